@@ -64,6 +64,7 @@ extern bool safe_mode;
 extern bool disable_3p_plugins;
 extern bool opt_disable_updater;
 extern bool opt_disable_missing_files_check;
+extern bool opt_gpu_profiler;
 extern string opt_starting_collection;
 extern string opt_starting_profile;
 
@@ -275,6 +276,7 @@ void OBSApp::InitUserConfigDefaults()
 	config_set_default_bool(userConfig, "BasicWindow", "CenterSnapping", false);
 	config_set_default_double(userConfig, "BasicWindow", "SnapDistance", 10.0);
 	config_set_default_bool(userConfig, "BasicWindow", "SpacingHelpersEnabled", true);
+	config_set_default_int(userConfig, "BasicWindow", "PreviewFPS", 0);
 	config_set_default_bool(userConfig, "BasicWindow", "RecordWhenStreaming", false);
 	config_set_default_bool(userConfig, "BasicWindow", "KeepRecordingWhenStreamStops", false);
 	config_set_default_bool(userConfig, "BasicWindow", "SysTrayEnabled", true);
@@ -295,7 +297,13 @@ void OBSApp::InitUserConfigDefaults()
 
 	config_set_default_bool(userConfig, "BasicWindow", "MultiviewDrawAreas", true);
 
+	config_set_default_int(userConfig, "BasicWindow", "MultiviewThumbnailFPS", 0);
+
 	config_set_default_bool(userConfig, "BasicWindow", "MediaControlsCountdownTimer", true);
+
+	config_set_default_int(userConfig, "Remux", "ConcurrentJobs", 2);
+	config_set_default_uint(userConfig, "Remux", "MaxMBps", 0);
+	config_set_default_bool(userConfig, "Remux", "FastStart", false);
 }
 
 static bool do_mkdir(const char *path)
@@ -1051,6 +1059,9 @@ bool OBSApp::OBSInit()
 
 	libobs_initialized = true;
 
+	if (opt_gpu_profiler)
+		obs_enable_gpu_profiler(true);
+
 	obs_set_ui_task_handler(ui_task_handler);
 
 #if defined(_WIN32) || defined(__APPLE__)
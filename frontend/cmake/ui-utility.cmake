@@ -9,6 +9,8 @@ target_sources(
     utility/BasicOutputHandler.cpp
     utility/BasicOutputHandler.hpp
     utility/display-helpers.hpp
+    utility/EncoderProbe.cpp
+    utility/EncoderProbe.hpp
     utility/FFmpegCodec.cpp
     utility/FFmpegCodec.hpp
     utility/FFmpegFormat.cpp
@@ -51,6 +53,8 @@ target_sources(
     utility/RemuxQueueModel.hpp
     utility/RemuxWorker.cpp
     utility/RemuxWorker.hpp
+    utility/SaveWorker.cpp
+    utility/SaveWorker.hpp
     utility/SceneRenameDelegate.cpp
     utility/SceneRenameDelegate.hpp
     utility/ScreenshotObj.cpp
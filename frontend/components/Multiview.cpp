@@ -19,6 +19,8 @@ Multiview::~Multiview()
 	}
 
 	obs_enter_graphics();
+	for (Thumbnail &thumbnail : thumbnails)
+		gs_texrender_destroy(thumbnail.texrender);
 	gs_vertexbuffer_destroy(actionSafeMargin);
 	gs_vertexbuffer_destroy(graphicsSafeMargin);
 	gs_vertexbuffer_destroy(fourByThreeSafeMargin);
@@ -64,11 +66,17 @@ static OBSSource CreateLabel(const char *name, size_t h)
 	return txtSource.Get();
 }
 
-void Multiview::Update(MultiviewLayout multiviewLayout, bool drawLabel, bool drawSafeArea)
+void Multiview::Update(MultiviewLayout multiviewLayout, bool drawLabel, bool drawSafeArea, int thumbnailFPS)
 {
 	this->multiviewLayout = multiviewLayout;
 	this->drawLabel = drawLabel;
 	this->drawSafeArea = drawSafeArea;
+	thumbnailInterval = thumbnailFPS > 0 ? 1000000000ULL / uint64_t(thumbnailFPS) : 0;
+
+	// Textures are only touched in the graphics thread, this just makes
+	// every tile render again the next time it is drawn
+	for (Thumbnail &thumbnail : thumbnails)
+		thumbnail.lastUpdate = 0;
 
 	multiviewScenes.clear();
 	multiviewLabels.clear();
@@ -207,6 +215,74 @@ static inline uint32_t labelOffset(MultiviewLayout multiviewLayout, obs_source_t
 	return (cx / 2) - w;
 }
 
+void Multiview::RenderThumbnail(size_t i, obs_source_t *src, uint64_t now)
+{
+	if (thumbnails.size() <= i)
+		thumbnails.resize(i + 1);
+
+	Thumbnail &thumbnail = thumbnails[i];
+	enum gs_color_space space = gs_get_color_space();
+	uint32_t texCX = uint32_t(siCX);
+	uint32_t texCY = uint32_t(siCY);
+
+	if (!texCX || !texCY)
+		return;
+
+	if (thumbnail.texrender && thumbnail.space != space) {
+		gs_texrender_destroy(thumbnail.texrender);
+		thumbnail.texrender = nullptr;
+	}
+	if (!thumbnail.texrender) {
+		thumbnail.texrender = gs_texrender_create(gs_get_format_from_space(space), GS_ZS_NONE);
+		thumbnail.space = space;
+		thumbnail.lastUpdate = 0;
+	}
+
+	if (!thumbnail.lastUpdate || now - thumbnail.lastUpdate >= thumbnailInterval) {
+		gs_texrender_reset(thumbnail.texrender);
+		if (gs_texrender_begin_with_color_space(thumbnail.texrender, texCX, texCY, space)) {
+			vec4 clear_color;
+			vec4_zero(&clear_color);
+
+			gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+			gs_ortho(0.0f, fw, 0.0f, fh, -100.0f, 100.0f);
+
+			gs_blend_state_push();
+			gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE,
+						   GS_BLEND_INVSRCALPHA);
+			obs_source_video_render(src);
+			gs_blend_state_pop();
+
+			gs_texrender_end(thumbnail.texrender);
+		}
+
+		// Spread the first updates over the interval so the tiles
+		// don't all render again in the same frame
+		if (!thumbnail.lastUpdate && numSrcs)
+			now -= thumbnailInterval * i / numSrcs;
+		thumbnail.lastUpdate = now;
+	}
+
+	gs_texture_t *tex = gs_texrender_get_texture(thumbnail.texrender);
+	if (!tex)
+		return;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_set_texture_srgb(image, tex);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, texCX, texCY);
+	gs_blend_state_pop();
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 void Multiview::Render(uint32_t cx, uint32_t cy)
 {
 	OBSBasic *main = (OBSBasic *)obs_frontend_get_main_window();
@@ -223,6 +299,7 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 	OBSSource previewSrc = main->GetCurrentSceneSource();
 	OBSSource programSrc = main->GetProgramSource();
 	bool studioMode = main->IsPreviewProgramMode();
+	uint64_t now = thumbnailInterval ? os_gettime_ns() : 0;
 
 	auto drawBox = [&](float cx, float cy, uint32_t colorVal) {
 		gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
@@ -410,14 +487,23 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 
 		/* ----------- */
 
-		// Render the source
-		gs_matrix_push();
-		gs_matrix_translate3f(siX, siY, 0.0f);
-		gs_matrix_scale3f(siScaleX, siScaleY, 1.0f);
-		setRegion(siX, siY, siCX, siCY);
-		obs_source_video_render(src);
-		endRegion();
-		gs_matrix_pop();
+		// Render the source, preview and program are always live
+		if (thumbnailInterval && colorVal == outerColor) {
+			gs_matrix_push();
+			gs_matrix_translate3f(siX, siY, 0.0f);
+			setRegion(siX, siY, siCX, siCY);
+			RenderThumbnail(i, src, now);
+			endRegion();
+			gs_matrix_pop();
+		} else {
+			gs_matrix_push();
+			gs_matrix_translate3f(siX, siY, 0.0f);
+			gs_matrix_scale3f(siScaleX, siScaleY, 1.0f);
+			setRegion(siX, siY, siCX, siCY);
+			obs_source_video_render(src);
+			endRegion();
+			gs_matrix_pop();
+		}
 
 		/* ----------- */
 
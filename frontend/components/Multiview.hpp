@@ -21,7 +21,7 @@ class Multiview {
 public:
 	Multiview();
 	~Multiview();
-	void Update(MultiviewLayout multiviewLayout, bool drawLabel, bool drawSafeArea);
+	void Update(MultiviewLayout multiviewLayout, bool drawLabel, bool drawSafeArea, int thumbnailFPS = 0);
 	void Render(uint32_t cx, uint32_t cy);
 	OBSSource GetSourceByPosition(int x, int y);
 
@@ -39,6 +39,17 @@ private:
 	std::vector<OBSWeakSource> multiviewScenes;
 	std::vector<OBSSource> multiviewLabels;
 
+	// Scenes that are neither preview nor program are rendered into these
+	// at a reduced rate when thumbnailInterval is set, 0 renders them live
+	struct Thumbnail {
+		gs_texrender_t *texrender = nullptr;
+		enum gs_color_space space = GS_CS_SRGB;
+		uint64_t lastUpdate = 0;
+	};
+	std::vector<Thumbnail> thumbnails;
+	uint64_t thumbnailInterval = 0;
+
+	void RenderThumbnail(size_t i, obs_source_t *src, uint64_t now);
 	// Multiview position helpers
 	float thickness = 6;
 	float offset, thicknessx2 = thickness * 2, pvwprgCX, pvwprgCY, sourceX, sourceY, labelX, labelY, scenesCX,
@@ -81,20 +81,30 @@ void SceneTree::resizeEvent(QResizeEvent *event)
 		int itemWidth = wid / items;
 
 		setGridSize(QSize(itemWidth, itemHeight));
-
-		for (int i = 0; i < count(); i++) {
-			item(i)->setSizeHint(QSize(itemWidth, itemHeight));
-		}
+		SetItemSizes(QSize(itemWidth, itemHeight));
 	} else {
 		setGridSize(QSize());
-		for (int i = 0; i < count(); i++) {
-			item(i)->setData(Qt::SizeHintRole, QVariant());
-		}
+		SetItemSizes(QSize());
 	}
 
 	QListWidget::resizeEvent(event);
 }
 
+void SceneTree::SetItemSizes(QSize size)
+{
+	if (size == itemSize)
+		return;
+
+	itemSize = size;
+
+	for (int i = 0; i < count(); i++) {
+		if (size.isValid())
+			item(i)->setSizeHint(size);
+		else
+			item(i)->setData(Qt::SizeHintRole, QVariant());
+	}
+}
+
 void SceneTree::startDrag(Qt::DropActions supportedActions)
 {
 	QListWidget::startDrag(supportedActions);
@@ -228,6 +238,12 @@ void SceneTree::dragLeaveEvent(QDragLeaveEvent *event)
 
 void SceneTree::rowsInserted(const QModelIndex &parent, int start, int end)
 {
+	/* only the new items need the current size, the rest already have it */
+	if (itemSize.isValid()) {
+		for (int i = start; i <= end; i++)
+			item(i)->setSizeHint(itemSize);
+	}
+
 	QResizeEvent event(size(), size());
 	SceneTree::resizeEvent(&event);
 
@@ -14,6 +14,10 @@ class SceneTree : public QListWidget {
 	int maxWidth = 150;
 	int itemHeight = 24;
 
+	/* the size hint every item has, so resizes and inserts only touch the
+	 * items when it changes */
+	QSize itemSize;
+
 public:
 	void SetGridMode(bool grid);
 	bool GetGridMode();
@@ -27,6 +31,7 @@ public:
 
 private:
 	void RepositionGrid(QDragMoveEvent *event = nullptr);
+	void SetItemSizes(QSize size);
 
 protected:
 	virtual bool eventFilter(QObject *obj, QEvent *event) override;
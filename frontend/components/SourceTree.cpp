@@ -7,6 +7,9 @@
 
 #include "moc_SourceTree.cpp"
 
+/* rows above and below the visible ones that get a widget ahead of time */
+#define WIDGET_ROW_MARGIN 8
+
 static inline OBSScene GetCurrentScene()
 {
 	OBSBasic *main = OBSBasic::Get();
@@ -39,11 +42,17 @@ SourceTree::SourceTree(QWidget *parent_) : QListView(parent_)
 	connect(App(), &OBSApp::StyleChanged, this, &SourceTree::UpdateIcons);
 
 	setItemDelegate(new SourceTreeDelegate(this));
+
+	connect(stm_, &QAbstractItemModel::rowsInserted, this, &SourceTree::QueueCreateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::rowsRemoved, this, &SourceTree::QueueCreateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::rowsMoved, this, &SourceTree::QueueCreateVisibleWidgets);
 }
 
 void SourceTree::UpdateIcons()
 {
 	SourceTreeModel *stm = GetStm();
+
+	itemHeight = 0;
 	stm->SceneChanged();
 }
 
@@ -52,25 +61,48 @@ void SourceTree::SetIconsVisible(bool visible)
 	SourceTreeModel *stm = GetStm();
 
 	iconsVisible = visible;
+	itemHeight = 0;
 	stm->SceneChanged();
 }
 
 void SourceTree::ResetWidgets()
 {
-	OBSScene scene = GetCurrentScene();
-
 	SourceTreeModel *stm = GetStm();
 	stm->UpdateGroupState(false);
 
-	for (int i = 0; i < stm->items.count(); i++) {
-		QModelIndex index = stm->createIndex(i, 0, nullptr);
-		setIndexWidget(index, new SourceTreeItem(this, stm->items[i]));
-	}
+	CreateVisibleWidgets();
+}
+
+SourceTreeItem *SourceTree::CreateItemWidget(int idx)
+{
+	SourceTreeModel *stm = GetStm();
+	SourceTreeItem *widget = new SourceTreeItem(this, stm->items[idx]);
+
+	setIndexWidget(stm->createIndex(idx, 0), widget);
+
+	if (!itemHeight)
+		itemHeight = widget->sizeHint().height();
+	return widget;
+}
+
+SourceTreeItem *SourceTree::GetItemWidget(int idx)
+{
+	SourceTreeModel *stm = GetStm();
+	if (idx < 0 || idx >= stm->items.count())
+		return nullptr;
+
+	QWidget *widget = indexWidget(stm->createIndex(idx, 0));
+	return widget ? reinterpret_cast<SourceTreeItem *>(widget) : CreateItemWidget(idx);
 }
 
-void SourceTree::UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item)
+SourceTreeItem *SourceTree::GetExistingItemWidget(obs_sceneitem_t *item)
 {
-	setIndexWidget(idx, new SourceTreeItem(this, item));
+	SourceTreeModel *stm = GetStm();
+	int idx = stm->IndexOf(item);
+	if (idx == -1)
+		return nullptr;
+
+	return reinterpret_cast<SourceTreeItem *>(indexWidget(stm->createIndex(idx, 0)));
 }
 
 void SourceTree::UpdateWidgets(bool force)
@@ -78,33 +110,106 @@ void SourceTree::UpdateWidgets(bool force)
 	SourceTreeModel *stm = GetStm();
 
 	for (int i = 0; i < stm->items.size(); i++) {
-		obs_sceneitem_t *item = stm->items[i];
-		SourceTreeItem *widget = GetItemWidget(i);
+		QWidget *widget = indexWidget(stm->createIndex(i, 0));
+		if (widget)
+			reinterpret_cast<SourceTreeItem *>(widget)->Update(force);
+	}
 
-		if (!widget) {
-			UpdateWidget(stm->createIndex(i, 0), item);
-		} else {
-			widget->Update(force);
-		}
+	QueueCreateVisibleWidgets();
+}
+
+void SourceTree::QueueCreateVisibleWidgets()
+{
+	if (widgetsQueued)
+		return;
+
+	widgetsQueued = true;
+	QMetaObject::invokeMethod(this, "CreateVisibleWidgets", Qt::QueuedConnection);
+}
+
+void SourceTree::CreateVisibleWidgets()
+{
+	SourceTreeModel *stm = GetStm();
+	int count = stm->items.count();
+
+	widgetsQueued = false;
+	if (!count)
+		return;
+
+	/* rows without a widget take their height from the first one made */
+	if (!itemHeight) {
+		if (!indexWidget(stm->createIndex(0, 0)))
+			CreateItemWidget(0);
+		scheduleDelayedItemsLayout();
+	}
+
+	executeDelayedItemsLayout();
+
+	QModelIndex first = indexAt(QPoint(0, 0));
+	QModelIndex last = indexAt(QPoint(0, viewport()->height() - 1));
+	int start = first.isValid() ? first.row() : 0;
+	int end = last.isValid() ? last.row() : count - 1;
+
+	start = std::max(start - WIDGET_ROW_MARGIN, 0);
+	end = std::min(end + WIDGET_ROW_MARGIN, count - 1);
+
+	for (int i = start; i <= end; i++) {
+		if (!indexWidget(stm->createIndex(i, 0)))
+			CreateItemWidget(i);
 	}
 }
 
-void SourceTree::SelectItem(obs_sceneitem_t *sceneitem, bool select)
+void SourceTree::SourceRemoved(OBSSource source)
 {
 	SourceTreeModel *stm = GetStm();
-	int i = 0;
 
-	for (; i < stm->items.count(); i++) {
-		if (stm->items[i] == sceneitem)
+	for (auto &item : stm->items) {
+		if (obs_sceneitem_get_source(item) == source) {
+			stm->SyncItems();
 			break;
+		}
 	}
+}
+
+void SourceTree::ItemVisibilityChanged(OBSSceneItem item, bool visible)
+{
+	SourceTreeItem *widget = GetExistingItemWidget(item);
+	if (widget)
+		widget->VisibilityChanged(visible);
+}
+
+void SourceTree::ItemLockedChanged(OBSSceneItem item, bool locked)
+{
+	if (GetStm()->IndexOf(item) == -1)
+		return;
+
+	SourceTreeItem *widget = GetExistingItemWidget(item);
+	if (widget)
+		widget->LockedChanged(locked);
+	else
+		OBSBasic::Get()->UpdateEditMenu();
+}
 
-	if (i == stm->items.count())
+void SourceTree::ItemSelectionChanged(OBSSceneItem item, bool select)
+{
+	if (!SelectItem(item, select))
 		return;
 
+	OBSBasic::Get()->UpdateContextBarDeferred();
+	OBSBasic::Get()->UpdateEditMenu();
+}
+
+bool SourceTree::SelectItem(obs_sceneitem_t *sceneitem, bool select)
+{
+	SourceTreeModel *stm = GetStm();
+	int i = stm->IndexOf(sceneitem);
+	if (i == -1)
+		return false;
+
 	QModelIndex index = stm->createIndex(i, 0);
 	if (index.isValid() && select != selectionModel()->isSelected(index))
 		selectionModel()->select(index, select ? QItemSelectionModel::Select : QItemSelectionModel::Deselect);
+	return true;
 }
 
 void SourceTree::mouseDoubleClickEvent(QMouseEvent *event)
@@ -475,8 +580,7 @@ bool SourceTree::Edit(int row)
 		return false;
 
 	QModelIndex index = stm->createIndex(row, 0);
-	QWidget *widget = indexWidget(index);
-	SourceTreeItem *itemWidget = reinterpret_cast<SourceTreeItem *>(widget);
+	SourceTreeItem *itemWidget = GetItemWidget(row);
 	if (itemWidget->IsEditing()) {
 #ifdef __APPLE__
 		itemWidget->ExitEditMode(true);
@@ -561,7 +665,8 @@ bool SourceTree::GroupedItemsSelected() const
 void SourceTree::Remove(OBSSceneItem item, OBSScene scene)
 {
 	OBSBasic *main = OBSBasic::Get();
-	GetStm()->Remove(item);
+	if (!GetStm()->Remove(item))
+		return;
 	main->SaveProject();
 
 	if (!main->SavingDisabled()) {
@@ -636,3 +741,15 @@ void SourceTree::paintEvent(QPaintEvent *event)
 		QListView::paintEvent(event);
 	}
 }
+
+void SourceTree::resizeEvent(QResizeEvent *event)
+{
+	QListView::resizeEvent(event);
+	QueueCreateVisibleWidgets();
+}
+
+void SourceTree::scrollContentsBy(int dx, int dy)
+{
+	QListView::scrollContentsBy(dx, dy);
+	CreateVisibleWidgets();
+}
@@ -23,20 +23,26 @@ class SourceTree : public QListView {
 
 	bool iconsVisible = true;
 
+	/* row widgets are only created for the rows around the visible ones,
+	 * rows without one are sized like the first widget that was made */
+	int itemHeight = 0;
+	bool widgetsQueued = false;
+
 	void UpdateNoSourcesMessage();
 
 	void ResetWidgets();
-	void UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item);
+	SourceTreeItem *CreateItemWidget(int idx);
+	SourceTreeItem *GetExistingItemWidget(obs_sceneitem_t *item);
 	void UpdateWidgets(bool force = false);
+	void QueueCreateVisibleWidgets();
 
 	inline SourceTreeModel *GetStm() const { return reinterpret_cast<SourceTreeModel *>(model()); }
 
 public:
-	inline SourceTreeItem *GetItemWidget(int idx)
-	{
-		QWidget *widget = indexWidget(GetStm()->createIndex(idx, 0));
-		return reinterpret_cast<SourceTreeItem *>(widget);
-	}
+	/* creates the widget of the row if it hasn't been yet */
+	SourceTreeItem *GetItemWidget(int idx);
+
+	inline int GetItemHeight() const { return itemHeight; }
 
 	explicit SourceTree(QWidget *parent = nullptr);
 
@@ -47,7 +53,7 @@ public:
 	inline OBSSceneItem Get(int idx) { return GetStm()->Get(idx); }
 	inline QString GetNewGroupName() { return GetStm()->GetNewGroupName(); }
 
-	void SelectItem(obs_sceneitem_t *sceneitem, bool select);
+	bool SelectItem(obs_sceneitem_t *sceneitem, bool select);
 
 	bool MultipleBaseSelected() const;
 	bool GroupsSelected() const;
@@ -57,8 +63,8 @@ public:
 	void SetIconsVisible(bool visible);
 
 public slots:
-	inline void ReorderItems() { GetStm()->ReorderItems(); }
-	inline void RefreshItems() { GetStm()->SceneChanged(); }
+	inline void ReorderItems() { GetStm()->SyncItems(); }
+	inline void RefreshItems() { GetStm()->SyncItems(); }
 	void Remove(OBSSceneItem item, OBSScene scene);
 	void GroupSelectedItems();
 	void UngroupSelectedGroups();
@@ -66,10 +72,19 @@ public slots:
 	bool Edit(int idx);
 	void NewGroupEdit(int idx);
 
+private slots:
+	void CreateVisibleWidgets();
+	void SourceRemoved(OBSSource source);
+	void ItemVisibilityChanged(OBSSceneItem item, bool visible);
+	void ItemLockedChanged(OBSSceneItem item, bool locked);
+	void ItemSelectionChanged(OBSSceneItem item, bool select);
+
 protected:
 	virtual void mouseDoubleClickEvent(QMouseEvent *event) override;
 	virtual void dropEvent(QDropEvent *event) override;
 	virtual void paintEvent(QPaintEvent *event) override;
+	virtual void resizeEvent(QResizeEvent *event) override;
+	virtual void scrollContentsBy(int dx, int dy) override;
 
 	virtual void selectionChanged(const QItemSelection &selected, const QItemSelection &deselected) override;
 };
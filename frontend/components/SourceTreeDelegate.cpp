@@ -10,7 +10,7 @@ QSize SourceTreeDelegate::sizeHint(const QStyleOptionViewItem &option, const QMo
 	QWidget *item = tree->indexWidget(index);
 
 	if (!item)
-		return (QSize(0, 0));
+		return (QSize(option.widget->minimumWidth(), tree->GetItemHeight()));
 
 	return (QSize(option.widget->minimumWidth(), item->height()));
 }
@@ -155,111 +155,6 @@ void SourceTreeItem::paintEvent(QPaintEvent *event)
 	QWidget::paintEvent(event);
 }
 
-void SourceTreeItem::DisconnectSignals()
-{
-	sigs.clear();
-}
-
-void SourceTreeItem::Clear()
-{
-	DisconnectSignals();
-	sceneitem = nullptr;
-}
-
-void SourceTreeItem::ReconnectSignals()
-{
-	if (!sceneitem)
-		return;
-
-	DisconnectSignals();
-
-	/* --------------------------------------------------------- */
-
-	auto removeItem = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem = (obs_sceneitem_t *)calldata_ptr(cd, "item");
-		obs_scene_t *curScene = (obs_scene_t *)calldata_ptr(cd, "scene");
-
-		if (curItem == this_->sceneitem) {
-			QMetaObject::invokeMethod(this_->tree, "Remove", Q_ARG(OBSSceneItem, curItem),
-						  Q_ARG(OBSScene, curScene));
-			curItem = nullptr;
-		}
-		if (!curItem)
-			QMetaObject::invokeMethod(this_, "Clear");
-	};
-
-	auto itemVisible = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem = (obs_sceneitem_t *)calldata_ptr(cd, "item");
-		bool visible = calldata_bool(cd, "visible");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "VisibilityChanged", Q_ARG(bool, visible));
-	};
-
-	auto itemLocked = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem = (obs_sceneitem_t *)calldata_ptr(cd, "item");
-		bool locked = calldata_bool(cd, "locked");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "LockedChanged", Q_ARG(bool, locked));
-	};
-
-	auto itemSelect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem = (obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Select");
-	};
-
-	auto itemDeselect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem = (obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Deselect");
-	};
-
-	auto reorderGroup = [](void *data, calldata_t *) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		QMetaObject::invokeMethod(this_->tree, "ReorderItems");
-	};
-
-	obs_scene_t *scene = obs_sceneitem_get_scene(sceneitem);
-	obs_source_t *sceneSource = obs_scene_get_source(scene);
-	signal_handler_t *signal = obs_source_get_signal_handler(sceneSource);
-
-	sigs.emplace_back(signal, "remove", removeItem, this);
-	sigs.emplace_back(signal, "item_remove", removeItem, this);
-	sigs.emplace_back(signal, "item_visible", itemVisible, this);
-	sigs.emplace_back(signal, "item_locked", itemLocked, this);
-	sigs.emplace_back(signal, "item_select", itemSelect, this);
-	sigs.emplace_back(signal, "item_deselect", itemDeselect, this);
-
-	if (obs_sceneitem_is_group(sceneitem)) {
-		obs_source_t *source = obs_sceneitem_get_source(sceneitem);
-		signal = obs_source_get_signal_handler(source);
-
-		sigs.emplace_back(signal, "reorder", reorderGroup, this);
-	}
-
-	/* --------------------------------------------------------- */
-
-	auto removeSource = [](void *data, calldata_t *) {
-		SourceTreeItem *this_ = reinterpret_cast<SourceTreeItem *>(data);
-		this_->DisconnectSignals();
-		this_->sceneitem = nullptr;
-		QMetaObject::invokeMethod(this_->tree, "RefreshItems");
-	};
-
-	obs_source_t *source = obs_sceneitem_get_source(sceneitem);
-	signal = obs_source_get_signal_handler(source);
-	sigs.emplace_back(signal, "remove", removeSource, this);
-}
-
 void SourceTreeItem::mouseDoubleClickEvent(QMouseEvent *event)
 {
 	QWidget::mouseDoubleClickEvent(event);
@@ -476,8 +371,6 @@ void SourceTreeItem::Update(bool force)
 
 	/* ------------------------------------------------- */
 
-	ReconnectSignals();
-
 	if (spacer) {
 		boxLayout->removeItem(spacer);
 		delete spacer;
@@ -528,17 +421,3 @@ void SourceTreeItem::ExpandClicked(bool checked)
 	else
 		tree->GetStm()->CollapseGroup(sceneitem);
 }
-
-void SourceTreeItem::Select()
-{
-	tree->SelectItem(sceneitem, true);
-	OBSBasic::Get()->UpdateContextBarDeferred();
-	OBSBasic::Get()->UpdateEditMenu();
-}
-
-void SourceTreeItem::Deselect()
-{
-	tree->SelectItem(sceneitem, false);
-	OBSBasic::Get()->UpdateContextBarDeferred();
-	OBSBasic::Get()->UpdateEditMenu();
-}
@@ -34,9 +34,6 @@ class SourceTreeItem : public QFrame {
 		SubItem,
 	};
 
-	void DisconnectSignals();
-	void ReconnectSignals();
-
 	Type type = Type::Unknown;
 
 public:
@@ -58,15 +55,12 @@ private:
 
 	SourceTree *tree;
 	OBSSceneItem sceneitem;
-	std::vector<OBSSignal> sigs;
 
 	virtual void paintEvent(QPaintEvent *event) override;
 
 	void ExitEditModeInternal(bool save);
 
 private slots:
-	void Clear();
-
 	void EnterEditMode();
 	void ExitEditMode(bool save);
 
@@ -74,7 +68,4 @@ private slots:
 	void LockedChanged(bool locked);
 
 	void ExpandClicked(bool checked);
-
-	void Select();
-	void Deselect();
 };
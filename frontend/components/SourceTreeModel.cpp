@@ -4,6 +4,10 @@
 
 #include <qt-wrappers.hpp>
 
+#include <QSet>
+
+#include <algorithm>
+
 #include "moc_SourceTreeModel.cpp"
 
 static inline OBSScene GetCurrentScene()
@@ -39,6 +43,9 @@ void SourceTreeModel::Clear()
 	endResetModel();
 
 	hasGroups = false;
+
+	sigs.clear();
+	signalScenes.clear();
 }
 
 static bool enumItem(obs_scene_t *, obs_sceneitem_t *item, void *ptr)
@@ -84,6 +91,8 @@ void SourceTreeModel::SceneChanged()
 		st->selectionModel()->select(index,
 					     select ? QItemSelectionModel::Select : QItemSelectionModel::Deselect);
 	}
+
+	ConnectSignals();
 }
 
 /* moves a scene item index (blame linux distros for using older Qt builds) */
@@ -94,80 +103,181 @@ static inline void MoveItem(QVector<OBSSceneItem> &items, int oldIdx, int newIdx
 	items.insert(newIdx, item);
 }
 
-/* reorders list optimally with model reorder funcs */
-void SourceTreeModel::ReorderItems()
+/* brings the list in line with the scene with row removals, inserts and
+ * moves instead of a reset, so rows that didn't change keep their widgets */
+void SourceTreeModel::SyncItems()
 {
 	OBSScene scene = GetCurrentScene();
 
 	QVector<OBSSceneItem> newitems;
 	obs_scene_enum_items(scene, enumItem, &newitems);
 
-	/* if item list has changed size, do full reset */
-	if (newitems.count() != items.count()) {
-		SceneChanged();
-		return;
+	QHash<obs_sceneitem_t *, int> newIndices;
+	for (int i = 0; i < newitems.count(); i++)
+		newIndices.insert(newitems[i], i);
+
+	/* remove the rows of items that are gone */
+	for (int i = items.count() - 1; i >= 0; i--) {
+		if (newIndices.contains(items[i]))
+			continue;
+
+		int end = i;
+		while (i > 0 && !newIndices.contains(items[i - 1]))
+			i--;
+
+		beginRemoveRows(QModelIndex(), i, end);
+		items.remove(i, end - i + 1);
+		endRemoveRows();
 	}
 
-	for (;;) {
-		int idx1Old = 0;
-		int idx1New = 0;
-		int count;
-		int i;
-
-		/* find first starting changed item index */
-		for (i = 0; i < newitems.count(); i++) {
-			obs_sceneitem_t *oldItem = items[i];
-			obs_sceneitem_t *newItem = newitems[i];
-			if (oldItem != newItem) {
-				idx1Old = i;
-				break;
-			}
-		}
+	QSet<obs_sceneitem_t *> oldItems;
+	for (auto &item : items)
+		oldItems.insert(item);
 
-		/* if everything is the same, break */
-		if (i == newitems.count()) {
-			break;
-		}
+	/* every step puts the right item at row i, either by moving the row
+	 * that's there down to where it belongs, by moving the right item up,
+	 * or by inserting it */
+	QVector<int> inserted;
+	for (int i = 0; i < newitems.count(); i++) {
+		obs_sceneitem_t *item = newitems[i];
 
-		/* find new starting index */
-		for (i = idx1Old + 1; i < newitems.count(); i++) {
-			obs_sceneitem_t *oldItem = items[idx1Old];
-			obs_sceneitem_t *newItem = newitems[i];
+		if (i < items.count() && items[i] == item)
+			continue;
 
-			if (oldItem == newItem) {
-				idx1New = i;
-				break;
+		if (i + 1 < items.count() && items[i + 1] == item) {
+			int to = std::min(newIndices.value(items[i]), (int)items.count() - 1);
+
+			beginMoveRows(QModelIndex(), i, i, QModelIndex(), to + 1);
+			MoveItem(items, i, to);
+			endMoveRows();
+			continue;
+		}
+
+		int from = -1;
+		if (oldItems.contains(item)) {
+			for (int j = i + 1; j < items.count(); j++) {
+				if (items[j] == item) {
+					from = j;
+					break;
+				}
 			}
 		}
 
-		/* if item could not be found, do full reset */
-		if (i == newitems.count()) {
-			SceneChanged();
-			return;
+		if (from != -1) {
+			beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+			MoveItem(items, from, i);
+			endMoveRows();
+		} else {
+			beginInsertRows(QModelIndex(), i, i);
+			items.insert(i, item);
+			endInsertRows();
+			inserted.push_back(i);
 		}
+	}
 
-		/* get move count */
-		for (count = 1; (idx1New + count) < newitems.count(); count++) {
-			int oldIdx = idx1Old + count;
-			int newIdx = idx1New + count;
+	for (int row : inserted) {
+		if (obs_sceneitem_selected(items[row]))
+			st->selectionModel()->select(createIndex(row, 0), QItemSelectionModel::Select);
+	}
 
-			obs_sceneitem_t *oldItem = items[oldIdx];
-			obs_sceneitem_t *newItem = newitems[newIdx];
+	UpdateGroupState(true);
+	st->UpdateWidgets();
+	ConnectSignals();
+}
 
-			if (oldItem != newItem) {
-				break;
-			}
-		}
+static void ItemRemoved(void *data, calldata_t *cd)
+{
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(cd, "scene");
 
-		/* move items */
-		beginMoveRows(QModelIndex(), idx1Old, idx1Old + count - 1, QModelIndex(), idx1New + count);
-		for (i = 0; i < count; i++) {
-			int to = idx1New + count;
-			if (to > idx1Old)
-				to--;
-			MoveItem(items, idx1Old, to);
-		}
-		endMoveRows();
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "Remove", Q_ARG(OBSSceneItem, item),
+				  Q_ARG(OBSScene, scene));
+}
+
+static void ItemVisible(void *data, calldata_t *cd)
+{
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+	bool visible = calldata_bool(cd, "visible");
+
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "ItemVisibilityChanged", Q_ARG(OBSSceneItem, item),
+				  Q_ARG(bool, visible));
+}
+
+static void ItemLocked(void *data, calldata_t *cd)
+{
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+	bool locked = calldata_bool(cd, "locked");
+
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "ItemLockedChanged", Q_ARG(OBSSceneItem, item),
+				  Q_ARG(bool, locked));
+}
+
+static void ItemSelect(void *data, calldata_t *cd)
+{
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "ItemSelectionChanged", Q_ARG(OBSSceneItem, item),
+				  Q_ARG(bool, true));
+}
+
+static void ItemDeselect(void *data, calldata_t *cd)
+{
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "ItemSelectionChanged", Q_ARG(OBSSceneItem, item),
+				  Q_ARG(bool, false));
+}
+
+static void GroupReordered(void *data, calldata_t *)
+{
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "ReorderItems");
+}
+
+static void SourceRemoved(void *data, calldata_t *cd)
+{
+	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
+
+	QMetaObject::invokeMethod(static_cast<SourceTree *>(data), "SourceRemoved",
+				  Q_ARG(OBSSource, OBSSource(source)));
+}
+
+/* the list listens to the scene and its groups once instead of every row
+ * widget listening on its own, so rows don't need a widget to stay in sync */
+void SourceTreeModel::ConnectSignals()
+{
+	QVector<OBSScene> scenes;
+
+	OBSScene scene = GetCurrentScene();
+	if (scene)
+		scenes.push_back(scene);
+
+	for (auto &item : items) {
+		if (obs_sceneitem_is_group(item))
+			scenes.push_back(obs_sceneitem_group_get_scene(item));
+	}
+
+	if (scenes == signalScenes)
+		return;
+
+	sigs.clear();
+	signalScenes = scenes;
+
+	if (scenes.empty())
+		return;
+
+	sigs.emplace_back(obs_get_signal_handler(), "source_remove", SourceRemoved, st);
+
+	for (auto &itemScene : scenes) {
+		signal_handler_t *signal = obs_source_get_signal_handler(obs_scene_get_source(itemScene));
+
+		sigs.emplace_back(signal, "item_remove", ItemRemoved, st);
+		sigs.emplace_back(signal, "item_visible", ItemVisible, st);
+		sigs.emplace_back(signal, "item_locked", ItemLocked, st);
+		sigs.emplace_back(signal, "item_select", ItemSelect, st);
+		sigs.emplace_back(signal, "item_deselect", ItemDeselect, st);
+
+		if (itemScene != scene)
+			sigs.emplace_back(signal, "reorder", GroupReordered, st);
 	}
 }
 
@@ -179,23 +289,14 @@ void SourceTreeModel::Add(obs_sceneitem_t *item)
 		beginInsertRows(QModelIndex(), 0, 0);
 		items.insert(0, item);
 		endInsertRows();
-
-		st->UpdateWidget(createIndex(0, 0, nullptr), item);
 	}
 }
 
-void SourceTreeModel::Remove(obs_sceneitem_t *item)
+bool SourceTreeModel::Remove(obs_sceneitem_t *item)
 {
-	int idx = -1;
-	for (int i = 0; i < items.count(); i++) {
-		if (items[i] == item) {
-			idx = i;
-			break;
-		}
-	}
-
+	int idx = IndexOf(item);
 	if (idx == -1)
-		return;
+		return false;
 
 	int startIdx = idx;
 	int endIdx = idx;
@@ -219,10 +320,23 @@ void SourceTreeModel::Remove(obs_sceneitem_t *item)
 	items.remove(idx, endIdx - startIdx + 1);
 	endRemoveRows();
 
-	if (is_group)
+	if (is_group) {
 		UpdateGroupState(true);
+		ConnectSignals();
+	}
 
 	OBSBasic::Get()->UpdateContextBarDeferred();
+	return true;
+}
+
+int SourceTreeModel::IndexOf(obs_sceneitem_t *item) const
+{
+	for (int i = 0; i < items.count(); i++) {
+		if (items[i] == item)
+			return i;
+	}
+
+	return -1;
 }
 
 OBSSceneItem SourceTreeModel::Get(int idx)
@@ -297,8 +411,8 @@ void SourceTreeModel::AddGroup()
 	items.insert(0, group);
 	endInsertRows();
 
-	st->UpdateWidget(createIndex(0, 0, nullptr), group);
 	UpdateGroupState(true);
+	ConnectSignals();
 
 	QMetaObject::invokeMethod(st, "Edit", Qt::QueuedConnection, Q_ARG(int, 0));
 }
@@ -360,7 +474,7 @@ void SourceTreeModel::UngroupSelectedGroups(QModelIndexList &indices)
 		obs_sceneitem_group_ungroup(item);
 	}
 
-	SceneChanged();
+	SyncItems();
 
 	OBSData redoData = main->BackupScene(scene);
 	main->CreateSceneUndoRedoAction(QTStr("Basic.Main.Ungroup"), undoData, redoData);
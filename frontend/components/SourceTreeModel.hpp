@@ -5,6 +5,8 @@
 
 #include <QAbstractListModel>
 
+#include <vector>
+
 class SourceTree;
 
 class SourceTreeModel : public QAbstractListModel {
@@ -17,13 +19,18 @@ class SourceTreeModel : public QAbstractListModel {
 	QVector<OBSSceneItem> items;
 	bool hasGroups = false;
 
+	QVector<OBSScene> signalScenes;
+	std::vector<OBSSignal> sigs;
+
 	static void OBSFrontendEvent(enum obs_frontend_event event, void *ptr);
 	void Clear();
 	void SceneChanged();
-	void ReorderItems();
+	void SyncItems();
+	void ConnectSignals();
 
 	void Add(obs_sceneitem_t *item);
-	void Remove(obs_sceneitem_t *item);
+	bool Remove(obs_sceneitem_t *item);
+	int IndexOf(obs_sceneitem_t *item) const;
 	OBSSceneItem Get(int idx);
 	QString GetNewGroupName();
 	void AddGroup();
@@ -29,12 +29,15 @@
 #include <QMimeData>
 #include <QPushButton>
 
+#include <algorithm>
+
 #include "moc_OBSRemux.cpp"
 
+static constexpr int MAX_REMUX_JOBS = 8;
+
 OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 	: QDialog(parent),
 	  queueModel(new RemuxQueueModel),
-	  worker(new RemuxWorker()),
 	  ui(new Ui::OBSRemux),
 	  recPath(path),
 	  autoRemux(autoRemux_)
@@ -85,13 +88,31 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 		&OBSRemux::clearAll);
 	connect(ui->buttonBox->button(QDialogButtonBox::Close), &QPushButton::clicked, this, &OBSRemux::close);
 
-	worker->moveToThread(&remuxer);
-	remuxer.start();
-
-	connect(worker.data(), &RemuxWorker::updateProgress, this, &OBSRemux::updateProgress);
-	connect(&remuxer, &QThread::finished, worker.data(), &QObject::deleteLater);
-	connect(worker.data(), &RemuxWorker::remuxFinished, this, &OBSRemux::remuxFinished);
-	connect(this, &OBSRemux::remux, worker.data(), &RemuxWorker::remux);
+	config_t *config = App()->GetUserConfig();
+	int jobs = autoRemux ? 1 : (int)config_get_int(config, "Remux", "ConcurrentJobs");
+	jobs = std::clamp(jobs, 1, MAX_REMUX_JOBS);
+
+	// The limit is shared by all jobs
+	bool faststart = config_get_bool(config, "Remux", "FastStart");
+	uint64_t maxBytesPerSec = config_get_uint(config, "Remux", "MaxMBps") * 1000000 / jobs;
+
+	for (int i = 0; i < jobs; i++) {
+		Remuxer *remuxer = remuxers.emplace_back(std::make_unique<Remuxer>()).get();
+
+		remuxer->worker = new RemuxWorker();
+		remuxer->worker->faststart = faststart;
+		remuxer->worker->maxBytesPerSec = maxBytesPerSec;
+		remuxer->worker->moveToThread(&remuxer->thread);
+		remuxer->thread.start();
+
+		connect(remuxer->worker.data(), &RemuxWorker::updateProgress, this, [this, remuxer](float percent) {
+			remuxer->progress = percent;
+			UpdateProgress();
+		});
+		connect(&remuxer->thread, &QThread::finished, remuxer->worker.data(), &QObject::deleteLater);
+		connect(remuxer->worker.data(), &RemuxWorker::remuxFinished, this,
+			[this, remuxer](bool success) { RemuxFinished(remuxer, success); });
+	}
 
 	connect(queueModel.data(), &RemuxQueueModel::rowsInserted, this, &OBSRemux::rowCountChanged);
 	connect(queueModel.data(), &RemuxQueueModel::rowsRemoved, this, &OBSRemux::rowCountChanged);
@@ -101,15 +122,21 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 				  Q_ARG(const QModelIndex &, index));
 }
 
+bool OBSRemux::IsWorking() const
+{
+	return std::any_of(remuxers.begin(), remuxers.end(), [](const auto &remuxer) { return remuxer->busy; });
+}
+
 bool OBSRemux::stopRemux()
 {
-	if (!worker->isWorking)
+	if (!IsWorking())
 		return true;
 
-	// By locking the worker thread's mutex, we ensure that its
-	// update poll will be blocked as long as we're in here with
+	// By locking the worker threads' mutexes, we ensure that their
+	// update polls will be blocked as long as we're in here with
 	// the popup open.
-	QMutexLocker lock(&worker->updateMutex);
+	for (auto &remuxer : remuxers)
+		remuxer->worker->updateMutex.lock();
 
 	bool exit = false;
 
@@ -119,20 +146,27 @@ bool OBSRemux::stopRemux()
 	}
 
 	if (exit) {
-		// Inform the worker it should no longer be
-		// working. It will interrupt accordingly in
-		// its next update callback.
-		worker->isWorking = false;
+		// Inform the workers they should no longer be
+		// working. They will interrupt accordingly in
+		// their next update callback.
+		for (auto &remuxer : remuxers)
+			remuxer->worker->isWorking = false;
 	}
 
+	for (auto &remuxer : remuxers)
+		remuxer->worker->updateMutex.unlock();
+
 	return exit;
 }
 
 OBSRemux::~OBSRemux()
 {
 	stopRemux();
-	remuxer.quit();
-	remuxer.wait();
+
+	for (auto &remuxer : remuxers) {
+		remuxer->thread.quit();
+		remuxer->thread.wait();
+	}
 }
 
 void OBSRemux::rowCountChanged(const QModelIndex &, int, int)
@@ -190,13 +224,13 @@ void OBSRemux::dropEvent(QDropEvent *ev)
 
 void OBSRemux::dragEnterEvent(QDragEnterEvent *ev)
 {
-	if (ev->mimeData()->hasUrls() && !worker->isWorking)
+	if (ev->mimeData()->hasUrls() && !IsWorking())
 		ev->accept();
 }
 
 void OBSRemux::beginRemux()
 {
-	if (worker->isWorking) {
+	if (IsWorking()) {
 		stopRemux();
 		return;
 	}
@@ -221,6 +255,9 @@ void OBSRemux::beginRemux()
 	// Set all jobs to "pending" first.
 	queueModel->beginProcessing();
 
+	batchTotal = queueModel->countEntries(RemuxEntryState::Pending);
+	batchDone = 0;
+
 	ui->progressBar->setVisible(true);
 	ui->buttonBox->button(QDialogButtonBox::Ok)->setText(QTStr("Remux.Stop"));
 	setAcceptDrops(false);
@@ -232,19 +269,40 @@ void OBSRemux::AutoRemux(QString inFile, QString outFile)
 {
 	if (inFile != "" && outFile != "" && autoRemux) {
 		ui->progressBar->setVisible(true);
-		emit remux(inFile, outFile);
+		batchTotal = 1;
+		batchDone = 0;
+		StartRemux(remuxers.front().get(), inFile, outFile);
 		autoRemuxFile = outFile;
 	}
 }
 
-void OBSRemux::remuxNextEntry()
+void OBSRemux::StartRemux(Remuxer *remuxer, const QString &source, const QString &target)
 {
+	RemuxWorker *worker = remuxer->worker;
+
+	remuxer->source = source;
+	remuxer->busy = true;
+	remuxer->progress = 0.0f;
 	worker->lastProgress = 0.f;
 
-	QString inputPath, outputPath;
-	if (queueModel->beginNextEntry(inputPath, outputPath)) {
-		emit remux(inputPath, outputPath);
-	} else {
+	QMetaObject::invokeMethod(
+		worker, [worker, source, target]() { worker->remux(source, target); }, Qt::QueuedConnection);
+}
+
+void OBSRemux::remuxNextEntry()
+{
+	for (auto &remuxer : remuxers) {
+		if (remuxer->busy)
+			continue;
+
+		QString inputPath, outputPath;
+		if (!queueModel->beginNextEntry(inputPath, outputPath))
+			break;
+
+		StartRemux(remuxer.get(), inputPath, outputPath);
+	}
+
+	if (!IsWorking()) {
 		queueModel->autoRemux = autoRemux;
 		queueModel->endProcessing();
 
@@ -278,16 +336,27 @@ void OBSRemux::reject()
 	QDialog::reject();
 }
 
-void OBSRemux::updateProgress(float percent)
+void OBSRemux::UpdateProgress()
 {
-	ui->progressBar->setValue(percent * 10);
+	// Progress of the whole batch, finished files count as 100%
+	float percent = batchDone * 100.0f;
+	for (auto &remuxer : remuxers) {
+		if (remuxer->busy)
+			percent += remuxer->progress;
+	}
+
+	ui->progressBar->setValue(batchTotal ? percent * 10 / batchTotal : 0);
 }
 
-void OBSRemux::remuxFinished(bool success)
+void OBSRemux::RemuxFinished(Remuxer *remuxer, bool success)
 {
 	ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
 
-	queueModel->finishEntry(success);
+	remuxer->busy = false;
+	batchDone++;
+	UpdateProgress();
+
+	queueModel->finishEntry(remuxer->source, success);
 
 	if (autoRemux && autoRemuxFile != "") {
 		QTimer::singleShot(3000, this, &OBSRemux::close);
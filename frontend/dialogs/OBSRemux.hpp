@@ -22,6 +22,9 @@
 #include <QPointer>
 #include <QThread>
 
+#include <memory>
+#include <vector>
+
 class RemuxQueueModel;
 class RemuxWorker;
 
@@ -29,8 +32,19 @@ class OBSRemux : public QDialog {
 	Q_OBJECT
 
 	QPointer<RemuxQueueModel> queueModel;
-	QThread remuxer;
-	QPointer<RemuxWorker> worker;
+
+	// One per job that may run at the same time, each with its own thread
+	struct Remuxer {
+		QThread thread;
+		QPointer<RemuxWorker> worker;
+		QString source;
+		bool busy = false;
+		float progress = 0.0f;
+	};
+	std::vector<std::unique_ptr<Remuxer>> remuxers;
+
+	int batchTotal = 0;
+	int batchDone = 0;
 
 	std::unique_ptr<Ui::OBSRemux> ui;
 
@@ -56,17 +70,17 @@ protected:
 
 	void remuxNextEntry();
 
+	bool IsWorking() const;
+	void StartRemux(Remuxer *remuxer, const QString &source, const QString &target);
+	void RemuxFinished(Remuxer *remuxer, bool success);
+	void UpdateProgress();
+
 private slots:
 	void rowCountChanged(const QModelIndex &parent, int first, int last);
 
 public slots:
-	void updateProgress(float percent);
-	void remuxFinished(bool success);
 	void beginRemux();
 	bool stopRemux();
 	void clearFinished();
 	void clearAll();
-
-signals:
-	void remux(const QString &source, const QString &target);
 };
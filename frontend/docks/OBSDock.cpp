@@ -4,6 +4,7 @@
 
 #include <QCheckBox>
 #include <QMessageBox>
+#include <QTimer>
 
 #include "moc_OBSDock.cpp"
 
@@ -23,7 +24,7 @@ void OBSDock::closeEvent(QCloseEvent *event)
 
 		if (cb->isChecked()) {
 			config_set_bool(App()->GetUserConfig(), "General", "WarnedAboutClosingDocks", true);
-			config_save_safe(App()->GetUserConfig(), "tmp", nullptr);
+			config_save_deferred(App()->GetUserConfig(), "tmp", nullptr);
 		}
 	};
 
@@ -43,4 +44,26 @@ void OBSDock::closeEvent(QCloseEvent *event)
 void OBSDock::showEvent(QShowEvent *event)
 {
 	QDockWidget::showEvent(event);
+
+	/* let the window paint before creating the contents */
+	if (deferredWidget)
+		QTimer::singleShot(0, this, &OBSDock::CreateDeferredWidget);
+}
+
+void OBSDock::SetDeferredWidget(std::function<void()> create)
+{
+	deferredWidget = std::move(create);
+
+	if (isVisible())
+		QTimer::singleShot(0, this, &OBSDock::CreateDeferredWidget);
+}
+
+void OBSDock::CreateDeferredWidget()
+{
+	if (!deferredWidget)
+		return;
+
+	std::function<void()> create = std::move(deferredWidget);
+	deferredWidget = nullptr;
+	create();
 }
@@ -2,6 +2,8 @@
 
 #include <QDockWidget>
 
+#include <functional>
+
 class QCloseEvent;
 class QShowEvent;
 class QString;
@@ -15,4 +17,13 @@ public:
 
 	virtual void closeEvent(QCloseEvent *event);
 	virtual void showEvent(QShowEvent *event);
+
+	/* Creates the dock's contents the first time it's shown instead of
+	 * right away, for docks that are usually hidden */
+	void SetDeferredWidget(std::function<void()> create);
+
+private:
+	std::function<void()> deferredWidget;
+
+	void CreateDeferredWidget();
 };
@@ -74,6 +74,11 @@ bool opt_allow_opengl = false;
 bool opt_always_on_top = false;
 bool opt_disable_updater = false;
 bool opt_disable_missing_files_check = false;
+bool opt_gpu_profiler = false;
+/* the trace is cheap enough to keep a short one on for diagnostics snapshots,
+ * it's only saved on exit when asked for */
+uint32_t opt_trace_history = 10;
+bool opt_save_trace = false;
 string opt_starting_collection;
 string opt_starting_profile;
 string opt_starting_scene;
@@ -452,30 +457,54 @@ ProfilerSnapshot GetSnapshot()
 	return ProfilerSnapshot{profile_snapshot_create(), SnapshotRelease};
 }
 
-static void SaveProfilerData(const ProfilerSnapshot &snap)
+static BPtr<char> GetProfilerDataPath(const char *extension)
 {
 	if (currentLogFile.empty())
-		return;
+		return nullptr;
 
 	auto pos = currentLogFile.rfind('.');
 	if (pos == currentLogFile.npos)
-		return;
+		return nullptr;
 
 #define LITERAL_SIZE(x) x, (sizeof(x) - 1)
 	ostringstream dst;
 	dst.write(LITERAL_SIZE("obs-studio/profiler_data/"));
 	dst.write(currentLogFile.c_str(), pos);
-	dst.write(LITERAL_SIZE(".csv.gz"));
+	dst << extension;
 #undef LITERAL_SIZE
 
-	BPtr<char> path = GetAppConfigPathPtr(dst.str().c_str());
+	return GetAppConfigPathPtr(dst.str().c_str());
+}
+
+static void SaveProfilerData(const ProfilerSnapshot &snap)
+{
+	BPtr<char> path = GetProfilerDataPath(".csv.gz");
+	if (!path)
+		return;
+
 	if (!profiler_snapshot_dump_csv_gz(snap.get(), path))
 		blog(LOG_WARNING, "Could not save profiler data to '%s'", static_cast<const char *>(path));
 }
 
+static void SaveProfilerTrace()
+{
+	BPtr<char> path = GetProfilerDataPath(".trace.json");
+	if (!path)
+		return;
+
+	if (!profiler_trace_dump_json(path))
+		blog(LOG_WARNING, "Could not save profiler trace to '%s'", static_cast<const char *>(path));
+}
+
 static auto ProfilerFree = [](void *) {
 	profiler_stop();
 
+	if (opt_trace_history) {
+		profiler_trace_stop();
+		if (opt_save_trace)
+			SaveProfilerTrace();
+	}
+
 	auto snap = GetSnapshot();
 
 	profiler_print(snap.get());
@@ -504,6 +533,8 @@ static int run_program(fstream &logFile, int argc, char *argv[])
 	std::unique_ptr<void, decltype(ProfilerFree)> prof_release(static_cast<void *>(&ProfilerFree), ProfilerFree);
 
 	profiler_start();
+	if (opt_trace_history)
+		profiler_trace_start(opt_trace_history);
 	profile_register_root(run_program_init, 0);
 
 	ScopeProfiler prof{run_program_init};
@@ -1030,6 +1061,15 @@ int main(int argc, char *argv[])
 		} else if (arg_is(argv[i], "--disable-missing-files-check", nullptr)) {
 			opt_disable_missing_files_check = true;
 
+		} else if (arg_is(argv[i], "--gpu-profiler", nullptr)) {
+			opt_gpu_profiler = true;
+
+		} else if (arg_is(argv[i], "--trace-history", nullptr)) {
+			if (++i < argc) {
+				opt_trace_history = (uint32_t)strtoul(argv[i], nullptr, 10);
+				opt_save_trace = opt_trace_history != 0;
+			}
+
 		} else if (arg_is(argv[i], "--steam", nullptr)) {
 			steam = true;
 
@@ -1057,7 +1097,10 @@ int main(int argc, char *argv[])
 				"--always-on-top: Start in 'always on top' mode.\n\n"
 				"--unfiltered_log: Make log unfiltered.\n\n"
 				"--disable-updater: Disable built-in updater (Windows/Mac only)\n\n"
-				"--disable-missing-files-check: Disable the missing files dialog which can appear on startup.\n\n";
+				"--disable-missing-files-check: Disable the missing files dialog which can appear on startup.\n\n"
+				"--gpu-profiler: Record GPU times of render passes in the profiler.\n"
+				"--trace-history <seconds>: Keep a trace of the last <seconds> of profiled spans "
+				"(10 by default, 0 disables it) and save it next to the profiler data on exit.\n\n";
 
 #ifdef _WIN32
 			MessageBoxA(NULL, help.c_str(), "Help", MB_OK | MB_ICONASTERISK);
@@ -359,6 +359,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->previewSafeAreas,     CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->automaticSearch,      CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->previewSpacingHelpers,CHECK_CHANGED,  GENERAL_CHANGED);
+	HookWidget(ui->previewFPS,           SCROLL_CHANGED, GENERAL_CHANGED);
 	HookWidget(ui->doubleClickSwitch,    CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->studioPortraitLayout, CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->prevProgLabelToggle,  CHECK_CHANGED,  GENERAL_CHANGED);
@@ -366,6 +367,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->multiviewDrawNames,   CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->multiviewDrawAreas,   CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->multiviewLayout,      COMBO_CHANGED,  GENERAL_CHANGED);
+	HookWidget(ui->multiviewThumbnailFPS, SCROLL_CHANGED, GENERAL_CHANGED);
 	HookWidget(ui->theme, 		     COMBO_CHANGED,  APPEAR_CHANGED);
 	HookWidget(ui->themeVariant,	     COMBO_CHANGED,  APPEAR_CHANGED);
 	HookWidget(ui->service,              COMBO_CHANGED,  STREAM1_CHANGED);
@@ -1296,6 +1298,8 @@ void OBSBasicSettings::LoadGeneralSettings()
 	bool spacingHelpersEnabled = config_get_bool(App()->GetUserConfig(), "BasicWindow", "SpacingHelpersEnabled");
 	ui->previewSpacingHelpers->setChecked(spacingHelpersEnabled);
 
+	ui->previewFPS->setValue((int)config_get_int(App()->GetUserConfig(), "BasicWindow", "PreviewFPS"));
+
 	bool warnBeforeStreamStop = config_get_bool(App()->GetUserConfig(), "BasicWindow", "WarnBeforeStoppingStream");
 	ui->warnBeforeStreamStop->setChecked(warnBeforeStreamStop);
 
@@ -1365,6 +1369,9 @@ void OBSBasicSettings::LoadGeneralSettings()
 	ui->multiviewLayout->setCurrentIndex(ui->multiviewLayout->findData(
 		QVariant::fromValue(config_get_int(App()->GetUserConfig(), "BasicWindow", "MultiviewLayout"))));
 
+	ui->multiviewThumbnailFPS->setValue(
+		(int)config_get_int(App()->GetUserConfig(), "BasicWindow", "MultiviewThumbnailFPS"));
+
 	prevLangIndex = ui->language->currentIndex();
 
 	if (obs_video_active())
@@ -2978,6 +2985,11 @@ void OBSBasicSettings::SaveGeneralSettings()
 		main->UpdatePreviewSpacingHelpers();
 	}
 
+	if (WidgetChanged(ui->previewFPS)) {
+		config_set_int(App()->GetUserConfig(), "BasicWindow", "PreviewFPS", ui->previewFPS->value());
+		main->UpdatePreviewFrameRate();
+	}
+
 	if (WidgetChanged(ui->doubleClickSwitch))
 		config_set_bool(App()->GetUserConfig(), "BasicWindow", "TransitionOnDoubleClick",
 				ui->doubleClickSwitch->isChecked());
@@ -3084,6 +3096,12 @@ void OBSBasicSettings::SaveGeneralSettings()
 		multiviewChanged = true;
 	}
 
+	if (WidgetChanged(ui->multiviewThumbnailFPS)) {
+		config_set_int(App()->GetUserConfig(), "BasicWindow", "MultiviewThumbnailFPS",
+			       ui->multiviewThumbnailFPS->value());
+		multiviewChanged = true;
+	}
+
 	if (multiviewChanged)
 		OBSProjector::UpdateMultiviewProjectors();
 }
@@ -3616,8 +3634,8 @@ void OBSBasicSettings::SaveSettings()
 	if (videoChanged || advancedChanged)
 		main->ResetVideo();
 
-	config_save_safe(main->Config(), "tmp", nullptr);
-	config_save_safe(App()->GetUserConfig(), "tmp", nullptr);
+	config_save_deferred(main->Config(), "tmp", nullptr);
+	config_save_deferred(App()->GetUserConfig(), "tmp", nullptr);
 	main->SaveProject();
 
 	if (Changed()) {
@@ -4196,7 +4214,7 @@ void OBSBasicSettings::HideOBSWindowWarning(int state)
 				   QTStr("Basic.Settings.General.HideOBSWindowsFromCapture.Message"));
 
 	config_set_bool(App()->GetUserConfig(), "General", "WarnedAboutHideOBSFromCapture", true);
-	config_save_safe(App()->GetUserConfig(), "tmp", nullptr);
+	config_save_deferred(App()->GetUserConfig(), "tmp", nullptr);
 }
 
 /*
@@ -4,6 +4,7 @@
 #include <docks/YouTubeAppDock.hpp>
 #endif
 #include <oauth/OAuth.hpp>
+#include <utility/EncoderProbe.hpp>
 #ifdef YOUTUBE_ENABLED
 #include <utility/YoutubeApiWrappers.hpp>
 #endif
@@ -338,6 +339,8 @@ void OBSBasicSettings::SaveStream1Settings()
 
 	if (oldMultitrackVideoSetting != ui->enableMultitrackVideo->isChecked())
 		main->ResetOutputs();
+	if (config_get_bool(main->Config(), "Stream1", "EnableMultitrackVideo"))
+		StartEncoderProbe();
 
 	SwapMultiTrack(QT_TO_UTF8(protocol));
 }
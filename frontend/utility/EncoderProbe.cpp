@@ -0,0 +1,484 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "EncoderProbe.hpp"
+
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#define PROBE_OUTPUT_ID "encoder_probe_output"
+
+/* enough frames to get past the encoders' startup, few enough that the
+ * whole probe takes seconds */
+#define PROBE_FRAMES 90
+#define PROBE_BITRATE 6000
+
+/* distinct frames cycled through, so encoders can't just skip */
+#define BANK_FRAMES 4
+#define BLOCK_SIZE 16
+
+#define VIDEO_CACHE_SIZE 16
+#define MAX_QUEUED_FRAMES 8
+
+#define STALL_TIMEOUT_NS 2000000000ULL
+#define DRAIN_TIMEOUT_NS 500000000ULL
+#define STOP_TIMEOUT_NS 5000000000ULL
+
+/* share of the measured rate a ladder may use, the rest covers the load of
+ * the scene and the encoders varying while live */
+#define LADDER_HEADROOM 0.8
+
+using namespace std;
+
+namespace {
+struct ProbeRun {
+	atomic<long> packets = 0;
+	uint64_t first_packet_ns = 0;
+	uint64_t last_packet_ns = 0;
+};
+
+struct FrameBank {
+	uint32_t width;
+	uint32_t height;
+	vector<uint8_t> luma[BANK_FRAMES];
+	vector<uint8_t> chroma[BANK_FRAMES];
+};
+} // namespace
+
+/* only one run is active at a time */
+static atomic<ProbeRun *> cur_run = nullptr;
+static atomic_bool cancel_probe = false;
+static atomic_bool probe_running = false;
+static std::thread probe_thread;
+
+static mutex results_mutex;
+static vector<GoLiveApi::EncoderBenchmark> results;
+
+/* ------------------------------------------------------------------------- */
+/* probe output: encoded output that only records packet timing */
+
+static const char *probe_output_name(void *)
+{
+	return "Encoder Probe Output";
+}
+
+static void *probe_output_create(obs_data_t *, obs_output_t *output)
+{
+	return output;
+}
+
+static void probe_output_destroy(void *) {}
+
+static bool probe_output_start(void *data)
+{
+	obs_output_t *output = static_cast<obs_output_t *>(data);
+
+	if (!obs_output_can_begin_data_capture(output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void probe_output_stop(void *data, uint64_t)
+{
+	obs_output_end_data_capture(static_cast<obs_output_t *>(data));
+}
+
+static void probe_output_packet(void *, encoder_packet *packet)
+{
+	ProbeRun *run = cur_run;
+
+	if (!packet || !run || packet->type != OBS_ENCODER_VIDEO)
+		return;
+
+	const uint64_t now = os_gettime_ns();
+	if (!run->first_packet_ns)
+		run->first_packet_ns = now;
+	run->last_packet_ns = now;
+	run->packets++;
+}
+
+static void RegisterProbeOutput()
+{
+	static bool registered = false;
+	if (registered)
+		return;
+
+	obs_output_info info = {};
+	info.id = PROBE_OUTPUT_ID;
+	info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED;
+	info.get_name = probe_output_name;
+	info.create = probe_output_create;
+	info.destroy = probe_output_destroy;
+	info.start = probe_output_start;
+	info.stop = probe_output_stop;
+	info.encoded_packet = probe_output_packet;
+	obs_register_output(&info);
+
+	registered = true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* synthetic frames: a scrolling gradient under a field of random blocks,
+ * an eighth of which change every frame */
+
+static void InitFrameBank(FrameBank &bank, uint32_t width, uint32_t height)
+{
+	const uint32_t blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const uint32_t blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	vector<uint8_t> field(blocks_x * blocks_y);
+	minstd_rand rng(1);
+
+	bank.width = width;
+	bank.height = height;
+
+	for (auto &block : field)
+		block = (uint8_t)(rng() % 256);
+
+	for (int f = 0; f < BANK_FRAMES; f++) {
+		auto &luma = bank.luma[f];
+		auto &chroma = bank.chroma[f];
+
+		luma.resize(width * height);
+		chroma.resize(width * (height / 2));
+
+		for (auto &block : field) {
+			if (rng() % 8 == 0)
+				block = (uint8_t)(rng() % 256);
+		}
+
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				uint8_t block = field[(y / BLOCK_SIZE) * blocks_x + x / BLOCK_SIZE];
+				luma[y * width + x] = (uint8_t)(block / 2 + ((x + y + f * 8) & 127));
+			}
+		}
+
+		for (uint32_t y = 0; y < height / 2; y++) {
+			for (uint32_t x = 0; x < width / 2; x++) {
+				uint8_t block = field[(y * 2 / BLOCK_SIZE) * blocks_x + x * 2 / BLOCK_SIZE];
+				chroma[y * width + x * 2] = (uint8_t)(96 + block / 4);
+				chroma[y * width + x * 2 + 1] = (uint8_t)(160 - block / 4);
+			}
+		}
+	}
+}
+
+static void ReleaseFrame(void *) {}
+
+/* ------------------------------------------------------------------------- */
+
+static bool OtherOutputActive()
+{
+	bool active = false;
+
+	auto check = [](void *param, obs_output_t *output) {
+		if (!obs_output_active(output) || strcmp(obs_output_get_id(output), PROBE_OUTPUT_ID) == 0)
+			return true;
+
+		*static_cast<bool *>(param) = true;
+		return false;
+	};
+	obs_enum_outputs(check, &active);
+
+	return active;
+}
+
+/* waits until the encoder has taken all but MAX_QUEUED_FRAMES - 1 of the
+ * pushed frames, false if it stops making progress */
+static bool WaitForEncoder(obs_encoder_t *encoder, uint32_t pushed)
+{
+	obs_encoder_stats stats;
+	uint64_t last_submitted = 0;
+	uint64_t last_progress = os_gettime_ns();
+
+	for (;;) {
+		obs_encoder_get_stats(encoder, &stats);
+		if (pushed - stats.frames_submitted < MAX_QUEUED_FRAMES)
+			return true;
+
+		const uint64_t now = os_gettime_ns();
+		if (stats.frames_submitted != last_submitted) {
+			last_submitted = stats.frames_submitted;
+			last_progress = now;
+		} else if (now - last_progress > STALL_TIMEOUT_NS || cancel_probe) {
+			return false;
+		}
+
+		os_sleep_ms(1);
+	}
+}
+
+/* delayed packets may never come without a flush, so this only waits until
+ * they stop coming */
+static void WaitForPackets(ProbeRun &run)
+{
+	long last_packets = run.packets;
+	uint64_t last_progress = os_gettime_ns();
+
+	while (last_packets < PROBE_FRAMES && !cancel_probe) {
+		const uint64_t now = os_gettime_ns();
+		long packets = run.packets;
+
+		if (packets != last_packets) {
+			last_packets = packets;
+			last_progress = now;
+		} else if (now - last_progress > DRAIN_TIMEOUT_NS) {
+			break;
+		}
+
+		os_sleep_ms(1);
+	}
+}
+
+static void StopOutput(obs_output_t *output)
+{
+	const uint64_t start = os_gettime_ns();
+
+	obs_output_stop(output);
+	while (obs_output_active(output)) {
+		if (os_gettime_ns() - start > STOP_TIMEOUT_NS) {
+			obs_output_force_stop(output);
+			break;
+		}
+		os_sleep_ms(1);
+	}
+}
+
+static bool PushFrames(video_t *video, obs_encoder_t *encoder, const FrameBank &bank, uint32_t fps_num,
+		       uint32_t fps_den)
+{
+	const uint64_t interval = util_mul_div64(1000000000ULL, fps_den, fps_num);
+	const uint64_t start = os_gettime_ns();
+
+	for (uint32_t i = 0; i < PROBE_FRAMES; i++) {
+		if (cancel_probe || !WaitForEncoder(encoder, i))
+			return false;
+
+		video_data frame = {};
+		frame.data[0] = const_cast<uint8_t *>(bank.luma[i % BANK_FRAMES].data());
+		frame.data[1] = const_cast<uint8_t *>(bank.chroma[i % BANK_FRAMES].data());
+		frame.linesize[0] = bank.width;
+		frame.linesize[1] = bank.width;
+		frame.timestamp = start + interval * i;
+
+		video_output_push_frame_ref(video, &frame, 1, ReleaseFrame, nullptr);
+	}
+
+	return true;
+}
+
+static optional<double> ProbeEncoder(const char *id, const FrameBank &bank, uint32_t fps_num, uint32_t fps_den)
+{
+	video_output_info voi = {};
+	voi.name = "encoder probe";
+	voi.format = VIDEO_FORMAT_NV12;
+	voi.fps_num = fps_num;
+	voi.fps_den = fps_den;
+	voi.width = bank.width;
+	voi.height = bank.height;
+	voi.cache_size = VIDEO_CACHE_SIZE;
+	voi.colorspace = VIDEO_CS_709;
+	voi.range = VIDEO_RANGE_PARTIAL;
+
+	video_t *video = nullptr;
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS)
+		return nullopt;
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "bitrate", PROBE_BITRATE);
+	obs_data_set_int(settings, "keyint_sec", 2);
+
+	obs_encoder_t *encoder = obs_video_encoder_create(id, "encoder probe", settings, nullptr);
+	obs_output_t *output = nullptr;
+	optional<double> fps;
+	ProbeRun run;
+
+	obs_data_release(settings);
+
+	if (encoder) {
+		obs_encoder_set_video(encoder, video);
+
+		output = obs_output_create(PROBE_OUTPUT_ID, "encoder probe", nullptr, nullptr);
+		obs_output_set_video_encoder(output, encoder);
+
+		cur_run = &run;
+
+		if (obs_output_start(output)) {
+			bool finished = PushFrames(video, encoder, bank, fps_num, fps_den);
+			if (finished)
+				WaitForPackets(run);
+
+			StopOutput(output);
+
+			const long packets = run.packets;
+			if (finished && packets >= 2 && run.last_packet_ns > run.first_packet_ns) {
+				const double duration = (double)(run.last_packet_ns - run.first_packet_ns) / 1e9;
+				fps = (double)(packets - 1) / duration;
+			}
+		}
+
+		cur_run = nullptr;
+	}
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	video_output_close(video);
+	return fps;
+}
+
+static bool ProbedCodec(const char *codec)
+{
+	return codec && (strcmp(codec, "h264") == 0 || strcmp(codec, "hevc") == 0 || strcmp(codec, "av1") == 0);
+}
+
+static void RunProbe(const vector<pair<uint32_t, uint32_t>> &resolutions, uint32_t fps_num, uint32_t fps_den)
+{
+	vector<GoLiveApi::EncoderBenchmark> probed;
+	const uint64_t start = os_gettime_ns();
+
+	for (auto &res : resolutions) {
+		FrameBank bank;
+		InitFrameBank(bank, res.first, res.second);
+
+		const char *id;
+		for (size_t i = 0; obs_enum_encoder_types(i, &id); i++) {
+			if (cancel_probe)
+				return;
+
+			if (obs_get_encoder_type(id) != OBS_ENCODER_VIDEO)
+				continue;
+			if ((obs_get_encoder_caps(id) & OBS_ENCODER_CAP_DEPRECATED) != 0)
+				continue;
+
+			const char *codec = obs_get_encoder_codec(id);
+			if (!ProbedCodec(codec))
+				continue;
+
+			/* a second session would make both measurements wrong,
+			 * and the live one matters more */
+			if (OtherOutputActive()) {
+				blog(LOG_INFO, "Encoder probe: stopped, an output is active");
+				return;
+			}
+
+			auto fps = ProbeEncoder(id, bank, fps_num, fps_den);
+			if (!fps)
+				continue;
+
+			probed.push_back({id, codec, bank.width, bank.height, *fps});
+		}
+	}
+
+	if (cancel_probe)
+		return;
+
+	blog(LOG_INFO, "Encoder probe: finished in %.1f s", (double)(os_gettime_ns() - start) / 1e9);
+	for (auto &result : probed)
+		blog(LOG_INFO, "    %s %ux%u: %.1f fps", result.encoder.c_str(), result.width, result.height,
+		     result.encode_fps);
+
+	const lock_guard lock(results_mutex);
+	results = std::move(probed);
+}
+
+void StartEncoderProbe()
+{
+	/* a probe that gave up because an output was active runs again */
+	if (probe_thread.joinable()) {
+		if (probe_running || !GetEncoderProbeResults().empty())
+			return;
+		probe_thread.join();
+	}
+
+	obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) || !ovi.fps_num || !ovi.fps_den)
+		return;
+
+	/* the output resolution is what the top track usually gets, 720p is
+	 * the usual second rung */
+	vector<pair<uint32_t, uint32_t>> resolutions;
+	resolutions.emplace_back(ovi.output_width & ~1u, ovi.output_height & ~1u);
+	if ((uint64_t)ovi.output_width * ovi.output_height > 1280 * 720)
+		resolutions.emplace_back(1280, 720);
+
+	/* output types can only be registered on the UI thread */
+	RegisterProbeOutput();
+
+	cancel_probe = false;
+	probe_running = true;
+	const uint32_t fps_num = ovi.fps_num;
+	const uint32_t fps_den = ovi.fps_den;
+
+	probe_thread = std::thread([resolutions = std::move(resolutions), fps_num, fps_den]() {
+		os_set_thread_name("encoder probe");
+		RunProbe(resolutions, fps_num, fps_den);
+		probe_running = false;
+	});
+}
+
+void StopEncoderProbe()
+{
+	if (!probe_thread.joinable())
+		return;
+
+	cancel_probe = true;
+	probe_thread.join();
+}
+
+vector<GoLiveApi::EncoderBenchmark> GetEncoderProbeResults()
+{
+	const lock_guard lock(results_mutex);
+	return results;
+}
+
+optional<uint32_t> EncoderProbeMaximumVideoTracks(uint32_t width, uint32_t height, double fps)
+{
+	double best_fps = 0.0;
+
+	{
+		const lock_guard lock(results_mutex);
+		for (auto &result : results) {
+			if (result.width == (width & ~1u) && result.height == (height & ~1u))
+				best_fps = max(best_fps, result.encode_fps);
+		}
+	}
+
+	if (best_fps <= 0.0 || fps <= 0.0)
+		return nullopt;
+
+	/* assumes every rung of the ladder has about half the pixel rate of
+	 * the one above it, so n tracks cost 2 - 2^(1 - n) top tracks */
+	const double budget = best_fps * LADDER_HEADROOM / fps;
+	if (budget >= 2.0)
+		return nullopt;
+	if (budget < 1.0)
+		return 1;
+
+	return (uint32_t)floor(1.0 - log2(2.0 - budget));
+}
@@ -0,0 +1,37 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "models/multitrack-video.hpp"
+
+#include <optional>
+#include <vector>
+
+/* Measures how many frames per second the video encoders sustain on this
+ * machine, the same way test/encoder-bench does, so the Go Live request can
+ * ask for a ladder the machine keeps up with.  The probe runs once per
+ * session on a background thread and gives up while any other output is
+ * active.  Results are empty until it has finished. */
+void StartEncoderProbe();
+void StopEncoderProbe();
+std::vector<GoLiveApi::EncoderBenchmark> GetEncoderProbeResults();
+
+/* The largest number of video tracks the fastest probed encoder sustains
+ * next to each other at this resolution and frame rate, nullopt if there
+ * are no results or the probe doesn't limit the ladder. */
+std::optional<uint32_t> EncoderProbeMaximumVideoTracks(uint32_t width, uint32_t height, double fps);
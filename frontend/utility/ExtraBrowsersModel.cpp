@@ -145,7 +145,10 @@ void ExtraBrowsersModel::UpdateItem(Item &item)
 	}
 
 	if (main->extraBrowserDockTargets[idx] != item.url) {
-		dock->cefWidget->setURL(QT_TO_UTF8(item.url));
+		/* a dock that hasn't been shown yet picks up the new URL
+		 * once it creates its browser */
+		if (dock->cefWidget)
+			dock->cefWidget->setURL(QT_TO_UTF8(item.url));
 		main->extraBrowserDockTargets[idx] = item.url;
 	}
 }
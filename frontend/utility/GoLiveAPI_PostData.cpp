@@ -1,4 +1,5 @@
 #include "GoLiveAPI_PostData.hpp"
+#include "EncoderProbe.hpp"
 #include "models/multitrack-video.hpp"
 
 #include <utility/system-info.hpp>
@@ -15,6 +16,10 @@ GoLiveApi::PostData constructGoLivePost(QString streamKey, const std::optional<u
 
 	system_info(post_data.capabilities);
 
+	auto encoder_benchmarks = GetEncoderProbeResults();
+	if (!encoder_benchmarks.empty())
+		post_data.capabilities.encoder_benchmarks = std::move(encoder_benchmarks);
+
 	auto &client = post_data.client;
 
 	client.name = "obs-studio";
@@ -71,8 +76,18 @@ GoLiveApi::PostData constructGoLivePost(QString streamKey, const std::optional<u
 
 	if (maximum_aggregate_bitrate.has_value())
 		preferences.maximum_aggregate_bitrate = maximum_aggregate_bitrate.value();
-	if (maximum_video_tracks.has_value())
+	if (maximum_video_tracks.has_value()) {
 		preferences.maximum_video_tracks = maximum_video_tracks.value();
+	} else if (preferences.framerate.denominator) {
+		/* "Auto" still shouldn't ask for more tracks than the local
+		 * encoders were measured to keep up with */
+		preferences.maximum_video_tracks = EncoderProbeMaximumVideoTracks(
+			preferences.width, preferences.height,
+			(double)preferences.framerate.numerator / (double)preferences.framerate.denominator);
+		if (preferences.maximum_video_tracks.has_value())
+			blog(LOG_INFO, "Limiting video tracks to %" PRIu32 " from the encoder probe",
+			     *preferences.maximum_video_tracks);
+	}
 
 	return post_data;
 }
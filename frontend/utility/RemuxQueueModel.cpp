@@ -338,6 +338,17 @@ void RemuxQueueModel::endProcessing()
 	emit dataChanged(index(0, RemuxEntryColumn::State), index(queue.length(), RemuxEntryColumn::State));
 }
 
+int RemuxQueueModel::countEntries(RemuxEntryState state) const
+{
+	int count = 0;
+
+	for (const RemuxQueueEntry &entry : queue)
+		if (entry.state == state)
+			count++;
+
+	return count;
+}
+
 bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
 {
 	bool anyStarted = false;
@@ -361,11 +372,11 @@ bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
 	return anyStarted;
 }
 
-void RemuxQueueModel::finishEntry(bool success)
+void RemuxQueueModel::finishEntry(const QString &inputPath, bool success)
 {
 	for (int row = 0; row < queue.length(); row++) {
 		RemuxQueueEntry &entry = queue[row];
-		if (entry.state == RemuxEntryState::InProgress) {
+		if (entry.state == RemuxEntryState::InProgress && entry.sourcePath == inputPath) {
 			if (success)
 				entry.state = RemuxEntryState::Complete;
 			else
@@ -53,8 +53,9 @@ public:
 	bool checkForErrors() const;
 	void beginProcessing();
 	void endProcessing();
+	int countEntries(RemuxEntryState state) const;
 	bool beginNextEntry(QString &inputPath, QString &outputPath);
-	void finishEntry(bool success);
+	void finishEntry(const QString &inputPath, bool success);
 	bool canClearFinished() const;
 	void clearFinished();
 	void clearAll();
@@ -18,6 +18,7 @@
 #include "RemuxWorker.hpp"
 
 #include <media-io/media-remux.h>
+#include <util/platform.h>
 #include <qt-wrappers.hpp>
 
 void RemuxWorker::UpdateProgress(float percent)
@@ -29,6 +30,15 @@ void RemuxWorker::UpdateProgress(float percent)
 	lastProgress = percent;
 }
 
+void RemuxWorker::Throttle()
+{
+	if (!maxBytesPerSec)
+		return;
+
+	while (isWorking && media_remux_job_get_bytes_per_sec(job) > maxBytesPerSec)
+		os_sleep_ms(10);
+}
+
 void RemuxWorker::remux(const QString &source, const QString &target)
 {
 	isWorking = true;
@@ -36,6 +46,8 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 	auto callback = [](void *data, float percent) {
 		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
 
+		rw->Throttle();
+
 		QMutexLocker lock(&rw->updateMutex);
 
 		rw->UpdateProgress(percent);
@@ -48,9 +60,12 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 
 	media_remux_job_t mr_job = nullptr;
 	if (media_remux_job_create(&mr_job, QT_TO_UTF8(source), QT_TO_UTF8(target))) {
+		job = mr_job;
+		media_remux_job_set_faststart(mr_job, faststart);
 
 		success = media_remux_job_process(mr_job, callback, this);
 
+		job = nullptr;
 		media_remux_job_destroy(mr_job);
 
 		stopped = !isWorking;
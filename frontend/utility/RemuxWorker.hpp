@@ -20,6 +20,10 @@
 #include <QMutex>
 #include <QObject>
 
+#include <cstdint>
+
+struct media_remux_job;
+
 class RemuxWorker : public QObject {
 	Q_OBJECT
 
@@ -30,6 +34,13 @@ class RemuxWorker : public QObject {
 	float lastProgress;
 	void UpdateProgress(float percent);
 
+	// Set before the worker is started
+	bool faststart = false;
+	uint64_t maxBytesPerSec = 0;
+
+	struct media_remux_job *job = nullptr;
+	void Throttle();
+
 	explicit RemuxWorker() : isWorking(false) {}
 	virtual ~RemuxWorker(){};
 
@@ -0,0 +1,92 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "SaveWorker.hpp"
+
+#include <util/threading.h>
+
+SaveWorker::SaveWorker()
+{
+	thread = std::thread([this]() { Thread(); });
+}
+
+SaveWorker::~SaveWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_one();
+	thread.join();
+}
+
+void SaveWorker::Queue(obs_data_t *data, const std::string &file)
+{
+	/* sources hand out their live settings objects, so copy everything
+	 * that will be written while still on the calling thread */
+	OBSDataAutoRelease snapshot = obs_data_create();
+	obs_data_apply(snapshot, data);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		bool replaced = false;
+		for (PendingSave &save : queue) {
+			if (save.file == file) {
+				save.data = snapshot.Get();
+				replaced = true;
+			}
+		}
+
+		if (!replaced)
+			queue.push_back({snapshot.Get(), file});
+	}
+	cv.notify_one();
+}
+
+void SaveWorker::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return queue.empty() && !busy; });
+}
+
+void SaveWorker::Thread()
+{
+	os_set_thread_name("scene collection save");
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+		if (queue.empty())
+			break;
+
+		PendingSave save = std::move(queue.front());
+		queue.pop_front();
+		busy = true;
+
+		lock.unlock();
+		if (!obs_data_save_json_pretty_safe(save.data, save.file.c_str(), "tmp", "bak"))
+			blog(LOG_ERROR, "Could not save scene data to %s", save.file.c_str());
+		save.data = nullptr;
+		lock.lock();
+
+		busy = false;
+		if (queue.empty())
+			idle.notify_all();
+	}
+}
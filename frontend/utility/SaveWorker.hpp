@@ -0,0 +1,53 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Writes json files on a background thread.  Queue takes a snapshot of the
+ * data, so the caller is free to keep modifying it.  A save that's still
+ * waiting is replaced by a newer save of the same file. */
+class SaveWorker {
+	struct PendingSave {
+		OBSData data;
+		std::string file;
+	};
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::condition_variable idle;
+	std::deque<PendingSave> queue;
+	bool busy = false;
+	bool stopping = false;
+
+	void Thread();
+
+public:
+	SaveWorker();
+	~SaveWorker();
+
+	void Queue(obs_data_t *data, const std::string &file);
+	void Wait();
+};
@@ -39,10 +39,13 @@ ScreenshotObj::ScreenshotObj(obs_source_t *source) : weakSource(OBSGetWeakRef(so
 
 ScreenshotObj::~ScreenshotObj()
 {
-	obs_enter_graphics();
-	gs_stagesurface_destroy(stagesurf);
-	gs_texrender_destroy(texrender);
-	obs_leave_graphics();
+	/* normally freed by Copy on the graphics thread already */
+	if (texrender || stagesurf) {
+		obs_enter_graphics();
+		gs_stagesurface_destroy(stagesurf);
+		gs_texrender_destroy(texrender);
+		obs_leave_graphics();
+	}
 
 	obs_remove_tick_callback(ScreenshotTick, this);
 
@@ -118,11 +121,17 @@ void ScreenshotObj::Screenshot()
 		gs_blend_state_pop();
 		gs_texrender_end(texrender);
 	}
+
+	Download();
 }
 
 void ScreenshotObj::Download()
 {
 	gs_stage_texture(stagesurf, gs_texrender_get_texture(texrender));
+
+	/* give the GPU as long to finish the copy as raw video readback does,
+	 * mapping any sooner would stall the graphics thread until it's done */
+	waitFrames = obs_get_video_readback_depth();
 }
 
 void ScreenshotObj::Copy()
@@ -143,12 +152,21 @@ void ScreenshotObj::Copy()
 			image = QImage(cx, cy, QImage::Format::Format_RGBX8888);
 
 			int linesize = image.bytesPerLine();
-			for (int y = 0; y < (int)cy; y++)
-				memcpy(image.scanLine(y), videoData + (y * videoLinesize), linesize);
+			if ((uint32_t)linesize == videoLinesize) {
+				memcpy(image.bits(), videoData, (size_t)linesize * cy);
+			} else {
+				for (int y = 0; y < (int)cy; y++)
+					memcpy(image.scanLine(y), videoData + (y * videoLinesize), linesize);
+			}
 		}
 
 		gs_stagesurface_unmap(stagesurf);
 	}
+
+	gs_stagesurface_destroy(stagesurf);
+	gs_texrender_destroy(texrender);
+	stagesurf = nullptr;
+	texrender = nullptr;
 }
 
 void ScreenshotObj::Save()
@@ -171,6 +189,14 @@ void ScreenshotObj::Save()
 	path = GetOutputFilename(rec_path, ext, noSpace, overwriteIfExists,
 				 GetFormatString(filenameFormat, "Screenshot", nullptr).c_str());
 
+	/* other screenshots can finish within the same second, so claim the
+	 * name now instead of when the encoding thread gets to write it */
+	if (!overwriteIfExists && !path.empty()) {
+		FILE *file = os_fopen(path.c_str(), "wb");
+		if (file)
+			fclose(file);
+	}
+
 	th = std::thread([this] { MuxAndFinish(); });
 }
 
@@ -280,7 +306,7 @@ void ScreenshotObj::MuxAndFinish()
 }
 
 #define STAGE_SCREENSHOT 0
-#define STAGE_DOWNLOAD 1
+#define STAGE_WAIT 1
 #define STAGE_COPY_AND_SAVE 2
 #define STAGE_FINISH 3
 
@@ -292,15 +318,19 @@ static void ScreenshotTick(void *param, float)
 		return;
 	}
 
+	if (data->stage == STAGE_WAIT) {
+		if (--data->waitFrames > 0)
+			return;
+
+		data->stage = STAGE_COPY_AND_SAVE;
+	}
+
 	obs_enter_graphics();
 
 	switch (data->stage) {
 	case STAGE_SCREENSHOT:
 		data->Screenshot();
 		break;
-	case STAGE_DOWNLOAD:
-		data->Download();
-		break;
 	case STAGE_COPY_AND_SAVE:
 		data->Copy();
 		QMetaObject::invokeMethod(data, "Save");
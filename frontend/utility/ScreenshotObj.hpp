@@ -46,6 +46,7 @@ public:
 	std::thread th;
 
 	int stage = 0;
+	uint32_t waitFrames = 0;
 
 public slots:
 	void Save();
@@ -17,7 +17,20 @@ void VolumeMeterTimer::RemoveVolControl(VolumeMeter *meter)
 void VolumeMeterTimer::timerEvent(QTimerEvent *)
 {
 	for (VolumeMeter *meter : volumeMeters) {
-		if (meter->needLayoutChange()) {
+		// Meters in hidden docks or collapsed mixers do no work at all
+		if (!meter->isVisible()) {
+			meter->pause();
+			continue;
+		}
+
+		bool resumed = meter->resume();
+		bool polled = meter->pollLevels();
+
+		// An idle meter has already painted its empty bars
+		if (!polled && !resumed && meter->isIdle() && !meter->needLayoutChange())
+			continue;
+
+		if (resumed || meter->needLayoutChange()) {
 			// Tell paintEvent to update layout and paint everything
 			meter->update();
 		} else {
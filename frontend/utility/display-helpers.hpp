@@ -19,11 +19,14 @@
 
 #include <graphics/matrix4.h>
 #include <graphics/vec4.h>
+#include <util/util_uint64.h>
 #include <obs.hpp>
 
 #include <QSize>
 #include <QWidget>
 
+#include <atomic>
+
 static inline void GetScaleAndCenterPos(int baseCX, int baseCY, int windowCX, int windowCY, int &x, int &y,
 					float &scale)
 {
@@ -59,6 +62,82 @@ static inline QSize GetPixelSize(QWidget *widget)
 	return widget->size() * widget->devicePixelRatioF();
 }
 
+/* Measures the GPU time of what a display draws between Begin and End.
+ * Results only become available a few frames later, so a small ring of
+ * queries is kept in flight.  Begin, End and Destroy must be called from
+ * the graphics thread, GetAverageNs from anywhere. */
+class DisplayGPUTimer {
+	static constexpr size_t QUERY_COUNT = 4;
+
+	struct Query {
+		gs_timer_range_t *range = nullptr;
+		gs_timer_t *timer = nullptr;
+		bool pending = false;
+	};
+
+	Query queries[QUERY_COUNT];
+	size_t current = 0;
+	std::atomic<uint64_t> averageNs{0};
+
+	void Collect(Query &query)
+	{
+		uint64_t frequency, ticks;
+		bool disjoint;
+
+		query.pending = false;
+
+		if (!gs_timer_range_get_data(query.range, &disjoint, &frequency) || disjoint || !frequency)
+			return;
+		if (!gs_timer_get_data(query.timer, &ticks))
+			return;
+
+		uint64_t ns = util_mul_div64(ticks, 1000000000ULL, frequency);
+		uint64_t average = averageNs.load(std::memory_order_relaxed);
+		averageNs.store(average ? (average * 7 + ns) / 8 : ns, std::memory_order_relaxed);
+	}
+
+public:
+	void Begin()
+	{
+		Query &query = queries[current];
+
+		if (query.pending)
+			Collect(query);
+		if (!query.range)
+			query.range = gs_timer_range_create();
+		if (!query.timer)
+			query.timer = gs_timer_create();
+		if (!query.range || !query.timer)
+			return;
+
+		gs_timer_range_begin(query.range);
+		gs_timer_begin(query.timer);
+	}
+
+	void End()
+	{
+		Query &query = queries[current];
+		if (!query.range || !query.timer)
+			return;
+
+		gs_timer_end(query.timer);
+		gs_timer_range_end(query.range);
+		query.pending = true;
+		current = (current + 1) % QUERY_COUNT;
+	}
+
+	void Destroy()
+	{
+		for (Query &query : queries) {
+			gs_timer_destroy(query.timer);
+			gs_timer_range_destroy(query.range);
+			query = Query();
+		}
+	}
+
+	uint64_t GetAverageNs() const { return averageNs.load(std::memory_order_relaxed); }
+};
+
 #define OUTLINE_COLOR 0xFFD0D0D0
 #define LINE_LENGTH 0.1f
 
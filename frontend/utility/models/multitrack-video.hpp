@@ -152,14 +152,27 @@ struct System {
 	NLOHMANN_DEFINE_TYPE_INTRUSIVE(System, version, name, build, release, revision, bits, arm, armEmulation)
 };
 
+/* Result of the local encode probe, frames per second one encoder session
+ * sustained at the given resolution */
+struct EncoderBenchmark {
+	string encoder;
+	string codec;
+	uint32_t width;
+	uint32_t height;
+	double encode_fps;
+
+	NLOHMANN_DEFINE_TYPE_INTRUSIVE(EncoderBenchmark, encoder, codec, width, height, encode_fps)
+};
+
 struct Capabilities {
 	Cpu cpu;
 	Memory memory;
 	optional<GamingFeatures> gaming_features;
 	System system;
 	optional<std::vector<Gpu>> gpu;
+	optional<std::vector<EncoderBenchmark>> encoder_benchmarks;
 
-	NLOHMANN_DEFINE_TYPE_INTRUSIVE(Capabilities, cpu, memory, gaming_features, system, gpu)
+	NLOHMANN_DEFINE_TYPE_INTRUSIVE(Capabilities, cpu, memory, gaming_features, system, gpu, encoder_benchmarks)
 };
 
 struct Preferences {
@@ -2,9 +2,12 @@
 
 #include <OBSApp.hpp>
 
+#include <algorithm>
+
 #include "moc_undo_stack.cpp"
 
 #define MAX_STACK_SIZE 5000
+#define MAX_STACK_BYTES (64 * 1024 * 1024)
 
 undo_stack::undo_stack(ui_ptr ui) : ui(ui)
 {
@@ -31,33 +34,101 @@ void undo_stack::clear()
 	ui->actionMainRedo->setDisabled(true);
 }
 
+std::string undo_stack::action_data::redo() const
+{
+	std::string data;
+	data.reserve(redo_prefix + redo_diff.size() + redo_suffix);
+	data.append(undo, 0, redo_prefix);
+	data.append(redo_diff);
+	data.append(undo, undo.size() - redo_suffix, redo_suffix);
+	return data;
+}
+
+undo_stack::action_data undo_stack::compact(std::string undo_data, const std::string &redo_data)
+{
+	const size_t max_shared = std::min(undo_data.size(), redo_data.size());
+	action_data data;
+
+	while (data.redo_prefix < max_shared && undo_data[data.redo_prefix] == redo_data[data.redo_prefix])
+		data.redo_prefix++;
+
+	while (data.redo_prefix + data.redo_suffix < max_shared &&
+	       undo_data[undo_data.size() - data.redo_suffix - 1] == redo_data[redo_data.size() - data.redo_suffix - 1])
+		data.redo_suffix++;
+
+	data.redo_diff = redo_data.substr(data.redo_prefix, redo_data.size() - data.redo_prefix - data.redo_suffix);
+	data.undo = std::move(undo_data);
+	data.undo.shrink_to_fit();
+	return data;
+}
+
 void undo_stack::add_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo,
 			    const std::string &undo_data, const std::string &redo_data, bool repeatable)
 {
 	if (!is_enabled())
 		return;
 
-	while (undo_items.size() >= MAX_STACK_SIZE) {
-		undo_redo_t item = undo_items.back();
-		undo_items.pop_back();
-	}
-
 	if (repeatable) {
 		repeat_reset_timer.start();
 	}
 
 	if (last_is_repeatable && repeatable && name == undo_items[0].name) {
+		std::promise<action_data> merged;
+		merged.set_value(compact(undo_items[0].data.get().undo, redo_data));
+
 		undo_items[0].redo = redo;
-		undo_items[0].redo_data = redo_data;
+		undo_items[0].data = merged.get_future().share();
 		return;
 	}
 
-	undo_redo_t n = {name, undo_data, redo_data, undo, redo};
+	std::promise<action_data> data;
+	data.set_value(compact(undo_data, redo_data));
+	push_action(name, undo, redo, data.get_future().share(), repeatable);
+}
+
+void undo_stack::add_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo,
+			    obs_data_t *undo_data, obs_data_t *redo_data)
+{
+	if (!is_enabled())
+		return;
+
+	OBSData undo_ref = undo_data;
+	OBSData redo_ref = redo_data;
+	auto serialize = [undo_ref, redo_ref]() {
+		const char *undo_json = obs_data_get_json(undo_ref);
+		const char *redo_json = obs_data_get_json(redo_ref);
+		return compact(undo_json ? undo_json : "", redo_json ? redo_json : "");
+	};
+
+	push_action(name, undo, redo, std::async(std::launch::async, serialize).share(), false);
+}
+
+void undo_stack::push_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo,
+			     const action_data_t &data, bool repeatable)
+{
+	undo_redo_t n = {name, data, undo, redo};
 
 	last_is_repeatable = repeatable;
-	undo_items.push_front(n);
+	undo_items.push_front(std::move(n));
 	clear_redo();
 
+	/* actions that are still being serialized are counted the next time */
+	auto action_size = [](const action_data_t &data) -> size_t {
+		if (data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return 0;
+		return data.get().size();
+	};
+
+	size_t total = 0;
+	for (const undo_redo_t &item : undo_items)
+		total += action_size(item.data);
+
+	/* always keep the action that was just added */
+	while (undo_items.size() > 1 && (undo_items.size() > MAX_STACK_SIZE || total > MAX_STACK_BYTES)) {
+		total -= std::min(total, action_size(undo_items.back().data));
+		undo_items.pop_back();
+	}
+
 	ui->actionMainUndo->setText(QTStr("Undo.Item.Undo").arg(name));
 	ui->actionMainUndo->setEnabled(true);
 
@@ -73,7 +144,7 @@ void undo_stack::undo()
 	last_is_repeatable = false;
 
 	undo_redo_t temp = undo_items.front();
-	temp.undo(temp.undo_data);
+	temp.undo(temp.data.get().undo);
 	redo_items.push_front(temp);
 	undo_items.pop_front();
 
@@ -96,7 +167,7 @@ void undo_stack::redo()
 	last_is_repeatable = false;
 
 	undo_redo_t temp = redo_items.front();
-	temp.redo(temp.redo_data);
+	temp.redo(temp.data.get().redo());
 	undo_items.push_front(temp);
 	redo_items.pop_front();
 
@@ -2,11 +2,14 @@
 
 #include "ui_OBSBasic.h"
 
+#include <obs.hpp>
+
 #include <QObject>
 #include <QString>
 #include <QTimer>
 
 #include <deque>
+#include <future>
 #include <string>
 
 class undo_stack : public QObject {
@@ -16,10 +19,26 @@ class undo_stack : public QObject {
 	typedef std::function<void(bool is_undo)> func;
 	typedef std::unique_ptr<Ui::OBSBasic> &ui_ptr;
 
+	/* The redo data of an action usually only differs from its undo data
+	 * in a small part, e.g. the items that were moved, so only that part
+	 * is stored along with how much of the undo data it shares. */
+	struct action_data {
+		std::string undo;
+		std::string redo_diff;
+		size_t redo_prefix = 0;
+		size_t redo_suffix = 0;
+
+		std::string redo() const;
+		inline size_t size() const { return undo.size() + redo_diff.size(); }
+	};
+
+	/* shared between copies of an action, and possibly still being
+	 * serialized on another thread */
+	typedef std::shared_future<action_data> action_data_t;
+
 	struct undo_redo_t {
 		QString name;
-		std::string undo_data;
-		std::string redo_data;
+		action_data_t data;
 		undo_redo_cb undo;
 		undo_redo_cb redo;
 	};
@@ -38,6 +57,10 @@ class undo_stack : public QObject {
 	void enable_internal();
 	void disable_internal();
 	void clear_redo();
+	void push_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo,
+			 const action_data_t &data, bool repeatable);
+
+	static action_data compact(std::string undo_data, const std::string &redo_data);
 
 private slots:
 	void reset_repeatable_state();
@@ -53,6 +76,12 @@ public:
 	void clear();
 	void add_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo,
 			const std::string &undo_data, const std::string &redo_data, bool repeatable = false);
+
+	/* Serializes the data on another thread, neither object may be
+	 * modified afterwards.  Meant for large snapshots such as the
+	 * transform states of a whole scene. */
+	void add_action(const QString &name, const undo_redo_cb &undo, const undo_redo_cb &redo, obs_data_t *undo_data,
+			obs_data_t *redo_data);
 	void undo();
 	void redo();
 };
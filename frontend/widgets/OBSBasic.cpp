@@ -35,6 +35,7 @@
 #include <dialogs/OBSBasicProperties.hpp>
 #include <dialogs/OBSBasicTransform.hpp>
 #include <settings/OBSBasicSettings.hpp>
+#include <utility/EncoderProbe.hpp>
 #include <utility/QuickTransition.hpp>
 #include <utility/SceneRenameDelegate.hpp>
 #if defined(_WIN32) || defined(WHATSNEW_ENABLED)
@@ -55,6 +56,8 @@
 #include <QThread>
 #include <QWidgetAction>
 
+#include <algorithm>
+#include <optional>
 #ifdef _WIN32
 #include <sstream>
 #endif
@@ -491,6 +494,7 @@ OBSBasic::OBSBasic(QWidget *parent) : OBSMainWindow(parent), undo_s(ui), ui(new
 
 	UpdatePreviewSafeAreas();
 	UpdatePreviewSpacingHelpers();
+	UpdatePreviewFrameRate();
 	UpdatePreviewOverflowSettings();
 }
 
@@ -890,12 +894,84 @@ static inline void LogEncoders()
 	list_encoders(OBS_ENCODER_AUDIO);
 }
 
+#define SLOWEST_MODULES_LOGGED 5
+
+/* Times the phases of OBSInit, both for the profiler and for the summary
+ * that's logged once the main window is up */
+class StartupTimer {
+	struct Phase {
+		const char *name;
+		uint64_t time_ns;
+	};
+
+	std::vector<Phase> phases;
+	std::optional<ScopeProfiler> profiler;
+	const uint64_t start_ns = os_gettime_ns();
+	uint64_t phase_start_ns = 0;
+
+public:
+	void Begin(const char *name)
+	{
+		End();
+		phases.push_back({name, 0});
+		profiler.emplace(name);
+		phase_start_ns = os_gettime_ns();
+	}
+
+	void End()
+	{
+		if (!profiler)
+			return;
+
+		phases.back().time_ns = os_gettime_ns() - phase_start_ns;
+		profiler.reset();
+	}
+
+	void Log();
+};
+
+void StartupTimer::Log()
+{
+	End();
+
+	struct ModuleTime {
+		const char *file;
+		uint64_t time_ns;
+	};
+
+	std::vector<ModuleTime> modules;
+	auto addModule = [](void *param, obs_module_t *module) {
+		auto modules = static_cast<std::vector<ModuleTime> *>(param);
+		modules->push_back({obs_get_module_file_name(module), obs_get_module_load_time(module)});
+	};
+	obs_enum_modules(addModule, &modules);
+
+	std::sort(modules.begin(), modules.end(),
+		  [](const ModuleTime &a, const ModuleTime &b) { return a.time_ns > b.time_ns; });
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Startup timing:");
+	for (const Phase &phase : phases)
+		blog(LOG_INFO, "    %s: %.1f ms", phase.name, (double)phase.time_ns / 1000000.0);
+	blog(LOG_INFO, "    Total: %.1f ms", (double)(os_gettime_ns() - start_ns) / 1000000.0);
+
+	blog(LOG_INFO, "  Slowest modules:");
+	for (size_t i = 0; i < modules.size() && i < SLOWEST_MODULES_LOGGED; i++)
+		blog(LOG_INFO, "    %s: %.1f ms", modules[i].file, (double)modules[i].time_ns / 1000000.0);
+	blog(LOG_INFO, "---------------------------------");
+}
+
 void OBSBasic::OBSInit()
 {
 	ProfileScope("OBSBasic::OBSInit");
 
+	StartupTimer startup;
+
 	if (!InitBasicConfig())
 		throw "Failed to load basic.ini";
+
+	startup.Begin("OBSBasic::InitAudioVideo");
+
 	if (!ResetAudio())
 		throw "Failed to initialize audio";
 
@@ -925,6 +1001,8 @@ void OBSBasic::OBSInit()
 		blog(LOG_INFO, "Audio monitoring device:\n\tname: %s\n\tid: %s", device_name, device_id);
 	}
 
+	startup.End();
+
 	InitOBSCallbacks();
 	InitHotkeys();
 	ui->preview->Init();
@@ -950,6 +1028,8 @@ void OBSBasic::OBSInit()
      */
 	RefreshSceneCollections(true);
 
+	startup.Begin("OBSBasic::LoadModules");
+
 	blog(LOG_INFO, "---------------------------------");
 	obs_load_all_modules2(&mfi);
 	blog(LOG_INFO, "---------------------------------");
@@ -960,10 +1040,13 @@ void OBSBasic::OBSInit()
 	BPtr<char *> failed_modules = mfi.failed_modules;
 
 #ifdef BROWSER_AVAILABLE
+	startup.Begin("OBSBasic::InitBrowserPanels");
 	cef = obs_browser_init_panel();
 	cef_js_avail = cef && obs_browser_qcef_version() >= 3;
 #endif
 
+	startup.Begin("OBSBasic::InitOutputs");
+
 	vcamEnabled = (obs_get_output_flags(VIRTUAL_CAM_ID) & OBS_OUTPUT_VIDEO) != 0;
 	if (vcamEnabled) {
 		emit VirtualCamEnabled();
@@ -983,6 +1066,8 @@ void OBSBasic::OBSInit()
 
 	InitPrimitives();
 
+	startup.End();
+
 	sceneDuplicationMode = config_get_bool(App()->GetUserConfig(), "BasicWindow", "SceneDuplicationMode");
 	swapScenesMode = config_get_bool(App()->GetUserConfig(), "BasicWindow", "SwapScenesMode");
 	editPropertiesMode = config_get_bool(App()->GetUserConfig(), "BasicWindow", "EditPropertiesMode");
@@ -1016,6 +1101,8 @@ void OBSBasic::OBSInit()
 		UpdateContextBar(true);
 	UpdateEditMenu();
 
+	startup.Begin("OBSBasic::LoadSceneCollection");
+
 	{
 		ProfileScope("OBSBasic::Load");
 		const std::string sceneCollectionName{
@@ -1045,6 +1132,8 @@ void OBSBasic::OBSInit()
 		disableSaving++;
 	}
 
+	startup.End();
+
 	loaded = true;
 
 	previewEnabled = config_get_bool(App()->GetUserConfig(), "BasicWindow", "PreviewEnabled");
@@ -1057,6 +1146,8 @@ void OBSBasic::OBSInit()
 
 	disableSaving--;
 
+	startup.Begin("OBSBasic::InitWindow");
+
 	auto addDisplay = [this](OBSQTDisplay *window) {
 		obs_display_add_draw_callback(window->GetDisplay(), OBSBasic::RenderMain, this);
 
@@ -1104,9 +1195,9 @@ void OBSBasic::OBSInit()
 		show();
 #endif
 
-	/* setup stats dock */
-	OBSBasicStats *statsDlg = new OBSBasicStats(statsDock, false);
-	statsDock->setWidget(statsDlg);
+	/* setup stats dock, it's hidden for most people so the stats widget
+	 * and its timers are only created once it's shown */
+	statsDock->SetDeferredWidget([this]() { statsDock->setWidget(new OBSBasicStats(statsDock, false)); });
 
 	/* ----------------------------- */
 	/* add custom browser docks      */
@@ -1165,6 +1256,8 @@ void OBSBasic::OBSInit()
 	ui->sideDocks->setChecked(sideDocks);
 	ui->sideDocks->blockSignals(false);
 
+	startup.End();
+
 	SystemTray(true);
 
 	TaskbarOverlayInit();
@@ -1255,7 +1348,13 @@ void OBSBasic::OBSInit()
 	}
 
 	UpdatePreviewProgramIndicators();
+
+	startup.Begin("OBSBasic::FinishedLoading");
 	OnFirstLoad();
+	startup.Log();
+
+	if (config_get_bool(activeConfiguration, "Stream1", "EnableMultitrackVideo"))
+		StartEncoderProbe();
 
 	if (!hideWindowOnStart)
 		activateWindow();
@@ -1313,7 +1412,8 @@ OBSBasic::~OBSBasic()
 	if (patronJsonThread && patronJsonThread->isRunning())
 		patronJsonThread->wait();
 
-	delete screenshotData;
+	for (QPointer<QObject> &screenshot : screenshotData)
+		delete screenshot;
 	delete previewProjector;
 	delete studioProgramProjector;
 	delete previewProjectorSource;
@@ -1370,6 +1470,8 @@ OBSBasic::~OBSBasic()
 	gs_vertexbuffer_destroy(leftLine);
 	gs_vertexbuffer_destroy(topLine);
 	gs_vertexbuffer_destroy(rightLine);
+	gs_texrender_destroy(previewCache);
+	previewGPUTimer.Destroy();
 	obs_leave_graphics();
 
 	/* When shutting down, sometimes source references can get in to the
@@ -1650,6 +1752,7 @@ void OBSBasic::closeEvent(QCloseEvent *event)
 		updateCheckThread->wait();
 	if (logUploadThread)
 		logUploadThread->wait();
+	StopEncoderProbe();
 	if (devicePropertiesThread && devicePropertiesThread->isRunning()) {
 		devicePropertiesThread->wait();
 		devicePropertiesThread.reset();
@@ -25,6 +25,8 @@
 #include <utility/BasicOutputHandler.hpp>
 #include <utility/VCamConfig.hpp>
 #include <utility/platform.hpp>
+#include <utility/SaveWorker.hpp>
+#include <utility/display-helpers.hpp>
 #include <utility/undo_stack.hpp>
 
 #include <obs-frontend-internal.hpp>
@@ -45,6 +47,7 @@ Q_DECLARE_METATYPE(OBSSource);
 
 extern volatile bool recording_paused;
 
+class BrowserDock;
 class ColorSelect;
 class OBSAbout;
 class OBSBasicAdvAudio;
@@ -359,6 +362,7 @@ private:
 	void SaveExtraBrowserDocks();
 	void ManageExtraBrowserDocks();
 	void AddExtraBrowserDock(const QString &title, const QString &url, const QString &uuid, bool firstCreate);
+	void CreateExtraBrowserWidget(BrowserDock *dock);
 #endif
 
 public:
@@ -429,7 +433,7 @@ public slots:
 private:
 	QList<QPointer<QDockWidget>> oldExtraDocks;
 	QStringList oldExtraDockNames;
-	QPointer<QDockWidget> statsDock;
+	QPointer<OBSDock> statsDock;
 	QByteArray startingDockLayout;
 	QStringList extraDockNames;
 	QList<std::shared_ptr<QDockWidget>> extraDocks;
@@ -791,9 +795,20 @@ private:
 
 	bool drawSpacingHelpers = true;
 
+	/* When previewInterval is set the preview content is rendered into
+	 * previewCache at the preview's size and only refreshed that often */
+	gs_texrender_t *previewCache = nullptr;
+	enum gs_color_space previewCacheSpace = GS_CS_SRGB;
+	uint32_t previewCacheCX = 0, previewCacheCY = 0;
+	uint64_t previewCacheTime = 0;
+	uint64_t previewInterval = 0;
+	DisplayGPUTimer previewGPUTimer;
+
 	float dpi = 1.0;
 
 	void DrawBackdrop(float cx, float cy);
+	void DrawPreviewContent(float cx, float cy);
+	void DrawCachedPreview(float cx, float cy);
 	void InitPrimitives();
 	void UpdatePreviewScalingMenu();
 
@@ -809,6 +824,8 @@ private:
 	QColor GetHoverColor() const;
 
 	void UpdatePreviewSpacingHelpers();
+	void UpdatePreviewFrameRate();
+	inline uint64_t GetPreviewGPUTimeNs() const { return previewGPUTimer.GetAverageNs(); }
 
 	float GetDevicePixelRatio();
 
@@ -1046,6 +1063,7 @@ private:
 	long disableSaving = 1;
 	bool projectChanged = false;
 	bool clearingFailed = false;
+	SaveWorker saveWorker;
 
 	QPointer<OBSMissingFiles> missDialog;
 	std::optional<std::pair<uint32_t, uint32_t>> migrationBaseResolution;
@@ -1055,13 +1073,14 @@ private:
 
 	void DisableRelativeCoordinates(bool disable);
 	void CreateDefaultScene(bool firstStart);
-	void Save(const char *file);
+	void Save(const char *file, bool async = false);
 	void LoadData(obs_data_t *data, const char *file, bool remigrate = false);
 	void Load(const char *file, bool remigrate = false);
 
-	void ClearSceneData();
+	void ClearSceneData(bool waitForDestroy = true);
 	void LogScenes();
 	void SaveProjectNow();
+	void SaveCurrentSceneCollection(bool async);
 	void ShowMissingFilesDialog(obs_missing_files_t *files);
 
 	void SetupNewSceneCollection(const std::string &collectionName);
@@ -1228,6 +1247,12 @@ private:
 	OBSWeakSource lastScene;
 	OBSWeakSource swapScene;
 
+	/* lazily loaded sources of the scenes next to the current one */
+	std::deque<OBSWeakSource> prewarmSources;
+
+	void PrewarmAdjacentScenes();
+	void PrewarmNextSource();
+
 	void LoadSceneListOrder(obs_data_array_t *array);
 	obs_data_array_t *SaveSceneListOrder();
 	void ChangeSceneIndex(bool relative, int idx, int invalidIdx);
@@ -1298,7 +1323,7 @@ public:
 	 * -------------------------------------
 	 */
 private:
-	QPointer<QObject> screenshotData;
+	std::vector<QPointer<QObject>> screenshotData;
 	std::string lastScreenshot;
 
 private slots:
@@ -108,37 +108,20 @@ static bool CloseFloat(float a, float b, float epsilon = 0.01)
 static bool FindItemAtPos(obs_scene_t * /* scene */, obs_sceneitem_t *item, void *param)
 {
 	SceneFindData *data = reinterpret_cast<SceneFindData *>(param);
-	matrix4 transform;
-	matrix4 invTransform;
-	vec3 transformedPos;
-	vec3 pos3;
-	vec3 pos3_;
 
 	if (!SceneItemHasVideo(item))
 		return true;
 	if (obs_sceneitem_locked(item))
 		return true;
 
-	vec3_set(&pos3, data->pos.x, data->pos.y, 0.0f);
-
-	obs_sceneitem_get_box_transform(item, &transform);
-
-	matrix4_inv(&invTransform, &transform);
-	vec3_transform(&transformedPos, &pos3, &invTransform);
-	vec3_transform(&pos3_, &transformedPos, &transform);
-
-	if (CloseFloat(pos3.x, pos3_.x) && CloseFloat(pos3.y, pos3_.y) && transformedPos.x >= 0.0f &&
-	    transformedPos.x <= 1.0f && transformedPos.y >= 0.0f && transformedPos.y <= 1.0f) {
-		if (data->selectBelow && obs_sceneitem_selected(item)) {
-			if (data->item)
-				return false;
-			else
-				data->selectBelow = false;
-		}
-
-		data->item = item;
+	if (data->selectBelow && obs_sceneitem_selected(item)) {
+		if (data->item)
+			return false;
+		else
+			data->selectBelow = false;
 	}
 
+	data->item = item;
 	return true;
 }
 
@@ -218,7 +201,7 @@ OBSSceneItem OBSBasicPreview::GetItemAtPos(const vec2 &pos, bool selectBelow)
 		return OBSSceneItem();
 
 	SceneFindData data(pos, selectBelow);
-	obs_scene_enum_items(scene, FindItemAtPos, &data);
+	obs_scene_enum_items_at(scene, &pos, FindItemAtPos, &data);
 	return data.item;
 }
 
@@ -1155,8 +1138,12 @@ void OBSBasicPreview::BoxItems(const vec2 &startPos, const vec2 &pos)
 	if (cursor().shape() != Qt::CrossCursor)
 		setCursor(Qt::CrossCursor);
 
+	vec2 pos_min, pos_max;
+	vec2_min(&pos_min, &startPos, &pos);
+	vec2_max(&pos_max, &startPos, &pos);
+
 	SceneFindBoxData data(startPos, pos);
-	obs_scene_enum_items(scene, FindItemsInBox, &data);
+	obs_scene_enum_items_in_rect(scene, &pos_min, &pos_max, FindItemsInBox, &data);
 
 	std::lock_guard<std::mutex> lock(selectMutex);
 	hoveredPreviewItems = data.sceneItems;
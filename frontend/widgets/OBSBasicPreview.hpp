@@ -144,6 +144,7 @@ public:
 	inline void SetLocked(bool newLockedVal) { locked = newLockedVal; }
 	inline void ToggleLocked() { locked = !locked; }
 	inline bool Locked() const { return locked; }
+	inline bool IsEditing() const { return mouseDown && mouseMoved; }
 
 	inline void SetFixedScaling(bool newFixedScalingVal)
 	{
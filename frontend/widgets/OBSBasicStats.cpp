@@ -3,6 +3,8 @@
 #include <widgets/OBSBasic.hpp>
 
 #include <qt-wrappers.hpp>
+#include <util/profiler.h>
+#include <util/util_uint64.h>
 
 #include <QGridLayout>
 #include <QLabel>
@@ -15,6 +17,14 @@
 #define TIMER_INTERVAL 2000
 #define REC_TIME_LEFT_INTERVAL 30000
 
+extern uint32_t opt_trace_history;
+
+static const char *stageNames[OBS_FRAME_TIMING_STAGE_COUNT] = {"Tick", "Output", "Displays", "Total"};
+
+/* GPU frame timing costs timer queries, so it's only on while a stats
+ * window or dock is visible */
+static int gpuTimingUsers = 0;
+
 void OBSBasicStats::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 {
 	OBSBasicStats *stats = reinterpret_cast<OBSBasicStats *>(ptr);
@@ -42,6 +52,83 @@ static QString MakeTimeLeftText(int hours, int minutes)
 	return QString::asprintf("%d %s, %d %s", hours, Str("Hours"), minutes, Str("Minutes"));
 }
 
+static QString MakePercentilesText(const struct obs_frame_timing_percentiles &pct)
+{
+	return QString("%1 / %2 / %3 ms")
+		.arg(QString::number((double)pct.p50 / 1000000.0, 'f', 2),
+		     QString::number((double)pct.p95 / 1000000.0, 'f', 2),
+		     QString::number((double)pct.p99 / 1000000.0, 'f', 2));
+}
+
+static QString MakeBytesText(uint64_t bytes)
+{
+	long double num = (long double)bytes / (1024.0l * 1024.0l);
+	const char *unit = "MiB";
+	if (num > 1024) {
+		num /= 1024;
+		unit = "GiB";
+	}
+	return QString("%1 %2").arg(num, 0, 'f', 1).arg(unit);
+}
+
+struct WriteStats {
+	uint64_t bytesWritten;
+	uint64_t bufferUsed;
+	uint64_t bufferSize;
+	double maxBlockedMs;
+	double totalBlockedMs;
+};
+
+/* file outputs that write through a buffer report it with get_write_stats */
+static bool GetWriteStats(obs_output_t *output, WriteStats &stats)
+{
+	proc_handler_t *ph = output ? obs_output_get_proc_handler(output) : nullptr;
+	calldata_t cd = {};
+	bool success = ph && proc_handler_call(ph, "get_write_stats", &cd);
+
+	if (success) {
+		stats.bytesWritten = (uint64_t)calldata_int(&cd, "bytes_written");
+		stats.bufferUsed = (uint64_t)calldata_int(&cd, "buffer_used");
+		stats.bufferSize = (uint64_t)calldata_int(&cd, "buffer_size");
+		stats.maxBlockedMs = calldata_float(&cd, "max_blocked_ms");
+		stats.totalBlockedMs = calldata_float(&cd, "total_blocked_ms");
+	}
+
+	calldata_free(&cd);
+	return success;
+}
+
+static std::vector<OBSEncoder> GetActiveEncoders()
+{
+	std::vector<OBSEncoder> encoders;
+
+	auto addEncoder = [&](obs_encoder_t *encoder) {
+		if (!encoder || !obs_encoder_active(encoder))
+			return;
+		for (const OBSEncoder &existing : encoders) {
+			if (existing == encoder)
+				return;
+		}
+		encoders.emplace_back(encoder);
+	};
+
+	auto enumOutput = [](void *param, obs_output_t *output) {
+		auto &add = *static_cast<decltype(addEncoder) *>(param);
+
+		if (!obs_output_active(output))
+			return true;
+
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+			add(obs_output_get_video_encoder2(output, i));
+		for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+			add(obs_output_get_audio_encoder(output, i));
+		return true;
+	};
+
+	obs_enum_outputs(enumOutput, &addEncoder);
+	return encoders;
+}
+
 static QString MakeMissedFramesText(uint32_t total_lagged, uint32_t total_rendered, long double num)
 {
 	return QString("%1 / %2 (%3%)")
@@ -80,6 +167,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	hddSpace = new QLabel(this);
 	recordTimeLeft = new QLabel(this);
 	memUsage = new QLabel(this);
+	gpuMemUsage = new QLabel(this);
 
 	QString str = MakeTimeLeftText(99999, 59);
 	int textWidth = recordTimeLeft->fontMetrics().boundingRect(str).width();
@@ -89,11 +177,17 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	newStat("HDDSpaceAvailable", hddSpace, 0);
 	newStat("DiskFullIn", recordTimeLeft, 0);
 	newStat("MemoryUsage", memUsage, 0);
+	newStat("GPUMemoryUsage", gpuMemUsage, 0);
+
+	diskWriteRate = new QLabel(this);
+	newStat("DiskWriteRate", diskWriteRate, 0);
 
 	fps = new QLabel(this);
 	renderTime = new QLabel(this);
+	previewGPUTime = new QLabel(this);
 	skippedFrames = new QLabel(this);
 	missedFrames = new QLabel(this);
+	monitoringLatency = new QLabel(this);
 
 	str = MakeMissedFramesText(999999, 999999, 99.99);
 	textWidth = missedFrames->fontMetrics().boundingRect(str).width();
@@ -103,15 +197,45 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 
 	newStatBare("FPS", fps, 2);
 	newStat("AverageTimeToRender", renderTime, 2);
+	newStat("PreviewGPUTime", previewGPUTime, 2);
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
+	newStat("MonitoringLatency", monitoringLatency, 2);
+
+	/* --------------------------------------------- */
+
+	timingLayout = new QGridLayout();
+
+	auto addBoldLabel = [&](QGridLayout *layout, const char *loc, int labelRow, int labelCol) {
+		QLabel *label = new QLabel(QTStr(loc), this);
+		label->setStyleSheet("font-weight: bold");
+		layout->addWidget(label, labelRow, labelCol);
+	};
+
+	addBoldLabel(timingLayout, "Basic.Stats.FrameTiming", 0, 0);
+	addBoldLabel(timingLayout, "Basic.Stats.FrameTiming.CPU", 0, 1);
+	addBoldLabel(timingLayout, "Basic.Stats.FrameTiming.GPU", 0, 2);
+
+	for (int i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++) {
+		std::string loc = "Basic.Stats.FrameTiming.";
+		loc += stageNames[i];
+
+		timingLayout->addWidget(new QLabel(QTStr(loc.c_str()), this), i + 1, 0);
+		for (int j = 0; j < 2; j++) {
+			stageTimes[i][j] = new QLabel(this);
+			timingLayout->addWidget(stageTimes[i][j], i + 1, j + 1);
+		}
+	}
 
 	/* --------------------------------------------- */
 	QPushButton *closeButton = nullptr;
 	if (closable)
 		closeButton = new QPushButton(QTStr("Close"));
+	QPushButton *exportButton = new QPushButton(QTStr("Basic.Stats.ExportDiagnostics"));
+	exportButton->setToolTip(QTStr("Basic.Stats.ExportDiagnostics.ToolTip"));
 	QPushButton *resetButton = new QPushButton(QTStr("Reset"));
 	QHBoxLayout *buttonLayout = new QHBoxLayout;
+	buttonLayout->addWidget(exportButton);
 	buttonLayout->addStretch();
 	buttonLayout->addWidget(resetButton);
 	if (closable)
@@ -131,6 +255,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	addOutputCol("Basic.Stats.DroppedFrames");
 	addOutputCol("Basic.Stats.MegabytesSent");
 	addOutputCol("Basic.Stats.Bitrate");
+	addOutputCol("Basic.Stats.Buffered");
 
 	/* --------------------------------------------- */
 
@@ -139,8 +264,19 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 
 	/* --------------------------------------------- */
 
+	encoderLayout = new QGridLayout();
+
+	addBoldLabel(encoderLayout, "Basic.Stats.Encoder", 0, 0);
+	addBoldLabel(encoderLayout, "Basic.Stats.Encoder.EncodeTime", 0, 1);
+	addBoldLabel(encoderLayout, "Basic.Stats.Encoder.Latency", 0, 2);
+	addBoldLabel(encoderLayout, "Basic.Stats.Encoder.Queue", 0, 3);
+	addBoldLabel(encoderLayout, "Basic.Stats.Bitrate", 0, 4);
+
+	/* --------------------------------------------- */
+
 	QVBoxLayout *outputContainerLayout = new QVBoxLayout();
 	outputContainerLayout->addLayout(outputLayout);
+	outputContainerLayout->addLayout(encoderLayout);
 	outputContainerLayout->addStretch();
 
 	QWidget *widget = new QWidget(this);
@@ -153,6 +289,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	/* --------------------------------------------- */
 
 	mainLayout->addLayout(topLayout);
+	mainLayout->addLayout(timingLayout);
 	mainLayout->addWidget(scrollArea);
 	mainLayout->addLayout(buttonLayout);
 	setLayout(mainLayout);
@@ -161,12 +298,13 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	if (closable)
 		connect(closeButton, &QPushButton::clicked, [this]() { close(); });
 	connect(resetButton, &QPushButton::clicked, [this]() { Reset(); });
+	connect(exportButton, &QPushButton::clicked, this, &OBSBasicStats::ExportDiagnostics);
 
 	delete shortcutFilter;
 	shortcutFilter = CreateShortcutFilter();
 	installEventFilter(shortcutFilter);
 
-	resize(800, 280);
+	resize(800, 480);
 
 	setWindowTitle(QTStr("Basic.Stats"));
 #ifdef __APPLE__
@@ -214,7 +352,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 	OBSBasic *main = OBSBasic::Get();
 	if (isVisible()) {
 		config_set_string(main->Config(), "Stats", "geometry", saveGeometry().toBase64().constData());
-		config_save_safe(main->Config(), "tmp", nullptr);
+		config_save_deferred(main->Config(), "tmp", nullptr);
 	}
 
 	// This code is only reached when the non-dockable stats window is
@@ -226,6 +364,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 
 OBSBasicStats::~OBSBasicStats()
 {
+	StopGPUTiming();
 	delete shortcutFilter;
 	os_cpu_usage_info_destroy(cpu_info);
 }
@@ -238,6 +377,7 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	ol.droppedFrames = new QLabel(this);
 	ol.megabytesSent = new QLabel(this);
 	ol.bitrate = new QLabel(this);
+	ol.buffered = new QLabel(this);
 
 	int col = 0;
 	int row = outputLabels.size() + 1;
@@ -246,6 +386,7 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	outputLayout->addWidget(ol.droppedFrames, row, col++);
 	outputLayout->addWidget(ol.megabytesSent, row, col++);
 	outputLayout->addWidget(ol.bitrate, row, col++);
+	outputLayout->addWidget(ol.buffered, row, col++);
 	outputLabels.push_back(ol);
 }
 
@@ -339,6 +480,25 @@ void OBSBasicStats::Update()
 
 	/* ------------------ */
 
+	struct gs_memory_usage gpuUsage;
+	obs_get_gpu_memory_usage(&gpuUsage);
+
+	num = (long double)gpuUsage.total / (1024.0l * 1024.0l);
+	str = QString::number(num, 'f', 1);
+	if (gpuUsage.budget) {
+		num = (long double)gpuUsage.budget / (1024.0l * 1024.0l);
+		str += QStringLiteral(" / ") + QString::number(num, 'f', 0);
+	}
+	str += QStringLiteral(" MB");
+	gpuMemUsage->setText(str);
+
+	if (gpuUsage.budget && gpuUsage.total > gpuUsage.budget)
+		setClasses(gpuMemUsage, "text-warning");
+	else
+		setClasses(gpuMemUsage, "");
+
+	/* ------------------ */
+
 	num = (long double)obs_get_average_frame_time_ns() / 1000000.0l;
 
 	str = QString::number(num, 'f', 1) + QStringLiteral(" ms");
@@ -355,6 +515,13 @@ void OBSBasicStats::Update()
 
 	/* ------------------ */
 
+	num = (long double)main->GetPreviewGPUTimeNs() / 1000000.0l;
+
+	str = QString::number(num, 'f', 1) + QStringLiteral(" ms");
+	previewGPUTime->setText(str);
+
+	/* ------------------ */
+
 	video_t *video = obs_get_video();
 	uint32_t total_encoded = video_output_get_total_frames(video);
 	uint32_t total_skipped = video_output_get_skipped_frames(video);
@@ -406,6 +573,22 @@ void OBSBasicStats::Update()
 	else
 		setClasses(missedFrames, "");
 
+	/* ------------------ */
+
+	uint64_t latency = obs_get_audio_monitoring_latency();
+	if (latency) {
+		num = (long double)latency / 1000000.0l;
+		str = QString::number(num, 'f', 1) + QStringLiteral(" ms");
+	} else {
+		str = QStringLiteral("-");
+	}
+	monitoringLatency->setText(str);
+
+	/* ------------------ */
+
+	UpdateFrameTiming();
+	UpdateDiskWriteRate(recOutput);
+
 	/* ------------------------------------------- */
 	/* recording/streaming stats                   */
 
@@ -416,6 +599,165 @@ void OBSBasicStats::Update()
 		long double kbps = outputLabels[1].kbps;
 		bitrates.push_back(kbps);
 	}
+
+	UpdateEncoders();
+}
+
+void OBSBasicStats::UpdateFrameTiming()
+{
+	struct obs_video_frame_timing timing = {};
+	bool valid = obs_get_video_frame_timing(&timing);
+
+	struct obs_video_info ovi = {};
+	obs_get_video_info(&ovi);
+	uint64_t frameTimeNs = ovi.fps_num ? util_mul_div64(1000000000ULL, ovi.fps_den, ovi.fps_num) : 0;
+
+	for (int i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++) {
+		for (int j = 0; j < 2; j++) {
+			const struct obs_frame_timing_percentiles &pct = j ? timing.gpu[i] : timing.cpu[i];
+			bool hasSamples = valid && (j ? timing.gpu_samples : timing.samples);
+			QLabel *label = stageTimes[i][j];
+
+			label->setText(hasSamples ? MakePercentilesText(pct) : QStringLiteral("-"));
+
+			if (hasSamples && pct.p95 > frameTimeNs)
+				setClasses(label, "text-danger");
+			else if (hasSamples && pct.p99 > frameTimeNs)
+				setClasses(label, "text-warning");
+			else
+				setClasses(label, "");
+		}
+	}
+}
+
+void OBSBasicStats::UpdateDiskWriteRate(obs_output_t *recOutput)
+{
+	WriteStats stats;
+	uint64_t curTime = os_gettime_ns();
+
+	if (!obs_output_active(recOutput) || !GetWriteStats(recOutput, stats)) {
+		lastDiskBytes = 0;
+		lastDiskTime = 0;
+		diskBytesPerSec = 0.0l;
+		diskWriteRate->setText(QStringLiteral("-"));
+		setClasses(diskWriteRate, "");
+		return;
+	}
+
+	long double timePassed = (long double)(curTime - lastDiskTime) / 1000000000.0l;
+	if (lastDiskTime && stats.bytesWritten >= lastDiskBytes && timePassed >= 0.01l)
+		diskBytesPerSec = (long double)(stats.bytesWritten - lastDiskBytes) / timePassed;
+	else
+		diskBytesPerSec = 0.0l;
+
+	lastDiskBytes = stats.bytesWritten;
+	lastDiskTime = curTime;
+
+	QString str = QString::number(diskBytesPerSec / (1024.0l * 1024.0l), 'f', 1) + QStringLiteral(" MB/s");
+	if (stats.bufferSize) {
+		uint64_t percent = stats.bufferUsed * 100 / stats.bufferSize;
+		str += QStringLiteral(" (") + QTStr("Basic.Stats.DiskWriteRate.Buffer").arg(percent) +
+		       QStringLiteral(")");
+	}
+	diskWriteRate->setText(str);
+
+	/* writes blocking means the disk can't keep up with the encoders */
+	if (stats.maxBlockedMs > 0.0)
+		setClasses(diskWriteRate, "text-danger");
+	else if (stats.bufferSize && stats.bufferUsed > stats.bufferSize / 2)
+		setClasses(diskWriteRate, "text-warning");
+	else
+		setClasses(diskWriteRate, "");
+}
+
+void OBSBasicStats::UpdateEncoders()
+{
+	std::vector<OBSEncoder> encoders = GetActiveEncoders();
+
+	bool changed = encoders.size() != encoderLabels.size();
+	for (size_t i = 0; !changed && i < encoders.size(); i++)
+		changed = encoderLabels[i].name != obs_encoder_get_name(encoders[i]);
+
+	if (changed) {
+		for (EncoderLabels &el : encoderLabels) {
+			delete el.nameLabel;
+			delete el.encodeTime;
+			delete el.latency;
+			delete el.queue;
+			delete el.bitrate;
+		}
+		encoderLabels.clear();
+
+		for (const OBSEncoder &encoder : encoders) {
+			EncoderLabels el;
+			el.name = obs_encoder_get_name(encoder);
+			el.nameLabel = new QLabel(QT_UTF8(el.name.c_str()), this);
+			el.encodeTime = new QLabel(this);
+			el.latency = new QLabel(this);
+			el.queue = new QLabel(this);
+			el.bitrate = new QLabel(this);
+
+			int col = 0;
+			int row = (int)encoderLabels.size() + 1;
+			encoderLayout->addWidget(el.nameLabel, row, col++);
+			encoderLayout->addWidget(el.encodeTime, row, col++);
+			encoderLayout->addWidget(el.latency, row, col++);
+			encoderLayout->addWidget(el.queue, row, col++);
+			encoderLayout->addWidget(el.bitrate, row, col++);
+			encoderLabels.push_back(el);
+		}
+	}
+
+	for (size_t i = 0; i < encoders.size(); i++)
+		encoderLabels[i].Update(encoders[i]);
+}
+
+void OBSBasicStats::EncoderLabels::Update(obs_encoder_t *encoder)
+{
+	struct obs_encoder_stats stats;
+
+	if (!obs_encoder_get_stats(encoder, &stats)) {
+		encodeTime->setText(QStringLiteral("-"));
+		latency->setText(QStringLiteral("-"));
+		queue->setText(QStringLiteral("-"));
+		bitrate->setText(QStringLiteral("-"));
+		return;
+	}
+
+	bool video = obs_encoder_get_type(encoder) == OBS_ENCODER_VIDEO;
+
+	double avg = stats.encode_calls ? (double)stats.encode_us_total / (double)stats.encode_calls : 0.0;
+	encodeTime->setText(QString("%1 / %2 ms")
+				    .arg(QString::number(avg / 1000.0, 'f', 2),
+					 QString::number((double)stats.encode_us_max / 1000.0, 'f', 2)));
+
+	if (video && stats.latency_samples) {
+		avg = (double)stats.latency_us_total / (double)stats.latency_samples;
+		latency->setText(QString("%1 / %2 ms")
+					 .arg(QString::number(avg / 1000.0, 'f', 1),
+					      QString::number((double)stats.latency_us_max / 1000.0, 'f', 1)));
+	} else {
+		latency->setText(QStringLiteral("-"));
+	}
+
+	if (video) {
+		QString str = QString::number(stats.frames_in_flight);
+		if (stats.lagged_frames)
+			str += QStringLiteral(" (") + QTStr("Basic.Stats.Encoder.Lagged").arg(stats.lagged_frames) +
+			       QStringLiteral(")");
+		queue->setText(str);
+		setClasses(queue, stats.lagged_frames ? "text-warning" : "");
+	} else {
+		queue->setText(QStringLiteral("-"));
+	}
+
+	long double num = stats.bitrate_kbps;
+	const char *unit = "kb/s";
+	if (num >= 10'000) {
+		num /= 1000;
+		unit = "Mb/s";
+	}
+	bitrate->setText(QString("%1 %2").arg(num, 0, 'f', 0).arg(unit));
 }
 
 void OBSBasicStats::StartRecTimeLeft()
@@ -459,6 +801,208 @@ void OBSBasicStats::RecordingTimeLeft()
 	recordTimeLeft->setMinimumWidth(recordTimeLeft->width());
 }
 
+static void AddFrameTiming(obs_data_t *data)
+{
+	struct obs_video_frame_timing timing;
+	if (!obs_get_video_frame_timing(&timing))
+		return;
+
+	OBSDataAutoRelease obj = obs_data_create();
+	OBSDataArrayAutoRelease stages = obs_data_array_create();
+
+	obs_data_set_int(obj, "samples", timing.samples);
+	obs_data_set_int(obj, "gpu_samples", timing.gpu_samples);
+
+	for (int i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++) {
+		OBSDataAutoRelease stage = obs_data_create();
+		obs_data_set_string(stage, "name", stageNames[i]);
+		obs_data_set_int(stage, "cpu_p50_ns", (long long)timing.cpu[i].p50);
+		obs_data_set_int(stage, "cpu_p95_ns", (long long)timing.cpu[i].p95);
+		obs_data_set_int(stage, "cpu_p99_ns", (long long)timing.cpu[i].p99);
+		if (timing.gpu_samples) {
+			obs_data_set_int(stage, "gpu_p50_ns", (long long)timing.gpu[i].p50);
+			obs_data_set_int(stage, "gpu_p95_ns", (long long)timing.gpu[i].p95);
+			obs_data_set_int(stage, "gpu_p99_ns", (long long)timing.gpu[i].p99);
+		}
+		obs_data_array_push_back(stages, stage);
+	}
+
+	obs_data_set_array(obj, "stages", stages);
+	obs_data_set_obj(data, "frame_timing", obj);
+}
+
+static obs_data_t *LatencyToData(const struct obs_output_latency_stats &latency)
+{
+	obs_data_t *obj = obs_data_create();
+
+	for (int i = 0; i < OBS_OUTPUT_LATENCY_STAGE_COUNT; i++) {
+		const struct obs_output_latency_histogram &hist = latency.stages[i];
+
+		OBSDataAutoRelease stage = obs_data_create();
+		obs_data_set_int(stage, "samples", (long long)hist.samples);
+		obs_data_set_int(stage, "us_total", (long long)hist.us_total);
+		obs_data_set_int(stage, "us_max", hist.us_max);
+
+		OBSDataArrayAutoRelease histogram = obs_data_array_create();
+		for (size_t j = 0; j < OBS_OUTPUT_LATENCY_BUCKETS; j++) {
+			OBSDataAutoRelease bucket = obs_data_create();
+			obs_data_set_int(bucket, "count", (long long)hist.buckets[j]);
+			obs_data_array_push_back(histogram, bucket);
+		}
+		obs_data_set_array(stage, "histogram", histogram);
+
+		obs_data_set_obj(obj, obs_output_latency_stage_name((enum obs_output_latency_stage)i), stage);
+	}
+
+	return obj;
+}
+
+static void AddOutputs(obs_data_t *data)
+{
+	OBSDataArrayAutoRelease outputs = obs_data_array_create();
+
+	auto enumOutput = [](void *param, obs_output_t *output) {
+		obs_data_array_t *array = static_cast<obs_data_array_t *>(param);
+		WriteStats stats;
+
+		if (!obs_output_active(output))
+			return true;
+
+		OBSDataAutoRelease obj = obs_data_create();
+		obs_data_set_string(obj, "name", obs_output_get_name(output));
+		obs_data_set_string(obj, "id", obs_output_get_id(output));
+		obs_data_set_int(obj, "total_bytes", (long long)obs_output_get_total_bytes(output));
+		obs_data_set_int(obj, "buffered_bytes", (long long)obs_output_get_buffered_bytes(output));
+		obs_data_set_int(obj, "total_frames", obs_output_get_total_frames(output));
+		obs_data_set_int(obj, "dropped_frames", obs_output_get_frames_dropped(output));
+
+		if (GetWriteStats(output, stats)) {
+			OBSDataAutoRelease write = obs_data_create();
+			obs_data_set_int(write, "bytes_written", (long long)stats.bytesWritten);
+			obs_data_set_int(write, "buffer_used", (long long)stats.bufferUsed);
+			obs_data_set_int(write, "buffer_size", (long long)stats.bufferSize);
+			obs_data_set_double(write, "max_blocked_ms", stats.maxBlockedMs);
+			obs_data_set_double(write, "total_blocked_ms", stats.totalBlockedMs);
+			obs_data_set_obj(obj, "write_stats", write);
+		}
+
+		OBSDataArrayAutoRelease tracks = obs_data_array_create();
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			struct obs_output_latency_stats latency;
+
+			if (!obs_output_get_video_encoder2(output, i) ||
+			    !obs_output_get_latency_stats(output, i, &latency))
+				continue;
+
+			OBSDataAutoRelease track = LatencyToData(latency);
+			obs_data_set_int(track, "track", (long long)i);
+			obs_data_array_push_back(tracks, track);
+		}
+		obs_data_set_array(obj, "latency", tracks);
+
+		obs_data_array_push_back(array, obj);
+		return true;
+	};
+
+	obs_enum_outputs(enumOutput, outputs.Get());
+	obs_data_set_array(data, "outputs", outputs);
+}
+
+static void AddEncoders(obs_data_t *data)
+{
+	OBSDataArrayAutoRelease encoders = obs_data_array_create();
+
+	for (const OBSEncoder &encoder : GetActiveEncoders()) {
+		struct obs_encoder_stats stats;
+		if (!obs_encoder_get_stats(encoder, &stats))
+			continue;
+
+		OBSDataAutoRelease obj = obs_data_create();
+		obs_data_set_string(obj, "name", obs_encoder_get_name(encoder));
+		obs_data_set_string(obj, "id", obs_encoder_get_id(encoder));
+		obs_data_set_int(obj, "encode_calls", (long long)stats.encode_calls);
+		obs_data_set_int(obj, "frames_submitted", (long long)stats.frames_submitted);
+		obs_data_set_int(obj, "encode_us_total", (long long)stats.encode_us_total);
+		obs_data_set_int(obj, "encode_us_max", stats.encode_us_max);
+		obs_data_set_int(obj, "packets", (long long)stats.packets);
+		obs_data_set_int(obj, "bytes", (long long)stats.bytes);
+		obs_data_set_int(obj, "bitrate_kbps", stats.bitrate_kbps);
+		obs_data_set_int(obj, "frames_in_flight", stats.frames_in_flight);
+		obs_data_set_int(obj, "lagged_frames", stats.lagged_frames);
+		obs_data_set_int(obj, "latency_samples", (long long)stats.latency_samples);
+		obs_data_set_int(obj, "latency_us_total", (long long)stats.latency_us_total);
+		obs_data_set_int(obj, "latency_us_max", stats.latency_us_max);
+
+		OBSDataArrayAutoRelease histogram = obs_data_array_create();
+		for (size_t i = 0; i < OBS_ENCODER_LATENCY_BUCKETS; i++) {
+			OBSDataAutoRelease bucket = obs_data_create();
+			obs_data_set_int(bucket, "count", (long long)stats.latency_histogram[i]);
+			obs_data_array_push_back(histogram, bucket);
+		}
+		obs_data_set_array(obj, "latency_histogram", histogram);
+
+		obs_data_array_push_back(encoders, obj);
+	}
+
+	obs_data_set_array(data, "encoders", encoders);
+}
+
+void OBSBasicStats::ExportDiagnostics()
+{
+	/* both files share a name so they can be matched up */
+	std::string name = "obs-studio/profiler_data/" + GenerateTimeDateFilename("diagnostics");
+	BPtr<char> path = GetAppConfigPathPtr((name + ".json").c_str());
+	BPtr<char> tracePath = GetAppConfigPathPtr((name + ".trace.json").c_str());
+	if (!path || !tracePath)
+		return;
+
+	struct obs_video_info ovi = {};
+	obs_get_video_info(&ovi);
+
+	struct gs_memory_usage gpuUsage;
+	obs_get_gpu_memory_usage(&gpuUsage);
+
+	OBSDataAutoRelease data = obs_data_create();
+	obs_data_set_string(data, "version", obs_get_version_string());
+	obs_data_set_double(data, "fps", ovi.fps_den ? (double)ovi.fps_num / (double)ovi.fps_den : 0.0);
+	obs_data_set_double(data, "active_fps", obs_get_active_fps());
+	obs_data_set_int(data, "average_frame_time_ns", (long long)obs_get_average_frame_time_ns());
+	obs_data_set_int(data, "total_frames", obs_get_total_frames());
+	obs_data_set_int(data, "lagged_frames", obs_get_lagged_frames());
+	obs_data_set_int(data, "encoded_frames", video_output_get_total_frames(obs_get_video()));
+	obs_data_set_int(data, "skipped_frames", video_output_get_skipped_frames(obs_get_video()));
+	obs_data_set_double(data, "cpu_usage", os_cpu_usage_info_query(cpu_info));
+	obs_data_set_int(data, "memory_usage", (long long)os_get_proc_resident_size());
+	obs_data_set_int(data, "gpu_memory_usage", (long long)gpuUsage.total);
+	obs_data_set_int(data, "gpu_memory_budget", (long long)gpuUsage.budget);
+	obs_data_set_int(data, "audio_buffering_ms", obs_get_audio_buffering_ms());
+	obs_data_set_int(data, "monitoring_latency_ns", (long long)obs_get_audio_monitoring_latency());
+	obs_data_set_int(data, "output_buffered_bytes", (long long)obs_get_output_buffered_bytes());
+	obs_data_set_int(data, "preview_gpu_time_ns", (long long)OBSBasic::Get()->GetPreviewGPUTimeNs());
+
+	AddFrameTiming(data);
+	AddOutputs(data);
+	AddEncoders(data);
+
+	bool traced = opt_trace_history && profiler_trace_dump_json(tracePath);
+	if (traced)
+		obs_data_set_string(data, "trace", tracePath);
+
+	if (!obs_data_save_json_pretty_safe(data, path, "tmp", nullptr)) {
+		blog(LOG_WARNING, "Could not save diagnostics snapshot to '%s'", static_cast<const char *>(path));
+		OBSMessageBox::warning(this, QTStr("Basic.Stats.ExportDiagnostics"),
+				       QTStr("Basic.Stats.ExportDiagnostics.Failed"));
+		return;
+	}
+
+	blog(LOG_INFO, "Saved diagnostics snapshot to '%s'", static_cast<const char *>(path));
+
+	QString text = QTStr("Basic.Stats.ExportDiagnostics.Saved").arg(QT_UTF8(static_cast<const char *>(path)));
+	if (!traced)
+		text += "\n\n" + QTStr("Basic.Stats.ExportDiagnostics.NoTrace");
+	OBSMessageBox::information(this, QTStr("Basic.Stats.ExportDiagnostics"), text);
+}
+
 void OBSBasicStats::Reset()
 {
 	timer.start();
@@ -517,16 +1061,11 @@ void OBSBasicStats::OutputLabels::Update(obs_output_t *output, bool rec)
 	status->setText(str);
 	setClasses(status, styling);
 
-	long double num = (long double)totalBytes / (1024.0l * 1024.0l);
-	const char *unit = "MiB";
-	if (num > 1024) {
-		num /= 1024;
-		unit = "GiB";
-	}
-	megabytesSent->setText(QString("%1 %2").arg(num, 0, 'f', 1).arg(unit));
+	megabytesSent->setText(MakeBytesText(totalBytes));
+	buffered->setText(active ? MakeBytesText(obs_output_get_buffered_bytes(output)) : QStringLiteral("-"));
 
-	num = kbps;
-	unit = "kb/s";
+	long double num = kbps;
+	const char *unit = "kb/s";
 	if (num >= 10'000) {
 		num /= 1000;
 		unit = "Mb/s";
@@ -574,10 +1113,26 @@ void OBSBasicStats::OutputLabels::Reset(obs_output_t *output)
 
 void OBSBasicStats::showEvent(QShowEvent *)
 {
+	if (!gpuTimingActive) {
+		gpuTimingActive = true;
+		if (gpuTimingUsers++ == 0)
+			obs_enable_video_frame_timing_gpu(true);
+	}
+
 	timer.start(TIMER_INTERVAL);
 }
 
 void OBSBasicStats::hideEvent(QHideEvent *)
 {
+	StopGPUTiming();
 	timer.stop();
 }
+
+void OBSBasicStats::StopGPUTiming()
+{
+	if (gpuTimingActive) {
+		gpuTimingActive = false;
+		if (--gpuTimingUsers == 0)
+			obs_enable_video_frame_timing_gpu(false);
+	}
+}
@@ -19,11 +19,19 @@ class OBSBasicStats : public QFrame {
 	QLabel *hddSpace = nullptr;
 	QLabel *recordTimeLeft = nullptr;
 	QLabel *memUsage = nullptr;
+	QLabel *gpuMemUsage = nullptr;
+	QLabel *diskWriteRate = nullptr;
 
 	QLabel *renderTime = nullptr;
+	QLabel *previewGPUTime = nullptr;
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
+	QLabel *monitoringLatency = nullptr;
 
+	QGridLayout *timingLayout = nullptr;
+	QLabel *stageTimes[OBS_FRAME_TIMING_STAGE_COUNT][2] = {};
+
+	QGridLayout *encoderLayout = nullptr;
 	QGridLayout *outputLayout = nullptr;
 
 	os_cpu_usage_info_t *cpu_info = nullptr;
@@ -33,12 +41,20 @@ class OBSBasicStats : public QFrame {
 	uint64_t num_bytes = 0;
 	std::vector<long double> bitrates;
 
+	uint64_t lastDiskBytes = 0;
+	uint64_t lastDiskTime = 0;
+	long double diskBytesPerSec = 0.0l;
+
+	bool gpuTimingActive = false;
+	void StopGPUTiming();
+
 	struct OutputLabels {
 		QPointer<QLabel> name;
 		QPointer<QLabel> status;
 		QPointer<QLabel> droppedFrames;
 		QPointer<QLabel> megabytesSent;
 		QPointer<QLabel> bitrate;
+		QPointer<QLabel> buffered;
 
 		uint64_t lastBytesSent = 0;
 		uint64_t lastBytesSentTime = 0;
@@ -54,7 +70,23 @@ class OBSBasicStats : public QFrame {
 
 	QList<OutputLabels> outputLabels;
 
+	struct EncoderLabels {
+		std::string name;
+		QPointer<QLabel> nameLabel;
+		QPointer<QLabel> encodeTime;
+		QPointer<QLabel> latency;
+		QPointer<QLabel> queue;
+		QPointer<QLabel> bitrate;
+
+		void Update(obs_encoder_t *encoder);
+	};
+
+	std::vector<EncoderLabels> encoderLabels;
+
 	void AddOutputLabels(QString name);
+	void UpdateFrameTiming();
+	void UpdateDiskWriteRate(obs_output_t *recOutput);
+	void UpdateEncoders();
 	void Update();
 
 	virtual void closeEvent(QCloseEvent *event) override;
@@ -75,6 +107,7 @@ private:
 
 private slots:
 	void RecordingTimeLeft();
+	void ExportDiagnostics();
 
 public slots:
 	void Reset();
@@ -100,22 +100,25 @@ void OBSBasic::ManageExtraBrowserDocks()
 	extraBrowsers->show();
 }
 
-void OBSBasic::AddExtraBrowserDock(const QString &title, const QString &url, const QString &uuid, bool firstCreate)
+void OBSBasic::CreateExtraBrowserWidget(BrowserDock *dock)
 {
 	static int panel_version = -1;
 	if (panel_version == -1) {
 		panel_version = obs_browser_qcef_version();
 	}
 
-	BrowserDock *dock = new BrowserDock(title);
-	QString bId(uuid.isEmpty() ? QUuid::createUuid().toString() : uuid);
-	bId.replace(QRegularExpression("[{}-]"), "");
-	dock->setProperty("uuid", bId);
-	dock->setObjectName(title + OBJ_NAME_SUFFIX);
-	dock->resize(460, 600);
-	dock->setMinimumSize(80, 80);
-	dock->setWindowTitle(title);
-	dock->setAllowedAreas(Qt::AllDockWidgetAreas);
+	int idx = -1;
+	for (int i = 0; i < extraBrowserDocks.size(); i++) {
+		if (extraBrowserDocks[i].get() == dock) {
+			idx = i;
+			break;
+		}
+	}
+
+	if (idx == -1)
+		return;
+
+	const QString &url = extraBrowserDockTargets[idx];
 
 	QCefWidget *browser = cef->create_widget(dock, QT_TO_UTF8(url), nullptr);
 	if (browser && panel_version >= 1)
@@ -138,6 +141,19 @@ void OBSBasic::AddExtraBrowserDock(const QString &title, const QString &url, con
 			browser->setStartupScript(script);
 		}
 	}
+}
+
+void OBSBasic::AddExtraBrowserDock(const QString &title, const QString &url, const QString &uuid, bool firstCreate)
+{
+	BrowserDock *dock = new BrowserDock(title);
+	QString bId(uuid.isEmpty() ? QUuid::createUuid().toString() : uuid);
+	bId.replace(QRegularExpression("[{}-]"), "");
+	dock->setProperty("uuid", bId);
+	dock->setObjectName(title + OBJ_NAME_SUFFIX);
+	dock->resize(460, 600);
+	dock->setMinimumSize(80, 80);
+	dock->setWindowTitle(title);
+	dock->setAllowedAreas(Qt::AllDockWidgetAreas);
 
 	AddDockWidget(dock, Qt::RightDockWidgetArea, true);
 	extraBrowserDocks.push_back(std::shared_ptr<QDockWidget>(dock));
@@ -145,6 +161,8 @@ void OBSBasic::AddExtraBrowserDock(const QString &title, const QString &url, con
 	extraBrowserDockTargets.push_back(url);
 
 	if (firstCreate) {
+		CreateExtraBrowserWidget(dock);
+
 		dock->setFloating(true);
 
 		QPoint curPos = pos();
@@ -156,6 +174,10 @@ void OBSBasic::AddExtraBrowserDock(const QString &title, const QString &url, con
 
 		dock->move(curPos);
 		dock->setVisible(true);
+	} else {
+		/* docks restored at startup only load their page once they're
+		 * shown, so hidden and tabbed away panels don't slow it down */
+		dock->SetDeferredWidget([this, dock]() { CreateExtraBrowserWidget(dock); });
 	}
 }
 #endif
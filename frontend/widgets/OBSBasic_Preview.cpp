@@ -26,6 +26,8 @@
 
 #include <QColorDialog>
 
+#include <algorithm>
+
 #include <sstream>
 
 extern void undo_redo(const std::string &data);
@@ -128,6 +130,82 @@ void OBSBasic::DrawBackdrop(float cx, float cy)
 	GS_DEBUG_MARKER_END();
 }
 
+void OBSBasic::DrawPreviewContent(float cx, float cy)
+{
+	if (IsPreviewProgramMode()) {
+		DrawBackdrop(cx, cy);
+
+		OBSScene scene = GetCurrentScene();
+		obs_source_t *source = obs_scene_get_source(scene);
+		if (source)
+			obs_source_video_render(source);
+	} else {
+		obs_render_main_texture_src_color_only();
+	}
+	gs_load_vertexbuffer(nullptr);
+}
+
+void OBSBasic::DrawCachedPreview(float cx, float cy)
+{
+	/* no point in a cache bigger than the canvas */
+	uint32_t texCX = std::min((uint32_t)previewCX, (uint32_t)cx);
+	uint32_t texCY = std::min((uint32_t)previewCY, (uint32_t)cy);
+	enum gs_color_space space = gs_get_color_space();
+	uint64_t now = os_gettime_ns();
+
+	if (!texCX || !texCY)
+		return;
+
+	if (previewCache && previewCacheSpace != space) {
+		gs_texrender_destroy(previewCache);
+		previewCache = nullptr;
+	}
+	if (!previewCache) {
+		previewCache = gs_texrender_create(gs_get_format_from_space(space), GS_ZS_NONE);
+		previewCacheSpace = space;
+		previewCacheTime = 0;
+	}
+
+	/* editing stays live so dragging items doesn't stutter */
+	bool stale = !previewCacheTime || now - previewCacheTime >= previewInterval || ui->preview->IsEditing();
+
+	if (stale || texCX != previewCacheCX || texCY != previewCacheCY) {
+		gs_texrender_reset(previewCache);
+		if (gs_texrender_begin_with_color_space(previewCache, texCX, texCY, space)) {
+			vec4 clear_color;
+			vec4_zero(&clear_color);
+
+			gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+			gs_ortho(0.0f, cx, 0.0f, cy, -100.0f, 100.0f);
+			DrawPreviewContent(cx, cy);
+			gs_texrender_end(previewCache);
+		}
+
+		previewCacheCX = texCX;
+		previewCacheCY = texCY;
+		previewCacheTime = now;
+	}
+
+	gs_texture_t *tex = gs_texrender_get_texture(previewCache);
+	if (!tex)
+		return;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_set_texture_srgb(image, tex);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, (uint32_t)cx, (uint32_t)cy);
+	gs_blend_state_pop();
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 void OBSBasic::RenderMain(void *data, uint32_t, uint32_t)
 {
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DEFAULT, "RenderMain");
@@ -137,6 +215,8 @@ void OBSBasic::RenderMain(void *data, uint32_t, uint32_t)
 
 	obs_get_video_info(&ovi);
 
+	window->previewGPUTimer.Begin();
+
 	window->previewCX = int(window->previewScale * float(ovi.base_width));
 	window->previewCY = int(window->previewScale * float(ovi.base_height));
 
@@ -158,17 +238,10 @@ void OBSBasic::RenderMain(void *data, uint32_t, uint32_t)
 	gs_ortho(0.0f, float(ovi.base_width), 0.0f, float(ovi.base_height), -100.0f, 100.0f);
 	gs_set_viewport(window->previewX, window->previewY, window->previewCX, window->previewCY);
 
-	if (window->IsPreviewProgramMode()) {
-		window->DrawBackdrop(float(ovi.base_width), float(ovi.base_height));
-
-		OBSScene scene = window->GetCurrentScene();
-		obs_source_t *source = obs_scene_get_source(scene);
-		if (source)
-			obs_source_video_render(source);
-	} else {
-		obs_render_main_texture_src_color_only();
-	}
-	gs_load_vertexbuffer(nullptr);
+	if (window->previewInterval)
+		window->DrawCachedPreview(float(ovi.base_width), float(ovi.base_height));
+	else
+		window->DrawPreviewContent(float(ovi.base_width), float(ovi.base_height));
 
 	/* --------------------------------------- */
 
@@ -197,6 +270,8 @@ void OBSBasic::RenderMain(void *data, uint32_t, uint32_t)
 	gs_projection_pop();
 	gs_viewport_pop();
 
+	window->previewGPUTimer.End();
+
 	GS_DEBUG_MARKER_END();
 }
 
@@ -621,6 +696,12 @@ void OBSBasic::UpdatePreviewSpacingHelpers()
 	drawSpacingHelpers = config_get_bool(App()->GetUserConfig(), "BasicWindow", "SpacingHelpersEnabled");
 }
 
+void OBSBasic::UpdatePreviewFrameRate()
+{
+	int fps = (int)config_get_int(App()->GetUserConfig(), "BasicWindow", "PreviewFPS");
+	previewInterval = fps > 0 ? 1000000000ULL / uint64_t(fps) : 0;
+}
+
 float OBSBasic::GetDevicePixelRatio()
 {
 	return dpi;
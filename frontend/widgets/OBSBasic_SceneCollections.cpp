@@ -22,10 +22,12 @@
 #include <utility/item-widget-helpers.hpp>
 
 #include <qt-wrappers.hpp>
+#include <util/platform.h>
 
 #include <QDir>
 
 #include <filesystem>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -217,6 +219,8 @@ const OBSSceneCollection &OBSBasic::CreateSceneCollection(const std::string &col
 
 void OBSBasic::RemoveSceneCollection(OBSSceneCollection collection)
 {
+	saveWorker.Wait();
+
 	try {
 		std::filesystem::remove(collection.collectionFile);
 	} catch (const std::filesystem::filesystem_error &error) {
@@ -814,7 +818,7 @@ static obs_data_t *GenerateSaveData(obs_data_array_t *sceneOrder, obs_data_array
 	return saveData;
 }
 
-void OBSBasic::Save(const char *file)
+void OBSBasic::Save(const char *file, bool async)
 {
 	OBSScene scene = GetCurrentScene();
 	OBSSource curProgramScene = OBSGetStrongRef(programScene);
@@ -878,6 +882,15 @@ void OBSBasic::Save(const char *file)
 		obs_data_set_obj(saveData, "migration_resolution", res);
 	}
 
+	/* building the data has to happen here, but serializing and writing
+	 * it out can be left to the save thread */
+	if (async) {
+		saveWorker.Queue(saveData, file);
+		return;
+	}
+
+	saveWorker.Wait();
+
 	if (!obs_data_save_json_pretty_safe(saveData, file, "tmp", "bak"))
 		blog(LOG_ERROR, "Could not save scene data to %s", file);
 }
@@ -1028,11 +1041,21 @@ void OBSBasic::LogScenes()
 
 void OBSBasic::Load(const char *file, bool remigrate)
 {
+	saveWorker.Wait();
+
 	disableSaving++;
 	lastOutputResolution.reset();
 	migrationBaseResolution.reset();
 
-	obs_data_t *data = obs_data_create_from_json_file_safe(file, "bak");
+	/* parse the next collection while the current one is torn down, the
+	 * old sources finish destroying in the background where that's safe */
+	std::future<obs_data_t *> parsed = std::async(std::launch::async, [path = string(file)]() {
+		return obs_data_create_from_json_file_safe(path.c_str(), "bak");
+	});
+
+	ClearSceneData(false);
+
+	obs_data_t *data = parsed.get();
 	if (!data) {
 		disableSaving--;
 		const auto path = filesystem::u8path(file);
@@ -1099,7 +1122,6 @@ static void ClearRelativePosCb(obs_data_t *data, void *)
 
 void OBSBasic::LoadData(obs_data_t *data, const char *file, bool remigrate)
 {
-	ClearSceneData();
 	ClearContextBar();
 
 	/* Exit OBS if clearing scene data failed for some reason. */
@@ -1226,7 +1248,12 @@ void OBSBasic::LoadData(obs_data_t *data, const char *file, bool remigrate)
 	DisableRelativeCoordinates(disableRelativeCoords);
 
 	obs_missing_files_t *files = obs_missing_files_create();
+
+	/* inputs of scenes that aren't shown are only created once they're
+	 * needed, or when they're prewarmed as part of a neighboring scene */
+	obs_set_lazy_source_creation(config_get_bool(App()->GetUserConfig(), "General", "LazySourceLoading"));
 	obs_load_sources(sources, AddMissingFiles, files);
+	obs_set_lazy_source_creation(false);
 
 	if (resetVideo)
 		ResetVideo();
@@ -1393,11 +1420,13 @@ retryScene:
 
 void OBSBasic::SaveProjectNow()
 {
-	if (disableSaving)
+	if (disableSaving) {
+		saveWorker.Wait();
 		return;
+	}
 
 	projectChanged = true;
-	SaveProjectDeferred();
+	SaveCurrentSceneCollection(false);
 }
 
 void OBSBasic::SaveProject()
@@ -1410,6 +1439,11 @@ void OBSBasic::SaveProject()
 }
 
 void OBSBasic::SaveProjectDeferred()
+{
+	SaveCurrentSceneCollection(true);
+}
+
+void OBSBasic::SaveCurrentSceneCollection(bool async)
 {
 	if (disableSaving)
 		return;
@@ -1422,13 +1456,48 @@ void OBSBasic::SaveProjectDeferred()
 	try {
 		const OBSSceneCollection &currentCollection = GetCurrentSceneCollection();
 
-		Save(currentCollection.collectionFile.u8string().c_str());
+		Save(currentCollection.collectionFile.u8string().c_str(), async);
 	} catch (const std::invalid_argument &error) {
 		blog(LOG_ERROR, "%s", error.what());
 	}
 }
 
-void OBSBasic::ClearSceneData()
+/* capture devices can usually only be opened by one source at a time, so
+ * they have to be fully destroyed before the next collection opens them */
+static bool HasExclusiveSource(void *param, obs_source_t *source)
+{
+	uint32_t flags = obs_source_get_output_flags(source);
+
+	if ((flags & OBS_SOURCE_DO_NOT_DUPLICATE) && (flags & OBS_SOURCE_VIDEO) &&
+	    !(flags & OBS_SOURCE_CONTROLLABLE_MEDIA)) {
+		*static_cast<bool *>(param) = true;
+		return false;
+	}
+
+	return true;
+}
+
+/* Only waits until the names of the old sources are free again.  Scenes
+ * release their items' sources from their own destroy task, so this is
+ * reached once the old scenes are gone, while the destroy callbacks of the
+ * inputs can keep running on the destroy thread.  Returns false if it timed
+ * out, which only happens if something is still holding a reference. */
+static bool WaitForSourceNames()
+{
+	const uint64_t timeout = os_gettime_ns() + 5000000000ULL;
+
+	do {
+		QApplication::sendPostedEvents(nullptr);
+		if (!obs_has_public_sources())
+			return true;
+
+		os_sleep_ms(1);
+	} while (os_gettime_ns() < timeout);
+
+	return false;
+}
+
+void OBSBasic::ClearSceneData(bool waitForDestroy)
 {
 	disableSaving++;
 
@@ -1469,6 +1538,9 @@ void OBSBasic::ClearSceneData()
 		return true;
 	};
 
+	if (!waitForDestroy)
+		obs_enum_sources(HasExclusiveSource, &waitForDestroy);
+
 	obs_enum_scenes(cb, nullptr);
 	obs_enum_sources(cb, nullptr);
 
@@ -1480,9 +1552,11 @@ void OBSBasic::ClearSceneData()
 	 * that deleteLater events are processed at this point */
 	QApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
 
-	do {
-		QApplication::sendPostedEvents(nullptr);
-	} while (obs_wait_for_destroy_queue());
+	if (waitForDestroy || !WaitForSourceNames()) {
+		do {
+			QApplication::sendPostedEvents(nullptr);
+		} while (obs_wait_for_destroy_queue());
+	}
 
 	/* Pump Qt events one final time to give remaining signals time to be
 	 * processed (since this happens after the destroy thread finishes and
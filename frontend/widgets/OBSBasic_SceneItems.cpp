@@ -1109,11 +1109,9 @@ void OBSBasic::on_actionRotate90CW_triggered()
 	obs_scene_enum_items(GetCurrentScene(), RotateSelectedSources, &f90CW);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.Rotate").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionRotate90CCW_triggered()
@@ -1123,11 +1121,9 @@ void OBSBasic::on_actionRotate90CCW_triggered()
 	obs_scene_enum_items(GetCurrentScene(), RotateSelectedSources, &f90CCW);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.Rotate").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionRotate180_triggered()
@@ -1137,11 +1133,9 @@ void OBSBasic::on_actionRotate180_triggered()
 	obs_scene_enum_items(GetCurrentScene(), RotateSelectedSources, &f180);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.Rotate").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 static bool MultiplySelectedItemScale(obs_scene_t * /* scene */, obs_sceneitem_t *item, void *param)
@@ -1177,11 +1171,9 @@ void OBSBasic::on_actionFlipHorizontal_triggered()
 	obs_scene_enum_items(GetCurrentScene(), MultiplySelectedItemScale, &scale);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.HFlip").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionFlipVertical_triggered()
@@ -1192,11 +1184,9 @@ void OBSBasic::on_actionFlipVertical_triggered()
 	obs_scene_enum_items(GetCurrentScene(), MultiplySelectedItemScale, &scale);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.VFlip").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 static bool CenterAlignSelectedItems(obs_scene_t * /* scene */, obs_sceneitem_t *item, void *param)
@@ -1236,11 +1226,9 @@ void OBSBasic::on_actionFitToScreen_triggered()
 	obs_scene_enum_items(GetCurrentScene(), CenterAlignSelectedItems, &boundsType);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.FitToScreen").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionStretchToScreen_triggered()
@@ -1250,11 +1238,9 @@ void OBSBasic::on_actionStretchToScreen_triggered()
 	obs_scene_enum_items(GetCurrentScene(), CenterAlignSelectedItems, &boundsType);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(QTStr("Undo.Transform.StretchToScreen")
 				  .arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-			  undo_redo, undo_redo, undo_data, redo_data);
+			  undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::CenterSelectedSceneItems(const CenterType &centerType)
@@ -1347,11 +1333,9 @@ void OBSBasic::on_actionCenterToScreen_triggered()
 	CenterSelectedSceneItems(centerType);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.Center").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionVerticalCenter_triggered()
@@ -1361,11 +1345,9 @@ void OBSBasic::on_actionVerticalCenter_triggered()
 	CenterSelectedSceneItems(centerType);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.VCenter").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_actionHorizontalCenter_triggered()
@@ -1375,11 +1357,9 @@ void OBSBasic::on_actionHorizontalCenter_triggered()
 	CenterSelectedSceneItems(centerType);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(GetCurrentScene(), false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(
 		QTStr("Undo.Transform.HCenter").arg(obs_source_get_name(obs_scene_get_source(GetCurrentScene()))),
-		undo_redo, undo_redo, undo_data, redo_data);
+		undo_redo, undo_redo, wrapper, rwrapper);
 }
 
 void OBSBasic::on_toggleSourceIcons_toggled(bool visible)
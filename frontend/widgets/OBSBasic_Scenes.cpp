@@ -25,6 +25,7 @@
 #include <qt-wrappers.hpp>
 
 #include <QLineEdit>
+#include <QTimer>
 #include <QWidgetAction>
 
 #include <vector>
@@ -89,6 +90,63 @@ OBSScene OBSBasic::GetCurrentScene()
 	return currentScene.load();
 }
 
+/* spread out so creating heavy sources doesn't stall the UI */
+#define PREWARM_INTERVAL_MS 50
+
+static bool QueueLazySources(obs_scene_t *, obs_sceneitem_t *item, void *param)
+{
+	auto queue = static_cast<deque<OBSWeakSource> *>(param);
+	obs_source_t *source = obs_sceneitem_get_source(item);
+
+	if (!obs_source_instantiated(source))
+		queue->push_back(OBSGetWeakRef(source));
+
+	if (obs_sceneitem_is_group(item))
+		obs_sceneitem_group_enum_items(item, QueueLazySources, param);
+	else if (obs_scene_t *nested = obs_scene_from_source(source))
+		obs_scene_enum_items(nested, QueueLazySources, param);
+
+	return true;
+}
+
+void OBSBasic::PrewarmAdjacentScenes()
+{
+	if (!config_get_bool(App()->GetUserConfig(), "General", "LazySourceLoading"))
+		return;
+
+	bool idle = prewarmSources.empty();
+	int row = ui->scenes->currentRow();
+
+	prewarmSources.clear();
+
+	for (int adjacent : {row + 1, row - 1}) {
+		QListWidgetItem *item = ui->scenes->item(adjacent);
+		if (!item)
+			continue;
+
+		OBSScene scene = GetOBSRef<OBSScene>(item);
+		obs_scene_enum_items(scene, QueueLazySources, &prewarmSources);
+	}
+
+	if (idle && !prewarmSources.empty())
+		QTimer::singleShot(PREWARM_INTERVAL_MS, this, &OBSBasic::PrewarmNextSource);
+}
+
+void OBSBasic::PrewarmNextSource()
+{
+	if (prewarmSources.empty())
+		return;
+
+	OBSSourceAutoRelease source = obs_weak_source_get_source(prewarmSources.front());
+	prewarmSources.pop_front();
+
+	if (source)
+		obs_source_instantiate(source);
+
+	if (!prewarmSources.empty())
+		QTimer::singleShot(PREWARM_INTERVAL_MS, this, &OBSBasic::PrewarmNextSource);
+}
+
 void OBSBasic::AddScene(OBSSource source)
 {
 	const char *name = obs_source_get_name(source);
@@ -939,10 +997,8 @@ void OBSBasic::on_actionResetTransform_triggered()
 	obs_scene_enum_items(scene, reset_tr, nullptr);
 	OBSDataAutoRelease rwrapper = obs_scene_save_transform_states(scene, false);
 
-	std::string undo_data(obs_data_get_json(wrapper));
-	std::string redo_data(obs_data_get_json(rwrapper));
 	undo_s.add_action(QTStr("Undo.Transform.Reset").arg(obs_source_get_name(obs_scene_get_source(scene))),
-			  undo_redo, undo_redo, undo_data, redo_data);
+			  undo_redo, undo_redo, wrapper, rwrapper);
 
 	obs_scene_enum_items(GetCurrentScene(), reset_tr, nullptr);
 }
@@ -950,16 +1006,14 @@ void OBSBasic::on_actionResetTransform_triggered()
 SourceTreeItem *OBSBasic::GetItemWidgetFromSceneItem(obs_sceneitem_t *sceneItem)
 {
 	int i = 0;
-	SourceTreeItem *treeItem = ui->sources->GetItemWidget(i);
 	OBSSceneItem item = ui->sources->Get(i);
 	int64_t id = obs_sceneitem_get_id(sceneItem);
-	while (treeItem && obs_sceneitem_get_id(item) != id) {
+	while (item && obs_sceneitem_get_id(item) != id) {
 		i++;
-		treeItem = ui->sources->GetItemWidget(i);
 		item = ui->sources->Get(i);
 	}
-	if (treeItem)
-		return treeItem;
+	if (item)
+		return ui->sources->GetItemWidget(i);
 
 	return nullptr;
 }
@@ -21,15 +21,27 @@
 
 #include <qt-wrappers.hpp>
 
+#include <algorithm>
+
+#define MAX_PENDING_SCREENSHOTS 8
+
 void OBSBasic::Screenshot(OBSSource source)
 {
-	if (!!screenshotData) {
+	auto finished = [](const QPointer<QObject> &screenshot) {
+		return screenshot.isNull();
+	};
+	screenshotData.erase(std::remove_if(screenshotData.begin(), screenshotData.end(), finished),
+			     screenshotData.end());
+
+	/* screenshots requested together are rendered and read back in the
+	 * same frames, each one is encoded on its own thread */
+	if (screenshotData.size() >= MAX_PENDING_SCREENSHOTS) {
 		blog(LOG_WARNING, "Cannot take new screenshot, "
-				  "screenshot currently in progress");
+				  "too many screenshots currently in progress");
 		return;
 	}
 
-	screenshotData = new ScreenshotObj(source);
+	screenshotData.emplace_back(new ScreenshotObj(source));
 }
 
 void OBSBasic::ScreenshotSelectedSource()
@@ -636,6 +636,7 @@ void OBSBasic::SetCurrentScene(OBSSource scene, bool force)
 
 	UpdateContextBar(true);
 	UpdatePreviewProgramIndicators();
+	PrewarmAdjacentScenes();
 
 	if (scene) {
 		bool userSwitched = (!force && !disableSaving);
@@ -314,7 +314,9 @@ void OBSProjector::UpdateMultiview()
 
 	transitionOnDoubleClick = config_get_bool(App()->GetUserConfig(), "BasicWindow", "TransitionOnDoubleClick");
 
-	multiview->Update(multiviewLayout, drawLabel, drawSafeArea);
+	int thumbnailFPS = (int)config_get_int(App()->GetUserConfig(), "BasicWindow", "MultiviewThumbnailFPS");
+
+	multiview->Update(multiviewLayout, drawLabel, drawSafeArea, thumbnailFPS);
 }
 
 void OBSProjector::UpdateProjectorTitle(QString name)
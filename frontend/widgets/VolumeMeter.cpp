@@ -215,6 +215,7 @@ QColor VolumeMeter::getMajorTickColor() const
 void VolumeMeter::setMajorTickColor(QColor c)
 {
 	majorTickColor = std::move(c);
+	ticksPixmap = QPixmap();
 }
 
 QColor VolumeMeter::getMinorTickColor() const
@@ -225,6 +226,7 @@ QColor VolumeMeter::getMinorTickColor() const
 void VolumeMeter::setMinorTickColor(QColor c)
 {
 	minorTickColor = std::move(c);
+	ticksPixmap = QPixmap();
 }
 
 int VolumeMeter::getMeterThickness() const
@@ -257,6 +259,7 @@ qreal VolumeMeter::getMinimumLevel() const
 void VolumeMeter::setMinimumLevel(qreal v)
 {
 	minimumLevel = v;
+	ticksPixmap = QPixmap();
 }
 
 qreal VolumeMeter::getWarningLevel() const
@@ -459,6 +462,39 @@ void VolumeMeter::setLevels(const float magnitude[MAX_AUDIO_CHANNELS], const flo
 	calculateBallistics(ts);
 }
 
+bool VolumeMeter::pollLevels()
+{
+	struct obs_volmeter_levels levels;
+
+	if (!obs_volmeter || !obs_volmeter_get_levels(obs_volmeter, &levels))
+		return false;
+
+	setLevels(levels.magnitude, levels.peak, levels.input_peak);
+	return true;
+}
+
+void VolumeMeter::pause()
+{
+	paused = true;
+}
+
+// Returns true if the meter was paused.  The peaks collected while it was
+// hidden are stale, so they're dropped instead of shown.
+bool VolumeMeter::resume()
+{
+	if (!paused)
+		return false;
+
+	struct obs_volmeter_levels levels;
+	if (obs_volmeter)
+		obs_volmeter_get_levels(obs_volmeter, &levels);
+
+	QMutexLocker locker(&dataMutex);
+	resetLevels();
+	paused = false;
+	return true;
+}
+
 inline void VolumeMeter::resetLevels()
 {
 	currentLastUpdateTime = 0;
@@ -526,6 +562,7 @@ inline void VolumeMeter::doLayout()
 		setMinimumSize(100, displayNrAudioChannels * (meterThickness + 1) - 1 + 4 + metrics.capHeight());
 	}
 
+	ticksPixmap = QPixmap();
 	resetLevels();
 }
 
@@ -889,13 +926,7 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 		if (needLayoutChange())
 			doLayout();
 
-		if (vertical) {
-			paintVTicks(painter, displayNrAudioChannels * (meterThickness + 1) - 1, 0,
-				    height - (INDICATOR_THICKNESS + 3));
-		} else {
-			paintHTicks(painter, INDICATOR_THICKNESS + 3, displayNrAudioChannels * (meterThickness + 1) - 1,
-				    width - (INDICATOR_THICKNESS + 3));
-		}
+		painter.drawPixmap(0, 0, getTicksPixmap(width, height));
 	}
 
 	if (vertical) {
@@ -934,6 +965,30 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 	lastRedrawTime = ts;
 }
 
+const QPixmap &VolumeMeter::getTicksPixmap(int width, int height)
+{
+	qreal dpr = devicePixelRatioF();
+	QSize size = rect().size() * dpr;
+
+	if (!ticksPixmap.isNull() && ticksPixmap.size() == size && ticksPixmap.devicePixelRatio() == dpr)
+		return ticksPixmap;
+
+	ticksPixmap = QPixmap(size);
+	ticksPixmap.setDevicePixelRatio(dpr);
+	ticksPixmap.fill(Qt::transparent);
+
+	QPainter painter(&ticksPixmap);
+	if (vertical) {
+		paintVTicks(painter, displayNrAudioChannels * (meterThickness + 1) - 1, 0,
+			    height - (INDICATOR_THICKNESS + 3));
+	} else {
+		paintHTicks(painter, INDICATOR_THICKNESS + 3, displayNrAudioChannels * (meterThickness + 1) - 1,
+			    width - (INDICATOR_THICKNESS + 3));
+	}
+
+	return ticksPixmap;
+}
+
 QRect VolumeMeter::getBarRect() const
 {
 	QRect rec = rect();
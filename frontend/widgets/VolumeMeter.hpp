@@ -3,6 +3,7 @@
 #include <obs.hpp>
 
 #include <QMutex>
+#include <QPixmap>
 #include <QWidget>
 
 #define FADER_PRECISION 4096.0
@@ -84,6 +85,7 @@ private:
 	void paintVMeter(QPainter &painter, int x, int y, int width, int height, float magnitude, float peak,
 			 float peakHold);
 	void paintVTicks(QPainter &painter, int x, int y, int height);
+	const QPixmap &getTicksPixmap(int width, int height);
 
 	QMutex dataMutex;
 
@@ -141,7 +143,12 @@ private:
 	QColor p_foregroundWarningColor;
 	QColor p_foregroundErrorColor;
 
+	// The scale only changes with the layout, so it is drawn once into
+	// this and copied on full repaints
+	QPixmap ticksPixmap;
+
 	uint64_t lastRedrawTime = 0;
+	bool paused = false;
 	int channels = 0;
 	bool clipping = false;
 	bool vertical;
@@ -153,6 +160,10 @@ public:
 
 	void setLevels(const float magnitude[MAX_AUDIO_CHANNELS], const float peak[MAX_AUDIO_CHANNELS],
 		       const float inputPeak[MAX_AUDIO_CHANNELS]);
+	bool pollLevels();
+	void pause();
+	bool resume();
+	inline bool isIdle() const { return currentLastUpdateTime == 0; }
 	QRect getBarRect() const;
 	bool needLayoutChange();
 
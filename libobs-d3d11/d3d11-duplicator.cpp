@@ -16,6 +16,8 @@
 ******************************************************************************/
 
 #include "d3d11-subsystem.hpp"
+#include <util/util_uint64.h>
+#include <algorithm>
 #include <unordered_map>
 
 // Window class name for the display window
@@ -86,6 +88,10 @@ void gs_duplicator::Start()
 	if (!get_monitor(device, idx, output.Assign()))
 		throw "Invalid monitor index";
 
+	DXGI_OUTPUT_DESC output_desc;
+	if (SUCCEEDED(output->GetDesc(&output_desc)))
+		rotation = output_desc.Rotation;
+
 	hr = output->QueryInterface(IID_PPV_ARGS(output5.Assign()));
 	hdr = false;
 	sdr_white_nits = 80.f;
@@ -418,12 +424,81 @@ EXPORT void gs_duplicator_destroy(gs_duplicator_t *duplicator)
 	}
 }
 
-static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
+/* above this share of the screen a single CopyResource beats the per
+ * rectangle copies */
+#define MAX_PARTIAL_COPY_AREA 0.5
+
+/* copies the rectangles changed since the last frame, moved areas are
+ * already in place in the frame, so their destinations are copied like
+ * dirty rects.  returns false if the whole frame has to be copied */
+static bool copy_dirty_rects(gs_duplicator_t *d, ID3D11Texture2D *tex, const DXGI_OUTDUPL_FRAME_INFO &info)
+{
+	HRESULT hr;
+
+	/* rects are in desktop space, the frame is in scanout orientation */
+	if (d->rotation != DXGI_MODE_ROTATION_IDENTITY && d->rotation != DXGI_MODE_ROTATION_UNSPECIFIED)
+		return false;
+	if (!info.TotalMetadataBufferSize)
+		return false;
+
+	d->metadata.resize(info.TotalMetadataBufferSize);
+	BYTE *buffer = d->metadata.data();
+	UINT move_size = 0;
+	UINT dirty_size = 0;
+
+	hr = d->duplicator->GetFrameMoveRects(info.TotalMetadataBufferSize, (DXGI_OUTDUPL_MOVE_RECT *)buffer,
+					      &move_size);
+	if (FAILED(hr))
+		return false;
+
+	hr = d->duplicator->GetFrameDirtyRects(info.TotalMetadataBufferSize - move_size, (RECT *)(buffer + move_size),
+					       &dirty_size);
+	if (FAILED(hr))
+		return false;
+
+	const DXGI_OUTDUPL_MOVE_RECT *moves = (const DXGI_OUTDUPL_MOVE_RECT *)buffer;
+	const RECT *dirty = (const RECT *)(buffer + move_size);
+	const size_t move_count = move_size / sizeof(*moves);
+	const size_t dirty_count = dirty_size / sizeof(*dirty);
+
+	const LONG width = (LONG)d->texture->width;
+	const LONG height = (LONG)d->texture->height;
+	uint64_t area = 0;
+
+	d->copy_rects.clear();
+	for (size_t i = 0; i < move_count + dirty_count; i++) {
+		RECT rect = i < move_count ? moves[i].DestinationRect : dirty[i - move_count];
+
+		rect.left = std::clamp(rect.left, 0L, width);
+		rect.right = std::clamp(rect.right, 0L, width);
+		rect.top = std::clamp(rect.top, 0L, height);
+		rect.bottom = std::clamp(rect.bottom, 0L, height);
+		if (rect.left >= rect.right || rect.top >= rect.bottom)
+			continue;
+
+		area += (uint64_t)(rect.right - rect.left) * (uint64_t)(rect.bottom - rect.top);
+		d->copy_rects.push_back(rect);
+	}
+
+	if ((double)area > (double)width * (double)height * MAX_PARTIAL_COPY_AREA)
+		return false;
+
+	for (const RECT &rect : d->copy_rects) {
+		const D3D11_BOX box = {(UINT)rect.left, (UINT)rect.top, 0, (UINT)rect.right, (UINT)rect.bottom, 1};
+		d->device->context->CopySubresourceRegion(d->texture->texture, 0, rect.left, rect.top, 0, tex, 0,
+							  &box);
+	}
+
+	return true;
+}
+
+static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex, const DXGI_OUTDUPL_FRAME_INFO &info)
 {
 	D3D11_TEXTURE2D_DESC desc;
 	tex->GetDesc(&desc);
 	const gs_color_format format = ConvertDXGITextureFormat(desc.Format);
 	const gs_color_format general_format = gs_generalize_format(format);
+	bool recreated = false;
 
 	if (!d->texture || (d->texture->width != desc.Width) || (d->texture->height != desc.Height) ||
 	    (d->texture->format != general_format)) {
@@ -433,10 +508,24 @@ static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
 		d->color_space =
 			d->hdr ? GS_CS_709_SCRGB
 			       : ((desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT) ? GS_CS_SRGB_16F : GS_CS_SRGB);
+		recreated = true;
 	}
 
-	if (d->texture)
+	if (!d->texture)
+		return;
+
+	if (!recreated && copy_dirty_rects(d, tex, info))
+		d->stats.partial_copies++;
+	else
 		d->device->context->CopyResource(d->texture->texture, tex);
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	if (now.QuadPart > info.LastPresentTime.QuadPart)
+		d->stats.total_latency_ns +=
+			util_mul_div64(now.QuadPart - info.LastPresentTime.QuadPart, 1000000000ULL, freq.QuadPart);
+	d->stats.frames++;
 }
 
 EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
@@ -472,6 +561,14 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
 		return true;
 	}
 
+	/* only the pointer changed, the last copy is still current */
+	if (!info.LastPresentTime.QuadPart && d->texture) {
+		d->stats.skipped_frames++;
+		d->duplicator->ReleaseFrame();
+		d->updated = true;
+		return true;
+	}
+
 	hr = res->QueryInterface(__uuidof(ID3D11Texture2D), (void **)tex.Assign());
 	if (FAILED(hr)) {
 		blog(LOG_ERROR,
@@ -482,7 +579,7 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
 		return true;
 	}
 
-	copy_texture(d, tex);
+	copy_texture(d, tex, info);
 	d->duplicator->ReleaseFrame();
 	d->updated = true;
 	
@@ -509,6 +606,11 @@ EXPORT float gs_duplicator_get_sdr_white_level(gs_duplicator_t *duplicator)
 	return duplicator->sdr_white_nits;
 }
 
+EXPORT void gs_duplicator_get_stats(gs_duplicator_t *duplicator, struct gs_duplicator_stats *stats)
+{
+	*stats = duplicator->stats;
+}
+
 EXPORT void gs_duplicator_show_window(gs_duplicator_t *duplicator, bool show)
 {
 	if (!duplicator || !duplicator->displayWindow)
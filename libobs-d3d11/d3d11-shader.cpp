@@ -194,6 +194,8 @@ void gs_shader::BuildConstantBuffer()
 			throw HRError("Failed to create constant buffer", hr);
 	}
 
+	constData.assign(constantSize, 0);
+
 	for (size_t i = 0; i < params.size(); i++)
 		gs_shader_set_default(&params[i]);
 }
@@ -303,23 +305,17 @@ void gs_shader::Compile(const char *shaderString, const char *file, const char *
 #endif
 }
 
-inline void gs_shader::UpdateParam(vector<uint8_t> &constData, gs_shader_param &param, bool &upload)
+inline void gs_shader::UpdateParam(gs_shader_param &param, bool &upload)
 {
 	if (param.type != GS_SHADER_PARAM_TEXTURE) {
 		if (!param.curValue.size())
 			throw "Not all shader parameters were set";
 
-		/* padding in case the constant needs to start at a new
-		 * register */
-		if (param.pos > constData.size()) {
-			uint8_t zero = 0;
-
-			constData.insert(constData.end(), param.pos - constData.size(), zero);
-		}
-
-		constData.insert(constData.end(), param.curValue.begin(), param.curValue.end());
-
 		if (param.changed) {
+			if (param.pos + param.curValue.size() > constData.size())
+				throw "Invalid constant data size given to shader";
+
+			memcpy(constData.data() + param.pos, param.curValue.data(), param.curValue.size());
 			upload = true;
 			param.changed = false;
 		}
@@ -342,16 +338,10 @@ inline void gs_shader::UpdateParam(vector<uint8_t> &constData, gs_shader_param &
 
 void gs_shader::UploadParams()
 {
-	vector<uint8_t> constData;
 	bool upload = false;
 
-	constData.reserve(constantSize);
-
 	for (size_t i = 0; i < params.size(); i++)
-		UpdateParam(constData, params[i], upload);
-
-	if (constData.size() != constantSize)
-		throw "Invalid constant data size given to shader";
+		UpdateParam(params[i], upload);
 
 	if (upload) {
 		D3D11_MAPPED_SUBRESOURCE map;
@@ -2825,6 +2825,48 @@ void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vertbuffer, const gs_vb_data
 	gs_vertexbuffer_flush_internal(vertbuffer, data);
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer, size_t start, size_t count, bool discard)
+{
+	const gs_vb_data *data = vertbuffer->vbd.data;
+	size_t num_tex = data->num_tex < vertbuffer->uvBuffers.size() ? data->num_tex : vertbuffer->uvBuffers.size();
+
+	if (!vertbuffer->dynamic) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range: vertex buffer is not dynamic");
+		return;
+	}
+	if (start + count > data->num) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range: range is outside of the vertex buffer");
+		return;
+	}
+
+	try {
+		if (data->points)
+			vertbuffer->FlushBufferRange(vertbuffer->vertexBuffer, data->points, sizeof(vec3), start,
+						     count, discard);
+
+		if (vertbuffer->normalBuffer && data->normals)
+			vertbuffer->FlushBufferRange(vertbuffer->normalBuffer, data->normals, sizeof(vec3), start,
+						     count, discard);
+
+		if (vertbuffer->tangentBuffer && data->tangents)
+			vertbuffer->FlushBufferRange(vertbuffer->tangentBuffer, data->tangents, sizeof(vec3), start,
+						     count, discard);
+
+		if (vertbuffer->colorBuffer && data->colors)
+			vertbuffer->FlushBufferRange(vertbuffer->colorBuffer, data->colors, sizeof(uint32_t), start,
+						     count, discard);
+
+		for (size_t i = 0; i < num_tex; i++) {
+			gs_tvertarray &tv = data->tvarray[i];
+			vertbuffer->FlushBufferRange(vertbuffer->uvBuffers[i], tv.array, tv.width * sizeof(float),
+						     start, count, discard);
+		}
+	} catch (const HRError &error) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range (D3D11): %s (%08lX)", error.str, error.hr);
+		LogD3D11ErrorDetails(error, vertbuffer->device);
+	}
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
 {
 	return vertbuffer->vbd.data;
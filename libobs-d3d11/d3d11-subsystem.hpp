@@ -384,6 +384,8 @@ struct gs_vertex_buffer : gs_obj {
 	vector<size_t> uvSizes;
 
 	void FlushBuffer(ID3D11Buffer *buffer, void *array, size_t elementSize);
+	void FlushBufferRange(ID3D11Buffer *buffer, void *array, size_t elementSize, size_t start, size_t count,
+			      bool discard);
 
 	UINT MakeBufferList(gs_vertex_shader *shader, ID3D11Buffer **buffers, uint32_t *strides);
 
@@ -685,10 +687,13 @@ struct gs_shader : gs_obj {
 	ComPtr<ID3D11Buffer> constants;
 	size_t constantSize;
 
+	/* CPU copy of the constant buffer, only changed params are written */
+	vector<uint8_t> constData;
+
 	D3D11_BUFFER_DESC bd = {};
 	vector<uint8_t> data;
 
-	inline void UpdateParam(vector<uint8_t> &constData, gs_shader_param &param, bool &upload);
+	inline void UpdateParam(gs_shader_param &param, bool &upload);
 	void UploadParams();
 
 	void BuildConstantBuffer();
@@ -761,9 +766,13 @@ struct gs_duplicator : gs_obj {
 	bool hdr = false;
 	enum gs_color_space color_space = GS_CS_SRGB;
 	float sdr_white_nits = 80.f;
+	DXGI_MODE_ROTATION rotation = DXGI_MODE_ROTATION_IDENTITY;
 	int idx;
 	long refs;
 	bool updated;
+	vector<BYTE> metadata;
+	vector<RECT> copy_rects;
+	gs_duplicator_stats stats = {};
 	HWND displayWindow;
 	gs_swap_chain *displaySwapChain;
 
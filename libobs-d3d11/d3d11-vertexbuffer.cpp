@@ -44,6 +44,24 @@ void gs_vertex_buffer::FlushBuffer(ID3D11Buffer *buffer, void *array, size_t ele
 	device->context->Unmap(buffer, 0);
 }
 
+void gs_vertex_buffer::FlushBufferRange(ID3D11Buffer *buffer, void *array, size_t elementSize, size_t start,
+					size_t count, bool discard)
+{
+	D3D11_MAPPED_SUBRESOURCE msr;
+	HRESULT hr;
+
+	/* without discard the caller guarantees the GPU is not reading the
+	 * range, so the buffer doesn't have to be renamed */
+	const D3D11_MAP map_type = discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	if (FAILED(hr = device->context->Map(buffer, 0, map_type, 0, &msr)))
+		throw HRError("Failed to map buffer", hr);
+
+	const size_t offset = elementSize * start;
+	memcpy((uint8_t *)msr.pData + offset, (uint8_t *)array + offset, elementSize * count);
+	device->context->Unmap(buffer, 0);
+}
+
 UINT gs_vertex_buffer::MakeBufferList(gs_vertex_shader *shader, ID3D11Buffer **buffers, uint32_t *strides)
 {
 	UINT numBuffers = 0;
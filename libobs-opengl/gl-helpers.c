@@ -150,3 +150,27 @@ bool update_buffer(GLenum target, GLuint buffer, const void *data, size_t size)
 	gl_bind_buffer(target, 0);
 	return success;
 }
+
+bool update_buffer_range(GLenum target, GLuint buffer, const void *data, size_t offset, size_t size, bool discard)
+{
+	void *ptr;
+	bool success = true;
+
+	/* when not discarding, the caller guarantees that the range is not
+	 * in use by the GPU, so the map doesn't have to synchronize */
+	GLbitfield flags = GL_MAP_WRITE_BIT;
+	flags |= discard ? GL_MAP_INVALIDATE_BUFFER_BIT : (GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (!gl_bind_buffer(target, buffer))
+		return false;
+
+	ptr = glMapBufferRange(target, offset, size, flags);
+	success = gl_success("glMapBufferRange");
+	if (success && ptr) {
+		memcpy(ptr, (const uint8_t *)data + offset, size);
+		glUnmapBuffer(target);
+	}
+
+	gl_bind_buffer(target, 0);
+	return success;
+}
@@ -16,7 +16,10 @@
 ******************************************************************************/
 
 #include <assert.h>
+#include <inttypes.h>
 
+#include <util/dstr.h>
+#include <util/platform.h>
 #include <graphics/vec2.h>
 #include <graphics/vec3.h>
 #include <graphics/vec4.h>
@@ -25,6 +28,24 @@
 #include "gl-subsystem.h"
 #include "gl-shaderparser.h"
 
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnv1a_hash(uint64_t hash, const void *data, size_t len)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint64_t)bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static inline uint64_t fnv1a_hash_str(uint64_t hash, const char *str)
+{
+	return str ? fnv1a_hash(hash, str, strlen(str)) : hash;
+}
+
 static inline void shader_param_free(struct gs_shader_param *param)
 {
 	bfree(param->name);
@@ -73,6 +94,7 @@ static bool gl_add_param(struct gs_shader *shader, struct shader_var *var, GLint
 		param.texture_id = (*texture_id)++;
 	} else {
 		param.changed = true;
+		param.version = 1;
 	}
 
 	da_move(param.def_value, var->default_val);
@@ -185,6 +207,8 @@ static bool gl_shader_init(struct gs_shader *shader, struct gl_shader_parser *gl
 	if (!gl_success("glCreateShader") || !shader->obj)
 		return false;
 
+	shader->hash = fnv1a_hash_str(FNV_OFFSET, glsp->gl_string.array);
+
 	glShaderSource(shader->obj, 1, (const GLchar **)&glsp->gl_string.array, 0);
 	if (!gl_success("glShaderSource"))
 		return false;
@@ -368,20 +392,29 @@ void gs_shader_get_param_info(const gs_sparam_t *param, struct gs_shader_param_i
 	info->name = param->name;
 }
 
+static inline void shader_set_value(struct gs_shader_param *param, const void *val, size_t size)
+{
+	if (param->cur_value.num == size && memcmp(param->cur_value.array, val, size) == 0)
+		return;
+
+	da_copy_array(param->cur_value, val, size);
+	param->version++;
+}
+
 void gs_shader_set_bool(gs_sparam_t *param, bool val)
 {
 	int int_val = val;
-	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+	shader_set_value(param, &int_val, sizeof(int_val));
 }
 
 void gs_shader_set_float(gs_sparam_t *param, float val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_set_value(param, &val, sizeof(val));
 }
 
 void gs_shader_set_int(gs_sparam_t *param, int val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_set_value(param, &val, sizeof(val));
 }
 
 void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
@@ -389,27 +422,27 @@ void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
 	struct matrix4 mat;
 	matrix4_from_matrix3(&mat, val);
 
-	da_copy_array(param->cur_value, &mat, sizeof(mat));
+	shader_set_value(param, &mat, sizeof(mat));
 }
 
 void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
 {
-	da_copy_array(param->cur_value, val, sizeof(*val));
+	shader_set_value(param, val, sizeof(*val));
 }
 
 void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_set_value(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_set_value(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_set_value(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
@@ -434,6 +467,13 @@ static void program_set_param_data(struct gs_program *program, struct program_pa
 {
 	void *array = pp->param->cur_value.array;
 
+	/* uniform values are program state, so only changes are uploaded */
+	if (pp->param->type != GS_SHADER_PARAM_TEXTURE) {
+		if (pp->version == pp->param->version)
+			return;
+		pp->version = pp->param->version;
+	}
+
 	if (pp->param->type == GS_SHADER_PARAM_BOOL || pp->param->type == GS_SHADER_PARAM_INT) {
 		if (validate_param(pp, sizeof(int))) {
 			glUniform1iv(pp->obj, 1, (int *)array);
@@ -494,7 +534,12 @@ static void program_set_param_data(struct gs_program *program, struct program_pa
 			pp->param->next_sampler = NULL;
 		}
 
-		glUniform1i(pp->obj, pp->param->texture_id);
+		/* the texture unit of a sampler never changes */
+		if (!pp->version) {
+			glUniform1i(pp->obj, pp->param->texture_id);
+			pp->version = 1;
+		}
+
 		if (pp->param->srgb)
 			device_load_texture_srgb(program->device, pp->param->texture, pp->param->texture_id);
 		else
@@ -573,6 +618,7 @@ static bool assign_program_param(struct gs_program *program, struct gs_shader_pa
 	}
 
 	info.param = param;
+	info.version = 0;
 	da_push_back(program->params, &info);
 	return true;
 }
@@ -598,6 +644,199 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* program binary cache */
+
+/* Increment if the on-disk format changes */
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_MAGIC 0x50424C47
+#define PROGRAM_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+struct program_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t driver_hash;
+	uint64_t vertex_hash;
+	uint64_t pixel_hash;
+	uint32_t format;
+	uint32_t size;
+};
+
+static void clear_program_cache(const char *path)
+{
+	struct dstr pattern = {0};
+	os_glob_t *glob;
+
+	dstr_printf(&pattern, "%s/*.bin", path);
+
+	if (os_glob(pattern.array, 0, &glob) == 0) {
+		for (size_t i = 0; i < glob->gl_pathc; i++)
+			os_unlink(glob->gl_pathv[i].path);
+		os_globfree(glob);
+	}
+
+	dstr_free(&pattern);
+}
+
+void gl_program_cache_init(struct gs_device *device)
+{
+	GLint formats = 0;
+	struct dstr driver_file = {0};
+	char hashstr[20];
+
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+		return;
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (!gl_success("glGetIntegerv") || formats <= 0)
+		return;
+
+	char *path = os_get_program_data_path_ptr("obs-studio/shader-cache/gl");
+	if (!path)
+		return;
+	if (os_mkdirs(path) == MKDIR_ERROR) {
+		bfree(path);
+		return;
+	}
+
+	/* binaries are only valid for the driver that produced them */
+	uint64_t hash = FNV_OFFSET;
+	hash = fnv1a_hash_str(hash, (const char *)glGetString(GL_VENDOR));
+	hash = fnv1a_hash_str(hash, (const char *)glGetString(GL_RENDERER));
+	hash = fnv1a_hash_str(hash, (const char *)glGetString(GL_VERSION));
+	snprintf(hashstr, sizeof(hashstr), "%016" PRIx64, hash);
+
+	dstr_printf(&driver_file, "%s/driver", path);
+
+	char *prev_hash = os_quick_read_utf8_file(driver_file.array);
+	if (!prev_hash || strcmp(prev_hash, hashstr) != 0) {
+		if (prev_hash)
+			blog(LOG_INFO, "OpenGL driver changed, clearing program binary cache");
+
+		clear_program_cache(path);
+		os_quick_write_utf8_file(driver_file.array, hashstr, strlen(hashstr), false);
+	}
+
+	bfree(prev_hash);
+	dstr_free(&driver_file);
+
+	device->program_cache_path = path;
+	device->driver_hash = hash;
+}
+
+static void program_cache_init_header(struct gs_program *program, struct program_cache_header *header)
+{
+	memset(header, 0, sizeof(*header));
+	header->magic = PROGRAM_CACHE_MAGIC;
+	header->version = PROGRAM_CACHE_VERSION;
+	header->driver_hash = program->device->driver_hash;
+	header->vertex_hash = program->vertex_shader->hash;
+	header->pixel_hash = program->pixel_shader->hash;
+}
+
+static void program_cache_get_path(struct gs_program *program, struct dstr *path)
+{
+	uint64_t hash = program->device->driver_hash;
+	hash = fnv1a_hash(hash, &program->vertex_shader->hash, sizeof(uint64_t));
+	hash = fnv1a_hash(hash, &program->pixel_shader->hash, sizeof(uint64_t));
+
+	dstr_printf(path, "%s/%016" PRIx64 ".bin", program->device->program_cache_path, hash);
+}
+
+static bool program_cache_load(struct gs_program *program)
+{
+	struct program_cache_header expected;
+	struct program_cache_header header;
+	struct dstr path = {0};
+	void *binary = NULL;
+	GLint linked = GL_FALSE;
+	bool success = false;
+	FILE *file;
+
+	if (!program->device->program_cache_path)
+		return false;
+
+	program_cache_get_path(program, &path);
+
+	file = os_fopen(path.array, "rb");
+	if (!file)
+		goto free;
+
+	program_cache_init_header(program, &expected);
+
+	if (fread(&header, sizeof(header), 1, file) != 1)
+		goto close;
+	if (header.magic != expected.magic || header.version != expected.version ||
+	    header.driver_hash != expected.driver_hash || header.vertex_hash != expected.vertex_hash ||
+	    header.pixel_hash != expected.pixel_hash || !header.size || header.size > PROGRAM_CACHE_MAX_SIZE)
+		goto close;
+
+	binary = bmalloc(header.size);
+	if (fread(binary, 1, header.size, file) != header.size)
+		goto close;
+
+	/* drivers may reject their own binaries after an update, in which
+	 * case the program is just linked from source again */
+	glProgramBinary(program->obj, header.format, binary, (GLsizei)header.size);
+	if (glGetError() != GL_NO_ERROR)
+		goto close;
+
+	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+	success = gl_success("glGetProgramiv") && linked == GL_TRUE;
+
+close:
+	fclose(file);
+	if (!success)
+		os_unlink(path.array);
+free:
+	bfree(binary);
+	dstr_free(&path);
+	return success;
+}
+
+static void program_cache_save(struct gs_program *program)
+{
+	struct program_cache_header header;
+	struct dstr path = {0};
+	GLint size = 0;
+	GLsizei length = 0;
+	GLenum format = 0;
+	void *binary;
+	FILE *file;
+
+	if (!program->device->program_cache_path)
+		return;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!gl_success("glGetProgramiv") || size <= 0 || size > PROGRAM_CACHE_MAX_SIZE)
+		return;
+
+	binary = bmalloc(size);
+	glGetProgramBinary(program->obj, size, &length, &format, binary);
+	if (!gl_success("glGetProgramBinary") || length <= 0)
+		goto free;
+
+	program_cache_init_header(program, &header);
+	header.format = format;
+	header.size = (uint32_t)length;
+
+	program_cache_get_path(program, &path);
+
+	file = os_fopen(path.array, "wb");
+	if (file) {
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			       fwrite(binary, 1, length, file) == (size_t)length;
+		fclose(file);
+
+		if (!written)
+			os_unlink(path.array);
+	}
+
+	dstr_free(&path);
+free:
+	bfree(binary);
+}
+
 struct gs_program *gs_program_create(struct gs_device *device)
 {
 	struct gs_program *program = bzalloc(sizeof(*program));
@@ -611,6 +850,19 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	if (!gl_success("glCreateProgram"))
 		goto error_detach_neither;
 
+	if (program_cache_load(program)) {
+		if (!assign_program_attribs(program))
+			goto error_detach_neither;
+		if (!assign_program_params(program))
+			goto error_detach_neither;
+		goto add_program;
+	}
+
+	if (device->program_cache_path) {
+		glProgramParameteri(program->obj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		gl_success("glProgramParameteri");
+	}
+
 	glAttachShader(program->obj, program->vertex_shader->obj);
 	if (!gl_success("glAttachShader (vertex)"))
 		goto error_detach_neither;
@@ -643,6 +895,9 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	glDetachShader(program->obj, program->pixel_shader->obj);
 	gl_success("glDetachShader (pixel)");
 
+	program_cache_save(program);
+
+add_program:
 	program->next = device->first_program;
 	program->prev_next = &device->first_program;
 	device->first_program = program;
@@ -748,7 +1003,7 @@ void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
 		gs_shader_set_texture(param, shader_tex.tex);
 		param->srgb = shader_tex.srgb;
 	} else {
-		da_copy_array(param->cur_value, val, size);
+		shader_set_value(param, val, size);
 	}
 }
 
@@ -457,6 +457,9 @@ struct gs_shader_param {
 	DARRAY(uint8_t) cur_value;
 	DARRAY(uint8_t) def_value;
 	bool changed;
+
+	/* bumped whenever cur_value changes */
+	uint32_t version;
 };
 
 enum attrib_type { ATTRIB_POSITION, ATTRIB_NORMAL, ATTRIB_TANGENT, ATTRIB_COLOR, ATTRIB_TEXCOORD, ATTRIB_TARGET };
@@ -471,6 +474,7 @@ struct gs_shader {
 	gs_device_t *device;
 	enum gs_shader_type type;
 	GLuint obj;
+	uint64_t hash;
 
 	struct gs_shader_param *viewproj;
 	struct gs_shader_param *world;
@@ -483,6 +487,7 @@ struct gs_shader {
 struct program_param {
 	GLint obj;
 	struct gs_shader_param *param;
+	uint32_t version;
 };
 
 struct gs_program {
@@ -501,6 +506,7 @@ struct gs_program {
 extern struct gs_program *gs_program_create(struct gs_device *device);
 extern void gs_program_destroy(struct gs_program *program);
 extern void program_update_params(struct gs_program *shader);
+extern void gl_program_cache_init(struct gs_device *device);
 
 struct gs_vertex_buffer {
 	GLuint vao;
@@ -646,6 +652,10 @@ struct gs_device {
 
 	struct gs_program *first_program;
 
+	/* program binary cache, NULL when the driver has no binary formats */
+	char *program_cache_path;
+	uint64_t driver_hash;
+
 	enum gs_cull_mode cur_cull_mode;
 	struct gs_rect cur_viewport;
 
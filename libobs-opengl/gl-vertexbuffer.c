@@ -169,6 +169,59 @@ void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vb, const struct gs_vb_data *
 	gs_vertexbuffer_flush_internal(vb, data);
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vb, size_t start, size_t count, bool discard)
+{
+	const struct gs_vb_data *data = vb->data;
+	size_t i;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		goto failed;
+	}
+	if (start + count > data->num) {
+		blog(LOG_ERROR, "vertex buffer range is out of bounds");
+		goto failed;
+	}
+
+	if (data->points) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->vertex_buffer, data->points,
+					 start * sizeof(struct vec3), count * sizeof(struct vec3), discard))
+			goto failed;
+	}
+
+	if (vb->normal_buffer && data->normals) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->normal_buffer, data->normals,
+					 start * sizeof(struct vec3), count * sizeof(struct vec3), discard))
+			goto failed;
+	}
+
+	if (vb->tangent_buffer && data->tangents) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->tangent_buffer, data->tangents,
+					 start * sizeof(struct vec3), count * sizeof(struct vec3), discard))
+			goto failed;
+	}
+
+	if (vb->color_buffer && data->colors) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->color_buffer, data->colors, start * sizeof(uint32_t),
+					 count * sizeof(uint32_t), discard))
+			goto failed;
+	}
+
+	for (i = 0; i < vb->uv_buffers.num; i++) {
+		GLuint buffer = vb->uv_buffers.array[i];
+		struct gs_tvertarray *tv = data->tvarray + i;
+		size_t stride = tv->width * sizeof(float);
+
+		if (!update_buffer_range(GL_ARRAY_BUFFER, buffer, tv->array, start * stride, count * stride, discard))
+			goto failed;
+	}
+
+	return;
+
+failed:
+	blog(LOG_ERROR, "gs_vertexbuffer_flush_range (GL) failed");
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
 {
 	return vb->data;
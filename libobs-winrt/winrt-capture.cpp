@@ -1,5 +1,7 @@
 #include "winrt-capture.h"
 
+#include <util/util_uint64.h>
+
 extern "C" EXPORT BOOL winrt_capture_supported()
 try {
 	/* no contract for IGraphicsCaptureItemInterop, verify 10.0.18362.0 */
@@ -114,6 +116,9 @@ struct winrt_capture {
 	uint32_t texture_height;
 	D3D11_BOX client_box;
 
+	/* WGC only delivers frames with new content, nothing is skipped */
+	struct gs_duplicator_stats stats;
+
 	BOOL active;
 	struct winrt_capture *next;
 
@@ -173,6 +178,17 @@ struct winrt_capture {
 				}
 
 				texture_written = true;
+
+				/* SystemRelativeTime is in QPC time, in 100ns units */
+				LARGE_INTEGER now, freq;
+				QueryPerformanceCounter(&now);
+				QueryPerformanceFrequency(&freq);
+				const int64_t present_ns = frame.SystemRelativeTime().count() * 100;
+				const int64_t now_ns =
+					(int64_t)util_mul_div64(now.QuadPart, 1000000000ULL, freq.QuadPart);
+				if (now_ns > present_ns)
+					stats.total_latency_ns += now_ns - present_ns;
+				stats.frames++;
 			}
 
 			if (frame_content_size.Width != last_size.Width ||
@@ -574,6 +590,14 @@ extern "C" EXPORT uint32_t winrt_capture_height(const struct winrt_capture *capt
 	return capture ? capture->texture_height : 0;
 }
 
+extern "C" EXPORT void winrt_capture_get_stats(const struct winrt_capture *capture, struct gs_duplicator_stats *stats)
+{
+	if (capture)
+		*stats = capture->stats;
+	else
+		*stats = {};
+}
+
 extern "C" EXPORT void winrt_capture_thread_start()
 {
 	struct winrt_capture *capture = capture_list;
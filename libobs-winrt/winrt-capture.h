@@ -21,6 +21,7 @@ EXPORT enum gs_color_space winrt_capture_get_color_space(const struct winrt_capt
 EXPORT void winrt_capture_render(struct winrt_capture *capture);
 EXPORT uint32_t winrt_capture_width(const struct winrt_capture *capture);
 EXPORT uint32_t winrt_capture_height(const struct winrt_capture *capture);
+EXPORT void winrt_capture_get_stats(const struct winrt_capture *capture, struct gs_duplicator_stats *stats);
 
 EXPORT void winrt_capture_thread_start();
 EXPORT void winrt_capture_thread_stop();
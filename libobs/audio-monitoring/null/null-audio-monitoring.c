@@ -22,6 +22,12 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 	UNUSED_PARAMETER(monitor);
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	UNUSED_PARAMETER(monitor);
+	return 0;
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	UNUSED_PARAMETER(monitor);
@@ -7,6 +7,7 @@
 #include "../../util/deque.h"
 #include "../../util/threading.h"
 #include "../../util/platform.h"
+#include "../../util/util_uint64.h"
 #include "../../obs-internal.h"
 #include "../../util/darray.h"
 
@@ -311,6 +312,25 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 		audio_monitor_init_final(monitor);
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	size_t queued_buffers;
+	size_t bytes;
+
+	if (monitor->ignore || !os_atomic_load_bool(&monitor->active))
+		return 0;
+
+	/* queue buffers are played back in order, so the estimate is
+	 * whatever waits on our side plus the buffers the queue holds */
+	pthread_mutex_lock(&monitor->mutex);
+	queued_buffers = 3 - monitor->empty_buffers.size / sizeof(AudioQueueBufferRef);
+	bytes = monitor->new_data.size + queued_buffers * monitor->buffer_size;
+	pthread_mutex_unlock(&monitor->mutex);
+
+	return util_mul_div64(bytes / (sizeof(float) * monitor->channels), 1000000000ULL,
+			      audio_output_get_sample_rate(obs->audio.audio));
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
@@ -1,9 +1,15 @@
 #include "obs-internal.h"
+#include "util/util_uint64.h"
 #include "pulseaudio-wrapper.h"
 
 #define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
+/* target latency of the pulse stream */
+#define MONITOR_TARGET_USEC 10000
+/* most audio the ring between capture and pulse can hold */
+#define MONITOR_RING_USEC 100000
+
 struct audio_monitor {
 	obs_source_t *source;
 	pa_stream *stream;
@@ -18,9 +24,13 @@ struct audio_monitor {
 	uint_fast32_t packets;
 	uint_fast64_t frames;
 
-	struct deque new_data;
+	/* filled on the capture thread, drained by the pulse mainloop */
+	struct spsc_ring ring;
 	audio_resampler_t *resampler;
 
+	volatile bool starved;
+	volatile long latency_us;
+
 	bool ignore;
 	pthread_mutex_t playback_mutex;
 };
@@ -178,52 +188,74 @@ void process_volume(const struct audio_monitor *monitor, float vol, uint8_t *con
 	}
 }
 
-static void do_stream_write(void *param)
+static inline uint64_t bytes_to_usec(const struct audio_monitor *monitor, size_t bytes)
 {
-	PULSE_DATA(param);
-	uint8_t *buffer = NULL;
+	return util_mul_div64(bytes / monitor->bytes_per_frame, 1000000ULL, monitor->samples_per_sec);
+}
 
-	pulseaudio_lock();
-	pthread_mutex_lock(&data->playback_mutex);
-
-	// If we have grown a large buffer internally, grow the pulse buffer to match so we can write our data out.
-	if (data->new_data.size > data->attr.tlength * 2) {
-		data->attr.fragsize = (uint32_t)-1;
-		data->attr.maxlength = (uint32_t)-1;
-		data->attr.prebuf = (uint32_t)-1;
-		data->attr.minreq = (uint32_t)-1;
-		data->attr.tlength = data->new_data.size;
-		pa_stream_set_buffer_attr(data->stream, &data->attr, NULL, NULL);
+/* consumer side of the ring, assumes the pulse mainloop lock */
+static void stream_write_from_ring(struct audio_monitor *data, pa_stream *s, size_t nbytes)
+{
+	size_t frame = data->bytes_per_frame;
+	size_t avail = spsc_ring_size(&data->ring);
+	pa_usec_t device_usec = 0;
+	int negative = 0;
+
+	/* drop whatever piled up beyond the target, so clock drift between
+	 * the source and the device cannot grow the latency */
+	if (avail > nbytes + data->attr.tlength) {
+		size_t drop = avail - nbytes - data->attr.tlength;
+		drop -= drop % frame;
+		spsc_ring_pop(&data->ring, drop);
+		avail -= drop;
 	}
 
-	// Buffer up enough data before we start playing.
-	if (pa_stream_is_corked(data->stream)) {
-		if (data->new_data.size >= data->attr.tlength) {
-			pa_stream_cork(data->stream, 0, NULL, NULL);
-		} else {
-			goto finish;
-		}
+	if (nbytes > avail) {
+		nbytes = avail;
+		os_atomic_set_bool(&data->starved, true);
 	}
+	nbytes -= nbytes % frame;
 
-	while (data->new_data.size > 0) {
-		size_t bytesToFill = data->new_data.size;
-		if (pa_stream_begin_write(data->stream, (void **)&buffer, &bytesToFill))
-			goto finish;
-
-		// PA may request we submit more or less data than we have.
-		// Wait for more data if we cannot perform a full write.
-		if (bytesToFill > data->new_data.size) {
-			pa_stream_cancel_write(data->stream);
-			goto finish;
-		}
+	while (nbytes > 0) {
+		uint8_t *buffer = NULL;
+		size_t size = nbytes;
 
-		deque_pop_front(&data->new_data, buffer, bytesToFill);
+		if (pa_stream_begin_write(s, (void **)&buffer, &size) < 0 || !size)
+			break;
+		if (size > nbytes)
+			size = nbytes;
 
-		pa_stream_write(data->stream, buffer, bytesToFill, NULL, 0LL, PA_SEEK_RELATIVE);
+		spsc_ring_peek(&data->ring, 0, buffer, size);
+		spsc_ring_pop(&data->ring, size);
+		pa_stream_write(s, buffer, size, NULL, 0LL, PA_SEEK_RELATIVE);
+		nbytes -= size;
 	}
 
-finish:
-	pthread_mutex_unlock(&data->playback_mutex);
+	if (pa_stream_get_latency(s, &device_usec, &negative) < 0 || negative)
+		device_usec = 0;
+
+	uint64_t usec = device_usec + bytes_to_usec(data, spsc_ring_size(&data->ring));
+	os_atomic_set_long(&data->latency_us, (long)usec);
+}
+
+static void pulseaudio_stream_write(pa_stream *s, size_t nbytes, void *userdata)
+{
+	PULSE_DATA(userdata);
+	stream_write_from_ring(data, s, nbytes);
+}
+
+/* called on the capture thread after new data was committed */
+static void kick_stream(struct audio_monitor *data)
+{
+	/* the mainloop only asks for data as the device drains, so once it
+	 * ran dry it has to be fed from here */
+	if (!os_atomic_exchange_bool(&data->starved, false))
+		return;
+
+	pulseaudio_lock();
+	size_t writable = pa_stream_writable_size(data->stream);
+	if (writable != (size_t)-1 && writable > 0)
+		stream_write_from_ring(data, data->stream, writable);
 	pulseaudio_unlock();
 }
 
@@ -252,6 +284,10 @@ static void on_audio_playback(void *param, obs_source_t *source, const struct au
 
 	bytes = monitor->bytes_per_frame * resample_frames;
 
+	/* the device is not keeping up, drop rather than add latency */
+	if (spsc_ring_space(&monitor->ring) < bytes)
+		goto unlock;
+
 	if (muted) {
 		memset(resample_data[0], 0, bytes);
 	} else {
@@ -260,13 +296,15 @@ static void on_audio_playback(void *param, obs_source_t *source, const struct au
 		}
 	}
 
-	deque_push_back(&monitor->new_data, resample_data[0], bytes);
+	spsc_ring_write(&monitor->ring, 0, resample_data[0], bytes);
+	spsc_ring_commit(&monitor->ring, bytes);
 	monitor->packets++;
 	monitor->frames += resample_frames;
 
+	kick_stream(monitor);
+
 unlock:
 	pthread_mutex_unlock(&monitor->playback_mutex);
-	do_stream_write(param);
 }
 
 static void pulseaudio_server_info(pa_context *c, const pa_server_info *i, void *userdata)
@@ -435,9 +473,12 @@ static bool audio_monitor_init(struct audio_monitor *monitor, obs_source_t *sour
 	monitor->attr.maxlength = (uint32_t)-1;
 	monitor->attr.minreq = (uint32_t)-1;
 	monitor->attr.prebuf = (uint32_t)-1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
+	monitor->attr.tlength = pa_usec_to_bytes(MONITOR_TARGET_USEC, &spec);
+
+	spsc_ring_init(&monitor->ring, pa_usec_to_bytes(MONITOR_RING_USEC, &spec));
 
-	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_START_CORKED;
+	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE |
+				  PA_STREAM_ADJUST_LATENCY;
 
 	int_fast32_t ret = pulseaudio_connect_playback(monitor->stream, monitor->device, &monitor->attr, flags);
 	if (ret < 0) {
@@ -455,6 +496,7 @@ static void audio_monitor_init_final(struct audio_monitor *monitor)
 	if (monitor->ignore)
 		return;
 
+	pulseaudio_write_callback(monitor->stream, pulseaudio_stream_write, monitor);
 	obs_source_add_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 }
 
@@ -467,12 +509,13 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 		obs_source_remove_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 
 	audio_resampler_destroy(monitor->resampler);
-	deque_free(&monitor->new_data);
 
 	if (monitor->stream)
 		pulseaudio_stop_playback(monitor);
 	pulseaudio_unref();
 
+	spsc_ring_free(&monitor->ring);
+
 	bfree(monitor->device);
 }
 
@@ -516,6 +559,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 	}
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	return (uint64_t)os_atomic_load_long(&monitor->latency_us) * 1000;
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
@@ -3,6 +3,7 @@
 #include "../../util/platform.h"
 #include "../../util/darray.h"
 #include "../../util/util_uint64.h"
+#include "../../util/threading.h"
 #include "../../obs-internal.h"
 
 #include "wasapi-output.h"
@@ -17,6 +18,11 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+/* shared mode buffer requested from the device, in 100ns units */
+#define MONITOR_BUFFER_DURATION 300000
+/* most audio the ring between capture and the device can hold */
+#define MONITOR_RING_MS 100
+
 ACTUALLY_DEFINE_GUID(CLSID_MMDeviceEnumerator, 0xBCDE0395, 0xE52F, 0x467C, 0x8E, 0x3D, 0xC4, 0x57, 0x92, 0x91, 0x69,
 		     0x2E);
 ACTUALLY_DEFINE_GUID(IID_IMMDeviceEnumerator, 0xA95664D2, 0x9614, 0x4F35, 0xA7, 0x46, 0xDE, 0x8D, 0xB6, 0x36, 0x17,
@@ -45,6 +51,19 @@ struct audio_monitor {
 
 	DARRAY(float) buf;
 	SRWLOCK playback_mutex;
+
+	/* filled on the capture thread, drained by the render thread when
+	 * the device asks for more */
+	struct spsc_ring ring;
+	uint32_t buffer_frames;
+	uint64_t stream_latency;
+	HANDLE device_event;
+	HANDLE stop_event;
+	pthread_t thread;
+	bool thread_active;
+	volatile bool device_lost;
+	volatile long device_pad;
+	volatile long latency_us;
 };
 
 /* #define DEBUG_AUDIO */
@@ -194,7 +213,9 @@ static bool audio_monitor_init_wasapi(struct audio_monitor *monitor)
 		goto fail;
 	}
 
-	hr = monitor->client->lpVtbl->Initialize(monitor->client, AUDCLNT_SHAREMODE_SHARED, 0, 10000000, 0, wfex, NULL);
+	hr = monitor->client->lpVtbl->Initialize(monitor->client, AUDCLNT_SHAREMODE_SHARED,
+						 AUDCLNT_STREAMFLAGS_EVENTCALLBACK, MONITOR_BUFFER_DURATION, 0, wfex,
+						 NULL);
 	if (FAILED(hr)) {
 		warn("%s: Failed to initialize: %08lX", __FUNCTION__, hr);
 		goto fail;
@@ -232,6 +253,29 @@ static bool audio_monitor_init_wasapi(struct audio_monitor *monitor)
 		goto fail;
 	}
 
+	REFERENCE_TIME stream_latency = 0;
+	monitor->client->lpVtbl->GetStreamLatency(monitor->client, &stream_latency);
+
+	monitor->buffer_frames = frames;
+	monitor->stream_latency = (uint64_t)stream_latency * 100;
+	os_atomic_set_long(&monitor->device_pad, 0);
+
+	monitor->device_event = CreateEvent(NULL, false, false, NULL);
+	monitor->stop_event = CreateEvent(NULL, true, false, NULL);
+	if (!monitor->device_event || !monitor->stop_event) {
+		warn("%s: Failed to create events", __FUNCTION__);
+		goto fail;
+	}
+
+	hr = monitor->client->lpVtbl->SetEventHandle(monitor->client, monitor->device_event);
+	if (FAILED(hr)) {
+		warn("%s: Failed to set event handle: %08lX", __FUNCTION__, hr);
+		goto fail;
+	}
+
+	size_t ring_frames = (size_t)monitor->sample_rate * MONITOR_RING_MS / 1000;
+	spsc_ring_init(&monitor->ring, ring_frames * monitor->channels * sizeof(float));
+
 	hr = monitor->client->lpVtbl->GetService(monitor->client, &IID_IAudioRenderClient, (void **)&monitor->render);
 	if (FAILED(hr)) {
 		warn("%s: Failed to get IAudioRenderClient: %08lX", __FUNCTION__, hr);
@@ -253,8 +297,19 @@ fail:
 	return success;
 }
 
+static void audio_monitor_stop_thread(struct audio_monitor *monitor)
+{
+	if (monitor->thread_active) {
+		SetEvent(monitor->stop_event);
+		pthread_join(monitor->thread, NULL);
+		monitor->thread_active = false;
+	}
+}
+
 static void audio_monitor_free_for_reconnect(struct audio_monitor *monitor)
 {
+	audio_monitor_stop_thread(monitor);
+
 	if (monitor->client)
 		monitor->client->lpVtbl->Stop(monitor->client);
 
@@ -274,6 +329,106 @@ static void audio_monitor_free_for_reconnect(struct audio_monitor *monitor)
 
 	deque_free(&monitor->delay_buffer);
 	da_free(monitor->buf);
+
+	spsc_ring_free(&monitor->ring);
+	if (monitor->device_event) {
+		CloseHandle(monitor->device_event);
+		monitor->device_event = NULL;
+	}
+	if (monitor->stop_event) {
+		CloseHandle(monitor->stop_event);
+		monitor->stop_event = NULL;
+	}
+
+	os_atomic_set_bool(&monitor->device_lost, false);
+	os_atomic_set_long(&monitor->latency_us, 0);
+}
+
+static inline uint64_t frames_to_ns(const struct audio_monitor *monitor, uint64_t frames)
+{
+	return util_mul_div64(frames, 1000000000ULL, monitor->sample_rate);
+}
+
+/* consumer side of the ring, only ever called on the render thread */
+static bool render_from_ring(struct audio_monitor *monitor)
+{
+	const size_t block = monitor->channels * sizeof(float);
+	IAudioRenderClient *const render = monitor->render;
+	UINT32 pad = 0;
+	BYTE *output;
+	HRESULT hr;
+
+	hr = monitor->client->lpVtbl->GetCurrentPadding(monitor->client, &pad);
+	if (FAILED(hr))
+		return false;
+
+	uint32_t space = monitor->buffer_frames - pad;
+	uint32_t queued = (uint32_t)(spsc_ring_size(&monitor->ring) / block);
+
+	/* drop whatever piled up beyond one device buffer, so clock drift
+	 * between the source and the device cannot grow the latency */
+	if (queued > space + monitor->buffer_frames) {
+		uint32_t drop = queued - space - monitor->buffer_frames;
+		spsc_ring_pop(&monitor->ring, drop * block);
+		queued -= drop;
+	}
+
+	uint32_t frames = queued < space ? queued : space;
+	if (frames) {
+		hr = render->lpVtbl->GetBuffer(render, frames, &output);
+		if (FAILED(hr))
+			return false;
+
+		spsc_ring_peek(&monitor->ring, 0, output, frames * block);
+		spsc_ring_pop(&monitor->ring, frames * block);
+
+		hr = render->lpVtbl->ReleaseBuffer(render, frames, 0);
+		if (FAILED(hr))
+			return false;
+
+		pad += frames;
+		queued -= frames;
+	}
+
+	uint64_t latency = monitor->stream_latency + frames_to_ns(monitor, (uint64_t)pad + queued);
+	os_atomic_set_long(&monitor->device_pad, (long)pad);
+	os_atomic_set_long(&monitor->latency_us, (long)(latency / 1000));
+	return true;
+}
+
+static void *audio_monitor_thread(void *param)
+{
+	struct audio_monitor *monitor = param;
+	HANDLE events[2] = {monitor->stop_event, monitor->device_event};
+
+	os_set_thread_name("audio monitor: render");
+	CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+	while (WaitForMultipleObjects(2, events, false, INFINITE) == WAIT_OBJECT_0 + 1) {
+		if (!render_from_ring(monitor)) {
+			/* the capture thread reconnects on its next packet */
+			os_atomic_set_bool(&monitor->device_lost, true);
+			break;
+		}
+	}
+
+	CoUninitialize();
+	return NULL;
+}
+
+/* the thread needs the monitor at its final address */
+static void audio_monitor_start_thread(struct audio_monitor *monitor)
+{
+	if (!monitor->client || monitor->thread_active)
+		return;
+
+	if (pthread_create(&monitor->thread, NULL, audio_monitor_thread, monitor) != 0) {
+		warn("%s: Failed to create render thread", __FUNCTION__);
+		os_atomic_set_bool(&monitor->device_lost, true);
+		return;
+	}
+
+	monitor->thread_active = true;
 }
 
 static void on_audio_playback(void *param, obs_source_t *source, const struct audio_data *audio_data, bool muted)
@@ -284,7 +439,7 @@ static void on_audio_playback(void *param, obs_source_t *source, const struct au
 	uint32_t resample_frames;
 	uint64_t ts_offset;
 	bool success;
-	BYTE *output;
+	size_t bytes;
 
 	if (!TryAcquireSRWLockExclusive(&monitor->playback_mutex)) {
 		return;
@@ -293,8 +448,14 @@ static void on_audio_playback(void *param, obs_source_t *source, const struct au
 		goto unlock;
 	}
 
-	if (!monitor->client && !audio_monitor_init_wasapi(monitor)) {
-		goto free_for_reconnect;
+	if (os_atomic_load_bool(&monitor->device_lost)) {
+		audio_monitor_free_for_reconnect(monitor);
+	}
+	if (!monitor->client) {
+		if (!audio_monitor_init_wasapi(monitor)) {
+			goto free_for_reconnect;
+		}
+		audio_monitor_start_thread(monitor);
 	}
 
 	success = audio_resampler_resample(monitor->resampler, resample_data, &resample_frames, &ts_offset,
@@ -303,45 +464,38 @@ static void on_audio_playback(void *param, obs_source_t *source, const struct au
 		goto unlock;
 	}
 
-	UINT32 pad = 0;
-	HRESULT hr = monitor->client->lpVtbl->GetCurrentPadding(monitor->client, &pad);
-	if (FAILED(hr)) {
-		goto free_for_reconnect;
-	}
-
 	bool decouple_audio = source->async_unbuffered && source->async_decoupled;
 
 	if (monitor->source_has_video && !decouple_audio) {
 		uint64_t ts = audio_data->timestamp - ts_offset;
+		size_t queued = spsc_ring_size(&monitor->ring) / (monitor->channels * sizeof(float));
+		uint32_t pad = (uint32_t)os_atomic_load_long(&monitor->device_pad) + (uint32_t)queued;
 
 		if (!process_audio_delay(monitor, (float **)(&resample_data[0]), &resample_frames, ts, pad)) {
 			goto unlock;
 		}
 	}
 
-	IAudioRenderClient *const render = monitor->render;
-	hr = render->lpVtbl->GetBuffer(render, resample_frames, &output);
-	if (FAILED(hr)) {
-		goto free_for_reconnect;
+	bytes = resample_frames * monitor->channels * sizeof(float);
+
+	/* the device is not keeping up, drop rather than add latency */
+	if (spsc_ring_space(&monitor->ring) < bytes) {
+		goto unlock;
 	}
 
-	if (!muted) {
+	if (muted) {
+		memset(resample_data[0], 0, bytes);
+	} else if (!close_float(vol, 1.0f, EPSILON)) {
 		/* apply volume */
-		if (!close_float(vol, 1.0f, EPSILON)) {
-			register float *cur = (float *)resample_data[0];
-			register float *end = cur + resample_frames * monitor->channels;
+		register float *cur = (float *)resample_data[0];
+		register float *end = cur + resample_frames * monitor->channels;
 
-			while (cur < end)
-				*(cur++) *= vol;
-		}
-		memcpy(output, resample_data[0], resample_frames * monitor->channels * sizeof(float));
-	}
-
-	hr = render->lpVtbl->ReleaseBuffer(render, resample_frames, muted ? AUDCLNT_BUFFERFLAGS_SILENT : 0);
-	if (FAILED(hr)) {
-		goto free_for_reconnect;
+		while (cur < end)
+			*(cur++) *= vol;
 	}
 
+	spsc_ring_write(&monitor->ring, 0, resample_data[0], bytes);
+	spsc_ring_commit(&monitor->ring, bytes);
 	goto unlock;
 
 free_for_reconnect:
@@ -359,6 +513,8 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 		obs_source_remove_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 	}
 
+	audio_monitor_stop_thread(monitor);
+
 	if (monitor->client)
 		monitor->client->lpVtbl->Stop(monitor->client);
 
@@ -367,6 +523,12 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 	audio_resampler_destroy(monitor->resampler);
 	deque_free(&monitor->delay_buffer);
 	da_free(monitor->buf);
+
+	spsc_ring_free(&monitor->ring);
+	if (monitor->device_event)
+		CloseHandle(monitor->device_event);
+	if (monitor->stop_event)
+		CloseHandle(monitor->stop_event);
 }
 
 extern bool devices_match(const char *id1, const char *id2);
@@ -404,6 +566,7 @@ static void audio_monitor_init_final(struct audio_monitor *monitor)
 		return;
 
 	monitor->source_has_video = (monitor->source->info.output_flags & OBS_SOURCE_VIDEO) != 0;
+	audio_monitor_start_thread(monitor);
 	obs_source_add_audio_capture_callback(monitor->source, on_audio_playback, monitor);
 }
 
@@ -449,6 +612,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 	}
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	return (uint64_t)os_atomic_load_long(&monitor->latency_us) * 1000;
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
@@ -14,8 +14,22 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+/*
+ *   Emitting a signal takes no locks.  Signals are found through an
+ * open-addressed hash table keyed on a hash of the name, and each signal
+ * publishes an immutable array of callback pointers which emitters walk
+ * directly.  Connecting or disconnecting builds a new array under the signal
+ * mutex and swaps it in.  Replaced arrays and removed callbacks are retired
+ * and only freed once no emitter can still be looking at them.
+ *
+ *   Disconnecting still waits for other threads that are in the middle of
+ * calling that callback, so the callback data can be freed right after
+ * signal_handler_disconnect returns.
+ */
+
 #include "../util/darray.h"
 #include "../util/threading.h"
+#include "../util/platform.h"
 
 #include "decl.h"
 #include "signal.h"
@@ -23,26 +37,110 @@
 struct signal_callback {
 	signal_callback_t callback;
 	void *data;
-	bool remove;
+	volatile long calls;
+	volatile bool remove;
 	bool keep_ref;
 };
 
+struct callback_array {
+	size_t num;
+	struct signal_callback **array;
+};
+
 struct signal_info {
 	struct decl_info func;
-	DARRAY(struct signal_callback) callbacks;
+	uint32_t hash;
+
+	struct callback_array *volatile callbacks;
+	volatile long emitting;
+
+	/* writers only */
 	pthread_mutex_t mutex;
-	bool signalling;
+	DARRAY(void *) retired;
 
 	struct signal_info *next;
 };
 
+/* what the current thread is calling, innermost first */
+struct signal_call {
+	struct signal_info *sig;
+	struct signal_callback *cb;
+	struct signal_call *prev;
+};
+
+static THREAD_LOCAL struct signal_call *current_signal_call = NULL;
+
+static inline uint32_t signal_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static inline struct callback_array *get_callbacks(struct signal_info *si)
+{
+	return os_atomic_load_ptr((void *const volatile *)&si->callbacks);
+}
+
+static inline struct callback_array *callback_array_create(size_t num)
+{
+	struct callback_array *cbs = bmalloc(sizeof(*cbs) + sizeof(struct signal_callback *) * num);
+	cbs->num = num;
+	cbs->array = (struct signal_callback **)(cbs + 1);
+	return cbs;
+}
+
+/* frees everything retired if no emitter is walking an old array, called
+ * with the signal mutex held after a new array has been published */
+static void signal_info_reclaim(struct signal_info *si)
+{
+	if (os_atomic_load_long(&si->emitting) != 0)
+		return;
+
+	for (size_t i = 0; i < si->retired.num; i++)
+		bfree(si->retired.array[i]);
+	da_resize(si->retired, 0);
+}
+
+/* publishes a copy of the current callbacks without the callbacks in
+ * `removed`, plus `added` if set; called with the signal mutex held */
+static void signal_info_replace_callbacks(struct signal_info *si, struct signal_callback *added,
+					  struct signal_callback *removed)
+{
+	struct callback_array *old = get_callbacks(si);
+	struct callback_array *cbs = NULL;
+	size_t old_num = old ? old->num : 0;
+	size_t num = 0;
+
+	if (old_num + (added ? 1 : 0) - (removed ? 1 : 0) > 0) {
+		cbs = callback_array_create(old_num + (added ? 1 : 0));
+
+		for (size_t i = 0; i < old_num; i++) {
+			if (old->array[i] != removed)
+				cbs->array[num++] = old->array[i];
+		}
+		if (added)
+			cbs->array[num++] = added;
+
+		cbs->num = num;
+	}
+
+	os_atomic_store_ptr((void *volatile *)&si->callbacks, cbs);
+
+	if (old)
+		da_push_back(si->retired, &old);
+}
+
 static inline struct signal_info *signal_info_create(struct decl_info *info)
 {
-	struct signal_info *si = bmalloc(sizeof(struct signal_info));
+	struct signal_info *si = bzalloc(sizeof(struct signal_info));
 	si->func = *info;
-	si->next = NULL;
-	si->signalling = false;
-	da_init(si->callbacks);
+	si->hash = signal_name_hash(info->name);
 
 	if (pthread_mutex_init_recursive(&si->mutex) != 0) {
 		blog(LOG_ERROR, "Could not create signal");
@@ -58,23 +156,63 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 static inline void signal_info_destroy(struct signal_info *si)
 {
 	if (si) {
+		struct callback_array *cbs = get_callbacks(si);
+
+		if (cbs) {
+			for (size_t i = 0; i < cbs->num; i++)
+				bfree(cbs->array[i]);
+			bfree(cbs);
+		}
+
+		for (size_t i = 0; i < si->retired.num; i++)
+			bfree(si->retired.array[i]);
+		da_free(si->retired);
+
 		pthread_mutex_destroy(&si->mutex);
 		decl_info_free(&si->func);
-		da_free(si->callbacks);
 		bfree(si);
 	}
 }
 
-static inline size_t signal_get_callback_idx(struct signal_info *si, signal_callback_t callback, void *data)
+static inline struct signal_callback *signal_find_callback(struct signal_info *si, signal_callback_t callback,
+							   void *data)
 {
-	for (size_t i = 0; i < si->callbacks.num; i++) {
-		struct signal_callback *sc = si->callbacks.array + i;
+	struct callback_array *cbs = get_callbacks(si);
+
+	for (size_t i = 0; cbs && i < cbs->num; i++) {
+		struct signal_callback *sc = cbs->array[i];
 
 		if (sc->callback == callback && sc->data == data)
-			return i;
+			return sc;
 	}
 
-	return DARRAY_INVALID;
+	return NULL;
+}
+
+static inline bool signal_in_call(struct signal_info *si)
+{
+	for (struct signal_call *call = current_signal_call; call; call = call->prev) {
+		if (call->sig == si)
+			return true;
+	}
+
+	return false;
+}
+
+/* waits for other threads to return from the callback; calls made by this
+ * thread further up the stack can't finish until this returns, so those
+ * are not waited for */
+static void signal_callback_wait(struct signal_callback *sc)
+{
+	long own = 0;
+
+	for (struct signal_call *call = current_signal_call; call; call = call->prev) {
+		if (call->cb == sc)
+			own++;
+	}
+
+	while (os_atomic_load_long(&sc->calls) > own)
+		os_sleep_ms(1);
 }
 
 struct global_callback_info {
@@ -84,31 +222,91 @@ struct global_callback_info {
 	bool remove;
 };
 
+struct signal_table {
+	size_t mask;
+	struct signal_info *volatile *slots;
+};
+
 struct signal_handler {
 	struct signal_info *first;
+	struct signal_table *volatile table;
+	size_t num_signals;
+	DARRAY(struct signal_table *) retired_tables;
 	pthread_mutex_t mutex;
 	volatile long refs;
 
 	DARRAY(struct global_callback_info) global_callbacks;
 	pthread_mutex_t global_callbacks_mutex;
+	volatile long num_global_callbacks;
 };
 
-static struct signal_info *getsignal(signal_handler_t *handler, const char *name, struct signal_info **p_last)
+static inline struct signal_table *signal_table_create(size_t size)
 {
-	struct signal_info *signal, *last = NULL;
+	struct signal_table *table = bzalloc(sizeof(*table) + sizeof(struct signal_info *) * size);
+	table->mask = size - 1;
+	table->slots = (struct signal_info *volatile *)(table + 1);
+	return table;
+}
 
-	signal = handler->first;
-	while (signal != NULL) {
-		if (strcmp(signal->func.name, name) == 0)
-			break;
+static inline void signal_table_insert(struct signal_table *table, struct signal_info *sig)
+{
+	size_t idx = sig->hash & table->mask;
+
+	while (table->slots[idx])
+		idx = (idx + 1) & table->mask;
+
+	os_atomic_store_ptr((void *volatile *)&table->slots[idx], sig);
+}
+
+/* lock-free; signals are never removed, so a slot that's found empty ends
+ * the probe */
+static struct signal_info *getsignal(signal_handler_t *handler, const char *name)
+{
+	struct signal_table *table = os_atomic_load_ptr((void *const volatile *)&handler->table);
+	uint32_t hash;
+	size_t idx;
+
+	if (!table)
+		return NULL;
+
+	hash = signal_name_hash(name);
+	idx = hash & table->mask;
 
-		last = signal;
-		signal = signal->next;
+	for (;;) {
+		struct signal_info *sig = os_atomic_load_ptr((void *const volatile *)&table->slots[idx]);
+		if (!sig)
+			return NULL;
+		if (sig->hash == hash && strcmp(sig->func.name, name) == 0)
+			return sig;
+
+		idx = (idx + 1) & table->mask;
 	}
+}
+
+/* called with the handler mutex held.  a table that gets replaced is kept
+ * until the handler is destroyed since lookups don't hold any lock */
+static void signal_handler_insert(signal_handler_t *handler, struct signal_info *sig)
+{
+	struct signal_table *table = handler->table;
+
+	if (!table || (handler->num_signals + 1) * 4 > (table->mask + 1) * 3) {
+		size_t size = table ? (table->mask + 1) * 2 : 16;
+		struct signal_table *new_table = signal_table_create(size);
+
+		for (struct signal_info *si = handler->first; si; si = si->next)
+			signal_table_insert(new_table, si);
+
+		os_atomic_store_ptr((void *volatile *)&handler->table, new_table);
+		if (table)
+			da_push_back(handler->retired_tables, &table);
+		table = new_table;
+	}
+
+	sig->next = handler->first;
+	handler->first = sig;
+	handler->num_signals++;
 
-	if (p_last)
-		*p_last = last;
-	return signal;
+	signal_table_insert(table, sig);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -144,6 +342,11 @@ static void signal_handler_actually_destroy(signal_handler_t *handler)
 		sig = next;
 	}
 
+	for (size_t i = 0; i < handler->retired_tables.num; i++)
+		bfree(handler->retired_tables.array[i]);
+	da_free(handler->retired_tables);
+	bfree(handler->table);
+
 	da_free(handler->global_callbacks);
 	pthread_mutex_destroy(&handler->global_callbacks_mutex);
 	pthread_mutex_destroy(&handler->mutex);
@@ -160,7 +363,7 @@ void signal_handler_destroy(signal_handler_t *handler)
 bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 {
 	struct decl_info func = {0};
-	struct signal_info *sig, *last;
+	struct signal_info *sig;
 	bool success = true;
 
 	if (!parse_decl_string(&func, signal_decl)) {
@@ -170,17 +373,17 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 
 	pthread_mutex_lock(&handler->mutex);
 
-	sig = getsignal(handler, func.name, &last);
+	sig = getsignal(handler, func.name);
 	if (sig) {
 		blog(LOG_WARNING, "Signal declaration '%s' exists", func.name);
 		decl_info_free(&func);
 		success = false;
 	} else {
 		sig = signal_info_create(&func);
-		if (!last)
-			handler->first = sig;
+		if (sig)
+			signal_handler_insert(handler, sig);
 		else
-			last->next = sig;
+			success = false;
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -191,17 +394,12 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 static void signal_handler_connect_internal(signal_handler_t *handler, const char *signal, signal_callback_t callback,
 					    void *data, bool keep_ref)
 {
-	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false, keep_ref};
-	size_t idx;
+	struct signal_info *sig;
 
 	if (!handler)
 		return;
 
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, signal, &last);
-	pthread_mutex_unlock(&handler->mutex);
-
+	sig = getsignal(handler, signal);
 	if (!sig) {
 		blog(LOG_WARNING,
 		     "signal_handler_connect: "
@@ -217,9 +415,15 @@ static void signal_handler_connect_internal(signal_handler_t *handler, const cha
 	if (keep_ref)
 		os_atomic_inc_long(&handler->refs);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (keep_ref || idx == DARRAY_INVALID)
-		da_push_back(sig->callbacks, &cb_data);
+	if (keep_ref || !signal_find_callback(sig, callback, data)) {
+		struct signal_callback *cb = bzalloc(sizeof(*cb));
+		cb->callback = callback;
+		cb->data = data;
+		cb->keep_ref = keep_ref;
+
+		signal_info_replace_callbacks(sig, cb, NULL);
+		signal_info_reclaim(sig);
+	}
 
 	pthread_mutex_unlock(&sig->mutex);
 }
@@ -234,95 +438,133 @@ void signal_handler_connect_ref(signal_handler_t *handler, const char *signal, s
 	signal_handler_connect_internal(handler, signal, callback, data, true);
 }
 
-static inline struct signal_info *getsignal_locked(signal_handler_t *handler, const char *name)
-{
-	struct signal_info *sig;
-
-	if (!handler)
-		return NULL;
-
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, name, NULL);
-	pthread_mutex_unlock(&handler->mutex);
-
-	return sig;
-}
-
 void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct signal_info *sig = handler ? getsignal(handler, signal) : NULL;
+	struct signal_callback *cb;
 	bool keep_ref = false;
-	size_t idx;
 
 	if (!sig)
 		return;
 
 	pthread_mutex_lock(&sig->mutex);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (idx != DARRAY_INVALID) {
-		if (sig->signalling) {
-			sig->callbacks.array[idx].remove = true;
-		} else {
-			keep_ref = sig->callbacks.array[idx].keep_ref;
-			da_erase(sig->callbacks, idx);
-		}
+	cb = signal_find_callback(sig, callback, data);
+	if (cb) {
+		os_atomic_store_bool(&cb->remove, true);
+		signal_info_replace_callbacks(sig, NULL, cb);
 	}
 
 	pthread_mutex_unlock(&sig->mutex);
 
-	if (keep_ref && os_atomic_dec_long(&handler->refs) == 0) {
-		signal_handler_actually_destroy(handler);
+	if (!cb)
+		return;
+
+	/* the callback hasn't been retired yet, so it can't be freed while
+	 * waiting on it */
+	signal_callback_wait(cb);
+	keep_ref = cb->keep_ref;
+
+	pthread_mutex_lock(&sig->mutex);
+	da_push_back(sig->retired, &cb);
+	signal_info_reclaim(sig);
+	pthread_mutex_unlock(&sig->mutex);
+
+	if (keep_ref) {
+		/* don't destroy the handler out from under a signal this
+		 * thread is still emitting */
+		if (signal_in_call(sig))
+			os_atomic_dec_long(&handler->refs);
+		else if (os_atomic_dec_long(&handler->refs) == 0)
+			signal_handler_actually_destroy(handler);
 	}
 }
 
-static THREAD_LOCAL struct signal_callback *current_signal_cb = NULL;
 static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
 
 void signal_handler_remove_current(void)
 {
-	if (current_signal_cb)
-		current_signal_cb->remove = true;
+	if (current_signal_call)
+		os_atomic_store_bool(&current_signal_call->cb->remove, true);
 	else if (current_global_cb)
 		current_global_cb->remove = true;
 }
 
+/* drops callbacks removed with signal_handler_remove_current, returning how
+ * many handler references they held */
+static long signal_info_purge(struct signal_info *sig)
+{
+	long remove_refs = 0;
+
+	pthread_mutex_lock(&sig->mutex);
+
+	for (;;) {
+		struct callback_array *cbs = get_callbacks(sig);
+		struct signal_callback *removed = NULL;
+
+		for (size_t i = 0; cbs && i < cbs->num; i++) {
+			if (os_atomic_load_bool(&cbs->array[i]->remove)) {
+				removed = cbs->array[i];
+				break;
+			}
+		}
+
+		if (!removed)
+			break;
+
+		if (removed->keep_ref)
+			remove_refs++;
+
+		signal_info_replace_callbacks(sig, NULL, removed);
+		da_push_back(sig->retired, &removed);
+	}
+
+	signal_info_reclaim(sig);
+	pthread_mutex_unlock(&sig->mutex);
+
+	return remove_refs;
+}
+
 void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct signal_info *sig = handler ? getsignal(handler, signal) : NULL;
+	struct callback_array *cbs;
 	long remove_refs = 0;
+	bool purge = false;
 
 	if (!sig)
 		return;
 
-	pthread_mutex_lock(&sig->mutex);
-	sig->signalling = true;
+	/* keeps everything reachable from the array alive until the
+	 * decrement below */
+	os_atomic_inc_long(&sig->emitting);
+	cbs = get_callbacks(sig);
 
-	for (size_t i = 0; i < sig->callbacks.num; i++) {
-		struct signal_callback *cb = sig->callbacks.array + i;
-		if (!cb->remove) {
-			current_signal_cb = cb;
-			cb->callback(cb->data, params);
-			current_signal_cb = NULL;
-		}
-	}
+	for (size_t i = 0; cbs && i < cbs->num; i++) {
+		struct signal_callback *cb = cbs->array[i];
 
-	for (size_t i = sig->callbacks.num; i > 0; i--) {
-		struct signal_callback *cb = sig->callbacks.array + i - 1;
-		if (cb->remove) {
-			if (cb->keep_ref)
-				remove_refs++;
+		os_atomic_inc_long(&cb->calls);
+		if (!os_atomic_load_bool(&cb->remove)) {
+			struct signal_call call = {sig, cb, current_signal_call};
 
-			da_erase(sig->callbacks, i - 1);
+			current_signal_call = &call;
+			cb->callback(cb->data, params);
+			current_signal_call = call.prev;
 		}
+		os_atomic_dec_long(&cb->calls);
+
+		if (os_atomic_load_bool(&cb->remove))
+			purge = true;
 	}
 
-	sig->signalling = false;
-	pthread_mutex_unlock(&sig->mutex);
+	os_atomic_dec_long(&sig->emitting);
 
-	pthread_mutex_lock(&handler->global_callbacks_mutex);
+	if (purge)
+		remove_refs = signal_info_purge(sig);
+
+	if (os_atomic_load_long(&handler->num_global_callbacks)) {
+		pthread_mutex_lock(&handler->global_callbacks_mutex);
 
-	if (handler->global_callbacks.num) {
 		for (size_t i = 0; i < handler->global_callbacks.num; i++) {
 			struct global_callback_info *cb = handler->global_callbacks.array + i;
 
@@ -341,9 +583,10 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal, callda
 			if (cb->remove && !cb->signaling)
 				da_erase(handler->global_callbacks, i - 1);
 		}
-	}
 
-	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+		os_atomic_store_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
+		pthread_mutex_unlock(&handler->global_callbacks_mutex);
+	}
 
 	if (remove_refs) {
 		os_atomic_set_long(&handler->refs, os_atomic_load_long(&handler->refs) - remove_refs);
@@ -364,6 +607,7 @@ void signal_handler_connect_global(signal_handler_t *handler, global_signal_call
 	if (idx == DARRAY_INVALID)
 		da_push_back(handler->global_callbacks, &cb_data);
 
+	os_atomic_store_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
 
@@ -387,5 +631,6 @@ void signal_handler_disconnect_global(signal_handler_t *handler, global_signal_c
 			da_erase(handler->global_callbacks, idx);
 	}
 
+	os_atomic_store_long(&handler->num_global_callbacks, (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
@@ -1354,10 +1354,15 @@ static void debug_print_string(const char *offset, const char *str)
 
 bool ep_parse(struct effect_parser *ep, gs_effect_t *effect, const char *effect_string, const char *file)
 {
-	bool success;
+	if (!ep_parse_source(ep, gs_preprocessor_name(), effect_string, file))
+		return false;
 
-	const char *graphics_preprocessor = gs_preprocessor_name();
+	return ep_compile_effect(ep, effect);
+}
 
+bool ep_parse_source(struct effect_parser *ep, const char *graphics_preprocessor, const char *effect_string,
+		     const char *file)
+{
 	if (graphics_preprocessor) {
 		struct cf_def def;
 
@@ -1369,7 +1374,6 @@ bool ep_parse(struct effect_parser *ep, gs_effect_t *effect, const char *effect_
 		cf_preprocessor_add_def(&ep->cfp.pp, &def);
 	}
 
-	ep->effect = effect;
 	if (!cf_parser_parse(&ep->cfp, effect_string, file))
 		return false;
 
@@ -1404,9 +1408,15 @@ bool ep_parse(struct effect_parser *ep, gs_effect_t *effect, const char *effect_
 	debug_print_string("\t", ep->cfp.lex.reformatted);
 #endif
 
-	success = !error_data_has_errors(&ep->cfp.error_list);
-	if (success)
-		success = ep_compile(ep);
+	return !error_data_has_errors(&ep->cfp.error_list);
+}
+
+bool ep_compile_effect(struct effect_parser *ep, gs_effect_t *effect)
+{
+	bool success;
+
+	ep->effect = effect;
+	success = ep_compile(ep);
 
 #if defined(_DEBUG) && defined(_DEBUG_SHADERS)
 	blog(LOG_DEBUG, "================================================================================");
@@ -285,6 +285,12 @@ extern void ep_free(struct effect_parser *ep);
 
 extern bool ep_parse(struct effect_parser *ep, gs_effect_t *effect, const char *effect_string, const char *file);
 
+/* parsing does not touch the graphics device and may run on any thread,
+ * compiling creates the shaders and needs the graphics context */
+extern bool ep_parse_source(struct effect_parser *ep, const char *preprocessor, const char *effect_string,
+			    const char *file);
+extern bool ep_compile_effect(struct effect_parser *ep, gs_effect_t *effect);
+
 #ifdef __cplusplus
 }
 #endif
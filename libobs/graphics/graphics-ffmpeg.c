@@ -368,13 +368,13 @@ static void *ffmpeg_image_reformat_frame(struct ffmpeg_image *info, AVFrame *fra
 			const size_t row_elements = min_line >> 2;
 			if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
 				for (int y = 0; y < info->cy; y++) {
-					gs_premultiply_xyza_srgb_loop_restrict(dst, src, row_elements);
+					gs_premultiply_rgba8_srgb(dst, src, row_elements);
 					dst += linesize;
 					src += src_linesize;
 				}
 			} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
 				for (int y = 0; y < info->cy; y++) {
-					gs_premultiply_xyza_loop_restrict(dst, src, row_elements);
+					gs_premultiply_rgba8(dst, src, row_elements);
 					dst += linesize;
 					src += src_linesize;
 				}
@@ -487,9 +487,9 @@ static void *ffmpeg_image_reformat_frame(struct ffmpeg_image *info, AVFrame *fra
 		av_freep(pointers);
 
 		if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-			gs_premultiply_xyza_srgb_loop(data, (size_t)info->cx * info->cy);
+			gs_premultiply_rgba8_srgb(data, data, (size_t)info->cx * info->cy);
 		} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-			gs_premultiply_xyza_loop(data, (size_t)info->cx * info->cy);
+			gs_premultiply_rgba8(data, data, (size_t)info->cx * info->cy);
 		}
 
 		info->format = format;
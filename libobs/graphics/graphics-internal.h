@@ -158,6 +158,7 @@ struct gs_exports {
 	void (*gs_vertexbuffer_destroy)(gs_vertbuffer_t *vertbuffer);
 	void (*gs_vertexbuffer_flush)(gs_vertbuffer_t *vertbuffer);
 	void (*gs_vertexbuffer_flush_direct)(gs_vertbuffer_t *vertbuffer, const struct gs_vb_data *data);
+	void (*gs_vertexbuffer_flush_range)(gs_vertbuffer_t *vertbuffer, size_t start, size_t count, bool discard);
 	struct gs_vb_data *(*gs_vertexbuffer_get_data)(const gs_vertbuffer_t *vertbuffer);
 
 	void (*gs_indexbuffer_destroy)(gs_indexbuffer_t *indexbuffer);
@@ -232,6 +233,7 @@ struct gs_exports {
 	gs_texture_t *(*gs_duplicator_get_texture)(gs_duplicator_t *duplicator);
 	enum gs_color_space (*gs_duplicator_get_color_space)(gs_duplicator_t *duplicator);
 	float (*gs_duplicator_get_sdr_white_level)(gs_duplicator_t *duplicator);
+	void (*gs_duplicator_get_stats)(gs_duplicator_t *duplicator, struct gs_duplicator_stats *stats);
 
 	bool (*device_can_adapter_fast_clear)(gs_device_t *device);
 
@@ -285,6 +287,14 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+struct gs_memory_scope {
+	enum gs_memory_category category;
+	const void *owner;
+};
+
+struct gs_memory_alloc;
+struct gs_memory_owner;
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -299,10 +309,14 @@ struct graphics_subsystem {
 	struct gs_effect *cur_effect;
 
 	gs_vertbuffer_t *sprite_buffer;
+	gs_vertbuffer_t *sprite_batch_buffer;
+	size_t sprite_batch_capacity;
 
 	bool using_immediate;
 	struct gs_vb_data *vbd;
 	gs_vertbuffer_t *immediate_vertbuffer;
+	size_t immediate_pos;
+	bool immediate_discard;
 	DARRAY(struct vec3) verts;
 	DARRAY(struct vec3) norms;
 	DARRAY(uint32_t) colors;
@@ -310,6 +324,7 @@ struct graphics_subsystem {
 
 	pthread_mutex_t effect_mutex;
 	struct gs_effect *first_effect;
+	struct effect_preparse *first_preparse;
 
 	pthread_mutex_t mutex;
 	volatile long ref;
@@ -317,5 +332,25 @@ struct graphics_subsystem {
 	struct blend_state cur_blend_state;
 	DARRAY(struct blend_state) blend_state_stack;
 
+	pthread_mutex_t memory_mutex;
+	struct gs_memory_alloc *memory_allocs;
+	struct gs_memory_owner *memory_owners;
+	uint64_t memory_usage[GS_MEMORY_CATEGORY_COUNT];
+	uint64_t memory_total;
+	uint64_t memory_budget;
+	DARRAY(struct gs_memory_scope) memory_scopes;
+
 	bool linear_srgb;
 };
+
+extern void gs_texrender_pool_free(void);
+
+extern void gs_memory_track(graphics_t *graphics, const void *obj, enum gs_memory_category category, uint64_t size);
+extern void gs_memory_untrack(graphics_t *graphics, const void *obj);
+extern void gs_memory_set_owner(graphics_t *graphics, const void *obj, const void *owner);
+extern const void *gs_memory_current_owner(graphics_t *graphics);
+extern enum gs_memory_category gs_memory_current_category(graphics_t *graphics);
+extern void gs_memory_free(graphics_t *graphics);
+extern uint64_t gs_texture_memory_size(uint32_t width, uint32_t height, uint32_t depth, enum gs_color_format format,
+				       uint32_t levels);
+extern uint64_t gs_zstencil_memory_size(uint32_t width, uint32_t height, enum gs_zstencil_format format);
@@ -0,0 +1,326 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Tracks the memory of the textures, stage surfaces and z-stencil buffers
+ * created through the graphics subsystem.  Sizes are estimated from the
+ * dimensions and format when the object is created, so this works the same
+ * on every backend.  The tables have their own mutex so the totals can be
+ * read without entering the graphics context.
+ */
+
+#include <inttypes.h>
+
+#include "../util/uthash.h"
+#include "../util/bmem.h"
+#include "graphics-internal.h"
+
+struct gs_memory_alloc {
+	/* the object pointer is the hashtable key */
+	uintptr_t key;
+
+	enum gs_memory_category category;
+	const void *owner;
+	uint64_t size;
+
+	UT_hash_handle hh;
+};
+
+struct gs_memory_owner {
+	/* the owner pointer is the hashtable key */
+	uintptr_t key;
+
+	uint64_t size;
+
+	UT_hash_handle hh;
+};
+
+static const char *category_names[GS_MEMORY_CATEGORY_COUNT] = {
+	"other", "texrender", "staging", "async", "image", "filter",
+};
+
+static void owner_add(graphics_t *graphics, const void *owner, uint64_t size)
+{
+	struct gs_memory_owner *entry;
+	uintptr_t key = (uintptr_t)owner;
+
+	if (!owner)
+		return;
+
+	HASH_FIND_PTR(graphics->memory_owners, &key, entry);
+	if (!entry) {
+		entry = bzalloc(sizeof(*entry));
+		entry->key = key;
+		HASH_ADD_PTR(graphics->memory_owners, key, entry);
+	}
+
+	entry->size += size;
+}
+
+static void owner_remove(graphics_t *graphics, const void *owner, uint64_t size)
+{
+	struct gs_memory_owner *entry;
+	uintptr_t key = (uintptr_t)owner;
+
+	if (!owner)
+		return;
+
+	HASH_FIND_PTR(graphics->memory_owners, &key, entry);
+	if (!entry)
+		return;
+
+	entry->size -= size < entry->size ? size : entry->size;
+	if (!entry->size) {
+		HASH_DEL(graphics->memory_owners, entry);
+		bfree(entry);
+	}
+}
+
+static inline struct gs_memory_scope *current_scope(graphics_t *graphics)
+{
+	return graphics->memory_scopes.num ? da_end(graphics->memory_scopes) : NULL;
+}
+
+void gs_memory_track(graphics_t *graphics, const void *obj, enum gs_memory_category category, uint64_t size)
+{
+	struct gs_memory_scope *scope = current_scope(graphics);
+	struct gs_memory_alloc *alloc;
+
+	if (!obj || !size)
+		return;
+
+	if (category == GS_MEMORY_OTHER && scope)
+		category = scope->category;
+
+	alloc = bzalloc(sizeof(*alloc));
+	alloc->key = (uintptr_t)obj;
+	alloc->category = category;
+	alloc->owner = scope ? scope->owner : NULL;
+	alloc->size = size;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	HASH_ADD_PTR(graphics->memory_allocs, key, alloc);
+	graphics->memory_usage[category] += size;
+	graphics->memory_total += size;
+	owner_add(graphics, alloc->owner, size);
+	pthread_mutex_unlock(&graphics->memory_mutex);
+}
+
+void gs_memory_untrack(graphics_t *graphics, const void *obj)
+{
+	struct gs_memory_alloc *alloc;
+	uintptr_t key = (uintptr_t)obj;
+
+	if (!obj)
+		return;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	HASH_FIND_PTR(graphics->memory_allocs, &key, alloc);
+	if (alloc) {
+		HASH_DEL(graphics->memory_allocs, alloc);
+		graphics->memory_usage[alloc->category] -= alloc->size;
+		graphics->memory_total -= alloc->size;
+		owner_remove(graphics, alloc->owner, alloc->size);
+	}
+	pthread_mutex_unlock(&graphics->memory_mutex);
+
+	bfree(alloc);
+}
+
+void gs_memory_set_owner(graphics_t *graphics, const void *obj, const void *owner)
+{
+	struct gs_memory_alloc *alloc;
+	uintptr_t key = (uintptr_t)obj;
+
+	if (!graphics || !obj)
+		return;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	HASH_FIND_PTR(graphics->memory_allocs, &key, alloc);
+	if (alloc && alloc->owner != owner) {
+		owner_remove(graphics, alloc->owner, alloc->size);
+		owner_add(graphics, owner, alloc->size);
+		alloc->owner = owner;
+	}
+	pthread_mutex_unlock(&graphics->memory_mutex);
+}
+
+const void *gs_memory_current_owner(graphics_t *graphics)
+{
+	struct gs_memory_scope *scope = graphics ? current_scope(graphics) : NULL;
+	return scope ? scope->owner : NULL;
+}
+
+enum gs_memory_category gs_memory_current_category(graphics_t *graphics)
+{
+	struct gs_memory_scope *scope = graphics ? current_scope(graphics) : NULL;
+	return scope ? scope->category : GS_MEMORY_OTHER;
+}
+
+void gs_memory_free(graphics_t *graphics)
+{
+	struct gs_memory_alloc *alloc, *tmp;
+	struct gs_memory_owner *owner, *otmp;
+
+	if (graphics->memory_total) {
+		blog(LOG_DEBUG, "gs_memory_free: %" PRIu64 " bytes of graphics memory were not freed",
+		     graphics->memory_total);
+	}
+
+	HASH_ITER (hh, graphics->memory_allocs, alloc, tmp) {
+		HASH_DEL(graphics->memory_allocs, alloc);
+		bfree(alloc);
+	}
+
+	HASH_ITER (hh, graphics->memory_owners, owner, otmp) {
+		HASH_DEL(graphics->memory_owners, owner);
+		bfree(owner);
+	}
+
+	da_free(graphics->memory_scopes);
+}
+
+uint64_t gs_texture_memory_size(uint32_t width, uint32_t height, uint32_t depth, enum gs_color_format format,
+				uint32_t levels)
+{
+	const uint64_t bpp = gs_get_format_bpp(format);
+	uint64_t size = 0;
+
+	if (!levels)
+		levels = gs_get_total_levels(width, height, depth);
+
+	for (uint32_t i = 0; i < levels; i++) {
+		size += (uint64_t)width * height * depth * bpp / 8;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		depth = depth > 1 ? depth / 2 : 1;
+	}
+
+	return size;
+}
+
+uint64_t gs_zstencil_memory_size(uint32_t width, uint32_t height, enum gs_zstencil_format format)
+{
+	uint64_t bytes = 0;
+
+	switch (format) {
+	case GS_ZS_NONE:
+		bytes = 0;
+		break;
+	case GS_Z16:
+		bytes = 2;
+		break;
+	case GS_Z24_S8:
+	case GS_Z32F:
+		bytes = 4;
+		break;
+	case GS_Z32F_S8X24:
+		bytes = 8;
+		break;
+	}
+
+	return (uint64_t)width * height * bytes;
+}
+
+void gs_memory_push_scope(enum gs_memory_category category, const void *owner)
+{
+	graphics_t *graphics = gs_get_context();
+	struct gs_memory_scope *parent;
+	struct gs_memory_scope scope;
+
+	if (!graphics) {
+		blog(LOG_DEBUG, "gs_memory_push_scope: called while not in a graphics context");
+		return;
+	}
+
+	parent = current_scope(graphics);
+	scope.category = category;
+	scope.owner = owner;
+
+	/* a new owner starts over, so a source rendered inside a filter's
+	 * scope isn't counted under the filter's category */
+	if (parent && (!owner || owner == parent->owner)) {
+		if (category == GS_MEMORY_OTHER)
+			scope.category = parent->category;
+		scope.owner = parent->owner;
+	}
+
+	da_push_back(graphics->memory_scopes, &scope);
+}
+
+void gs_memory_pop_scope(void)
+{
+	graphics_t *graphics = gs_get_context();
+
+	if (!graphics || !graphics->memory_scopes.num) {
+		blog(LOG_DEBUG, "gs_memory_pop_scope: no scope to pop");
+		return;
+	}
+
+	da_pop_back(graphics->memory_scopes);
+}
+
+void gs_get_memory_usage(graphics_t *graphics, struct gs_memory_usage *usage)
+{
+	memset(usage, 0, sizeof(*usage));
+
+	if (!graphics)
+		return;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	usage->total = graphics->memory_total;
+	usage->budget = graphics->memory_budget;
+	memcpy(usage->categories, graphics->memory_usage, sizeof(usage->categories));
+	pthread_mutex_unlock(&graphics->memory_mutex);
+}
+
+uint64_t gs_get_owner_memory_usage(graphics_t *graphics, const void *owner)
+{
+	struct gs_memory_owner *entry;
+	uintptr_t key = (uintptr_t)owner;
+	uint64_t size = 0;
+
+	if (!graphics || !owner)
+		return 0;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	HASH_FIND_PTR(graphics->memory_owners, &key, entry);
+	if (entry)
+		size = entry->size;
+	pthread_mutex_unlock(&graphics->memory_mutex);
+
+	return size;
+}
+
+void gs_set_memory_budget(graphics_t *graphics, uint64_t budget)
+{
+	if (!graphics)
+		return;
+
+	pthread_mutex_lock(&graphics->memory_mutex);
+	graphics->memory_budget = budget;
+	pthread_mutex_unlock(&graphics->memory_mutex);
+}
+
+const char *gs_memory_category_name(enum gs_memory_category category)
+{
+	if (category < 0 || category >= GS_MEMORY_CATEGORY_COUNT)
+		return "unknown";
+
+	return category_names[category];
+}
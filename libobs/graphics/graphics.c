@@ -20,6 +20,7 @@
 #include "../util/base.h"
 #include "../util/bmem.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
 #include "graphics-internal.h"
 #include "vec2.h"
 #include "vec3.h"
@@ -68,6 +69,11 @@ static inline bool gs_valid(const char *f)
 
 #define IMMEDIATE_COUNT 512
 
+/* immediate mode vertices are appended to a ring of this many vertices, so
+ * each gs_render_stop only uploads its own range and only wraps (and
+ * discards the buffer) once every IMMEDIATE_RING_COUNT vertices */
+#define IMMEDIATE_RING_COUNT (IMMEDIATE_COUNT * 8)
+
 void gs_enum_adapters(bool (*callback)(void *param, const char *name, uint32_t id), void *param)
 {
 	graphics_t *graphics = thread_graphics;
@@ -89,6 +95,7 @@ void gs_enum_adapters(bool (*callback)(void *param, const char *name, uint32_t i
 
 extern void gs_init_image_deps(void);
 extern void gs_free_image_deps(void);
+extern void gs_image_file_free_shared(void);
 
 bool load_graphics_imports(struct gs_exports *exports, void *module, const char *module_name);
 
@@ -97,20 +104,22 @@ static bool graphics_init_immediate_vb(struct graphics_subsystem *graphics)
 	struct gs_vb_data *vbd;
 
 	vbd = gs_vbdata_create();
-	vbd->num = IMMEDIATE_COUNT;
-	vbd->points = bmalloc(sizeof(struct vec3) * IMMEDIATE_COUNT);
-	vbd->normals = bmalloc(sizeof(struct vec3) * IMMEDIATE_COUNT);
-	vbd->colors = bmalloc(sizeof(uint32_t) * IMMEDIATE_COUNT);
+	vbd->num = IMMEDIATE_RING_COUNT;
+	vbd->points = bzalloc(sizeof(struct vec3) * IMMEDIATE_RING_COUNT);
+	vbd->normals = bzalloc(sizeof(struct vec3) * IMMEDIATE_RING_COUNT);
+	vbd->colors = bzalloc(sizeof(uint32_t) * IMMEDIATE_RING_COUNT);
 	vbd->num_tex = 1;
 	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
 	vbd->tvarray[0].width = 2;
-	vbd->tvarray[0].array = bmalloc(sizeof(struct vec2) * IMMEDIATE_COUNT);
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * IMMEDIATE_RING_COUNT);
 
 	graphics->immediate_vertbuffer =
 		graphics->exports.device_vertexbuffer_create(graphics->device, vbd, GS_DYNAMIC);
 	if (!graphics->immediate_vertbuffer)
 		return false;
 
+	graphics->immediate_pos = 0;
+	graphics->immediate_discard = true;
 	return true;
 }
 
@@ -153,6 +162,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&graphics->memory_mutex, NULL) != 0)
+		return false;
 
 	graphics->exports.device_blend_function_separate(graphics->device, GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA,
 							 GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
@@ -178,6 +189,7 @@ int gs_create(graphics_t **pgraphics, const char *module, uint32_t adapter)
 	graphics_t *graphics = bzalloc(sizeof(struct graphics_subsystem));
 	pthread_mutex_init_value(&graphics->mutex);
 	pthread_mutex_init_value(&graphics->effect_mutex);
+	pthread_mutex_init_value(&graphics->memory_mutex);
 
 	graphics->module = os_dlopen(module);
 	if (!graphics->module) {
@@ -227,15 +239,23 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		gs_effect_preparse_clear();
+
+		gs_texrender_pool_free();
+
 		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_buffer);
+		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_batch_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
 
 		thread_graphics = NULL;
 	}
 
+	gs_memory_free(graphics);
+
 	pthread_mutex_destroy(&graphics->mutex);
 	pthread_mutex_destroy(&graphics->effect_mutex);
+	pthread_mutex_destroy(&graphics->memory_mutex);
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
 	da_free(graphics->blend_state_stack);
@@ -244,6 +264,7 @@ void gs_destroy(graphics_t *graphics)
 	bfree(graphics);
 
 	gs_free_image_deps();
+	gs_image_file_free_shared();
 }
 
 void gs_enter_context(graphics_t *graphics)
@@ -508,13 +529,20 @@ void gs_render_start(bool b_new)
 	if (b_new) {
 		graphics->vbd = gs_vbdata_create();
 	} else {
+		size_t pos = graphics->immediate_pos;
+
+		if (pos + IMMEDIATE_COUNT > IMMEDIATE_RING_COUNT) {
+			graphics->immediate_pos = pos = 0;
+			graphics->immediate_discard = true;
+		}
+
 		graphics->vbd = gs_vertexbuffer_get_data(graphics->immediate_vertbuffer);
-		memset(graphics->vbd->colors, 0xFF, sizeof(uint32_t) * IMMEDIATE_COUNT);
+		memset(graphics->vbd->colors + pos, 0xFF, sizeof(uint32_t) * IMMEDIATE_COUNT);
 
-		graphics->verts.array = graphics->vbd->points;
-		graphics->norms.array = graphics->vbd->normals;
-		graphics->colors.array = graphics->vbd->colors;
-		graphics->texverts[0].array = graphics->vbd->tvarray[0].array;
+		graphics->verts.array = graphics->vbd->points + pos;
+		graphics->norms.array = graphics->vbd->normals + pos;
+		graphics->colors.array = graphics->vbd->colors + pos;
+		graphics->texverts[0].array = (struct vec2 *)graphics->vbd->tvarray[0].array + pos;
 
 		graphics->verts.capacity = IMMEDIATE_COUNT;
 		graphics->norms.capacity = IMMEDIATE_COUNT;
@@ -569,11 +597,17 @@ void gs_render_stop(enum gs_draw_mode mode)
 	}
 
 	if (graphics->using_immediate) {
-		gs_vertexbuffer_flush(graphics->immediate_vertbuffer);
+		size_t start = graphics->immediate_pos;
+
+		/* vertices before this range may still be in flight, so only
+		 * discard the buffer when the ring wrapped */
+		gs_vertexbuffer_flush_range(graphics->immediate_vertbuffer, start, num, graphics->immediate_discard);
+		graphics->immediate_discard = false;
+		graphics->immediate_pos += num;
 
 		gs_load_vertexbuffer(graphics->immediate_vertbuffer);
 		gs_load_indexbuffer(NULL);
-		gs_draw(mode, 0, (uint32_t)num);
+		gs_draw(mode, (uint32_t)start, (uint32_t)num);
 
 		reset_immediate_arrays(graphics);
 	} else {
@@ -777,47 +811,208 @@ static inline struct gs_effect *find_cached_effect(const char *filename)
 	return effect;
 }
 
-gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
+/* ------------------------------------------------------------------------- */
+/* effect preparsing */
+
+#define MAX_EFFECT_PARSE_THREADS 8
+
+extern const char *gs_preprocessor_name(void);
+
+struct effect_preparse {
+	char *file;
+	struct effect_parser parser;
+	bool success;
+	uint64_t parse_ns;
+	struct effect_preparse *next;
+};
+
+struct effect_preparse_job {
+	const char *preprocessor;
+	struct effect_preparse **entries;
+	size_t count;
+	volatile long next_entry;
+};
+
+static void effect_preparse_free(struct effect_preparse *entry)
 {
-	char *file_string;
-	gs_effect_t *effect = NULL;
+	ep_free(&entry->parser);
+	bfree(entry->file);
+	bfree(entry);
+}
 
-	if (!gs_valid_p("gs_effect_create_from_file", file))
-		return NULL;
+static void *effect_preparse_thread(void *param)
+{
+	struct effect_preparse_job *job = param;
 
-	effect = find_cached_effect(file);
-	if (effect)
-		return effect;
+	for (;;) {
+		size_t idx = (size_t)os_atomic_inc_long(&job->next_entry) - 1;
+		if (idx >= job->count)
+			break;
 
-	file_string = os_quick_read_utf8_file(file);
-	if (!file_string) {
-		blog(LOG_ERROR, "Could not load effect file '%s'", file);
-		return NULL;
+		struct effect_preparse *entry = job->entries[idx];
+		uint64_t start = os_gettime_ns();
+
+		char *file_string = os_quick_read_utf8_file(entry->file);
+		if (file_string) {
+			entry->success = ep_parse_source(&entry->parser, job->preprocessor, file_string, entry->file);
+			bfree(file_string);
+		}
+
+		entry->parse_ns = os_gettime_ns() - start;
 	}
 
-	effect = gs_effect_create(file_string, file, error_string);
-	bfree(file_string);
+	return NULL;
+}
 
-	return effect;
+static bool effect_preparse_known(graphics_t *graphics, struct effect_preparse_job *job, const char *file)
+{
+	if (find_cached_effect(file))
+		return true;
+
+	for (struct effect_preparse *entry = graphics->first_preparse; entry; entry = entry->next) {
+		if (strcmp(entry->file, file) == 0)
+			return true;
+	}
+
+	for (size_t i = 0; i < job->count; i++) {
+		if (strcmp(job->entries[i]->file, file) == 0)
+			return true;
+	}
+
+	return false;
 }
 
-gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, char **error_string)
+void gs_effect_preparse_files(const char *const *files, size_t count)
 {
-	if (!gs_valid_p("gs_effect_create", effect_string))
-		return NULL;
+	graphics_t *graphics = thread_graphics;
+	struct effect_preparse_job job = {0};
+	uint64_t parse_ns = 0;
+	size_t parsed = 0;
+
+	if (!gs_valid("gs_effect_preparse_files") || !files || !count)
+		return;
 
+	uint64_t start = os_gettime_ns();
+
+	job.preprocessor = gs_preprocessor_name();
+	job.entries = bmalloc(count * sizeof(*job.entries));
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+
+	for (size_t i = 0; i < count; i++) {
+		if (!files[i] || effect_preparse_known(graphics, &job, files[i]))
+			continue;
+
+		struct effect_preparse *entry = bzalloc(sizeof(*entry));
+		entry->file = bstrdup(files[i]);
+		ep_init(&entry->parser);
+		job.entries[job.count++] = entry;
+	}
+
+	pthread_mutex_unlock(&graphics->effect_mutex);
+
+	size_t num_threads = (size_t)os_get_logical_cores();
+	if (num_threads > MAX_EFFECT_PARSE_THREADS)
+		num_threads = MAX_EFFECT_PARSE_THREADS;
+	if (num_threads > job.count)
+		num_threads = job.count;
+
+	/* the calling thread parses as well */
+	pthread_t threads[MAX_EFFECT_PARSE_THREADS];
+	size_t started = 0;
+	while (started + 1 < num_threads) {
+		if (pthread_create(&threads[started], NULL, effect_preparse_thread, &job) != 0)
+			break;
+		started++;
+	}
+
+	effect_preparse_thread(&job);
+
+	for (size_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+
+	for (size_t i = 0; i < job.count; i++) {
+		struct effect_preparse *entry = job.entries[i];
+		parse_ns += entry->parse_ns;
+
+		/* failures are parsed again on creation to report the errors */
+		if (!entry->success) {
+			effect_preparse_free(entry);
+			continue;
+		}
+
+		entry->next = graphics->first_preparse;
+		graphics->first_preparse = entry;
+		parsed++;
+	}
+
+	pthread_mutex_unlock(&graphics->effect_mutex);
+
+	if (job.count)
+		blog(LOG_INFO, "Parsed %zu effects on %zu threads in %.2f ms (%.2f ms of parsing)", parsed,
+		     started + 1, (double)(os_gettime_ns() - start) / 1000000.0, (double)parse_ns / 1000000.0);
+
+	bfree(job.entries);
+}
+
+void gs_effect_preparse_clear(void)
+{
+	graphics_t *graphics = thread_graphics;
+	size_t unused = 0;
+
+	if (!gs_valid("gs_effect_preparse_clear"))
+		return;
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+
+	while (graphics->first_preparse) {
+		struct effect_preparse *next = graphics->first_preparse->next;
+		effect_preparse_free(graphics->first_preparse);
+		graphics->first_preparse = next;
+		unused++;
+	}
+
+	pthread_mutex_unlock(&graphics->effect_mutex);
+
+	if (unused)
+		blog(LOG_DEBUG, "Discarded %zu preparsed effects that were not created", unused);
+}
+
+static struct effect_preparse *take_preparsed_effect(const char *file)
+{
+	graphics_t *graphics = thread_graphics;
+	struct effect_preparse **prev_next = &graphics->first_preparse;
+	struct effect_preparse *entry = NULL;
+
+	pthread_mutex_lock(&graphics->effect_mutex);
+
+	for (; *prev_next; prev_next = &(*prev_next)->next) {
+		if (strcmp((*prev_next)->file, file) == 0) {
+			entry = *prev_next;
+			*prev_next = entry->next;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&graphics->effect_mutex);
+	return entry;
+}
+
+static gs_effect_t *effect_create_parsed(struct effect_parser *parser, bool success, const char *filename,
+					 char **error_string)
+{
 	struct gs_effect *effect = bzalloc(sizeof(struct gs_effect));
-	struct effect_parser parser;
-	bool success;
 
 	effect->graphics = thread_graphics;
 	effect->effect_path = bstrdup(filename);
 
-	ep_init(&parser);
-	success = ep_parse(&parser, effect, effect_string, filename);
+	if (success)
+		success = ep_compile_effect(parser, effect);
 	if (!success) {
 		if (error_string)
-			*error_string = error_data_buildstring(&parser.cfp.error_list);
+			*error_string = error_data_buildstring(&parser->cfp.error_list);
 		gs_effect_destroy(effect);
 		effect = NULL;
 	}
@@ -834,7 +1029,60 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, c
 		pthread_mutex_unlock(&thread_graphics->effect_mutex);
 	}
 
+	return effect;
+}
+
+gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
+{
+	struct effect_preparse *preparsed;
+	char *file_string;
+	gs_effect_t *effect = NULL;
+
+	if (!gs_valid_p("gs_effect_create_from_file", file))
+		return NULL;
+
+	effect = find_cached_effect(file);
+	if (effect)
+		return effect;
+
+	preparsed = take_preparsed_effect(file);
+	if (preparsed) {
+		uint64_t start = os_gettime_ns();
+		effect = effect_create_parsed(&preparsed->parser, true, file, error_string);
+
+		blog(LOG_DEBUG, "Effect '%s': parsed in %.2f ms ahead of time, compiled in %.2f ms", file,
+		     (double)preparsed->parse_ns / 1000000.0, (double)(os_gettime_ns() - start) / 1000000.0);
+
+		effect_preparse_free(preparsed);
+		return effect;
+	}
+
+	file_string = os_quick_read_utf8_file(file);
+	if (!file_string) {
+		blog(LOG_ERROR, "Could not load effect file '%s'", file);
+		return NULL;
+	}
+
+	effect = gs_effect_create(file_string, file, error_string);
+	bfree(file_string);
+
+	return effect;
+}
+
+gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, char **error_string)
+{
+	if (!gs_valid_p("gs_effect_create", effect_string))
+		return NULL;
+
+	struct effect_parser parser;
+	gs_effect_t *effect;
+	bool success;
+
+	ep_init(&parser);
+	success = ep_parse_source(&parser, gs_preprocessor_name(), effect_string, filename);
+	effect = effect_create_parsed(&parser, success, filename, error_string);
 	ep_free(&parser);
+
 	return effect;
 }
 
@@ -1013,6 +1261,111 @@ void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t h
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+#define SPRITE_BATCH_MIN_CAPACITY 64
+
+static bool reserve_sprite_batch(graphics_t *graphics, size_t count)
+{
+	if (graphics->sprite_batch_buffer && graphics->sprite_batch_capacity >= count)
+		return true;
+
+	size_t capacity = graphics->sprite_batch_capacity ? graphics->sprite_batch_capacity : SPRITE_BATCH_MIN_CAPACITY;
+	while (capacity < count)
+		capacity *= 2;
+
+	struct gs_vb_data *vbd = gs_vbdata_create();
+	vbd->num = capacity * 6;
+	vbd->points = bzalloc(sizeof(struct vec3) * vbd->num);
+	vbd->num_tex = 1;
+	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * vbd->num);
+
+	gs_vertbuffer_t *vb = graphics->exports.device_vertexbuffer_create(graphics->device, vbd, GS_DYNAMIC);
+	if (!vb)
+		return false;
+
+	if (graphics->sprite_batch_buffer)
+		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_batch_buffer);
+
+	graphics->sprite_batch_buffer = vb;
+	graphics->sprite_batch_capacity = capacity;
+	return true;
+}
+
+void gs_draw_sprite_batch(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height,
+			  const struct matrix4 *transforms, size_t count)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_vb_data sprite = {0};
+	struct vec3 sprite_points[4];
+	struct gs_tvertarray sprite_tv;
+	struct vec2 sprite_uvs[4];
+	struct matrix4 top;
+
+	if (!gs_valid_p("gs_draw_sprite_batch", transforms) || !count)
+		return;
+
+	/* rectangle textures and batch failures draw one sprite at a time */
+	if ((tex && gs_texture_is_rect(tex)) || !reserve_sprite_batch(graphics, count)) {
+		for (size_t i = 0; i < count; i++) {
+			gs_matrix_push();
+			gs_matrix_mul(&transforms[i]);
+			gs_draw_sprite(tex, flip, width, height);
+			gs_matrix_pop();
+		}
+		return;
+	}
+
+	if (tex && gs_get_texture_type(tex) != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "A sprite must be a 2D texture");
+		return;
+	}
+	if (!tex && (!width || !height)) {
+		blog(LOG_ERROR, "A sprite cannot be drawn without a width/height");
+		return;
+	}
+
+	float fcx = width ? (float)width : (float)gs_texture_get_width(tex);
+	float fcy = height ? (float)height : (float)gs_texture_get_height(tex);
+
+	sprite.points = sprite_points;
+	sprite.tvarray = &sprite_tv;
+	sprite_tv.array = sprite_uvs;
+	build_sprite_norm(&sprite, fcx, fcy, flip);
+
+	/* the vertices are moved to their final position here, so the batch
+	 * is drawn with an identity world matrix */
+	gs_matrix_get(&top);
+
+	struct gs_vb_data *data = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+	struct vec3 *points = data->points;
+	struct vec2 *uvs = data->tvarray[0].array;
+	static const size_t corners[6] = {0, 1, 2, 2, 1, 3};
+
+	for (size_t i = 0; i < count; i++) {
+		struct matrix4 world;
+		struct vec3 transformed[4];
+
+		matrix4_mul(&world, &transforms[i], &top);
+		for (size_t j = 0; j < 4; j++)
+			vec3_transform(&transformed[j], &sprite_points[j], &world);
+
+		for (size_t j = 0; j < 6; j++) {
+			vec3_copy(points++, &transformed[corners[j]]);
+			vec2_copy(uvs++, &sprite_uvs[corners[j]]);
+		}
+	}
+
+	gs_vertexbuffer_flush(graphics->sprite_batch_buffer);
+	gs_load_vertexbuffer(graphics->sprite_batch_buffer);
+	gs_load_indexbuffer(NULL);
+
+	gs_matrix_push();
+	gs_matrix_identity();
+	gs_draw(GS_TRIS, 0, (uint32_t)(count * 6));
+	gs_matrix_pop();
+}
+
 void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x, uint32_t sub_y, uint32_t sub_cx,
 			      uint32_t sub_cy)
 {
@@ -1330,8 +1683,15 @@ gs_texture_t *gs_texture_create(uint32_t width, uint32_t height, enum gs_color_f
 		levels = 1;
 	}
 
-	return graphics->exports.device_texture_create(graphics->device, width, height, color_format, levels, data,
-						       flags);
+	gs_texture_t *tex = graphics->exports.device_texture_create(graphics->device, width, height, color_format,
+								    levels, data, flags);
+	if (tex) {
+		uint32_t tracked_levels = uses_mipmaps && levels == 1 ? 0 : levels;
+		gs_memory_track(graphics, tex, GS_MEMORY_OTHER,
+				gs_texture_memory_size(width, height, 1, color_format, tracked_levels));
+	}
+
+	return tex;
 }
 
 #if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
@@ -1453,7 +1813,15 @@ gs_texture_t *gs_cubetexture_create(uint32_t size, enum gs_color_format color_fo
 		data = NULL;
 	}
 
-	return graphics->exports.device_cubetexture_create(graphics->device, size, color_format, levels, data, flags);
+	gs_texture_t *tex =
+		graphics->exports.device_cubetexture_create(graphics->device, size, color_format, levels, data, flags);
+	if (tex) {
+		uint32_t tracked_levels = uses_mipmaps && levels == 1 ? 0 : levels;
+		gs_memory_track(graphics, tex, GS_MEMORY_OTHER,
+				gs_texture_memory_size(size, size, 1, color_format, tracked_levels) * 6);
+	}
+
+	return tex;
 }
 
 gs_texture_t *gs_voltexture_create(uint32_t width, uint32_t height, uint32_t depth, enum gs_color_format color_format,
@@ -1464,8 +1832,13 @@ gs_texture_t *gs_voltexture_create(uint32_t width, uint32_t height, uint32_t dep
 	if (!gs_valid("gs_voltexture_create"))
 		return NULL;
 
-	return graphics->exports.device_voltexture_create(graphics->device, width, height, depth, color_format, levels,
-							  data, flags);
+	gs_texture_t *tex = graphics->exports.device_voltexture_create(graphics->device, width, height, depth,
+								       color_format, levels, data, flags);
+	if (tex)
+		gs_memory_track(graphics, tex, GS_MEMORY_OTHER,
+				gs_texture_memory_size(width, height, depth, color_format, levels));
+
+	return tex;
 }
 
 gs_zstencil_t *gs_zstencil_create(uint32_t width, uint32_t height, enum gs_zstencil_format format)
@@ -1475,7 +1848,11 @@ gs_zstencil_t *gs_zstencil_create(uint32_t width, uint32_t height, enum gs_zsten
 	if (!gs_valid("gs_zstencil_create"))
 		return NULL;
 
-	return graphics->exports.device_zstencil_create(graphics->device, width, height, format);
+	gs_zstencil_t *zs = graphics->exports.device_zstencil_create(graphics->device, width, height, format);
+	if (zs)
+		gs_memory_track(graphics, zs, GS_MEMORY_OTHER, gs_zstencil_memory_size(width, height, format));
+
+	return zs;
 }
 
 gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height, enum gs_color_format color_format)
@@ -1485,7 +1862,13 @@ gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height, enum gs_
 	if (!gs_valid("gs_stagesurface_create"))
 		return NULL;
 
-	return graphics->exports.device_stagesurface_create(graphics->device, width, height, color_format);
+	gs_stagesurf_t *surf =
+		graphics->exports.device_stagesurface_create(graphics->device, width, height, color_format);
+	if (surf)
+		gs_memory_track(graphics, surf, GS_MEMORY_STAGING,
+				gs_texture_memory_size(width, height, 1, color_format, 1));
+
+	return surf;
 }
 
 gs_samplerstate_t *gs_samplerstate_create(const struct gs_sampler_info *info)
@@ -2346,6 +2729,7 @@ void gs_texture_destroy(gs_texture_t *tex)
 	if (!tex)
 		return;
 
+	gs_memory_untrack(graphics, tex);
 	graphics->exports.gs_texture_destroy(tex);
 }
 
@@ -2431,6 +2815,7 @@ void gs_cubetexture_destroy(gs_texture_t *cubetex)
 	if (!cubetex)
 		return;
 
+	gs_memory_untrack(graphics, cubetex);
 	graphics->exports.gs_cubetexture_destroy(cubetex);
 }
 
@@ -2463,6 +2848,7 @@ void gs_voltexture_destroy(gs_texture_t *voltex)
 	if (!voltex)
 		return;
 
+	gs_memory_untrack(graphics, voltex);
 	graphics->exports.gs_voltexture_destroy(voltex);
 }
 
@@ -2515,6 +2901,7 @@ void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 	if (!stagesurf)
 		return;
 
+	gs_memory_untrack(graphics, stagesurf);
 	graphics->exports.gs_stagesurface_destroy(stagesurf);
 }
 
@@ -2575,6 +2962,7 @@ void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 	if (!zstencil)
 		return;
 
+	gs_memory_untrack(thread_graphics, zstencil);
 	thread_graphics->exports.gs_zstencil_destroy(zstencil);
 }
 
@@ -2616,6 +3004,17 @@ void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vertbuffer, const struct gs_v
 	thread_graphics->exports.gs_vertexbuffer_flush_direct(vertbuffer, data);
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer, size_t start, size_t count, bool discard)
+{
+	if (!gs_valid_p("gs_vertexbuffer_flush_range", vertbuffer))
+		return;
+
+	if (thread_graphics->exports.gs_vertexbuffer_flush_range)
+		thread_graphics->exports.gs_vertexbuffer_flush_range(vertbuffer, start, count, discard);
+	else
+		thread_graphics->exports.gs_vertexbuffer_flush(vertbuffer);
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
 {
 	if (!gs_valid_p("gs_vertexbuffer_get_data", vertbuffer))
@@ -2848,8 +3247,11 @@ bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv, uint32_
 	if (graphics->exports.device_texture_create_nv12) {
 		success = graphics->exports.device_texture_create_nv12(graphics->device, tex_y, tex_uv, width, height,
 								       flags);
-		if (success)
+		if (success) {
+			/* tex_uv shares the storage of tex_y */
+			gs_memory_track(graphics, *tex_y, GS_MEMORY_OTHER, (uint64_t)width * height * 3 / 2);
 			return true;
+		}
 	}
 
 	*tex_y = gs_texture_create(width, height, GS_R8, 1, NULL, flags);
@@ -2886,8 +3288,11 @@ bool gs_texture_create_p010(gs_texture_t **tex_y, gs_texture_t **tex_uv, uint32_
 	if (graphics->exports.device_texture_create_p010) {
 		success = graphics->exports.device_texture_create_p010(graphics->device, tex_y, tex_uv, width, height,
 								       flags);
-		if (success)
+		if (success) {
+			/* tex_uv shares the storage of tex_y */
+			gs_memory_track(graphics, *tex_y, GS_MEMORY_OTHER, (uint64_t)width * height * 3);
 			return true;
+		}
 	}
 
 	*tex_y = gs_texture_create(width, height, GS_R16, 1, NULL, flags);
@@ -3073,6 +3478,18 @@ float gs_duplicator_get_sdr_white_level(gs_duplicator_t *duplicator)
 	return thread_graphics->exports.gs_duplicator_get_sdr_white_level(duplicator);
 }
 
+void gs_duplicator_get_stats(gs_duplicator_t *duplicator, struct gs_duplicator_stats *stats)
+{
+	if (!gs_valid_p2("gs_duplicator_get_stats", duplicator, stats))
+		return;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!thread_graphics->exports.gs_duplicator_get_stats)
+		return;
+
+	thread_graphics->exports.gs_duplicator_get_stats(duplicator, stats);
+}
+
 /** creates a windows GDI-lockable texture */
 gs_texture_t *gs_texture_create_gdi(uint32_t width, uint32_t height)
 {
@@ -3184,8 +3601,13 @@ gs_stagesurf_t *gs_stagesurface_create_nv12(uint32_t width, uint32_t height)
 		return NULL;
 	}
 
-	if (graphics->exports.device_stagesurface_create_nv12)
-		return graphics->exports.device_stagesurface_create_nv12(graphics->device, width, height);
+	if (graphics->exports.device_stagesurface_create_nv12) {
+		gs_stagesurf_t *surf =
+			graphics->exports.device_stagesurface_create_nv12(graphics->device, width, height);
+		if (surf)
+			gs_memory_track(graphics, surf, GS_MEMORY_STAGING, (uint64_t)width * height * 3 / 2);
+		return surf;
+	}
 
 	return NULL;
 }
@@ -3203,8 +3625,13 @@ gs_stagesurf_t *gs_stagesurface_create_p010(uint32_t width, uint32_t height)
 		return NULL;
 	}
 
-	if (graphics->exports.device_stagesurface_create_p010)
-		return graphics->exports.device_stagesurface_create_p010(graphics->device, width, height);
+	if (graphics->exports.device_stagesurface_create_p010) {
+		gs_stagesurf_t *surf =
+			graphics->exports.device_stagesurface_create_p010(graphics->device, width, height);
+		if (surf)
+			gs_memory_track(graphics, surf, GS_MEMORY_STAGING, (uint64_t)width * height * 3);
+		return surf;
+	}
 
 	return NULL;
 }
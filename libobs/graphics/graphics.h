@@ -446,6 +446,14 @@ EXPORT void gs_effect_set_color(gs_eparam_t *param, uint32_t argb);
  * --------------------------------------------------- */
 
 EXPORT gs_texrender_t *gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format zsformat);
+
+/**
+ * Creates a texrender that borrows its target from a shared pool from
+ * gs_texrender_begin until the next gs_texrender_reset, so texrenders that
+ * are not rendered in a frame don't keep their targets alive.  The texture
+ * is only valid until the next reset.
+ */
+EXPORT gs_texrender_t *gs_texrender_create_pooled(enum gs_color_format format, enum gs_zstencil_format zsformat);
 EXPORT void gs_texrender_destroy(gs_texrender_t *texrender);
 EXPORT bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy);
 EXPORT bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender, uint32_t cx, uint32_t cy,
@@ -455,6 +463,49 @@ EXPORT void gs_texrender_reset(gs_texrender_t *texrender);
 EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 EXPORT enum gs_color_format gs_texrender_get_format(const gs_texrender_t *texrender);
 
+/** Frees pooled targets unused for this long, 0 keeps them (default 10) */
+EXPORT void gs_texrender_set_pool_idle_timeout(uint32_t seconds);
+
+/** Frees every pooled target that is not currently borrowed */
+EXPORT void gs_texrender_pool_evict(void);
+
+/* ---------------------------------------------------
+ * graphics memory tracking
+ * --------------------------------------------------- */
+
+enum gs_memory_category {
+	GS_MEMORY_OTHER,
+	GS_MEMORY_TEXRENDER,
+	GS_MEMORY_STAGING,
+	GS_MEMORY_ASYNC,
+	GS_MEMORY_IMAGE,
+	GS_MEMORY_FILTER,
+	GS_MEMORY_CATEGORY_COUNT,
+};
+
+struct gs_memory_usage {
+	uint64_t total;
+	uint64_t budget;
+	uint64_t categories[GS_MEMORY_CATEGORY_COUNT];
+};
+
+/**
+ * Textures, stage surfaces and z-stencil buffers created until the matching
+ * pop are counted under this category and owner.  A NULL owner inherits the
+ * enclosing scope's owner, and within the same owner GS_MEMORY_OTHER inherits
+ * its category.
+ */
+EXPORT void gs_memory_push_scope(enum gs_memory_category category, const void *owner);
+EXPORT void gs_memory_pop_scope(void);
+
+/* these don't require the graphics context */
+EXPORT void gs_get_memory_usage(graphics_t *graphics, struct gs_memory_usage *usage);
+EXPORT uint64_t gs_get_owner_memory_usage(graphics_t *graphics, const void *owner);
+EXPORT const char *gs_memory_category_name(enum gs_memory_category category);
+
+/** Sets the soft budget reported in gs_memory_usage, 0 is no budget */
+EXPORT void gs_set_memory_budget(graphics_t *graphics, uint64_t budget);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -548,6 +599,8 @@ EXPORT gs_effect_t *gs_get_effect(void);
 
 EXPORT gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string);
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string, const char *filename, char **error_string);
+EXPORT void gs_effect_preparse_files(const char *const *files, size_t count);
+EXPORT void gs_effect_preparse_clear(void);
 
 EXPORT gs_shader_t *gs_vertexshader_create_from_file(const char *file, char **error_string);
 EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file, char **error_string);
@@ -566,6 +619,15 @@ EXPORT uint8_t *gs_create_texture_file_data3(const char *file, enum gs_image_alp
 					     enum gs_color_format *format, uint32_t *cx, uint32_t *cy,
 					     enum gs_color_space *space);
 
+/**
+ * Premultiplies 8-bit RGBA or BGRA texels by their alpha.  dst may be the
+ * same as src.
+ */
+EXPORT void gs_premultiply_rgba8(uint8_t *dst, const uint8_t *src, size_t texel_count);
+
+/** Same as gs_premultiply_rgba8, with sRGB encoded colors premultiplied as linear. */
+EXPORT void gs_premultiply_rgba8_srgb(uint8_t *dst, const uint8_t *src, size_t texel_count);
+
 #define GS_FLIP_U (1 << 0)
 #define GS_FLIP_V (1 << 1)
 
@@ -578,6 +640,10 @@ EXPORT uint8_t *gs_create_texture_file_data3(const char *file, enum gs_image_alp
  */
 EXPORT void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height);
 
+/** Draws the sprite once per transform in a single draw call */
+EXPORT void gs_draw_sprite_batch(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height,
+				 const struct matrix4 *transforms, size_t count);
+
 EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
@@ -760,6 +826,14 @@ EXPORT void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
 EXPORT void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer);
 EXPORT void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer);
 EXPORT void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vertbuffer, const struct gs_vb_data *data);
+
+/**
+ * Uploads only vertices [start, start + count) of a dynamic vertex buffer.
+ * When discard is false the caller guarantees the GPU is not reading that
+ * range, so the upload does not wait on or rename the buffer.  Falls back to a
+ * full flush on backends without range uploads.
+ */
+EXPORT void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer, size_t start, size_t count, bool discard);
 EXPORT struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer);
 
 EXPORT void gs_indexbuffer_destroy(gs_indexbuffer_t *indexbuffer);
@@ -827,6 +901,13 @@ EXPORT bool gs_shared_texture_available(void);
 struct gs_duplicator;
 typedef struct gs_duplicator gs_duplicator_t;
 
+struct gs_duplicator_stats {
+	uint64_t frames;           /* frames with new desktop content */
+	uint64_t skipped_frames;   /* frames with only pointer updates */
+	uint64_t partial_copies;   /* frames copied through dirty rects */
+	uint64_t total_latency_ns; /* present to copy, summed over frames */
+};
+
 /**
  * Gets information about the monitor at the specific index, returns false
  * when there is no monitor at the specified index
@@ -843,6 +924,7 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *duplicator);
 EXPORT gs_texture_t *gs_duplicator_get_texture(gs_duplicator_t *duplicator);
 EXPORT enum gs_color_space gs_duplicator_get_color_space(gs_duplicator_t *duplicator);
 EXPORT float gs_duplicator_get_sdr_white_level(gs_duplicator_t *duplicator);
+EXPORT void gs_duplicator_get_stats(gs_duplicator_t *duplicator, struct gs_duplicator_stats *stats);
 
 EXPORT bool gs_can_adapter_fast_clear(void);
 
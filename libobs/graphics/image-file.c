@@ -15,14 +15,257 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
+#include <sys/stat.h>
+
 #include "image-file.h"
 #include "../util/base.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/darray.h"
 #include "../util/dstr.h"
+#include "../util/sse-intrin.h"
 #include "vec4.h"
 
 #define blog(level, format, ...) blog(level, "%s: " format, __FUNCTION__, __VA_ARGS__)
 
+/* animations whose fully decoded frames would exceed this are not cached,
+ * each frame is decoded again when it comes up */
+#define GIF_MAX_CACHE_SIZE (256ULL * 1024ULL * 1024ULL)
+
+/* ------------------------------------------------------------------------- */
+/* premultiplication */
+
+/* (c * a + 128) / 255 rounded, which matches the float path for every
+ * value of c and a */
+static inline __m128i premultiply_epi16(__m128i c, __m128i bias)
+{
+	__m128i a = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), bias);
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline uint8_t premultiply_u8(uint32_t c, uint32_t a)
+{
+	uint32_t t = c * a + 128;
+	return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+void gs_premultiply_rgba8(uint8_t *dst, const uint8_t *src, size_t texel_count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+	size_t i = 0;
+
+	for (; i + 4 <= texel_count; i += 4) {
+		const __m128i texels = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		const __m128i lo = premultiply_epi16(_mm_unpacklo_epi8(texels, zero), bias);
+		const __m128i hi = premultiply_epi16(_mm_unpackhi_epi8(texels, zero), bias);
+
+		__m128i out = _mm_packus_epi16(lo, hi);
+		out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out), _mm_and_si128(alpha_mask, texels));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), out);
+	}
+
+	for (; i < texel_count; i++) {
+		const uint8_t *in = src + i * 4;
+		uint8_t *out = dst + i * 4;
+		const uint8_t a = in[3];
+
+		out[0] = premultiply_u8(in[0], a);
+		out[1] = premultiply_u8(in[1], a);
+		out[2] = premultiply_u8(in[2], a);
+		out[3] = a;
+	}
+}
+
+/* the sRGB conversions are too expensive to do per texel, but each channel
+ * only depends on itself and alpha, so the float path is run once for every
+ * pair and looked up afterwards */
+static uint8_t srgb_premultiply_table[256][256];
+static pthread_once_t srgb_premultiply_once = PTHREAD_ONCE_INIT;
+
+static void init_srgb_premultiply_table(void)
+{
+	for (int a = 0; a < 256; a++) {
+		for (int c = 0; c < 256; c++) {
+			uint8_t texel[4] = {(uint8_t)c, (uint8_t)c, (uint8_t)c, (uint8_t)a};
+			gs_premultiply_xyza_srgb(texel);
+			srgb_premultiply_table[a][c] = texel[0];
+		}
+	}
+}
+
+void gs_premultiply_rgba8_srgb(uint8_t *dst, const uint8_t *src, size_t texel_count)
+{
+	pthread_once(&srgb_premultiply_once, init_srgb_premultiply_table);
+
+	for (size_t i = 0; i < texel_count; i++) {
+		const uint8_t a = src[3];
+		const uint8_t *table = srgb_premultiply_table[a];
+
+		dst[0] = table[src[0]];
+		dst[1] = table[src[1]];
+		dst[2] = table[src[2]];
+		dst[3] = a;
+
+		dst += 4;
+		src += 4;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* decoded image cache */
+
+/* still images are kept decoded after they're loaded, so sources showing
+ * the same file, or a file that's shown again, don't decode it again.
+ * least recently used entries are at the front */
+struct decoded_image {
+	char *path;
+	time_t mtime;
+	int64_t file_size;
+	enum gs_image_alpha_mode alpha_mode;
+
+	enum gs_color_format format;
+	enum gs_color_space space;
+	uint32_t cx;
+	uint32_t cy;
+	uint8_t *data;
+	size_t size;
+};
+
+#define DEFAULT_DECODE_CACHE_SIZE (256ULL * 1024ULL * 1024ULL)
+
+static pthread_mutex_t cache_mutex;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static DARRAY(struct decoded_image) decode_cache;
+static uint64_t decode_cache_size = 0;
+static uint64_t decode_cache_max = DEFAULT_DECODE_CACHE_SIZE;
+
+static void init_cache_mutex(void)
+{
+	pthread_mutex_init(&cache_mutex, NULL);
+}
+
+static inline void free_decoded_image(struct decoded_image *entry)
+{
+	bfree(entry->path);
+	bfree(entry->data);
+}
+
+static void trim_decode_cache(uint64_t max)
+{
+	while (decode_cache.num && decode_cache_size > max) {
+		struct decoded_image *entry = decode_cache.array;
+		decode_cache_size -= entry->size;
+		free_decoded_image(entry);
+		da_erase(decode_cache, 0);
+	}
+}
+
+static bool get_file_info(const char *path, time_t *mtime, int64_t *file_size)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return false;
+
+	*mtime = st.st_mtime;
+	*file_size = (int64_t)st.st_size;
+	return true;
+}
+
+static uint8_t *decode_cache_find(const char *path, time_t mtime, int64_t file_size,
+				  enum gs_image_alpha_mode alpha_mode, enum gs_color_format *format, uint32_t *cx,
+				  uint32_t *cy, enum gs_color_space *space)
+{
+	uint8_t *data = NULL;
+
+	pthread_once(&cache_once, init_cache_mutex);
+	pthread_mutex_lock(&cache_mutex);
+
+	for (size_t i = decode_cache.num; i > 0; i--) {
+		struct decoded_image *entry = &decode_cache.array[i - 1];
+		if (entry->alpha_mode != alpha_mode || strcmp(entry->path, path) != 0)
+			continue;
+
+		if (entry->mtime != mtime || entry->file_size != file_size) {
+			/* the file changed, so this is stale */
+			decode_cache_size -= entry->size;
+			free_decoded_image(entry);
+			da_erase(decode_cache, i - 1);
+			break;
+		}
+
+		struct decoded_image found = *entry;
+		data = bmemdup(found.data, found.size);
+		*format = found.format;
+		*cx = found.cx;
+		*cy = found.cy;
+		*space = found.space;
+
+		da_erase(decode_cache, i - 1);
+		da_push_back(decode_cache, &found);
+		break;
+	}
+
+	pthread_mutex_unlock(&cache_mutex);
+	return data;
+}
+
+static void decode_cache_insert(const char *path, time_t mtime, int64_t file_size,
+				enum gs_image_alpha_mode alpha_mode, enum gs_color_format format, uint32_t cx,
+				uint32_t cy, enum gs_color_space space, const uint8_t *data)
+{
+	const size_t size = (size_t)cx * cy * gs_get_format_bpp(format) / 8;
+
+	pthread_once(&cache_once, init_cache_mutex);
+	pthread_mutex_lock(&cache_mutex);
+
+	if (size && size <= decode_cache_max) {
+		struct decoded_image entry = {
+			.path = bstrdup(path),
+			.mtime = mtime,
+			.file_size = file_size,
+			.alpha_mode = alpha_mode,
+			.format = format,
+			.space = space,
+			.cx = cx,
+			.cy = cy,
+			.data = bmemdup(data, size),
+			.size = size,
+		};
+
+		/* another thread may have decoded the same file meanwhile */
+		for (size_t i = 0; i < decode_cache.num; i++) {
+			struct decoded_image *old = &decode_cache.array[i];
+			if (old->alpha_mode == alpha_mode && strcmp(old->path, path) == 0) {
+				decode_cache_size -= old->size;
+				free_decoded_image(old);
+				da_erase(decode_cache, i);
+				break;
+			}
+		}
+
+		da_push_back(decode_cache, &entry);
+		decode_cache_size += size;
+		trim_decode_cache(decode_cache_max);
+	}
+
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+void gs_image_file_set_cache_size(uint64_t max_size)
+{
+	pthread_once(&cache_once, init_cache_mutex);
+	pthread_mutex_lock(&cache_mutex);
+	decode_cache_max = max_size;
+	trim_decode_cache(max_size);
+	pthread_mutex_unlock(&cache_mutex);
+}
+
 static void *bi_def_bitmap_create(int width, int height)
 {
 	return bmalloc((size_t)4 * width * height);
@@ -60,6 +303,11 @@ static inline int get_full_decoded_gif_size(gs_image_file_t *image)
 	return image->gif.width * image->gif.height * 4 * image->gif.frame_count;
 }
 
+static inline bool is_cached_gif(gs_image_file_t *image)
+{
+	return image->animation_frame_data != NULL;
+}
+
 static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage, size_t size)
 {
 	UNUSED_PARAMETER(image);
@@ -132,7 +380,11 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t
 		gif_decode_frame(&image->gif, 0);
 
 		image->animation_frame_cache = alloc_mem(image, mem_usage, image->gif.frame_count * sizeof(uint8_t *));
-		image->animation_frame_data = alloc_mem(image, mem_usage, get_full_decoded_gif_size(image));
+		if (max_size <= GIF_MAX_CACHE_SIZE)
+			image->animation_frame_data = alloc_mem(image, mem_usage, get_full_decoded_gif_size(image));
+		else
+			blog(LOG_INFO, "Not caching the %u frames of '%s' (%" PRIu64 " MB decoded)",
+			     image->gif.frame_count, path, max_size / (1024 * 1024));
 
 		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
 			if (gif_decode_frame(&image->gif, i) != GIF_OK)
@@ -153,10 +405,11 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path, uint64_t
 			*mem_usage += size;
 		}
 
+		const size_t area = (size_t)image->cx * image->cy;
 		if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-			gs_premultiply_xyza_srgb_loop(image->gif.frame_image, (size_t)image->cx * image->cy);
+			gs_premultiply_rgba8_srgb(image->gif.frame_image, image->gif.frame_image, area);
 		} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-			gs_premultiply_xyza_loop(image->gif.frame_image, (size_t)image->cx * image->cy);
+			gs_premultiply_rgba8(image->gif.frame_image, image->gif.frame_image, area);
 		}
 	} else {
 		gif_finalise(&image->gif);
@@ -199,8 +452,22 @@ static void gs_image_file_init_internal(gs_image_file_t *image, const char *file
 		}
 	}
 
-	image->texture_data =
-		gs_create_texture_file_data3(file, alpha_mode, &image->format, &image->cx, &image->cy, space);
+	time_t mtime;
+	int64_t file_size;
+	const bool cacheable = get_file_info(file, &mtime, &file_size);
+
+	if (cacheable)
+		image->texture_data = decode_cache_find(file, mtime, file_size, alpha_mode, &image->format, &image->cx,
+							&image->cy, space);
+
+	if (!image->texture_data) {
+		image->texture_data =
+			gs_create_texture_file_data3(file, alpha_mode, &image->format, &image->cx, &image->cy, space);
+
+		if (cacheable && image->texture_data)
+			decode_cache_insert(file, mtime, file_size, alpha_mode, image->format, image->cx, image->cy,
+					    *space, image->texture_data);
+	}
 
 	if (mem_usage) {
 		*mem_usage += image->cx * image->cy * gs_get_format_bpp(image->format) / 8;
@@ -264,6 +531,8 @@ void gs_image_file_init_texture(gs_image_file_t *image)
 	if (!image->loaded)
 		return;
 
+	gs_memory_push_scope(GS_MEMORY_IMAGE, NULL);
+
 	if (image->is_animated_gif) {
 		image->texture = gs_texture_create(image->cx, image->cy, image->format, 1,
 						   (const uint8_t **)&image->gif.frame_image, GS_DYNAMIC);
@@ -274,6 +543,8 @@ void gs_image_file_init_texture(gs_image_file_t *image)
 		bfree(image->texture_data);
 		image->texture_data = NULL;
 	}
+
+	gs_memory_pop_scope();
 }
 
 static inline uint64_t get_time(gs_image_file_t *image, int i)
@@ -310,11 +581,13 @@ static inline int calculate_new_frame(gs_image_file_t *image, uint64_t elapsed_t
 
 static void decode_new_frame(gs_image_file_t *image, int new_frame, enum gs_image_alpha_mode alpha_mode)
 {
-	if (!image->animation_frame_cache[new_frame]) {
+	bool cached = is_cached_gif(image);
+
+	if (cached ? !image->animation_frame_cache[new_frame] : image->last_decoded_frame != new_frame) {
 		int last_frame;
 
 		/* if looped, decode frame 0 */
-		last_frame = (new_frame < image->last_decoded_frame) ? 0 : image->last_decoded_frame + 1;
+		last_frame = (new_frame <= image->last_decoded_frame) ? 0 : image->last_decoded_frame + 1;
 
 		/* decode missed frames */
 		for (int i = last_frame; i < new_frame; i++) {
@@ -325,16 +598,18 @@ static void decode_new_frame(gs_image_file_t *image, int new_frame, enum gs_imag
 		/* decode actual desired frame */
 		if (gif_decode_frame(&image->gif, new_frame) == GIF_OK) {
 			const size_t area = (size_t)image->gif.width * image->gif.height;
-			size_t pos = new_frame * area * 4;
-			image->animation_frame_cache[new_frame] = image->animation_frame_data + pos;
 
 			if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-				gs_premultiply_xyza_srgb_loop(image->gif.frame_image, area);
+				gs_premultiply_rgba8_srgb(image->gif.frame_image, image->gif.frame_image, area);
 			} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-				gs_premultiply_xyza_loop(image->gif.frame_image, area);
+				gs_premultiply_rgba8(image->gif.frame_image, image->gif.frame_image, area);
 			}
 
-			memcpy(image->animation_frame_cache[new_frame], image->gif.frame_image, area * 4);
+			if (cached) {
+				size_t pos = new_frame * area * 4;
+				image->animation_frame_cache[new_frame] = image->animation_frame_data + pos;
+				memcpy(image->animation_frame_cache[new_frame], image->gif.frame_image, area * 4);
+			}
 
 			image->last_decoded_frame = new_frame;
 		}
@@ -392,11 +667,13 @@ static void gs_image_file_update_texture_internal(gs_image_file_t *image, enum g
 	if (!image->is_animated_gif || !image->loaded)
 		return;
 
-	if (!image->animation_frame_cache[image->cur_frame])
-		decode_new_frame(image, image->cur_frame, alpha_mode);
+	decode_new_frame(image, image->cur_frame, alpha_mode);
 
-	gs_texture_set_image(image->texture, image->animation_frame_cache[image->cur_frame], image->gif.width * 4,
-			     false);
+	if (is_cached_gif(image))
+		gs_texture_set_image(image->texture, image->animation_frame_cache[image->cur_frame],
+				     image->gif.width * 4, false);
+	else
+		gs_texture_set_image(image->texture, image->gif.frame_image, image->gif.width * 4, false);
 }
 
 void gs_image_file_update_texture(gs_image_file_t *image)
@@ -418,3 +695,234 @@ void gs_image_file4_update_texture(gs_image_file4_t *if4)
 {
 	gs_image_file_update_texture_internal(&if4->image3.image2.image, if4->image3.alpha_mode);
 }
+
+/* ------------------------------------------------------------------------- */
+/* decode pool */
+
+/* images loaded from the graphics thread would stall rendering while they
+ * decode, so they can be handed to a few shared workers instead */
+#define MAX_DECODE_THREADS 4
+
+struct decode_job {
+	gs_image_file4_t *if4;
+	char *file;
+	enum gs_image_alpha_mode alpha_mode;
+	void (*callback)(void *param);
+	void *param;
+
+	os_event_t *done;
+	volatile long refs;
+};
+
+struct decode_pool {
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	DARRAY(pthread_t) threads;
+	DARRAY(struct decode_job *) queued;
+	DARRAY(struct decode_job *) running;
+	bool stopping;
+};
+
+static struct decode_pool decode_pool;
+static pthread_once_t decode_pool_once = PTHREAD_ONCE_INIT;
+
+static void init_decode_pool(void)
+{
+	pthread_mutex_init(&decode_pool.mutex, NULL);
+}
+
+static inline void decode_job_release(struct decode_job *job)
+{
+	if (os_atomic_dec_long(&job->refs) == 0) {
+		os_event_destroy(job->done);
+		bfree(job->file);
+		bfree(job);
+	}
+}
+
+static void run_decode_job(struct decode_job *job)
+{
+	gs_image_file4_init(job->if4, job->file, job->alpha_mode);
+	if (job->callback)
+		job->callback(job->param);
+
+	pthread_mutex_lock(&decode_pool.mutex);
+	da_erase_item(decode_pool.running, &job);
+	pthread_mutex_unlock(&decode_pool.mutex);
+
+	os_event_signal(job->done);
+	decode_job_release(job);
+}
+
+static void *decode_thread(void *unused)
+{
+	os_set_thread_name("libobs: image decode");
+
+	for (;;) {
+		struct decode_job *job = NULL;
+
+		os_sem_wait(decode_pool.sem);
+
+		pthread_mutex_lock(&decode_pool.mutex);
+		if (decode_pool.stopping) {
+			pthread_mutex_unlock(&decode_pool.mutex);
+			break;
+		}
+
+		/* jobs that were waited on before they started are run by
+		 * the waiting thread, so the queue can be empty here */
+		if (decode_pool.queued.num) {
+			job = decode_pool.queued.array[0];
+			da_erase(decode_pool.queued, 0);
+			da_push_back(decode_pool.running, &job);
+		}
+		pthread_mutex_unlock(&decode_pool.mutex);
+
+		if (job)
+			run_decode_job(job);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+/* called with the pool mutex held */
+static bool start_decode_threads(void)
+{
+	if (decode_pool.threads.num)
+		return true;
+
+	if (!decode_pool.sem && os_sem_init(&decode_pool.sem, 0) != 0)
+		return false;
+
+	int count = os_get_logical_cores() - 1;
+	if (count > MAX_DECODE_THREADS)
+		count = MAX_DECODE_THREADS;
+	if (count < 1)
+		count = 1;
+
+	decode_pool.stopping = false;
+
+	for (int i = 0; i < count; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, decode_thread, NULL) != 0)
+			break;
+		da_push_back(decode_pool.threads, &thread);
+	}
+
+	return decode_pool.threads.num > 0;
+}
+
+void gs_image_file4_init_async(gs_image_file4_t *if4, const char *file, enum gs_image_alpha_mode alpha_mode,
+			       void (*callback)(void *param), void *param)
+{
+	struct decode_job *job;
+	bool queued = false;
+
+	if (!if4)
+		return;
+
+	memset(if4, 0, sizeof(*if4));
+	if4->image3.alpha_mode = alpha_mode;
+
+	job = bzalloc(sizeof(*job));
+	job->if4 = if4;
+	job->file = bstrdup(file);
+	job->alpha_mode = alpha_mode;
+	job->callback = callback;
+	job->param = param;
+	job->refs = 1;
+
+	if (os_event_init(&job->done, OS_EVENT_TYPE_MANUAL) != 0) {
+		bfree(job->file);
+		bfree(job);
+		gs_image_file4_init(if4, file, alpha_mode);
+		if (callback)
+			callback(param);
+		return;
+	}
+
+	pthread_once(&decode_pool_once, init_decode_pool);
+	pthread_mutex_lock(&decode_pool.mutex);
+	if (start_decode_threads()) {
+		da_push_back(decode_pool.queued, &job);
+		queued = true;
+	}
+	pthread_mutex_unlock(&decode_pool.mutex);
+
+	if (queued)
+		os_sem_post(decode_pool.sem);
+	else
+		run_decode_job(job);
+}
+
+void gs_image_file4_wait(gs_image_file4_t *if4)
+{
+	struct decode_job *job = NULL;
+	bool run_here = false;
+
+	pthread_once(&decode_pool_once, init_decode_pool);
+	pthread_mutex_lock(&decode_pool.mutex);
+
+	for (size_t i = 0; i < decode_pool.queued.num; i++) {
+		if (decode_pool.queued.array[i]->if4 == if4) {
+			job = decode_pool.queued.array[i];
+			da_erase(decode_pool.queued, i);
+			run_here = true;
+			break;
+		}
+	}
+
+	for (size_t i = 0; !job && i < decode_pool.running.num; i++) {
+		if (decode_pool.running.array[i]->if4 == if4) {
+			job = decode_pool.running.array[i];
+			os_atomic_inc_long(&job->refs);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&decode_pool.mutex);
+
+	if (!job)
+		return;
+
+	if (run_here) {
+		run_decode_job(job);
+	} else {
+		os_event_wait(job->done);
+		decode_job_release(job);
+	}
+}
+
+void gs_image_file_free_shared(void)
+{
+	pthread_once(&decode_pool_once, init_decode_pool);
+	pthread_mutex_lock(&decode_pool.mutex);
+	decode_pool.stopping = true;
+	pthread_mutex_unlock(&decode_pool.mutex);
+
+	for (size_t i = 0; i < decode_pool.threads.num; i++)
+		os_sem_post(decode_pool.sem);
+	for (size_t i = 0; i < decode_pool.threads.num; i++)
+		pthread_join(decode_pool.threads.array[i], NULL);
+	da_free(decode_pool.threads);
+
+	/* nothing should still be queued at this point, but finish anything
+	 * that is so its callback isn't lost */
+	while (decode_pool.queued.num) {
+		struct decode_job *job = decode_pool.queued.array[0];
+		da_erase(decode_pool.queued, 0);
+		run_decode_job(job);
+	}
+
+	da_free(decode_pool.queued);
+	da_free(decode_pool.running);
+	os_sem_destroy(decode_pool.sem);
+	decode_pool.sem = NULL;
+
+	pthread_once(&cache_once, init_cache_mutex);
+	pthread_mutex_lock(&cache_mutex);
+	trim_decode_cache(0);
+	da_free(decode_cache);
+	pthread_mutex_unlock(&cache_mutex);
+}
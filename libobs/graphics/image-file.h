@@ -88,6 +88,22 @@ EXPORT void gs_image_file4_init(gs_image_file4_t *if4, const char *file, enum gs
 EXPORT bool gs_image_file4_tick(gs_image_file4_t *if4, uint64_t elapsed_time_ns);
 EXPORT void gs_image_file4_update_texture(gs_image_file4_t *if4);
 
+/**
+ * Decodes the file on a shared worker thread instead of the calling thread.
+ * The callback is called from the worker once if4 is ready, if4 must not be
+ * used before then or freed before gs_image_file4_wait.
+ */
+EXPORT void gs_image_file4_init_async(gs_image_file4_t *if4, const char *file, enum gs_image_alpha_mode alpha_mode,
+				      void (*callback)(void *param), void *param);
+/** Waits for a decode started with gs_image_file4_init_async to finish. */
+EXPORT void gs_image_file4_wait(gs_image_file4_t *if4);
+
+/**
+ * Sets how many bytes of decoded still images are kept for reuse by later
+ * loads of the same unchanged file, 0 disables the cache.
+ */
+EXPORT void gs_image_file_set_cache_size(uint64_t max_size);
+
 static inline void gs_image_file2_free(gs_image_file2_t *if2)
 {
 	gs_image_file_free(&if2->image);
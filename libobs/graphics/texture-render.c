@@ -21,7 +21,11 @@
  */
 
 #include <assert.h>
+#include "../util/threading.h"
+#include "../util/platform.h"
+#include "../util/darray.h"
 #include "graphics.h"
+#include "graphics-internal.h"
 
 struct gs_texture_render {
 	gs_texture_t *target, *prev_target;
@@ -34,8 +38,154 @@ struct gs_texture_render {
 	enum gs_zstencil_format zsformat;
 
 	bool rendered;
+
+	/* borrows its target from the pool from begin until the next reset */
+	bool pooled;
+};
+
+/* Render targets returned by pooled texrenders, keyed by size and format.
+ * Textures can only be destroyed in the graphics context, so a reset (which
+ * usually happens on the tick thread) only puts them back here, and idle
+ * ones are destroyed the next time a texrender begins. */
+
+#define POOL_TRIM_INTERVAL_NS 1000000000ULL
+
+struct pool_target {
+	gs_texture_t *target;
+	gs_zstencil_t *zs;
+
+	uint32_t cx, cy;
+
+	enum gs_color_format format;
+	enum gs_zstencil_format zsformat;
+
+	uint64_t release_time;
 };
 
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct pool_target) pool_targets;
+static uint64_t pool_idle_timeout_ns = 10000000000ULL;
+static uint64_t pool_last_trim = 0;
+
+static void pool_release(gs_texrender_t *texrender)
+{
+	struct pool_target pt = {
+		.target = texrender->target,
+		.zs = texrender->zs,
+		.cx = texrender->cx,
+		.cy = texrender->cy,
+		.format = texrender->format,
+		.zsformat = texrender->zsformat,
+		.release_time = os_gettime_ns(),
+	};
+
+	texrender->target = NULL;
+	texrender->zs = NULL;
+	texrender->cx = 0;
+	texrender->cy = 0;
+
+	if (!pt.target)
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	da_push_back(pool_targets, &pt);
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static bool pool_acquire(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	/* newest first, those are the least likely to be trimmed */
+	for (size_t i = pool_targets.num; i > 0; i--) {
+		struct pool_target *pt = &pool_targets.array[i - 1];
+
+		if (pt->cx == cx && pt->cy == cy && pt->format == texrender->format &&
+		    pt->zsformat == texrender->zsformat) {
+			texrender->target = pt->target;
+			texrender->zs = pt->zs;
+			da_erase(pool_targets, i - 1);
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&pool_mutex);
+
+	texrender->cx = cx;
+	texrender->cy = cy;
+
+	/* idle targets stay counted for their last user, the borrower is
+	 * only known here because a reset may not be in the context */
+	if (found) {
+		graphics_t *graphics = gs_get_context();
+		gs_memory_set_owner(graphics, texrender->target, gs_memory_current_owner(graphics));
+		gs_memory_set_owner(graphics, texrender->zs, gs_memory_current_owner(graphics));
+	}
+
+	return found;
+}
+
+/* assumes the graphics context */
+static void pool_trim(void)
+{
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&pool_mutex);
+
+	if (pool_idle_timeout_ns && now - pool_last_trim >= POOL_TRIM_INTERVAL_NS) {
+		pool_last_trim = now;
+
+		for (size_t i = pool_targets.num; i > 0; i--) {
+			struct pool_target *pt = &pool_targets.array[i - 1];
+
+			if (now - pt->release_time < pool_idle_timeout_ns)
+				continue;
+
+			gs_texture_destroy(pt->target);
+			gs_zstencil_destroy(pt->zs);
+			da_erase(pool_targets, i - 1);
+		}
+	}
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void gs_texrender_pool_free(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+
+	for (size_t i = 0; i < pool_targets.num; i++) {
+		gs_texture_destroy(pool_targets.array[i].target);
+		gs_zstencil_destroy(pool_targets.array[i].zs);
+	}
+	da_free(pool_targets);
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void gs_texrender_pool_evict(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+
+	for (size_t i = 0; i < pool_targets.num; i++) {
+		gs_texture_destroy(pool_targets.array[i].target);
+		gs_zstencil_destroy(pool_targets.array[i].zs);
+	}
+	da_resize(pool_targets, 0);
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void gs_texrender_set_pool_idle_timeout(uint32_t seconds)
+{
+	pthread_mutex_lock(&pool_mutex);
+	pool_idle_timeout_ns = (uint64_t)seconds * 1000000000ULL;
+	pthread_mutex_unlock(&pool_mutex);
+}
+
 gs_texrender_t *gs_texrender_create(enum gs_color_format format, enum gs_zstencil_format zsformat)
 {
 	struct gs_texture_render *texrender;
@@ -46,9 +196,19 @@ gs_texrender_t *gs_texrender_create(enum gs_color_format format, enum gs_zstenci
 	return texrender;
 }
 
+gs_texrender_t *gs_texrender_create_pooled(enum gs_color_format format, enum gs_zstencil_format zsformat)
+{
+	gs_texrender_t *texrender = gs_texrender_create(format, zsformat);
+	texrender->pooled = true;
+	return texrender;
+}
+
 void gs_texrender_destroy(gs_texrender_t *texrender)
 {
 	if (texrender) {
+		if (texrender->pooled)
+			pool_release(texrender);
+
 		gs_texture_destroy(texrender->target);
 		gs_zstencil_destroy(texrender->zs);
 		bfree(texrender);
@@ -60,6 +220,12 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx, uint32
 	if (!texrender)
 		return false;
 
+	if (texrender->pooled) {
+		pool_release(texrender);
+		if (pool_acquire(texrender, cx, cy))
+			return true;
+	}
+
 	gs_texture_destroy(texrender->target);
 	gs_zstencil_destroy(texrender->zs);
 
@@ -68,18 +234,22 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx, uint32
 	texrender->cx = cx;
 	texrender->cy = cy;
 
+	/* keep the category of an enclosing scope, such as a filter's */
+	enum gs_memory_category category = gs_memory_current_category(gs_get_context());
+	gs_memory_push_scope(category == GS_MEMORY_OTHER ? GS_MEMORY_TEXRENDER : category, NULL);
 	texrender->target = gs_texture_create(cx, cy, texrender->format, 1, NULL, GS_RENDER_TARGET);
+	if (texrender->target && texrender->zsformat != GS_ZS_NONE)
+		texrender->zs = gs_zstencil_create(cx, cy, texrender->zsformat);
+	gs_memory_pop_scope();
+
 	if (!texrender->target)
 		return false;
 
-	if (texrender->zsformat != GS_ZS_NONE) {
-		texrender->zs = gs_zstencil_create(cx, cy, texrender->zsformat);
-		if (!texrender->zs) {
-			gs_texture_destroy(texrender->target);
-			texrender->target = NULL;
+	if (texrender->zsformat != GS_ZS_NONE && !texrender->zs) {
+		gs_texture_destroy(texrender->target);
+		texrender->target = NULL;
 
-			return false;
-		}
+		return false;
 	}
 
 	return true;
@@ -98,6 +268,8 @@ bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender, uint32_t cx,
 	if (!cx || !cy)
 		return false;
 
+	pool_trim();
+
 	if (texrender->cx != cx || texrender->cy != cy)
 		if (!texrender_resetbuffer(texrender, cx, cy))
 			return false;
@@ -136,8 +308,11 @@ void gs_texrender_end(gs_texrender_t *texrender)
 
 void gs_texrender_reset(gs_texrender_t *texrender)
 {
-	if (texrender)
+	if (texrender) {
+		if (texrender->pooled)
+			pool_release(texrender);
 		texrender->rendered = false;
+	}
 }
 
 gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender)
@@ -35,6 +35,7 @@
 #endif
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
+extern void obs_apply_core_thread_affinity(void);
 
 /* #define DEBUG_AUDIO */
 
@@ -70,6 +71,13 @@ struct audio_output {
 
 	pthread_t thread;
 	os_event_t *stop_event;
+	volatile bool catch_up;
+
+	/* set by audio_output_step, ticks then wait for step_sem instead of
+	 * the clock */
+	volatile bool manual_clock;
+	os_sem_t *step_sem;
+	os_sem_t *step_done_sem;
 
 	bool initialized;
 
@@ -77,6 +85,9 @@ struct audio_output {
 	void *input_param;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
+
+	/* bit per mix with connected inputs, updated on connect/disconnect */
+	volatile long active_mixes;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -129,7 +140,7 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx, u
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static inline void clamp_audio_output(struct audio_output *audio, uint32_t active_mixes, size_t bytes)
 {
 	size_t float_size = bytes / sizeof(float);
 
@@ -137,7 +148,7 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if ((active_mixes & (1 << mix_idx)) == 0)
 			continue;
 
 		for (size_t plane = 0; plane < audio->planes; plane++) {
@@ -159,9 +170,9 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 
 static void input_and_output(struct audio_output *audio, uint64_t audio_time, uint64_t prev_time)
 {
-	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
+	size_t bytes = audio->info.frames_per_tick * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
-	uint32_t active_mixes = 0;
+	uint32_t active_mixes = (uint32_t)os_atomic_load_long(&audio->active_mixes);
 	uint64_t new_ts = 0;
 	bool success;
 
@@ -171,19 +182,16 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time, ui
 	blog(LOG_DEBUG, "audio_time: %llu, prev_time: %llu, bytes: %lu", audio_time, prev_time, bytes);
 #endif
 
-	/* get mixers */
-	pthread_mutex_lock(&audio->input_mutex);
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-		if (audio->mixes[i].inputs.num)
-			active_mixes |= (1 << i);
-	}
-	pthread_mutex_unlock(&audio->input_mutex);
-
-	/* clear mix buffers */
+	/* clear mix buffers.  inactive mixes are neither mixed nor output,
+	 * an input connected during this tick gets its first data next tick */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		memset(mix->buffer, 0, sizeof(mix->buffer));
+		if ((active_mixes & (1 << mix_idx)) == 0)
+			continue;
+
+		for (size_t i = 0; i < audio->planes; i++)
+			memset(mix->buffer[i], 0, bytes);
 
 		for (size_t i = 0; i < audio->planes; i++)
 			data[mix_idx].data[i] = mix->buffer[i];
@@ -195,11 +203,13 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time, ui
 		return;
 
 	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, active_mixes, bytes);
 
 	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if (active_mixes & (1 << i))
+			do_audio_output(audio, i, new_ts, audio->info.frames_per_tick);
+	}
 }
 
 static void *audio_thread(void *param)
@@ -221,19 +231,33 @@ static void *audio_thread(void *param)
 		profile_store_name(obs_get_profiler_name_store(), "audio_thread(%s)", audio->info.name);
 
 	while (os_event_try(audio->stop_event) == EAGAIN) {
-		samples += AUDIO_OUTPUT_FRAMES;
+		samples += audio->info.frames_per_tick;
 		uint64_t audio_time = start_time + audio_frames_to_ns(rate, samples);
+		bool manual = os_atomic_load_bool(&audio->manual_clock);
+
+		if (manual) {
+			os_sem_wait(audio->step_sem);
+			if (os_event_try(audio->stop_event) != EAGAIN)
+				break;
+		} else {
+			os_sleepto_ns_fast(audio_time);
+		}
 
-		os_sleepto_ns_fast(audio_time);
+		obs_apply_core_thread_affinity();
 
 		profile_start(audio_thread_name);
 
 		input_and_output(audio, audio_time, prev_time);
+		while (os_atomic_exchange_bool(&audio->catch_up, false))
+			input_and_output(audio, audio_time, prev_time);
 		prev_time = audio_time;
 
 		profile_end(audio_thread_name);
 
 		profile_reenable_thread();
+
+		if (manual)
+			os_sem_post(audio->step_done_sem);
 	}
 
 #ifdef _WIN32
@@ -286,6 +310,19 @@ static inline bool audio_input_init(struct audio_input *input, struct audio_outp
 	return true;
 }
 
+/* assumes input_mutex */
+static void update_active_mixes(struct audio_output *audio)
+{
+	long active_mixes = 0;
+
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if (audio->mixes[i].inputs.num)
+			active_mixes |= (1 << i);
+	}
+
+	os_atomic_set_long(&audio->active_mixes, active_mixes);
+}
+
 bool audio_output_connect(audio_t *audio, size_t mi, const struct audio_convert_info *conversion,
 			  audio_output_callback_t callback, void *param)
 {
@@ -319,8 +356,10 @@ bool audio_output_connect(audio_t *audio, size_t mi, const struct audio_convert_
 			input.conversion.samples_per_sec = audio->info.samples_per_sec;
 
 		success = audio_input_init(&input, audio);
-		if (success)
+		if (success) {
 			da_push_back(mix->inputs, &input);
+			update_active_mixes(audio);
+		}
 	}
 
 	pthread_mutex_unlock(&audio->input_mutex);
@@ -340,6 +379,7 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx, audio_output_callba
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 		audio_input_free(mix->inputs.array + idx);
 		da_erase(mix->inputs, idx);
+		update_active_mixes(audio);
 	}
 
 	pthread_mutex_unlock(&audio->input_mutex);
@@ -363,6 +403,10 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail0;
 
 	memcpy(&out->info, info, sizeof(struct audio_output_info));
+	if (!out->info.frames_per_tick || out->info.frames_per_tick > AUDIO_OUTPUT_FRAMES)
+		out->info.frames_per_tick = AUDIO_OUTPUT_FRAMES;
+	else if (out->info.frames_per_tick < AUDIO_OUTPUT_MIN_FRAMES)
+		out->info.frames_per_tick = AUDIO_OUTPUT_MIN_FRAMES;
 	out->channels = get_audio_channels(info->speakers);
 	out->planes = planar ? out->channels : 1;
 	out->input_cb = info->input_callback;
@@ -373,13 +417,21 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail0;
 	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail1;
-	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+	if (os_sem_init(&out->step_sem, 0) != 0)
 		goto fail2;
+	if (os_sem_init(&out->step_done_sem, 0) != 0)
+		goto fail3;
+	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+		goto fail4;
 
 	out->initialized = true;
 	*audio = out;
 	return AUDIO_OUTPUT_SUCCESS;
 
+fail4:
+	os_sem_destroy(out->step_done_sem);
+fail3:
+	os_sem_destroy(out->step_sem);
 fail2:
 	os_event_destroy(out->stop_event);
 fail1:
@@ -398,7 +450,10 @@ void audio_output_close(audio_t *audio)
 
 	if (audio->initialized) {
 		os_event_signal(audio->stop_event);
+		os_sem_post(audio->step_sem);
 		pthread_join(audio->thread, &thread_ret);
+		os_sem_destroy(audio->step_done_sem);
+		os_sem_destroy(audio->step_sem);
 		os_event_destroy(audio->stop_event);
 		pthread_mutex_destroy(&audio->input_mutex);
 	}
@@ -419,19 +474,28 @@ const struct audio_output_info *audio_output_get_info(const audio_t *audio)
 	return audio ? &audio->info : NULL;
 }
 
-bool audio_output_active(const audio_t *audio)
+void audio_output_catch_up(audio_t *audio)
+{
+	if (audio)
+		os_atomic_set_bool(&audio->catch_up, true);
+}
+
+void audio_output_step(audio_t *audio)
 {
 	if (!audio)
-		return false;
+		return;
 
-	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		const struct audio_mix *mix = &audio->mixes[mix_idx];
+	os_atomic_set_bool(&audio->manual_clock, true);
+	os_sem_post(audio->step_sem);
+	os_sem_wait(audio->step_done_sem);
+}
 
-		if (mix->inputs.num != 0)
-			return true;
-	}
+bool audio_output_active(const audio_t *audio)
+{
+	if (!audio)
+		return false;
 
-	return false;
+	return os_atomic_load_long(&audio->active_mixes) != 0;
 }
 
 size_t audio_output_get_block_size(const audio_t *audio)
@@ -453,3 +517,8 @@ uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio->info.samples_per_sec;
 }
+
+uint32_t audio_output_get_frames_per_tick(const audio_t *audio)
+{
+	return audio ? audio->info.frames_per_tick : AUDIO_OUTPUT_FRAMES;
+}
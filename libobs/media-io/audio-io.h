@@ -29,6 +29,7 @@ extern "C" {
 #define MAX_AUDIO_CHANNELS 8
 #define MAX_DEVICE_INPUT_CHANNELS 64
 #define AUDIO_OUTPUT_FRAMES 1024
+#define AUDIO_OUTPUT_MIN_FRAMES 64
 
 #define TOTAL_AUDIO_SIZE (MAX_AUDIO_MIXES * MAX_AUDIO_CHANNELS * AUDIO_OUTPUT_FRAMES * sizeof(float))
 
@@ -96,6 +97,11 @@ struct audio_output_info {
 
 	audio_input_callback_t input_callback;
 	void *input_param;
+
+	/* Frames mixed per audio tick.  0 selects AUDIO_OUTPUT_FRAMES; other
+	 * values are clamped to AUDIO_OUTPUT_MIN_FRAMES..AUDIO_OUTPUT_FRAMES.
+	 * Mix buffers are always AUDIO_OUTPUT_FRAMES in size. */
+	uint32_t frames_per_tick;
 };
 
 struct audio_convert_info {
@@ -221,8 +227,20 @@ EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
 EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
+EXPORT uint32_t audio_output_get_frames_per_tick(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(const audio_t *audio);
 
+/* Runs one more tick right after the current one instead of waiting for the
+ * clock, handing the input callback the same times again.  Called from the
+ * input callback to drain a tick of buffering without a gap in the output. */
+EXPORT void audio_output_catch_up(audio_t *audio);
+
+/* Stops following the clock and runs exactly one tick per call, returning
+ * once the tick is done.  The output stays on the manual clock until it is
+ * closed.  Meant for benchmarks and tests that need to run the audio
+ * pipeline faster than real time. */
+EXPORT void audio_output_step(audio_t *audio);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
 
 #include "../util/c99defs.h"
 #include <math.h>
+#include <stdint.h>
 
 #ifdef _MSC_VER
 #include <float.h>
@@ -38,6 +39,73 @@ static inline float db_to_mul(const float db)
 	return isfinite((double)db) ? powf(10.0f, db / 20.0f) : 0.0f;
 }
 
+/* Branch free approximations for per sample loops, which the compiler can
+ * vectorize (GCC needs -fno-trapping-math to if-convert them).  For normal
+ * floats, fast_mul_to_db is within 1e-4 dB of mul_to_db and fast_db_to_mul
+ * within 1e-5 relative error of db_to_mul.  Unlike db_to_mul, only -inf
+ * maps to 0. */
+
+static inline float fast_log2f(const float x)
+{
+	union {
+		float f;
+		uint32_t i;
+	} u = {x};
+
+	float e = (float)((int32_t)((u.i >> 23) & 0xff) - 127);
+	u.i = (u.i & 0x007fffff) | 0x3f800000;
+
+	/* mantissa in [sqrt(0.5), sqrt(2)) keeps the series short */
+	const bool high = u.f > 1.41421356f;
+	const float m = u.f * (high ? 0.5f : 1.0f);
+	e += high ? 1.0f : 0.0f;
+
+	const float t = (m - 1.0f) / (m + 1.0f);
+	const float t2 = t * t;
+	return e + t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f)));
+}
+
+static inline float fast_exp2f(const float x)
+{
+	union {
+		float f;
+		uint32_t i;
+	} u;
+
+	/* plain compares instead of fminf/fmaxf/floorf, which are library
+	 * calls without fast math and block vectorization */
+	float c = (x > -126.0f) ? x : -126.0f;
+	c = (c < 127.0f) ? c : 127.0f;
+
+	/* biased to be positive so truncation rounds to nearest */
+	const int32_t n = (int32_t)(c + 127.5f) - 127;
+	const float f = c - (float)n;
+
+	float p = 0.000154035304f;
+	p = p * f + 0.00133335581f;
+	p = p * f + 0.00961812911f;
+	p = p * f + 0.0555041087f;
+	p = p * f + 0.240226507f;
+	p = p * f + 0.693147181f;
+	p = p * f + 1.0f;
+
+	u.i = (uint32_t)(n + 127) << 23;
+	const float r = u.f * p;
+	return (x < -126.0f) ? 0.0f : r;
+}
+
+static inline float fast_mul_to_db(const float mul)
+{
+	const float db = 6.02059991f * fast_log2f(mul);
+	return (mul == 0.0f) ? -INFINITY : db;
+}
+
+static inline float fast_db_to_mul(const float db)
+{
+	/* -inf underflows to 0 */
+	return fast_exp2f(db * 0.166096405f);
+}
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -0,0 +1,56 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+#include "../util/sse-intrin.h"
+
+/* Float mixing kernels used by the audio pipeline.  SSE2 on x86, mapped to
+ * NEON by SIMDe elsewhere.  Results are identical to the scalar loops. */
+
+/* out[i] += in[i] */
+static inline void audio_mix_add(float *out, const float *in, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i));
+		__m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_loadu_ps(in + i + 4));
+		_mm_storeu_ps(out + i, a);
+		_mm_storeu_ps(out + i + 4, b);
+	}
+
+	for (; i < count; i++)
+		out[i] += in[i];
+}
+
+/* out[i] += in[i] * mul[i] */
+static inline void audio_mix_add_mul(float *out, const float *in, const float *mul, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(mul + i));
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), _mm_loadu_ps(mul + i + 4));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), a));
+		_mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_loadu_ps(out + i + 4), b));
+	}
+
+	for (; i < count; i++)
+		out[i] += in[i] * mul[i];
+}
@@ -0,0 +1,302 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "../util/bmem.h"
+#include "../util/darray.h"
+#include "../util/threading.h"
+#include "../util/sse-intrin.h"
+#include "audio-polyphase.h"
+#include "audio-io.h"
+
+/* 44.1k <-> 48k needs 160 phases, anything beyond this is an odd ratio
+ * that swresample handles better */
+#define MAX_PHASES 1024
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+struct polyphase_table {
+	uint32_t phases;
+	uint32_t step;
+	uint32_t taps;
+	long refs;
+
+	/* phases * taps coefficients, phase major */
+	float *coeffs;
+};
+
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct polyphase_table *) tables;
+
+struct audio_polyphase {
+	struct polyphase_table *table;
+	uint32_t in_rate;
+	uint32_t channels;
+
+	float *buf[MAX_AUDIO_CHANNELS];
+	size_t len;
+	size_t capacity;
+
+	/* the next output reads buf[pos] to buf[pos + taps - 1] with the
+	 * coefficients of this phase */
+	size_t pos;
+	uint32_t phase;
+};
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* zeroth order modified bessel function of the first kind */
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+
+	return sum;
+}
+
+static void build_table(struct polyphase_table *table)
+{
+	const uint32_t taps = table->taps;
+	const uint32_t half = taps / 2;
+	const double ratio = (double)table->phases / (double)table->step;
+
+	/* longer filters afford a sharper transition and a cutoff closer to
+	 * nyquist */
+	const double rolloff = 1.0 - 2.4 / (double)taps;
+	const double beta = taps >= 64 ? 10.0 : (double)taps / 8.0 + 2.0;
+	const double cutoff = rolloff * (ratio < 1.0 ? ratio : 1.0);
+	const double i0_beta = bessel_i0(beta);
+
+	table->coeffs = bmalloc(sizeof(float) * table->phases * taps);
+
+	for (uint32_t p = 0; p < table->phases; p++) {
+		float *coeffs = table->coeffs + p * taps;
+		double sum = 0.0;
+
+		for (uint32_t t = 0; t < taps; t++) {
+			/* distance from the output point, in input samples */
+			double d = (double)t - (double)(half - 1) - (double)p / (double)table->phases;
+			double x = d * cutoff;
+			double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			double w = d / (double)half;
+			double window = fabs(w) < 1.0 ? bessel_i0(beta * sqrt(1.0 - w * w)) / i0_beta : 0.0;
+
+			coeffs[t] = (float)(sinc * window);
+			sum += coeffs[t];
+		}
+
+		/* unity gain at DC for every phase */
+		for (uint32_t t = 0; t < taps; t++)
+			coeffs[t] = (float)(coeffs[t] / sum);
+	}
+}
+
+static struct polyphase_table *get_table(uint32_t phases, uint32_t step, uint32_t taps)
+{
+	struct polyphase_table *table = NULL;
+
+	pthread_mutex_lock(&table_mutex);
+
+	for (size_t i = 0; i < tables.num; i++) {
+		struct polyphase_table *cur = tables.array[i];
+		if (cur->phases == phases && cur->step == step && cur->taps == taps) {
+			table = cur;
+			break;
+		}
+	}
+
+	if (!table) {
+		table = bzalloc(sizeof(*table));
+		table->phases = phases;
+		table->step = step;
+		table->taps = taps;
+		build_table(table);
+		da_push_back(tables, &table);
+	}
+
+	table->refs++;
+
+	pthread_mutex_unlock(&table_mutex);
+	return table;
+}
+
+static void release_table(struct polyphase_table *table)
+{
+	pthread_mutex_lock(&table_mutex);
+
+	if (--table->refs == 0) {
+		da_erase_item(tables, &table);
+		if (!tables.num)
+			da_free(tables);
+
+		bfree(table->coeffs);
+		bfree(table);
+	}
+
+	pthread_mutex_unlock(&table_mutex);
+}
+
+struct audio_polyphase *audio_polyphase_create(uint32_t in_rate, uint32_t out_rate, uint32_t channels,
+					       uint32_t taps)
+{
+	struct audio_polyphase *ph;
+	uint32_t div;
+
+	if (!in_rate || !out_rate || !channels || channels > MAX_AUDIO_CHANNELS)
+		return NULL;
+	if (!taps || taps % 4)
+		return NULL;
+
+	div = gcd(in_rate, out_rate);
+	if (out_rate / div > MAX_PHASES)
+		return NULL;
+
+	ph = bzalloc(sizeof(*ph));
+	ph->table = get_table(out_rate / div, in_rate / div, taps);
+	ph->in_rate = in_rate;
+	ph->channels = channels;
+
+	/* pad with silence so the first output lands on the first input */
+	const uint32_t lead = taps / 2 - 1;
+	for (uint32_t ch = 0; ch < channels; ch++)
+		memset(audio_polyphase_reserve(ph, ch, lead), 0, sizeof(float) * lead);
+	audio_polyphase_commit(ph, lead);
+
+	return ph;
+}
+
+void audio_polyphase_destroy(struct audio_polyphase *ph)
+{
+	if (!ph)
+		return;
+
+	for (uint32_t ch = 0; ch < ph->channels; ch++)
+		bfree(ph->buf[ch]);
+
+	release_table(ph->table);
+	bfree(ph);
+}
+
+float *audio_polyphase_reserve(struct audio_polyphase *ph, uint32_t channel, uint32_t frames)
+{
+	if (ph->len + frames > ph->capacity) {
+		size_t capacity = ph->capacity ? ph->capacity : 1024;
+
+		while (capacity < ph->len + frames)
+			capacity *= 2;
+
+		for (uint32_t ch = 0; ch < ph->channels; ch++)
+			ph->buf[ch] = brealloc(ph->buf[ch], sizeof(float) * capacity);
+		ph->capacity = capacity;
+	}
+
+	return ph->buf[channel] + ph->len;
+}
+
+void audio_polyphase_commit(struct audio_polyphase *ph, uint32_t frames)
+{
+	ph->len += frames;
+}
+
+uint32_t audio_polyphase_max_output(const struct audio_polyphase *ph)
+{
+	const struct polyphase_table *table = ph->table;
+
+	if (ph->len < ph->pos + table->taps)
+		return 0;
+
+	/* outputs n read from pos + (phase + n * step) / phases, which has
+	 * to stay within len - taps */
+	uint64_t room = (uint64_t)(ph->len - table->taps - ph->pos) + 1;
+	uint64_t count = (room * table->phases - ph->phase + table->step - 1) / table->step;
+	return (uint32_t)count;
+}
+
+static inline float dot_product(const float *a, const float *b, uint32_t count)
+{
+	__m128 sum = _mm_setzero_ps();
+
+	for (uint32_t i = 0; i < count; i += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+uint32_t audio_polyphase_process(struct audio_polyphase *ph, float *const out[], size_t step, uint32_t max_frames)
+{
+	const struct polyphase_table *table = ph->table;
+	const uint32_t taps = table->taps;
+	uint32_t frames = audio_polyphase_max_output(ph);
+
+	if (frames > max_frames)
+		frames = max_frames;
+
+	for (uint32_t n = 0; n < frames; n++) {
+		const float *coeffs = table->coeffs + ph->phase * taps;
+
+		for (uint32_t ch = 0; ch < ph->channels; ch++)
+			out[ch][n * step] = dot_product(ph->buf[ch] + ph->pos, coeffs, taps);
+
+		ph->phase += table->step;
+		ph->pos += ph->phase / table->phases;
+		ph->phase %= table->phases;
+	}
+
+	/* drop the input no future output reads.  when downsampling hard,
+	 * the next output may start past what was received so far */
+	size_t drop = ph->pos < ph->len ? ph->pos : ph->len;
+	if (drop) {
+		for (uint32_t ch = 0; ch < ph->channels; ch++)
+			memmove(ph->buf[ch], ph->buf[ch] + drop, sizeof(float) * (ph->len - drop));
+		ph->len -= drop;
+		ph->pos -= drop;
+	}
+
+	return frames;
+}
+
+uint64_t audio_polyphase_delay_ns(const struct audio_polyphase *ph)
+{
+	const struct polyphase_table *table = ph->table;
+	double point = (double)(ph->pos + table->taps / 2 - 1) + (double)ph->phase / (double)table->phases;
+	double pending = (double)ph->len - point;
+
+	if (pending <= 0.0)
+		return 0;
+	return (uint64_t)(pending * 1000000000.0 / (double)ph->in_rate);
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Built-in polyphase FIR resampler for float samples, used by
+ * audio-resampler-ffmpeg.c.  Filter tables only depend on the rate ratio
+ * and filter length, so every resampler with the same ones shares a
+ * single table. */
+
+struct audio_polyphase;
+
+/* taps: filter length per phase, a multiple of 4.  Returns NULL if the
+ * ratio needs more phases than is reasonable to tabulate. */
+struct audio_polyphase *audio_polyphase_create(uint32_t in_rate, uint32_t out_rate, uint32_t channels,
+					       uint32_t taps);
+void audio_polyphase_destroy(struct audio_polyphase *ph);
+
+/* returns room for frames input samples of a channel, valid until commit */
+float *audio_polyphase_reserve(struct audio_polyphase *ph, uint32_t channel, uint32_t frames);
+void audio_polyphase_commit(struct audio_polyphase *ph, uint32_t frames);
+
+/* most frames the next audio_polyphase_process can produce */
+uint32_t audio_polyphase_max_output(const struct audio_polyphase *ph);
+
+/* writes channel ch of output frame n to out[ch][n * step] */
+uint32_t audio_polyphase_process(struct audio_polyphase *ph, float *const out[], size_t step, uint32_t max_frames);
+
+/* input received but not output yet, in nanoseconds */
+uint64_t audio_polyphase_delay_ns(const struct audio_polyphase *ph);
+
+#ifdef __cplusplus
+}
+#endif
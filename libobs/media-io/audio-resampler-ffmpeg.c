@@ -15,17 +15,35 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <math.h>
+
 #include "../util/bmem.h"
+#include "../util/sse-intrin.h"
+#include "../util/threading.h"
 #include "audio-resampler.h"
+#include "audio-polyphase.h"
 #include "audio-io.h"
 #include <libavutil/avutil.h>
+#include <libavutil/opt.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
+static volatile long resampler_engine = AUDIO_RESAMPLER_ENGINE_DEFAULT;
+static volatile long resampler_quality = AUDIO_RESAMPLER_QUALITY_DEFAULT;
+
 struct audio_resampler {
 	struct SwrContext *context;
 	bool opened;
 
+	/* same rate and layout: convert directly without swresample */
+	bool direct;
+	enum audio_format direct_input_format;
+	enum audio_format direct_output_format;
+
+	/* same layout, different rate: built-in engine, when selected.  uses
+	 * the direct formats */
+	struct audio_polyphase *polyphase;
+
 	uint32_t input_freq;
 	enum AVSampleFormat input_format;
 	uint8_t *output_buffer[MAX_AV_PLANES];
@@ -97,9 +115,314 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 }
 #endif
 
+/* ------------------------------------------------------------------------- */
+/* direct conversion, for when neither the rate nor the layout change        */
+
+static enum audio_format packed_format(enum audio_format format)
+{
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT_PLANAR:
+		return AUDIO_FORMAT_U8BIT;
+	case AUDIO_FORMAT_16BIT_PLANAR:
+		return AUDIO_FORMAT_16BIT;
+	case AUDIO_FORMAT_32BIT_PLANAR:
+		return AUDIO_FORMAT_32BIT;
+	case AUDIO_FORMAT_FLOAT_PLANAR:
+		return AUDIO_FORMAT_FLOAT;
+	default:
+		return format;
+	}
+}
+
+static bool can_convert_directly(const struct resample_info *dst, const struct resample_info *src)
+{
+	enum audio_format src_fmt = packed_format(src->format);
+	enum audio_format dst_fmt = packed_format(dst->format);
+
+	if (src->samples_per_sec != dst->samples_per_sec || src->speakers != dst->speakers ||
+	    src->speakers == SPEAKERS_UNKNOWN)
+		return false;
+	if (src_fmt == AUDIO_FORMAT_UNKNOWN || dst_fmt == AUDIO_FORMAT_UNKNOWN)
+		return false;
+
+	/* integer to integer conversions are left to swresample */
+	return src_fmt == dst_fmt || src_fmt == AUDIO_FORMAT_FLOAT || dst_fmt == AUDIO_FORMAT_FLOAT;
+}
+
+/* The scalar conversions below match what swresample does for the same
+ * sample formats, so output does not change depending on the path taken. */
+
+static inline float sample_to_float(const uint8_t *src, enum audio_format format)
+{
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT:
+		return (float)((int)*src - 0x80) * (1.0f / (1 << 7));
+	case AUDIO_FORMAT_16BIT:
+		return (float)*(const int16_t *)src * (1.0f / (1 << 15));
+	case AUDIO_FORMAT_32BIT:
+		return (float)*(const int32_t *)src * (1.0f / (1U << 31));
+	default:
+		return *(const float *)src;
+	}
+}
+
+static inline void float_to_sample(uint8_t *dst, float val, enum audio_format format)
+{
+	switch (format) {
+	case AUDIO_FORMAT_U8BIT: {
+		long v = lrintf(val * (1 << 7)) + 0x80;
+		*dst = (uint8_t)(v < 0 ? 0 : (v > 0xFF ? 0xFF : v));
+		break;
+	}
+	case AUDIO_FORMAT_16BIT: {
+		long v = lrintf(val * (1 << 15));
+		*(int16_t *)dst = (int16_t)(v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v));
+		break;
+	}
+	case AUDIO_FORMAT_32BIT: {
+		long long v = llrintf(val * (1U << 31));
+		*(int32_t *)dst = (int32_t)(v < INT32_MIN ? INT32_MIN : (v > INT32_MAX ? INT32_MAX : v));
+		break;
+	}
+	default:
+		*(float *)dst = val;
+	}
+}
+
+static void convert_channel(uint8_t *dst, size_t dst_step, enum audio_format dst_fmt, const uint8_t *src,
+			    size_t src_step, enum audio_format src_fmt, uint32_t frames)
+{
+	if (src_fmt == dst_fmt) {
+		const size_t size = get_audio_bytes_per_channel(src_fmt);
+
+		for (uint32_t i = 0; i < frames; i++) {
+			memcpy(dst, src, size);
+			dst += dst_step;
+			src += src_step;
+		}
+	} else if (dst_fmt == AUDIO_FORMAT_FLOAT) {
+		for (uint32_t i = 0; i < frames; i++) {
+			*(float *)dst = sample_to_float(src, src_fmt);
+			dst += dst_step;
+			src += src_step;
+		}
+	} else {
+		for (uint32_t i = 0; i < frames; i++) {
+			float_to_sample(dst, *(const float *)src, dst_fmt);
+			dst += dst_step;
+			src += src_step;
+		}
+	}
+}
+
+/* the layouts audio outputs and most sources use get dedicated kernels */
+
+static void interleave_float_stereo(float *dst, const float *left, const float *right, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 l = _mm_loadu_ps(left + i);
+		__m128 r = _mm_loadu_ps(right + i);
+		_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+		_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+	}
+
+	for (; i < frames; i++) {
+		dst[i * 2] = left[i];
+		dst[i * 2 + 1] = right[i];
+	}
+}
+
+static void deinterleave_float_stereo(float *left, float *right, const float *src, uint32_t frames)
+{
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_loadu_ps(src + i * 2);
+		__m128 b = _mm_loadu_ps(src + i * 2 + 4);
+		_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+
+	for (; i < frames; i++) {
+		left[i] = src[i * 2];
+		right[i] = src[i * 2 + 1];
+	}
+}
+
+static void deinterleave_s16_stereo_to_float(float *left, float *right, const int16_t *src, uint32_t frames)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / (1 << 15));
+	uint32_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		/* sign extend L R L R ... to 32 bits, then split */
+		__m128i in = _mm_loadl_epi64((const __m128i *)(src + i * 2));
+		__m128i wide = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+		__m128 a = _mm_mul_ps(_mm_cvtepi32_ps(wide), scale);
+
+		in = _mm_loadl_epi64((const __m128i *)(src + i * 2 + 4));
+		wide = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+		__m128 b = _mm_mul_ps(_mm_cvtepi32_ps(wide), scale);
+
+		_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+
+	for (; i < frames; i++) {
+		left[i] = (float)src[i * 2] * (1.0f / (1 << 15));
+		right[i] = (float)src[i * 2 + 1] * (1.0f / (1 << 15));
+	}
+}
+
+static void convert_directly(struct audio_resampler *rs, uint8_t *output[], const uint8_t *const input[],
+			     uint32_t frames)
+{
+	const enum audio_format in_fmt = rs->direct_input_format;
+	const enum audio_format out_fmt = rs->direct_output_format;
+	const bool in_planar = is_audio_planar(in_fmt);
+	const bool out_planar = is_audio_planar(out_fmt);
+	const enum audio_format in_packed = packed_format(in_fmt);
+	const enum audio_format out_packed = packed_format(out_fmt);
+	const size_t in_size = get_audio_bytes_per_channel(in_fmt);
+	const size_t out_size = get_audio_bytes_per_channel(out_fmt);
+	const uint32_t channels = rs->output_ch;
+
+	if (channels == 2) {
+		if (in_fmt == AUDIO_FORMAT_FLOAT_PLANAR && out_fmt == AUDIO_FORMAT_FLOAT) {
+			interleave_float_stereo((float *)output[0], (const float *)input[0], (const float *)input[1],
+						frames);
+			return;
+		}
+		if (in_fmt == AUDIO_FORMAT_FLOAT && out_fmt == AUDIO_FORMAT_FLOAT_PLANAR) {
+			deinterleave_float_stereo((float *)output[0], (float *)output[1], (const float *)input[0],
+						  frames);
+			return;
+		}
+		if (in_fmt == AUDIO_FORMAT_16BIT && out_fmt == AUDIO_FORMAT_FLOAT_PLANAR) {
+			deinterleave_s16_stereo_to_float((float *)output[0], (float *)output[1],
+							 (const int16_t *)input[0], frames);
+			return;
+		}
+	}
+
+	for (uint32_t ch = 0; ch < channels; ch++) {
+		const uint8_t *src = in_planar ? input[ch] : input[0] + ch * in_size;
+		uint8_t *dst = out_planar ? output[ch] : output[0] + ch * out_size;
+		const size_t src_step = in_planar ? in_size : in_size * channels;
+		const size_t dst_step = out_planar ? out_size : out_size * channels;
+
+		convert_channel(dst, dst_step, out_packed, src, src_step, in_packed, frames);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* built-in polyphase engine                                                 */
+
+static bool can_use_polyphase(const struct resample_info *dst, const struct resample_info *src)
+{
+	if (src->speakers != dst->speakers || src->speakers == SPEAKERS_UNKNOWN)
+		return false;
+
+	return packed_format(src->format) != AUDIO_FORMAT_UNKNOWN && packed_format(dst->format) == AUDIO_FORMAT_FLOAT;
+}
+
+static uint32_t polyphase_taps(enum audio_resampler_quality quality)
+{
+	switch (quality) {
+	case AUDIO_RESAMPLER_QUALITY_LOW:
+		return 16;
+	case AUDIO_RESAMPLER_QUALITY_HIGH:
+		return 64;
+	default:
+		return 32;
+	}
+}
+
+static inline void ensure_output_size(struct audio_resampler *rs, int frames)
+{
+	if (frames > rs->output_size) {
+		if (rs->output_buffer[0])
+			av_freep(&rs->output_buffer[0]);
+
+		av_samples_alloc(rs->output_buffer, NULL, rs->output_ch, frames, rs->output_format, 0);
+
+		rs->output_size = frames;
+	}
+}
+
+static void resample_polyphase(struct audio_resampler *rs, uint8_t *output[], uint32_t *out_frames,
+			       uint64_t *ts_offset, const uint8_t *const input[], uint32_t in_frames)
+{
+	const enum audio_format in_fmt = rs->direct_input_format;
+	const bool in_planar = is_audio_planar(in_fmt);
+	const bool out_planar = is_audio_planar(rs->direct_output_format);
+	const enum audio_format in_packed = packed_format(in_fmt);
+	const size_t in_size = get_audio_bytes_per_channel(in_fmt);
+	const uint32_t channels = rs->output_ch;
+	float *out[MAX_AUDIO_CHANNELS];
+
+	*ts_offset = audio_polyphase_delay_ns(rs->polyphase);
+
+	for (uint32_t ch = 0; ch < channels; ch++) {
+		const uint8_t *src = in_planar ? input[ch] : input[0] + ch * in_size;
+		const size_t src_step = in_planar ? in_size : in_size * channels;
+		float *dst = audio_polyphase_reserve(rs->polyphase, ch, in_frames);
+
+		convert_channel((uint8_t *)dst, sizeof(float), AUDIO_FORMAT_FLOAT, src, src_step, in_packed, in_frames);
+	}
+	audio_polyphase_commit(rs->polyphase, in_frames);
+
+	ensure_output_size(rs, (int)audio_polyphase_max_output(rs->polyphase));
+
+	for (uint32_t ch = 0; ch < channels; ch++)
+		out[ch] = out_planar ? (float *)rs->output_buffer[ch] : (float *)rs->output_buffer[0] + ch;
+
+	*out_frames = audio_polyphase_process(rs->polyphase, out, out_planar ? 1 : channels, (uint32_t)rs->output_size);
+
+	for (uint32_t i = 0; i < rs->output_planes; i++)
+		output[i] = rs->output_buffer[i];
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void set_swr_options(struct SwrContext *context, enum audio_resampler_engine engine,
+			    enum audio_resampler_quality quality)
+{
+	if (engine == AUDIO_RESAMPLER_ENGINE_SOXR) {
+		av_opt_set_int(context, "resampler", SWR_ENGINE_SOXR, 0);
+
+		/* bits of precision */
+		if (quality == AUDIO_RESAMPLER_QUALITY_LOW)
+			av_opt_set_double(context, "precision", 16.0, 0);
+		else if (quality == AUDIO_RESAMPLER_QUALITY_HIGH)
+			av_opt_set_double(context, "precision", 28.0, 0);
+		return;
+	}
+
+	/* swresample defaults to a 32 tap filter and 1024 phases */
+	if (quality == AUDIO_RESAMPLER_QUALITY_LOW) {
+		av_opt_set_int(context, "filter_size", 8, 0);
+		av_opt_set_int(context, "phase_shift", 6, 0);
+	} else if (quality == AUDIO_RESAMPLER_QUALITY_HIGH) {
+		av_opt_set_int(context, "filter_size", 64, 0);
+		av_opt_set_int(context, "phase_shift", 12, 0);
+		av_opt_set_double(context, "cutoff", 0.97, 0);
+	}
+}
+
+void audio_resampler_set_engine(enum audio_resampler_engine engine, enum audio_resampler_quality quality)
+{
+	os_atomic_set_long(&resampler_engine, (long)engine);
+	os_atomic_set_long(&resampler_quality, (long)quality);
+}
+
 audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const struct resample_info *src)
 {
 	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
+	enum audio_resampler_engine engine = (enum audio_resampler_engine)os_atomic_load_long(&resampler_engine);
+	enum audio_resampler_quality quality = (enum audio_resampler_quality)os_atomic_load_long(&resampler_quality);
 	int errcode;
 
 	rs->opened = false;
@@ -111,6 +434,23 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const
 	rs->output_format = convert_audio_format(dst->format);
 	rs->output_planes = is_audio_planar(dst->format) ? rs->output_ch : 1;
 
+	if (can_convert_directly(dst, src)) {
+		rs->direct = true;
+		rs->direct_input_format = src->format;
+		rs->direct_output_format = dst->format;
+		return rs;
+	}
+
+	if (engine == AUDIO_RESAMPLER_ENGINE_POLYPHASE && can_use_polyphase(dst, src)) {
+		rs->polyphase = audio_polyphase_create(src->samples_per_sec, dst->samples_per_sec, rs->output_ch,
+						       polyphase_taps(quality));
+		if (rs->polyphase) {
+			rs->direct_input_format = src->format;
+			rs->direct_output_format = dst->format;
+			return rs;
+		}
+	}
+
 #if (LIBSWRESAMPLE_VERSION_INT < AV_VERSION_INT(4, 5, 100))
 	rs->input_layout = convert_speaker_layout(src->speakers);
 	rs->output_layout = convert_speaker_layout(dst->speakers);
@@ -156,7 +496,16 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const
 			blog(LOG_DEBUG, "swr_set_matrix failed for mono upmix\n");
 	}
 
+	if (engine != AUDIO_RESAMPLER_ENGINE_POLYPHASE)
+		set_swr_options(rs->context, engine, quality);
+
 	errcode = swr_init(rs->context);
+	if (errcode != 0 && engine == AUDIO_RESAMPLER_ENGINE_SOXR) {
+		/* swresample built without libsoxr */
+		blog(LOG_DEBUG, "soxr resampler unavailable, using swresample's own");
+		av_opt_set_int(rs->context, "resampler", SWR_ENGINE_SWR, 0);
+		errcode = swr_init(rs->context);
+	}
 	if (errcode != 0) {
 		blog(LOG_ERROR, "avresample_open failed: error code %d", errcode);
 		audio_resampler_destroy(rs);
@@ -171,6 +520,7 @@ void audio_resampler_destroy(audio_resampler_t *rs)
 	if (rs) {
 		if (rs->context)
 			swr_free(&rs->context);
+		audio_polyphase_destroy(rs->polyphase);
 		if (rs->output_buffer[0])
 			av_freep(&rs->output_buffer[0]);
 
@@ -184,6 +534,23 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[], uint32_t
 	if (!rs)
 		return false;
 
+	if (rs->direct) {
+		ensure_output_size(rs, (int)in_frames);
+		convert_directly(rs, rs->output_buffer, input, in_frames);
+
+		for (uint32_t i = 0; i < rs->output_planes; i++)
+			output[i] = rs->output_buffer[i];
+
+		*out_frames = in_frames;
+		*ts_offset = 0;
+		return true;
+	}
+
+	if (rs->polyphase) {
+		resample_polyphase(rs, output, out_frames, ts_offset, input, in_frames);
+		return true;
+	}
+
 	struct SwrContext *context = rs->context;
 	int ret;
 
@@ -194,14 +561,7 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[], uint32_t
 	*ts_offset = (uint64_t)swr_get_delay(context, 1000000000);
 
 	/* resize the buffer if bigger */
-	if (estimated > rs->output_size) {
-		if (rs->output_buffer[0])
-			av_freep(&rs->output_buffer[0]);
-
-		av_samples_alloc(rs->output_buffer, NULL, rs->output_ch, estimated, rs->output_format, 0);
-
-		rs->output_size = estimated;
-	}
+	ensure_output_size(rs, estimated);
 
 	ret = swr_convert(context, rs->output_buffer, rs->output_size, (const uint8_t **)input, in_frames);
 
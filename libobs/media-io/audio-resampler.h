@@ -33,6 +33,27 @@ struct resample_info {
 	enum speaker_layout speakers;
 };
 
+enum audio_resampler_engine {
+	/** swresample's own resampler */
+	AUDIO_RESAMPLER_ENGINE_DEFAULT,
+	/** swresample through libsoxr, the default engine if unavailable */
+	AUDIO_RESAMPLER_ENGINE_SOXR,
+	/** built-in polyphase filter, filter tables are shared between
+	 * resamplers with the same rates.  Same-layout conversions only,
+	 * anything else uses the default engine */
+	AUDIO_RESAMPLER_ENGINE_POLYPHASE,
+};
+
+enum audio_resampler_quality {
+	AUDIO_RESAMPLER_QUALITY_DEFAULT,
+	AUDIO_RESAMPLER_QUALITY_LOW,
+	AUDIO_RESAMPLER_QUALITY_MEDIUM,
+	AUDIO_RESAMPLER_QUALITY_HIGH,
+};
+
+/** Sets the engine and quality of resamplers created from then on */
+EXPORT void audio_resampler_set_engine(enum audio_resampler_engine engine, enum audio_resampler_quality quality);
+
 EXPORT audio_resampler_t *audio_resampler_create(const struct resample_info *dst, const struct resample_info *src);
 EXPORT void audio_resampler_destroy(audio_resampler_t *resampler);
 
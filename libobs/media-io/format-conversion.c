@@ -173,6 +173,9 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t s
 	}
 }
 
+/* duplicates the eight low bytes of each 16-bit lane into both bytes */
+#define dup_lanes(val) _mm_or_si128(val, _mm_slli_epi16(val, 8))
+
 void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
 		    uint8_t *output, uint32_t out_linesize)
 {
@@ -181,19 +184,55 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	__m128i zero = _mm_setzero_si128();
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		/* 16 pixels per line at a time: V, U, Y, 0 */
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)chroma0), zero);
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)chroma1), zero);
+			u = dup_lanes(u);
+			v = dup_lanes(v);
+
+			__m128i vu_lo = _mm_unpacklo_epi8(v, u);
+			__m128i vu_hi = _mm_unpackhi_epi8(v, u);
+
+			__m128i line = _mm_loadu_si128((const __m128i *)lum0);
+			__m128i y_lo = _mm_unpacklo_epi8(line, zero);
+			__m128i y_hi = _mm_unpackhi_epi8(line, zero);
+			_mm_storeu_si128((__m128i *)output0, _mm_unpacklo_epi16(vu_lo, y_lo));
+			_mm_storeu_si128((__m128i *)(output0 + 4), _mm_unpackhi_epi16(vu_lo, y_lo));
+			_mm_storeu_si128((__m128i *)(output0 + 8), _mm_unpacklo_epi16(vu_hi, y_hi));
+			_mm_storeu_si128((__m128i *)(output0 + 12), _mm_unpackhi_epi16(vu_hi, y_hi));
+
+			line = _mm_loadu_si128((const __m128i *)lum1);
+			y_lo = _mm_unpacklo_epi8(line, zero);
+			y_hi = _mm_unpackhi_epi8(line, zero);
+			_mm_storeu_si128((__m128i *)output1, _mm_unpacklo_epi16(vu_lo, y_lo));
+			_mm_storeu_si128((__m128i *)(output1 + 4), _mm_unpackhi_epi16(vu_lo, y_lo));
+			_mm_storeu_si128((__m128i *)(output1 + 8), _mm_unpacklo_epi16(vu_hi, y_hi));
+			_mm_storeu_si128((__m128i *)(output1 + 12), _mm_unpackhi_epi16(vu_hi, y_hi));
+
+			chroma0 += 8;
+			chroma1 += 8;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out;
 			out = (*(chroma0++) << 8) | *(chroma1++);
 
@@ -214,11 +253,14 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo_mask = _mm_set1_epi16(0x00FF);
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint16_t *chroma;
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
 		lum0 = input[0] + y * 2 * in_linesize[0];
@@ -226,7 +268,39 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		/* 16 pixels per line at a time: Y, U, V, 0 */
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i uv = _mm_loadu_si128((const __m128i *)chroma);
+			__m128i u = dup_lanes(_mm_and_si128(uv, lo_mask));
+			__m128i v = dup_lanes(_mm_srli_epi16(uv, 8));
+
+			__m128i v_lo = _mm_unpacklo_epi8(v, zero);
+			__m128i v_hi = _mm_unpackhi_epi8(v, zero);
+
+			__m128i line = _mm_loadu_si128((const __m128i *)lum0);
+			__m128i yu_lo = _mm_unpacklo_epi8(line, u);
+			__m128i yu_hi = _mm_unpackhi_epi8(line, u);
+			_mm_storeu_si128((__m128i *)output0, _mm_unpacklo_epi16(yu_lo, v_lo));
+			_mm_storeu_si128((__m128i *)(output0 + 4), _mm_unpackhi_epi16(yu_lo, v_lo));
+			_mm_storeu_si128((__m128i *)(output0 + 8), _mm_unpacklo_epi16(yu_hi, v_hi));
+			_mm_storeu_si128((__m128i *)(output0 + 12), _mm_unpackhi_epi16(yu_hi, v_hi));
+
+			line = _mm_loadu_si128((const __m128i *)lum1);
+			yu_lo = _mm_unpacklo_epi8(line, u);
+			yu_hi = _mm_unpackhi_epi8(line, u);
+			_mm_storeu_si128((__m128i *)output1, _mm_unpacklo_epi16(yu_lo, v_lo));
+			_mm_storeu_si128((__m128i *)(output1 + 4), _mm_unpackhi_epi16(yu_lo, v_lo));
+			_mm_storeu_si128((__m128i *)(output1 + 8), _mm_unpacklo_epi16(yu_hi, v_hi));
+			_mm_storeu_si128((__m128i *)(output1 + 12), _mm_unpackhi_epi16(yu_hi, v_hi));
+
+			chroma += 8;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out = *(chroma++) << 8;
 
 			*(output0++) = *(lum0++) | out;
@@ -248,41 +322,37 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize, uint32_t start_y
 	register const uint32_t *input32_end;
 	register uint32_t *output32;
 
-	if (leading_lum) {
-		for (y = start_y; y < end_y; y++) {
-			input32 = (const uint32_t *)(input + y * in_linesize);
-			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
+	/* the second pixel of each pair takes the first pixel's second luma */
+	uint32_t keep_mask = leading_lum ? 0xFFFFFF00 : 0xFFFF00FF;
+	uint32_t lum_mask = leading_lum ? 0x000000FF : 0x0000FF00;
+	__m128i keep_mask128 = _mm_set1_epi32((int)keep_mask);
+	__m128i lum_mask128 = _mm_set1_epi32((int)lum_mask);
+
+	for (y = start_y; y < end_y; y++) {
+		input32 = (const uint32_t *)(input + y * in_linesize);
+		input32_end = input32 + width_d2;
+		output32 = (uint32_t *)(output + y * out_linesize);
 
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
+		while (input32 + 4 <= input32_end) {
+			__m128i dw = _mm_loadu_si128((const __m128i *)input32);
+			__m128i second = _mm_or_si128(_mm_and_si128(dw, keep_mask128),
+						      _mm_and_si128(_mm_srli_epi32(dw, 16), lum_mask128));
 
-				output32[0] = dw;
-				dw &= 0xFFFFFF00;
-				dw |= (uint8_t)(dw >> 16);
-				output32[1] = dw;
+			_mm_storeu_si128((__m128i *)output32, _mm_unpacklo_epi32(dw, second));
+			_mm_storeu_si128((__m128i *)(output32 + 4), _mm_unpackhi_epi32(dw, second));
 
-				output32 += 2;
-				input32++;
-			}
+			output32 += 8;
+			input32 += 4;
 		}
-	} else {
-		for (y = start_y; y < end_y; y++) {
-			input32 = (const uint32_t *)(input + y * in_linesize);
-			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
-
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
-
-				output32[0] = dw;
-				dw &= 0xFFFF00FF;
-				dw |= (dw >> 16) & 0xFF00;
-				output32[1] = dw;
-
-				output32 += 2;
-				input32++;
-			}
+
+		while (input32 < input32_end) {
+			register uint32_t dw = *input32;
+
+			output32[0] = dw;
+			output32[1] = (dw & keep_mask) | ((dw >> 16) & lum_mask);
+
+			output32 += 2;
+			input32++;
 		}
 	}
 }
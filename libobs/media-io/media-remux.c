@@ -19,16 +19,62 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/deque.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/util_uint64.h"
+#include "../util/buffered-file-serializer.h"
 
 #include <libavformat/avformat.h>
 #include <libavcodec/version.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#define AVIO_BUFFER_SIZE 65536
+
+/* packet data the read thread may queue ahead of the muxer */
+#define MAX_READ_AHEAD_BYTES (64 * 1048576)
+
+/* Upper bound of the sample tables per sample, with every sample being its
+ * own chunk: stsz, stts, ctts, stss, stsc and co64 entries */
+#define MOOV_BYTES_PER_SAMPLE 64
+#define MOOV_BASE_SIZE (1024 * 1024)
+
+struct read_packet {
+	AVPacket *pkt;
+	int64_t read_pos;
+};
+
 struct media_remux_job {
+	char *in_filename, *out_filename;
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	/* output is written through a buffered file serializer, which does the
+	 * actual file I/O on its own thread */
+	struct serializer out_serializer;
+	bool use_serializer;
+
+	/* packets are demuxed on a separate thread so reading the input and
+	 * writing the output overlap */
+	pthread_t read_thread;
+	bool read_thread_active;
+	pthread_mutex_t read_mutex;
+	os_event_t *packet_available;
+	os_event_t *space_available;
+	struct deque packets;
+	size_t queued_bytes;
+	bool read_done;
+	bool stop_reading;
+	int read_result;
+
+	int64_t bytes_processed;
+	uint64_t start_time;
+
+	bool faststart;
 };
 
 static inline void init_size(media_remux_job_t job, const char *in_filename)
@@ -64,6 +110,33 @@ static inline bool init_input(media_remux_job_t job, const char *in_filename)
 	return true;
 }
 
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int write_output(void *opaque, const uint8_t *buf, int buf_size)
+#else
+static int write_output(void *opaque, uint8_t *buf, int buf_size)
+#endif
+{
+	media_remux_job_t job = opaque;
+	size_t written = s_write(&job->out_serializer, buf, buf_size);
+
+	return written == (size_t)buf_size ? buf_size : AVERROR(EIO);
+}
+
+static int64_t seek_output(void *opaque, int64_t offset, int whence)
+{
+	media_remux_job_t job = opaque;
+
+	switch (whence) {
+	case SEEK_SET:
+		return serializer_seek(&job->out_serializer, offset, SERIALIZE_SEEK_START);
+	case SEEK_CUR:
+		return serializer_seek(&job->out_serializer, offset, SERIALIZE_SEEK_CURRENT);
+	}
+
+	/* AVSEEK_SIZE and SEEK_END are not supported for buffered output */
+	return -1;
+}
+
 static inline bool init_output(media_remux_job_t job, const char *out_filename)
 {
 	int ret;
@@ -120,6 +193,20 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 #endif
 
 	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+		if (buffered_file_serializer_init_defaults(&job->out_serializer, out_filename)) {
+			uint8_t *buf = av_malloc(AVIO_BUFFER_SIZE);
+
+			job->use_serializer = true;
+			job->ofmt_ctx->pb = avio_alloc_context(buf, AVIO_BUFFER_SIZE, 1, job, NULL, write_output,
+							       seek_output);
+			if (!job->ofmt_ctx->pb) {
+				av_free(buf);
+				blog(LOG_ERROR, "media_remux: Failed to create output I/O context");
+				return false;
+			}
+			return true;
+		}
+
 		ret = avio_open(&job->ofmt_ctx->pb, out_filename, AVIO_FLAG_WRITE);
 		if (ret < 0) {
 			blog(LOG_ERROR,
@@ -133,6 +220,26 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 	return true;
 }
 
+static void free_output(media_remux_job_t job)
+{
+	if (job->use_serializer) {
+		if (job->ofmt_ctx->pb) {
+			avio_flush(job->ofmt_ctx->pb);
+			av_freep(&job->ofmt_ctx->pb->buffer);
+			avio_context_free(&job->ofmt_ctx->pb);
+		}
+
+		/* waits for the I/O thread to finish writing */
+		buffered_file_serializer_free(&job->out_serializer);
+		job->use_serializer = false;
+	} else if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+		avio_close(job->ofmt_ctx->pb);
+	}
+
+	avformat_free_context(job->ofmt_ctx);
+	job->ofmt_ctx = NULL;
+}
+
 bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, const char *out_filename)
 {
 	if (!job)
@@ -149,6 +256,15 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, con
 	if (!*job)
 		return false;
 
+	if (pthread_mutex_init(&(*job)->read_mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_event_init(&(*job)->packet_available, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (os_event_init(&(*job)->space_available, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	(*job)->in_filename = bstrdup(in_filename);
+	(*job)->out_filename = bstrdup(out_filename);
 	init_size(*job, in_filename);
 
 	if (!init_input(*job, in_filename))
@@ -159,8 +275,14 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, con
 
 	return true;
 
+fail_mutex:
+	bfree(*job);
+	*job = NULL;
+	return false;
+
 fail:
 	media_remux_job_destroy(*job);
+	*job = NULL;
 	return false;
 }
 
@@ -174,34 +296,143 @@ static inline void process_packet(AVPacket *pkt, AVStream *in_stream, AVStream *
 	pkt->pos = -1;
 }
 
-static inline int process_packets(media_remux_job_t job, media_remux_progress_callback callback, void *data)
+static void *read_thread(void *data)
 {
-	AVPacket pkt;
+	media_remux_job_t job = data;
+	int ret;
+
+	os_set_thread_name("media_remux: read thread");
 
-	int ret, throttle = 0;
 	for (;;) {
-		ret = av_read_frame(job->ifmt_ctx, &pkt);
+		struct read_packet rp = {.pkt = av_packet_alloc()};
+		if (!rp.pkt) {
+			ret = AVERROR(ENOMEM);
+			break;
+		}
+
+		ret = av_read_frame(job->ifmt_ctx, rp.pkt);
 		if (ret < 0) {
-			if (ret != AVERROR_EOF)
-				blog(LOG_ERROR,
-				     "media_remux: Error reading"
-				     " packet: %s",
-				     av_err2str(ret));
+			av_packet_free(&rp.pkt);
+			break;
+		}
+
+		rp.read_pos = avio_tell(job->ifmt_ctx->pb);
+
+		pthread_mutex_lock(&job->read_mutex);
+		while (job->queued_bytes >= MAX_READ_AHEAD_BYTES && !job->stop_reading) {
+			pthread_mutex_unlock(&job->read_mutex);
+			os_event_wait(job->space_available);
+			pthread_mutex_lock(&job->read_mutex);
+		}
+
+		if (job->stop_reading) {
+			pthread_mutex_unlock(&job->read_mutex);
+			av_packet_free(&rp.pkt);
+			ret = AVERROR_EXIT;
 			break;
 		}
 
+		deque_push_back(&job->packets, &rp, sizeof(rp));
+		job->queued_bytes += rp.pkt->size;
+		pthread_mutex_unlock(&job->read_mutex);
+
+		os_event_signal(job->packet_available);
+	}
+
+	pthread_mutex_lock(&job->read_mutex);
+	job->read_result = ret;
+	job->read_done = true;
+	pthread_mutex_unlock(&job->read_mutex);
+
+	os_event_signal(job->packet_available);
+	return NULL;
+}
+
+/* returns false once the read thread is done and the queue is empty */
+static bool next_packet(media_remux_job_t job, struct read_packet *rp, int *read_result)
+{
+	bool have_packet = false;
+
+	for (;;) {
+		pthread_mutex_lock(&job->read_mutex);
+
+		if (job->packets.size) {
+			deque_pop_front(&job->packets, rp, sizeof(*rp));
+			job->queued_bytes -= rp->pkt->size;
+			have_packet = true;
+		}
+
+		const bool done = job->read_done;
+		*read_result = job->read_result;
+		pthread_mutex_unlock(&job->read_mutex);
+
+		if (have_packet) {
+			os_event_signal(job->space_available);
+			return true;
+		}
+		if (done)
+			return false;
+
+		os_event_wait(job->packet_available);
+	}
+}
+
+static void stop_read_thread(media_remux_job_t job)
+{
+	struct read_packet rp;
+
+	if (!job->read_thread_active)
+		return;
+
+	pthread_mutex_lock(&job->read_mutex);
+	job->stop_reading = true;
+	pthread_mutex_unlock(&job->read_mutex);
+
+	os_event_signal(job->space_available);
+	pthread_join(job->read_thread, NULL);
+	job->read_thread_active = false;
+
+	while (job->packets.size) {
+		deque_pop_front(&job->packets, &rp, sizeof(rp));
+		av_packet_free(&rp.pkt);
+	}
+	job->queued_bytes = 0;
+}
+
+static inline int process_packets(media_remux_job_t job, media_remux_progress_callback callback, void *data)
+{
+	struct read_packet rp;
+	int read_result = 0;
+
+	int ret = 0, throttle = 0;
+
+	if (pthread_create(&job->read_thread, NULL, read_thread, job) != 0) {
+		blog(LOG_ERROR, "media_remux: Failed to create read thread");
+		return AVERROR(ENOMEM);
+	}
+	job->read_thread_active = true;
+
+	while (next_packet(job, &rp, &read_result)) {
+		AVPacket *pkt = rp.pkt;
+
+		if (rp.read_pos > job->bytes_processed)
+			job->bytes_processed = rp.read_pos;
+
 		if (callback != NULL && throttle++ > 10) {
-			float progress = pkt.pos / (float)job->in_size * 100.f;
-			if (!callback(data, progress))
+			float progress = job->bytes_processed / (float)job->in_size * 100.f;
+			if (!callback(data, progress)) {
+				av_packet_free(&pkt);
+				ret = AVERROR_EXIT;
 				break;
+			}
 			throttle = 0;
 		}
 
-		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
-			       job->ofmt_ctx->streams[pkt.stream_index]);
+		process_packet(pkt, job->ifmt_ctx->streams[pkt->stream_index],
+			       job->ofmt_ctx->streams[pkt->stream_index]);
 
-		ret = av_interleaved_write_frame(job->ofmt_ctx, &pkt);
-		av_packet_unref(&pkt);
+		ret = av_interleaved_write_frame(job->ofmt_ctx, pkt);
+		av_packet_free(&pkt);
 
 		if (ret < 0) {
 			blog(LOG_ERROR, "media_remux: Error muxing packet: %s", av_err2str(ret));
@@ -215,52 +446,205 @@ static inline int process_packets(media_remux_job_t job, media_remux_progress_ca
 		}
 	}
 
-	return ret;
+	stop_read_thread(job);
+
+	/* stopped by the callback or a muxing error */
+	if (ret < 0 && ret != AVERROR_INVALIDDATA && ret != -EINVAL)
+		return ret;
+
+	if (read_result < 0 && read_result != AVERROR_EOF)
+		blog(LOG_ERROR,
+		     "media_remux: Error reading"
+		     " packet: %s",
+		     av_err2str(read_result));
+	return read_result;
 }
 
-bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callback callback, void *data)
+void media_remux_job_set_faststart(media_remux_job_t job, bool faststart)
 {
+	if (job)
+		job->faststart = faststart;
+}
+
+static inline bool is_mov_output(media_remux_job_t job)
+{
+	const char *name = job->ofmt_ctx->oformat->name;
+	return strcmp(name, "mp4") == 0 || strcmp(name, "mov") == 0;
+}
+
+/* The number of samples is only known once everything has been read, so it
+ * is estimated from the duration and rates of the input streams, with a
+ * fair margin: running out of the reserved space fails the trailer, and the
+ * remux is then done again without it. Returns 0 if any of them is
+ * unknown. */
+static int64_t estimate_moov_size(media_remux_job_t job)
+{
+	AVFormatContext *ifmt_ctx = job->ifmt_ctx;
+	double samples = 0.0;
+
+	if (ifmt_ctx->duration <= 0)
+		return 0;
+
+	double seconds = (double)ifmt_ctx->duration / AV_TIME_BASE;
+
+	for (unsigned i = 0; i < ifmt_ctx->nb_streams; i++) {
+		AVStream *stream = ifmt_ctx->streams[i];
+		AVCodecParameters *par = stream->codecpar;
+
+		if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+			double rate = fmax(av_q2d(stream->avg_frame_rate), av_q2d(stream->r_frame_rate));
+			if (rate <= 0.0)
+				return 0;
+
+			samples += seconds * rate;
+
+		} else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+			if (par->frame_size <= 0 || par->sample_rate <= 0)
+				return 0;
+
+			samples += seconds * par->sample_rate / par->frame_size;
+
+		} else {
+			return 0;
+		}
+	}
+
+	return (int64_t)(samples * 1.25 * MOOV_BYTES_PER_SAMPLE) + MOOV_BASE_SIZE;
+}
+
+/* Reserves room for the moov ahead of the samples so that it ends up at the
+ * start of the file without the whole file being read and shifted again.
+ * Returns whether space was reserved. */
+static bool set_faststart_options(media_remux_job_t job, AVDictionary **opts)
+{
+	if (!job->faststart || !job->use_serializer || !is_mov_output(job))
+		return false;
+
+	int64_t size = estimate_moov_size(job);
+	if (!size || size > INT_MAX) {
+		blog(LOG_INFO, "media_remux: Could not estimate the index size, "
+			       "not reserving space for it");
+		return false;
+	}
+
+	blog(LOG_INFO, "media_remux: Reserving %" PRId64 " KiB for the index", size / 1024);
+	av_dict_set_int(opts, "moov_size", size, 0);
+	return true;
+}
+
+/* Starts over with the input and output opened again, for another pass */
+static bool reset_job(media_remux_job_t job)
+{
+	avformat_close_input(&job->ifmt_ctx);
+	free_output(job);
+
+	job->read_done = false;
+	job->stop_reading = false;
+	job->read_result = 0;
+	job->bytes_processed = 0;
+
+	return init_input(job, job->in_filename) && init_output(job, job->out_filename);
+}
+
+/* Writes the whole output once.  *trailer_failed is set when only writing
+ * the trailer failed.  With space reserved, that means the index didn't fit
+ * and has overwritten the first samples */
+static bool remux_pass(media_remux_job_t job, media_remux_progress_callback callback, void *data, bool reserve,
+		       bool *reserved, bool *trailer_failed)
+{
+	AVDictionary *opts = NULL;
 	int ret;
-	bool success = false;
+	bool success;
 
-	if (!job)
-		return success;
+	*reserved = reserve && set_faststart_options(job, &opts);
+	*trailer_failed = false;
 
-	ret = avformat_write_header(job->ofmt_ctx, NULL);
+	ret = avformat_write_header(job->ofmt_ctx, &opts);
+	av_dict_free(&opts);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Error opening output file: %s", av_err2str(ret));
-		return success;
+		return false;
 	}
 
 	if (callback != NULL)
 		callback(data, 0.f);
 
+	job->start_time = os_gettime_ns();
+
 	ret = process_packets(job, callback, data);
 	success = ret >= 0 || ret == AVERROR_EOF;
 
 	ret = av_write_trailer(job->ofmt_ctx);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: av_write_trailer: %s", av_err2str(ret));
+		*trailer_failed = success;
 		success = false;
 	}
 
+	return success;
+}
+
+bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callback callback, void *data)
+{
+	bool reserved, trailer_failed;
+	bool success = false;
+
+	if (!job)
+		return success;
+
+	success = remux_pass(job, callback, data, true, &reserved, &trailer_failed);
+
+	/* the output has no usable index, so it's written again with the index
+	 * at the end, the way it is without faststart */
+	if (!success && reserved && trailer_failed) {
+		blog(LOG_WARNING, "media_remux: The index did not fit in the reserved "
+				  "space, remuxing again without reserving it");
+
+		if (reset_job(job))
+			success = remux_pass(job, callback, data, false, &reserved, &trailer_failed);
+	}
+
+	if (success) {
+		uint64_t elapsed = os_gettime_ns() - job->start_time;
+		blog(LOG_INFO, "media_remux: Remuxed %.1f MB in %.2f seconds (%.1f MB/s)",
+		     (double)job->bytes_processed / 1000000.0, (double)elapsed / 1000000000.0,
+		     (double)media_remux_job_get_bytes_per_sec(job) / 1000000.0);
+	}
+
 	if (callback != NULL)
 		callback(data, 100.f);
 
 	return success;
 }
 
+uint64_t media_remux_job_get_bytes_per_sec(media_remux_job_t job)
+{
+	if (!job || !job->start_time)
+		return 0;
+
+	uint64_t elapsed = os_gettime_ns() - job->start_time;
+	if (!elapsed)
+		return 0;
+
+	return util_mul_div64((uint64_t)job->bytes_processed, 1000000000ULL, elapsed);
+}
+
 void media_remux_job_destroy(media_remux_job_t job)
 {
 	if (!job)
 		return;
 
-	avformat_close_input(&job->ifmt_ctx);
+	stop_read_thread(job);
 
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
-		avio_close(job->ofmt_ctx->pb);
+	avformat_close_input(&job->ifmt_ctx);
+	free_output(job);
 
-	avformat_free_context(job->ofmt_ctx);
+	os_event_destroy(job->packet_available);
+	os_event_destroy(job->space_available);
+	pthread_mutex_destroy(&job->read_mutex);
+	deque_free(&job->packets);
 
+	bfree(job->in_filename);
+	bfree(job->out_filename);
 	bfree(job);
 }
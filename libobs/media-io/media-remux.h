@@ -29,7 +29,16 @@ extern "C" {
 #endif
 
 EXPORT bool media_remux_job_create(media_remux_job_t *job, const char *in_filename, const char *out_filename);
+/* Puts the index of MP4/MOV output at the start of the file by reserving
+ * space for it ahead of the samples, given the size of the index can be
+ * estimated from the input.  Needs to be set before processing. */
+EXPORT void media_remux_job_set_faststart(media_remux_job_t job, bool faststart);
 EXPORT bool media_remux_job_process(media_remux_job_t job, media_remux_progress_callback callback, void *data);
+
+/* Input bytes remuxed per second so far, can be called from the progress
+ * callback.  Jobs are independent, so several may be processed at once on
+ * separate threads. */
+EXPORT uint64_t media_remux_job_get_bytes_per_sec(media_remux_job_t job);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
 #ifdef __cplusplus
@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/deque.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -30,21 +31,41 @@
 #include "video-scaler.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
+extern void obs_apply_core_thread_affinity(void);
 
 #define MAX_CONVERT_BUFFERS 3
-#define MAX_CACHE_SIZE 16
+#define MAX_CACHE_SIZE 64
+#define MAX_DISPATCH_THREADS 8
 
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+
+	/* raised by the producer when the cache is full, so atomic */
+	volatile long skipped;
+	volatile long count;
+
+	/* frame data referenced by video_output_push_frame_ref */
+	struct video_data frame_ref;
+	void (*release)(void *param);
+	void *release_param;
 };
 
-struct video_input {
+/* scaler shared by every input that requests the same conversion, so that
+ * each frame is only converted once no matter how many inputs consume it */
+struct video_input_scaler {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
+	long refs;
+
+	uint64_t last_serial;
+	bool last_success;
+};
+
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_input_scaler *scaler;
 
 	// allow outputting at fractions of main composition FPS,
 	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
@@ -58,20 +79,206 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	/* set when the input was connected with its own delivery thread */
+	struct video_input_worker *worker;
+
+	/* called on the dispatch threads alongside the other parallel inputs,
+	 * dispatch marks it as due for the current frame */
+	bool parallel;
+	bool dispatch;
+};
+
+/* one call of a parallel input for the current frame.  the scaler is only
+ * set when the input is its sole user, in which case it is run on the
+ * dispatch thread as well */
+struct video_dispatch_job {
+	void (*callback)(void *param, struct video_data *frame);
+	void *param;
+	struct video_input_scaler *scaler;
+	struct video_data frame;
 };
 
-static inline void video_input_free(struct video_input *input)
+struct video_input_ref {
+	void (*callback)(void *param, struct video_data *frame);
+	void *param;
+};
+
+/* Delivers frames of one input on a thread of its own, so that a slow
+ * consumer only drops its own frames instead of stalling the video thread
+ * for every other input.  Frames are copied into a fixed pool of buffers;
+ * when none is free the frame is dropped for this input only. */
+struct video_input_worker {
+	pthread_t thread;
+	os_sem_t *ready;
+	pthread_mutex_t mutex;
+	volatile bool stop;
+
+	enum video_format format;
+	uint32_t height;
+	struct video_frame *frames;
+	size_t num_frames;
+
+	/* indices into frames */
+	struct deque queued;
+	struct deque free;
+
+	volatile long skipped_frames;
+	volatile long total_frames;
+
+	void (*callback)(void *param, struct video_data *frame);
+	void *param;
+};
+
+static void *video_input_worker_thread(void *param)
+{
+	struct video_input_worker *worker = param;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(worker->ready) == 0) {
+		struct video_data data = {0};
+		uint64_t timestamp;
+		size_t idx;
+
+		if (os_atomic_load_bool(&worker->stop))
+			break;
+
+		pthread_mutex_lock(&worker->mutex);
+		deque_pop_front(&worker->queued, &idx, sizeof(idx));
+		deque_pop_front(&worker->queued, &timestamp, sizeof(timestamp));
+		pthread_mutex_unlock(&worker->mutex);
+
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			data.data[i] = worker->frames[idx].data[i];
+			data.linesize[i] = worker->frames[idx].linesize[i];
+		}
+		data.timestamp = timestamp;
+
+		worker->callback(worker->param, &data);
+
+		pthread_mutex_lock(&worker->mutex);
+		deque_push_back(&worker->free, &idx, sizeof(idx));
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	return NULL;
+}
+
+static void video_input_worker_destroy(struct video_input_worker *worker)
+{
+	if (!worker)
+		return;
+
+	os_atomic_set_bool(&worker->stop, true);
+	os_sem_post(worker->ready);
+	pthread_join(worker->thread, NULL);
+
+	for (size_t i = 0; i < worker->num_frames; i++)
+		video_frame_free(&worker->frames[i]);
+	bfree(worker->frames);
+
+	deque_free(&worker->queued);
+	deque_free(&worker->free);
+	os_sem_destroy(worker->ready);
+	pthread_mutex_destroy(&worker->mutex);
+	bfree(worker);
+}
+
+static struct video_input_worker *video_input_worker_create(const struct video_input *input, size_t queue_size)
+{
+	struct video_input_worker *worker = bzalloc(sizeof(*worker));
+
+	worker->format = input->conversion.format;
+	worker->height = input->conversion.height;
+	worker->callback = input->callback;
+	worker->param = input->param;
+	worker->num_frames = queue_size;
+	worker->frames = bzalloc(sizeof(struct video_frame) * queue_size);
+
+	for (size_t i = 0; i < queue_size; i++) {
+		video_frame_init(&worker->frames[i], worker->format, input->conversion.width, worker->height);
+		deque_push_back(&worker->free, &i, sizeof(i));
+	}
+
+	if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+		goto fail0;
+	if (os_sem_init(&worker->ready, 0) != 0)
+		goto fail1;
+	if (pthread_create(&worker->thread, NULL, video_input_worker_thread, worker) != 0)
+		goto fail2;
+
+	return worker;
+
+fail2:
+	os_sem_destroy(worker->ready);
+fail1:
+	pthread_mutex_destroy(&worker->mutex);
+fail0:
+	for (size_t i = 0; i < queue_size; i++)
+		video_frame_free(&worker->frames[i]);
+	bfree(worker->frames);
+	deque_free(&worker->free);
+	bfree(worker);
+	return NULL;
+}
+
+/* called on the video thread; the frame is only valid during the call */
+static void video_input_worker_push(struct video_input_worker *worker, const struct video_data *data)
+{
+	struct video_frame src;
+	size_t idx = 0;
+	bool have_frame = false;
+
+	os_atomic_inc_long(&worker->total_frames);
+
+	pthread_mutex_lock(&worker->mutex);
+	if (worker->free.size) {
+		deque_pop_front(&worker->free, &idx, sizeof(idx));
+		have_frame = true;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (!have_frame) {
+		os_atomic_inc_long(&worker->skipped_frames);
+		return;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		src.data[i] = data->data[i];
+		src.linesize[i] = data->linesize[i];
+	}
+	video_frame_copy(&worker->frames[idx], &src, worker->format, worker->height);
+
+	pthread_mutex_lock(&worker->mutex);
+	deque_push_back(&worker->queued, &idx, sizeof(idx));
+	deque_push_back(&worker->queued, &data->timestamp, sizeof(data->timestamp));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(worker->ready);
+}
+
+static void video_input_scaler_release(struct video_input_scaler *scaler)
 {
+	if (!scaler || --scaler->refs > 0)
+		return;
+
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
+		video_frame_free(&scaler->frame[i]);
+	video_scaler_destroy(scaler->scaler);
+	bfree(scaler);
+}
+
+static inline void video_input_free(struct video_input *input)
+{
+	video_input_worker_destroy(input->worker);
+	video_input_scaler_release(input->scaler);
 }
 
 struct video_output {
 	struct video_output_info info;
 
 	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
 
 	os_sem_t *update_semaphore;
@@ -81,69 +288,218 @@ struct video_output {
 
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
+	uint64_t input_serial;
 
-	size_t available_frames;
+	/* Single producer, single consumer ring.  next_write is only touched
+	 * by the thread locking frames, first_added only by the video thread,
+	 * and available_frames hands slots back and forth between them. */
+	volatile long available_frames;
 	size_t first_added;
-	size_t last_added;
+	size_t next_write;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
 	struct video_output *parent;
 
 	volatile bool raw_active;
 	volatile long gpu_refs;
+
+	/* Parallel inputs are run on the dispatch threads each frame, with the
+	 * video thread taking jobs as well and waiting for all of them before
+	 * moving on.  The input mutex stays locked in the meantime, so inputs
+	 * disconnected from a parallel callback are removed after the join. */
+	DARRAY(pthread_t) dispatch_threads;
+	DARRAY(struct video_dispatch_job) dispatch_jobs;
+	os_sem_t *dispatch_semaphore;
+	os_event_t *dispatch_done;
+	volatile bool dispatch_stop;
+	volatile long dispatch_next;
+	volatile long dispatch_busy;
+
+	pthread_mutex_t deferred_mutex;
+	DARRAY(struct video_input_ref) deferred_disconnects;
 };
 
+/* video output whose parallel inputs the current thread is running */
+static THREAD_LOCAL struct video_output *dispatching_video = NULL;
+
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input, struct video_data *data)
+static inline bool scale_video_output(struct video_output *video, struct video_input_scaler *scaler,
+				      struct video_data *data)
 {
 	bool success = true;
 
-	if (input->scaler) {
+	if (scaler) {
 		struct video_frame *frame;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+		/* another input with the same conversion may have already
+		 * scaled this frame */
+		if (scaler->last_serial != video->input_serial) {
+			if (++scaler->cur_frame == MAX_CONVERT_BUFFERS)
+				scaler->cur_frame = 0;
+
+			frame = &scaler->frame[scaler->cur_frame];
 
-		frame = &input->frame[input->cur_frame];
+			scaler->last_success = video_scaler_scale(scaler->scaler, frame->data, frame->linesize,
+								  (const uint8_t *const *)data->data, data->linesize);
+			scaler->last_serial = video->input_serial;
 
-		success = video_scaler_scale(input->scaler, frame->data, frame->linesize,
-					     (const uint8_t *const *)data->data, data->linesize);
+			if (!scaler->last_success)
+				blog(LOG_WARNING, "video-io: Could not scale frame!");
+		}
+
+		frame = &scaler->frame[scaler->cur_frame];
+		success = scaler->last_success;
 
 		if (success) {
 			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
 				data->data[i] = frame->data[i];
 				data->linesize[i] = frame->linesize[i];
 			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
 		}
 	}
 
 	return success;
 }
 
+static void run_dispatch_jobs(struct video_output *video)
+{
+	const long num = (long)video->dispatch_jobs.num;
+
+	dispatching_video = video;
+
+	for (;;) {
+		const long idx = os_atomic_inc_long(&video->dispatch_next) - 1;
+		if (idx >= num)
+			break;
+
+		struct video_dispatch_job *job = &video->dispatch_jobs.array[idx];
+		if (job->scaler && !scale_video_output(video, job->scaler, &job->frame))
+			continue;
+
+		job->callback(job->param, &job->frame);
+	}
+
+	dispatching_video = NULL;
+}
+
+static void *video_dispatch_thread(void *param)
+{
+	struct video_output *video = param;
+
+	os_set_thread_name("video-io: dispatch thread");
+
+	while (os_sem_wait(video->dispatch_semaphore) == 0) {
+		if (os_atomic_load_bool(&video->dispatch_stop))
+			break;
+
+		run_dispatch_jobs(video);
+
+		if (os_atomic_dec_long(&video->dispatch_busy) == 0)
+			os_event_signal(video->dispatch_done);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static bool add_dispatch_threads(struct video_output *video, size_t num_parallel)
+{
+	long num_threads = (long)num_parallel - 1;
+	long max_threads = os_get_logical_cores() - 1;
+
+	if (max_threads > MAX_DISPATCH_THREADS)
+		max_threads = MAX_DISPATCH_THREADS;
+	if (num_threads > max_threads)
+		num_threads = max_threads;
+
+	if (!video->dispatch_semaphore && os_sem_init(&video->dispatch_semaphore, 0) != 0)
+		return false;
+	if (!video->dispatch_done && os_event_init(&video->dispatch_done, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
+	while ((long)video->dispatch_threads.num < num_threads) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, video_dispatch_thread, video) != 0)
+			return false;
+		da_push_back(video->dispatch_threads, &thread);
+	}
+
+	return true;
+}
+
+static void free_dispatch_threads(struct video_output *video)
+{
+	os_atomic_set_bool(&video->dispatch_stop, true);
+	for (size_t i = 0; i < video->dispatch_threads.num; i++)
+		os_sem_post(video->dispatch_semaphore);
+	for (size_t i = 0; i < video->dispatch_threads.num; i++)
+		pthread_join(video->dispatch_threads.array[i], NULL);
+	da_free(video->dispatch_threads);
+	da_free(video->dispatch_jobs);
+	da_free(video->deferred_disconnects);
+
+	if (video->dispatch_semaphore)
+		os_sem_destroy(video->dispatch_semaphore);
+	if (video->dispatch_done)
+		os_event_destroy(video->dispatch_done);
+}
+
+static void process_deferred_disconnects(struct video_output *video)
+{
+	DARRAY(struct video_input_ref) refs;
+	da_init(refs);
+
+	pthread_mutex_lock(&video->deferred_mutex);
+	da_move(refs, video->deferred_disconnects);
+	pthread_mutex_unlock(&video->deferred_mutex);
+
+	for (size_t i = 0; i < refs.num; i++)
+		video_output_disconnect2(video, refs.array[i].callback, refs.array[i].param);
+
+	da_free(refs);
+}
+
+/* called with the input mutex locked */
+static void dispatch_parallel_inputs(struct video_output *video)
+{
+	long workers = (long)video->dispatch_jobs.num - 1;
+	if (workers > (long)video->dispatch_threads.num)
+		workers = (long)video->dispatch_threads.num;
+
+	os_atomic_set_long(&video->dispatch_next, 0);
+	os_atomic_set_long(&video->dispatch_busy, workers);
+
+	for (long i = 0; i < workers; i++)
+		os_sem_post(video->dispatch_semaphore);
+
+	run_dispatch_jobs(video);
+
+	if (workers > 0)
+		os_event_wait(video->dispatch_done);
+
+	if (video->deferred_disconnects.num)
+		process_deferred_disconnects(video);
+}
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
 	bool complete;
-	bool skipped;
-
-	/* -------------------------------- */
-
-	pthread_mutex_lock(&video->data_mutex);
 
 	frame_info = &video->cache[video->first_added];
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	pthread_mutex_lock(&video->input_mutex);
 
+	video->input_serial++;
+
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
+		struct video_data frame = frame_info->release ? frame_info->frame_ref : frame_info->frame;
+		frame.timestamp = frame_info->frame.timestamp;
 
 		// an explicit counter is used instead of remainder calculation
 		// to allow multiple encoders started at the same time to start on
@@ -155,33 +511,74 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
+		if (input->parallel) {
+			input->dispatch = true;
+			continue;
+		}
+
+		if (!scale_video_output(video, input->scaler, &frame))
+			continue;
+
+		if (input->worker)
+			video_input_worker_push(input->worker, &frame);
+		else
 			input->callback(input->param, &frame);
 	}
 
+	/* queued after the serial inputs have all been called, so that none
+	 * of them can disconnect a parallel input while its job is queued */
+	da_clear(video->dispatch_jobs);
+
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array + i;
+		if (!input->dispatch)
+			continue;
+
+		input->dispatch = false;
+
+		struct video_dispatch_job job = {
+			.callback = input->callback,
+			.param = input->param,
+			.frame = frame_info->release ? frame_info->frame_ref : frame_info->frame,
+		};
+		job.frame.timestamp = frame_info->frame.timestamp;
+
+		/* a shared scaler is only run once per frame, do that here
+		 * before any of its inputs is dispatched */
+		if (input->scaler && input->scaler->refs == 1)
+			job.scaler = input->scaler;
+		else if (!scale_video_output(video, input->scaler, &job.frame))
+			continue;
+
+		da_push_back(video->dispatch_jobs, &job);
+	}
+
+	if (video->dispatch_jobs.num)
+		dispatch_parallel_inputs(video);
+
 	pthread_mutex_unlock(&video->input_mutex);
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-
 	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
+	complete = os_atomic_dec_long(&frame_info->count) == 0;
 
 	if (complete) {
+		if (frame_info->release) {
+			frame_info->release(frame_info->release_param);
+			frame_info->release = NULL;
+			frame_info->release_param = NULL;
+		}
+
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
+		os_atomic_inc_long(&video->available_frames);
+	} else if (os_atomic_load_long(&frame_info->skipped) > 0) {
+		os_atomic_dec_long(&frame_info->skipped);
 		os_atomic_inc_long(&video->skipped_frames);
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	return complete;
@@ -200,6 +597,8 @@ static void *video_thread(void *param)
 		if (video->stop)
 			break;
 
+		obs_apply_core_thread_affinity();
+
 		profile_start(video_thread_name);
 		while (!video->stop && !video_output_cur_frame(video)) {
 			os_atomic_inc_long(&video->total_frames);
@@ -233,7 +632,7 @@ static inline void init_cache(struct video_output *video)
 		video_frame_init(frame, video->info.format, video->info.width, video->info.height);
 	}
 
-	video->available_frames = video->info.cache_size;
+	video->available_frames = (long)video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -250,9 +649,9 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	memcpy(&out->info, info, sizeof(struct video_output_info));
 	out->frame_time = util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
+		goto fail0;
+	if (pthread_mutex_init(&out->deferred_mutex, NULL) != 0)
 		goto fail1;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail2;
@@ -267,9 +666,9 @@ int video_output_open(video_t **video, struct video_output_info *info)
 fail3:
 	os_sem_destroy(out->update_semaphore);
 fail2:
-	pthread_mutex_destroy(&out->input_mutex);
+	pthread_mutex_destroy(&out->deferred_mutex);
 fail1:
-	pthread_mutex_destroy(&out->data_mutex);
+	pthread_mutex_destroy(&out->input_mutex);
 fail0:
 	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
@@ -288,12 +687,17 @@ void video_output_close(video_t *video)
 		video_input_free(&video->inputs.array[i]);
 	da_free(video->inputs);
 
-	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame *)&video->cache[i]);
+	for (size_t i = 0; i < video->info.cache_size; i++) {
+		struct cached_frame_info *cfi = &video->cache[i];
+		if (cfi->release)
+			cfi->release(cfi->release_param);
+		video_frame_free((struct video_frame *)&cfi->frame);
+	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+	free_dispatch_threads(video);
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
+	pthread_mutex_destroy(&video->deferred_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
 
 	bfree(video);
@@ -337,6 +741,25 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 	return (a == VIDEO_CS_DEFAULT) || (b == VIDEO_CS_DEFAULT) || (collapse_space(a) == collapse_space(b));
 }
 
+/* the thread count of whichever input created a scaler is kept */
+static inline bool same_conversion(const struct video_scale_info *a, const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width && a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace && a->dither == b->dither;
+}
+
+static struct video_input_scaler *find_input_scaler(struct video_output *video,
+						    const struct video_scale_info *conversion)
+{
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input_scaler *scaler = video->inputs.array[i].scaler;
+		if (scaler && same_conversion(&scaler->conversion, conversion))
+			return scaler;
+	}
+
+	return NULL;
+}
+
 static inline bool video_input_init(struct video_input *input, struct video_output *video)
 {
 	if (input->conversion.width != video->info.width || input->conversion.height != video->info.height ||
@@ -349,7 +772,19 @@ static inline bool video_input_init(struct video_input *input, struct video_outp
 						.range = video->info.range,
 						.colorspace = video->info.colorspace};
 
-		int ret = video_scaler_create(&input->scaler, &input->conversion, &from, VIDEO_SCALE_FAST_BILINEAR);
+		struct video_input_scaler *scaler = find_input_scaler(video, &input->conversion);
+		if (scaler) {
+			scaler->refs++;
+			input->scaler = scaler;
+			return true;
+		}
+
+		scaler = bzalloc(sizeof(*scaler));
+		scaler->conversion = input->conversion;
+		scaler->last_serial = video->input_serial;
+		scaler->refs = 1;
+
+		int ret = video_scaler_create(&scaler->scaler, &input->conversion, &from, VIDEO_SCALE_FAST_BILINEAR);
 		if (ret != VIDEO_SCALER_SUCCESS) {
 			if (ret == VIDEO_SCALER_BAD_CONVERSION)
 				blog(LOG_ERROR, "video_input_init: Bad "
@@ -358,12 +793,15 @@ static inline bool video_input_init(struct video_input *input, struct video_outp
 				blog(LOG_ERROR, "video_input_init: Failed to "
 						"create scaler");
 
+			bfree(scaler);
 			return false;
 		}
 
 		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i], input->conversion.format, input->conversion.width,
+			video_frame_init(&scaler->frame[i], input->conversion.format, input->conversion.width,
 					 input->conversion.height);
+
+		input->scaler = scaler;
 	}
 
 	return true;
@@ -395,8 +833,19 @@ bool video_output_connect(video_t *video, const struct video_scale_info *convers
 	return video_output_connect2(video, conversion, 1, callback, param);
 }
 
-bool video_output_connect2(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
-			   void (*callback)(void *param, struct video_data *frame), void *param)
+static size_t count_parallel_inputs(const struct video_output *video)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		if (video->inputs.array[i].parallel)
+			count++;
+	}
+	return count;
+}
+
+static bool connect_input(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
+			  size_t queue_size, bool parallel, void (*callback)(void *param, struct video_data *frame),
+			  void *param)
 {
 	bool success = false;
 
@@ -415,6 +864,7 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 		input.param = param;
 
 		input.frame_rate_divisor = frame_rate_divisor;
+		input.parallel = parallel;
 
 		if (conversion) {
 			input.conversion = *conversion;
@@ -432,6 +882,21 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 			input.conversion.height = video->info.height;
 
 		success = video_input_init(&input, video);
+		if (success && queue_size) {
+			input.worker = video_input_worker_create(&input, queue_size);
+			if (!input.worker) {
+				blog(LOG_ERROR, "video_output_connect: Failed to "
+						"create input thread");
+				video_input_free(&input);
+				success = false;
+			}
+		}
+		if (success && parallel && !add_dispatch_threads(video, count_parallel_inputs(video) + 1)) {
+			/* any threads already running still take jobs, and
+			 * with none the video thread runs them all */
+			blog(LOG_WARNING, "video_output_connect: Failed to "
+					  "create dispatch thread");
+		}
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -448,6 +913,56 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 	return success;
 }
 
+bool video_output_connect2(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
+			   void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	return connect_input(video, conversion, frame_rate_divisor, 0, false, callback, param);
+}
+
+bool video_output_connect_threaded(video_t *video, const struct video_scale_info *conversion,
+				   uint32_t frame_rate_divisor, size_t queue_size,
+				   void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	if (!queue_size)
+		return false;
+
+	return connect_input(video, conversion, frame_rate_divisor, queue_size, false, callback, param);
+}
+
+bool video_output_connect_parallel(video_t *video, const struct video_scale_info *conversion,
+				   uint32_t frame_rate_divisor, void (*callback)(void *param, struct video_data *frame),
+				   void *param)
+{
+	return connect_input(video, conversion, frame_rate_divisor, 0, true, callback, param);
+}
+
+bool video_output_get_input_frames(video_t *video, void (*callback)(void *param, struct video_data *frame),
+				   void *param, uint32_t *total, uint32_t *skipped)
+{
+	bool found = false;
+
+	if (!video || !callback)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input_worker *worker = video->inputs.array[idx].worker;
+		if (worker) {
+			*total = (uint32_t)os_atomic_load_long(&worker->total_frames);
+			*skipped = (uint32_t)os_atomic_load_long(&worker->skipped_frames);
+			found = true;
+		}
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return found;
+}
+
 static void log_skipped(video_t *video)
 {
 	long skipped = os_atomic_load_long(&video->skipped_frames);
@@ -474,6 +989,28 @@ bool video_output_disconnect2(video_t *video, void (*callback)(void *param, stru
 
 	video = get_root(video);
 
+	/* the video thread holds the input mutex until every parallel input
+	 * has returned, the inputs don't change until then either */
+	if (dispatching_video == video) {
+		if (video_get_input_idx(video, callback, param) == DARRAY_INVALID)
+			return false;
+
+		struct video_input_ref ref = {callback, param};
+		bool found = false;
+
+		pthread_mutex_lock(&video->deferred_mutex);
+		for (size_t i = 0; i < video->deferred_disconnects.num; i++) {
+			struct video_input_ref *cur = &video->deferred_disconnects.array[i];
+			if (cur->callback == callback && cur->param == param)
+				found = true;
+		}
+		if (!found)
+			da_push_back(video->deferred_disconnects, &ref);
+		pthread_mutex_unlock(&video->deferred_mutex);
+
+		return !found;
+	}
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
@@ -506,42 +1043,90 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+/* fold the frame into the last one published, which the video thread then
+ * outputs once more per count */
+static bool merge_cached_frame(struct video_output *video, int count)
+{
+	size_t last = video->next_write ? video->next_write - 1 : video->info.cache_size - 1;
+	struct cached_frame_info *cfi = &video->cache[last];
+	long cur;
+
+	do {
+		cur = os_atomic_load_long(&cfi->count);
+
+		/* the video thread finished it in the meantime, so there is
+		 * a free slot again */
+		if (cur == 0)
+			return false;
+	} while (!os_atomic_compare_swap_long(&cfi->count, cur, cur + count));
+
+	for (int i = 0; i < count; i++)
+		os_atomic_inc_long(&cfi->skipped);
+	return true;
+}
+
+static struct cached_frame_info *add_cached_frame(struct video_output *video, int count, uint64_t timestamp)
+{
+	struct cached_frame_info *cfi;
+
+	while (os_atomic_load_long(&video->available_frames) == 0) {
+		if (merge_cached_frame(video, count))
+			return NULL;
+	}
+
+	cfi = &video->cache[video->next_write];
+	cfi->frame.timestamp = timestamp;
+	cfi->skipped = 0;
+	cfi->count = count;
+	return cfi;
+}
+
+/* hands the slot returned by add_cached_frame over to the video thread */
+static void publish_cached_frame(struct video_output *video)
+{
+	if (++video->next_write == video->info.cache_size)
+		video->next_write = 0;
+
+	os_atomic_dec_long(&video->available_frames);
+	os_sem_post(video->update_semaphore);
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
 
 	video = get_root(video);
 
-	pthread_mutex_lock(&video->data_mutex);
+	cfi = add_cached_frame(video, count, timestamp);
+	if (cfi)
+		memcpy(frame, &cfi->frame, sizeof(*frame));
 
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
+	return cfi != NULL;
+}
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
+bool video_output_push_frame_ref(video_t *video, const struct video_data *frame, int count,
+				 void (*release)(void *param), void *param)
+{
+	struct cached_frame_info *cfi;
 
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
+	if (!video || !frame || !release)
+		return false;
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+	video = get_root(video);
 
-		locked = true;
-	}
+	cfi = add_cached_frame(video, count, frame->timestamp);
+	if (cfi) {
+		cfi->frame_ref = *frame;
+		cfi->release = release;
+		cfi->release_param = param;
 
-	pthread_mutex_unlock(&video->data_mutex);
+		publish_cached_frame(video);
+	}
 
-	return locked;
+	return cfi != NULL;
 }
 
 void video_output_unlock_frame(video_t *video)
@@ -549,14 +1134,7 @@ void video_output_unlock_frame(video_t *video)
 	if (!video)
 		return;
 
-	video = get_root(video);
-
-	pthread_mutex_lock(&video->data_mutex);
-
-	video->available_frames--;
-	os_sem_post(video->update_semaphore);
-
-	pthread_mutex_unlock(&video->data_mutex);
+	publish_cached_frame(get_root(video));
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
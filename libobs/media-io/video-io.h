@@ -275,12 +275,27 @@ enum video_scale_type {
 	VIDEO_SCALE_BICUBIC,
 };
 
+enum video_scale_dither {
+	VIDEO_SCALE_DITHER_DEFAULT,
+	VIDEO_SCALE_DITHER_NONE,
+	VIDEO_SCALE_DITHER_BAYER,
+	VIDEO_SCALE_DITHER_ERROR_DIFFUSION,
+};
+
 struct video_scale_info {
 	enum video_format format;
 	uint32_t width;
 	uint32_t height;
 	enum video_range_type range;
 	enum video_colorspace colorspace;
+
+	/* number of slice threads used when scaling to this format, 0 or 1
+	 * scales on the calling thread */
+	uint32_t threads;
+
+	/* dithering used when reducing bit depth; the default disables it for
+	 * high bit depth destinations at least as deep as the source */
+	enum video_scale_dither dither;
 };
 
 EXPORT enum video_format video_format_from_fourcc(uint32_t fourcc);
@@ -303,6 +318,31 @@ EXPORT bool video_output_connect(video_t *video, const struct video_scale_info *
 EXPORT bool video_output_connect2(video_t *video, const struct video_scale_info *conversion,
 				  uint32_t frame_rate_divisor, void (*callback)(void *param, struct video_data *frame),
 				  void *param);
+/**
+ * Connects an input that receives frames on a thread of its own rather than
+ * on the video thread.  Up to queue_size frames are copied and queued for it;
+ * frames arriving while the queue is full are dropped for this input only.
+ */
+EXPORT bool video_output_connect_threaded(video_t *video, const struct video_scale_info *conversion,
+					  uint32_t frame_rate_divisor, size_t queue_size,
+					  void (*callback)(void *param, struct video_data *frame), void *param);
+
+/**
+ * Connects an input that is called in parallel with the other inputs
+ * connected this way, each on a thread of the video output's dispatch pool.
+ * The video thread waits for all of them to return before the next frame,
+ * so no frames are dropped.  The callback must not connect inputs.
+ */
+EXPORT bool video_output_connect_parallel(video_t *video, const struct video_scale_info *conversion,
+					  uint32_t frame_rate_divisor,
+					  void (*callback)(void *param, struct video_data *frame), void *param);
+
+/**
+ * Gets the frame counts of an input connected with
+ * video_output_connect_threaded.  Returns false if no such input exists.
+ */
+EXPORT bool video_output_get_input_frames(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					  void *param, uint32_t *total, uint32_t *skipped);
 EXPORT void video_output_disconnect(video_t *video, void (*callback)(void *param, struct video_data *frame),
 				    void *param);
 EXPORT bool video_output_disconnect2(video_t *video, void (*callback)(void *param, struct video_data *frame),
@@ -311,8 +351,23 @@ EXPORT bool video_output_disconnect2(video_t *video, void (*callback)(void *para
 EXPORT bool video_output_active(const video_t *video);
 
 EXPORT const struct video_output_info *video_output_get_info(const video_t *video);
+/**
+ * Locks the next free frame of the cache for writing.  The cache is a lock-free
+ * ring with a single producer, so frames of one video output must only be
+ * locked, unlocked and pushed from one thread at a time.
+ */
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame, int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+
+/**
+ * Queues a frame that references plane data owned by the caller instead of
+ * copying it into the frame cache.  The data must stay valid until release
+ * is called, which happens on the video thread once every input has
+ * received the frame, or when the output is closed.  Returns false without
+ * calling release if the cache is full (the frame is counted as skipped).
+ */
+EXPORT bool video_output_push_frame_ref(video_t *video, const struct video_data *frame, int count,
+					void (*release)(void *param), void *param);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
@@ -18,6 +18,7 @@
 #include "../util/bmem.h"
 #include "video-scaler.h"
 
+#include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswscale/swscale.h>
@@ -28,6 +29,12 @@ struct video_scaler {
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+
+	/* only used with slice threading, which requires the frame API */
+	bool threaded;
+	AVFrame *src_frame;
+	AVFrame *dst_frame;
+	int dst_size;
 };
 
 static inline enum AVPixelFormat get_ffmpeg_video_format(enum video_format format)
@@ -138,6 +145,33 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 	return 0;
 }
 
+static inline int get_format_depth(enum AVPixelFormat format)
+{
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+	return desc ? desc->comp[0].depth : 8;
+}
+
+static const char *get_ffmpeg_dither(enum video_scale_dither dither, enum AVPixelFormat src, enum AVPixelFormat dst)
+{
+	switch (dither) {
+	case VIDEO_SCALE_DITHER_DEFAULT:
+		/* high bit depth paths that lose no precision, e.g. P010 to
+		 * P010/I010, have nothing to dither; 8-bit paths are left
+		 * as they were */
+		if (get_format_depth(dst) > 8 && get_format_depth(dst) >= get_format_depth(src))
+			return "none";
+		return NULL;
+	case VIDEO_SCALE_DITHER_NONE:
+		return "none";
+	case VIDEO_SCALE_DITHER_BAYER:
+		return "bayer";
+	case VIDEO_SCALE_DITHER_ERROR_DIFFUSION:
+		return "ed";
+	}
+
+	return NULL;
+}
+
 #define FIXED_1_0 (1 << 16)
 
 int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_info *dst,
@@ -150,6 +184,7 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 	const int *coeff_dst = get_ffmpeg_coeffs(dst->colorspace);
 	int range_src = get_ffmpeg_range_type(src->range);
 	int range_dst = get_ffmpeg_range_type(dst->range);
+	const char *dither = get_ffmpeg_dither(dst->dither, format_src, format_dst);
 	struct video_scaler *scaler;
 	int ret;
 
@@ -180,6 +215,24 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 		blog(LOG_WARNING, "video_scaler_create: av_image_alloc failed: %d", ret);
 		goto fail;
 	}
+	scaler->dst_size = ret;
+
+	if (dst->threads > 1) {
+		scaler->src_frame = av_frame_alloc();
+		scaler->dst_frame = av_frame_alloc();
+		if (!scaler->src_frame || !scaler->dst_frame) {
+			blog(LOG_ERROR, "video_scaler_create: Could not allocate frames");
+			goto fail;
+		}
+
+		scaler->src_frame->format = format_src;
+		scaler->src_frame->width = src->width;
+		scaler->src_frame->height = src->height;
+		scaler->dst_frame->format = format_dst;
+		scaler->dst_frame->width = dst->width;
+		scaler->dst_frame->height = dst->height;
+		scaler->threaded = true;
+	}
 
 	scaler->swscale = sws_alloc_context();
 	if (!scaler->swscale) {
@@ -197,6 +250,10 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 	av_opt_set_int(scaler->swscale, "dst_format", format_dst, 0);
 	av_opt_set_int(scaler->swscale, "src_range", range_src, 0);
 	av_opt_set_int(scaler->swscale, "dst_range", range_dst, 0);
+	if (scaler->threaded)
+		av_opt_set_int(scaler->swscale, "threads", dst->threads, 0);
+	if (dither)
+		av_opt_set(scaler->swscale, "sws_dither", dither, 0);
 	if (sws_init_context(scaler->swscale, NULL, NULL) < 0) {
 		blog(LOG_ERROR, "video_scaler_create: sws_init_context failed");
 		goto fail;
@@ -221,6 +278,8 @@ void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
 		sws_freeContext(scaler->swscale);
+		av_frame_free(&scaler->src_frame);
+		av_frame_free(&scaler->dst_frame);
 
 		if (scaler->dst_pointers[0])
 			av_freep(scaler->dst_pointers);
@@ -229,14 +288,55 @@ void video_scaler_destroy(video_scaler_t *scaler)
 	}
 }
 
+static void free_nothing(void *opaque, uint8_t *data)
+{
+	UNUSED_PARAMETER(opaque);
+	UNUSED_PARAMETER(data);
+}
+
+/* Slice threading is only available through sws_scale_frame, which takes
+ * references on the frames it is given.  The buffers here live elsewhere, so
+ * wrap them in non-owning buffer refs to keep libswscale from copying them. */
+static int scale_threaded(struct video_scaler *scaler, const uint8_t *const input[], const uint32_t in_linesize[])
+{
+	AVFrame *src = scaler->src_frame;
+	AVFrame *dst = scaler->dst_frame;
+	int ret;
+
+	for (size_t i = 0; i < 4; i++) {
+		src->data[i] = (uint8_t *)input[i];
+		src->linesize[i] = (int)in_linesize[i];
+		dst->data[i] = scaler->dst_pointers[i];
+		dst->linesize[i] = scaler->dst_linesizes[i];
+	}
+
+	src->buf[0] = av_buffer_create((uint8_t *)input[0], 1, free_nothing, NULL, AV_BUFFER_FLAG_READONLY);
+	dst->buf[0] = av_buffer_create(scaler->dst_pointers[0], scaler->dst_size, free_nothing, NULL, 0);
+	if (!src->buf[0] || !dst->buf[0]) {
+		ret = AVERROR(ENOMEM);
+	} else {
+		ret = sws_scale_frame(scaler->swscale, dst, src);
+		if (ret >= 0)
+			ret = scaler->dst_heights[0];
+	}
+
+	av_buffer_unref(&src->buf[0]);
+	av_buffer_unref(&dst->buf[0]);
+	return ret;
+}
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[], const uint32_t out_linesize[],
 			const uint8_t *const input[], const uint32_t in_linesize[])
 {
 	if (!scaler)
 		return false;
 
-	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0, scaler->src_height,
-			    scaler->dst_pointers, scaler->dst_linesizes);
+	int ret;
+	if (scaler->threaded)
+		ret = scale_threaded(scaler, input, in_linesize);
+	else
+		ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0, scaler->src_height,
+				scaler->dst_pointers, scaler->dst_linesizes);
 	if (ret <= 0) {
 		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d", ret);
 		return false;
@@ -76,6 +76,10 @@ struct obs_volmeter {
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
+
+	/* levels accumulated for obs_volmeter_get_levels, under mutex */
+	struct obs_volmeter_levels levels;
+	bool levels_updated;
 };
 
 static float cubic_def_to_db(const float def)
@@ -459,6 +463,37 @@ static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_d
 	}
 }
 
+/* x4(d, c, b, a)  -->  a + b + c + d
+ */
+#define hadd_ps(r, x4)                      \
+	do {                                \
+		float x4_mem[4];            \
+		_mm_storeu_ps(x4_mem, x4);  \
+		r = x4_mem[0] + x4_mem[1];  \
+		r += x4_mem[2] + x4_mem[3]; \
+	} while (false)
+
+static float get_sum_of_squares(const float *samples, size_t nr_samples)
+{
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	size_t i = 0;
+	float sum;
+
+	for (; (i + 7) < nr_samples; i += 8) {
+		__m128 a = _mm_loadu_ps(&samples[i]);
+		__m128 b = _mm_loadu_ps(&samples[i + 4]);
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(a, a));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(b, b));
+	}
+
+	hadd_ps(sum, _mm_add_ps(sum0, sum1));
+
+	for (; i < nr_samples; i++)
+		sum += samples[i] * samples[i];
+	return sum;
+}
+
 static void volmeter_process_magnitude(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
 {
 	size_t nr_samples = data->frames;
@@ -470,11 +505,7 @@ static void volmeter_process_magnitude(obs_volmeter_t *volmeter, const struct au
 			continue;
 		}
 
-		float sum = 0.0;
-		for (size_t i = 0; i < nr_samples; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
-		}
+		float sum = get_sum_of_squares(samples, nr_samples);
 		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
 
 		channel_nr++;
@@ -489,6 +520,26 @@ static void volmeter_process_audio_data(obs_volmeter_t *volmeter, const struct a
 	volmeter_process_magnitude(volmeter, data, nr_channels);
 }
 
+/* peaks are held until the levels are read so that a poller sees every peak
+ * between two reads, assumes volmeter->mutex */
+static void update_levels(struct obs_volmeter *volmeter, const float magnitude[MAX_AUDIO_CHANNELS],
+			  const float peak[MAX_AUDIO_CHANNELS], const float input_peak[MAX_AUDIO_CHANNELS])
+{
+	struct obs_volmeter_levels *levels = &volmeter->levels;
+
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
+		levels->magnitude[channel_nr] = magnitude[channel_nr];
+
+		if (!volmeter->levels_updated || peak[channel_nr] > levels->peak[channel_nr])
+			levels->peak[channel_nr] = peak[channel_nr];
+		if (!volmeter->levels_updated || input_peak[channel_nr] > levels->input_peak[channel_nr])
+			levels->input_peak[channel_nr] = input_peak[channel_nr];
+	}
+
+	levels->timestamp = os_gettime_ns();
+	volmeter->levels_updated = true;
+}
+
 static void volmeter_source_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
 {
 	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
@@ -513,6 +564,8 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source, cons
 		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
 	}
 
+	update_levels(volmeter, magnitude, peak, input_peak);
+
 	pthread_mutex_unlock(&volmeter->mutex);
 
 	signal_levels_updated(volmeter, magnitude, peak, input_peak);
@@ -749,6 +802,23 @@ fail:
 	return NULL;
 }
 
+bool obs_volmeter_get_levels(obs_volmeter_t *volmeter, struct obs_volmeter_levels *levels)
+{
+	bool updated;
+
+	if (!volmeter || !levels)
+		return false;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	updated = volmeter->levels_updated;
+	if (updated)
+		*levels = volmeter->levels;
+	volmeter->levels_updated = false;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	return updated;
+}
+
 void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 {
 	if (!volmeter)
@@ -238,6 +238,25 @@ typedef void (*obs_volmeter_updated_t)(void *param, const float magnitude[MAX_AU
 EXPORT void obs_volmeter_add_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter, obs_volmeter_updated_t callback, void *param);
 
+struct obs_volmeter_levels {
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+	uint64_t timestamp;
+};
+
+/**
+ * @brief Get the levels published since the last call
+ * @param volmeter pointer to the volume meter object
+ * @param levels receives the levels in dB
+ * @return false if no audio was measured since the last call
+ *
+ * An alternative to obs_volmeter_add_callback for displays that redraw on a
+ * timer.  The magnitude is the latest one, the peaks are the highest since
+ * the previous call, and the timestamp is when the latest audio arrived.
+ */
+EXPORT bool obs_volmeter_get_levels(obs_volmeter_t *volmeter, struct obs_volmeter_levels *levels);
+
 EXPORT float obs_mul_to_db(float mul);
 EXPORT float obs_db_to_mul(float db);
 
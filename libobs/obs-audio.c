@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "media-io/audio-mix.h"
 
 struct ts_info {
 	uint64_t start;
@@ -45,10 +46,10 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 	return (size_t)util_mul_div64(t, sample_rate, 1000000000ULL);
 }
 
-static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, size_t channels, size_t sample_rate,
-			     struct ts_info *ts)
+static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *source, uint32_t mixers, size_t channels,
+			     size_t sample_rate, struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = obs->audio.frames_per_tick;
 	size_t start_point = 0;
 
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
@@ -56,24 +57,22 @@ static inline void mix_audio(struct audio_output_data *mixes, obs_source_t *sour
 
 	if (source->audio_ts != ts->start) {
 		start_point = convert_time_to_frames(sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES)
+		if (start_point >= total_floats)
 			return;
 
 		total_floats -= start_point;
 	}
 
-	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud = source->audio_output_buf[mix_idx][ch];
-			register float *end;
+	/* mixes the source isn't routed to were zeroed when it rendered */
+	mixers &= source->audio_mixers;
 
-			mix += start_point;
-			end = aud + total_floats;
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			audio_mix_add(mixes[mix_idx].data[ch] + start_point, source->audio_output_buf[mix_idx][ch],
+				      total_floats);
 	}
 }
 
@@ -176,15 +175,11 @@ static bool discard_if_stopped(obs_source_t *source, size_t channels)
 	}
 }
 
-#define MAX_AUDIO_SIZE (AUDIO_OUTPUT_FRAMES * sizeof(float))
-
 static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *source, size_t channels,
 				 size_t sample_rate, struct ts_info *ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = audio->frames_per_tick;
 	size_t size;
-	/* debug assert only */
-	UNUSED_PARAMETER(audio);
 
 #if DEBUG_AUDIO == 1
 	bool is_audio_source = source->info.output_flags & OBS_SOURCE_AUDIO;
@@ -207,7 +202,7 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 	}
 
 	if (source->audio_ts < (ts->start - 1)) {
-		if (source->audio_pending && source->audio_input_buf[0].size < MAX_AUDIO_SIZE &&
+		if (source->audio_pending && source->audio_input_buf[0].size < audio->frames_per_tick * sizeof(float) &&
 		    discard_if_stopped(source, channels))
 			return;
 
@@ -230,7 +225,7 @@ static inline void discard_audio(struct obs_core_audio *audio, obs_source_t *sou
 
 	if (source->audio_ts != ts->start && source->audio_ts != (ts->start - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate, source->audio_ts - ts->start);
-		if (start_point == AUDIO_OUTPUT_FRAMES) {
+		if (start_point >= audio->frames_per_tick) {
 #if DEBUG_AUDIO == 1
 			if (is_audio_source)
 				blog(LOG_DEBUG, "can't discard, start point is "
@@ -275,6 +270,31 @@ static inline bool audio_buffering_maxed(struct obs_core_audio *audio)
 	return audio->total_buffering_ticks == audio->max_buffering_ticks;
 }
 
+static inline int buffering_ticks_to_ms(struct obs_core_audio *audio, size_t sample_rate, int ticks)
+{
+	return (int)((int64_t)ticks * audio->frames_per_tick * 1000 / (int64_t)sample_rate);
+}
+
+/* starts a new lateness window, the old one no longer reflects the buffering */
+static inline void reset_slack_window(struct obs_core_audio *audio)
+{
+	audio->slack_window_start = 0;
+	audio->min_slack = UINT64_MAX;
+}
+
+static void signal_audio_buffering(struct obs_core_audio *audio, size_t sample_rate, int delta_ticks,
+				   const char *source_name)
+{
+	struct calldata params;
+	uint8_t stack[256];
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_int(&params, "ms", buffering_ticks_to_ms(audio, sample_rate, audio->total_buffering_ticks));
+	calldata_set_int(&params, "delta_ms", buffering_ticks_to_ms(audio, sample_rate, delta_ticks));
+	calldata_set_string(&params, "source", source_name);
+	signal_handler_signal(obs->signals, "audio_buffering_changed", &params);
+}
+
 static void set_fixed_audio_buffering(struct obs_core_audio *audio, size_t sample_rate, struct ts_info *ts)
 {
 	struct ts_info new_ts;
@@ -290,21 +310,22 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio, size_t sampl
 	ticks = audio->max_buffering_ticks - audio->total_buffering_ticks;
 	audio->total_buffering_ticks += ticks;
 
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames_per_tick * 1000 / sample_rate;
 
 	blog(LOG_INFO,
 	     "Enabling fixed audio buffering, total "
 	     "audio buffering is now %d milliseconds",
 	     (int)total_ms);
+	signal_audio_buffering(audio, sample_rate, ticks, NULL);
 
-	new_ts.start =
-		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * AUDIO_OUTPUT_FRAMES);
+	new_ts.start = audio->buffered_ts -
+		       audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * audio->frames_per_tick);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
 
 		new_ts.end = new_ts.start;
-		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * AUDIO_OUTPUT_FRAMES);
+		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * audio->frames_per_tick);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64, new_ts.start, new_ts.end);
@@ -334,7 +355,7 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 
 	offset = ts->start - min_ts;
 	frames = ns_to_audio_frames(sample_rate, offset);
-	ticks = (int)((frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
+	ticks = (int)((frames + audio->frames_per_tick - 1) / audio->frames_per_tick);
 
 	audio->total_buffering_ticks += ticks;
 
@@ -344,14 +365,16 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
-	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
-	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
+	ms = ticks * audio->frames_per_tick * 1000 / sample_rate;
+	total_ms = audio->total_buffering_ticks * audio->frames_per_tick * 1000 / sample_rate;
 
 	blog(LOG_INFO,
 	     "adding %d milliseconds of audio buffering, total "
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
 	     (int)ms, (int)total_ms, buffering_name);
+	signal_audio_buffering(audio, sample_rate, ticks, buffering_name);
+	reset_slack_window(audio);
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -360,14 +383,14 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 	blog(LOG_DEBUG, "old buffered ts: %" PRIu64 "-%" PRIu64, ts->start, ts->end);
 #endif
 
-	new_ts.start =
-		audio->buffered_ts - audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * AUDIO_OUTPUT_FRAMES);
+	new_ts.start = audio->buffered_ts -
+		       audio_frames_to_ns(sample_rate, audio->buffering_wait_ticks * audio->frames_per_tick);
 
 	while (ticks--) {
 		const uint64_t cur_ticks = ++audio->buffering_wait_ticks;
 
 		new_ts.end = new_ts.start;
-		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * AUDIO_OUTPUT_FRAMES);
+		new_ts.start = audio->buffered_ts - audio_frames_to_ns(sample_rate, cur_ticks * audio->frames_per_tick);
 
 #if DEBUG_AUDIO == 1
 		blog(LOG_DEBUG, "add buffered ts: %" PRIu64 "-%" PRIu64, new_ts.start, new_ts.end);
@@ -381,7 +404,7 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 
 static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_rate, uint64_t min_ts)
 {
-	size_t total_floats = AUDIO_OUTPUT_FRAMES;
+	size_t total_floats = obs->audio.frames_per_tick;
 	size_t size;
 
 	if (source->info.audio_render || source->audio_pending || !source->audio_ts) {
@@ -390,7 +413,7 @@ static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_r
 
 	if (source->audio_ts != min_ts && source->audio_ts != (min_ts - 1)) {
 		size_t start_point = convert_time_to_frames(sample_rate, source->audio_ts - min_ts);
-		if (start_point >= AUDIO_OUTPUT_FRAMES)
+		if (start_point >= total_floats)
 			return false;
 
 		total_floats -= start_point;
@@ -465,6 +488,232 @@ static inline void execute_audio_tasks(void)
 	}
 }
 
+#define MAX_AUDIO_RENDER_THREADS 8
+
+static void render_audio_source(struct obs_core_audio *audio, obs_source_t *source, uint32_t mixers, uint64_t start_ts)
+{
+	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
+	size_t channels = audio_output_get_channels(audio->audio);
+	size_t audio_size = audio->frames_per_tick * sizeof(float);
+
+	obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio_buffering_maxed(audio) && source->audio_ts != 0 && source->audio_ts < start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, channels, sample_rate, start_ts);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
+		}
+	}
+}
+
+static void run_audio_render_jobs(struct obs_core_audio *audio)
+{
+	const long num = (long)audio->render_jobs.num;
+
+	for (;;) {
+		const long idx = os_atomic_inc_long(&audio->render_next) - 1;
+		if (idx >= num)
+			break;
+
+		render_audio_source(audio, audio->render_jobs.array[idx], audio->render_mixers, audio->render_start_ts);
+	}
+}
+
+static void *audio_render_thread(void *param)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	os_set_thread_name("libobs: audio render thread");
+	obs_set_alloc_counter(OBS_ALLOC_AUDIO);
+
+	while (os_sem_wait(audio->render_semaphore) == 0) {
+		if (os_atomic_load_bool(&audio->render_stop))
+			break;
+
+		obs_apply_core_thread_affinity();
+		run_audio_render_jobs(audio);
+
+		if (os_atomic_dec_long(&audio->render_busy) == 0)
+			os_event_signal(audio->render_done);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+bool init_audio_render_threads(uint32_t num_threads)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (num_threads > MAX_AUDIO_RENDER_THREADS)
+		num_threads = MAX_AUDIO_RENDER_THREADS;
+	if (!num_threads)
+		return true;
+
+	audio->render_stop = false;
+
+	if (os_sem_init(&audio->render_semaphore, 0) != 0)
+		goto fail;
+	if (os_event_init(&audio->render_done, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	for (uint32_t i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, audio_render_thread, NULL) != 0)
+			goto fail;
+		da_push_back(audio->render_threads, &thread);
+	}
+
+	return true;
+
+fail:
+	/* stops and joins the threads that did start */
+	free_audio_render_threads();
+	return false;
+}
+
+void free_audio_render_threads(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	os_atomic_set_bool(&audio->render_stop, true);
+	for (size_t i = 0; i < audio->render_threads.num; i++)
+		os_sem_post(audio->render_semaphore);
+	for (size_t i = 0; i < audio->render_threads.num; i++)
+		pthread_join(audio->render_threads.array[i], NULL);
+	da_free(audio->render_threads);
+	da_free(audio->render_jobs);
+
+	if (audio->render_semaphore) {
+		os_sem_destroy(audio->render_semaphore);
+		audio->render_semaphore = NULL;
+	}
+	if (audio->render_done) {
+		os_event_destroy(audio->render_done);
+		audio->render_done = NULL;
+	}
+}
+
+/* render_order is built children first, so once every leaf (a source without
+ * an audio_render callback) has been rendered, the composite sources that mix
+ * them can be rendered in order.  leaves only touch their own buffers and
+ * are spread over the render threads, with the audio thread taking jobs as
+ * well */
+static void render_audio_sources(struct obs_core_audio *audio, uint32_t mixers, uint64_t start_ts)
+{
+	if (!audio->render_threads.num) {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(audio, audio->render_order.array[i], mixers, start_ts);
+		return;
+	}
+
+	da_resize(audio->render_jobs, 0);
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (!source->info.audio_render)
+			da_push_back(audio->render_jobs, &source);
+	}
+
+	long workers = (long)audio->render_jobs.num - 1;
+	if (workers > (long)audio->render_threads.num)
+		workers = (long)audio->render_threads.num;
+
+	audio->render_mixers = mixers;
+	audio->render_start_ts = start_ts;
+	os_atomic_set_long(&audio->render_next, 0);
+	os_atomic_set_long(&audio->render_busy, workers);
+
+	for (long i = 0; i < workers; i++)
+		os_sem_post(audio->render_semaphore);
+
+	run_audio_render_jobs(audio);
+
+	if (workers > 0)
+		os_event_wait(audio->render_done);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (source->info.audio_render)
+			render_audio_source(audio, source, mixers, start_ts);
+	}
+}
+
+/* length of the window source lateness is tracked over before buffering
+ * may shrink by a tick */
+#define ADAPTIVE_WINDOW_NS 5000000000ULL
+
+/* how much audio the source has queued past the end of this tick, or
+ * UINT64_MAX if it isn't holding back buffering.  assumes audio_buf_mutex */
+static uint64_t get_source_slack(obs_source_t *source, size_t sample_rate, const struct ts_info *ts)
+{
+	uint64_t end;
+
+	if (source->info.audio_render || source->audio_pending || !source->audio_ts)
+		return UINT64_MAX;
+
+	end = source->audio_ts + audio_frames_to_ns(sample_rate, source->audio_input_buf[0].size / sizeof(float));
+	return end > ts->end ? end - ts->end : 0;
+}
+
+/* Buffering is removed by mixing one extra tick right after this one, so the
+ * output stays continuous and the sources' queued audio is simply consumed a
+ * tick sooner; nothing is dropped or resampled. */
+static void update_adaptive_buffering(struct obs_core_audio *audio, size_t sample_rate, const struct ts_info *ts,
+				      uint64_t slack)
+{
+	const uint64_t tick_ns = audio_frames_to_ns(sample_rate, audio->frames_per_tick);
+	bool shrink;
+
+	if (slack < audio->min_slack)
+		audio->min_slack = slack;
+
+	if (!audio->slack_window_start) {
+		audio->slack_window_start = ts->start;
+		return;
+	}
+	if (ts->start - audio->slack_window_start < ADAPTIVE_WINDOW_NS)
+		return;
+
+	/* every source stayed at least two ticks ahead for the whole window,
+	 * so one tick can go while leaving a tick of headroom */
+	shrink = audio->total_buffering_ticks > 0 && audio->min_slack >= tick_ns * 2;
+	reset_slack_window(audio);
+
+	if (!shrink)
+		return;
+
+	audio->total_buffering_ticks--;
+	audio->catching_up = true;
+	audio_output_catch_up(audio->audio);
+
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering is now %d milliseconds",
+	     buffering_ticks_to_ms(audio, sample_rate, 1),
+	     buffering_ticks_to_ms(audio, sample_rate, audio->total_buffering_ticks));
+	signal_audio_buffering(audio, sample_rate, -1, NULL);
+}
+
+static const char *mix_audio_name = "mix_audio";
 bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
 		    struct audio_output_data *mixes)
 {
@@ -474,18 +723,23 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
-	size_t audio_size;
+	uint64_t slack = UINT64_MAX;
 	uint64_t min_ts;
 
+	/* the audio-io thread only ever runs this and the encoders */
+	obs_set_alloc_counter(OBS_ALLOC_AUDIO);
+
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
 
-	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	/* a catch up tick mixes the next buffered tick early instead of
+	 * adding a new one */
+	if (!audio->catching_up)
+		deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	audio->catching_up = false;
 	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
-	audio_size = AUDIO_OUTPUT_FRAMES * sizeof(float);
-
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG, "ts %llu-%llu", ts.start, ts.end);
 #endif
@@ -523,6 +777,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	source = data->first_audio_source;
 	while (source) {
+		obs_source_flush_audio_queue(source);
 		push_audio_tree(NULL, source, audio);
 		source = (struct obs_source *)source->next_audio_source;
 	}
@@ -531,36 +786,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 && source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels, sample_rate, ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
-			}
-		}
-	}
+	render_audio_sources(audio, mixers, ts.start);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
@@ -581,19 +807,23 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	/* ------------------------------------------------ */
 	/* mix audio */
 	if (!audio->buffering_wait_ticks) {
+		profile_start(mix_audio_name);
+
 		for (size_t i = 0; i < audio->root_nodes.num; i++) {
 			obs_source_t *source = audio->root_nodes.array[i];
 
-			if (source->audio_pending)
+			if (source->audio_pending || source->audio_silent)
 				continue;
 
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate, &ts);
+				mix_audio(mixes, source, mixers, channels, sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
+
+		profile_end(mix_audio_name);
 	}
 
 	/* ------------------------------------------------ */
@@ -603,6 +833,11 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	source = data->first_audio_source;
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
+		if (audio->adaptive_buffer) {
+			uint64_t source_slack = get_source_slack(source, sample_rate, &ts);
+			if (source_slack < slack)
+				slack = source_slack;
+		}
 		discard_audio(audio, source, channels, sample_rate, &ts);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
@@ -624,6 +859,9 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 		return false;
 	}
 
+	if (audio->adaptive_buffer)
+		update_adaptive_buffering(audio, sample_rate, &ts, slack);
+
 	execute_audio_tasks();
 
 	UNUSED_PARAMETER(param);
@@ -537,7 +537,13 @@ static CGEventRef KeyboardEventProc(CGEventTapProxy proxy __unused, CGEventType
             platform->is_key_down[obs_key_from_virtual_key(keycode)] = false;
             break;
         }
-        case kCGEventFlagsChanged: {
+        case kCGEventFlagsChanged:
+        case kCGEventLeftMouseDown:
+        case kCGEventLeftMouseUp:
+        case kCGEventRightMouseDown:
+        case kCGEventRightMouseUp:
+        case kCGEventOtherMouseDown:
+        case kCGEventOtherMouseUp: {
             break;
         }
         case kCGEventTapDisabledByTimeout: {
@@ -547,8 +553,12 @@ static CGEventRef KeyboardEventProc(CGEventTapProxy proxy __unused, CGEventType
         }
         default: {
             blog(LOG_WARNING, "[hotkeys-cocoa]: Received unexpected event with code '%d'", type);
+            return event;
         }
     }
+
+    if (type != kCGEventTapDisabledByTimeout)
+        obs_hotkeys_input_event();
     return event;
 }
 
@@ -596,7 +606,13 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
     if (has_event_access) {
         platform->eventTap = CGEventTapCreate(kCGHIDEventTap, kCGHeadInsertEventTap, kCGEventTapOptionListenOnly,
                                               CGEventMaskBit(kCGEventKeyDown) | CGEventMaskBit(kCGEventKeyUp) |
-                                                  CGEventMaskBit(kCGEventFlagsChanged),
+                                                  CGEventMaskBit(kCGEventFlagsChanged) |
+                                                  CGEventMaskBit(kCGEventLeftMouseDown) |
+                                                  CGEventMaskBit(kCGEventLeftMouseUp) |
+                                                  CGEventMaskBit(kCGEventRightMouseDown) |
+                                                  CGEventMaskBit(kCGEventRightMouseUp) |
+                                                  CGEventMaskBit(kCGEventOtherMouseDown) |
+                                                  CGEventMaskBit(kCGEventOtherMouseUp),
                                               KeyboardEventProc, platform);
         if (!platform->eventTap) {
             blog(LOG_WARNING, "[hotkeys-cocoa]: Couldn't create hotkey event tap.");
@@ -609,6 +625,9 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
         CFRelease(source);
 
         CGEventTapEnable(platform->eventTap, true);
+
+        /* the tap wakes the hotkey thread, polling is only a fallback */
+        os_atomic_set_bool(&hotkeys->input_events, true);
     } else {
         blog(LOG_WARNING, "[hotkeys-cocoa]: No event permissions, could not add global hotkeys.");
     }
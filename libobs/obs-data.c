@@ -310,10 +310,12 @@ static inline void obs_data_item_detach(struct obs_data_item *item)
 	}
 }
 
+/* the hash handle still holds the hash and length of the name from before it
+ * was detached, so the name doesn't have to be hashed again */
 static inline void obs_data_item_reattach(struct obs_data *parent, struct obs_data_item *item)
 {
 	if (parent) {
-		HASH_ADD_STR(parent->items, name, item);
+		HASH_ADD_KEYPTR_BYHASHVALUE(hh, parent->items, item->name, item->hh.keylen, item->hh.hashv, item);
 		item->parent = parent;
 	}
 }
@@ -686,11 +688,8 @@ void obs_data_release(obs_data_t *data)
 		obs_data_destroy(data);
 }
 
-static const char *obs_data_get_json_internal(obs_data_t *data, bool pretty, bool with_defaults)
+static inline size_t get_json_flags(bool pretty)
 {
-	if (!data)
-		return NULL;
-
 	size_t flags = JSON_PRESERVE_ORDER;
 
 	if (pretty)
@@ -698,6 +697,16 @@ static const char *obs_data_get_json_internal(obs_data_t *data, bool pretty, boo
 	else
 		flags |= JSON_COMPACT;
 
+	return flags;
+}
+
+static const char *obs_data_get_json_internal(obs_data_t *data, bool pretty, bool with_defaults)
+{
+	if (!data)
+		return NULL;
+
+	size_t flags = get_json_flags(pretty);
+
 	/* NOTE: don't use libobs bfree for json text */
 	free(data->json);
 	data->json = NULL;
@@ -734,37 +743,92 @@ const char *obs_data_get_last_json(obs_data_t *data)
 	return data ? data->json : NULL;
 }
 
-bool obs_data_save_json(obs_data_t *data, const char *file)
+/* the json is dumped from the tree straight into a buffered file rather
+ * than into one big string first */
+static bool obs_data_write_json_file(obs_data_t *data, const char *file, bool pretty)
 {
-	const char *json = obs_data_get_json(data);
+	json_t *root;
+	FILE *f;
+	int ret;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file(file, json, strlen(json), false);
-	}
+	if (!data)
+		return false;
 
-	return false;
+	f = os_fopen(file, "wb");
+	if (!f)
+		return false;
+
+	setvbuf(f, NULL, _IOFBF, 64 * 1024);
+
+	root = obs_data_to_json(data, false);
+	ret = json_dumpf(root, f, get_json_flags(pretty));
+	json_decref(root);
+
+	if (fflush(f) != 0)
+		ret = -1;
+	fclose(f);
+
+	return ret == 0;
 }
 
-bool obs_data_save_json_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext)
+static bool obs_data_write_json_file_safe(obs_data_t *data, const char *file, bool pretty, const char *temp_ext,
+					  const char *backup_ext)
 {
-	const char *json = obs_data_get_json(data);
+	struct dstr backup_path = {0};
+	struct dstr temp_path = {0};
+	bool success = false;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file_safe(file, json, strlen(json), false, temp_ext, backup_ext);
+	if (!data)
+		return false;
+
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR, "obs_data_save_json_safe: invalid "
+				"temporary extension specified");
+		return false;
 	}
 
-	return false;
+	dstr_copy(&temp_path, file);
+	if (*temp_ext != '.')
+		dstr_cat(&temp_path, ".");
+	dstr_cat(&temp_path, temp_ext);
+
+	if (!obs_data_write_json_file(data, temp_path.array, pretty)) {
+		blog(LOG_ERROR,
+		     "obs_data_save_json_safe: failed to "
+		     "write to %s",
+		     temp_path.array);
+		goto cleanup;
+	}
+
+	if (backup_ext && *backup_ext) {
+		dstr_copy(&backup_path, file);
+		if (*backup_ext != '.')
+			dstr_cat(&backup_path, ".");
+		dstr_cat(&backup_path, backup_ext);
+	}
+
+	if (os_safe_replace(file, temp_path.array, backup_path.array) == 0)
+		success = true;
+
+cleanup:
+	dstr_free(&backup_path);
+	dstr_free(&temp_path);
+	return success;
 }
 
-bool obs_data_save_json_pretty_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext)
+bool obs_data_save_json(obs_data_t *data, const char *file)
 {
-	const char *json = obs_data_get_json_pretty(data);
+	return obs_data_write_json_file(data, file, false);
+}
 
-	if (json && *json) {
-		return os_quick_write_utf8_file_safe(file, json, strlen(json), false, temp_ext, backup_ext);
-	}
+bool obs_data_save_json_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext)
+{
+	return obs_data_write_json_file_safe(data, file, false, temp_ext, backup_ext);
+}
 
-	return false;
+bool obs_data_save_json_pretty_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext)
+{
+	return obs_data_write_json_file_safe(data, file, true, temp_ext, backup_ext);
 }
 
 static void get_defaults_array_cb(obs_data_t *data, void *vp)
@@ -862,15 +926,38 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	return item;
 }
 
-static void set_item_data(struct obs_data *data, struct obs_data_item **item, const char *name, const void *ptr,
-			  size_t size, enum obs_data_type type, bool default_data, bool autoselect_data)
+/* setting a value looks the name up and then, for a new item, inserts it,
+ * so the name is hashed once for both */
+struct item_key {
+	const char *name;
+	size_t len;
+	unsigned hash;
+};
+
+static inline void get_item_key(struct item_key *key, const char *name)
+{
+	key->name = name;
+	key->len = strlen(name);
+	HASH_VALUE(name, key->len, key->hash);
+}
+
+static inline struct obs_data_item *get_item_by_key(struct obs_data *data, const struct item_key *key)
+{
+	struct obs_data_item *item;
+	HASH_FIND_BYHASHVALUE(hh, data->items, key->name, key->len, key->hash, item);
+	return item;
+}
+
+static void set_item_data(struct obs_data *data, struct obs_data_item **item, const struct item_key *key,
+			  const void *ptr, size_t size, enum obs_data_type type, bool default_data,
+			  bool autoselect_data)
 {
 	obs_data_item_t *new_item = NULL;
 
-	if ((!item || !*item) && data) {
-		new_item = obs_data_item_create(name, ptr, size, type, default_data, autoselect_data);
+	if ((!item || !*item) && data && key->name) {
+		new_item = obs_data_item_create(key->name, ptr, size, type, default_data, autoselect_data);
 		new_item->parent = data;
-		HASH_ADD_STR(data->items, name, new_item);
+		HASH_ADD_KEYPTR_BYHASHVALUE(hh, data->items, new_item->name, key->len, key->hash, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
@@ -885,51 +972,66 @@ static inline void set_item(struct obs_data *data, obs_data_item_t **item, const
 			    size_t size, enum obs_data_type type)
 {
 	obs_data_item_t *actual_item = NULL;
+	struct item_key key = {0};
 
 	if (!data && !item)
 		return;
 
 	if (!item) {
-		actual_item = get_item(data, name);
+		if (!name)
+			return;
+
+		get_item_key(&key, name);
+		actual_item = get_item_by_key(data, &key);
 		item = &actual_item;
 	}
 
-	set_item_data(data, item, name, ptr, size, type, false, false);
+	set_item_data(data, item, &key, ptr, size, type, false, false);
 }
 
 static inline void set_item_def(struct obs_data *data, obs_data_item_t **item, const char *name, const void *ptr,
 				size_t size, enum obs_data_type type)
 {
 	obs_data_item_t *actual_item = NULL;
+	struct item_key key = {0};
 
 	if (!data && !item)
 		return;
 
 	if (!item) {
-		actual_item = get_item(data, name);
+		if (!name)
+			return;
+
+		get_item_key(&key, name);
+		actual_item = get_item_by_key(data, &key);
 		item = &actual_item;
 	}
 
 	if (*item && (*item)->type != type)
 		return;
 
-	set_item_data(data, item, name, ptr, size, type, true, false);
+	set_item_data(data, item, &key, ptr, size, type, true, false);
 }
 
 static inline void set_item_auto(struct obs_data *data, obs_data_item_t **item, const char *name, const void *ptr,
 				 size_t size, enum obs_data_type type)
 {
 	obs_data_item_t *actual_item = NULL;
+	struct item_key key = {0};
 
 	if (!data && !item)
 		return;
 
 	if (!item) {
-		actual_item = get_item(data, name);
+		if (!name)
+			return;
+
+		get_item_key(&key, name);
+		actual_item = get_item_by_key(data, &key);
 		item = &actual_item;
 	}
 
-	set_item_data(data, item, name, ptr, size, type, false, true);
+	set_item_data(data, item, &key, ptr, size, type, false, true);
 }
 
 static void copy_obj(struct obs_data *data, const char *name, struct obs_data *obj,
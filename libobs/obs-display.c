@@ -60,6 +60,7 @@ bool obs_display_init(struct obs_display *display, const struct gs_init_data *gr
 	}
 
 	display->enabled = true;
+	display->render_divisor = 1;
 	return true;
 }
 
@@ -228,6 +229,7 @@ void render_display(struct obs_display *display)
 {
 	uint32_t cx, cy;
 	bool update_color_space;
+	long divisor;
 
 	if (!display || !display->enabled)
 		return;
@@ -240,6 +242,17 @@ void render_display(struct obs_display *display)
 	cy = display->next_cy;
 	update_color_space = display->update_color_space;
 
+	/* throttled displays still present right away when resized so that
+	 * the swap chain never shows stale contents at the wrong size */
+	divisor = os_atomic_load_long(&display->render_divisor);
+	if (divisor > 1 && ++display->frames_skipped < (uint32_t)divisor && !update_color_space &&
+	    cx == display->cx && cy == display->cy) {
+		pthread_mutex_unlock(&display->draw_info_mutex);
+		return;
+	}
+
+	display->frames_skipped = 0;
+
 	display->update_color_space = false;
 
 	pthread_mutex_unlock(&display->draw_info_mutex);
@@ -279,6 +292,19 @@ bool obs_display_enabled(obs_display_t *display)
 	return display ? display->enabled : false;
 }
 
+void obs_display_set_frame_rate_divisor(obs_display_t *display, uint32_t divisor)
+{
+	if (!display)
+		return;
+
+	os_atomic_set_long(&display->render_divisor, divisor ? (long)divisor : 1);
+}
+
+uint32_t obs_display_get_frame_rate_divisor(obs_display_t *display)
+{
+	return display ? (uint32_t)os_atomic_load_long(&display->render_divisor) : 0;
+}
+
 void obs_display_set_background_color(obs_display_t *display, uint32_t color)
 {
 	if (display)
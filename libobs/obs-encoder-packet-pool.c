@@ -0,0 +1,208 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/* Process-wide pool of encoder packet data.  Packet data is ref counted
+ * through a long stored right before it; pooled data additionally has a
+ * block header in front of that, and its ref count carries
+ * PACKET_POOLED_REF so obs_encoder_packet_release can tell it apart from
+ * the plain bmalloc'd packets the parsers and muxers create.
+ *
+ * Blocks come in power of two size classes.  Each class keeps as many idle
+ * blocks as it had in use at its peak since the last trim, so the pool
+ * follows whatever packet sizes the running encoders currently produce. */
+
+/* 64 keeps the data at bmalloc's alignment */
+#define BLOCK_HEADER_SIZE 64
+
+/* 4 KiB to 16 MiB, anything larger is not kept */
+#define MIN_CLASS_SHIFT 12
+#define NUM_CLASSES 13
+
+#define TRIM_INTERVAL 512
+
+struct packet_block {
+	struct packet_block *next;
+	size_t capacity;
+	int size_class;
+};
+
+struct size_class {
+	struct packet_block *idle;
+	size_t num_idle;
+	size_t in_use;
+	size_t peak;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct size_class classes[NUM_CLASSES];
+static uint32_t allocs_since_trim = 0;
+static size_t pool_idle_bytes = 0;
+static uint64_t pool_hits = 0;
+static uint64_t pool_misses = 0;
+
+static inline uint8_t *block_data(struct packet_block *block)
+{
+	return (uint8_t *)block + BLOCK_HEADER_SIZE;
+}
+
+static inline size_t class_capacity(int size_class)
+{
+	return (size_t)1 << (MIN_CLASS_SHIFT + size_class);
+}
+
+static inline int get_size_class(size_t size)
+{
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		if (size <= class_capacity(i))
+			return i;
+	}
+	return -1;
+}
+
+/* assumes pool_mutex */
+static void trim_pool(void)
+{
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		struct size_class *sc = &classes[i];
+		size_t keep = sc->peak - sc->in_use;
+
+		while (sc->num_idle > keep) {
+			struct packet_block *block = sc->idle;
+
+			sc->idle = block->next;
+			sc->num_idle--;
+			pool_idle_bytes -= block->capacity;
+			bfree(block);
+		}
+
+		sc->peak = sc->in_use;
+	}
+
+	allocs_since_trim = 0;
+}
+
+uint8_t *obs_encoder_packet_pool_alloc(size_t size)
+{
+	struct packet_block *block = NULL;
+	int size_class = get_size_class(size);
+
+	if (size_class != -1) {
+		struct size_class *sc = &classes[size_class];
+
+		pthread_mutex_lock(&pool_mutex);
+
+		if (sc->idle) {
+			block = sc->idle;
+			sc->idle = block->next;
+			sc->num_idle--;
+			pool_idle_bytes -= block->capacity;
+			pool_hits++;
+		} else {
+			pool_misses++;
+		}
+
+		if (++sc->in_use > sc->peak)
+			sc->peak = sc->in_use;
+		if (++allocs_since_trim == TRIM_INTERVAL)
+			trim_pool();
+
+		pthread_mutex_unlock(&pool_mutex);
+	}
+
+	if (!block) {
+		size_t capacity = size_class != -1 ? class_capacity(size_class) : size;
+
+		block = bmalloc(BLOCK_HEADER_SIZE + capacity);
+		block->capacity = capacity;
+		block->size_class = size_class;
+	}
+
+	block->next = NULL;
+	*((long *)block_data(block) - 1) = PACKET_POOLED_REF | 1;
+	return block_data(block);
+}
+
+void obs_encoder_packet_pool_release(uint8_t *data)
+{
+	struct packet_block *block = (struct packet_block *)(data - BLOCK_HEADER_SIZE);
+
+	if (block->size_class == -1) {
+		bfree(block);
+		return;
+	}
+
+	pthread_mutex_lock(&pool_mutex);
+
+	struct size_class *sc = &classes[block->size_class];
+	sc->in_use--;
+
+	block->next = sc->idle;
+	sc->idle = block;
+	sc->num_idle++;
+	pool_idle_bytes += block->capacity;
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+size_t obs_encoder_packet_pool_capacity(const uint8_t *data)
+{
+	const struct packet_block *block = (const struct packet_block *)(data - BLOCK_HEADER_SIZE);
+	return block->capacity;
+}
+
+void obs_encoder_packet_pool_free(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		struct size_class *sc = &classes[i];
+
+		while (sc->idle) {
+			struct packet_block *block = sc->idle;
+			sc->idle = block->next;
+			bfree(block);
+		}
+		sc->num_idle = 0;
+		sc->peak = sc->in_use;
+	}
+
+	pool_idle_bytes = 0;
+	pool_hits = 0;
+	pool_misses = 0;
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_get_encoder_packet_pool_stats(struct obs_encoder_packet_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_get_encoder_packet_pool_stats"))
+		return;
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&pool_mutex);
+	stats->hits = pool_hits;
+	stats->misses = pool_misses;
+	stats->idle_bytes = pool_idle_bytes;
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		stats->idle_blocks += classes[i].num_idle;
+		stats->blocks_in_use += classes[i].in_use;
+	}
+	pthread_mutex_unlock(&pool_mutex);
+}
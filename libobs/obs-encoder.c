@@ -24,7 +24,15 @@
 
 #define get_weak(encoder) ((obs_weak_encoder_t *)encoder->context.control)
 
+/* most frames handed to an OBS_ENCODER_CAP_AUDIO_BATCH encoder at once */
+#define MAX_AUDIO_ENCODE_BATCH 8
+
+/* how much the GOP cache keeps, a video GOP that runs longer is not cached */
+#define GOP_CACHE_MAX_USEC (10 * 1000000LL)
+#define GOP_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
 static void encoder_set_video(obs_encoder_t *encoder, video_t *video);
+static void free_gop_cache(struct obs_encoder *encoder);
 
 struct obs_encoder_info *find_encoder(const char *id)
 {
@@ -51,6 +59,9 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 	pthread_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
 	pthread_mutex_init_value(&encoder->roi_mutex);
+	pthread_mutex_init_value(&encoder->async_mutex);
+	pthread_mutex_init_value(&encoder->stats_mutex);
+	pthread_mutex_init_value(&encoder->lent_mutex);
 
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER, settings, name, NULL, hotkey_data, false))
 		return false;
@@ -64,6 +75,12 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 		return false;
 	if (pthread_mutex_init(&encoder->roi_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->async_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&encoder->stats_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&encoder->lent_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -140,6 +157,7 @@ obs_encoder_t *obs_audio_encoder_create(const char *id, const char *name, obs_da
 
 static void receive_video(void *param, struct video_data *frame);
 static void receive_audio(void *param, size_t mix_idx, struct audio_data *data);
+static void reset_stats(struct obs_encoder *encoder);
 
 static inline void get_audio_info(const struct obs_encoder *encoder, struct audio_convert_info *info)
 {
@@ -191,6 +209,44 @@ static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 	       (video->using_p010_tex || video->using_nv12_tex);
 }
 
+/* whether mix already produces the output an encoder wants, assumes
+ * mixes_mutex */
+static bool mix_matches(const struct obs_core_video_mix *mix, const struct obs_view *view,
+			enum obs_scale_type scale_type, const struct video_scale_info *target)
+{
+	const struct video_output_info *voi = video_output_get_info(mix->video);
+
+	if (mix->view != view)
+		return false;
+
+	/* the scale type only matters if the canvas actually gets scaled */
+	if (mix->ovi.scale_type != scale_type &&
+	    (target->width != mix->ovi.base_width || target->height != mix->ovi.base_height))
+		return false;
+
+	if (voi->width != target->width || voi->height != target->height)
+		return false;
+
+	return voi->format == target->format && voi->colorspace == target->colorspace && voi->range == target->range;
+}
+
+/* shares a matching mix with the encoder, assumes mixes_mutex */
+static bool use_matching_mix(struct obs_encoder *encoder, const struct obs_view *view,
+			     const struct video_scale_info *target)
+{
+	for (size_t i = 0; i < obs->video.mixes.num; i++) {
+		struct obs_core_video_mix *current = obs->video.mixes.array[i];
+
+		if (mix_matches(current, view, encoder->gpu_scale_type, target)) {
+			current->encoder_refs += 1;
+			obs_encoder_set_video(encoder, current->video);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /**
  * GPU based rescaling is currently implemented via core video mixes,
  * i.e. a core mix with matching width/height/format/colorspace/range
@@ -200,14 +256,10 @@ static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 {
 	struct obs_core_video_mix *mix, *current_mix;
-	bool create_mix = true;
+	struct video_scale_info target = {0};
 	struct obs_video_info ovi;
 	const struct video_output_info *info;
-	uint32_t width;
-	uint32_t height;
-	enum video_format format;
-	enum video_colorspace space;
-	enum video_range_type range;
+	bool found;
 
 	if (!encoder->media)
 		return;
@@ -218,51 +270,34 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 		return;
 
 	info = video_output_get_info(encoder->media);
-	width = encoder->scaled_width ? encoder->scaled_width : info->width;
-	height = encoder->scaled_height ? encoder->scaled_height : info->height;
-	format = encoder->preferred_format != VIDEO_FORMAT_NONE ? encoder->preferred_format : info->format;
-	space = encoder->preferred_space != VIDEO_CS_DEFAULT ? encoder->preferred_space : info->colorspace;
-	range = encoder->preferred_range != VIDEO_RANGE_DEFAULT ? encoder->preferred_range : info->range;
+	target.width = encoder->scaled_width ? encoder->scaled_width : info->width;
+	target.height = encoder->scaled_height ? encoder->scaled_height : info->height;
+	target.format = encoder->preferred_format != VIDEO_FORMAT_NONE ? encoder->preferred_format : info->format;
+	target.colorspace = encoder->preferred_space != VIDEO_CS_DEFAULT ? encoder->preferred_space
+									  : info->colorspace;
+	target.range = encoder->preferred_range != VIDEO_RANGE_DEFAULT ? encoder->preferred_range : info->range;
 
 	current_mix = get_mix_for_video(encoder->media);
 	if (!current_mix)
 		return;
 
+	/* encoders wanting the same output share one rescale and
+	 * conversion pass */
 	pthread_mutex_lock(&obs->video.mixes_mutex);
-	for (size_t i = 0; i < obs->video.mixes.num; i++) {
-		struct obs_core_video_mix *current = obs->video.mixes.array[i];
-		const struct video_output_info *voi = video_output_get_info(current->video);
-		if (current_mix->view != current->view)
-			continue;
-
-		if (current->ovi.scale_type != encoder->gpu_scale_type)
-			continue;
-
-		if (voi->width != width || voi->height != height)
-			continue;
-
-		if (voi->format != format || voi->colorspace != space || voi->range != range)
-			continue;
-
-		current->encoder_refs += 1;
-		obs_encoder_set_video(encoder, current->video);
-		create_mix = false;
-		break;
-	}
-
+	found = use_matching_mix(encoder, current_mix->view, &target);
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
-	if (!create_mix)
+	if (found)
 		return;
 
 	ovi = current_mix->ovi;
 
-	ovi.output_format = format;
-	ovi.colorspace = space;
-	ovi.range = range;
+	ovi.output_format = target.format;
+	ovi.colorspace = target.colorspace;
+	ovi.range = target.range;
 
-	ovi.output_height = height;
-	ovi.output_width = width;
+	ovi.output_height = target.height;
+	ovi.output_width = target.width;
 	ovi.scale_type = encoder->gpu_scale_type;
 
 	ovi.gpu_conversion = true;
@@ -278,27 +313,7 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 	pthread_mutex_lock(&obs->video.mixes_mutex);
 
 	// double check that nobody else added a matching mix while we've created our mix
-	for (size_t i = 0; i < obs->video.mixes.num; i++) {
-		struct obs_core_video_mix *current = obs->video.mixes.array[i];
-		const struct video_output_info *voi = video_output_get_info(current->video);
-		if (current->view != current_mix->view)
-			continue;
-
-		if (current->ovi.scale_type != encoder->gpu_scale_type)
-			continue;
-
-		if (voi->width != width || voi->height != height)
-			continue;
-
-		if (voi->format != format || voi->colorspace != space || voi->range != range)
-			continue;
-
-		obs_encoder_set_video(encoder, current->video);
-		create_mix = false;
-		break;
-	}
-
-	if (!create_mix) {
+	if (use_matching_mix(encoder, current_mix->view, &target)) {
 		obs_free_video_mix(mix);
 	} else {
 		da_push_back(obs->video.mixes, &mix);
@@ -321,6 +336,11 @@ static void add_connection(struct obs_encoder *encoder)
 
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
+		} else if (encoder->encoder_group) {
+			/* renditions of a group encode the same frames, run
+			 * them side by side rather than one after the other */
+			start_raw_video_parallel(encoder->media, &info, encoder->frame_rate_divisor, receive_video,
+						 encoder);
 		} else {
 			start_raw_video(encoder->media, &info, encoder->frame_rate_divisor, receive_video, encoder);
 		}
@@ -401,13 +421,21 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
+		free_gop_cache(encoder);
+		deque_free(&encoder->gop_cache);
 		da_free(encoder->roi);
 		da_free(encoder->encoder_packet_times);
+		for (size_t i = 0; i < encoder->lent_packets.num; i++)
+			obs_encoder_packet_pool_release(encoder->lent_packets.array[i]);
+		da_free(encoder->lent_packets);
 		pthread_mutex_destroy(&encoder->init_mutex);
 		pthread_mutex_destroy(&encoder->callbacks_mutex);
 		pthread_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
 		pthread_mutex_destroy(&encoder->roi_mutex);
+		pthread_mutex_destroy(&encoder->async_mutex);
+		pthread_mutex_destroy(&encoder->stats_mutex);
+		pthread_mutex_destroy(&encoder->lent_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -546,12 +574,19 @@ obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder)
 	return encoder->context.settings;
 }
 
+static inline size_t audio_encode_batch_max(const struct obs_encoder *encoder)
+{
+	return (encoder->info.caps & OBS_ENCODER_CAP_AUDIO_BATCH) != 0 ? MAX_AUDIO_ENCODE_BATCH : 1;
+}
+
 static inline void reset_audio_buffers(struct obs_encoder *encoder)
 {
+	size_t size = encoder->framesize_bytes * audio_encode_batch_max(encoder);
+
 	free_audio_buffers(encoder);
 
 	for (size_t i = 0; i < encoder->planes; i++)
-		encoder->audio_output_buffer[i] = bmalloc(encoder->framesize_bytes);
+		encoder->audio_output_buffer[i] = bmalloc(size);
 }
 
 static void intitialize_audio_encoder(struct obs_encoder *encoder)
@@ -673,6 +708,8 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 		encoder->offset_usec = 0;
 		encoder->start_ts = 0;
 		encoder->frame_rate_divisor_counter = 0;
+		encoder->async_frames = 0;
+		encoder->async_failed = false;
 		maybe_clear_encoder_core_video_mix(encoder);
 
 		for (size_t i = 0; i < encoder->paired_encoders.num; i++) {
@@ -706,9 +743,10 @@ void pause_reset(struct pause_data *pause)
 	pthread_mutex_unlock(&pause->mutex);
 }
 
-static inline void obs_encoder_start_internal(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param)
+static inline void obs_encoder_start_internal(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param,
+					      bool held)
 {
-	struct encoder_callback cb = {false, new_packet, param};
+	struct encoder_callback cb = {false, new_packet, param, held};
 	bool first = false;
 
 	if (!encoder->context.data || !encoder->media)
@@ -729,6 +767,7 @@ static inline void obs_encoder_start_internal(obs_encoder_t *encoder, encoded_ca
 		pause_reset(&encoder->pause);
 
 		encoder->cur_pts = 0;
+		reset_stats(encoder);
 		add_connection(encoder);
 	}
 }
@@ -741,7 +780,19 @@ void obs_encoder_start(obs_encoder_t *encoder, encoded_callback_t new_packet, vo
 		return;
 
 	pthread_mutex_lock(&encoder->init_mutex);
-	obs_encoder_start_internal(encoder, new_packet, param);
+	obs_encoder_start_internal(encoder, new_packet, param, false);
+	pthread_mutex_unlock(&encoder->init_mutex);
+}
+
+void obs_encoder_start_held(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_start_held"))
+		return;
+	if (!obs_ptr_valid(new_packet, "obs_encoder_start_held"))
+		return;
+
+	pthread_mutex_lock(&encoder->init_mutex);
+	obs_encoder_start_internal(encoder, new_packet, param, true);
 	pthread_mutex_unlock(&encoder->init_mutex);
 }
 
@@ -764,6 +815,9 @@ void obs_encoder_stop(obs_encoder_t *encoder, encoded_callback_t new_packet, voi
 		last = (encoder->callbacks.num == 0);
 	}
 
+	if (last)
+		free_gop_cache(encoder);
+
 	pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 	encoder->encoder_packet_times.num = 0;
@@ -944,6 +998,39 @@ bool obs_encoder_set_frame_rate_divisor(obs_encoder_t *encoder, uint32_t frame_r
 	return true;
 }
 
+bool obs_encoder_set_max_latency(obs_encoder_t *encoder, uint32_t latency_ms)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_max_latency"))
+		return false;
+
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_encoder_set_max_latency: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set max latency "
+		     "while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	if (encoder->initialized) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set max latency "
+		     "after the encoder has been initialized",
+		     obs_encoder_get_name(encoder));
+		return false;
+	}
+
+	encoder->max_latency_ms = latency_ms;
+	return true;
+}
+
 bool obs_encoder_scaling_enabled(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_scaling_enabled"))
@@ -1032,6 +1119,28 @@ uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder)
 	return encoder->frame_rate_divisor;
 }
 
+uint32_t obs_encoder_get_max_latency(const obs_encoder_t *encoder)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_max_latency"))
+		return 0;
+
+	return encoder->info.type == OBS_ENCODER_VIDEO ? encoder->max_latency_ms : 0;
+}
+
+uint32_t obs_encoder_get_max_latency_frames(const obs_encoder_t *encoder)
+{
+	const struct video_output_info *voi;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_max_latency_frames"))
+		return 0;
+	if (encoder->info.type != OBS_ENCODER_VIDEO || !encoder->max_latency_ms || !encoder->media)
+		return 0;
+
+	voi = video_output_get_info(encoder->media);
+	return (uint32_t)util_mul_div64(encoder->max_latency_ms, voi->fps_num,
+					1000ULL * voi->fps_den * encoder->frame_rate_divisor);
+}
+
 uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_get_sample_rate"))
@@ -1256,10 +1365,124 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 	da_free(data);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Statistics                                                                */
+
+static inline void stats_begin(struct obs_encoder *encoder)
+{
+	pthread_mutex_lock(&encoder->stats_mutex);
+	os_atomic_inc_long(&encoder->stats_seq);
+}
+
+static inline void stats_end(struct obs_encoder *encoder)
+{
+	os_atomic_inc_long(&encoder->stats_seq);
+	pthread_mutex_unlock(&encoder->stats_mutex);
+}
+
+static inline uint32_t ns_to_us32(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+void encoder_stats_add_call(struct obs_encoder *encoder, uint64_t duration_ns, uint32_t frames)
+{
+	struct obs_encoder_stats *stats = &encoder->stats;
+	const uint32_t us = ns_to_us32(duration_ns);
+
+	stats_begin(encoder);
+	stats->encode_calls++;
+	stats->frames_submitted += frames;
+	stats->encode_us_total += us;
+	stats->encode_us_last = us;
+	if (us > stats->encode_us_max)
+		stats->encode_us_max = us;
+	stats_end(encoder);
+}
+
+static void stats_add_packet(struct obs_encoder *encoder, const struct encoder_packet *pkt,
+			     const struct encoder_packet_time *ept)
+{
+	struct obs_encoder_stats *stats = &encoder->stats;
+	const uint64_t now = os_gettime_ns();
+
+	stats_begin(encoder);
+
+	stats->packets++;
+	stats->bytes += pkt->size;
+
+	if (!encoder->stats_window_start)
+		encoder->stats_window_start = now;
+	encoder->stats_window_bytes += pkt->size;
+
+	const uint64_t window = now - encoder->stats_window_start;
+	if (window >= 1000000000ULL) {
+		stats->bitrate_kbps = (uint32_t)util_mul_div64(encoder->stats_window_bytes * 8, 1000000ULL, window);
+		encoder->stats_window_start = now;
+		encoder->stats_window_bytes = 0;
+	}
+
+	if (ept && ept->fer && now >= ept->fer) {
+		const uint32_t us = ns_to_us32(now - ept->fer);
+		size_t bucket = 0;
+
+		while (bucket < OBS_ENCODER_LATENCY_BUCKETS - 1 && us >= (1000U << bucket))
+			bucket++;
+
+		stats->latency_samples++;
+		stats->latency_us_total += us;
+		stats->latency_us_last = us;
+		if (us > stats->latency_us_max)
+			stats->latency_us_max = us;
+		stats->latency_histogram[bucket]++;
+	}
+
+	stats_end(encoder);
+}
+
+static void reset_stats(struct obs_encoder *encoder)
+{
+	stats_begin(encoder);
+	memset(&encoder->stats, 0, sizeof(encoder->stats));
+	encoder->stats_window_start = 0;
+	encoder->stats_window_bytes = 0;
+	stats_end(encoder);
+}
+
+bool obs_encoder_get_stats(const obs_encoder_t *encoder, struct obs_encoder_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_stats") || !obs_ptr_valid(stats, "obs_encoder_get_stats"))
+		return false;
+
+	for (;;) {
+		long seq = os_atomic_load_long(&encoder->stats_seq);
+		if (seq & 1)
+			continue;
+
+		*stats = encoder->stats;
+
+		if (os_atomic_load_long(&encoder->stats_seq) == seq)
+			break;
+	}
+
+	if (encoder->info.type == OBS_ENCODER_VIDEO) {
+		if (stats->frames_submitted > stats->packets)
+			stats->frames_in_flight = (uint32_t)(stats->frames_submitted - stats->packets);
+		if (encoder->media && !gpu_encode_available(encoder))
+			stats->lagged_frames = video_output_get_skipped_frames(encoder->media);
+	}
+
+	return true;
+}
+
 static const char *send_packet_name = "send_packet";
 static inline void send_packet(struct obs_encoder *encoder, struct encoder_callback *cb, struct encoder_packet *packet,
 			       struct encoder_packet_time *packet_time)
 {
+	if (cb->held)
+		return;
+
 	profile_start(send_packet_name);
 	/* include SEI in first video packet */
 	if (encoder->info.type == OBS_ENCODER_VIDEO && !cb->sent_first_packet)
@@ -1285,12 +1508,100 @@ void full_stop(struct obs_encoder *encoder)
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 		da_free(encoder->callbacks);
+		free_gop_cache(encoder);
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 		remove_connection(encoder, false);
 	}
 }
 
+/* data of the packet currently being sent off, if it came from
+ * obs_encoder_packet_alloc; outputs receive packets on the sending thread */
+static THREAD_LOCAL uint8_t *lent_packet_data = NULL;
+
+/* takes over the reference obs_encoder_packet_alloc gave the encoder */
+static bool take_lent_packet(struct obs_encoder *encoder, uint8_t *data)
+{
+	bool found = false;
+
+	if (!data)
+		return false;
+
+	pthread_mutex_lock(&encoder->lent_mutex);
+	for (size_t i = 0; i < encoder->lent_packets.num; i++) {
+		if (encoder->lent_packets.array[i] == data) {
+			da_erase(encoder->lent_packets, i);
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&encoder->lent_mutex);
+
+	return found;
+}
+
+static inline void release_packet_data(uint8_t *data)
+{
+	long *p_refs = ((long *)data) - 1;
+	long refs = os_atomic_dec_long(p_refs);
+
+	if (refs == 0)
+		bfree(p_refs);
+	else if (refs == PACKET_POOLED_REF)
+		obs_encoder_packet_pool_release(data);
+}
+
+/* assumes callbacks_mutex */
+static void free_gop_cache(struct obs_encoder *encoder)
+{
+	struct encoder_packet packet;
+
+	while (encoder->gop_cache.size) {
+		deque_pop_front(&encoder->gop_cache, &packet, sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	encoder->gop_cache_bytes = 0;
+}
+
+static inline struct encoder_packet *first_cached_packet(struct obs_encoder *encoder)
+{
+	return deque_data(&encoder->gop_cache, 0);
+}
+
+/* assumes callbacks_mutex, and that lent_packet_data is set for pkt */
+static void add_to_gop_cache(struct obs_encoder *encoder, struct encoder_packet *pkt)
+{
+	struct encoder_packet packet;
+
+	if (encoder->info.type == OBS_ENCODER_VIDEO) {
+		if (pkt->keyframe)
+			free_gop_cache(encoder);
+		else if (!encoder->gop_cache.size)
+			return;
+
+	} else {
+		struct encoder_packet *first;
+
+		while ((first = first_cached_packet(encoder)) != NULL &&
+		       pkt->dts_usec - first->dts_usec > GOP_CACHE_MAX_USEC) {
+			deque_pop_front(&encoder->gop_cache, &packet, sizeof(packet));
+			encoder->gop_cache_bytes -= packet.size;
+			obs_encoder_packet_release(&packet);
+		}
+	}
+
+	obs_encoder_packet_create_instance(&packet, pkt);
+	deque_push_back(&encoder->gop_cache, &packet, sizeof(packet));
+	encoder->gop_cache_bytes += packet.size;
+
+	/* the GOP is too long to be worth keeping, wait for the next one */
+	if (encoder->info.type == OBS_ENCODER_VIDEO &&
+	    (encoder->gop_cache_bytes > GOP_CACHE_MAX_BYTES ||
+	     pkt->dts_usec - first_cached_packet(encoder)->dts_usec > GOP_CACHE_MAX_USEC))
+		free_gop_cache(encoder);
+}
+
 void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received, struct encoder_packet *pkt)
 {
 	if (!success) {
@@ -1336,8 +1647,16 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 				     pkt->pts);
 		}
 
+		stats_add_packet(encoder, pkt, found_ept ? &ept_local : NULL);
+
+		uint8_t *lent = take_lent_packet(encoder, pkt->data) ? pkt->data : NULL;
+		lent_packet_data = lent;
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
+		if (encoder->gop_cache_enabled)
+			add_to_gop_cache(encoder, pkt);
+
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
@@ -1346,12 +1665,48 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
+		if (lent) {
+			lent_packet_data = NULL;
+			release_packet_data(lent);
+		}
+
 		// Count number of video frames successfully encoded
 		if (pkt->type == OBS_ENCODER_VIDEO)
 			encoder->encoded_frames++;
 	}
 }
 
+void obs_encoder_replay_gop_cache(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param)
+{
+	size_t idx;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_replay_gop_cache"))
+		return;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+
+	idx = get_callback_idx(encoder, new_packet, param);
+	if (idx != DARRAY_INVALID) {
+		struct encoder_callback *cb = encoder->callbacks.array + idx;
+		size_t count = encoder->gop_cache.size / sizeof(struct encoder_packet);
+
+		cb->held = false;
+
+		for (size_t i = 0; i < count; i++) {
+			struct encoder_packet packet =
+				*(struct encoder_packet *)deque_data(&encoder->gop_cache, i * sizeof(packet));
+
+			/* outputs take a reference instead of copying */
+			lent_packet_data = packet.data;
+			send_packet(encoder, cb, &packet, NULL);
+		}
+
+		lent_packet_data = NULL;
+	}
+
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+}
+
 static const char *do_encode_name = "do_encode";
 bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts)
 {
@@ -1383,6 +1738,8 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 	success = encoder->info.encode(encoder->context.data, frame, &pkt, &received);
 	profile_end(encoder->profile_encoder_encode_name);
 
+	encoder_stats_add_call(encoder, os_gettime_ns() - fer_ts, 1);
+
 	/* Generate and enqueue the frame timing metrics, namely
 	 * the CTS (composition time), FER (frame encode request), FERC
 	 * (frame encode request complete) and current PTS. PTS is used to
@@ -1407,6 +1764,137 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const u
 	return success;
 }
 
+/* like do_encode, but one encoder call for several audio frames */
+static bool do_encode_audio_batch(struct obs_encoder *encoder, struct encoder_frame *frame)
+{
+	profile_start(do_encode_name);
+	if (!encoder->profile_encoder_encode_name)
+		encoder->profile_encoder_encode_name =
+			profile_store_name(obs_get_profiler_name_store(), "encode(%s)", encoder->context.name);
+
+	struct encoder_packet pkts[MAX_AUDIO_ENCODE_BATCH * 2] = {0};
+	size_t num_packets = sizeof(pkts) / sizeof(pkts[0]);
+	bool success;
+
+	if (encoder->reconfigure_requested) {
+		encoder->reconfigure_requested = false;
+		encoder->info.update(encoder->context.data, encoder->context.settings);
+	}
+
+	for (size_t i = 0; i < num_packets; i++) {
+		pkts[i].timebase_num = encoder->timebase_num * encoder->frame_rate_divisor;
+		pkts[i].timebase_den = encoder->timebase_den;
+		pkts[i].encoder = encoder;
+	}
+
+	const uint64_t start = os_gettime_ns();
+
+	profile_start(encoder->profile_encoder_encode_name);
+	success = encoder->info.encode_audio_batch(encoder->context.data, frame, pkts, &num_packets);
+	profile_end(encoder->profile_encoder_encode_name);
+
+	encoder_stats_add_call(encoder, os_gettime_ns() - start, frame->frames / (uint32_t)encoder->framesize);
+
+	if (!success)
+		send_off_encoder_packet(encoder, false, false, &pkts[0]);
+	for (size_t i = 0; success && i < num_packets; i++)
+		send_off_encoder_packet(encoder, true, true, &pkts[i]);
+
+	profile_end(do_encode_name);
+
+	return success;
+}
+
+static inline bool encoder_async(const struct obs_encoder *encoder)
+{
+	return (encoder->info.caps & OBS_ENCODER_CAP_ASYNC) != 0;
+}
+
+/* like do_encode, but only queues the frame.  its packet is sent off from
+ * obs_encoder_complete_frame on the encoder's thread */
+static bool do_submit(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts)
+{
+	profile_start(do_encode_name);
+	if (!encoder->profile_encoder_encode_name)
+		encoder->profile_encoder_encode_name =
+			profile_store_name(obs_get_profiler_name_store(), "encode(%s)", encoder->context.name);
+
+	bool success;
+
+	if (encoder->reconfigure_requested) {
+		encoder->reconfigure_requested = false;
+		encoder->info.update(encoder->context.data, encoder->context.settings);
+	}
+
+	/* the timing entry has to exist before the frame can complete */
+	if (frame_cts) {
+		pthread_mutex_lock(&encoder->async_mutex);
+		struct encoder_packet_time *ept = da_push_back_new(encoder->encoder_packet_times);
+		ept->pts = frame->pts;
+		ept->cts = *frame_cts;
+		ept->fer = os_gettime_ns();
+		pthread_mutex_unlock(&encoder->async_mutex);
+	}
+
+	os_atomic_inc_long(&encoder->async_frames);
+
+	const uint64_t start = os_gettime_ns();
+
+	profile_start(encoder->profile_encoder_encode_name);
+	success = encoder->info.submit_frame(encoder->context.data, frame);
+	profile_end(encoder->profile_encoder_encode_name);
+
+	encoder_stats_add_call(encoder, os_gettime_ns() - start, 1);
+
+	if (frame_cts) {
+		uint64_t ferc = success ? os_gettime_ns() : 0;
+
+		pthread_mutex_lock(&encoder->async_mutex);
+		for (size_t i = encoder->encoder_packet_times.num; i > 0; i--) {
+			struct encoder_packet_time *ept = &encoder->encoder_packet_times.array[i - 1];
+			if (ept->pts == frame->pts) {
+				ept->ferc = ferc;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&encoder->async_mutex);
+	}
+
+	if (!success) {
+		os_atomic_dec_long(&encoder->async_frames);
+		send_off_encoder_packet(encoder, false, false, NULL);
+	}
+
+	profile_end(do_encode_name);
+
+	return success;
+}
+
+void obs_encoder_complete_frame(obs_encoder_t *encoder, bool success, struct encoder_packet *packet)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_complete_frame"))
+		return;
+
+	os_atomic_dec_long(&encoder->async_frames);
+
+	/* stopping has to happen on the video thread, which would otherwise
+	 * deadlock with us while it waits in submit_frame */
+	if (!success) {
+		os_atomic_set_bool(&encoder->async_failed, true);
+		return;
+	}
+	if (!packet)
+		return;
+
+	packet->timebase_num = encoder->timebase_num * encoder->frame_rate_divisor;
+	packet->timebase_den = encoder->timebase_den;
+	packet->encoder = encoder;
+
+	pthread_mutex_lock(&encoder->async_mutex);
+	send_off_encoder_packet(encoder, true, true, packet);
+	pthread_mutex_unlock(&encoder->async_mutex);
+}
+
 static inline bool video_pause_check_internal(struct pause_data *pause, uint64_t ts)
 {
 	pause->last_video_ts = ts;
@@ -1441,9 +1929,15 @@ static void receive_video(void *param, struct video_data *frame)
 {
 	profile_start(receive_video_name);
 
+	struct bmem_counter *prev_counter = obs_set_alloc_counter(OBS_ALLOC_ENCODERS);
 	struct obs_encoder *encoder = param;
 	struct encoder_frame enc_frame;
 
+	if (os_atomic_load_bool(&encoder->async_failed)) {
+		send_off_encoder_packet(encoder, false, false, NULL);
+		goto wait_for_audio;
+	}
+
 	if (encoder->encoder_group && !encoder->start_ts) {
 		struct obs_encoder_group *group = encoder->encoder_group;
 		bool ready = false;
@@ -1485,10 +1979,12 @@ static void receive_video(void *param, struct video_data *frame)
 	enc_frame.frames = 1;
 	enc_frame.pts = encoder->cur_pts;
 
-	if (do_encode(encoder, &enc_frame, &frame->timestamp))
+	if (encoder_async(encoder) ? do_submit(encoder, &enc_frame, &frame->timestamp)
+				   : do_encode(encoder, &enc_frame, &frame->timestamp))
 		encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
 
 wait_for_audio:
+	bmem_set_thread_counter(prev_counter);
 	profile_end(receive_video_name);
 }
 
@@ -1599,24 +2095,35 @@ fail:
 static bool send_audio_data(struct obs_encoder *encoder)
 {
 	struct encoder_frame enc_frame;
+	size_t count = encoder->audio_input_buffer[0].size / encoder->framesize_bytes;
+	size_t max_count = audio_encode_batch_max(encoder);
+	bool success;
+
+	if (count > max_count)
+		count = max_count;
+
+	size_t bytes = encoder->framesize_bytes * count;
 
 	memset(&enc_frame, 0, sizeof(struct encoder_frame));
 
 	for (size_t i = 0; i < encoder->planes; i++) {
-		deque_pop_front(&encoder->audio_input_buffer[i], encoder->audio_output_buffer[i],
-				encoder->framesize_bytes);
+		deque_pop_front(&encoder->audio_input_buffer[i], encoder->audio_output_buffer[i], bytes);
 
 		enc_frame.data[i] = encoder->audio_output_buffer[i];
-		enc_frame.linesize[i] = (uint32_t)encoder->framesize_bytes;
+		enc_frame.linesize[i] = (uint32_t)bytes;
 	}
 
-	enc_frame.frames = (uint32_t)encoder->framesize;
+	enc_frame.frames = (uint32_t)(encoder->framesize * count);
 	enc_frame.pts = encoder->cur_pts;
 
-	if (!do_encode(encoder, &enc_frame, NULL))
+	if (max_count > 1)
+		success = do_encode_audio_batch(encoder, &enc_frame);
+	else
+		success = do_encode(encoder, &enc_frame, NULL);
+	if (!success)
 		return false;
 
-	encoder->cur_pts += encoder->framesize;
+	encoder->cur_pts += encoder->framesize * count;
 	return true;
 }
 
@@ -1690,6 +2197,7 @@ static void receive_audio(void *param, size_t mix_idx, struct audio_data *in)
 {
 	profile_start(receive_audio_name);
 
+	struct bmem_counter *prev_counter = obs_set_alloc_counter(OBS_ALLOC_ENCODERS);
 	struct obs_encoder *encoder = param;
 	struct audio_data audio = *in;
 
@@ -1714,6 +2222,7 @@ static void receive_audio(void *param, size_t mix_idx, struct audio_data *in)
 	UNUSED_PARAMETER(mix_idx);
 
 end:
+	bmem_set_thread_counter(prev_counter);
 	profile_end(receive_audio_name);
 }
 
@@ -1739,12 +2248,14 @@ void obs_encoder_remove_output(struct obs_encoder *encoder, struct obs_output *o
 
 void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
 {
-	long *p_refs;
-
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+
+	if (src->data && src->data == lent_packet_data) {
+		os_atomic_inc_long(((long *)src->data) - 1);
+		return;
+	}
+
+	dst->data = obs_encoder_packet_pool_alloc(src->size);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1766,15 +2277,45 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 	if (!pkt)
 		return;
 
-	if (pkt->data) {
-		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
-	}
+	if (pkt->data)
+		release_packet_data(pkt->data);
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
 }
 
+uint8_t *obs_encoder_packet_alloc(obs_encoder_t *encoder, size_t size)
+{
+	uint8_t *data;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_packet_alloc"))
+		return NULL;
+
+	data = obs_encoder_packet_pool_alloc(size);
+
+	pthread_mutex_lock(&encoder->lent_mutex);
+	da_push_back(encoder->lent_packets, &data);
+	pthread_mutex_unlock(&encoder->lent_mutex);
+
+	return data;
+}
+
+void obs_encoder_set_gop_cache(obs_encoder_t *encoder, bool enable)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_gop_cache"))
+		return;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	encoder->gop_cache_enabled = enable;
+	if (!enable)
+		free_gop_cache(encoder);
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+}
+
+bool obs_encoder_gop_cache_enabled(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_gop_cache_enabled") ? encoder->gop_cache_enabled : false;
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder, enum video_format format)
 {
 	if (!encoder || encoder->info.type != OBS_ENCODER_VIDEO)
@@ -2072,6 +2613,11 @@ bool obs_encoder_set_group(obs_encoder_t *encoder, obs_encoder_group_t *group)
 	return true;
 }
 
+obs_encoder_group_t *obs_encoder_get_group(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_group") ? encoder->encoder_group : NULL;
+}
+
 obs_encoder_group_t *obs_encoder_group_create()
 {
 	struct obs_encoder_group *group = bzalloc(sizeof(struct obs_encoder_group));
@@ -38,6 +38,8 @@ typedef struct obs_encoder obs_encoder_t;
 #define OBS_ENCODER_CAP_INTERNAL (1 << 3)
 #define OBS_ENCODER_CAP_ROI (1 << 4)
 #define OBS_ENCODER_CAP_SCALING (1 << 5)
+#define OBS_ENCODER_CAP_AUDIO_BATCH (1 << 6)
+#define OBS_ENCODER_CAP_ASYNC (1 << 7)
 
 /** Specifies the encoder type */
 enum obs_encoder_type {
@@ -344,10 +346,53 @@ struct obs_encoder_info {
 
 	bool (*encode_texture2)(void *data, struct encoder_texture *texture, int64_t pts, uint64_t lock_key,
 				uint64_t *next_key, struct encoder_packet *packet, bool *received_packet);
+
+	/**
+	 * Audio encoder only, required with OBS_ENCODER_CAP_AUDIO_BATCH:
+	 * encodes several frames in one call.
+	 *
+	 * @param       data         Data associated with this encoder
+	 *                           context
+	 * @param[in]   frame        Raw audio, a whole number of frames of the
+	 *                           encoder's frame size
+	 * @param[out]  packets      Encoder packet output.  The packet data
+	 *                           must stay valid until the next call
+	 * @param[in,out] num_packets  Capacity of packets on input, number of
+	 *                           packets received on output
+	 * @return                   true if successful, false otherwise.
+	 */
+	bool (*encode_audio_batch)(void *data, struct encoder_frame *frame, struct encoder_packet *packets,
+				   size_t *num_packets);
+
+	/**
+	 * Raw video encoder only, required with OBS_ENCODER_CAP_ASYNC: queues
+	 * a frame for encoding and returns without waiting for its packet.
+	 * Every submitted frame must later be completed exactly once, in
+	 * submission order, with obs_encoder_complete_frame.  May block while
+	 * the encoder has no room for another frame.
+	 *
+	 * @param       data   Data associated with this encoder context
+	 * @param[in]   frame  Raw video frame, only valid during the call
+	 * @return             true if the frame was queued, false otherwise.
+	 */
+	bool (*submit_frame)(void *data, struct encoder_frame *frame);
 };
 
 EXPORT void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size);
 
+/**
+ * Completes the oldest frame queued with submit_frame.  Can be called from
+ * any thread, but not after the encoder's destroy callback has returned.
+ *
+ * @param  encoder  Encoder the frame was submitted to
+ * @param  success  false if encoding failed, which stops the encoder
+ * @param  packet   Packet that came out of the encoder for this frame, or
+ *                  NULL if none did yet.  It need not be the packet of this
+ *                  frame when the encoder reorders or looks ahead.  The
+ *                  timebase and encoder fields are filled in by libobs
+ */
+EXPORT void obs_encoder_complete_frame(obs_encoder_t *encoder, bool success, struct encoder_packet *packet);
+
 /**
  * Register an encoder definition to the current obs context.  This should be
  * used in obs_module_load.
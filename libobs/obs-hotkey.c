@@ -1152,19 +1152,34 @@ static inline void query_hotkeys()
 	enum_bindings(query_hotkey, &param);
 }
 
+void obs_hotkeys_input_event(void)
+{
+	if (obs && obs->hotkeys.input_event)
+		os_event_signal(obs->hotkeys.input_event);
+}
+
 #define NBSP "\xC2\xA0"
 
+#define HOTKEY_POLL_MS 25
+#define HOTKEY_FALLBACK_POLL_MS 250
+
 void *obs_hotkey_thread(void *arg)
 {
 	UNUSED_PARAMETER(arg);
 
 	os_set_thread_name("libobs: hotkey thread");
 
-	const char *hotkey_thread_name =
-		profile_store_name(obs_get_profiler_name_store(), "obs_hotkey_thread(%g" NBSP "ms)", 25.);
-	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
+	const char *hotkey_thread_name = profile_store_name(obs_get_profiler_name_store(),
+							    "obs_hotkey_thread(%g" NBSP "ms)", (double)HOTKEY_POLL_MS);
+	profile_register_root(hotkey_thread_name, (uint64_t)HOTKEY_POLL_MS * 1000000);
+
+	while (os_event_try(obs->hotkeys.stop_event) == EAGAIN) {
+		const bool input_events = os_atomic_load_bool(&obs->hotkeys.input_events);
+
+		os_event_timedwait(obs->hotkeys.input_event, input_events ? HOTKEY_FALLBACK_POLL_MS : HOTKEY_POLL_MS);
+		if (os_event_try(obs->hotkeys.stop_event) != EAGAIN)
+			break;
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
 		if (!lock())
 			continue;
 
@@ -20,6 +20,7 @@
 #include "util/c99defs.h"
 #include "util/darray.h"
 #include "util/deque.h"
+#include "util/spsc-ring.h"
 #include "util/dstr.h"
 #include "util/threading.h"
 #include "util/platform.h"
@@ -47,10 +48,12 @@
 #define HASH_ADD_UUID(head, uuid_field, add) HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
 #define NUM_TEXTURES 2
+#define MAX_READBACK_DEPTH 4
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define MAX_FUSED_FILTERS 8
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -108,6 +111,9 @@ struct obs_module {
 	void *module;
 	bool loaded;
 
+	/* time spent opening, loading and post-loading the module */
+	uint64_t load_time_ns;
+
 	bool (*load)(void);
 	void (*unload)(void);
 	void (*post_load)(void);
@@ -188,6 +194,11 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys);
 void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys);
 bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context, obs_key_t key);
 
+/* Called by platforms on key and mouse button input to query the hotkeys
+ * right away.  Platforms that do set obs_core_hotkeys.input_events so the
+ * key state is only polled as a fallback. */
+void obs_hotkeys_input_event(void);
+
 const char *obs_get_hotkey_translation(obs_key_t key, const char *def);
 
 struct obs_context_data;
@@ -213,10 +224,12 @@ void obs_hotkey_name_map_free(void);
 struct obs_view {
 	pthread_mutex_t channels_mutex;
 	obs_source_t *channels[MAX_CHANNELS];
+	volatile long channels_serial;
 };
 
 extern bool obs_view_init(struct obs_view *view);
 extern void obs_view_free(struct obs_view *view);
+extern bool obs_view_video_changed(struct obs_view *view, long *serial);
 
 /* ------------------------------------------------------------------------- */
 /* displays */
@@ -233,6 +246,10 @@ struct obs_display {
 	DARRAY(struct draw_callback) draw_callbacks;
 	bool use_clear_workaround;
 
+	/* only every render_divisor-th graphics frame is presented */
+	volatile long render_divisor;
+	uint32_t frames_skipped;
+
 	struct obs_display *next;
 	struct obs_display **prev_next;
 };
@@ -263,28 +280,79 @@ struct obs_task_info {
 	void *param;
 };
 
+struct obs_tick_job {
+	obs_source_t *source;
+	uint64_t tick_time;
+};
+
+/* An async frame being copied into the mapped textures of its source by an
+ * upload thread, between the video tick and the render of the source */
+struct obs_async_upload {
+	struct obs_source_frame *frame;
+	uint8_t *ptr[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	uint32_t height[MAX_AV_PLANES];
+	os_event_t *done;
+	bool pending;
+};
+
+struct obs_shared_texrender {
+	/* held so the address can't be reused by another source */
+	obs_weak_source_t *weak;
+	enum gs_color_space space;
+	gs_texrender_t *texrender;
+	uint64_t last_frame;
+};
+
+struct obs_readback_ref {
+	struct obs_core_video_mix *mix;
+	int slot;
+};
+
+struct obs_readback_job {
+	struct video_data frame;
+	int slot;
+	int count;
+};
+
 struct obs_core_video_mix {
 	struct obs_view *view;
 
-	gs_stagesurf_t *active_copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *active_copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	gs_texture_t *convert_textures_encode[NUM_CHANNELS];
 #ifdef _WIN32
-	gs_stagesurf_t *copy_surfaces_encode[NUM_TEXTURES];
+	gs_stagesurf_t *copy_surfaces_encode[MAX_READBACK_DEPTH];
 #endif
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
+
+	/* separable lanczos output scaling: the horizontally scaled
+	 * intermediate and the per column/row weights */
+	gs_texture_t *scale_texture;
+	gs_texture_t *scale_weights_x;
+	gs_texture_t *scale_weights_y;
+	bool separable_scale_failed;
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+
+	/* render_texture still holds a valid frame that can be reused if
+	 * nothing drawn into it changed */
+	bool main_texture_valid;
+	uint32_t main_texture_reused;
+	long last_channels_serial;
+	float last_sdr_white_level;
+	float last_hdr_nominal_peak_level;
+	bool textures_copied[MAX_READBACK_DEPTH];
 	bool texture_converted;
 	bool using_nv12_tex;
 	bool using_p010_tex;
 	struct deque vframe_info_buffer;
 	struct deque vframe_info_buffer_gpu;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	gs_stagesurf_t *mapped_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
 	int cur_texture;
+	int readback_depth;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
 	bool gpu_was_active;
@@ -299,6 +367,23 @@ struct obs_core_video_mix {
 	pthread_t gpu_encode_thread;
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
+	uint64_t gpu_encode_stalls;
+	uint64_t gpu_encode_copies;
+
+	/* slots still being read from, either by the pipelined readback
+	 * thread or by video outputs holding zero-copy frames */
+	pthread_mutex_t readback_mutex;
+	bool readback_busy[MAX_READBACK_DEPTH];
+	os_event_t *readback_done;
+	bool readback_zero_copy;
+	struct obs_readback_ref readback_refs[MAX_READBACK_DEPTH];
+
+	/* pipelined raw readback, only used if readback_depth > NUM_TEXTURES */
+	struct deque readback_queue;
+	os_sem_t *readback_semaphore;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
 
 	video_t *video;
 	struct obs_video_info ovi;
@@ -318,6 +403,10 @@ struct obs_core_video_mix {
 extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
 
+extern bool init_readback(struct obs_core_video_mix *video);
+extern void stop_readback_thread(struct obs_core_video_mix *video);
+extern void free_readback(struct obs_core_video_mix *video);
+
 struct obs_core_video {
 	graphics_t *graphics;
 	gs_effect_t *default_effect;
@@ -328,6 +417,7 @@ struct obs_core_video {
 	gs_effect_t *conversion_effect;
 	gs_effect_t *bicubic_effect;
 	gs_effect_t *lanczos_effect;
+	gs_effect_t *lanczos_separable_effect;
 	gs_effect_t *area_effect;
 	gs_effect_t *bilinear_lowres_effect;
 	gs_effect_t *premultiplied_alpha_effect;
@@ -338,6 +428,15 @@ struct obs_core_video {
 	uint64_t video_half_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
 	double video_fps;
+
+	/* render budget, see update_render_budget */
+	volatile bool render_budget;
+	volatile long render_degradation;
+	uint32_t budget_over_frames;
+	uint32_t budget_under_frames;
+
+	/* graphics memory budget, see enforce_gpu_memory_budget */
+	bool gpu_memory_over_budget;
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
@@ -357,6 +456,13 @@ struct obs_core_video {
 	float sdr_white_level;
 	float hdr_nominal_peak_level;
 
+	uint32_t readback_depth;
+	bool readback_zero_copy;
+	volatile bool precise_pacing;
+
+	/* incremented once per graphics frame, see obs_source_video_changed */
+	volatile long render_serial;
+
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
 
@@ -366,10 +472,39 @@ struct obs_core_video {
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
 	struct obs_core_video_mix *main_mix;
+
+	/* worker threads for OBS_SOURCE_TICK_THREADSAFE video ticks */
+	DARRAY(pthread_t) tick_threads;
+	os_sem_t *tick_semaphore;
+	os_event_t *tick_done;
+	volatile long tick_next;
+	volatile long tick_busy;
+	volatile bool tick_stop;
+	float tick_seconds;
+
+	/* worker threads copying async frames into mapped textures */
+	DARRAY(pthread_t) upload_threads;
+	pthread_mutex_t upload_mutex;
+	os_sem_t *upload_semaphore;
+	struct deque upload_queue;
+
+	/* nested scene textures shared by all mixes/displays within a frame */
+	DARRAY(struct obs_shared_texrender) shared_texrenders;
+	uint64_t shared_texrender_frame;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
 
+extern bool init_tick_threads(void);
+extern void free_tick_threads(void);
+
+extern bool init_upload_threads(void);
+extern void free_upload_threads(void);
+extern bool obs_queue_async_upload(struct obs_async_upload *upload);
+
+extern gs_texrender_t *obs_get_shared_texrender(obs_source_t *source, enum gs_color_space space);
+extern void obs_free_shared_texrenders(void);
+
 struct audio_monitor;
 
 struct obs_core_audio {
@@ -384,6 +519,28 @@ struct obs_core_audio {
 	int total_buffering_ticks;
 	int max_buffering_ticks;
 	bool fixed_buffer;
+	uint32_t frames_per_tick;
+
+	enum audio_resampler_engine resampler_engine;
+	enum audio_resampler_quality resampler_quality;
+
+	/* adaptive buffering: the smallest amount of audio any source had
+	 * queued past the current tick during the window */
+	bool adaptive_buffer;
+	bool catching_up;
+	uint64_t slack_window_start;
+	uint64_t min_slack;
+
+	/* worker threads rendering leaf sources of render_order in parallel */
+	DARRAY(pthread_t) render_threads;
+	DARRAY(struct obs_source *) render_jobs;
+	os_sem_t *render_semaphore;
+	os_event_t *render_done;
+	volatile long render_next;
+	volatile long render_busy;
+	volatile bool render_stop;
+	uint32_t render_mixers;
+	uint64_t render_start_ts;
 
 	pthread_mutex_t monitoring_mutex;
 	DARRAY(struct audio_monitor *) monitors;
@@ -415,6 +572,11 @@ struct obs_core_data {
 	pthread_mutex_t audio_sources_mutex;
 	pthread_mutex_t draw_callbacks_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
+
+	/* packets buffered by all outputs, and the limit for them */
+	pthread_mutex_t output_buffers_mutex;
+	uint64_t output_buffered_bytes;
+	uint64_t output_buffer_limit;
 	DARRAY(struct rendered_callback) rendered_callbacks;
 	DARRAY(struct tick_callback) tick_callbacks;
 
@@ -426,8 +588,16 @@ struct obs_core_data {
 
 	volatile bool valid;
 
+	/* inputs loaded from saved data aren't created until they're needed */
+	volatile bool lazy_source_creation;
+
+	/* set while obs_load_sources defers thread safe inputs to create
+	 * them in parallel */
+	volatile bool parallel_source_creation;
+
 	DARRAY(char *) protocols;
 	DARRAY(obs_source_t *) sources_to_tick;
+	DARRAY(struct obs_tick_job) tick_jobs;
 };
 
 /* user hotkeys */
@@ -441,6 +611,8 @@ struct obs_core_hotkeys {
 	pthread_t hotkey_thread;
 	bool hotkey_thread_initialized;
 	os_event_t *stop_event;
+	os_event_t *input_event;
+	volatile bool input_events;
 	bool thread_disable_press;
 	bool strict_modifiers;
 	bool reroute_hotkeys;
@@ -467,6 +639,15 @@ struct obs_core_hotkeys {
 
 typedef DARRAY(struct obs_source_info) obs_source_info_array_t;
 
+/* allocation counts of the core threads, logged on shutdown to find churn */
+enum obs_alloc_counter {
+	OBS_ALLOC_VIDEO,
+	OBS_ALLOC_AUDIO,
+	OBS_ALLOC_ENCODERS,
+	OBS_ALLOC_OUTPUTS,
+	OBS_ALLOC_COUNTER_COUNT,
+};
+
 struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
@@ -498,10 +679,17 @@ struct obs_core {
 	os_task_queue_t *destruction_task_thread;
 
 	obs_task_handler_t ui_task_handler;
+
+	struct bmem_counter alloc_counters[OBS_ALLOC_COUNTER_COUNT];
 };
 
 extern struct obs_core *obs;
 
+static inline struct bmem_counter *obs_set_alloc_counter(enum obs_alloc_counter counter)
+{
+	return bmem_set_thread_counter(&obs->alloc_counters[counter]);
+}
+
 struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
@@ -509,8 +697,12 @@ struct obs_graphics_context {
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
 	const char *video_thread_name;
+	os_hr_timer_t *pacing_timer;
+	uint64_t pacing_slack_ns;
 };
 
+extern void obs_apply_core_thread_affinity(void);
+
 extern void *obs_graphics_thread(void *param);
 extern bool obs_graphics_thread_loop(struct obs_graphics_context *context);
 #ifdef __APPLE__
@@ -518,15 +710,27 @@ extern void *obs_graphics_thread_autorelease(void *param);
 extern bool obs_graphics_thread_loop_autorelease(struct obs_graphics_context *context);
 #endif
 
+extern void frame_timing_frame_begin(void);
+extern void frame_timing_frame_end(void);
+extern void frame_timing_stage_begin(enum obs_frame_timing_stage stage);
+extern void frame_timing_stage_end(enum obs_frame_timing_stage stage);
+extern void frame_timing_free(void);
+extern bool gpu_profiler_active(void);
+
 extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
 extern bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
 			   struct audio_output_data *mixes);
+extern bool init_audio_render_threads(uint32_t num_threads);
+extern void free_audio_render_threads(void);
 
 extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 
 extern void start_raw_video(video_t *video, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
 			    void (*callback)(void *param, struct video_data *frame), void *param);
+extern void start_raw_video_parallel(video_t *video, const struct video_scale_info *conversion,
+				     uint32_t frame_rate_divisor,
+				     void (*callback)(void *param, struct video_data *frame), void *param);
 extern void stop_raw_video(video_t *video, void (*callback)(void *param, struct video_data *frame), void *param);
 
 /* ------------------------------------------------------------------------- */
@@ -639,8 +843,27 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* lent by the source, given back once no longer used */
+	bool lent;
+
+	/* the planes of frames lent with obs_source_lend_video_textures,
+	 * which have no data */
+	gs_texture_t *textures[MAX_AV_PLANES];
 };
 
+/* frames returned by the pool must only be given back with
+ * obs_source_frame_pool_release (or freed with obs_source_frame_destroy) */
+extern struct obs_source_frame *obs_source_frame_pool_acquire(enum video_format format, uint32_t width,
+							      uint32_t height);
+extern void obs_source_frame_pool_release(struct obs_source_frame *frame);
+
+/* wraps frame data lent by a source, which obs_source_frame_pool_release
+ * gives back through the release callback instead of keeping it */
+extern struct obs_source_frame *obs_source_frame_pool_wrap(const struct obs_source_frame *frame,
+							   obs_source_frame_release_t release, void *param);
+extern void obs_source_frame_pool_free(void);
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -702,9 +925,16 @@ struct obs_source {
 	/* indicates ownership of the info.id buffer */
 	bool owns_info_id;
 
+	/* GPU profiler scope name of filters and transitions, created the
+	 * first time they're timed */
+	const char *gpu_profile_name;
+
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* render serial of the last change to the source's video */
+	volatile long video_change_serial;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -725,6 +955,15 @@ struct obs_source {
 	bool active;
 	bool showing;
 
+	/* loaded without calling create, see obs_source_instantiate */
+	volatile bool deferred;
+
+	/* whether the source was drawn during the last few frames, updated
+	 * on tick from what was actually rendered */
+	volatile bool render_visible;
+	uint32_t render_skipped_frames;
+	bool rendered;
+
 	/* used to temporarily disable sources if needed */
 	bool enabled;
 
@@ -744,6 +983,7 @@ struct obs_source {
 	/* audio */
 	bool audio_failed;
 	bool audio_pending;
+	bool audio_silent; /* output buffers were zeroed for this tick */
 	bool pending_stop;
 	bool audio_active;
 	bool user_muted;
@@ -753,6 +993,14 @@ struct obs_source {
 	uint64_t audio_ts;
 	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
+	struct spsc_ring audio_input_queue; /* capture thread -> audio thread */
+	/* resets from other threads are applied by the capture thread, which
+	 * owns next_audio_sys_ts_min and the queue.  the values are protected
+	 * by audio_buf_mutex */
+	volatile bool audio_reset_pending;
+	uint64_t audio_reset_sys_ts;
+	bool audio_queue_resize;
+	DARRAY(float) audio_queue_buf;
 	DARRAY(struct audio_action) audio_actions;
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
@@ -777,6 +1025,13 @@ struct obs_source {
 	gs_texrender_t *async_texrender;
 	struct obs_source_frame *cur_async_frame;
 	bool async_gpu_conversion;
+
+	/* the planes of the last frame are drawn directly with a conversion
+	 * technique, async_texrender is only converted into when something
+	 * needs it.  async_direct_frame keeps the frame's color properties */
+	bool async_direct;
+	bool async_texrender_stale;
+	struct obs_source_frame async_direct_frame;
 	enum video_format async_format;
 	bool async_full_range;
 	uint8_t async_trc;
@@ -790,6 +1045,7 @@ struct obs_source {
 	bool async_linear_alpha;
 	bool async_active;
 	bool async_update_texture;
+	struct obs_async_upload async_upload;
 	bool async_unbuffered;
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
@@ -829,6 +1085,11 @@ struct obs_source {
 	bool rendering_filter;
 	bool filter_bypass_active;
 
+	/* fused pixel filters, set on the filter that starts the run */
+	gs_effect_t *fused_effect;
+	const char *fused_functions[MAX_FUSED_FILTERS];
+	size_t fused_num;
+
 	/* sources specific hotkeys */
 	obs_hotkey_pair_id mute_unmute_key;
 	obs_hotkey_id push_to_mute_key;
@@ -858,6 +1119,7 @@ struct obs_source {
 	bool transitioning_video;
 	bool transitioning_audio;
 	bool transition_source_active[2];
+	bool transition_source_hidden[2];
 	uint32_t transition_alignment;
 	uint32_t transition_actual_cx;
 	uint32_t transition_actual_cy;
@@ -898,12 +1160,14 @@ extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
+extern uint64_t audio_monitor_get_latency(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
 
 extern obs_source_t *obs_source_create_set_last_ver(const char *id, const char *name, const char *uuid,
 						    obs_data_t *settings, obs_data_t *hotkey_data,
 						    uint32_t last_obs_ver, bool is_private);
 extern void obs_source_destroy(struct obs_source *source);
+extern void obs_source_create_deferred(obs_source_t *source);
 extern void obs_source_addref(obs_source_t *source);
 
 enum view_type {
@@ -989,11 +1253,20 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source, bool centere
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+/* obs_source_video_tick split around the info.video_tick call, returns
+ * false if the source has no video_tick to call */
+extern bool obs_source_video_tick_prepare(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_finish(obs_source_t *source);
+extern bool obs_source_video_changed(obs_source_t *source);
+extern bool obs_scene_video_changed(obs_scene_t *scene);
+extern bool obs_transition_video_changed(obs_source_t *transition);
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
 				    size_t size);
+extern void obs_source_flush_audio_queue(obs_source_t *source);
+extern void obs_source_reset_audio_queue(obs_source_t *source);
 
 extern void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy);
 
@@ -1008,7 +1281,9 @@ extern void remove_async_frame(obs_source_t *source, struct obs_source_frame *fr
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source, uint64_t sys_time);
 extern void deinterlace_update_async_video(obs_source_t *source);
+extern void deinterlace_swap_async_textures(obs_source_t *source);
 extern void deinterlace_render(obs_source_t *s);
+extern void convert_stale_async_texrender(struct obs_source *source);
 
 /* ------------------------------------------------------------------------- */
 /* outputs  */
@@ -1025,6 +1300,20 @@ struct delay_data {
 	struct encoder_packet packet;
 	bool packet_time_valid;
 	struct encoder_packet_time packet_time;
+
+	/* packet data is in spill segment spill_segment at spill_offset */
+	bool spilled;
+	uint64_t spill_segment;
+	int64_t spill_offset;
+};
+
+/* temporary file that delayed packet data past the memory limit goes to */
+struct delay_segment {
+	FILE *file;
+	char *path;
+	uint64_t id;
+	int64_t size;
+	size_t packets;
 };
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet, struct encoder_packet_time *frame_time);
@@ -1076,6 +1365,23 @@ struct keyframe_group_data {
 	enum keyframe_group_track_status seen_on_track[MAX_OUTPUT_VIDEO_ENCODERS];
 };
 
+#define MAX_INTERLEAVED_TRACKS (MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
+/* packets of one encoder on their way to an output's mux thread */
+struct output_mux_queue {
+	struct spsc_ring ring;
+
+	/* takes packets while the ring is full, under the output's mux_mutex */
+	struct deque overflow;
+	volatile bool overflowing;
+};
+
+struct output_latency_pending {
+	int64_t pts;
+	uint64_t cts;
+	uint64_t pir;
+};
+
 struct obs_output {
 	struct obs_context_data context;
 	struct obs_output_info info;
@@ -1095,9 +1401,38 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	/* packets waiting to be interleaved, one queue per track (video tracks
+	 * first) in DTS order, and a min-heap of the non-empty tracks keyed
+	 * by their first packet */
+	struct deque interleaved_tracks[MAX_INTERLEAVED_TRACKS];
+	size_t interleaved_heap[MAX_INTERLEAVED_TRACKS];
+	size_t interleaved_heap_size;
+
+	/* encoders only queue their packets, the mux thread hands them on to
+	 * the interleaver, the delay or the output itself */
+	struct output_mux_queue mux_queues[MAX_INTERLEAVED_TRACKS];
+	pthread_mutex_t mux_mutex;
+	encoded_callback_t mux_callback;
+	pthread_t mux_thread;
+	os_sem_t *mux_sem;
+	volatile bool mux_stop;
+	bool mux_thread_active;
 	int stop_code;
 
+	/* start from the encoders' GOP caches, the callback stays held until
+	 * the output is active and the caches were replayed */
+	bool fast_start;
+	encoded_callback_t held_callback;
+
+	/* this output's share of obs->data.output_buffered_bytes, updated
+	 * by the mux thread, which also applies the policy over the limit */
+	uint64_t buffered_bytes;
+	uint64_t buffer_check_ts;
+	enum obs_output_buffer_policy buffer_policy;
+	bool buffer_over_limit;
+	bool buffer_drop_video[MAX_OUTPUT_VIDEO_ENCODERS];
+	int buffer_dropped_frames;
+
 	int reconnect_retry_sec;
 	int reconnect_retry_max;
 	int reconnect_retries;
@@ -1150,6 +1485,18 @@ struct obs_output {
 	pthread_mutex_t pkt_callbacks_mutex;
 	DARRAY(struct packet_callback) pkt_callbacks;
 
+	/* written under latency_mutex, read without locking through
+	 * latency_seq, which is odd while an update is in progress */
+	pthread_mutex_t latency_mutex;
+	volatile long latency_seq;
+	struct obs_output_latency_stats latency[MAX_OUTPUT_VIDEO_ENCODERS];
+
+	/* interleaved video packets the output hasn't reported written yet,
+	 * only kept once it has reported a write */
+	DARRAY(struct output_latency_pending)
+	latency_pending[MAX_OUTPUT_VIDEO_ENCODERS];
+	volatile bool latency_reports_writes;
+
 	bool valid;
 
 	uint64_t active_delay_ns;
@@ -1163,6 +1510,14 @@ struct obs_output {
 	volatile bool delay_active;
 	volatile bool delay_capturing;
 
+	uint64_t delay_memory_limit;
+	uint64_t delay_memory_used;
+	char *delay_spill_dir;
+	DARRAY(struct delay_segment) delay_segments;
+	uint64_t delay_next_segment;
+	size_t delay_spilled_packets;
+	volatile bool delay_spill_forced;
+
 	char *last_error_message;
 
 	float audio_data[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
@@ -1178,6 +1533,7 @@ static inline void do_output_signal(struct obs_output *output, const char *signa
 
 extern void process_delay(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time);
 extern void obs_output_cleanup_delay(obs_output_t *output);
+extern void obs_output_free_delay_segments(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
 extern void obs_output_delay_stop(obs_output_t *output);
 extern bool obs_output_actual_start(obs_output_t *output);
@@ -1188,6 +1544,17 @@ extern const struct obs_output_info *find_output(const char *id);
 extern void obs_output_remove_encoder(struct obs_output *output, struct obs_encoder *encoder);
 
 extern void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src);
+
+/* set in the ref count of packet data that comes from the packet pool */
+#define PACKET_POOLED_REF (1L << (sizeof(long) * 8 - 2))
+
+/* returns data with a ref count of one, given back with
+ * obs_encoder_packet_pool_release once it drops to zero */
+extern uint8_t *obs_encoder_packet_pool_alloc(size_t size);
+extern void obs_encoder_packet_pool_release(uint8_t *data);
+/* usable size of pooled packet data, at least the size it was allocated with */
+extern size_t obs_encoder_packet_pool_capacity(const uint8_t *data);
+extern void obs_encoder_packet_pool_free(void);
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -1202,6 +1569,9 @@ struct encoder_callback {
 	bool sent_first_packet;
 	encoded_callback_t new_packet;
 	void *param;
+
+	/* receives no packets until the GOP cache was replayed to it */
+	bool held;
 };
 
 struct obs_encoder_group {
@@ -1263,6 +1633,9 @@ struct obs_encoder {
 	uint32_t frame_rate_divisor_counter; // only used for GPU encoders
 	video_t *fps_override;
 
+	/* how long the encoder may hold frames back, 0 for real-time */
+	uint32_t max_latency_ms;
+
 	// Number of frames successfully encoded
 	uint32_t encoded_frames;
 
@@ -1297,8 +1670,34 @@ struct obs_encoder {
 	pthread_mutex_t callbacks_mutex;
 	DARRAY(struct encoder_callback) callbacks;
 
+	/* packets since the last keyframe for video, of the last
+	 * GOP_CACHE_MAX_USEC for audio, replayed to outputs that fast start
+	 * on the running encoder.  guarded by callbacks_mutex */
+	bool gop_cache_enabled;
+	struct deque gop_cache;
+	size_t gop_cache_bytes;
+
 	DARRAY(struct encoder_packet_time) encoder_packet_times;
 
+	/* OBS_ENCODER_CAP_ASYNC: completions arrive on the encoder's thread,
+	 * async_mutex guards encoder_packet_times and packet sending */
+	pthread_mutex_t async_mutex;
+	volatile long async_frames;
+	volatile bool async_failed;
+
+	/* written under stats_mutex, read without locking through stats_seq,
+	 * which is odd while an update is in progress */
+	pthread_mutex_t stats_mutex;
+	volatile long stats_seq;
+	struct obs_encoder_stats stats;
+	uint64_t stats_window_start;
+	uint64_t stats_window_bytes;
+
+	/* pool data given out with obs_encoder_packet_alloc that has not been
+	 * sent off in a packet yet */
+	pthread_mutex_t lent_mutex;
+	DARRAY(uint8_t *) lent_packets;
+
 	struct pause_data pause;
 
 	const char *profile_encoder_encode_name;
@@ -1314,6 +1713,10 @@ extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
 
 extern void obs_encoder_start(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param);
+/* like obs_encoder_start, but the callback only gets packets once
+ * obs_encoder_replay_gop_cache was called for it */
+extern void obs_encoder_start_held(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param);
+extern void obs_encoder_replay_gop_cache(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param);
 extern void obs_encoder_stop(obs_encoder_t *encoder, encoded_callback_t new_packet, void *param);
 
 extern void obs_encoder_add_output(struct obs_encoder *encoder, struct obs_output *output);
@@ -1323,6 +1726,7 @@ extern bool start_gpu_encode(obs_encoder_t *encoder);
 extern void stop_gpu_encode(obs_encoder_t *encoder);
 
 extern bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame, const uint64_t *frame_cts);
+extern void encoder_stats_add_call(struct obs_encoder *encoder, uint64_t duration_ns, uint32_t frames);
 extern void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received, struct encoder_packet *pkt);
 
 void obs_encoder_destroy(obs_encoder_t *encoder);
@@ -1363,6 +1767,8 @@ void obs_output_remove_encoder_internal(struct obs_output *output, struct obs_en
 extern void source_profiler_frame_begin(void);
 /* Process data collected during frame */
 extern void source_profiler_frame_collect(void);
+/* The graphics thread missed at least one frame after the current one */
+extern void source_profiler_frame_lagged(void);
 
 /* Start/end of outputs being rendered (GPU timer begin/end) */
 extern void source_profiler_render_begin(void);
@@ -1378,6 +1784,8 @@ extern void source_profiler_async_frame_received(obs_source_t *source);
 extern uint64_t source_profiler_source_tick_start(void);
 /* Submit start timestamp for source */
 extern void source_profiler_source_tick_end(obs_source_t *source, uint64_t start);
+/* Submit tick duration for a source ticked outside of tick_start/tick_end */
+extern void source_profiler_source_tick_record(obs_source_t *source, uint64_t duration);
 
 /* Obtain GPU timer and start timestamp for render start of a source. */
 extern uint64_t source_profiler_source_render_begin(gs_timer_t **timer);
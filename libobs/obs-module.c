@@ -97,6 +97,7 @@ extern void reset_win32_symbol_paths(void);
 int obs_open_module(obs_module_t **module, const char *path, const char *data_path)
 {
 	struct obs_module mod = {0};
+	uint64_t start_time = os_gettime_ns();
 	int errorcode;
 
 	if (!module || !path || !obs)
@@ -130,6 +131,7 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 	mod.mod_name = get_module_name(mod.file);
 	mod.data_path = bstrdup(data_path);
 	mod.next = obs->first_module;
+	mod.load_time_ns = os_gettime_ns() - start_time;
 
 	if (mod.file) {
 		blog(LOG_DEBUG, "Loading module: %s", mod.file);
@@ -155,11 +157,13 @@ bool obs_init_module(obs_module_t *module)
 	const char *profile_name =
 		profile_store_name(obs_get_profiler_name_store(), "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
+	uint64_t start_time = os_gettime_ns();
 
 	module->loaded = module->load();
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'", module->file);
 
+	module->load_time_ns += os_gettime_ns() - start_time;
 	profile_end(profile_name);
 	return module->loaded;
 }
@@ -197,6 +201,11 @@ const char *obs_get_module_binary_path(obs_module_t *module)
 	return module ? module->bin_path : NULL;
 }
 
+uint64_t obs_get_module_load_time(obs_module_t *module)
+{
+	return module ? module->load_time_ns : 0;
+}
+
 const char *obs_get_module_data_path(obs_module_t *module)
 {
 	return module ? module->data_path : NULL;
@@ -361,9 +370,53 @@ static const char *obs_load_all_modules_name = "obs_load_all_modules";
 static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 #endif
 
+static void find_module_effects(void *param, const struct obs_module_info2 *info)
+{
+	DARRAY(char *) *files = param;
+	struct dstr pattern = {0};
+	os_glob_t *glob;
+
+	if (!is_safe_module(info->name))
+		return;
+
+	dstr_printf(&pattern, "%s/*.effect", info->data_path);
+
+	if (os_glob(pattern.array, 0, &glob) == 0) {
+		for (size_t i = 0; i < glob->gl_pathc; i++) {
+			char *file = bstrdup(glob->gl_pathv[i].path);
+			da_push_back(*files, &file);
+		}
+		os_globfree(glob);
+	}
+
+	dstr_free(&pattern);
+}
+
+/* parses the effect files shipped by modules on worker threads, so creating
+ * them while the modules load only has to compile the shaders */
+static void preparse_module_effects(void)
+{
+	DARRAY(char *) files;
+
+	if (!obs->video.graphics)
+		return;
+
+	da_init(files);
+	obs_find_modules2(find_module_effects, &files);
+
+	obs_enter_graphics();
+	gs_effect_preparse_files((const char *const *)files.array, files.num);
+	obs_leave_graphics();
+
+	for (size_t i = 0; i < files.num; i++)
+		bfree(files.array[i]);
+	da_free(files);
+}
+
 void obs_load_all_modules(void)
 {
 	profile_start(obs_load_all_modules_name);
+	preparse_module_effects();
 	obs_find_modules2(load_all_callback, NULL);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
@@ -381,6 +434,7 @@ void obs_load_all_modules2(struct obs_module_failure_info *mfi)
 	memset(mfi, 0, sizeof(*mfi));
 
 	profile_start(obs_load_all_modules2_name);
+	preparse_module_effects();
 	obs_find_modules2(load_all_callback, &fail_info);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
@@ -404,9 +458,19 @@ void obs_module_failure_info_free(struct obs_module_failure_info *mfi)
 
 void obs_post_load_modules(void)
 {
-	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
-		if (mod->post_load)
+	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next) {
+		if (mod->post_load) {
+			uint64_t start_time = os_gettime_ns();
 			mod->post_load();
+			mod->load_time_ns += os_gettime_ns() - start_time;
+		}
+	}
+
+	if (obs->video.graphics) {
+		obs_enter_graphics();
+		gs_effect_preparse_clear();
+		obs_leave_graphics();
+	}
 }
 
 static inline void make_data_dir(struct dstr *parsed_data_dir, const char *data_dir, const char *name)
@@ -900,6 +964,16 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 
 	if (info->type == OBS_ENCODER_AUDIO)
 		CHECK_REQUIRED_VAL_(info, get_frame_size, obs_register_encoder);
+	if ((info->caps & OBS_ENCODER_CAP_AUDIO_BATCH) != 0)
+		CHECK_REQUIRED_VAL_(info, encode_audio_batch, obs_register_encoder);
+	if ((info->caps & OBS_ENCODER_CAP_ASYNC) != 0) {
+		if (info->type != OBS_ENCODER_VIDEO || (info->caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0) {
+			encoder_warn("Only raw video encoders can be asynchronous. Encoder id '%s' not registered.",
+				     info->id);
+			goto error;
+		}
+		CHECK_REQUIRED_VAL_(info, submit_frame, obs_register_encoder);
+	}
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
@@ -31,6 +31,12 @@
 #include <X11/XF86keysym.h>
 #include <X11/Sunkeysym.h>
 
+#if defined(XCB_XINPUT_FOUND)
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 void obs_nix_x11_log_info(void)
 {
 	Display *dpy = obs_get_nix_platform_display();
@@ -96,6 +102,12 @@ struct obs_hotkeys_platform {
 	bool pressed[XINPUT_MOUSE_LEN];
 	bool update[XINPUT_MOUSE_LEN];
 	bool button_pressed[XINPUT_MOUSE_LEN];
+
+	/* separate connection that only wakes the hotkey thread on input */
+	xcb_connection_t *input_connection;
+	pthread_t input_thread;
+	int input_stop_pipe[2];
+	bool input_thread_active;
 #endif
 };
 
@@ -838,6 +850,108 @@ static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
 	xcb_input_xi_select_events(connection, window, 1, &mask.head);
 	xcb_flush(connection);
 }
+
+static void *input_event_thread(void *param)
+{
+	obs_hotkeys_platform_t *context = param;
+	xcb_connection_t *connection = context->input_connection;
+	struct pollfd fds[2] = {
+		{.fd = xcb_get_file_descriptor(connection), .events = POLLIN},
+		{.fd = context->input_stop_pipe[0], .events = POLLIN},
+	};
+
+	os_set_thread_name("libobs: x11 input thread");
+
+	while (poll(fds, 2, -1) >= 0 || errno == EINTR) {
+		xcb_generic_event_t *event;
+		bool input = false;
+
+		/* the write end is closed to stop the thread */
+		if (fds[1].revents)
+			break;
+
+		while ((event = xcb_poll_for_event(connection))) {
+			if ((event->response_type & ~0x80) == XCB_GE_GENERIC)
+				input = true;
+			free(event);
+		}
+
+		if (xcb_connection_has_error(connection))
+			break;
+		if (input)
+			obs_hotkeys_input_event();
+	}
+
+	os_atomic_set_bool(&obs->hotkeys.input_events, false);
+	return NULL;
+}
+
+static bool start_input_events(obs_hotkeys_platform_t *context)
+{
+	xcb_input_xi_query_version_reply_t *version;
+	xcb_generic_error_t *error;
+	xcb_connection_t *connection;
+	bool supported;
+
+	connection = xcb_connect(NULL, NULL);
+	if (xcb_connection_has_error(connection))
+		goto fail;
+
+	version = xcb_input_xi_query_version_reply(connection, xcb_input_xi_query_version(connection, 2, 0), NULL);
+	supported = version && version->major_version >= 2;
+	free(version);
+	if (!supported)
+		goto fail;
+
+	struct {
+		xcb_input_event_mask_t head;
+		xcb_input_xi_event_mask_t mask;
+	} mask;
+	mask.head.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+	mask.head.mask_len = sizeof(mask.mask) / sizeof(uint32_t);
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE;
+
+	error = xcb_request_check(connection, xcb_input_xi_select_events_checked(
+						      connection, root_window(context, connection), 1, &mask.head));
+	if (error) {
+		free(error);
+		goto fail;
+	}
+
+	if (pipe(context->input_stop_pipe) != 0)
+		goto fail;
+
+	context->input_connection = connection;
+	if (pthread_create(&context->input_thread, NULL, input_event_thread, context) != 0) {
+		close(context->input_stop_pipe[0]);
+		close(context->input_stop_pipe[1]);
+		context->input_connection = NULL;
+		goto fail;
+	}
+
+	context->input_thread_active = true;
+	return true;
+
+fail:
+	blog(LOG_INFO, "hotkeys: XInput2 raw events unavailable, polling key state");
+	xcb_disconnect(connection);
+	return false;
+}
+
+static void stop_input_events(obs_hotkeys_platform_t *context)
+{
+	if (!context->input_thread_active)
+		return;
+
+	close(context->input_stop_pipe[1]);
+	pthread_join(context->input_thread, NULL);
+	close(context->input_stop_pipe[0]);
+	xcb_disconnect(context->input_connection);
+
+	context->input_connection = NULL;
+	context->input_thread_active = false;
+}
 #endif
 
 static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
@@ -855,6 +969,11 @@ static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 #endif
 	fill_base_keysyms(hotkeys);
 	fill_keycodes(hotkeys);
+
+#if defined(XCB_XINPUT_FOUND)
+	if (start_input_events(hotkeys->platform_context))
+		os_atomic_set_bool(&hotkeys->input_events, true);
+#endif
 	return true;
 }
 
@@ -864,6 +983,10 @@ static void obs_nix_x11_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	if (!context)
 		return;
 
+#if defined(XCB_XINPUT_FOUND)
+	stop_input_events(context);
+#endif
+
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		da_free(context->keycodes[i].list);
 
@@ -43,10 +43,147 @@ static inline bool log_flag_encoded(const struct obs_output *output, const char
 	return ret;
 }
 
+/* ------------------------------------------------------------------------- */
+/* spilling packet data past the memory limit to disk */
+
+/* packets never straddle segments, and each one is deleted as soon as all
+ * of its packets have been sent */
+#define DELAY_SEGMENT_SIZE (256LL * 1024 * 1024)
+
+static void free_delay_segment(struct delay_segment *segment)
+{
+	fclose(segment->file);
+	os_unlink(segment->path);
+	bfree(segment->path);
+}
+
+void obs_output_free_delay_segments(obs_output_t *output)
+{
+	for (size_t i = 0; i < output->delay_segments.num; i++)
+		free_delay_segment(&output->delay_segments.array[i]);
+	da_free(output->delay_segments);
+
+	output->delay_spilled_packets = 0;
+	output->delay_memory_used = 0;
+}
+
+/* assumes delay_mutex */
+static struct delay_segment *get_write_segment(struct obs_output *output, size_t size)
+{
+	struct delay_segment *segment = da_end(output->delay_segments);
+	struct dstr path = {0};
+	FILE *file;
+
+	if (segment && segment->size + (int64_t)size <= DELAY_SEGMENT_SIZE)
+		return segment;
+
+	dstr_printf(&path, "%s/obs-delay-%p-%" PRIu64 ".tmp", output->delay_spill_dir, (void *)output,
+		    output->delay_next_segment);
+
+	file = os_fopen(path.array, "w+b");
+	if (!file) {
+		blog(LOG_WARNING, "Output '%s': Couldn't create delay file '%s'", output->context.name, path.array);
+		dstr_free(&path);
+		return NULL;
+	}
+
+	segment = da_push_back_new(output->delay_segments);
+	segment->file = file;
+	segment->path = path.array;
+	segment->id = output->delay_next_segment++;
+	return segment;
+}
+
+/* assumes delay_mutex, leaves all of the packet but its data in place */
+static bool spill_packet(struct obs_output *output, struct delay_data *dd)
+{
+	struct delay_segment *segment = get_write_segment(output, dd->packet.size);
+	struct encoder_packet data_ref = dd->packet;
+
+	if (!segment)
+		return false;
+
+	if (os_fseeki64(segment->file, segment->size, SEEK_SET) != 0 ||
+	    fwrite(dd->packet.data, 1, dd->packet.size, segment->file) != dd->packet.size) {
+		blog(LOG_WARNING, "Output '%s': Couldn't write to delay file '%s'", output->context.name,
+		     segment->path);
+		return false;
+	}
+
+	dd->spilled = true;
+	dd->spill_segment = segment->id;
+	dd->spill_offset = segment->size;
+	dd->packet.data = NULL;
+
+	segment->size += (int64_t)dd->packet.size;
+	segment->packets++;
+	output->delay_spilled_packets++;
+
+	obs_encoder_packet_release(&data_ref);
+	return true;
+}
+
+/* assumes delay_mutex */
+static bool load_spilled_packet(struct obs_output *output, struct delay_data *dd)
+{
+	struct delay_segment *segment = NULL;
+	uint8_t *data;
+	bool success;
+	size_t idx;
+
+	for (idx = 0; idx < output->delay_segments.num; idx++) {
+		if (output->delay_segments.array[idx].id == dd->spill_segment) {
+			segment = &output->delay_segments.array[idx];
+			break;
+		}
+	}
+
+	if (!segment)
+		return false;
+
+	data = obs_encoder_packet_pool_alloc(dd->packet.size);
+	success = os_fseeki64(segment->file, dd->spill_offset, SEEK_SET) == 0 &&
+		  fread(data, 1, dd->packet.size, segment->file) == dd->packet.size;
+
+	if (success) {
+		dd->packet.data = data;
+		dd->spilled = false;
+	} else {
+		blog(LOG_WARNING, "Output '%s': Couldn't read from delay file '%s'", output->context.name,
+		     segment->path);
+		obs_encoder_packet_pool_release(data);
+	}
+
+	output->delay_spilled_packets--;
+
+	/* the last segment is still being written to */
+	if (--segment->packets == 0 && idx + 1 < output->delay_segments.num) {
+		free_delay_segment(segment);
+		da_erase(output->delay_segments, idx);
+	}
+
+	return success;
+}
+
+/* once spilling, keep spilling until it's all been read back, so the
+ * packets due next are the ones in memory.  the output buffer limit can
+ * make it spill everything, regardless of the delay's own limit */
+static inline bool should_spill(const struct obs_output *output, size_t size)
+{
+	if (!output->delay_spill_dir)
+		return false;
+	if (output->delay_spilled_packets || os_atomic_load_bool(&output->delay_spill_forced))
+		return true;
+
+	return output->delay_memory_limit && output->delay_memory_used + size > output->delay_memory_limit;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static inline void push_packet(struct obs_output *output, struct encoder_packet *packet,
 			       struct encoder_packet_time *packet_time, uint64_t t)
 {
-	struct delay_data dd;
+	struct delay_data dd = {0};
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts = t;
@@ -56,6 +193,10 @@ static inline void push_packet(struct obs_output *output, struct encoder_packet
 	obs_encoder_packet_create_instance(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
+
+	if (!should_spill(output, dd.packet.size) || !spill_packet(output, &dd))
+		output->delay_memory_used += dd.packet.size;
+
 	deque_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -89,6 +230,8 @@ void obs_output_cleanup_delay(obs_output_t *output)
 		}
 	}
 
+	obs_output_free_delay_segments(output);
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -98,6 +241,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 	uint64_t elapsed_time;
 	struct delay_data dd;
 	bool popped = false;
+	bool loaded = true;
 	bool preserve;
 
 	/* ------------------------------------------------ */
@@ -116,6 +260,11 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 		} else if (elapsed_time > output->active_delay_ns) {
 			deque_pop_front(&output->delay_data, NULL, sizeof(dd));
 			popped = true;
+
+			if (dd.spilled)
+				loaded = load_spilled_packet(output, &dd);
+			else if (dd.msg == DELAY_MSG_PACKET)
+				output->delay_memory_used -= dd.packet.size;
 		}
 	}
 
@@ -123,7 +272,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 
 	/* ------------------------------------------------ */
 
-	if (popped)
+	if (popped && loaded)
 		process_delay_data(output, &dd);
 
 	return popped;
@@ -207,3 +356,19 @@ uint32_t obs_output_get_active_delay(const obs_output_t *output)
 	return obs_output_valid(output, "obs_output_set_delay") ? (uint32_t)(output->active_delay_ns / 1000000000ULL)
 								: 0;
 }
+
+void obs_output_set_delay_memory_limit(obs_output_t *output, uint64_t max_bytes, const char *spill_dir)
+{
+	bool enable = spill_dir && *spill_dir;
+
+	if (!obs_output_valid(output, "obs_output_set_delay_memory_limit"))
+		return;
+	if (!log_flag_encoded(output, __FUNCTION__, false))
+		return;
+
+	pthread_mutex_lock(&output->delay_mutex);
+	bfree(output->delay_spill_dir);
+	output->delay_spill_dir = enable ? bstrdup(spill_dir) : NULL;
+	output->delay_memory_limit = enable ? max_bytes : 0;
+	pthread_mutex_unlock(&output->delay_mutex);
+}
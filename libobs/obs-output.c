@@ -32,6 +32,12 @@
 #define RECONNECT_RETRY_MAX_MSEC (15 * 60 * 1000)
 #define RECONNECT_RETRY_BASE_EXP 1.5f
 
+/* how long packets are buffered while waiting for audio and video to line
+ * up, has to cover what a fast start replays from the encoder GOP caches */
+#define MAX_PRESTART_BUFFER_USEC (15 * 1000000LL)
+
+static void reset_packet_data(obs_output_t *output);
+
 static inline bool active(const struct obs_output *output)
 {
 	return os_atomic_load_bool(&output->active);
@@ -146,6 +152,8 @@ static const char *output_signals[] = {
 	"void deactivate(ptr output)",
 	"void reconnect(ptr output)",
 	"void reconnect_success(ptr output)",
+	"void buffer_limit(ptr output, int buffered_bytes, int total_bytes)",
+	"void buffer_limit_cleared(ptr output)",
 	NULL,
 };
 
@@ -170,6 +178,8 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 	pthread_mutex_init_value(&output->delay_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
 	pthread_mutex_init_value(&output->pkt_callbacks_mutex);
+	pthread_mutex_init_value(&output->latency_mutex);
+	pthread_mutex_init_value(&output->mux_mutex);
 
 	if (pthread_mutex_init(&output->interleaved_mutex, NULL) != 0)
 		goto fail;
@@ -179,6 +189,10 @@ obs_output_t *obs_output_create(const char *id, const char *name, obs_data_t *se
 		goto fail;
 	if (pthread_mutex_init(&output->pkt_callbacks_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&output->latency_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&output->mux_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&output->stopping_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
@@ -226,11 +240,119 @@ fail:
 	return NULL;
 }
 
+/* ------------------------------------------------------------------------- */
+/* interleave queues */
+
+static inline size_t get_packet_track(enum obs_encoder_type type, size_t idx)
+{
+	return type == OBS_ENCODER_VIDEO ? idx : MAX_OUTPUT_VIDEO_ENCODERS + idx;
+}
+
+static inline size_t num_track_packets(const struct obs_output *output, size_t track)
+{
+	return output->interleaved_tracks[track].size / sizeof(struct encoder_packet);
+}
+
+static inline struct encoder_packet *get_track_packet(struct obs_output *output, size_t track, size_t idx)
+{
+	return deque_data(&output->interleaved_tracks[track], idx * sizeof(struct encoder_packet));
+}
+
+/* interleaving order: by DTS, video before audio with the same DTS, and
+ * lower tracks first */
+static inline bool packet_before(const struct encoder_packet *a, const struct encoder_packet *b)
+{
+	if (a->dts_usec != b->dts_usec)
+		return a->dts_usec < b->dts_usec;
+	if (a->type != b->type)
+		return a->type == OBS_ENCODER_VIDEO;
+	return a->track_idx < b->track_idx;
+}
+
+static inline bool track_before(struct obs_output *output, size_t a, size_t b)
+{
+	return packet_before(get_track_packet(output, a, 0), get_track_packet(output, b, 0));
+}
+
+static inline void swap_heap_entries(struct obs_output *output, size_t a, size_t b)
+{
+	size_t track = output->interleaved_heap[a];
+	output->interleaved_heap[a] = output->interleaved_heap[b];
+	output->interleaved_heap[b] = track;
+}
+
+static void sift_heap_up(struct obs_output *output, size_t pos)
+{
+	while (pos) {
+		size_t parent = (pos - 1) / 2;
+
+		if (!track_before(output, output->interleaved_heap[pos], output->interleaved_heap[parent]))
+			break;
+
+		swap_heap_entries(output, pos, parent);
+		pos = parent;
+	}
+}
+
+static void sift_heap_down(struct obs_output *output, size_t pos)
+{
+	const size_t size = output->interleaved_heap_size;
+
+	for (;;) {
+		size_t child = pos * 2 + 1;
+
+		if (child >= size)
+			break;
+		if (child + 1 < size &&
+		    track_before(output, output->interleaved_heap[child + 1], output->interleaved_heap[child]))
+			child++;
+		if (!track_before(output, output->interleaved_heap[child], output->interleaved_heap[pos]))
+			break;
+
+		swap_heap_entries(output, pos, child);
+		pos = child;
+	}
+}
+
+/* for when packets were changed or removed on several tracks */
+static void rebuild_interleave_heap(struct obs_output *output)
+{
+	output->interleaved_heap_size = 0;
+
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		if (output->interleaved_tracks[i].size)
+			output->interleaved_heap[output->interleaved_heap_size++] = i;
+	}
+
+	for (size_t i = output->interleaved_heap_size / 2; i > 0; i--)
+		sift_heap_down(output, i - 1);
+}
+
+static inline struct encoder_packet *get_first_interleaved_packet(struct obs_output *output)
+{
+	return output->interleaved_heap_size ? get_track_packet(output, output->interleaved_heap[0], 0) : NULL;
+}
+
+static void pop_first_interleaved_packet(struct obs_output *output)
+{
+	size_t track = output->interleaved_heap[0];
+
+	deque_pop_front(&output->interleaved_tracks[track], NULL, sizeof(struct encoder_packet));
+
+	if (!output->interleaved_tracks[track].size)
+		output->interleaved_heap[0] = output->interleaved_heap[--output->interleaved_heap_size];
+	sift_heap_down(output, 0);
+}
+
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array + i);
-	da_free(output->interleaved_packets);
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		for (size_t j = 0; j < num_track_packets(output, i); j++)
+			obs_encoder_packet_release(get_track_packet(output, i, j));
+		deque_free(&output->interleaved_tracks[i]);
+	}
+
+	output->interleaved_heap_size = 0;
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -294,8 +416,10 @@ void obs_output_destroy(obs_output_t *output)
 
 		da_free(output->keyframe_group_tracking);
 
-		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
 			da_free(output->encoder_packet_times[i]);
+			da_free(output->latency_pending[i]);
+		}
 
 		da_free(output->pkt_callbacks);
 
@@ -306,9 +430,13 @@ void obs_output_destroy(obs_output_t *output)
 		pthread_mutex_destroy(&output->interleaved_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
 		pthread_mutex_destroy(&output->pkt_callbacks_mutex);
+		pthread_mutex_destroy(&output->latency_mutex);
+		pthread_mutex_destroy(&output->mux_mutex);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		deque_free(&output->delay_data);
+		obs_output_free_delay_segments(output);
+		bfree(output->delay_spill_dir);
 		if (output->owns_info_id)
 			bfree((void *)output->info.id);
 		if (output->last_error_message)
@@ -1139,6 +1267,19 @@ void obs_output_set_reconnect_settings(obs_output_t *output, int retry_count, in
 	output->reconnect_retry_sec = retry_sec;
 }
 
+void obs_output_set_fast_start(obs_output_t *output, bool fast_start)
+{
+	if (!obs_output_valid(output, "obs_output_set_fast_start"))
+		return;
+
+	output->fast_start = fast_start;
+}
+
+bool obs_output_get_fast_start(const obs_output_t *output)
+{
+	return obs_output_valid(output, "obs_output_get_fast_start") ? output->fast_start : false;
+}
+
 uint64_t obs_output_get_total_bytes(const obs_output_t *output)
 {
 	if (!obs_output_valid(output, "obs_output_get_total_bytes"))
@@ -1157,9 +1298,9 @@ int obs_output_get_frames_dropped(const obs_output_t *output)
 	if (!obs_output_valid(output, "obs_output_get_frames_dropped"))
 		return 0;
 	if (!output->info.get_dropped_frames)
-		return 0;
+		return output->buffer_dropped_frames;
 
-	return output->info.get_dropped_frames(output->context.data);
+	return output->info.get_dropped_frames(output->context.data) + output->buffer_dropped_frames;
 }
 
 int obs_output_get_total_frames(const obs_output_t *output)
@@ -1461,6 +1602,37 @@ static size_t extract_buffer_from_sei(sei_t *sei, uint8_t **data_out)
 	return payload_size;
 }
 
+/* Appends the caption data to the packet.  Pooled blocks are sized to their
+ * class, so when nothing else holds a reference to the packet the caption
+ * usually fits in the slack after the payload and nothing is copied.
+ * Otherwise the packet is copied once into data of the exact new size. */
+static void append_caption_data(struct encoder_packet *out, const struct encoder_packet *backup,
+				const uint8_t *caption, size_t caption_size)
+{
+	long refs = os_atomic_load_long(((long *)out->data) - 1);
+	size_t new_size = out->size + caption_size;
+	uint8_t *new_data;
+
+	if (!caption_size)
+		return;
+
+	if (refs == (PACKET_POOLED_REF | 1) && obs_encoder_packet_pool_capacity(out->data) >= new_size) {
+		memcpy(out->data + out->size, caption, caption_size);
+		out->size = new_size;
+		return;
+	}
+
+	new_data = obs_encoder_packet_pool_alloc(new_size);
+	memcpy(new_data, out->data, out->size);
+	memcpy(new_data + out->size, caption, caption_size);
+
+	obs_encoder_packet_release(out);
+
+	*out = *backup;
+	out->data = new_data;
+	out->size = new_size;
+}
+
 static const uint8_t nal_start[4] = {0, 0, 0, 1};
 static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 {
@@ -1468,7 +1640,6 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_t sei;
 	uint8_t *data = NULL;
 	size_t size;
-	long ref = 1;
 	bool avc = false;
 	bool hevc = false;
 	bool av1 = false;
@@ -1524,9 +1695,9 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 #endif
 	sei_init(&sei, 0.0);
 
+	/* only the caption NAL/OBU is built here, it gets appended to the
+	 * encoded payload in one go afterwards */
 	da_init(out_data);
-	da_push_back_array(out_data, (uint8_t *)&ref, sizeof(ref));
-	da_push_back_array(out_data, out->data, out->size);
 
 	if (ctrack->caption_data.size > 0) {
 
@@ -1634,29 +1805,103 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 		if (data) {
 			bfree(data);
 		}
-		obs_encoder_packet_release(out);
-
-		*out = backup;
-		out->data = (uint8_t *)out_data.array + sizeof(ref);
-		out->size = out_data.num - sizeof(ref);
+		append_caption_data(out, &backup, out_data.array, out_data.num);
 	}
+	da_free(out_data);
 	sei_free(&sei);
 	return avc || hevc || av1;
 }
 
+#define LATENCY_PENDING_MAX 512
+
+static inline void latency_begin(struct obs_output *output)
+{
+	os_atomic_inc_long(&output->latency_seq);
+}
+
+static inline void latency_end(struct obs_output *output)
+{
+	os_atomic_inc_long(&output->latency_seq);
+}
+
+static void latency_add(struct obs_output_latency_histogram *hist, uint64_t begin, uint64_t end)
+{
+	size_t bucket = 0;
+
+	if (!begin || !end || end < begin)
+		return;
+
+	const uint64_t us64 = (end - begin) / 1000;
+	const uint32_t us = us64 > UINT32_MAX ? UINT32_MAX : (uint32_t)us64;
+
+	while (bucket < OBS_OUTPUT_LATENCY_BUCKETS - 1 && us >= (1000U << bucket))
+		bucket++;
+
+	hist->samples++;
+	hist->us_total += us;
+	if (us > hist->us_max)
+		hist->us_max = us;
+	hist->buckets[bucket]++;
+}
+
+static void latency_add_interleaved(struct obs_output *output, size_t track, const struct encoder_packet_time *ept,
+				    uint64_t pir)
+{
+	struct obs_output_latency_stats *stats = &output->latency[track];
+
+	pthread_mutex_lock(&output->latency_mutex);
+
+	latency_begin(output);
+	latency_add(&stats->stages[OBS_OUTPUT_LATENCY_COMPOSITE], ept->cts, ept->fer);
+	latency_add(&stats->stages[OBS_OUTPUT_LATENCY_ENCODE], ept->fer, ept->ferc);
+	latency_add(&stats->stages[OBS_OUTPUT_LATENCY_INTERLEAVE], ept->ferc, pir);
+	latency_end(output);
+
+	/* outputs drop packets without telling, so cap what's kept for them */
+	if (os_atomic_load_bool(&output->latency_reports_writes)) {
+		struct output_latency_pending *pending;
+
+		if (output->latency_pending[track].num >= LATENCY_PENDING_MAX)
+			da_erase(output->latency_pending[track], 0);
+
+		pending = da_push_back_new(output->latency_pending[track]);
+		pending->pts = ept->pts;
+		pending->cts = ept->cts;
+		pending->pir = pir;
+	}
+
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
+static void reset_latency(struct obs_output *output)
+{
+	pthread_mutex_lock(&output->latency_mutex);
+	latency_begin(output);
+	memset(output->latency, 0, sizeof(output->latency));
+	latency_end(output);
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		output->latency_pending[i].num = 0;
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet *first = get_first_interleaved_packet(output);
 	struct encoder_packet_time ept_local = {0};
 	bool found_ept = false;
 
+	if (!first)
+		return;
+
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!has_higher_opposing_ts(output, first))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	struct encoder_packet out = *first;
+	pop_first_interleaved_packet(output);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1704,6 +1949,8 @@ static inline void send_interleaved(struct obs_output *output)
 			if (found_ept == false) {
 				blog(LOG_DEBUG, "%s: Track %lu encoder packet timing for PTS%" PRId64 " not found.",
 				     __FUNCTION__, out.track_idx, out.pts);
+			} else {
+				latency_add_interleaved(output, out.track_idx, &ept_local, os_gettime_ns());
 			}
 		} else {
 			// encoder_packet_times should not be empty; log if so.
@@ -1741,35 +1988,45 @@ static inline void set_higher_ts(struct obs_output *output, struct encoder_packe
 }
 
 static inline struct encoder_packet *find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-							    size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t audio_idx);
+							    size_t idx)
+{
+	return get_track_packet(output, get_packet_track(type, idx), 0);
+}
+
+static inline struct encoder_packet *find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
+							   size_t idx)
+{
+	size_t track = get_packet_track(type, idx);
+	size_t num = num_track_packets(output, track);
+
+	return num ? get_track_packet(output, track, num - 1) : NULL;
+}
 
 /* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+static struct encoder_packet *get_interleaved_start(struct obs_output *output)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
 	struct encoder_packet *first_video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
+	struct encoder_packet *closest = NULL;
 
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		int64_t diff;
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		size_t track = get_packet_track(OBS_ENCODER_AUDIO, i);
 
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
+		for (size_t j = 0; j < num_track_packets(output, track); j++) {
+			struct encoder_packet *packet = get_track_packet(output, track, j);
+			int64_t diff = llabs(packet->dts_usec - first_video->dts_usec);
+			bool tie = closest && diff == closest_diff && packet_before(packet, closest);
 
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+			if (diff < closest_diff || tie) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return NULL;
+	return packet_before(first_video, closest) ? first_video : closest;
 }
 
 static int64_t get_encoder_duration(struct obs_encoder *encoder)
@@ -1777,42 +2034,39 @@ static int64_t get_encoder_duration(struct obs_encoder *encoder)
 	return (encoder->timebase_num * 1000000LL / encoder->timebase_den) * encoder->framesize;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+/* returns -1 if not all first packets are there yet, otherwise whether
+ * everything up to and including *last has to be pruned */
+static int prune_premature_packets(struct obs_output *output, struct encoder_packet **last)
 {
 	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
 	int64_t duration_usec, max_audio_duration_usec = 0;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 	int audio_encoders = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1)
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!video)
 		return -1;
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	*last = video;
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		struct encoder_packet *audio;
-		int audio_idx;
 		int64_t audio_duration_usec = 0;
 
 		if (!output->audio_encoders[i])
 			continue;
 		audio_encoders++;
 
-		audio_idx = find_first_packet_type_idx(output, OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (packet_before(*last, audio))
+			*last = audio;
 
 		diff = audio->dts_usec - video->dts_usec;
 		if (diff > max_diff)
@@ -1833,89 +2087,70 @@ static int prune_premature_packets(struct obs_output *output)
 		duration_usec = max_audio_duration_usec;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
+	return diff > duration_usec ? 1 : 0;
 }
 
-static void discard_to_idx(struct obs_output *output, size_t idx)
+static void discard_first_track_packet(struct obs_output *output, size_t track)
 {
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		if (packet->type == OBS_ENCODER_VIDEO) {
-			da_pop_front(output->encoder_packet_times[packet->track_idx]);
+	struct encoder_packet packet;
+
+	deque_pop_front(&output->interleaved_tracks[track], &packet, sizeof(packet));
+	if (packet.type == OBS_ENCODER_VIDEO) {
+		da_pop_front(output->encoder_packet_times[packet.track_idx]);
+	}
+	obs_encoder_packet_release(&packet);
+}
+
+/* discards everything before limit in interleaving order, and limit
+ * itself if inclusive */
+static void discard_to_packet(struct obs_output *output, const struct encoder_packet *limit, bool inclusive)
+{
+	const struct encoder_packet stop = *limit;
+
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		struct encoder_packet *packet;
+
+		while ((packet = get_track_packet(output, i, 0)) != NULL) {
+			if (!packet_before(packet, &stop) && (!inclusive || packet_before(&stop, packet)))
+				break;
+			discard_first_track_packet(output, i);
 		}
-		obs_encoder_packet_release(packet);
 	}
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	rebuild_interleave_heap(output);
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct encoder_packet *last = NULL;
+	int prune_start = prune_premature_packets(output, &last);
 
 #if DEBUG_STARTING_PACKETS == 1
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video", (int)packet->track_idx, packet->dts_usec,
-		     (int)i < prune_start ? "true" : "false");
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		for (size_t j = 0; j < num_track_packets(output, i); j++) {
+			struct encoder_packet *packet = get_track_packet(output, i, j);
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
+			     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video", (int)packet->track_idx,
+			     packet->dts_usec, prune_start == 1 && !packet_before(last, packet) ? "true" : "false");
+		}
 	}
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
+	if (prune_start == -1) {
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
-
-	return true;
-}
-
-static int find_first_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)i;
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output, enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)(i - 1);
+	} else if (prune_start != 0) {
+		discard_to_packet(output, last, true);
+	} else {
+		struct encoder_packet *start = get_interleaved_start(output);
+		if (start)
+			discard_to_packet(output, start, false);
 	}
 
-	return -1;
-}
-
-static inline struct encoder_packet *find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-							    size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
-							   size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return true;
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output, struct encoder_packet **video,
@@ -1952,7 +2187,7 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	struct encoder_packet *video[MAX_OUTPUT_VIDEO_ENCODERS] = {0};
 	struct encoder_packet *audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
 	struct encoder_packet *last_audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
-	size_t start_idx;
+	struct encoder_packet *start;
 	size_t first_audio_idx;
 	size_t first_video_idx;
 
@@ -1981,9 +2216,9 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
+	start = get_interleaved_start(output);
+	if (start && start != get_first_interleaved_packet(output)) {
+		discard_to_packet(output, start, false);
 		if (!get_audio_and_video_packets(output, video, audio))
 			return false;
 	}
@@ -2014,9 +2249,9 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[first_audio_idx]->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet = &output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet, NULL);
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		for (size_t j = 0; j < num_track_packets(output, i); j++)
+			apply_interleaved_packet_offset(output, get_track_packet(output, i, j), NULL);
 	}
 
 	return true;
@@ -2024,57 +2259,58 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 
 static inline void insert_interleaved_packet(struct obs_output *output, struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
-			continue;
+	const size_t track = get_packet_track(out->type, out->track_idx);
+	const size_t num = num_track_packets(output, track);
+	size_t idx = num;
 
-		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
+	deque_push_back(&output->interleaved_tracks[track], out, sizeof(*out));
+
+	/* encoders produce packets in DTS order, so this only moves a packet
+	 * back if one didn't */
+	while (idx > 0) {
+		struct encoder_packet *prev = get_track_packet(output, track, idx - 1);
+		struct encoder_packet *cur = get_track_packet(output, track, idx);
+		struct encoder_packet tmp;
+
+		if (!packet_before(cur, prev))
 			break;
-		}
+
+		tmp = *prev;
+		*prev = *cur;
+		*cur = tmp;
+		idx--;
 	}
 
-	da_insert(output->interleaved_packets, idx, out);
+	if (!num) {
+		output->interleaved_heap[output->interleaved_heap_size] = track;
+		sift_heap_up(output, output->interleaved_heap_size++);
+	} else if (idx == 0) {
+		rebuild_interleave_heap(output);
+	}
 }
 
+/* offsets are applied per track, so only the order between tracks and
+ * the highest timestamps need updating */
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0, sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
-
-		insert_interleaved_packet(output, &old_array.array[i]);
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		for (size_t j = 0; j < num_track_packets(output, i); j++)
+			set_higher_ts(output, get_track_packet(output, i, j));
 	}
 
-	da_free(old_array);
+	rebuild_interleave_heap(output);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output, int64_t dts_usec)
 {
-	size_t idx = 0;
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		struct encoder_packet *packet;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p = &output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
-			break;
+		while ((packet = get_track_packet(output, i, 0)) != NULL && packet->dts_usec < dts_usec)
+			discard_first_track_packet(output, i);
 	}
 
-	if (idx)
-		discard_to_idx(output, idx);
+	rebuild_interleave_heap(output);
 }
 
 static bool purge_encoder_group_keyframe_data(obs_output_t *output, size_t idx)
@@ -2153,6 +2389,22 @@ static void apply_ept_offsets(struct obs_output *output)
 	}
 }
 
+static bool prestart_buffer_full(struct obs_output *output, const struct encoder_packet *packet)
+{
+	struct encoder_packet *first = get_first_interleaved_packet(output);
+	bool received_video = true;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (output->video_encoders[i])
+			received_video = received_video && output->received_video[i];
+	}
+
+	if (output->received_audio && received_video)
+		return false;
+
+	return first && packet->dts_usec - first->dts_usec > MAX_PRESTART_BUFFER_USEC;
+}
+
 static void interleave_packets(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
 {
 	struct obs_output *output = data;
@@ -2168,6 +2420,14 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 
 	pthread_mutex_lock(&output->interleaved_mutex);
 
+	/* start over rather than buffer indefinitely for tracks that don't
+	 * line up */
+	if (prestart_buffer_full(output, packet)) {
+		blog(LOG_WARNING, "Output '%s': audio and video did not line up, discarding buffered packets",
+		     output->context.name);
+		reset_packet_data(output);
+	}
+
 	/* if first video frame is not a keyframe, discard until received */
 	if (packet->type == OBS_ENCODER_VIDEO && !output->received_video[packet->track_idx] && !packet->keyframe) {
 		discard_unused_audio_packets(output, packet->dts_usec);
@@ -2357,7 +2617,10 @@ static inline void start_audio_encoders(struct obs_output *output, encoded_callb
 {
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		if (output->audio_encoders[i]) {
-			obs_encoder_start(output->audio_encoders[i], encoded_callback, output);
+			if (output->held_callback)
+				obs_encoder_start_held(output->audio_encoders[i], encoded_callback, output);
+			else
+				obs_encoder_start(output->audio_encoders[i], encoded_callback, output);
 		}
 	}
 }
@@ -2366,7 +2629,10 @@ static inline void start_video_encoders(struct obs_output *output, encoded_callb
 {
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
 		if (output->video_encoders[i]) {
-			obs_encoder_start(output->video_encoders[i], encoded_callback, output);
+			if (output->held_callback)
+				obs_encoder_start_held(output->video_encoders[i], encoded_callback, output);
+			else
+				obs_encoder_start(output->video_encoders[i], encoded_callback, output);
 		}
 	}
 }
@@ -2411,6 +2677,411 @@ static inline bool preserve_active(struct obs_output *output)
 	return (output->delay_flags & OBS_OUTPUT_DELAY_PRESERVE) != 0;
 }
 
+/* ------------------------------------------------------------------------- */
+/* mux thread */
+
+/* per encoder, about four seconds of 60 fps video */
+#define MUX_QUEUE_PACKETS 256
+
+struct mux_entry {
+	struct encoder_packet packet;
+	struct encoder_packet_time packet_time;
+	bool has_packet_time;
+};
+
+/* runs on the encoder's thread, so it only takes a reference */
+static void queue_encoded_packet(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
+{
+	struct obs_output *output = data;
+	struct output_mux_queue *queue;
+	struct mux_entry entry = {0};
+
+	queue = &output->mux_queues[get_packet_track(packet->type, get_encoder_index(output, packet))];
+
+	obs_encoder_packet_create_instance(&entry.packet, packet);
+	if (packet_time) {
+		entry.packet_time = *packet_time;
+		entry.has_packet_time = true;
+	}
+
+	/* once the ring was full, packets keep going to the overflow until
+	 * the mux thread took it, so they stay in order */
+	if (!os_atomic_load_bool(&queue->overflowing) && spsc_ring_space(&queue->ring) >= sizeof(entry)) {
+		spsc_ring_write(&queue->ring, 0, &entry, sizeof(entry));
+		spsc_ring_commit(&queue->ring, sizeof(entry));
+	} else {
+		pthread_mutex_lock(&output->mux_mutex);
+		os_atomic_set_bool(&queue->overflowing, true);
+		deque_push_back(&queue->overflow, &entry, sizeof(entry));
+		pthread_mutex_unlock(&output->mux_mutex);
+	}
+
+	os_sem_post(output->mux_sem);
+}
+
+/* ------------------------------------------------------------------------- */
+/* buffer limit */
+
+#define BUFFER_CHECK_INTERVAL_NS 100000000ULL
+
+static const char *buffer_policy_name(enum obs_output_buffer_policy policy)
+{
+	switch (policy) {
+	case OBS_OUTPUT_BUFFER_DROP:
+		return "dropping video";
+	case OBS_OUTPUT_BUFFER_SPILL:
+		return "spilling the delay to disk";
+	case OBS_OUTPUT_BUFFER_STOP:
+		return "stopping";
+	}
+
+	return "unknown";
+}
+
+static uint64_t get_buffered_bytes(struct obs_output *output)
+{
+	uint64_t bytes = 0;
+
+	pthread_mutex_lock(&output->interleaved_mutex);
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		for (size_t j = 0; j < num_track_packets(output, i); j++)
+			bytes += get_track_packet(output, i, j)->size;
+	}
+	pthread_mutex_unlock(&output->interleaved_mutex);
+
+	pthread_mutex_lock(&output->delay_mutex);
+	bytes += output->delay_memory_used;
+	pthread_mutex_unlock(&output->delay_mutex);
+
+	if (output->info.get_buffered_bytes && output->context.data)
+		bytes += output->info.get_buffered_bytes(output->context.data);
+
+	return bytes;
+}
+
+/* replaces the output's share of the total, returns the new total */
+static uint64_t set_output_buffered_bytes(struct obs_output *output, uint64_t bytes, uint64_t *limit)
+{
+	struct obs_core_data *data = &obs->data;
+	uint64_t total;
+
+	pthread_mutex_lock(&data->output_buffers_mutex);
+	data->output_buffered_bytes = data->output_buffered_bytes - output->buffered_bytes + bytes;
+	output->buffered_bytes = bytes;
+	total = data->output_buffered_bytes;
+	if (limit)
+		*limit = data->output_buffer_limit;
+	pthread_mutex_unlock(&data->output_buffers_mutex);
+
+	return total;
+}
+
+/* stopping joins the mux thread this is called from */
+static void stop_for_buffer_limit(void *param)
+{
+	obs_output_t *output = param;
+
+	if (obs_output_active(output)) {
+		obs_output_set_last_error(output, "The output buffered more than the output buffer limit allows.");
+		obs_output_force_stop(output);
+	}
+	obs_output_release(output);
+}
+
+static void begin_buffer_limit(struct obs_output *output, uint64_t bytes, uint64_t total, uint64_t limit)
+{
+	enum obs_output_buffer_policy policy = output->buffer_policy;
+	struct calldata params = {0};
+
+	if (policy == OBS_OUTPUT_BUFFER_SPILL && !(output->active_delay_ns && output->delay_spill_dir))
+		policy = OBS_OUTPUT_BUFFER_DROP;
+
+	blog(LOG_WARNING,
+	     "Output '%s': Outputs buffered %" PRIu64 " bytes, over the limit of %" PRIu64 ", %" PRIu64
+	     " of them here, %s",
+	     output->context.name, total, limit, bytes, buffer_policy_name(policy));
+
+	calldata_set_ptr(&params, "output", output);
+	calldata_set_int(&params, "buffered_bytes", (long long)bytes);
+	calldata_set_int(&params, "total_bytes", (long long)total);
+	signal_handler_signal(output->context.signals, "buffer_limit", &params);
+	calldata_free(&params);
+
+	switch (policy) {
+	case OBS_OUTPUT_BUFFER_DROP:
+		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+			output->buffer_drop_video[i] = !!output->video_encoders[i];
+		break;
+	case OBS_OUTPUT_BUFFER_SPILL:
+		os_atomic_set_bool(&output->delay_spill_forced, true);
+		break;
+	case OBS_OUTPUT_BUFFER_STOP:
+		if (obs_output_get_ref(output))
+			obs_queue_task(OBS_TASK_DESTROY, stop_for_buffer_limit, output, false);
+		break;
+	}
+}
+
+static void end_buffer_limit(struct obs_output *output, uint64_t total)
+{
+	blog(LOG_INFO, "Output '%s': Outputs buffered %" PRIu64 " bytes, under the limit again",
+	     output->context.name, total);
+
+	os_atomic_set_bool(&output->delay_spill_forced, false);
+	do_output_signal(output, "buffer_limit_cleared");
+}
+
+static void check_buffer_limit(struct obs_output *output)
+{
+	const uint64_t now = os_gettime_ns();
+	uint64_t bytes, total, limit;
+	bool over;
+
+	if (now - output->buffer_check_ts < BUFFER_CHECK_INTERVAL_NS)
+		return;
+	output->buffer_check_ts = now;
+
+	bytes = get_buffered_bytes(output);
+	total = set_output_buffered_bytes(output, bytes, &limit);
+	over = limit && total > limit;
+
+	if (over == output->buffer_over_limit)
+		return;
+
+	output->buffer_over_limit = over;
+	if (over)
+		begin_buffer_limit(output, bytes, total, limit);
+	else
+		end_buffer_limit(output, total);
+}
+
+/* once over the limit, video is dropped until the first keyframe after it
+ * is under again, so the output never gets a broken GOP */
+static bool drop_for_buffer_limit(struct obs_output *output, struct encoder_packet *packet)
+{
+	size_t idx;
+
+	if (packet->type != OBS_ENCODER_VIDEO)
+		return false;
+
+	idx = get_encoder_index(output, packet);
+	if (!output->buffer_drop_video[idx])
+		return false;
+
+	if (packet->keyframe && !output->buffer_over_limit) {
+		output->buffer_drop_video[idx] = false;
+		return false;
+	}
+
+	output->buffer_dropped_frames++;
+	return true;
+}
+
+static void reset_buffer_limit(struct obs_output *output)
+{
+	output->buffer_check_ts = 0;
+	output->buffer_over_limit = false;
+	memset(output->buffer_drop_video, 0, sizeof(output->buffer_drop_video));
+	os_atomic_set_bool(&output->delay_spill_forced, false);
+	set_output_buffered_bytes(output, 0, NULL);
+}
+
+uint64_t obs_output_get_buffered_bytes(obs_output_t *output)
+{
+	if (!obs_output_valid(output, "obs_output_get_buffered_bytes"))
+		return 0;
+
+	return get_buffered_bytes(output);
+}
+
+void obs_output_set_buffer_policy(obs_output_t *output, enum obs_output_buffer_policy policy)
+{
+	if (!obs_output_valid(output, "obs_output_set_buffer_policy"))
+		return;
+
+	output->buffer_policy = policy;
+}
+
+enum obs_output_buffer_policy obs_output_get_buffer_policy(const obs_output_t *output)
+{
+	return obs_output_valid(output, "obs_output_get_buffer_policy") ? output->buffer_policy
+									 : OBS_OUTPUT_BUFFER_DROP;
+}
+
+void obs_set_output_buffer_limit(uint64_t max_bytes)
+{
+	if (!obs)
+		return;
+
+	pthread_mutex_lock(&obs->data.output_buffers_mutex);
+	obs->data.output_buffer_limit = max_bytes;
+	pthread_mutex_unlock(&obs->data.output_buffers_mutex);
+}
+
+uint64_t obs_get_output_buffer_limit(void)
+{
+	uint64_t limit;
+
+	if (!obs)
+		return 0;
+
+	pthread_mutex_lock(&obs->data.output_buffers_mutex);
+	limit = obs->data.output_buffer_limit;
+	pthread_mutex_unlock(&obs->data.output_buffers_mutex);
+	return limit;
+}
+
+uint64_t obs_get_output_buffered_bytes(void)
+{
+	uint64_t bytes;
+
+	if (!obs)
+		return 0;
+
+	pthread_mutex_lock(&obs->data.output_buffers_mutex);
+	bytes = obs->data.output_buffered_bytes;
+	pthread_mutex_unlock(&obs->data.output_buffers_mutex);
+	return bytes;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void process_mux_entry(struct obs_output *output, struct mux_entry *entry)
+{
+	if (!drop_for_buffer_limit(output, &entry->packet))
+		output->mux_callback(output, &entry->packet, entry->has_packet_time ? &entry->packet_time : NULL);
+	obs_encoder_packet_release(&entry->packet);
+}
+
+static inline void process_mux_ring(struct obs_output *output, struct output_mux_queue *queue, size_t size)
+{
+	struct mux_entry entry;
+
+	for (; size >= sizeof(entry); size -= sizeof(entry)) {
+		spsc_ring_peek(&queue->ring, 0, &entry, sizeof(entry));
+		spsc_ring_pop(&queue->ring, sizeof(entry));
+		process_mux_entry(output, &entry);
+	}
+}
+
+static void drain_mux_queue(struct obs_output *output, struct output_mux_queue *queue)
+{
+	struct mux_entry entry;
+	struct deque overflow;
+	size_t older;
+
+	process_mux_ring(output, queue, spsc_ring_size(&queue->ring));
+
+	if (!os_atomic_load_bool(&queue->overflowing))
+		return;
+
+	/* what is in the ring at this point came before the overflow, what
+	 * comes into it after the flag is cleared comes after */
+	pthread_mutex_lock(&output->mux_mutex);
+	older = spsc_ring_size(&queue->ring);
+	overflow = queue->overflow;
+	deque_init(&queue->overflow);
+	os_atomic_set_bool(&queue->overflowing, false);
+	pthread_mutex_unlock(&output->mux_mutex);
+
+	process_mux_ring(output, queue, older);
+
+	while (overflow.size) {
+		deque_pop_front(&overflow, &entry, sizeof(entry));
+		process_mux_entry(output, &entry);
+	}
+
+	deque_free(&overflow);
+}
+
+static void *mux_thread(void *data)
+{
+	struct obs_output *output = data;
+
+	os_set_thread_name("libobs: output mux thread");
+	obs_set_alloc_counter(OBS_ALLOC_OUTPUTS);
+
+	for (;;) {
+		os_sem_wait(output->mux_sem);
+
+		/* everything queued before the stop still gets through */
+		bool stop = os_atomic_load_bool(&output->mux_stop);
+
+		for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+			if (output->mux_queues[i].ring.data)
+				drain_mux_queue(output, &output->mux_queues[i]);
+		}
+
+		check_buffer_limit(output);
+
+		if (stop)
+			break;
+	}
+
+	return NULL;
+}
+
+static void free_mux_queues(struct obs_output *output)
+{
+	for (size_t i = 0; i < MAX_INTERLEAVED_TRACKS; i++) {
+		spsc_ring_free(&output->mux_queues[i].ring);
+		deque_free(&output->mux_queues[i].overflow);
+		output->mux_queues[i].overflowing = false;
+	}
+}
+
+static bool start_mux_thread(struct obs_output *output, encoded_callback_t callback, bool has_video, bool has_audio)
+{
+	const size_t ring_size = MUX_QUEUE_PACKETS * sizeof(struct mux_entry);
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (has_video && output->video_encoders[i])
+			spsc_ring_init(&output->mux_queues[get_packet_track(OBS_ENCODER_VIDEO, i)].ring, ring_size);
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (has_audio && output->audio_encoders[i])
+			spsc_ring_init(&output->mux_queues[get_packet_track(OBS_ENCODER_AUDIO, i)].ring, ring_size);
+	}
+
+	output->mux_callback = callback;
+	os_atomic_set_bool(&output->mux_stop, false);
+	reset_buffer_limit(output);
+
+	if (os_sem_init(&output->mux_sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&output->mux_thread, NULL, mux_thread, output) != 0) {
+		os_sem_destroy(output->mux_sem);
+		goto fail;
+	}
+
+	output->mux_thread_active = true;
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Output '%s': Failed to create mux thread, packets will be handled on the encoder threads",
+	     output->context.name);
+	output->mux_sem = NULL;
+	free_mux_queues(output);
+	return false;
+}
+
+/* the encoders have to be stopped first */
+static void stop_mux_thread(struct obs_output *output)
+{
+	if (!output->mux_thread_active)
+		return;
+
+	os_atomic_set_bool(&output->mux_stop, true);
+	os_sem_post(output->mux_sem);
+	pthread_join(output->mux_thread, NULL);
+
+	os_sem_destroy(output->mux_sem);
+	output->mux_sem = NULL;
+	output->mux_thread_active = false;
+	free_mux_queues(output);
+	reset_buffer_limit(output);
+}
+
 static void hook_data_capture(struct obs_output *output)
 {
 	encoded_callback_t encoded_callback;
@@ -2421,6 +3092,7 @@ static void hook_data_capture(struct obs_output *output)
 		pthread_mutex_lock(&output->interleaved_mutex);
 		reset_packet_data(output);
 		pthread_mutex_unlock(&output->interleaved_mutex);
+		reset_latency(output);
 
 		encoded_callback = (has_video && has_audio) ? interleave_packets : default_encoded_callback;
 
@@ -2437,6 +3109,11 @@ static void hook_data_capture(struct obs_output *output)
 			     output->context.name, output->delay_sec, preserve_active(output) ? "on" : "off");
 		}
 
+		if (start_mux_thread(output, encoded_callback, has_video, has_audio))
+			encoded_callback = queue_encoded_packet;
+
+		output->held_callback = output->fast_start ? encoded_callback : NULL;
+
 		if (has_audio)
 			start_audio_encoders(output, encoded_callback);
 		if (has_video)
@@ -2634,6 +3311,25 @@ static void reset_raw_output(obs_output_t *output)
 	pause_reset(&output->pause);
 }
 
+/* lets the held encoder callbacks of a fast start go, starting with the
+ * encoders' cached packets.  audio first, it has to reach back past the
+ * video keyframe for the tracks to line up */
+static void replay_gop_caches(struct obs_output *output)
+{
+	encoded_callback_t callback = output->held_callback;
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (output->audio_encoders[i])
+			obs_encoder_replay_gop_cache(output->audio_encoders[i], callback, output);
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (output->video_encoders[i])
+			obs_encoder_replay_gop_cache(output->video_encoders[i], callback, output);
+	}
+
+	output->held_callback = NULL;
+}
+
 bool obs_output_begin_data_capture(obs_output_t *output, uint32_t flags)
 {
 	UNUSED_PARAMETER(flags);
@@ -2647,6 +3343,7 @@ bool obs_output_begin_data_capture(obs_output_t *output, uint32_t flags)
 		return false;
 
 	output->total_frames = 0;
+	output->buffer_dropped_frames = 0;
 
 	if (!flag_encoded(output))
 		reset_raw_output(output);
@@ -2666,6 +3363,9 @@ bool obs_output_begin_data_capture(obs_output_t *output, uint32_t flags)
 	do_output_signal(output, "activate");
 	os_atomic_set_bool(&output->active, true);
 
+	if (output->held_callback)
+		replay_gop_caches(output);
+
 	if (reconnecting(output)) {
 		signal_reconnect_success(output);
 		os_atomic_set_bool(&output->reconnecting, false);
@@ -2719,7 +3419,9 @@ static void *end_data_capture_thread(void *data)
 	bool has_audio = flag_audio(output);
 
 	if (flag_encoded(output)) {
-		if (output->active_delay_ns)
+		if (output->mux_thread_active)
+			encoded_callback = queue_encoded_packet;
+		else if (output->active_delay_ns)
 			encoded_callback = process_delay;
 		else
 			encoded_callback = (has_video && has_audio) ? interleave_packets : default_encoded_callback;
@@ -2728,6 +3430,8 @@ static void *end_data_capture_thread(void *data)
 			stop_video_encoders(output, encoded_callback);
 		if (has_audio)
 			stop_audio_encoders(output, encoded_callback);
+
+		stop_mux_thread(output);
 	} else {
 		if (has_video)
 			stop_raw_video(output->video, default_raw_video_callback, output);
@@ -3190,3 +3894,72 @@ void obs_output_remove_packet_callback(obs_output_t *output,
 	da_erase_item(output->pkt_callbacks, &data);
 	pthread_mutex_unlock(&output->pkt_callbacks_mutex);
 }
+
+void obs_output_packet_written(obs_output_t *output, const struct encoder_packet *packet)
+{
+	if (!obs_output_valid(output, "obs_output_packet_written") ||
+	    !obs_ptr_valid(packet, "obs_output_packet_written"))
+		return;
+	if (packet->type != OBS_ENCODER_VIDEO || packet->track_idx >= MAX_OUTPUT_VIDEO_ENCODERS)
+		return;
+
+	const uint64_t now = os_gettime_ns();
+	struct obs_output_latency_stats *stats = &output->latency[packet->track_idx];
+
+	os_atomic_set_bool(&output->latency_reports_writes, true);
+
+	pthread_mutex_lock(&output->latency_mutex);
+
+	/* packets are written in the order they were interleaved, so the ones
+	 * before the match were dropped by the output */
+	for (size_t i = 0; i < output->latency_pending[packet->track_idx].num; i++) {
+		struct output_latency_pending pending = output->latency_pending[packet->track_idx].array[i];
+
+		if (pending.pts != packet->pts)
+			continue;
+
+		da_erase_range(output->latency_pending[packet->track_idx], 0, i + 1);
+
+		latency_begin(output);
+		latency_add(&stats->stages[OBS_OUTPUT_LATENCY_SEND], pending.pir, now);
+		latency_add(&stats->stages[OBS_OUTPUT_LATENCY_TOTAL], pending.cts, now);
+		latency_end(output);
+		break;
+	}
+
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
+bool obs_output_get_latency_stats(const obs_output_t *output, size_t track, struct obs_output_latency_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_latency_stats") ||
+	    !obs_ptr_valid(stats, "obs_output_get_latency_stats"))
+		return false;
+	if (track >= MAX_OUTPUT_VIDEO_ENCODERS)
+		return false;
+
+	for (;;) {
+		long seq = os_atomic_load_long(&output->latency_seq);
+		if (seq & 1)
+			continue;
+
+		*stats = output->latency[track];
+
+		if (os_atomic_load_long(&output->latency_seq) == seq)
+			break;
+	}
+
+	return true;
+}
+
+static const char *latency_stage_names[OBS_OUTPUT_LATENCY_STAGE_COUNT] = {
+	"composite", "encode", "interleave", "send", "total",
+};
+
+const char *obs_output_latency_stage_name(enum obs_output_latency_stage stage)
+{
+	if (stage < 0 || stage >= OBS_OUTPUT_LATENCY_STAGE_COUNT)
+		return "unknown";
+
+	return latency_stage_names[stage];
+}
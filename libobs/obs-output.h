@@ -85,6 +85,9 @@ struct obs_output_info {
 
 	/* required if OBS_OUTPUT_SERVICE */
 	const char *protocols;
+
+	/* bytes of packets the output holds on to and hasn't sent */
+	uint64_t (*get_buffered_bytes)(void *data);
 };
 
 EXPORT void obs_register_output_s(const struct obs_output_info *info, size_t size);
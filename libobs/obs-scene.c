@@ -19,6 +19,7 @@
 #include "util/threading.h"
 #include "util/util_uint64.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-mix.h"
 #include "obs-scene.h"
 #include "obs-internal.h"
 
@@ -238,6 +239,15 @@ static void scene_destroy(void *data)
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
 	da_free(scene->mix_sources);
+	da_free(scene->draw_items);
+	da_free(scene->draw_transforms);
+	da_free(scene->draw_inv_box_transforms);
+	da_free(scene->draw_hide_transitions);
+	da_free(scene->draw_visible);
+	da_free(scene->draw_box_mins);
+	da_free(scene->draw_box_maxs);
+	da_free(scene->grid_items);
+	da_free(scene->grid_marks);
 	bfree(scene);
 }
 
@@ -292,8 +302,133 @@ static void scene_enum_all_sources(void *data, obs_source_enum_proc_t enum_callb
 	scene_enum_sources(data, enum_callback, param, false);
 }
 
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
+
+static inline void mark_scene_changed(struct obs_scene *scene)
+{
+	if (scene) {
+		os_atomic_set_bool(&scene->draw_cache_valid, false);
+		if (scene->source)
+			obs_source_mark_video_changed(scene->source);
+	}
+}
+
+static inline int grid_cell(float pos, float cell_size)
+{
+	/* also false for NaN */
+	if (!(pos >= 0.0f))
+		return 0;
+
+	float cell = pos / cell_size;
+	return cell < (float)(SCENE_GRID_CELLS - 1) ? (int)cell : SCENE_GRID_CELLS - 1;
+}
+
+static inline bool get_grid_cells(const struct obs_scene *scene, const struct vec2 *min, const struct vec2 *max,
+				  int *x1, int *y1, int *x2, int *y2)
+{
+	/* boxes of degenerate transforms can't be hit */
+	if (!isfinite(min->x) || !isfinite(min->y) || !isfinite(max->x) || !isfinite(max->y))
+		return false;
+
+	*x1 = grid_cell(min->x, scene->grid_cell_size.x);
+	*y1 = grid_cell(min->y, scene->grid_cell_size.y);
+	*x2 = grid_cell(max->x, scene->grid_cell_size.x);
+	*y2 = grid_cell(max->y, scene->grid_cell_size.y);
+	return true;
+}
+
+/* assumes video lock */
+static void update_draw_grid(struct obs_scene *scene)
+{
+	const size_t num = scene->draw_items.num;
+	uint32_t *offsets = scene->grid_offsets;
+	int x1, y1, x2, y2;
+
+	uint32_t cx = scene_getwidth(scene);
+	uint32_t cy = scene_getheight(scene);
+	vec2_set(&scene->grid_cell_size, (float)(cx ? cx : 1) / SCENE_GRID_CELLS,
+		 (float)(cy ? cy : 1) / SCENE_GRID_CELLS);
+
+	da_resize(scene->draw_box_mins, num);
+	da_resize(scene->draw_box_maxs, num);
+	da_resize(scene->grid_marks, num);
+	memset(scene->grid_marks.array, 0, num * sizeof(uint32_t));
+	scene->grid_mark = 0;
+
+	/* count per cell, then turn the counts into offsets and fill the
+	 * cells in draw order */
+	memset(offsets, 0, sizeof(scene->grid_offsets));
+
+	for (size_t i = 0; i < num; i++) {
+		struct obs_scene_item *item = scene->draw_items.array[i];
+
+		scene->draw_box_mins.array[i] = item->box_min;
+		scene->draw_box_maxs.array[i] = item->box_max;
+
+		if (!get_grid_cells(scene, &item->box_min, &item->box_max, &x1, &y1, &x2, &y2))
+			continue;
+
+		for (int y = y1; y <= y2; y++)
+			for (int x = x1; x <= x2; x++)
+				offsets[y * SCENE_GRID_CELLS + x + 1]++;
+	}
+
+	for (size_t i = 1; i <= SCENE_GRID_CELLS * SCENE_GRID_CELLS; i++)
+		offsets[i] += offsets[i - 1];
+
+	da_resize(scene->grid_items, offsets[SCENE_GRID_CELLS * SCENE_GRID_CELLS]);
+
+	uint32_t fill[SCENE_GRID_CELLS * SCENE_GRID_CELLS];
+	memcpy(fill, offsets, sizeof(fill));
+
+	for (size_t i = 0; i < num; i++) {
+		if (!get_grid_cells(scene, &scene->draw_box_mins.array[i], &scene->draw_box_maxs.array[i], &x1, &y1,
+				    &x2, &y2))
+			continue;
+
+		for (int y = y1; y <= y2; y++)
+			for (int x = x1; x <= x2; x++)
+				scene->grid_items.array[fill[y * SCENE_GRID_CELLS + x]++] = (uint32_t)i;
+	}
+}
+
+/* assumes video lock */
+static void update_draw_cache(struct obs_scene *scene)
+{
+	size_t num = 0;
+
+	if (os_atomic_set_bool(&scene->draw_cache_valid, true))
+		return;
+
+	scene->draw_cache_version++;
+
+	for (struct obs_scene_item *item = scene->first_item; item; item = item->next)
+		num++;
+
+	da_resize(scene->draw_items, num);
+	da_resize(scene->draw_transforms, num);
+	da_resize(scene->draw_inv_box_transforms, num);
+	da_resize(scene->draw_hide_transitions, num);
+	da_resize(scene->draw_visible, num);
+
+	num = 0;
+	for (struct obs_scene_item *item = scene->first_item; item; item = item->next) {
+		scene->draw_items.array[num] = item;
+		scene->draw_transforms.array[num] = item->draw_transform;
+		scene->draw_inv_box_transforms.array[num] = item->inv_box_transform;
+		scene->draw_hide_transitions.array[num] = item->hide_transition;
+		scene->draw_visible.array[num] = item->user_visible;
+		num++;
+	}
+
+	update_draw_grid(scene);
+}
+
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
+	mark_scene_changed(item->parent);
+
 	if (item->prev)
 		item->prev->next = item->next;
 	else
@@ -309,6 +444,7 @@ static inline void attach_sceneitem(struct obs_scene *parent, struct obs_scene_i
 {
 	item->prev = prev;
 	item->parent = parent;
+	mark_scene_changed(parent);
 
 	if (prev) {
 		item->next = prev->next;
@@ -336,9 +472,6 @@ void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy)
 		v->y += (float)(cy / 2);
 }
 
-static uint32_t scene_getwidth(void *data);
-static uint32_t scene_getheight(void *data);
-
 static inline void get_scene_dimensions(const obs_sceneitem_t *item, float *x, float *y)
 {
 	obs_scene_t *parent = item->parent;
@@ -594,7 +727,53 @@ static inline void update_nested_scene_crop(struct obs_scene_item *item, uint32_
 	item->crop.bottom = (int)((float)item->crop.bottom * scale_y);
 }
 
-static void update_item_transform(struct obs_scene_item *item, bool update_tex)
+static void update_item_box_bounds(struct obs_scene_item *item)
+{
+	const struct matrix4 *m = &item->box_transform;
+	struct vec2 corners[3];
+
+	matrix4_inv(&item->inv_box_transform, m);
+
+	vec2_set(&item->box_min, m->t.x, m->t.y);
+	vec2_set(&corners[0], m->t.x + m->x.x, m->t.y + m->x.y);
+	vec2_set(&corners[1], m->t.x + m->y.x, m->t.y + m->y.y);
+	vec2_set(&corners[2], m->t.x + m->x.x + m->y.x, m->t.y + m->x.y + m->y.y);
+	item->box_max = item->box_min;
+
+	for (size_t i = 0; i < 3; i++) {
+		vec2_min(&item->box_min, &item->box_min, &corners[i]);
+		vec2_max(&item->box_max, &item->box_max, &corners[i]);
+	}
+}
+
+static void update_item_render_bounds(struct obs_scene_item *item, uint32_t width, uint32_t height)
+{
+	struct vec3 corners[4];
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], (float)width, 0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, (float)height, 0.0f);
+	vec3_set(&corners[3], (float)width, (float)height, 0.0f);
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec2 corner;
+
+		vec3_transform(&corners[i], &corners[i], &item->draw_transform);
+		vec2_set(&corner, corners[i].x, corners[i].y);
+
+		if (i == 0) {
+			item->render_min = corner;
+			item->render_max = corner;
+		} else {
+			vec2_min(&item->render_min, &item->render_min, &corner);
+			vec2_max(&item->render_max, &item->render_max, &corner);
+		}
+	}
+}
+
+/* recalculates the transforms of an item without signaling the change,
+ * returns false if updates of the item are deferred */
+static bool calc_item_transform(struct obs_scene_item *item, bool update_tex)
 {
 	uint32_t width;
 	uint32_t height;
@@ -604,11 +783,11 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	struct vec2 origin;
 	struct vec2 scale;
 	struct vec2 position;
-	struct calldata params;
-	uint8_t stack[128];
 
 	if (os_atomic_load_long(&item->defer_update) > 0)
-		return;
+		return false;
+
+	mark_scene_changed(item->parent);
 
 	/* Reset bounds crop */
 	memset(&item->bounds_crop, 0, sizeof(item->bounds_crop));
@@ -663,6 +842,8 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	item->output_scale = scale;
 
+	update_item_render_bounds(item, width, height);
+
 	/* ----------------------- */
 
 	if (item->bounds_type != OBS_BOUNDS_NONE) {
@@ -685,15 +866,31 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	matrix4_rotate_aa4f(&item->box_transform, &item->box_transform, 0.0f, 0.0f, 1.0f, RAD(item->rot));
 	matrix4_translate3f(&item->box_transform, &item->box_transform, position.x, position.y, 0.0f);
 
+	update_item_box_bounds(item);
+
 #ifdef DEBUG_TRANSFORM
 	log_matrix(&item->draw_transform, "box_transform");
 #endif
 
-	/* ----------------------- */
+	return true;
+}
+
+static inline void signal_item_transform(struct obs_scene_item *item)
+{
+	struct calldata params;
+	uint8_t stack[128];
 
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "item", item);
 	signal_parent(item->parent, "item_transform", &params);
+}
+
+static void update_item_transform(struct obs_scene_item *item, bool update_tex)
+{
+	if (!calc_item_transform(item, update_tex))
+		return;
+
+	signal_item_transform(item);
 
 	if (!update_tex)
 		return;
@@ -736,64 +933,57 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	       (item_is_scene(item) && !item->is_group);
 }
 
-static void render_item_texture(struct obs_scene_item *item, enum gs_color_space current_space,
-				enum gs_color_space source_space)
+/* nested scenes render the same texture regardless of the item, so it can
+ * be shared with every other item using that scene.  cropped items sample
+ * their part of the full texture */
+static inline bool item_texture_shareable(const struct obs_scene_item *item)
 {
-	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
-	if (!tex) {
-		return;
-	}
-
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE, "render_item_texture");
-
-	gs_effect_t *effect = obs->video.default_effect;
-	enum obs_scale_type type = item->scale_filter;
-	uint32_t cx = gs_texture_get_width(tex);
-	uint32_t cy = gs_texture_get_height(tex);
+	return item_is_scene(item) && !item->is_group && !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition);
+}
 
-	bool upscale = false;
-	if (type != OBS_SCALE_DISABLE) {
-		if (type == OBS_SCALE_POINT) {
-			gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-			gs_effect_set_next_sampler(image, obs->video.point_sampler);
+static inline bool item_texture_cropped(const struct obs_scene_item *item)
+{
+	return crop_enabled(&item->crop) || crop_enabled(&item->bounds_crop);
+}
 
-		} else if (!close_float(item->output_scale.x, 1.0f, EPSILON) ||
-			   !close_float(item->output_scale.y, 1.0f, EPSILON)) {
-			if (item->output_scale.x < 0.5f || item->output_scale.y < 0.5f) {
-				effect = obs->video.bilinear_lowres_effect;
-			} else if (type == OBS_SCALE_BICUBIC) {
-				effect = obs->video.bicubic_effect;
-			} else if (type == OBS_SCALE_LANCZOS) {
-				effect = obs->video.lanczos_effect;
-			} else if (type == OBS_SCALE_AREA) {
-				effect = obs->video.area_effect;
-				upscale = (item->output_scale.x >= 1.0f) && (item->output_scale.y >= 1.0f);
-			}
+/* obs_source_draw for the cropped part of a shared nested scene texture */
+static void draw_texture_crop(gs_texture_t *tex, const struct obs_scene_item *item)
+{
+	gs_effect_t *effect = gs_get_effect();
+	const bool linear_srgb = gs_get_linear_srgb();
+	const bool previous = gs_framebuffer_srgb_enabled();
+	uint32_t width = gs_texture_get_width(tex);
+	uint32_t height = gs_texture_get_height(tex);
 
-			gs_eparam_t *const scale_param = gs_effect_get_param_by_name(effect, "base_dimension");
-			if (scale_param) {
-				struct vec2 base_res = {(float)cx, (float)cy};
+	gs_enable_framebuffer_srgb(linear_srgb);
 
-				gs_effect_set_vec2(scale_param, &base_res);
-			}
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+		gs_effect_set_texture(image, tex);
 
-			gs_eparam_t *const scale_i_param = gs_effect_get_param_by_name(effect, "base_dimension_i");
-			if (scale_i_param) {
-				struct vec2 base_res_i = {1.0f / (float)cx, 1.0f / (float)cy};
+	gs_draw_sprite_subregion(tex, 0, item->crop.left + item->bounds_crop.left,
+				 item->crop.top + item->bounds_crop.top, calc_cx(item, width),
+				 calc_cy(item, height));
 
-				gs_effect_set_vec2(scale_i_param, &base_res_i);
-			}
-		}
-	}
+	gs_enable_framebuffer_srgb(previous);
+}
 
-	float multiplier = 1.f;
+/* technique of the scaling effects converting the item texture from the
+ * source color space to the current one */
+static const char *item_draw_technique(bool upscale, enum gs_color_space current_space,
+				       enum gs_color_space source_space, float *multiplier)
+{
+	*multiplier = 1.f;
 
 	if (current_space == GS_CS_709_SCRGB) {
 		switch (source_space) {
 		case GS_CS_SRGB:
 		case GS_CS_SRGB_16F:
 		case GS_CS_709_EXTENDED:
-			multiplier = obs_get_video_sdr_white_level() / 80.f;
+			*multiplier = obs_get_video_sdr_white_level() / 80.f;
 			break;
 		case GS_CS_709_SCRGB:
 			break;
@@ -805,7 +995,7 @@ static void render_item_texture(struct obs_scene_item *item, enum gs_color_space
 		case GS_CS_SRGB:
 		case GS_CS_SRGB_16F:
 		case GS_CS_709_EXTENDED:
-			multiplier = 80.f / obs_get_video_sdr_white_level();
+			*multiplier = 80.f / obs_get_video_sdr_white_level();
 			break;
 		case GS_CS_709_SCRGB:
 			break;
@@ -856,6 +1046,68 @@ static void render_item_texture(struct obs_scene_item *item, enum gs_color_space
 		}
 	}
 
+	return tech_name;
+}
+
+static void render_item_texture(struct obs_scene_item *item, gs_texrender_t *texrender, bool shared,
+				enum gs_color_space current_space, enum gs_color_space source_space)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(texrender);
+	if (!tex) {
+		return;
+	}
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE, "render_item_texture");
+
+	gs_effect_t *effect = obs->video.default_effect;
+	enum obs_scale_type type = item->scale_filter;
+	uint32_t cx = gs_texture_get_width(tex);
+
+	/* over the render budget, the costlier filters fall back to bilinear */
+	if ((type == OBS_SCALE_BICUBIC || type == OBS_SCALE_LANCZOS || type == OBS_SCALE_AREA) &&
+	    obs_get_render_degradation() >= OBS_RENDER_DEGRADATION_SCALING)
+		type = OBS_SCALE_BILINEAR;
+
+	uint32_t cy = gs_texture_get_height(tex);
+
+	bool upscale = false;
+	if (type != OBS_SCALE_DISABLE) {
+		if (type == OBS_SCALE_POINT) {
+			gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+			gs_effect_set_next_sampler(image, obs->video.point_sampler);
+
+		} else if (!close_float(item->output_scale.x, 1.0f, EPSILON) ||
+			   !close_float(item->output_scale.y, 1.0f, EPSILON)) {
+			if (item->output_scale.x < 0.5f || item->output_scale.y < 0.5f) {
+				effect = obs->video.bilinear_lowres_effect;
+			} else if (type == OBS_SCALE_BICUBIC) {
+				effect = obs->video.bicubic_effect;
+			} else if (type == OBS_SCALE_LANCZOS) {
+				effect = obs->video.lanczos_effect;
+			} else if (type == OBS_SCALE_AREA) {
+				effect = obs->video.area_effect;
+				upscale = (item->output_scale.x >= 1.0f) && (item->output_scale.y >= 1.0f);
+			}
+
+			gs_eparam_t *const scale_param = gs_effect_get_param_by_name(effect, "base_dimension");
+			if (scale_param) {
+				struct vec2 base_res = {(float)cx, (float)cy};
+
+				gs_effect_set_vec2(scale_param, &base_res);
+			}
+
+			gs_eparam_t *const scale_i_param = gs_effect_get_param_by_name(effect, "base_dimension_i");
+			if (scale_i_param) {
+				struct vec2 base_res_i = {1.0f / (float)cx, 1.0f / (float)cy};
+
+				gs_effect_set_vec2(scale_i_param, &base_res_i);
+			}
+		}
+	}
+
+	float multiplier;
+	const char *tech_name = item_draw_technique(upscale, current_space, source_space, &multiplier);
+
 	gs_eparam_t *const multiplier_param = gs_effect_get_param_by_name(effect, "multiplier");
 	if (multiplier_param)
 		gs_effect_set_float(multiplier_param, multiplier);
@@ -868,15 +1120,21 @@ static void render_item_texture(struct obs_scene_item *item, enum gs_color_space
 				   obs_blend_mode_params[item->blend_type].dst_alpha);
 	gs_blend_op(obs_blend_mode_params[item->blend_type].op);
 
-	while (gs_effect_loop(effect, tech_name))
-		obs_source_draw(tex, 0, 0, 0, 0, 0);
+	const bool crop = shared && item_texture_cropped(item);
+
+	while (gs_effect_loop(effect, tech_name)) {
+		if (crop)
+			draw_texture_crop(tex, item);
+		else
+			obs_source_draw(tex, 0, 0, 0, 0, 0);
+	}
 
 	gs_blend_state_pop();
 
 	GS_DEBUG_MARKER_END();
 }
 
-static bool are_texcoords_centered(struct matrix4 *m)
+static bool are_texcoords_centered(const struct matrix4 *m)
 {
 	static const struct matrix4 identity = {
 		{1.0f, 0.0f, 0.0f, 0.0f},
@@ -890,27 +1148,32 @@ static bool are_texcoords_centered(struct matrix4 *m)
 	return memcmp(m, &copy, sizeof(*m)) == 0;
 }
 
-static inline void render_item(struct obs_scene_item *item)
+static inline void render_item(struct obs_scene_item *item, const struct matrix4 *draw_transform)
 {
 	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s", obs_source_get_name(item->source));
 
 	const bool use_texrender = item_texture_enabled(item);
+	const bool share_texrender = use_texrender && item_texture_shareable(item);
 
 	obs_source_t *const source = item->source;
 	const enum gs_color_space current_space = gs_get_color_space();
 	const enum gs_color_space source_space = obs_source_get_color_space(source, 1, &current_space);
 	const enum gs_color_format format = gs_get_format_from_space(source_space);
 
-	if (item->item_render && (!use_texrender || (gs_texrender_get_format(item->item_render) != format))) {
+	if (item->item_render && (!use_texrender || share_texrender ||
+				  (gs_texrender_get_format(item->item_render) != format))) {
 		gs_texrender_destroy(item->item_render);
 		item->item_render = NULL;
 	}
 
-	if (!item->item_render && use_texrender) {
-		item->item_render = gs_texrender_create(format, GS_ZS_NONE);
+	if (!item->item_render && use_texrender && !share_texrender) {
+		item->item_render = gs_texrender_create_pooled(format, GS_ZS_NONE);
 	}
 
-	if (item->item_render) {
+	gs_texrender_t *const texrender = share_texrender ? obs_get_shared_texrender(source, source_space)
+							  : item->item_render;
+
+	if (texrender) {
 		uint32_t width = obs_source_get_width(item->source);
 		uint32_t height = obs_source_get_height(item->source);
 
@@ -918,10 +1181,15 @@ static inline void render_item(struct obs_scene_item *item)
 			goto cleanup;
 		}
 
-		uint32_t cx = calc_cx(item, width);
-		uint32_t cy = calc_cy(item, height);
+		/* the shared texture is the whole scene, and is only drawn by
+		 * the first item to use it during the frame */
+		uint32_t cx = share_texrender ? width : calc_cx(item, width);
+		uint32_t cy = share_texrender ? height : calc_cy(item, height);
 
-		if (cx && cy && gs_texrender_begin_with_color_space(item->item_render, cx, cy, source_space)) {
+		if (share_texrender && (!calc_cx(item, width) || !calc_cy(item, height)))
+			goto cleanup;
+
+		if (cx && cy && gs_texrender_begin_with_color_space(texrender, cx, cy, source_space)) {
 			float cx_scale = (float)width / (float)cx;
 			float cy_scale = (float)height / (float)cy;
 			struct vec4 clear_color;
@@ -930,9 +1198,11 @@ static inline void render_item(struct obs_scene_item *item)
 			gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
 			gs_ortho(0.0f, (float)width, 0.0f, (float)height, -100.0f, 100.0f);
 
-			gs_matrix_scale3f(cx_scale, cy_scale, 1.0f);
-			gs_matrix_translate3f(-(float)(item->crop.left + item->bounds_crop.left),
-					      -(float)(item->crop.top + item->bounds_crop.top), 0.0f);
+			if (!share_texrender) {
+				gs_matrix_scale3f(cx_scale, cy_scale, 1.0f);
+				gs_matrix_translate3f(-(float)(item->crop.left + item->bounds_crop.left),
+						      -(float)(item->crop.top + item->bounds_crop.top), 0.0f);
+			}
 
 			if (item->user_visible && transition_active(item->show_transition)) {
 				const int cx = obs_source_get_width(item->source);
@@ -950,16 +1220,16 @@ static inline void render_item(struct obs_scene_item *item)
 				obs_source_set_texcoords_centered(item->source, false);
 			}
 
-			gs_texrender_end(item->item_render);
+			gs_texrender_end(texrender);
 		}
 	}
 
-	const bool linear_srgb = !item->item_render || (item->blend_method != OBS_BLEND_METHOD_SRGB_OFF);
+	const bool linear_srgb = !texrender || (item->blend_method != OBS_BLEND_METHOD_SRGB_OFF);
 	const bool previous = gs_set_linear_srgb(linear_srgb);
 	gs_matrix_push();
-	gs_matrix_mul(&item->draw_transform);
-	if (item->item_render) {
-		render_item_texture(item, current_space, source_space);
+	gs_matrix_mul(draw_transform);
+	if (texrender) {
+		render_item_texture(item, texrender, share_texrender, current_space, source_space);
 	} else if (item->user_visible && transition_active(item->show_transition)) {
 		const int cx = obs_source_get_width(item->source);
 		const int cy = obs_source_get_height(item->source);
@@ -971,7 +1241,7 @@ static inline void render_item(struct obs_scene_item *item)
 		obs_transition_set_size(item->hide_transition, cx, cy);
 		obs_source_video_render(item->hide_transition);
 	} else {
-		const bool centered = are_texcoords_centered(&item->draw_transform);
+		const bool centered = are_texcoords_centered(draw_transform);
 		obs_source_set_texcoords_centered(item->source, centered);
 		obs_source_video_render(item->source);
 		obs_source_set_texcoords_centered(item->source, false);
@@ -983,6 +1253,89 @@ cleanup:
 	GS_DEBUG_MARKER_END();
 }
 
+/* items of the same source without crop, scale filtering, custom blending or
+ * transitions only differ in their transform, so the source can be rendered
+ * once and drawn for all of them in a single batch */
+static inline bool item_batchable(const struct obs_scene_item *item)
+{
+	return !item->is_group && !item_is_scene(item) && !item_texture_enabled(item) &&
+	       !transition_active(item->show_transition) && !transition_active(item->hide_transition);
+}
+
+static void render_item_batch(struct obs_scene_item *const *items, const struct matrix4 *draw_transforms,
+			      size_t count)
+{
+	obs_source_t *const source = items[0]->source;
+	const enum gs_color_space current_space = gs_get_color_space();
+	const enum gs_color_space source_space = obs_source_get_color_space(source, 1, &current_space);
+	const uint32_t width = obs_source_get_width(source);
+	const uint32_t height = obs_source_get_height(source);
+
+	if (!width || !height)
+		return;
+
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item batch: %s (%zu)", obs_source_get_name(source), count);
+
+	gs_texrender_t *const texrender = obs_get_shared_texrender(source, source_space);
+	if (!texrender) {
+		for (size_t i = 0; i < count; i++)
+			render_item(items[i], &draw_transforms[i]);
+		goto cleanup;
+	}
+
+	/* another batch of the same source may have rendered it this frame */
+	if (gs_texrender_begin_with_color_space(texrender, width, height, source_space)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)width, 0.0f, (float)height, -100.0f, 100.0f);
+
+		obs_source_set_texcoords_centered(source, true);
+		obs_source_video_render(source);
+		obs_source_set_texcoords_centered(source, false);
+
+		gs_texrender_end(texrender);
+	}
+
+	gs_texture_t *const tex = gs_texrender_get_texture(texrender);
+	if (!tex)
+		goto cleanup;
+
+	gs_effect_t *const effect = obs->video.default_effect;
+	float multiplier;
+	const char *tech_name = item_draw_technique(false, current_space, source_space, &multiplier);
+
+	gs_eparam_t *const multiplier_param = gs_effect_get_param_by_name(effect, "multiplier");
+	if (multiplier_param)
+		gs_effect_set_float(multiplier_param, multiplier);
+
+	const bool previous = gs_set_linear_srgb(true);
+	const bool previous_srgb = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+
+	const enum obs_blending_type blend_type = items[0]->blend_type;
+	gs_blend_state_push();
+	gs_blend_function_separate(obs_blend_mode_params[blend_type].src_color,
+				   obs_blend_mode_params[blend_type].dst_color,
+				   obs_blend_mode_params[blend_type].src_alpha,
+				   obs_blend_mode_params[blend_type].dst_alpha);
+	gs_blend_op(obs_blend_mode_params[blend_type].op);
+
+	gs_eparam_t *const image = gs_effect_get_param_by_name(effect, "image");
+	while (gs_effect_loop(effect, tech_name)) {
+		gs_effect_set_texture_srgb(image, tex);
+		gs_draw_sprite_batch(tex, 0, 0, 0, draw_transforms, count);
+	}
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous_srgb);
+	gs_set_linear_srgb(previous);
+
+cleanup:
+	GS_DEBUG_MARKER_END();
+}
+
 static void scene_video_tick(void *data, float seconds)
 {
 	struct obs_scene *scene = data;
@@ -1052,11 +1405,56 @@ static inline bool scene_size_changed(obs_scene_t *scene)
 	return true;
 }
 
+static inline bool item_outside_scene(const struct obs_scene_item *item, float cx, float cy)
+{
+	const struct vec2 *min = &item->render_min;
+	const struct vec2 *max = &item->render_max;
+
+	return max->x <= 0.0f || max->y <= 0.0f || min->x >= cx || min->y >= cy;
+}
+
+static inline bool draw_item_shown(const struct obs_scene *scene, size_t idx, float cx, float cy)
+{
+	const struct obs_scene_item *item = scene->draw_items.array[idx];
+	bool hiding = transition_active(scene->draw_hide_transitions.array[idx]);
+
+	if (!scene->draw_visible.array[idx] && !hiding)
+		return false;
+
+	/* nothing of items entirely outside of the scene ends up on screen,
+	 * so don't draw them and leave their sources unrendered.  groups
+	 * draw into their parent, so they aren't bound by their own size */
+	return scene->is_group || hiding || transition_active(item->show_transition) ||
+	       !item_outside_scene(item, cx, cy);
+}
+
+/* number of consecutive draw items starting at idx that can be drawn as one
+ * batch */
+static size_t draw_item_batch_count(const struct obs_scene *scene, size_t idx, float cx, float cy)
+{
+	const struct obs_scene_item *item = scene->draw_items.array[idx];
+	size_t count = 1;
+
+	if (!item_batchable(item))
+		return 1;
+
+	while (idx + count < scene->draw_items.num) {
+		const struct obs_scene_item *next = scene->draw_items.array[idx + count];
+
+		if (next->source != item->source || next->blend_type != item->blend_type || !item_batchable(next) ||
+		    !draw_item_shown(scene, idx + count, cx, cy))
+			break;
+
+		count++;
+	}
+
+	return count;
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	obs_scene_item_ptr_array_t remove_items;
 	struct obs_scene *scene = data;
-	struct obs_scene_item *item;
 
 	da_init(remove_items);
 
@@ -1067,15 +1465,28 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items, NULL, size_changed);
 	}
 
+	update_draw_cache(scene);
+
+	const float cx = (float)scene_getwidth(scene);
+	const float cy = (float)scene_getheight(scene);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
-	item = scene->first_item;
-	while (item) {
-		if (item->user_visible || transition_active(item->hide_transition))
-			render_item(item);
+	for (size_t i = 0; i < scene->draw_items.num; i++) {
+		struct obs_scene_item *item = scene->draw_items.array[i];
 
-		item = item->next;
+		if (!draw_item_shown(scene, i, cx, cy))
+			continue;
+
+		size_t count = draw_item_batch_count(scene, i, cx, cy);
+		if (count > 1) {
+			render_item_batch(scene->draw_items.array + i, scene->draw_transforms.array + i, count);
+			i += count - 1;
+			continue;
+		}
+
+		render_item(item, &scene->draw_transforms.array[i]);
 	}
 
 	gs_blend_state_pop();
@@ -1089,6 +1500,38 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+/* assumes video lock */
+static bool scene_items_changed(struct obs_scene *scene)
+{
+	for (struct obs_scene_item *item = scene->first_item; item; item = item->next) {
+		/* pending transform updates and pruning happen while rendering */
+		if (obs_source_removed(item->source))
+			return true;
+		if (os_atomic_load_bool(&item->update_transform) || source_size_changed(item))
+			return true;
+
+		if (transition_active(item->show_transition) || transition_active(item->hide_transition))
+			return true;
+		if (item->user_visible && obs_source_video_changed(item->source))
+			return true;
+	}
+
+	return false;
+}
+
+bool obs_scene_video_changed(obs_scene_t *scene)
+{
+	bool changed;
+
+	video_lock(scene);
+	changed = (!scene->is_group && (scene_getwidth(scene) != scene->last_width ||
+					scene_getheight(scene) != scene->last_height)) ||
+		  scene_items_changed(scene);
+	video_unlock(scene);
+
+	return changed;
+}
+
 static void set_visibility(struct obs_scene_item *item, bool vis)
 {
 	pthread_mutex_lock(&item->actions_mutex);
@@ -1105,6 +1548,7 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	os_atomic_set_long(&item->active_refs, vis ? 1 : 0);
 	item->visible = vis;
 	item->user_visible = vis;
+	mark_scene_changed(item->parent);
 
 	pthread_mutex_unlock(&item->actions_mutex);
 }
@@ -1478,6 +1922,7 @@ static uint32_t scene_getheight(void *data)
 static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *buf, uint64_t ts, size_t sample_rate)
 {
 	bool cur_visible = item->visible;
+	const uint64_t frames = obs->audio.frames_per_tick;
 	uint64_t frame_num = 0;
 	size_t deref_count = 0;
 
@@ -1493,7 +1938,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *b
 
 		new_frame_num = util_mul_div64(timestamp - ts, sample_rate, 1000000000ULL);
 
-		if (ts && new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (ts && new_frame_num >= frames)
 			break;
 
 		da_erase(item->audio_actions, i--);
@@ -1511,7 +1956,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item, float *b
 	}
 
 	if (buf) {
-		for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+		for (; frame_num < frames; frame_num++)
 			buf[frame_num] = cur_visible ? 1.0f : 0.0f;
 	}
 
@@ -1538,7 +1983,7 @@ static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf, uin
 	pthread_mutex_unlock(&item->actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = util_mul_div64(AUDIO_OUTPUT_FRAMES, 1000000000ULL, sample_rate);
+		uint64_t duration = util_mul_div64(obs->audio.frames_per_tick, 1000000000ULL, sample_rate);
 
 		if (!ts || action.timestamp < (ts + duration)) {
 			apply_scene_item_audio_actions(item, buf, ts, sample_rate);
@@ -1555,27 +2000,6 @@ static void process_all_audio_actions(struct obs_scene_item *item, size_t sample
 		;
 }
 
-static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in, size_t pos, size_t count)
-{
-	register float *out = p_out + pos;
-	register float *buf = buf_in;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
-}
-
-static inline void mix_audio(float *p_out, float *p_in, size_t pos, size_t count)
-{
-	register float *out = p_out + pos;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
-}
-
 static inline struct scene_source_mix *get_source_mix(struct obs_scene *scene, struct obs_source *source)
 {
 	for (size_t i = 0; i < scene->mix_sources.num; i++) {
@@ -1662,7 +2086,7 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 
 		pos = (size_t)ns_to_audio_frames(sample_rate, source_ts - timestamp);
 
-		if (pos >= AUDIO_OUTPUT_FRAMES) {
+		if (pos >= obs->audio.frames_per_tick) {
 			item = item->next;
 			continue;
 		}
@@ -1672,7 +2096,7 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 			continue;
 		}
 
-		size_t count = AUDIO_OUTPUT_FRAMES - pos;
+		size_t count = obs->audio.frames_per_tick - pos;
 
 		/* Update buf so that parent mute state applies to all current
 		 * scene items as well */
@@ -1738,22 +2162,29 @@ static bool scene_audio_render_internal(struct obs_scene *scene, struct obs_scen
 
 	for (size_t i = 0; i < scene->mix_sources.num; i++) {
 		struct scene_source_mix *source_mix = &scene->mix_sources.array[i];
-		obs_source_get_audio_mix(source_mix->transition ? source_mix->transition : source_mix->source,
-					 &child_audio);
+		obs_source_t *mix_source = source_mix->transition ? source_mix->transition : source_mix->source;
+
+		/* muted or zero volume, output buffers are all zero */
+		if (mix_source->audio_silent)
+			continue;
+
+		obs_source_get_audio_mix(mix_source, &child_audio);
+
+		/* mixes the child isn't routed to were zeroed when it rendered */
+		const uint32_t child_mixers = mixers & mix_source->audio_mixers;
 
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((child_mixers & (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
-				float *out = audio_output->output[mix].data[ch];
+				float *out = audio_output->output[mix].data[ch] + source_mix->pos;
 				float *in = child_audio.output[mix].data[ch];
 
 				if (source_mix->apply_buf)
-					mix_audio_with_buf(out, in, source_mix->buf, source_mix->pos,
-							   source_mix->count);
+					audio_mix_add_mul(out, in, source_mix->buf, source_mix->count);
 				else
-					mix_audio(out, in, source_mix->pos, source_mix->count);
+					audio_mix_add(out, in, source_mix->count);
 			}
 		}
 	}
@@ -1905,6 +2336,11 @@ static inline void duplicate_item_data(struct obs_scene_item *dst, struct obs_sc
 	dst->blend_method = src->blend_method;
 	dst->blend_type = src->blend_type;
 	dst->box_transform = src->box_transform;
+	dst->inv_box_transform = src->inv_box_transform;
+	dst->box_min = src->box_min;
+	dst->box_max = src->box_max;
+	dst->render_min = src->render_min;
+	dst->render_max = src->render_max;
 	dst->box_scale = src->box_scale;
 	dst->draw_transform = src->draw_transform;
 	dst->bounds_type = src->bounds_type;
@@ -2196,6 +2632,124 @@ void obs_scene_enum_items(obs_scene_t *scene, bool (*callback)(obs_scene_t *, ob
 	full_unlock(scene);
 }
 
+static inline bool box_contains(const struct matrix4 *box_transform, const struct matrix4 *inv_box_transform,
+				const struct vec2 *pos)
+{
+	struct vec3 pos3, box_pos, round_trip;
+
+	vec3_set(&pos3, pos->x, pos->y, 0.0f);
+	vec3_transform(&box_pos, &pos3, inv_box_transform);
+
+	/* a degenerate transform does not invert */
+	vec3_transform(&round_trip, &box_pos, box_transform);
+	if (fabsf(round_trip.x - pos3.x) > 0.01f || fabsf(round_trip.y - pos3.y) > 0.01f)
+		return false;
+
+	return box_pos.x >= 0.0f && box_pos.x <= 1.0f && box_pos.y >= 0.0f && box_pos.y <= 1.0f;
+}
+
+/* calls back for the item at idx, false if enumeration has to stop, either
+ * because the callback says so or because it changed the scene */
+static inline bool enum_cached_item(obs_scene_t *scene, size_t idx,
+				    bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	struct obs_scene_item *item = scene->draw_items.array[idx];
+	const uint32_t version = scene->draw_cache_version;
+
+	obs_sceneitem_addref(item);
+	bool keep_going = callback(scene, item, param);
+	obs_sceneitem_release(item);
+
+	return keep_going && os_atomic_load_bool(&scene->draw_cache_valid) && version == scene->draw_cache_version;
+}
+
+void obs_scene_enum_items_at(obs_scene_t *scene, const struct vec2 *pos,
+			     bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	int x, y;
+
+	if (!scene || !pos || !callback)
+		return;
+
+	full_lock(scene);
+	update_draw_cache(scene);
+
+	if (get_grid_cells(scene, pos, pos, &x, &y, &x, &y)) {
+		const size_t cell = y * SCENE_GRID_CELLS + x;
+
+		for (size_t i = scene->grid_offsets[cell]; i < scene->grid_offsets[cell + 1]; i++) {
+			const size_t idx = scene->grid_items.array[i];
+			struct obs_scene_item *item = scene->draw_items.array[idx];
+
+			if (!box_contains(&item->box_transform, &scene->draw_inv_box_transforms.array[idx], pos))
+				continue;
+			if (!enum_cached_item(scene, idx, callback, param))
+				break;
+		}
+	}
+
+	full_unlock(scene);
+}
+
+static int compare_indices(const void *a, const void *b)
+{
+	const uint32_t ia = *(const uint32_t *)a;
+	const uint32_t ib = *(const uint32_t *)b;
+	return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+void obs_scene_enum_items_in_rect(obs_scene_t *scene, const struct vec2 *min, const struct vec2 *max,
+				  bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param)
+{
+	DARRAY(uint32_t) hits;
+	int x1, y1, x2, y2;
+
+	if (!scene || !min || !max || !callback)
+		return;
+
+	da_init(hits);
+
+	full_lock(scene);
+	update_draw_cache(scene);
+
+	if (get_grid_cells(scene, min, max, &x1, &y1, &x2, &y2)) {
+		/* boxes spanning several cells are only collected once */
+		const uint32_t mark = ++scene->grid_mark;
+
+		for (int y = y1; y <= y2; y++) {
+			for (int x = x1; x <= x2; x++) {
+				const size_t cell = y * SCENE_GRID_CELLS + x;
+
+				for (size_t i = scene->grid_offsets[cell]; i < scene->grid_offsets[cell + 1]; i++) {
+					uint32_t idx = scene->grid_items.array[i];
+					const struct vec2 *box_min = &scene->draw_box_mins.array[idx];
+					const struct vec2 *box_max = &scene->draw_box_maxs.array[idx];
+
+					if (scene->grid_marks.array[idx] == mark)
+						continue;
+					if (box_max->x < min->x || box_min->x > max->x || box_max->y < min->y ||
+					    box_min->y > max->y)
+						continue;
+
+					scene->grid_marks.array[idx] = mark;
+					da_push_back(hits, &idx);
+				}
+			}
+		}
+
+		qsort(hits.array, hits.num, sizeof(*hits.array), compare_indices);
+
+		for (size_t i = 0; i < hits.num; i++) {
+			if (!enum_cached_item(scene, hits.array[i], callback, param))
+				break;
+		}
+	}
+
+	full_unlock(scene);
+
+	da_free(hits);
+}
+
 static obs_sceneitem_t *sceneitem_get_ref(obs_sceneitem_t *si)
 {
 	long owners = os_atomic_load_long(&si->ref);
@@ -2367,6 +2921,7 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene, obs_source_t
 	get_scene_dimensions(item, &item->scale_ref.x, &item->scale_ref.y);
 	matrix4_identity(&item->draw_transform);
 	matrix4_identity(&item->box_transform);
+	update_item_box_bounds(item);
 
 	/* Ensure initial position is still top-left corner in relative mode. */
 	if (!item->absolute_coordinates)
@@ -2401,6 +2956,7 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene, obs_source_t
 		}
 	}
 
+	mark_scene_changed(scene);
 	full_unlock(scene);
 
 	if (!scene->source->context.private)
@@ -3054,6 +3610,47 @@ void obs_sceneitem_set_info2(obs_sceneitem_t *item, const struct obs_transform_i
 	}
 }
 
+void obs_scene_set_items_info2(obs_scene_t *scene, obs_sceneitem_t *const *items,
+			       const struct obs_transform_info *infos, size_t num)
+{
+	obs_scene_item_ptr_array_t updated;
+
+	if (!obs_ptr_valid(scene, "obs_scene_set_items_info2") || !obs_ptr_valid(items, "obs_scene_set_items_info2") ||
+	    !obs_ptr_valid(infos, "obs_scene_set_items_info2"))
+		return;
+
+	da_init(updated);
+	da_reserve(updated, num);
+
+	/* apply everything under one lock, so the next frame either has
+	 * none or all of the changes, and tell listeners afterwards */
+	full_lock(scene);
+
+	for (size_t i = 0; i < num; i++) {
+		obs_sceneitem_t *item = items[i];
+
+		if (!item || !item->parent || (item->parent != scene && !item->parent->is_group)) {
+			blog(LOG_WARNING, "obs_scene_set_items_info2: item %zu is not in this scene", i);
+			continue;
+		}
+
+		scene_item_set_info_internal(item, &infos[i]);
+		item->crop_to_bounds = infos[i].crop_to_bounds;
+
+		if (item->parent->is_group)
+			os_atomic_set_bool(&item->update_transform, true);
+		else if (calc_item_transform(item, false))
+			da_push_back(updated, &item);
+	}
+
+	full_unlock(scene);
+
+	for (size_t i = 0; i < updated.num; i++)
+		signal_item_transform(updated.array[i]);
+
+	da_free(updated);
+}
+
 void obs_sceneitem_get_draw_transform(const obs_sceneitem_t *item, struct matrix4 *transform)
 {
 	if (item)
@@ -3108,6 +3705,7 @@ bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
 		obs_sceneitem_group_enum_items(item, group_item_transition, &visible);
 
 	item->user_visible = visible;
+	mark_scene_changed(item->parent);
 
 	if (visible) {
 		if (os_atomic_inc_long(&item->active_refs) == 1) {
@@ -3223,6 +3821,7 @@ bool obs_scene_reorder_items(obs_scene_t *scene, obs_sceneitem_t *const *item_or
 		prev = item_order[i];
 	}
 
+	mark_scene_changed(scene);
 	full_unlock(scene);
 
 	signal_reorder(scene->first_item);
@@ -3241,6 +3840,7 @@ void obs_scene_atomic_update(obs_scene_t *scene, obs_scene_atomic_update_func fu
 
 	full_lock(scene);
 	func(data, scene);
+	mark_scene_changed(scene);
 	full_unlock(scene);
 	obs_scene_release(scene);
 }
@@ -3305,6 +3905,7 @@ void obs_sceneitem_set_blending_method(obs_sceneitem_t *item, enum obs_blending_
 		return;
 
 	item->blend_method = method;
+	mark_scene_changed(item->parent);
 }
 
 enum obs_blending_method obs_sceneitem_get_blending_method(obs_sceneitem_t *item)
@@ -3656,6 +4257,7 @@ obs_sceneitem_t *obs_scene_insert_group(obs_scene_t *scene, const char *name, ob
 		apply_group_transform(items[idx], item);
 	}
 	items[0]->prev = NULL;
+	mark_scene_changed(sub_scene);
 	resize_group(item, false);
 	full_unlock(sub_scene);
 	full_unlock(scene);
@@ -3997,6 +4599,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene, struct obs_sceneitem_order_inf
 			}
 
 			resize_group(info->item, false);
+			mark_scene_changed(sub_scene);
 			full_unlock(sub_scene);
 			obs_scene_release(sub_scene);
 		}
@@ -4015,6 +4618,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene, struct obs_sceneitem_order_inf
 		prev = item;
 	}
 
+	mark_scene_changed(scene);
 	full_unlock(scene);
 
 	signal_reorder(scene->first_item);
@@ -4078,6 +4682,7 @@ void obs_sceneitem_set_transition(obs_sceneitem_t *item, bool show, obs_source_t
 	if (*target)
 		obs_source_release(*target);
 	*target = obs_source_get_ref(transition);
+	mark_scene_changed(item->parent);
 }
 
 obs_source_t *obs_sceneitem_get_transition(obs_sceneitem_t *item, bool show)
@@ -73,6 +73,15 @@ struct obs_scene_item {
 	struct vec2 box_scale;
 	struct matrix4 draw_transform;
 
+	/* for hit testing, kept up to date with box_transform */
+	struct matrix4 inv_box_transform;
+	struct vec2 box_min;
+	struct vec2 box_max;
+
+	/* scene space bounds of what draw_transform draws, for culling */
+	struct vec2 render_min;
+	struct vec2 render_max;
+
 	enum obs_bounds_type bounds_type;
 	uint32_t bounds_align;
 	struct vec2 bounds;
@@ -105,6 +114,8 @@ struct scene_source_mix {
 	float buf[AUDIO_OUTPUT_FRAMES];
 };
 
+#define SCENE_GRID_CELLS 16
+
 struct obs_scene {
 	struct obs_source *source;
 
@@ -124,4 +135,26 @@ struct obs_scene {
 	struct obs_scene_item *first_item;
 
 	DARRAY(struct scene_source_mix) mix_sources;
+
+	/* what rendering and hit testing read from the items, in draw order,
+	 * so they don't have to walk the item list.  rebuilt on the next use
+	 * after mark_scene_changed, assumes video lock */
+	bool draw_cache_valid;
+	DARRAY(struct obs_scene_item *) draw_items;
+	DARRAY(struct matrix4) draw_transforms;
+	DARRAY(struct matrix4) draw_inv_box_transforms;
+	DARRAY(obs_source_t *) draw_hide_transitions;
+	DARRAY(bool) draw_visible;
+
+	/* uniform grid over the scene of which item boxes touch each cell,
+	 * as indices into draw_items in draw order.  items outside the scene
+	 * are put in the edge cells */
+	DARRAY(struct vec2) draw_box_mins;
+	DARRAY(struct vec2) draw_box_maxs;
+	DARRAY(uint32_t) grid_items;
+	uint32_t grid_offsets[SCENE_GRID_CELLS * SCENE_GRID_CELLS + 1];
+	struct vec2 grid_cell_size;
+	DARRAY(uint32_t) grid_marks;
+	uint32_t grid_mark;
+	uint32_t draw_cache_version;
 };
@@ -42,6 +42,7 @@ enum obs_service_connect_info {
 	OBS_SERVICE_CONNECT_INFO_PASSWORD = 6,
 	OBS_SERVICE_CONNECT_INFO_ENCRYPT_PASSPHRASE = 8,
 	OBS_SERVICE_CONNECT_INFO_BEARER_TOKEN = 10,
+	OBS_SERVICE_CONNECT_INFO_SERVER_URL_ALTERNATIVES = 12,
 };
 
 struct obs_service_info {
@@ -237,7 +237,6 @@ void deinterlace_update_async_video(obs_source_t *source)
 
 	pthread_mutex_lock(&source->async_mutex);
 
-	const bool updated = source->cur_async_frame != NULL;
 	struct obs_source_frame *frame = source->prev_async_frame;
 	source->prev_async_frame = NULL;
 
@@ -251,20 +250,35 @@ void deinterlace_update_async_video(obs_source_t *source)
 		}
 
 		obs_source_release_frame(source, frame);
+	}
+}
 
-	} else if (updated) { /* swap cur/prev if no previous texture */
-		for (size_t c = 0; c < MAX_AV_PLANES; c++) {
-			gs_texture_t *prev_tex = source->async_prev_textures[c];
-			source->async_prev_textures[c] = source->async_textures[c];
-			source->async_textures[c] = prev_tex;
-		}
+/* Called on tick with the async mutex locked, once the textures have the size
+ * of the new current frame.  Without a new previous frame, the current
+ * textures become the previous ones, and the new frame goes into the old
+ * previous textures, whose field is no longer needed.  Doing this before
+ * render rather than during it lets the new frame be uploaded ahead of time
+ * like that of any other async source. */
+void deinterlace_swap_async_textures(obs_source_t *source)
+{
+	if (!source->cur_async_frame || source->prev_async_frame)
+		return;
 
-		if (source->async_texrender) {
-			gs_texrender_t *prev = source->async_prev_texrender;
-			source->async_prev_texrender = source->async_texrender;
-			source->async_texrender = prev;
-		}
+	gs_enter_context(obs->video.graphics);
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		gs_texture_t *prev_tex = source->async_prev_textures[c];
+		source->async_prev_textures[c] = source->async_textures[c];
+		source->async_textures[c] = prev_tex;
+	}
+
+	if (source->async_texrender) {
+		gs_texrender_t *prev = source->async_prev_texrender;
+		source->async_prev_texrender = source->async_texrender;
+		source->async_texrender = prev;
 	}
+
+	gs_leave_context();
 }
 
 static inline gs_effect_t *get_effect(enum obs_deinterlace_mode mode)
@@ -324,6 +338,9 @@ void deinterlace_render(obs_source_t *s)
 	gs_eparam_t *dimensions = gs_effect_get_param_by_name(effect, "dimensions");
 	struct vec2 size = {(float)s->async_width, (float)s->async_height};
 
+	/* the last frame may have been drawn without being converted */
+	convert_stale_async_texrender(s);
+
 	gs_texture_t *cur_tex = s->async_texrender ? gs_texrender_get_texture(s->async_texrender)
 						   : s->async_textures[0];
 	gs_texture_t *prev_tex = s->async_prev_texrender ? gs_texrender_get_texture(s->async_prev_texrender)
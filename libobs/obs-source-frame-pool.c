@@ -0,0 +1,211 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "media-io/video-frame.h"
+#include "obs-internal.h"
+
+/* Process-wide pool of async source frames.  Frames are keyed by the
+ * format/width/height they were allocated with, so every camera running at
+ * the same resolution shares one set of buffers, and buffers freed by a
+ * resolution change or cache cleanup can be picked up again by any source
+ * instead of going back to the system allocator. */
+
+/* idle frames older than this are freed */
+#define POOL_MAX_IDLE_NS 10000000000ULL
+
+/* idle bytes held by the pool before the oldest frames are freed */
+#define POOL_MAX_IDLE_BYTES (512ULL * 1024ULL * 1024ULL)
+
+/* a plain obs_source_frame as far as obs_source_frame_destroy is concerned */
+struct pool_frame {
+	struct obs_source_frame frame;
+
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+	size_t size;
+
+	uint64_t release_time;
+
+	/* set for lent frames */
+	obs_source_frame_release_t release;
+	void *release_param;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct pool_frame *) pool_frames;
+static size_t pool_idle_bytes = 0;
+static uint64_t pool_hits = 0;
+static uint64_t pool_misses = 0;
+
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	size_t size = 0;
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		size += (size_t)frame->linesize[i] * heights[i];
+	return size;
+}
+
+static inline void destroy_pool_frame(struct pool_frame *pf)
+{
+	bfree(pf->frame.data[0]);
+	bfree(pf);
+}
+
+/* removes the frame at idx, assumes pool_mutex */
+static inline struct pool_frame *take_frame(size_t idx)
+{
+	struct pool_frame *pf = pool_frames.array[idx];
+
+	da_erase(pool_frames, idx);
+	pool_idle_bytes -= pf->size;
+	return pf;
+}
+
+/* frees frames that have been idle too long or exceed the byte budget;
+ * frames are appended on release, so the oldest are at the front.  assumes
+ * pool_mutex */
+static void trim_pool(uint64_t now)
+{
+	while (pool_frames.num) {
+		struct pool_frame *pf = pool_frames.array[0];
+
+		if (pool_idle_bytes <= POOL_MAX_IDLE_BYTES && now - pf->release_time < POOL_MAX_IDLE_NS)
+			break;
+
+		destroy_pool_frame(take_frame(0));
+	}
+}
+
+struct obs_source_frame *obs_source_frame_pool_acquire(enum video_format format, uint32_t width, uint32_t height)
+{
+	struct pool_frame *pf = NULL;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	/* newest first so recently used (cache hot) buffers are preferred */
+	for (size_t i = pool_frames.num; i > 0; i--) {
+		struct pool_frame *cur = pool_frames.array[i - 1];
+
+		if (cur->format == format && cur->width == width && cur->height == height) {
+			pf = take_frame(i - 1);
+			break;
+		}
+	}
+
+	if (pf)
+		pool_hits++;
+	else
+		pool_misses++;
+
+	trim_pool(os_gettime_ns());
+
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (pf) {
+		struct obs_source_frame *frame = &pf->frame;
+		uint8_t *data[MAX_AV_PLANES];
+		uint32_t linesize[MAX_AV_PLANES];
+
+		memcpy(data, frame->data, sizeof(data));
+		memcpy(linesize, frame->linesize, sizeof(linesize));
+
+		memset(frame, 0, sizeof(*frame));
+		memcpy(frame->data, data, sizeof(data));
+		memcpy(frame->linesize, linesize, sizeof(linesize));
+	} else {
+		pf = bzalloc(sizeof(*pf));
+		obs_source_frame_init(&pf->frame, format, width, height);
+		pf->format = format;
+		pf->width = width;
+		pf->height = height;
+		pf->size = get_frame_size(&pf->frame);
+	}
+
+	pf->frame.format = format;
+	pf->frame.width = width;
+	pf->frame.height = height;
+	return &pf->frame;
+}
+
+struct obs_source_frame *obs_source_frame_pool_wrap(const struct obs_source_frame *frame,
+						    obs_source_frame_release_t release, void *param)
+{
+	struct pool_frame *pf = bzalloc(sizeof(*pf));
+
+	pf->frame = *frame;
+	pf->frame.refs = 0;
+	pf->frame.prev_frame = false;
+	pf->release = release;
+	pf->release_param = param;
+	return &pf->frame;
+}
+
+void obs_source_frame_pool_release(struct obs_source_frame *frame)
+{
+	struct pool_frame *pf = (struct pool_frame *)frame;
+
+	if (!frame)
+		return;
+
+	if (pf->release) {
+		pf->release(pf->release_param);
+		bfree(pf);
+		return;
+	}
+
+	pthread_mutex_lock(&pool_mutex);
+
+	pf->release_time = os_gettime_ns();
+	da_push_back(pool_frames, &pf);
+	pool_idle_bytes += pf->size;
+
+	trim_pool(pf->release_time);
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_source_frame_pool_free(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+
+	for (size_t i = 0; i < pool_frames.num; i++)
+		destroy_pool_frame(pool_frames.array[i]);
+	da_free(pool_frames);
+	pool_idle_bytes = 0;
+	pool_hits = 0;
+	pool_misses = 0;
+
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void obs_get_source_frame_pool_stats(struct obs_source_frame_pool_stats *stats)
+{
+	if (!obs_ptr_valid(stats, "obs_get_source_frame_pool_stats"))
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	stats->hits = pool_hits;
+	stats->misses = pool_misses;
+	stats->idle_frames = pool_frames.num;
+	stats->idle_bytes = pool_idle_bytes;
+	pthread_mutex_unlock(&pool_mutex);
+}
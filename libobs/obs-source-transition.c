@@ -46,8 +46,8 @@ bool obs_transition_init(obs_source_t *transition)
 		return false;
 
 	transition->transition_alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
-	transition->transition_texrender[0] = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	transition->transition_texrender[1] = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	transition->transition_texrender[0] = gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
+	transition->transition_texrender[1] = gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
 	transition->transition_source_active[0] = true;
 
 	return transition->transition_texrender[0] != NULL && transition->transition_texrender[1] != NULL;
@@ -160,7 +160,11 @@ static void recalculate_transition_matrix(obs_source_t *tr, size_t idx)
 	matrix4_identity(&mat);
 	matrix4_scale3f(&mat, &mat, scale.x, scale.y, 1.0f);
 	matrix4_translate3f(&mat, &mat, pos.x, pos.y, 0.0f);
-	matrix4_copy(&tr->transition_matrices[idx], &mat);
+
+	if (memcmp(&tr->transition_matrices[idx], &mat, sizeof(mat)) != 0) {
+		matrix4_copy(&tr->transition_matrices[idx], &mat);
+		obs_source_mark_video_changed(tr);
+	}
 }
 
 static inline void recalculate_transition_matrices(obs_source_t *transition)
@@ -413,6 +417,8 @@ void obs_transition_set(obs_source_t *transition, obs_source_t *source)
 	transition->transition_manual_target = 0.0f;
 	unlock_transition(transition);
 
+	obs_source_mark_video_changed(transition);
+
 	for (size_t i = 0; i < 2; i++) {
 		if (s[i] && active[i])
 			obs_source_remove_active_child(transition, s[i]);
@@ -602,7 +608,7 @@ static inline void render_child(obs_source_t *transition, obs_source_t *child, s
 	enum gs_color_format format = gs_get_format_from_space(space);
 	if (gs_texrender_get_format(transition->transition_texrender[idx]) != format) {
 		gs_texrender_destroy(transition->transition_texrender[idx]);
-		transition->transition_texrender[idx] = gs_texrender_create(format, GS_ZS_NONE);
+		transition->transition_texrender[idx] = gs_texrender_create_pooled(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(transition->transition_texrender[idx], cx, cy, space)) {
@@ -631,6 +637,26 @@ static void obs_transition_stop(obs_source_t *transition)
 	transition->transition_source_active[1] = false;
 	transition->transition_sources[0] = transition->transition_sources[1];
 	transition->transition_sources[1] = NULL;
+
+	obs_source_mark_video_changed(transition);
+}
+
+bool obs_transition_video_changed(obs_source_t *transition)
+{
+	obs_source_t *child;
+	bool changed;
+
+	lock_transition(transition);
+	if (transition->transitioning_video || transition->transitioning_audio) {
+		unlock_transition(transition);
+		return true;
+	}
+	child = obs_source_get_ref(transition->transition_sources[0]);
+	unlock_transition(transition);
+
+	changed = child && obs_source_video_changed(child);
+	obs_source_release(child);
+	return changed;
 }
 
 static inline void handle_stop(obs_source_t *transition)
@@ -655,6 +681,7 @@ void obs_transition_video_render2(obs_source_t *transition, obs_transition_video
 {
 	struct transition_state state;
 	struct matrix4 matrices[2];
+	bool hidden[2];
 	bool locked = false;
 	bool stopped = false;
 	bool video_stopped = false;
@@ -680,6 +707,10 @@ void obs_transition_video_render2(obs_source_t *transition, obs_transition_video
 	matrices[0] = transition->transition_matrices[0];
 	matrices[1] = transition->transition_matrices[1];
 
+	/* only for this frame */
+	memcpy(hidden, transition->transition_source_hidden, sizeof(hidden));
+	memset(transition->transition_source_hidden, 0, sizeof(hidden));
+
 	unlock_transition(transition);
 
 	if (state.transitioning_video)
@@ -693,7 +724,7 @@ void obs_transition_video_render2(obs_source_t *transition, obs_transition_video
 		const enum gs_color_space current_space = gs_get_color_space();
 		const enum gs_color_space source_space = obs_source_get_color_space(transition, 1, &current_space);
 		for (size_t i = 0; i < 2; i++) {
-			if (state.s[i]) {
+			if (state.s[i] && !hidden[i]) {
 				render_child(transition, state.s[i], i, source_space);
 				tex[i] = get_texture(transition, i);
 				if (!tex[i])
@@ -777,6 +808,16 @@ enum gs_color_space obs_transition_video_get_color_space(obs_source_t *transitio
 	return space;
 }
 
+void obs_transition_hide_source(obs_source_t *transition, enum obs_transition_target target)
+{
+	if (!transition_valid(transition, "obs_transition_hide_source"))
+		return;
+
+	lock_transition(transition);
+	transition->transition_source_hidden[target == OBS_TRANSITION_SOURCE_B] = true;
+	unlock_transition(transition);
+}
+
 bool obs_transition_video_render_direct(obs_source_t *transition, enum obs_transition_target target)
 {
 	struct transition_state state;
@@ -866,7 +907,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child, struct
 	obs_source_get_audio_mix(child, &child_audio);
 	pos = (size_t)ns_to_audio_frames(sample_rate, ts - min_ts);
 
-	if (pos > AUDIO_OUTPUT_FRAMES)
+	if (pos > obs->audio.frames_per_tick)
 		return;
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
@@ -880,7 +921,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child, struct
 			float *out = output->data[ch];
 			float *in = input->data[ch];
 
-			mix_child(transition, out + pos, in, AUDIO_OUTPUT_FRAMES - pos, sample_rate, ts, mix);
+			mix_child(transition, out + pos, in, obs->audio.frames_per_tick - pos, sample_rate, ts, mix);
 		}
 	}
 }
@@ -996,6 +1037,7 @@ static inline obs_source_t *copy_source_state(obs_source_t *tr_dest, obs_source_
 
 	tr_dest->transition_sources[idx] = new_child;
 	tr_dest->transition_source_active[idx] = active;
+	obs_source_mark_video_changed(tr_dest);
 
 	if (active && new_child)
 		obs_source_add_active_child(tr_dest, new_child);
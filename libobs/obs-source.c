@@ -82,6 +82,7 @@ static const char *source_signals[] = {
 	"void deactivate(ptr source)",
 	"void show(ptr source)",
 	"void hide(ptr source)",
+	"void render_visible(ptr source, bool visible)",
 	"void mute(ptr source, bool muted)",
 	"void push_to_mute_changed(ptr source, bool enabled)",
 	"void push_to_mute_delay(ptr source, int delay)",
@@ -164,6 +165,16 @@ static inline bool is_composite_source(const struct obs_source *source)
 	return source->info.output_flags & OBS_SOURCE_COMPOSITE;
 }
 
+/* a quarter second of audio in the output format */
+static size_t get_audio_queue_capacity(void)
+{
+	audio_t *audio = obs->audio.audio;
+	size_t channels = audio ? audio_output_get_channels(audio) : 2;
+	size_t sample_rate = audio ? audio_output_get_sample_rate(audio) : 48000;
+
+	return channels * (sample_rate / 4) * sizeof(float);
+}
+
 extern char *find_libobs_data_file(const char *file);
 
 /* internal initialization */
@@ -201,6 +212,8 @@ static bool obs_source_init(struct obs_source *source)
 
 	if (is_audio_source(source) || is_composite_source(source))
 		allocate_audio_output_buffer(source);
+	if (is_audio_source(source))
+		spsc_ring_init(&source->audio_input_queue, get_audio_queue_capacity());
 	if (source->info.audio_mix)
 		allocate_audio_mix_buffer(source);
 
@@ -213,6 +226,7 @@ static bool obs_source_init(struct obs_source *source)
 
 	source->deinterlace_top_first = true;
 	source->audio_mixers = 0xFF;
+	source->video_change_serial = os_atomic_load_long(&obs->video.render_serial);
 
 	source->private_settings = obs_data_create();
 	return true;
@@ -318,9 +332,23 @@ static void obs_source_init_audio_hotkeys(struct obs_source *source)
 							      obs_source_hotkey_push_to_talk, source);
 }
 
+/* only inputs load lazily, scenes and transitions are needed right away to
+ * know what is shown.  while loading a set of sources, inputs that can be
+ * created from any thread are deferred as well, to be created in parallel */
+static inline bool can_defer_creation(const struct obs_source_info *info, bool private)
+{
+	if (private || !info || info->type != OBS_SOURCE_TYPE_INPUT || !info->create)
+		return false;
+	if (os_atomic_load_bool(&obs->data.lazy_source_creation))
+		return true;
+
+	return (info->output_flags & OBS_SOURCE_CREATE_THREADSAFE) != 0 &&
+	       os_atomic_load_bool(&obs->data.parallel_source_creation);
+}
+
 static obs_source_t *obs_source_create_internal(const char *id, const char *name, const char *uuid,
 						obs_data_t *settings, obs_data_t *hotkey_data, bool private,
-						uint32_t last_obs_ver)
+						uint32_t last_obs_ver, bool allow_defer)
 {
 	struct obs_source *source = bzalloc(sizeof(struct obs_source));
 
@@ -367,12 +395,17 @@ static obs_source_t *obs_source_create_internal(const char *id, const char *name
 
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info && info->create)
-		source->context.data = info->create(source->context.settings, source);
-	if ((!info || info->create) && !source->context.data)
-		blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	if (allow_defer && can_defer_creation(info, private)) {
+		source->deferred = true;
+	} else {
+		if (info && info->create)
+			source->context.data = info->create(source->context.settings, source);
+		if ((!info || info->create) && !source->context.data)
+			blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	}
 
-	blog(LOG_DEBUG, "%ssource '%s' (%s) created", private ? "private " : "", name, id);
+	blog(LOG_DEBUG, "%ssource '%s' (%s) %s", private ? "private " : "", name, id,
+	     source->deferred ? "deferred" : "created");
 
 	source->flags = source->default_flags;
 	source->enabled = true;
@@ -392,18 +425,76 @@ fail:
 
 obs_source_t *obs_source_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data)
 {
-	return obs_source_create_internal(id, name, NULL, settings, hotkey_data, false, LIBOBS_API_VER);
+	return obs_source_create_internal(id, name, NULL, settings, hotkey_data, false, LIBOBS_API_VER, false);
 }
 
 obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings)
 {
-	return obs_source_create_internal(id, name, NULL, settings, NULL, true, LIBOBS_API_VER);
+	return obs_source_create_internal(id, name, NULL, settings, NULL, true, LIBOBS_API_VER, false);
 }
 
 obs_source_t *obs_source_create_set_last_ver(const char *id, const char *name, const char *uuid, obs_data_t *settings,
 					     obs_data_t *hotkey_data, uint32_t last_obs_ver, bool is_private)
 {
-	return obs_source_create_internal(id, name, uuid, settings, hotkey_data, is_private, last_obs_ver);
+	return obs_source_create_internal(id, name, uuid, settings, hotkey_data, is_private, last_obs_ver, true);
+}
+
+/* whoever clears the deferred flag creates the source, returns true if that
+ * was this call and creation succeeded */
+static bool create_deferred(obs_source_t *source)
+{
+	if (!os_atomic_set_bool(&source->deferred, false))
+		return false;
+
+	const uint64_t start = os_gettime_ns();
+	void *data = source->info.create(source->context.settings, source);
+
+	if (!data) {
+		blog(LOG_ERROR, "Failed to create source '%s'!", source->context.name);
+		return false;
+	}
+
+	source->context.data = data;
+
+	blog(LOG_DEBUG, "source '%s' (%s) instantiated in %.1f ms", source->context.name, source->info.id,
+	     (double)(os_gettime_ns() - start) / 1000000.0);
+	return true;
+}
+
+void obs_source_create_deferred(obs_source_t *source)
+{
+	create_deferred(source);
+}
+
+bool obs_source_instantiate(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_instantiate"))
+		return false;
+
+	if (!create_deferred(source))
+		return source->context.data != NULL;
+
+	void *data = source->context.data;
+
+	/* it was loaded along with everything else, and may have been
+	 * shown or activated while it had nothing to show */
+	if (source->info.load)
+		source->info.load(data, source->context.settings);
+	if (source->showing && source->info.show)
+		source->info.show(data);
+	if (source->active && source->info.activate)
+		source->info.activate(data);
+
+	obs_source_mark_video_changed(source);
+	return true;
+}
+
+bool obs_source_instantiated(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_instantiated"))
+		return false;
+
+	return !os_atomic_load_bool(&source->deferred);
 }
 
 static char *get_new_filter_name(obs_source_t *dst, const char *name)
@@ -566,11 +657,13 @@ void obs_source_frame_init(struct obs_source_frame *frame, enum video_format for
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		obs_source_frame_pool_release(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t *filter);
 static void obs_source_destroy_defer(struct obs_source *source);
+static void prepare_async_upload(struct obs_source *source, struct obs_source_frame *frame);
+static bool finish_async_upload(struct obs_source *source, const struct obs_source_frame *frame);
 
 void obs_source_destroy(struct obs_source *source)
 {
@@ -645,6 +738,9 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	finish_async_upload(source, NULL);
+	os_event_destroy(source->async_upload.done);
+
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -659,6 +755,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	}
 	if (source->filter_texrender)
 		gs_texrender_destroy(source->filter_texrender);
+	gs_effect_destroy(source->fused_effect);
 	if (source->color_space_texrender)
 		gs_texrender_destroy(source->color_space_texrender);
 	gs_leave_context();
@@ -667,11 +764,13 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		bfree(source->audio_data.data[i]);
 	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		deque_free(&source->audio_input_buf[i]);
+	spsc_ring_free(&source->audio_input_queue);
+	da_free(source->audio_queue_buf);
 	audio_resampler_destroy(source->resampler);
 	bfree(source->audio_output_buf[0][0]);
 	bfree(source->audio_mix_buf[0]);
 
-	obs_source_frame_destroy(source->async_preload_frame);
+	obs_source_frame_pool_release(source->async_preload_frame);
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_free(source);
@@ -879,6 +978,10 @@ bool obs_source_configurable(const obs_source_t *source)
 
 obs_properties_t *obs_source_properties(const obs_source_t *source)
 {
+	/* editing a source needs the real thing */
+	if (source && os_atomic_load_bool(&source->deferred))
+		obs_source_instantiate((obs_source_t *)source);
+
 	if (!data_valid(source, "obs_source_properties"))
 		return NULL;
 
@@ -915,6 +1018,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data, source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count, 0);
+		obs_source_mark_video_changed(source);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -932,6 +1036,7 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 		os_atomic_inc_long(&source->defer_update_count);
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data, source->context.settings);
+		obs_source_mark_video_changed(source);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -953,6 +1058,70 @@ void obs_source_update_properties(obs_source_t *source)
 	obs_source_dosignal(source, NULL, "update_properties");
 }
 
+void obs_source_mark_video_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_mark_video_changed"))
+		return;
+
+	os_atomic_set_long(&source->video_change_serial, os_atomic_load_long(&obs->video.render_serial));
+}
+
+/* a change recorded during the previous frame may have happened after that
+ * frame was already rendered, so it counts for the current frame as well */
+static inline bool video_changed_recently(obs_source_t *source)
+{
+	unsigned long cur = (unsigned long)os_atomic_load_long(&obs->video.render_serial);
+	unsigned long last = (unsigned long)os_atomic_load_long(&source->video_change_serial);
+	return cur - last <= 1;
+}
+
+static bool filters_video_changed(obs_source_t *source)
+{
+	bool changed = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		if (!filter->enabled) {
+			if (video_changed_recently(filter)) {
+				changed = true;
+				break;
+			}
+		} else if (obs_source_video_changed(filter)) {
+			changed = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->filter_mutex);
+	return changed;
+}
+
+/* returns whether the source would render differently than on the previous
+ * frame, conservatively true for anything that can't tell */
+bool obs_source_video_changed(obs_source_t *source)
+{
+	/* audio-only sources don't draw anything */
+	if ((source->info.output_flags & OBS_SOURCE_VIDEO) == 0)
+		return false;
+	if (video_changed_recently(source))
+		return true;
+	if (!source->enabled)
+		return false;
+	if (source->filters.num && filters_video_changed(source))
+		return true;
+
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return obs_transition_video_changed(source);
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		return obs_scene_video_changed(source->context.data);
+
+	const uint32_t flags = source->info.output_flags;
+	return (flags & OBS_SOURCE_ASYNC) != 0 || (flags & OBS_SOURCE_STATIC_VIDEO) == 0;
+}
+
 void obs_source_send_mouse_click(obs_source_t *source, const struct obs_mouse_event *event, int32_t type, bool mouse_up,
 				 uint32_t click_count)
 {
@@ -1118,9 +1287,42 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time);
 
+/* Gets the planes of a frame lent with obs_source_lend_video_textures,
+ * false for any other frame.  Only frames without data can be texture
+ * frames, so other frames don't need the lookup. */
+static bool get_lent_textures(obs_source_t *source, const struct obs_source_frame *frame,
+			      gs_texture_t *textures[MAX_AV_PLANES])
+{
+	bool found = false;
+
+	if (!frame || frame->data[0])
+		return false;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		const struct async_frame *af = &source->async_cache.array[i];
+
+		if (af->frame == frame) {
+			found = af->textures[0] != NULL;
+			if (found && textures)
+				memcpy(textures, af->textures, sizeof(af->textures));
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->async_mutex);
+	return found;
+}
+
 static void filter_frame(obs_source_t *source, struct obs_source_frame **ref_frame)
 {
 	struct obs_source_frame *frame = *ref_frame;
+
+	/* filters work on frame data, which texture frames don't have */
+	if (get_lent_textures(source, frame, NULL))
+		return;
+
 	if (frame) {
 		os_atomic_inc_long(&frame->refs);
 		frame = filter_async_video(source, frame);
@@ -1185,6 +1387,9 @@ static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
+	/* the last frame, if it was never rendered */
+	finish_async_upload(source, NULL);
+
 	pthread_mutex_lock(&source->async_mutex);
 
 	if (deinterlacing_enabled(source)) {
@@ -1204,18 +1409,55 @@ static void async_tick(obs_source_t *source)
 		filter_frame(source, &source->prev_async_frame);
 	filter_frame(source, &source->cur_async_frame);
 
-	if (source->cur_async_frame)
+	if (source->cur_async_frame) {
 		source->async_update_texture = set_async_texture_size(source, source->cur_async_frame);
 
+		if (deinterlacing_enabled(source))
+			deinterlace_swap_async_textures(source);
+
+		if (source->async_update_texture)
+			prepare_async_upload(source, source->cur_async_frame);
+	}
+
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+/* frames a source has to go undrawn before it's no longer render visible,
+ * so sources drawn on and off (e.g. during transitions) don't flap */
+#define RENDER_HIDDEN_FRAMES 3
+
+static void update_render_visible(obs_source_t *source)
 {
-	bool now_showing, now_active;
+	bool rendered = source->rendered;
+	bool visible = os_atomic_load_bool(&source->render_visible);
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
+	source->rendered = false;
+
+	if (rendered) {
+		source->render_skipped_frames = 0;
+	} else if (visible && ++source->render_skipped_frames < RENDER_HIDDEN_FRAMES) {
 		return;
+	}
+
+	if (rendered != visible) {
+		struct calldata data;
+		uint8_t stack[128];
+
+		os_atomic_set_bool(&source->render_visible, rendered);
+
+		calldata_init_fixed(&data, stack, sizeof(stack));
+		calldata_set_ptr(&data, "source", source);
+		calldata_set_bool(&data, "visible", rendered);
+		signal_handler_signal(source->context.signals, "render_visible", &data);
+	}
+}
+
+bool obs_source_video_tick_prepare(obs_source_t *source, float seconds)
+{
+	bool now_showing, now_active;
+
+	if (os_atomic_load_bool(&source->deferred) && (source->show_refs || source->activate_refs))
+		obs_source_instantiate(source);
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
@@ -1254,6 +1496,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		}
 
 		source->showing = now_showing;
+		obs_source_mark_video_changed(source);
 	}
 
 	/* call activate/deactivate if the reference changed */
@@ -1279,13 +1522,28 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
+	update_render_visible(source);
 
+	return source->context.data && source->info.video_tick;
+}
+
+void obs_source_video_tick_finish(obs_source_t *source)
+{
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	if (obs_source_video_tick_prepare(source, seconds))
+		source->info.video_tick(source->context.data, seconds);
+
+	obs_source_video_tick_finish(source);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate, const size_t frames)
 {
@@ -1313,7 +1571,8 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 	source->timing_adjust = os_time - timestamp;
 }
 
-static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+/* clears the input buffers, assumes audio_buf_mutex */
+static void reset_audio_input(obs_source_t *source, uint64_t os_time)
 {
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		if (source->audio_input_buf[i].size)
@@ -1322,20 +1581,17 @@ static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 
 	source->last_audio_input_buf_size = 0;
 	source->audio_ts = os_time;
-	source->next_audio_sys_ts_min = os_time;
 }
 
-static void handle_ts_jump(obs_source_t *source, uint64_t expected, uint64_t ts, uint64_t diff, uint64_t os_time)
+/* for resets from outside the capture thread, also drops any queued audio.
+ * next_audio_sys_ts_min is only reset once the capture thread picks it up
+ * in apply_audio_reset.  assumes audio_buf_mutex */
+static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 {
-	blog(LOG_DEBUG,
-	     "Timestamp for source '%s' jumped by '%" PRIu64 "', "
-	     "expected value %" PRIu64 ", input value %" PRIu64,
-	     source->context.name, diff, expected, ts);
-
-	pthread_mutex_lock(&source->audio_buf_mutex);
-	reset_audio_timing(source, ts, os_time);
-	reset_audio_data(source, os_time);
-	pthread_mutex_unlock(&source->audio_buf_mutex);
+	spsc_ring_clear(&source->audio_input_queue);
+	reset_audio_input(source, os_time);
+	source->audio_reset_sys_ts = os_time;
+	os_atomic_set_bool(&source->audio_reset_pending, true);
 }
 
 static void source_signal_audio_data(obs_source_t *source, const struct audio_data *in, bool muted)
@@ -1369,7 +1625,7 @@ static void source_output_audio_place(obs_source_t *source, const struct audio_d
 	size_t size = in->frames * sizeof(float);
 
 	if (!source->audio_ts || in->timestamp < source->audio_ts)
-		reset_audio_data(source, in->timestamp);
+		reset_audio_input(source, in->timestamp);
 
 	buf_placement = get_buf_placement(audio, in->timestamp - source->audio_ts) * sizeof(float);
 
@@ -1410,6 +1666,143 @@ static inline void source_output_audio_push_back(obs_source_t *source, const str
 	source->last_audio_input_buf_size = 0;
 }
 
+/* Audio goes from the capture thread to the input buffers through a lock-free
+ * ring, so capture threads never wait on the audio thread holding
+ * audio_buf_mutex.  The timestamp smoothing still runs on the capture thread;
+ * the audio thread only places the already timed data once per tick.  If the
+ * ring is full (or the source has none), the capture thread takes the mutex,
+ * flushes the ring itself, and stores the data directly. */
+
+struct audio_queue_packet {
+	uint64_t timestamp;
+	uint32_t frames;
+	/* channels the data was written with, packets from before an audio
+	 * reset are dropped */
+	uint32_t channels;
+	bool push_back;
+	bool reset;
+};
+
+/* assumes audio_buf_mutex */
+static void store_audio_packet(obs_source_t *source, const struct audio_queue_packet *pkt, const struct audio_data *in)
+{
+	if (pkt->reset)
+		reset_audio_input(source, pkt->timestamp);
+	else if (pkt->push_back && source->audio_ts)
+		source_output_audio_push_back(source, in);
+	else
+		source_output_audio_place(source, in);
+}
+
+/* consumer side, assumes audio_buf_mutex */
+static void flush_audio_queue(obs_source_t *source)
+{
+	struct spsc_ring *ring = &source->audio_input_queue;
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	struct audio_queue_packet pkt;
+
+	while (spsc_ring_size(ring) >= sizeof(pkt)) {
+		struct audio_data in = {0};
+		size_t size;
+
+		spsc_ring_peek(ring, 0, &pkt, sizeof(pkt));
+		size = pkt.frames * sizeof(float);
+
+		if (pkt.channels != channels) {
+			spsc_ring_pop(ring, sizeof(pkt) + size * pkt.channels);
+			continue;
+		}
+
+		da_resize(source->audio_queue_buf, pkt.frames * channels);
+		for (size_t i = 0; i < channels; i++) {
+			in.data[i] = (uint8_t *)(source->audio_queue_buf.array + pkt.frames * i);
+			spsc_ring_peek(ring, sizeof(pkt) + size * i, in.data[i], size);
+		}
+
+		in.frames = pkt.frames;
+		in.timestamp = pkt.timestamp;
+		store_audio_packet(source, &pkt, &in);
+
+		spsc_ring_pop(ring, sizeof(pkt) + size * channels);
+	}
+}
+
+void obs_source_flush_audio_queue(obs_source_t *source)
+{
+	if (!spsc_ring_size(&source->audio_input_queue))
+		return;
+
+	pthread_mutex_lock(&source->audio_buf_mutex);
+	flush_audio_queue(source);
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+/* called by obs_reset_audio2 once the new audio output is open: the queue is
+ * sized for the old channel count and sample rate, so it's dropped and the
+ * capture thread re-creates it */
+void obs_source_reset_audio_queue(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->audio_buf_mutex);
+	source->audio_queue_resize = true;
+	reset_audio_data(source, 0);
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+/* capture thread: applies what reset_audio_data left for it.  only the
+ * producer can free the queue, as it writes to it without the mutex */
+static void apply_audio_reset(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->audio_buf_mutex);
+
+	if (source->audio_queue_resize) {
+		spsc_ring_free(&source->audio_input_queue);
+		spsc_ring_init(&source->audio_input_queue, get_audio_queue_capacity());
+		source->audio_queue_resize = false;
+	}
+
+	source->next_audio_sys_ts_min = source->audio_reset_sys_ts;
+	os_atomic_set_bool(&source->audio_reset_pending, false);
+
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+/* producer side, called from the capture thread */
+static void queue_audio_packet(obs_source_t *source, struct audio_queue_packet *pkt, const struct audio_data *in)
+{
+	struct spsc_ring *ring = &source->audio_input_queue;
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	size_t size = pkt->frames * sizeof(float);
+
+	pkt->channels = (uint32_t)channels;
+
+	if (spsc_ring_space(ring) >= sizeof(*pkt) + size * channels) {
+		spsc_ring_write(ring, 0, pkt, sizeof(*pkt));
+		for (size_t i = 0; size && i < channels; i++)
+			spsc_ring_write(ring, sizeof(*pkt) + size * i, in->data[i], size);
+		spsc_ring_commit(ring, sizeof(*pkt) + size * channels);
+		return;
+	}
+
+	pthread_mutex_lock(&source->audio_buf_mutex);
+	flush_audio_queue(source);
+	store_audio_packet(source, pkt, in);
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+static void handle_ts_jump(obs_source_t *source, uint64_t expected, uint64_t ts, uint64_t diff, uint64_t os_time)
+{
+	struct audio_queue_packet reset = {.timestamp = os_time, .reset = true};
+
+	blog(LOG_DEBUG,
+	     "Timestamp for source '%s' jumped by '%" PRIu64 "', "
+	     "expected value %" PRIu64 ", input value %" PRIu64,
+	     source->context.name, diff, expected, ts);
+
+	reset_audio_timing(source, ts, os_time);
+	source->next_audio_sys_ts_min = os_time;
+	queue_audio_packet(source, &reset, NULL);
+}
+
 static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 {
 	if (source->push_to_mute_enabled && source->user_push_to_mute_pressed)
@@ -1435,6 +1828,9 @@ static void source_output_audio_data(obs_source_t *source, const struct audio_da
 	bool using_direct_ts = false;
 	bool push_back = false;
 
+	if (os_atomic_load_bool(&source->audio_reset_pending))
+		apply_audio_reset(source);
+
 	/* detects 'directly' set timestamps as long as they're within
 	 * a certain threshold */
 	if (uint64_diff(in.timestamp, os_time) < MAX_TS_VAR) {
@@ -1468,8 +1864,6 @@ static void source_output_audio_data(obs_source_t *source, const struct audio_da
 
 	in.timestamp += source->timing_adjust;
 
-	pthread_mutex_lock(&source->audio_buf_mutex);
-
 	if (source->next_audio_sys_ts_min == in.timestamp) {
 		push_back = true;
 
@@ -1504,14 +1898,14 @@ static void source_output_audio_data(obs_source_t *source, const struct audio_da
 	}
 
 	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
-		if (push_back && source->audio_ts)
-			source_output_audio_push_back(source, &in);
-		else
-			source_output_audio_place(source, &in);
+		struct audio_queue_packet pkt = {
+			.timestamp = in.timestamp,
+			.frames = in.frames,
+			.push_back = push_back,
+		};
+		queue_audio_packet(source, &pkt, &in);
 	}
 
-	pthread_mutex_unlock(&source->audio_buf_mutex);
-
 	source_signal_audio_data(source, data, source_muted(source, os_time));
 }
 
@@ -1974,7 +2368,10 @@ bool set_async_texture_size(struct obs_source *source, const struct obs_source_f
 	source->async_full_range = frame->full_range;
 	source->async_trc = frame->trc;
 
+	finish_async_upload(source, NULL);
+
 	gs_enter_context(obs->video.graphics);
+	gs_memory_push_scope(GS_MEMORY_ASYNC, source);
 
 	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
 		gs_texture_destroy(source->async_textures[c]);
@@ -1991,6 +2388,8 @@ bool set_async_texture_size(struct obs_source *source, const struct obs_source_f
 	const enum gs_color_format format = convert_video_format(frame->format, frame->trc);
 	const bool async_gpu_conversion = (cur != CONVERT_NONE) && init_gpu_conversion(source, frame);
 	source->async_gpu_conversion = async_gpu_conversion;
+	source->async_direct = false;
+	source->async_texrender_stale = false;
 	if (async_gpu_conversion) {
 		source->async_texrender = gs_texrender_create(format, GS_ZS_NONE);
 
@@ -2005,6 +2404,7 @@ bool set_async_texture_size(struct obs_source *source, const struct obs_source_f
 	if (deinterlacing_enabled(source))
 		set_deinterlace_texture_size(source);
 
+	gs_memory_pop_scope();
 	gs_leave_context();
 
 	return source->async_textures[0] != NULL;
@@ -2045,6 +2445,97 @@ static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES], const struct obs_
 	}
 }
 
+static inline bool can_upload_async(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	if (!os_atomic_load_long(&source->show_refs))
+		return false;
+	if (get_lent_textures(source, frame, NULL))
+		return false;
+
+	if (source->async_gpu_conversion)
+		return source->async_texrender != NULL;
+
+	if (get_convert_type(frame->format, frame->full_range, frame->trc) != CONVERT_NONE)
+		return false;
+
+	/* the texture would be recreated for the other format on render */
+	enum gs_color_format format = gs_texture_get_color_format(source->async_textures[0]);
+	return !(format == GS_BGRX && frame->format == VIDEO_FORMAT_BGRA) &&
+	       !(format == GS_BGRA && frame->format == VIDEO_FORMAT_BGRX);
+}
+
+/* Maps the textures of the source for the frame to be rendered, and has an
+ * upload thread copy the frame into them while the graphics thread does
+ * other things, so that rendering only has to unmap them.  Called on tick
+ * with the async mutex locked. */
+static void prepare_async_upload(struct obs_source *source, struct obs_source_frame *frame)
+{
+	struct obs_async_upload *upload = &source->async_upload;
+
+	if (!obs->video.upload_threads.num || !can_upload_async(source, frame))
+		return;
+	if (!upload->done && os_event_init(&upload->done, OS_EVENT_TYPE_MANUAL) != 0)
+		return;
+
+	gs_enter_context(obs->video.graphics);
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		gs_texture_t *tex = source->async_textures[c];
+		if (!tex)
+			continue;
+
+		if (!gs_texture_map(tex, &upload->ptr[c], &upload->linesize[c])) {
+			for (size_t i = 0; i < c; i++) {
+				if (upload->ptr[i])
+					gs_texture_unmap(source->async_textures[i]);
+			}
+
+			memset(upload->ptr, 0, sizeof(upload->ptr));
+			gs_leave_context();
+			return;
+		}
+
+		upload->height[c] = gs_texture_get_height(tex);
+	}
+
+	gs_leave_context();
+
+	os_atomic_inc_long(&frame->refs);
+	upload->frame = frame;
+	upload->pending = true;
+
+	os_event_reset(upload->done);
+	obs_queue_async_upload(upload);
+}
+
+/* Waits for a prepared upload and unmaps the textures, which has the GPU
+ * copy the frame in.  Returns whether that frame was the one given. */
+static bool finish_async_upload(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_async_upload *upload = &source->async_upload;
+
+	if (!upload->pending)
+		return false;
+
+	os_event_wait(upload->done);
+
+	gs_enter_context(obs->video.graphics);
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (upload->ptr[c])
+			gs_texture_unmap(source->async_textures[c]);
+	}
+	gs_leave_context();
+
+	const bool uploaded = upload->frame == frame;
+
+	obs_source_frame_decref(upload->frame);
+	memset(upload->ptr, 0, sizeof(upload->ptr));
+	upload->frame = NULL;
+	upload->pending = false;
+
+	return uploaded;
+}
+
 static const char *select_conversion_technique(enum video_format format, bool full_range, uint8_t trc)
 {
 	switch (format) {
@@ -2205,14 +2696,35 @@ static inline void set_eparam(gs_effect_t *effect, const char *name, float val)
 	gs_effect_set_float(param, val);
 }
 
+static void set_conversion_color_params(gs_effect_t *conv, const struct obs_source_frame *frame)
+{
+	struct vec4 vec0, vec1, vec2;
+	vec4_set(&vec0, frame->color_matrix[0], frame->color_matrix[1], frame->color_matrix[2],
+		 frame->color_matrix[3]);
+	vec4_set(&vec1, frame->color_matrix[4], frame->color_matrix[5], frame->color_matrix[6],
+		 frame->color_matrix[7]);
+	vec4_set(&vec2, frame->color_matrix[8], frame->color_matrix[9], frame->color_matrix[10],
+		 frame->color_matrix[11]);
+	gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec0"), &vec0);
+	gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec1"), &vec1);
+	gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec2"), &vec2);
+	if (!frame->full_range) {
+		gs_eparam_t *min_param = gs_effect_get_param_by_name(conv, "color_range_min");
+		gs_effect_set_val(min_param, frame->color_range_min, sizeof(float) * 3);
+		gs_eparam_t *max_param = gs_effect_get_param_by_name(conv, "color_range_max");
+		gs_effect_set_val(max_param, frame->color_range_max, sizeof(float) * 3);
+	}
+}
+
 static bool update_async_texrender(struct obs_source *source, const struct obs_source_frame *frame,
-				   gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender)
+				   gs_texture_t *tex[MAX_AV_PLANES], gs_texrender_t *texrender, bool uploaded)
 {
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_CONVERT_FORMAT, "Convert Format");
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	if (!uploaded)
+		upload_raw_frame(tex, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
@@ -2260,22 +2772,7 @@ static bool update_async_texrender(struct obs_source *source, const struct obs_s
 		set_eparam(conv, "hdr_lw", (float)frame->max_luminance);
 		set_eparam(conv, "hdr_lmax", obs_get_video_hdr_nominal_peak_level());
 
-		struct vec4 vec0, vec1, vec2;
-		vec4_set(&vec0, frame->color_matrix[0], frame->color_matrix[1], frame->color_matrix[2],
-			 frame->color_matrix[3]);
-		vec4_set(&vec1, frame->color_matrix[4], frame->color_matrix[5], frame->color_matrix[6],
-			 frame->color_matrix[7]);
-		vec4_set(&vec2, frame->color_matrix[8], frame->color_matrix[9], frame->color_matrix[10],
-			 frame->color_matrix[11]);
-		gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec0"), &vec0);
-		gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec1"), &vec1);
-		gs_effect_set_vec4(gs_effect_get_param_by_name(conv, "color_vec2"), &vec2);
-		if (!frame->full_range) {
-			gs_eparam_t *min_param = gs_effect_get_param_by_name(conv, "color_range_min");
-			gs_effect_set_val(min_param, frame->color_range_min, sizeof(float) * 3);
-			gs_eparam_t *max_param = gs_effect_get_param_by_name(conv, "color_range_max");
-			gs_effect_set_val(max_param, frame->color_range_max, sizeof(float) * 3);
-		}
+		set_conversion_color_params(conv, frame);
 
 		gs_draw(GS_TRIS, 0, 3);
 
@@ -2289,8 +2786,55 @@ static bool update_async_texrender(struct obs_source *source, const struct obs_s
 		gs_texrender_end(texrender);
 	}
 
-	GS_DEBUG_MARKER_END();
-	return success;
+	GS_DEBUG_MARKER_END();
+	return success;
+}
+
+/* SDR I420, NV12 and I444 frames can be converted as they're drawn with
+ * the *_Draw techniques.  deinterlacing still needs the converted texture */
+static inline bool can_draw_async_direct(const struct obs_source *source, const struct obs_source_frame *frame)
+{
+	if (deinterlacing_enabled(source))
+		return false;
+	if (frame->trc == VIDEO_TRC_PQ || frame->trc == VIDEO_TRC_HLG)
+		return false;
+
+	switch (frame->format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I444:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static const char *select_direct_technique(enum video_format format, bool linear)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+		return linear ? "I420_DrawLinear" : "I420_Draw";
+	case VIDEO_FORMAT_NV12:
+		return linear ? "NV12_DrawLinear" : "NV12_Draw";
+	case VIDEO_FORMAT_I444:
+		return linear ? "I444_DrawLinear" : "I444_Draw";
+	default:
+		return NULL;
+	}
+}
+
+/* converts the planes uploaded for direct drawing into async_texrender, for
+ * when the source is drawn somewhere direct drawing doesn't apply */
+void convert_stale_async_texrender(struct obs_source *source)
+{
+	if (!source->async_texrender_stale)
+		return;
+
+	gs_memory_push_scope(GS_MEMORY_ASYNC, source);
+	update_async_texrender(source, &source->async_direct_frame, source->async_textures, source->async_texrender,
+			       true);
+	gs_memory_pop_scope();
+	source->async_texrender_stale = false;
 }
 
 bool update_async_texture(struct obs_source *source, const struct obs_source_frame *frame, gs_texture_t *tex,
@@ -2305,15 +2849,50 @@ bool update_async_textures(struct obs_source *source, const struct obs_source_fr
 {
 	enum convert_type type;
 
+	/* the textures are mapped as long as an upload is pending */
+	const bool uploaded = tex == source->async_textures && finish_async_upload(source, frame);
+	gs_texture_t *lent_textures[MAX_AV_PLANES];
+
 	source->async_flip = frame->flip;
 	source->async_linear_alpha = (frame->flags & OBS_SOURCE_FRAME_LINEAR_ALPHA) != 0;
 
-	if (source->async_gpu_conversion && texrender)
-		return update_async_texrender(source, frame, tex, texrender);
+	/* texture frames are converted straight from the textures they came
+	 * in, the planes of the source stay unused */
+	if (get_lent_textures(source, frame, lent_textures)) {
+		if (tex == source->async_textures) {
+			source->async_direct = false;
+			source->async_texrender_stale = false;
+		}
+
+		return source->async_gpu_conversion && texrender &&
+		       update_async_texrender(source, frame, lent_textures, texrender, true);
+	}
+
+	if (source->async_gpu_conversion && texrender) {
+		if (tex == source->async_textures) {
+			source->async_direct = can_draw_async_direct(source, frame);
+			source->async_texrender_stale = false;
+
+			if (source->async_direct) {
+				if (!uploaded)
+					upload_raw_frame(tex, frame);
+
+				/* only the properties are kept, the data
+				 * itself is in the planes now */
+				source->async_direct_frame = *frame;
+				memset(source->async_direct_frame.data, 0, sizeof(source->async_direct_frame.data));
+				source->async_texrender_stale = true;
+				return true;
+			}
+		}
+
+		return update_async_texrender(source, frame, tex, texrender, uploaded);
+	}
 
 	type = get_convert_type(frame->format, frame->full_range, frame->trc);
 	if (type == CONVERT_NONE) {
-		gs_texture_set_image(tex[0], frame->data[0], frame->linesize[0], false);
+		if (!uploaded)
+			gs_texture_set_image(tex[0], frame->data[0], frame->linesize[0], false);
 		return true;
 	}
 
@@ -2354,7 +2933,10 @@ static void recreate_async_texture(obs_source_t *source, enum gs_color_format fo
 	uint32_t cx = gs_texture_get_width(source->async_textures[0]);
 	uint32_t cy = gs_texture_get_height(source->async_textures[0]);
 	gs_texture_destroy(source->async_textures[0]);
+
+	gs_memory_push_scope(GS_MEMORY_ASYNC, source);
 	source->async_textures[0] = gs_texture_create(cx, cy, format, 1, NULL, GS_DYNAMIC);
+	gs_memory_pop_scope();
 }
 
 static inline void check_to_swap_bgrx_bgra(obs_source_t *source, struct obs_source_frame *frame)
@@ -2382,7 +2964,9 @@ static void obs_source_update_async_video(obs_source_t *source)
 			}
 
 			if (source->async_update_texture) {
+				gs_memory_push_scope(GS_MEMORY_ASYNC, source);
 				update_async_textures(source, frame, source->async_textures, source->async_texrender);
+				gs_memory_pop_scope();
 				source->async_update_texture = false;
 			}
 
@@ -2414,6 +2998,43 @@ static void rotate_async_video(obs_source_t *source, long rotation)
 	gs_matrix_rotaa4f(0.0f, 0.0f, -1.0f, RAD((float)rotation));
 }
 
+static void obs_source_draw_async_direct(struct obs_source *source, bool linear_srgb)
+{
+	gs_effect_t *conv = obs->video.conversion_effect;
+	const char *tech_name = select_direct_technique(source->async_format, linear_srgb);
+	gs_technique_t *tech = gs_effect_get_technique(conv, tech_name);
+	gs_texture_t *const *const tex = source->async_textures;
+
+	if (!tech)
+		return;
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(conv, "image"), tex[0]);
+	gs_effect_set_texture(gs_effect_get_param_by_name(conv, "image1"), tex[1]);
+	gs_effect_set_texture(gs_effect_get_param_by_name(conv, "image2"), tex[2]);
+	set_eparam(conv, "width_x2_i", 0.5f / (float)source->async_width);
+	set_conversion_color_params(conv, &source->async_direct_frame);
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	long rotation = source->async_rotation;
+	if (rotation) {
+		gs_matrix_push();
+		rotate_async_video(source, rotation);
+	}
+
+	gs_technique_begin(tech);
+	gs_technique_begin_pass(tech, 0);
+	gs_draw_sprite(tex[0], source->async_flip ? GS_FLIP_V : 0, source->async_width, source->async_height);
+	gs_technique_end_pass(tech);
+	gs_technique_end(tech);
+
+	if (rotation)
+		gs_matrix_pop();
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 static inline void obs_source_render_async_video(obs_source_t *source)
 {
 	if (source->async_textures[0] && source->async_active) {
@@ -2482,6 +3103,16 @@ static inline void obs_source_render_async_video(obs_source_t *source)
 			}
 		}
 
+		/* the direct techniques only output SDR */
+		if (source->async_direct && source_space == GS_CS_SRGB &&
+		    (current_space == GS_CS_SRGB || current_space == GS_CS_SRGB_16F)) {
+			obs_source_draw_async_direct(source, linear_srgb);
+			source_profiler_source_render_end(source, start, timer);
+			return;
+		}
+
+		convert_stale_async_texrender(source);
+
 		const bool previous = gs_set_linear_srgb(linear_srgb);
 
 		gs_technique_t *const tech = gs_effect_get_technique(effect, tech_name);
@@ -2580,10 +3211,28 @@ static uint32_t get_base_height(const obs_source_t *source)
 	return source->async_active ? get_async_height(source) : 0;
 }
 
+static inline const char *get_gpu_profile_name(obs_source_t *source)
+{
+	if (source->info.type != OBS_SOURCE_TYPE_FILTER && source->info.type != OBS_SOURCE_TYPE_TRANSITION)
+		return NULL;
+	if (!gpu_profiler_active())
+		return NULL;
+
+	if (!source->gpu_profile_name)
+		source->gpu_profile_name = profile_store_name(obs_get_profiler_name_store(), "%s(%s)",
+							      source->info.id, source->context.name);
+	return source->gpu_profile_name;
+}
+
 static void source_render(obs_source_t *source, gs_effect_t *effect)
 {
 	gs_timer_t *timer = NULL;
 	const uint64_t start = source_profiler_source_render_begin(&timer);
+	const char *gpu_profile_name = get_gpu_profile_name(source);
+
+	if (gpu_profile_name)
+		obs_gpu_profile_start(gpu_profile_name);
+	gs_memory_push_scope(GS_MEMORY_OTHER, source);
 
 	void *const data = source->context.data;
 	const enum gs_color_space current_space = gs_get_color_space();
@@ -2696,6 +3345,10 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 	} else {
 		source->info.video_render(data, effect);
 	}
+
+	gs_memory_pop_scope();
+	if (gpu_profile_name)
+		obs_gpu_profile_end(gpu_profile_name);
 	source_profiler_source_render_end(source, start, timer);
 }
 
@@ -2716,6 +3369,8 @@ void obs_source_default_render(obs_source_t *source)
 	}
 }
 
+static bool render_fused_filters(obs_source_t *filter);
+
 static inline void obs_source_main_render(obs_source_t *source)
 {
 	uint32_t flags = source->info.output_flags;
@@ -2731,7 +3386,7 @@ static inline void obs_source_main_render(obs_source_t *source)
 
 	if (default_effect) {
 		obs_source_default_render(source);
-	} else if (source->context.data) {
+	} else if (source->context.data && !render_fused_filters(source)) {
 		source_render(source, custom_draw ? NULL : gs_get_effect());
 	}
 
@@ -2780,6 +3435,8 @@ static inline void render_video(obs_source_t *source)
 		return;
 	}
 
+	source->rendered = true;
+
 	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_SOURCE, get_type_format(source->info.type),
 				     obs_source_get_name(source));
 
@@ -2964,6 +3621,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_mark_video_changed(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3001,6 +3660,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source, obs_source_t
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_mark_video_changed(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3126,8 +3787,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter, enu
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_mark_video_changed(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 int obs_source_filter_get_index(obs_source_t *source, obs_source_t *filter)
@@ -3171,8 +3834,10 @@ void obs_source_filter_set_index(obs_source_t *source, obs_source_t *filter, siz
 	success = set_filter_index(source, filter, index);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_mark_video_changed(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -3349,7 +4014,7 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				obs_source_frame_pool_release(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -3357,18 +4022,20 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
-{
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
 
+/* Frames piling up without being rendered are dropped, and the incoming one
+ * along with them, so that timing starts over.  Cached frames go back to the
+ * cache and lent ones back to their source, the cache itself is kept.
+ * Returns false if the frame is dropped.  assumes async_mutex */
+static bool begin_cache_frame(struct obs_source *source, const struct obs_source_frame *frame)
+{
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
+		for (size_t i = 0; i < source->async_frames.num; i++)
+			remove_async_frame(source, source->async_frames.array[i]);
+
+		da_resize(source->async_frames, 0);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -3377,10 +4044,25 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
+	return true;
+}
+
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_pool_release(output)
+static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!begin_cache_frame(source, frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return NULL;
+	}
+
+	const enum video_format format = frame->format;
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
@@ -3396,12 +4078,13 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	clean_cache(source);
 
 	if (!new_frame) {
-		struct async_frame new_af;
+		struct async_frame new_af = {0};
 
-		new_frame = obs_source_frame_create(format, frame->width, frame->height);
+		new_frame = obs_source_frame_pool_acquire(format, frame->width, frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.lent = false;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -3438,7 +4121,7 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
+			obs_source_frame_pool_release(output);
 			output = NULL;
 		} else {
 			da_push_back(source->async_frames, &output);
@@ -3463,6 +4146,106 @@ void obs_source_output_video(obs_source_t *source, const struct obs_source_frame
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+void obs_source_lend_video(obs_source_t *source, const struct obs_source_frame *frame,
+			   obs_source_frame_release_t release, void *param)
+{
+	if (!frame)
+		return;
+	if (destroying(source) || !obs_source_valid(source, "obs_source_lend_video")) {
+		release(param);
+		return;
+	}
+
+	source_profiler_async_frame_received(source);
+
+	struct obs_source_frame new_frame = *frame;
+	new_frame.full_range = format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!begin_cache_frame(source, &new_frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		release(param);
+		return;
+	}
+
+	clean_cache(source);
+
+	/* in the cache while used like any other frame, with a reference of
+	 * the cache, see remove_async_frame */
+	struct async_frame af = {.used = true, .lent = true};
+	af.frame = obs_source_frame_pool_wrap(&new_frame, release, param);
+	af.frame->refs = 1;
+
+	da_push_back(source->async_cache, &af);
+	da_push_back(source->async_frames, &af.frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+static bool has_async_video_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+
+	for (size_t i = 0; i < source->filters.num; i++) {
+		struct obs_source *filter = source->filters.array[i];
+
+		if (filter->enabled && filter->info.filter_video) {
+			found = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->filter_mutex);
+	return found;
+}
+
+bool obs_source_lend_video_textures(obs_source_t *source, const struct obs_source_frame *frame,
+				    gs_texture_t *const textures[MAX_AV_PLANES], obs_source_frame_release_t release,
+				    void *param)
+{
+	if (!obs_ptr_valid(frame, "obs_source_lend_video_textures") ||
+	    !obs_ptr_valid(textures, "obs_source_lend_video_textures") || !textures[0])
+		return false;
+	if (frame->format != VIDEO_FORMAT_NV12 && frame->format != VIDEO_FORMAT_P010)
+		return false;
+	if (destroying(source) || !obs_source_valid(source, "obs_source_lend_video_textures"))
+		return false;
+	if (deinterlacing_enabled(source) || has_async_video_filters(source))
+		return false;
+
+	source_profiler_async_frame_received(source);
+
+	struct obs_source_frame new_frame = *frame;
+	memset(new_frame.data, 0, sizeof(new_frame.data));
+	memset(new_frame.linesize, 0, sizeof(new_frame.linesize));
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!begin_cache_frame(source, &new_frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		release(param);
+		return true;
+	}
+
+	clean_cache(source);
+
+	struct async_frame af = {.used = true, .lent = true};
+	memcpy(af.textures, textures, sizeof(af.textures));
+	af.frame = obs_source_frame_pool_wrap(&new_frame, release, param);
+	af.frame->refs = 1;
+
+	da_push_back(source->async_cache, &af);
+	da_push_back(source->async_frames, &af.frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+	return true;
+}
+
 void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame)
 {
 	if (destroying(source))
@@ -3564,8 +4347,8 @@ static void obs_source_preload_video_internal(obs_source_t *source, const struct
 		return;
 
 	if (preload_frame_changed(source, frame)) {
-		obs_source_frame_destroy(source->async_preload_frame);
-		source->async_preload_frame = obs_source_frame_create(frame->format, frame->width, frame->height);
+		obs_source_frame_pool_release(source->async_preload_frame);
+		source->async_preload_frame = obs_source_frame_pool_acquire(frame->format, frame->width, frame->height);
 	}
 
 	copy_frame_data(source->async_preload_frame, frame);
@@ -3658,8 +4441,8 @@ static void obs_source_set_video_frame_internal(obs_source_t *source, const stru
 	obs_enter_graphics();
 
 	if (preload_frame_changed(source, frame)) {
-		obs_source_frame_destroy(source->async_preload_frame);
-		source->async_preload_frame = obs_source_frame_create(frame->format, frame->width, frame->height);
+		obs_source_frame_pool_release(source->async_preload_frame);
+		source->async_preload_frame = obs_source_frame_pool_acquire(frame->format, frame->width, frame->height);
 	}
 
 	copy_frame_data(source->async_preload_frame, frame);
@@ -3932,7 +4715,12 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			if (f->lent) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -4084,7 +4872,7 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			obs_source_frame_pool_release(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -4092,6 +4880,48 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 	}
 }
 
+struct obs_source_frame *obs_source_frame_hold(obs_source_t *source, struct obs_source_frame *frame)
+{
+	struct obs_source_frame *copy = NULL;
+	size_t idx = DARRAY_INVALID;
+
+	if (!obs_source_valid(source, "obs_source_frame_hold") || !frame)
+		return frame;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		if (source->async_cache.array[i].frame == frame) {
+			idx = i;
+			break;
+		}
+	}
+
+	/* texture frames have no data to copy, they're held as they are */
+	if (idx == DARRAY_INVALID || !source->async_cache.array[idx].lent ||
+	    source->async_cache.array[idx].textures[0]) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return frame;
+	}
+
+	/* the copy takes the place of the lent frame in the cache: one
+	 * reference for the cache and one for the caller */
+	struct async_frame af = {.used = true, .lent = false};
+	copy = obs_source_frame_pool_acquire(frame->format, frame->width, frame->height);
+	copy_frame_data(copy, frame);
+	copy->refs = 2;
+	af.frame = copy;
+	da_push_back(source->async_cache, &af);
+
+	/* drops the reference of the caller, then the one of the cache, which
+	 * gives the frame back to its source */
+	os_atomic_dec_long(&frame->refs);
+	remove_async_frame(source, frame);
+
+	pthread_mutex_unlock(&source->async_mutex);
+	return copy;
+}
+
 const char *obs_source_get_name(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_name") ? source->context.name : NULL;
@@ -4200,20 +5030,15 @@ bool obs_source_process_filter_begin(obs_source_t *filter, enum gs_color_format
 	return obs_source_process_filter_begin_with_color_space(filter, format, GS_CS_SRGB, allow_direct);
 }
 
-bool obs_source_process_filter_begin_with_color_space(obs_source_t *filter, enum gs_color_format format,
-						      enum gs_color_space space,
-						      enum obs_allow_direct_render allow_direct)
+static bool process_filter_begin(obs_source_t *filter, obs_source_t *target, enum gs_color_format format,
+				 enum gs_color_space space, enum obs_allow_direct_render allow_direct)
 {
-	obs_source_t *target, *parent;
+	obs_source_t *parent;
 	uint32_t filter_flags, parent_flags;
 	int cx, cy;
 
-	if (!obs_ptr_valid(filter, "obs_source_process_filter_begin_with_color_space"))
-		return false;
-
 	filter->filter_bypass_active = false;
 
-	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
 
 	if (!target) {
@@ -4252,7 +5077,7 @@ bool obs_source_process_filter_begin_with_color_space(obs_source_t *filter, enum
 	}
 
 	if (!filter->filter_texrender) {
-		filter->filter_texrender = gs_texrender_create(format, GS_ZS_NONE);
+		filter->filter_texrender = gs_texrender_create_pooled(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(filter->filter_texrender, cx, cy, space)) {
@@ -4279,20 +5104,26 @@ bool obs_source_process_filter_begin_with_color_space(obs_source_t *filter, enum
 	return true;
 }
 
-void obs_source_process_filter_tech_end(obs_source_t *filter, gs_effect_t *effect, uint32_t width, uint32_t height,
-					const char *tech_name)
+bool obs_source_process_filter_begin_with_color_space(obs_source_t *filter, enum gs_color_format format,
+						      enum gs_color_space space,
+						      enum obs_allow_direct_render allow_direct)
 {
-	obs_source_t *target, *parent;
+	if (!obs_ptr_valid(filter, "obs_source_process_filter_begin_with_color_space"))
+		return false;
+
+	return process_filter_begin(filter, obs_filter_get_target(filter), format, space, allow_direct);
+}
+
+static void process_filter_tech_end(obs_source_t *filter, obs_source_t *target, gs_effect_t *effect, uint32_t width,
+				    uint32_t height, const char *tech_name)
+{
+	obs_source_t *parent;
 	gs_texture_t *texture;
 	uint32_t filter_flags;
 
-	if (!filter)
-		return;
-
 	const bool filter_bypass_active = filter->filter_bypass_active;
 	filter->filter_bypass_active = false;
 
-	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
 
 	if (!target || !parent)
@@ -4316,6 +5147,15 @@ void obs_source_process_filter_tech_end(obs_source_t *filter, gs_effect_t *effec
 	gs_set_linear_srgb(previous);
 }
 
+void obs_source_process_filter_tech_end(obs_source_t *filter, gs_effect_t *effect, uint32_t width, uint32_t height,
+					const char *tech_name)
+{
+	if (!filter)
+		return;
+
+	process_filter_tech_end(filter, obs_filter_get_target(filter), effect, width, height, tech_name);
+}
+
 void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect, uint32_t width, uint32_t height)
 {
 	if (!obs_ptr_valid(filter, "obs_source_process_filter_end"))
@@ -4354,6 +5194,162 @@ void obs_source_skip_video_filter(obs_source_t *filter)
 	}
 }
 
+/* Runs of filters that only change the color of each pixel are drawn with
+ * one generated effect instead of one texrender pass per filter.  The effect
+ * is cached on the first filter of the run, keyed by the pixel functions it
+ * was built from. */
+
+static const char *fused_effect_header = "uniform float4x4 ViewProj;\n"
+					 "uniform texture2d image;\n"
+					 "\n"
+					 "sampler_state textureSampler {\n"
+					 "\tFilter = Linear;\n"
+					 "\tAddressU = Clamp;\n"
+					 "\tAddressV = Clamp;\n"
+					 "};\n"
+					 "\n"
+					 "struct VertData {\n"
+					 "\tfloat4 pos : POSITION;\n"
+					 "\tfloat2 uv : TEXCOORD0;\n"
+					 "};\n"
+					 "\n"
+					 "VertData VSDefault(VertData vert_in)\n"
+					 "{\n"
+					 "\tVertData vert_out;\n"
+					 "\tvert_out.pos = mul(float4(vert_in.pos.xyz, 1.0), ViewProj);\n"
+					 "\tvert_out.uv = vert_in.uv;\n"
+					 "\treturn vert_out;\n"
+					 "}\n"
+					 "\n";
+
+static const char *fused_effect_footer = "\treturn rgba;\n"
+					 "}\n"
+					 "\n"
+					 "technique Draw\n"
+					 "{\n"
+					 "\tpass\n"
+					 "\t{\n"
+					 "\t\tvertex_shader = VSDefault(vert_in);\n"
+					 "\t\tpixel_shader = PSFused(vert_in);\n"
+					 "\t}\n"
+					 "}\n";
+
+static inline bool is_pixel_filter(obs_source_t *filter)
+{
+	return filter->filter_parent && filter->context.data && filter->enabled &&
+	       filter->info.filter_get_pixel_function && filter->info.filter_set_pixel_params;
+}
+
+static inline void get_fused_prefix(struct dstr *prefix, size_t idx)
+{
+	dstr_printf(prefix, "fused%d_", (int)idx);
+}
+
+static gs_effect_t *get_fused_effect(obs_source_t *filter, const char **functions, size_t num)
+{
+	struct dstr code = {0};
+	struct dstr prefix = {0};
+	char *errors = NULL;
+
+	if (filter->fused_num == num && memcmp(filter->fused_functions, functions, num * sizeof(*functions)) == 0)
+		return filter->fused_effect;
+
+	gs_effect_destroy(filter->fused_effect);
+	filter->fused_effect = NULL;
+	memcpy(filter->fused_functions, functions, num * sizeof(*functions));
+	filter->fused_num = num;
+
+	dstr_copy(&code, fused_effect_header);
+
+	for (size_t i = 0; i < num; i++) {
+		struct dstr function = {0};
+
+		get_fused_prefix(&prefix, i);
+		dstr_copy(&function, functions[i]);
+		dstr_replace(&function, "$", prefix.array);
+		dstr_cat_dstr(&code, &function);
+		dstr_cat(&code, "\n");
+		dstr_free(&function);
+	}
+
+	/* the filter closest to the parent is applied first */
+	dstr_cat(&code, "float4 PSFused(VertData vert_in) : TARGET\n{\n"
+			"\tfloat4 rgba = image.Sample(textureSampler, vert_in.uv);\n");
+	for (size_t i = num; i > 0; i--) {
+		get_fused_prefix(&prefix, i - 1);
+		dstr_catf(&code, "\trgba = %sprocess(rgba);\n", prefix.array);
+	}
+	dstr_cat(&code, fused_effect_footer);
+
+	filter->fused_effect = gs_effect_create(code.array, "fused pixel filters", &errors);
+	if (!filter->fused_effect)
+		blog(LOG_WARNING, "Failed to fuse the filters starting at '%s', rendering them separately: %s",
+		     filter->context.name, errors ? errors : "(unknown error)");
+
+	bfree(errors);
+	dstr_free(&prefix);
+	dstr_free(&code);
+	return filter->fused_effect;
+}
+
+static bool render_fused_filters(obs_source_t *filter)
+{
+	const enum gs_color_space space = GS_CS_SRGB;
+	const char *functions[MAX_FUSED_FILTERS];
+	obs_source_t *run[MAX_FUSED_FILTERS];
+	obs_source_t *parent = filter->filter_parent;
+	obs_source_t *cur = filter;
+	obs_source_t *target;
+	gs_effect_t *effect;
+	struct dstr prefix = {0};
+	size_t num = 0;
+
+	if (!is_pixel_filter(filter))
+		return false;
+
+	const uint32_t srgb = filter->info.output_flags & OBS_SOURCE_SRGB;
+
+	while (num < MAX_FUSED_FILTERS && cur && cur != parent && is_pixel_filter(cur) &&
+	       (cur->info.output_flags & OBS_SOURCE_SRGB) == srgb) {
+		const char *function = cur->info.filter_get_pixel_function(cur->context.data);
+		if (!function)
+			break;
+
+		run[num] = cur;
+		functions[num++] = function;
+		cur = cur->filter_target;
+	}
+
+	if (num < 2)
+		return false;
+
+	/* HDR goes through each filter's own color space handling */
+	target = run[num - 1]->filter_target;
+	if (!target || obs_source_get_color_space(target, 1, &space) != space)
+		return false;
+
+	effect = get_fused_effect(filter, functions, num);
+	if (!effect)
+		return false;
+
+	if (!process_filter_begin(filter, target, GS_RGBA, space, OBS_ALLOW_DIRECT_RENDERING))
+		return true;
+
+	for (size_t i = 0; i < num; i++) {
+		get_fused_prefix(&prefix, i);
+		run[i]->info.filter_set_pixel_params(run[i]->context.data, effect, prefix.array);
+	}
+	dstr_free(&prefix);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	process_filter_tech_end(filter, target, effect, 0, 0, "Draw");
+
+	gs_blend_state_pop();
+	return true;
+}
+
 signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_signal_handler") ? source->context.signals : NULL;
@@ -4608,10 +5604,17 @@ void obs_source_load(obs_source_t *source)
 
 void obs_source_load2(obs_source_t *source)
 {
-	if (!data_valid(source, "obs_source_load2"))
+	if (!obs_source_valid(source, "obs_source_load2"))
 		return;
 
-	obs_source_load(source);
+	/* deferred sources load themselves once they're instantiated, but
+	 * their filters exist already */
+	if (!os_atomic_load_bool(&source->deferred)) {
+		if (!source->context.data)
+			return;
+
+		obs_source_load(source);
+	}
 
 	for (size_t i = source->filters.num; i > 0; i--) {
 		obs_source_t *filter = source->filters.array[i - 1];
@@ -4629,6 +5632,14 @@ bool obs_source_showing(const obs_source_t *source)
 	return obs_source_valid(source, "obs_source_showing") ? source->show_refs != 0 : false;
 }
 
+bool obs_source_render_visible(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_render_visible"))
+		return false;
+
+	return os_atomic_load_bool(&source->render_visible);
+}
+
 static inline void signal_flags_updated(obs_source_t *source)
 {
 	struct calldata data;
@@ -4866,6 +5877,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	obs_source_mark_video_changed(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -5066,18 +6078,20 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 
 static inline void multiply_output_audio(obs_source_t *source, size_t mix, size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
+	for (size_t ch = 0; ch < channels; ch++) {
+		register float *out = source->audio_output_buf[mix][ch];
+		register float *end = out + obs->audio.frames_per_tick;
 
-	while (out < end)
-		*(out++) *= vol;
+		while (out < end)
+			*(out++) *= vol;
+	}
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix, size_t channels, float *vol_data)
 {
 	for (size_t ch = 0; ch < channels; ch++) {
 		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
+		register float *end = out + obs->audio.frames_per_tick;
 		register float *vol = vol_data;
 
 		while (out < end)
@@ -5107,6 +6121,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 {
 	float vol_data[AUDIO_OUTPUT_FRAMES];
 	float cur_vol = get_source_volume(source, source->audio_ts);
+	const size_t frames = obs->audio.frames_per_tick;
 	size_t frame_num = 0;
 
 	pthread_mutex_lock(&source->audio_actions_mutex);
@@ -5121,7 +6136,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 
 		new_frame_num = conv_time_to_frames(sample_rate, timestamp - source->audio_ts);
 
-		if (new_frame_num >= AUDIO_OUTPUT_FRAMES)
+		if (new_frame_num >= frames)
 			break;
 
 		da_erase(source->audio_actions, i--);
@@ -5136,7 +6151,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 		cur_vol = get_source_volume(source, timestamp);
 	}
 
-	for (; frame_num < AUDIO_OUTPUT_FRAMES; frame_num++)
+	for (; frame_num < frames; frame_num++)
 		vol_data[frame_num] = cur_vol;
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
@@ -5162,7 +6177,7 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t cha
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	if (actions_pending) {
-		uint64_t duration = conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
+		uint64_t duration = conv_frames_to_time(sample_rate, obs->audio.frames_per_tick);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
 			apply_audio_actions(source, channels, sample_rate);
@@ -5177,6 +6192,7 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t cha
 	if (vol == 0.0f || mixers == 0) {
 		memset(source->audio_output_buf[0][0], 0,
 		       AUDIO_OUTPUT_FRAMES * sizeof(float) * MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		source->audio_silent = true;
 		return;
 	}
 
@@ -5246,7 +6262,7 @@ static void audio_submix(obs_source_t *source, size_t channels, size_t sample_ra
 		audio.data[i] = (const uint8_t *)audio_data.data[i];
 
 	audio.samples_per_sec = (uint32_t)sample_rate;
-	audio.frames = AUDIO_OUTPUT_FRAMES;
+	audio.frames = obs->audio.frames_per_tick;
 	audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	audio.speakers = (enum speaker_layout)channels;
 	audio.timestamp = ts;
@@ -5254,6 +6270,13 @@ static void audio_submix(obs_source_t *source, size_t channels, size_t sample_ra
 	obs_source_output_audio(source, &audio);
 }
 
+static inline void clear_output_audio(obs_source_t *source, size_t mix, size_t channels, size_t size)
+{
+	/* channels are AUDIO_OUTPUT_FRAMES apart, ticks may be shorter */
+	for (size_t ch = 0; ch < channels; ch++)
+		memset(source->audio_output_buf[mix][ch], 0, size);
+}
+
 static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate,
 					     size_t size)
 {
@@ -5284,7 +6307,7 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 		}
 
 		if ((source->audio_mixers & mix_and_val) == 0 || (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0, size * channels);
+			clear_output_audio(source, mix, channels, size);
 			continue;
 		}
 
@@ -5298,7 +6321,7 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 	}
 
 	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0, size * channels);
+		clear_output_audio(source, 0, channels, size);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
@@ -5306,6 +6329,8 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 
 void obs_source_audio_render(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate, size_t size)
 {
+	source->audio_silent = false;
+
 	if (!source->audio_output_buf[0][0]) {
 		source->audio_pending = true;
 		return;
@@ -5444,6 +6469,23 @@ enum obs_monitoring_type obs_source_get_monitoring_type(const obs_source_t *sour
 									  : OBS_MONITORING_TYPE_NONE;
 }
 
+uint64_t obs_source_get_monitoring_latency(const obs_source_t *source)
+{
+	uint64_t latency = 0;
+
+	if (!obs_source_valid(source, "obs_source_get_monitoring_latency"))
+		return 0;
+
+	/* the monitor may be destroyed on another thread, it is only safe to
+	 * use while it is still in the list */
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	if (source->monitor && da_find(obs->audio.monitors, &source->monitor, 0) != DARRAY_INVALID)
+		latency = audio_monitor_get_latency(source->monitor);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	return latency;
+}
+
 void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered)
 {
 	if (!obs_source_valid(source, "obs_source_set_async_unbuffered"))
@@ -5829,3 +6871,11 @@ uint64_t obs_source_get_last_async_ts(const obs_source_t *source)
 {
 	return source->async_last_rendered_ts;
 }
+
+uint64_t obs_source_get_gpu_memory_usage(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_get_gpu_memory_usage"))
+		return 0;
+
+	return gs_get_owner_memory_usage(obs->video.graphics, source);
+}
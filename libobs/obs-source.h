@@ -203,6 +203,27 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video_tick callback doesn't use the graphics subsystem or other
+ * sources, and may be called from a worker thread in parallel with the
+ * video_tick of other sources.
+ */
+#define OBS_SOURCE_TICK_THREADSAFE (1 << 17)
+
+/**
+ * Source's video only changes when its settings are updated or when it calls
+ * obs_source_mark_video_changed, which allows libobs to skip re-rendering
+ * mixes that contain nothing but unchanged sources.
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1 << 18)
+
+/**
+ * Source's create callback may be called from a worker thread in parallel
+ * with the creation of other sources, such as when loading a scene
+ * collection.
+ */
+#define OBS_SOURCE_CREATE_THREADSAFE (1 << 19)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
@@ -546,6 +567,28 @@ struct obs_source_info {
 	 * @param  source  Source that the filter is being added to
 	 */
 	void (*filter_add)(void *data, obs_source_t *source);
+
+	/**
+	 * Returns the pixel function of a filter that only changes the color
+	 * of each pixel, so that a run of such filters can be drawn in a
+	 * single pass.  Every '$' in the code is replaced by a per-filter
+	 * prefix, and the code must define '$process', which takes and
+	 * returns a premultiplied float4 color.  Return NULL to be rendered
+	 * normally.
+	 *
+	 * @param  data  Filter data
+	 * @return       Effect code, which must stay valid while it is in use
+	 */
+	const char *(*filter_get_pixel_function)(void *data);
+
+	/**
+	 * Sets the uniforms of the pixel function on a fused effect.
+	 *
+	 * @param  data    Filter data
+	 * @param  effect  Fused effect
+	 * @param  prefix  What '$' was replaced with in the parameter names
+	 */
+	void (*filter_set_pixel_params)(void *data, gs_effect_t *effect, const char *prefix);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info, size_t size);
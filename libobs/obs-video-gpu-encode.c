@@ -29,6 +29,7 @@ static void *gpu_encode_thread(void *data)
 	da_init(encoders);
 
 	os_set_thread_name("obs gpu encode thread");
+	obs_set_alloc_counter(OBS_ALLOC_ENCODERS);
 	const char *gpu_encode_thread_name = profile_store_name(
 		obs_get_profiler_name_store(), "obs_gpu_encode_thread(%g" NBSP "ms)", interval / 1000000.);
 	profile_register_root(gpu_encode_thread_name, interval);
@@ -44,6 +45,8 @@ static void *gpu_encode_thread(void *data)
 		if (os_atomic_load_bool(&video->gpu_encode_stop))
 			break;
 
+		obs_apply_core_thread_affinity();
+
 		if (wait_frames) {
 			wait_frames--;
 			continue;
@@ -164,6 +167,8 @@ static void *gpu_encode_thread(void *data)
 			}
 			profile_end(gpu_encode_frame_name);
 
+			encoder_stats_add_call(encoder, os_gettime_ns() - fer_ts, 1);
+
 			/* Generate and enqueue the frame timing metrics, namely
 			 * the CTS (composition time), FER (frame encode request), FERC
 			 * (frame encode request complete) and current PTS. PTS is used to
@@ -229,6 +234,8 @@ bool init_gpu_encoding(struct obs_core_video_mix *video)
 	const struct video_output_info *info = video_output_get_info(video->video);
 
 	video->gpu_encode_stop = false;
+	video->gpu_encode_stalls = 0;
+	video->gpu_encode_copies = 0;
 
 	deque_reserve(&video->gpu_encoder_avail_queue, NUM_ENCODE_TEXTURES);
 	for (size_t i = 0; i < NUM_ENCODE_TEXTURES; i++) {
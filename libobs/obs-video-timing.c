@@ -0,0 +1,382 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdlib.h>
+
+#include "obs-internal.h"
+#include "util/util_uint64.h"
+
+/* Rolling per-stage frame times of the graphics thread.  Samples are only
+ * touched by the graphics thread; percentiles are published every
+ * TIMING_PUBLISH_INTERVAL frames behind a sequence counter so that any thread
+ * can read them without taking a lock. */
+
+#define TIMING_SAMPLES 256
+#define TIMING_PUBLISH_INTERVAL 16
+
+/* GPU timer results are read this many frames after they were issued */
+#define TIMING_GPU_FRAMES 3
+
+/* named GPU scopes issued past this in a frame aren't timed */
+#define MAX_GPU_SCOPES 256
+#define GPU_SCOPE_SKIPPED SIZE_MAX
+
+struct timing_ring {
+	uint64_t samples[TIMING_SAMPLES];
+	size_t idx;
+	size_t num;
+};
+
+struct gpu_scope {
+	const char *name;
+	gs_timer_t *timer;
+	bool ended;
+};
+
+struct gpu_frame {
+	gs_timer_range_t *range;
+	gs_timer_t *timers[OBS_FRAME_TIMING_STAGE_COUNT];
+	bool issued[OBS_FRAME_TIMING_STAGE_COUNT];
+
+	/* timers are kept for reuse, only the first num_scopes were
+	 * issued this frame */
+	DARRAY(struct gpu_scope) scopes;
+	size_t num_scopes;
+};
+
+static struct timing_ring cpu_rings[OBS_FRAME_TIMING_STAGE_COUNT];
+static struct timing_ring gpu_rings[OBS_FRAME_TIMING_STAGE_COUNT];
+static uint64_t stage_start[OBS_FRAME_TIMING_STAGE_COUNT];
+
+static struct gpu_frame gpu_frames[TIMING_GPU_FRAMES];
+static size_t gpu_frame_idx = 0;
+static bool gpu_enabled = false;
+static bool gpu_scopes_enabled = false;
+static volatile bool gpu_enable_next = false;
+static volatile bool gpu_scopes_enable_next = false;
+
+/* indices of the open scopes of the current frame */
+static DARRAY(size_t) open_gpu_scopes;
+
+static const char *gpu_scopes_name = "gpu";
+
+static uint32_t frames_since_publish = 0;
+
+static volatile long published_seq = 0;
+static struct obs_video_frame_timing published;
+
+static inline void ring_push(struct timing_ring *ring, uint64_t val)
+{
+	ring->samples[ring->idx] = val;
+	ring->idx = (ring->idx + 1) % TIMING_SAMPLES;
+	if (ring->num < TIMING_SAMPLES)
+		ring->num++;
+}
+
+static int cmp_uint64(const void *a, const void *b)
+{
+	const uint64_t val_a = *(const uint64_t *)a;
+	const uint64_t val_b = *(const uint64_t *)b;
+	return (val_a > val_b) - (val_a < val_b);
+}
+
+static void calc_percentiles(const struct timing_ring *ring, struct obs_frame_timing_percentiles *out)
+{
+	uint64_t sorted[TIMING_SAMPLES];
+
+	if (!ring->num) {
+		memset(out, 0, sizeof(*out));
+		return;
+	}
+
+	memcpy(sorted, ring->samples, ring->num * sizeof(uint64_t));
+	qsort(sorted, ring->num, sizeof(uint64_t), cmp_uint64);
+
+	out->p50 = sorted[(ring->num - 1) * 50 / 100];
+	out->p95 = sorted[(ring->num - 1) * 95 / 100];
+	out->p99 = sorted[(ring->num - 1) * 99 / 100];
+}
+
+static void publish(void)
+{
+	struct obs_video_frame_timing timing = {0};
+
+	timing.samples = (uint32_t)cpu_rings[OBS_FRAME_TIMING_TOTAL].num;
+	timing.gpu_samples = (uint32_t)gpu_rings[OBS_FRAME_TIMING_OUTPUT].num;
+
+	for (size_t i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++) {
+		calc_percentiles(&cpu_rings[i], &timing.cpu[i]);
+		calc_percentiles(&gpu_rings[i], &timing.gpu[i]);
+	}
+
+	os_atomic_inc_long(&published_seq);
+	published = timing;
+	os_atomic_inc_long(&published_seq);
+}
+
+static void free_gpu_frames(void)
+{
+	gs_enter_context(obs->video.graphics);
+
+	for (size_t i = 0; i < TIMING_GPU_FRAMES; i++) {
+		struct gpu_frame *frame = &gpu_frames[i];
+
+		for (size_t stage = 0; stage < OBS_FRAME_TIMING_STAGE_COUNT; stage++)
+			gs_timer_destroy(frame->timers[stage]);
+		for (size_t j = 0; j < frame->scopes.num; j++)
+			gs_timer_destroy(frame->scopes.array[j].timer);
+		da_free(frame->scopes);
+		gs_timer_range_destroy(frame->range);
+	}
+
+	gs_leave_context();
+
+	da_free(open_gpu_scopes);
+
+	memset(gpu_frames, 0, sizeof(gpu_frames));
+	for (size_t i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++)
+		memset(&gpu_rings[i], 0, sizeof(gpu_rings[i]));
+}
+
+/* assumes graphics context */
+static void collect_gpu_frame(struct gpu_frame *frame)
+{
+	bool disjoint = false;
+	uint64_t freq = 0;
+
+	if (!frame->range || !gs_timer_range_get_data(frame->range, &disjoint, &freq) || disjoint || !freq)
+		goto clear;
+
+	for (size_t stage = 0; stage < OBS_FRAME_TIMING_STAGE_COUNT; stage++) {
+		uint64_t ticks;
+
+		if (frame->issued[stage] && gs_timer_get_data(frame->timers[stage], &ticks))
+			ring_push(&gpu_rings[stage], util_mul_div64(ticks, 1000000000ULL, freq));
+	}
+
+	/* GPU times arrive frames late, so they're recorded as a group of
+	 * their own next to the CPU scopes of the graphics thread */
+	if (frame->num_scopes) {
+		profile_start(gpu_scopes_name);
+
+		for (size_t i = 0; i < frame->num_scopes; i++) {
+			struct gpu_scope *scope = &frame->scopes.array[i];
+			uint64_t ticks;
+
+			if (scope->ended && gs_timer_get_data(scope->timer, &ticks))
+				profile_record(scope->name, util_mul_div64(ticks, 1000000000ULL, freq));
+		}
+
+		profile_end(gpu_scopes_name);
+	}
+
+clear:
+	memset(frame->issued, 0, sizeof(frame->issued));
+	frame->num_scopes = 0;
+}
+
+void frame_timing_frame_begin(void)
+{
+	gpu_scopes_enabled = os_atomic_load_bool(&gpu_scopes_enable_next);
+	bool enable = os_atomic_load_bool(&gpu_enable_next) || gpu_scopes_enabled;
+
+	if (gpu_enabled != enable) {
+		if (gpu_enabled)
+			free_gpu_frames();
+		gpu_enabled = enable;
+	}
+
+	if (!gpu_enabled) {
+		frame_timing_stage_begin(OBS_FRAME_TIMING_TOTAL);
+		return;
+	}
+
+	struct gpu_frame *frame = &gpu_frames[gpu_frame_idx];
+
+	gs_enter_context(obs->video.graphics);
+
+	/* the oldest frame is reused for this one, so read it back first */
+	collect_gpu_frame(frame);
+
+	if (!frame->range)
+		frame->range = gs_timer_range_create();
+	if (frame->range)
+		gs_timer_range_begin(frame->range);
+
+	gs_leave_context();
+
+	frame_timing_stage_begin(OBS_FRAME_TIMING_TOTAL);
+}
+
+void frame_timing_stage_begin(enum obs_frame_timing_stage stage)
+{
+	stage_start[stage] = os_gettime_ns();
+
+	if (!gpu_enabled || !gpu_frames[gpu_frame_idx].range)
+		return;
+
+	struct gpu_frame *frame = &gpu_frames[gpu_frame_idx];
+
+	gs_enter_context(obs->video.graphics);
+	if (!frame->timers[stage])
+		frame->timers[stage] = gs_timer_create();
+	if (frame->timers[stage]) {
+		gs_timer_begin(frame->timers[stage]);
+		frame->issued[stage] = true;
+	}
+	gs_leave_context();
+}
+
+void frame_timing_stage_end(enum obs_frame_timing_stage stage)
+{
+	ring_push(&cpu_rings[stage], os_gettime_ns() - stage_start[stage]);
+
+	if (!gpu_enabled)
+		return;
+
+	struct gpu_frame *frame = &gpu_frames[gpu_frame_idx];
+	if (!frame->issued[stage])
+		return;
+
+	gs_enter_context(obs->video.graphics);
+	gs_timer_end(frame->timers[stage]);
+	gs_leave_context();
+}
+
+void frame_timing_frame_end(void)
+{
+	frame_timing_stage_end(OBS_FRAME_TIMING_TOTAL);
+
+	if (gpu_enabled) {
+		struct gpu_frame *frame = &gpu_frames[gpu_frame_idx];
+
+		/* scopes left open are dropped rather than carried over */
+		da_resize(open_gpu_scopes, 0);
+
+		if (frame->range) {
+			gs_enter_context(obs->video.graphics);
+			gs_timer_range_end(frame->range);
+			gs_leave_context();
+		}
+
+		gpu_frame_idx = (gpu_frame_idx + 1) % TIMING_GPU_FRAMES;
+	}
+
+	if (++frames_since_publish >= TIMING_PUBLISH_INTERVAL) {
+		frames_since_publish = 0;
+		publish();
+	}
+}
+
+void frame_timing_free(void)
+{
+	if (gpu_enabled) {
+		free_gpu_frames();
+		gpu_enabled = false;
+		gpu_scopes_enabled = false;
+	}
+
+	for (size_t i = 0; i < OBS_FRAME_TIMING_STAGE_COUNT; i++)
+		memset(&cpu_rings[i], 0, sizeof(cpu_rings[i]));
+	frames_since_publish = 0;
+}
+
+void obs_enable_video_frame_timing_gpu(bool enable)
+{
+	os_atomic_set_bool(&gpu_enable_next, enable);
+}
+
+void obs_enable_gpu_profiler(bool enable)
+{
+	os_atomic_set_bool(&gpu_scopes_enable_next, enable);
+}
+
+bool gpu_profiler_active(void)
+{
+	return gpu_scopes_enabled;
+}
+
+void obs_gpu_profile_start(const char *name)
+{
+	size_t idx = GPU_SCOPE_SKIPPED;
+
+	if (!gpu_scopes_enabled || !obs_in_task_thread(OBS_TASK_GRAPHICS))
+		return;
+
+	struct gpu_frame *frame = &gpu_frames[gpu_frame_idx];
+
+	if (frame->range && frame->num_scopes < MAX_GPU_SCOPES) {
+		if (frame->num_scopes == frame->scopes.num)
+			da_push_back_new(frame->scopes);
+
+		struct gpu_scope *scope = &frame->scopes.array[frame->num_scopes];
+
+		gs_enter_context(obs->video.graphics);
+		if (!scope->timer)
+			scope->timer = gs_timer_create();
+		if (scope->timer) {
+			gs_timer_begin(scope->timer);
+			scope->name = name;
+			scope->ended = false;
+			idx = frame->num_scopes++;
+		}
+		gs_leave_context();
+	}
+
+	da_push_back(open_gpu_scopes, &idx);
+}
+
+void obs_gpu_profile_end(const char *name)
+{
+	if (!gpu_scopes_enabled || !open_gpu_scopes.num || !obs_in_task_thread(OBS_TASK_GRAPHICS))
+		return;
+
+	const size_t idx = *(size_t *)da_end(open_gpu_scopes);
+	da_pop_back(open_gpu_scopes);
+
+	if (idx == GPU_SCOPE_SKIPPED)
+		return;
+
+	struct gpu_scope *scope = &gpu_frames[gpu_frame_idx].scopes.array[idx];
+	if (scope->name != name)
+		blog(LOG_DEBUG, "obs_gpu_profile_end: '%s' ended while '%s' was open", name, scope->name);
+
+	gs_enter_context(obs->video.graphics);
+	gs_timer_end(scope->timer);
+	gs_leave_context();
+	scope->ended = true;
+}
+
+bool obs_get_video_frame_timing(struct obs_video_frame_timing *timing)
+{
+	long seq;
+
+	if (!obs_ptr_valid(timing, "obs_get_video_frame_timing"))
+		return false;
+
+	do {
+		seq = os_atomic_load_long(&published_seq);
+		if (seq & 1)
+			continue;
+
+		*timing = published;
+
+		/* also orders the copy above before the sequence check */
+	} while ((seq & 1) || !os_atomic_compare_swap_long(&published_seq, seq, seq));
+
+	return timing->samples != 0;
+}
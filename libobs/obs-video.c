@@ -17,6 +17,7 @@
 
 #include <time.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -29,8 +30,252 @@
 #include <windows.h>
 #endif
 
+#define MAX_TICK_THREADS 4
+#define MAX_UPLOAD_THREADS 4
+
+static void run_tick_jobs(void)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_data *data = &obs->data;
+	const long num = (long)data->tick_jobs.num;
+
+	for (;;) {
+		const long idx = os_atomic_inc_long(&video->tick_next) - 1;
+		if (idx >= num)
+			break;
+
+		struct obs_tick_job *job = &data->tick_jobs.array[idx];
+		obs_source_t *s = job->source;
+		const uint64_t start = os_gettime_ns();
+		s->info.video_tick(s->context.data, video->tick_seconds);
+		job->tick_time += os_gettime_ns() - start;
+	}
+}
+
+static void *tick_thread(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+
+	os_set_thread_name("libobs: tick thread");
+	obs_set_alloc_counter(OBS_ALLOC_VIDEO);
+
+	while (os_sem_wait(video->tick_semaphore) == 0) {
+		if (os_atomic_load_bool(&video->tick_stop))
+			break;
+
+		obs_apply_core_thread_affinity();
+		run_tick_jobs();
+
+		if (os_atomic_dec_long(&video->tick_busy) == 0)
+			os_event_signal(video->tick_done);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+bool init_tick_threads(void)
+{
+	struct obs_core_video *video = &obs->video;
+	int num_threads = os_get_logical_cores() - 2;
+
+	if (num_threads > MAX_TICK_THREADS)
+		num_threads = MAX_TICK_THREADS;
+	if (num_threads <= 0)
+		return true;
+
+	video->tick_stop = false;
+
+	if (os_sem_init(&video->tick_semaphore, 0) != 0)
+		goto fail;
+	if (os_event_init(&video->tick_done, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	for (int i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, tick_thread, NULL) != 0)
+			goto fail;
+		da_push_back(video->tick_threads, &thread);
+	}
+
+	return true;
+
+fail:
+	/* stops and joins the threads that did start */
+	free_tick_threads();
+	return false;
+}
+
+void free_tick_threads(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	os_atomic_set_bool(&video->tick_stop, true);
+	for (size_t i = 0; i < video->tick_threads.num; i++)
+		os_sem_post(video->tick_semaphore);
+	for (size_t i = 0; i < video->tick_threads.num; i++)
+		pthread_join(video->tick_threads.array[i], NULL);
+	da_free(video->tick_threads);
+
+	if (video->tick_semaphore) {
+		os_sem_destroy(video->tick_semaphore);
+		video->tick_semaphore = NULL;
+	}
+	if (video->tick_done) {
+		os_event_destroy(video->tick_done);
+		video->tick_done = NULL;
+	}
+}
+
+static void copy_async_upload(struct obs_async_upload *upload)
+{
+	const struct obs_source_frame *frame = upload->frame;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		uint8_t *ptr = upload->ptr[c];
+		if (!ptr)
+			continue;
+
+		const uint8_t *data = frame->data[c];
+		const uint32_t linesize = frame->linesize[c];
+		const uint32_t linesize_out = upload->linesize[c];
+		const size_t row_copy = (linesize < linesize_out) ? linesize : linesize_out;
+		const uint32_t height = upload->height[c];
+
+		if (linesize == linesize_out) {
+			memcpy(ptr, data, row_copy * height);
+		} else {
+			for (uint32_t y = 0; y < height; y++) {
+				memcpy(ptr, data, row_copy);
+				ptr += linesize_out;
+				data += linesize;
+			}
+		}
+	}
+
+	os_event_signal(upload->done);
+}
+
+static void *upload_thread(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+
+	os_set_thread_name("libobs: upload thread");
+	obs_set_alloc_counter(OBS_ALLOC_VIDEO);
+
+	while (os_sem_wait(video->upload_semaphore) == 0) {
+		struct obs_async_upload *upload = NULL;
+
+		pthread_mutex_lock(&video->upload_mutex);
+		if (video->upload_queue.size)
+			deque_pop_front(&video->upload_queue, &upload, sizeof(upload));
+		pthread_mutex_unlock(&video->upload_mutex);
+
+		/* queued last, once everything before it is done */
+		if (!upload)
+			break;
+
+		copy_async_upload(upload);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+bool init_upload_threads(void)
+{
+	struct obs_core_video *video = &obs->video;
+	int num_threads = os_get_logical_cores() / 4;
+
+	if (num_threads > MAX_UPLOAD_THREADS)
+		num_threads = MAX_UPLOAD_THREADS;
+	if (num_threads <= 0)
+		return true;
+
+	if (pthread_mutex_init(&video->upload_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&video->upload_semaphore, 0) != 0)
+		return false;
+
+	for (int i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, upload_thread, NULL) != 0)
+			return false;
+		da_push_back(video->upload_threads, &thread);
+	}
+
+	return true;
+}
+
+void free_upload_threads(void)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_async_upload *stop = NULL;
+
+	if (!video->upload_semaphore)
+		return;
+
+	pthread_mutex_lock(&video->upload_mutex);
+	for (size_t i = 0; i < video->upload_threads.num; i++)
+		deque_push_back(&video->upload_queue, &stop, sizeof(stop));
+	pthread_mutex_unlock(&video->upload_mutex);
+
+	for (size_t i = 0; i < video->upload_threads.num; i++)
+		os_sem_post(video->upload_semaphore);
+	for (size_t i = 0; i < video->upload_threads.num; i++)
+		pthread_join(video->upload_threads.array[i], NULL);
+	da_free(video->upload_threads);
+
+	deque_free(&video->upload_queue);
+	os_sem_destroy(video->upload_semaphore);
+	video->upload_semaphore = NULL;
+	pthread_mutex_destroy(&video->upload_mutex);
+}
+
+/* returns false if there are no upload threads, in which case the frame has
+ * to be uploaded on the graphics thread */
+bool obs_queue_async_upload(struct obs_async_upload *upload)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (!video->upload_threads.num)
+		return false;
+
+	pthread_mutex_lock(&video->upload_mutex);
+	deque_push_back(&video->upload_queue, &upload, sizeof(upload));
+	pthread_mutex_unlock(&video->upload_mutex);
+
+	os_sem_post(video->upload_semaphore);
+	return true;
+}
+
+/* runs the video_tick callbacks of thread-safe sources on the tick threads,
+ * with the graphics thread taking jobs as well */
+static void tick_sources_parallel(float seconds)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_data *data = &obs->data;
+
+	long workers = (long)data->tick_jobs.num - 1;
+	if (workers > (long)video->tick_threads.num)
+		workers = (long)video->tick_threads.num;
+
+	video->tick_seconds = seconds;
+	os_atomic_set_long(&video->tick_next, 0);
+	os_atomic_set_long(&video->tick_busy, workers);
+
+	for (long i = 0; i < workers; i++)
+		os_sem_post(video->tick_semaphore);
+
+	run_tick_jobs();
+
+	if (workers > 0)
+		os_event_wait(video->tick_done);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
+	struct obs_core_video *video = &obs->video;
 	struct obs_core_data *data = &obs->data;
 	struct obs_source *source;
 	uint64_t delta_time;
@@ -75,20 +320,112 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
+	const bool parallel = video->tick_threads.num > 0;
+	da_clear(data->tick_jobs);
+
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
 		obs_source_t *s = data->sources_to_tick.array[i];
 		const uint64_t start = source_profiler_source_tick_start();
-		obs_source_video_tick(s, seconds);
+
+		if (parallel && (s->info.output_flags & OBS_SOURCE_TICK_THREADSAFE) != 0) {
+			if (obs_source_video_tick_prepare(s, seconds)) {
+				struct obs_tick_job job = {.source = s};
+				if (start)
+					job.tick_time = os_gettime_ns() - start;
+				da_push_back(data->tick_jobs, &job);
+				continue;
+			}
+
+			obs_source_video_tick_finish(s);
+		} else {
+			obs_source_video_tick(s, seconds);
+		}
+
 		source_profiler_source_tick_end(s, start);
 		obs_source_release(s);
 	}
 
+	if (data->tick_jobs.num) {
+		tick_sources_parallel(seconds);
+
+		for (size_t i = 0; i < data->tick_jobs.num; i++) {
+			struct obs_tick_job *job = &data->tick_jobs.array[i];
+			obs_source_video_tick_finish(job->source);
+			source_profiler_source_tick_record(job->source, job->tick_time);
+			obs_source_release(job->source);
+		}
+	}
+
 	return cur_time;
 }
 
+/* Nested scenes that are rendered more than once in a frame (the same scene
+ * used by multiple canvases, or nested in several scenes) only need to be
+ * drawn once.  Textures are looked up by source and color space and
+ * reset at the start of every frame; textures not used during the last
+ * frame are freed.  Sources are matched by their weak reference, which the
+ * cache holds, rather than by their address, which a new source could get
+ * once the old one is destroyed. */
+gs_texrender_t *obs_get_shared_texrender(obs_source_t *source, enum gs_color_space space)
+{
+	struct obs_core_video *video = &obs->video;
+	obs_weak_source_t *weak = (obs_weak_source_t *)source->context.control;
+	struct obs_shared_texrender *shared;
+
+	for (size_t i = 0; i < video->shared_texrenders.num; i++) {
+		shared = &video->shared_texrenders.array[i];
+		if (shared->weak == weak && shared->space == space) {
+			shared->last_frame = video->shared_texrender_frame;
+			return shared->texrender;
+		}
+	}
+
+	gs_texrender_t *texrender = gs_texrender_create(gs_get_format_from_space(space), GS_ZS_NONE);
+	if (!texrender)
+		return NULL;
+
+	shared = da_push_back_new(video->shared_texrenders);
+	shared->weak = obs_source_get_weak_source(source);
+	shared->space = space;
+	shared->texrender = texrender;
+	shared->last_frame = video->shared_texrender_frame;
+	return texrender;
+}
+
+static void reset_shared_texrenders(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = video->shared_texrenders.num; i > 0; i--) {
+		struct obs_shared_texrender *shared = &video->shared_texrenders.array[i - 1];
+		if (shared->last_frame != video->shared_texrender_frame) {
+			gs_texrender_destroy(shared->texrender);
+			obs_weak_source_release(shared->weak);
+			da_erase(video->shared_texrenders, i - 1);
+		} else {
+			gs_texrender_reset(shared->texrender);
+		}
+	}
+
+	video->shared_texrender_frame++;
+}
+
+void obs_free_shared_texrenders(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->shared_texrenders.num; i++) {
+		gs_texrender_destroy(video->shared_texrenders.array[i].texrender);
+		obs_weak_source_release(video->shared_texrenders.array[i].weak);
+	}
+	da_free(video->shared_texrenders);
+}
+
 /* in obs-display.c */
 extern void render_display(struct obs_display *display);
 
+static const char *render_display_name = "render_display";
+
 static inline void render_displays(void)
 {
 	struct obs_display *display;
@@ -103,7 +440,9 @@ static inline void render_displays(void)
 
 	display = obs->data.first_display;
 	while (display) {
+		obs_gpu_profile_start(render_display_name);
 		render_display(display);
+		obs_gpu_profile_end(render_display_name);
 		display = display->next;
 	}
 
@@ -121,12 +460,29 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video_mix *video)
+static inline void wait_for_readback(struct obs_core_video_mix *video, int slot)
+{
+	if (!video->readback_done)
+		return;
+
+	for (;;) {
+		pthread_mutex_lock(&video->readback_mutex);
+		const bool busy = video->readback_busy[slot];
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		if (!busy)
+			break;
+
+		os_event_wait(video->readback_done);
+	}
+}
+
+static inline void unmap_surfaces(struct obs_core_video_mix *video, int slot)
 {
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+		if (video->mapped_surfaces[slot][c]) {
+			gs_stagesurface_unmap(video->mapped_surfaces[slot][c]);
+			video->mapped_surfaces[slot][c] = NULL;
 		}
 	}
 }
@@ -167,14 +523,49 @@ static inline void draw_mix_texture(const size_t mix_idx)
 }
 
 static const char *render_main_texture_name = "render_main_texture";
+/* assumes draw_callbacks_mutex is locked */
+static bool main_texture_changed(struct obs_core_video_mix *video)
+{
+	const float sdr_white_level = obs->video.sdr_white_level;
+	const float hdr_nominal_peak_level = obs->video.hdr_nominal_peak_level;
+	/* still redraw about once per second, render targets don't survive a
+	 * device rebuild */
+	const uint32_t max_reused = video->ovi.fps_num / video->ovi.fps_den;
+	bool changed = !video->main_texture_valid || video->main_texture_reused >= max_reused ||
+		       obs->data.draw_callbacks.num > 0 || video->last_sdr_white_level != sdr_white_level ||
+		       video->last_hdr_nominal_peak_level != hdr_nominal_peak_level;
+
+	/* always called so the channel serial stays current */
+	if (obs_view_video_changed(video->view, &video->last_channels_serial))
+		changed = true;
+
+	video->last_sdr_white_level = sdr_white_level;
+	video->last_hdr_nominal_peak_level = hdr_nominal_peak_level;
+	return changed;
+}
+
+static const char *render_main_texture_skipped_name = "render_main_texture_skipped";
 static inline void render_main_texture(struct obs_core_video_mix *video)
 {
 	uint32_t base_width = video->ovi.base_width;
 	uint32_t base_height = video->ovi.base_height;
 
 	profile_start(render_main_texture_name);
+	obs_gpu_profile_start(render_main_texture_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE, render_main_texture_name);
 
+	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
+	const bool changed = main_texture_changed(video);
+	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+
+	/* nothing drawn into the mix changed, keep the previous frame */
+	if (!changed) {
+		video->main_texture_reused++;
+		profile_start(render_main_texture_skipped_name);
+		profile_end(render_main_texture_skipped_name);
+		goto rendered;
+	}
+
 	struct vec4 clear_color;
 	vec4_set(&clear_color, 0.0f, 0.0f, 0.0f, 0.0f);
 
@@ -199,6 +590,10 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 	else
 		obs_view_render(video->view);
 
+	video->main_texture_valid = true;
+	video->main_texture_reused = 0;
+
+rendered:
 	video->texture_rendered = true;
 
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
@@ -211,6 +606,7 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
 
 	GS_DEBUG_MARKER_END();
+	obs_gpu_profile_end(render_main_texture_name);
 	profile_end(render_main_texture_name);
 }
 
@@ -264,6 +660,148 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video_mix *mix, uint
 	}
 }
 
+static inline float lanczos_weight(double x)
+{
+	if (fabs(x) < 1e-6)
+		return 1.0f;
+
+	double x_pi = x * M_PI;
+	return (float)(3.0 * sin(x_pi) * sin(x_pi / 3.0) / (x_pi * x_pi));
+}
+
+/* one row of RGBA32F texel pairs per pass, the layout is described in
+ * lanczos_separable_scale.effect */
+static gs_texture_t *create_separable_weights(uint32_t src, uint32_t dst)
+{
+	float *data = bmalloc(sizeof(float) * 8 * dst);
+	const double ratio = (double)src / (double)dst;
+
+	for (uint32_t i = 0; i < dst; i++) {
+		double pos = ((double)i + 0.5) * ratio;
+		double center = floor(pos - 0.5);
+		double f_neg = center + 0.5 - pos;
+		float w[6];
+		float sum = 0.0f;
+
+		for (int tap = 0; tap < 6; tap++) {
+			w[tap] = lanczos_weight(f_neg + (double)(tap - 2));
+			sum += w[tap];
+		}
+		for (int tap = 0; tap < 6; tap++)
+			w[tap] /= sum;
+
+		float *texel0 = data + i * 4;
+		float *texel1 = data + (dst + i) * 4;
+		float middle = w[2] + w[3];
+
+		texel0[0] = w[0];
+		texel0[1] = w[1];
+		texel0[2] = middle;
+		texel0[3] = w[4];
+		texel1[0] = w[5];
+		texel1[1] = (float)(center - 2.0);
+		texel1[2] = (float)(center + 0.5) + w[3] / middle;
+		texel1[3] = 0.0f;
+	}
+
+	gs_texture_t *tex = gs_texture_create(dst, 2, GS_RGBA32F, 1, (const uint8_t **)&data, 0);
+	bfree(data);
+	return tex;
+}
+
+static bool init_separable_scale(struct obs_core_video_mix *mix, uint32_t width, uint32_t height)
+{
+	const uint32_t base_width = mix->ovi.base_width;
+	const uint32_t base_height = mix->ovi.base_height;
+
+	/* the base size is fixed for the lifetime of the mix */
+	if (mix->scale_texture && gs_texture_get_width(mix->scale_weights_x) == width &&
+	    gs_texture_get_width(mix->scale_weights_y) == height)
+		return true;
+
+	gs_texture_destroy(mix->scale_texture);
+	gs_texture_destroy(mix->scale_weights_x);
+	gs_texture_destroy(mix->scale_weights_y);
+
+	/* float, so the negative lobes survive between the passes */
+	mix->scale_texture = gs_texture_create(width, base_height, GS_RGBA16F, 1, NULL, GS_RENDER_TARGET);
+	mix->scale_weights_x = create_separable_weights(base_width, width);
+	mix->scale_weights_y = create_separable_weights(base_height, height);
+
+	if (!mix->scale_texture || !mix->scale_weights_x || !mix->scale_weights_y) {
+		blog(LOG_WARNING, "Failed to create separable scale textures, "
+				  "falling back to single pass scaling");
+		gs_texture_destroy(mix->scale_texture);
+		gs_texture_destroy(mix->scale_weights_x);
+		gs_texture_destroy(mix->scale_weights_y);
+		mix->scale_texture = NULL;
+		mix->scale_weights_x = NULL;
+		mix->scale_weights_y = NULL;
+		mix->separable_scale_failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+static void render_separable_pass(gs_effect_t *effect, const char *tech_name, gs_texture_t *weights,
+				  uint32_t src_width, uint32_t src_height, uint32_t width, uint32_t height)
+{
+	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
+	struct vec2 base, base_i, target;
+
+	vec2_set(&base, (float)src_width, (float)src_height);
+	vec2_set(&base_i, 1.0f / (float)src_width, 1.0f / (float)src_height);
+	vec2_set(&target, (float)width, (float)height);
+	gs_effect_set_vec2(gs_effect_get_param_by_name(effect, "base_dimension"), &base);
+	gs_effect_set_vec2(gs_effect_get_param_by_name(effect, "base_dimension_i"), &base_i);
+	gs_effect_set_vec2(gs_effect_get_param_by_name(effect, "target_dimension"), &target);
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "weights"), weights);
+
+	set_render_size(width, height);
+
+	size_t passes = gs_technique_begin(tech);
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
+		gs_draw_sprite(NULL, 0, width, height);
+		gs_technique_end_pass(tech);
+	}
+	gs_technique_end(tech);
+}
+
+/* lanczos is separable, so scaling one axis at a time takes 5 + 5 fetches
+ * per pixel instead of the 25 of the single pass shader */
+static bool render_separable_scale(struct obs_core_video_mix *mix, gs_texture_t *texture, gs_texture_t *target)
+{
+	struct obs_core_video *video = &obs->video;
+	gs_effect_t *effect = video->lanczos_separable_effect;
+	const uint32_t base_width = mix->ovi.base_width;
+	const uint32_t base_height = mix->ovi.base_height;
+	const uint32_t width = gs_texture_get_width(target);
+	const uint32_t height = gs_texture_get_height(target);
+
+	if (!effect || mix->separable_scale_failed || !init_separable_scale(mix, width, height))
+		return false;
+
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	gs_enable_blending(false);
+
+	gs_set_render_target(mix->scale_texture, NULL);
+	gs_effect_set_texture_srgb(image, texture);
+	gs_enable_framebuffer_srgb(false);
+	render_separable_pass(effect, "DrawX", mix->scale_weights_x, base_width, base_height, width, base_height);
+
+	gs_set_render_target(target, NULL);
+	gs_effect_set_texture(image, mix->scale_texture);
+	gs_enable_framebuffer_srgb(true);
+	render_separable_pass(effect, "DrawY", mix->scale_weights_y, width, base_height, width, height);
+
+	gs_enable_framebuffer_srgb(false);
+	gs_enable_blending(true);
+	return true;
+}
+
 static const char *render_output_texture_name = "render_output_texture";
 static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix)
 {
@@ -276,8 +814,15 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix
 		return texture;
 
 	profile_start(render_output_texture_name);
+	obs_gpu_profile_start(render_output_texture_name);
 
 	gs_effect_t *effect = get_scale_effect(mix, width, height);
+	if (effect == obs->video.lanczos_effect && render_separable_scale(mix, texture, target)) {
+		obs_gpu_profile_end(render_output_texture_name);
+		profile_end(render_output_texture_name);
+		return target;
+	}
+
 	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
 
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
@@ -314,6 +859,7 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video_mix *mix
 	gs_enable_blending(true);
 	gs_enable_framebuffer_srgb(false);
 
+	obs_gpu_profile_end(render_output_texture_name);
 	profile_end(render_output_texture_name);
 
 	return target;
@@ -343,6 +889,7 @@ static void render_convert_texture(struct obs_core_video_mix *video, gs_texture_
 				   gs_texture_t *texture)
 {
 	profile_start(render_convert_texture_name);
+	obs_gpu_profile_start(render_convert_texture_name);
 
 	gs_effect_t *effect = obs->video.conversion_effect;
 	gs_eparam_t *color_vec0 = gs_effect_get_param_by_name(effect, "color_vec0");
@@ -398,6 +945,7 @@ static void render_convert_texture(struct obs_core_video_mix *video, gs_texture_
 
 	video->texture_converted = true;
 
+	obs_gpu_profile_end(render_convert_texture_name);
 	profile_end(render_convert_texture_name);
 }
 
@@ -407,8 +955,12 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 					gs_stagesurf_t *const *const copy_surfaces, size_t channel_count)
 {
 	profile_start(stage_output_texture_name);
+	obs_gpu_profile_start(stage_output_texture_name);
 
-	unmap_last_surface(video);
+	/* the surfaces of this slot may still be mapped (and, with pipelined
+	 * readback, still being copied from) since they were last downloaded */
+	wait_for_readback(video, cur_texture);
+	unmap_surfaces(video, cur_texture);
 
 	if (!video->gpu_conversion) {
 		gs_stagesurf_t *copy = copy_surfaces[0];
@@ -434,11 +986,16 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 		video->textures_copied[cur_texture] = true;
 	}
 
+	obs_gpu_profile_end(stage_output_texture_name);
 	profile_end(stage_output_texture_name);
 }
 
+/* the encoder ring is shared with the GPU encode thread, so gpu_encoder_mutex
+ * is only held around the ring itself and not while waiting on the GPU */
 static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active, struct obs_vframe_info *vframe_info)
 {
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+
 	bool duplicate = !video->gpu_encoder_avail_queue.size ||
 			 (video->gpu_encoder_queue.size && vframe_info->count > 1);
 
@@ -448,10 +1005,16 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 
 		/* texture-based encoding is stopping */
 		if (!tf) {
+			pthread_mutex_unlock(&video->gpu_encoder_mutex);
 			return false;
 		}
 
+		if (!video->gpu_encoder_avail_queue.size)
+			video->gpu_encode_stalls++;
+
 		tf->count++;
+		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
 		os_sem_post(video->gpu_encode_semaphore);
 		goto finish;
 	}
@@ -459,6 +1022,12 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 	struct obs_tex_frame tf;
 	deque_pop_front(&video->gpu_encoder_avail_queue, &tf, sizeof(tf));
 
+	const bool copy = raw_active || vframe_info->count > 1;
+	if (copy)
+		video->gpu_encode_copies++;
+
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
 	if (tf.released) {
 #ifdef _WIN32
 		gs_texture_acquire_sync(tf.tex, tf.lock_key, GS_WAIT_INFINITE);
@@ -470,7 +1039,7 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 	 * some chance the very first frame has to be duplicated for whatever
 	 * reason.  otherwise, it goes to the 'duplicate' case above, which
 	 * will ensure better performance. */
-	if (raw_active || vframe_info->count > 1) {
+	if (copy) {
 		gs_copy_texture(tf.tex, video->convert_textures_encode[0]);
 #ifndef _WIN32
 		/* Y and UV textures are views of the same texture on D3D, and
@@ -497,7 +1066,10 @@ static inline bool queue_frame(struct obs_core_video_mix *video, bool raw_active
 	tf.handle = gs_texture_get_shared_handle(tf.tex);
 	gs_texture_release_sync(tf.tex, ++tf.lock_key);
 #endif
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
 	deque_push_back(&video->gpu_encoder_queue, &tf, sizeof(tf));
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 
 	os_sem_post(video->gpu_encode_semaphore);
 
@@ -526,9 +1098,7 @@ static void output_gpu_encoders(struct obs_core_video_mix *video, bool raw_activ
 	struct obs_vframe_info vframe_info;
 	deque_pop_front(&video->vframe_info_buffer_gpu, &vframe_info, sizeof(vframe_info));
 
-	pthread_mutex_lock(&video->gpu_encoder_mutex);
 	encode_gpu(video, raw_active, &vframe_info);
-	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 
 end:
 	profile_end(output_gpu_encoders_name);
@@ -553,7 +1123,7 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 		if (gpu_active) {
 			convert_textures = video->convert_textures_encode;
 #ifdef _WIN32
-			copy_surfaces = video->copy_surfaces_encode;
+			copy_surfaces = &video->copy_surfaces_encode[cur_texture];
 			channel_count = 1;
 #endif
 			gs_flush();
@@ -580,18 +1150,18 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video_mix *video, int prev_texture, struct video_data *frame)
+static inline bool download_frame(struct obs_core_video_mix *video, int read_texture, struct video_data *frame)
 {
-	if (!video->textures_copied[prev_texture])
+	if (!video->textures_copied[read_texture])
 		return false;
 
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-		gs_stagesurf_t *surface = video->active_copy_surfaces[prev_texture][channel];
+		gs_stagesurf_t *surface = video->active_copy_surfaces[read_texture][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel], &frame->linesize[channel]))
 				return false;
 
-			video->mapped_surfaces[channel] = surface;
+			video->mapped_surfaces[read_texture][channel] = surface;
 		}
 	}
 	return true;
@@ -794,6 +1364,178 @@ static inline void output_video_data(struct obs_core_video_mix *video, struct vi
 	}
 }
 
+#define NBSP "\xC2\xA0"
+
+static const char *readback_output_video_data_name = "output_video_data";
+static void *readback_thread(void *data)
+{
+	struct obs_core_video_mix *video = data;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("libobs: readback thread");
+	obs_set_alloc_counter(OBS_ALLOC_VIDEO);
+	const char *readback_thread_name = profile_store_name(obs_get_profiler_name_store(),
+							      "obs_readback_thread(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(readback_thread_name, interval);
+
+	while (os_sem_wait(video->readback_semaphore) == 0) {
+		struct obs_readback_job job;
+
+		if (os_atomic_load_bool(&video->readback_stop))
+			break;
+
+		obs_apply_core_thread_affinity();
+
+		pthread_mutex_lock(&video->readback_mutex);
+		deque_pop_front(&video->readback_queue, &job, sizeof(job));
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		profile_start(readback_thread_name);
+		profile_start(readback_output_video_data_name);
+		output_video_data(video, &job.frame, job.count);
+		profile_end(readback_output_video_data_name);
+		profile_end(readback_thread_name);
+
+		pthread_mutex_lock(&video->readback_mutex);
+		video->readback_busy[job.slot] = false;
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		os_event_signal(video->readback_done);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+bool init_readback(struct obs_core_video_mix *video)
+{
+	video->readback_stop = false;
+	memset(video->readback_busy, 0, sizeof(video->readback_busy));
+
+	if (pthread_mutex_init(&video->readback_mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&video->readback_done, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
+	/* zero-copy frames are handed to the video output as is, so there
+	 * is nothing left to copy out on a separate thread */
+	if (video->readback_zero_copy || video->readback_depth <= NUM_TEXTURES)
+		return true;
+
+	if (os_sem_init(&video->readback_semaphore, 0) != 0)
+		return false;
+	if (pthread_create(&video->readback_thread, NULL, readback_thread, video) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+void stop_readback_thread(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized) {
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_semaphore);
+		pthread_join(video->readback_thread, NULL);
+		video->readback_thread_initialized = false;
+	}
+}
+
+void free_readback(struct obs_core_video_mix *video)
+{
+	if (video->readback_semaphore) {
+		os_sem_destroy(video->readback_semaphore);
+		video->readback_semaphore = NULL;
+	}
+	if (video->readback_done) {
+		os_event_destroy(video->readback_done);
+		video->readback_done = NULL;
+	}
+
+	deque_free(&video->readback_queue);
+	pthread_mutex_destroy(&video->readback_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
+}
+
+static inline void queue_readback(struct obs_core_video_mix *video, int slot, struct video_data *frame, int count)
+{
+	struct obs_readback_job job = {.frame = *frame, .slot = slot, .count = count};
+
+	pthread_mutex_lock(&video->readback_mutex);
+	video->readback_busy[slot] = true;
+	deque_push_back(&video->readback_queue, &job, sizeof(job));
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	os_sem_post(video->readback_semaphore);
+}
+
+static void release_zero_copy_frame(void *param)
+{
+	struct obs_readback_ref *ref = param;
+	struct obs_core_video_mix *video = ref->mix;
+
+	pthread_mutex_lock(&video->readback_mutex);
+	video->readback_busy[ref->slot] = false;
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	os_event_signal(video->readback_done);
+}
+
+static bool get_zero_copy_frame(struct obs_core_video_mix *video, const struct video_data *input,
+				struct video_data *output)
+{
+	const struct video_output_info *info = video_output_get_info(video->video);
+
+	*output = *input;
+
+	if (!video->gpu_conversion)
+		return true;
+
+	switch (info->format) {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
+		/* Y and UV planes staged as a single surface */
+		if (!input->linesize[1]) {
+			output->data[1] = input->data[0] + (size_t)input->linesize[0] * info->height;
+			output->linesize[1] = input->linesize[0];
+		}
+		return true;
+
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static bool output_video_data_zero_copy(struct obs_core_video_mix *video, int slot, struct video_data *input_frame,
+					int count)
+{
+	struct obs_readback_ref *ref = &video->readback_refs[slot];
+	struct video_data frame;
+
+	if (!get_zero_copy_frame(video, input_frame, &frame))
+		return false;
+
+	ref->mix = video;
+	ref->slot = slot;
+
+	pthread_mutex_lock(&video->readback_mutex);
+	video->readback_busy[slot] = true;
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	/* a full cache counts the frame as skipped, same as the copy path */
+	if (!video_output_push_frame_ref(video->video, &frame, count, release_zero_copy_frame, ref))
+		release_zero_copy_frame(ref);
+
+	return true;
+}
+
 void add_ready_encoder_group(obs_encoder_t *encoder)
 {
 	obs_weak_encoder_t *weak = obs_encoder_get_weak_encoder(encoder);
@@ -802,14 +1544,65 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
-static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, uint64_t interval_ns)
+/* By default the pacing timer sleeps until the frame is due.  With precise
+ * pacing on, it's set to wake up early by a slack that tracks how late the
+ * timer has been waking up recently, and the remaining time is spun off.
+ * Overshoot grows the slack immediately and it decays slowly afterwards.
+ * The spin keeps a core busy for up to the slack every frame, which is why
+ * it's opt-in. */
+#define PACING_SLACK_MIN_NS 100000ULL
+#define PACING_SLACK_MAX_NS 2000000ULL
+#define PACING_SLACK_DEFAULT_NS 500000ULL
+
+static const char *frame_pacing_error_name = "frame_pacing_error";
+static bool frame_pacing_sleepto(struct obs_graphics_context *context, uint64_t target)
+{
+	if (!context->pacing_timer)
+		return os_sleepto_ns(target);
+
+	uint64_t cur_time = os_gettime_ns();
+	if (target < cur_time)
+		return false;
+
+	if (!os_atomic_load_bool(&obs->video.precise_pacing)) {
+		os_hr_timer_sleepto_ns(context->pacing_timer, target);
+		profile_record(frame_pacing_error_name, os_gettime_ns() - target);
+		return true;
+	}
+
+	const uint64_t slack = context->pacing_slack_ns;
+	if (target - cur_time > slack) {
+		const uint64_t wake_target = target - slack;
+		os_hr_timer_sleepto_ns(context->pacing_timer, wake_target);
+
+		cur_time = os_gettime_ns();
+		const uint64_t overshoot = cur_time > wake_target ? cur_time - wake_target : 0;
+		uint64_t wanted = overshoot + overshoot / 4 + PACING_SLACK_MIN_NS;
+		if (wanted > PACING_SLACK_MAX_NS)
+			wanted = PACING_SLACK_MAX_NS;
+
+		if (wanted > slack)
+			context->pacing_slack_ns = wanted;
+		else
+			context->pacing_slack_ns = slack - (slack - wanted) / 16;
+	}
+
+	while (cur_time < target)
+		cur_time = os_gettime_ns();
+
+	profile_record(frame_pacing_error_name, cur_time - target);
+	return true;
+}
+
+static inline void video_sleep(struct obs_core_video *video, struct obs_graphics_context *context, uint64_t *p_time,
+			       uint64_t interval_ns)
 {
 	struct obs_vframe_info vframe_info;
 	uint64_t cur_time = *p_time;
 	uint64_t t = cur_time + interval_ns;
 	int count;
 
-	if (os_sleepto_ns(t)) {
+	if (frame_pacing_sleepto(context, t)) {
 		*p_time = t;
 		count = 1;
 	} else {
@@ -870,8 +1663,9 @@ static inline void output_frame(struct obs_core_video_mix *video)
 	const bool raw_active = video->raw_was_active;
 	const bool gpu_active = video->gpu_was_active;
 
+	/* download the oldest staged frame, readback_depth - 1 frames ago */
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
+	int read_texture = (cur_texture + 1) % video->readback_depth;
 	struct video_data frame;
 	bool frame_ready = 0;
 
@@ -888,7 +1682,7 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
+		frame_ready = download_frame(video, read_texture, &frame);
 		profile_end(output_frame_download_frame_name);
 	}
 
@@ -904,12 +1698,19 @@ static inline void output_frame(struct obs_core_video_mix *video)
 		deque_pop_front(&video->vframe_info_buffer, &vframe_info, sizeof(vframe_info));
 
 		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
+		if (video->readback_zero_copy &&
+		    output_video_data_zero_copy(video, read_texture, &frame, vframe_info.count)) {
+			/* surfaces stay mapped until the output releases them */
+		} else if (video->readback_thread_initialized) {
+			queue_readback(video, read_texture, &frame, vframe_info.count);
+		} else {
+			profile_start(output_frame_output_video_data_name);
+			output_video_data(video, &frame, vframe_info.count);
+			profile_end(output_frame_output_video_data_name);
+		}
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->readback_depth)
 		video->cur_texture = 0;
 }
 
@@ -931,8 +1732,6 @@ static inline void output_frames(void)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
@@ -1094,22 +1893,159 @@ static inline bool stop_requested(void)
 	return success;
 }
 
+/* frames over this share of the interval count against the budget */
+#define BUDGET_OVER_PERCENT 90
+/* frames under this share of the interval count towards recovery */
+#define BUDGET_UNDER_PERCENT 60
+/* consecutive frames over budget before degrading further */
+#define BUDGET_OVER_FRAMES 5
+/* time spent well within budget before restoring a level */
+#define BUDGET_RECOVER_NS 2000000000ULL
+
+static void set_render_degradation(long level, uint64_t frame_time_ns, uint64_t interval)
+{
+	struct obs_core_video *video = &obs->video;
+	long prev = os_atomic_set_long(&video->render_degradation, level);
+	struct calldata params;
+	uint8_t stack[128];
+
+	if (prev == level)
+		return;
+
+	blog(LOG_INFO, "Render budget: frame took %.2f ms of %.2f ms, degradation level %ld -> %ld",
+	     (double)frame_time_ns / 1000000.0, (double)interval / 1000000.0, prev, level);
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_int(&params, "level", level);
+	signal_handler_signal(obs->signals, "render_degradation", &params);
+}
+
+static void update_render_budget(uint64_t frame_time_ns, uint64_t interval)
+{
+	struct obs_core_video *video = &obs->video;
+	long level = os_atomic_load_long(&video->render_degradation);
+
+	if (!os_atomic_load_bool(&video->render_budget)) {
+		video->budget_over_frames = 0;
+		video->budget_under_frames = 0;
+		if (level != OBS_RENDER_DEGRADATION_NONE)
+			set_render_degradation(OBS_RENDER_DEGRADATION_NONE, frame_time_ns, interval);
+		return;
+	}
+
+	if (frame_time_ns * 100 > interval * BUDGET_OVER_PERCENT) {
+		video->budget_under_frames = 0;
+
+		if (++video->budget_over_frames >= BUDGET_OVER_FRAMES && level < OBS_RENDER_DEGRADATION_MINIMAL) {
+			video->budget_over_frames = 0;
+			set_render_degradation(level + 1, frame_time_ns, interval);
+		}
+
+	} else if (frame_time_ns * 100 < interval * BUDGET_UNDER_PERCENT && level > OBS_RENDER_DEGRADATION_NONE) {
+		video->budget_over_frames = 0;
+
+		if (++video->budget_under_frames >= BUDGET_RECOVER_NS / interval) {
+			video->budget_under_frames = 0;
+			set_render_degradation(level - 1, frame_time_ns, interval);
+		}
+
+	} else {
+		video->budget_over_frames = 0;
+		video->budget_under_frames = 0;
+	}
+}
+
+static bool get_inactive_source(void *param, obs_source_t *source)
+{
+	DARRAY(obs_source_t *) *sources = param;
+
+	if (!os_atomic_load_long(&source->show_refs) && source->color_space_texrender) {
+		obs_source_t *ref = obs_source_get_ref(source);
+		if (ref)
+			da_push_back(*sources, &ref);
+	}
+
+	return true;
+}
+
+#define MBYTE (1024 * 1024)
+
+/* runs about once a second on the graphics thread */
+static void enforce_gpu_memory_budget(void)
+{
+	struct obs_core_video *video = &obs->video;
+	DARRAY(obs_source_t *) sources;
+	struct gs_memory_usage usage;
+	uint64_t before;
+
+	gs_get_memory_usage(video->graphics, &usage);
+	if (!usage.budget || usage.total <= usage.budget) {
+		if (video->gpu_memory_over_budget) {
+			blog(LOG_INFO, "GPU memory is back within budget (%" PRIu64 " MB)", usage.total / MBYTE);
+			video->gpu_memory_over_budget = false;
+		}
+		return;
+	}
+
+	before = usage.total;
+
+	/* sources are collected first, as a source released inside the
+	 * enumeration could be destroyed while holding the sources mutex */
+	da_init(sources);
+	obs_enum_all_sources(get_inactive_source, &sources);
+
+	gs_enter_context(video->graphics);
+
+	for (size_t i = 0; i < sources.num; i++) {
+		obs_source_t *source = sources.array[i];
+		gs_texrender_destroy(source->color_space_texrender);
+		source->color_space_texrender = NULL;
+	}
+
+	gs_texrender_pool_evict();
+	gs_leave_context();
+
+	for (size_t i = 0; i < sources.num; i++)
+		obs_source_release(sources.array[i]);
+	da_free(sources);
+
+	gs_get_memory_usage(video->graphics, &usage);
+
+	if (!video->gpu_memory_over_budget) {
+		uint64_t freed = before > usage.total ? before - usage.total : 0;
+		blog(LOG_WARNING,
+		     "GPU memory over budget (%" PRIu64 " MB of %" PRIu64 " MB), "
+		     "freed %" PRIu64 " MB of cached render targets",
+		     before / MBYTE, usage.budget / MBYTE, freed / MBYTE);
+		video->gpu_memory_over_budget = usage.total > usage.budget;
+	}
+}
+
+#undef MBYTE
+
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
 
+	obs_apply_core_thread_affinity();
 	update_active_states();
+	os_atomic_inc_long(&obs->video.render_serial);
 
 	profile_start(context->video_thread_name);
 	source_profiler_frame_begin();
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	reset_shared_texrenders();
 	gs_leave_context();
 
+	frame_timing_frame_begin();
+
 	profile_start(tick_sources_name);
+	frame_timing_stage_begin(OBS_FRAME_TIMING_TICK);
 	context->last_time = tick_sources(obs->video.video_time, context->last_time);
+	frame_timing_stage_end(OBS_FRAME_TIMING_TICK);
 	profile_end(tick_sources_name);
 
 #ifdef _WIN32
@@ -1122,24 +2058,33 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	source_profiler_render_begin();
 	profile_start(output_frame_name);
+	frame_timing_stage_begin(OBS_FRAME_TIMING_OUTPUT);
 	output_frames();
+	frame_timing_stage_end(OBS_FRAME_TIMING_OUTPUT);
 	profile_end(output_frame_name);
 
 	profile_start(render_displays_name);
+	frame_timing_stage_begin(OBS_FRAME_TIMING_DISPLAYS);
 	render_displays();
+	frame_timing_stage_end(OBS_FRAME_TIMING_DISPLAYS);
 	profile_end(render_displays_name);
 	source_profiler_render_end();
 
 	execute_graphics_tasks();
+	frame_timing_frame_end();
 
 	frame_time_ns = os_gettime_ns() - frame_start;
+	update_render_budget(frame_time_ns, context->interval);
 
 	source_profiler_frame_collect();
 	profile_end(context->video_thread_name);
 
 	profile_reenable_thread();
 
-	video_sleep(&obs->video, &obs->video.video_time, context->interval);
+	const uint32_t lagged_frames = obs->video.lagged_frames;
+	video_sleep(&obs->video, context, &obs->video.video_time, context->interval);
+	if (obs->video.lagged_frames != lagged_frames)
+		source_profiler_frame_lagged();
 
 	context->frame_time_total_ns += frame_time_ns;
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
@@ -1153,6 +2098,8 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 		context->frame_time_total_ns = 0;
 		context->fps_total_ns = 0;
 		context->fps_total_frames = 0;
+
+		enforce_gpu_memory_budget();
 	}
 
 	return !stop_requested();
@@ -1172,6 +2119,7 @@ void *obs_graphics_thread(void *param)
 	obs->video.video_time = os_gettime_ns();
 
 	os_set_thread_name("libobs: graphics thread");
+	obs_set_alloc_counter(OBS_ALLOC_VIDEO);
 
 	const char *video_thread_name = profile_store_name(obs_get_profiler_name_store(),
 							   "obs_graphics_thread(%g" NBSP "ms)", interval / 1000000.);
@@ -1186,6 +2134,8 @@ void *obs_graphics_thread(void *param)
 	context.fps_total_frames = 0;
 	context.last_time = 0;
 	context.video_thread_name = video_thread_name;
+	context.pacing_timer = os_hr_timer_create();
+	context.pacing_slack_ns = PACING_SLACK_DEFAULT_NS;
 
 #ifdef __APPLE__
 	while (obs_graphics_thread_loop_autorelease(&context))
@@ -1194,6 +2144,9 @@ void *obs_graphics_thread(void *param)
 #endif
 		;
 
+	frame_timing_free();
+	os_hr_timer_destroy(context.pacing_timer);
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
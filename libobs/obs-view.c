@@ -102,6 +102,7 @@ void obs_view_set_source(obs_view_t *view, uint32_t channel, obs_source_t *sourc
 	source = obs_source_get_ref(source);
 	prev_source = view->channels[channel];
 	view->channels[channel] = source;
+	os_atomic_inc_long(&view->channels_serial);
 
 	pthread_mutex_unlock(&view->channels_mutex);
 
@@ -114,6 +115,33 @@ void obs_view_set_source(obs_view_t *view, uint32_t channel, obs_source_t *sourc
 	}
 }
 
+/* returns whether any channel would render differently than it did on the
+ * last frame, serial is the channel serial the caller last rendered */
+bool obs_view_video_changed(obs_view_t *view, long *serial)
+{
+	bool changed = false;
+
+	if (!view)
+		return false;
+
+	pthread_mutex_lock(&view->channels_mutex);
+
+	long cur_serial = os_atomic_load_long(&view->channels_serial);
+	if (*serial != cur_serial) {
+		*serial = cur_serial;
+		changed = true;
+	}
+
+	for (size_t i = 0; !changed && i < MAX_CHANNELS; i++) {
+		struct obs_source *source = view->channels[i];
+		if (source && (source->removed || obs_source_video_changed(source)))
+			changed = true;
+	}
+
+	pthread_mutex_unlock(&view->channels_mutex);
+	return changed;
+}
+
 void obs_view_render(obs_view_t *view)
 {
 	if (!view)
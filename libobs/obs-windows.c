@@ -366,6 +366,13 @@ void log_system_info(void)
 
 struct obs_hotkeys_platform {
 	int vk_codes[OBS_KEY_LAST_VALUE];
+
+	/* raw input thread that wakes the hotkey thread on input */
+	pthread_t input_thread;
+	DWORD input_thread_id;
+	os_event_t *input_ready;
+	bool input_thread_created;
+	bool input_active;
 };
 
 static int get_virtual_key(obs_key_t key)
@@ -967,6 +974,116 @@ static int get_virtual_key(obs_key_t key)
 	return 0;
 }
 
+#define INPUT_WINDOW_CLASS L"OBSHotkeyRawInput"
+
+static bool is_hotkey_input(const RAWINPUT *input)
+{
+	const USHORT wheel = RI_MOUSE_WHEEL | RI_MOUSE_HWHEEL;
+
+	if (input->header.dwType == RIM_TYPEKEYBOARD)
+		return true;
+
+	/* mouse movement and scrolling can't change the hotkey state */
+	return input->header.dwType == RIM_TYPEMOUSE && (input->data.mouse.usButtonFlags & ~wheel) != 0;
+}
+
+static LRESULT CALLBACK input_window_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+	if (msg == WM_INPUT) {
+		RAWINPUT input;
+		UINT size = sizeof(input);
+		UINT ret = GetRawInputData((HRAWINPUT)lparam, RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER));
+
+		if (ret != (UINT)-1 && is_hotkey_input(&input))
+			obs_hotkeys_input_event();
+	}
+
+	return DefWindowProcW(hwnd, msg, wparam, lparam);
+}
+
+static void *raw_input_thread(void *param)
+{
+	obs_hotkeys_platform_t *context = param;
+	HINSTANCE instance = GetModuleHandleW(NULL);
+	RAWINPUTDEVICE devices[2] = {0};
+	WNDCLASSW wc = {0};
+	HWND hwnd = NULL;
+	MSG msg;
+
+	os_set_thread_name("libobs: raw input thread");
+
+	wc.lpfnWndProc = input_window_proc;
+	wc.hInstance = instance;
+	wc.lpszClassName = INPUT_WINDOW_CLASS;
+
+	if (RegisterClassW(&wc))
+		hwnd = CreateWindowExW(0, INPUT_WINDOW_CLASS, NULL, 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, instance, NULL);
+
+	/* generic desktop keyboard and mouse, delivered even when OBS isn't
+	 * focused.  raw input has one target window per device class per
+	 * process, so this only works as long as nothing else in the process
+	 * registers them too */
+	for (size_t i = 0; i < 2; i++) {
+		devices[i].usUsagePage = 0x01;
+		devices[i].usUsage = i == 0 ? 0x06 : 0x02;
+		devices[i].dwFlags = RIDEV_INPUTSINK;
+		devices[i].hwndTarget = hwnd;
+	}
+
+	context->input_active = hwnd && RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE));
+
+	/* makes sure the message queue exists before anything is posted */
+	PeekMessageW(&msg, NULL, 0, 0, PM_NOREMOVE);
+	context->input_thread_id = GetCurrentThreadId();
+	os_event_signal(context->input_ready);
+
+	if (context->input_active) {
+		while (GetMessageW(&msg, NULL, 0, 0) > 0)
+			DispatchMessageW(&msg);
+
+		for (size_t i = 0; i < 2; i++) {
+			devices[i].dwFlags = RIDEV_REMOVE;
+			devices[i].hwndTarget = NULL;
+		}
+		RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE));
+	}
+
+	if (hwnd)
+		DestroyWindow(hwnd);
+	UnregisterClassW(INPUT_WINDOW_CLASS, instance);
+	return NULL;
+}
+
+static void start_raw_input(struct obs_core_hotkeys *hotkeys)
+{
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+
+	if (os_event_init(&context->input_ready, OS_EVENT_TYPE_MANUAL) != 0)
+		return;
+
+	context->input_thread_created = pthread_create(&context->input_thread, NULL, raw_input_thread, context) == 0;
+	if (!context->input_thread_created)
+		return;
+
+	os_event_wait(context->input_ready);
+
+	if (context->input_active)
+		os_atomic_set_bool(&hotkeys->input_events, true);
+	else
+		blog(LOG_INFO, "hotkeys: Raw input unavailable, polling key state");
+}
+
+static void stop_raw_input(obs_hotkeys_platform_t *context)
+{
+	if (context->input_thread_created) {
+		if (context->input_active)
+			PostThreadMessageW(context->input_thread_id, WM_QUIT, 0, 0);
+		pthread_join(context->input_thread, NULL);
+	}
+
+	os_event_destroy(context->input_ready);
+}
+
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 {
 	hotkeys->platform_context = bzalloc(sizeof(obs_hotkeys_platform_t));
@@ -974,11 +1091,15 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		hotkeys->platform_context->vk_codes[i] = get_virtual_key(i);
 
+	start_raw_input(hotkeys);
 	return true;
 }
 
 void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 {
+	if (hotkeys->platform_context)
+		stop_raw_input(hotkeys->platform_context);
+
 	bfree(hotkeys->platform_context);
 	hotkeys->platform_context = NULL;
 }
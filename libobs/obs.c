@@ -370,7 +370,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->readback_depth; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] = gs_stagesurface_create_nv12(info->width, info->height);
@@ -434,7 +434,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	if (success) {
 		video->render_space = space;
 	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -474,6 +474,41 @@ gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
 	return *effect;
 }
 
+static const char *const preparsed_effects[] = {
+	"default.effect",
+	"opaque.effect",
+	"solid.effect",
+	"repeat.effect",
+	"format_conversion.effect",
+	"bicubic_scale.effect",
+	"lanczos_scale.effect",
+	"lanczos_separable_scale.effect",
+	"area.effect",
+	"bilinear_lowres_scale.effect",
+	"premultiplied_alpha.effect",
+	"default_rect.effect",
+};
+
+#define PREPARSED_EFFECT_COUNT (sizeof(preparsed_effects) / sizeof(preparsed_effects[0]))
+
+static void preparse_effects(void)
+{
+	char *files[PREPARSED_EFFECT_COUNT];
+	size_t count = PREPARSED_EFFECT_COUNT;
+
+	/* default_rect.effect is last and only used by OpenGL */
+	if (gs_get_device_type() != GS_DEVICE_OPENGL)
+		count--;
+
+	for (size_t i = 0; i < count; i++)
+		files[i] = obs_find_data_file(preparsed_effects[i]);
+
+	gs_effect_preparse_files((const char *const *)files, count);
+
+	for (size_t i = 0; i < count; i++)
+		bfree(files[i]);
+}
+
 static const char *shader_comp_name = "shader compilation";
 static const char *obs_init_graphics_name = "obs_init_graphics";
 static int obs_init_graphics(struct obs_video_info *ovi)
@@ -504,6 +539,8 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	profile_start(shader_comp_name);
 	gs_enter_context(video->graphics);
 
+	preparse_effects();
+
 	char *filename = obs_find_data_file("default.effect");
 	video->default_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
@@ -538,6 +575,10 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	video->lanczos_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
 
+	filename = obs_find_data_file("lanczos_separable_scale.effect");
+	video->lanczos_separable_effect = gs_effect_create_from_file(filename, NULL);
+	bfree(filename);
+
 	filename = obs_find_data_file("area.effect");
 	video->area_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
@@ -607,6 +648,7 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 	struct video_output_info vi;
 
 	pthread_mutex_init_value(&video->gpu_encoder_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
 
 	make_video_info(&vi, ovi);
 	video->ovi = *ovi;
@@ -623,6 +665,8 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
 	video->gpu_conversion = ovi->gpu_conversion;
+	video->readback_depth = (int)obs->video.readback_depth;
+	video->readback_zero_copy = obs->video.readback_zero_copy;
 	video->gpu_was_active = false;
 	video->raw_was_active = false;
 	video->was_active = false;
@@ -652,6 +696,9 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 
 	gs_leave_context();
 
+	if (!init_readback(video))
+		return OBS_VIDEO_FAIL;
+
 	return OBS_VIDEO_SUCCESS;
 }
 
@@ -681,6 +728,11 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (!obs_view_add2(&obs->data.main_view, ovi))
 		return OBS_VIDEO_FAIL;
 
+	if (!init_tick_threads())
+		return OBS_VIDEO_FAIL;
+	if (!init_upload_threads())
+		return OBS_VIDEO_FAIL;
+
 	int errorcode;
 #ifdef __APPLE__
 	pthread_attr_t attr;
@@ -712,6 +764,9 @@ static void stop_video(void)
 		pthread_join(video->video_thread, &thread_retval);
 		video->thread_initialized = false;
 	}
+
+	free_tick_threads();
+	free_upload_threads();
 }
 
 static void obs_free_render_textures(struct obs_core_video_mix *video)
@@ -721,14 +776,16 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 	gs_enter_context(obs->video.graphics);
 
-	for (size_t c = 0; c < NUM_CHANNELS; c++) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->mapped_surfaces[i][c]) {
+				gs_stagesurface_unmap(video->mapped_surfaces[i][c]);
+				video->mapped_surfaces[i][c] = NULL;
+			}
 		}
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
 				gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -762,15 +819,28 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 	video->render_texture = NULL;
 	video->output_texture = NULL;
 
+	gs_texture_destroy(video->scale_texture);
+	gs_texture_destroy(video->scale_weights_x);
+	gs_texture_destroy(video->scale_weights_y);
+	video->scale_texture = NULL;
+	video->scale_weights_x = NULL;
+	video->scale_weights_y = NULL;
+	video->separable_scale_failed = false;
+
 	gs_leave_context();
 }
 
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		stop_readback_thread(video);
+
+		/* releases any zero-copy frames still held by the output */
 		video_output_close(video->video);
 		video->video = NULL;
 
+		free_readback(video);
+
 		obs_free_render_textures(video);
 
 		deque_free(&video->vframe_info_buffer);
@@ -829,6 +899,8 @@ static void obs_free_graphics(void)
 	if (video->graphics) {
 		gs_enter_context(video->graphics);
 
+		obs_free_shared_texrenders();
+
 		gs_texture_destroy(video->transparent_texture);
 
 		gs_samplerstate_destroy(video->point_sampler);
@@ -841,6 +913,7 @@ static void obs_free_graphics(void)
 		gs_effect_destroy(video->bicubic_effect);
 		gs_effect_destroy(video->repeat_effect);
 		gs_effect_destroy(video->lanczos_effect);
+		gs_effect_destroy(video->lanczos_separable_effect);
 		gs_effect_destroy(video->area_effect);
 		gs_effect_destroy(video->bilinear_lowres_effect);
 		video->default_effect = NULL;
@@ -899,6 +972,8 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	free_audio_render_threads();
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -921,6 +996,7 @@ static bool obs_init_data(void)
 
 	pthread_mutex_init_value(&obs->data.displays_mutex);
 	pthread_mutex_init_value(&obs->data.draw_callbacks_mutex);
+	pthread_mutex_init_value(&obs->data.output_buffers_mutex);
 
 	if (pthread_mutex_init_recursive(&data->sources_mutex) != 0)
 		goto fail;
@@ -936,6 +1012,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&obs->data.draw_callbacks_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&obs->data.output_buffers_mutex, NULL) != 0)
+		goto fail;
 
 	if (!obs_view_init(&data->main_view))
 		goto fail;
@@ -1012,6 +1090,7 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	pthread_mutex_destroy(&data->output_buffers_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->rendered_callbacks);
 	da_free(data->tick_callbacks);
@@ -1021,6 +1100,7 @@ static void obs_free_data(void)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
 	da_free(data->sources_to_tick);
+	da_free(data->tick_jobs);
 }
 
 static const char *obs_signals[] = {
@@ -1048,6 +1128,10 @@ static const char *obs_signals[] = {
 
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 
+	"void audio_buffering_changed(int ms, int delta_ms, string source)",
+
+	"void render_degradation(int level)",
+
 	"void hotkey_layout_change()",
 	"void hotkey_register(ptr hotkey)",
 	"void hotkey_unregister(ptr hotkey)",
@@ -1088,6 +1172,10 @@ static inline bool obs_init_hotkeys(void)
 	hotkeys->sceneitem_show = bstrdup("Show '%1'");
 	hotkeys->sceneitem_hide = bstrdup("Hide '%1'");
 
+	/* platforms may start delivering input events during init */
+	if (os_event_init(&hotkeys->input_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
 	if (!obs_hotkeys_platform_init(hotkeys))
 		return false;
 
@@ -1115,6 +1203,7 @@ static inline void stop_hotkeys(void)
 
 	if (hotkeys->hotkey_thread_initialized) {
 		os_event_signal(hotkeys->stop_event);
+		os_event_signal(hotkeys->input_event);
 		pthread_join(hotkeys->hotkey_thread, &thread_ret);
 		hotkeys->hotkey_thread_initialized = false;
 	}
@@ -1137,6 +1226,8 @@ static inline void obs_free_hotkeys(void)
 	obs_hotkey_name_map_free();
 
 	obs_hotkeys_platform_free(hotkeys);
+	os_event_destroy(hotkeys->input_event);
+	hotkeys->input_event = NULL;
 	pthread_mutex_destroy(&hotkeys->mutex);
 }
 
@@ -1168,6 +1259,13 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
 
+	obs->video.readback_depth = NUM_TEXTURES;
+
+	obs->alloc_counters[OBS_ALLOC_VIDEO].name = "video";
+	obs->alloc_counters[OBS_ALLOC_AUDIO].name = "audio";
+	obs->alloc_counters[OBS_ALLOC_ENCODERS].name = "encoders";
+	obs->alloc_counters[OBS_ALLOC_OUTPUTS].name = "outputs";
+
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
 	if (!obs->name_store) {
@@ -1184,7 +1282,9 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	if (!obs_init_hotkeys())
 		return false;
 
-	obs->destruction_task_thread = os_task_queue_create();
+	/* source and output destroy callbacks join threads and wait on other
+	 * queues, so they get a thread of their own */
+	obs->destruction_task_thread = os_task_queue_create_dedicated("libobs: destroy", OS_TASK_PRIORITY_NORMAL);
 	if (!obs->destruction_task_thread)
 		return false;
 
@@ -1309,6 +1409,15 @@ struct obs_cmdline_args obs_get_cmdline_args(void)
 	return cmdline_args;
 }
 
+static void log_alloc_counters(void)
+{
+	for (size_t i = 0; i < OBS_ALLOC_COUNTER_COUNT; i++) {
+		struct bmem_counter *counter = &obs->alloc_counters[i];
+		blog(LOG_INFO, "Allocations on %s threads: %ld (%ld reallocs)", counter->name, counter->allocs,
+		     counter->reallocs);
+	}
+}
+
 void obs_shutdown(void)
 {
 	struct obs_module *module;
@@ -1360,6 +1469,13 @@ void obs_shutdown(void)
 	obs_free_audio();
 	obs_free_video();
 	os_task_queue_destroy(obs->destruction_task_thread);
+	os_task_pool_free();
+
+	/* deferred destroys give frames and packets back to the pools, so they
+	 * go once nothing is left to run */
+	obs_source_frame_pool_free();
+	obs_encoder_packet_pool_free();
+	log_alloc_counters();
 	obs_free_hotkeys();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
@@ -1523,35 +1639,78 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	if (!oai)
 		return true;
 
-	if (oai->max_buffering_ms) {
-		uint32_t max_frames = oai->max_buffering_ms * oai->samples_per_sec / SEC_TO_MSEC;
-		max_frames += (AUDIO_OUTPUT_FRAMES - 1);
-		audio->max_buffering_ticks = max_frames / AUDIO_OUTPUT_FRAMES;
-	} else {
-		audio->max_buffering_ticks = 45;
-	}
+	uint32_t frames_per_tick = oai->frames_per_tick;
+	if (!frames_per_tick || frames_per_tick > AUDIO_OUTPUT_FRAMES)
+		frames_per_tick = AUDIO_OUTPUT_FRAMES;
+	else if (frames_per_tick < AUDIO_OUTPUT_MIN_FRAMES)
+		frames_per_tick = AUDIO_OUTPUT_MIN_FRAMES;
+	audio->frames_per_tick = frames_per_tick;
+
+	/* the default budget is 45 full size ticks regardless of tick size */
+	uint32_t max_frames = oai->max_buffering_ms ? oai->max_buffering_ms * oai->samples_per_sec / SEC_TO_MSEC
+						    : 45 * AUDIO_OUTPUT_FRAMES;
+	max_frames += (frames_per_tick - 1);
+	audio->max_buffering_ticks = max_frames / frames_per_tick;
 	audio->fixed_buffer = oai->fixed_buffering;
+	audio->adaptive_buffer = oai->adaptive_buffering && !oai->fixed_buffering;
+	audio->min_slack = UINT64_MAX;
+
+	audio->resampler_engine = oai->resampler_engine;
+	audio->resampler_quality = oai->resampler_quality;
+	audio_resampler_set_engine(oai->resampler_engine, oai->resampler_quality);
 
 	int max_buffering_ms =
-		audio->max_buffering_ticks * AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC / (int)oai->samples_per_sec;
+		audio->max_buffering_ticks * (int)frames_per_tick * SEC_TO_MSEC / (int)oai->samples_per_sec;
 
 	ai.name = "Audio";
 	ai.samples_per_sec = oai->samples_per_sec;
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	ai.speakers = oai->speakers;
+	ai.frames_per_tick = frames_per_tick;
 	ai.input_callback = audio_callback;
 
+	/* the audio thread starts rendering as soon as the output opens */
+	if (!init_audio_render_threads(oai->render_threads)) {
+		blog(LOG_ERROR, "Could not create audio render threads");
+		return false;
+	}
+
+	static const char *engine_names[] = {"swresample", "soxr", "polyphase"};
+	static const char *quality_names[] = {"default", "low", "medium", "high"};
+	const char *engine_name = (size_t)audio->resampler_engine < 3 ? engine_names[audio->resampler_engine]
+								      : "unknown";
+	const char *quality_name = (size_t)audio->resampler_quality < 4 ? quality_names[audio->resampler_quality]
+									 : "unknown";
+
+	const char *buffering_type = "dynamically increasing";
+	if (audio->fixed_buffer)
+		buffering_type = "fixed";
+	else if (audio->adaptive_buffer)
+		buffering_type = "adaptive";
+
 	blog(LOG_INFO, "---------------------------------");
 	blog(LOG_INFO,
 	     "audio settings reset:\n"
 	     "\tsamples per sec: %d\n"
 	     "\tspeakers:        %d\n"
+	     "\tframes per tick: %d\n"
 	     "\tmax buffering:   %d milliseconds\n"
-	     "\tbuffering type:  %s",
-	     (int)ai.samples_per_sec, (int)ai.speakers, max_buffering_ms,
-	     oai->fixed_buffering ? "fixed" : "dynamically increasing");
+	     "\tbuffering type:  %s\n"
+	     "\trender threads:  %d\n"
+	     "\tresampler:       %s (%s quality)",
+	     (int)ai.samples_per_sec, (int)ai.speakers, (int)frames_per_tick, max_buffering_ms,
+	     buffering_type, (int)audio->render_threads.num, engine_name, quality_name);
+
+	if (!obs_init_audio(&ai))
+		return false;
 
-	return obs_init_audio(&ai);
+	/* audio queued by sources is in the old format */
+	pthread_mutex_lock(&obs->data.audio_sources_mutex);
+	for (obs_source_t *source = obs->data.first_audio_source; source; source = source->next_audio_source)
+		obs_source_reset_audio_queue(source);
+	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+
+	return true;
 }
 
 bool obs_reset_audio(const struct obs_audio_info *oai)
@@ -1594,6 +1753,41 @@ void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 	video->hdr_nominal_peak_level = hdr_nominal_peak_level;
 }
 
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (depth < NUM_TEXTURES)
+		depth = NUM_TEXTURES;
+	else if (depth > MAX_READBACK_DEPTH)
+		depth = MAX_READBACK_DEPTH;
+
+	obs->video.readback_depth = depth;
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	return obs->video.readback_depth;
+}
+
+void obs_set_video_zero_copy_readback(bool enable)
+{
+	obs->video.readback_zero_copy = enable;
+}
+
+bool obs_get_video_zero_copy_readback(void)
+{
+	return obs->video.readback_zero_copy;
+}
+
+void obs_set_video_precise_pacing(bool enable)
+{
+	os_atomic_set_bool(&obs->video.precise_pacing, enable);
+}
+
+bool obs_get_video_precise_pacing(void)
+{
+	return os_atomic_load_bool(&obs->video.precise_pacing);
+}
+
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -1620,12 +1814,33 @@ bool obs_get_audio_info2(struct obs_audio_info2 *oai2)
 		oai2->samples_per_sec = oai.samples_per_sec;
 		oai2->speakers = oai.speakers;
 		oai2->fixed_buffering = audio->fixed_buffer;
-		oai2->max_buffering_ms =
-			audio->max_buffering_ticks * AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC / (int)oai2->samples_per_sec;
+		oai2->max_buffering_ms = audio->max_buffering_ticks * (int)audio->frames_per_tick * SEC_TO_MSEC /
+					 (int)oai2->samples_per_sec;
+		oai2->frames_per_tick = audio->frames_per_tick;
+		oai2->render_threads = (uint32_t)audio->render_threads.num;
+		oai2->adaptive_buffering = audio->adaptive_buffer;
+		oai2->resampler_engine = audio->resampler_engine;
+		oai2->resampler_quality = audio->resampler_quality;
 		return true;
 	}
 }
 
+uint32_t obs_get_audio_frames_per_tick(void)
+{
+	return obs->audio.frames_per_tick ? obs->audio.frames_per_tick : AUDIO_OUTPUT_FRAMES;
+}
+
+uint32_t obs_get_audio_buffering_ms(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (!audio->audio)
+		return 0;
+
+	return (uint32_t)audio->total_buffering_ticks * audio->frames_per_tick * SEC_TO_MSEC /
+	       audio_output_get_sample_rate(audio->audio);
+}
+
 bool obs_enum_source_types(size_t idx, const char **id)
 {
 	if (idx >= obs->source_types.num)
@@ -2252,6 +2467,76 @@ obs_source_t *obs_load_private_source(obs_data_t *source_data)
 	return obs_load_source_type(source_data, true);
 }
 
+#define MAX_CREATE_THREADS 8
+
+struct create_jobs {
+	obs_source_t **sources;
+	long num;
+	volatile long next;
+};
+
+static void run_create_jobs(struct create_jobs *jobs)
+{
+	for (;;) {
+		const long idx = os_atomic_inc_long(&jobs->next) - 1;
+		if (idx >= jobs->num)
+			break;
+
+		obs_source_create_deferred(jobs->sources[idx]);
+	}
+}
+
+static void *create_thread(void *param)
+{
+	os_set_thread_name("libobs: source creation");
+	run_create_jobs(param);
+	return NULL;
+}
+
+/* creates the inputs that were deferred for having thread safe create
+ * callbacks, on as many threads as is worth it */
+static void create_deferred_sources(obs_source_t **sources, size_t count)
+{
+	DARRAY(obs_source_t *) deferred;
+	pthread_t threads[MAX_CREATE_THREADS];
+	struct create_jobs jobs = {0};
+	long num_threads = 0;
+
+	da_init(deferred);
+
+	for (size_t i = 0; i < count; i++) {
+		if (sources[i] && os_atomic_load_bool(&sources[i]->deferred))
+			da_push_back(deferred, &sources[i]);
+	}
+
+	if (!deferred.num) {
+		da_free(deferred);
+		return;
+	}
+
+	jobs.sources = deferred.array;
+	jobs.num = (long)deferred.num;
+
+	long workers = (long)os_get_logical_cores() - 1;
+	if (workers > MAX_CREATE_THREADS)
+		workers = MAX_CREATE_THREADS;
+	if (workers > jobs.num - 1)
+		workers = jobs.num - 1;
+
+	for (long i = 0; i < workers; i++) {
+		if (pthread_create(&threads[num_threads], NULL, create_thread, &jobs) == 0)
+			num_threads++;
+	}
+
+	run_create_jobs(&jobs);
+
+	for (long i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	blog(LOG_DEBUG, "Created %zu sources on %ld threads", deferred.num, num_threads + 1);
+	da_free(deferred);
+}
+
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *private_data)
 {
 	DARRAY(obs_source_t *) sources;
@@ -2263,6 +2548,13 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *priv
 	count = obs_data_array_count(array);
 	da_reserve(sources, count);
 
+	/* scenes reference their items by name, so everything has to exist
+	 * before anything loads, but creating the inputs doesn't have to
+	 * happen in order */
+	const bool lazy = obs_get_lazy_source_creation();
+	if (!lazy)
+		os_atomic_set_bool(&obs->data.parallel_source_creation, true);
+
 	for (i = 0; i < count; i++) {
 		obs_data_t *source_data = obs_data_array_item(array, i);
 		obs_source_t *source = obs_load_source(source_data);
@@ -2272,6 +2564,11 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *priv
 		obs_data_release(source_data);
 	}
 
+	if (!lazy) {
+		os_atomic_set_bool(&obs->data.parallel_source_creation, false);
+		create_deferred_sources(sources.array, sources.num);
+	}
+
 	/* tell sources that we want to load */
 	for (i = 0; i < sources.num; i++) {
 		obs_source_t *source = sources.array[i];
@@ -2292,6 +2589,16 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *priv
 	da_free(sources);
 }
 
+void obs_set_lazy_source_creation(bool lazy)
+{
+	os_atomic_set_bool(&obs->data.lazy_source_creation, lazy);
+}
+
+bool obs_get_lazy_source_creation(void)
+{
+	return os_atomic_load_bool(&obs->data.lazy_source_creation);
+}
+
 obs_data_t *obs_save_source(obs_source_t *source)
 {
 	obs_data_array_t *filters = obs_data_array_create();
@@ -2731,6 +3038,49 @@ profiler_name_store_t *obs_get_profiler_name_store(void)
 	return obs->name_store;
 }
 
+/* core threads compare the generation they applied to the current one each
+ * frame and only take the lock when it changed */
+static pthread_mutex_t core_affinity_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct os_cpu_set core_affinity;
+static volatile long core_affinity_gen = 0;
+static THREAD_LOCAL long core_affinity_applied = 0;
+
+bool obs_set_core_thread_affinity(const char *cpu_list)
+{
+	struct os_cpu_set set;
+
+	if (!os_cpu_set_parse(&set, cpu_list)) {
+		blog(LOG_WARNING, "obs_set_core_thread_affinity: invalid CPU list '%s'", cpu_list);
+		return false;
+	}
+
+	pthread_mutex_lock(&core_affinity_mutex);
+	core_affinity = set;
+	os_atomic_inc_long(&core_affinity_gen);
+	pthread_mutex_unlock(&core_affinity_mutex);
+
+	blog(LOG_INFO, "Core thread affinity: %s", cpu_list && *cpu_list ? cpu_list : "any CPU");
+	return true;
+}
+
+void obs_apply_core_thread_affinity(void)
+{
+	struct os_cpu_set set;
+	long gen = os_atomic_load_long(&core_affinity_gen);
+
+	if (gen == core_affinity_applied)
+		return;
+
+	pthread_mutex_lock(&core_affinity_mutex);
+	set = core_affinity;
+	gen = core_affinity_gen;
+	pthread_mutex_unlock(&core_affinity_mutex);
+
+	core_affinity_applied = gen;
+	if (!os_set_thread_affinity(&set))
+		blog(LOG_WARNING, "Failed to set the CPU affinity of a core thread");
+}
+
 uint64_t obs_get_video_frame_time(void)
 {
 	return obs->video.video_time;
@@ -2751,6 +3101,41 @@ uint64_t obs_get_frame_interval_ns(void)
 	return obs->video.video_frame_interval_ns;
 }
 
+void obs_set_render_budget(bool enable)
+{
+	os_atomic_set_bool(&obs->video.render_budget, enable);
+}
+
+bool obs_get_render_budget(void)
+{
+	return os_atomic_load_bool(&obs->video.render_budget);
+}
+
+enum obs_render_degradation obs_get_render_degradation(void)
+{
+	return (enum obs_render_degradation)os_atomic_load_long(&obs->video.render_degradation);
+}
+
+void obs_get_gpu_memory_usage(struct gs_memory_usage *usage)
+{
+	if (!obs_ptr_valid(usage, "obs_get_gpu_memory_usage"))
+		return;
+
+	gs_get_memory_usage(obs->video.graphics, usage);
+}
+
+void obs_set_gpu_memory_budget(uint64_t max_bytes)
+{
+	gs_set_memory_budget(obs->video.graphics, max_bytes);
+}
+
+uint64_t obs_get_gpu_memory_budget(void)
+{
+	struct gs_memory_usage usage;
+	gs_get_memory_usage(obs->video.graphics, &usage);
+	return usage.budget;
+}
+
 enum obs_obj_type obs_obj_get_type(void *obj)
 {
 	struct obs_context_data *context = obj;
@@ -2855,6 +3240,21 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+uint64_t obs_get_audio_monitoring_latency(void)
+{
+	uint64_t latency = 0;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	for (size_t i = 0; i < obs->audio.monitors.num; i++) {
+		uint64_t cur = audio_monitor_get_latency(obs->audio.monitors.array[i]);
+		if (cur > latency)
+			latency = cur;
+	}
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	return latency;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param)
 {
 	struct tick_callback data = {tick, param};
@@ -2947,6 +3347,16 @@ void start_raw_video(video_t *v, const struct video_scale_info *conversion, uint
 		os_atomic_inc_long(&video->raw_active);
 }
 
+void start_raw_video_parallel(video_t *v, const struct video_scale_info *conversion, uint32_t frame_rate_divisor,
+			      void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	struct obs_core_video_mix *video = get_mix_for_video(v);
+	if (!video)
+		return;
+	if (video_output_connect_parallel(v, conversion, frame_rate_divisor, callback, param))
+		os_atomic_inc_long(&video->raw_active);
+}
+
 void stop_raw_video(video_t *v, void (*callback)(void *param, struct video_data *frame), void *param)
 {
 	struct obs_core_video_mix *video = get_mix_for_video(v);
@@ -3067,6 +3477,35 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 	}
 }
 
+bool obs_get_gpu_encode_stats(video_t *v, struct obs_gpu_encode_stats *stats)
+{
+	struct obs_core_video_mix *video;
+	bool active;
+
+	if (!obs_ptr_valid(stats, "obs_get_gpu_encode_stats"))
+		return false;
+
+	video = v ? get_mix_for_video(v) : obs->video.main_mix;
+	if (!video)
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	active = video->gpu_encoders.num > 0;
+	if (active) {
+		size_t available = video->gpu_encoder_avail_queue.size / sizeof(struct obs_tex_frame);
+
+		stats->ring_depth = NUM_ENCODE_TEXTURES;
+		stats->ring_in_use = NUM_ENCODE_TEXTURES - (uint32_t)available;
+		stats->stalls = video->gpu_encode_stalls;
+		stats->copies = video->gpu_encode_copies;
+	}
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+	return active;
+}
+
 bool obs_video_active(void)
 {
 	bool result = false;
@@ -3205,6 +3644,17 @@ bool obs_wait_for_destroy_queue(void)
 	return os_task_queue_wait(obs->destruction_task_thread);
 }
 
+bool obs_has_public_sources(void)
+{
+	bool has_sources;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+	has_sources = obs->data.public_sources != NULL;
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+
+	return has_sources;
+}
+
 static void set_ui_thread(void *unused)
 {
 	is_ui_thread = true;
@@ -25,6 +25,7 @@
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
@@ -125,6 +126,20 @@ enum obs_scale_type {
 	OBS_SCALE_AREA,
 };
 
+/**
+ * How much rendering is cut back while the graphics thread is over its frame
+ * budget, see obs_set_render_budget.  Each level includes the ones below it.
+ */
+enum obs_render_degradation {
+	OBS_RENDER_DEGRADATION_NONE,
+	/** scene items are scaled with bilinear filtering */
+	OBS_RENDER_DEGRADATION_SCALING,
+	/** sources that opt in should update at a reduced rate */
+	OBS_RENDER_DEGRADATION_RATE,
+	/** sources that opt in should skip any optional work */
+	OBS_RENDER_DEGRADATION_MINIMAL,
+};
+
 enum obs_blending_method {
 	OBS_BLEND_METHOD_DEFAULT,
 	OBS_BLEND_METHOD_SRGB_OFF,
@@ -214,6 +229,20 @@ struct obs_audio_info2 {
 
 	uint32_t max_buffering_ms;
 	bool fixed_buffering;
+
+	/** Frames mixed per audio tick, 0 for AUDIO_OUTPUT_FRAMES */
+	uint32_t frames_per_tick;
+
+	/** Threads rendering independent audio sources, 0 to render serially */
+	uint32_t render_threads;
+
+	/** Shrink buffering again once sources have been early for a while,
+	 * ignored with fixed_buffering */
+	bool adaptive_buffering;
+
+	/** Sample rate conversion used for sources created afterwards */
+	enum audio_resampler_engine resampler_engine;
+	enum audio_resampler_quality resampler_quality;
 };
 
 /**
@@ -399,6 +428,14 @@ EXPORT void obs_init_win32_crash_handler(void);
  */
 EXPORT profiler_name_store_t *obs_get_profiler_name_store(void);
 
+/**
+ * Pins the graphics, video, audio and other core threads of libobs to a set
+ * of CPUs, so that software encoders bound elsewhere cannot starve them.
+ * Takes a CPU list as parsed by os_cpu_set_parse, NULL or an empty list lets
+ * them run anywhere again.  Running threads pick it up on their next frame.
+ */
+EXPORT bool obs_set_core_thread_affinity(const char *cpu_list);
+
 /**
  * Sets base video output base resolution/fps/format.
  *
@@ -437,6 +474,38 @@ EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 /** Sets the video levels */
 EXPORT void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level);
 
+/**
+ * Sets how many frames raw video readback is pipelined over (2-4).  Values
+ * above 2 map staging surfaces later and copy them out on a separate thread.
+ * Takes effect on the next video reset.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+
+/** Gets the raw video readback depth */
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
+/**
+ * Enables passing mapped staging surfaces to raw video outputs directly
+ * instead of copying them into the video frame cache.  A surface stays
+ * mapped (and rendering into its slot waits) until every raw output has
+ * received the frame.  Takes effect on the next video reset.
+ */
+EXPORT void obs_set_video_zero_copy_readback(bool enable);
+
+/** Gets whether zero-copy raw video readback is enabled */
+EXPORT bool obs_get_video_zero_copy_readback(void);
+
+/**
+ * Enables precise frame pacing: the graphics thread wakes up slightly early
+ * and spins until the frame is due, instead of relying on the timer alone.
+ * Lowers frame time jitter at the cost of keeping a core busy for up to
+ * 2 milliseconds per frame.  Off by default, takes effect immediately.
+ */
+EXPORT void obs_set_video_precise_pacing(bool enable);
+
+/** Gets whether precise frame pacing is enabled */
+EXPORT bool obs_get_video_precise_pacing(void);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
@@ -446,6 +515,16 @@ EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
  */
 EXPORT bool obs_get_audio_info2(struct obs_audio_info2 *oai2);
 
+/**
+ * Gets the number of frames mixed per audio tick.  Sources rendering audio
+ * only need to produce this many frames per tick, although their buffers are
+ * always AUDIO_OUTPUT_FRAMES in size.
+ */
+EXPORT uint32_t obs_get_audio_frames_per_tick(void);
+
+/** Gets the current amount of audio buffering in milliseconds */
+EXPORT uint32_t obs_get_audio_buffering_ms(void);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -509,6 +588,9 @@ EXPORT const char *obs_get_module_binary_path(obs_module_t *module);
 /** Returns the module data path */
 EXPORT const char *obs_get_module_data_path(obs_module_t *module);
 
+/** Returns the time in nanoseconds it took to open, load and post-load the module */
+EXPORT uint64_t obs_get_module_load_time(obs_module_t *module);
+
 #ifndef SWIG
 /**
  * Adds a module search path to be used with obs_find_modules.  If the search
@@ -774,6 +856,15 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 /** Loads sources from a data array */
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb, void *private_data);
 
+/**
+ * Sets whether inputs loaded from saved data are created lazily.  Lazily
+ * loaded inputs keep their settings and filters, but their plugin isn't
+ * created until they're first shown or activated, or until
+ * obs_source_instantiate is called.
+ */
+EXPORT void obs_set_lazy_source_creation(bool lazy);
+EXPORT bool obs_get_lazy_source_creation(void);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -809,6 +900,9 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/** Gets the highest latency of all active audio monitors, in nanoseconds */
+EXPORT uint64_t obs_get_audio_monitoring_latency(void);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds), void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds), void *param);
 
@@ -832,11 +926,108 @@ EXPORT uint64_t obs_get_video_frame_time(void);
 
 EXPORT double obs_get_active_fps(void);
 EXPORT uint64_t obs_get_average_frame_time_ns(void);
+
+/**
+ * Enables or disables the render budget.  While enabled, rendering is
+ * progressively degraded when frames take longer than the frame interval,
+ * and restored once they are well within it again.  Changes are logged and
+ * signaled with render_degradation on the core signal handler.
+ */
+EXPORT void obs_set_render_budget(bool enable);
+EXPORT bool obs_get_render_budget(void);
+
+/** Returns the current render degradation level */
+EXPORT enum obs_render_degradation obs_get_render_degradation(void);
+
+/**
+ * Gets the graphics memory of the textures, stage surfaces and z-stencil
+ * buffers created through libobs, by category.  Sizes are estimated from
+ * the dimensions and format of each allocation.
+ */
+EXPORT void obs_get_gpu_memory_usage(struct gs_memory_usage *usage);
+
+/** Gets the graphics memory created while the source was rendering */
+EXPORT uint64_t obs_source_get_gpu_memory_usage(const obs_source_t *source);
+
+/**
+ * Sets a soft graphics memory budget in bytes, 0 (the default) is none.
+ * While over it, idle pooled render targets and render targets cached by
+ * sources that aren't showing are freed, about once a second.
+ */
+EXPORT void obs_set_gpu_memory_budget(uint64_t max_bytes);
+EXPORT uint64_t obs_get_gpu_memory_budget(void);
 EXPORT uint64_t obs_get_frame_interval_ns(void);
 
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+struct obs_gpu_encode_stats {
+	/** Number of textures in the GPU encoder texture ring */
+	uint32_t ring_depth;
+	/** Textures currently queued for or held by GPU encoders */
+	uint32_t ring_in_use;
+	/** Frames that had to reuse the last queued texture because none was free */
+	uint64_t stalls;
+	/** Frames copied into the ring instead of swapped in */
+	uint64_t copies;
+};
+
+/**
+ * Gets texture ring statistics for GPU encoding of a video output (NULL for
+ * the main output).  Returns false if no GPU encoder is active on it.
+ */
+EXPORT bool obs_get_gpu_encode_stats(video_t *video, struct obs_gpu_encode_stats *stats);
+
+enum obs_frame_timing_stage {
+	OBS_FRAME_TIMING_TICK,
+	OBS_FRAME_TIMING_OUTPUT,
+	OBS_FRAME_TIMING_DISPLAYS,
+	OBS_FRAME_TIMING_TOTAL,
+	OBS_FRAME_TIMING_STAGE_COUNT,
+};
+
+struct obs_frame_timing_percentiles {
+	uint64_t p50;
+	uint64_t p95;
+	uint64_t p99;
+};
+
+struct obs_video_frame_timing {
+	/** Number of frames the CPU percentiles are computed from */
+	uint32_t samples;
+	/** Number of frames the GPU percentiles are computed from */
+	uint32_t gpu_samples;
+	/** CPU time of each graphics thread stage, in nanoseconds */
+	struct obs_frame_timing_percentiles cpu[OBS_FRAME_TIMING_STAGE_COUNT];
+	/** GPU time of each graphics thread stage, in nanoseconds */
+	struct obs_frame_timing_percentiles gpu[OBS_FRAME_TIMING_STAGE_COUNT];
+};
+
+/**
+ * Gets percentiles of the recent per-stage frame times of the graphics
+ * thread.  Safe to call from any thread.  Returns false if no frames have
+ * been sampled yet.
+ */
+EXPORT bool obs_get_video_frame_timing(struct obs_video_frame_timing *timing);
+
+/** Enables or disables GPU timer queries for obs_get_video_frame_timing */
+EXPORT void obs_enable_video_frame_timing_gpu(bool enable);
+
+/**
+ * Enables or disables GPU timing of the scopes marked with
+ * obs_gpu_profile_start/end.  The GPU times are recorded in the profiler
+ * under a "gpu" entry of the graphics thread a few frames later.
+ */
+EXPORT void obs_enable_gpu_profiler(bool enable);
+
+/**
+ * Marks a scope of GPU work on the graphics thread, similar to
+ * profile_start/profile_end.  The name must stay valid for the lifetime of
+ * the profiler.  Does nothing unless obs_enable_gpu_profiler is enabled.
+ */
+EXPORT void obs_gpu_profile_start(const char *name);
+EXPORT void obs_gpu_profile_end(const char *name);
+
 OBS_DEPRECATED EXPORT bool obs_nv12_tex_active(void);
 OBS_DEPRECATED EXPORT bool obs_p010_tex_active(void);
 
@@ -858,6 +1049,10 @@ EXPORT bool obs_in_task_thread(enum obs_task_type type);
 
 EXPORT bool obs_wait_for_destroy_queue(void);
 
+/* Returns true while any named source still exists, including sources that
+ * were released but haven't been removed from the name table yet */
+EXPORT bool obs_has_public_sources(void);
+
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
@@ -948,6 +1143,14 @@ EXPORT void obs_display_remove_draw_callback(obs_display_t *display,
 EXPORT void obs_display_set_enabled(obs_display_t *display, bool enable);
 EXPORT bool obs_display_enabled(obs_display_t *display);
 
+/**
+ * Only renders this display every divisor-th frame of the main canvas, so
+ * that previews and projectors can run at a lower rate than the program
+ * output.  A divisor of 1 (the default) renders every frame.
+ */
+EXPORT void obs_display_set_frame_rate_divisor(obs_display_t *display, uint32_t divisor);
+EXPORT uint32_t obs_display_get_frame_rate_divisor(obs_display_t *display);
+
 EXPORT void obs_display_set_background_color(obs_display_t *display, uint32_t color);
 
 EXPORT void obs_display_size(obs_display_t *display, uint32_t *width, uint32_t *height);
@@ -1143,6 +1346,23 @@ EXPORT bool obs_source_active(const obs_source_t *source);
  */
 EXPORT bool obs_source_showing(const obs_source_t *source);
 
+/**
+ * Returns true if the source was actually drawn during the last few frames.
+ * Unlike showing, this is false for sources that are shown but not drawn,
+ * such as items outside of their scene or behind a skipped transition side.
+ */
+EXPORT bool obs_source_render_visible(const obs_source_t *source);
+
+/**
+ * Creates a lazily loaded source now rather than when it's first shown.
+ * Returns true if the source has been created, false if creation failed or
+ * the source's type is unavailable.
+ */
+EXPORT bool obs_source_instantiate(obs_source_t *source);
+
+/** Returns false if the source was loaded lazily and hasn't been created */
+EXPORT bool obs_source_instantiated(const obs_source_t *source);
+
 /** Unused flag */
 #define OBS_SOURCE_FLAG_UNUSED_1 (1 << 0)
 /** Specifies to force audio to mono */
@@ -1280,6 +1500,9 @@ enum obs_monitoring_type {
 EXPORT void obs_source_set_monitoring_type(obs_source_t *source, enum obs_monitoring_type type);
 EXPORT enum obs_monitoring_type obs_source_get_monitoring_type(const obs_source_t *source);
 
+/** Gets the measured latency of the source's audio monitor, in nanoseconds */
+EXPORT uint64_t obs_source_get_monitoring_latency(const obs_source_t *source);
+
 /** Gets private front-end settings data.  This data is saved/loaded
  * automatically.  Returns an incremented reference. */
 EXPORT obs_data_t *obs_source_get_private_settings(obs_source_t *item);
@@ -1330,6 +1553,36 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx, uint
 EXPORT void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame);
 EXPORT void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame);
 
+/** Called once libobs is done with a lent frame, from any thread */
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The frame data has to
+ * stay valid until release is called, which happens once the frame has been
+ * drawn or dropped.  release must not output video to the source.
+ *
+ * NOTE: Like obs_source_output_video, non-YUV formats are always treated as
+ * full range.
+ */
+EXPORT void obs_source_lend_video(obs_source_t *source, const struct obs_source_frame *frame,
+				  obs_source_frame_release_t release, void *param);
+
+/**
+ * Outputs asynchronous video that is already on the GPU, so it's neither
+ * copied nor uploaded.  The frame describes the video like it does for
+ * obs_source_lend_video but has no data, the planes are in textures
+ * created in the obs graphics context, GS_R8 and GS_R8G8 for NV12, GS_R16
+ * and GS_RG16 for P010.  The textures have to stay valid until release is
+ * called.  Texture frames skip async video filters.
+ *
+ * Returns false without calling release if the source can't take texture
+ * frames right now (async video filters or deinterlacing are in use, or the
+ * format isn't NV12 or P010), the frame data has to be output instead.
+ */
+EXPORT bool obs_source_lend_video_textures(obs_source_t *source, const struct obs_source_frame *frame,
+					   gs_texture_t *const textures[MAX_AV_PLANES],
+					   obs_source_frame_release_t release, void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source, const struct obs_source_cea_708 *captions);
@@ -1363,12 +1616,26 @@ EXPORT void obs_source_output_audio(obs_source_t *source, const struct obs_sourc
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
+/**
+ * Signals that the video of a source with OBS_SOURCE_STATIC_VIDEO changed for
+ * a reason other than a settings update
+ */
+EXPORT void obs_source_mark_video_changed(obs_source_t *source);
+
 /** Gets the current async video frame */
 EXPORT struct obs_source_frame *obs_source_get_frame(obs_source_t *source);
 
 /** Releases the current async video frame */
 EXPORT void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *frame);
 
+/**
+ * Prepares a frame given to filter_video to be held across ticks.  Frames
+ * lent by the source are copied so their buffer goes back to the source right
+ * away, other frames are returned as they are.  Release the returned frame
+ * with obs_source_release_frame if it isn't passed on.
+ */
+EXPORT struct obs_source_frame *obs_source_frame_hold(obs_source_t *source, struct obs_source_frame *frame);
+
 /**
  * Default RGB filter handler for generic effect filters.  Processes the
  * filter chain and renders them to texture if needed, then the filter is
@@ -1544,6 +1811,13 @@ EXPORT void obs_transition_video_render(obs_source_t *transition, obs_transition
 EXPORT void obs_transition_video_render2(obs_source_t *transition, obs_transition_video_render_callback_t callback,
 					 gs_texture_t *placeholder_texture);
 
+/**
+ * Tells the next obs_transition_video_render call that a source won't be
+ * visible in the frame, so it isn't rendered and the callback gets the
+ * placeholder texture for it instead.  Has to be called every frame.
+ */
+EXPORT void obs_transition_hide_source(obs_source_t *transition, enum obs_transition_target target);
+
 EXPORT enum gs_color_space obs_transition_video_get_color_space(obs_source_t *transition);
 
 /** Directly renders its sub-source instead of to texture.  Returns false if no
@@ -1618,6 +1892,21 @@ static inline obs_scene_t *obs_get_scene_by_name(const char *name)
 EXPORT void obs_scene_enum_items(obs_scene_t *scene, bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *),
 				 void *param);
 
+/**
+ * Enumerates the items whose bounding box contains a position in scene
+ * coordinates, from the bottom up.  Locked and hidden items are included.
+ */
+EXPORT void obs_scene_enum_items_at(obs_scene_t *scene, const struct vec2 *pos,
+				    bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param);
+
+/**
+ * Enumerates the items whose axis-aligned bounding box overlaps a rectangle in
+ * scene coordinates, from the bottom up.  Callers that need an exact test
+ * still have to check each item.
+ */
+EXPORT void obs_scene_enum_items_in_rect(obs_scene_t *scene, const struct vec2 *min, const struct vec2 *max,
+					 bool (*callback)(obs_scene_t *, obs_sceneitem_t *, void *), void *param);
+
 EXPORT bool obs_scene_reorder_items(obs_scene_t *scene, obs_sceneitem_t *const *item_order, size_t item_order_size);
 
 struct obs_sceneitem_order_info {
@@ -1705,6 +1994,15 @@ OBS_DEPRECATED EXPORT void obs_sceneitem_set_info(obs_sceneitem_t *item, const s
 EXPORT void obs_sceneitem_get_info2(const obs_sceneitem_t *item, struct obs_transform_info *info);
 EXPORT void obs_sceneitem_set_info2(obs_sceneitem_t *item, const struct obs_transform_info *info);
 
+/**
+ * Sets the transform info of many items of a scene at once.  The changes are
+ * applied under a single lock of the scene, so they show up in the same
+ * frame, and each item signals item_transform once after all of them have
+ * been applied.  Items may also be in groups of the scene.
+ */
+EXPORT void obs_scene_set_items_info2(obs_scene_t *scene, obs_sceneitem_t *const *items,
+				      const struct obs_transform_info *infos, size_t num);
+
 EXPORT void obs_sceneitem_get_draw_transform(const obs_sceneitem_t *item, struct matrix4 *transform);
 EXPORT void obs_sceneitem_get_box_transform(const obs_sceneitem_t *item, struct matrix4 *transform);
 EXPORT void obs_sceneitem_get_box_scale(const obs_sceneitem_t *item, struct vec2 *scale);
@@ -1847,6 +2145,13 @@ EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 /** If delay is active, gets the currently active delay value, in seconds. */
 EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 
+/**
+ * Limits how much packet data the delay keeps in memory.  Packets queued
+ * past max_bytes are written to temporary files in spill_dir and read back
+ * when they are due.  0 (the default) keeps everything in memory.
+ */
+EXPORT void obs_output_set_delay_memory_limit(obs_output_t *output, uint64_t max_bytes, const char *spill_dir);
+
 /** Forces the output to stop.  Usually only used with delay. */
 EXPORT void obs_output_force_stop(obs_output_t *output);
 
@@ -1974,6 +2279,14 @@ EXPORT obs_service_t *obs_output_get_service(const obs_output_t *output);
  */
 EXPORT void obs_output_set_reconnect_settings(obs_output_t *output, int retry_count, int retry_sec);
 
+/**
+ * Starts the output from the last keyframe its encoders kept with
+ * obs_encoder_set_gop_cache when they are already running for another
+ * output, rather than from the next keyframe.  Takes effect on start.
+ */
+EXPORT void obs_output_set_fast_start(obs_output_t *output, bool fast_start);
+EXPORT bool obs_output_get_fast_start(const obs_output_t *output);
+
 EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
@@ -2036,6 +2349,35 @@ EXPORT void obs_output_output_caption_text2(obs_output_t *output, const char *te
 EXPORT float obs_output_get_congestion(obs_output_t *output);
 EXPORT int obs_output_get_connect_time_ms(obs_output_t *output);
 
+/** What an output does while the buffers of all outputs are over the limit */
+enum obs_output_buffer_policy {
+	/** Drops video until a keyframe after the buffers are under again */
+	OBS_OUTPUT_BUFFER_DROP,
+	/** Spills the delay to disk if it can, otherwise drops */
+	OBS_OUTPUT_BUFFER_SPILL,
+	/** Stops the output, with the reason as its last error */
+	OBS_OUTPUT_BUFFER_STOP,
+};
+
+/**
+ * Gets the bytes of packets the output holds: the interleaver, the delay's
+ * packets in memory, and the output's own queue if it reports it.
+ */
+EXPORT uint64_t obs_output_get_buffered_bytes(obs_output_t *output);
+
+EXPORT void obs_output_set_buffer_policy(obs_output_t *output, enum obs_output_buffer_policy policy);
+EXPORT enum obs_output_buffer_policy obs_output_get_buffer_policy(const obs_output_t *output);
+
+/**
+ * Limits the bytes all active outputs buffer together.  Each output applies
+ * its buffer policy while the total is over.  0 (the default) is no limit.
+ */
+EXPORT void obs_set_output_buffer_limit(uint64_t max_bytes);
+EXPORT uint64_t obs_get_output_buffer_limit(void);
+
+/** Gets the bytes all active outputs buffered, as of their last check */
+EXPORT uint64_t obs_get_output_buffered_bytes(void);
+
 EXPORT bool obs_output_reconnecting(const obs_output_t *output);
 
 /** Pass a string of the last output error, for UI use */
@@ -2074,6 +2416,51 @@ EXPORT void obs_output_remove_packet_callback(obs_output_t *output,
 								struct encoder_packet_time *pkt_time, void *param),
 					      void *param);
 
+/** Stages of a video frame's trip through an output, each measured between
+ * two of the frame's encoder_packet_time events */
+enum obs_output_latency_stage {
+	/** Frame render start (CTS) to encode request (FER) */
+	OBS_OUTPUT_LATENCY_COMPOSITE,
+	/** Encode request (FER) to encode complete (FERC) */
+	OBS_OUTPUT_LATENCY_ENCODE,
+	/** Encode complete (FERC) to packet interleave (PIR), includes any
+	 * output delay */
+	OBS_OUTPUT_LATENCY_INTERLEAVE,
+	/** Packet interleave (PIR) to the output writing the packet */
+	OBS_OUTPUT_LATENCY_SEND,
+	/** Frame render start (CTS) to the output writing the packet */
+	OBS_OUTPUT_LATENCY_TOTAL,
+	OBS_OUTPUT_LATENCY_STAGE_COUNT,
+};
+
+#define OBS_OUTPUT_LATENCY_BUCKETS 12
+
+struct obs_output_latency_histogram {
+	/** Frames measured, and their latency in microseconds */
+	uint64_t samples;
+	uint64_t us_total;
+	uint32_t us_max;
+	/** Bucket i counts latencies under 2^i milliseconds that did not fit
+	 * in a lower bucket, the last one counts everything else */
+	uint64_t buckets[OBS_OUTPUT_LATENCY_BUCKETS];
+};
+
+struct obs_output_latency_stats {
+	struct obs_output_latency_histogram stages[OBS_OUTPUT_LATENCY_STAGE_COUNT];
+};
+
+/**
+ * Gets the per stage latency of the video frames of a video track of an
+ * output since it last started.  The send and total stages are only measured
+ * for outputs that report their writes with obs_output_packet_written().
+ * Does not lock, so it can be polled at any rate from any thread.
+ */
+EXPORT bool obs_output_get_latency_stats(const obs_output_t *output, size_t track,
+					 struct obs_output_latency_stats *stats);
+
+/** Returns a short name of a latency stage, for logs and exports */
+EXPORT const char *obs_output_latency_stage_name(enum obs_output_latency_stage stage);
+
 /* ------------------------------------------------------------------------- */
 /* Functions used by outputs */
 
@@ -2113,6 +2500,14 @@ EXPORT void obs_output_end_data_capture(obs_output_t *output);
  */
 EXPORT void obs_output_signal_stop(obs_output_t *output, int code);
 
+/**
+ * Reports that an output has written an encoded video packet, typically to a
+ * socket, to measure the send stage of its latency.  Only the type, track
+ * and timestamps of the packet are read, so a copy made before the packet
+ * was released will do.
+ */
+EXPORT void obs_output_packet_written(obs_output_t *output, const struct encoder_packet *packet);
+
 EXPORT uint64_t obs_output_get_pause_offset(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -2197,6 +2592,25 @@ EXPORT void obs_encoder_set_gpu_scale_type(obs_encoder_t *encoder, enum obs_scal
  */
 EXPORT bool obs_encoder_set_frame_rate_divisor(obs_encoder_t *encoder, uint32_t divisor);
 
+/**
+ * Allows a video encoder to hold back frames for up to latency_ms, e.g.
+ * for a deep lookahead when the output is a local recording.  Encoders
+ * that support it size their lookahead to fit, 0 (the default) keeps
+ * them real-time.  Outputs wait for the delayed packets when stopping.
+ *
+ * Can only be called on stopped encoders, changing this on the fly is not supported
+ */
+EXPORT bool obs_encoder_set_max_latency(obs_encoder_t *encoder, uint32_t latency_ms);
+
+/**
+ * Makes a running encoder keep its most recent packets, the ones since the
+ * last keyframe for video encoders and the last few seconds for audio
+ * encoders, so that outputs with fast start enabled can join it from the
+ * last keyframe instead of waiting for the next one.  Off by default.
+ */
+EXPORT void obs_encoder_set_gop_cache(obs_encoder_t *encoder, bool enable);
+EXPORT bool obs_encoder_gop_cache_enabled(const obs_encoder_t *encoder);
+
 /**
  * Adds region of interest (ROI) for an encoder. This allows prioritizing
  * quality of regions of the frame.
@@ -2236,6 +2650,54 @@ EXPORT uint32_t obs_encoder_get_frame_rate_divisor(const obs_encoder_t *encoder)
 /** For video encoders, returns the number of frames encoded */
 EXPORT uint32_t obs_encoder_get_encoded_frames(const obs_encoder_t *encoder);
 
+/** For video encoders, returns how long frames may be held back in milliseconds */
+EXPORT uint32_t obs_encoder_get_max_latency(const obs_encoder_t *encoder);
+
+/**
+ * For video encoders, returns how many frames at the encoder's frame rate
+ * fit in its maximum latency, 0 if it should stay real-time
+ */
+EXPORT uint32_t obs_encoder_get_max_latency_frames(const obs_encoder_t *encoder);
+
+#define OBS_ENCODER_LATENCY_BUCKETS 10
+
+struct obs_encoder_stats {
+	/** Encode calls, and frames handed to the encoder with them */
+	uint64_t encode_calls;
+	uint64_t frames_submitted;
+	/** Time spent in the encode callback, in microseconds */
+	uint64_t encode_us_total;
+	uint32_t encode_us_last;
+	uint32_t encode_us_max;
+
+	/** Packets produced, and their total size in bytes */
+	uint64_t packets;
+	uint64_t bytes;
+	/** Bitrate produced over the last full second, in kbps */
+	uint32_t bitrate_kbps;
+
+	/** For video encoders, frames submitted that have no packet yet */
+	uint32_t frames_in_flight;
+	/** For raw video encoders, frames skipped by their video output
+	 * because its consumers fell behind */
+	uint32_t lagged_frames;
+
+	/** Video frame submit to packet latency, in microseconds */
+	uint64_t latency_samples;
+	uint64_t latency_us_total;
+	uint32_t latency_us_last;
+	uint32_t latency_us_max;
+	/** Bucket i counts latencies under 2^i milliseconds that did not fit
+	 * in a lower bucket, the last one counts everything else */
+	uint64_t latency_histogram[OBS_ENCODER_LATENCY_BUCKETS];
+};
+
+/**
+ * Gets the statistics of an encoder since it last started.  Does not lock,
+ * so it can be polled at any rate from any thread.
+ */
+EXPORT bool obs_encoder_get_stats(const obs_encoder_t *encoder, struct obs_encoder_stats *stats);
+
 /** For audio encoders, returns the sample rate of the audio */
 EXPORT uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder);
 
@@ -2341,6 +2803,29 @@ EXPORT uint32_t obs_encoder_get_caps(const obs_encoder_t *encoder);
 EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst, struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/**
+ * Allocates packet data for an encoder to write its output into.  When the
+ * encoder returns it as the data of its packet, outputs take a reference to
+ * it instead of copying the packet.  The data belongs to libobs once the
+ * packet has been sent, so it must not be reused for another packet.
+ * Data that never gets sent is freed with the encoder.
+ */
+EXPORT uint8_t *obs_encoder_packet_alloc(obs_encoder_t *encoder, size_t size);
+
+struct obs_encoder_packet_pool_stats {
+	uint64_t hits;
+	uint64_t misses;
+	size_t blocks_in_use;
+	size_t idle_blocks;
+	size_t idle_bytes;
+};
+
+/**
+ * Gets statistics of the pool that packet data held by outputs is drawn
+ * from.  Blocks are pooled by power of two size across all encoders.
+ */
+EXPORT void obs_get_encoder_packet_pool_stats(struct obs_encoder_packet_pool_stats *stats);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder, const char *reroute_id);
 
 /** Returns whether encoder is paused */
@@ -2358,6 +2843,8 @@ EXPORT uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder);
  * destroy the group until it becomes completely inactive.
  */
 EXPORT bool obs_encoder_set_group(obs_encoder_t *encoder, obs_encoder_group_t *group);
+/** Returns the group the encoder was added to, or NULL */
+EXPORT obs_encoder_group_t *obs_encoder_get_group(const obs_encoder_t *encoder);
 EXPORT obs_encoder_group_t *obs_encoder_group_create();
 EXPORT void obs_encoder_group_destroy(obs_encoder_group_t *group);
 
@@ -2474,6 +2961,19 @@ static inline void obs_source_frame_destroy(struct obs_source_frame *frame)
 
 EXPORT void obs_source_frame_copy(struct obs_source_frame *dst, const struct obs_source_frame *src);
 
+struct obs_source_frame_pool_stats {
+	uint64_t hits;
+	uint64_t misses;
+	size_t idle_frames;
+	size_t idle_bytes;
+};
+
+/**
+ * Gets statistics of the pool that async source frame buffers are drawn
+ * from.  Frames are pooled by format and size across all sources.
+ */
+EXPORT void obs_get_source_frame_pool_stats(struct obs_source_frame_pool_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* Get source icon type */
 EXPORT enum obs_icon_type obs_source_get_icon_type(const char *id);
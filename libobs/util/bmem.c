@@ -21,6 +21,10 @@
 #include "platform.h"
 #include "threading.h"
 
+#ifdef HAVE_MIMALLOC
+#include <mimalloc.h>
+#endif
+
 /*
  * NOTE: totally jacked the mem alignment trick from ffmpeg, credit to them:
  *   http://www.ffmpeg.org/
@@ -38,7 +42,9 @@
  * change, it would also ruin our memory alignment for some reallocated memory
  * on those platforms.
  */
-#if defined(_WIN32)
+#if defined(HAVE_MIMALLOC)
+#define MIMALLOC 1
+#elif defined(_WIN32)
 #define ALIGNED_MALLOC 1
 #else
 #define ALIGNMENT_HACK 1
@@ -46,7 +52,9 @@
 
 static void *a_malloc(size_t size)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef MIMALLOC
+	return mi_malloc_aligned(size, ALIGNMENT);
+#elif ALIGNED_MALLOC
 	return _aligned_malloc(size, ALIGNMENT);
 #elif ALIGNMENT_HACK
 	void *ptr = NULL;
@@ -67,7 +75,9 @@ static void *a_malloc(size_t size)
 
 static void *a_realloc(void *ptr, size_t size)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef MIMALLOC
+	return mi_realloc_aligned(ptr, size, ALIGNMENT);
+#elif ALIGNED_MALLOC
 	return _aligned_realloc(ptr, size, ALIGNMENT);
 #elif ALIGNMENT_HACK
 	long diff;
@@ -86,7 +96,9 @@ static void *a_realloc(void *ptr, size_t size)
 
 static void a_free(void *ptr)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef MIMALLOC
+	mi_free(ptr);
+#elif ALIGNED_MALLOC
 	_aligned_free(ptr);
 #elif ALIGNMENT_HACK
 	if (ptr)
@@ -97,6 +109,16 @@ static void a_free(void *ptr)
 }
 
 static long num_allocs = 0;
+static long total_allocs = 0;
+
+static THREAD_LOCAL struct bmem_counter *thread_counter = NULL;
+
+struct bmem_counter *bmem_set_thread_counter(struct bmem_counter *counter)
+{
+	struct bmem_counter *prev = thread_counter;
+	thread_counter = counter;
+	return prev;
+}
 
 void *bmalloc(size_t size)
 {
@@ -113,6 +135,9 @@ void *bmalloc(size_t size)
 	}
 
 	os_atomic_inc_long(&num_allocs);
+	os_atomic_inc_long(&total_allocs);
+	if (thread_counter)
+		os_atomic_inc_long(&thread_counter->allocs);
 	return ptr;
 }
 
@@ -120,6 +145,9 @@ void *brealloc(void *ptr, size_t size)
 {
 	if (!ptr)
 		os_atomic_inc_long(&num_allocs);
+	os_atomic_inc_long(&total_allocs);
+	if (thread_counter)
+		os_atomic_inc_long(ptr ? &thread_counter->reallocs : &thread_counter->allocs);
 
 	if (!size) {
 		os_breakpoint();
@@ -149,6 +177,11 @@ long bnum_allocs(void)
 	return num_allocs;
 }
 
+long bnum_total_allocs(void)
+{
+	return os_atomic_load_long(&total_allocs);
+}
+
 int base_get_alignment(void)
 {
 	return ALIGNMENT;
@@ -39,6 +39,20 @@ EXPORT int base_get_alignment(void);
 
 EXPORT long bnum_allocs(void);
 
+/* bmalloc and brealloc calls so far, wraps around */
+EXPORT long bnum_total_allocs(void);
+
+struct bmem_counter {
+	const char *name;
+	volatile long allocs;
+	volatile long reallocs;
+};
+
+/* counts the calling thread's bmalloc/brealloc calls in counter from now on,
+ * or stops counting if NULL.  returns the previous counter so a subsystem
+ * can count the work it does on someone else's thread and restore it. */
+EXPORT struct bmem_counter *bmem_set_thread_counter(struct bmem_counter *counter);
+
 EXPORT void *bmemdup(const void *ptr, size_t size);
 
 static inline void *bzalloc(size_t size)
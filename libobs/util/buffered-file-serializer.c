@@ -14,10 +14,21 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "buffered-file-serializer.h"
 
 #include <inttypes.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "platform.h"
 #include "threading.h"
 #include "deque.h"
@@ -25,6 +36,10 @@
 
 static const size_t DEFAULT_BUF_SIZE = 256ULL * 1048576ULL; // 256 MiB
 static const size_t DEFAULT_CHUNK_SIZE = 1048576;           // 1 MiB
+static const uint64_t PREALLOC_SIZE = 64ULL * 1048576ULL;   // 64 MiB
+
+/* Number of chunks that can be written at the same time */
+#define IO_QUEUE_DEPTH 4
 
 /* ========================================================================== */
 /* Buffered writer based on ffmpeg-mux implementation                         */
@@ -34,6 +49,30 @@ struct io_header {
 	uint64_t data_length;
 };
 
+/* Chunks are written at the offset they belong to rather than through a
+ * file position, so that several of them can be in flight at once: with
+ * overlapped I/O on Windows, and on a thread of their own elsewhere. */
+struct io_chunk {
+	unsigned char *data;
+	size_t used;
+	uint64_t offset;
+	bool pending;
+	uint64_t submit_ts;
+
+#ifdef _WIN32
+	OVERLAPPED ov;
+#else
+	pthread_t thread;
+	bool thread_active;
+	os_sem_t *submit_sem;
+	os_sem_t *done_sem;
+	bool stop;
+	bool success;
+	int error;
+	int fd;
+#endif
+};
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -42,12 +81,26 @@ struct io_buffer {
 	os_event_t *new_data_available_event;
 	pthread_t io_thread;
 	pthread_mutex_t data_mutex;
-	FILE *output_file;
+#ifdef _WIN32
+	HANDLE output_file;
+#else
+	int output_file;
+#endif
 	struct deque data;
 	uint64_t next_pos;
 
 	size_t buffer_size;
 	size_t chunk_size;
+
+	/* Protected by data_mutex */
+	struct buffered_file_serializer_stats stats;
+
+	/* I/O thread only */
+	struct io_chunk chunks[IO_QUEUE_DEPTH];
+	size_t cur_chunk;
+	uint64_t append_pos;
+	uint64_t allocated;
+	bool prealloc_failed;
 };
 
 struct file_output_data {
@@ -55,48 +108,300 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+/* -------------------------------------------------------------------------- */
+/* Platform file I/O                                                          */
+
+#ifdef _WIN32
+static bool open_file(struct io_buffer *io, const char *path)
+{
+	wchar_t *wpath = NULL;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	io->output_file = CreateFileW(wpath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+				      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+	bfree(wpath);
+
+	if (io->output_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+		io->chunks[i].ov.hEvent = CreateEvent(NULL, true, false, NULL);
+		if (!io->chunks[i].ov.hEvent)
+			return false;
+	}
+
+	return true;
+}
+
+static void close_file(struct io_buffer *io)
+{
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+		if (io->chunks[i].ov.hEvent)
+			CloseHandle(io->chunks[i].ov.hEvent);
+	}
+
+	if (io->output_file && io->output_file != INVALID_HANDLE_VALUE)
+		CloseHandle(io->output_file);
+}
+
+static bool chunk_submit(struct io_buffer *io, struct io_chunk *chunk)
+{
+	HANDLE event = chunk->ov.hEvent;
+
+	memset(&chunk->ov, 0, sizeof(chunk->ov));
+	chunk->ov.hEvent = event;
+	chunk->ov.Offset = (DWORD)chunk->offset;
+	chunk->ov.OffsetHigh = (DWORD)(chunk->offset >> 32);
+
+	if (!WriteFile(io->output_file, chunk->data, (DWORD)chunk->used, NULL, &chunk->ov) &&
+	    GetLastError() != ERROR_IO_PENDING) {
+		blog(LOG_ERROR, "Error writing to file: %lu", GetLastError());
+		return false;
+	}
+
+	chunk->pending = true;
+	return true;
+}
+
+static bool chunk_wait(struct io_buffer *io, struct io_chunk *chunk)
+{
+	DWORD written = 0;
+
+	chunk->pending = false;
+
+	if (!GetOverlappedResult(io->output_file, &chunk->ov, &written, true) || written != chunk->used) {
+		blog(LOG_ERROR, "Error writing to file: %lu (%lu != %zu)", GetLastError(), written, chunk->used);
+		return false;
+	}
+
+	return true;
+}
+
+/* The allocation past the end of the file is given back when it's closed */
+static bool preallocate(struct io_buffer *io, uint64_t size)
+{
+	FILE_ALLOCATION_INFO info = {0};
+
+	info.AllocationSize.QuadPart = (LONGLONG)size;
+	return !!SetFileInformationByHandle(io->output_file, FileAllocationInfo, &info, sizeof(info));
+}
+#else
+static void *chunk_thread(void *opaque)
+{
+	struct io_chunk *chunk = opaque;
+	os_set_thread_name("buffered writer chunk thread");
+
+	for (;;) {
+		os_sem_wait(chunk->submit_sem);
+		if (chunk->stop)
+			break;
+
+		size_t written = 0;
+		chunk->success = true;
+
+		while (written < chunk->used) {
+			ssize_t ret = pwrite(chunk->fd, chunk->data + written, chunk->used - written,
+					     (off_t)(chunk->offset + written));
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0) {
+				chunk->error = errno;
+				chunk->success = false;
+				break;
+			}
+
+			written += (size_t)ret;
+		}
+
+		os_sem_post(chunk->done_sem);
+	}
+
+	return NULL;
+}
+
+static bool open_file(struct io_buffer *io, const char *path)
+{
+	io->output_file = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (io->output_file == -1)
+		return false;
+
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+		struct io_chunk *chunk = &io->chunks[i];
+
+		chunk->fd = io->output_file;
+		if (os_sem_init(&chunk->submit_sem, 0) != 0 || os_sem_init(&chunk->done_sem, 0) != 0)
+			return false;
+		if (pthread_create(&chunk->thread, NULL, chunk_thread, chunk) != 0)
+			return false;
+
+		chunk->thread_active = true;
+	}
+
+	return true;
+}
+
+static void close_file(struct io_buffer *io)
+{
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+		struct io_chunk *chunk = &io->chunks[i];
+
+		if (chunk->thread_active) {
+			chunk->stop = true;
+			os_sem_post(chunk->submit_sem);
+			pthread_join(chunk->thread, NULL);
+		}
+
+		os_sem_destroy(chunk->submit_sem);
+		os_sem_destroy(chunk->done_sem);
+	}
+
+	if (io->output_file != -1)
+		close(io->output_file);
+}
+
+static bool chunk_submit(struct io_buffer *io, struct io_chunk *chunk)
+{
+	UNUSED_PARAMETER(io);
+
+	chunk->pending = true;
+	os_sem_post(chunk->submit_sem);
+	return true;
+}
+
+static bool chunk_wait(struct io_buffer *io, struct io_chunk *chunk)
+{
+	UNUSED_PARAMETER(io);
+
+	os_sem_wait(chunk->done_sem);
+	chunk->pending = false;
+
+	if (!chunk->success)
+		blog(LOG_ERROR, "Error writing to file: %s", strerror(chunk->error));
+	return chunk->success;
+}
+
+/* Reserves the space without changing the file size, so nothing has to be
+ * trimmed once done */
+static bool preallocate(struct io_buffer *io, uint64_t size)
+{
+#ifdef __linux__
+	return fallocate(io->output_file, FALLOC_FL_KEEP_SIZE, (off_t)io->allocated,
+			 (off_t)(size - io->allocated)) == 0;
+#else
+	UNUSED_PARAMETER(io);
+	UNUSED_PARAMETER(size);
+	return false;
+#endif
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* I/O thread                                                                 */
+
+/* Measured from submitting the chunk, so it also covers the time it spends
+ * queued behind the ones before it */
+static bool finish_chunk(struct io_buffer *io, struct io_chunk *chunk)
+{
+	if (!chunk_wait(io, chunk))
+		return false;
+
+	uint64_t write_ns = os_gettime_ns() - chunk->submit_ts;
+
+	pthread_mutex_lock(&io->data_mutex);
+	io->stats.bytes_written += chunk->used;
+	if (write_ns > io->stats.max_write_ns)
+		io->stats.max_write_ns = write_ns;
+	pthread_mutex_unlock(&io->data_mutex);
+	return true;
+}
+
+static bool wait_all_chunks(struct io_buffer *io)
+{
+	bool success = true;
+
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++) {
+		if (io->chunks[i].pending && !finish_chunk(io, &io->chunks[i]))
+			success = false;
+	}
+
+	return success;
+}
+
+/* Writes the current chunk and moves on to the next one, which may have to
+ * finish being written first. */
+static bool submit_chunk(struct io_buffer *io)
+{
+	struct io_chunk *chunk = &io->chunks[io->cur_chunk];
+	uint64_t end = chunk->offset + chunk->used;
+
+	/* Only appending chunks can't overlap with ones still in flight,
+	 * anything else (e.g. headers rewritten after the fact) has to wait for
+	 * them so that it lands on top. */
+	if (chunk->offset != io->append_pos && !wait_all_chunks(io))
+		return false;
+
+	/* Growing the file a chunk at a time makes the file system update its
+	 * metadata on every write, reserve space well ahead instead. */
+	if (!io->prealloc_failed && end > io->allocated) {
+		uint64_t size = end + PREALLOC_SIZE;
+
+		if (preallocate(io, size))
+			io->allocated = size;
+		else
+			io->prealloc_failed = true;
+	}
+
+	chunk->submit_ts = os_gettime_ns();
+	if (!chunk_submit(io, chunk))
+		return false;
+
+	io->append_pos = end;
+	io->cur_chunk = (io->cur_chunk + 1) % IO_QUEUE_DEPTH;
+
+	chunk = &io->chunks[io->cur_chunk];
+	if (chunk->pending && !finish_chunk(io, chunk))
+		return false;
+
+	chunk->used = 0;
+	return true;
+}
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
+	struct io_buffer *io = &out->io;
 	os_set_thread_name("buffered writer i/o thread");
 
-	// Chunk collects the writes into a larger batch
-	size_t chunk_used = 0;
-	size_t chunk_size = out->io.chunk_size;
-
-	unsigned char *chunk = bmalloc(chunk_size);
-	if (!chunk) {
-		os_atomic_set_bool(&out->io.output_error, true);
-		fprintf(stderr, "Error allocating memory for output\n");
-		goto error;
-	}
+	size_t chunk_size = io->chunk_size;
 
 	bool shutting_down;
-	bool want_seek = false;
 	bool force_flush_chunk = false;
 
 	// current_seek_position is a virtual position updated as we read from
 	// the buffer, if it becomes discontinuous due to a seek request we
-	// flush the chunk. next_seek_position is the actual offset we should
-	// seek to when we write the chunk.
+	// flush the chunk. Each chunk is written at the offset of its first
+	// write.
 	uint64_t current_seek_position = 0;
-	uint64_t next_seek_position;
 
 	for (;;) {
 		// Wait for data to be written to the buffer
-		os_event_wait(out->io.new_data_available_event);
+		os_event_wait(io->new_data_available_event);
 
 		// Loop to write in chunk_size chunks
 		for (;;) {
-			pthread_mutex_lock(&out->io.data_mutex);
+			struct io_chunk *chunk = &io->chunks[io->cur_chunk];
+
+			pthread_mutex_lock(&io->data_mutex);
 
-			shutting_down = os_atomic_load_bool(&out->io.shutdown_requested);
+			shutting_down = os_atomic_load_bool(&io->shutdown_requested);
 
 			// Fetch as many writes as possible from the deque
-			// and fill up our local chunk. This may involve
-			// seeking, so take care of that as well.
+			// and fill up the current chunk. A discontinuity
+			// ends the chunk.
 			for (;;) {
-				size_t available = out->io.data.size;
+				size_t available = io->data.size;
 
 				// Buffer is empty (now) or was already empty (we got
 				// woken up to exit)
@@ -105,88 +410,64 @@ static void *io_thread(void *opaque)
 
 				// Get seek offset and data size
 				struct io_header header;
-				deque_peek_front(&out->io.data, &header, sizeof(header));
+				deque_peek_front(&io->data, &header, sizeof(header));
 
 				// Do we need to seek?
 				if (header.seek_offset != current_seek_position) {
-
 					// If there's already part of a chunk pending,
-					// flush it at the current offset. Similarly,
-					// if we already plan to seek, then seek.
-					if (chunk_used || want_seek) {
+					// flush it at its offset first.
+					if (chunk->used) {
 						force_flush_chunk = true;
 						break;
 					}
 
-					// Mark that we need to seek and where to
-					want_seek = true;
-					next_seek_position = header.seek_offset;
-
 					// Update our virtual position
 					current_seek_position = header.seek_offset;
 				}
 
 				// Make sure there's enough room for the data, if
 				// not then force a flush
-				if (header.data_length + chunk_used > chunk_size) {
+				if (header.data_length + chunk->used > chunk_size) {
 					force_flush_chunk = true;
 					break;
 				}
 
+				if (!chunk->used)
+					chunk->offset = header.seek_offset;
+
 				// Remove header that we already read
-				deque_pop_front(&out->io.data, NULL, sizeof(header));
+				deque_pop_front(&io->data, NULL, sizeof(header));
 
 				// Copy from the buffer to our local chunk
-				deque_pop_front(&out->io.data, chunk + chunk_used, header.data_length);
+				deque_pop_front(&io->data, chunk->data + chunk->used, header.data_length);
 
 				// Update offsets
-				chunk_used += header.data_length;
+				chunk->used += header.data_length;
 				current_seek_position += header.data_length;
 			}
 
 			// Signal that there is more room in the buffer
-			os_event_signal(out->io.buffer_space_available_event);
+			os_event_signal(io->buffer_space_available_event);
 
 			// Try to avoid lots of small writes unless this was the final
 			// data left in the buffer. The buffer might be entirely empty
 			// if we were woken up to exit.
-			if (!force_flush_chunk && (!chunk_used || (chunk_used < 65536 && !shutting_down))) {
-				os_event_reset(out->io.new_data_available_event);
-				pthread_mutex_unlock(&out->io.data_mutex);
+			if (!force_flush_chunk && (!chunk->used || (chunk->used < 65536 && !shutting_down))) {
+				os_event_reset(io->new_data_available_event);
+				pthread_mutex_unlock(&io->data_mutex);
 				break;
 			}
 
-			pthread_mutex_unlock(&out->io.data_mutex);
-
-			// Seek if we need to
-			if (want_seek) {
-				os_fseeki64(out->io.output_file, next_seek_position, SEEK_SET);
-
-				// Update the next virtual position, making sure to take
-				// into account the size of the chunk we're about to write.
-				current_seek_position = next_seek_position + chunk_used;
-
-				want_seek = false;
-
-				// If we did a seek but do not have any data left to write
-				// return to the start of the loop.
-				if (!chunk_used) {
-					force_flush_chunk = false;
-					continue;
-				}
-			}
+			pthread_mutex_unlock(&io->data_mutex);
 
 			// Write the current chunk to the output file
-			size_t bytes_written = fwrite(chunk, 1, chunk_used, out->io.output_file);
-			if (bytes_written != chunk_used) {
-				blog(LOG_ERROR, "Error writing to '%s': %s (%zu != %zu)\n", out->filename.array,
-				     strerror(errno), bytes_written, chunk_used);
-				os_atomic_set_bool(&out->io.output_error, true);
+			if (chunk->used && !submit_chunk(io)) {
+				blog(LOG_ERROR, "Error writing to '%s'", out->filename.array);
+				os_atomic_set_bool(&io->output_error, true);
 
 				goto error;
 			}
 
-			chunk_used = 0;
 			force_flush_chunk = false;
 		}
 
@@ -196,10 +477,11 @@ static void *io_thread(void *opaque)
 	}
 
 error:
-	if (chunk)
-		bfree(chunk);
+	if (!wait_all_chunks(io) && !os_atomic_load_bool(&io->output_error)) {
+		blog(LOG_ERROR, "Error writing to '%s'", out->filename.array);
+		os_atomic_set_bool(&io->output_error, true);
+	}
 
-	fclose(out->io.output_file);
 	return NULL;
 }
 
@@ -246,6 +528,15 @@ static inline size_t min(size_t a, size_t b)
 }
 #endif
 
+static void add_blocked_time(struct io_buffer *io, uint64_t blocked_ns)
+{
+	pthread_mutex_lock(&io->data_mutex);
+	io->stats.total_blocked_ns += blocked_ns;
+	if (blocked_ns > io->stats.max_blocked_ns)
+		io->stats.max_blocked_ns = blocked_ns;
+	pthread_mutex_unlock(&io->data_mutex);
+}
+
 static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 {
 	struct file_output_data *out = opaque;
@@ -274,7 +565,10 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 			// No space, wait for the I/O thread to make space
 			os_event_reset(out->io.buffer_space_available_event);
 			pthread_mutex_unlock(&out->io.data_mutex);
+
+			uint64_t start = os_gettime_ns();
 			os_event_wait(out->io.buffer_space_available_event);
+			add_blocked_time(&out->io, os_gettime_ns() - start);
 			continue;
 		}
 
@@ -300,6 +594,9 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 			next_chunk_size = min(remaining, out->io.chunk_size);
 		}
 
+		if (out->io.data.size > out->io.stats.buffer_peak)
+			out->io.stats.buffer_peak = out->io.data.size;
+
 		// Tell the I/O thread that there's new data to be written
 		os_event_signal(out->io.new_data_available_event);
 
@@ -319,6 +616,12 @@ static int64_t file_output_get_pos(void *opaque)
 	return (int64_t)out->io.next_pos;
 }
 
+static void free_chunks(struct io_buffer *io)
+{
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++)
+		bfree(io->chunks[i].data);
+}
+
 bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path)
 {
 	return buffered_file_serializer_init(s, path, 0, 0);
@@ -332,13 +635,20 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
-	if (!out->io.output_file)
-		return false;
-
 	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
 	out->io.chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
 
+	for (size_t i = 0; i < IO_QUEUE_DEPTH; i++)
+		out->io.chunks[i].data = bmalloc(out->io.chunk_size);
+
+	if (!open_file(&out->io, path)) {
+		close_file(&out->io);
+		free_chunks(&out->io);
+		dstr_free(&out->filename);
+		bfree(out);
+		return false;
+	}
+
 	// Start at 1MB, this can grow up to max_bufsize depending
 	// on how fast data is going in and out.
 	deque_reserve(&out->io.data, 1048576);
@@ -376,6 +686,9 @@ void buffered_file_serializer_free(struct serializer *s)
 		pthread_mutex_unlock(&out->io.data_mutex);
 		pthread_join(out->io.io_thread, NULL);
 
+		close_file(&out->io);
+		free_chunks(&out->io);
+
 		os_event_destroy(out->io.new_data_available_event);
 		os_event_destroy(out->io.buffer_space_available_event);
 
@@ -389,3 +702,19 @@ void buffered_file_serializer_free(struct serializer *s)
 	dstr_free(&out->filename);
 	bfree(out);
 }
+
+void buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats)
+{
+	struct file_output_data *out = s->data;
+
+	if (!out || !out->io.active) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&out->io.data_mutex);
+	*stats = out->io.stats;
+	stats->buffer_used = out->io.data.size;
+	stats->buffer_size = out->io.buffer_size;
+	pthread_mutex_unlock(&out->io.data_mutex);
+}
@@ -22,11 +22,30 @@
 extern "C" {
 #endif
 
+struct buffered_file_serializer_stats {
+	/* Data that has made it to the file */
+	uint64_t bytes_written;
+	/* Data waiting to be written, and how much of it there can be before
+	 * writes block */
+	size_t buffer_used;
+	size_t buffer_peak;
+	size_t buffer_size;
+	/* Longest time a single write waited for space in the buffer, and all
+	 * of them together */
+	uint64_t max_blocked_ns;
+	uint64_t total_blocked_ns;
+	/* Longest time a chunk took to be written to the file */
+	uint64_t max_write_ns;
+};
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize,
 					  size_t chunk_size);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
+/* Can be called from any thread while the serializer is in use */
+EXPORT void buffered_file_serializer_get_stats(struct serializer *s, struct buffered_file_serializer_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
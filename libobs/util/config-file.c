@@ -20,6 +20,7 @@
 
 #include "config-file.h"
 #include "threading.h"
+#include "task.h"
 #include "platform.h"
 #include "base.h"
 #include "bmem.h"
@@ -64,8 +65,32 @@ struct config_data {
 	struct config_section *sections;
 	struct config_section *defaults;
 	pthread_mutex_t mutex;
+
+	/* set when user values change, cleared once they're written out */
+	bool dirty;
+
+	/* serializes writing the file so the deferred writer and direct
+	 * saves don't write the same temporary file at once */
+	pthread_mutex_t write_mutex;
+
+	/* deferred saves, created on first use */
+	os_task_queue_t *writer;
+	char *deferred_temp_ext;
+	char *deferred_backup_ext;
+	bool save_queued;
 };
 
+static inline int config_init_mutexes(struct config_data *config)
+{
+	if (pthread_mutex_init_recursive(&config->mutex) != 0)
+		return -1;
+	if (pthread_mutex_init(&config->write_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&config->mutex);
+		return -1;
+	}
+	return 0;
+}
+
 config_t *config_create(const char *file)
 {
 	struct config_data *config;
@@ -78,7 +103,7 @@ config_t *config_create(const char *file)
 
 	config = bzalloc(sizeof(struct config_data));
 
-	if (pthread_mutex_init_recursive(&config->mutex) != 0) {
+	if (config_init_mutexes(config) != 0) {
 		bfree(config);
 		return NULL;
 	}
@@ -277,7 +302,7 @@ int config_open(config_t **config, const char *file, enum config_open_type open_
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
+	if (config_init_mutexes(*config) != 0) {
 		bfree(*config);
 		return CONFIG_ERROR;
 	}
@@ -305,7 +330,7 @@ int config_open_string(config_t **config, const char *str)
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
+	if (config_init_mutexes(*config) != 0) {
 		bfree(*config);
 		return CONFIG_ERROR;
 	}
@@ -328,39 +353,20 @@ int config_open_defaults(config_t *config, const char *file)
 	return config_parse_file(&config->defaults, file, false);
 }
 
-int config_save(config_t *config)
+static void config_serialize(config_t *config, struct dstr *str)
 {
-	FILE *f;
-	struct dstr str, tmp;
-	int ret = CONFIG_ERROR;
-
-	if (!config)
-		return CONFIG_ERROR;
-	if (!config->file)
-		return CONFIG_ERROR;
-
-	dstr_init(&str);
-	dstr_init(&tmp);
-
-	pthread_mutex_lock(&config->mutex);
-
-	f = os_fopen(config->file, "wb");
-	if (!f) {
-		pthread_mutex_unlock(&config->mutex);
-		return CONFIG_FILENOTFOUND;
-	}
-
 	struct config_section *section, *stmp;
 	struct config_item *item, *itmp;
+	struct dstr tmp = {0};
 
 	int idx = 0;
 	HASH_ITER (hh, config->sections, section, stmp) {
 		if (idx++)
-			dstr_cat(&str, "\n");
+			dstr_cat(str, "\n");
 
-		dstr_cat(&str, "[");
-		dstr_cat(&str, section->name);
-		dstr_cat(&str, "]\n");
+		dstr_cat(str, "[");
+		dstr_cat(str, section->name);
+		dstr_cat(str, "]\n");
 
 		HASH_ITER (hh, section->items, item, itmp) {
 			dstr_copy(&tmp, item->value ? item->value : "");
@@ -368,30 +374,76 @@ int config_save(config_t *config)
 			dstr_replace(&tmp, "\r", "\\r");
 			dstr_replace(&tmp, "\n", "\\n");
 
-			dstr_cat(&str, item->name);
-			dstr_cat(&str, "=");
-			dstr_cat(&str, tmp.array);
-			dstr_cat(&str, "\n");
+			dstr_cat(str, item->name);
+			dstr_cat(str, "=");
+			dstr_cat(str, tmp.array);
+			dstr_cat(str, "\n");
 		}
 	}
 
+	dstr_free(&tmp);
+}
+
+static int config_write_file(const char *file, const struct dstr *str)
+{
+	int ret = CONFIG_ERROR;
+	FILE *f;
+
+	f = os_fopen(file, "wb");
+	if (!f)
+		return CONFIG_FILENOTFOUND;
+
 #ifdef _WIN32
 	if (fwrite("\xEF\xBB\xBF", 3, 1, f) != 1)
 		goto cleanup;
 #endif
-	if (fwrite(str.array, str.len, 1, f) != 1)
+	if (str->len && fwrite(str->array, str->len, 1, f) != 1)
 		goto cleanup;
 
 	ret = CONFIG_SUCCESS;
 
 cleanup:
 	fclose(f);
+	return ret;
+}
 
+/* copies the data out under the lock so the file itself is written
+ * without blocking anything that reads or changes values */
+static void config_take_snapshot(config_t *config, struct dstr *str)
+{
+	pthread_mutex_lock(&config->mutex);
+	config_serialize(config, str);
+	config->dirty = false;
 	pthread_mutex_unlock(&config->mutex);
+}
 
-	dstr_free(&tmp);
-	dstr_free(&str);
+static inline void config_set_dirty(config_t *config)
+{
+	pthread_mutex_lock(&config->mutex);
+	config->dirty = true;
+	pthread_mutex_unlock(&config->mutex);
+}
 
+int config_save(config_t *config)
+{
+	struct dstr str = {0};
+	int ret;
+
+	if (!config)
+		return CONFIG_ERROR;
+	if (!config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->write_mutex);
+
+	config_take_snapshot(config, &str);
+	ret = config_write_file(config->file, &str);
+	if (ret != CONFIG_SUCCESS)
+		config_set_dirty(config);
+
+	pthread_mutex_unlock(&config->write_mutex);
+
+	dstr_free(&str);
 	return ret;
 }
 
@@ -399,7 +451,7 @@ int config_save_safe(config_t *config, const char *temp_ext, const char *backup_
 {
 	struct dstr temp_file = {0};
 	struct dstr backup_file = {0};
-	char *file = config->file;
+	struct dstr str = {0};
 	int ret;
 
 	if (!temp_ext || !*temp_ext) {
@@ -407,17 +459,18 @@ int config_save_safe(config_t *config, const char *temp_ext, const char *backup_
 				"temporary extension specified");
 		return CONFIG_ERROR;
 	}
+	if (!config || !config->file)
+		return CONFIG_ERROR;
 
-	pthread_mutex_lock(&config->mutex);
+	pthread_mutex_lock(&config->write_mutex);
 
 	dstr_copy(&temp_file, config->file);
 	if (*temp_ext != '.')
 		dstr_cat(&temp_file, ".");
 	dstr_cat(&temp_file, temp_ext);
 
-	config->file = temp_file.array;
-	ret = config_save(config);
-	config->file = file;
+	config_take_snapshot(config, &str);
+	ret = config_write_file(temp_file.array, &str);
 
 	if (ret != CONFIG_SUCCESS) {
 		blog(LOG_ERROR,
@@ -434,16 +487,81 @@ int config_save_safe(config_t *config, const char *temp_ext, const char *backup_
 		dstr_cat(&backup_file, backup_ext);
 	}
 
-	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0)
+	if (os_safe_replace(config->file, temp_file.array, backup_file.array) != 0)
 		ret = CONFIG_ERROR;
 
 cleanup:
-	pthread_mutex_unlock(&config->mutex);
+	if (ret != CONFIG_SUCCESS)
+		config_set_dirty(config);
+
+	pthread_mutex_unlock(&config->write_mutex);
 	dstr_free(&temp_file);
 	dstr_free(&backup_file);
+	dstr_free(&str);
 	return ret;
 }
 
+static void config_deferred_save(void *param)
+{
+	config_t *config = param;
+	char *temp_ext;
+	char *backup_ext;
+	bool dirty;
+
+	/* cleared first, so changes made while this writes queue another
+	 * save, while every request before it is covered by this one */
+	pthread_mutex_lock(&config->mutex);
+	config->save_queued = false;
+	dirty = config->dirty;
+	temp_ext = bstrdup(config->deferred_temp_ext);
+	backup_ext = bstrdup(config->deferred_backup_ext);
+	pthread_mutex_unlock(&config->mutex);
+
+	if (dirty)
+		config_save_safe(config, temp_ext, backup_ext);
+
+	bfree(temp_ext);
+	bfree(backup_ext);
+}
+
+int config_save_deferred(config_t *config, const char *temp_ext, const char *backup_ext)
+{
+	bool queued = true;
+
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR, "config_save_deferred: invalid "
+				"temporary extension specified");
+		return CONFIG_ERROR;
+	}
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->mutex);
+
+	if (!config->writer)
+		config->writer = os_task_queue_create_named("config writer", OS_TASK_PRIORITY_LOW);
+
+	bfree(config->deferred_temp_ext);
+	bfree(config->deferred_backup_ext);
+	config->deferred_temp_ext = bstrdup(temp_ext);
+	config->deferred_backup_ext = backup_ext && *backup_ext ? bstrdup(backup_ext) : NULL;
+
+	if (!config->save_queued && config->dirty) {
+		queued = os_task_queue_queue_task(config->writer, config_deferred_save, config);
+		config->save_queued = queued;
+	}
+
+	pthread_mutex_unlock(&config->mutex);
+
+	return queued ? CONFIG_SUCCESS : config_save_safe(config, temp_ext, backup_ext);
+}
+
+void config_flush(config_t *config)
+{
+	if (config && config->writer)
+		os_task_queue_wait(config->writer);
+}
+
 void config_close(config_t *config)
 {
 	struct config_section *section, *temp;
@@ -451,6 +569,11 @@ void config_close(config_t *config)
 	if (!config)
 		return;
 
+	/* finishes any pending deferred save */
+	os_task_queue_destroy(config->writer);
+	bfree(config->deferred_temp_ext);
+	bfree(config->deferred_backup_ext);
+
 	HASH_ITER (hh, config->sections, section, temp) {
 		HASH_DELETE(hh, config->sections, section);
 		config_section_free(section);
@@ -463,6 +586,7 @@ void config_close(config_t *config)
 
 	bfree(config->file);
 	pthread_mutex_destroy(&config->mutex);
+	pthread_mutex_destroy(&config->write_mutex);
 	bfree(config);
 }
 
@@ -515,6 +639,7 @@ static void config_set_item(config_t *config, struct config_section **sections,
 {
 	struct config_section *sec;
 	struct config_item *item;
+	bool changed = true;
 
 	pthread_mutex_lock(&config->mutex);
 
@@ -533,11 +658,18 @@ static void config_set_item(config_t *config, struct config_section **sections,
 		item->value = value;
 
 		HASH_ADD_STR(sec->items, name, item);
+	} else if (strcmp(item->value, value) == 0) {
+		/* unchanged, so there's nothing new to write */
+		bfree(value);
+		changed = false;
 	} else {
 		bfree(item->value);
 		item->value = value;
 	}
 
+	if (changed && sections == &config->sections)
+		config->dirty = true;
+
 	pthread_mutex_unlock(&config->mutex);
 }
 
@@ -711,6 +843,7 @@ bool config_remove_value(config_t *config, const char *section, const char *name
 		if (item) {
 			HASH_DELETE(hh, sec->items, item);
 			config_item_free(item);
+			config->dirty = true;
 			success = true;
 		}
 	}
@@ -48,6 +48,12 @@ EXPORT int config_save(config_t *config);
 EXPORT int config_save_safe(config_t *config, const char *temp_ext, const char *backup_ext);
 EXPORT void config_close(config_t *config);
 
+/* Saves like config_save_safe, but in the background.  Requests made
+ * before the write starts are coalesced, and nothing is written if no
+ * value changed since the last save.  config_close waits for it. */
+EXPORT int config_save_deferred(config_t *config, const char *temp_ext, const char *backup_ext);
+EXPORT void config_flush(config_t *config);
+
 EXPORT size_t config_num_sections(config_t *config);
 EXPORT const char *config_get_section(config_t *config, size_t idx);
 
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+
+#include "bmem.h"
+#include "threading.h"
+#include "spsc-ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bounded multiple producer, multiple consumer queue of fixed size items.
+ * Any number of threads may push and pop at the same time without locking.
+ * Every cell carries a sequence number that tells a producer whether the
+ * cell is free for its position and a consumer whether the cell has been
+ * filled for its position, so the only contended operation is claiming a
+ * position.  The capacity is a power of two and does not grow; pushing to
+ * a full ring fails instead. */
+
+struct mpmc_ring {
+	uint8_t *cells;
+	size_t item_size;
+	size_t stride;
+	size_t capacity;
+
+	uint8_t pad0[RING_CACHE_LINE_SIZE];
+	volatile long tail;
+	uint8_t pad1[RING_CACHE_LINE_SIZE - sizeof(long)];
+	volatile long head;
+	uint8_t pad2[RING_CACHE_LINE_SIZE - sizeof(long)];
+};
+
+static inline volatile long *mpmc_ring_cell(const struct mpmc_ring *ring, unsigned long pos)
+{
+	size_t idx = (size_t)pos & (ring->capacity - 1);
+	return (volatile long *)(ring->cells + idx * ring->stride);
+}
+
+static inline void *mpmc_ring_cell_data(volatile long *cell)
+{
+	return (uint8_t *)cell + sizeof(long);
+}
+
+static inline void mpmc_ring_init(struct mpmc_ring *ring, size_t item_size, size_t min_capacity)
+{
+	size_t capacity = 2;
+
+	memset(ring, 0, sizeof(struct mpmc_ring));
+	if (!min_capacity || !item_size)
+		return;
+
+	while (capacity < min_capacity)
+		capacity <<= 1;
+
+	ring->item_size = item_size;
+	ring->stride = (sizeof(long) + item_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	ring->capacity = capacity;
+	ring->cells = (uint8_t *)bmalloc(ring->stride * capacity);
+
+	for (size_t i = 0; i < capacity; i++)
+		*mpmc_ring_cell(ring, (unsigned long)i) = (long)i;
+}
+
+static inline void mpmc_ring_free(struct mpmc_ring *ring)
+{
+	bfree(ring->cells);
+	memset(ring, 0, sizeof(struct mpmc_ring));
+}
+
+/* only exact when no other thread is pushing or popping */
+static inline size_t mpmc_ring_size(const struct mpmc_ring *ring)
+{
+	unsigned long t = (unsigned long)os_atomic_load_long(&ring->tail);
+	unsigned long h = (unsigned long)os_atomic_load_long(&ring->head);
+	size_t size = (size_t)(t - h);
+	return size > ring->capacity ? ring->capacity : size;
+}
+
+static inline bool mpmc_ring_empty(const struct mpmc_ring *ring)
+{
+	return mpmc_ring_size(ring) == 0;
+}
+
+/* copies one item in, returns false if the ring is full */
+static inline bool mpmc_ring_push_back(struct mpmc_ring *ring, const void *data)
+{
+	long pos = os_atomic_load_long(&ring->tail);
+	volatile long *cell;
+
+	if (!ring->cells)
+		return false;
+
+	for (;;) {
+		long diff;
+
+		cell = mpmc_ring_cell(ring, (unsigned long)pos);
+		diff = (long)((unsigned long)os_atomic_load_long(cell) - (unsigned long)pos);
+
+		if (diff == 0) {
+			if (os_atomic_compare_exchange_long(&ring->tail, &pos, (long)((unsigned long)pos + 1)))
+				break;
+		} else if (diff < 0) {
+			/* the consumer of the previous lap hasn't freed it */
+			return false;
+		} else {
+			pos = os_atomic_load_long(&ring->tail);
+		}
+	}
+
+	memcpy(mpmc_ring_cell_data(cell), data, ring->item_size);
+	os_atomic_store_long(cell, (long)((unsigned long)pos + 1));
+	return true;
+}
+
+/* copies one item out, returns false if the ring is empty */
+static inline bool mpmc_ring_pop_front(struct mpmc_ring *ring, void *data)
+{
+	long pos = os_atomic_load_long(&ring->head);
+	volatile long *cell;
+
+	if (!ring->cells)
+		return false;
+
+	for (;;) {
+		long diff;
+
+		cell = mpmc_ring_cell(ring, (unsigned long)pos);
+		diff = (long)((unsigned long)os_atomic_load_long(cell) - ((unsigned long)pos + 1));
+
+		if (diff == 0) {
+			if (os_atomic_compare_exchange_long(&ring->head, &pos, (long)((unsigned long)pos + 1)))
+				break;
+		} else if (diff < 0) {
+			/* nothing pushed here yet, or still being copied in */
+			return false;
+		} else {
+			pos = os_atomic_load_long(&ring->head);
+		}
+	}
+
+	if (data)
+		memcpy(data, mpmc_ring_cell_data(cell), ring->item_size);
+	os_atomic_store_long(cell, (long)((unsigned long)pos + ring->capacity));
+	return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -262,6 +262,43 @@ void os_sleep_ms(uint32_t duration)
 	usleep(duration * 1000);
 }
 
+struct os_hr_timer {
+	int unused;
+};
+
+os_hr_timer_t *os_hr_timer_create(void)
+{
+	return bzalloc(sizeof(struct os_hr_timer));
+}
+
+void os_hr_timer_destroy(os_hr_timer_t *timer)
+{
+	bfree(timer);
+}
+
+bool os_hr_timer_sleepto_ns(os_hr_timer_t *timer, uint64_t time_target)
+{
+	UNUSED_PARAMETER(timer);
+
+#ifdef __APPLE__
+	return os_sleepto_ns(time_target);
+#else
+	if (time_target < os_gettime_ns())
+		return false;
+
+	/* os_gettime_ns() is CLOCK_MONOTONIC, so sleep to the absolute time
+	 * directly instead of accumulating error from relative sleeps */
+	struct timespec req;
+	req.tv_sec = time_target / 1000000000;
+	req.tv_nsec = time_target % 1000000000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &req, NULL) == EINTR)
+		;
+
+	return true;
+#endif
+}
+
 #if !defined(__APPLE__)
 
 uint64_t os_gettime_ns(void)
@@ -442,6 +442,56 @@ bool os_sleepto_ns_fast(uint64_t time_target)
 	return true;
 }
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+struct os_hr_timer {
+	HANDLE handle;
+};
+
+os_hr_timer_t *os_hr_timer_create(void)
+{
+	/* high resolution timers require Windows 10 1803, fall back to a
+	 * regular waitable timer on older versions */
+	HANDLE handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!handle)
+		handle = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	if (!handle)
+		return NULL;
+
+	struct os_hr_timer *timer = bzalloc(sizeof(struct os_hr_timer));
+	timer->handle = handle;
+	return timer;
+}
+
+void os_hr_timer_destroy(os_hr_timer_t *timer)
+{
+	if (timer) {
+		CloseHandle(timer->handle);
+		bfree(timer);
+	}
+}
+
+bool os_hr_timer_sleepto_ns(os_hr_timer_t *timer, uint64_t time_target)
+{
+	const uint64_t current = os_gettime_ns();
+	if (time_target < current)
+		return false;
+
+	/* negative due times are relative, in 100 nanosecond units */
+	LARGE_INTEGER due;
+	due.QuadPart = -(LONGLONG)((time_target - current) / 100);
+	if (!due.QuadPart)
+		return true;
+
+	if (!SetWaitableTimer(timer->handle, &due, 0, NULL, NULL, FALSE))
+		return os_sleepto_ns(time_target);
+
+	WaitForSingleObject(timer->handle, INFINITE);
+	return true;
+}
+
 void os_sleep_ms(uint32_t duration)
 {
 	/* windows 8+ appears to have decreased sleep precision */
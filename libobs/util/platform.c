@@ -844,3 +844,77 @@ struct timespec *os_nstime_to_timespec(uint64_t timestamp, struct timespec *stor
 
 	return storage;
 }
+
+static inline const char *skip_spaces(const char *str)
+{
+	while (*str == ' ' || *str == '\t')
+		str++;
+	return str;
+}
+
+static bool parse_cpu_number(const char **str, uint32_t *cpu)
+{
+	char *end;
+	unsigned long val;
+
+	if (**str < '0' || **str > '9')
+		return false;
+
+	val = strtoul(*str, &end, 10);
+	if (val >= OS_MAX_CPUS)
+		return false;
+
+	*cpu = (uint32_t)val;
+	*str = end;
+	return true;
+}
+
+bool os_cpu_set_parse(struct os_cpu_set *set, const char *cpu_list)
+{
+	const char *str = cpu_list;
+
+	memset(set, 0, sizeof(*set));
+	if (!str)
+		return true;
+
+	str = skip_spaces(str);
+	while (*str) {
+		uint32_t first, last;
+
+		if (strncmp(str, "node:", 5) == 0) {
+			struct os_cpu_set node_set;
+
+			str += 5;
+			if (!parse_cpu_number(&str, &first) || !os_get_numa_node_cpus(first, &node_set))
+				goto fail;
+
+			for (size_t i = 0; i < OS_MAX_CPUS / 64; i++)
+				set->bits[i] |= node_set.bits[i];
+		} else {
+			if (!parse_cpu_number(&str, &first))
+				goto fail;
+
+			last = first;
+			if (*str == '-') {
+				str++;
+				if (!parse_cpu_number(&str, &last) || last < first)
+					goto fail;
+			}
+
+			for (uint32_t cpu = first; cpu <= last; cpu++)
+				os_cpu_set_add(set, cpu);
+		}
+
+		str = skip_spaces(str);
+		if (*str == ',')
+			str = skip_spaces(str + 1);
+		else if (*str)
+			goto fail;
+	}
+
+	return true;
+
+fail:
+	memset(set, 0, sizeof(*set));
+	return false;
+}
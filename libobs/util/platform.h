@@ -98,6 +98,15 @@ EXPORT bool os_sleepto_ns(uint64_t time_target);
 EXPORT bool os_sleepto_ns_fast(uint64_t time_target);
 EXPORT void os_sleep_ms(uint32_t duration);
 
+/* High resolution timer for sleeping until an absolute os_gettime_ns() time
+ * with lower wake-up latency than os_sleepto_ns().  Returns false if the
+ * target time has already passed. */
+typedef struct os_hr_timer os_hr_timer_t;
+
+EXPORT os_hr_timer_t *os_hr_timer_create(void);
+EXPORT void os_hr_timer_destroy(os_hr_timer_t *timer);
+EXPORT bool os_hr_timer_sleepto_ns(os_hr_timer_t *timer, uint64_t time_target);
+
 EXPORT uint64_t os_gettime_ns(void);
 
 EXPORT int os_get_config_path(char *dst, size_t size, const char *name);
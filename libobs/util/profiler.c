@@ -2,9 +2,11 @@
 #include "profiler.h"
 
 #include "darray.h"
+#include "deque.h"
 #include "dstr.h"
 #include "platform.h"
 #include "threading.h"
+#include "spsc-ring.h"
 
 #include <math.h>
 
@@ -355,8 +357,399 @@ static void merge_context(profile_call *context)
 	free_call_context(prev_call);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+/* Spans are recorded into a ring per thread that only that thread writes,
+ * and a collector thread moves them into a history of the last few seconds
+ * that can be dumped in the Chrome trace format.  Recording doesn't take a
+ * lock after the first span of a thread, so this can be left on. */
+
+#define TRACE_STACK_DEPTH 64
+#define TRACE_RING_SPANS 2048
+#define TRACE_COLLECT_INTERVAL_MS 100
+#define TRACE_MAX_HISTORY_SPANS (1 << 20)
+
+struct trace_span {
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+	uint32_t thread_id;
+	uint32_t depth;
+};
+
+struct trace_thread {
+	struct spsc_ring ring;
+	uint32_t id;
+	volatile long dropped;
+
+	long generation;
+	size_t depth;
+	struct {
+		const char *name;
+		uint64_t start;
+	} stack[TRACE_STACK_DEPTH];
+};
+
+static volatile bool trace_enabled = false;
+static volatile long trace_generation = 0;
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct trace_thread *) trace_threads;
+static DARRAY(const char *) trace_thread_names;
+static struct deque trace_history;
+static uint64_t trace_history_ns = 0;
+static long trace_dropped = 0;
+
+static bool trace_collector_active = false;
+static pthread_t trace_collector;
+static os_event_t *trace_stop_event = NULL;
+
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static bool trace_key_created = false;
+static pthread_key_t trace_key;
+
+static THREAD_LOCAL struct trace_thread *thread_trace = NULL;
+
+/* trace_mutex must be held */
+static void trace_drain_thread(struct trace_thread *t)
+{
+	struct trace_span span;
+
+	while (spsc_ring_size(&t->ring) >= sizeof(span)) {
+		spsc_ring_peek(&t->ring, 0, &span, sizeof(span));
+		spsc_ring_pop(&t->ring, sizeof(span));
+
+		/* the outermost span of a thread names it in the trace */
+		if (!span.depth && !trace_thread_names.array[span.thread_id])
+			trace_thread_names.array[span.thread_id] = span.name;
+
+		deque_push_back(&trace_history, &span, sizeof(span));
+	}
+
+	trace_dropped += os_atomic_exchange_long(&t->dropped, 0);
+}
+
+/* trace_mutex must be held */
+static void trace_collect(void)
+{
+	const uint64_t now = os_gettime_ns();
+	struct trace_span span;
+
+	for (size_t i = 0; i < trace_threads.num; i++)
+		trace_drain_thread(trace_threads.array[i]);
+
+	while (trace_history.size) {
+		deque_peek_front(&trace_history, &span, sizeof(span));
+		if (trace_history.size <= TRACE_MAX_HISTORY_SPANS * sizeof(span) &&
+		    span.start + span.duration + trace_history_ns >= now)
+			break;
+
+		deque_pop_front(&trace_history, NULL, sizeof(span));
+	}
+}
+
+static void trace_free_thread(struct trace_thread *t)
+{
+	spsc_ring_free(&t->ring);
+	bfree(t);
+}
+
+static void trace_thread_exit(void *param)
+{
+	struct trace_thread *t = param;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_drain_thread(t);
+	da_erase_item(trace_threads, &t);
+	pthread_mutex_unlock(&trace_mutex);
+
+	trace_free_thread(t);
+}
+
+static void trace_key_init(void)
+{
+	trace_key_created = pthread_key_create(&trace_key, trace_thread_exit) == 0;
+}
+
+static struct trace_thread *get_trace_thread(void)
+{
+	struct trace_thread *t = thread_trace;
+	const char *no_name = NULL;
+
+	if (t)
+		return t;
+
+	pthread_once(&trace_key_once, trace_key_init);
+	if (!trace_key_created)
+		return NULL;
+
+	t = bzalloc(sizeof(struct trace_thread));
+	spsc_ring_init(&t->ring, TRACE_RING_SPANS * sizeof(struct trace_span));
+
+	pthread_mutex_lock(&trace_mutex);
+	t->id = (uint32_t)trace_thread_names.num;
+	da_push_back(trace_thread_names, &no_name);
+	da_push_back(trace_threads, &t);
+	pthread_mutex_unlock(&trace_mutex);
+
+	pthread_setspecific(trace_key, t);
+	thread_trace = t;
+	return t;
+}
+
+static void trace_push(struct trace_thread *t, const char *name, uint64_t start, uint64_t end, size_t depth)
+{
+	struct trace_span span = {
+		.name = name,
+		.start = start,
+		.duration = end - start,
+		.thread_id = t->id,
+		.depth = (uint32_t)depth,
+	};
+
+	if (spsc_ring_space(&t->ring) < sizeof(span)) {
+		os_atomic_inc_long(&t->dropped);
+		return;
+	}
+
+	spsc_ring_write(&t->ring, 0, &span, sizeof(span));
+	spsc_ring_commit(&t->ring, sizeof(span));
+}
+
+static inline struct trace_thread *trace_current_thread(void)
+{
+	struct trace_thread *t;
+	long generation;
+
+	if (!os_atomic_load_bool(&trace_enabled))
+		return NULL;
+
+	t = get_trace_thread();
+	if (!t)
+		return NULL;
+
+	/* spans opened before the last restart will never be closed */
+	generation = os_atomic_load_long(&trace_generation);
+	if (t->generation != generation) {
+		t->generation = generation;
+		t->depth = 0;
+	}
+
+	return t;
+}
+
+static inline void trace_begin(const char *name)
+{
+	struct trace_thread *t = trace_current_thread();
+	if (!t)
+		return;
+
+	if (t->depth < TRACE_STACK_DEPTH) {
+		t->stack[t->depth].name = name;
+		t->stack[t->depth].start = os_gettime_ns();
+	}
+
+	t->depth++;
+}
+
+static inline void trace_end(const char *name, uint64_t end)
+{
+	struct trace_thread *t = trace_current_thread();
+	size_t idx;
+
+	if (!t || !t->depth)
+		return;
+
+	if (t->depth > TRACE_STACK_DEPTH) {
+		t->depth--;
+		return;
+	}
+
+	for (idx = t->depth; idx > 0; idx--) {
+		if (t->stack[idx - 1].name == name)
+			break;
+	}
+
+	if (!idx)
+		return;
+
+	/* like profile_end, close anything left open inside of it */
+	while (t->depth >= idx) {
+		t->depth--;
+		trace_push(t, t->stack[t->depth].name, t->stack[t->depth].start, end, t->depth);
+	}
+}
+
+static inline void trace_record(const char *name, uint64_t duration_ns)
+{
+	struct trace_thread *t = trace_current_thread();
+	uint64_t end;
+
+	if (!t)
+		return;
+
+	end = os_gettime_ns();
+	trace_push(t, name, end - duration_ns, end, t->depth);
+}
+
+static void *trace_collector_thread(void *param)
+{
+	os_set_thread_name("profiler: trace collector");
+
+	while (os_event_timedwait(trace_stop_event, TRACE_COLLECT_INTERVAL_MS) == ETIMEDOUT) {
+		pthread_mutex_lock(&trace_mutex);
+		trace_collect();
+		pthread_mutex_unlock(&trace_mutex);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+void profiler_trace_start(uint32_t history_seconds)
+{
+	pthread_mutex_lock(&trace_mutex);
+
+	trace_history_ns = (uint64_t)history_seconds * 1000000000ULL;
+	deque_free(&trace_history);
+	trace_dropped = 0;
+
+	if (!trace_collector_active) {
+		if (os_event_init(&trace_stop_event, OS_EVENT_TYPE_MANUAL) != 0) {
+			blog(LOG_WARNING, "profiler_trace_start: Failed to create stop event");
+		} else if (pthread_create(&trace_collector, NULL, trace_collector_thread, NULL) != 0) {
+			blog(LOG_WARNING, "profiler_trace_start: Failed to create collector thread");
+			os_event_destroy(trace_stop_event);
+			trace_stop_event = NULL;
+		} else {
+			trace_collector_active = true;
+		}
+	}
+
+	os_atomic_inc_long(&trace_generation);
+	os_atomic_set_bool(&trace_enabled, trace_collector_active);
+
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+void profiler_trace_stop(void)
+{
+	bool active;
+
+	os_atomic_set_bool(&trace_enabled, false);
+
+	pthread_mutex_lock(&trace_mutex);
+	active = trace_collector_active;
+	trace_collector_active = false;
+	pthread_mutex_unlock(&trace_mutex);
+
+	if (!active)
+		return;
+
+	os_event_signal(trace_stop_event);
+	pthread_join(trace_collector, NULL);
+	os_event_destroy(trace_stop_event);
+	trace_stop_event = NULL;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_collect();
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+static void trace_write_string(FILE *f, const char *str)
+{
+	for (const unsigned char *c = (const unsigned char *)(str ? str : ""); *c; c++) {
+		if (*c == '"' || *c == '\\')
+			fprintf(f, "\\%c", *c);
+		else if (*c < 0x20)
+			fprintf(f, "\\u%04x", *c);
+		else
+			fputc(*c, f);
+	}
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	DARRAY(const char *) names = {0};
+	struct trace_span *spans = NULL;
+	size_t num_spans;
+	uint64_t base = UINT64_MAX;
+	long dropped;
+	FILE *f;
+
+	f = os_fopen(filename, "wb");
+	if (!f)
+		return false;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_collect();
+	num_spans = trace_history.size / sizeof(struct trace_span);
+	if (num_spans) {
+		spans = bmalloc(trace_history.size);
+		deque_peek_front(&trace_history, spans, trace_history.size);
+	}
+	da_copy(names, trace_thread_names);
+	dropped = trace_dropped;
+	pthread_mutex_unlock(&trace_mutex);
+
+	for (size_t i = 0; i < num_spans; i++)
+		base = spans[i].start < base ? spans[i].start : base;
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+
+	for (size_t i = 0; i < names.num; i++) {
+		fprintf(f, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"",
+			i ? "," : "", i);
+		if (names.array[i])
+			trace_write_string(f, names.array[i]);
+		else
+			fprintf(f, "thread %zu", i);
+		fputs("\"}}", f);
+	}
+
+	for (size_t i = 0; i < num_spans; i++) {
+		const struct trace_span *span = &spans[i];
+
+		fputs(i || names.num ? ",\n{\"ph\":\"X\",\"name\":\"" : "\n{\"ph\":\"X\",\"name\":\"", f);
+		trace_write_string(f, span->name);
+		fprintf(f, "\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%.3f,\"dur\":%.3f}", span->thread_id,
+			(span->start - base) / 1000.0, span->duration / 1000.0);
+	}
+
+	fputs("\n]}\n", f);
+
+	if (dropped)
+		blog(LOG_WARNING, "profiler_trace_dump_json: %ld spans were dropped", dropped);
+
+	bfree(spans);
+	da_free(names);
+	return fclose(f) == 0;
+}
+
+static void trace_free(void)
+{
+	profiler_trace_stop();
+
+	pthread_mutex_lock(&trace_mutex);
+	for (size_t i = 0; i < trace_threads.num; i++)
+		trace_free_thread(trace_threads.array[i]);
+	da_free(trace_threads);
+	da_free(trace_thread_names);
+	deque_free(&trace_history);
+	pthread_mutex_unlock(&trace_mutex);
+
+	/* threads still alive must not free their ring again on exit */
+	if (trace_key_created)
+		pthread_key_delete(trace_key);
+	trace_key_created = false;
+	thread_trace = NULL;
+}
+
 void profile_start(const char *name)
 {
+	trace_begin(name);
+
 	if (!thread_enabled)
 		return;
 
@@ -385,6 +778,8 @@ void profile_start(const char *name)
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
+	trace_end(name, end);
+
 	if (!thread_enabled)
 		return;
 
@@ -429,6 +824,35 @@ void profile_end(const char *name)
 	merge_context(call);
 }
 
+void profile_record(const char *name, uint64_t duration_ns)
+{
+	trace_record(name, duration_ns);
+
+	if (!thread_enabled)
+		return;
+
+	const uint64_t end = os_gettime_ns();
+	profile_call new_call = {
+		.name = name,
+#ifdef TRACK_OVERHEAD
+		.overhead_start = end,
+		.overhead_end = end,
+#endif
+		.start_time = end - duration_ns,
+		.end_time = end,
+		.parent = thread_context,
+	};
+
+	if (new_call.parent) {
+		da_push_back(new_call.parent->children, &new_call);
+		return;
+	}
+
+	profile_call *call = bmalloc(sizeof(profile_call));
+	memcpy(call, &new_call, sizeof(profile_call));
+	merge_context(call);
+}
+
 static int profiler_time_entry_compare(const void *first, const void *second)
 {
 	int64_t diff = ((profiler_time_entry *)second)->time_delta - ((profiler_time_entry *)first)->time_delta;
@@ -768,6 +1192,8 @@ void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
 
+	trace_free();
+
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
 	da_move(old_root_entries, root_entries);
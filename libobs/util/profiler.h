@@ -19,6 +19,10 @@ EXPORT void profile_register_root(const char *name, uint64_t expected_time_betwe
 EXPORT void profile_start(const char *name);
 EXPORT void profile_end(const char *name);
 
+/* Records an externally measured duration as if it were a profile_start/
+ * profile_end pair ending now, e.g. for timing errors rather than spans */
+EXPORT void profile_record(const char *name, uint64_t duration_ns);
+
 EXPORT void profile_reenable_thread(void);
 
 /* ------------------------------------------------------------------------- */
@@ -32,6 +36,15 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* Records every profiled span into per-thread rings and keeps the last
+ * history_seconds of them, independently of profiler_start */
+EXPORT void profiler_trace_start(uint32_t history_seconds);
+EXPORT void profiler_trace_stop(void);
+
+/* Writes the recorded history in the Chrome trace event format, which
+ * chrome://tracing and Perfetto can open */
+EXPORT bool profiler_trace_dump_json(const char *filename);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
@@ -93,6 +93,10 @@ static bool gpu_enabled = false;
 /* These can be set from other threads, mark them volatile */
 static volatile bool enable_next = false;
 static volatile bool gpu_enable_next = false;
+static volatile long lag_offenders = 0;
+
+/* Frames until the samples of the last lagged frame are collected */
+static uint8_t lag_report_frames = 0;
 
 void ucirclebuf_init(struct ucirclebuf *buf, size_t capacity)
 {
@@ -122,6 +126,11 @@ void ucirclebuf_push(struct ucirclebuf *buf, uint64_t val)
 	buf->num++;
 }
 
+static inline uint64_t ucirclebuf_last(const struct ucirclebuf *buf)
+{
+	return buf->num ? buf->array[buf->idx - 1] : 0;
+}
+
 static struct frame_sample *frame_sample_create(void)
 {
 	struct frame_sample *smp = bzalloc(sizeof(struct frame_sample));
@@ -230,6 +239,11 @@ void source_profiler_gpu_enable(bool enable)
 	gpu_enable_next = enable && enable_next;
 }
 
+void source_profiler_log_lag_offenders(size_t top_n)
+{
+	os_atomic_set_long(&lag_offenders, (long)top_n);
+}
+
 void source_profiler_reset_video(struct obs_video_info *ovi)
 {
 	double fps = ceil((double)ovi->fps_num / (double)ovi->fps_den);
@@ -280,6 +294,74 @@ static inline bool is_async_video_source(const struct obs_source *source)
 	return (source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO;
 }
 
+struct lag_offender {
+	const obs_source_t *source;
+	uint64_t tick;
+	uint64_t render;
+	uint64_t render_gpu;
+};
+
+static int lag_offender_compare(const void *a, const void *b)
+{
+	const struct lag_offender *first = a;
+	const struct lag_offender *second = b;
+	const uint64_t first_time = first->tick + first->render;
+	const uint64_t second_time = second->tick + second->render;
+
+	return first_time < second_time ? 1 : (first_time > second_time ? -1 : 0);
+}
+
+/* Runs on the graphics thread, which is the only writer of the tick and
+ * render samples and of the hashmap itself */
+static void log_lag_offenders(void)
+{
+	DARRAY(struct lag_offender) offenders = {0};
+	size_t top_n = (size_t)os_atomic_load_long(&lag_offenders);
+	struct profiler_entry *ent, *tmp;
+
+	if (!top_n)
+		return;
+
+	HASH_ITER (hh, hm_entries, ent, tmp) {
+		struct lag_offender *offender = da_push_back_new(offenders);
+		offender->source = (const obs_source_t *)ent->key;
+		offender->tick = ucirclebuf_last(&ent->tick);
+		offender->render = ucirclebuf_last(&ent->render_cpu_sum);
+		offender->render_gpu = ucirclebuf_last(&ent->render_gpu_sum);
+	}
+
+	if (!offenders.num)
+		goto free;
+
+	qsort(offenders.array, offenders.num, sizeof(struct lag_offender), lag_offender_compare);
+	if (top_n > offenders.num)
+		top_n = offenders.num;
+
+	blog(LOG_INFO, "Graphics thread lagged, slowest sources of the frame:");
+	for (size_t i = 0; i < top_n; i++) {
+		const struct lag_offender *offender = &offenders.array[i];
+
+		blog(LOG_INFO, "\t'%s': tick %.3f ms, render %.3f ms, GPU %.3f ms",
+		     obs_source_get_name(offender->source), offender->tick / 1000000.0, offender->render / 1000000.0,
+		     offender->render_gpu / 1000000.0);
+	}
+
+free:
+	da_free(offenders);
+}
+
+void source_profiler_frame_lagged(void)
+{
+	if (!enabled || !os_atomic_load_long(&lag_offenders) || lag_report_frames)
+		return;
+
+	/* the samples of this frame are collected FRAME_BUFFER_SIZE - 1
+	 * frames from now */
+	lag_report_frames = FRAME_BUFFER_SIZE - 1;
+	if (!lag_report_frames)
+		log_lag_offenders();
+}
+
 static const char *source_profiler_frame_collect_name = "source_profiler_frame_collect";
 void source_profiler_frame_collect(void)
 {
@@ -383,6 +465,9 @@ void source_profiler_frame_collect(void)
 	if (gpu_enabled && gpu_ready)
 		gs_leave_context();
 
+	if (lag_report_frames && !--lag_report_frames)
+		log_lag_offenders();
+
 	/* Apply updated states for next frame */
 	if (!enable_next) {
 		enabled = gpu_enabled = false;
@@ -425,7 +510,13 @@ void source_profiler_source_tick_end(obs_source_t *source, uint64_t start)
 	if (!enabled)
 		return;
 
-	const uint64_t delta = os_gettime_ns() - start;
+	source_profiler_source_tick_record(source, os_gettime_ns() - start);
+}
+
+void source_profiler_source_tick_record(obs_source_t *source, uint64_t delta)
+{
+	if (!enabled)
+		return;
 
 	struct source_samples *smp = NULL;
 	HASH_FIND_PTR(hm_samples, &source, smp);
@@ -487,7 +578,7 @@ static void task_delete_source(void *key)
 		source_samples_destroy(smp);
 	}
 
-	pthread_rwlock_rdlock(&hm_rwlock);
+	pthread_rwlock_wrlock(&hm_rwlock);
 	struct profiler_entry *ent = NULL;
 	HASH_FIND_PTR(hm_entries, &key, ent);
 	if (ent) {
@@ -628,3 +719,84 @@ profiler_result_t *source_profiler_get_result(obs_source_t *source)
 	}
 	return ret;
 }
+
+static int uint64_compare(const void *a, const void *b)
+{
+	const uint64_t first = *(const uint64_t *)a;
+	const uint64_t second = *(const uint64_t *)b;
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+/* sorts values in place */
+static void calculate_percentiles(uint64_t *values, size_t num, struct profiler_percentiles *result)
+{
+	if (!num)
+		return;
+
+	qsort(values, num, sizeof(uint64_t), uint64_compare);
+	result->p50 = values[(num - 1) * 50 / 100];
+	result->p95 = values[(num - 1) * 95 / 100];
+	result->p99 = values[(num - 1) * 99 / 100];
+}
+
+static inline void calculate_buf_percentiles(const struct ucirclebuf *buf, uint64_t *scratch,
+					     struct profiler_percentiles *result)
+{
+	memcpy(scratch, buf->array, buf->num * sizeof(uint64_t));
+	calculate_percentiles(scratch, buf->num, result);
+}
+
+/* same intervals as calculate_fps */
+static void calculate_interval_percentiles(const struct ucirclebuf *frames, uint64_t *scratch,
+					   struct profiler_percentiles *result)
+{
+	size_t num = 0;
+
+	for (size_t idx = 0; idx < frames->num; idx++) {
+		const uint64_t ts = frames->array[idx];
+		if (!ts)
+			break;
+
+		size_t prev_idx = idx ? idx - 1 : frames->num - 1;
+		const uint64_t prev_ts = frames->array[prev_idx];
+		if (!prev_ts || prev_ts >= ts)
+			continue;
+
+		scratch[num++] = ts - prev_ts;
+	}
+
+	calculate_percentiles(scratch, num, result);
+}
+
+bool source_profiler_fill_percentiles(obs_source_t *source, struct profiler_result_percentiles *result)
+{
+	if (!enabled || !result)
+		return false;
+
+	memset(result, 0, sizeof(struct profiler_result_percentiles));
+
+	pthread_rwlock_rdlock(&hm_rwlock);
+
+	struct profiler_entry *ent = NULL;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent && ent->tick.capacity) {
+		uint64_t *scratch = bmalloc(ent->tick.capacity * sizeof(uint64_t));
+
+		calculate_buf_percentiles(&ent->tick, scratch, &result->tick);
+		calculate_buf_percentiles(&ent->render_cpu_sum, scratch, &result->render);
+		if (gpu_enabled)
+			calculate_buf_percentiles(&ent->render_gpu_sum, scratch, &result->render_gpu);
+
+		if (is_async_video_source(source)) {
+			calculate_interval_percentiles(&ent->async_frame_ts, scratch, &result->async_input_interval);
+			calculate_interval_percentiles(&ent->async_rendered_ts, scratch,
+						       &result->async_rendered_interval);
+		}
+
+		bfree(scratch);
+	}
+
+	pthread_rwlock_unlock(&hm_rwlock);
+
+	return !!ent;
+}
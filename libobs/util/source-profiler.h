@@ -51,6 +51,25 @@ typedef struct profiler_result {
 	uint64_t async_rendered_worst;
 } profiler_result_t;
 
+typedef struct profiler_percentiles {
+	uint64_t p50;
+	uint64_t p95;
+	uint64_t p99;
+} profiler_percentiles_t;
+
+typedef struct profiler_result_percentiles {
+	/* Tick times in ns */
+	profiler_percentiles_t tick;
+
+	/* Sum of all render passes in a frame for CPU and GPU in ns */
+	profiler_percentiles_t render;
+	profiler_percentiles_t render_gpu;
+
+	/* Time between submitted/rendered async frames in ns */
+	profiler_percentiles_t async_input_interval;
+	profiler_percentiles_t async_rendered_interval;
+} profiler_result_percentiles_t;
+
 /* Enable/disable profiler (applied on next frame) */
 EXPORT void source_profiler_enable(bool enable);
 /* Enable/disable GPU profiling (applied on next frame) */
@@ -60,6 +79,12 @@ EXPORT void source_profiler_gpu_enable(bool enable);
 EXPORT profiler_result_t *source_profiler_get_result(obs_source_t *source);
 /* Update existing profiler results object for source */
 EXPORT bool source_profiler_fill_result(obs_source_t *source, profiler_result_t *result);
+/* Fill percentiles over the same samples as source_profiler_fill_result */
+EXPORT bool source_profiler_fill_percentiles(obs_source_t *source, profiler_result_percentiles_t *result);
+
+/* Log the top_n most expensive sources of a frame whenever the graphics
+ * thread misses a frame, 0 disables */
+EXPORT void source_profiler_log_lag_offenders(size_t top_n);
 
 #ifdef __cplusplus
 }
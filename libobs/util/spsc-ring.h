@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+
+#include "bmem.h"
+#include "threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Single producer, single consumer byte ring.  The producer and consumer may
+ * run on different threads without locking; each position is only written
+ * by its own side.  Positions are free-running and the capacity is a power
+ * of two, so wrapping is a mask.  Anything written with spsc_ring_write is
+ * not visible to the consumer until spsc_ring_commit.  The two positions
+ * are kept on separate cache lines so the sides don't invalidate each other
+ * on every update. */
+
+#define RING_CACHE_LINE_SIZE 64
+
+struct spsc_ring {
+	uint8_t *data;
+	size_t capacity;
+
+	uint8_t pad0[RING_CACHE_LINE_SIZE];
+	volatile long write_pos;
+	uint8_t pad1[RING_CACHE_LINE_SIZE - sizeof(long)];
+	volatile long read_pos;
+	uint8_t pad2[RING_CACHE_LINE_SIZE - sizeof(long)];
+};
+
+static inline void spsc_ring_init(struct spsc_ring *ring, size_t min_capacity)
+{
+	size_t capacity = 1;
+
+	memset(ring, 0, sizeof(struct spsc_ring));
+	if (!min_capacity)
+		return;
+
+	while (capacity < min_capacity)
+		capacity <<= 1;
+
+	ring->data = bmalloc(capacity);
+	ring->capacity = capacity;
+}
+
+static inline void spsc_ring_free(struct spsc_ring *ring)
+{
+	bfree(ring->data);
+	memset(ring, 0, sizeof(struct spsc_ring));
+}
+
+/* bytes committed and not yet popped */
+static inline size_t spsc_ring_size(const struct spsc_ring *ring)
+{
+	unsigned long w = (unsigned long)os_atomic_load_long(&ring->write_pos);
+	unsigned long r = (unsigned long)os_atomic_load_long(&ring->read_pos);
+	return (size_t)(w - r);
+}
+
+static inline size_t spsc_ring_space(const struct spsc_ring *ring)
+{
+	return ring->capacity - spsc_ring_size(ring);
+}
+
+static inline void spsc_ring_copy_in(struct spsc_ring *ring, unsigned long pos, const void *data, size_t size)
+{
+	size_t start = (size_t)pos & (ring->capacity - 1);
+	size_t first = ring->capacity - start;
+
+	if (first > size)
+		first = size;
+
+	memcpy(ring->data + start, data, first);
+	memcpy(ring->data, (const uint8_t *)data + first, size - first);
+}
+
+static inline void spsc_ring_copy_out(const struct spsc_ring *ring, unsigned long pos, void *data, size_t size)
+{
+	size_t start = (size_t)pos & (ring->capacity - 1);
+	size_t first = ring->capacity - start;
+
+	if (first > size)
+		first = size;
+
+	memcpy(data, ring->data + start, first);
+	memcpy((uint8_t *)data + first, ring->data, size - first);
+}
+
+/* producer: writes at offset past the last committed byte, the caller must
+ * have checked spsc_ring_space */
+static inline void spsc_ring_write(struct spsc_ring *ring, size_t offset, const void *data, size_t size)
+{
+	unsigned long w = (unsigned long)ring->write_pos;
+	spsc_ring_copy_in(ring, w + (unsigned long)offset, data, size);
+}
+
+/* producer: publishes size bytes written with spsc_ring_write */
+static inline void spsc_ring_commit(struct spsc_ring *ring, size_t size)
+{
+	unsigned long w = (unsigned long)ring->write_pos;
+	os_atomic_set_long(&ring->write_pos, (long)(w + (unsigned long)size));
+}
+
+/* consumer: reads at offset past the read position without popping */
+static inline void spsc_ring_peek(const struct spsc_ring *ring, size_t offset, void *data, size_t size)
+{
+	unsigned long r = (unsigned long)ring->read_pos;
+	spsc_ring_copy_out(ring, r + (unsigned long)offset, data, size);
+}
+
+/* consumer */
+static inline void spsc_ring_pop(struct spsc_ring *ring, size_t size)
+{
+	unsigned long r = (unsigned long)ring->read_pos;
+	os_atomic_set_long(&ring->read_pos, (long)(r + (unsigned long)size));
+}
+
+/* consumer: drops everything committed so far */
+static inline void spsc_ring_clear(struct spsc_ring *ring)
+{
+	os_atomic_set_long(&ring->read_pos, os_atomic_load_long(&ring->write_pos));
+}
+
+#ifdef __cplusplus
+}
+#endif
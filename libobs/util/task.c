@@ -1,19 +1,36 @@
 #include "task.h"
 #include "bmem.h"
 #include "threading.h"
+#include "platform.h"
+#include "darray.h"
 #include "deque.h"
 
-struct os_task_queue {
-	pthread_t thread;
-	os_sem_t *sem;
-	long id;
+#define PRIORITY_COUNT (OS_TASK_PRIORITY_HIGH + 1)
+#define MIN_POOL_THREADS 2
+#define MAX_POOL_THREADS 16
+
+/* a queue gives up its worker after this many tasks so the queues sharing
+ * a priority take turns */
+#define QUEUE_BATCH_SIZE 32
 
-	bool waiting;
-	bool tasks_processed;
-	os_event_t *wait_event;
+struct os_task_queue {
+	char *name;
+	enum os_task_priority priority;
 
 	pthread_mutex_t mutex;
 	struct deque tasks;
+	long completed;
+
+	/* only one thread drains a queue at a time, which keeps its tasks in
+	 * order.  `pool` is the pool whose ready list holds the queue, and is
+	 * protected by that pool's mutex rather than the queue's */
+	bool running;
+	struct task_pool *pool;
+	os_event_t *idle_event;
+
+	/* a dedicated queue has a pool of its own with one thread, for tasks
+	 * that can block: they would hold up a shared worker meanwhile */
+	struct task_pool *own_pool;
 };
 
 struct os_task_info {
@@ -21,39 +38,322 @@ struct os_task_info {
 	void *param;
 };
 
-static THREAD_LOCAL bool exit_thread = false;
-static THREAD_LOCAL long thread_id = 0;
-static volatile long thread_id_counter = 1;
+/* a pool entry is either a loose task or a queue that has tasks; an entry
+ * with neither was taken over by a thread waiting on its queue */
+struct pool_item {
+	os_task_t task;
+	void *param;
+	os_task_queue_t *queue;
+};
+
+struct task_pool {
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	struct deque ready[PRIORITY_COUNT];
+	DARRAY(pthread_t) threads;
+	bool stopping;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct task_pool *pool = NULL;
+
+static THREAD_LOCAL struct task_pool *current_pool = NULL;
+static THREAD_LOCAL os_task_queue_t *current_queue = NULL;
+static THREAD_LOCAL const char *current_thread_name = NULL;
+
+static void *task_pool_thread(void *param);
+
+static void task_pool_destroy(struct task_pool *tp)
+{
+	for (size_t i = 0; i < PRIORITY_COUNT; i++)
+		deque_free(&tp->ready[i]);
+	da_free(tp->threads);
+	os_sem_destroy(tp->sem);
+	pthread_mutex_destroy(&tp->mutex);
+	bfree(tp);
+}
+
+static struct task_pool *task_pool_create(int count)
+{
+	struct task_pool *tp = bzalloc(sizeof(*tp));
+
+	if (pthread_mutex_init(&tp->mutex, NULL) != 0) {
+		bfree(tp);
+		return NULL;
+	}
+	if (os_sem_init(&tp->sem, 0) != 0) {
+		pthread_mutex_destroy(&tp->mutex);
+		bfree(tp);
+		return NULL;
+	}
+
+	for (int i = 0; i < count; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, task_pool_thread, tp) != 0)
+			break;
+		da_push_back(tp->threads, &thread);
+	}
+
+	if (!tp->threads.num) {
+		task_pool_destroy(tp);
+		return NULL;
+	}
+
+	return tp;
+}
+
+static struct task_pool *get_pool(void)
+{
+	struct task_pool *tp;
+
+	pthread_mutex_lock(&pool_mutex);
+	if (!pool) {
+		int count = os_get_logical_cores();
+		if (count < MIN_POOL_THREADS)
+			count = MIN_POOL_THREADS;
+		if (count > MAX_POOL_THREADS)
+			count = MAX_POOL_THREADS;
+
+		pool = task_pool_create(count);
+	}
+	tp = pool;
+	pthread_mutex_unlock(&pool_mutex);
 
-static void *tiny_tubular_task_thread(void *param);
+	return tp;
+}
+
+static bool task_pool_push(struct task_pool *tp, const struct pool_item *item, enum os_task_priority priority)
+{
+	if (!tp)
+		return false;
+
+	pthread_mutex_lock(&tp->mutex);
+	deque_push_back(&tp->ready[priority], item, sizeof(*item));
+	if (item->queue)
+		item->queue->pool = tp;
+	pthread_mutex_unlock(&tp->mutex);
+
+	os_sem_post(tp->sem);
+	return true;
+}
+
+static inline struct task_pool *queue_pool(os_task_queue_t *tq)
+{
+	return tq->own_pool ? tq->own_pool : get_pool();
+}
+
+static bool task_pool_pop(struct task_pool *tp, struct pool_item *item)
+{
+	pthread_mutex_lock(&tp->mutex);
+	for (size_t i = PRIORITY_COUNT; i > 0; i--) {
+		struct deque *ready = &tp->ready[i - 1];
+
+		while (ready->size) {
+			deque_pop_front(ready, item, sizeof(*item));
+			if (item->queue)
+				item->queue->pool = NULL;
+			if (item->queue || item->task) {
+				pthread_mutex_unlock(&tp->mutex);
+				return true;
+			}
+		}
+	}
+	pthread_mutex_unlock(&tp->mutex);
+
+	return false;
+}
+
+/* takes the queue out of the ready list so the caller can run it, called
+ * with the queue mutex held */
+static bool task_pool_claim(os_task_queue_t *tq)
+{
+	struct task_pool *tp = tq->own_pool;
+	bool claimed = false;
+
+	if (!tp) {
+		pthread_mutex_lock(&pool_mutex);
+		tp = pool;
+		pthread_mutex_unlock(&pool_mutex);
+	}
+
+	if (!tp)
+		return false;
+
+	pthread_mutex_lock(&tp->mutex);
+	if (tq->pool == tp) {
+		struct deque *ready = &tp->ready[tq->priority];
+		size_t count = ready->size / sizeof(struct pool_item);
+
+		for (size_t i = 0; i < count; i++) {
+			struct pool_item *item = deque_data(ready, i * sizeof(struct pool_item));
+			if (item->queue == tq) {
+				item->queue = NULL;
+				tq->pool = NULL;
+				claimed = true;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&tp->mutex);
+
+	return claimed;
+}
+
+static void set_worker_name(const char *name)
+{
+	if (name != current_thread_name) {
+		os_set_thread_name(name);
+		current_thread_name = name;
+	}
+}
+
+/* called with the queue mutex held, which is held again on return */
+static void run_queue_tasks(os_task_queue_t *tq)
+{
+	os_task_queue_t *prev_queue = current_queue;
+
+	if (tq->name)
+		set_worker_name(tq->name);
+
+	current_queue = tq;
+	tq->running = true;
+
+	for (size_t i = 0; tq->tasks.size; i++) {
+		struct os_task_info ti;
+
+		/* back of the ready list, so the queues sharing a priority
+		 * take turns */
+		if (i == QUEUE_BATCH_SIZE) {
+			struct pool_item item = {NULL, NULL, tq};
+			if (task_pool_push(queue_pool(tq), &item, tq->priority))
+				break;
+		}
+
+		deque_pop_front(&tq->tasks, &ti, sizeof(ti));
+		pthread_mutex_unlock(&tq->mutex);
+
+		ti.task(ti.param);
+
+		pthread_mutex_lock(&tq->mutex);
+		tq->completed++;
+	}
+
+	tq->running = false;
+	current_queue = prev_queue;
+
+	/* the event is signalled while the mutex is held so that a thread
+	 * destroying the queue knows it's done with once it gets the mutex */
+	if (!tq->tasks.size)
+		os_event_signal(tq->idle_event);
+}
+
+static void run_pool_item(const struct pool_item *item)
+{
+	if (item->queue) {
+		pthread_mutex_lock(&item->queue->mutex);
+		run_queue_tasks(item->queue);
+		pthread_mutex_unlock(&item->queue->mutex);
+	} else {
+		item->task(item->param);
+	}
+}
+
+static void *task_pool_thread(void *param)
+{
+	struct task_pool *tp = param;
+	current_pool = tp;
+
+	set_worker_name("libobs: task pool");
+
+	while (os_sem_wait(tp->sem) == 0) {
+		struct pool_item item;
+
+		pthread_mutex_lock(&tp->mutex);
+		bool stopping = tp->stopping;
+		pthread_mutex_unlock(&tp->mutex);
+
+		if (stopping)
+			break;
+
+		/* a waiting worker may have taken the item already */
+		if (task_pool_pop(tp, &item)) {
+			run_pool_item(&item);
+			set_worker_name("libobs: task pool");
+		}
+	}
+
+	return NULL;
+}
+
+static void task_pool_stop(struct task_pool *tp)
+{
+	struct pool_item item;
+
+	pthread_mutex_lock(&tp->mutex);
+	tp->stopping = true;
+	pthread_mutex_unlock(&tp->mutex);
+
+	for (size_t i = 0; i < tp->threads.num; i++)
+		os_sem_post(tp->sem);
+	for (size_t i = 0; i < tp->threads.num; i++)
+		pthread_join(tp->threads.array[i], NULL);
+
+	/* anything left over still gets run so no task is lost */
+	while (task_pool_pop(tp, &item))
+		run_pool_item(&item);
+
+	task_pool_destroy(tp);
+}
+
+/* ------------------------------------------------------------------------- */
 
 os_task_queue_t *os_task_queue_create(void)
+{
+	return os_task_queue_create_named(NULL, OS_TASK_PRIORITY_NORMAL);
+}
+
+os_task_queue_t *os_task_queue_create_named(const char *name, enum os_task_priority priority)
 {
 	struct os_task_queue *tq = bzalloc(sizeof(*tq));
-	tq->id = os_atomic_inc_long(&thread_id_counter);
+
+	if (priority < OS_TASK_PRIORITY_LOW || priority > OS_TASK_PRIORITY_HIGH)
+		priority = OS_TASK_PRIORITY_NORMAL;
+
+	tq->name = name ? bstrdup(name) : NULL;
+	tq->priority = priority;
 
 	if (pthread_mutex_init(&tq->mutex, NULL) != 0)
 		goto fail1;
-	if (os_sem_init(&tq->sem, 0) != 0)
+	if (os_event_init(&tq->idle_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail2;
-	if (os_event_init(&tq->wait_event, OS_EVENT_TYPE_AUTO) != 0)
-		goto fail3;
-	if (pthread_create(&tq->thread, NULL, tiny_tubular_task_thread, tq) != 0)
-		goto fail4;
 
+	os_event_signal(tq->idle_event);
 	return tq;
 
-fail4:
-	os_event_destroy(tq->wait_event);
-fail3:
-	os_sem_destroy(tq->sem);
 fail2:
 	pthread_mutex_destroy(&tq->mutex);
 fail1:
+	bfree(tq->name);
 	bfree(tq);
 	return NULL;
 }
 
+os_task_queue_t *os_task_queue_create_dedicated(const char *name, enum os_task_priority priority)
+{
+	struct os_task_queue *tq = os_task_queue_create_named(name, priority);
+
+	if (!tq)
+		return NULL;
+
+	tq->own_pool = task_pool_create(1);
+	if (!tq->own_pool) {
+		os_task_queue_destroy(tq);
+		return NULL;
+	}
+
+	return tq;
+}
+
 bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
 {
 	struct os_task_info ti = {
@@ -66,99 +366,116 @@ bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
 
 	pthread_mutex_lock(&tq->mutex);
 	deque_push_back(&tq->tasks, &ti, sizeof(ti));
-	pthread_mutex_unlock(&tq->mutex);
-	os_sem_post(tq->sem);
-	return true;
-}
 
-static void wait_for_thread(void *data)
-{
-	os_task_queue_t *tq = data;
-	os_event_signal(tq->wait_event);
-}
+	/* a running queue picks up new tasks by itself, and a queue with
+	 * earlier tasks is already in the ready list */
+	if (!tq->running && tq->tasks.size == sizeof(ti)) {
+		struct pool_item item = {NULL, NULL, tq};
 
-static void stop_thread(void *unused)
-{
-	exit_thread = true;
-	UNUSED_PARAMETER(unused);
+		os_event_reset(tq->idle_event);
+
+		/* without a pool the tasks still have to run */
+		if (!task_pool_push(queue_pool(tq), &item, tq->priority))
+			run_queue_tasks(tq);
+	}
+
+	pthread_mutex_unlock(&tq->mutex);
+	return true;
 }
 
-void os_task_queue_destroy(os_task_queue_t *tq)
+/* a queue that waits for a worker while the caller blocks on it could end
+ * up waiting behind the caller, so the caller runs it instead.  only the
+ * queue being waited on is run here: running anything else could put a
+ * task this thread already depends on below one that depends on it */
+static void wait_for_queue(os_task_queue_t *tq)
 {
-	if (!tq)
-		return;
+	for (;;) {
+		pthread_mutex_lock(&tq->mutex);
+		if (!tq->running && tq->tasks.size && task_pool_claim(tq))
+			run_queue_tasks(tq);
+		pthread_mutex_unlock(&tq->mutex);
 
-	os_task_queue_queue_task(tq, stop_thread, NULL);
-	pthread_join(tq->thread, NULL);
-	os_event_destroy(tq->wait_event);
-	os_sem_destroy(tq->sem);
-	pthread_mutex_destroy(&tq->mutex);
-	deque_free(&tq->tasks);
-	bfree(tq);
+		if (os_event_timedwait(tq->idle_event, 1) == 0)
+			break;
+	}
 }
 
 bool os_task_queue_wait(os_task_queue_t *tq)
 {
+	bool pending;
+	long completed;
+
 	if (!tq)
 		return false;
 
-	struct os_task_info ti = {
-		wait_for_thread,
-		tq,
-	};
-
 	pthread_mutex_lock(&tq->mutex);
-	tq->waiting = true;
-	tq->tasks_processed = false;
-	deque_push_back(&tq->tasks, &ti, sizeof(ti));
+	pending = tq->running || tq->tasks.size;
+	completed = tq->completed;
 	pthread_mutex_unlock(&tq->mutex);
 
-	os_sem_post(tq->sem);
-	os_event_wait(tq->wait_event);
+	if (!pending)
+		return false;
 
+	if (current_pool)
+		wait_for_queue(tq);
+	else
+		os_event_wait(tq->idle_event);
+
+	/* the worker signals while holding the mutex, so once this is taken
+	 * it's done with the queue.  signalling again passes the wakeup on to
+	 * the next thread waiting on the queue, if any */
 	pthread_mutex_lock(&tq->mutex);
-	bool tasks_processed = tq->tasks_processed;
+	bool tasks_processed = tq->completed != completed;
+	if (!tq->running && !tq->tasks.size)
+		os_event_signal(tq->idle_event);
 	pthread_mutex_unlock(&tq->mutex);
 
 	return tasks_processed;
 }
 
+void os_task_queue_destroy(os_task_queue_t *tq)
+{
+	if (!tq)
+		return;
+
+	os_task_queue_wait(tq);
+
+	if (tq->own_pool)
+		task_pool_stop(tq->own_pool);
+
+	os_event_destroy(tq->idle_event);
+	pthread_mutex_destroy(&tq->mutex);
+	deque_free(&tq->tasks);
+	bfree(tq->name);
+	bfree(tq);
+}
+
 bool os_task_queue_inside(os_task_queue_t *tq)
 {
-	return tq->id == thread_id;
+	return tq && current_queue == tq;
 }
 
-static void *tiny_tubular_task_thread(void *param)
+bool os_task_pool_queue_task(enum os_task_priority priority, os_task_t task, void *param)
 {
-	struct os_task_queue *tq = param;
-	thread_id = tq->id;
+	struct pool_item item = {task, param, NULL};
 
-	os_set_thread_name(__FUNCTION__);
+	if (!task)
+		return false;
+	if (priority < OS_TASK_PRIORITY_LOW || priority > OS_TASK_PRIORITY_HIGH)
+		priority = OS_TASK_PRIORITY_NORMAL;
 
-	while (!exit_thread && os_sem_wait(tq->sem) == 0) {
-		struct os_task_info ti;
+	return task_pool_push(get_pool(), &item, priority);
+}
 
-		pthread_mutex_lock(&tq->mutex);
-		deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		if (tq->tasks.size && ti.task == wait_for_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		}
-		if (tq->tasks.size && ti.task == stop_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		}
-		if (tq->waiting) {
-			if (ti.task == wait_for_thread) {
-				tq->waiting = false;
-			} else {
-				tq->tasks_processed = true;
-			}
-		}
-		pthread_mutex_unlock(&tq->mutex);
+void os_task_pool_free(void)
+{
+	struct task_pool *tp;
 
-		ti.task(ti.param);
-	}
+	pthread_mutex_lock(&pool_mutex);
+	tp = pool;
+	pool = NULL;
+	pthread_mutex_unlock(&pool_mutex);
 
-	return NULL;
+	if (tp)
+		task_pool_stop(tp);
 }
@@ -11,12 +11,29 @@ typedef struct os_task_queue os_task_queue_t;
 
 typedef void (*os_task_t)(void *param);
 
+enum os_task_priority {
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_HIGH,
+};
+
+/* Task queues run their tasks one at a time and in order, on a pool of
+ * worker threads shared by every queue */
 EXPORT os_task_queue_t *os_task_queue_create(void);
+EXPORT os_task_queue_t *os_task_queue_create_named(const char *name, enum os_task_priority priority);
+/* Like os_task_queue_create_named, but the queue keeps a thread of its own
+ * rather than using the shared pool.  For tasks that can block, such as on
+ * another queue or on something outside libobs */
+EXPORT os_task_queue_t *os_task_queue_create_dedicated(const char *name, enum os_task_priority priority);
 EXPORT bool os_task_queue_queue_task(os_task_queue_t *tt, os_task_t task, void *param);
 EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* Runs a task on the shared pool with no ordering relative to other tasks */
+EXPORT bool os_task_pool_queue_task(enum os_task_priority priority, os_task_t task, void *param);
+EXPORT void os_task_pool_free(void);
+
 #ifdef __cplusplus
 }
 #endif
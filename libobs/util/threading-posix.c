@@ -28,10 +28,17 @@
 
 #if defined(__FreeBSD__)
 #include <pthread_np.h>
+#include <sys/cpuset.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <stdio.h>
 #endif
 
 #include "bmem.h"
 #include "threading.h"
+#include "platform.h"
 
 struct os_event_data {
 	pthread_mutex_t mutex;
@@ -271,3 +278,87 @@ void os_set_thread_name(const char *name)
 	}
 #endif
 }
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#if defined(__FreeBSD__)
+typedef cpuset_t os_native_cpu_set_t;
+#else
+typedef cpu_set_t os_native_cpu_set_t;
+#endif
+
+#define NATIVE_MAX_CPUS (CPU_SETSIZE < OS_MAX_CPUS ? CPU_SETSIZE : OS_MAX_CPUS)
+
+bool os_set_thread_affinity(const struct os_cpu_set *set)
+{
+	os_native_cpu_set_t native;
+	bool empty = os_cpu_set_empty(set);
+
+	CPU_ZERO(&native);
+
+	/* the kernel drops CPUs that are outside of the cpuset of the
+	 * process, so asking for all of them resets the affinity */
+	for (uint32_t cpu = 0; cpu < NATIVE_MAX_CPUS; cpu++) {
+		if (empty || os_cpu_set_has(set, cpu))
+			CPU_SET(cpu, &native);
+	}
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(native), &native) == 0;
+}
+
+bool os_get_thread_affinity(struct os_cpu_set *set)
+{
+	os_native_cpu_set_t native;
+
+	memset(set, 0, sizeof(*set));
+	if (pthread_getaffinity_np(pthread_self(), sizeof(native), &native) != 0)
+		return false;
+
+	for (uint32_t cpu = 0; cpu < NATIVE_MAX_CPUS; cpu++) {
+		if (CPU_ISSET(cpu, &native))
+			os_cpu_set_add(set, cpu);
+	}
+	return true;
+}
+#else
+bool os_set_thread_affinity(const struct os_cpu_set *set)
+{
+	UNUSED_PARAMETER(set);
+	return false;
+}
+
+bool os_get_thread_affinity(struct os_cpu_set *set)
+{
+	memset(set, 0, sizeof(*set));
+	return false;
+}
+#endif
+
+bool os_get_numa_node_cpus(uint32_t node, struct os_cpu_set *set)
+{
+#if defined(__linux__)
+	char path[64];
+	char *cpu_list;
+	bool success;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+
+	cpu_list = os_quick_read_utf8_file(path);
+	if (!cpu_list) {
+		memset(set, 0, sizeof(*set));
+		return false;
+	}
+
+	/* the file ends with a newline */
+	char *end = strchr(cpu_list, '\n');
+	if (end)
+		*end = 0;
+
+	success = os_cpu_set_parse(set, cpu_list) && !os_cpu_set_empty(set);
+	bfree(cpu_list);
+	return success;
+#else
+	UNUSED_PARAMETER(node);
+	memset(set, 0, sizeof(*set));
+	return false;
+#endif
+}
@@ -210,3 +210,54 @@ void os_set_thread_name(const char *name)
 		FreeLibrary(hModule);
 	}
 }
+
+/* A thread only runs within one processor group, so a set that spans
+ * several groups is trimmed to the lowest group it uses. */
+bool os_set_thread_affinity(const struct os_cpu_set *set)
+{
+	GROUP_AFFINITY affinity = {0};
+
+	if (os_cpu_set_empty(set)) {
+		DWORD_PTR process_mask, system_mask;
+
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+			return false;
+		return SetThreadAffinityMask(GetCurrentThread(), process_mask) != 0;
+	}
+
+	for (WORD group = 0; group < OS_MAX_CPUS / 64; group++) {
+		if (set->bits[group]) {
+			affinity.Group = group;
+			affinity.Mask = (KAFFINITY)set->bits[group];
+			break;
+		}
+	}
+
+	return !!SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+}
+
+bool os_get_thread_affinity(struct os_cpu_set *set)
+{
+	GROUP_AFFINITY affinity;
+
+	memset(set, 0, sizeof(*set));
+	if (!GetThreadGroupAffinity(GetCurrentThread(), &affinity) || affinity.Group >= OS_MAX_CPUS / 64)
+		return false;
+
+	set->bits[affinity.Group] = (uint64_t)affinity.Mask;
+	return true;
+}
+
+bool os_get_numa_node_cpus(uint32_t node, struct os_cpu_set *set)
+{
+	GROUP_AFFINITY affinity;
+
+	memset(set, 0, sizeof(*set));
+	if (node > MAXUSHORT || !GetNumaNodeProcessorMaskEx((USHORT)node, &affinity))
+		return false;
+	if (affinity.Group >= OS_MAX_CPUS / 64 || !affinity.Mask)
+		return false;
+
+	set->bits[affinity.Group] = (uint64_t)affinity.Mask;
+	return true;
+}
@@ -140,3 +140,42 @@ static inline bool os_atomic_load_bool(const volatile bool *ptr)
 
 	return b;
 }
+
+static inline void os_atomic_store_ptr(void *volatile *ptr, void *val)
+{
+#if defined(_M_ARM64)
+	_ReadWriteBarrier();
+	__stlr64((volatile unsigned __int64 *)ptr, (unsigned __int64)val);
+	_ReadWriteBarrier();
+#elif defined(_M_ARM)
+	__dmb(_ARM_BARRIER_ISH);
+	__iso_volatile_store32((volatile __int32 *)ptr, (__int32)val);
+	__dmb(_ARM_BARRIER_ISH);
+#else
+	_InterlockedExchangePointer(ptr, val);
+#endif
+}
+
+static inline void *os_atomic_exchange_ptr(void *volatile *ptr, void *val)
+{
+	return _InterlockedExchangePointer(ptr, val);
+}
+
+static inline void *os_atomic_load_ptr(void *const volatile *ptr)
+{
+#if defined(_M_ARM64)
+	void *const val = (void *)__ldar64((volatile unsigned __int64 *)ptr);
+#elif defined(_M_X64)
+	void *const val = (void *)__iso_volatile_load64((const volatile __int64 *)ptr);
+#else
+	void *const val = (void *)__iso_volatile_load32((const volatile __int32 *)ptr);
+#endif
+
+#if defined(_M_ARM)
+	__dmb(_ARM_BARRIER_ISH);
+#else
+	_ReadWriteBarrier();
+#endif
+
+	return val;
+}
@@ -92,6 +92,47 @@ EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
 
+#define OS_MAX_CPUS 1024
+
+/* set of logical CPUs, CPU n is bit n % 64 of bits[n / 64] */
+struct os_cpu_set {
+	uint64_t bits[OS_MAX_CPUS / 64];
+};
+
+static inline void os_cpu_set_add(struct os_cpu_set *set, uint32_t cpu)
+{
+	if (cpu < OS_MAX_CPUS)
+		set->bits[cpu / 64] |= 1ULL << (cpu % 64);
+}
+
+static inline bool os_cpu_set_has(const struct os_cpu_set *set, uint32_t cpu)
+{
+	return cpu < OS_MAX_CPUS && (set->bits[cpu / 64] & (1ULL << (cpu % 64))) != 0;
+}
+
+static inline bool os_cpu_set_empty(const struct os_cpu_set *set)
+{
+	for (size_t i = 0; i < OS_MAX_CPUS / 64; i++) {
+		if (set->bits[i])
+			return false;
+	}
+	return true;
+}
+
+/* Parses a comma separated list of CPUs and CPU ranges such as "0-3,8",
+ * where "node:N" stands for every CPU of NUMA node N.  An empty or NULL
+ * list gives an empty set. */
+EXPORT bool os_cpu_set_parse(struct os_cpu_set *set, const char *cpu_list);
+
+EXPORT bool os_get_numa_node_cpus(uint32_t node, struct os_cpu_set *set);
+
+/* Pins the calling thread to a set of CPUs, an empty set lets it run on any
+ * CPU of the process again.  Threads the calling thread creates afterwards
+ * inherit the set on Linux and FreeBSD, but not on Windows.  Unsupported on
+ * macOS. */
+EXPORT bool os_set_thread_affinity(const struct os_cpu_set *set);
+EXPORT bool os_get_thread_affinity(struct os_cpu_set *set);
+
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
 #else
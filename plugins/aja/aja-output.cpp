@@ -46,23 +46,6 @@ static void free_audio_data(struct audio_data *frames)
 	memset(frames, 0, sizeof(*frames));
 }
 
-static void copy_video_data(struct video_data *src, struct video_data *dst, size_t size)
-{
-	if (src->data[0]) {
-		dst->data[0] = (uint8_t *)bmemdup(src->data[0], size);
-	}
-}
-
-static void free_video_frame(struct video_data *frame)
-{
-	if (frame->data[0]) {
-		bfree(frame->data[0]);
-		frame->data[0] = NULL;
-	}
-
-	memset(frame, 0, sizeof(*frame));
-}
-
 static void update_sdi_transport_and_sdi_transport_4k(obs_properties_t *props, NTV2DeviceID device_id, IOSelection io,
 						      NTV2VideoFormat vf)
 {
@@ -130,6 +113,8 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID, const std::stri
 	  mRunThreadLock{},
 	  mVideoQueue{},
 	  mAudioQueue{},
+	  mFreeVideoBuffers{},
+	  mVideoBufferSize{0},
 	  mOBSOutput{nullptr},
 	  mCrosspoints{}
 {
@@ -139,6 +124,8 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID, const std::stri
 
 AJAOutput::~AJAOutput()
 {
+	ClearVideoQueue();
+
 	if (mVideoQueue)
 		mVideoQueue.reset();
 	if (mAudioQueue)
@@ -267,11 +254,14 @@ void AJAOutput::QueueVideoFrame(struct video_data *frame, size_t size)
 
 	if (mVideoQueue->size() > kVideoQueueMaxSize) {
 		auto &front = mVideoQueue->front();
-		free_video_frame(&front.frame);
+		release_video_frame(front);
 		mVideoQueue->pop_front();
 	}
 
-	copy_video_data(frame, &vf.frame, size);
+	if (frame->data[0]) {
+		vf.frame.data[0] = acquire_video_buffer(size);
+		memcpy(vf.frame.data[0], frame->data[0], size);
+	}
 
 	mVideoQueue->push_back(vf);
 	mVideoQueueFrames++;
@@ -303,9 +293,48 @@ void AJAOutput::ClearVideoQueue()
 	const std::lock_guard<std::mutex> lock(mVideoLock);
 	while (mVideoQueue->size() > 0) {
 		auto &vf = mVideoQueue->front();
-		free_video_frame(&vf.frame);
+		release_video_frame(vf);
 		mVideoQueue->pop_front();
 	}
+	free_video_buffers();
+}
+
+uint8_t *AJAOutput::acquire_video_buffer(size_t size)
+{
+	// a format change invalidates every recycled buffer
+	if (size != mVideoBufferSize) {
+		free_video_buffers();
+		mVideoBufferSize = size;
+	}
+
+	if (mFreeVideoBuffers.empty())
+		return (uint8_t *)bmalloc(size);
+
+	uint8_t *buffer = mFreeVideoBuffers.back();
+	mFreeVideoBuffers.pop_back();
+	return buffer;
+}
+
+void AJAOutput::release_video_frame(VideoFrame &vf)
+{
+	uint8_t *buffer = vf.frame.data[0];
+
+	if (buffer) {
+		// frames queued before a format change are freed, not recycled
+		if (vf.size == mVideoBufferSize && mFreeVideoBuffers.size() <= kVideoQueueMaxSize)
+			mFreeVideoBuffers.push_back(buffer);
+		else
+			bfree(buffer);
+	}
+
+	memset(&vf.frame, 0, sizeof(vf.frame));
+}
+
+void AJAOutput::free_video_buffers()
+{
+	for (uint8_t *buffer : mFreeVideoBuffers)
+		bfree(buffer);
+	mFreeVideoBuffers.clear();
 }
 
 void AJAOutput::ClearAudioQueue()
@@ -451,7 +480,7 @@ void AJAOutput::DMAVideoFromQueue()
 	}
 
 	if (freeFrame) {
-		free_video_frame(&vf.frame);
+		release_video_frame(vf);
 		mVideoQueue->pop_front();
 	}
 }
@@ -15,6 +15,7 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 struct VideoFrame {
 	struct video_data frame;
@@ -129,6 +130,11 @@ private:
 	uint32_t get_card_play_count();
 	void dma_audio_samples(NTV2AudioSystem audioSys, uint32_t *data, size_t size);
 
+	// video queue buffers, lock video queue before calling
+	uint8_t *acquire_video_buffer(size_t size);
+	void release_video_frame(VideoFrame &vf);
+	void free_video_buffers();
+
 	CNTV2Card *mCard;
 
 	OutputProps mOutputProps;
@@ -146,6 +152,10 @@ private:
 	std::unique_ptr<VideoQueue> mVideoQueue;
 	std::unique_ptr<AudioQueue> mAudioQueue;
 
+	// raster buffers recycled between queued frames
+	std::vector<uint8_t *> mFreeVideoBuffers;
+	size_t mVideoBufferSize;
+
 	obs_output_t *mOBSOutput;
 
 	NTV2XptConnections mCrosspoints;
@@ -106,6 +106,9 @@ struct ca_encoder {
 	vector<uint8_t> input_buffer;
 	vector<uint8_t> encode_buffer;
 
+	vector<uint8_t> batch_buffer;
+	vector<AudioStreamPacketDescription> batch_desc;
+
 	uint64_t total_samples = 0;
 	uint64_t samples_per_second = 0;
 	uint32_t priming_samples = 0;
@@ -705,6 +708,58 @@ static bool aac_encode(void *data, struct encoder_frame *frame, struct encoder_p
 
 	return true;
 }
+
+static bool aac_encode_batch(void *data, struct encoder_frame *frame, struct encoder_packet *packets,
+			     size_t *num_packets)
+{
+	ca_encoder *ca = static_cast<ca_encoder *>(data);
+	size_t capacity = *num_packets;
+
+	*num_packets = 0;
+
+	ca->input_buffer.insert(end(ca->input_buffer), frame->data[0], frame->data[0] + frame->linesize[0]);
+
+	size_t wanted = min(ca->input_buffer.size() / ca->in_bytes_required, capacity);
+	if (!wanted)
+		return true;
+
+	ca->batch_buffer.resize(ca->output_buffer_size * wanted);
+	ca->batch_desc.resize(wanted);
+
+	UInt32 out_packets = (UInt32)wanted;
+
+	AudioBufferList buffer_list = {0};
+	buffer_list.mNumberBuffers = 1;
+	buffer_list.mBuffers[0].mNumberChannels = (UInt32)ca->channels;
+	buffer_list.mBuffers[0].mDataByteSize = (UInt32)ca->batch_buffer.size();
+	buffer_list.mBuffers[0].mData = ca->batch_buffer.data();
+
+	OSStatus code = AudioConverterFillComplexBuffer(ca->converter, complex_input_data_proc, ca, &out_packets,
+							&buffer_list, ca->batch_desc.data());
+	if (code && code != 1) {
+		log_osstatus(LOG_ERROR, ca, "AudioConverterFillComplexBuffer", code);
+		return false;
+	}
+
+	for (UInt32 i = 0; i < out_packets; i++) {
+		const AudioStreamPacketDescription &desc = ca->batch_desc[i];
+		struct encoder_packet *packet = &packets[i];
+
+		packet->pts = ca->total_samples - ca->priming_samples;
+		packet->dts = ca->total_samples - ca->priming_samples;
+		packet->timebase_num = 1;
+		packet->timebase_den = (uint32_t)ca->samples_per_second;
+		packet->type = OBS_ENCODER_AUDIO;
+		packet->keyframe = true;
+		packet->size = desc.mDataByteSize;
+		packet->data = ca->batch_buffer.data() + desc.mStartOffset;
+
+		ca->total_samples += ca->in_bytes_required / ca->in_frame_size;
+	}
+
+	*num_packets = out_packets;
+	return true;
+}
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -1271,6 +1326,8 @@ bool obs_module_load(void)
 	aac_info.destroy = aac_destroy;
 	aac_info.create = aac_create;
 	aac_info.encode = aac_encode;
+	aac_info.encode_audio_batch = aac_encode_batch;
+	aac_info.caps = OBS_ENCODER_CAP_AUDIO_BATCH;
 	aac_info.get_frame_size = aac_frame_size;
 	aac_info.get_audio_info = aac_audio_info;
 	aac_info.get_extra_data = aac_extra_data;
@@ -569,12 +569,8 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 	frameQueueObsToDecklink.reset();
 
 	const int rowSize = decklinkOutput->GetWidth() * 4;
-	const int frameSize = rowSize * decklinkOutput->GetHeight();
-	for (std::vector<uint8_t> &blob : frameBlobs) {
-		blob.assign(frameSize, 0);
-		frameQueueDecklinkToObs.push(blob.data());
-	}
-	activeBlob = nullptr;
+	outputFrames.clear();
+	lastScheduledFrame = nullptr;
 
 	struct obs_video_info ovi;
 	const enum video_colorspace colorspace = obs_get_video_info(&ovi) ? ovi.colorspace : VIDEO_CS_DEFAULT;
@@ -584,7 +580,7 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 		(obs_output_get_video_conversion(decklinkOutput->GetOutput())->colorspace == VIDEO_CS_2100_PQ);
 	BMDPixelFormat pixelFormat = enable_hdr ? bmdFormat10BitRGBXLE : bmdFormat8BitBGRA;
 	const int64_t minimumPrerollFrames = std::max(device->GetMinimumPrerollFrames(), INT64_C(3));
-	for (int64_t i = 0; i < minimumPrerollFrames; ++i) {
+	for (int64_t i = 0; i < minimumPrerollFrames + (int64_t)FrameQueueFrameCount; ++i) {
 		ComPtr<IDeckLinkMutableVideoFrame> decklinkOutputFrame;
 		HRESULT result = output_->CreateVideoFrame(decklinkOutput->GetWidth(), decklinkOutput->GetHeight(),
 							   rowSize, pixelFormat, bmdFrameFlagDefault,
@@ -601,11 +597,22 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 			theFrame = decklinkOutputHDRFrame.Get();
 		}
 
+		void *bytes;
+		if (SUCCEEDED(theFrame->GetBytes(&bytes)))
+			memset(bytes, 0, (size_t)rowSize * decklinkOutput->GetHeight());
+		outputFrames.emplace_back(theFrame);
+
+		if (i >= minimumPrerollFrames) {
+			frameQueueDecklinkToObs.push(theFrame);
+			continue;
+		}
+
 		result = output_->ScheduleVideoFrame(theFrame, i * frameDuration, frameDuration, frameTimescale);
 		if (result != S_OK) {
 			blog(LOG_ERROR, "failed to schedule video frame for preroll 0x%X", result);
 			return false;
 		}
+		lastScheduledFrame = theFrame;
 	}
 	totalFramesScheduled = minimumPrerollFrames;
 
@@ -634,6 +641,8 @@ bool DeckLinkDeviceInstance::StopOutput()
 	renderDelegate.Clear();
 	frameQueueDecklinkToObs.reset();
 	frameQueueObsToDecklink.reset();
+	lastScheduledFrame = nullptr;
+	outputFrames.clear();
 
 	return true;
 }
@@ -644,35 +653,48 @@ void DeckLinkDeviceInstance::UpdateVideoFrame(video_data *frame)
 	if (decklinkOutput == nullptr)
 		return;
 
-	uint8_t *const blob = frameQueueDecklinkToObs.pop();
-	if (blob) {
-		memcpy(blob, frame->data[0], frame->linesize[0] * decklinkOutput->GetHeight());
-		frameQueueObsToDecklink.push(blob);
-	}
-}
+	IDeckLinkVideoFrame *const outputFrame = frameQueueDecklinkToObs.pop();
+	if (!outputFrame)
+		return;
 
-void DeckLinkDeviceInstance::ScheduleVideoFrame(IDeckLinkVideoFrame *frame)
-{
 	void *bytes;
-	if (SUCCEEDED(frame->GetBytes(&bytes))) {
-		uint8_t *blob = frameQueueObsToDecklink.pop();
-		if (blob) {
-			if (activeBlob)
-				frameQueueDecklinkToObs.push(activeBlob);
-			activeBlob = blob;
+	if (SUCCEEDED(outputFrame->GetBytes(&bytes))) {
+		const size_t rowBytes = (size_t)outputFrame->GetRowBytes();
+		const size_t height = (size_t)decklinkOutput->GetHeight();
+
+		if (frame->linesize[0] == rowBytes) {
+			memcpy(bytes, frame->data[0], rowBytes * height);
 		} else {
-			blob = activeBlob;
+			const size_t copyBytes = std::min(rowBytes, (size_t)frame->linesize[0]);
+			for (size_t y = 0; y < height; y++)
+				memcpy((uint8_t *)bytes + y * rowBytes, frame->data[0] + y * frame->linesize[0],
+				       copyBytes);
 		}
+	}
 
-		const int frameSize = frame->GetRowBytes() * frame->GetHeight();
-		if (blob)
-			memcpy(bytes, blob, frameSize);
-		else
-			memset(bytes, 0, frameSize);
+	frameQueueObsToDecklink.push(outputFrame);
+}
 
-		output->ScheduleVideoFrame(frame, totalFramesScheduled * frameDuration, frameDuration, frameTimescale);
-		++totalFramesScheduled;
+void DeckLinkDeviceInstance::ScheduleVideoFrame(IDeckLinkVideoFrame *frame)
+{
+	/* the completed frame goes back to OBS once a newer frame replaces
+	 * it; without one, it is refilled with the last scheduled frame, as
+	 * the completed frame is a full preroll behind */
+	IDeckLinkVideoFrame *next = frameQueueObsToDecklink.pop();
+	if (next) {
+		frameQueueDecklinkToObs.push(frame);
+	} else {
+		void *bytes;
+		void *lastBytes;
+		if (lastScheduledFrame && lastScheduledFrame != frame && SUCCEEDED(frame->GetBytes(&bytes)) &&
+		    SUCCEEDED(lastScheduledFrame->GetBytes(&lastBytes)))
+			memcpy(bytes, lastBytes, (size_t)frame->GetRowBytes() * frame->GetHeight());
+		next = frame;
 	}
+
+	output->ScheduleVideoFrame(next, totalFramesScheduled * frameDuration, frameDuration, frameTimescale);
+	lastScheduledFrame = next;
+	++totalFramesScheduled;
 }
 
 void DeckLinkDeviceInstance::WriteAudio(audio_data *frames)
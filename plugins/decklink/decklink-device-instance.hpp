@@ -70,7 +70,7 @@ private:
 
 	struct Node {
 		std::atomic<Node *> next = nullptr;
-		uint8_t *frame = nullptr;
+		IDeckLinkVideoFrame *frame = nullptr;
 	};
 
 	struct alignas(FalseSharingSize) PaddedNode {
@@ -102,7 +102,7 @@ public:
 		cache_list = &cache[0].node;
 	}
 
-	void push(uint8_t *v)
+	void push(IDeckLinkVideoFrame *v)
 	{
 		Node *const n = cache_list;
 		cache_list = cache_list->next.load(std::memory_order_relaxed);
@@ -115,9 +115,9 @@ public:
 		back = n;
 	}
 
-	uint8_t *pop()
+	IDeckLinkVideoFrame *pop()
 	{
-		uint8_t *frame = nullptr;
+		IDeckLinkVideoFrame *frame = nullptr;
 
 		Node *const n_front = front->next.load(std::memory_order_consume);
 		if (n_front != nullptr) {
@@ -157,10 +157,13 @@ protected:
 	bool allow10Bit;
 
 	OBSVideoFrame *convertFrame = nullptr;
-	std::vector<uint8_t> frameBlobs[FrameQueueFrameCount];
+	/* device frames: the preroll frames the device holds, plus
+	 * FrameQueueFrameCount frames passed between the two queues so OBS
+	 * writes straight into device memory */
+	std::vector<ComPtr<IDeckLinkVideoFrame>> outputFrames;
 	FrameQueue frameQueueObsToDecklink;
 	FrameQueue frameQueueDecklinkToObs;
-	uint8_t *activeBlob = nullptr;
+	IDeckLinkVideoFrame *lastScheduledFrame = nullptr;
 	BMDTimeValue frameDuration;
 	BMDTimeScale frameTimescale;
 	BMDTimeScale totalFramesScheduled;
@@ -1,6 +1,7 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <sys/stat.h>
@@ -24,9 +25,19 @@ struct image_source {
 	uint64_t last_time;
 	bool active;
 	bool restart_gif;
+	bool texture_stale;
+	uint32_t upload_ticks;
 	volatile bool file_decoded;
 	volatile bool texture_loaded;
 
+	/* animated images decode their frames on this queue, the graphics
+	 * thread only uploads them */
+	os_task_queue_t *frame_queue;
+	uint64_t frame_elapsed;
+	uint64_t pending_elapsed;
+	volatile bool frame_decoding;
+	volatile bool frame_decoded;
+
 	gs_image_file4_t if4;
 };
 
@@ -44,6 +55,11 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
+static inline enum gs_image_alpha_mode get_alpha_mode(struct image_source *context)
+{
+	return context->linear_alpha ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB : GS_IMAGE_ALPHA_PREMULTIPLY;
+}
+
 void image_source_preload_image(void *data)
 {
 	struct image_source *context = data;
@@ -51,8 +67,13 @@ void image_source_preload_image(void *data)
 		return;
 
 	context->file_timestamp = get_modified_timestamp(context->file);
-	gs_image_file4_init(&context->if4, context->file,
-			    context->linear_alpha ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB : GS_IMAGE_ALPHA_PREMULTIPLY);
+	gs_image_file4_init(&context->if4, context->file, get_alpha_mode(context));
+	os_atomic_set_bool(&context->file_decoded, true);
+}
+
+static void image_source_decoded(void *data)
+{
+	struct image_source *context = data;
 	os_atomic_set_bool(&context->file_decoded, true);
 }
 
@@ -72,27 +93,72 @@ static void image_source_load_texture(void *data)
 		warn("failed to load texture '%s'", context->file);
 	context->update_time_elapsed = 0;
 	os_atomic_set_bool(&context->texture_loaded, true);
+	obs_source_mark_video_changed(context->source);
+}
+
+static void decode_frame(void *data)
+{
+	struct image_source *context = data;
+
+	if (gs_image_file4_tick(&context->if4, context->frame_elapsed))
+		os_atomic_set_bool(&context->frame_decoded, true);
+	os_atomic_set_bool(&context->frame_decoding, false);
+}
+
+static void queue_frame_decode(struct image_source *context)
+{
+	if (!context->frame_queue)
+		context->frame_queue = os_task_queue_create();
+
+	context->frame_elapsed = context->pending_elapsed;
+	context->pending_elapsed = 0;
+	os_atomic_set_bool(&context->frame_decoding, true);
+	os_task_queue_queue_task(context->frame_queue, decode_frame, context);
+}
+
+static void wait_for_frame(struct image_source *context)
+{
+	if (os_atomic_load_bool(&context->frame_decoding))
+		os_task_queue_wait(context->frame_queue);
 }
 
 static void image_source_unload(void *data)
 {
 	struct image_source *context = data;
+	gs_image_file4_wait(&context->if4);
+	wait_for_frame(context);
+	os_atomic_set_bool(&context->frame_decoded, false);
+	context->pending_elapsed = 0;
+
 	os_atomic_set_bool(&context->file_decoded, false);
 	os_atomic_set_bool(&context->texture_loaded, false);
 
 	obs_enter_graphics();
 	gs_image_file4_free(&context->if4);
 	obs_leave_graphics();
+
+	obs_source_mark_video_changed(context->source);
 }
 
 static void image_source_load(struct image_source *context)
 {
 	image_source_unload(context);
 
-	if (context->file && *context->file) {
-		image_source_preload_image(context);
-		image_source_load_texture(context);
+	if (!context->file || !*context->file)
+		return;
+
+	/* loading on show or when the file changes happens on the graphics
+	 * thread, decode on the shared pool so rendering isn't stalled, tick
+	 * uploads the texture once it's done */
+	if (obs_in_task_thread(OBS_TASK_GRAPHICS)) {
+		context->file_timestamp = get_modified_timestamp(context->file);
+		gs_image_file4_init_async(&context->if4, context->file, get_alpha_mode(context), image_source_decoded,
+					  context);
+		return;
 	}
+
+	image_source_preload_image(context);
+	image_source_load_texture(context);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -147,6 +213,10 @@ static void restart_gif(void *data)
 	struct image_source *context = data;
 
 	if (context->if4.image3.image2.image.is_animated_gif) {
+		wait_for_frame(context);
+		os_atomic_set_bool(&context->frame_decoded, false);
+		context->pending_elapsed = 0;
+
 		context->if4.image3.image2.image.cur_frame = 0;
 		context->if4.image3.image2.image.cur_loop = 0;
 		context->if4.image3.image2.image.cur_time = 0;
@@ -155,6 +225,7 @@ static void restart_gif(void *data)
 		gs_image_file4_update_texture(&context->if4);
 		obs_leave_graphics();
 
+		obs_source_mark_video_changed(context->source);
 		context->restart_gif = false;
 	}
 }
@@ -179,6 +250,7 @@ static void image_source_destroy(void *data)
 	struct image_source *context = data;
 
 	image_source_unload(context);
+	os_task_queue_destroy(context->frame_queue);
 
 	if (context->file)
 		bfree(context->file);
@@ -224,14 +296,54 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_enable_framebuffer_srgb(previous);
 }
 
+static void update_animation(struct image_source *context)
+{
+	if (os_atomic_set_bool(&context->frame_decoded, false))
+		context->texture_stale = true;
+
+	/* keep the animation going, but only upload frames that
+	 * will be drawn, and at most every other tick while the
+	 * renderer is over its budget */
+	bool upload = context->texture_stale && obs_source_render_visible(context->source);
+	if (upload && obs_get_render_degradation() >= OBS_RENDER_DEGRADATION_RATE)
+		upload = (context->upload_ticks++ & 1) == 0;
+
+	if (upload) {
+		obs_enter_graphics();
+		gs_image_file4_update_texture(&context->if4);
+		obs_leave_graphics();
+
+		context->texture_stale = false;
+		obs_source_mark_video_changed(context->source);
+	}
+
+	queue_frame_decode(context);
+}
+
+/* frame of the last slide texture upload.  slideshows decode several slides
+ * ahead, which would otherwise all be uploaded in the same frame once
+ * decoded.  only accessed from the graphics thread */
+static uint64_t last_slide_upload = 0;
+
+static inline bool can_upload_slide(uint64_t frame_time)
+{
+	if (last_slide_upload == frame_time)
+		return false;
+
+	last_slide_upload = frame_time;
+	return true;
+}
+
 static void image_source_tick(void *data, float seconds)
 {
 	struct image_source *context = data;
 	if (!os_atomic_load_bool(&context->texture_loaded)) {
-		if (os_atomic_load_bool(&context->file_decoded))
-			image_source_load_texture(context);
-		else
+		if (!os_atomic_load_bool(&context->file_decoded))
+			return;
+		if (context->is_slide && !can_upload_slide(obs_get_video_frame_time()))
 			return;
+
+		image_source_load_texture(context);
 	}
 
 	uint64_t frame_time = obs_get_video_frame_time();
@@ -269,14 +381,12 @@ static void image_source_tick(void *data, float seconds)
 	}
 
 	if (context->last_time && context->if4.image3.image2.image.is_animated_gif) {
-		uint64_t elapsed = frame_time - context->last_time;
-		bool updated = gs_image_file4_tick(&context->if4, elapsed);
+		context->pending_elapsed += frame_time - context->last_time;
 
-		if (updated) {
-			obs_enter_graphics();
-			gs_image_file4_update_texture(&context->if4);
-			obs_leave_graphics();
-		}
+		/* the worker still owns the animation state while it decodes,
+		 * the elapsed time is handed to it with the next frame */
+		if (!os_atomic_load_bool(&context->frame_decoding))
+			update_animation(context);
 	}
 
 	context->last_time = frame_time;
@@ -363,7 +473,7 @@ static enum gs_color_space image_source_get_color_space(void *data, size_t count
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB | OBS_SOURCE_STATIC_VIDEO | OBS_SOURCE_CREATE_THREADSAFE,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -34,6 +37,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define INVALID_DISPLAY (-1)
 
+/* beyond this many damage rectangles the remaining ones are folded into one
+ * band, a request per rectangle would cost more than the extra rows */
+#define MAX_DAMAGE_BANDS 16
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -65,6 +72,24 @@ struct xshm_data {
 	bool use_xinerama;
 	bool use_randr;
 	bool advanced;
+
+	/* the capture thread copies the screen into the shm segment, guarded
+	 * by frame_mutex, and the tick uploads it when frame_dirty is set */
+	pthread_t capture_thread;
+	pthread_mutex_t frame_mutex;
+	bool capture_thread_active;
+	volatile bool capture_stop;
+	bool frame_dirty;
+
+	bool use_damage;
+	bool full_copy;
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+};
+
+struct damage_band {
+	int_fast32_t top;
+	int_fast32_t bottom;
 };
 
 /**
@@ -99,9 +124,214 @@ static bool xshm_check_extensions(xcb_connection_t *xcb)
 	if (!xcb_get_extension_data(xcb, &xcb_randr_id)->present)
 		blog(LOG_INFO, "Missing Randr extension !");
 
+	if (!xcb_get_extension_data(xcb, &xcb_damage_id)->present)
+		blog(LOG_INFO, "Missing Damage extension, copying the full screen every frame");
+
 	return ok;
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * @return false if the damage extension is not available
+ */
+static bool xshm_damage_init(struct xshm_data *data)
+{
+	if (!xcb_get_extension_data(data->xcb, &xcb_damage_id)->present)
+		return false;
+
+	xcb_xfixes_query_version_cookie_t xfix_c;
+	xcb_damage_query_version_cookie_t dmg_c;
+	xcb_damage_query_version_reply_t *dmg_r;
+
+	xfix_c = xcb_xfixes_query_version_unchecked(data->xcb, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+	free(xcb_xfixes_query_version_reply(data->xcb, xfix_c, NULL));
+
+	dmg_c = xcb_damage_query_version_unchecked(data->xcb, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION);
+	dmg_r = xcb_damage_query_version_reply(data->xcb, dmg_c, NULL);
+	if (!dmg_r)
+		return false;
+	free(dmg_r);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+	return true;
+}
+
+static void xshm_damage_free(struct xshm_data *data)
+{
+	if (!data->use_damage)
+		return;
+
+	xcb_damage_destroy(data->xcb, data->damage);
+	xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+	xcb_flush(data->xcb);
+	data->use_damage = false;
+}
+
+static int cmp_damage_band(const void *a, const void *b)
+{
+	const struct damage_band *band_a = a;
+	const struct damage_band *band_b = b;
+
+	if (band_a->top == band_b->top)
+		return 0;
+	return band_a->top < band_b->top ? -1 : 1;
+}
+
+/**
+ * Collect the damaged rows of the captured area since the last call
+ *
+ * Rectangles are reduced to full width row bands, sorted and merged, so
+ * each band can be read straight into its place in the shm segment.
+ *
+ * @return number of bands, 0 if nothing changed
+ */
+static size_t xshm_damage_get_bands(struct xshm_data *data, struct damage_band *bands)
+{
+	xcb_xfixes_fetch_region_cookie_t reg_c;
+	xcb_xfixes_fetch_region_reply_t *reg_r;
+	xcb_generic_event_t *event;
+	size_t count = 0;
+
+	/* damage notify events are only used to wake the server side, the
+	 * region is what matters */
+	while ((event = xcb_poll_for_event(data->xcb)))
+		free(event);
+
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE, data->damage_region);
+	reg_c = xcb_xfixes_fetch_region_unchecked(data->xcb, data->damage_region);
+	reg_r = xcb_xfixes_fetch_region_reply(data->xcb, reg_c, NULL);
+	if (!reg_r)
+		return 0;
+
+	xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reg_r);
+	int rect_count = xcb_xfixes_fetch_region_rectangles_length(reg_r);
+
+	const int_fast32_t left = data->adj_x_org;
+	const int_fast32_t right = data->adj_x_org + data->adj_width;
+	const int_fast32_t top = data->adj_y_org;
+	const int_fast32_t bottom = data->adj_y_org + data->adj_height;
+
+	for (int i = 0; i < rect_count; i++) {
+		const xcb_rectangle_t *rect = &rects[i];
+		int_fast32_t band_top = rect->y > top ? rect->y : top;
+		int_fast32_t band_bottom = rect->y + rect->height < bottom ? rect->y + rect->height : bottom;
+
+		if (rect->x >= right || rect->x + rect->width <= left || band_top >= band_bottom)
+			continue;
+
+		struct damage_band band = {band_top - top, band_bottom - top};
+		if (count < MAX_DAMAGE_BANDS) {
+			bands[count++] = band;
+			continue;
+		}
+
+		/* too many rectangles, grow the last band to cover the rest */
+		struct damage_band *last = &bands[count - 1];
+		if (band.top < last->top)
+			last->top = band.top;
+		if (band.bottom > last->bottom)
+			last->bottom = band.bottom;
+	}
+
+	free(reg_r);
+
+	if (count < 2)
+		return count;
+
+	qsort(bands, count, sizeof(*bands), cmp_damage_band);
+
+	size_t merged = 0;
+	for (size_t i = 1; i < count; i++) {
+		if (bands[i].top <= bands[merged].bottom) {
+			if (bands[i].bottom > bands[merged].bottom)
+				bands[merged].bottom = bands[i].bottom;
+		} else {
+			bands[++merged] = bands[i];
+		}
+	}
+
+	return merged + 1;
+}
+
+/**
+ * Read rows of the captured area into their place in the shm segment
+ *
+ * @note requires frame_mutex
+ */
+static bool xshm_copy_rows(struct xshm_data *data, int_fast32_t top, int_fast32_t bottom)
+{
+	xcb_shm_get_image_cookie_t img_c;
+	xcb_shm_get_image_reply_t *img_r;
+
+	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root, data->adj_x_org, data->adj_y_org + top,
+					    data->adj_width, bottom - top, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+					    data->xshm->seg, (uint32_t)(top * data->adj_width * 4));
+
+	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+	if (!img_r)
+		return false;
+
+	free(img_r);
+	return true;
+}
+
+/**
+ * Copy the screen off the graphics thread
+ *
+ * Runs once per output frame. With the damage extension only the damaged
+ * rows are read from the server, and nothing at all when the screen did
+ * not change, in which case the tick skips the texture upload as well.
+ */
+static void *xshm_capture_thread(void *vptr)
+{
+	XSHM_DATA(vptr);
+	struct damage_band bands[MAX_DAMAGE_BANDS];
+	const uint64_t interval = obs_get_frame_interval_ns();
+	uint64_t next = os_gettime_ns();
+
+	os_set_thread_name("xshm-input: capture");
+
+	while (!data->capture_stop) {
+		next += interval;
+		if (!os_sleepto_ns(next))
+			next = os_gettime_ns();
+
+		if (!obs_source_showing(data->source))
+			continue;
+
+		size_t count = 1;
+		if (data->use_damage)
+			count = xshm_damage_get_bands(data, bands);
+		if (data->full_copy || !data->use_damage) {
+			bands[0].top = 0;
+			bands[0].bottom = data->adj_height;
+			count = 1;
+		}
+		if (!count)
+			continue;
+
+		bool copied = true;
+
+		pthread_mutex_lock(&data->frame_mutex);
+		for (size_t i = 0; i < count; i++)
+			copied = xshm_copy_rows(data, bands[i].top, bands[i].bottom) && copied;
+
+		/* a failed read leaves rows behind, so the next pass rereads
+		 * the whole area */
+		data->full_copy = !copied;
+		data->frame_dirty = true;
+		pthread_mutex_unlock(&data->frame_mutex);
+	}
+
+	return NULL;
+}
+
 /**
  * Update the capture
  *
@@ -184,6 +414,12 @@ static const char *xshm_getname(void *unused)
  */
 static void xshm_capture_stop(struct xshm_data *data)
 {
+	if (data->capture_thread_active) {
+		data->capture_stop = true;
+		pthread_join(data->capture_thread, NULL);
+		data->capture_thread_active = false;
+	}
+
 	obs_enter_graphics();
 
 	if (data->texture) {
@@ -197,6 +433,9 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	if (data->xcb)
+		xshm_damage_free(data);
+
 	if (data->xshm) {
 		xshm_xcb_detach(data->xshm);
 		data->xshm = NULL;
@@ -262,6 +501,17 @@ static void xshm_capture_start(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	data->use_damage = xshm_damage_init(data);
+	data->full_copy = true;
+	data->frame_dirty = false;
+	data->capture_stop = false;
+
+	if (pthread_create(&data->capture_thread, NULL, xshm_capture_thread, data) != 0) {
+		blog(LOG_ERROR, "failed to create capture thread !");
+		goto fail;
+	}
+	data->capture_thread_active = true;
+
 	return;
 fail:
 	xshm_capture_stop(data);
@@ -465,6 +715,7 @@ static void xshm_destroy(void *vptr)
 
 	xshm_capture_stop(data);
 
+	pthread_mutex_destroy(&data->frame_mutex);
 	bfree(data);
 }
 
@@ -475,6 +726,7 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 {
 	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 	data->source = source;
+	pthread_mutex_init(&data->frame_mutex, NULL);
 
 	xshm_update(data, settings);
 
@@ -494,27 +746,21 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
-
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root, data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
-
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-
-	if (!img_r)
-		goto exit;
-
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data, data->adj_width * 4, false);
+	/* never wait for a read in progress, the frame is picked up on the
+	 * next tick instead */
+	if (pthread_mutex_trylock(&data->frame_mutex) == 0) {
+		if (data->frame_dirty) {
+			gs_texture_set_image(data->texture, (void *)data->xshm->data, data->adj_width * 4, false);
+			data->frame_dirty = false;
+		}
+		pthread_mutex_unlock(&data->frame_mutex);
+	}
+
 	xcb_xcursor_update(data->xcb, data->cursor);
 
 	obs_leave_graphics();
-
-exit:
-	free(img_r);
 }
 
 /**
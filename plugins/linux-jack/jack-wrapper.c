@@ -58,14 +58,58 @@ static enum speaker_layout jack_channels_to_obs_speakers(uint_fast32_t channels)
 	return SPEAKERS_UNKNOWN;
 }
 
-int jack_process_callback(jack_nframes_t nframes, void *arg)
+/* drift between the JACK clock and the period timestamps before the
+ * timestamps are re-anchored */
+#define TIMESTAMP_RESYNC_NS 10000000ULL
+
+/**
+ * Timestamp of the first frame of the current period
+ *
+ * Consecutive periods are timestamped from a running frame count, so they
+ * line up exactly instead of carrying the scheduling jitter of the process
+ * callback.  The anchor only moves when the estimate from the JACK cycle
+ * times drifts further than TIMESTAMP_RESYNC_NS from the frame count.
+ */
+static uint64_t jack_period_timestamp(struct jack_data *data, jack_nframes_t nframes, jack_nframes_t sample_rate)
 {
-	struct jack_data *data = (struct jack_data *)arg;
 	jack_nframes_t current_frames;
 	jack_time_t current_usecs, next_usecs;
 	float period_usecs;
-
 	uint64_t now = os_gettime_ns();
+	uint64_t timestamp;
+
+	if (!jack_get_cycle_times(data->jack_client, &current_frames, &current_usecs, &next_usecs, &period_usecs)) {
+		/* the buffer holds the period that ended when this cycle began */
+		jack_time_t jack_now = jack_get_time();
+		uint64_t since_cycle = jack_now > current_usecs ? (jack_now - current_usecs) * 1000 : 0;
+
+		timestamp = now - since_cycle - (uint64_t)(period_usecs * 1000);
+	} else {
+		timestamp = now - util_mul_div64(nframes, 1000000000ULL, sample_rate);
+		blog(LOG_WARNING, "jack_get_cycle_times error: guessing timestamp");
+	}
+
+	if (sample_rate != data->last_sample_rate) {
+		data->last_sample_rate = sample_rate;
+		data->base_timestamp = 0;
+	}
+
+	uint64_t expected = data->base_timestamp + util_mul_div64(data->total_frames, 1000000000ULL, sample_rate);
+	uint64_t diff = timestamp > expected ? timestamp - expected : expected - timestamp;
+
+	if (!data->base_timestamp || diff > TIMESTAMP_RESYNC_NS) {
+		data->base_timestamp = timestamp;
+		data->total_frames = 0;
+		expected = timestamp;
+	}
+
+	data->total_frames += nframes;
+	return expected;
+}
+
+int jack_process_callback(jack_nframes_t nframes, void *arg)
+{
+	struct jack_data *data = (struct jack_data *)arg;
 
 	if (data == 0)
 		return 0;
@@ -73,7 +117,8 @@ int jack_process_callback(jack_nframes_t nframes, void *arg)
 	struct obs_source_audio out;
 	out.speakers = jack_channels_to_obs_speakers(data->channels);
 	out.samples_per_sec = jack_get_sample_rate(data->jack_client);
-	/* format is always 32 bit float for jack */
+	/* format is always 32 bit float for jack, and each port buffer is
+	 * handed to libobs as one plane without copying */
 	out.format = AUDIO_FORMAT_FLOAT_PLANAR;
 
 	for (unsigned int i = 0; i < data->channels; ++i) {
@@ -83,12 +128,7 @@ int jack_process_callback(jack_nframes_t nframes, void *arg)
 	}
 
 	out.frames = nframes;
-	if (!jack_get_cycle_times(data->jack_client, &current_frames, &current_usecs, &next_usecs, &period_usecs)) {
-		out.timestamp = now - (int64_t)(period_usecs * 1000);
-	} else {
-		out.timestamp = now - util_mul_div64(nframes, 1000000000ULL, data->samples_per_sec);
-		blog(LOG_WARNING, "jack_get_cycle_times error: guessing timestamp");
-	}
+	out.timestamp = jack_period_timestamp(data, nframes, out.samples_per_sec);
 
 	/* FIXME: this function is not realtime-safe, we should do something
 	 * about this */
@@ -130,6 +170,10 @@ int_fast32_t jack_init(struct jack_data *data)
 		}
 	}
 
+	data->base_timestamp = 0;
+	data->total_frames = 0;
+	data->last_sample_rate = 0;
+
 	if (jack_set_process_callback(data->jack_client, jack_process_callback, data) != 0) {
 		blog(LOG_ERROR, "jack_set_process_callback Error");
 		goto error;
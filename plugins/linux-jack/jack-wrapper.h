@@ -34,6 +34,11 @@ struct jack_data {
 	uint_fast32_t samples_per_sec;
 	uint_fast32_t bytes_per_frame;
 
+	/* period timestamps, only touched by the process callback */
+	uint64_t base_timestamp;
+	uint64_t total_frames;
+	jack_nframes_t last_sample_rate;
+
 	jack_client_t *jack_client;
 	jack_port_t **jack_ports;
 
@@ -24,6 +24,7 @@
 #include <glad/glad.h>
 
 #include <pipewire/pipewire.h>
+#include "pipewire-audio.h"
 #include "screencast-portal.h"
 
 #if PW_CHECK_VERSION(0, 3, 60)
@@ -50,6 +51,7 @@ bool obs_module_load(void)
 #endif
 
 	screencast_portal_load();
+	pipewire_audio_load();
 
 	return true;
 }
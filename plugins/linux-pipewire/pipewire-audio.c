@@ -0,0 +1,587 @@
+/* pipewire-audio.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "pipewire-audio.h"
+
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/utils/result.h>
+
+/* Audio capture straight from the PipeWire graph.  The stream asks for
+ * float planar samples at the OBS sample rate and channel layout, so the
+ * conversion happens once in the PipeWire adapter and libobs can take the
+ * buffers as they are, and it asks for a quantum of one audio tick so the
+ * graph does not buffer more than OBS mixes at a time. */
+
+/* drift between the device clock and the period timestamps before the
+ * timestamps are re-anchored */
+#define TIMESTAMP_RESYNC_NS 10000000ULL
+
+struct audio_node {
+	uint32_t id;
+	char *name;
+	char *description;
+};
+
+struct pipewire_audio {
+	obs_source_t *source;
+	bool capture_sink;
+
+	struct pw_thread_loop *thread_loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct spa_hook core_listener;
+	int sync_id;
+
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+	DARRAY(struct audio_node) nodes;
+
+	struct pw_stream *stream;
+	struct spa_hook stream_listener;
+	struct spa_audio_info_raw info;
+	enum audio_format format;
+	enum speaker_layout speakers;
+
+	char *target;
+
+	/* only touched from the stream's process callback */
+	uint64_t base_timestamp;
+	uint64_t total_frames;
+};
+
+static const char *media_class(const struct pipewire_audio *pwa)
+{
+	return pwa->capture_sink ? "Audio/Sink" : "Audio/Source";
+}
+
+static void free_node(struct audio_node *node)
+{
+	bfree(node->name);
+	bfree(node->description);
+}
+
+/* assumes the thread loop lock */
+static uint32_t find_target_id(struct pipewire_audio *pwa)
+{
+	if (!pwa->target || !*pwa->target)
+		return PW_ID_ANY;
+
+	for (size_t i = 0; i < pwa->nodes.num; i++) {
+		if (strcmp(pwa->nodes.array[i].name, pwa->target) == 0)
+			return pwa->nodes.array[i].id;
+	}
+
+	return PW_ID_ANY;
+}
+
+static enum speaker_layout channels_to_speakers(uint32_t channels)
+{
+	switch (channels) {
+	case 1:
+		return SPEAKERS_MONO;
+	case 2:
+		return SPEAKERS_STEREO;
+	case 3:
+		return SPEAKERS_2POINT1;
+	case 4:
+		return SPEAKERS_4POINT0;
+	case 5:
+		return SPEAKERS_4POINT1;
+	case 6:
+		return SPEAKERS_5POINT1;
+	case 8:
+		return SPEAKERS_7POINT1;
+	}
+
+	return SPEAKERS_UNKNOWN;
+}
+
+/* channel positions in the order libobs expects them for each layout */
+static void fill_positions(struct spa_audio_info_raw *info, enum speaker_layout speakers)
+{
+	static const uint32_t positions[] = {
+		SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+		SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR, SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR,
+	};
+
+	switch (speakers) {
+	case SPEAKERS_MONO:
+		info->position[0] = SPA_AUDIO_CHANNEL_MONO;
+		break;
+	case SPEAKERS_2POINT1:
+		info->position[0] = SPA_AUDIO_CHANNEL_FL;
+		info->position[1] = SPA_AUDIO_CHANNEL_FR;
+		info->position[2] = SPA_AUDIO_CHANNEL_LFE;
+		break;
+	case SPEAKERS_4POINT0:
+		info->position[0] = SPA_AUDIO_CHANNEL_FL;
+		info->position[1] = SPA_AUDIO_CHANNEL_FR;
+		info->position[2] = SPA_AUDIO_CHANNEL_FC;
+		info->position[3] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	case SPEAKERS_4POINT1:
+		info->position[0] = SPA_AUDIO_CHANNEL_FL;
+		info->position[1] = SPA_AUDIO_CHANNEL_FR;
+		info->position[2] = SPA_AUDIO_CHANNEL_FC;
+		info->position[3] = SPA_AUDIO_CHANNEL_LFE;
+		info->position[4] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	default:
+		for (uint32_t i = 0; i < info->channels && i < SPA_N_ELEMENTS(positions); i++)
+			info->position[i] = positions[i];
+		break;
+	}
+}
+
+/* timestamps follow the frame count from the first period, so consecutive
+ * periods line up exactly; the anchor only moves when the device clock has
+ * drifted away from the stream clock */
+static uint64_t period_timestamp(struct pipewire_audio *pwa, uint64_t timestamp, uint32_t frames)
+{
+	uint64_t expected = pwa->base_timestamp + util_mul_div64(pwa->total_frames, 1000000000ULL, pwa->info.rate);
+	uint64_t diff = timestamp > expected ? timestamp - expected : expected - timestamp;
+
+	if (!pwa->base_timestamp || diff > TIMESTAMP_RESYNC_NS) {
+		pwa->base_timestamp = timestamp;
+		pwa->total_frames = 0;
+		expected = timestamp;
+	}
+
+	pwa->total_frames += frames;
+	return expected;
+}
+
+static uint64_t capture_timestamp(struct pipewire_audio *pwa, uint32_t frames)
+{
+	struct pw_time t = {0};
+
+#if PW_CHECK_VERSION(0, 3, 50)
+	pw_stream_get_time_n(pwa->stream, &t, sizeof(t));
+#else
+	pw_stream_get_time(pwa->stream, &t);
+#endif
+
+	/* pw_time.now is CLOCK_MONOTONIC like os_gettime_ns, and the delay
+	 * is how long ago the first sample of this period was captured */
+	if (t.now > 0 && t.rate.denom > 0) {
+		int64_t delay_ns = t.delay * (int64_t)SPA_NSEC_PER_SEC * t.rate.num / t.rate.denom;
+		return (uint64_t)(t.now - delay_ns);
+	}
+
+	return os_gettime_ns() - util_mul_div64(frames, 1000000000ULL, pwa->info.rate);
+}
+
+static void on_process_cb(void *user_data)
+{
+	struct pipewire_audio *pwa = user_data;
+	struct pw_buffer *b = pw_stream_dequeue_buffer(pwa->stream);
+
+	if (!b)
+		return;
+
+	struct spa_buffer *buf = b->buffer;
+	const bool planar = pwa->format == AUDIO_FORMAT_FLOAT_PLANAR;
+	const uint32_t frame_size = planar ? sizeof(float) : sizeof(float) * pwa->info.channels;
+	const uint32_t planes = planar ? pwa->info.channels : 1;
+
+	if (!pwa->info.rate || !frame_size || !buf->n_datas || !buf->datas[0].data || buf->n_datas < planes)
+		goto queue;
+
+	struct obs_source_audio out = {0};
+	out.speakers = pwa->speakers;
+	out.format = pwa->format;
+	out.samples_per_sec = pwa->info.rate;
+	out.frames = buf->datas[0].chunk->size / frame_size;
+
+	for (uint32_t i = 0; i < planes && i < MAX_AV_PLANES; i++) {
+		struct spa_data *d = &buf->datas[i];
+
+		if (!d->data)
+			goto queue;
+		out.data[i] = (uint8_t *)d->data + d->chunk->offset;
+	}
+
+	if (out.frames) {
+		out.timestamp = period_timestamp(pwa, capture_timestamp(pwa, out.frames), out.frames);
+		obs_source_output_audio(pwa->source, &out);
+	}
+
+queue:
+	pw_stream_queue_buffer(pwa->stream, b);
+}
+
+static void on_param_changed_cb(void *user_data, uint32_t id, const struct spa_pod *param)
+{
+	struct pipewire_audio *pwa = user_data;
+	struct spa_audio_info_raw info = {0};
+
+	if (!param || id != SPA_PARAM_Format)
+		return;
+
+	if (spa_format_audio_raw_parse(param, &info) < 0)
+		return;
+
+	switch (info.format) {
+	case SPA_AUDIO_FORMAT_F32P:
+		pwa->format = AUDIO_FORMAT_FLOAT_PLANAR;
+		break;
+	case SPA_AUDIO_FORMAT_F32:
+		pwa->format = AUDIO_FORMAT_FLOAT;
+		break;
+	default:
+		blog(LOG_WARNING, "[pipewire-audio] Unsupported sample format %u", info.format);
+		pwa->format = AUDIO_FORMAT_UNKNOWN;
+		info.rate = 0;
+		break;
+	}
+
+	pwa->info = info;
+	pwa->speakers = channels_to_speakers(info.channels);
+	pwa->base_timestamp = 0;
+	pwa->total_frames = 0;
+
+	blog(LOG_INFO, "[pipewire-audio] Negotiated %s, %u Hz, %u channels (source: %s)",
+	     pwa->format == AUDIO_FORMAT_FLOAT_PLANAR ? "F32P" : "F32", info.rate, info.channels,
+	     obs_source_get_name(pwa->source));
+}
+
+static void on_state_changed_cb(void *user_data, enum pw_stream_state old, enum pw_stream_state state,
+				const char *error)
+{
+	struct pipewire_audio *pwa = user_data;
+
+	UNUSED_PARAMETER(old);
+
+	blog(LOG_INFO, "[pipewire-audio] Stream %s: %s (source: %s)", pw_stream_state_as_string(state),
+	     error ? error : "none", obs_source_get_name(pwa->source));
+}
+
+static const struct pw_stream_events stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.state_changed = on_state_changed_cb,
+	.param_changed = on_param_changed_cb,
+	.process = on_process_cb,
+};
+
+/* assumes the thread loop lock */
+static void destroy_stream(struct pipewire_audio *pwa)
+{
+	if (!pwa->stream)
+		return;
+
+	spa_hook_remove(&pwa->stream_listener);
+	pw_stream_disconnect(pwa->stream);
+	pw_stream_destroy(pwa->stream);
+	pwa->stream = NULL;
+}
+
+/* assumes the thread loop lock */
+static void connect_stream(struct pipewire_audio *pwa)
+{
+	struct obs_audio_info oai;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod *params[1];
+	struct spa_audio_info_raw info = {0};
+	struct pw_properties *props;
+
+	destroy_stream(pwa);
+
+	if (!pwa->core || !obs_get_audio_info(&oai))
+		return;
+
+	props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio", PW_KEY_MEDIA_CATEGORY, "Capture", PW_KEY_MEDIA_ROLE,
+				  "Production", PW_KEY_NODE_NAME, "obs-audio-capture", NULL);
+	pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", obs_get_audio_frames_per_tick(),
+			   oai.samples_per_sec);
+	if (pwa->capture_sink)
+		pw_properties_set(props, "stream.capture.sink", "true");
+	if (pwa->target && *pwa->target)
+		pw_properties_set(props, "target.object", pwa->target);
+
+	pwa->stream = pw_stream_new(pwa->core, obs_source_get_name(pwa->source), props);
+	if (!pwa->stream) {
+		blog(LOG_WARNING, "[pipewire-audio] Failed to create stream: %m");
+		return;
+	}
+
+	pw_stream_add_listener(pwa->stream, &pwa->stream_listener, &stream_events, pwa);
+
+	info.format = SPA_AUDIO_FORMAT_F32P;
+	info.rate = oai.samples_per_sec;
+	info.channels = get_audio_channels(oai.speakers);
+	fill_positions(&info, oai.speakers);
+	params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info);
+
+	enum pw_stream_flags flags = PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS;
+	pw_stream_connect(pwa->stream, PW_DIRECTION_INPUT, find_target_id(pwa), flags, params, 1);
+}
+
+static void on_global_cb(void *user_data, uint32_t id, uint32_t permissions, const char *type, uint32_t version,
+			 const struct spa_dict *props)
+{
+	struct pipewire_audio *pwa = user_data;
+	const char *class;
+	const char *name;
+	const char *description;
+
+	UNUSED_PARAMETER(permissions);
+	UNUSED_PARAMETER(version);
+
+	if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+		return;
+
+	class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+	name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+	if (!class || !name || strcmp(class, media_class(pwa)) != 0)
+		return;
+
+	description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+
+	struct audio_node *node = da_push_back_new(pwa->nodes);
+	node->id = id;
+	node->name = bstrdup(name);
+	node->description = bstrdup(description ? description : name);
+}
+
+static void on_global_remove_cb(void *user_data, uint32_t id)
+{
+	struct pipewire_audio *pwa = user_data;
+
+	for (size_t i = 0; i < pwa->nodes.num; i++) {
+		if (pwa->nodes.array[i].id == id) {
+			free_node(&pwa->nodes.array[i]);
+			da_erase(pwa->nodes, i);
+			break;
+		}
+	}
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = on_global_cb,
+	.global_remove = on_global_remove_cb,
+};
+
+static void on_core_error_cb(void *user_data, uint32_t id, int seq, int res, const char *message)
+{
+	struct pipewire_audio *pwa = user_data;
+
+	blog(LOG_ERROR, "[pipewire-audio] Error id:%u seq:%d res:%d (%s): %s", id, seq, res, spa_strerror(res),
+	     message);
+
+	pw_thread_loop_signal(pwa->thread_loop, false);
+}
+
+static void on_core_done_cb(void *user_data, uint32_t id, int seq)
+{
+	struct pipewire_audio *pwa = user_data;
+
+	if (id == PW_ID_CORE && pwa->sync_id == seq)
+		pw_thread_loop_signal(pwa->thread_loop, false);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = on_core_done_cb,
+	.error = on_core_error_cb,
+};
+
+/* obs_source_info methods */
+
+static const char *pipewire_audio_input_get_name(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return obs_module_text("PipeWireAudioInput");
+}
+
+static const char *pipewire_audio_output_get_name(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return obs_module_text("PipeWireAudioOutput");
+}
+
+static void pipewire_audio_destroy(void *data)
+{
+	struct pipewire_audio *pwa = data;
+
+	if (pwa->thread_loop)
+		pw_thread_loop_stop(pwa->thread_loop);
+
+	destroy_stream(pwa);
+
+	if (pwa->registry) {
+		spa_hook_remove(&pwa->registry_listener);
+		pw_proxy_destroy((struct pw_proxy *)pwa->registry);
+	}
+
+	if (pwa->core) {
+		spa_hook_remove(&pwa->core_listener);
+		pw_core_disconnect(pwa->core);
+	}
+
+	if (pwa->context)
+		pw_context_destroy(pwa->context);
+	if (pwa->thread_loop)
+		pw_thread_loop_destroy(pwa->thread_loop);
+
+	for (size_t i = 0; i < pwa->nodes.num; i++)
+		free_node(&pwa->nodes.array[i]);
+	da_free(pwa->nodes);
+
+	bfree(pwa->target);
+	bfree(pwa);
+}
+
+static void *pipewire_audio_create(obs_data_t *settings, obs_source_t *source, bool capture_sink)
+{
+	struct pipewire_audio *pwa = bzalloc(sizeof(*pwa));
+
+	pwa->source = source;
+	pwa->capture_sink = capture_sink;
+	pwa->target = bstrdup(obs_data_get_string(settings, "target"));
+
+	pwa->thread_loop = pw_thread_loop_new("PipeWire audio thread loop", NULL);
+	if (!pwa->thread_loop)
+		goto fail;
+
+	pwa->context = pw_context_new(pw_thread_loop_get_loop(pwa->thread_loop), NULL, 0);
+	if (!pwa->context || pw_thread_loop_start(pwa->thread_loop) < 0)
+		goto fail;
+
+	pw_thread_loop_lock(pwa->thread_loop);
+
+	pwa->core = pw_context_connect(pwa->context, NULL, 0);
+	if (!pwa->core) {
+		blog(LOG_WARNING, "[pipewire-audio] Error creating PipeWire core: %m");
+		pw_thread_loop_unlock(pwa->thread_loop);
+		goto fail;
+	}
+
+	pw_core_add_listener(pwa->core, &pwa->core_listener, &core_events, pwa);
+
+	pwa->registry = pw_core_get_registry(pwa->core, PW_VERSION_REGISTRY, 0);
+	pw_registry_add_listener(pwa->registry, &pwa->registry_listener, &registry_events, pwa);
+
+	/* wait for the existing nodes so a saved target resolves */
+	pwa->sync_id = pw_core_sync(pwa->core, PW_ID_CORE, pwa->sync_id);
+	pw_thread_loop_wait(pwa->thread_loop);
+
+	connect_stream(pwa);
+
+	pw_thread_loop_unlock(pwa->thread_loop);
+	return pwa;
+
+fail:
+	blog(LOG_WARNING, "[pipewire-audio] Failed to connect to PipeWire (source: %s)", obs_source_get_name(source));
+	return pwa;
+}
+
+static void *pipewire_audio_input_create(obs_data_t *settings, obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, false);
+}
+
+static void *pipewire_audio_output_create(obs_data_t *settings, obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, true);
+}
+
+static void pipewire_audio_get_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "target", "");
+}
+
+static obs_properties_t *pipewire_audio_get_properties(void *data)
+{
+	struct pipewire_audio *pwa = data;
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *list;
+
+	list = obs_properties_add_list(props, "target", obs_module_text("PipeWireAudioDevice"), OBS_COMBO_TYPE_LIST,
+				       OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(list, obs_module_text("Default"), "");
+
+	if (!pwa || !pwa->thread_loop)
+		return props;
+
+	pw_thread_loop_lock(pwa->thread_loop);
+	for (size_t i = 0; i < pwa->nodes.num; i++) {
+		struct audio_node *node = &pwa->nodes.array[i];
+		obs_property_list_add_string(list, node->description, node->name);
+	}
+	pw_thread_loop_unlock(pwa->thread_loop);
+
+	return props;
+}
+
+static void pipewire_audio_update(void *data, obs_data_t *settings)
+{
+	struct pipewire_audio *pwa = data;
+	const char *target = obs_data_get_string(settings, "target");
+
+	if (pwa->target && strcmp(pwa->target, target) == 0)
+		return;
+
+	if (!pwa->core)
+		return;
+
+	pw_thread_loop_lock(pwa->thread_loop);
+	bfree(pwa->target);
+	pwa->target = bstrdup(target);
+	connect_stream(pwa);
+	pw_thread_loop_unlock(pwa->thread_loop);
+}
+
+void pipewire_audio_load(void)
+{
+	const struct obs_source_info pipewire_audio_input_info = {
+		.id = "pipewire-audio-input-capture",
+		.type = OBS_SOURCE_TYPE_INPUT,
+		.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE,
+		.get_name = pipewire_audio_input_get_name,
+		.create = pipewire_audio_input_create,
+		.destroy = pipewire_audio_destroy,
+		.get_defaults = pipewire_audio_get_defaults,
+		.get_properties = pipewire_audio_get_properties,
+		.update = pipewire_audio_update,
+		.icon_type = OBS_ICON_TYPE_AUDIO_INPUT,
+	};
+	obs_register_source(&pipewire_audio_input_info);
+
+	const struct obs_source_info pipewire_audio_output_info = {
+		.id = "pipewire-audio-output-capture",
+		.type = OBS_SOURCE_TYPE_INPUT,
+		.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE | OBS_SOURCE_DO_NOT_SELF_MONITOR,
+		.get_name = pipewire_audio_output_get_name,
+		.create = pipewire_audio_output_create,
+		.destroy = pipewire_audio_destroy,
+		.get_defaults = pipewire_audio_get_defaults,
+		.get_properties = pipewire_audio_get_properties,
+		.update = pipewire_audio_update,
+		.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT,
+	};
+	obs_register_source(&pipewire_audio_output_info);
+}
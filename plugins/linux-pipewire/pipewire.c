@@ -98,7 +98,10 @@ struct _obs_pipewire_stream {
 	obs_pipewire *obs_pw;
 	obs_source_t *source;
 
+	/* DMA-BUF textures are imported once per pw_buffer and kept in its
+	 * user_data, memory textures are owned by the stream */
 	gs_texture_t *texture;
+	bool texture_owned;
 
 	struct pw_stream *stream;
 	struct spa_hook stream_listener;
@@ -553,6 +556,34 @@ static void renegotiate_format(void *data, uint64_t expirations)
 
 /* ------------------------------------------------- */
 
+static void clear_stream_texture(obs_pipewire_stream *obs_pw_stream)
+{
+	if (obs_pw_stream->texture_owned)
+		gs_texture_destroy(obs_pw_stream->texture);
+	obs_pw_stream->texture = NULL;
+	obs_pw_stream->texture_owned = false;
+}
+
+/* no damage metadata means the whole frame may have changed */
+static bool buffer_has_damage(struct spa_buffer *buffer)
+{
+	struct spa_meta *damage = spa_buffer_find_meta(buffer, SPA_META_VideoDamage);
+	struct spa_meta_region *region;
+
+	if (!damage)
+		return true;
+
+	spa_meta_for_each(region, damage)
+	{
+		/* the list ends with the first invalid region */
+		if (!spa_meta_region_is_valid(region))
+			break;
+		return true;
+	}
+
+	return false;
+}
+
 static void return_unused_pw_buffer(struct pw_stream *stream, struct pw_buffer *b)
 {
 #if PW_CHECK_VERSION(1, 2, 0)
@@ -706,6 +737,8 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 	struct spa_buffer *buffer;
 	struct pw_buffer *b;
 	bool has_buffer = true;
+	bool cursor_valid;
+	bool changed = false;
 
 	b = find_latest_buffer(obs_pw_stream->stream);
 	if (!b) {
@@ -788,21 +821,36 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 			goto read_metadata;
 		}
 
-		g_clear_pointer(&obs_pw_stream->texture, gs_texture_destroy);
+		gs_texture_t *texture = b->user_data;
+		if (!texture) {
+			use_modifiers = obs_pw_stream->format.info.raw.modifier != DRM_FORMAT_MOD_INVALID;
+			texture = gs_texture_create_from_dmabuf(obs_pw_stream->format.info.raw.size.width,
+								obs_pw_stream->format.info.raw.size.height,
+								obs_pw_video_format.drm_format, GS_BGRX, planes, fds,
+								strides, offsets, use_modifiers ? modifiers : NULL);
+
+			if (texture == NULL) {
+				clear_stream_texture(obs_pw_stream);
+				changed = true;
+
+				remove_modifier_from_format(obs_pw_stream, obs_pw_stream->format.info.raw.format,
+							    obs_pw_stream->format.info.raw.modifier);
+				pw_loop_signal_event(pw_thread_loop_get_loop(obs_pw->thread_loop),
+						     obs_pw_stream->reneg);
+				goto read_metadata;
+			}
 
-		use_modifiers = obs_pw_stream->format.info.raw.modifier != DRM_FORMAT_MOD_INVALID;
-		obs_pw_stream->texture = gs_texture_create_from_dmabuf(obs_pw_stream->format.info.raw.size.width,
-								       obs_pw_stream->format.info.raw.size.height,
-								       obs_pw_video_format.drm_format, GS_BGRX, planes,
-								       fds, strides, offsets,
-								       use_modifiers ? modifiers : NULL);
-
-		if (obs_pw_stream->texture == NULL) {
-			remove_modifier_from_format(obs_pw_stream, obs_pw_stream->format.info.raw.format,
-						    obs_pw_stream->format.info.raw.modifier);
-			pw_loop_signal_event(pw_thread_loop_get_loop(obs_pw->thread_loop), obs_pw_stream->reneg);
-			goto read_metadata;
+			if (obs_pw_video_format.swap_red_blue)
+				swap_texture_red_blue(texture);
+			b->user_data = texture;
 		}
+
+		/* the release point has to be signaled by rendering */
+		changed |= !obs_pw_stream->texture || obs_pw_stream->sync.set || buffer_has_damage(buffer);
+
+		if (obs_pw_stream->texture_owned)
+			clear_stream_texture(obs_pw_stream);
+		obs_pw_stream->texture = texture;
 	} else {
 		blog(LOG_DEBUG, "[pipewire] Buffer has memory texture");
 
@@ -823,17 +871,25 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 			goto read_metadata;
 		}
 
-		g_clear_pointer(&obs_pw_stream->texture, gs_texture_destroy);
+		clear_stream_texture(obs_pw_stream);
 		obs_pw_stream->texture = gs_texture_create(obs_pw_stream->format.info.raw.size.width,
 							   obs_pw_stream->format.info.raw.size.height,
 							   obs_pw_video_format.gs_format, 1,
 							   (const uint8_t **)&buffer->datas[0].data, GS_DYNAMIC);
-	}
+		obs_pw_stream->texture_owned = true;
+		changed = true;
 
-	if (obs_pw_video_format.swap_red_blue)
-		swap_texture_red_blue(obs_pw_stream->texture);
+		if (obs_pw_video_format.swap_red_blue)
+			swap_texture_red_blue(obs_pw_stream->texture);
+	}
 
 	/* Video Crop */
+	int crop_x = obs_pw_stream->crop.x;
+	int crop_y = obs_pw_stream->crop.y;
+	uint32_t crop_width = obs_pw_stream->crop.width;
+	uint32_t crop_height = obs_pw_stream->crop.height;
+	bool crop_valid = obs_pw_stream->crop.valid;
+
 	region = spa_buffer_find_meta_data(buffer, SPA_META_VideoCrop, sizeof(*region));
 	if (region && spa_meta_region_is_valid(region)) {
 #ifdef DEBUG_PIPEWIRE
@@ -850,26 +906,39 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 		obs_pw_stream->crop.valid = false;
 	}
 
+	changed |= crop_valid != obs_pw_stream->crop.valid || crop_x != obs_pw_stream->crop.x ||
+		   crop_y != obs_pw_stream->crop.y || crop_width != obs_pw_stream->crop.width ||
+		   crop_height != obs_pw_stream->crop.height;
+
 	/* Video Transform */
+	enum spa_meta_videotransform_value transform = obs_pw_stream->transform;
+
 	video_transform = spa_buffer_find_meta_data(buffer, SPA_META_VideoTransform, sizeof(*video_transform));
 	if (video_transform)
 		obs_pw_stream->transform = video_transform->transform;
 	else
 		obs_pw_stream->transform = SPA_META_TRANSFORMATION_None;
 
+	changed |= transform != obs_pw_stream->transform;
+
 read_metadata:
 
 	/* Cursor */
+	cursor_valid = obs_pw_stream->cursor.valid;
 	cursor = spa_buffer_find_meta_data(buffer, SPA_META_Cursor, sizeof(*cursor));
 	obs_pw_stream->cursor.valid = cursor && spa_meta_cursor_is_valid(cursor);
+	changed |= obs_pw_stream->cursor.visible && cursor_valid != obs_pw_stream->cursor.valid;
+
 	if (obs_pw_stream->cursor.visible && obs_pw_stream->cursor.valid) {
 		struct spa_meta_bitmap *bitmap = NULL;
 
 		if (cursor->bitmap_offset)
 			bitmap = SPA_MEMBER(cursor, cursor->bitmap_offset, struct spa_meta_bitmap);
 
-		if (bitmap)
+		if (bitmap) {
 			g_clear_pointer(&obs_pw_stream->cursor.texture, gs_texture_destroy);
+			changed = true;
+		}
 
 		if (bitmap && bitmap->size.width > 0 && bitmap->size.height > 0 &&
 		    obs_pw_video_format_from_spa_format(bitmap->format, &obs_pw_video_format) &&
@@ -891,6 +960,9 @@ read_metadata:
 				swap_texture_red_blue(obs_pw_stream->cursor.texture);
 		}
 
+		changed |= obs_pw_stream->cursor.x != cursor->position.x ||
+			   obs_pw_stream->cursor.y != cursor->position.y;
+
 		obs_pw_stream->cursor.x = cursor->position.x;
 		obs_pw_stream->cursor.y = cursor->position.y;
 	}
@@ -898,6 +970,9 @@ read_metadata:
 	pw_stream_queue_buffer(obs_pw_stream->stream, b);
 
 	obs_leave_graphics();
+
+	if (changed)
+		obs_source_mark_video_changed(obs_pw_stream->source);
 }
 
 static void on_process_cb(void *user_data)
@@ -920,7 +995,7 @@ static void on_param_changed_cb(void *user_data, uint32_t id, const struct spa_p
 	obs_pipewire_stream *obs_pw_stream = user_data;
 	obs_pipewire *obs_pw = obs_pw_stream->obs_pw;
 	struct spa_pod_builder pod_builder;
-	const struct spa_pod *params[7];
+	const struct spa_pod *params[8];
 	const char *format_name;
 	uint32_t n_params = 0;
 	uint32_t buffer_types;
@@ -981,6 +1056,13 @@ static void on_param_changed_cb(void *user_data, uint32_t id, const struct spa_p
 							SPA_PARAM_META_size,
 							SPA_POD_Int(sizeof(struct spa_meta_region)));
 
+	/* Video damage */
+	params[n_params++] = spa_pod_builder_add_object(
+		&pod_builder, SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta, SPA_PARAM_META_type,
+		SPA_POD_Id(SPA_META_VideoDamage), SPA_PARAM_META_size,
+		SPA_POD_CHOICE_RANGE_Int(sizeof(struct spa_meta_region) * 16, sizeof(struct spa_meta_region) * 1,
+					 sizeof(struct spa_meta_region) * 16));
+
 	/* Cursor */
 	params[n_params++] =
 		spa_pod_builder_add_object(&pod_builder, SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta, SPA_PARAM_META_type,
@@ -1047,10 +1129,30 @@ static void on_state_changed_cb(void *user_data, enum pw_stream_state old, enum
 	     pw_stream_state_as_string(state), error ? error : "none");
 }
 
+static void on_remove_buffer_cb(void *user_data, struct pw_buffer *b)
+{
+	obs_pipewire_stream *obs_pw_stream = user_data;
+	gs_texture_t *texture = b->user_data;
+
+	if (!texture)
+		return;
+
+	obs_enter_graphics();
+	if (obs_pw_stream->texture == texture) {
+		clear_stream_texture(obs_pw_stream);
+		obs_source_mark_video_changed(obs_pw_stream->source);
+	}
+	gs_texture_destroy(texture);
+	obs_leave_graphics();
+
+	b->user_data = NULL;
+}
+
 static const struct pw_stream_events stream_events = {
 	PW_VERSION_STREAM_EVENTS,
 	.state_changed = on_state_changed_cb,
 	.param_changed = on_param_changed_cb,
+	.remove_buffer = on_remove_buffer_cb,
 	.process = on_process_cb,
 };
 
@@ -1364,6 +1466,7 @@ void obs_pipewire_stream_video_render(obs_pipewire_stream *obs_pw_stream, gs_eff
 void obs_pipewire_stream_set_cursor_visible(obs_pipewire_stream *obs_pw_stream, bool cursor_visible)
 {
 	obs_pw_stream->cursor.visible = cursor_visible;
+	obs_source_mark_video_changed(obs_pw_stream->source);
 }
 
 void obs_pipewire_stream_destroy(obs_pipewire_stream *obs_pw_stream)
@@ -1381,9 +1484,10 @@ void obs_pipewire_stream_destroy(obs_pipewire_stream *obs_pw_stream)
 
 	obs_enter_graphics();
 	g_clear_pointer(&obs_pw_stream->cursor.texture, gs_texture_destroy);
-	g_clear_pointer(&obs_pw_stream->texture, gs_texture_destroy);
+	clear_stream_texture(obs_pw_stream);
 	obs_leave_graphics();
 
+	/* destroys the imported DMA-BUF textures through on_remove_buffer_cb */
 	pw_thread_loop_lock(obs_pw_stream->obs_pw->thread_loop);
 	if (obs_pw_stream->stream)
 		pw_stream_disconnect(obs_pw_stream->stream);
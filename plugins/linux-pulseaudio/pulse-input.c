@@ -15,8 +15,10 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <pthread.h>
 #include <util/platform.h>
 #include <util/bmem.h>
+#include <util/darray.h>
 #include <util/util_uint64.h>
 #include <obs-module.h>
 
@@ -28,15 +30,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PULSE_DATA(voidptr) struct pulse_data *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-input: " msg, ##__VA_ARGS__)
 
-struct pulse_data {
-	obs_source_t *source;
+/**
+ * One record stream per device, shared by every source capturing it so each
+ * device is only opened and timestamped once.
+ */
+struct pulse_stream_share {
 	pa_stream *stream;
-
-	/* user settings */
 	char *device;
 	bool is_default;
 	bool input;
 
+	/* sources receiving the audio, protected by the pulse mainloop lock */
+	DARRAY(obs_source_t *) sources;
+
 	/* server info */
 	enum speaker_layout speakers;
 	pa_sample_format_t format;
@@ -50,7 +56,20 @@ struct pulse_data {
 	uint_fast64_t frames;
 };
 
-static void pulse_stop_recording(struct pulse_data *data);
+struct pulse_data {
+	obs_source_t *source;
+	struct pulse_stream_share *share;
+
+	/* user settings */
+	char *device;
+	bool is_default;
+	bool input;
+};
+
+static pthread_mutex_t shares_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct pulse_stream_share *) shares;
+
+static void pulse_stop_recording(struct pulse_stream_share *data);
 
 /**
  * get obs from pulse audio format
@@ -181,7 +200,7 @@ static void pulse_stream_read(pa_stream *p, size_t nbytes, void *userdata)
 {
 	UNUSED_PARAMETER(p);
 	UNUSED_PARAMETER(nbytes);
-	PULSE_DATA(userdata);
+	struct pulse_stream_share *data = userdata;
 
 	const void *frames;
 	size_t bytes;
@@ -212,8 +231,10 @@ static void pulse_stream_read(pa_stream *p, size_t nbytes, void *userdata)
 	if (!data->first_ts)
 		data->first_ts = out.timestamp + STARTUP_TIMEOUT_NS;
 
-	if (out.timestamp > data->first_ts)
-		obs_source_output_audio(data->source, &out);
+	if (out.timestamp > data->first_ts) {
+		for (size_t i = 0; i < data->sources.num; i++)
+			obs_source_output_audio(data->sources.array[i], &out);
+	}
 
 	data->packets++;
 	data->frames += out.frames;
@@ -229,7 +250,7 @@ exit:
 static void pulse_server_info(pa_context *c, const pa_server_info *i, void *userdata)
 {
 	UNUSED_PARAMETER(c);
-	PULSE_DATA(userdata);
+	struct pulse_stream_share *data = userdata;
 
 	blog(LOG_INFO, "Server name: '%s %s'", i->server_name, i->server_version);
 
@@ -263,7 +284,7 @@ static void pulse_server_info(pa_context *c, const pa_server_info *i, void *user
 static void pulse_source_info(pa_context *c, const pa_source_info *i, int eol, void *userdata)
 {
 	UNUSED_PARAMETER(c);
-	PULSE_DATA(userdata);
+	struct pulse_stream_share *data = userdata;
 	// An error occured
 	if (eol < 0) {
 		data->format = PA_SAMPLE_INVALID;
@@ -316,7 +337,7 @@ skip:
  * this setting for monitor streams. For "real" input streams this should work
  * fine though.
  */
-static int_fast32_t pulse_start_recording(struct pulse_data *data)
+static int_fast32_t pulse_start_recording(struct pulse_stream_share *data, const char *name)
 {
 	if (pulse_get_server_info(pulse_server_info, (void *)data) < 0) {
 		blog(LOG_ERROR, "Unable to get server info !");
@@ -347,7 +368,7 @@ static int_fast32_t pulse_start_recording(struct pulse_data *data)
 
 	pa_channel_map channel_map = pulse_channel_map(data->speakers);
 
-	data->stream = pulse_stream_new(obs_source_get_name(data->source), &spec, &channel_map);
+	data->stream = pulse_stream_new(name, &spec, &channel_map);
 	if (!data->stream) {
 		blog(LOG_ERROR, "Unable to create stream");
 		return -1;
@@ -388,7 +409,7 @@ static int_fast32_t pulse_start_recording(struct pulse_data *data)
 /**
  * stop recording
  */
-static void pulse_stop_recording(struct pulse_data *data)
+static void pulse_stop_recording(struct pulse_stream_share *data)
 {
 	if (data->stream) {
 		pulse_lock();
@@ -406,6 +427,89 @@ static void pulse_stop_recording(struct pulse_data *data)
 	data->frames = 0;
 }
 
+static inline bool pulse_share_matches(struct pulse_stream_share *share, struct pulse_data *data)
+{
+	if (share->input != data->input || share->is_default != data->is_default)
+		return false;
+
+	/* the device of a default share follows the server default */
+	return data->is_default || strcmp(share->device, data->device) == 0;
+}
+
+/**
+ * Attach a source to the stream of its device, starting it if no other
+ * source is recording from that device yet
+ */
+static struct pulse_stream_share *pulse_share_acquire(struct pulse_data *data)
+{
+	struct pulse_stream_share *share = NULL;
+
+	pthread_mutex_lock(&shares_mutex);
+
+	for (size_t i = 0; i < shares.num; i++) {
+		if (pulse_share_matches(shares.array[i], data)) {
+			share = shares.array[i];
+			break;
+		}
+	}
+
+	if (!share) {
+		share = bzalloc(sizeof(struct pulse_stream_share));
+		share->device = bstrdup(data->device);
+		share->is_default = data->is_default;
+		share->input = data->input;
+
+		if (pulse_start_recording(share, obs_source_get_name(data->source)) < 0) {
+			bfree(share->device);
+			bfree(share);
+			pthread_mutex_unlock(&shares_mutex);
+			return NULL;
+		}
+
+		da_push_back(shares, &share);
+	} else {
+		blog(LOG_INFO, "Sharing recording from '%s'", share->device);
+	}
+
+	pulse_lock();
+	da_push_back(share->sources, &data->source);
+	pulse_unlock();
+
+	pthread_mutex_unlock(&shares_mutex);
+	return share;
+}
+
+/**
+ * Detach a source from its stream, stopping it with the last source
+ */
+static void pulse_share_release(struct pulse_data *data)
+{
+	struct pulse_stream_share *share = data->share;
+	if (!share)
+		return;
+
+	data->share = NULL;
+
+	pthread_mutex_lock(&shares_mutex);
+
+	pulse_lock();
+	da_erase_item(share->sources, &data->source);
+	pulse_unlock();
+
+	if (!share->sources.num) {
+		da_erase_item(shares, &share);
+		if (!shares.num)
+			da_free(shares);
+
+		pulse_stop_recording(share);
+		da_free(share->sources);
+		bfree(share->device);
+		bfree(share);
+	}
+
+	pthread_mutex_unlock(&shares_mutex);
+}
+
 /**
  * input info callback
  */
@@ -507,8 +611,7 @@ static void pulse_destroy(void *vptr)
 	if (!data)
 		return;
 
-	if (data->stream)
-		pulse_stop_recording(data);
+	pulse_share_release(data);
 	pulse_unref();
 
 	if (data->device)
@@ -537,9 +640,8 @@ static void pulse_update(void *vptr, obs_data_t *settings)
 	if (!restart)
 		return;
 
-	if (data->stream)
-		pulse_stop_recording(data);
-	pulse_start_recording(data);
+	pulse_share_release(data);
+	data->share = pulse_share_acquire(data);
 }
 
 /**
@@ -17,11 +17,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <linux/videodev2.h>
+#include <libavutil/hwcontext.h>
 
 #include "v4l2-decoder.h"
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: decoder: " msg, ##__VA_ARGS__)
 
+static bool has_vaapi(const AVCodec *codec)
+{
+	for (int i = 0;; i++) {
+		const AVCodecHWConfig *config = avcodec_get_hw_config(codec, i);
+		if (!config)
+			return false;
+
+		if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX &&
+		    config->device_type == AV_HWDEVICE_TYPE_VAAPI)
+			return true;
+	}
+}
+
+/* falls back to software decoding if there is no usable VAAPI device, or if
+ * libavcodec cannot decode the stream on it */
+static void init_hw_decoder(struct v4l2_decoder *decoder)
+{
+	if (!has_vaapi(decoder->codec))
+		return;
+
+	if (av_hwdevice_ctx_create(&decoder->hw_device_ctx, AV_HWDEVICE_TYPE_VAAPI, NULL, NULL, 0) < 0) {
+		blog(LOG_INFO, "no VAAPI device, decoding in software");
+		return;
+	}
+
+	decoder->hw_frame = av_frame_alloc();
+	if (!decoder->hw_frame) {
+		av_buffer_unref(&decoder->hw_device_ctx);
+		return;
+	}
+
+	decoder->context->hw_device_ctx = av_buffer_ref(decoder->hw_device_ctx);
+	blog(LOG_INFO, "decoding with VAAPI");
+}
+
 int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
 {
 	if (pixfmt == V4L2_PIX_FMT_MJPEG) {
@@ -55,6 +91,8 @@ int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
 
 	decoder->context->flags2 |= AV_CODEC_FLAG2_FAST;
 
+	init_hw_decoder(decoder);
+
 	if (avcodec_open2(decoder->context, decoder->codec, NULL) < 0) {
 		blog(LOG_ERROR, "failed to open codec");
 		return -1;
@@ -72,6 +110,10 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder)
 		av_frame_free(&decoder->frame);
 	}
 
+	if (decoder->hw_frame) {
+		av_frame_free(&decoder->hw_frame);
+	}
+
 	if (decoder->packet) {
 		av_packet_free(&decoder->packet);
 	}
@@ -82,6 +124,10 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder)
 #endif
 		avcodec_free_context(&decoder->context);
 	}
+
+	if (decoder->hw_device_ctx) {
+		av_buffer_unref(&decoder->hw_device_ctx);
+	}
 }
 
 int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length, struct v4l2_decoder *decoder)
@@ -93,17 +139,27 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length
 		return -1;
 	}
 
-	if (avcodec_receive_frame(decoder->context, decoder->frame) < 0) {
+	AVFrame *frame = decoder->hw_frame ? decoder->hw_frame : decoder->frame;
+	if (avcodec_receive_frame(decoder->context, frame) < 0) {
 		blog(LOG_ERROR, "failed to receive frame from codec");
 		return -1;
 	}
 
+	/* stays a software frame if the hwaccel could not take the stream */
+	if (frame->format == AV_PIX_FMT_VAAPI) {
+		if (av_hwframe_transfer_data(decoder->frame, frame, 0) < 0) {
+			blog(LOG_ERROR, "failed to download frame from VAAPI");
+			return -1;
+		}
+		frame = decoder->frame;
+	}
+
 	for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i) {
-		out->data[i] = decoder->frame->data[i];
-		out->linesize[i] = decoder->frame->linesize[i];
+		out->data[i] = frame->data[i];
+		out->linesize[i] = frame->linesize[i];
 	}
 
-	switch (decoder->context->pix_fmt) {
+	switch (frame->format) {
 	case AV_PIX_FMT_GRAY8:
 		out->format = VIDEO_FORMAT_Y800;
 		break;
@@ -119,6 +175,9 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length
 	case AV_PIX_FMT_YUV444P:
 		out->format = VIDEO_FORMAT_I444;
 		break;
+	case AV_PIX_FMT_NV12:
+		out->format = VIDEO_FORMAT_NV12;
+		break;
 	default:
 		break;
 	}
@@ -33,6 +33,10 @@ struct v4l2_decoder {
 	AVCodecContext *context;
 	AVPacket *packet;
 	AVFrame *frame;
+
+	/* VAAPI, NULL when decoding in software */
+	AVBufferRef *hw_device_ctx;
+	AVFrame *hw_frame;
 };
 
 /**
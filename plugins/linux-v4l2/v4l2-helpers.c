@@ -96,14 +96,14 @@ int_fast32_t v4l2_query_all_buffers(int_fast32_t dev, struct v4l2_buffer_data *b
 }
 #endif
 
-int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
+static int_fast32_t create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf, enum v4l2_buf_type type)
 {
 	struct v4l2_requestbuffers req;
 	struct v4l2_buffer map;
 
 	memset(&req, 0, sizeof(req));
 	req.count = 4;
-	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.type = type;
 	req.memory = V4L2_MEMORY_MMAP;
 
 	if (v4l2_ioctl(dev, VIDIOC_REQBUFS, &req) < 0) {
@@ -142,6 +142,16 @@ int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
 	return 0;
 }
 
+int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
+{
+	return create_mmap(dev, buf, V4L2_BUF_TYPE_VIDEO_CAPTURE);
+}
+
+int_fast32_t v4l2_create_output_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
+{
+	return create_mmap(dev, buf, V4L2_BUF_TYPE_VIDEO_OUTPUT);
+}
+
 int_fast32_t v4l2_destroy_mmap(struct v4l2_buffer_data *buf)
 {
 	for (uint_fast32_t i = 0; i < buf->count; ++i) {
@@ -229,6 +229,19 @@ int_fast32_t v4l2_query_all_buffers(int_fast32_t dev, struct v4l2_buffer_data *b
  */
 int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf);
 
+/**
+ * Create memory mapping for the buffers of an output device
+ *
+ * Same as v4l2_create_mmap, but for buffers the application fills and
+ * queues to the device.
+ *
+ * @param dev handle for the v4l2 device
+ * @param buf buffer data
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_create_output_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf);
+
 /**
  * Destroy the memory mapping for buffers
  *
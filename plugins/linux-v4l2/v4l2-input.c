@@ -63,6 +63,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+/**
+ * Buffers lent to libobs
+ *
+ * Raw frames are handed to libobs without copying them, each dequeued buffer
+ * is queued again once the frame has been drawn or dropped.  That can happen
+ * after the capture stopped or the source was destroyed, so the pool is
+ * refcounted by the source and every lent buffer, and the last reference
+ * unmaps the buffers.
+ */
+struct v4l2_lent_buffer {
+	struct v4l2_lend_pool *pool;
+	uint32_t index;
+	bool lent;
+};
+
+struct v4l2_lend_pool {
+	volatile long refs;
+	volatile long lent;
+	pthread_mutex_t mutex;
+	/** device to queue returned buffers on, -1 once capture stopped */
+	int_fast32_t dev;
+	/** mapped buffers, owned by the pool after capture stopped */
+	struct v4l2_buffer_data buffers;
+	struct v4l2_lent_buffer *lent_buffers;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -90,6 +116,7 @@ struct v4l2_data {
 	int height;
 	int linesize;
 	struct v4l2_buffer_data buffers;
+	struct v4l2_lend_pool *lend_pool;
 
 	bool auto_reset;
 	int timeout_frames;
@@ -100,6 +127,141 @@ static void v4l2_init(struct v4l2_data *data);
 static void v4l2_terminate(struct v4l2_data *data);
 static void v4l2_update(void *vptr, obs_data_t *settings);
 
+static struct v4l2_lend_pool *v4l2_lend_pool_create(int_fast32_t dev, uint_fast32_t count)
+{
+	struct v4l2_lend_pool *pool = bzalloc(sizeof(struct v4l2_lend_pool));
+	pool->refs = 1;
+	pool->dev = dev;
+	pthread_mutex_init(&pool->mutex, NULL);
+
+	pool->lent_buffers = bzalloc(count * sizeof(struct v4l2_lent_buffer));
+	for (uint_fast32_t i = 0; i < count; ++i) {
+		pool->lent_buffers[i].pool = pool;
+		pool->lent_buffers[i].index = (uint32_t)i;
+	}
+
+	return pool;
+}
+
+static void v4l2_lend_pool_release(struct v4l2_lend_pool *pool)
+{
+	if (!pool || os_atomic_dec_long(&pool->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&pool->buffers);
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool->lent_buffers);
+	bfree(pool);
+}
+
+/**
+ * Stop queueing returned buffers and take over the mapped buffers, which may
+ * still be in use by libobs.
+ */
+static void v4l2_lend_pool_stop(struct v4l2_lend_pool *pool, struct v4l2_buffer_data *buffers)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->dev = -1;
+	pool->buffers = *buffers;
+	memset(buffers, 0, sizeof(*buffers));
+	pthread_mutex_unlock(&pool->mutex);
+
+	long lent = os_atomic_load_long(&pool->lent);
+	if (lent)
+		blog(LOG_DEBUG, "%ld buffers still lent after capture stopped", lent);
+
+	v4l2_lend_pool_release(pool);
+}
+
+static void v4l2_return_buffer(void *param)
+{
+	struct v4l2_lent_buffer *lent = param;
+	struct v4l2_lend_pool *pool = lent->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	lent->lent = false;
+	if (pool->dev != -1) {
+		struct v4l2_buffer buf = {0};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = lent->index;
+
+		if (v4l2_ioctl(pool->dev, VIDIOC_QBUF, &buf) < 0)
+			blog(LOG_ERROR, "failed to enqueue returned buffer");
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	os_atomic_dec_long(&pool->lent);
+	v4l2_lend_pool_release(pool);
+}
+
+/**
+ * Lend a dequeued buffer to libobs.
+ *
+ * At least two buffers are kept with the driver, so capture never starves
+ * while libobs holds on to frames.  Returns false if the frame has to be
+ * copied instead.
+ */
+static bool v4l2_lend_buffer(struct v4l2_data *data, const struct obs_source_frame *frame, uint32_t index)
+{
+	struct v4l2_lend_pool *pool = data->lend_pool;
+
+	if ((long)data->buffers.count - os_atomic_load_long(&pool->lent) <= 2)
+		return false;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->lent_buffers[index].lent = true;
+	pthread_mutex_unlock(&pool->mutex);
+
+	os_atomic_inc_long(&pool->refs);
+	os_atomic_inc_long(&pool->lent);
+	obs_source_lend_video(data->source, frame, v4l2_return_buffer, &pool->lent_buffers[index]);
+	return true;
+}
+
+/**
+ * Like v4l2_reset_capture, but buffers still lent to libobs are left out and
+ * queued again when they are returned.
+ */
+static int_fast32_t v4l2_lend_pool_reset(struct v4l2_lend_pool *pool, uint_fast32_t count)
+{
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	int_fast32_t ret = -1;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	if (v4l2_ioctl(pool->dev, VIDIOC_STREAMOFF, &type) < 0) {
+		blog(LOG_ERROR, "unable to stop stream");
+		goto fail;
+	}
+
+	for (uint_fast32_t i = 0; i < count; ++i) {
+		if (pool->lent_buffers[i].lent)
+			continue;
+
+		struct v4l2_buffer buf = {0};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = (uint32_t)i;
+
+		if (v4l2_ioctl(pool->dev, VIDIOC_QBUF, &buf) < 0) {
+			blog(LOG_ERROR, "unable to queue buffer");
+			goto fail;
+		}
+	}
+
+	if (v4l2_ioctl(pool->dev, VIDIOC_STREAMON, &type) < 0) {
+		blog(LOG_ERROR, "unable to start stream");
+		goto fail;
+	}
+
+	ret = 0;
+
+fail:
+	pthread_mutex_unlock(&pool->mutex);
+	return ret;
+}
+
 /**
  * Prepare the output frame structure for obs and compute plane offsets
  * For encoded formats (mjpeg) this clears the frame and plane offsets,
@@ -222,7 +384,7 @@ static void *v4l2_thread(void *vptr)
 			}
 
 			if (data->auto_reset) {
-				if (v4l2_reset_capture(data->dev, &data->buffers) == 0)
+				if (v4l2_lend_pool_reset(data->lend_pool, data->buffers.count) == 0)
 					blog(LOG_INFO, "%s: stream reset successful", data->device_id);
 				else
 					blog(LOG_ERROR, "%s: failed to reset", data->device_id);
@@ -261,6 +423,12 @@ static void *v4l2_thread(void *vptr)
 		} else {
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
+
+			/* the buffer is queued again once libobs is done */
+			if (v4l2_lend_buffer(data, &out, buf.index)) {
+				frames++;
+				continue;
+			}
 		}
 		obs_source_output_video(data->source, &out);
 
@@ -835,6 +1003,11 @@ static void v4l2_terminate(struct v4l2_data *data)
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
+
+	if (data->lend_pool) {
+		v4l2_lend_pool_stop(data->lend_pool, &data->buffers);
+		data->lend_pool = NULL;
+	}
 	v4l2_destroy_mmap(&data->buffers);
 
 	if (data->dev != -1) {
@@ -959,6 +1132,8 @@ static void v4l2_init(struct v4l2_data *data)
 		}
 	}
 
+	data->lend_pool = v4l2_lend_pool_create(data->dev, data->buffers.count);
+
 	/* start the capture thread */
 	if (os_event_init(&data->event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
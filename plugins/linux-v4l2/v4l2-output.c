@@ -11,10 +11,22 @@
 #include <errno.h>
 #include <string.h>
 
+#include "v4l2-helpers.h"
+
 struct virtualcam_data {
 	obs_output_t *output;
 	int device;
 	uint32_t frame_size;
+
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+
+	/* frames are copied into buffers mapped from the device and queued,
+	 * write() is only used if the device can't stream */
+	struct v4l2_buffer_data buffers;
+	uint32_t buffers_queued;
+	bool use_write;
 };
 
 static const char *virtualcam_name(void *unused)
@@ -110,6 +122,98 @@ static void *virtualcam_create(obs_data_t *settings, obs_output_t *output)
 	return vcam;
 }
 
+static uint32_t get_pixelformat(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+		return V4L2_PIX_FMT_NV12;
+	case VIDEO_FORMAT_I420:
+		return V4L2_PIX_FMT_YUV420;
+	default:
+		return V4L2_PIX_FMT_YUYV;
+	}
+}
+
+static uint32_t get_frame_size(enum video_format format, uint32_t width, uint32_t height)
+{
+	if (format == VIDEO_FORMAT_YUY2)
+		return width * height * 2;
+
+	return width * height + (width + 1) / 2 * ((height + 1) / 2) * 2;
+}
+
+/* NV12 and I420 frames of the main video are converted on the GPU, so they
+ * are passed on as they are.  anything else is converted to YUYV */
+static enum video_format get_output_format(void)
+{
+	struct obs_video_info ovi;
+	obs_get_video_info(&ovi);
+
+	if (ovi.output_format == VIDEO_FORMAT_NV12 || ovi.output_format == VIDEO_FORMAT_I420)
+		return ovi.output_format;
+
+	return VIDEO_FORMAT_YUY2;
+}
+
+static bool set_format(struct virtualcam_data *vcam, struct v4l2_format *format, enum video_format video_format)
+{
+	format->fmt.pix.width = vcam->width;
+	format->fmt.pix.height = vcam->height;
+	format->fmt.pix.pixelformat = get_pixelformat(video_format);
+	format->fmt.pix.field = V4L2_FIELD_NONE;
+	format->fmt.pix.bytesperline = video_format == VIDEO_FORMAT_YUY2 ? vcam->width * 2 : vcam->width;
+	format->fmt.pix.sizeimage = get_frame_size(video_format, vcam->width, vcam->height);
+
+	if (ioctl(vcam->device, VIDIOC_S_FMT, format) < 0)
+		return false;
+
+	/* the device may already be set up in another format */
+	if (format->fmt.pix.pixelformat != get_pixelformat(video_format))
+		return false;
+
+	vcam->format = video_format;
+	vcam->frame_size = get_frame_size(video_format, vcam->width, vcam->height);
+	return true;
+}
+
+static void free_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req = {0};
+
+	if (!vcam->buffers.count)
+		return;
+
+	v4l2_destroy_mmap(&vcam->buffers);
+
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+	ioctl(vcam->device, VIDIOC_REQBUFS, &req);
+}
+
+static void init_buffers(struct virtualcam_data *vcam, const char *device)
+{
+	vcam->buffers_queued = 0;
+	vcam->use_write = true;
+
+	if (v4l2_create_output_mmap(vcam->device, &vcam->buffers) < 0) {
+		free_buffers(vcam);
+		blog(LOG_INFO, "Streaming I/O isn't available on '%s', writing frames instead", device);
+		return;
+	}
+
+	for (uint_fast32_t i = 0; i < vcam->buffers.count; i++) {
+		if (vcam->buffers.info[i].length < vcam->frame_size) {
+			free_buffers(vcam);
+			return;
+		}
+	}
+
+	/* frames are dropped rather than waiting for the device to give a
+	 * buffer back */
+	fcntl(vcam->device, F_SETFL, fcntl(vcam->device, F_GETFL) | O_NONBLOCK);
+	vcam->use_write = false;
+}
+
 static bool try_connect(void *data, const char *device)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
@@ -117,10 +221,8 @@ static bool try_connect(void *data, const char *device)
 	struct v4l2_capability capability;
 	struct v4l2_streamparm parm;
 
-	uint32_t width = obs_output_get_width(vcam->output);
-	uint32_t height = obs_output_get_height(vcam->output);
-
-	vcam->frame_size = width * height * 2;
+	vcam->width = obs_output_get_width(vcam->output);
+	vcam->height = obs_output_get_height(vcam->output);
 
 	vcam->device = open(device, O_RDWR);
 
@@ -148,33 +250,38 @@ static bool try_connect(void *data, const char *device)
 	if (ioctl(vcam->device, VIDIOC_S_PARM, &parm) < 0)
 		goto fail_close_device;
 
-	format.fmt.pix.width = width;
-	format.fmt.pix.height = height;
-	format.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-	format.fmt.pix.sizeimage = vcam->frame_size;
-
-	if (ioctl(vcam->device, VIDIOC_S_FMT, &format) < 0)
-		goto fail_close_device;
+	enum video_format video_format = get_output_format();
+	if (!set_format(vcam, &format, video_format)) {
+		if (video_format == VIDEO_FORMAT_YUY2 || !set_format(vcam, &format, VIDEO_FORMAT_YUY2))
+			goto fail_close_device;
+	}
 
 	struct video_scale_info vsi = {0};
-	vsi.format = VIDEO_FORMAT_YUY2;
-	vsi.width = width;
-	vsi.height = height;
+	vsi.format = vcam->format;
+	vsi.width = vcam->width;
+	vsi.height = vcam->height;
+	vsi.range = ovi.range;
+	vsi.colorspace = ovi.colorspace;
 	obs_output_set_video_conversion(vcam->output, &vsi);
 
+	init_buffers(vcam, device);
+
 	memset(&parm, 0, sizeof(parm));
 	parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
 	if (ioctl(vcam->device, VIDIOC_STREAMON, &parm) < 0) {
 		blog(LOG_ERROR, "Failed to start streaming on '%s' (%s)", device, strerror(errno));
-		goto fail_close_device;
+		goto fail_free_buffers;
 	}
 
-	blog(LOG_INFO, "Virtual camera started");
+	blog(LOG_INFO, "Virtual camera started (%s, %s)", get_video_format_name(vcam->format),
+	     vcam->use_write ? "write" : "mmap");
 	obs_output_begin_data_capture(vcam->output, 0);
 
 	return true;
 
+fail_free_buffers:
+	free_buffers(vcam);
 fail_close_device:
 	close(vcam->device);
 	return false;
@@ -245,22 +352,98 @@ static void virtualcam_stop(void *data, uint64_t ts)
 		blog(LOG_WARNING, "Failed to stop streaming on video device %d (%s)", vcam->device, strerror(errno));
 	}
 
+	free_buffers(vcam);
 	close(vcam->device);
 	blog(LOG_INFO, "Virtual camera stopped");
 
 	UNUSED_PARAMETER(ts);
 }
 
+/* packs the planes without their padding */
+static void copy_frame(struct virtualcam_data *vcam, const struct video_data *frame, uint8_t *dst)
+{
+	uint32_t planes = vcam->format == VIDEO_FORMAT_YUY2 ? 1 : (vcam->format == VIDEO_FORMAT_NV12 ? 2 : 3);
+
+	for (uint32_t p = 0; p < planes; p++) {
+		uint32_t width_bytes = vcam->width;
+		uint32_t height = p ? (vcam->height + 1) / 2 : vcam->height;
+
+		if (vcam->format == VIDEO_FORMAT_YUY2)
+			width_bytes = vcam->width * 2;
+		else if (p)
+			width_bytes = vcam->format == VIDEO_FORMAT_NV12 ? (vcam->width + 1) / 2 * 2
+								     : (vcam->width + 1) / 2;
+
+		if (frame->linesize[p] == width_bytes) {
+			memcpy(dst, frame->data[p], (size_t)width_bytes * height);
+			dst += (size_t)width_bytes * height;
+			continue;
+		}
+
+		for (uint32_t y = 0; y < height; y++) {
+			memcpy(dst, frame->data[p] + (size_t)frame->linesize[p] * y, width_bytes);
+			dst += width_bytes;
+		}
+	}
+}
+
+static void write_video(struct virtualcam_data *vcam, struct video_data *frame)
+{
+	uint8_t *data = frame->data[0];
+
+	if (vcam->format != VIDEO_FORMAT_YUY2 || frame->linesize[0] != vcam->width * 2) {
+		data = bmalloc(vcam->frame_size);
+		copy_frame(vcam, frame, data);
+	}
+
+	uint32_t offset = 0;
+	while (offset < vcam->frame_size) {
+		ssize_t written = write(vcam->device, data + offset, vcam->frame_size - offset);
+		if (written <= 0)
+			break;
+		offset += (uint32_t)written;
+	}
+
+	if (data != frame->data[0])
+		bfree(data);
+}
+
 static void virtual_video(void *param, struct video_data *frame)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)param;
-	uint32_t frame_size = vcam->frame_size;
-	while (frame_size > 0) {
-		ssize_t written = write(vcam->device, frame->data[0], vcam->frame_size);
-		if (written == -1)
-			break;
-		frame_size -= written;
+	struct v4l2_buffer buf = {0};
+
+	if (vcam->use_write) {
+		write_video(vcam, frame);
+		return;
 	}
+
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	buf.memory = V4L2_MEMORY_MMAP;
+
+	/* every buffer is filled once before any is taken back */
+	if (vcam->buffers_queued < vcam->buffers.count) {
+		buf.index = vcam->buffers_queued;
+	} else if (ioctl(vcam->device, VIDIOC_DQBUF, &buf) < 0) {
+		if (errno != EAGAIN)
+			blog(LOG_DEBUG, "v4l2-output: Failed to dequeue buffer (%s)", strerror(errno));
+		return;
+	}
+
+	copy_frame(vcam, frame, vcam->buffers.info[buf.index].start);
+
+	buf.bytesused = vcam->frame_size;
+	buf.field = V4L2_FIELD_NONE;
+	buf.timestamp.tv_sec = (time_t)(frame->timestamp / 1000000000);
+	buf.timestamp.tv_usec = (suseconds_t)(frame->timestamp % 1000000000 / 1000);
+
+	if (ioctl(vcam->device, VIDIOC_QBUF, &buf) < 0) {
+		blog(LOG_DEBUG, "v4l2-output: Failed to queue buffer (%s)", strerror(errno));
+		return;
+	}
+
+	if (vcam->buffers_queued < vcam->buffers.count)
+		vcam->buffers_queued++;
 }
 
 struct obs_output_info virtualcam_info = {
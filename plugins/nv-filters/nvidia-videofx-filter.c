@@ -46,6 +46,14 @@ enum nvvfx_filter_id { S_FX_AIGS, S_FX_BLUR, S_FX_BG_BLUR };
 bool nvvfx_loaded = false;
 bool nvvfx_new_sdk = false;
 
+/* All effects of all filter instances are queued on one CUDA stream, so their
+ * maps, transfers and inference runs are serialized without any cross stream
+ * synchronization, and only one stream is created however many filters are
+ * in use. */
+static pthread_mutex_t shared_stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CUstream shared_stream = NULL;
+static long shared_stream_refs = 0;
+
 /* clang-format off */
 struct nvvfx_data {
 	obs_source_t *context;
@@ -183,10 +191,8 @@ static void nvvfx_filter_actual_destroy(void *data)
 			NvCVImage_Destroy(filter->blur_dst_img);
 		}
 	}
-	if (filter->stream)
-		NvVFX_CudaStreamDestroy(filter->stream);
-	if (filter->stream_blur)
-		NvVFX_CudaStreamDestroy(filter->stream_blur);
+	release_shared_stream(&filter->stream);
+	release_shared_stream(&filter->stream_blur);
 
 	if (filter->handle) {
 		if (filter->stateObjectHandle) {
@@ -223,6 +229,37 @@ static void *log_nverror_destroy(struct nvvfx_data *filter, NvCV_Status vfxErr)
 //---------------------------------------------------------------------------//
 // filter creation //
 
+static NvCV_Status acquire_shared_stream(CUstream *stream)
+{
+	NvCV_Status vfxErr = NVCV_SUCCESS;
+
+	pthread_mutex_lock(&shared_stream_mutex);
+	if (!shared_stream_refs)
+		vfxErr = NvVFX_CudaStreamCreate(&shared_stream);
+	if (vfxErr == NVCV_SUCCESS) {
+		shared_stream_refs++;
+		*stream = shared_stream;
+	}
+	pthread_mutex_unlock(&shared_stream_mutex);
+
+	return vfxErr;
+}
+
+static void release_shared_stream(CUstream *stream)
+{
+	if (!*stream)
+		return;
+
+	pthread_mutex_lock(&shared_stream_mutex);
+	if (--shared_stream_refs == 0) {
+		NvVFX_CudaStreamDestroy(shared_stream);
+		shared_stream = NULL;
+	}
+	pthread_mutex_unlock(&shared_stream_mutex);
+
+	*stream = NULL;
+}
+
 static bool nvvfx_filter_create_internal(struct nvvfx_data *filter)
 {
 	NvCV_Status vfxErr;
@@ -260,7 +297,7 @@ static bool nvvfx_filter_create_internal(struct nvvfx_data *filter)
 		size_t max_len = sizeof(buffer) / sizeof(char);
 		snprintf(modelDir, max_len, "%s\\models", buffer);
 		vfxErr = NvVFX_SetString(filter->handle, NVVFX_MODEL_DIRECTORY, modelDir);
-		vfxErr = NvVFX_CudaStreamCreate(&filter->stream);
+		vfxErr = acquire_shared_stream(&filter->stream);
 		if (NVCV_SUCCESS != vfxErr)
 			log_nverror_destroy(filter, vfxErr);
 		vfxErr = NvVFX_SetCudaStream(filter->handle, NVVFX_CUDA_STREAM, filter->stream);
@@ -268,7 +305,7 @@ static bool nvvfx_filter_create_internal(struct nvvfx_data *filter)
 			log_nverror_destroy(filter, vfxErr);
 	}
 	if (id == S_FX_BLUR || id == S_FX_BG_BLUR) {
-		vfxErr = NvVFX_CudaStreamCreate(&filter->stream_blur);
+		vfxErr = acquire_shared_stream(&filter->stream_blur);
 		if (NVCV_SUCCESS != vfxErr)
 			log_nverror_destroy(filter, vfxErr);
 		vfxErr = NvVFX_SetCudaStream(filter->handle_blur, NVVFX_CUDA_STREAM, filter->stream_blur);
@@ -378,12 +415,8 @@ static void nvvfx_filter_reset(void *data, calldata_t *calldata)
 
 	os_atomic_set_bool(&filter->processing_stop, true);
 	// [A] first destroy
-	if (filter->stream) {
-		NvVFX_CudaStreamDestroy(filter->stream);
-	}
-	if (filter->stream_blur) {
-		NvVFX_CudaStreamDestroy(filter->stream_blur);
-	}
+	release_shared_stream(&filter->stream);
+	release_shared_stream(&filter->stream_blur);
 	if (filter->handle) {
 		if (filter->stateObjectHandle) {
 			NvVFX_DeallocateState(filter->handle, filter->stateObjectHandle);
@@ -632,7 +665,7 @@ static bool process_texture(struct nvvfx_data *filter)
 	}
 
 	/* 2. Convert to BGR. */
-	vfxErr = NvCVImage_Transfer(filter->src_img, filter->BGR_src_img, 1.0f, filter->stream_blur, filter->stage);
+	vfxErr = NvCVImage_Transfer(filter->src_img, filter->BGR_src_img, 1.0f, process_stream, filter->stage);
 	if (vfxErr != NVCV_SUCCESS) {
 		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
 		error("Error converting src to BGR img; error %i: %s", vfxErr, errString);
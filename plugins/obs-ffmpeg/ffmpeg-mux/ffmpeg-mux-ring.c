@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "ffmpeg-mux-ring.h"
+
+#include <util/bmem.h>
+#include <util/threading.h>
+
+struct ring_header {
+	uint32_t size;
+	volatile bool attached;
+	/* where obs-ffmpeg-mux is done reading, only it moves this */
+	volatile long read_pos;
+};
+
+#define RING_DATA_OFFSET 64
+
+struct ffm_ring {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	size_t map_size;
+#endif
+	char name[64];
+	bool is_writer;
+
+	struct ring_header *header;
+	uint8_t *data;
+	uint32_t size;
+
+	/* writer only, positions wrap around at 2^32 along with read_pos */
+	uint32_t write_pos;
+};
+
+static volatile long ring_count = 0;
+
+static void *map_ring(struct ffm_ring *ring, size_t size, bool create)
+{
+#ifdef _WIN32
+	void *map;
+
+	if (create) {
+		ring->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size,
+						  ring->name);
+	} else {
+		ring->handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, false, ring->name);
+	}
+	if (!ring->handle)
+		return NULL;
+
+	map = MapViewOfFile(ring->handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	return map;
+#else
+	void *map;
+	int fd;
+
+	if (create)
+		fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	else
+		fd = shm_open(ring->name, O_RDWR, 0);
+	if (fd == -1)
+		return NULL;
+
+	if (create && ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		return NULL;
+	}
+
+	if (!create) {
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return NULL;
+		}
+		size = (size_t)st.st_size;
+	}
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return NULL;
+
+	ring->map_size = size;
+	return map;
+#endif
+}
+
+struct ffm_ring *ffm_ring_create(uint32_t size)
+{
+	struct ffm_ring *ring = bzalloc(sizeof(*ring));
+	long id = os_atomic_inc_long(&ring_count);
+
+#ifdef _WIN32
+	snprintf(ring->name, sizeof(ring->name), "Local\\obs-ffmpeg-mux-%lu-%ld", GetCurrentProcessId(), id);
+#else
+	/* kept short, macOS doesn't take names over 31 characters */
+	snprintf(ring->name, sizeof(ring->name), "/obs-mux-%d-%ld", (int)getpid(), id);
+#endif
+
+	ring->is_writer = true;
+	ring->header = map_ring(ring, RING_DATA_OFFSET + (size_t)size, true);
+	if (!ring->header) {
+		ffm_ring_destroy(ring);
+		return NULL;
+	}
+
+	ring->header->size = size;
+	ring->data = (uint8_t *)ring->header + RING_DATA_OFFSET;
+	ring->size = size;
+	return ring;
+}
+
+const char *ffm_ring_name(const struct ffm_ring *ring)
+{
+	return ring->name;
+}
+
+bool ffm_ring_write(struct ffm_ring *ring, const uint8_t *data, uint32_t size, uint32_t *p_pos)
+{
+	uint32_t pos = ring->write_pos;
+	uint32_t offset = pos & (ring->size - 1);
+	uint32_t read_pos;
+
+	if (!os_atomic_load_bool(&ring->header->attached))
+		return false;
+
+	/* packets are read in place, so one that would wrap around starts
+	 * over at the beginning instead */
+	if (offset + size > ring->size)
+		pos += ring->size - offset;
+
+	read_pos = (uint32_t)os_atomic_load_long(&ring->header->read_pos);
+	if (pos + size - read_pos > ring->size)
+		return false;
+
+	memcpy(ring->data + (pos & (ring->size - 1)), data, size);
+	ring->write_pos = pos + size;
+	*p_pos = pos;
+	return true;
+}
+
+uint32_t ffm_ring_used(const struct ffm_ring *ring)
+{
+	uint32_t read_pos = (uint32_t)os_atomic_load_long(&ring->header->read_pos);
+	return ring->write_pos - read_pos;
+}
+
+struct ffm_ring *ffm_ring_open(const char *name)
+{
+	struct ffm_ring *ring = bzalloc(sizeof(*ring));
+	uint32_t size;
+
+	snprintf(ring->name, sizeof(ring->name), "%s", name);
+
+	ring->header = map_ring(ring, 0, false);
+	if (!ring->header) {
+		ffm_ring_destroy(ring);
+		return NULL;
+	}
+
+#ifndef _WIN32
+	/* mapped by both now, the name isn't needed anymore */
+	shm_unlink(ring->name);
+#endif
+
+	size = ring->header->size;
+	if (!size || (size & (size - 1)) != 0) {
+		ffm_ring_destroy(ring);
+		return NULL;
+	}
+
+	ring->data = (uint8_t *)ring->header + RING_DATA_OFFSET;
+	ring->size = size;
+
+	os_atomic_set_bool(&ring->header->attached, true);
+	return ring;
+}
+
+uint8_t *ffm_ring_data(struct ffm_ring *ring, uint32_t pos, uint32_t size)
+{
+	uint32_t offset = pos & (ring->size - 1);
+
+	if (size > ring->size - offset)
+		return NULL;
+
+	return ring->data + offset;
+}
+
+void ffm_ring_release(struct ffm_ring *ring, uint32_t pos, uint32_t size)
+{
+	os_atomic_set_long(&ring->header->read_pos, (long)(pos + size));
+}
+
+void ffm_ring_destroy(struct ffm_ring *ring)
+{
+	if (!ring)
+		return;
+
+#ifdef _WIN32
+	if (ring->header)
+		UnmapViewOfFile(ring->header);
+	if (ring->handle)
+		CloseHandle(ring->handle);
+#else
+	if (ring->header)
+		munmap(ring->header, ring->map_size);
+	/* in case obs-ffmpeg-mux never got to open it */
+	if (ring->is_writer)
+		shm_unlink(ring->name);
+#endif
+
+	bfree(ring);
+}
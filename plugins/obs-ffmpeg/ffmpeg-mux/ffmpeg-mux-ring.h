@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Shared memory the packet data goes through instead of the pipe.  The
+ * pipe still carries every ffm_packet_info, in order, so it is also what
+ * wakes obs-ffmpeg-mux up; a packet that doesn't fit in the ring (or any
+ * packet before obs-ffmpeg-mux has opened it) just follows its info in the
+ * pipe like before, so the writer never has to wait on the ring. */
+
+/* must be a power of two */
+#define FFM_RING_SIZE (16 * 1024 * 1024)
+
+struct ffm_ring;
+
+/* obs-ffmpeg: creates the ring, its name goes on the command line */
+struct ffm_ring *ffm_ring_create(uint32_t size);
+const char *ffm_ring_name(const struct ffm_ring *ring);
+bool ffm_ring_write(struct ffm_ring *ring, const uint8_t *data, uint32_t size, uint32_t *pos);
+/* what obs-ffmpeg-mux has yet to release */
+uint32_t ffm_ring_used(const struct ffm_ring *ring);
+
+/* obs-ffmpeg-mux: reads packets in place, and releases them in the order
+ * they were written once they are muxed */
+struct ffm_ring *ffm_ring_open(const char *name);
+uint8_t *ffm_ring_data(struct ffm_ring *ring, uint32_t pos, uint32_t size);
+void ffm_ring_release(struct ffm_ring *ring, uint32_t pos, uint32_t size);
+
+void ffm_ring_destroy(struct ffm_ring *ring);
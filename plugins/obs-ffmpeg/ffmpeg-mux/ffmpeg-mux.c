@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-ring.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
@@ -43,7 +44,37 @@
 
 /* ------------------------------------------------------------------------- */
 
+#ifdef FFMPEG_MUX_LIBRARY
+/* built into obs-ffmpeg for muxing in-process, errors are logged and kept
+ * for the thread muxing rather than written to stderr for the output */
+static THREAD_LOCAL char mux_last_error[1024];
+
+static void mux_error(const char *format, ...)
+{
+	size_t len;
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(mux_last_error, sizeof(mux_last_error), format, args);
+	va_end(args);
+
+	len = strlen(mux_last_error);
+	while (len && mux_last_error[len - 1] == '\n')
+		mux_last_error[--len] = 0;
+
+	blog(LOG_WARNING, "[ffmpeg muxer] %s", mux_last_error);
+}
+
+static inline void mux_print(const char *format, ...)
+{
+	UNUSED_PARAMETER(format);
+}
+#else
+#define mux_error(...) fprintf(stderr, __VA_ARGS__)
+#define mux_print(...) printf(__VA_ARGS__)
+
 static char *global_stream_key = "";
+#endif
 
 struct resize_buf {
 	uint8_t *buf;
@@ -98,6 +129,7 @@ struct main_params {
 	char *acodec;
 	char *muxer_settings;
 	int codec_tag;
+	char *ring_name;
 };
 
 struct audio_params {
@@ -244,6 +276,7 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 	}
 
 	dstr_free(&ffm->params.printable_file);
+	bfree(ffm->params.file);
 
 	av_packet_free(&ffm->packet);
 
@@ -256,7 +289,7 @@ static bool get_opt_str(int *p_argc, char ***p_argv, char **str, const char *opt
 	char **argv = *p_argv;
 
 	if (!argc) {
-		printf("Missing expected option: '%s'\n", opt);
+		mux_print("Missing expected option: '%s'\n", opt);
 		return false;
 	}
 
@@ -293,6 +326,7 @@ static bool get_audio_params(struct audio_params *audio, int *argc, char ***argv
 	return true;
 }
 
+#ifndef FFMPEG_MUX_LIBRARY
 static void ffmpeg_log_callback(void *param, int level, const char *format, va_list args)
 {
 #ifdef ENABLE_FFMPEG_MUX_DEBUG
@@ -329,6 +363,7 @@ static void ffmpeg_log_callback(void *param, int level, const char *format, va_l
 #endif
 	UNUSED_PARAMETER(param);
 }
+#endif
 
 static bool init_params(int *argc, char ***argv, struct main_params *params, struct audio_params **p_audio)
 {
@@ -336,21 +371,24 @@ static bool init_params(int *argc, char ***argv, struct main_params *params, str
 
 	if (!get_opt_str(argc, argv, &params->file, "file name"))
 		return false;
+
+	/* a file can still be finishing after the next one got its name */
+	params->file = bstrdup(params->file);
 	if (!get_opt_int(argc, argv, &params->has_video, "video track count"))
 		return false;
 	if (!get_opt_int(argc, argv, &params->tracks, "audio track count"))
 		return false;
 
 	if (params->has_video > 1 || params->has_video < 0) {
-		puts("Invalid number of video tracks\n");
+		mux_print("Invalid number of video tracks\n\n");
 		return false;
 	}
 	if (params->tracks < 0) {
-		puts("Invalid number of audio tracks\n");
+		mux_print("Invalid number of audio tracks\n\n");
 		return false;
 	}
 	if (params->has_video == 0 && params->tracks == 0) {
-		puts("Must have at least 1 audio track or 1 video track\n");
+		mux_print("Must have at least 1 audio track or 1 video track\n\n");
 		return false;
 	}
 
@@ -401,14 +439,20 @@ static bool init_params(int *argc, char ***argv, struct main_params *params, str
 
 	dstr_copy(&params->printable_file, params->file);
 
-	get_opt_str(argc, argv, &global_stream_key, "stream key");
-	if (strcmp(global_stream_key, "") != 0) {
-		dstr_replace(&params->printable_file, global_stream_key, "{stream_key}");
+	char *stream_key = "";
+	get_opt_str(argc, argv, &stream_key, "stream key");
+	if (strcmp(stream_key, "") != 0) {
+		dstr_replace(&params->printable_file, stream_key, "{stream_key}");
 	}
 
+#ifndef FFMPEG_MUX_LIBRARY
+	/* in-process, the log callback is obs-ffmpeg's */
+	global_stream_key = stream_key;
 	av_log_set_callback(ffmpeg_log_callback);
+#endif
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
+	get_opt_str(argc, argv, &params->ring_name, "shared memory ring");
 
 	return true;
 }
@@ -417,7 +461,7 @@ static bool new_stream(struct ffmpeg_mux *ffm, AVStream **stream, const char *na
 {
 	*stream = avformat_new_stream(ffm->output, NULL);
 	if (!*stream) {
-		fprintf(stderr, "Couldn't create stream for encoder '%s'\n", name);
+		mux_error("Couldn't create stream for encoder '%s'\n", name);
 		return false;
 	}
 
@@ -433,7 +477,7 @@ static void create_video_stream(struct ffmpeg_mux *ffm)
 
 	const AVCodecDescriptor *codec = avcodec_descriptor_get_by_name(name);
 	if (!codec) {
-		fprintf(stderr, "Couldn't find codec '%s'\n", name);
+		mux_error("Couldn't find codec '%s'\n", name);
 		return;
 	}
 
@@ -512,13 +556,13 @@ static void create_audio_stream(struct ffmpeg_mux *ffm, int idx)
 
 	const AVCodecDescriptor *codec_desc = avcodec_descriptor_get_by_name(name);
 	if (!codec_desc) {
-		fprintf(stderr, "Couldn't find codec descriptor '%s'\n", name);
+		mux_error("Couldn't find codec descriptor '%s'\n", name);
 		return;
 	}
 
 	const AVCodec *codec = avcodec_find_encoder(codec_desc->id);
 	if (!codec) {
-		fprintf(stderr, "Couldn't find codec '%s'\n", name);
+		mux_error("Couldn't find codec '%s'\n", name);
 		return;
 	}
 
@@ -595,6 +639,7 @@ static void ffmpeg_mux_header(struct ffmpeg_mux *ffm, uint8_t *data, struct ffm_
 	}
 }
 
+#ifndef FFMPEG_MUX_LIBRARY
 static size_t safe_read(void *vdata, size_t size)
 {
 	uint8_t *data = vdata;
@@ -648,6 +693,7 @@ static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 
 	return true;
 }
+#endif
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4996)
@@ -665,7 +711,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 	unsigned char *chunk = malloc(CHUNK_SIZE);
 	if (!chunk) {
 		os_atomic_set_bool(&ffm->io.output_error, true);
-		fprintf(stderr, "Error allocating memory for output\n");
+		mux_error("Error allocating memory for output\n");
 		goto error;
 	}
 
@@ -770,7 +816,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 			// Write the current chunk to the output file
 			if (fwrite(chunk, chunk_used, 1, ffm->io.output_file) != 1) {
 				os_atomic_set_bool(&ffm->io.output_error, true);
-				fprintf(stderr, "Error writing to '%s', %s\n", ffm->params.printable_file.array,
+				mux_error("Error writing to '%s', %s\n", ffm->params.printable_file.array,
 					strerror(errno));
 				goto error;
 			}
@@ -873,7 +919,7 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 			// We're in charge of managing the actual file now
 			ffm->io.output_file = os_fopen(ffm->params.file, "wb");
 			if (!ffm->io.output_file) {
-				fprintf(stderr, "Couldn't open '%s', %s\n", ffm->params.printable_file.array,
+				mux_error("Couldn't open '%s', %s\n", ffm->params.printable_file.array,
 					strerror(errno));
 				return FFM_ERROR;
 			}
@@ -899,7 +945,7 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 		} else {
 			ret = avio_open(&ffm->output->pb, ffm->params.file, AVIO_FLAG_WRITE);
 			if (ret < 0) {
-				fprintf(stderr, "Couldn't open '%s', %s\n", ffm->params.printable_file.array,
+				mux_error("Couldn't open '%s', %s\n", ffm->params.printable_file.array,
 					av_err2str(ret));
 				return FFM_ERROR;
 			}
@@ -908,25 +954,25 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 
 	AVDictionary *dict = NULL;
 	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=", " ", 0))) {
-		fprintf(stderr, "Failed to parse muxer settings: %s\n%s\n", av_err2str(ret),
+		mux_error("Failed to parse muxer settings: %s\n%s\n", av_err2str(ret),
 			ffm->params.muxer_settings);
 
 		av_dict_free(&dict);
 	}
 
 	if (av_dict_count(dict) > 0) {
-		printf("Using muxer settings:");
+		mux_print("Using muxer settings:");
 
 		AVDictionaryEntry *entry = NULL;
 		while ((entry = av_dict_get(dict, "", entry, AV_DICT_IGNORE_SUFFIX)))
-			printf("\n\t%s=%s", entry->key, entry->value);
+			mux_print("\n\t%s=%s", entry->key, entry->value);
 
-		printf("\n");
+		mux_print("\n");
 	}
 
 	ret = avformat_write_header(ffm->output, &dict);
 	if (ret < 0) {
-		fprintf(stderr, "Error opening '%s': %s", ffm->params.printable_file.array, av_err2str(ret));
+		mux_error("Error opening '%s': %s", ffm->params.printable_file.array, av_err2str(ret));
 
 		av_dict_free(&dict);
 
@@ -957,19 +1003,19 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 		output_format = av_guess_format(NULL, ffm->params.file, NULL);
 
 	if (output_format == NULL) {
-		fprintf(stderr, "Couldn't find an appropriate muxer for '%s'\n", ffm->params.printable_file.array);
+		mux_error("Couldn't find an appropriate muxer for '%s'\n", ffm->params.printable_file.array);
 		return FFM_ERROR;
 	}
 
 #ifdef ENABLE_FFMPEG_MUX_DEBUG
-	printf("info: Output format name and long_name: %s, %s\n",
+	mux_print("info: Output format name and long_name: %s, %s\n",
 	       output_format->name ? output_format->name : "unknown",
 	       output_format->long_name ? output_format->long_name : "unknown");
 #endif
 
 	ret = avformat_alloc_output_context2(&ffm->output, output_format, NULL, ffm->params.file);
 	if (ret < 0) {
-		fprintf(stderr, "Couldn't initialize output context: %s\n", av_err2str(ret));
+		mux_error("Couldn't initialize output context: %s\n", av_err2str(ret));
 		return FFM_ERROR;
 	}
 
@@ -987,20 +1033,23 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 	return FFM_SUCCESS;
 }
 
-static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc, char *argv[])
+static bool ffmpeg_mux_init_params(struct ffmpeg_mux *ffm, int argc, char *argv[])
 {
 	argc--;
 	argv++;
 	if (!init_params(&argc, &argv, &ffm->params, &ffm->audio))
-		return FFM_ERROR;
+		return false;
 
 	if (ffm->params.tracks) {
 		ffm->audio_header = calloc(ffm->params.tracks, sizeof(*ffm->audio_header));
 	}
 
-	if (!ffmpeg_mux_get_extra_data(ffm))
-		return FFM_ERROR;
+	return true;
+}
 
+/* the headers have to be set by now */
+static int ffmpeg_mux_open(struct ffmpeg_mux *ffm)
+{
 	ffm->packet = av_packet_alloc();
 
 	/* ffmpeg does not have a way of telling what's supported
@@ -1008,6 +1057,18 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc, char *argv
 	return ffmpeg_mux_init_context(ffm);
 }
 
+#ifndef FFMPEG_MUX_LIBRARY
+static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc, char *argv[])
+{
+	if (!ffmpeg_mux_init_params(ffm, argc, argv))
+		return FFM_ERROR;
+
+	if (!ffmpeg_mux_get_extra_data(ffm))
+		return FFM_ERROR;
+
+	return ffmpeg_mux_open(ffm);
+}
+
 static int ffmpeg_mux_init(struct ffmpeg_mux *ffm, int argc, char *argv[])
 {
 	int ret = ffmpeg_mux_init_internal(ffm, argc, argv);
@@ -1019,6 +1080,7 @@ static int ffmpeg_mux_init(struct ffmpeg_mux *ffm, int argc, char *argv[])
 	ffm->initialized = true;
 	return ret;
 }
+#endif
 
 static inline int get_index(struct ffmpeg_mux *ffm, struct ffm_packet_info *info)
 {
@@ -1091,14 +1153,52 @@ static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf, struc
 	}
 
 	if (ret < 0) {
-		fprintf(stderr, "av_interleaved_write_frame failed: %d: %s\n", ret, av_err2str(ret));
+		mux_error("av_interleaved_write_frame failed: %d: %s\n", ret, av_err2str(ret));
 	}
 
 	return ret >= 0;
 }
 
-static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size, struct resize_buf *filename, int argc,
-				    char **argv)
+#ifndef FFMPEG_MUX_LIBRARY
+/* Writing the trailer can take a while, e.g. when the index has to be moved
+ * to the front of the file, so the file that is done is finished on a thread
+ * of its own while the next one is already being written. */
+struct mux_closer {
+	struct ffmpeg_mux *ffm;
+	pthread_t thread;
+	bool active;
+};
+
+static void *close_thread(void *data)
+{
+	struct mux_closer *closer = data;
+
+	ffmpeg_mux_free(closer->ffm);
+	free(closer->ffm);
+	return NULL;
+}
+
+static void mux_closer_wait(struct mux_closer *closer)
+{
+	if (closer->active) {
+		pthread_join(closer->thread, NULL);
+		closer->active = false;
+	}
+}
+
+static void mux_closer_start(struct mux_closer *closer, struct ffmpeg_mux *ffm)
+{
+	/* files are split minutes apart, the last one is long done */
+	mux_closer_wait(closer);
+
+	closer->ffm = ffm;
+	closer->active = pthread_create(&closer->thread, NULL, close_thread, closer) == 0;
+	if (!closer->active)
+		close_thread(closer);
+}
+
+static inline bool read_change_file(struct ffmpeg_mux **ffm, struct mux_closer *closer, uint32_t size,
+				    struct resize_buf *filename, int argc, char **argv)
 {
 	resize_buf_resize(filename, size + 1);
 	if (safe_read(filename->buf, size) != size) {
@@ -1114,16 +1214,17 @@ static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size, struc
 	char *argv1_backup = argv[1];
 	argv[1] = (char *)filename->buf;
 
-	ffmpeg_mux_free(ffm);
+	mux_closer_start(closer, *ffm);
+	*ffm = calloc(1, sizeof(struct ffmpeg_mux));
+
+	ret = ffmpeg_mux_init(*ffm, argc, argv);
+	argv[1] = argv1_backup;
 
-	ret = ffmpeg_mux_init(ffm, argc, argv);
 	if (ret != FFM_SUCCESS) {
 		fprintf(stderr, "Couldn't initialize muxer\n");
 		return false;
 	}
 
-	argv[1] = argv1_backup;
-
 	return true;
 }
 
@@ -1136,9 +1237,11 @@ int main(int argc, char *argv[])
 #endif
 {
 	struct ffm_packet_info info = {0};
-	struct ffmpeg_mux ffm = {0};
+	struct ffmpeg_mux *ffm = calloc(1, sizeof(struct ffmpeg_mux));
+	struct mux_closer closer = {0};
 	struct resize_buf rb = {0};
 	struct resize_buf rb_filename = {0};
+	struct ffm_ring *ring = NULL;
 	bool fail = false;
 	int ret;
 
@@ -1162,28 +1265,44 @@ int main(int argc, char *argv[])
 #endif
 	setvbuf(stderr, NULL, _IONBF, 0);
 
-	ret = ffmpeg_mux_init(&ffm, argc, argv);
+	ret = ffmpeg_mux_init(ffm, argc, argv);
 	if (ret != FFM_SUCCESS) {
 		fprintf(stderr, "Couldn't initialize muxer\n");
 		return ret;
 	}
 
+	/* without it everything just keeps coming through the pipe */
+	if (ffm->params.ring_name && *ffm->params.ring_name)
+		ring = ffm_ring_open(ffm->params.ring_name);
+
 	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
 		if (info.type == FFM_PACKET_CHANGE_FILE) {
-			fail = !read_change_file(&ffm, info.size, &rb_filename, argc, argv);
+			fail = !read_change_file(&ffm, &closer, info.size, &rb_filename, argc, argv);
+			continue;
+		}
+
+		if (info.in_ring) {
+			uint8_t *data = ring ? ffm_ring_data(ring, info.ring_pos, info.size) : NULL;
+
+			fail = !data || !ffmpeg_mux_packet(ffm, data, &info);
+			if (data)
+				ffm_ring_release(ring, info.ring_pos, info.size);
 			continue;
 		}
 
 		resize_buf_resize(&rb, info.size);
 
 		if (safe_read(rb.buf, info.size) == info.size) {
-			fail = !ffmpeg_mux_packet(&ffm, rb.buf, &info);
+			fail = !ffmpeg_mux_packet(ffm, rb.buf, &info);
 		} else {
 			fail = true;
 		}
 	}
 
-	ffmpeg_mux_free(&ffm);
+	ffmpeg_mux_free(ffm);
+	free(ffm);
+	mux_closer_wait(&closer);
+	ffm_ring_destroy(ring);
 	resize_buf_free(&rb);
 	resize_buf_free(&rb_filename);
 
@@ -1194,3 +1313,58 @@ int main(int argc, char *argv[])
 #endif
 	return 0;
 }
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef FFMPEG_MUX_LIBRARY
+struct ffmpeg_mux *ffm_mux_create(int argc, char *argv[])
+{
+	struct ffmpeg_mux *ffm = calloc(1, sizeof(*ffm));
+
+	mux_last_error[0] = 0;
+
+	if (!ffmpeg_mux_init_params(ffm, argc, argv)) {
+		ffmpeg_mux_free(ffm);
+		free(ffm);
+		return NULL;
+	}
+
+	return ffm;
+}
+
+int ffm_mux_headers_needed(const struct ffmpeg_mux *ffm)
+{
+	return ffm->params.has_video + ffm->params.tracks;
+}
+
+void ffm_mux_set_header(struct ffmpeg_mux *ffm, uint8_t *data, struct ffm_packet_info *info)
+{
+	ffmpeg_mux_header(ffm, data, info);
+}
+
+int ffm_mux_open(struct ffmpeg_mux *ffm)
+{
+	int ret = ffmpeg_mux_open(ffm);
+	ffm->initialized = ret == FFM_SUCCESS;
+	return ret;
+}
+
+bool ffm_mux_write(struct ffmpeg_mux *ffm, uint8_t *data, struct ffm_packet_info *info)
+{
+	return ffmpeg_mux_packet(ffm, data, info);
+}
+
+void ffm_mux_destroy(struct ffmpeg_mux *ffm)
+{
+	if (ffm) {
+		ffmpeg_mux_free(ffm);
+		free(ffm);
+	}
+}
+
+const char *ffm_mux_last_error(void)
+{
+	return mux_last_error;
+}
+#endif
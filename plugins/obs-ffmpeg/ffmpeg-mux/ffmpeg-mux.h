@@ -36,4 +36,23 @@ struct ffm_packet_info {
 	uint32_t index;
 	enum ffm_packet_type type;
 	bool keyframe;
+	/* the data is in the shared memory ring at ring_pos rather than
+	 * following in the pipe */
+	bool in_ring;
+	uint32_t ring_pos;
 };
+
+#ifdef FFMPEG_MUX_LIBRARY
+/* muxing in-process, in the order the pipe would take it: create with the
+ * same arguments the process gets, set its headers, open, write packets.
+ * ffm_mux_last_error is the last error on the calling thread */
+struct ffmpeg_mux;
+
+struct ffmpeg_mux *ffm_mux_create(int argc, char *argv[]);
+int ffm_mux_headers_needed(const struct ffmpeg_mux *ffm);
+void ffm_mux_set_header(struct ffmpeg_mux *ffm, uint8_t *data, struct ffm_packet_info *info);
+int ffm_mux_open(struct ffmpeg_mux *ffm);
+bool ffm_mux_write(struct ffmpeg_mux *ffm, uint8_t *data, struct ffm_packet_info *info);
+void ffm_mux_destroy(struct ffmpeg_mux *ffm);
+const char *ffm_mux_last_error(void);
+#endif
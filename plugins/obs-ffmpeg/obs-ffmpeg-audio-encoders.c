@@ -344,13 +344,10 @@ static void *flac_create(obs_data_t *settings, obs_encoder_t *encoder)
 	return enc_create(settings, encoder, "flac", NULL, AV_SAMPLE_FMT_S16);
 }
 
-static bool do_encode(struct enc_encoder *enc, struct encoder_packet *packet, bool *received_packet)
+static bool send_frame(struct enc_encoder *enc)
 {
-	AVRational time_base = {1, enc->context->sample_rate};
-	AVPacket avpacket = {0};
-	int got_packet;
-	int ret;
 	int channels;
+	int ret;
 
 	enc->aframe->nb_samples = enc->frame_size;
 	enc->aframe->pts =
@@ -367,28 +364,42 @@ static bool do_encode(struct enc_encoder *enc, struct encoder_packet *packet, bo
 	enc->total_samples += enc->frame_size;
 
 	ret = avcodec_send_frame(enc->context, enc->aframe);
-	if (ret == 0)
-		ret = avcodec_receive_packet(enc->context, &avpacket);
+	if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
+		ret = 0;
+	if (ret < 0) {
+		warn("avcodec_send_frame failed: %s", av_err2str(ret));
+		return false;
+	}
 
-	got_packet = (ret == 0);
+	return true;
+}
+
+/* appends the packet data to packet_buffer, packet->data is left for the
+ * caller to set once the buffer is done growing */
+static bool receive_packet(struct enc_encoder *enc, struct encoder_packet *packet, bool *received_packet)
+{
+	AVRational time_base = {1, enc->context->sample_rate};
+	AVPacket avpacket = {0};
+	int ret;
+
+	ret = avcodec_receive_packet(enc->context, &avpacket);
+
+	*received_packet = (ret == 0);
 
 	if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
 		ret = 0;
 	if (ret < 0) {
-		warn("avcodec_encode_audio2 failed: %s", av_err2str(ret));
+		warn("avcodec_receive_packet failed: %s", av_err2str(ret));
 		return false;
 	}
 
-	*received_packet = !!got_packet;
-	if (!got_packet)
+	if (!*received_packet)
 		return true;
 
-	da_resize(enc->packet_buffer, 0);
 	da_push_back_array(enc->packet_buffer, avpacket.data, avpacket.size);
 
 	packet->pts = rescale_ts(avpacket.pts, enc->context, time_base);
 	packet->dts = rescale_ts(avpacket.dts, enc->context, time_base);
-	packet->data = enc->packet_buffer.array;
 	packet->size = avpacket.size;
 	packet->type = OBS_ENCODER_AUDIO;
 	packet->keyframe = true;
@@ -398,6 +409,21 @@ static bool do_encode(struct enc_encoder *enc, struct encoder_packet *packet, bo
 	return true;
 }
 
+static bool do_encode(struct enc_encoder *enc, struct encoder_packet *packet, bool *received_packet)
+{
+	*received_packet = false;
+
+	if (!send_frame(enc))
+		return false;
+
+	da_resize(enc->packet_buffer, 0);
+	if (!receive_packet(enc, packet, received_packet))
+		return false;
+
+	packet->data = enc->packet_buffer.array;
+	return true;
+}
+
 static bool enc_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet, bool *received_packet)
 {
 	struct enc_encoder *enc = data;
@@ -408,6 +434,47 @@ static bool enc_encode(void *data, struct encoder_frame *frame, struct encoder_p
 	return do_encode(enc, packet, received_packet);
 }
 
+static bool enc_encode_batch(void *data, struct encoder_frame *frame, struct encoder_packet *packets,
+			     size_t *num_packets)
+{
+	struct enc_encoder *enc = data;
+	size_t frames = frame->frames / enc->frame_size;
+	size_t capacity = *num_packets;
+	size_t count = 0;
+	size_t offset = 0;
+
+	*num_packets = 0;
+	da_resize(enc->packet_buffer, 0);
+
+	for (size_t f = 0; f < frames; f++) {
+		for (size_t i = 0; i < enc->audio_planes; i++)
+			memcpy(enc->samples[i], frame->data[i] + f * enc->frame_size_bytes, enc->frame_size_bytes);
+
+		if (!send_frame(enc))
+			return false;
+
+		while (count < capacity) {
+			bool received;
+
+			if (!receive_packet(enc, &packets[count], &received))
+				return false;
+			if (!received)
+				break;
+			count++;
+		}
+	}
+
+	/* packet data was appended in order, so each packet starts where
+	 * the previous one ends */
+	for (size_t i = 0; i < count; i++) {
+		packets[i].data = enc->packet_buffer.array + offset;
+		offset += packets[i].size;
+	}
+
+	*num_packets = count;
+	return true;
+}
+
 static void enc_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_int(settings, "bitrate", 128);
@@ -464,11 +531,13 @@ struct obs_encoder_info aac_encoder_info = {
 	.create = aac_create,
 	.destroy = enc_destroy,
 	.encode = enc_encode,
+	.encode_audio_batch = enc_encode_batch,
 	.get_frame_size = enc_frame_size,
 	.get_defaults = enc_defaults,
 	.get_properties = enc_properties,
 	.get_extra_data = enc_extra_data,
 	.get_audio_info = enc_audio_info,
+	.caps = OBS_ENCODER_CAP_AUDIO_BATCH,
 };
 
 struct obs_encoder_info opus_encoder_info = {
@@ -479,11 +548,13 @@ struct obs_encoder_info opus_encoder_info = {
 	.create = opus_create,
 	.destroy = enc_destroy,
 	.encode = enc_encode,
+	.encode_audio_batch = enc_encode_batch,
 	.get_frame_size = enc_frame_size,
 	.get_defaults = enc_defaults,
 	.get_properties = enc_properties,
 	.get_extra_data = enc_extra_data,
 	.get_audio_info = enc_audio_info,
+	.caps = OBS_ENCODER_CAP_AUDIO_BATCH,
 };
 
 struct obs_encoder_info pcm_encoder_info = {
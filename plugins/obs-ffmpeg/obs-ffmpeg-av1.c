@@ -130,6 +130,8 @@ static bool av1_update(struct av1_encoder *enc, obs_data_t *settings)
 
 	const char *ffmpeg_opts = obs_data_get_string(settings, "ffmpeg_opts");
 	ffmpeg_video_encoder_update(&enc->ffve, bitrate, keyint_sec, voi, &info, ffmpeg_opts);
+	const char *cpu_affinity = obs_data_get_string(settings, "cpu_affinity");
+	ffmpeg_video_encoder_set_affinity(&enc->ffve, cpu_affinity);
 	av_dict_free(&svtav1_opts);
 
 	info("settings:\n"
@@ -141,9 +143,10 @@ static bool av1_update(struct av1_encoder *enc, obs_data_t *settings)
 	     "\tpreset:       %d\n"
 	     "\twidth:        %d\n"
 	     "\theight:       %d\n"
-	     "\tffmpeg opts:  %s\n",
+	     "\tffmpeg opts:  %s\n"
+	     "\tcpu affinity: %s\n",
 	     enc->ffve.enc_name, rc, bitrate, cqp, enc->ffve.context->gop_size, preset, enc->ffve.context->width,
-	     enc->ffve.height, ffmpeg_opts);
+	     enc->ffve.height, ffmpeg_opts, enc->ffve.pin_threads ? cpu_affinity : "any");
 
 	enc->ffve.context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 	return ffmpeg_video_encoder_init_codec(&enc->ffve);
@@ -293,6 +296,9 @@ obs_properties_t *av1_properties(enum av1_encoder_type type)
 
 	obs_properties_add_text(props, "ffmpeg_opts", obs_module_text("FFmpegOpts"), OBS_TEXT_DEFAULT);
 
+	p = obs_properties_add_text(props, "cpu_affinity", obs_module_text("CPUAffinity"), OBS_TEXT_DEFAULT);
+	obs_property_set_long_description(p, obs_module_text("CPUAffinity.ToolTip"));
+
 	return props;
 }
 
@@ -36,7 +36,7 @@ void ffmpeg_hls_mux_destroy(void *data)
 		da_free(stream->mux_packets);
 		deque_free(&stream->packets);
 
-		os_process_pipe_destroy(stream->pipe);
+		stop_pipe(stream);
 		dstr_free(&stream->path);
 		dstr_free(&stream->printable_path);
 		dstr_free(&stream->stream_key);
@@ -143,10 +143,10 @@ bool ffmpeg_hls_mux_start(void *data)
 
 	obs_data_release(settings);
 
-	start_pipe(stream, path.array);
+	bool started = start_pipe(stream, path.array);
 	dstr_free(&path);
 
-	if (!stream->pipe) {
+	if (!started) {
 		obs_output_set_last_error(stream->output, obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
 		return false;
@@ -21,6 +21,7 @@
 #include <util/dstr.h>
 #include <util/darray.h>
 #include <util/platform.h>
+#include <util/util_uint64.h>
 
 #include "obs-ffmpeg-output.h"
 #include "obs-ffmpeg-formats.h"
@@ -356,7 +357,137 @@ typedef int (*write_packet_cb)(void *, const uint8_t *, int);
 typedef int (*write_packet_cb)(void *, uint8_t *, int);
 #endif
 
-static inline int allocate_custom_aviocontext(struct ffmpeg_output *stream, bool is_rist)
+/* SRT's default bandwidth overhead for retransmissions */
+#define PACE_OVERHEAD_PERCENT 25
+/* how far the writes may run ahead of the pacing rate */
+#define PACE_BURST_MSEC 10
+
+#define STATS_INTERVAL_NS 1000000000ULL
+/* 10% loss or retransmissions counts as fully congested */
+#define LOSS_CONGESTION_SCALE 10.0
+/* SRT's default latency */
+#define SRT_DEFAULT_LATENCY_MS 120
+
+/* Paces at SRT's maxbw when one is set in the URL, otherwise at the stream
+ * bitrate plus the retransmission overhead, so that a keyframe goes out
+ * over a few frame intervals instead of in one burst. */
+static void init_pacing(struct ffmpeg_output *stream)
+{
+	struct ffmpeg_cfg *config = &stream->ff_data.config;
+	int overhead = PACE_OVERHEAD_PERCENT;
+	uint64_t rate = 0;
+
+	if (config->is_srt) {
+		SRTContext *s = stream->h->priv_data;
+
+		if (s->maxbw > 0)
+			rate = (uint64_t)s->maxbw;
+		else if (s->oheadbw >= 0)
+			overhead = s->oheadbw;
+	}
+
+	if (!rate) {
+		uint64_t kbps = config->video_bitrate > 0 ? config->video_bitrate : 0;
+
+		for (int idx = 0; idx < config->audio_mix_count; idx++) {
+			if (config->audio_bitrates[idx] > 0)
+				kbps += config->audio_bitrates[idx];
+		}
+
+		/* without a video bitrate there's nothing to pace at */
+		if (config->video_bitrate > 0)
+			rate = kbps * 1000 / 8 * (100 + overhead) / 100;
+	}
+
+	stream->pace_rate = rate;
+	stream->pace_burst = (int64_t)(rate * PACE_BURST_MSEC / 1000);
+	if (stream->pace_burst < UDP_DEFAULT_PAYLOAD_SIZE)
+		stream->pace_burst = UDP_DEFAULT_PAYLOAD_SIZE;
+	stream->pace_tokens = stream->pace_burst;
+	stream->pace_last_ns = os_gettime_ns();
+
+	stream->stats_last_ns = stream->pace_last_ns;
+	stream->congestion = 0.0f;
+
+	if (rate)
+		info("Pacing output at %" PRIu64 " kbps", rate * 8 / 1000);
+}
+
+static void pace_write(struct ffmpeg_output *stream, int size)
+{
+	uint64_t now;
+
+	if (!stream->pace_rate)
+		return;
+
+	now = os_gettime_ns();
+	stream->pace_tokens += (int64_t)util_mul_div64(now - stream->pace_last_ns, stream->pace_rate, 1000000000ULL);
+	stream->pace_last_ns = now;
+
+	if (stream->pace_tokens > stream->pace_burst)
+		stream->pace_tokens = stream->pace_burst;
+
+	stream->pace_tokens -= size;
+
+	if (stream->pace_tokens < 0) {
+		uint64_t wait = util_mul_div64((uint64_t)-stream->pace_tokens, 1000000000ULL, stream->pace_rate);
+		os_sleepto_ns_fast(now + wait);
+	}
+}
+
+static inline float clamp_congestion(double val)
+{
+	return val > 1.0 ? 1.0f : (val < 0.0 ? 0.0f : (float)val);
+}
+
+/* congestion is whichever is worse: how much of the latency window the
+ * send buffer fills, or the loss rate of the last interval */
+static void update_congestion(struct ffmpeg_output *stream)
+{
+	uint64_t now = os_gettime_ns();
+
+	if (now - stream->stats_last_ns < STATS_INTERVAL_NS)
+		return;
+	stream->stats_last_ns = now;
+
+	if (stream->ff_data.config.is_srt) {
+		SRTContext *s = stream->h->priv_data;
+		int latency_ms = s->latency >= 0 ? (int)(s->latency / 1000) : SRT_DEFAULT_LATENCY_MS;
+		SRT_TRACEBSTATS perf = {0};
+		double buffered, loss;
+
+		if (srt_bstats(s->fd, &perf, 1) < 0)
+			return;
+
+		buffered = latency_ms > 0 ? (double)perf.msSndBuf / latency_ms : 0.0;
+		loss = perf.pktSent ? (double)(perf.pktSndLoss + perf.pktRetrans) / perf.pktSent : 0.0;
+		loss *= LOSS_CONGESTION_SCALE;
+
+		stream->congestion = clamp_congestion(buffered > loss ? buffered : loss);
+	} else {
+		RISTContext *s = stream->h->priv_data;
+		double loss = (100.0 - s->quality) / 100.0 * LOSS_CONGESTION_SCALE;
+
+		stream->congestion = clamp_congestion(loss);
+	}
+}
+
+static int mpegts_url_write(void *opaque, const uint8_t *buf, int size)
+{
+	struct ffmpeg_output *stream = opaque;
+
+	if (!stream->h)
+		return AVERROR(EIO);
+
+	pace_write(stream, size);
+	update_congestion(stream);
+
+	if (stream->ff_data.config.is_rist)
+		return librist_write(stream->h, buf, size);
+	return libsrt_write(stream->h, buf, size);
+}
+
+static inline int allocate_custom_aviocontext(struct ffmpeg_output *stream)
 {
 	/* allocate buffers */
 	uint8_t *buffer = NULL;
@@ -370,19 +501,16 @@ static inline int allocate_custom_aviocontext(struct ffmpeg_output *stream, bool
 	if (!buffer)
 		return AVERROR(ENOMEM);
 	/* allocate custom avio_context */
-	if (is_rist)
-		s = avio_alloc_context(buffer, buffer_size, AVIO_FLAG_WRITE, h, NULL, (write_packet_cb)librist_write,
-				       NULL);
-	else
-		s = avio_alloc_context(buffer, buffer_size, AVIO_FLAG_WRITE, h, NULL, (write_packet_cb)libsrt_write,
-				       NULL);
+	s = avio_alloc_context(buffer, buffer_size, AVIO_FLAG_WRITE, stream, NULL, (write_packet_cb)mpegts_url_write,
+			       NULL);
 	if (!s)
 		goto fail;
 	s->max_packet_size = h->max_packet_size;
-	s->opaque = h;
 	stream->s = s;
 	stream->ff_data.output->pb = s;
 
+	init_pacing(stream);
+
 	return 0;
 fail:
 	av_freep(&buffer);
@@ -466,7 +594,7 @@ static inline int open_output_file(struct ffmpeg_output *stream, struct ffmpeg_d
 		}
 		av_dict_free(&dict);
 	} else {
-		ret = allocate_custom_aviocontext(stream, rist);
+		ret = allocate_custom_aviocontext(stream);
 		if (ret < 0) {
 			info("Couldn't allocate custom avio_context for url: '%s', %s", data->config.url,
 			     av_err2str(ret));
@@ -513,6 +641,7 @@ static void close_mpegts_url(struct ffmpeg_output *stream, bool is_rist)
 	}
 	av_freep(&h->priv_data);
 	av_freep(h);
+	stream->h = NULL;
 
 	/* close custom avio_context for srt or rist */
 	AVIOContext *s = stream->s;
@@ -1027,6 +1156,12 @@ static uint64_t ffmpeg_mpegts_total_bytes(void *data)
 	return output->total_bytes;
 }
 
+static float ffmpeg_mpegts_congestion(void *data)
+{
+	struct ffmpeg_output *output = data;
+	return output->active ? output->congestion : 0.0f;
+}
+
 static inline int64_t rescale_ts2(AVStream *stream, AVRational codec_time_base, int64_t val)
 {
 	return av_rescale_q_rnd(val / codec_time_base.num, codec_time_base, stream->time_base,
@@ -1198,5 +1333,6 @@ struct obs_output_info ffmpeg_mpegts_muxer = {
 	.stop = ffmpeg_mpegts_stop,
 	.encoded_packet = ffmpeg_mpegts_data,
 	.get_total_bytes = ffmpeg_mpegts_total_bytes,
+	.get_congestion = ffmpeg_mpegts_congestion,
 	.get_properties = ffmpeg_mpegts_properties,
 };
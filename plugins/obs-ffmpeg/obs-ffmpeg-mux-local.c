@@ -0,0 +1,316 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Muxes on a thread of its own with the code of obs-ffmpeg-mux, rather
+ * than piping every packet to that process.  The packets are only
+ * referenced, and the queue is bounded so that the output still blocks
+ * like it would on a full pipe when the disk can't keep up. */
+
+#include "ffmpeg-mux/ffmpeg-mux.h"
+#include "obs-ffmpeg-mux.h"
+
+/* about four seconds of 4K 150 Mbps video */
+#define LOCAL_MUX_MAX_BYTES (64 * 1024 * 1024)
+
+struct local_mux_entry {
+	struct ffm_packet_info info;
+	/* referenced packet, or data copied for what isn't reference
+	 * counted: headers and file names */
+	struct encoder_packet packet;
+	uint8_t *data;
+	bool stop;
+};
+
+struct local_mux {
+	/* the arguments obs-ffmpeg-mux would get, with the file name
+	 * pointing to file after a file change */
+	os_process_args_t *args;
+	char **argv;
+	int argc;
+	struct dstr file;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	os_event_t *space_event;
+	struct deque queue;
+	size_t queued_bytes;
+
+	volatile bool failed;
+	int result;
+	char error[1024];
+
+	/* the file before a file change, finishing on a thread of its own */
+	struct ffmpeg_mux *closing;
+	pthread_t close_thread;
+	bool close_thread_active;
+};
+
+static inline void free_entry(struct local_mux_entry *entry)
+{
+	if (entry->packet.data)
+		obs_encoder_packet_release(&entry->packet);
+	bfree(entry->data);
+}
+
+static inline const uint8_t *entry_data(const struct local_mux_entry *entry)
+{
+	return entry->data ? entry->data : entry->packet.data;
+}
+
+static void set_failed(struct local_mux *mux, int result)
+{
+	mux->result = result;
+	strncpy(mux->error, ffm_mux_last_error(), sizeof(mux->error) - 1);
+	os_atomic_set_bool(&mux->failed, true);
+
+	/* nothing will be written anymore, so don't keep the output waiting */
+	os_event_signal(mux->space_event);
+}
+
+static struct ffmpeg_mux *create_mux(struct local_mux *mux, int *headers_needed)
+{
+	struct ffmpeg_mux *ffm = ffm_mux_create(mux->argc, mux->argv);
+
+	if (!ffm) {
+		set_failed(mux, FFM_ERROR);
+		return NULL;
+	}
+
+	*headers_needed = ffm_mux_headers_needed(ffm);
+	return ffm;
+}
+
+static void *close_thread(void *data)
+{
+	struct local_mux *mux = data;
+
+	os_set_thread_name("obs-ffmpeg: in-process mux close");
+	ffm_mux_destroy(mux->closing);
+	return NULL;
+}
+
+static void wait_closed(struct local_mux *mux)
+{
+	if (mux->close_thread_active) {
+		pthread_join(mux->close_thread, NULL);
+		mux->close_thread_active = false;
+	}
+
+	mux->closing = NULL;
+}
+
+/* writing the trailer can take a while, the next file doesn't have to wait
+ * for it */
+static void close_async(struct local_mux *mux, struct ffmpeg_mux *ffm)
+{
+	wait_closed(mux);
+
+	mux->closing = ffm;
+	mux->close_thread_active = pthread_create(&mux->close_thread, NULL, close_thread, mux) == 0;
+	if (!mux->close_thread_active)
+		ffm_mux_destroy(ffm);
+}
+
+/* the same as obs-ffmpeg-mux does with what it reads: the headers come
+ * first, and again after each file change */
+static struct ffmpeg_mux *process_entry(struct local_mux *mux, struct ffmpeg_mux *ffm, int *headers_needed,
+					struct local_mux_entry *entry)
+{
+	uint8_t *data = (uint8_t *)entry_data(entry);
+
+	if (entry->info.type == FFM_PACKET_CHANGE_FILE) {
+		close_async(mux, ffm);
+
+		dstr_copy(&mux->file, (const char *)data);
+		mux->argv[1] = mux->file.array;
+		return create_mux(mux, headers_needed);
+	}
+
+	if (*headers_needed) {
+		ffm_mux_set_header(ffm, data, &entry->info);
+
+		if (--(*headers_needed) == 0) {
+			int ret = ffm_mux_open(ffm);
+			if (ret != FFM_SUCCESS)
+				set_failed(mux, ret);
+		}
+		return ffm;
+	}
+
+	if (!ffm_mux_write(ffm, data, &entry->info))
+		set_failed(mux, FFM_ERROR);
+	return ffm;
+}
+
+static void *local_mux_thread(void *data)
+{
+	struct local_mux *mux = data;
+	struct ffmpeg_mux *ffm;
+	int headers_needed = 0;
+
+	os_set_thread_name("obs-ffmpeg: in-process mux");
+
+	ffm = create_mux(mux, &headers_needed);
+
+	for (;;) {
+		struct local_mux_entry entry;
+
+		os_sem_wait(mux->sem);
+
+		pthread_mutex_lock(&mux->mutex);
+		deque_pop_front(&mux->queue, &entry, sizeof(entry));
+		mux->queued_bytes -= entry.info.size;
+		pthread_mutex_unlock(&mux->mutex);
+
+		os_event_signal(mux->space_event);
+
+		if (entry.stop)
+			break;
+
+		if (!os_atomic_load_bool(&mux->failed))
+			ffm = process_entry(mux, ffm, &headers_needed, &entry);
+		free_entry(&entry);
+	}
+
+	/* writes the trailer */
+	ffm_mux_destroy(ffm);
+	wait_closed(mux);
+	return NULL;
+}
+
+static void push_entry(struct local_mux *mux, struct local_mux_entry *entry)
+{
+	pthread_mutex_lock(&mux->mutex);
+
+	/* the stop always goes in, it's what gets the thread to finish */
+	while (!entry->stop && mux->queued_bytes && mux->queued_bytes + entry->info.size > LOCAL_MUX_MAX_BYTES &&
+	       !os_atomic_load_bool(&mux->failed)) {
+		pthread_mutex_unlock(&mux->mutex);
+		os_event_wait(mux->space_event);
+		pthread_mutex_lock(&mux->mutex);
+	}
+
+	deque_push_back(&mux->queue, entry, sizeof(*entry));
+	mux->queued_bytes += entry->info.size;
+	pthread_mutex_unlock(&mux->mutex);
+
+	os_sem_post(mux->sem);
+}
+
+struct local_mux *local_mux_create(os_process_args_t *args)
+{
+	struct local_mux *mux = bzalloc(sizeof(*mux));
+	char **argv = os_process_args_get_argv(args);
+
+	mux->args = args;
+	mux->argc = (int)os_process_args_get_argc(args);
+	mux->argv = bmemdup(argv, (mux->argc + 1) * sizeof(char *));
+
+	pthread_mutex_init_value(&mux->mutex);
+	if (pthread_mutex_init(&mux->mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&mux->sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&mux->space_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (pthread_create(&mux->thread, NULL, local_mux_thread, mux) != 0)
+		goto fail;
+
+	return mux;
+
+fail:
+	os_event_destroy(mux->space_event);
+	os_sem_destroy(mux->sem);
+	pthread_mutex_destroy(&mux->mutex);
+	bfree(mux->argv);
+	bfree(mux);
+	return NULL;
+}
+
+bool local_mux_write(struct local_mux *mux, const struct ffm_packet_info *info, struct encoder_packet *packet,
+		     bool copy)
+{
+	struct local_mux_entry entry = {.info = *info};
+
+	if (os_atomic_load_bool(&mux->failed))
+		return false;
+
+	if (copy)
+		entry.data = bmemdup(packet->data, packet->size);
+	else
+		obs_encoder_packet_ref(&entry.packet, packet);
+
+	push_entry(mux, &entry);
+	return true;
+}
+
+bool local_mux_change_file(struct local_mux *mux, const char *path)
+{
+	struct local_mux_entry entry = {.info = {.type = FFM_PACKET_CHANGE_FILE}};
+
+	if (os_atomic_load_bool(&mux->failed))
+		return false;
+
+	entry.data = (uint8_t *)bstrdup(path);
+	push_entry(mux, &entry);
+	return true;
+}
+
+size_t local_mux_get_error(struct local_mux *mux, char *error, size_t size)
+{
+	size_t len;
+
+	if (!os_atomic_load_bool(&mux->failed) || !size)
+		return 0;
+
+	len = strlen(mux->error);
+	if (len >= size)
+		len = size - 1;
+
+	memcpy(error, mux->error, len);
+	return len;
+}
+
+int local_mux_destroy(struct local_mux *mux)
+{
+	struct local_mux_entry entry = {.stop = true};
+	int result;
+
+	if (!mux)
+		return 0;
+
+	push_entry(mux, &entry);
+	pthread_join(mux->thread, NULL);
+
+	while (mux->queue.size) {
+		deque_pop_front(&mux->queue, &entry, sizeof(entry));
+		free_entry(&entry);
+	}
+
+	result = os_atomic_load_bool(&mux->failed) ? mux->result : FFM_SUCCESS;
+
+	deque_free(&mux->queue);
+	os_event_destroy(mux->space_event);
+	os_sem_destroy(mux->sem);
+	pthread_mutex_destroy(&mux->mutex);
+	os_process_args_destroy(mux->args);
+	dstr_free(&mux->file);
+	bfree(mux->argv);
+	bfree(mux);
+	return result;
+}
@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "ffmpeg-mux/ffmpeg-mux-ring.h"
 #include "obs-ffmpeg-mux.h"
 #include "obs-ffmpeg-formats.h"
 
@@ -44,6 +45,36 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 }
 #endif
 
+struct replay_gop *replay_gop_create(bool keyframe)
+{
+	struct replay_gop *gop = bzalloc(sizeof(*gop));
+	gop->refs = 1;
+	gop->keyframe = keyframe;
+	return gop;
+}
+
+void replay_gop_release(struct replay_gop *gop)
+{
+	if (!gop || os_atomic_dec_long(&gop->refs) != 0)
+		return;
+
+	/* its part of the spool file can be written over now */
+	if (gop->spilled)
+		replay_spool_free(gop->spool, gop);
+
+	for (size_t i = 0; i < gop->packets.num; i++)
+		obs_encoder_packet_release(&gop->packets.array[i]);
+	da_free(gop->packets);
+	bfree(gop);
+}
+
+static inline void release_save_gops(struct ffmpeg_muxer *stream)
+{
+	for (size_t i = 0; i < stream->save_gops.num; i++)
+		replay_gop_release(stream->save_gops.array[i]);
+	da_free(stream->save_gops);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
@@ -52,7 +83,18 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 		obs_encoder_packet_release(&pkt);
 	}
 
+	while (stream->gops.size > 0) {
+		struct replay_gop *gop;
+		deque_pop_front(&stream->gops, &gop, sizeof(gop));
+		replay_gop_release(gop);
+	}
+
 	deque_free(&stream->packets);
+	deque_free(&stream->gops);
+
+	/* a save would still read from it, it has to be done first */
+	replay_spool_destroy(stream->spool);
+	stream->spool = NULL;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -65,15 +107,16 @@ static void ffmpeg_mux_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 
-	replay_buffer_clear(stream);
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
+	replay_buffer_clear(stream);
 	for (size_t i = 0; i < stream->mux_packets.num; i++)
 		obs_encoder_packet_release(&stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
+	release_save_gops(stream);
 	deque_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -92,6 +135,27 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&stream->manual_split, true);
 }
 
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+/* The file is written by obs-ffmpeg-mux, what can be seen from here is how
+ * long handing it the packets took and how full the ring is */
+static void get_write_stats_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct ffm_ring *ring = stream->ring;
+
+	calldata_set_int(cd, "bytes_written", (long long)stream->total_bytes);
+	calldata_set_int(cd, "buffer_used", ring ? (long long)ffm_ring_used(ring) : 0);
+	calldata_set_int(cd, "buffer_peak", 0);
+	calldata_set_int(cd, "buffer_size", ring ? FFM_RING_SIZE : 0);
+	calldata_set_float(cd, "max_blocked_ms", ns_to_ms(stream->max_blocked_ns));
+	calldata_set_float(cd, "total_blocked_ms", ns_to_ms(stream->total_blocked_ns));
+	calldata_set_float(cd, "max_write_ms", 0.0);
+}
+
 static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
@@ -105,6 +169,11 @@ static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void split_file(out bool split_file_enabled)", split_file_proc, stream);
+	proc_handler_add(ph,
+			 "void get_write_stats(out int bytes_written, out int buffer_used, out int buffer_peak, "
+			 "out int buffer_size, out float max_blocked_ms, out float total_blocked_ms, "
+			 "out float max_write_ms)",
+			 get_write_stats_proc, stream);
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -302,12 +371,52 @@ static void build_command_line(struct ffmpeg_muxer *stream, os_process_args_t **
 	add_muxer_params(*args, stream);
 }
 
-void start_pipe(struct ffmpeg_muxer *stream, const char *path)
+bool start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
 	build_command_line(stream, &args, path);
+
+	if (stream->in_process) {
+		stream->local = local_mux_create(args);
+		if (stream->local)
+			return true;
+
+		warn("Failed to start muxing in-process, using obs-ffmpeg-mux");
+	}
+
+	/* just the pipe if the ring can't be created */
+	stream->ring = ffm_ring_create(FFM_RING_SIZE);
+	if (stream->ring)
+		os_process_args_add_arg(args, ffm_ring_name(stream->ring));
+
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
+
+	if (!stream->pipe) {
+		ffm_ring_destroy(stream->ring);
+		stream->ring = NULL;
+	}
+	return stream->pipe != NULL;
+}
+
+/* returns the exit code of obs-ffmpeg-mux, or what muxing in-process
+ * would have exited with */
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret;
+
+	if (stream->local)
+		ret = local_mux_destroy(stream->local);
+	else
+		ret = os_process_pipe_destroy(stream->pipe);
+
+	/* obs-ffmpeg-mux has exited, nothing reads from it anymore */
+	ffm_ring_destroy(stream->ring);
+
+	stream->local = NULL;
+	stream->pipe = NULL;
+	stream->ring = NULL;
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream, obs_data_t *settings, const char *path)
@@ -400,6 +509,7 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream, obs_da
 		stream->max_size = obs_data_get_int(settings, "max_size_mb") * (1024 * 1024);
 		stream->split_file = obs_data_get_bool(settings, "split_file");
 		stream->allow_overwrite = obs_data_get_bool(settings, "allow_overwrite");
+		stream->in_process = obs_data_get_bool(settings, "in_process");
 		stream->cur_size = 0;
 		stream->sent_headers = false;
 	}
@@ -422,9 +532,7 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream, obs_da
 		os_unlink(path);
 	}
 
-	start_pipe(stream, path);
-
-	if (!stream->pipe) {
+	if (!start_pipe(stream, path)) {
 		obs_output_set_last_error(stream->output, obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
 		return false;
@@ -435,6 +543,8 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream, obs_da
 	os_atomic_set_bool(&stream->capturing, true);
 	os_atomic_set_bool(&stream->stopping, false);
 	stream->total_bytes = 0;
+	stream->max_blocked_ns = 0;
+	stream->total_blocked_ns = 0;
 	obs_output_begin_data_capture(stream->output, 0);
 
 	info("Writing file '%s'...", stream->path.array);
@@ -466,8 +576,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -517,7 +626,10 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 
 	size_t len;
 
-	len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error, sizeof(error) - 1);
+	if (stream->local)
+		len = local_mux_get_error(stream->local, error, sizeof(error) - 1);
+	else
+		len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error, sizeof(error) - 1);
 
 	if (len > 0) {
 		error[len] = 0;
@@ -600,7 +712,9 @@ static void generate_filename(struct ffmpeg_muxer *stream, struct dstr *dst, boo
 	obs_data_release(settings);
 }
 
-bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+/* copy is for packets that aren't reference counted, only matters when
+ * muxing in-process */
+static bool write_packet_internal(struct ffmpeg_muxer *stream, struct encoder_packet *packet, bool copy)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
 	size_t ret;
@@ -622,20 +736,43 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
-		return false;
-	}
+	uint64_t start = os_gettime_ns();
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
-		return false;
+	if (stream->local) {
+		if (!local_mux_write(stream->local, &info, packet, copy)) {
+			warn("In-process muxing failed");
+			signal_failure(stream);
+			return false;
+		}
+	} else {
+		/* obs-ffmpeg-mux reads the headers on their own, they
+		 * always go through the pipe */
+		if (stream->ring && !copy)
+			info.in_ring = ffm_ring_write(stream->ring, packet->data, (uint32_t)packet->size,
+						      &info.ring_pos);
+
+		ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
+		if (ret != sizeof(info)) {
+			warn("os_process_pipe_write for info structure failed");
+			signal_failure(stream);
+			return false;
+		}
+
+		if (!info.in_ring) {
+			ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
+			if (ret != packet->size) {
+				warn("os_process_pipe_write for packet data failed");
+				signal_failure(stream);
+				return false;
+			}
+		}
 	}
 
+	uint64_t blocked_ns = os_gettime_ns() - start;
+	stream->total_blocked_ns += blocked_ns;
+	if (blocked_ns > stream->max_blocked_ns)
+		stream->max_blocked_ns = blocked_ns;
+
 	stream->total_bytes += packet->size;
 
 	if (stream->split_file)
@@ -644,13 +781,18 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 	return true;
 }
 
+bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	return write_packet_internal(stream, packet, false);
+}
+
 static bool send_audio_headers(struct ffmpeg_muxer *stream, obs_encoder_t *aencoder, size_t idx)
 {
 	struct encoder_packet packet = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1, .track_idx = idx};
 
 	if (!obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, true);
 }
 
 static bool send_video_headers(struct ffmpeg_muxer *stream)
@@ -661,7 +803,7 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 
 	if (!obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, true);
 }
 
 bool send_headers(struct ffmpeg_muxer *stream)
@@ -715,6 +857,15 @@ static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
 	uint32_t size = (uint32_t)strlen(filename);
 	struct ffm_packet_info info = {.type = FFM_PACKET_CHANGE_FILE, .size = size};
 
+	if (stream->local) {
+		if (!local_mux_change_file(stream->local, filename)) {
+			warn("In-process muxing failed");
+			signal_failure(stream);
+			return false;
+		}
+		return true;
+	}
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
 	if (ret != sizeof(info)) {
 		warn("os_process_pipe_write for info structure failed");
@@ -974,6 +1125,35 @@ static void replay_buffer_destroy(void *data)
 	ffmpeg_mux_destroy(data);
 }
 
+/* the spool file has room for the size limit, and for the intervals
+ * that are already purged but still being saved */
+static void create_replay_spool(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	const char *dir = obs_data_get_string(settings, "disk_directory");
+	struct dstr path = {0};
+
+	if (!stream->max_size) {
+		warn("Keeping the replay buffer on disk needs a size limit, keeping it in memory");
+		return;
+	}
+
+	if (!dir || !*dir)
+		dir = obs_data_get_string(settings, "directory");
+
+	dstr_copy(&path, dir);
+	dstr_replace(&path, "\\", "/");
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	os_mkdirs(path.array);
+	dstr_catf(&path, ".obs-replay-buffer-%p.spool", stream);
+
+	stream->spool = replay_spool_create(path.array, (uint64_t)stream->max_size + (uint64_t)stream->max_size / 2);
+	if (!stream->spool)
+		warn("Failed to create the replay buffer spool file, keeping it in memory");
+
+	dstr_free(&path);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -986,6 +1166,9 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	stream->in_process = obs_data_get_bool(s, "in_process");
+	if (obs_data_get_bool(s, "use_disk"))
+		create_replay_spool(stream, s);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -996,104 +1179,191 @@ static bool replay_buffer_start(void *data)
 	return true;
 }
 
-static bool purge_front(struct ffmpeg_muxer *stream)
+static void purge_front(struct ffmpeg_muxer *stream)
 {
-	struct encoder_packet pkt;
-	bool keyframe;
+	struct replay_gop *gop;
 
-	if (!stream->packets.size)
-		return false;
-
-	deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
-
-	keyframe = pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe;
+	deque_pop_front(&stream->gops, &gop, sizeof(gop));
 
-	if (keyframe)
+	if (gop->keyframe)
 		stream->keyframes--;
 
-	if (!stream->packets.size) {
+	if (!stream->gops.size) {
 		stream->cur_size = 0;
 		stream->cur_time = 0;
 	} else {
-		struct encoder_packet first;
-		deque_peek_front(&stream->packets, &first, sizeof(first));
-		stream->cur_time = first.dts_usec;
-		stream->cur_size -= (int64_t)pkt.size;
+		struct replay_gop *first;
+		deque_peek_front(&stream->gops, &first, sizeof(first));
+		stream->cur_time = first->packets.array[0].dts_usec;
+		stream->cur_size -= gop->size;
 	}
 
-	obs_encoder_packet_release(&pkt);
-	return keyframe;
-}
-
-static inline void purge(struct ffmpeg_muxer *stream)
-{
-	if (purge_front(stream)) {
-		struct encoder_packet pkt;
-
-		for (;;) {
-			if (!stream->packets.size)
-				return;
-			deque_peek_front(&stream->packets, &pkt, sizeof(pkt));
-			if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
-				return;
-
-			purge_front(stream);
-		}
-	}
+	replay_gop_release(gop);
 }
 
 static inline void replay_buffer_purge(struct ffmpeg_muxer *stream, struct encoder_packet *pkt)
 {
 	if (stream->max_size) {
-		if (!stream->packets.size || stream->keyframes <= 2)
+		if (!stream->gops.size || stream->keyframes <= 2)
 			return;
 
-		while ((stream->cur_size + (int64_t)pkt->size) > stream->max_size)
-			purge(stream);
+		while (stream->gops.size && (stream->cur_size + (int64_t)pkt->size) > stream->max_size)
+			purge_front(stream);
 	}
 
-	if (!stream->packets.size || stream->keyframes <= 2)
+	if (!stream->gops.size || stream->keyframes <= 2)
 		return;
 
-	while ((pkt->dts_usec - stream->cur_time) > stream->max_time)
-		purge(stream);
+	while (stream->gops.size && (pkt->dts_usec - stream->cur_time) > stream->max_time)
+		purge_front(stream);
 }
 
-static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet, int64_t video_offset,
-			  int64_t *audio_offsets, int64_t video_pts_offset, int64_t *audio_dts_offsets)
+static void replay_buffer_push(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 {
+	bool keyframe = packet->type == OBS_ENCODER_VIDEO && packet->keyframe;
+	struct replay_gop *gop = NULL;
 	struct encoder_packet pkt;
-	size_t idx;
+
+	if (!stream->gops.size)
+		stream->cur_time = packet->dts_usec;
+	else
+		deque_peek_back(&stream->gops, &gop, sizeof(gop));
+
+	if (!gop || keyframe) {
+		/* the one before is complete now */
+		if (gop && stream->spool)
+			replay_spool_push(stream->spool, gop);
+
+		gop = replay_gop_create(keyframe);
+		deque_push_back(&stream->gops, &gop, sizeof(gop));
+
+		if (keyframe)
+			stream->keyframes++;
+	}
 
 	obs_encoder_packet_ref(&pkt, packet);
+	da_push_back(gop->packets, &pkt);
+	gop->size += (int64_t)pkt.size;
+	stream->cur_size += (int64_t)pkt.size;
+}
+
+struct replay_packet {
+	struct encoder_packet packet;
+	/* where the data is in the spool file, if the packet has none */
+	uint64_t offset;
+};
+
+typedef DARRAY(struct replay_packet) replay_packets_t;
 
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_pts_offset;
-		pkt.pts -= video_pts_offset;
+static void insert_packet(replay_packets_t *packets, struct encoder_packet *packet, uint64_t offset,
+			  int64_t video_offset, int64_t *audio_offsets, int64_t video_pts_offset,
+			  int64_t *audio_dts_offsets)
+{
+	struct replay_packet entry = {.offset = offset};
+	struct encoder_packet *pkt = &entry.packet;
+	size_t idx;
+
+	obs_encoder_packet_ref(pkt, packet);
+
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		pkt->dts_usec -= video_offset;
+		pkt->dts -= video_pts_offset;
+		pkt->pts -= video_pts_offset;
 	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
+		pkt->dts_usec -= audio_offsets[pkt->track_idx];
+		pkt->dts -= audio_dts_offsets[pkt->track_idx];
+		pkt->pts -= audio_dts_offsets[pkt->track_idx];
 	}
 
 	for (idx = packets->num; idx > 0; idx--) {
-		struct encoder_packet *p = packets->array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
+		struct encoder_packet *p = &packets->array[idx - 1].packet;
+		if (p->dts_usec < pkt->dts_usec)
 			break;
 	}
 
-	da_insert(*packets, idx, &pkt);
+	da_insert(*packets, idx, &entry);
+}
+
+static void reorder_packets(struct ffmpeg_muxer *stream, replay_packets_t *packets)
+{
+	bool found_video = false;
+	bool found_audio[MAX_AUDIO_MIXES] = {0};
+	int64_t video_offset = 0;
+	int64_t video_pts_offset = 0;
+	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+	size_t num_packets = 0;
+
+	for (size_t i = 0; i < stream->save_gops.num; i++)
+		num_packets += stream->save_gops.array[i]->packets.num;
+
+	da_reserve(*packets, num_packets);
+
+	if (stream->spool)
+		replay_spool_lock(stream->spool);
+
+	for (size_t i = 0; i < stream->save_gops.num; i++) {
+		struct replay_gop *gop = stream->save_gops.array[i];
+		uint64_t offset = gop->offset;
+
+		for (size_t j = 0; j < gop->packets.num; j++) {
+			struct encoder_packet *pkt = &gop->packets.array[j];
+
+			if (pkt->type == OBS_ENCODER_VIDEO) {
+				if (!found_video) {
+					video_pts_offset = pkt->pts;
+					video_offset = video_pts_offset * 1000000 / pkt->timebase_den;
+					found_video = true;
+				}
+			} else {
+				if (!found_audio[pkt->track_idx]) {
+					found_audio[pkt->track_idx] = true;
+					audio_offsets[pkt->track_idx] = pkt->dts_usec;
+					audio_dts_offsets[pkt->track_idx] = pkt->dts;
+				}
+			}
+
+			insert_packet(packets, pkt, offset, video_offset, audio_offsets, video_pts_offset,
+				      audio_dts_offsets);
+			offset += pkt->size;
+		}
+	}
+
+	if (stream->spool)
+		replay_spool_unlock(stream->spool);
+}
+
+/* packets of intervals on disk are read back one at a time, into data
+ * that isn't reference counted */
+static bool write_replay_packet(struct ffmpeg_muxer *stream, struct replay_packet *entry, struct darray *buf)
+{
+	struct encoder_packet pkt = entry->packet;
+
+	if (pkt.data)
+		return write_packet(stream, &pkt);
+
+	darray_resize(sizeof(uint8_t), buf, pkt.size);
+	if (!replay_spool_read(stream->spool, entry->offset, buf->array, pkt.size)) {
+		warn("Failed to read packet back from the spool file");
+		return false;
+	}
+
+	pkt.data = buf->array;
+	return write_packet_internal(stream, &pkt, true);
 }
 
 static void *replay_buffer_mux_thread(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
+	replay_packets_t packets = {0};
+	struct darray buf = {0};
 	bool error = false;
 
-	start_pipe(stream, stream->path.array);
+	/* reordered here rather than when saving, so the encoders don't
+	 * wait on it */
+	reorder_packets(stream, &packets);
 
-	if (!stream->pipe) {
+	if (!start_pipe(stream, stream->path.array)) {
 		warn("Failed to create process pipe");
 		error = true;
 		goto error;
@@ -1105,26 +1375,24 @@ static void *replay_buffer_mux_thread(void *data)
 		goto error;
 	}
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		if (!write_packet(stream, pkt)) {
+	for (size_t i = 0; i < packets.num; i++) {
+		if (!write_replay_packet(stream, &packets.array[i], &buf)) {
 			warn("Could not write packet for file '%s'", stream->path.array);
 			error = true;
 			goto error;
 		}
-		obs_encoder_packet_release(pkt);
+		obs_encoder_packet_release(&packets.array[i].packet);
 	}
 
 	info("Wrote replay buffer to '%s'", stream->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	if (error) {
-		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(&stream->mux_packets.array[i]);
-	}
-	da_free(stream->mux_packets);
+	stop_pipe(stream);
+	for (size_t i = 0; i < packets.num; i++)
+		obs_encoder_packet_release(&packets.array[i].packet);
+	da_free(packets);
+	darray_free(&buf);
+	release_save_gops(stream);
 	os_atomic_set_bool(&stream->muxing, false);
 
 	if (!error) {
@@ -1136,43 +1404,36 @@ error:
 	return NULL;
 }
 
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
+static struct replay_gop *replay_gop_copy(struct replay_gop *src)
 {
-	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
+	struct replay_gop *gop = replay_gop_create(src->keyframe);
 
-	da_reserve(stream->mux_packets, num_packets);
+	da_reserve(gop->packets, src->packets.num);
+	for (size_t i = 0; i < src->packets.num; i++)
+		push_back_packet(&gop->packets, &src->packets.array[i]);
+	gop->size = src->size;
+	return gop;
+}
 
-	/* ---------------------------- */
-	/* reorder packets */
+static void replay_buffer_save(struct ffmpeg_muxer *stream)
+{
+	const size_t size = sizeof(struct replay_gop *);
+	size_t num_gops = stream->gops.size / size;
 
-	bool found_video = false;
-	bool found_audio[MAX_AUDIO_MIXES] = {0};
-	int64_t video_offset = 0;
-	int64_t video_pts_offset = 0;
-	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
-	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+	da_reserve(stream->save_gops, num_gops);
 
-	for (size_t i = 0; i < num_packets; i++) {
-		struct encoder_packet *pkt;
-		pkt = deque_data(&stream->packets, i * size);
+	for (size_t i = 0; i < num_gops; i++) {
+		struct replay_gop *gop = *(struct replay_gop **)deque_data(&stream->gops, i * size);
 
-		if (pkt->type == OBS_ENCODER_VIDEO) {
-			if (!found_video) {
-				video_pts_offset = pkt->pts;
-				video_offset = video_pts_offset * 1000000 / pkt->timebase_den;
-				found_video = true;
-			}
+		/* the last one still gets packets, so it's the only one that
+		 * has to be copied */
+		if (i == num_gops - 1) {
+			gop = replay_gop_copy(gop);
 		} else {
-			if (!found_audio[pkt->track_idx]) {
-				found_audio[pkt->track_idx] = true;
-				audio_offsets[pkt->track_idx] = pkt->dts_usec;
-				audio_dts_offsets[pkt->track_idx] = pkt->dts;
-			}
+			os_atomic_inc_long(&gop->refs);
 		}
 
-		insert_packet(&stream->mux_packets, pkt, video_offset, audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
+		da_push_back(stream->save_gops, &gop);
 	}
 
 	generate_filename(stream, &stream->path, true);
@@ -1181,6 +1442,7 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL, replay_buffer_mux_thread, stream) == 0;
 	if (!stream->mux_thread_joinable) {
 		warn("Failed to create muxer thread");
+		release_save_gops(stream);
 		os_atomic_set_bool(&stream->muxing, false);
 	}
 }
@@ -1196,13 +1458,18 @@ static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
 	os_atomic_set_bool(&stream->active, false);
 	os_atomic_set_bool(&stream->sent_headers, false);
 	os_atomic_set_bool(&stream->stopping, false);
+
+	/* a save still reading from the spool file has to finish first */
+	if (stream->spool && stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
 	replay_buffer_clear(stream);
 }
 
 static void replay_buffer_data(void *data, struct encoder_packet *packet)
 {
 	struct ffmpeg_muxer *stream = data;
-	struct encoder_packet pkt;
 
 	if (!active(stream))
 		return;
@@ -1220,17 +1487,8 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
-
-	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
-
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
-
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+	replay_buffer_purge(stream, packet);
+	replay_buffer_push(stream, packet);
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
@@ -1253,6 +1511,7 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "use_disk", false);
 }
 
 struct obs_output_info replay_buffer = {
@@ -11,11 +11,40 @@
 
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
+struct ffm_packet_info;
+struct local_mux;
+struct ffm_ring;
+struct replay_spool;
+
+/* The replay buffer keeps its packets by keyframe interval.  The oldest
+ * interval goes at once when purging, and saving only has to reference
+ * the intervals, the mux thread takes it from there. */
+struct replay_gop {
+	volatile long refs;
+	mux_packets_t packets;
+	int64_t size;
+	bool keyframe;
+
+	/* written to the spool file, the packets keep everything but their
+	 * data, which follows one after the other from offset */
+	struct replay_spool *spool;
+	bool spilled;
+	uint64_t offset;
+};
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	/* muxing in-process rather than piping to obs-ffmpeg-mux */
+	struct local_mux *local;
+	bool in_process;
+	/* the packet data going to obs-ffmpeg-mux through shared memory */
+	struct ffm_ring *ring;
 	int64_t stop_ts;
 	uint64_t total_bytes;
+	/* time spent handing packets to the muxer */
+	uint64_t max_blocked_ns;
+	uint64_t total_blocked_ns;
 	bool sent_headers;
 	volatile bool active;
 	volatile bool capturing;
@@ -37,6 +66,11 @@ struct ffmpeg_muxer {
 	obs_hotkey_id hotkey;
 	volatile bool muxing;
 	mux_packets_t mux_packets;
+	/* struct replay_gop pointers, oldest first, and what is being saved */
+	struct deque gops;
+	DARRAY(struct replay_gop *) save_gops;
+	/* on disk rather than in memory, when "use_disk" is set */
+	struct replay_spool *spool;
 
 	/* split file */
 	bool found_video;
@@ -68,9 +102,31 @@ struct ffmpeg_muxer {
 
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
-void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+bool start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
 void ffmpeg_mux_stop(void *data, uint64_t ts);
 uint64_t ffmpeg_mux_total_bytes(void *data);
+
+/* obs-ffmpeg-mux-local.c, takes over args when it succeeds */
+struct local_mux *local_mux_create(os_process_args_t *args);
+bool local_mux_write(struct local_mux *mux, const struct ffm_packet_info *info, struct encoder_packet *packet,
+		     bool copy);
+bool local_mux_change_file(struct local_mux *mux, const char *path);
+size_t local_mux_get_error(struct local_mux *mux, char *error, size_t size);
+int local_mux_destroy(struct local_mux *mux);
+
+struct replay_gop *replay_gop_create(bool keyframe);
+void replay_gop_release(struct replay_gop *gop);
+
+/* obs-ffmpeg-replay-spool.c, writes completed keyframe intervals to a
+ * file reused in place, and reads them back when saving */
+struct replay_spool *replay_spool_create(const char *path, uint64_t capacity);
+void replay_spool_push(struct replay_spool *spool, struct replay_gop *gop);
+void replay_spool_lock(struct replay_spool *spool);
+void replay_spool_unlock(struct replay_spool *spool);
+bool replay_spool_read(struct replay_spool *spool, uint64_t offset, uint8_t *data, size_t size);
+void replay_spool_free(struct replay_spool *spool, struct replay_gop *gop);
+void replay_spool_destroy(struct replay_spool *spool);
@@ -114,6 +114,16 @@ struct ffmpeg_output {
 	URLContext *h;
 	AVIOContext *s;
 	bool got_headers;
+
+	/* token bucket the writes are paced with, in bytes per second, no
+	 * pacing when the rate is 0 */
+	uint64_t pace_rate;
+	int64_t pace_burst;
+	int64_t pace_tokens;
+	uint64_t pace_last_ns;
+
+	uint64_t stats_last_ns;
+	float congestion;
 #endif
 };
 bool ffmpeg_data_init(struct ffmpeg_data *data, struct ffmpeg_cfg *config);
@@ -0,0 +1,297 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Keeps the replay buffer on disk.  Each keyframe interval is written to
+ * the spool file on a thread of its own once it is complete, and then only
+ * its packets' timestamps stay in memory.  The file is used as a ring: the
+ * intervals are freed oldest first, so it never grows past its capacity,
+ * and an interval that doesn't fit just stays in memory. */
+
+#include <inttypes.h>
+#include "obs-ffmpeg-mux.h"
+
+#define do_log(level, format, ...) blog(level, "[ffmpeg replay spool: '%s'] " format, spool->path.array, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+struct spool_region {
+	struct replay_gop *gop;
+	uint64_t size;
+	bool freed;
+};
+
+struct replay_spool {
+	struct dstr path;
+	FILE *write_file;
+	/* only the mux thread of a save reads */
+	FILE *read_file;
+
+	uint64_t capacity;
+	uint64_t head;
+	uint64_t used;
+	DARRAY(struct spool_region) regions;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	struct deque queue;
+	bool failed;
+	bool full;
+};
+
+static bool alloc_region(struct replay_spool *spool, struct replay_gop *gop, uint64_t *offset)
+{
+	uint64_t size = (uint64_t)gop->size;
+	uint64_t pad = 0;
+	struct spool_region *region;
+
+	/* intervals are read back in one piece, so one that would wrap
+	 * around starts over at the beginning instead */
+	if (spool->head + size > spool->capacity)
+		pad = spool->capacity - spool->head;
+
+	if (spool->used + pad + size > spool->capacity) {
+		if (!spool->full)
+			warn("Spool file is full, keeping the newest intervals in memory");
+		spool->full = true;
+		return false;
+	}
+
+	*offset = pad ? 0 : spool->head;
+	spool->head = *offset + size;
+	spool->used += pad + size;
+	spool->full = false;
+
+	region = da_push_back_new(spool->regions);
+	region->gop = gop;
+	region->size = pad + size;
+	return true;
+}
+
+static bool write_gop(struct replay_spool *spool, struct replay_gop *gop, uint64_t offset)
+{
+	if (os_fseeki64(spool->write_file, (int64_t)offset, SEEK_SET) != 0)
+		return false;
+
+	for (size_t i = 0; i < gop->packets.num; i++) {
+		struct encoder_packet *pkt = &gop->packets.array[i];
+		if (fwrite(pkt->data, 1, pkt->size, spool->write_file) != pkt->size)
+			return false;
+	}
+
+	/* it has to be readable from the other handle once spilled */
+	return fflush(spool->write_file) == 0;
+}
+
+static void spill(struct replay_spool *spool, struct replay_gop *gop)
+{
+	uint64_t offset;
+	uint64_t head;
+	bool success;
+
+	pthread_mutex_lock(&spool->mutex);
+	head = spool->head;
+	success = alloc_region(spool, gop, &offset);
+	pthread_mutex_unlock(&spool->mutex);
+
+	if (!success)
+		return;
+
+	success = write_gop(spool, gop, offset);
+
+	pthread_mutex_lock(&spool->mutex);
+
+	if (success) {
+		gop->spool = spool;
+		gop->offset = offset;
+		gop->spilled = true;
+
+		for (size_t i = 0; i < gop->packets.num; i++) {
+			struct encoder_packet data = gop->packets.array[i];
+			gop->packets.array[i].data = NULL;
+			obs_encoder_packet_release(&data);
+		}
+	} else {
+		struct spool_region *region = &spool->regions.array[spool->regions.num - 1];
+		spool->used -= region->size;
+		spool->head = head;
+		da_pop_back(spool->regions);
+
+		warn("Failed to write to spool file, keeping the replay buffer in memory: %s", strerror(errno));
+		spool->failed = true;
+	}
+
+	pthread_mutex_unlock(&spool->mutex);
+}
+
+static void *spool_thread(void *data)
+{
+	struct replay_spool *spool = data;
+
+	os_set_thread_name("obs-ffmpeg: replay spool");
+
+	for (;;) {
+		struct replay_gop *gop;
+		bool failed;
+
+		os_sem_wait(spool->sem);
+
+		pthread_mutex_lock(&spool->mutex);
+		deque_pop_front(&spool->queue, &gop, sizeof(gop));
+		failed = spool->failed;
+		pthread_mutex_unlock(&spool->mutex);
+
+		if (!gop)
+			break;
+
+		/* not worth writing if it was purged in the meantime */
+		if (!failed && os_atomic_load_long(&gop->refs) > 1)
+			spill(spool, gop);
+
+		replay_gop_release(gop);
+	}
+
+	return NULL;
+}
+
+struct replay_spool *replay_spool_create(const char *path, uint64_t capacity)
+{
+	struct replay_spool *spool = bzalloc(sizeof(*spool));
+
+	dstr_copy(&spool->path, path);
+	spool->capacity = capacity;
+
+	pthread_mutex_init_value(&spool->mutex);
+	if (pthread_mutex_init(&spool->mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&spool->sem, 0) != 0)
+		goto fail;
+
+	spool->write_file = os_fopen(path, "w+b");
+	if (!spool->write_file) {
+		warn("Failed to create spool file");
+		goto fail;
+	}
+
+	spool->read_file = os_fopen(path, "rb");
+	if (!spool->read_file) {
+		warn("Failed to open spool file for reading");
+		goto fail;
+	}
+
+	if (pthread_create(&spool->thread, NULL, spool_thread, spool) != 0)
+		goto fail;
+
+	info("Keeping up to %" PRIu64 " MB of replay buffer on disk", capacity / (1024 * 1024));
+	return spool;
+
+fail:
+	if (spool->read_file)
+		fclose(spool->read_file);
+	if (spool->write_file) {
+		fclose(spool->write_file);
+		os_unlink(path);
+	}
+	os_sem_destroy(spool->sem);
+	pthread_mutex_destroy(&spool->mutex);
+	dstr_free(&spool->path);
+	bfree(spool);
+	return NULL;
+}
+
+/* takes a reference of gop, it is expected not to get any packets
+ * anymore */
+void replay_spool_push(struct replay_spool *spool, struct replay_gop *gop)
+{
+	os_atomic_inc_long(&gop->refs);
+
+	pthread_mutex_lock(&spool->mutex);
+	deque_push_back(&spool->queue, &gop, sizeof(gop));
+	pthread_mutex_unlock(&spool->mutex);
+
+	os_sem_post(spool->sem);
+}
+
+/* while locked, intervals don't get spilled, so that the packets which
+ * still have their data can be referenced before it goes */
+void replay_spool_lock(struct replay_spool *spool)
+{
+	pthread_mutex_lock(&spool->mutex);
+}
+
+void replay_spool_unlock(struct replay_spool *spool)
+{
+	pthread_mutex_unlock(&spool->mutex);
+}
+
+bool replay_spool_read(struct replay_spool *spool, uint64_t offset, uint8_t *data, size_t size)
+{
+	if (os_fseeki64(spool->read_file, (int64_t)offset, SEEK_SET) != 0)
+		return false;
+
+	return fread(data, 1, size, spool->read_file) == size;
+}
+
+/* regions are given back in about the order they were written, but one
+ * held by a save can outlive newer ones, so only what precedes the oldest
+ * region still in use can be written over */
+void replay_spool_free(struct replay_spool *spool, struct replay_gop *gop)
+{
+	pthread_mutex_lock(&spool->mutex);
+
+	for (size_t i = 0; i < spool->regions.num; i++) {
+		if (spool->regions.array[i].gop == gop) {
+			spool->regions.array[i].freed = true;
+			break;
+		}
+	}
+
+	while (spool->regions.num && spool->regions.array[0].freed) {
+		spool->used -= spool->regions.array[0].size;
+		da_erase(spool->regions, 0);
+	}
+
+	pthread_mutex_unlock(&spool->mutex);
+}
+
+/* all of the intervals it has written must have been released */
+void replay_spool_destroy(struct replay_spool *spool)
+{
+	struct replay_gop *stop = NULL;
+
+	if (!spool)
+		return;
+
+	pthread_mutex_lock(&spool->mutex);
+	deque_push_back(&spool->queue, &stop, sizeof(stop));
+	pthread_mutex_unlock(&spool->mutex);
+
+	os_sem_post(spool->sem);
+	pthread_join(spool->thread, NULL);
+
+	fclose(spool->read_file);
+	fclose(spool->write_file);
+	os_unlink(spool->path.array);
+
+	deque_free(&spool->queue);
+	da_free(spool->regions);
+	os_sem_destroy(spool->sem);
+	pthread_mutex_destroy(&spool->mutex);
+	dstr_free(&spool->path);
+	bfree(spool);
+}
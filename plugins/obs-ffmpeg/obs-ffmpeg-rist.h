@@ -50,8 +50,16 @@ typedef struct RISTContext {
 	struct rist_ctx *ctx;
 	int statsinterval;
 	struct rist_stats_sender_peer *stats_list;
+
+	/* from the latest stats callback, read by the sender for congestion */
+	volatile double quality;
+	uint32_t stats_count;
 } RISTContext;
 
+/* stats come in every second for congestion, the summary is logged once a minute */
+#define RIST_STATS_INTERVAL_MS 1000
+#define RIST_STATS_LOG_INTERVAL 60
+
 static int risterr2ret(int err)
 {
 	switch (err) {
@@ -122,6 +130,12 @@ static int cb_stats(void *arg, const struct rist_stats *stats_container)
 	RISTContext *s = (RISTContext *)arg;
 	rist_log(&s->logging_settings, RIST_LOG_INFO, "%s\n", stats_container->stats_json);
 	if (stats_container->stats_type == RIST_STATS_SENDER_PEER) {
+		s->quality = stats_container->stats.sender_peer.quality;
+		if (++s->stats_count % RIST_STATS_LOG_INTERVAL != 0) {
+			rist_stats_free(stats_container);
+			return 0;
+		}
+
 		blog(LOG_INFO, "---------------------------------");
 		blog(LOG_DEBUG,
 		     "[obs-ffmpeg mpegts muxer / librist]: Session Summary\n"
@@ -154,7 +168,8 @@ static int librist_open(URLContext *h, const char *uri)
 	s->overrun_nonfatal = 0;
 	s->fifo_shift = FF_LIBRIST_FIFO_DEFAULT_SHIFT;
 	s->logging_settings = (struct rist_logging_settings)LOGGING_SETTINGS_INITIALIZER;
-	s->statsinterval = 60000; // log stats every 60 seconds
+	s->statsinterval = RIST_STATS_INTERVAL_MS;
+	s->quality = 100.0;
 
 	ret = rist_logging_set(&logging_settings, s->log_level, log_cb, h, NULL, NULL);
 	if (ret < 0) {
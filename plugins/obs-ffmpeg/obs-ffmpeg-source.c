@@ -46,6 +46,7 @@ struct ffmpeg_source {
 	bool is_local_file;
 	bool is_hw_decoding;
 	bool full_decode;
+	int full_decode_limit_mb;
 	bool is_clear_on_media_end;
 	bool restart_on_activate;
 	bool close_when_inactive;
@@ -243,6 +244,13 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static bool get_texture_frame(void *opaque, struct obs_source_frame *f, gs_texture_t *const *textures,
+			      obs_source_frame_release_t release, void *param)
+{
+	struct ffmpeg_source *s = opaque;
+	return obs_source_lend_video_textures(s->source, f, textures, release, param);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -295,6 +303,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.v_cb = get_frame,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
+			.v_texture_cb = get_texture_frame,
 			.a_cb = get_audio,
 			.stop_cb = media_stopped,
 			.path = s->input,
@@ -309,6 +318,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.reconnecting = s->reconnecting,
 			.request_preload = s->is_stinger,
 			.full_decode = s->full_decode,
+			.cache_limit = (size_t)s->full_decode_limit_mb * 1024 * 1024,
 		};
 
 		s->media = media_playback_create(&info);
@@ -456,6 +466,7 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	s->input_format = input_format ? bstrdup(input_format) : NULL;
 	s->is_hw_decoding = is_hw_decoding;
 	s->full_decode = obs_data_get_bool(settings, "full_decode");
+	s->full_decode_limit_mb = (int)obs_data_get_int(settings, "full_decode_limit_mb");
 	s->is_clear_on_media_end = obs_data_get_bool(settings, "clear_on_media_end");
 	s->restart_on_activate = !astrcmpi_n(input, RIST_PROTO, sizeof(RIST_PROTO) - 1)
 					 ? false
@@ -31,6 +31,7 @@
 #include <opts-parser.h>
 
 #include <unistd.h>
+#include <inttypes.h>
 
 #include <libavutil/opt.h>
 #include <libavutil/pixdesc.h>
@@ -61,10 +62,23 @@ enum codec_type {
 	CODEC_AV1,
 };
 
+/* Imports of pooled VA surfaces are kept for as long as the frames context
+ * lives, so that the DMA-BUF export and EGL import only happen the first time
+ * the pool hands out a surface.  The pool grows with the number of frames the
+ * encoder keeps in flight, anything beyond this is imported per frame. */
+#define MAX_CACHED_SURFACES 32
+
 struct vaapi_surface {
 	AVFrame *frame;
 	gs_texture_t *textures[4];
 	uint32_t num_textures;
+	bool cached;
+};
+
+struct vaapi_cached_surface {
+	VASurfaceID id;
+	gs_texture_t *textures[4];
+	uint32_t num_textures;
 };
 
 struct vaapi_encoder {
@@ -93,6 +107,18 @@ struct vaapi_encoder {
 	int height;
 	bool first_packet;
 	bool initialized;
+
+	bool texture;
+	DARRAY(struct vaapi_cached_surface) surfaces;
+
+	/* modifiers EGL can import for every layer of the surface format,
+	 * handed to the driver when allocating the surface pool */
+	DARRAY(uint64_t) modifiers;
+	bool modifiers_set;
+#if VA_CHECK_VERSION(1, 11, 0)
+	VADRMFormatModifierList modifier_list;
+	VASurfaceAttrib modifier_attrib;
+#endif
 };
 
 static const char *h264_vaapi_getname(void *unused)
@@ -140,6 +166,94 @@ static void vaapi_video_info(void *data, struct video_scale_info *info)
 	info->format = pref_format;
 }
 
+static bool get_layer_formats(enum AVPixelFormat format, uint32_t drm_formats[2])
+{
+	switch (format) {
+	case AV_PIX_FMT_NV12:
+		drm_formats[0] = DRM_FORMAT_R8;
+		drm_formats[1] = DRM_FORMAT_GR88;
+		return true;
+	case AV_PIX_FMT_P010:
+		drm_formats[0] = DRM_FORMAT_R16;
+		drm_formats[1] = DRM_FORMAT_GR1616;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void query_surface_modifiers(struct vaapi_encoder *enc)
+{
+	uint32_t drm_formats[2];
+	uint64_t *luma = NULL;
+	uint64_t *chroma = NULL;
+	size_t n_luma = 0;
+	size_t n_chroma = 0;
+	bool success;
+
+	if (!get_layer_formats(enc->context->pix_fmt, drm_formats))
+		return;
+
+	obs_enter_graphics();
+	success = gs_query_dmabuf_modifiers_for_format(drm_formats[0], &luma, &n_luma) &&
+		  gs_query_dmabuf_modifiers_for_format(drm_formats[1], &chroma, &n_chroma);
+	obs_leave_graphics();
+
+	if (success) {
+		for (size_t i = 0; i < n_luma; i++) {
+			if (luma[i] == DRM_FORMAT_MOD_INVALID)
+				continue;
+
+			for (size_t j = 0; j < n_chroma; j++) {
+				if (chroma[j] == luma[i]) {
+					da_push_back(enc->modifiers, &luma[i]);
+					break;
+				}
+			}
+		}
+	}
+
+	bfree(luma);
+	bfree(chroma);
+}
+
+static int init_frames_context(struct vaapi_encoder *enc, bool use_modifiers)
+{
+	av_buffer_unref(&enc->vaframes_ref);
+
+	enc->vaframes_ref = av_hwframe_ctx_alloc(enc->vadevice_ref);
+	if (!enc->vaframes_ref)
+		return AVERROR(ENOMEM);
+
+	AVHWFramesContext *frames_ctx = (AVHWFramesContext *)enc->vaframes_ref->data;
+	frames_ctx->format = AV_PIX_FMT_VAAPI;
+	frames_ctx->sw_format = enc->context->pix_fmt;
+	frames_ctx->width = enc->context->width;
+	frames_ctx->height = enc->context->height;
+
+#if VA_CHECK_VERSION(1, 11, 0)
+	if (use_modifiers) {
+		AVVAAPIFramesContext *va_frames = frames_ctx->hwctx;
+
+		/* the frames context copies the attributes but not the list
+		 * they point to, and reads it again whenever the pool grows */
+		enc->modifier_list.num_modifiers = (uint32_t)enc->modifiers.num;
+		enc->modifier_list.modifiers = enc->modifiers.array;
+		enc->modifier_attrib.type = VASurfaceAttribDRMFormatModifiers;
+		enc->modifier_attrib.flags = VA_SURFACE_ATTRIB_SETTABLE;
+		enc->modifier_attrib.value.type = VAGenericValueTypePointer;
+		enc->modifier_attrib.value.value.p = &enc->modifier_list;
+
+		va_frames->attributes = &enc->modifier_attrib;
+		va_frames->nb_attributes = 1;
+	}
+#else
+	UNUSED_PARAMETER(use_modifiers);
+#endif
+
+	return av_hwframe_ctx_init(enc->vaframes_ref);
+}
+
 static bool vaapi_init_codec(struct vaapi_encoder *enc, const char *path)
 {
 	int ret;
@@ -154,19 +268,23 @@ static bool vaapi_init_codec(struct vaapi_encoder *enc, const char *path)
 	AVVAAPIDeviceContext *vadevctx = vahwctx->hwctx;
 	enc->va_dpy = vadevctx->display;
 
-	enc->vaframes_ref = av_hwframe_ctx_alloc(enc->vadevice_ref);
-	if (!enc->vaframes_ref) {
-		warn("Failed to alloc HW frames context");
-		return false;
+	/* texture encoders ask the driver for a surface layout EGL is known to
+	 * import, the driver picks its own layout if it does not take any */
+	if (enc->texture) {
+		query_surface_modifiers(enc);
+
+#if VA_CHECK_VERSION(1, 11, 0)
+		if (enc->modifiers.num) {
+			ret = init_frames_context(enc, true);
+			enc->modifiers_set = ret >= 0;
+			if (ret < 0)
+				info("Driver refused the EGL surface modifiers, letting it choose: %s",
+				     av_err2str(ret));
+		}
+#endif
 	}
 
-	AVHWFramesContext *frames_ctx = (AVHWFramesContext *)enc->vaframes_ref->data;
-	frames_ctx->format = AV_PIX_FMT_VAAPI;
-	frames_ctx->sw_format = enc->context->pix_fmt;
-	frames_ctx->width = enc->context->width;
-	frames_ctx->height = enc->context->height;
-
-	ret = av_hwframe_ctx_init(enc->vaframes_ref);
+	ret = enc->modifiers_set ? 0 : init_frames_context(enc, false);
 	if (ret < 0) {
 		warn("Failed to init HW frames context: %s", av_err2str(ret));
 		return false;
@@ -386,79 +504,151 @@ static inline enum gs_color_format drm_to_gs_color_format(int format)
 	}
 }
 
-static void vaapi_destroy_surface(struct vaapi_surface *out)
+static void destroy_textures(gs_texture_t *textures[4], uint32_t num_textures)
 {
-	for (uint32_t i = 0; i < out->num_textures; ++i) {
-		if (out->textures[i]) {
-			gs_texture_destroy(out->textures[i]);
-			out->textures[i] = NULL;
+	for (uint32_t i = 0; i < num_textures; ++i) {
+		if (textures[i]) {
+			gs_texture_destroy(textures[i]);
+			textures[i] = NULL;
 		}
 	}
+}
+
+/* requires the graphics context for uncached surfaces */
+static void vaapi_destroy_surface(struct vaapi_surface *out)
+{
+	if (!out->cached)
+		destroy_textures(out->textures, out->num_textures);
 
 	av_frame_free(&out->frame);
 }
 
-static bool vaapi_create_surface(struct vaapi_encoder *enc, struct vaapi_surface *out)
+static bool modifier_importable(struct vaapi_encoder *enc, uint64_t modifier)
+{
+	/* nothing to check against when EGL did not list any */
+	if (!enc->modifiers.num || modifier == DRM_FORMAT_MOD_INVALID)
+		return true;
+
+	for (size_t i = 0; i < enc->modifiers.num; i++) {
+		if (enc->modifiers.array[i] == modifier)
+			return true;
+	}
+
+	return false;
+}
+
+static bool import_surface(struct vaapi_encoder *enc, VASurfaceID id, gs_texture_t *textures[4],
+			   uint32_t *num_textures, const char **reason)
 {
-	int ret;
 	VAStatus vas;
 	VADRMPRIMESurfaceDescriptor desc;
 	const AVPixFmtDescriptor *fmt_desc;
 	bool ok = true;
 
-	memset(out, 0, sizeof(*out));
+	*num_textures = 0;
 
 	fmt_desc = av_pix_fmt_desc_get(enc->context->pix_fmt);
 	if (!fmt_desc) {
-		warn("Failed to get pix fmt descriptor");
+		*reason = "unknown pixel format";
 		return false;
 	}
 
-	out->frame = av_frame_alloc();
-	if (!out->frame) {
-		warn("Failed to allocate hw frame");
-		return false;
-	}
-
-	ret = av_hwframe_get_buffer(enc->vaframes_ref, out->frame, 0);
-	if (ret < 0) {
-		warn("Failed to get hw frame buffer: %s", av_err2str(ret));
-		goto fail;
-	}
-
-	vas = vaExportSurfaceHandle(enc->va_dpy, (uintptr_t)out->frame->data[3], VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+	vas = vaExportSurfaceHandle(enc->va_dpy, id, VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
 				    VA_EXPORT_SURFACE_WRITE_ONLY | VA_EXPORT_SURFACE_SEPARATE_LAYERS, &desc);
 	if (vas != VA_STATUS_SUCCESS) {
 		warn("Failed to export VA surface handle: %s", vaErrorStr(vas));
-		goto fail;
+		*reason = "the driver cannot export surfaces as DMA-BUF";
+		return false;
 	}
 
-	for (uint32_t i = 0; i < desc.num_layers; ++i) {
+	for (uint32_t i = 0; i < desc.num_layers && ok; ++i) {
 		unsigned int width = desc.width;
 		unsigned int height = desc.height;
+		uint32_t object = desc.layers[i].object_index[0];
+		uint64_t modifier = desc.objects[object].drm_format_modifier;
+
 		if (i) {
 			width /= 1 << fmt_desc->log2_chroma_w;
 			height /= 1 << fmt_desc->log2_chroma_h;
 		}
 
-		out->textures[i] = gs_texture_create_from_dmabuf(
-			width, height, desc.layers[i].drm_format, drm_to_gs_color_format(desc.layers[i].drm_format), 1,
-			&desc.objects[desc.layers[i].object_index[0]].fd, &desc.layers[i].pitch[0],
-			&desc.layers[i].offset[0], &desc.objects[desc.layers[i].object_index[0]].drm_format_modifier);
+		if (!modifier_importable(enc, modifier)) {
+			warn("Surface layer %u modifier 0x%" PRIx64 " is not importable by EGL", i, modifier);
+			*reason = "the surface modifier is not importable by EGL";
+			ok = false;
+			continue;
+		}
+
+		textures[i] = gs_texture_create_from_dmabuf(width, height, desc.layers[i].drm_format,
+							     drm_to_gs_color_format(desc.layers[i].drm_format), 1,
+							     &desc.objects[object].fd, &desc.layers[i].pitch[0],
+							     &desc.layers[i].offset[0], &modifier);
 
-		if (!out->textures[i]) {
-			warn("Failed to import VA surface texture");
+		if (!textures[i]) {
+			warn("Failed to import VA surface layer %u (format 0x%08x, modifier 0x%" PRIx64 ")", i,
+			     desc.layers[i].drm_format, modifier);
+			*reason = "EGL failed to import the surface";
 			ok = false;
 		}
 
-		out->num_textures++;
+		(*num_textures)++;
 	}
 
 	for (uint32_t i = 0; i < desc.num_objects; ++i)
 		close(desc.objects[i].fd);
 
-	if (ok)
-		return true;
+	if (!ok)
+		destroy_textures(textures, *num_textures);
+	return ok;
+}
+
+/* requires the graphics context */
+static bool vaapi_create_surface(struct vaapi_encoder *enc, struct vaapi_surface *out, const char **reason)
+{
+	struct vaapi_cached_surface *cached;
+	VASurfaceID id;
+	int ret;
+
+	memset(out, 0, sizeof(*out));
+
+	out->frame = av_frame_alloc();
+	if (!out->frame) {
+		warn("Failed to allocate hw frame");
+		*reason = "out of memory";
+		return false;
+	}
+
+	ret = av_hwframe_get_buffer(enc->vaframes_ref, out->frame, 0);
+	if (ret < 0) {
+		warn("Failed to get hw frame buffer: %s", av_err2str(ret));
+		*reason = "no surface available";
+		goto fail;
+	}
+
+	id = (VASurfaceID)(uintptr_t)out->frame->data[3];
+
+	for (size_t i = 0; i < enc->surfaces.num; i++) {
+		cached = &enc->surfaces.array[i];
+		if (cached->id == id) {
+			memcpy(out->textures, cached->textures, sizeof(out->textures));
+			out->num_textures = cached->num_textures;
+			out->cached = true;
+			return true;
+		}
+	}
+
+	if (!import_surface(enc, id, out->textures, &out->num_textures, reason))
+		goto fail;
+
+	if (enc->surfaces.num < MAX_CACHED_SURFACES) {
+		cached = da_push_back_new(enc->surfaces);
+		cached->id = id;
+		memcpy(cached->textures, out->textures, sizeof(cached->textures));
+		cached->num_textures = out->num_textures;
+		out->cached = true;
+	}
+
+	return true;
 
 fail:
 	vaapi_destroy_surface(out);
@@ -485,6 +675,16 @@ static void vaapi_destroy(void *data)
 	if (enc->initialized)
 		flush_remaining_packets(enc);
 
+	if (enc->surfaces.num) {
+		obs_enter_graphics();
+		for (size_t i = 0; i < enc->surfaces.num; i++) {
+			struct vaapi_cached_surface *cached = &enc->surfaces.array[i];
+			destroy_textures(cached->textures, cached->num_textures);
+		}
+		obs_leave_graphics();
+	}
+
+	da_free(enc->surfaces);
 	av_packet_free(&enc->packet);
 	avcodec_free_context(&enc->context);
 	av_frame_unref(enc->vframe);
@@ -494,6 +694,7 @@ static void vaapi_destroy(void *data)
 	da_free(enc->buffer);
 	bfree(enc->header);
 	bfree(enc->sei);
+	da_free(enc->modifiers);
 
 	bfree(enc);
 }
@@ -510,7 +711,7 @@ static inline const char *vaapi_encoder_name(enum codec_type codec)
 	return NULL;
 }
 
-static void *vaapi_create_internal(obs_data_t *settings, obs_encoder_t *encoder, enum codec_type codec)
+static void *vaapi_create_internal(obs_data_t *settings, obs_encoder_t *encoder, enum codec_type codec, bool texture)
 {
 	struct vaapi_encoder *enc;
 
@@ -518,6 +719,7 @@ static void *vaapi_create_internal(obs_data_t *settings, obs_encoder_t *encoder,
 	enc->encoder = encoder;
 
 	enc->codec = codec;
+	enc->texture = texture;
 	enc->vaapi = avcodec_find_encoder_by_name(vaapi_encoder_name(codec));
 
 	enc->first_packet = true;
@@ -545,16 +747,20 @@ fail:
 	return NULL;
 }
 
-static inline bool vaapi_test_texencode(struct vaapi_encoder *enc)
+static inline bool vaapi_test_texencode(struct vaapi_encoder *enc, const char **reason)
 {
 	struct vaapi_surface surface;
+	bool success;
 
-	if (obs_encoder_scaling_enabled(enc->encoder) && !obs_encoder_gpu_scaling_enabled(enc->encoder))
+	if (obs_encoder_scaling_enabled(enc->encoder) && !obs_encoder_gpu_scaling_enabled(enc->encoder)) {
+		*reason = "the encoder is scaled on the CPU";
 		return false;
+	}
 
 	obs_enter_graphics();
-	bool success = vaapi_create_surface(enc, &surface);
-	vaapi_destroy_surface(&surface);
+	success = vaapi_create_surface(enc, &surface, reason);
+	if (success)
+		vaapi_destroy_surface(&surface);
 	obs_leave_graphics();
 	return success;
 }
@@ -562,21 +768,28 @@ static inline bool vaapi_test_texencode(struct vaapi_encoder *enc)
 static void *vaapi_create_tex_internal(obs_data_t *settings, obs_encoder_t *encoder, enum codec_type codec,
 				       const char *fallback)
 {
-	void *enc = vaapi_create_internal(settings, encoder, codec);
+	const char *reason = "unknown error";
+	struct vaapi_encoder *enc = vaapi_create_internal(settings, encoder, codec, true);
 	if (!enc) {
 		return NULL;
 	}
-	if (!vaapi_test_texencode(enc)) {
+	if (!vaapi_test_texencode(enc, &reason)) {
 		vaapi_destroy(enc);
-		blog(LOG_WARNING, "VAAPI: Falling back to %s encoder", fallback);
+		blog(LOG_WARNING,
+		     "VAAPI: Zero-copy texture encoding unavailable because %s, "
+		     "falling back to the %s encoder which copies frames through system memory",
+		     reason, fallback);
 		return obs_encoder_create_rerouted(encoder, fallback);
 	}
+
+	info("Zero-copy texture encoding, surface modifiers %s",
+	     enc->modifiers_set ? "negotiated with EGL" : "chosen by the driver");
 	return enc;
 }
 
 static void *h264_vaapi_create(obs_data_t *settings, obs_encoder_t *encoder)
 {
-	return vaapi_create_internal(settings, encoder, CODEC_H264);
+	return vaapi_create_internal(settings, encoder, CODEC_H264, false);
 }
 
 static void *h264_vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
@@ -586,7 +799,7 @@ static void *h264_vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
 
 static void *av1_vaapi_create(obs_data_t *settings, obs_encoder_t *encoder)
 {
-	return vaapi_create_internal(settings, encoder, CODEC_AV1);
+	return vaapi_create_internal(settings, encoder, CODEC_AV1, false);
 }
 
 static void *av1_vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
@@ -597,7 +810,7 @@ static void *av1_vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
 #ifdef ENABLE_HEVC
 static void *hevc_vaapi_create(obs_data_t *settings, obs_encoder_t *encoder)
 {
-	return vaapi_create_internal(settings, encoder, CODEC_HEVC);
+	return vaapi_create_internal(settings, encoder, CODEC_HEVC, false);
 }
 
 static void *hevc_vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
@@ -767,15 +980,15 @@ static bool vaapi_encode_tex(void *data, struct encoder_texture *texture, int64_
 
 	struct vaapi_encoder *enc = data;
 	struct vaapi_surface surface;
+	const char *reason = NULL;
 	int ret;
 
 	*received_packet = false;
 
 	obs_enter_graphics();
 
-	// Destroyed piecemeal to avoid taking the graphics lock again.
-	if (!vaapi_create_surface(enc, &surface)) {
-		warn("vaapi_encode_tex: failed to create texture hw frame");
+	if (!vaapi_create_surface(enc, &surface, &reason)) {
+		warn("vaapi_encode_tex: failed to create texture hw frame because %s", reason);
 		obs_leave_graphics();
 		return false;
 	}
@@ -783,15 +996,20 @@ static bool vaapi_encode_tex(void *data, struct encoder_texture *texture, int64_
 	for (uint32_t i = 0; i < surface.num_textures; ++i) {
 		if (!texture->tex[i]) {
 			warn("vaapi_encode_tex: unexpected number of textures");
+			vaapi_destroy_surface(&surface);
 			obs_leave_graphics();
-			goto fail;
+			return false;
 		}
 		gs_copy_texture(surface.textures[i], texture->tex[i]);
-		gs_texture_destroy(surface.textures[i]);
 	}
 
 	gs_flush();
 
+	/* Destroyed here to avoid taking the graphics lock again, cached
+	 * surfaces keep their textures. */
+	if (!surface.cached)
+		destroy_textures(surface.textures, surface.num_textures);
+
 	obs_leave_graphics();
 
 	enc->vframe->pts = pts;
@@ -8,9 +8,45 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+void ffmpeg_video_encoder_set_affinity(struct ffmpeg_video_encoder *enc, const char *cpu_list)
+{
+	enc->pin_threads = false;
+	if (!cpu_list || !*cpu_list)
+		return;
+
+	if (!os_cpu_set_parse(&enc->affinity, cpu_list) || os_cpu_set_empty(&enc->affinity)) {
+		warn("Invalid CPU affinity '%s', threads are not pinned", cpu_list);
+		return;
+	}
+
+	enc->pin_threads = true;
+}
+
+/* codec threads are created when the codec opens and inherit the affinity of
+ * the thread that opens it where the platform allows, so that thread is
+ * pinned for the duration */
+static int open_codec(struct ffmpeg_video_encoder *enc)
+{
+	struct os_cpu_set prev;
+	bool pinned = false;
+	int ret;
+
+	if (enc->pin_threads) {
+		pinned = os_get_thread_affinity(&prev) && os_set_thread_affinity(&enc->affinity);
+		if (!pinned)
+			warn("Failed to pin codec threads, they may run on any CPU");
+	}
+
+	ret = avcodec_open2(enc->context, enc->avcodec, NULL);
+
+	if (pinned)
+		os_set_thread_affinity(&prev);
+	return ret;
+}
+
 bool ffmpeg_video_encoder_init_codec(struct ffmpeg_video_encoder *enc)
 {
-	int ret = avcodec_open2(enc->context, enc->avcodec, NULL);
+	int ret = open_codec(enc);
 	if (ret < 0) {
 		if (!obs_encoder_get_last_error(enc->encoder)) {
 			if (enc->on_init_error) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <util/platform.h>
+#include <util/threading.h>
 #include <util/darray.h>
 #include <util/dstr.h>
 #include <util/base.h>
@@ -33,6 +34,10 @@ struct ffmpeg_video_encoder {
 	int height;
 	bool initialized;
 
+	/* CPUs the codec threads are created on, if any */
+	struct os_cpu_set affinity;
+	bool pin_threads;
+
 	void *parent;
 	init_error_cb on_init_error;
 	first_packet_cb on_first_packet;
@@ -42,6 +47,7 @@ extern bool ffmpeg_video_encoder_init(struct ffmpeg_video_encoder *enc, void *pa
 				      const char *enc_lib, const char *enc_lib2, const char *enc_name,
 				      init_error_cb on_init_error, first_packet_cb on_first_packet);
 extern void ffmpeg_video_encoder_free(struct ffmpeg_video_encoder *enc);
+extern void ffmpeg_video_encoder_set_affinity(struct ffmpeg_video_encoder *enc, const char *cpu_list);
 extern bool ffmpeg_video_encoder_init_codec(struct ffmpeg_video_encoder *enc);
 extern void ffmpeg_video_encoder_update(struct ffmpeg_video_encoder *enc, int bitrate, int keyint_sec,
 					const struct video_output_info *voi, const struct video_scale_info *info,
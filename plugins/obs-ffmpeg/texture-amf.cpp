@@ -11,6 +11,9 @@
 #include <mutex>
 #include <deque>
 #include <map>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 
 #include <AMF/components/VideoEncoderHEVC.h>
 #include <AMF/components/VideoEncoderVCE.h>
@@ -94,7 +97,17 @@ struct amf_base {
 	AMFBufferPtr header;
 	AMFSurfacePtr roi_map;
 
+	/* QueryOutput runs on output_thread so the encoder keeps working
+	 * between encode calls.  output_mutex guards everything below it
+	 * up to in_flight_limit */
+	std::thread output_thread;
+	std::mutex output_mutex;
+	std::condition_variable output_cv;
 	std::deque<AMFDataPtr> queued_packets;
+	AMF_RESULT output_error = AMF_OK;
+	bool stop_output = false;
+	int in_flight = 0;
+	int in_flight_limit = 1;
 
 	AMF_VIDEO_CONVERTER_COLOR_PROFILE_ENUM amf_color_profile;
 	AMF_COLOR_TRANSFER_CHARACTERISTIC_ENUM amf_characteristic;
@@ -117,7 +130,17 @@ struct amf_base {
 	bool roi_supported = false;
 
 	inline amf_base(bool fallback) : fallback(fallback) {}
-	virtual ~amf_base() = default;
+	virtual ~amf_base()
+	{
+		if (output_thread.joinable()) {
+			{
+				std::scoped_lock lock(output_mutex);
+				stop_output = true;
+			}
+			output_cv.notify_all();
+			output_thread.join();
+		}
+	}
 	virtual void init() = 0;
 };
 
@@ -629,6 +652,101 @@ static void add_roi(amf_base *enc, AMFSurface *amf_surf)
 		amf_surf->SetProperty(AMF_VIDEO_ENCODER_AV1_ROI_DATA, enc->roi_map);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Output thread                                                             */
+
+/* frames that may be waiting for output on top of what the encoder holds
+ * back for reordering */
+static constexpr int max_in_flight_frames = 16;
+
+static void amf_output_thread(amf_base *enc)
+{
+	os_set_thread_name("amf: output");
+
+	std::unique_lock lock(enc->output_mutex);
+
+	while (!enc->stop_output) {
+		if (enc->in_flight <= 0) {
+			enc->output_cv.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+
+		AMFDataPtr new_packet;
+		AMF_RESULT res = enc->amf_encoder->QueryOutput(&new_packet);
+
+		if (!new_packet && (res == AMF_REPEAT || res == AMF_OK))
+			os_sleep_ms(1);
+
+		lock.lock();
+
+		if (new_packet) {
+			enc->queued_packets.push_back(new_packet);
+			if (enc->in_flight > 0)
+				enc->in_flight--;
+			enc->output_cv.notify_all();
+
+		} else if (res != AMF_REPEAT && res != AMF_OK) {
+			enc->output_error = res;
+			enc->output_cv.notify_all();
+			break;
+		}
+	}
+}
+
+static int get_in_flight_frames(amf_base *enc, obs_data_t *settings)
+{
+	int frames = (int)obs_data_get_int(settings, "in_flight_frames");
+	if (frames > 0)
+		return frames;
+
+	/* around 4K60 a single frame in flight leaves the VCN idle while
+	 * OBS prepares the next one */
+	uint64_t pixel_rate = (uint64_t)enc->cx * enc->cy * enc->fps_num / enc->fps_den;
+	return pixel_rate >= 3840ULL * 2160ULL * 50ULL ? 4 : 2;
+}
+
+static void start_output_thread(amf_base *enc, obs_data_t *settings)
+{
+	int frames = get_in_flight_frames(enc, settings);
+
+	enc->in_flight_limit = frames + (int)enc->dts_offset;
+	enc->output_thread = std::thread(amf_output_thread, enc);
+
+	info("frames in flight: %d", frames);
+}
+
+/* frames dropped by Flush never come out of QueryOutput */
+static void reset_in_flight(amf_base *enc)
+{
+	std::scoped_lock lock(enc->output_mutex);
+	enc->in_flight = 0;
+}
+
+/* waits until another frame may be submitted.  pre-analysis and other
+ * options can make the encoder hold back more frames than the reordering
+ * accounts for, in which case the limit is raised rather than stalling
+ * on every frame */
+static void wait_for_room(amf_base *enc, std::unique_lock<std::mutex> &lock)
+{
+	const auto frame_time = std::chrono::nanoseconds(SEC_TO_NSEC * enc->fps_den / enc->fps_num);
+
+	while (enc->in_flight >= enc->in_flight_limit && enc->output_error == AMF_OK) {
+		if (enc->output_cv.wait_for(lock, frame_time * 2) == std::cv_status::timeout &&
+		    enc->in_flight >= enc->in_flight_limit) {
+			if (enc->in_flight_limit >= max_in_flight_frames + (int)enc->dts_offset)
+				throw amf_error("Timed out waiting for encoder output", AMF_REPEAT);
+
+			enc->in_flight_limit++;
+			debug("raised frames in flight limit to %d", enc->in_flight_limit);
+		}
+	}
+
+	if (enc->output_error != AMF_OK)
+		throw amf_error("QueryOutput failed", enc->output_error);
+}
+
 static void amf_encode_base(amf_base *enc, AMFSurface *amf_surf, encoder_packet *packet, bool *received_packet)
 {
 	auto &queued_packets = enc->queued_packets;
@@ -637,20 +755,24 @@ static void amf_encode_base(amf_base *enc, AMFSurface *amf_surf, encoder_packet
 
 	*received_packet = false;
 
-	bool waiting = true;
-	while (waiting) {
-		/* ----------------------------------- */
-		/* add ROI data (if any)               */
-		if (enc->roi_supported && obs_encoder_has_roi(enc->encoder))
-			add_roi(enc, amf_surf);
+	{
+		std::unique_lock lock(enc->output_mutex);
+		wait_for_room(enc, lock);
+	}
+
+	/* ----------------------------------- */
+	/* add ROI data (if any)               */
+	if (enc->roi_supported && obs_encoder_has_roi(enc->encoder))
+		add_roi(enc, amf_surf);
 
-		/* ----------------------------------- */
-		/* submit frame                        */
+	/* ----------------------------------- */
+	/* submit frame                        */
 
+	for (;;) {
 		res = enc->amf_encoder->SubmitInput(amf_surf);
 
 		if (res == AMF_OK || res == AMF_NEED_MORE_INPUT) {
-			waiting = false;
+			break;
 
 		} else if (res == AMF_INPUT_FULL) {
 			os_sleep_ms(1);
@@ -664,31 +786,25 @@ static void amf_encode_base(amf_base *enc, AMFSurface *amf_surf, encoder_packet
 		} else {
 			throw amf_error("SubmitInput failed", res);
 		}
-
-		/* ----------------------------------- */
-		/* query as many packets as possible   */
-
-		AMFDataPtr new_packet;
-		do {
-			res = enc->amf_encoder->QueryOutput(&new_packet);
-			if (new_packet)
-				queued_packets.push_back(new_packet);
-
-			if (res != AMF_REPEAT && res != AMF_OK) {
-				throw amf_error("QueryOutput failed", res);
-			}
-		} while (!!new_packet);
 	}
 
 	/* ----------------------------------- */
 	/* return a packet if available        */
 
-	if (queued_packets.size()) {
-		AMFDataPtr amf_out;
+	AMFDataPtr amf_out;
 
-		amf_out = queued_packets.front();
-		queued_packets.pop_front();
+	{
+		std::scoped_lock lock(enc->output_mutex);
+		enc->in_flight++;
+		enc->output_cv.notify_all();
 
+		if (queued_packets.size()) {
+			amf_out = queued_packets.front();
+			queued_packets.pop_front();
+		}
+	}
+
+	if (amf_out) {
 		*received_packet = true;
 		convert_to_encoder_packet(enc, amf_out, packet);
 	}
@@ -1091,6 +1207,7 @@ static void amf_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "preset", "quality");
 	obs_data_set_default_string(settings, "profile", "high");
 	obs_data_set_default_int(settings, "bf", 3);
+	obs_data_set_default_int(settings, "in_flight_frames", 0);
 }
 
 static bool rate_control_modified(obs_properties_t *ppts, obs_property_t *p, obs_data_t *settings)
@@ -1161,6 +1278,9 @@ static obs_properties_t *amf_properties_internal(amf_codec_type codec)
 		obs_properties_add_int(props, "bf", obs_module_text("BFrames"), 0, 5, 1);
 	}
 
+	p = obs_properties_add_int(props, "in_flight_frames", obs_module_text("AMF.InFlightFrames"), 0, 16, 1);
+	obs_property_set_long_description(p, obs_module_text("AMF.InFlightFrames.ToolTip"));
+
 	p = obs_properties_add_text(props, "ffmpeg_opts", obs_module_text("AMFOpts"), OBS_TEXT_DEFAULT);
 	obs_property_set_long_description(p, obs_module_text("AMFOpts.ToolTip"));
 
@@ -1279,6 +1399,8 @@ try {
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Flush failed", res);
 
+	reset_in_flight(enc);
+
 	res = enc->amf_encoder->ReInit(enc->cx, enc->cy);
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::ReInit failed", res);
@@ -1427,6 +1549,8 @@ static void amf_avc_create_internal(amf_base *enc, obs_data_t *settings)
 		else
 			enc->dts_offset = 0;
 	}
+
+	start_output_thread(enc, settings);
 }
 
 static void *amf_avc_create_texencode(obs_data_t *settings, obs_encoder_t *encoder)
@@ -1603,6 +1727,8 @@ try {
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Flush failed", res);
 
+	reset_in_flight(enc);
+
 	res = enc->amf_encoder->ReInit(enc->cx, enc->cy);
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::ReInit failed", res);
@@ -1758,6 +1884,8 @@ static void amf_hevc_create_internal(amf_base *enc, obs_data_t *settings)
 	res = enc->amf_encoder->GetProperty(AMF_VIDEO_ENCODER_HEVC_EXTRADATA, &p);
 	if (res == AMF_OK && p.type == AMF_VARIANT_INTERFACE)
 		enc->header = AMFBufferPtr(p.pInterface);
+
+	start_output_thread(enc, settings);
 }
 
 static void *amf_hevc_create_texencode(obs_data_t *settings, obs_encoder_t *encoder)
@@ -1949,6 +2077,8 @@ try {
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Flush failed", res);
 
+	reset_in_flight(enc);
+
 	res = enc->amf_encoder->ReInit(enc->cx, enc->cy);
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::ReInit failed", res);
@@ -2053,6 +2183,8 @@ static void amf_av1_create_internal(amf_base *enc, obs_data_t *settings)
 	res = enc->amf_encoder->GetProperty(AMF_VIDEO_ENCODER_AV1_EXTRA_DATA, &p);
 	if (res == AMF_OK && p.type == AMF_VARIANT_INTERFACE)
 		enc->header = AMFBufferPtr(p.pInterface);
+
+	start_output_thread(enc, settings);
 }
 
 static void *amf_av1_create_texencode(obs_data_t *settings, obs_encoder_t *encoder)
@@ -2127,6 +2259,7 @@ static void amf_av1_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "rate_control", "CBR");
 	obs_data_set_default_string(settings, "preset", "quality");
 	obs_data_set_default_string(settings, "profile", "high");
+	obs_data_set_default_int(settings, "in_flight_frames", 0);
 }
 
 static void register_av1()
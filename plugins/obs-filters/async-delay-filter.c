@@ -161,6 +161,10 @@ static struct obs_source_frame *async_delay_filter_video(void *data, struct obs_
 
 	filter->last_video_ts = frame->timestamp;
 
+	/* frames are held by reference, only lent ones have to be copied so
+	 * their source gets its buffers back */
+	frame = obs_source_frame_hold(parent, frame);
+
 	deque_push_back(&filter->video_frames, &frame, sizeof(struct obs_source_frame *));
 	deque_peek_front(&filter->video_frames, &output, sizeof(struct obs_source_frame *));
 
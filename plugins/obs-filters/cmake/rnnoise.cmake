@@ -41,6 +41,12 @@ if(ENABLE_RNNOISE)
 
       target_compile_options(obs-rnnoise PRIVATE -Wno-newline-eof -Wno-error=null-dereference)
 
+      # The dense and GRU kernels in rnn.c rely on loop vectorization
+      set_source_files_properties(
+        rnnoise/src/rnn.c
+        PROPERTIES COMPILE_OPTIONS "$<$<NOT:$<CONFIG:Debug>>:-O3>"
+      )
+
       set_target_properties(obs-rnnoise PROPERTIES FOLDER plugins/obs-filters/rnnoise POSITION_INDEPENDENT_CODE TRUE)
     endif()
   endif()
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <obs-module.h>
 #include <graphics/matrix4.h>
 #include <graphics/quat.h>
+#include <util/dstr.h>
 
 /* clang-format off */
 
@@ -600,6 +601,42 @@ static void color_correction_filter_render_v2(void *data, gs_effect_t *effect)
 	}
 }
 
+/*
+ * Same as PSColorFilterRGBA in the .effect file, so that OBS can draw this
+ * filter together with its neighbours in a single pass.
+ */
+static const char *color_correction_pixel_function = "uniform float $gamma;\n"
+						     "uniform float4x4 $color_matrix;\n"
+						     "\n"
+						     "float4 $process(float4 rgba)\n"
+						     "{\n"
+						     "\trgba.rgb *= (rgba.a > 0.) ? (1. / rgba.a) : 0.;\n"
+						     "\trgba.rgb = pow(rgba.rgb, float3($gamma, $gamma, $gamma));\n"
+						     "\trgba = mul($color_matrix, rgba);\n"
+						     "\trgba.rgb *= rgba.a;\n"
+						     "\treturn rgba;\n"
+						     "}\n";
+
+static const char *color_correction_filter_get_pixel_function(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return color_correction_pixel_function;
+}
+
+static void color_correction_filter_set_pixel_params(void *data, gs_effect_t *effect, const char *prefix)
+{
+	struct color_correction_filter_data_v2 *filter = data;
+	struct dstr name = {0};
+
+	dstr_printf(&name, "%sgamma", prefix);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, name.array), filter->gamma);
+
+	dstr_printf(&name, "%scolor_matrix", prefix);
+	gs_effect_set_matrix4(gs_effect_get_param_by_name(effect, name.array), &filter->final_matrix);
+
+	dstr_free(&name);
+}
+
 /*
  * This function sets the interface. the types (add_*_Slider), the type of
  * data collected (int), the internal name, user-facing name, minimum,
@@ -730,4 +767,6 @@ struct obs_source_info color_filter_v2 = {
 	.get_properties = color_correction_filter_properties_v2,
 	.get_defaults = color_correction_filter_defaults_v2,
 	.video_get_color_space = color_correction_filter_get_color_space,
+	.filter_get_pixel_function = color_correction_filter_get_pixel_function,
+	.filter_set_pixel_params = color_correction_filter_set_pixel_params,
 };
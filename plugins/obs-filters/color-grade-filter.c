@@ -1,8 +1,11 @@
 #include <obs-module.h>
 #include <graphics/half.h>
 #include <graphics/image-file.h>
+#include <util/darray.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <sys/stat.h>
 
 /* clang-format off */
 
@@ -25,22 +28,31 @@ enum clut_dimension {
 	CLUT_3D,
 };
 
+/* parsed LUTs are shared by every filter using the same file, keyed by path
+ * and modification time */
+struct clut {
+	char *path;
+	time_t timestamp;
+	long refs;
+
+	gs_texture_t *texture;
+	enum clut_dimension dim;
+	struct vec3 clut_scale;
+	struct vec3 clut_offset;
+	struct vec3 domain_min;
+	struct vec3 domain_max;
+};
+
+static pthread_mutex_t clut_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct clut *) clut_cache;
+
 struct lut_filter_data {
 	obs_source_t *context;
 	gs_effect_t *effect;
-	gs_texture_t *target;
-
-	gs_image_file_t image;
-
-	uint32_t cube_width;
-	void *cube_data;
+	struct clut *clut;
 
 	char *file;
 	float clut_amount;
-	struct vec3 clut_scale;
-	struct vec3 clut_offset;
-	struct vec3 domain_min;
-	struct vec3 domain_max;
 	const char *clut_texture_name;
 	const char *tech_name;
 };
@@ -112,7 +124,7 @@ static bool get_cube_entry(FILE *const file, float *const red, float *const gree
 
 static void *load_1d_lut(FILE *const file, const uint32_t width, float red, float green, float blue)
 {
-	const uint32_t data_size = 4 * width * width * width * sizeof(struct half);
+	const uint32_t data_size = 4 * width * sizeof(struct half);
 	struct half *values = bmalloc(data_size);
 
 	size_t offset = 0;
@@ -222,6 +234,129 @@ static void *load_cube_file(const char *const path, uint32_t *const width, struc
 	return data;
 }
 
+static time_t get_modified_timestamp(const char *path)
+{
+	struct stat stats;
+	if (os_stat(path, &stats) != 0)
+		return -1;
+	return stats.st_mtime;
+}
+
+/* assumes the graphics context */
+static bool load_clut(struct clut *clut)
+{
+	const char *const path = clut->path;
+	uint32_t width = LUT_WIDTH;
+	void *cube_data = NULL;
+
+	clut->dim = CLUT_3D;
+	vec3_set(&clut->domain_min, 0.0f, 0.0f, 0.0f);
+	vec3_set(&clut->domain_max, 1.0f, 1.0f, 1.0f);
+
+	const char *const ext = os_get_path_extension(path);
+	if (ext && astrcmpi(ext, ".cube") == 0)
+		cube_data = load_cube_file(path, &width, &clut->domain_min, &clut->domain_max, &clut->dim);
+
+	if (cube_data) {
+		if (clut->dim == CLUT_1D) {
+			clut->texture = gs_texture_create(width, 1, GS_RGBA16F, 1, (const uint8_t **)&cube_data, 0);
+		} else {
+			clut->texture = gs_voltexture_create(width, width, width, GS_RGBA16F, 1,
+							     (const uint8_t **)&cube_data, 0);
+		}
+		bfree(cube_data);
+
+		struct vec3 domain_scale;
+		vec3_sub(&domain_scale, &clut->domain_max, &clut->domain_min);
+
+		const float width_minus_one = (float)(width - 1);
+		vec3_set(&clut->clut_scale, width_minus_one, width_minus_one, width_minus_one);
+		vec3_div(&clut->clut_scale, &clut->clut_scale, &domain_scale);
+
+		vec3_neg(&clut->clut_offset, &clut->domain_min);
+		vec3_mul(&clut->clut_offset, &clut->clut_offset, &clut->clut_scale);
+
+		/* want normalized UVW */
+		vec3_divf(&clut->clut_scale, &clut->clut_scale, (float)width);
+		vec3_addf(&clut->clut_offset, &clut->clut_offset, 0.5f);
+		vec3_divf(&clut->clut_offset, &clut->clut_offset, (float)width);
+
+	} else if (!ext || astrcmpi(ext, ".cube") != 0) {
+		gs_image_file_t image;
+		gs_image_file_init(&image, path);
+
+		if (image.loaded) {
+			clut->texture = make_clut_texture_png(image.format, image.cx, image.cy, image.texture_data);
+			const float width_i = 1.0f / (float)LUT_WIDTH;
+			const float clut_scale = 1.0f - width_i;
+			const float offset = 0.5f * width_i;
+			vec3_set(&clut->clut_scale, clut_scale, clut_scale, clut_scale);
+			vec3_set(&clut->clut_offset, offset, offset, offset);
+		}
+
+		gs_image_file_free(&image);
+	}
+
+	return clut->texture != NULL;
+}
+
+/* assumes the graphics context */
+static struct clut *clut_acquire(const char *path)
+{
+	const time_t timestamp = get_modified_timestamp(path);
+	struct clut *clut = NULL;
+
+	pthread_mutex_lock(&clut_cache_mutex);
+
+	for (size_t i = 0; i < clut_cache.num; i++) {
+		struct clut *cur = clut_cache.array[i];
+		if (cur->timestamp == timestamp && strcmp(cur->path, path) == 0) {
+			clut = cur;
+			clut->refs++;
+			break;
+		}
+	}
+
+	if (!clut) {
+		clut = bzalloc(sizeof(*clut));
+		clut->path = bstrdup(path);
+		clut->timestamp = timestamp;
+		clut->refs = 1;
+
+		if (load_clut(clut)) {
+			da_push_back(clut_cache, &clut);
+		} else {
+			bfree(clut->path);
+			bfree(clut);
+			clut = NULL;
+		}
+	}
+
+	pthread_mutex_unlock(&clut_cache_mutex);
+	return clut;
+}
+
+/* assumes the graphics context */
+static void clut_release(struct clut *clut)
+{
+	if (!clut)
+		return;
+
+	pthread_mutex_lock(&clut_cache_mutex);
+
+	if (--clut->refs == 0) {
+		da_erase_item(clut_cache, &clut);
+		if (!clut_cache.num)
+			da_free(clut_cache);
+
+		gs_voltexture_destroy(clut->texture);
+		bfree(clut->path);
+		bfree(clut);
+	}
+
+	pthread_mutex_unlock(&clut_cache_mutex);
+}
+
 static void color_grade_filter_update(void *data, obs_data_t *settings)
 {
 	struct lut_filter_data *filter = data;
@@ -239,38 +374,22 @@ static void color_grade_filter_update(void *data, obs_data_t *settings)
 	else
 		filter->file = NULL;
 
-	bfree(filter->cube_data);
-	filter->cube_data = NULL;
-
 	obs_enter_graphics();
-	gs_image_file_free(&filter->image);
-	gs_voltexture_destroy(filter->target);
-	filter->target = NULL;
-	obs_leave_graphics();
 
-	enum clut_dimension clut_dim = CLUT_3D;
+	/* acquire before releasing, so an unchanged LUT is not reloaded */
+	struct clut *clut = path ? clut_acquire(path) : NULL;
+	clut_release(filter->clut);
+	filter->clut = clut;
+
 	const char *clut_texture_name = "clut_3d";
 	const char *tech_name = "Draw3D";
 
-	if (path) {
-		vec3_set(&filter->domain_min, 0.0f, 0.0f, 0.0f);
-		vec3_set(&filter->domain_max, 1.0f, 1.0f, 1.0f);
-
-		const char *const ext = os_get_path_extension(path);
-		if (ext && astrcmpi(ext, ".cube") == 0) {
-			filter->cube_data = load_cube_file(path, &filter->cube_width, &filter->domain_min,
-							   &filter->domain_max, &clut_dim);
-		} else {
-			gs_image_file_init(&filter->image, path);
-			filter->cube_width = LUT_WIDTH;
-		}
-
-		if (clut_dim == CLUT_1D) {
+	if (clut) {
+		if (clut->dim == CLUT_1D) {
 			clut_texture_name = "clut_1d";
 			tech_name = "Draw1D";
-		} else if ((filter->domain_min.x > 0.f) || (filter->domain_min.y > 0.f) ||
-			   (filter->domain_min.z > 0.f) || (filter->domain_max.x < 1.f) ||
-			   (filter->domain_max.y < 1.f) || (filter->domain_max.z < 1.f)) {
+		} else if ((clut->domain_min.x > 0.f) || (clut->domain_min.y > 0.f) || (clut->domain_min.z > 0.f) ||
+			   (clut->domain_max.x < 1.f) || (clut->domain_max.y < 1.f) || (clut->domain_max.z < 1.f)) {
 			tech_name = "DrawDomain3D";
 		} else if (clut_amount < 1.0) {
 			tech_name = "DrawAmount3D";
@@ -279,44 +398,6 @@ static void color_grade_filter_update(void *data, obs_data_t *settings)
 		}
 	}
 
-	obs_enter_graphics();
-
-	if (path) {
-		if (filter->image.loaded) {
-			filter->target = make_clut_texture_png(filter->image.format, filter->image.cx, filter->image.cy,
-							       filter->image.texture_data);
-			const float width_i = 1.0f / (float)LUT_WIDTH;
-			const float clut_scale = 1.0f - width_i;
-			const float offset = 0.5f * width_i;
-			vec3_set(&filter->clut_scale, clut_scale, clut_scale, clut_scale);
-			vec3_set(&filter->clut_offset, offset, offset, offset);
-		} else if (filter->cube_data) {
-			const uint32_t width = filter->cube_width;
-			if (clut_dim == CLUT_1D) {
-				filter->target = gs_texture_create(width, 1, GS_RGBA16F, 1,
-								   (const uint8_t **)&filter->cube_data, 0);
-			} else {
-				filter->target = gs_voltexture_create(width, width, width, GS_RGBA16F, 1,
-								      (const uint8_t **)&filter->cube_data, 0);
-			}
-
-			struct vec3 domain_scale;
-			vec3_sub(&domain_scale, &filter->domain_max, &filter->domain_min);
-
-			const float width_minus_one = (float)(width - 1);
-			vec3_set(&filter->clut_scale, width_minus_one, width_minus_one, width_minus_one);
-			vec3_div(&filter->clut_scale, &filter->clut_scale, &domain_scale);
-
-			vec3_neg(&filter->clut_offset, &filter->domain_min);
-			vec3_mul(&filter->clut_offset, &filter->clut_offset, &filter->clut_scale);
-
-			/* want normalized UVW */
-			vec3_divf(&filter->clut_scale, &filter->clut_scale, (float)width);
-			vec3_addf(&filter->clut_offset, &filter->clut_offset, 0.5f);
-			vec3_divf(&filter->clut_offset, &filter->clut_offset, (float)width);
-		}
-	}
-
 	filter->clut_amount = (float)clut_amount;
 	filter->clut_texture_name = clut_texture_name;
 	filter->tech_name = tech_name;
@@ -383,11 +464,9 @@ static void color_grade_filter_destroy(void *data)
 
 	obs_enter_graphics();
 	gs_effect_destroy(filter->effect);
-	gs_voltexture_destroy(filter->target);
-	gs_image_file_free(&filter->image);
+	clut_release(filter->clut);
 	obs_leave_graphics();
 
-	bfree(filter->cube_data);
 	bfree(filter->file);
 	bfree(filter);
 }
@@ -399,7 +478,8 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 	struct lut_filter_data *filter = data;
 	obs_source_t *target = obs_filter_get_target(filter->context);
 
-	if (!target || !filter->target || !filter->effect) {
+	struct clut *const clut = filter->clut;
+	if (!target || !clut || !filter->effect) {
 		obs_source_skip_video_filter(filter->context);
 		return;
 	}
@@ -419,22 +499,22 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 		if (obs_source_process_filter_begin_with_color_space(filter->context, format, source_space,
 								     OBS_ALLOW_DIRECT_RENDERING)) {
 			gs_eparam_t *param = gs_effect_get_param_by_name(filter->effect, filter->clut_texture_name);
-			gs_effect_set_texture_srgb(param, filter->target);
+			gs_effect_set_texture_srgb(param, clut->texture);
 
 			param = gs_effect_get_param_by_name(filter->effect, "clut_amount");
 			gs_effect_set_float(param, filter->clut_amount);
 
 			param = gs_effect_get_param_by_name(filter->effect, "clut_scale");
-			gs_effect_set_vec3(param, &filter->clut_scale);
+			gs_effect_set_vec3(param, &clut->clut_scale);
 
 			param = gs_effect_get_param_by_name(filter->effect, "clut_offset");
-			gs_effect_set_vec3(param, &filter->clut_offset);
+			gs_effect_set_vec3(param, &clut->clut_offset);
 
 			param = gs_effect_get_param_by_name(filter->effect, "domain_min");
-			gs_effect_set_vec3(param, &filter->domain_min);
+			gs_effect_set_vec3(param, &clut->domain_min);
 
 			param = gs_effect_get_param_by_name(filter->effect, "domain_max");
-			gs_effect_set_vec3(param, &filter->domain_max);
+			gs_effect_set_vec3(param, &clut->domain_max);
 
 			gs_blend_state_push();
 			gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
@@ -327,7 +327,7 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 	/* --------------------------------- */
 	/* gain stage of expansion           */
 
-	float env_db = mul_to_db(env_buf[idx]);
+	float env_db = fast_mul_to_db(env_buf[idx]);
 	float diff = threshold - env_db;
 
 	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
@@ -365,9 +365,9 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 	/* output                            */
 
 	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
+		gain = fast_db_to_mul(fminf(0, gain_db[idx]));
 	} else {
-		gain = db_to_mul(gain_db[idx]);
+		gain = fast_db_to_mul(gain_db[idx]);
 	}
 
 	samples[idx] *= gain * output_gain;
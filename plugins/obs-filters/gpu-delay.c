@@ -3,11 +3,22 @@
 #include <util/util_uint64.h>
 
 #define S_DELAY_MS "delay_ms"
+#define S_PACKED "packed"
 #define T_DELAY_MS obs_module_text("DelayMs")
+#define T_PACKED obs_module_text("GPUDelay.Packed")
+#define T_PACKED_DESC obs_module_text("GPUDelay.Packed.Description")
 
+#define MAX_DELAY_MS 500
+#define MAX_PACKED_DELAY_MS 2000
+
+/* Packed frames hold luma in an R8 texture and chroma in a half size R8G8
+ * texture, 1.5 bytes per pixel instead of 4 (or 8 for 16F), at the cost of
+ * alpha and chroma resolution.  Only SDR frames are packed. */
 struct frame {
 	gs_texrender_t *render;
+	gs_texrender_t *chroma;
 	enum gs_color_space space;
+	bool packed;
 	uint64_t ts;
 };
 
@@ -20,6 +31,10 @@ struct gpu_delay_filter_data {
 	uint32_t cy;
 	bool target_valid;
 	bool processed_frame;
+
+	bool packed;
+	gs_effect_t *effect;
+	gs_texrender_t *scratch;
 };
 
 static const char *gpu_delay_filter_get_name(void *unused)
@@ -28,15 +43,23 @@ static const char *gpu_delay_filter_get_name(void *unused)
 	return obs_module_text("GPUDelayFilter");
 }
 
+static inline void destroy_frame(struct frame *frame)
+{
+	gs_texrender_destroy(frame->render);
+	gs_texrender_destroy(frame->chroma);
+}
+
 static void free_textures(struct gpu_delay_filter_data *f)
 {
 	obs_enter_graphics();
 	while (f->frames.size) {
 		struct frame frame;
 		deque_pop_front(&f->frames, &frame, sizeof(frame));
-		gs_texrender_destroy(frame.render);
+		destroy_frame(&frame);
 	}
 	deque_free(&f->frames);
+	gs_texrender_destroy(f->scratch);
+	f->scratch = NULL;
 	obs_leave_graphics();
 }
 
@@ -65,6 +88,8 @@ static void update_interval(struct gpu_delay_filter_data *f, uint64_t new_interv
 		for (size_t i = prev_num; i < num; i++) {
 			struct frame *frame = deque_data(&f->frames, i * sizeof(*frame));
 			frame->render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+			frame->chroma = NULL;
+			frame->packed = false;
 		}
 
 		obs_leave_graphics();
@@ -75,7 +100,7 @@ static void update_interval(struct gpu_delay_filter_data *f, uint64_t new_interv
 		while (num_frames(&f->frames) > num) {
 			struct frame frame;
 			deque_pop_front(&f->frames, &frame, sizeof(frame));
-			gs_texrender_destroy(frame.render);
+			destroy_frame(&frame);
 		}
 
 		obs_leave_graphics();
@@ -133,7 +158,13 @@ static void gpu_delay_filter_update(void *data, obs_data_t *s)
 {
 	struct gpu_delay_filter_data *f = data;
 
-	f->delay_ns = (uint64_t)obs_data_get_int(s, S_DELAY_MS) * 1000000ULL;
+	f->packed = obs_data_get_bool(s, S_PACKED) && f->effect;
+
+	/* the higher limit only applies to packed frames */
+	int64_t delay_ms = obs_data_get_int(s, S_DELAY_MS);
+	if (!f->packed && delay_ms > MAX_DELAY_MS)
+		delay_ms = MAX_DELAY_MS;
+	f->delay_ns = (uint64_t)delay_ms * 1000000ULL;
 
 	/* full reset */
 	f->cx = 0;
@@ -142,13 +173,25 @@ static void gpu_delay_filter_update(void *data, obs_data_t *s)
 	free_textures(f);
 }
 
+static bool packed_modified(obs_properties_t *props, obs_property_t *p, obs_data_t *settings)
+{
+	bool packed = obs_data_get_bool(settings, S_PACKED);
+	p = obs_properties_get(props, S_DELAY_MS);
+	obs_property_int_set_limits(p, 0, packed ? MAX_PACKED_DELAY_MS : MAX_DELAY_MS, 1);
+	return true;
+}
+
 static obs_properties_t *gpu_delay_filter_properties(void *data)
 {
 	obs_properties_t *props = obs_properties_create();
 
-	obs_property_t *p = obs_properties_add_int(props, S_DELAY_MS, T_DELAY_MS, 0, 500, 1);
+	obs_property_t *p = obs_properties_add_int(props, S_DELAY_MS, T_DELAY_MS, 0, MAX_DELAY_MS, 1);
 	obs_property_int_set_suffix(p, " ms");
 
+	p = obs_properties_add_bool(props, S_PACKED, T_PACKED);
+	obs_property_set_long_description(p, T_PACKED_DESC);
+	obs_property_set_modified_callback(p, packed_modified);
+
 	UNUSED_PARAMETER(data);
 	return props;
 }
@@ -156,8 +199,16 @@ static obs_properties_t *gpu_delay_filter_properties(void *data)
 static void *gpu_delay_filter_create(obs_data_t *settings, obs_source_t *context)
 {
 	struct gpu_delay_filter_data *f = bzalloc(sizeof(*f));
+	char *effect_path = obs_module_file("gpu_delay.effect");
+
 	f->context = context;
 
+	obs_enter_graphics();
+	f->effect = gs_effect_create_from_file(effect_path, NULL);
+	obs_leave_graphics();
+
+	bfree(effect_path);
+
 	obs_source_update(context, settings);
 	return f;
 }
@@ -167,6 +218,11 @@ static void gpu_delay_filter_destroy(void *data)
 	struct gpu_delay_filter_data *f = data;
 
 	free_textures(f);
+
+	obs_enter_graphics();
+	gs_effect_destroy(f->effect);
+	obs_leave_graphics();
+
 	bfree(f);
 }
 
@@ -230,6 +286,35 @@ static const char *get_tech_name_and_multiplier(enum gs_color_space current_spac
 	return tech_name;
 }
 
+static void draw_packed_frame(struct gpu_delay_filter_data *f, struct frame *frame,
+			      enum gs_color_space current_space)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(frame->render);
+	gs_texture_t *tex_uv = gs_texrender_get_texture(frame->chroma);
+	if (!tex || !tex_uv)
+		return;
+
+	/* packed frames are always sRGB, the shader outputs linear values */
+	const char *technique = "DrawPacked";
+	float multiplier = 1.f;
+	if (current_space == GS_CS_709_SCRGB) {
+		technique = "DrawPackedMultiply";
+		multiplier = obs_get_video_sdr_white_level() / 80.0f;
+	}
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(f->effect, "image"), tex);
+	gs_effect_set_texture(gs_effect_get_param_by_name(f->effect, "image_uv"), tex_uv);
+	gs_effect_set_float(gs_effect_get_param_by_name(f->effect, "multiplier"), multiplier);
+
+	while (gs_effect_loop(f->effect, technique))
+		gs_draw_sprite(tex, 0, f->cx, f->cy);
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 static void draw_frame(struct gpu_delay_filter_data *f)
 {
 	struct frame frame;
@@ -239,6 +324,11 @@ static void draw_frame(struct gpu_delay_filter_data *f)
 	float multiplier;
 	const char *technique = get_tech_name_and_multiplier(current_space, frame.space, &multiplier);
 
+	if (frame.packed) {
+		draw_packed_frame(f, &frame, current_space);
+		return;
+	}
+
 	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
 	gs_texture_t *tex = gs_texrender_get_texture(frame.render);
 	if (tex) {
@@ -255,6 +345,83 @@ static void draw_frame(struct gpu_delay_filter_data *f)
 	}
 }
 
+static bool render_target(struct gpu_delay_filter_data *f, gs_texrender_t *render, enum gs_color_space space,
+			  obs_source_t *target, obs_source_t *parent)
+{
+	bool success = false;
+
+	gs_texrender_reset(render);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin_with_color_space(render, f->cx, f->cy, space)) {
+		uint32_t parent_flags = obs_source_get_output_flags(target);
+		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)f->cx, 0.0f, (float)f->cy, -100.0f, 100.0f);
+
+		if (target == parent && !custom_draw && !async)
+			obs_source_default_render(target);
+		else
+			obs_source_video_render(target);
+
+		gs_texrender_end(render);
+		success = true;
+	}
+
+	gs_blend_state_pop();
+	return success;
+}
+
+static void pack_plane(struct gpu_delay_filter_data *f, gs_texrender_t *render, gs_texture_t *tex, uint32_t cx,
+		       uint32_t cy, const char *technique)
+{
+	gs_texrender_reset(render);
+
+	if (gs_texrender_begin(render, cx, cy)) {
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		gs_effect_set_texture(gs_effect_get_param_by_name(f->effect, "image"), tex);
+		while (gs_effect_loop(f->effect, technique))
+			gs_draw_sprite(tex, 0, cx, cy);
+
+		gs_texrender_end(render);
+	}
+}
+
+/* converts the scratch render into the packed planes of the frame */
+static void pack_frame(struct gpu_delay_filter_data *f, struct frame *frame)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(f->scratch);
+	if (!tex)
+		return;
+
+	if (!frame->packed) {
+		gs_texrender_destroy(frame->render);
+		frame->render = gs_texrender_create(GS_R8, GS_ZS_NONE);
+		frame->chroma = gs_texrender_create(GS_R8G8, GS_ZS_NONE);
+		frame->packed = true;
+	}
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(false);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	pack_plane(f, frame->render, tex, f->cx, f->cy, "PackY");
+	pack_plane(f, frame->chroma, tex, (f->cx + 1) / 2, (f->cy + 1) / 2, "PackUV");
+
+	gs_blend_state_pop();
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 {
 	struct gpu_delay_filter_data *f = data;
@@ -274,6 +441,9 @@ static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 	struct frame frame;
 	deque_pop_front(&f->frames, &frame, sizeof(frame));
 
+	/* the delayed frames are counted as this filter's memory */
+	gs_memory_push_scope(GS_MEMORY_FILTER, f->context);
+
 	const enum gs_color_space preferred_spaces[] = {
 		GS_CS_SRGB,
 		GS_CS_SRGB_16F,
@@ -281,38 +451,30 @@ static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 	};
 	const enum gs_color_space space =
 		obs_source_get_color_space(target, OBS_COUNTOF(preferred_spaces), preferred_spaces);
-	const enum gs_color_format format = gs_get_format_from_space(space);
-	if (gs_texrender_get_format(frame.render) != format) {
-		gs_texrender_destroy(frame.render);
-		frame.render = gs_texrender_create(format, GS_ZS_NONE);
-	}
-
-	gs_texrender_reset(frame.render);
-
-	gs_blend_state_push();
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-
-	if (gs_texrender_begin_with_color_space(frame.render, f->cx, f->cy, space)) {
-		uint32_t parent_flags = obs_source_get_output_flags(target);
-		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
-		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
-		struct vec4 clear_color;
-
-		vec4_zero(&clear_color);
-		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
-		gs_ortho(0.0f, (float)f->cx, 0.0f, (float)f->cy, -100.0f, 100.0f);
-
-		if (target == parent && !custom_draw && !async)
-			obs_source_default_render(target);
-		else
-			obs_source_video_render(target);
-
-		gs_texrender_end(frame.render);
+	const bool packed = f->packed && space == GS_CS_SRGB;
+
+	if (packed) {
+		if (!f->scratch)
+			f->scratch = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		if (render_target(f, f->scratch, space, target, parent)) {
+			pack_frame(f, &frame);
+			frame.space = space;
+		}
+	} else {
+		const enum gs_color_format format = gs_get_format_from_space(space);
+		if (frame.packed || gs_texrender_get_format(frame.render) != format) {
+			gs_texrender_destroy(frame.render);
+			gs_texrender_destroy(frame.chroma);
+			frame.render = gs_texrender_create(format, GS_ZS_NONE);
+			frame.chroma = NULL;
+			frame.packed = false;
+		}
 
-		frame.space = space;
+		if (render_target(f, frame.render, space, target, parent))
+			frame.space = space;
 	}
 
-	gs_blend_state_pop();
+	gs_memory_pop_scope();
 
 	deque_push_back(&f->frames, &frame, sizeof(frame));
 	draw_frame(f);
@@ -152,16 +152,26 @@ static void analyze_envelope(struct limiter_data *cd, float **samples, const uin
 
 static inline void process_compression(const struct limiter_data *cd, float **samples, uint32_t num_samples)
 {
+	/* the envelope is only needed up to here, so it is turned into the
+	 * gain in place, then each channel is scaled in a separate pass */
+	float *gain_buf = cd->envelope_buf;
+	const float slope = cd->slope;
+	const float threshold = cd->threshold;
+	const float output_gain = cd->output_gain;
+
 	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
+		const float env_db = fast_mul_to_db(gain_buf[i]);
+		const float gain = slope * (threshold - env_db);
+		gain_buf[i] = fast_db_to_mul(gain < 0.0f ? gain : 0.0f) * output_gain;
+	}
 
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		float *channel = samples[c];
+		if (!channel)
+			continue;
+
+		for (size_t i = 0; i < num_samples; ++i)
+			channel[i] *= gain_buf[i];
 	}
 }
 
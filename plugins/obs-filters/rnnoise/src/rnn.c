@@ -76,22 +76,49 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+/* The weight matrices are stored input-major, so accumulating one input at a
+   time walks each row contiguously and lets the compiler vectorize the inner
+   loop over neurons.  On x86-64 ELF targets an AVX2 clone is also built and
+   picked at load time; aarch64 gets NEON from the baseline ISA. */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__) && \
+    (!defined(__clang__) || __clang_major__ >= 14)
+#define RNN_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define RNN_TARGET_CLONES
+#endif
+
+RNN_TARGET_CLONES
+static void accumulate(float *sum, const rnn_weight *weights, int N, int M, int stride, const float *input)
 {
    int i, j;
+   for (j=0;j<M;j++)
+   {
+      const rnn_weight *w = &weights[j*stride];
+      float x = input[j];
+      for (i=0;i<N;i++)
+         sum[i] += w[i]*x;
+   }
+}
+
+static OPUS_INLINE void init_sum(float *sum, const rnn_weight *bias, int N)
+{
+   int i;
+   for (i=0;i<N;i++)
+      sum[i] = bias[i];
+}
+
+static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+{
+   int i;
    int N, M;
    int stride;
    M = layer->nb_inputs;
    N = layer->nb_neurons;
    stride = N;
+   init_sum(output, layer->bias, N);
+   accumulate(output, layer->input_weights, N, M, stride, input);
    for (i=0;i<N;i++)
-   {
-      /* Compute update gate. */
-      float sum = layer->bias[i];
-      for (j=0;j<M;j++)
-         sum += layer->input_weights[j*stride + i]*input[j];
-      output[i] = WEIGHTS_SCALE*sum;
-   }
+      output[i] *= WEIGHTS_SCALE;
    if (layer->activation == ACTIVATION_SIGMOID) {
       for (i=0;i<N;i++)
          output[i] = sigmoid_approx(output[i]);
@@ -108,43 +135,38 @@ static void compute_dense(const DenseLayer *layer, float *output, const float *i
 
 static void compute_gru(const GRULayer *gru, float *state, const float *input)
 {
-   int i, j;
+   int i;
    int N, M;
    int stride;
    float z[MAX_NEURONS];
    float r[MAX_NEURONS];
    float h[MAX_NEURONS];
+   float rstate[MAX_NEURONS];
    M = gru->nb_inputs;
    N = gru->nb_neurons;
    stride = 3*N;
+   /* Compute update gate. */
+   init_sum(z, gru->bias, N);
+   accumulate(z, gru->input_weights, N, M, stride, input);
+   accumulate(z, gru->recurrent_weights, N, N, stride, state);
    for (i=0;i<N;i++)
-   {
-      /* Compute update gate. */
-      float sum = gru->bias[i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[j*stride + i]*state[j];
-      z[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
-   }
+      z[i] = sigmoid_approx(WEIGHTS_SCALE*z[i]);
+   /* Compute reset gate. */
+   init_sum(r, &gru->bias[N], N);
+   accumulate(r, &gru->input_weights[N], N, M, stride, input);
+   accumulate(r, &gru->recurrent_weights[N], N, N, stride, state);
    for (i=0;i<N;i++)
    {
-      /* Compute reset gate. */
-      float sum = gru->bias[N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[N + j*stride + i]*state[j];
-      r[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      r[i] = sigmoid_approx(WEIGHTS_SCALE*r[i]);
+      rstate[i] = state[i]*r[i];
    }
+   /* Compute output. */
+   init_sum(h, &gru->bias[2*N], N);
+   accumulate(h, &gru->input_weights[2*N], N, M, stride, input);
+   accumulate(h, &gru->recurrent_weights[2*N], N, N, stride, rstate);
    for (i=0;i<N;i++)
    {
-      /* Compute output. */
-      float sum = gru->bias[2*N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[2*N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[2*N + j*stride + i]*state[j]*r[j];
+      float sum = h[i];
       if (gru->activation == ACTIVATION_SIGMOID) sum = sigmoid_approx(WEIGHTS_SCALE*sum);
       else if (gru->activation == ACTIVATION_TANH) sum = tansig_approx(WEIGHTS_SCALE*sum);
       else if (gru->activation == ACTIVATION_RELU) sum = relu(WEIGHTS_SCALE*sum);
@@ -13,6 +13,9 @@ static void *cuda_lib = NULL;
 static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
 CudaFunctions *cu = NULL;
 
+static pthread_mutex_t ctx_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct cuda_shared_ctx *) shared_ctxs;
+
 bool load_cuda_lib(void)
 {
 #ifdef _WIN32
@@ -133,6 +136,70 @@ bool cuda_error_check(struct nvenc_data *enc, CUresult res, const char *func, co
 	return false;
 }
 
+bool cuda_ctx_acquire(struct nvenc_data *enc, CUdevice device)
+{
+	struct cuda_shared_ctx *shared = NULL;
+	bool success = true;
+
+	pthread_mutex_lock(&ctx_mutex);
+
+	for (size_t i = 0; i < shared_ctxs.num; i++) {
+		if (shared_ctxs.array[i]->device == device) {
+			shared = shared_ctxs.array[i];
+			break;
+		}
+	}
+
+	if (!shared) {
+		CUcontext ctx;
+
+		if (!cuda_error_check(enc, cu->cuCtxCreate(&ctx, 0, device), __FUNCTION__, "cuCtxCreate")) {
+			success = false;
+			goto fail;
+		}
+		cu->cuCtxPopCurrent(NULL);
+
+		shared = bzalloc(sizeof(*shared));
+		shared->device = device;
+		shared->ctx = ctx;
+		pthread_mutex_init(&shared->mutex, NULL);
+		da_push_back(shared_ctxs, &shared);
+	}
+
+	shared->refs++;
+	enc->cu_shared = shared;
+	enc->cu_ctx = shared->ctx;
+
+fail:
+	pthread_mutex_unlock(&ctx_mutex);
+	return success;
+}
+
+void cuda_ctx_release(struct nvenc_data *enc)
+{
+	struct cuda_shared_ctx *shared = enc->cu_shared;
+	if (!shared)
+		return;
+
+	pthread_mutex_lock(&ctx_mutex);
+
+	if (--shared->refs == 0) {
+		da_erase_item(shared_ctxs, &shared);
+		if (!shared_ctxs.num)
+			da_free(shared_ctxs);
+
+		cu->cuCtxDestroy(shared->ctx);
+		da_free(shared->textures);
+		pthread_mutex_destroy(&shared->mutex);
+		bfree(shared);
+	}
+
+	pthread_mutex_unlock(&ctx_mutex);
+
+	enc->cu_shared = NULL;
+	enc->cu_ctx = NULL;
+}
+
 bool init_cuda(obs_encoder_t *encoder)
 {
 	bool success;
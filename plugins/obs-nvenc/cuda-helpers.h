@@ -1,6 +1,8 @@
 #pragma once
 
 #include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
 
 #include <ffnvcodec/dynlink_cuda.h>
 
@@ -45,12 +47,37 @@ typedef struct CudaFunctions {
 
 extern CudaFunctions *cu;
 
+/* Texture registered with a shared context, used by every session that
+ * encodes it.  The tex_id is an OpenGL texture name. */
+struct cuda_shared_tex {
+	uint32_t tex_id;
+	CUgraphicsResource res_y;
+	CUgraphicsResource res_uv;
+	long refs;
+};
+
+/* One CUDA context per device, shared by every NVENC session on it, so
+ * that the renditions of a canvas do not each set up a context and register
+ * the same textures */
+struct cuda_shared_ctx {
+	CUdevice device;
+	CUcontext ctx;
+	long refs;
+
+	pthread_mutex_t mutex;
+	DARRAY(struct cuda_shared_tex) textures;
+};
+
 bool init_cuda(obs_encoder_t *encoder);
 bool cuda_get_error_desc(CUresult res, const char **name, const char **desc);
 
 struct nvenc_data;
 bool cuda_error_check(struct nvenc_data *enc, CUresult res, const char *func, const char *call);
 
+/* sets enc->cu_ctx to the shared context of the device */
+bool cuda_ctx_acquire(struct nvenc_data *enc, CUdevice device);
+void cuda_ctx_release(struct nvenc_data *enc);
+
 /* CUDA error handling */
 #define CU_FAILED(call)                                        \
 	if (!cuda_error_check(enc, call, __FUNCTION__, #call)) \
@@ -80,17 +80,14 @@ bool cuda_ctx_init(struct nvenc_data *enc, obs_data_t *settings, const bool text
 		debug("Loading up CUDA on device %u", device);
 	}
 #endif
-	CU_FAILED(cu->cuCtxCreate(&enc->cu_ctx, 0, device))
-	CU_FAILED(cu->cuCtxPopCurrent(NULL))
-
-	return true;
+	return cuda_ctx_acquire(enc, device);
 }
 
 void cuda_ctx_free(struct nvenc_data *enc)
 {
 	if (enc->cu_ctx) {
 		cu->cuCtxPopCurrent(NULL);
-		cu->cuCtxDestroy(enc->cu_ctx);
+		cuda_ctx_release(enc);
 	}
 }
 
@@ -325,3 +322,44 @@ bool cuda_encode(void *data, struct encoder_frame *frame, struct encoder_packet
 
 	return nvenc_encode_base(enc, bs, surf->mapped_res, frame->pts, packet, received_packet);
 }
+
+bool cuda_submit(void *data, struct encoder_frame *frame)
+{
+	struct nvenc_data *enc = data;
+	struct nv_cuda_surface *surf;
+	struct nv_bitstream *bs;
+
+	/* wait for the output thread to hand back a surface */
+	os_sem_wait(enc->free_sem);
+
+	bs = &enc->bitstreams.array[enc->next_bitstream];
+	surf = &enc->surfaces.array[enc->next_bitstream];
+
+	pthread_mutex_lock(&enc->dts_mutex);
+	deque_push_back(&enc->dts_list, &frame->pts, sizeof(frame->pts));
+	pthread_mutex_unlock(&enc->dts_mutex);
+
+	/* ------------------------------------ */
+	/* copy to CUDA surface                 */
+
+	if (!copy_frame(enc, frame, surf))
+		return false;
+
+	/* ------------------------------------ */
+	/* map output tex so nvenc can use it   */
+
+	NV_ENC_MAP_INPUT_RESOURCE map = {NV_ENC_MAP_INPUT_RESOURCE_VER};
+	map.registeredResource = surf->res;
+	map.mappedBufferFmt = enc->surface_format;
+
+	if (NV_FAILED(nv.nvEncMapInputResource(enc->session, &map)))
+		return false;
+
+	surf->mapped_res = map.mappedResource;
+
+	/* ------------------------------------ */
+	/* queue the encode, the output thread  */
+	/* picks up the packet                  */
+
+	return nvenc_submit_base(enc, bs, surf->mapped_res, frame->pts);
+}
@@ -4,6 +4,7 @@
 #include "nvenc-helpers.h"
 
 #include <util/deque.h>
+#include <util/threading.h>
 #include <opts-parser.h>
 
 #ifdef _WIN32
@@ -109,7 +110,23 @@ struct nvenc_data {
 
 	struct nvenc_properties props;
 
+	/* NVENC engines the frames are split across, 1 without split encode
+	 * or when the driver picks in auto mode */
+	int split_engines;
+
 	CUcontext cu_ctx;
+	struct cuda_shared_ctx *cu_shared;
+
+	/* Non-texture encoders are asynchronous: frames are submitted on the
+	 * video thread and the output thread waits for their bitstreams */
+	bool output_thread_active;
+	pthread_t output_thread;
+	os_sem_t *output_sem;
+	os_sem_t *free_sem;
+	pthread_mutex_t dts_mutex;
+	volatile long frames_pending;
+	volatile bool output_stop;
+	int64_t pts_step;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -156,6 +173,7 @@ struct nv_texture {
 
 bool nvenc_encode_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts,
 		       struct encoder_packet *packet, bool *received_packet);
+bool nvenc_submit_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts);
 
 /* ------------------------------------------------------------------------- */
 /* Backend-specific functions                                                */
@@ -180,6 +198,7 @@ bool cuda_init_surfaces(struct nvenc_data *enc);
 void cuda_free_surfaces(struct nvenc_data *enc);
 
 bool cuda_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet, bool *received_packet);
+bool cuda_submit(void *data, struct encoder_frame *frame);
 
 #ifndef _WIN32
 /** CUDA OpenGL **/
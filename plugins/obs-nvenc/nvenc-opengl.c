@@ -5,49 +5,104 @@
  * NVENC implementation using CUDA context and OpenGL textures
  */
 
+/* input_textures holds the textures of the shared context this session
+ * uses, each one counted once in the shared refs */
+static void release_shared_tex(struct cuda_shared_ctx *shared, GLuint tex_id)
+{
+	for (size_t i = 0; i < shared->textures.num; i++) {
+		struct cuda_shared_tex *st = &shared->textures.array[i];
+		if (st->tex_id != tex_id)
+			continue;
+
+		if (--st->refs == 0) {
+			cu->cuGraphicsUnregisterResource(st->res_y);
+			cu->cuGraphicsUnregisterResource(st->res_uv);
+			da_erase(shared->textures, i);
+		}
+		return;
+	}
+}
+
 void cuda_opengl_free(struct nvenc_data *enc)
 {
-	if (!enc->cu_ctx)
+	struct cuda_shared_ctx *shared = enc->cu_shared;
+	if (!enc->cu_ctx || !shared)
 		return;
 
 	cu->cuCtxPushCurrent(enc->cu_ctx);
-	for (size_t i = 0; i < enc->input_textures.num; i++) {
-		CUgraphicsResource res_y = enc->input_textures.array[i].res_y;
-		CUgraphicsResource res_uv = enc->input_textures.array[i].res_uv;
-		cu->cuGraphicsUnregisterResource(res_y);
-		cu->cuGraphicsUnregisterResource(res_uv);
-	}
+	pthread_mutex_lock(&shared->mutex);
+	for (size_t i = 0; i < enc->input_textures.num; i++)
+		release_shared_tex(shared, enc->input_textures.array[i].tex_id);
+	pthread_mutex_unlock(&shared->mutex);
 	cu->cuCtxPopCurrent(NULL);
+
+	da_free(enc->input_textures);
 }
 
 /* ------------------------------------------------------------------------- */
 /* Actual encoding stuff                                                     */
 
-static inline bool get_res_for_tex_ids(struct nvenc_data *enc, GLuint tex_id_y, GLuint tex_id_uv,
-				       CUgraphicsResource *tex_y, CUgraphicsResource *tex_uv)
+/* textures are only registered once per shared context, sessions encoding
+ * the same canvas textures reuse the registration */
+static inline bool get_shared_res(struct nvenc_data *enc, struct cuda_shared_ctx *shared, GLuint tex_id_y,
+				  GLuint tex_id_uv, CUgraphicsResource *tex_y, CUgraphicsResource *tex_uv)
 {
 	bool success = true;
 
-	for (size_t idx = 0; idx < enc->input_textures.num; idx++) {
-		struct handle_tex *ht = &enc->input_textures.array[idx];
-		if (ht->tex_id != tex_id_y)
+	for (size_t idx = 0; idx < shared->textures.num; idx++) {
+		struct cuda_shared_tex *st = &shared->textures.array[idx];
+		if (st->tex_id != tex_id_y)
 			continue;
 
-		*tex_y = ht->res_y;
-		*tex_uv = ht->res_uv;
+		st->refs++;
+		*tex_y = st->res_y;
+		*tex_uv = st->res_uv;
 		return success;
 	}
 
+	*tex_y = NULL;
+	*tex_uv = NULL;
+
 	CU_CHECK(cu->cuGraphicsGLRegisterImage(tex_y, tex_id_y, GL_TEXTURE_2D, CU_GRAPHICS_REGISTER_FLAGS_READ_ONLY))
 	CU_CHECK(cu->cuGraphicsGLRegisterImage(tex_uv, tex_id_uv, GL_TEXTURE_2D, CU_GRAPHICS_REGISTER_FLAGS_READ_ONLY))
 
-	struct handle_tex ht = {tex_id_y, *tex_y, *tex_uv};
-	da_push_back(enc->input_textures, &ht);
+	struct cuda_shared_tex st = {tex_id_y, *tex_y, *tex_uv, 1};
+	da_push_back(shared->textures, &st);
 
 unmap:
 	if (!success) {
-		cu->cuGraphicsUnregisterResource(*tex_y);
-		cu->cuGraphicsUnregisterResource(*tex_uv);
+		if (*tex_y)
+			cu->cuGraphicsUnregisterResource(*tex_y);
+		if (*tex_uv)
+			cu->cuGraphicsUnregisterResource(*tex_uv);
+	}
+
+	return success;
+}
+
+static inline bool get_res_for_tex_ids(struct nvenc_data *enc, GLuint tex_id_y, GLuint tex_id_uv,
+				       CUgraphicsResource *tex_y, CUgraphicsResource *tex_uv)
+{
+	struct cuda_shared_ctx *shared = enc->cu_shared;
+	bool success;
+
+	for (size_t idx = 0; idx < enc->input_textures.num; idx++) {
+		struct handle_tex *ht = &enc->input_textures.array[idx];
+		if (ht->tex_id != tex_id_y)
+			continue;
+
+		*tex_y = ht->res_y;
+		*tex_uv = ht->res_uv;
+		return true;
+	}
+
+	pthread_mutex_lock(&shared->mutex);
+	success = get_shared_res(enc, shared, tex_id_y, tex_id_uv, tex_y, tex_uv);
+	pthread_mutex_unlock(&shared->mutex);
+
+	if (success) {
+		struct handle_tex ht = {tex_id_y, *tex_y, *tex_uv};
+		da_push_back(enc->input_textures, &ht);
 	}
 
 	return success;
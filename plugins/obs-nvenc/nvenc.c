@@ -7,6 +7,9 @@
 
 #define EXTRA_BUFFERS 5
 
+/* NVENC does not look further ahead than this */
+#define MAX_LOOKAHEAD_DEPTH 32
+
 #ifndef _WIN32
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #define max(a, b) (((a) > (b)) ? (a) : (b))
@@ -139,6 +142,59 @@ static bool init_session(struct nvenc_data *enc)
 	return true;
 }
 
+#ifdef NVENC_12_1_OR_LATER
+/* Roughly what a single engine sustains, 4K60 */
+#define SPLIT_ENCODE_PIXEL_RATE (3840ULL * 2160ULL * 60ULL)
+
+/* The requested mode can come from another GPU or an older driver, so check
+ * it against the session.  In auto mode the driver only splits at some
+ * presets, force it when one engine cannot keep up with the frame rate. */
+static NV_ENC_SPLIT_ENCODE_MODE get_split_encode_mode(struct nvenc_data *enc, uint32_t width, uint32_t height,
+						      uint32_t fps_num, uint32_t fps_den)
+{
+	NV_ENC_SPLIT_ENCODE_MODE mode = (NV_ENC_SPLIT_ENCODE_MODE)enc->props.split_encode;
+	const int engines = nv_get_cap(enc, NV_ENC_CAPS_NUM_ENCODER_ENGINES);
+
+	enc->split_engines = 1;
+
+	if (mode == NV_ENC_SPLIT_DISABLE_MODE)
+		return mode;
+
+	if (enc->codec == CODEC_H264 || engines < 2 || has_broken_split_encoding()) {
+		if (mode != NV_ENC_SPLIT_AUTO_MODE)
+			warn("Split encode is not available for this codec, GPU or driver, disabling it");
+		return NV_ENC_SPLIT_DISABLE_MODE;
+	}
+
+	if (mode == NV_ENC_SPLIT_THREE_FORCED_MODE && engines < 3) {
+		warn("Three-way split encode needs three NVENC engines, using two-way split instead");
+		mode = NV_ENC_SPLIT_TWO_FORCED_MODE;
+	}
+
+	if (mode == NV_ENC_SPLIT_AUTO_MODE) {
+		uint64_t pixel_rate = (uint64_t)width * height * fps_num / fps_den;
+		if (pixel_rate > SPLIT_ENCODE_PIXEL_RATE)
+			mode = NV_ENC_SPLIT_AUTO_FORCED_MODE;
+	}
+
+	switch (mode) {
+	case NV_ENC_SPLIT_TWO_FORCED_MODE:
+		enc->split_engines = 2;
+		break;
+	case NV_ENC_SPLIT_THREE_FORCED_MODE:
+		enc->split_engines = 3;
+		break;
+	case NV_ENC_SPLIT_AUTO_FORCED_MODE:
+		enc->split_engines = engines;
+		break;
+	default:
+		break;
+	}
+
+	return mode;
+}
+#endif
+
 static void initialize_params(struct nvenc_data *enc, const GUID *nv_preset, NV_ENC_TUNING_INFO nv_tuning,
 			      uint32_t width, uint32_t height, uint32_t fps_num, uint32_t fps_den)
 {
@@ -158,7 +214,7 @@ static void initialize_params(struct nvenc_data *enc, const GUID *nv_preset, NV_
 	params->encodeConfig = &enc->config;
 	params->tuningInfo = nv_tuning;
 #ifdef NVENC_12_1_OR_LATER
-	params->splitEncodeMode = (NV_ENC_SPLIT_ENCODE_MODE)enc->props.split_encode;
+	params->splitEncodeMode = get_split_encode_mode(enc, width, height, fps_num, fps_den);
 #endif
 }
 
@@ -289,11 +345,16 @@ static bool init_encoder_base(struct nvenc_data *enc, obs_data_t *settings)
 	/* lookahead */
 
 	const bool use_profile_lookahead = config->rcParams.enableLookahead;
+	/* a latency budget (recordings) allows looking further ahead */
+	const int latency_frames = (int)obs_encoder_get_max_latency_frames(enc->encoder);
+	const int latency_lookahead = min(MAX_LOOKAHEAD_DEPTH, latency_frames - config->frameIntervalP);
 	bool lookahead = nv_get_cap(enc, NV_ENC_CAPS_SUPPORT_LOOKAHEAD) &&
-			 (enc->props.lookahead || use_profile_lookahead);
+			 (enc->props.lookahead || use_profile_lookahead || latency_lookahead > 8);
 
 	if (lookahead) {
 		rc_lookahead = use_profile_lookahead ? config->rcParams.lookaheadDepth : 8;
+		if (latency_lookahead > rc_lookahead)
+			rc_lookahead = latency_lookahead;
 
 		/* Due to the additional calculations required to handle lookahead,
 		 * get the user override here (if any). */
@@ -397,7 +458,9 @@ static bool init_encoder_base(struct nvenc_data *enc, obs_data_t *settings)
 		  config->rcParams.lookaheadDepth);
 	dstr_catf(&log, "\taq:           %s\n", enc->props.adaptive_quantization ? "true" : "false");
 
-	if (enc->props.split_encode) {
+	if (enc->split_engines > 1) {
+		dstr_catf(&log, "\tsplit encode: %d-way\n", enc->split_engines);
+	} else if (enc->props.split_encode) {
 		dstr_catf(&log, "\tsplit encode: %ld\n", enc->props.split_encode);
 	}
 	if (enc->props.opts.count)
@@ -792,6 +855,7 @@ static void *nvenc_create_internal(enum codec_type codec, obs_data_t *settings,
 	enc->codec = codec;
 	enc->first_packet = true;
 	enc->non_texture = !texture;
+	pthread_mutex_init_value(&enc->dts_mutex);
 
 	nvenc_properties_read(&enc->props, settings);
 
@@ -844,6 +908,9 @@ static void *nvenc_create_internal(enum codec_type codec, obs_data_t *settings,
 		goto fail;
 #endif
 
+	if (!texture && !init_output_thread(enc))
+		goto fail;
+
 	enc->codec = codec;
 
 	return enc;
@@ -963,9 +1030,20 @@ static void nvenc_destroy(void *data)
 		NV_ENC_PIC_PARAMS params = {NV_ENC_PIC_PARAMS_VER};
 		params.encodePicFlags = NV_ENC_PIC_FLAG_EOS;
 		nv.nvEncEncodePicture(enc->session, &params);
-		get_encoded_packet(enc, true);
+		if (!enc->output_thread_active)
+			get_encoded_packet(enc, true);
 	}
 
+	/* the output thread drains what is still queued before exiting */
+	if (enc->output_thread_active) {
+		os_atomic_set_bool(&enc->output_stop, true);
+		os_sem_post(enc->output_sem);
+		pthread_join(enc->output_thread, NULL);
+	}
+	os_sem_destroy(enc->output_sem);
+	os_sem_destroy(enc->free_sem);
+	pthread_mutex_destroy(&enc->dts_mutex);
+
 	for (size_t i = 0; i < enc->bitstreams.num; i++) {
 		nv_bitstream_free(enc, &enc->bitstreams.array[i]);
 	}
@@ -1001,10 +1079,87 @@ static void nvenc_destroy(void *data)
 	bfree(enc);
 }
 
-static bool get_encoded_packet(struct nvenc_data *enc, bool finalize)
+/* locks the oldest queued bitstream, copies its packet to packet_data and
+ * releases the input it was encoded from */
+static bool read_bitstream(struct nvenc_data *enc)
 {
 	void *s = enc->session;
+	size_t cur_bs_idx = enc->cur_bitstream;
+	struct nv_bitstream *bs = &enc->bitstreams.array[cur_bs_idx];
+#ifdef _WIN32
+	struct nv_texture *nvtex = enc->non_texture ? NULL : &enc->textures.array[cur_bs_idx];
+	struct nv_cuda_surface *surf = enc->non_texture ? &enc->surfaces.array[cur_bs_idx] : NULL;
+#else
+	struct nv_cuda_surface *surf = &enc->surfaces.array[cur_bs_idx];
+#endif
+
+	/* ---------------- */
+
+	NV_ENC_LOCK_BITSTREAM lock = {NV_ENC_LOCK_BITSTREAM_VER};
+	lock.outputBitstream = bs->ptr;
+	lock.doNotWait = false;
 
+	if (NV_FAILED(nv.nvEncLockBitstream(s, &lock))) {
+		return false;
+	}
+
+	if (enc->first_packet) {
+		NV_ENC_SEQUENCE_PARAM_PAYLOAD payload = {0};
+		uint8_t buf[256];
+		uint32_t size = 0;
+
+		payload.version = NV_ENC_SEQUENCE_PARAM_PAYLOAD_VER;
+		payload.spsppsBuffer = buf;
+		payload.inBufferSize = sizeof(buf);
+		payload.outSPSPPSPayloadSize = &size;
+
+		nv.nvEncGetSequenceParams(s, &payload);
+		enc->header = bmemdup(buf, size);
+		enc->header_size = size;
+		enc->first_packet = false;
+	}
+
+	da_copy_array(enc->packet_data, lock.bitstreamBufferPtr, lock.bitstreamSizeInBytes);
+
+	enc->packet_pts = (int64_t)lock.outputTimeStamp;
+	enc->packet_keyframe = lock.pictureType == NV_ENC_PIC_TYPE_IDR;
+
+	if (NV_FAILED(nv.nvEncUnlockBitstream(s, bs->ptr))) {
+		return false;
+	}
+
+	/* ---------------- */
+#ifdef _WIN32
+	if (nvtex && nvtex->mapped_res) {
+		NVENCSTATUS err;
+		err = nv.nvEncUnmapInputResource(s, nvtex->mapped_res);
+		if (nv_failed(enc->encoder, err, __FUNCTION__, "unmap")) {
+			return false;
+		}
+		nvtex->mapped_res = NULL;
+	}
+#endif
+	/* ---------------- */
+
+	if (surf && surf->mapped_res) {
+		NVENCSTATUS err;
+		err = nv.nvEncUnmapInputResource(s, surf->mapped_res);
+		if (nv_failed(enc->encoder, err, __FUNCTION__, "unmap")) {
+			return false;
+		}
+		surf->mapped_res = NULL;
+	}
+
+	/* ---------------- */
+
+	if (++enc->cur_bitstream == enc->buf_count)
+		enc->cur_bitstream = 0;
+
+	return true;
+}
+
+static bool get_encoded_packet(struct nvenc_data *enc, bool finalize)
+{
 	da_resize(enc->packet_data, 0);
 
 	if (!enc->buffers_queued)
@@ -1015,80 +1170,98 @@ static bool get_encoded_packet(struct nvenc_data *enc, bool finalize)
 	size_t count = finalize ? enc->buffers_queued : 1;
 
 	for (size_t i = 0; i < count; i++) {
-		size_t cur_bs_idx = enc->cur_bitstream;
-		struct nv_bitstream *bs = &enc->bitstreams.array[cur_bs_idx];
-#ifdef _WIN32
-		struct nv_texture *nvtex = enc->non_texture ? NULL : &enc->textures.array[cur_bs_idx];
-		struct nv_cuda_surface *surf = enc->non_texture ? &enc->surfaces.array[cur_bs_idx] : NULL;
-#else
-		struct nv_cuda_surface *surf = &enc->surfaces.array[cur_bs_idx];
-#endif
+		if (!read_bitstream(enc))
+			return false;
 
-		/* ---------------- */
+		enc->buffers_queued--;
+	}
 
-		NV_ENC_LOCK_BITSTREAM lock = {NV_ENC_LOCK_BITSTREAM_VER};
-		lock.outputBitstream = bs->ptr;
-		lock.doNotWait = false;
+	return true;
+}
 
-		if (NV_FAILED(nv.nvEncLockBitstream(s, &lock))) {
-			return false;
-		}
+/* ------------------------------------------------------------------------- */
+/* Output thread of asynchronous encoders                                    */
 
-		if (enc->first_packet) {
-			NV_ENC_SEQUENCE_PARAM_PAYLOAD payload = {0};
-			uint8_t buf[256];
-			uint32_t size = 0;
+static void output_frame(struct nvenc_data *enc, bool discard)
+{
+	struct encoder_packet packet = {0};
+	int64_t dts = 0;
+	bool success;
 
-			payload.version = NV_ENC_SEQUENCE_PARAM_PAYLOAD_VER;
-			payload.spsppsBuffer = buf;
-			payload.inBufferSize = sizeof(buf);
-			payload.outSPSPPSPayloadSize = &size;
+	cu->cuCtxPushCurrent(enc->cu_ctx);
+	success = read_bitstream(enc);
+	cu->cuCtxPopCurrent(NULL);
 
-			nv.nvEncGetSequenceParams(s, &payload);
-			enc->header = bmemdup(buf, size);
-			enc->header_size = size;
-			enc->first_packet = false;
-		}
+	pthread_mutex_lock(&enc->dts_mutex);
+	deque_pop_front(&enc->dts_list, &dts, sizeof(dts));
+	pthread_mutex_unlock(&enc->dts_mutex);
 
-		da_copy_array(enc->packet_data, lock.bitstreamBufferPtr, lock.bitstreamSizeInBytes);
+	os_atomic_dec_long(&enc->frames_pending);
+	os_sem_post(enc->free_sem);
 
-		enc->packet_pts = (int64_t)lock.outputTimeStamp;
-		enc->packet_keyframe = lock.pictureType == NV_ENC_PIC_TYPE_IDR;
+	if (discard)
+		return;
 
-		if (NV_FAILED(nv.nvEncUnlockBitstream(s, bs->ptr))) {
-			return false;
-		}
+	if (success) {
+		/* subtract bframe delay from dts for H.264/HEVC */
+		if (enc->codec != CODEC_AV1)
+			dts -= enc->props.bf * enc->pts_step;
 
-		/* ---------------- */
-#ifdef _WIN32
-		if (nvtex && nvtex->mapped_res) {
-			NVENCSTATUS err;
-			err = nv.nvEncUnmapInputResource(s, nvtex->mapped_res);
-			if (nv_failed(enc->encoder, err, __FUNCTION__, "unmap")) {
-				return false;
-			}
-			nvtex->mapped_res = NULL;
-		}
-#endif
-		/* ---------------- */
-
-		if (surf && surf->mapped_res) {
-			NVENCSTATUS err;
-			err = nv.nvEncUnmapInputResource(s, surf->mapped_res);
-			if (nv_failed(enc->encoder, err, __FUNCTION__, "unmap")) {
-				return false;
-			}
-			surf->mapped_res = NULL;
-		}
+		packet.data = enc->packet_data.array;
+		packet.size = enc->packet_data.num;
+		packet.type = OBS_ENCODER_VIDEO;
+		packet.pts = enc->packet_pts;
+		packet.dts = dts;
+		packet.keyframe = enc->packet_keyframe;
+	}
+
+	obs_encoder_complete_frame(enc->encoder, success, success ? &packet : NULL);
+}
+
+static void *output_thread(void *data)
+{
+	struct nvenc_data *enc = data;
 
-		/* ---------------- */
+	os_set_thread_name("nvenc: output thread");
 
-		if (++enc->cur_bitstream == enc->buf_count)
-			enc->cur_bitstream = 0;
+	for (;;) {
+		os_sem_wait(enc->output_sem);
 
-		enc->buffers_queued--;
+		/* like get_encoded_packet, keep output_delay frames queued so
+		 * the bitstream being locked is always complete, and flush the
+		 * rest once EOS was sent */
+		bool stop = os_atomic_load_bool(&enc->output_stop);
+		long keep = stop ? 0 : enc->output_delay - 1;
+
+		while (os_atomic_load_long(&enc->frames_pending) > keep)
+			output_frame(enc, stop);
+
+		if (stop)
+			break;
 	}
 
+	return NULL;
+}
+
+static bool init_output_thread(struct nvenc_data *enc)
+{
+	video_t *video = obs_encoder_parent_video(enc->encoder);
+	const struct video_output_info *voi = video_output_get_info(video);
+
+	/* packets normally get their timebase from libobs before encoding,
+	 * asynchronous ones only after */
+	enc->pts_step = (int64_t)voi->fps_den * obs_encoder_get_frame_rate_divisor(enc->encoder);
+
+	if (pthread_mutex_init(&enc->dts_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&enc->output_sem, 0) != 0)
+		return false;
+	if (os_sem_init(&enc->free_sem, (int)enc->buf_count) != 0)
+		return false;
+	if (pthread_create(&enc->output_thread, NULL, output_thread, enc) != 0)
+		return false;
+
+	enc->output_thread_active = true;
 	return true;
 }
 
@@ -1182,8 +1355,7 @@ static void add_roi(struct nvenc_data *enc, NV_ENC_PIC_PARAMS *params)
 	params->qpDeltaMapSize = (uint32_t)map_size;
 }
 
-bool nvenc_encode_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts,
-		       struct encoder_packet *packet, bool *received_packet)
+static bool encode_picture(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts)
 {
 	NV_ENC_PIC_PARAMS params = {0};
 	params.version = NV_ENC_PIC_PARAMS_VER;
@@ -1215,12 +1387,23 @@ bool nvenc_encode_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pi
 	}
 
 	enc->encode_started = true;
-	enc->buffers_queued++;
 
 	if (++enc->next_bitstream == enc->buf_count) {
 		enc->next_bitstream = 0;
 	}
 
+	return true;
+}
+
+bool nvenc_encode_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts,
+		       struct encoder_packet *packet, bool *received_packet)
+{
+	if (!encode_picture(enc, bs, pic, pts)) {
+		return false;
+	}
+
+	enc->buffers_queued++;
+
 	/* ------------------------------------ */
 	/* check for encoded packet and parse   */
 
@@ -1253,6 +1436,17 @@ bool nvenc_encode_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pi
 	return true;
 }
 
+bool nvenc_submit_base(struct nvenc_data *enc, struct nv_bitstream *bs, void *pic, int64_t pts)
+{
+	if (!encode_picture(enc, bs, pic, pts)) {
+		return false;
+	}
+
+	os_atomic_inc_long(&enc->frames_pending);
+	os_sem_post(enc->output_sem);
+	return true;
+}
+
 static void nvenc_soft_video_info(void *data, struct video_scale_info *info)
 {
 	struct nvenc_data *enc = data;
@@ -1350,12 +1544,13 @@ struct obs_encoder_info h264_nvenc_soft_info = {
 	.id = "obs_nvenc_h264_soft",
 	.codec = "h264",
 	.type = OBS_ENCODER_VIDEO,
-	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL | OBS_ENCODER_CAP_ASYNC,
 	.get_name = h264_nvenc_soft_get_name,
 	.create = h264_nvenc_soft_create,
 	.destroy = nvenc_destroy,
 	.update = nvenc_update,
 	.encode = cuda_encode,
+	.submit_frame = cuda_submit,
 	.get_defaults = h264_nvenc_defaults,
 	.get_properties = h264_nvenc_properties,
 	.get_extra_data = nvenc_extra_data,
@@ -1368,12 +1563,13 @@ struct obs_encoder_info hevc_nvenc_soft_info = {
 	.id = "obs_nvenc_hevc_soft",
 	.codec = "hevc",
 	.type = OBS_ENCODER_VIDEO,
-	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL | OBS_ENCODER_CAP_ASYNC,
 	.get_name = hevc_nvenc_soft_get_name,
 	.create = hevc_nvenc_soft_create,
 	.destroy = nvenc_destroy,
 	.update = nvenc_update,
 	.encode = cuda_encode,
+	.submit_frame = cuda_submit,
 	.get_defaults = hevc_nvenc_defaults,
 	.get_properties = hevc_nvenc_properties,
 	.get_extra_data = nvenc_extra_data,
@@ -1386,12 +1582,13 @@ struct obs_encoder_info av1_nvenc_soft_info = {
 	.id = "obs_nvenc_av1_soft",
 	.codec = "av1",
 	.type = OBS_ENCODER_VIDEO,
-	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI | OBS_ENCODER_CAP_INTERNAL | OBS_ENCODER_CAP_ASYNC,
 	.get_name = av1_nvenc_soft_get_name,
 	.create = av1_nvenc_soft_create,
 	.destroy = nvenc_destroy,
 	.update = nvenc_update,
 	.encode = cuda_encode,
+	.submit_frame = cuda_submit,
 	.get_defaults = av1_nvenc_defaults,
 	.get_properties = av1_nvenc_properties,
 	.get_extra_data = nvenc_extra_data,
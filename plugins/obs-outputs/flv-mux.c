@@ -309,7 +309,52 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size, bool w
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header)
+/* Tag headers are written into the tag itself, the payload is referenced */
+
+static size_t tag_header_write(void *param, const void *data, size_t size)
+{
+	struct flv_tag *tag = param;
+
+	assert(tag->header_size + size <= FLV_TAG_MAX_HEADER_SIZE);
+	if (tag->header_size + size > FLV_TAG_MAX_HEADER_SIZE)
+		return 0;
+
+	memcpy(tag->header + tag->header_size, data, size);
+	tag->header_size += size;
+	return size;
+}
+
+static int64_t tag_header_get_pos(void *param)
+{
+	struct flv_tag *tag = param;
+	return (int64_t)tag->header_size;
+}
+
+static void tag_serializer_init(struct serializer *s, struct flv_tag *tag)
+{
+	memset(tag, 0, sizeof(*tag));
+	memset(s, 0, sizeof(*s));
+	s->data = tag;
+	s->write = tag_header_write;
+	s->get_pos = tag_header_get_pos;
+}
+
+static void tag_set_data(struct flv_tag *tag, struct encoder_packet *packet)
+{
+	uint32_t tag_size = (uint32_t)(tag->header_size + packet->size);
+
+	tag->data = packet->data;
+	tag->data_size = packet->size;
+
+	/* previous tag size, see write_previous_tag_size */
+	tag->footer[0] = (uint8_t)(tag_size >> 24);
+	tag->footer[1] = (uint8_t)(tag_size >> 16);
+	tag->footer[2] = (uint8_t)(tag_size >> 8);
+	tag->footer[3] = (uint8_t)tag_size;
+}
+
+static void flv_video(struct serializer *s, struct flv_tag *tag, int32_t dts_offset, struct encoder_packet *packet,
+		      bool is_header)
 {
 	int64_t offset = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -337,12 +382,12 @@ static void flv_video(struct serializer *s, int32_t dts_offset, struct encoder_p
 	s_w8(s, packet->keyframe ? 0x17 : 0x27);
 	s_w8(s, is_header ? 0 : 1);
 	s_wb24(s, get_ms_time(packet, offset));
-	s_write(s, packet->data, packet->size);
 
-	write_previous_tag_size(s);
+	tag_set_data(tag, packet);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset, struct encoder_packet *packet, bool is_header)
+static void flv_audio(struct serializer *s, struct flv_tag *tag, int32_t dts_offset, struct encoder_packet *packet,
+		      bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
@@ -368,34 +413,28 @@ static void flv_audio(struct serializer *s, int32_t dts_offset, struct encoder_p
 	/* these are the two extra bytes mentioned above */
 	s_w8(s, 0xaf);
 	s_w8(s, is_header ? 0 : 1);
-	s_write(s, packet->data, packet->size);
 
-	write_previous_tag_size(s);
+	tag_set_data(tag, packet);
 }
 
-void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, uint8_t **output, size_t *size, bool is_header)
+void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, struct flv_tag *tag, bool is_header)
 {
-	struct array_output_data data;
 	struct serializer s;
 
-	array_output_serializer_init(&s, &data);
+	tag_serializer_init(&s, tag);
 
 	if (packet->type == OBS_ENCODER_VIDEO)
-		flv_video(&s, dts_offset, packet, is_header);
+		flv_video(&s, tag, dts_offset, packet, is_header);
 	else
-		flv_audio(&s, dts_offset, packet, is_header);
-
-	*output = data.bytes.array;
-	*size = data.bytes.num;
+		flv_audio(&s, tag, dts_offset, packet, is_header);
 }
 
-void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id, int32_t dts_offset, uint8_t **output,
-			 size_t *size, int type, size_t idx)
+static void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id, int32_t dts_offset,
+				struct flv_tag *tag, int type, size_t idx)
 {
-	struct array_output_data data;
 	struct serializer s;
 
-	array_output_serializer_init(&s, &data);
+	tag_serializer_init(&s, tag);
 
 	assert(packet->type == OBS_ENCODER_AUDIO);
 
@@ -435,21 +474,15 @@ void flv_packet_audio_ex(struct encoder_packet *packet, enum audio_id_t codec_id
 		s_wa4cc(&s, codec_id);
 	}
 
-	s_write(&s, packet->data, packet->size);
-
-	write_previous_tag_size(&s);
-
-	*output = data.bytes.array;
-	*size = data.bytes.num;
+	tag_set_data(tag, packet);
 }
 
 // Y2023 spec
-void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int32_t dts_offset, uint8_t **output,
-		   size_t *size, int type, size_t idx)
+static void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int32_t dts_offset,
+			  struct flv_tag *tag, int type, size_t idx)
 {
-	struct array_output_data data;
 	struct serializer s;
-	array_output_serializer_init(&s, &data);
+	tag_serializer_init(&s, tag);
 
 	assert(packet->type == OBS_ENCODER_VIDEO);
 
@@ -493,47 +526,40 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id, int3
 		s_wb24(&s, get_ms_time(packet, packet->pts - packet->dts));
 	}
 
-	// packet data
-	s_write(&s, packet->data, packet->size);
-
-	// packet tail
-	write_previous_tag_size(&s);
-
-	*output = data.bytes.array;
-	*size = data.bytes.num;
+	// packet data and tail
+	tag_set_data(tag, packet);
 }
 
-void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size, size_t idx)
+void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, struct flv_tag *tag, size_t idx)
 {
-	flv_packet_ex(packet, codec, 0, output, size, PACKETTYPE_SEQ_START, idx);
+	flv_packet_ex(packet, codec, 0, tag, PACKETTYPE_SEQ_START, idx);
 }
 
-void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset, uint8_t **output,
-		       size_t *size, size_t idx)
+void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset, struct flv_tag *tag,
+		       size_t idx)
 {
 	int packet_type = PACKETTYPE_FRAMES;
 	// PACKETTYPE_FRAMESX is an optimization to avoid sending composition
 	// time offsets of 0. See Enhanced RTMP spec.
 	if ((codec == CODEC_H264 || codec == CODEC_HEVC) && packet->dts == packet->pts)
 		packet_type = PACKETTYPE_FRAMESX;
-	flv_packet_ex(packet, codec, dts_offset, output, size, packet_type, idx);
+	flv_packet_ex(packet, codec, dts_offset, tag, packet_type, idx);
 }
 
-void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size, size_t idx)
+void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec, struct flv_tag *tag, size_t idx)
 {
-	flv_packet_ex(packet, codec, 0, output, size, PACKETTYPE_SEQ_END, idx);
+	flv_packet_ex(packet, codec, 0, tag, PACKETTYPE_SEQ_END, idx);
 }
 
-void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_t codec, uint8_t **output, size_t *size,
-			    size_t idx)
+void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_t codec, struct flv_tag *tag, size_t idx)
 {
-	flv_packet_audio_ex(packet, codec, 0, output, size, AUDIO_PACKETTYPE_SEQ_START, idx);
+	flv_packet_audio_ex(packet, codec, 0, tag, AUDIO_PACKETTYPE_SEQ_START, idx);
 }
 
-void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset, uint8_t **output,
-			     size_t *size, size_t idx)
+void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
+			     struct flv_tag *tag, size_t idx)
 {
-	flv_packet_audio_ex(packet, codec, dts_offset, output, size, AUDIO_PACKETTYPE_FRAMES, idx);
+	flv_packet_audio_ex(packet, codec, dts_offset, tag, AUDIO_PACKETTYPE_FRAMES, idx);
 }
 
 void flv_packet_metadata(enum video_id_t codec_id, uint8_t **output, size_t *size, int bits_per_raw_sample,
@@ -58,22 +58,39 @@ static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 	return (int32_t)(val * MILLISECOND_DEN / packet->timebase_den);
 }
 
+/* 11 byte tag header plus the largest (multitrack, composition time)
+ * enhanced RTMP video header */
+#define FLV_TAG_MAX_HEADER_SIZE 24
+
+/* An FLV tag that references the packet payload instead of copying it, the
+ * tag is header, then data, then footer.  header_size is 0 when the packet
+ * produced no tag. */
+struct flv_tag {
+	uint8_t header[FLV_TAG_MAX_HEADER_SIZE];
+	size_t header_size;
+	const uint8_t *data;
+	size_t data_size;
+	uint8_t footer[4];
+};
+
+static inline size_t flv_tag_size(const struct flv_tag *tag)
+{
+	return tag->header_size ? tag->header_size + tag->data_size + sizeof(tag->footer) : 0;
+}
+
 extern void write_file_info(FILE *file, int64_t duration_ms, int64_t size);
 
 extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size, bool write_header);
-extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, uint8_t **output, size_t *size,
-			   bool is_header);
+extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset, struct flv_tag *tag, bool is_header);
 // Y2023 spec
-extern void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size,
-			     size_t idx);
+extern void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec, struct flv_tag *tag, size_t idx);
 extern void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec, int32_t dts_offset,
-			      uint8_t **output, size_t *size, size_t idx);
-extern void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec, uint8_t **output, size_t *size,
-			   size_t idx);
+			      struct flv_tag *tag, size_t idx);
+extern void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec, struct flv_tag *tag, size_t idx);
 extern void flv_packet_metadata(enum video_id_t codec, uint8_t **output, size_t *size, int bits_per_raw_sample,
 				uint8_t color_primaries, int color_trc, int color_space, int min_luminance,
 				int max_luminance, size_t idx);
-extern void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_t codec, uint8_t **output, size_t *size,
+extern void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_t codec, struct flv_tag *tag,
 				   size_t idx);
 extern void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
-				    uint8_t **output, size_t *size, size_t idx);
+				    struct flv_tag *tag, size_t idx);
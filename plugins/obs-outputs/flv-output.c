@@ -178,17 +178,25 @@ static void *flv_output_create(obs_data_t *settings, obs_output_t *output)
 	return stream;
 }
 
+static void write_tag(struct flv_output *stream, const struct flv_tag *tag)
+{
+	if (!tag->header_size)
+		return;
+
+	fwrite(tag->header, 1, tag->header_size, stream->file);
+	fwrite(tag->data, 1, tag->data_size, stream->file);
+	fwrite(tag->footer, 1, sizeof(tag->footer), stream->file);
+}
+
 static int write_packet(struct flv_output *stream, struct encoder_packet *packet, bool is_header)
 {
-	uint8_t *data;
-	size_t size;
+	struct flv_tag tag;
 	int ret = 0;
 
 	stream->last_packet_ts = get_ms_time(packet, packet->dts);
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data, &size, is_header);
-	fwrite(data, 1, size, stream->file);
-	bfree(data);
+	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &tag, is_header);
+	write_tag(stream, &tag);
 
 	return ret;
 }
@@ -196,20 +204,18 @@ static int write_packet(struct flv_output *stream, struct encoder_packet *packet
 static int write_packet_ex(struct flv_output *stream, struct encoder_packet *packet, bool is_header, bool is_footer,
 			   size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
 	int ret = 0;
 
 	if (is_header) {
-		flv_packet_start(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_start(packet, stream->video_codec[idx], &tag, idx);
 	} else if (is_footer) {
-		flv_packet_end(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_end(packet, stream->video_codec[idx], &tag, idx);
 	} else {
-		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &tag, idx);
 	}
 
-	fwrite(data, 1, size, stream->file);
-	bfree(data);
+	write_tag(stream, &tag);
 
 	// manually created packets
 	if (is_header || is_footer)
@@ -222,18 +228,16 @@ static int write_packet_ex(struct flv_output *stream, struct encoder_packet *pac
 
 static int write_audio_packet_ex(struct flv_output *stream, struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
 	int ret = 0;
 
 	if (is_header) {
-		flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
+		flv_packet_audio_start(packet, stream->audio_codec[idx], &tag, idx);
 	} else {
-		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &tag, idx);
 	}
 
-	fwrite(data, 1, size, stream->file);
-	bfree(data);
+	write_tag(stream, &tag);
 
 	return ret;
 }
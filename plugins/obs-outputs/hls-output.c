@@ -0,0 +1,569 @@
+/******************************************************************************
+    Copyright (C) 2024 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Streams HLS with fragmented MP4 segments muxed in process.  Every
+ * fragment the muxer writes is appended to the current segment, and with
+ * low latency enabled it is also uploaded on its own as a partial segment
+ * of it.  Uploads go through a pool of workers so that one slow request
+ * doesn't hold up the ones after it. */
+
+#include "mp4-mux.h"
+#include "hls-upload.h"
+
+#include <inttypes.h>
+
+#include <obs-module.h>
+#include <util/array-serializer.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+#define do_log(level, format, ...) \
+	blog(level, "[hls output: '%s'] " format, obs_output_get_name(out->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define MIME_PLAYLIST "application/vnd.apple.mpegurl"
+#define MIME_MP4 "video/mp4"
+
+/* Segments around the target duration rather than over it */
+#define SEGMENT_THRESHOLD 0.9
+/* Partial segments are only listed for the most recent segments */
+#define PART_SEGMENTS 2
+/* Time given to the last uploads after stopping */
+#define FLUSH_TIMEOUT_MS 5000
+
+struct hls_part {
+	int64_t duration_usec;
+	bool independent;
+};
+
+struct hls_segment {
+	uint64_t seq;
+	int64_t duration_usec;
+	DARRAY(struct hls_part) parts;
+};
+
+struct hls_output {
+	obs_output_t *output;
+
+	volatile bool active;
+	volatile bool stopping;
+	uint64_t stop_ts;
+
+	pthread_mutex_t mutex;
+
+	struct mp4_mux *muxer;
+	struct serializer serializer;
+	struct array_output_data data;
+
+	struct hls_uploader *uploader;
+	uint64_t total_bytes;
+
+	/* Playlist URL split around its name, e.g.
+	 * "https://host/live/" "stream" ".m3u8" "?token=..." */
+	struct dstr url_prefix;
+	struct dstr name;
+	struct dstr url_suffix;
+
+	int64_t target_duration;
+	int64_t part_duration;
+	size_t list_size;
+
+	DARRAY(struct hls_segment) segments;
+	struct hls_segment cur;
+	DARRAY(uint8_t) segment_data;
+	uint64_t next_seq;
+	int64_t max_duration;
+};
+
+static inline bool stopping(struct hls_output *out)
+{
+	return os_atomic_load_bool(&out->stopping);
+}
+
+static inline bool active(struct hls_output *out)
+{
+	return os_atomic_load_bool(&out->active);
+}
+
+static inline bool low_latency(struct hls_output *out)
+{
+	return out->part_duration > 0;
+}
+
+static const char *hls_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("HLSOutput");
+}
+
+static void free_segments(struct hls_output *out)
+{
+	for (size_t i = 0; i < out->segments.num; i++)
+		da_free(out->segments.array[i].parts);
+	da_free(out->segments);
+	da_free(out->cur.parts);
+	da_free(out->segment_data);
+}
+
+static void hls_output_destroy(void *data)
+{
+	struct hls_output *out = data;
+
+	hls_uploader_destroy(out->uploader, 0);
+	mp4_mux_destroy(out->muxer);
+	array_output_serializer_free(&out->data);
+	free_segments(out);
+
+	dstr_free(&out->url_prefix);
+	dstr_free(&out->name);
+	dstr_free(&out->url_suffix);
+	pthread_mutex_destroy(&out->mutex);
+	bfree(out);
+}
+
+static void *hls_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct hls_output *out = bzalloc(sizeof(struct hls_output));
+	out->output = output;
+	pthread_mutex_init(&out->mutex, NULL);
+
+	UNUSED_PARAMETER(settings);
+	return out;
+}
+
+static void get_url(struct hls_output *out, struct dstr *dst, const char *name)
+{
+	dstr_copy_dstr(dst, &out->url_prefix);
+	dstr_cat(dst, name);
+	dstr_cat_dstr(dst, &out->url_suffix);
+}
+
+static void put(struct hls_output *out, const char *name, const char *content_type, const void *data, size_t size,
+		int flags)
+{
+	struct dstr url = {0};
+
+	get_url(out, &url, name);
+	hls_uploader_put(out->uploader, url.array, content_type, data, size, flags);
+	dstr_free(&url);
+}
+
+static inline double to_sec(int64_t usec)
+{
+	return (double)usec / 1000000.0;
+}
+
+static void write_parts(struct hls_output *out, struct dstr *playlist, const struct hls_segment *seg)
+{
+	for (size_t i = 0; i < seg->parts.num; i++) {
+		const struct hls_part *part = &seg->parts.array[i];
+
+		dstr_catf(playlist, "#EXT-X-PART:DURATION=%.5f,URI=\"%s%" PRIu64 ".%zu.m4s\"%s\n",
+			  to_sec(part->duration_usec), out->name.array, seg->seq, i,
+			  part->independent ? ",INDEPENDENT=YES" : "");
+	}
+}
+
+static void upload_playlist(struct hls_output *out, bool end)
+{
+	struct dstr playlist = {0};
+	struct dstr name = {0};
+	uint64_t first_seq = out->segments.num ? out->segments.array[0].seq : out->cur.seq;
+	int64_t target = out->target_duration;
+
+	/* Segments are cut at keyframes only, should one be longer than
+	 * configured the target has to cover it */
+	if (out->max_duration > target)
+		target = out->max_duration;
+
+	dstr_copy(&playlist, "#EXTM3U\n");
+	dstr_cat(&playlist, "#EXT-X-VERSION:6\n");
+	dstr_catf(&playlist, "#EXT-X-TARGETDURATION:%" PRId64 "\n", (target + 999999) / 1000000);
+
+	if (low_latency(out)) {
+		dstr_catf(&playlist, "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%.3f\n", to_sec(out->part_duration * 3));
+		dstr_catf(&playlist, "#EXT-X-PART-INF:PART-TARGET=%.5f\n", to_sec(out->part_duration));
+	}
+
+	dstr_catf(&playlist, "#EXT-X-MEDIA-SEQUENCE:%" PRIu64 "\n", first_seq);
+	dstr_catf(&playlist, "#EXT-X-MAP:URI=\"%s_init.mp4\"\n", out->name.array);
+
+	for (size_t i = 0; i < out->segments.num; i++) {
+		const struct hls_segment *seg = &out->segments.array[i];
+
+		if (low_latency(out) && i + PART_SEGMENTS >= out->segments.num)
+			write_parts(out, &playlist, seg);
+
+		dstr_catf(&playlist, "#EXTINF:%.5f,\n%s%" PRIu64 ".m4s\n", to_sec(seg->duration_usec),
+			  out->name.array, seg->seq);
+	}
+
+	/* The segment being written so far, as parts only */
+	if (low_latency(out) && !end)
+		write_parts(out, &playlist, &out->cur);
+
+	if (end)
+		dstr_cat(&playlist, "#EXT-X-ENDLIST\n");
+
+	dstr_printf(&name, "%s.m3u8", out->name.array);
+	put(out, name.array, MIME_PLAYLIST, playlist.array, playlist.len, HLS_UPLOAD_REPLACE);
+
+	dstr_free(&name);
+	dstr_free(&playlist);
+}
+
+static void close_segment(struct hls_output *out)
+{
+	struct dstr name = {0};
+
+	if (!out->segment_data.num)
+		return;
+
+	dstr_printf(&name, "%s%" PRIu64 ".m4s", out->name.array, out->cur.seq);
+	put(out, name.array, MIME_MP4, out->segment_data.array, out->segment_data.num, 0);
+	dstr_free(&name);
+
+	if (out->cur.duration_usec > out->max_duration)
+		out->max_duration = out->cur.duration_usec;
+
+	/* Only the parts of the last segments are listed */
+	if (!low_latency(out))
+		da_free(out->cur.parts);
+	if (out->segments.num >= PART_SEGMENTS)
+		da_free(out->segments.array[out->segments.num - PART_SEGMENTS].parts);
+
+	da_push_back(out->segments, &out->cur);
+	memset(&out->cur, 0, sizeof(out->cur));
+	out->cur.seq = out->next_seq++;
+	da_clear(out->segment_data);
+
+	while (out->segments.num > out->list_size) {
+		da_free(out->segments.array[0].parts);
+		da_erase(out->segments, 0);
+	}
+}
+
+static void add_fragment(void *param, const struct mp4_fragment_info *frag)
+{
+	struct hls_output *out = param;
+	int64_t threshold = (int64_t)(out->target_duration * SEGMENT_THRESHOLD);
+	const uint8_t *data = out->data.bytes.array;
+	size_t size = out->data.bytes.num;
+
+	if (frag->header_size) {
+		struct dstr name = {0};
+
+		dstr_printf(&name, "%s_init.mp4", out->name.array);
+		put(out, name.array, MIME_MP4, data, frag->header_size, 0);
+		dstr_free(&name);
+
+		data += frag->header_size;
+		size -= frag->header_size;
+	}
+
+	/* Segments have to start with a keyframe, with parts in between the
+	 * segment can only end where the next one can start */
+	if (low_latency(out) && frag->independent && out->cur.duration_usec >= threshold)
+		close_segment(out);
+
+	if (low_latency(out)) {
+		struct hls_part *part = da_push_back_new(out->cur.parts);
+		struct dstr name = {0};
+
+		part->duration_usec = frag->duration_usec;
+		part->independent = frag->independent;
+
+		dstr_printf(&name, "%s%" PRIu64 ".%zu.m4s", out->name.array, out->cur.seq, out->cur.parts.num - 1);
+		put(out, name.array, MIME_MP4, data, size, HLS_UPLOAD_EXPENDABLE);
+		dstr_free(&name);
+	}
+
+	da_push_back_array(out->segment_data, data, size);
+	out->cur.duration_usec += frag->duration_usec;
+
+	if (!low_latency(out) && out->cur.duration_usec >= threshold)
+		close_segment(out);
+
+	array_output_serializer_reset(&out->data);
+
+	if (low_latency(out) || !out->cur.duration_usec)
+		upload_playlist(out, false);
+}
+
+static bool split_url(struct hls_output *out, const char *url)
+{
+	const char *ext = strstr(url, ".m3u8");
+	const char *slash;
+
+	if (!ext) {
+		warn("The server URL has to point to an .m3u8 playlist");
+		return false;
+	}
+
+	slash = ext;
+	while (slash > url && *(slash - 1) != '/')
+		slash--;
+
+	if (slash == ext) {
+		warn("The playlist name can't be empty");
+		return false;
+	}
+
+	dstr_ncopy(&out->url_prefix, url, slash - url);
+	dstr_ncopy(&out->name, slash, ext - slash);
+	dstr_copy(&out->url_suffix, ext + 5);
+	return true;
+}
+
+static int64_t get_frame_duration(obs_encoder_t *encoder)
+{
+	const struct video_output_info *voi = video_output_get_info(obs_encoder_video(encoder));
+	uint32_t divisor = obs_encoder_get_frame_rate_divisor(encoder);
+
+	if (!voi || !voi->fps_num)
+		return 0;
+
+	return (int64_t)util_mul_div64(1000000ULL * voi->fps_den, divisor ? divisor : 1, voi->fps_num);
+}
+
+static void reset_state(struct hls_output *out)
+{
+	free_segments(out);
+	memset(&out->cur, 0, sizeof(out->cur));
+	out->next_seq = 1;
+	out->max_duration = 0;
+}
+
+static bool hls_output_start(void *data)
+{
+	struct hls_output *out = data;
+	obs_encoder_t *vencoder;
+	obs_data_t *settings;
+	obs_service_t *service;
+	struct dstr url = {0};
+	int64_t frame_duration;
+	int64_t keyint_sec;
+	bool success;
+
+	if (!obs_output_can_begin_data_capture(out->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(out->output, 0))
+		return false;
+
+	service = obs_output_get_service(out->output);
+	if (!service)
+		return false;
+
+	dstr_copy(&url, obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL));
+	dstr_replace(&url, "{stream_key}", obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_STREAM_KEY));
+	success = split_url(out, url.array);
+	dstr_free(&url);
+
+	if (!success) {
+		obs_output_set_last_error(out->output, obs_module_text("HLSOutput.InvalidURL"));
+		return false;
+	}
+
+	vencoder = obs_output_get_video_encoder(out->output);
+	settings = obs_encoder_get_settings(vencoder);
+	keyint_sec = obs_data_get_int(settings, "keyint_sec");
+	obs_data_release(settings);
+
+	out->target_duration = (keyint_sec > 0 ? keyint_sec : 2) * 1000000LL;
+	frame_duration = get_frame_duration(vencoder);
+
+	settings = obs_output_get_settings(out->output);
+	out->part_duration = obs_data_get_int(settings, "part_duration_ms") * 1000LL;
+	out->list_size = (size_t)obs_data_get_int(settings, "list_size");
+	size_t workers = (size_t)obs_data_get_int(settings, "upload_workers");
+	obs_data_release(settings);
+
+	if (out->part_duration && out->part_duration < frame_duration)
+		out->part_duration = frame_duration;
+	if (out->part_duration >= out->target_duration)
+		out->part_duration = 0;
+	if (out->list_size < 3)
+		out->list_size = 3;
+
+	if (workers < 1)
+		workers = 1;
+
+	out->uploader = hls_uploader_create(obs_output_get_name(out->output), workers);
+	if (!out->uploader)
+		return false;
+
+	reset_state(out);
+	out->total_bytes = 0;
+
+	array_output_serializer_init(&out->serializer, &out->data);
+	out->muxer = mp4_mux_create(out->output, &out->serializer,
+				    MP4_USE_NEGATIVE_CTS | MP4_FRAGMENTED | MP4_SEGMENTED);
+	mp4_mux_set_fragment_callback(out->muxer, add_fragment, out);
+
+	/* Parts end a frame early, as a part can't be longer than the
+	 * part target */
+	if (low_latency(out))
+		mp4_mux_set_part_duration(out->muxer, out->part_duration - frame_duration);
+
+	os_atomic_set_bool(&out->stopping, false);
+	os_atomic_set_bool(&out->active, true);
+	obs_output_begin_data_capture(out->output, 0);
+
+	if (low_latency(out))
+		info("Streaming to '%s%s.m3u8', parts of %" PRId64 " ms", out->url_prefix.array, out->name.array,
+		     out->part_duration / 1000);
+	else
+		info("Streaming to '%s%s.m3u8'", out->url_prefix.array, out->name.array);
+	return true;
+}
+
+static void hls_output_stop(void *data, uint64_t ts)
+{
+	struct hls_output *out = data;
+	out->stop_ts = ts / 1000;
+	os_atomic_set_bool(&out->stopping, true);
+}
+
+static void flush_uploads_task(void *param)
+{
+	hls_uploader_destroy(param, FLUSH_TIMEOUT_MS);
+}
+
+static void hls_output_actual_stop(struct hls_output *out, int code)
+{
+	os_atomic_set_bool(&out->active, false);
+
+	/* Flushes the last fragment */
+	mp4_mux_finalise(out->muxer);
+	mp4_mux_destroy(out->muxer);
+	out->muxer = NULL;
+
+	out->total_bytes = hls_uploader_total_bytes(out->uploader);
+
+	if (code == 0) {
+		close_segment(out);
+		upload_playlist(out, true);
+
+		/* The last uploads can take a while, stopping doesn't have to
+		 * wait on them */
+		obs_queue_task(OBS_TASK_DESTROY, flush_uploads_task, out->uploader, false);
+	} else {
+		hls_uploader_destroy(out->uploader, 0);
+	}
+	out->uploader = NULL;
+
+	array_output_serializer_free(&out->data);
+	reset_state(out);
+
+	if (code)
+		obs_output_signal_stop(out->output, code);
+	else
+		obs_output_end_data_capture(out->output);
+
+	info("HLS output stopped");
+}
+
+static void hls_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct hls_output *out = data;
+
+	pthread_mutex_lock(&out->mutex);
+
+	if (!active(out))
+		goto unlock;
+
+	if (!packet) {
+		hls_output_actual_stop(out, OBS_OUTPUT_ENCODE_ERROR);
+		goto unlock;
+	}
+
+	if (stopping(out) && packet->sys_dts_usec >= (int64_t)out->stop_ts) {
+		hls_output_actual_stop(out, 0);
+		goto unlock;
+	}
+
+	mp4_mux_submit_packet(out->muxer, packet);
+
+	if (hls_uploader_failed(out->uploader)) {
+		obs_output_set_last_error(out->output, obs_module_text("HLSOutput.UploadFailed"));
+		hls_output_actual_stop(out, OBS_OUTPUT_DISCONNECTED);
+	}
+
+unlock:
+	pthread_mutex_unlock(&out->mutex);
+}
+
+static void hls_output_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, "part_duration_ms", 0);
+	obs_data_set_default_int(defaults, "list_size", 5);
+	obs_data_set_default_int(defaults, "upload_workers", 3);
+}
+
+static obs_properties_t *hls_output_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *p;
+
+	p = obs_properties_add_int(props, "part_duration_ms", obs_module_text("HLSOutput.PartDuration"), 0, 2000,
+				   50);
+	obs_property_int_set_suffix(p, " ms");
+	obs_property_set_long_description(p, obs_module_text("HLSOutput.PartDuration.ToolTip"));
+	obs_properties_add_int(props, "list_size", obs_module_text("HLSOutput.ListSize"), 3, 30, 1);
+	obs_properties_add_int(props, "upload_workers", obs_module_text("HLSOutput.UploadWorkers"), 1, 8, 1);
+	return props;
+}
+
+static uint64_t hls_output_total_bytes(void *data)
+{
+	struct hls_output *out = data;
+	uint64_t total_bytes;
+
+	pthread_mutex_lock(&out->mutex);
+	total_bytes = out->uploader ? hls_uploader_total_bytes(out->uploader) : out->total_bytes;
+	pthread_mutex_unlock(&out->mutex);
+
+	return total_bytes;
+}
+
+struct obs_output_info hls_output_info = {
+	.id = "hls_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK | OBS_OUTPUT_SERVICE,
+	.protocols = "HLS",
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc",
+#else
+	.encoded_video_codecs = "h264",
+#endif
+	.encoded_audio_codecs = "aac",
+	.get_name = hls_output_name,
+	.create = hls_output_create,
+	.destroy = hls_output_destroy,
+	.start = hls_output_start,
+	.stop = hls_output_stop,
+	.encoded_packet = hls_output_packet,
+	.get_defaults = hls_output_defaults,
+	.get_properties = hls_output_properties,
+	.get_total_bytes = hls_output_total_bytes,
+};
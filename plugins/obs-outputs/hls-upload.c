@@ -0,0 +1,432 @@
+/******************************************************************************
+    Copyright (C) 2024 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "hls-upload.h"
+
+#include <curl/curl.h>
+
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define do_log(level, format, ...) blog(level, "[hls uploader: '%s'] " format, up->name.array, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define MAX_ATTEMPTS 3
+#define RETRY_DELAY_MS 500
+#define MAX_CONSECUTIVE_FAILURES 5
+/* well over a minute of 6 Mbps video */
+#define MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+struct upload_job {
+	struct dstr url;
+	const char *content_type;
+	uint8_t *data;
+	size_t size;
+	int flags;
+
+	int attempts;
+	uint64_t retry_ts;
+};
+
+struct upload_worker {
+	struct hls_uploader *up;
+	pthread_t thread;
+	bool thread_active;
+	CURL *curl;
+	char error[CURL_ERROR_SIZE];
+};
+
+struct hls_uploader {
+	struct dstr name;
+	struct dstr user_agent;
+
+	pthread_mutex_t mutex;
+	os_event_t *work_event;
+	os_event_t *idle_event;
+	DARRAY(struct upload_job *) queue;
+	size_t queued_bytes;
+	size_t in_flight;
+	long consecutive_failures;
+	bool dropping;
+
+	struct upload_worker *workers;
+	size_t num_workers;
+
+	volatile bool stopping;
+	volatile bool failed;
+	uint64_t total_bytes;
+};
+
+struct upload_read {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+static inline void free_job(struct upload_job *job)
+{
+	dstr_free(&job->url);
+	bfree(job->data);
+	bfree(job);
+}
+
+static size_t read_data(char *buffer, size_t size, size_t nitems, void *param)
+{
+	struct upload_read *rd = param;
+	size_t len = size * nitems;
+
+	if (len > rd->size - rd->pos)
+		len = rd->size - rd->pos;
+
+	memcpy(buffer, rd->data + rd->pos, len);
+	rd->pos += len;
+	return len;
+}
+
+static size_t discard_data(char *ptr, size_t size, size_t nmemb, void *param)
+{
+	UNUSED_PARAMETER(ptr);
+	UNUSED_PARAMETER(param);
+	return size * nmemb;
+}
+
+/* Lets the uploads still running be cancelled when destroying */
+static int check_stopping(void *param, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	struct hls_uploader *up = param;
+
+	UNUSED_PARAMETER(dltotal);
+	UNUSED_PARAMETER(dlnow);
+	UNUSED_PARAMETER(ultotal);
+	UNUSED_PARAMETER(ulnow);
+
+	return os_atomic_load_bool(&up->stopping) ? 1 : 0;
+}
+
+static bool upload(struct upload_worker *worker, struct upload_job *job)
+{
+	struct hls_uploader *up = worker->up;
+	struct upload_read rd = {job->data, job->size, 0};
+	struct curl_slist *headers = NULL;
+	struct dstr content_type = {0};
+	CURL *c = worker->curl;
+	long response_code = 0;
+	CURLcode res;
+
+	dstr_printf(&content_type, "Content-Type: %s", job->content_type);
+	headers = curl_slist_append(headers, content_type.array);
+
+	/* The same handle is used for every upload so that its connection
+	 * is kept alive */
+	worker->error[0] = 0;
+	curl_easy_setopt(c, CURLOPT_URL, job->url.array);
+	curl_easy_setopt(c, CURLOPT_UPLOAD, 1L);
+	curl_easy_setopt(c, CURLOPT_READFUNCTION, read_data);
+	curl_easy_setopt(c, CURLOPT_READDATA, &rd);
+	curl_easy_setopt(c, CURLOPT_INFILESIZE_LARGE, (curl_off_t)job->size);
+	curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, discard_data);
+	curl_easy_setopt(c, CURLOPT_HTTPHEADER, headers);
+	curl_easy_setopt(c, CURLOPT_USERAGENT, up->user_agent.array);
+	curl_easy_setopt(c, CURLOPT_ERRORBUFFER, worker->error);
+
+	res = curl_easy_perform(c);
+	if (res == CURLE_OK)
+		curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &response_code);
+
+	curl_easy_setopt(c, CURLOPT_HTTPHEADER, NULL);
+	curl_slist_free_all(headers);
+	dstr_free(&content_type);
+
+	if (res != CURLE_OK) {
+		if (!os_atomic_load_bool(&up->stopping))
+			warn("Upload of '%s' failed: %s", job->url.array,
+			     worker->error[0] ? worker->error : curl_easy_strerror(res));
+		return false;
+	}
+
+	if (response_code < 200 || response_code >= 300) {
+		warn("Upload of '%s' failed with HTTP status %ld", job->url.array, response_code);
+		return false;
+	}
+
+	return true;
+}
+
+/* Takes the oldest upload that isn't waiting to be retried */
+static struct upload_job *take_job(struct hls_uploader *up, uint64_t now)
+{
+	for (size_t i = 0; i < up->queue.num; i++) {
+		struct upload_job *job = up->queue.array[i];
+
+		if (job->retry_ts <= now) {
+			da_erase(up->queue, i);
+			up->queued_bytes -= job->size;
+			up->in_flight++;
+			return job;
+		}
+	}
+
+	return NULL;
+}
+
+static void finish_job(struct hls_uploader *up, struct upload_job *job, bool success)
+{
+	pthread_mutex_lock(&up->mutex);
+
+	up->in_flight--;
+
+	if (success) {
+		up->consecutive_failures = 0;
+		up->total_bytes += job->size;
+		free_job(job);
+		job = NULL;
+
+	} else if (!os_atomic_load_bool(&up->stopping) && ++job->attempts < MAX_ATTEMPTS) {
+		/* Retried by whichever worker is free by then, the uploads
+		 * queued after it carry on in the meantime */
+		job->retry_ts = os_gettime_ns() + (uint64_t)RETRY_DELAY_MS * job->attempts * 1000000ULL;
+		da_push_back(up->queue, &job);
+		up->queued_bytes += job->size;
+		job = NULL;
+
+	} else if (!os_atomic_load_bool(&up->stopping)) {
+		warn("Giving up on '%s'", job->url.array);
+
+		if (++up->consecutive_failures >= MAX_CONSECUTIVE_FAILURES && !os_atomic_load_bool(&up->failed)) {
+			warn("%ld uploads failed in a row", up->consecutive_failures);
+			os_atomic_set_bool(&up->failed, true);
+		}
+	}
+
+	if (!up->queue.num && !up->in_flight)
+		os_event_signal(up->idle_event);
+
+	pthread_mutex_unlock(&up->mutex);
+
+	if (job)
+		free_job(job);
+}
+
+static void *upload_thread(void *data)
+{
+	struct upload_worker *worker = data;
+	struct hls_uploader *up = worker->up;
+
+	os_set_thread_name("hls-output: upload");
+
+	while (!os_atomic_load_bool(&up->stopping)) {
+		struct upload_job *job;
+
+		pthread_mutex_lock(&up->mutex);
+		job = take_job(up, os_gettime_ns());
+		if (!job)
+			os_event_reset(up->work_event);
+		pthread_mutex_unlock(&up->mutex);
+
+		if (!job) {
+			/* Wakes up now and then for retries */
+			os_event_timedwait(up->work_event, 100);
+			continue;
+		}
+
+		finish_job(up, job, upload(worker, job));
+	}
+
+	return NULL;
+}
+
+struct hls_uploader *hls_uploader_create(const char *name, size_t workers)
+{
+	struct hls_uploader *up = bzalloc(sizeof(struct hls_uploader));
+
+	dstr_copy(&up->name, name);
+	dstr_printf(&up->user_agent, "libobs/%s", obs_get_version_string());
+
+	pthread_mutex_init_value(&up->mutex);
+	if (pthread_mutex_init(&up->mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&up->work_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	if (os_event_init(&up->idle_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	up->workers = bzalloc(workers * sizeof(struct upload_worker));
+	up->num_workers = workers;
+
+	for (size_t i = 0; i < workers; i++) {
+		struct upload_worker *worker = &up->workers[i];
+
+		worker->up = up;
+		worker->curl = curl_easy_init();
+		if (!worker->curl)
+			goto fail;
+
+		curl_easy_setopt(worker->curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(worker->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+		curl_easy_setopt(worker->curl, CURLOPT_CONNECTTIMEOUT, 5L);
+		/* A stalled upload fails after ten seconds without progress
+		 * rather than after a fixed time, segments can be large */
+		curl_easy_setopt(worker->curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+		curl_easy_setopt(worker->curl, CURLOPT_LOW_SPEED_TIME, 10L);
+		curl_easy_setopt(worker->curl, CURLOPT_NOPROGRESS, 0L);
+		curl_easy_setopt(worker->curl, CURLOPT_XFERINFOFUNCTION, check_stopping);
+		curl_easy_setopt(worker->curl, CURLOPT_XFERINFODATA, up);
+
+		worker->thread_active = pthread_create(&worker->thread, NULL, upload_thread, worker) == 0;
+		if (!worker->thread_active)
+			goto fail;
+	}
+
+	return up;
+
+fail:
+	warn("Failed to create upload workers");
+	hls_uploader_destroy(up, 0);
+	return NULL;
+}
+
+void hls_uploader_destroy(struct hls_uploader *up, uint32_t timeout_ms)
+{
+	if (!up)
+		return;
+
+	if (timeout_ms) {
+		pthread_mutex_lock(&up->mutex);
+		bool idle = !up->queue.num && !up->in_flight;
+		if (!idle)
+			os_event_reset(up->idle_event);
+		pthread_mutex_unlock(&up->mutex);
+
+		if (!idle && os_event_timedwait(up->idle_event, timeout_ms) != 0)
+			warn("Uploads didn't finish in time, cancelling them");
+	}
+
+	os_atomic_set_bool(&up->stopping, true);
+	os_event_signal(up->work_event);
+
+	for (size_t i = 0; i < up->num_workers; i++) {
+		struct upload_worker *worker = &up->workers[i];
+
+		if (worker->thread_active)
+			pthread_join(worker->thread, NULL);
+		if (worker->curl)
+			curl_easy_cleanup(worker->curl);
+	}
+
+	for (size_t i = 0; i < up->queue.num; i++)
+		free_job(up->queue.array[i]);
+	da_free(up->queue);
+
+	bfree(up->workers);
+	os_event_destroy(up->idle_event);
+	os_event_destroy(up->work_event);
+	pthread_mutex_destroy(&up->mutex);
+	dstr_free(&up->user_agent);
+	dstr_free(&up->name);
+	bfree(up);
+}
+
+static struct upload_job *find_queued(struct hls_uploader *up, const char *url)
+{
+	for (size_t i = 0; i < up->queue.num; i++) {
+		struct upload_job *job = up->queue.array[i];
+
+		if (!job->attempts && dstr_cmp(&job->url, url) == 0)
+			return job;
+	}
+
+	return NULL;
+}
+
+/* When uploads can't keep up, what is expendable goes first */
+static void drop_expendable(struct hls_uploader *up)
+{
+	size_t dropped = 0;
+
+	for (size_t i = 0; i < up->queue.num && up->queued_bytes > MAX_QUEUED_BYTES;) {
+		struct upload_job *job = up->queue.array[i];
+
+		if (!(job->flags & HLS_UPLOAD_EXPENDABLE)) {
+			i++;
+			continue;
+		}
+
+		up->queued_bytes -= job->size;
+		da_erase(up->queue, i);
+		free_job(job);
+		dropped++;
+	}
+
+	if (dropped && !up->dropping)
+		warn("Uploads are falling behind, dropped %zu partial uploads", dropped);
+	up->dropping = dropped > 0;
+
+	if (up->queued_bytes > MAX_QUEUED_BYTES && !os_atomic_load_bool(&up->failed)) {
+		warn("Uploads fell too far behind");
+		os_atomic_set_bool(&up->failed, true);
+	}
+}
+
+void hls_uploader_put(struct hls_uploader *up, const char *url, const char *content_type, const void *data,
+		      size_t size, int flags)
+{
+	struct upload_job *job;
+
+	pthread_mutex_lock(&up->mutex);
+
+	job = (flags & HLS_UPLOAD_REPLACE) ? find_queued(up, url) : NULL;
+	if (job) {
+		up->queued_bytes -= job->size;
+		bfree(job->data);
+	} else {
+		job = bzalloc(sizeof(struct upload_job));
+		dstr_copy(&job->url, url);
+		da_push_back(up->queue, &job);
+	}
+
+	job->content_type = content_type;
+	job->data = bmemdup(data, size);
+	job->size = size;
+	job->flags = flags;
+	up->queued_bytes += size;
+
+	if (up->queued_bytes > MAX_QUEUED_BYTES)
+		drop_expendable(up);
+
+	os_event_signal(up->work_event);
+	pthread_mutex_unlock(&up->mutex);
+}
+
+bool hls_uploader_failed(struct hls_uploader *up)
+{
+	return os_atomic_load_bool(&up->failed);
+}
+
+uint64_t hls_uploader_total_bytes(struct hls_uploader *up)
+{
+	uint64_t total_bytes;
+
+	pthread_mutex_lock(&up->mutex);
+	total_bytes = up->total_bytes;
+	pthread_mutex_unlock(&up->mutex);
+
+	return total_bytes;
+}
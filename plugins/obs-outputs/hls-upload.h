@@ -0,0 +1,46 @@
+/******************************************************************************
+    Copyright (C) 2024 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+
+/* Uploads files with HTTP PUT from a pool of workers, each of which keeps
+ * its connection alive.  Uploads that fail are retried by the workers
+ * themselves, so queuing one never waits on the network. */
+struct hls_uploader;
+
+enum hls_upload_flags {
+	/* Replaces the data of a queued upload to the same URL that hasn't
+	 * started yet, e.g. for playlists */
+	HLS_UPLOAD_REPLACE = 1 << 0,
+	/* May be dropped when uploads fall behind, e.g. for partial segments
+	 * which are uploaded again as part of their segment */
+	HLS_UPLOAD_EXPENDABLE = 1 << 1,
+};
+
+struct hls_uploader *hls_uploader_create(const char *name, size_t workers);
+/* Gives queued uploads up to timeout_ms to finish before cancelling them */
+void hls_uploader_destroy(struct hls_uploader *up, uint32_t timeout_ms);
+
+/* The data is copied */
+void hls_uploader_put(struct hls_uploader *up, const char *url, const char *content_type, const void *data,
+		      size_t size, int flags);
+
+/* Too many uploads failed in a row, or they fell too far behind */
+bool hls_uploader_failed(struct hls_uploader *up);
+uint64_t hls_uploader_total_bytes(struct hls_uploader *up);
@@ -0,0 +1,209 @@
+#include "ingest-race.h"
+#include "librtmp/rtmp.h"
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#define closesocket close
+#endif
+
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET ~0
+#endif
+
+/* longer than happy-eyeballs' own connection timeout, which ends every
+ * attempt before this */
+#define RACE_TIMEOUT_MS 30000
+/* once one URL has connected, give the others this long to beat it */
+#define RACE_GRACE_MS 200
+
+struct race;
+
+struct candidate {
+	struct race *race;
+	pthread_t thread;
+	char *hostname;
+	int port;
+
+	bool finished;
+	bool connected;
+	uint64_t connect_time_ns;
+};
+
+/* Shared with the candidate threads, the race may give up on some of them
+ * and leave them to release it once they finish. */
+struct race {
+	volatile long refs;
+	pthread_mutex_t mutex;
+	os_event_t *event;
+
+	socklen_t bind_addr_len;
+	struct sockaddr_storage bind_addr;
+
+	size_t count;
+	struct candidate candidates[];
+};
+
+static void race_release(struct race *race)
+{
+	if (os_atomic_dec_long(&race->refs) != 0)
+		return;
+
+	for (size_t i = 0; i < race->count; i++)
+		bfree(race->candidates[i].hostname);
+
+	pthread_mutex_destroy(&race->mutex);
+	os_event_destroy(race->event);
+	bfree(race);
+}
+
+static void *candidate_thread(void *data)
+{
+	struct candidate *candidate = data;
+	struct race *race = candidate->race;
+	struct happy_eyeballs_ctx *ctx = NULL;
+	uint64_t connect_time_ns = 0;
+	bool connected = false;
+
+	os_set_thread_name("rtmp-stream: ingest race");
+
+	if (happy_eyeballs_create(&ctx) == 0) {
+		int ret;
+
+		happy_eyeballs_set_bind_addr(ctx, race->bind_addr_len, &race->bind_addr);
+
+		ret = happy_eyeballs_connect(ctx, candidate->hostname, candidate->port);
+		if (ret == EAGAIN)
+			ret = happy_eyeballs_timedwait_default(ctx);
+
+		if (ret == 0) {
+			SOCKET sock = happy_eyeballs_get_socket_fd(ctx);
+
+			connect_time_ns = happy_eyeballs_get_connection_time_ns(ctx);
+			connected = true;
+
+			/* the winning socket belongs to the caller */
+			if (sock != INVALID_SOCKET)
+				closesocket(sock);
+		}
+
+		happy_eyeballs_destroy(ctx);
+	}
+
+	pthread_mutex_lock(&race->mutex);
+	candidate->finished = true;
+	candidate->connected = connected;
+	candidate->connect_time_ns = connect_time_ns;
+	pthread_mutex_unlock(&race->mutex);
+
+	os_event_signal(race->event);
+	race_release(race);
+	return NULL;
+}
+
+static bool init_candidate(struct candidate *candidate, const char *url)
+{
+	AVal host = {0}, app = {0};
+	unsigned int port = 0;
+	int protocol = 0;
+
+	if (!RTMP_ParseURL(url, &protocol, &host, &port, &app) || !host.av_len)
+		return false;
+
+	if (!port)
+		port = (protocol & RTMP_FEATURE_SSL) ? 443 : 1935;
+
+	candidate->hostname = bstrdup_n(host.av_val, host.av_len);
+	candidate->port = (int)port;
+	return true;
+}
+
+/* assumes race->mutex */
+static int get_fastest(struct race *race, size_t *num_finished, uint64_t *connect_time_ns)
+{
+	int fastest = -1;
+
+	*num_finished = 0;
+
+	for (size_t i = 0; i < race->count; i++) {
+		struct candidate *candidate = &race->candidates[i];
+
+		if (!candidate->finished)
+			continue;
+
+		(*num_finished)++;
+
+		if (candidate->connected && (fastest == -1 || candidate->connect_time_ns < *connect_time_ns)) {
+			fastest = (int)i;
+			*connect_time_ns = candidate->connect_time_ns;
+		}
+	}
+
+	return fastest;
+}
+
+int ingest_race(char *const *urls, size_t count, socklen_t bind_addr_len, struct sockaddr_storage *bind_addr,
+		uint64_t *connect_time_ns)
+{
+	struct race *race = bzalloc(sizeof(struct race) + sizeof(struct candidate) * count);
+	uint64_t deadline = os_gettime_ns() + RACE_TIMEOUT_MS * 1000000ULL;
+	uint64_t grace_deadline = 0;
+	int fastest = -1;
+
+	race->refs = 1;
+	race->count = count;
+	pthread_mutex_init(&race->mutex, NULL);
+	os_event_init(&race->event, OS_EVENT_TYPE_AUTO);
+
+	if (bind_addr && bind_addr_len > 0) {
+		race->bind_addr = *bind_addr;
+		race->bind_addr_len = bind_addr_len;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct candidate *candidate = &race->candidates[i];
+
+		candidate->race = race;
+
+		if (!init_candidate(candidate, urls[i])) {
+			candidate->finished = true;
+			continue;
+		}
+
+		os_atomic_inc_long(&race->refs);
+		if (pthread_create(&candidate->thread, NULL, candidate_thread, candidate) == 0) {
+			pthread_detach(candidate->thread);
+		} else {
+			os_atomic_dec_long(&race->refs);
+			candidate->finished = true;
+		}
+	}
+
+	for (;;) {
+		uint64_t now = os_gettime_ns();
+		uint64_t wait_until;
+		size_t num_finished;
+
+		pthread_mutex_lock(&race->mutex);
+		fastest = get_fastest(race, &num_finished, connect_time_ns);
+		pthread_mutex_unlock(&race->mutex);
+
+		if (num_finished == count)
+			break;
+
+		if (fastest != -1 && !grace_deadline)
+			grace_deadline = now + RACE_GRACE_MS * 1000000ULL;
+
+		wait_until = grace_deadline ? grace_deadline : deadline;
+		if (now >= wait_until)
+			break;
+
+		os_event_timedwait(race->event, (unsigned long)((wait_until - now) / 1000000ULL) + 1);
+	}
+
+	race_release(race);
+	return fastest;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <happy-eyeballs.h>
+
+/* Opens a TCP connection to every RTMP URL at the same time, each one racing
+ * its own IPv4 and IPv6 addresses through happy-eyeballs, and returns the
+ * index of the URL that connected fastest, or -1 if none could be reached.
+ * The probe connections are closed again before this returns. */
+int ingest_race(char *const *urls, size_t count, socklen_t bind_addr_len, struct sockaddr_storage *bind_addr,
+		uint64_t *connect_time_ns);
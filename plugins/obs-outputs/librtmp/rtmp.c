@@ -1582,6 +1582,32 @@ WriteN(RTMP *r, const char *buffer, int n)
     const char *ptr = buffer;
     struct linger l;
 
+    if (r->m_bBatchSend)
+    {
+        if (r->m_sendBufLen + n > r->m_sendBufSize)
+        {
+            int size = r->m_sendBufSize ? r->m_sendBufSize : 65536;
+            char *buf;
+
+            while (size < r->m_sendBufLen + n)
+                size *= 2;
+
+            buf = realloc(r->m_sendBuf, size);
+            if (!buf)
+            {
+                RTMP_Log(RTMP_LOGERROR, "%s, failed to grow send batch to %d bytes",
+                         __FUNCTION__, size);
+                return FALSE;
+            }
+            r->m_sendBuf = buf;
+            r->m_sendBufSize = size;
+        }
+
+        memcpy(r->m_sendBuf + r->m_sendBufLen, buffer, n);
+        r->m_sendBufLen += n;
+        return TRUE;
+    }
+
     while (n > 0)
     {
         int nBytes;
@@ -4085,18 +4111,38 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
+/* Collects everything written until the next RTMP_FlushBatch into one buffer,
+ * so several packets (and all of their chunks) go out in a single send. */
+void
+RTMP_BeginBatch(RTMP *r)
+{
+    if (!(r->Link.protocol & RTMP_FEATURE_HTTP))
+        r->m_bBatchSend = TRUE;
+}
+
 int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+RTMP_FlushBatch(RTMP *r)
+{
+    int len = r->m_sendBufLen;
+
+    r->m_bBatchSend = FALSE;
+    r->m_sendBufLen = 0;
+
+    if (len <= 0 || !RTMP_IsConnected(r))
+        return TRUE;
+
+    /* a failed send closes the connection, which frees the buffer */
+    return WriteN(r, r->m_sendBuf, len);
+}
+
+/* Grows the channel table and picks the smallest header type the previous
+ * packet on the channel allows.  *wireTime is the timestamp (or delta) that
+ * goes into the chunk header. */
+static int
+PreparePacketHeader(RTMP *r, RTMPPacket *packet, uint32_t *wireTime)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
-    int nSize;
-    int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
-    uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4128,8 +4174,8 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
          * whatever was previously sent, rather than just looking at the previous packet's absolute timestamp.
          *
          * The type 3 chunks/RTMP_PACKET_SIZE_MINIMUM packets produced here specify the beginning of a new
-         * message as opposed to message continuation type 3 chunks that are handled in the loop further down
-         * in this function.
+         * message as opposed to message continuation type 3 chunks that are handled in the chunk loops of
+         * RTMP_SendPacket and RTMP_WriteTag.
          */
         uint32_t delta = packet->m_nTimeStamp - prevPacket->m_nTimeStamp;
         if (delta == prevPacket->m_nLastWireTimeStamp
@@ -4145,58 +4191,30 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         return FALSE;
     }
 
-    nSize = packetSize[packet->m_headerType];
-    hSize = nSize;
-    cSize = 0;
-    t = packet->m_nTimeStamp - last;
-    packet->m_nLastWireTimeStamp = t;
+    *wireTime = packet->m_nTimeStamp - last;
+    packet->m_nLastWireTimeStamp = *wireTime;
+    return TRUE;
+}
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+/* Writes the header of the first chunk of a packet into hbuf, which has room
+ * for RTMP_MAX_HEADER_SIZE bytes, and returns its size. */
+static int
+EncodePacketHeader(const RTMPPacket *packet, uint32_t t, char *hbuf)
+{
+    char *hptr = hbuf, *hend = hbuf + RTMP_MAX_HEADER_SIZE;
+    int nSize = packetSize[packet->m_headerType];
+    char c = packet->m_headerType << 6;
 
     if (packet->m_nChannel > 319)
-        cSize = 2;
-    else if (packet->m_nChannel > 63)
-        cSize = 1;
-    if (cSize)
-    {
-        header -= cSize;
-        hSize += cSize;
-    }
-
-    if (nSize > 1 && t >= 0xffffff)
-    {
-        header -= 4;
-        hSize += 4;
-    }
-
-    hptr = header;
-    c = packet->m_headerType << 6;
-    switch (cSize)
-    {
-    case 0:
-        c |= packet->m_nChannel;
-        break;
-    case 1:
-        break;
-    case 2:
         c |= 1;
-        break;
-    }
+    else if (packet->m_nChannel <= 63)
+        c |= packet->m_nChannel;
     *hptr++ = c;
-    if (cSize)
+    if (packet->m_nChannel > 63)
     {
         int tmp = packet->m_nChannel - 64;
         *hptr++ = tmp & 0xff;
-        if (cSize == 2)
+        if (packet->m_nChannel > 319)
             *hptr++ = tmp >> 8;
     }
 
@@ -4217,6 +4235,72 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    return (int)(hptr - hbuf);
+}
+
+/* Writes the type 3 header that continues a packet into the next chunk. */
+static int
+EncodeContinuationHeader(const RTMPPacket *packet, uint32_t t, char *hbuf)
+{
+    char *hptr = hbuf, *hend = hbuf + RTMP_MAX_HEADER_SIZE;
+
+    if (packet->m_nChannel > 319)
+        *hptr++ = 0xc0 | 1;
+    else if (packet->m_nChannel > 63)
+        *hptr++ = 0xc0;
+    else
+        *hptr++ = 0xc0 | packet->m_nChannel;
+    if (packet->m_nChannel > 63)
+    {
+        int tmp = packet->m_nChannel - 64;
+        *hptr++ = tmp & 0xff;
+        if (packet->m_nChannel > 319)
+            *hptr++ = tmp >> 8;
+    }
+
+    if (t >= 0xffffff)
+        hptr = AMF_EncodeInt32(hptr, hend, t);
+
+    return (int)(hptr - hbuf);
+}
+
+/* Remembers the packet as the last one sent on its channel, later packets
+ * compress their headers against it.  Its body is never used. */
+static void
+StoreSentPacket(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    if (r->m_vecChannelsOut[packet->m_nChannel])
+        memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize;
+    char *header, hbuf[RTMP_MAX_HEADER_SIZE];
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (!PreparePacketHeader(r, packet, &t))
+        return FALSE;
+
+    /* the body has RTMP_MAX_HEADER_SIZE bytes of room in front of it */
+    hSize = EncodePacketHeader(packet, t, hbuf);
+    if (packet->m_body)
+    {
+        header = packet->m_body - hSize;
+        memcpy(header, hbuf, hSize);
+    }
+    else
+    {
+        header = hbuf;
+    }
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4229,7 +4313,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         int chunks = (nSize+nChunkSize-1) / nChunkSize;
         if (chunks > 1)
         {
-            tlen = chunks * (cSize + 1) + nSize + hSize;
+            tlen = chunks * RTMP_MAX_HEADER_SIZE + nSize;
             tbuf = malloc(tlen);
             if (!tbuf)
                 return FALSE;
@@ -4263,39 +4347,14 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         // prepare to send off remaining data in Type 3 chunks
         if (nSize > 0)
         {
-            header = buffer - 1;
-            hSize = 1;
-            if (cSize)
-            {
-                header -= cSize;
-                hSize += cSize;
-            }
-            if (t >= 0xffffff)
-            {
-                hSize += 4;
-                header -= 4;
-            }
-            *header = (0xc0 | c);
-            if (cSize)
-            {
-                int tmp = packet->m_nChannel - 64;
-                header[1] = tmp & 0xff;
-                if (cSize == 2)
-                    header[2] = tmp >> 8;
-            }
-            if (t >= 0xffffff)
-                AMF_EncodeInt32(header+hSize-4, header+hSize, t);
+            char cbuf[RTMP_MAX_HEADER_SIZE];
+
+            /* overwrites the tail of the chunk that was just sent */
+            hSize = EncodeContinuationHeader(packet, t, cbuf);
+            header = buffer - hSize;
+            memcpy(header, cbuf, hSize);
         }
     }
-    if (tbuf)
-    {
-        int wrote = WriteN(r, tbuf, toff-tbuf);
-        free(tbuf);
-        tbuf = NULL;
-        if (!wrote)
-            return FALSE;
-    }
-
     /* we invoked a remote method */
     if (packet->m_packetType == RTMP_PACKET_TYPE_INVOKE)
     {
@@ -4314,9 +4373,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    StoreSentPacket(r, packet);
     return TRUE;
 }
 
@@ -4325,6 +4382,10 @@ RTMP_Close(RTMP *r)
 {
     int i;
 
+    /* anything still batched is dropped, the unpublish goes out directly */
+    r->m_bBatchSend = FALSE;
+    r->m_sendBufLen = 0;
+
     if (RTMP_IsConnected(r))
     {
         for (int idx = 0; idx < r->Link.nStreams; idx++)
@@ -4417,6 +4478,10 @@ RTMP_Close(RTMP *r)
         r->Link.lFlags ^= RTMP_LF_FTCU;
     }
 
+    free(r->m_sendBuf);
+    r->m_sendBuf = NULL;
+    r->m_sendBufSize = 0;
+
     memset (&r->m_bindIP, 0, sizeof(r->m_bindIP));
     r->m_bCustomSend = 0;
     r->m_customSendFunc = NULL;
@@ -5393,3 +5458,132 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Sends one chunk made of a header and n bytes gathered from the remaining
+ * tag pieces.  The pieces are appended to the batch buffer, outside of a
+ * batch that buffer is flushed right away so each chunk is a single send. */
+static int
+WriteTagChunk(RTMP *r, const char *header, int hSize, const char **pieces, int *pieceSizes, int n)
+{
+    int batching = r->m_bBatchSend;
+
+    r->m_bBatchSend = TRUE;
+    if (!WriteN(r, header, hSize))
+        goto fail;
+
+    while (n > 0)
+    {
+        int num = pieceSizes[0] < n ? pieceSizes[0] : n;
+
+        if (num && !WriteN(r, pieces[0], num))
+            goto fail;
+
+        pieces[0] += num;
+        pieceSizes[0] -= num;
+        n -= num;
+
+        if (!pieceSizes[0])
+        {
+            pieces[0] = pieces[1];
+            pieceSizes[0] = pieceSizes[1];
+            pieceSizes[1] = 0;
+        }
+    }
+
+    if (!batching)
+        return RTMP_FlushBatch(r);
+    return TRUE;
+
+fail:
+    r->m_bBatchSend = batching;
+    return FALSE;
+}
+
+/* Like RTMP_Write for a single FLV tag, but the tag header and its payload
+ * are passed separately and the payload is chunked straight from the
+ * caller's buffer instead of being copied into a packet first.  The
+ * previous tag size that follows a tag in a file is not passed at all. */
+int
+RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *data, int dataSize, int streamIdx)
+{
+    RTMPPacket packet = {0};
+    const char *pieces[2];
+    int pieceSizes[2];
+    char hbuf[RTMP_MAX_HEADER_SIZE];
+    int hSize, nSize, nChunkSize;
+    uint32_t t;
+
+    if (tagSize < 11)
+    {
+        /* FLV pkt too small */
+        return 0;
+    }
+
+    /* RTMPT posts all chunks of a packet at once, let RTMP_Write do that */
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+    {
+        char *buf = malloc(tagSize + dataSize);
+        int ret;
+
+        if (!buf)
+            return -1;
+
+        memcpy(buf, tag, tagSize);
+        memcpy(buf + tagSize, data, dataSize);
+        ret = RTMP_Write(r, buf, tagSize + dataSize, streamIdx);
+        free(buf);
+        return ret;
+    }
+
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = tag[0];
+    packet.m_nBodySize = AMF_DecodeInt24(tag + 1);
+    packet.m_nTimeStamp = AMF_DecodeInt24(tag + 4);
+    packet.m_nTimeStamp |= (uint32_t)(uint8_t)tag[7] << 24;
+
+    if (packet.m_nBodySize != (uint32_t)(tagSize - 11 + dataSize))
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, tag body size %u does not match %d bytes of data",
+                 __FUNCTION__, packet.m_nBodySize, tagSize - 11 + dataSize);
+        return -1;
+    }
+
+    if (((packet.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !packet.m_nTimeStamp) || packet.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    if (!PreparePacketHeader(r, &packet, &t))
+        return -1;
+
+    pieces[0] = tag + 11;
+    pieceSizes[0] = tagSize - 11;
+    pieces[1] = data;
+    pieceSizes[1] = dataSize;
+
+    hSize = EncodePacketHeader(&packet, t, hbuf);
+    nSize = packet.m_nBodySize;
+    nChunkSize = r->m_outChunkSize;
+
+    while (nSize + hSize)
+    {
+        if (nSize < nChunkSize)
+            nChunkSize = nSize;
+
+        if (!WriteTagChunk(r, hbuf, hSize, pieces, pieceSizes, nChunkSize))
+            return -1;
+
+        nSize -= nChunkSize;
+        hSize = nSize > 0 ? EncodeContinuationHeader(&packet, t, hbuf) : 0;
+    }
+
+    StoreSentPacket(r, &packet);
+    return tagSize + dataSize;
+}
@@ -422,6 +422,11 @@ extern "C"
         void*   m_customSendParam;
         CUSTOMSEND m_customSendFunc;
 
+        uint8_t m_bBatchSend;	/* collect writes until RTMP_FlushBatch */
+        char *m_sendBuf;
+        int m_sendBufLen;
+        int m_sendBufSize;
+
         RTMP_BINDINFO m_bindIP;
 
         uint8_t m_bSendChunkSizeInfo;
@@ -496,6 +501,8 @@ extern "C"
     int RTMP_ReadPacket(RTMP *r, RTMPPacket *packet);
     int RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue);
     int RTMP_SendChunk(RTMP *r, RTMPChunk *chunk);
+    void RTMP_BeginBatch(RTMP *r);
+    int RTMP_FlushBatch(RTMP *r);
     int RTMP_IsConnected(RTMP *r);
     SOCKET RTMP_Socket(RTMP *r);
     int RTMP_IsTimedout(RTMP *r);
@@ -543,6 +550,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *data, int dataSize,
+                      int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
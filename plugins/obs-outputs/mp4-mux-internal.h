@@ -78,6 +78,15 @@ struct fragment_sample {
 	uint32_t size;
 	int32_t offset;
 	uint32_t duration;
+	bool keyframe;
+};
+
+/* Fragment random access entry, for the index written at the end of
+ * fragmented files */
+struct fragment_entry {
+	uint64_t time;
+	uint64_t moof_offset;
+	uint8_t traf_number;
 };
 
 struct mp4_track {
@@ -126,6 +135,9 @@ struct mp4_track {
 	/* Temporary array with information about the samples to be included
 	 * in the next fragment. */
 	DARRAY(struct fragment_sample) fragment_samples;
+
+	/* Fragments containing samples of this track (MP4_FRAGMENTED only) */
+	DARRAY(struct fragment_entry) fragments;
 };
 
 struct mp4_mux {
@@ -141,18 +153,31 @@ struct mp4_mux {
 	uint32_t fragments_written;
 	/* PTS where next fragmentation should take place */
 	int64_t next_frag_pts;
+	/* PTS where the last fragment ended, and how long fragments between
+	 * keyframes are (0 if they aren't) */
+	int64_t frag_start_pts;
+	int64_t part_duration;
 
 	/* Creation time (seconds since Jan 1 1904) */
 	uint64_t creation_time;
 
 	/* Offset of placeholder atom/box to contain final mdat header */
 	size_t placeholder_offset;
+	/* Offset of the mehd box to contain the final duration */
+	int64_t mehd_offset;
 
 	uint8_t track_ctr;
 	/* Audio/Video tracks */
 	DARRAY(struct mp4_track) tracks;
 	/* Special tracks */
 	struct mp4_track *chapter_track;
+
+	/* Reports how much of the full moov is written when finalising */
+	mp4_mux_progress_cb progress_cb;
+	void *progress_param;
+
+	mp4_mux_fragment_cb fragment_cb;
+	void *fragment_param;
 };
 
 /* clang-format off */
@@ -25,6 +25,7 @@
 #include <obs-module.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <util/array-serializer.h>
 
 #include <time.h>
@@ -1717,6 +1718,14 @@ static size_t mp4_write_mvex(struct mp4_mux *mux)
 
 	write_box(s, 0, "mvex");
 
+	/* Movie Extends Header Box (8.8.2), the duration is filled in when
+	 * finalising */
+	if ((mux->flags & MP4_FRAGMENTED) && !(mux->flags & MP4_SEGMENTED)) {
+		mux->mehd_offset = serializer_get_pos(s);
+		write_fullbox(s, 20, "mehd", 1, 0);
+		s_wb64(s, 0); // fragment_duration
+	}
+
 	for (size_t track_id = 0; track_id < mux->tracks.num; track_id++)
 		mp4_write_trex(mux, (uint32_t)(track_id + 1));
 
@@ -1941,6 +1950,64 @@ static size_t mp4_write_udta(struct mp4_mux *mux)
 	return write_box_size(s, start);
 }
 
+struct trak_job {
+	struct mp4_mux mux;
+	struct mp4_track *track;
+	struct serializer s;
+	struct array_output_data ao;
+	pthread_t thread;
+	bool threaded;
+};
+
+static void *trak_thread(void *data)
+{
+	struct trak_job *job = data;
+
+	os_set_thread_name("mp4 muxer: write trak");
+	mp4_write_trak(&job->mux, job->track, false);
+	return NULL;
+}
+
+/* The sample tables of long recordings are what makes the full moov slow to
+ * write, so each trak is written on a thread of its own into a buffer of its
+ * own, and the buffers are appended in track order.  Writing a trak only
+ * reads from the muxer, so each thread gets a copy of it with its own
+ * serializer. */
+static void mp4_write_full_traks(struct mp4_mux *mux)
+{
+	struct serializer *s = mux->serializer;
+	size_t num = mux->tracks.num + (mux->chapter_track ? 1 : 0);
+	struct trak_job *jobs = bzalloc(num * sizeof(struct trak_job));
+
+	for (size_t i = 0; i < num; i++) {
+		struct trak_job *job = &jobs[i];
+
+		job->mux = *mux;
+		job->track = i < mux->tracks.num ? &mux->tracks.array[i] : mux->chapter_track;
+		array_output_serializer_init(&job->s, &job->ao);
+		job->mux.serializer = &job->s;
+
+		job->threaded = pthread_create(&job->thread, NULL, trak_thread, job) == 0;
+		if (!job->threaded)
+			mp4_write_trak(&job->mux, job->track, false);
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		struct trak_job *job = &jobs[i];
+
+		if (job->threaded)
+			pthread_join(job->thread, NULL);
+
+		s_write(s, job->ao.bytes.array, job->ao.bytes.num);
+		array_output_serializer_free(&job->ao);
+
+		if (mux->progress_cb)
+			mux->progress_cb(mux->progress_param, (float)(i + 1) / (float)num);
+	}
+
+	bfree(jobs);
+}
+
 /// Movie Box (8.2.1)
 static size_t mp4_write_moov(struct mp4_mux *mux, bool fragmented)
 {
@@ -1952,14 +2019,15 @@ static size_t mp4_write_moov(struct mp4_mux *mux, bool fragmented)
 	mp4_write_mvhd(mux);
 
 	// trak(s)
-	for (size_t i = 0; i < mux->tracks.num; i++) {
-		struct mp4_track *track = &mux->tracks.array[i];
-		mp4_write_trak(mux, track, fragmented);
+	if (fragmented) {
+		for (size_t i = 0; i < mux->tracks.num; i++) {
+			struct mp4_track *track = &mux->tracks.array[i];
+			mp4_write_trak(mux, track, true);
+		}
+	} else {
+		mp4_write_full_traks(mux);
 	}
 
-	if (!fragmented && mux->chapter_track)
-		mp4_write_trak(mux, mux->chapter_track, false);
-
 	// mvex
 	if (fragmented)
 		mp4_write_mvex(mux);
@@ -1991,7 +2059,12 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 	struct serializer *s = mux->serializer;
 	int64_t start = serializer_get_pos(s);
 
-	uint32_t flags = BASE_DATA_OFFSET_PRESENT | DEFAULT_SAMPLE_FLAGS_PRESENT;
+	/* Segments don't know where in a file they end up */
+	uint32_t flags = DEFAULT_SAMPLE_FLAGS_PRESENT;
+	if (mux->flags & MP4_SEGMENTED)
+		flags |= DEFAULT_BASE_IS_MOOF;
+	else
+		flags |= BASE_DATA_OFFSET_PRESENT;
 
 	/* Add default size/duration if all samples match. */
 	bool durations_match = true;
@@ -2023,7 +2096,8 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 	write_fullbox(s, 0, "tfhd", 0, flags);
 
 	s_wb32(s, track->track_id); // track_ID
-	s_wb64(s, moof_start);      // base_data_offset
+	if (flags & BASE_DATA_OFFSET_PRESENT)
+		s_wb64(s, moof_start); // base_data_offset
 
 	// default_sample_duration
 	if (durations_match) {
@@ -2047,13 +2121,9 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 	return write_box_size(s, start);
 }
 
-/// 8.8.12 Track fragment decode time
-static size_t mp4_write_tfdt(struct mp4_mux *mux, struct mp4_track *track)
+/* Decode time of the next fragment's first sample in track timescale */
+static uint64_t get_fragment_decode_time(struct mp4_track *track)
 {
-	struct serializer *s = mux->serializer;
-
-	write_fullbox(s, 20, "tfdt", 1, 0);
-
 	/* Subtract samples that are not written yet */
 	uint64_t duration_written = track->duration;
 	for (size_t i = 0; i < track->fragment_samples.num; i++)
@@ -2064,7 +2134,17 @@ static size_t mp4_write_tfdt(struct mp4_mux *mux, struct mp4_track *track)
 		duration_written = util_mul_div64(duration_written, track->timescale, track->timebase_den);
 	}
 
-	s_wb64(s, duration_written); // baseMediaDecodeTime
+	return duration_written;
+}
+
+/// 8.8.12 Track fragment decode time
+static size_t mp4_write_tfdt(struct mp4_mux *mux, struct mp4_track *track)
+{
+	struct serializer *s = mux->serializer;
+
+	write_fullbox(s, 20, "tfdt", 1, 0);
+
+	s_wb64(s, get_fragment_decode_time(track)); // baseMediaDecodeTime
 
 	return 20;
 }
@@ -2112,8 +2192,13 @@ static size_t mp4_write_trun(struct mp4_mux *mux, struct mp4_track *track, uint3
 	if (track->sample_size)
 		return write_box_size(s, start);
 
-	if (track->type == TRACK_VIDEO)
-		s_wb32(s, SAMPLE_FLAG_DEPENDS_NO); // first_sample_flags
+	/* Fragments between keyframes start with a non-sync sample */
+	if (track->type == TRACK_VIDEO) {
+		if (track->fragment_samples.array[0].keyframe)
+			s_wb32(s, SAMPLE_FLAG_DEPENDS_NO); // first_sample_flags
+		else
+			s_wb32(s, SAMPLE_FLAG_DEPENDS_YES | SAMPLE_FLAG_IS_NON_SYNC);
+	}
 
 	for (size_t idx = 0; idx < sample_count; idx++) {
 		struct fragment_sample *smp = &track->fragment_samples.array[idx];
@@ -2265,7 +2350,7 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 
 		/* When using negative CTS, subtract DTS-PTS offset. */
 		if (track->type == TRACK_VIDEO && mux->flags & MP4_USE_NEGATIVE_CTS) {
-			if (!track->offsets.num)
+			if (!track->samples)
 				track->dts_offset = offset;
 
 			offset -= track->dts_offset;
@@ -2276,6 +2361,7 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 		smp->size = size;
 		smp->offset = offset;
 		smp->duration = duration;
+		smp->keyframe = pkt->keyframe;
 
 		*mdat_size += size;
 
@@ -2293,6 +2379,11 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 
 		track->samples += sample_count;
 
+		/* Fragmented files never get a full moov, so the sample tables
+		 * for it aren't needed */
+		if (mux->flags & MP4_FRAGMENTED)
+			continue;
+
 		/* If delta (duration) matche sprevious, increment counter,
 		 * otherwise create a new entry. */
 		if (track->deltas.num == 0 || track->deltas.array[track->deltas.num - 1].delta != duration) {
@@ -2337,9 +2428,10 @@ static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
 	if (!count || !track->fragment_samples.num)
 		return;
 
-	struct chunk *chk = da_push_back_new(track->chunks);
-	chk->offset = serializer_get_pos(s);
-	chk->samples = (uint32_t)track->fragment_samples.num;
+	struct chunk chk = {
+		.offset = serializer_get_pos(s),
+		.samples = (uint32_t)track->fragment_samples.num,
+	};
 
 	for (size_t i = 0; i < track->fragment_samples.num; i++) {
 		struct encoder_packet pkt;
@@ -2348,18 +2440,73 @@ static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
 		obs_encoder_packet_release(&pkt);
 	}
 
-	chk->size = (uint32_t)(serializer_get_pos(s) - chk->offset);
+	chk.size = (uint32_t)(serializer_get_pos(s) - chk.offset);
 
 	/* Fixup sample count for fixed-size codecs */
 	if (track->sample_size)
-		chk->samples = chk->size / track->sample_size;
+		chk.samples = chk.size / track->sample_size;
+
+	if (!(mux->flags & MP4_FRAGMENTED))
+		da_push_back(track->chunks, &chk);
 
 	da_clear(track->fragment_samples);
 }
 
+/* Same order as the traf boxes written for the fragment */
+static void add_fragment_entries(struct mp4_mux *mux, int64_t moof_start)
+{
+	uint8_t traf_number = 0;
+
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+		if (!track->fragment_samples.num)
+			continue;
+
+		struct fragment_entry *entry = da_push_back_new(track->fragments);
+		entry->time = get_fragment_decode_time(track);
+		entry->moof_offset = (uint64_t)moof_start;
+		entry->traf_number = ++traf_number;
+	}
+}
+
+static void get_fragment_info(struct mp4_mux *mux, struct mp4_fragment_info *info)
+{
+	struct mp4_track *timing_track = NULL;
+
+	info->independent = true;
+
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+
+		if (!track->fragment_samples.num)
+			continue;
+
+		if (track->type == TRACK_VIDEO) {
+			if (!track->fragment_samples.array[0].keyframe)
+				info->independent = false;
+			if (!timing_track || timing_track->type != TRACK_VIDEO)
+				timing_track = track;
+		} else if (!timing_track) {
+			timing_track = track;
+		}
+	}
+
+	info->duration_usec = 0;
+	if (!timing_track)
+		return;
+
+	uint64_t duration = 0;
+	for (size_t i = 0; i < timing_track->fragment_samples.num; i++)
+		duration += timing_track->fragment_samples.array[i].duration;
+
+	info->duration_usec = (int64_t)util_mul_div64(duration, 1000000ULL * timing_track->timebase_num,
+						      timing_track->timebase_den);
+}
+
 static void mp4_flush_fragment(struct mp4_mux *mux)
 {
 	struct serializer *s = mux->serializer;
+	struct mp4_fragment_info frag_info = {0};
 
 	// Write file header if not already done
 	if (!mux->fragments_written) {
@@ -2377,9 +2524,17 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 
 	// Write initial incomplete moov (because fragmentation)
 	if (!mux->fragments_written) {
+		int64_t moov_start = serializer_get_pos(s);
+
 		mp4_write_moov(mux, true);
 		s_write(s, aod.bytes.array, aod.bytes.num);
+
+		/* mehd was written to the temporary buffer */
+		if (mux->mehd_offset)
+			mux->mehd_offset += moov_start;
 		array_output_serializer_reset(&aod);
+
+		frag_info.header_size = (size_t)serializer_get_pos(s);
 	}
 
 	mux->fragments_written++;
@@ -2406,6 +2561,13 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 
 	// write moof once to get size
 	int64_t moof_start = serializer_get_pos(s);
+
+	if ((mux->flags & MP4_FRAGMENTED) && !(mux->flags & MP4_SEGMENTED))
+		add_fragment_entries(mux, moof_start);
+
+	if (mux->fragment_cb)
+		get_fragment_info(mux, &frag_info);
+
 	size_t moof_size = mp4_write_moof(mux, 0, moof_start);
 	array_output_serializer_reset(&aod);
 
@@ -2439,7 +2601,11 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 	if (!mux->next_frag_pts && mux->chapter_track)
 		write_packets(mux, mux->chapter_track);
 
+	mux->frag_start_pts = mux->next_frag_pts;
 	mux->next_frag_pts = 0;
+
+	if (mux->fragment_cb)
+		mux->fragment_cb(mux->fragment_param, &frag_info);
 }
 
 /* ========================================================================== */
@@ -2578,6 +2744,7 @@ static inline void free_track(struct mp4_track *track)
 	da_free(track->offsets);
 	da_free(track->sync_samples);
 	da_free(track->fragment_samples);
+	da_free(track->fragments);
 }
 
 /* ===========================================================================*/
@@ -2621,6 +2788,16 @@ void mp4_mux_destroy(struct mp4_mux *mux)
 	bfree(mux);
 }
 
+static inline struct mp4_track *first_video_track(struct mp4_mux *mux)
+{
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		if (mux->tracks.array[i].type == TRACK_VIDEO)
+			return &mux->tracks.array[i];
+	}
+
+	return NULL;
+}
+
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 {
 	struct mp4_track *track = NULL;
@@ -2662,6 +2839,11 @@ bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 		/* Set fragmentation PTS if packet is keyframe and PTS > 0 */
 		if (parsed_packet.keyframe && parsed_packet.pts > 0) {
 			mux->next_frag_pts = packet_pts_usec(&parsed_packet);
+		} else if (mux->part_duration && !mux->next_frag_pts && track == first_video_track(mux)) {
+			int64_t pts_usec = packet_pts_usec(&parsed_packet);
+
+			if (pts_usec - mux->frag_start_pts >= mux->part_duration)
+				mux->next_frag_pts = pts_usec;
 		}
 	}
 
@@ -2670,10 +2852,30 @@ bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt)
 	return true;
 }
 
+void mp4_mux_set_progress_callback(struct mp4_mux *mux, mp4_mux_progress_cb callback, void *param)
+{
+	mux->progress_cb = callback;
+	mux->progress_param = param;
+}
+
+void mp4_mux_set_fragment_callback(struct mp4_mux *mux, mp4_mux_fragment_cb callback, void *param)
+{
+	mux->fragment_cb = callback;
+	mux->fragment_param = param;
+}
+
+void mp4_mux_set_part_duration(struct mp4_mux *mux, int64_t duration_usec)
+{
+	mux->part_duration = duration_usec;
+}
+
 bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name)
 {
 	if (dts_usec < 0)
 		return false;
+	/* Chapters only go into the full moov */
+	if (mux->flags & MP4_FRAGMENTED)
+		return false;
 	if (!mux->chapter_track)
 		add_chapter_track(mux);
 
@@ -2691,6 +2893,83 @@ bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name
 	return true;
 }
 
+/// 8.8.10 Track Fragment Random Access Box
+static size_t mp4_write_tfra(struct mp4_mux *mux, struct mp4_track *track)
+{
+	struct serializer *s = mux->serializer;
+	int64_t start = serializer_get_pos(s);
+
+	write_fullbox(s, 0, "tfra", 1, 0);
+
+	s_wb32(s, track->track_id); // track_ID
+	/* reserved, length_size_of_traf_num, length_size_of_trun_num and
+	 * length_size_of_sample_num (all 1 byte) */
+	s_wb32(s, 0);
+	s_wb32(s, (uint32_t)track->fragments.num); // number_of_entry
+
+	for (size_t i = 0; i < track->fragments.num; i++) {
+		struct fragment_entry *entry = &track->fragments.array[i];
+
+		s_wb64(s, entry->time);        // time
+		s_wb64(s, entry->moof_offset); // moof_offset
+		s_w8(s, entry->traf_number);   // traf_number
+		s_w8(s, 1);                    // trun_number
+		s_w8(s, 1);                    // sample_number
+	}
+
+	return write_box_size(s, start);
+}
+
+/// 8.8.9 Movie Fragment Random Access Box
+static size_t mp4_write_mfra(struct mp4_mux *mux)
+{
+	struct serializer *s = mux->serializer;
+	int64_t start = serializer_get_pos(s);
+
+	write_box(s, 0, "mfra");
+
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+		if (track->fragments.num)
+			mp4_write_tfra(mux, track);
+	}
+
+	/* Movie Fragment Random Access Offset Box (8.8.11), its size field
+	 * is the size of the enclosing mfra */
+	size_t size = serializer_get_pos(s) - start + 16;
+	write_fullbox(s, 16, "mfro", 0, 0);
+	s_wb32(s, (uint32_t)size);
+
+	return write_box_size(s, start);
+}
+
+/* The fragments are already complete on disk, only the index and the
+ * duration are left to write. */
+static bool mp4_finalise_fragmented(struct mp4_mux *mux)
+{
+	struct serializer *s = mux->serializer;
+
+	/* Use array serializer for mfra as it seeks to write box sizes */
+	struct serializer fs;
+	struct array_output_data ao;
+	array_output_serializer_init(&fs, &ao);
+
+	mux->serializer = &fs;
+	mp4_write_mfra(mux);
+	mux->serializer = s;
+
+	s_write(s, ao.bytes.array, ao.bytes.num);
+	info("Fragment index size: %zu KiB", ao.bytes.num / 1024);
+	array_output_serializer_free(&ao);
+
+	if (mux->mehd_offset) {
+		serializer_seek(s, mux->mehd_offset + 12, SERIALIZE_SEEK_START);
+		s_wb64(s, get_longest_track_duration(mux)); // fragment_duration
+	}
+
+	return true;
+}
+
 bool mp4_mux_finalise(struct mp4_mux *mux)
 {
 	struct serializer *s = mux->serializer;
@@ -2705,6 +2984,12 @@ bool mp4_mux_finalise(struct mp4_mux *mux)
 
 	info("Number of fragments: %u", mux->fragments_written);
 
+	if (mux->flags & MP4_SEGMENTED)
+		return true;
+
+	if (mux->flags & MP4_FRAGMENTED)
+		return mp4_finalise_fragmented(mux);
+
 	if (mux->flags & MP4_SKIP_FINALISATION) {
 		warn("Skipping MP4 finalization!");
 		return true;
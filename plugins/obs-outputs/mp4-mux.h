@@ -31,10 +31,38 @@ enum mp4_mux_flags {
 	MP4_SKIP_FINALISATION = 1 << 2,
 	/* Use negative CTS instead of edit lists */
 	MP4_USE_NEGATIVE_CTS = 1 << 3,
+	/* Keep the file fragmented and finish it with an index of the
+	 * fragments, only per-fragment information is kept in memory */
+	MP4_FRAGMENTED = 1 << 4,
+	/* Fragments are used as segments of their own (e.g. for HLS): offsets
+	 * are relative to each moof, and finalising only flushes the last
+	 * fragment */
+	MP4_SEGMENTED = 1 << 5,
 };
 
+struct mp4_fragment_info {
+	/* Size of the file header (ftyp/moov) written before the first
+	 * fragment, 0 for all others */
+	size_t header_size;
+	/* Starts with a keyframe on every video track */
+	bool independent;
+	/* Duration of the first video track (or of the first track without
+	 * video) */
+	int64_t duration_usec;
+};
+
+typedef void (*mp4_mux_progress_cb)(void *param, float progress);
+typedef void (*mp4_mux_fragment_cb)(void *param, const struct mp4_fragment_info *info);
+
 struct mp4_mux *mp4_mux_create(obs_output_t *output, struct serializer *serializer, enum mp4_mux_flags flags);
 void mp4_mux_destroy(struct mp4_mux *mux);
 bool mp4_mux_submit_packet(struct mp4_mux *mux, struct encoder_packet *pkt);
 bool mp4_mux_add_chapter(struct mp4_mux *mux, int64_t dts_usec, const char *name);
 bool mp4_mux_finalise(struct mp4_mux *mux);
+/* Called while finalising, with the fraction of the moov written so far */
+void mp4_mux_set_progress_callback(struct mp4_mux *mux, mp4_mux_progress_cb callback, void *param);
+/* Called once a fragment has been written to the serializer */
+void mp4_mux_set_fragment_callback(struct mp4_mux *mux, mp4_mux_fragment_cb callback, void *param);
+/* Also fragments between keyframes once the first video track has this much
+ * since the last fragment, 0 (the default) only fragments at keyframes */
+void mp4_mux_set_part_duration(struct mp4_mux *mux, int64_t duration_usec);
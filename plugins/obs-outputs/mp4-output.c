@@ -23,6 +23,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/deque.h>
 #include <util/buffered-file-serializer.h>
 
 #include <opts-parser.h>
@@ -38,6 +39,28 @@ struct chapter {
 	char *name;
 };
 
+enum file_job_type {
+	/* A file that is done being written to, the full moov still has to
+	 * be written and the writer flushed before it's complete. */
+	JOB_FINALIZE,
+	/* The file the output splits to, opened ahead of the split point */
+	JOB_OPEN_NEXT,
+};
+
+struct file_job {
+	enum file_job_type type;
+	struct mp4_output *out;
+	struct mp4_mux *muxer;
+	struct serializer *serializer;
+	char *path;
+	char *chapter_index;
+	uint64_t start_time;
+
+	/* the last file of the output, which stops once it is complete */
+	bool stop;
+	int code;
+};
+
 struct mp4_output {
 	obs_output_t *output;
 	struct dstr path;
@@ -45,7 +68,7 @@ struct mp4_output {
 	/* File serializer buffer configuration */
 	size_t buffer_size;
 	size_t chunk_size;
-	struct serializer serializer;
+	struct serializer *serializer;
 
 	volatile bool active;
 	volatile bool stopping;
@@ -54,6 +77,9 @@ struct mp4_output {
 	bool allow_overwrite;
 	uint64_t total_bytes;
 
+	/* Write statistics of the files written before the current one */
+	struct buffered_file_serializer_stats prev_stats;
+
 	pthread_mutex_t mutex;
 
 	struct mp4_mux *muxer;
@@ -62,6 +88,12 @@ struct mp4_output {
 	int64_t last_dts_usec;
 	DARRAY(struct chapter) chapters;
 
+	/* Chapters are only written to the file when it is finalised, so they
+	 * are also appended to a text file next to it as they are added. That
+	 * one survives a crash and is removed once the file is complete. */
+	FILE *chapter_index;
+	struct dstr chapter_index_path;
+
 	/* File splitting stuff */
 	bool split_file_enabled;
 	bool split_file_ready;
@@ -80,6 +112,19 @@ struct mp4_output {
 
 	/* Buffer for packets while we reinitialise the muxer after splitting */
 	DARRAY(struct encoder_packet) split_buffer;
+
+	/* Opening and finalisation happen on a thread of their own so that
+	 * neither splitting nor stopping holds up the encoders */
+	pthread_t file_thread;
+	bool file_thread_active;
+	pthread_mutex_t file_mutex;
+	os_sem_t *file_sem;
+	struct deque file_queue;
+
+	/* Next file of a split, set by the file thread */
+	volatile bool next_file_ready;
+	struct serializer *next_serializer;
+	struct dstr next_path;
 };
 
 static inline bool stopping(struct mp4_output *out)
@@ -139,19 +184,78 @@ static const char *mp4_output_name(void *unused)
 	return obs_module_text("MP4Output");
 }
 
+static void discard_next_file(struct mp4_output *out)
+{
+	if (!os_atomic_load_bool(&out->next_file_ready))
+		return;
+
+	if (out->next_serializer) {
+		buffered_file_serializer_free(out->next_serializer);
+		bfree(out->next_serializer);
+		out->next_serializer = NULL;
+		os_unlink(out->next_path.array);
+	}
+
+	dstr_free(&out->next_path);
+	os_atomic_set_bool(&out->next_file_ready, false);
+}
+
 static void mp4_output_destory(void *data)
 {
 	struct mp4_output *out = data;
 
+	if (out->file_thread_active) {
+		struct file_job *stop = NULL;
+
+		pthread_mutex_lock(&out->file_mutex);
+		deque_push_back(&out->file_queue, &stop, sizeof(stop));
+		pthread_mutex_unlock(&out->file_mutex);
+
+		os_sem_post(out->file_sem);
+		pthread_join(out->file_thread, NULL);
+	}
+
+	discard_next_file(out);
+
+	deque_free(&out->file_queue);
+	os_sem_destroy(out->file_sem);
+	pthread_mutex_destroy(&out->file_mutex);
+
 	for (size_t i = 0; i < out->chapters.num; i++)
 		bfree(out->chapters.array[i].name);
 	da_free(out->chapters);
 
+	if (out->chapter_index)
+		fclose(out->chapter_index);
+	dstr_free(&out->chapter_index_path);
+
 	pthread_mutex_destroy(&out->mutex);
 	dstr_free(&out->path);
 	bfree(out);
 }
 
+static void write_chapter_index(struct mp4_output *out, int64_t dts_usec, const char *name)
+{
+	if (!out->chapter_index) {
+		dstr_printf(&out->chapter_index_path, "%s.chapters", out->path.array);
+		out->chapter_index = os_fopen(out->chapter_index_path.array, "w");
+		if (!out->chapter_index) {
+			warn("Failed to open chapter index '%s'", out->chapter_index_path.array);
+			dstr_free(&out->chapter_index_path);
+			return;
+		}
+	}
+
+	int64_t total_ms = dts_usec / 1000;
+	int ms = (int)(total_ms % 1000);
+	int seconds = (int)(total_ms / 1000 % 60);
+	int minutes = (int)(total_ms / 60000 % 60);
+	int hours = (int)(total_ms / 3600000);
+
+	fprintf(out->chapter_index, "%02d:%02d:%02d.%03d %s\n", hours, minutes, seconds, ms, name);
+	fflush(out->chapter_index);
+}
+
 static void mp4_add_chapter_proc(void *data, calldata_t *cd)
 {
 	struct mp4_output *out = data;
@@ -176,6 +280,8 @@ static void mp4_add_chapter_proc(void *data, calldata_t *cd)
 	struct chapter *chap = da_push_back_new(out->chapters);
 	chap->dts_usec = out->last_dts_usec;
 	chap->name = name.array;
+	if (active(out))
+		write_chapter_index(out, chap->dts_usec, chap->name);
 	pthread_mutex_unlock(&out->mutex);
 }
 
@@ -190,18 +296,70 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&out->manual_split, true);
 }
 
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+/* Covers every file of the output, only the buffer fill is of the file being
+ * written */
+static void get_write_stats_proc(void *data, calldata_t *cd)
+{
+	struct mp4_output *out = data;
+	struct buffered_file_serializer_stats stats = {0};
+
+	pthread_mutex_lock(&out->mutex);
+
+	if (out->serializer)
+		buffered_file_serializer_get_stats(out->serializer, &stats);
+
+	stats.bytes_written += out->prev_stats.bytes_written;
+	stats.total_blocked_ns += out->prev_stats.total_blocked_ns;
+	if (out->prev_stats.buffer_peak > stats.buffer_peak)
+		stats.buffer_peak = out->prev_stats.buffer_peak;
+	if (out->prev_stats.max_blocked_ns > stats.max_blocked_ns)
+		stats.max_blocked_ns = out->prev_stats.max_blocked_ns;
+	if (out->prev_stats.max_write_ns > stats.max_write_ns)
+		stats.max_write_ns = out->prev_stats.max_write_ns;
+
+	pthread_mutex_unlock(&out->mutex);
+
+	calldata_set_int(cd, "bytes_written", (long long)stats.bytes_written);
+	calldata_set_int(cd, "buffer_used", (long long)stats.buffer_used);
+	calldata_set_int(cd, "buffer_peak", (long long)stats.buffer_peak);
+	calldata_set_int(cd, "buffer_size", (long long)stats.buffer_size);
+	calldata_set_float(cd, "max_blocked_ms", ns_to_ms(stats.max_blocked_ns));
+	calldata_set_float(cd, "total_blocked_ms", ns_to_ms(stats.total_blocked_ns));
+	calldata_set_float(cd, "max_write_ms", ns_to_ms(stats.max_write_ns));
+}
+
+static void *file_thread(void *data);
+
 static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct mp4_output *out = bzalloc(sizeof(struct mp4_output));
 	out->output = output;
 	pthread_mutex_init(&out->mutex, NULL);
+	pthread_mutex_init(&out->file_mutex, NULL);
+
+	if (os_sem_init(&out->file_sem, 0) == 0)
+		out->file_thread_active = pthread_create(&out->file_thread, NULL, file_thread, out) == 0;
+	if (!out->file_thread_active)
+		warn("Failed to create file thread, files will be opened and finalized in place");
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void file_changed(string next_file)");
+	signal_handler_add(sh, "void finalize_progress(string path, float progress)");
+	signal_handler_add(sh, "void file_finalized(string path)");
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void split_file(out bool split_file_enabled)", split_file_proc, out);
 	proc_handler_add(ph, "void add_chapter(string chapter_name)", mp4_add_chapter_proc, out);
+	proc_handler_add(ph,
+			 "void get_write_stats(out int bytes_written, out int buffer_used, out int buffer_peak, "
+			 "out int buffer_size, out float max_blocked_ms, out float total_blocked_ms, "
+			 "out float max_write_ms)",
+			 get_write_stats_proc, out);
 
 	UNUSED_PARAMETER(settings);
 	return out;
@@ -232,6 +390,8 @@ static void parse_custom_options(struct mp4_output *out, const char *opts_str)
 			apply_flag(&flags, opt.value, MP4_USE_MDTA_KEY_VALUE);
 		} else if (strcmp(opt.name, "use_negative_cts") == 0) {
 			apply_flag(&flags, opt.value, MP4_USE_NEGATIVE_CTS);
+		} else if (strcmp(opt.name, "fragmented") == 0) {
+			apply_flag(&flags, opt.value, MP4_FRAGMENTED);
 		} else if (strcmp(opt.name, "buffer_size") == 0) {
 			out->buffer_size = strtoull(opt.value, 0, 10) * 1048576ULL;
 		} else if (strcmp(opt.name, "chunk_size") == 0) {
@@ -248,6 +408,29 @@ static void parse_custom_options(struct mp4_output *out, const char *opts_str)
 
 static void generate_filename(struct mp4_output *out, struct dstr *dst, bool overwrite);
 
+static struct serializer *create_serializer(struct mp4_output *out, const char *path)
+{
+	struct serializer *s = bzalloc(sizeof(struct serializer));
+
+	if (!buffered_file_serializer_init(s, path, out->buffer_size, out->chunk_size)) {
+		warn("Unable to open MP4 file '%s'", path);
+		bfree(s);
+		return NULL;
+	}
+
+	return s;
+}
+
+static bool open_file(struct mp4_output *out)
+{
+	out->serializer = create_serializer(out, out->path.array);
+	if (!out->serializer)
+		return false;
+
+	out->muxer = mp4_mux_create(out->output, out->serializer, out->flags);
+	return true;
+}
+
 static bool mp4_output_start(void *data)
 {
 	struct mp4_output *out = data;
@@ -265,6 +448,7 @@ static bool mp4_output_start(void *data)
 	out->split_file_enabled = obs_data_get_bool(settings, "split_file");
 	out->allow_overwrite = obs_data_get_bool(settings, "allow_overwrite");
 	out->cur_size = 0;
+	memset(&out->prev_stats, 0, sizeof(out->prev_stats));
 
 	/* Get path */
 	const char *path = obs_data_get_string(settings, "path");
@@ -281,13 +465,10 @@ static bool mp4_output_start(void *data)
 
 	obs_data_release(settings);
 
-	if (!buffered_file_serializer_init(&out->serializer, out->path.array, out->buffer_size, out->chunk_size)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+	if (!open_file(out))
 		return false;
-	}
 
-	/* Initialise muxer and start capture */
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	/* Start capture */
 	os_atomic_set_bool(&out->active, true);
 	obs_output_begin_data_capture(out->output, 0);
 
@@ -376,41 +557,220 @@ static void generate_filename(struct mp4_output *out, struct dstr *dst, bool ove
 	obs_data_release(settings);
 }
 
-static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+static void signal_finalize_progress(void *param, float progress)
 {
-	uint64_t start_time = os_gettime_ns();
+	struct file_job *job = param;
+	signal_handler_t *sh = obs_output_get_signal_handler(job->out->output);
+	calldata_t cd = {0};
 
-	/* finalise file */
-	for (size_t i = 0; i < out->chapters.num; i++) {
-		struct chapter *chap = &out->chapters.array[i];
-		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
-	}
+	calldata_set_string(&cd, "path", job->path);
+	calldata_set_float(&cd, "progress", progress);
+	signal_handler_signal(sh, "finalize_progress", &cd);
+	calldata_free(&cd);
+}
 
-	mp4_mux_finalise(out->muxer);
+static void mp4_mux_destroy_task(void *ptr)
+{
+	struct mp4_mux *muxer = ptr;
+	mp4_mux_destroy(muxer);
+}
+
+static void finalize_file(struct file_job *job)
+{
+	struct mp4_output *out = job->out;
+	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
+	calldata_t cd = {0};
+
+	mp4_mux_set_progress_callback(job->muxer, signal_finalize_progress, job);
+	bool success = mp4_mux_finalise(job->muxer);
 
 	info("Waiting for file writer to finish...");
 
-	/* flush/close file and destroy old muxer */
-	buffered_file_serializer_free(&out->serializer);
-	mp4_mux_destroy(out->muxer);
+	/* Flush/close output file and destroy muxer */
+	buffered_file_serializer_free(job->serializer);
+	bfree(job->serializer);
+	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, job->muxer, false);
 
-	for (size_t i = 0; i < out->chapters.num; i++)
-		bfree(out->chapters.array[i].name);
+	info("MP4 file '%s' complete. Finalization took %" PRIu64 " ms.", job->path,
+	     (os_gettime_ns() - job->start_time) / 1000000);
+
+	/* The chapters are in the file now, unless finalising it failed */
+	if (job->chapter_index && success)
+		os_unlink(job->chapter_index);
+
+	calldata_set_string(&cd, "path", job->path);
+	signal_handler_signal(sh, "file_finalized", &cd);
+	calldata_free(&cd);
+
+	if (job->stop) {
+		/* The split never happened */
+		discard_next_file(out);
+
+		if (job->code)
+			obs_output_signal_stop(out->output, job->code);
+		else
+			obs_output_end_data_capture(out->output);
+	}
+
+	bfree(job->chapter_index);
+	bfree(job->path);
+	bfree(job);
+}
+
+static void open_next_file(struct file_job *job)
+{
+	struct mp4_output *out = job->out;
+	struct dstr path = {0};
+
+	generate_filename(out, &path, out->allow_overwrite);
+	struct serializer *s = create_serializer(out, path.array);
+
+	pthread_mutex_lock(&out->file_mutex);
+	out->next_serializer = s;
+	dstr_move(&out->next_path, &path);
+	pthread_mutex_unlock(&out->file_mutex);
+
+	os_atomic_set_bool(&out->next_file_ready, true);
+	bfree(job);
+}
+
+static void run_job(struct file_job *job)
+{
+	if (job->type == JOB_OPEN_NEXT)
+		open_next_file(job);
+	else
+		finalize_file(job);
+}
+
+static void *file_thread(void *data)
+{
+	struct mp4_output *out = data;
+
+	os_set_thread_name("mp4 output: file i/o");
+
+	for (;;) {
+		struct file_job *job;
+
+		os_sem_wait(out->file_sem);
+
+		pthread_mutex_lock(&out->file_mutex);
+		deque_pop_front(&out->file_queue, &job, sizeof(job));
+		pthread_mutex_unlock(&out->file_mutex);
+
+		if (!job)
+			break;
+
+		run_job(job);
+	}
+
+	return NULL;
+}
+
+static void queue_job(struct mp4_output *out, struct file_job *job)
+{
+	if (!out->file_thread_active) {
+		run_job(job);
+		return;
+	}
+
+	/* The next file is needed before anything else is done */
+	pthread_mutex_lock(&out->file_mutex);
+	if (job->type == JOB_OPEN_NEXT)
+		deque_push_front(&out->file_queue, &job, sizeof(job));
+	else
+		deque_push_back(&out->file_queue, &job, sizeof(job));
+	pthread_mutex_unlock(&out->file_mutex);
+
+	os_sem_post(out->file_sem);
+}
+
+/* Opens the file to split to on the file thread, generating its name at the
+ * split point like before. */
+static void queue_open_next(struct mp4_output *out)
+{
+	struct file_job *job = bzalloc(sizeof(struct file_job));
+
+	job->type = JOB_OPEN_NEXT;
+	job->out = out;
+	queue_job(out, job);
+}
+
+/* What is still buffered counts as written, it will be by the time anyone
+ * looks again */
+static void add_prev_stats(struct mp4_output *out)
+{
+	struct buffered_file_serializer_stats *prev = &out->prev_stats;
+	struct buffered_file_serializer_stats stats;
+
+	buffered_file_serializer_get_stats(out->serializer, &stats);
+
+	prev->bytes_written += stats.bytes_written + stats.buffer_used;
+	prev->total_blocked_ns += stats.total_blocked_ns;
+	if (stats.buffer_peak > prev->buffer_peak)
+		prev->buffer_peak = stats.buffer_peak;
+	if (stats.max_blocked_ns > prev->max_blocked_ns)
+		prev->max_blocked_ns = stats.max_blocked_ns;
+	if (stats.max_write_ns > prev->max_write_ns)
+		prev->max_write_ns = stats.max_write_ns;
+}
+
+/* Hands the current file over to the file thread, the muxer and serializer
+ * belong to it from then on. */
+static void queue_finalize(struct mp4_output *out, bool stop, int code)
+{
+	struct file_job *job = bzalloc(sizeof(struct file_job));
+
+	add_prev_stats(out);
+
+	job->type = JOB_FINALIZE;
+	job->out = out;
+	job->muxer = out->muxer;
+	job->serializer = out->serializer;
+	job->path = bstrdup(out->path.array);
+	job->start_time = os_gettime_ns();
+	job->stop = stop;
+	job->code = code;
+
+	out->muxer = NULL;
+	out->serializer = NULL;
+
+	for (size_t i = 0; i < out->chapters.num; i++) {
+		struct chapter *chap = &out->chapters.array[i];
+		mp4_mux_add_chapter(job->muxer, chap->dts_usec, chap->name);
+		bfree(chap->name);
+	}
 
 	da_clear(out->chapters);
 
-	info("MP4 file split complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
+	if (out->chapter_index) {
+		fclose(out->chapter_index);
+		out->chapter_index = NULL;
+		job->chapter_index = out->chapter_index_path.array;
+		dstr_init(&out->chapter_index_path);
+	}
 
-	/* open new file */
-	generate_filename(out, &out->path, out->allow_overwrite);
-	info("Changing output file to '%s'", out->path.array);
+	queue_job(out, job);
+}
 
-	if (!buffered_file_serializer_init(&out->serializer, out->path.array, out->buffer_size, out->chunk_size)) {
-		warn("Unable to open MP4 file '%s'", out->path.array);
+static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+{
+	/* finalise file */
+	queue_finalize(out, false, 0);
+
+	/* switch to the file opened ahead of time */
+	pthread_mutex_lock(&out->file_mutex);
+	dstr_move(&out->path, &out->next_path);
+	out->serializer = out->next_serializer;
+	out->next_serializer = NULL;
+	pthread_mutex_unlock(&out->file_mutex);
+
+	os_atomic_set_bool(&out->next_file_ready, false);
+
+	if (!out->serializer)
 		return false;
-	}
 
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	info("Changing output file to '%s'", out->path.array);
+	out->muxer = mp4_mux_create(out->output, out->serializer, out->flags);
 
 	calldata_t cd = {0};
 	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
@@ -432,45 +792,23 @@ static void mp4_output_stop(void *data, uint64_t ts)
 	os_atomic_set_bool(&out->stopping, true);
 }
 
-static void mp4_mux_destroy_task(void *ptr)
-{
-	struct mp4_mux *muxer = ptr;
-	mp4_mux_destroy(muxer);
-}
-
 static void mp4_output_actual_stop(struct mp4_output *out, int code)
 {
 	os_atomic_set_bool(&out->active, false);
 
-	uint64_t start_time = os_gettime_ns();
+	for (size_t i = 0; i < out->split_buffer.num; i++)
+		obs_encoder_packet_release(&out->split_buffer.array[i]);
+	da_free(out->split_buffer);
 
-	for (size_t i = 0; i < out->chapters.num; i++) {
-		struct chapter *chap = &out->chapters.array[i];
-		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
-	}
-
-	mp4_mux_finalise(out->muxer);
-
-	if (code) {
+	/* Opening the next file failed on a split, nothing left to finalize */
+	if (!out->muxer) {
+		discard_next_file(out);
 		obs_output_signal_stop(out->output, code);
-	} else {
-		obs_output_end_data_capture(out->output);
+		return;
 	}
 
-	info("Waiting for file writer to finish...");
-
-	/* Flush/close output file and destroy muxer */
-	buffered_file_serializer_free(&out->serializer);
-	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, out->muxer, false);
-	out->muxer = NULL;
-
-	/* Clear chapter data */
-	for (size_t i = 0; i < out->chapters.num; i++)
-		bfree(out->chapters.array[i].name);
-
-	da_clear(out->chapters);
-
-	info("MP4 file output complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
+	/* The output only stops once the file is complete */
+	queue_finalize(out, true, code);
 }
 
 static void push_back_packet(struct mp4_output *out, struct encoder_packet *packet)
@@ -531,7 +869,8 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 			int64_t first_pts_usec = packet_pts_usec(first_pkt);
 
 			if (pts_usec >= first_pts_usec) {
-				if (packet->type != OBS_ENCODER_AUDIO) {
+				/* Keep buffering until the next file is open */
+				if (packet->type != OBS_ENCODER_AUDIO || !os_atomic_load_bool(&out->next_file_ready)) {
 					push_back_packet(out, packet);
 					goto unlock;
 				}
@@ -543,6 +882,7 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 				out->split_file_ready = true;
 			}
 		} else if (should_split(out, packet)) {
+			queue_open_next(out);
 			push_back_packet(out, packet);
 			goto unlock;
 		}
@@ -570,7 +910,7 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 
 	submit_packet(out, packet);
 
-	if (serializer_get_pos(&out->serializer) == -1)
+	if (serializer_get_pos(out->serializer) == -1)
 		mp4_output_actual_stop(out, OBS_OUTPUT_ERROR);
 
 unlock:
@@ -0,0 +1,1023 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-module.h>
+#include <obs-avc.h>
+#include <obs-hevc.h>
+#include <util/darray.h>
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <inttypes.h>
+#include "librtmp/rtmp.h"
+#include "librtmp/log.h"
+#include "flv-mux.h"
+#include "rtmp-av1.h"
+#include "rtmp-hevc.h"
+
+/* Streams the same encoded data to several RTMP servers at once.
+ *
+ * Packets go through the output's single interleaver and are muxed into FLV
+ * tags once.  Each tag references the encoder packet's data and is shared,
+ * ref counted, between the destinations.  Every destination has its own
+ * queue, send thread, frame dropping and reconnect loop, so a slow or
+ * failing server only ever affects itself.
+ *
+ * The destinations come from the "destinations" array in the output
+ * settings, each an object with "server", "key" and optionally "username",
+ * "password", "drop_threshold_ms" and "pframe_drop_threshold_ms". */
+
+#define do_log(level, format, ...) \
+	blog(level, "[rtmp multi stream: '%s'] " format, obs_output_get_name(stream->output), ##__VA_ARGS__)
+#define dest_log(level, format, ...)                                                                       \
+	blog(level, "[rtmp multi stream: '%s' #%zu] " format, obs_output_get_name(dest->stream->output), \
+	     dest->idx, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define OPT_DESTINATIONS "destinations"
+#define OPT_SERVER "server"
+#define OPT_KEY "key"
+#define OPT_USERNAME "username"
+#define OPT_PASSWORD "password"
+#define OPT_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_RECONNECT_DELAY_SEC "reconnect_delay_sec"
+#define OPT_MAX_RECONNECT_RETRIES "max_reconnect_retries"
+
+#define MSEC_TO_USEC 1000LL
+
+/* a destination that falls this far behind starts over at a keyframe */
+#define MAX_QUEUE_DURATION_USEC (10000LL * MSEC_TO_USEC)
+
+#define MAX_SEND_BATCH_SIZE (256 * 1024)
+
+struct shared_tag {
+	volatile long refs;
+	struct encoder_packet packet;
+	struct flv_tag tag;
+};
+
+struct rtmp_multi_stream;
+
+struct rtmp_destination {
+	struct rtmp_multi_stream *stream;
+	size_t idx;
+
+	struct dstr path, key;
+	struct dstr username, password;
+	RTMP rtmp;
+
+	pthread_t send_thread;
+	bool thread_created;
+	os_sem_t *send_sem;
+
+	pthread_mutex_t packets_mutex;
+	struct deque packets;
+	/* packets are only queued while connected */
+	bool connected;
+	bool wait_for_keyframe;
+	int32_t ts_offset_ms;
+	int64_t last_dts_usec;
+	int min_priority;
+
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+
+	volatile bool failed;
+	uint64_t total_bytes_sent;
+	volatile long dropped_frames;
+	int reconnects;
+};
+
+struct rtmp_multi_stream {
+	obs_output_t *output;
+
+	DARRAY(struct rtmp_destination *) destinations;
+
+	volatile bool active;
+	volatile bool stop_pending;
+	volatile bool encode_error;
+	os_event_t *stop_event;
+	uint64_t stop_ts;
+	volatile long running_destinations;
+
+	bool got_first_packet;
+	int32_t start_dts_offset;
+
+	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
+	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
+
+	int reconnect_delay_sec;
+	int max_reconnect_retries;
+};
+
+static const char *rtmp_multi_stream_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RTMPMultiStream");
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct shared_tag *shared_tag_create(struct rtmp_multi_stream *stream, struct encoder_packet *packet)
+{
+	struct shared_tag *st = bzalloc(sizeof(*st));
+	size_t idx = packet->track_idx;
+
+	st->refs = 1;
+	st->packet = *packet;
+
+	if (packet->type == OBS_ENCODER_VIDEO && (idx != 0 || stream->video_codec[idx] != CODEC_H264))
+		flv_packet_frames(&st->packet, stream->video_codec[idx], stream->start_dts_offset, &st->tag, idx);
+	else if (packet->type == OBS_ENCODER_AUDIO && idx != 0)
+		flv_packet_audio_frames(&st->packet, stream->audio_codec[idx], stream->start_dts_offset, &st->tag,
+					idx);
+	else
+		flv_packet_mux(&st->packet, stream->start_dts_offset, &st->tag, false);
+
+	return st;
+}
+
+static inline void shared_tag_addref(struct shared_tag *st)
+{
+	os_atomic_inc_long(&st->refs);
+}
+
+static inline void shared_tag_release(struct shared_tag *st)
+{
+	if (st && os_atomic_dec_long(&st->refs) == 0) {
+		obs_encoder_packet_release(&st->packet);
+		bfree(st);
+	}
+}
+
+static inline int32_t get_tag_timestamp(const uint8_t *header)
+{
+	return (int32_t)(((uint32_t)header[7] << 24) | ((uint32_t)header[4] << 16) | ((uint32_t)header[5] << 8) |
+			 header[6]);
+}
+
+static inline void set_tag_timestamp(uint8_t *header, int32_t ts)
+{
+	header[4] = (uint8_t)(ts >> 16);
+	header[5] = (uint8_t)(ts >> 8);
+	header[6] = (uint8_t)ts;
+	header[7] = (uint8_t)((ts >> 24) & 0x7F);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool stopping(struct rtmp_multi_stream *stream)
+{
+	return os_event_try(stream->stop_event) != EAGAIN;
+}
+
+/* assumes packets_mutex */
+static void free_destination_packets(struct rtmp_destination *dest)
+{
+	while (dest->packets.size) {
+		struct shared_tag *st;
+		deque_pop_front(&dest->packets, &st, sizeof(st));
+		shared_tag_release(st);
+	}
+}
+
+static void destination_destroy(struct rtmp_destination *dest)
+{
+	if (!dest)
+		return;
+
+	RTMP_TLS_Free(&dest->rtmp);
+	free_destination_packets(dest);
+	deque_free(&dest->packets);
+	pthread_mutex_destroy(&dest->packets_mutex);
+	os_sem_destroy(dest->send_sem);
+	dstr_free(&dest->path);
+	dstr_free(&dest->key);
+	dstr_free(&dest->username);
+	dstr_free(&dest->password);
+	bfree(dest);
+}
+
+static void free_destinations(struct rtmp_multi_stream *stream)
+{
+	for (size_t i = 0; i < stream->destinations.num; i++) {
+		struct rtmp_destination *dest = stream->destinations.array[i];
+
+		if (dest->thread_created)
+			pthread_join(dest->send_thread, NULL);
+		destination_destroy(dest);
+	}
+
+	da_free(stream->destinations);
+}
+
+static void rtmp_multi_stream_destroy(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (os_atomic_load_bool(&stream->active)) {
+		stream->stop_ts = 0;
+		os_event_signal(stream->stop_event);
+		for (size_t i = 0; i < stream->destinations.num; i++)
+			os_sem_post(stream->destinations.array[i]->send_sem);
+	}
+
+	free_destinations(stream);
+	os_event_destroy(stream->stop_event);
+	bfree(stream);
+}
+
+static void *rtmp_multi_stream_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct rtmp_multi_stream *stream = bzalloc(sizeof(struct rtmp_multi_stream));
+	stream->output = output;
+
+	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
+{
+	bool valid = !dstr_is_empty(str);
+	val->av_val = valid ? str->array : NULL;
+	val->av_len = valid ? (int)str->len : 0;
+}
+
+static int connect_destination(struct rtmp_destination *dest)
+{
+	if (dstr_is_empty(&dest->path))
+		return OBS_OUTPUT_BAD_PATH;
+
+	dest_log(LOG_INFO, "Connecting to RTMP URL %s...", dest->path.array);
+
+	RTMP_TLS_Free(&dest->rtmp);
+	RTMP_Init(&dest->rtmp);
+
+	if (!RTMP_SetupURL(&dest->rtmp, dest->path.array))
+		return OBS_OUTPUT_BAD_PATH;
+
+	RTMP_EnableWrite(&dest->rtmp);
+
+	set_rtmp_dstr(&dest->rtmp.Link.pubUser, &dest->username);
+	set_rtmp_dstr(&dest->rtmp.Link.pubPasswd, &dest->password);
+	dest->rtmp.Link.flashVer.av_val = "FMLE/3.0 (compatible; FMSc/1.0)";
+	dest->rtmp.Link.flashVer.av_len = (int)strlen(dest->rtmp.Link.flashVer.av_val);
+	dest->rtmp.Link.swfUrl = dest->rtmp.Link.tcUrl;
+
+	RTMP_AddStream(&dest->rtmp, dest->key.array);
+
+	dest->rtmp.m_outChunkSize = 4096;
+	dest->rtmp.m_bSendChunkSizeInfo = true;
+	dest->rtmp.m_bUseNagle = true;
+
+	if (!RTMP_Connect(&dest->rtmp, NULL))
+		return OBS_OUTPUT_CONNECT_FAILED;
+
+	if (!RTMP_ConnectStream(&dest->rtmp, 0))
+		return OBS_OUTPUT_INVALID_STREAM;
+
+	dest_log(LOG_INFO, "Connection to %s successful", dest->path.array);
+	return OBS_OUTPUT_SUCCESS;
+}
+
+static bool write_tag(struct rtmp_destination *dest, struct flv_tag *tag)
+{
+	if (!tag->header_size)
+		return true;
+
+	if (RTMP_WriteTag(&dest->rtmp, (const char *)tag->header, (int)tag->header_size, (const char *)tag->data,
+			  (int)tag->data_size, 0) < 0)
+		return false;
+
+	dest->total_bytes_sent += flv_tag_size(tag);
+	return true;
+}
+
+static bool send_meta_data(struct rtmp_destination *dest)
+{
+	uint8_t *meta_data;
+	size_t meta_data_size;
+	bool success;
+
+	flv_meta_data(dest->stream->output, &meta_data, &meta_data_size, false);
+	success = RTMP_Write(&dest->rtmp, (char *)meta_data, (int)meta_data_size, 0) >= 0;
+	bfree(meta_data);
+
+	return success;
+}
+
+static bool send_audio_header(struct rtmp_destination *dest, size_t idx, bool *next)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	obs_encoder_t *aencoder = obs_output_get_audio_encoder(stream->output, idx);
+	struct encoder_packet packet = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1};
+	struct flv_tag tag;
+	uint8_t *header;
+
+	if (!aencoder) {
+		*next = false;
+		return true;
+	}
+
+	if (!obs_encoder_get_extra_data(aencoder, &header, &packet.size))
+		return false;
+
+	packet.data = header;
+	if (idx == 0)
+		flv_packet_mux(&packet, 0, &tag, true);
+	else
+		flv_packet_audio_start(&packet, stream->audio_codec[idx], &tag, idx);
+
+	return write_tag(dest, &tag);
+}
+
+static bool send_video_header(struct rtmp_destination *dest, size_t idx)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	obs_encoder_t *vencoder = obs_output_get_video_encoder2(stream->output, idx);
+	struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1, .keyframe = true};
+	struct flv_tag tag;
+	uint8_t *header;
+	size_t size;
+	bool success;
+
+	if (!obs_encoder_get_extra_data(vencoder, &header, &size))
+		return false;
+
+	switch (stream->video_codec[idx]) {
+	case CODEC_NONE:
+		return false;
+	case CODEC_H264:
+		packet.size = obs_parse_avc_header(&packet.data, header, size);
+		break;
+	case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+		packet.size = obs_parse_hevc_header(&packet.data, header, size);
+		break;
+#else
+		return false;
+#endif
+	case CODEC_AV1:
+		packet.size = obs_parse_av1_header(&packet.data, header, size);
+		break;
+	}
+
+	// Always send H.264 on track 0 as old style for compatibility.
+	if (idx == 0 && stream->video_codec[idx] == CODEC_H264)
+		flv_packet_mux(&packet, 0, &tag, true);
+	else
+		flv_packet_start(&packet, stream->video_codec[idx], &tag, idx);
+
+	success = write_tag(dest, &tag);
+	bfree(packet.data);
+	return success;
+}
+
+static bool send_headers(struct rtmp_destination *dest)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	size_t i = 0;
+	bool next = true;
+
+	if (!send_meta_data(dest))
+		return false;
+
+	if (!send_audio_header(dest, i++, &next))
+		return false;
+
+	for (size_t j = 0; j < MAX_OUTPUT_VIDEO_ENCODERS; j++) {
+		if (obs_output_get_video_encoder2(stream->output, j) && !send_video_header(dest, j))
+			return false;
+	}
+
+	while (next) {
+		if (!send_audio_header(dest, i++, &next))
+			return false;
+	}
+
+	return true;
+}
+
+static void send_footers(struct rtmp_destination *dest)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO, .timebase_den = 1};
+		struct flv_tag tag;
+
+		if (!obs_output_get_video_encoder2(stream->output, i))
+			continue;
+		if (i == 0 && stream->video_codec[i] == CODEC_H264)
+			continue;
+
+		flv_packet_end(&packet, stream->video_codec[i], &tag, i);
+		if (!write_tag(dest, &tag))
+			return;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct shared_tag *pop_tag(struct rtmp_destination *dest, int32_t *ts_offset_ms, bool *last)
+{
+	struct shared_tag *st = NULL;
+
+	pthread_mutex_lock(&dest->packets_mutex);
+	if (dest->packets.size) {
+		deque_pop_front(&dest->packets, &st, sizeof(st));
+		*ts_offset_ms = dest->ts_offset_ms;
+	}
+	*last = !dest->packets.size;
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	return st;
+}
+
+static bool send_shared_tag(struct rtmp_destination *dest, struct shared_tag *st, int32_t ts_offset_ms)
+{
+	struct flv_tag tag = st->tag;
+	int32_t ts = get_tag_timestamp(tag.header) - ts_offset_ms;
+
+	set_tag_timestamp(tag.header, ts > 0 ? ts : 0);
+	return write_tag(dest, &tag);
+}
+
+/* returns false if the connection failed */
+static bool send_loop(struct rtmp_destination *dest)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	bool batch = !(dest->rtmp.Link.protocol & RTMP_FEATURE_HTTP);
+
+	while (os_sem_wait(dest->send_sem) == 0) {
+		struct shared_tag *st;
+		int32_t ts_offset_ms;
+		bool last;
+
+		if (stopping(stream) && stream->stop_ts == 0)
+			break;
+
+		st = pop_tag(dest, &ts_offset_ms, &last);
+		if (!st) {
+			/* the stop point has been reached and everything
+			 * before it has been sent */
+			if (stopping(stream))
+				break;
+			continue;
+		}
+
+		if (batch)
+			RTMP_BeginBatch(&dest->rtmp);
+
+		bool success = send_shared_tag(dest, st, ts_offset_ms);
+		shared_tag_release(st);
+
+		if (success && batch && (last || dest->rtmp.m_sendBufLen >= MAX_SEND_BATCH_SIZE))
+			success = RTMP_FlushBatch(&dest->rtmp);
+		if (!success)
+			return false;
+	}
+
+	if (batch && !RTMP_FlushBatch(&dest->rtmp))
+		return false;
+
+	send_footers(dest);
+	return true;
+}
+
+static void set_connected(struct rtmp_destination *dest, bool connected)
+{
+	pthread_mutex_lock(&dest->packets_mutex);
+	if (!connected)
+		free_destination_packets(dest);
+	dest->connected = connected;
+	dest->wait_for_keyframe = true;
+	dest->min_priority = 0;
+	pthread_mutex_unlock(&dest->packets_mutex);
+}
+
+static void destination_finished(struct rtmp_multi_stream *stream)
+{
+	if (os_atomic_dec_long(&stream->running_destinations) != 0)
+		return;
+
+	if (os_atomic_load_bool(&stream->encode_error)) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_ENCODE_ERROR);
+	} else if (stopping(stream)) {
+		obs_output_end_data_capture(stream->output);
+	} else {
+		info("All destinations failed");
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_DISCONNECTED);
+	}
+
+	os_atomic_set_bool(&stream->active, false);
+}
+
+static void *destination_thread(void *data)
+{
+	struct rtmp_destination *dest = data;
+	struct rtmp_multi_stream *stream = dest->stream;
+	int retries = 0;
+
+	os_set_thread_name("rtmp-multi-stream: send_thread");
+
+	while (!stopping(stream)) {
+		int ret = connect_destination(dest);
+
+		if (ret == OBS_OUTPUT_SUCCESS && send_headers(dest)) {
+			retries = 0;
+			set_connected(dest, true);
+
+			bool success = send_loop(dest);
+
+			set_connected(dest, false);
+			RTMP_Close(&dest->rtmp);
+
+			if (success)
+				break;
+
+			dest_log(LOG_WARNING, "Disconnected from %s", dest->path.array);
+		} else {
+			dest_log(LOG_WARNING, "Connection to %s failed: %d", dest->path.array, ret);
+			RTMP_Close(&dest->rtmp);
+
+			/* a bad URL won't get better by retrying */
+			if (ret == OBS_OUTPUT_BAD_PATH)
+				break;
+		}
+
+		if (retries++ >= stream->max_reconnect_retries) {
+			dest_log(LOG_WARNING, "Giving up after %d reconnect attempt(s)", stream->max_reconnect_retries);
+			break;
+		}
+
+		dest_log(LOG_INFO, "Reconnecting in %d second(s)", stream->reconnect_delay_sec);
+		if (os_event_timedwait(stream->stop_event, (unsigned long)stream->reconnect_delay_sec * 1000) == 0)
+			break;
+
+		dest->reconnects++;
+	}
+
+	if (!stopping(stream))
+		os_atomic_set_bool(&dest->failed, true);
+
+	dest_log(LOG_INFO, "Sent %" PRIu64 " bytes, dropped %ld frame(s), %d reconnect(s)", dest->total_bytes_sent,
+		 os_atomic_load_long(&dest->dropped_frames), dest->reconnects);
+
+	destination_finished(stream);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct rtmp_destination *destination_create(struct rtmp_multi_stream *stream, obs_data_t *item,
+						   obs_data_t *settings, size_t idx)
+{
+	struct rtmp_destination *dest = bzalloc(sizeof(*dest));
+	int64_t drop_b, drop_p;
+
+	dest->stream = stream;
+	dest->idx = idx;
+	pthread_mutex_init_value(&dest->packets_mutex);
+
+	if (pthread_mutex_init(&dest->packets_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&dest->send_sem, 0) != 0)
+		goto fail;
+
+	dstr_copy(&dest->path, obs_data_get_string(item, OPT_SERVER));
+	dstr_copy(&dest->key, obs_data_get_string(item, OPT_KEY));
+	dstr_copy(&dest->username, obs_data_get_string(item, OPT_USERNAME));
+	dstr_copy(&dest->password, obs_data_get_string(item, OPT_PASSWORD));
+	dstr_depad(&dest->path);
+	dstr_depad(&dest->key);
+
+	drop_b = obs_data_has_user_value(item, OPT_DROP_THRESHOLD) ? obs_data_get_int(item, OPT_DROP_THRESHOLD)
+								    : obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	drop_p = obs_data_has_user_value(item, OPT_PFRAME_DROP_THRESHOLD)
+			 ? obs_data_get_int(item, OPT_PFRAME_DROP_THRESHOLD)
+			 : obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	dest->drop_threshold_usec = drop_b * MSEC_TO_USEC;
+	dest->pframe_drop_threshold_usec = drop_p * MSEC_TO_USEC;
+	return dest;
+
+fail:
+	destination_destroy(dest);
+	return NULL;
+}
+
+static bool init_destinations(struct rtmp_multi_stream *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	obs_data_array_t *array = obs_data_get_array(settings, OPT_DESTINATIONS);
+	size_t count = obs_data_array_count(array);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		struct rtmp_destination *dest = destination_create(stream, item, settings, i);
+
+		obs_data_release(item);
+		if (dest)
+			da_push_back(stream->destinations, &dest);
+	}
+
+	stream->reconnect_delay_sec = (int)obs_data_get_int(settings, OPT_RECONNECT_DELAY_SEC);
+	stream->max_reconnect_retries = (int)obs_data_get_int(settings, OPT_MAX_RECONNECT_RETRIES);
+	if (stream->reconnect_delay_sec < 1)
+		stream->reconnect_delay_sec = 1;
+
+	obs_data_array_release(array);
+	obs_data_release(settings);
+	return stream->destinations.num != 0;
+}
+
+static bool rtmp_multi_stream_start(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	/* threads of the previous session have exited or are exiting */
+	free_destinations(stream);
+	os_event_reset(stream->stop_event);
+	os_atomic_set_bool(&stream->stop_pending, false);
+	os_atomic_set_bool(&stream->encode_error, false);
+	stream->stop_ts = 0;
+	stream->got_first_packet = false;
+
+	if (!init_destinations(stream)) {
+		warn("No destinations");
+		return false;
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		obs_encoder_t *enc = obs_output_get_audio_encoder(stream->output, i);
+		if (enc)
+			stream->audio_codec[i] = to_audio_type(obs_encoder_get_codec(enc));
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		obs_encoder_t *enc = obs_output_get_video_encoder2(stream->output, i);
+		if (enc)
+			stream->video_codec[i] = to_video_type(obs_encoder_get_codec(enc));
+	}
+
+	os_atomic_set_bool(&stream->active, true);
+	os_atomic_set_long(&stream->running_destinations, (long)stream->destinations.num);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	for (size_t i = 0; i < stream->destinations.num; i++) {
+		struct rtmp_destination *dest = stream->destinations.array[i];
+
+		if (pthread_create(&dest->send_thread, NULL, destination_thread, dest) == 0) {
+			dest->thread_created = true;
+		} else {
+			dest_log(LOG_WARNING, "Failed to create send thread");
+			os_atomic_set_bool(&dest->failed, true);
+			destination_finished(stream);
+		}
+	}
+
+	info("Streaming to %zu destination(s)", stream->destinations.num);
+	return true;
+}
+
+static void stop_destinations(struct rtmp_multi_stream *stream)
+{
+	os_event_signal(stream->stop_event);
+	for (size_t i = 0; i < stream->destinations.num; i++)
+		os_sem_post(stream->destinations.array[i]->send_sem);
+}
+
+static void rtmp_multi_stream_stop(void *data, uint64_t ts)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (!os_atomic_load_bool(&stream->active)) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_SUCCESS);
+		return;
+	}
+
+	/* with a timestamp, stop once the data reaches it */
+	stream->stop_ts = ts / 1000ULL;
+	if (ts)
+		os_atomic_set_bool(&stream->stop_pending, true);
+	else
+		stop_destinations(stream);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* assumes packets_mutex */
+static void drop_frames(struct rtmp_destination *dest, int highest_priority)
+{
+	struct deque new_buf = {0};
+	int num_frames_dropped = 0;
+
+	while (dest->packets.size) {
+		struct shared_tag *st;
+		deque_pop_front(&dest->packets, &st, sizeof(st));
+
+		/* do not drop audio data or video keyframes */
+		if (st->packet.type == OBS_ENCODER_AUDIO || st->packet.drop_priority >= highest_priority) {
+			deque_push_back(&new_buf, &st, sizeof(st));
+		} else {
+			num_frames_dropped++;
+			shared_tag_release(st);
+		}
+	}
+
+	deque_free(&dest->packets);
+	dest->packets = new_buf;
+
+	if (dest->min_priority < highest_priority)
+		dest->min_priority = highest_priority;
+	if (num_frames_dropped)
+		os_atomic_set_long(&dest->dropped_frames,
+				   os_atomic_load_long(&dest->dropped_frames) + num_frames_dropped);
+}
+
+/* assumes packets_mutex */
+static void check_to_drop_frames(struct rtmp_destination *dest, bool pframes)
+{
+	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
+	int64_t drop_threshold = pframes ? dest->pframe_drop_threshold_usec : dest->drop_threshold_usec;
+	size_t num_packets = dest->packets.size / sizeof(struct shared_tag *);
+
+	if (dest->min_priority >= priority)
+		return;
+
+	for (size_t i = 0; i < num_packets; i++) {
+		struct shared_tag **st = deque_data(&dest->packets, i * sizeof(struct shared_tag *));
+
+		if ((*st)->packet.type == OBS_ENCODER_VIDEO) {
+			if (dest->last_dts_usec - (*st)->packet.dts_usec >= drop_threshold)
+				drop_frames(dest, priority);
+			return;
+		}
+	}
+}
+
+/* assumes packets_mutex */
+static bool queue_full(struct rtmp_destination *dest, struct shared_tag *st)
+{
+	struct shared_tag **first;
+
+	if (!dest->packets.size)
+		return false;
+
+	first = deque_data(&dest->packets, 0);
+	return st->packet.dts_usec - (*first)->packet.dts_usec >= MAX_QUEUE_DURATION_USEC;
+}
+
+static void queue_tag(struct rtmp_destination *dest, struct shared_tag *st)
+{
+	struct encoder_packet *packet = &st->packet;
+	bool queued = false;
+
+	pthread_mutex_lock(&dest->packets_mutex);
+
+	if (!dest->connected)
+		goto unlock;
+
+	if (queue_full(dest, st)) {
+		dest_log(LOG_WARNING, "Destination is too far behind, skipping to the next keyframe");
+		os_atomic_set_long(&dest->dropped_frames, os_atomic_load_long(&dest->dropped_frames) +
+								  (long)(dest->packets.size / sizeof(st)));
+		free_destination_packets(dest);
+		dest->wait_for_keyframe = true;
+	}
+
+	/* a new connection starts at a keyframe with its own time base */
+	if (dest->wait_for_keyframe) {
+		if (packet->type != OBS_ENCODER_VIDEO || packet->track_idx != 0 || !packet->keyframe)
+			goto unlock;
+
+		dest->wait_for_keyframe = false;
+		dest->ts_offset_ms = get_tag_timestamp(st->tag.header);
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		check_to_drop_frames(dest, false);
+		check_to_drop_frames(dest, true);
+
+		if (packet->drop_priority < dest->min_priority) {
+			os_atomic_inc_long(&dest->dropped_frames);
+			goto unlock;
+		}
+
+		dest->min_priority = 0;
+		dest->last_dts_usec = packet->dts_usec;
+	}
+
+	shared_tag_addref(st);
+	deque_push_back(&dest->packets, &st, sizeof(st));
+	queued = true;
+
+unlock:
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	if (queued)
+		os_sem_post(dest->send_sem);
+}
+
+static void rtmp_multi_stream_data(void *data, struct encoder_packet *packet)
+{
+	struct rtmp_multi_stream *stream = data;
+	struct encoder_packet new_packet;
+	struct shared_tag *st;
+
+	if (!os_atomic_load_bool(&stream->active) || stopping(stream))
+		return;
+
+	/* encoder fail */
+	if (!packet) {
+		os_atomic_set_bool(&stream->encode_error, true);
+		stream->stop_ts = 0;
+		stop_destinations(stream);
+		return;
+	}
+
+	if (os_atomic_load_bool(&stream->stop_pending) && packet->sys_dts_usec >= (int64_t)stream->stop_ts) {
+		os_atomic_set_bool(&stream->stop_pending, false);
+		stop_destinations(stream);
+		return;
+	}
+
+	if (!stream->got_first_packet) {
+		stream->start_dts_offset = get_ms_time(packet, packet->dts);
+		stream->got_first_packet = true;
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		switch (stream->video_codec[packet->track_idx]) {
+		case CODEC_NONE:
+			return;
+		case CODEC_H264:
+			obs_parse_avc_packet(&new_packet, packet);
+			break;
+		case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+			obs_parse_hevc_packet(&new_packet, packet);
+			break;
+#else
+			return;
+#endif
+		case CODEC_AV1:
+			obs_parse_av1_packet(&new_packet, packet);
+			break;
+		}
+	} else {
+		obs_encoder_packet_ref(&new_packet, packet);
+	}
+
+	/* muxed once, the destinations only hold references */
+	st = shared_tag_create(stream, &new_packet);
+
+	for (size_t i = 0; i < stream->destinations.num; i++)
+		queue_tag(stream->destinations.array[i], st);
+
+	shared_tag_release(st);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void rtmp_multi_stream_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(defaults, OPT_RECONNECT_DELAY_SEC, 10);
+	obs_data_set_default_int(defaults, OPT_MAX_RECONNECT_RETRIES, 20);
+}
+
+static obs_properties_t *rtmp_multi_stream_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *p;
+
+	p = obs_properties_add_int(props, OPT_DROP_THRESHOLD, obs_module_text("RTMPStream.DropThreshold"), 200, 10000,
+				   100);
+	obs_property_int_set_suffix(p, " ms");
+
+	p = obs_properties_add_int(props, OPT_RECONNECT_DELAY_SEC, obs_module_text("RTMPMultiStream.ReconnectDelay"),
+				   1, 60, 1);
+	obs_property_int_set_suffix(p, " s");
+
+	obs_properties_add_int(props, OPT_MAX_RECONNECT_RETRIES, obs_module_text("RTMPMultiStream.MaxRetries"), 0,
+			       10000, 1);
+
+	return props;
+}
+
+static uint64_t rtmp_multi_stream_total_bytes_sent(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < stream->destinations.num; i++)
+		total += stream->destinations.array[i]->total_bytes_sent;
+	return total;
+}
+
+static int rtmp_multi_stream_dropped_frames(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	long dropped = 0;
+
+	for (size_t i = 0; i < stream->destinations.num; i++)
+		dropped += os_atomic_load_long(&stream->destinations.array[i]->dropped_frames);
+	return (int)dropped;
+}
+
+/* the most congested destination that is still being streamed to */
+static float rtmp_multi_stream_congestion(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	float congestion = 0.0f;
+
+	for (size_t i = 0; i < stream->destinations.num; i++) {
+		struct rtmp_destination *dest = stream->destinations.array[i];
+		float val;
+
+		if (os_atomic_load_bool(&dest->failed))
+			continue;
+
+		pthread_mutex_lock(&dest->packets_mutex);
+		if (dest->min_priority > 0) {
+			val = 1.0f;
+		} else if (dest->packets.size) {
+			struct shared_tag **first = deque_data(&dest->packets, 0);
+			int64_t duration = dest->last_dts_usec - (*first)->packet.dts_usec;
+
+			val = (float)duration / (float)dest->drop_threshold_usec;
+		} else {
+			val = 0.0f;
+		}
+		pthread_mutex_unlock(&dest->packets_mutex);
+
+		if (val > congestion)
+			congestion = val;
+	}
+
+	return congestion > 1.0f ? 1.0f : congestion;
+}
+
+struct obs_output_info rtmp_multi_output_info = {
+	.id = "rtmp_multi_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK_AV,
+#ifdef NO_CRYPTO
+	.protocols = "RTMP",
+#else
+	.protocols = "RTMP;RTMPS",
+#endif
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc;av1",
+#else
+	.encoded_video_codecs = "h264;av1",
+#endif
+	.encoded_audio_codecs = "aac",
+	.get_name = rtmp_multi_stream_getname,
+	.create = rtmp_multi_stream_create,
+	.destroy = rtmp_multi_stream_destroy,
+	.start = rtmp_multi_stream_start,
+	.stop = rtmp_multi_stream_stop,
+	.encoded_packet = rtmp_multi_stream_data,
+	.get_defaults = rtmp_multi_stream_defaults,
+	.get_properties = rtmp_multi_stream_properties,
+	.get_total_bytes = rtmp_multi_stream_total_bytes_sent,
+	.get_congestion = rtmp_multi_stream_congestion,
+	.get_dropped_frames = rtmp_multi_stream_dropped_frames,
+};
@@ -0,0 +1,248 @@
+#ifndef _WIN32
+#include "rtmp-stream.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+/* The send thread can't wake poll() through an os_event_t, so the socket
+ * thread also watches the read end of a pipe that gets a byte written to it
+ * whenever the buffer gets data or the thread should exit. */
+
+bool socket_wake_init(struct rtmp_stream *stream)
+{
+	if (pipe(stream->socket_wake_fds) != 0) {
+		stream->socket_wake_fds[0] = -1;
+		stream->socket_wake_fds[1] = -1;
+		return false;
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		int flags = fcntl(stream->socket_wake_fds[i], F_GETFL);
+		fcntl(stream->socket_wake_fds[i], F_SETFL, flags | O_NONBLOCK);
+		fcntl(stream->socket_wake_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return true;
+}
+
+void socket_wake_free(struct rtmp_stream *stream)
+{
+	for (size_t i = 0; i < 2; i++) {
+		if (stream->socket_wake_fds[i] != -1) {
+			close(stream->socket_wake_fds[i]);
+			stream->socket_wake_fds[i] = -1;
+		}
+	}
+}
+
+void socket_wake_signal(struct rtmp_stream *stream)
+{
+	const char c = 0;
+
+	/* a full pipe already has a wakeup pending */
+	if (stream->socket_wake_fds[1] != -1 && write(stream->socket_wake_fds[1], &c, 1) < 0 && errno != EAGAIN)
+		blog(LOG_WARNING, "socket_thread_posix: Failed to signal socket thread, errno %d", errno);
+}
+
+static void socket_wake_drain(struct rtmp_stream *stream)
+{
+	char discard[64];
+
+	while (read(stream->socket_wake_fds[0], discard, sizeof(discard)) > 0)
+		;
+}
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+static bool socket_read(struct rtmp_stream *stream)
+{
+	char discard[16384];
+
+	for (;;) {
+		ssize_t ret = recv(stream->rtmp.m_sb.sb_socket, discard, sizeof(discard), 0);
+		int err_code = 0;
+
+		if (ret > 0)
+			continue;
+
+		if (ret == -1) {
+			err_code = errno;
+			if (err_code == EAGAIN || err_code == EWOULDBLOCK)
+				return true;
+			if (err_code == EINTR)
+				continue;
+		}
+
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Socket error, recv() returned "
+		     "%zd, errno %d",
+		     ret, err_code);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, size_t latency_packet_size,
+				int delay_time)
+{
+	bool exit_loop = false;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	size_t send_len = latency_packet_size < stream->write_buf_len ? latency_packet_size : stream->write_buf_len;
+	int ret = RTMPSockBuf_Send(&stream->rtmp.m_sb, (const char *)stream->write_buf, (int)send_len);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf, stream->write_buf + ret, stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		os_event_signal(stream->buffer_space_available_event);
+	} else {
+		int err_code = ret == -1 ? errno : 0;
+
+		if (ret == -1 && (err_code == EAGAIN || err_code == EWOULDBLOCK || err_code == EINTR)) {
+			if (err_code != EINTR) {
+				*can_write = false;
+				socket_stall_begin(stream);
+			}
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_BREAK;
+		}
+
+		/* connection closed, or connection was aborted /
+		 * socket closed / etc, that's a fatal error. */
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Socket error, send() returned "
+		     "%d, errno %d",
+		     ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+#define LATENCY_FACTOR 20
+
+static inline void socket_thread_posix_internal(struct rtmp_stream *stream)
+{
+	bool can_write = true;
+
+	int delay_time;
+	size_t latency_packet_size;
+
+	struct pollfd fds[2] = {0};
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size = stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	fds[0].fd = stream->rtmp.m_sb.sb_socket;
+	fds[1].fd = stream->socket_wake_fds[0];
+	fds[1].events = POLLIN;
+
+	for (;;) {
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		/* only ask for writability while the socket is full, it's
+		 * level triggered and would otherwise spin */
+		fds[0].events = POLLIN | (can_write ? 0 : POLLOUT);
+
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_posix: Aborting due to poll failure, errno %d", errno);
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		if (fds[1].revents & POLLIN)
+			socket_wake_drain(stream);
+
+		if (fds[0].revents & (POLLERR | POLLNVAL)) {
+			int err_code = 0;
+			socklen_t size = sizeof(err_code);
+
+			getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR, &err_code, &size);
+			blog(LOG_ERROR,
+			     "socket_thread_posix: Aborting due to socket error "
+			     "%d (buffer: %zu / %zu)",
+			     err_code, stream->write_buf_len, stream->write_buf_size);
+			stream->rtmp.last_error_code = err_code;
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		/* a hang up shows up as a failed recv() */
+		if ((fds[0].revents & (POLLIN | POLLHUP)) && !socket_read(stream))
+			return;
+
+		if (fds[0].revents & POLLOUT) {
+			can_write = true;
+			socket_stall_end(stream);
+		}
+
+		while (can_write) {
+			enum data_ret ret = write_data(stream, &can_write, latency_packet_size, delay_time);
+
+			if (ret == RET_FATAL)
+				return;
+			if (ret == RET_BREAK)
+				break;
+		}
+	}
+
+	blog(LOG_INFO, "socket_thread_posix: Normal exit");
+}
+
+void *socket_thread_posix(void *data)
+{
+	struct rtmp_stream *stream = data;
+
+	os_set_thread_name("rtmp-stream: socket_thread");
+	socket_thread_posix_internal(stream);
+	return NULL;
+}
+#endif
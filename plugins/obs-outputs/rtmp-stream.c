@@ -43,6 +43,22 @@
 #define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
 #define MIN_ESTIMATE_DURATION_MS 1000
 #define MAX_ESTIMATE_DURATION_MS 2000
+#define MIN_DBR_BITRATE 50
+#define DBR_TCP_SAMPLE_NS (100ULL * MSEC_TO_NSEC)
+/* TCP estimates are what the link delivered while backed up, leave room for
+ * the backlog to drain */
+#define DBR_TCP_HEADROOM_PERCENT 90
+/* hold off increasing while the RTT shows a standing queue */
+#define DBR_RTT_INFLATION 2
+
+/* upper bound on how much the send thread collects before sending it */
+#define MAX_SEND_BATCH_SIZE (256 * 1024)
+
+#define SEND_RATE_WINDOW_NS (500ULL * MSEC_TO_NSEC)
+#define INGEST_CACHE_TIMEOUT_NS (10ULL * 60ULL * SEC_TO_NSEC)
+
+/* once dropping, go to half the threshold so it doesn't retrigger at once */
+#define DROP_TARGET_PERCENT 50
 
 static const char *rtmp_stream_getname(void *unused)
 {
@@ -75,6 +91,7 @@ static inline void free_packets(struct rtmp_stream *stream)
 		deque_pop_front(&stream->packets, &packet, sizeof(packet));
 		obs_encoder_packet_release(&packet);
 	}
+	stream->packets_bytes = 0;
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -127,6 +144,9 @@ static void rtmp_stream_destroy(void *data)
 	dstr_free(&stream->password);
 	dstr_free(&stream->encoder_name);
 	dstr_free(&stream->bind_ip);
+	dstr_free(&stream->ingest_alternatives);
+	dstr_free(&stream->ingest_cache_url);
+	dstr_free(&stream->ingest_cache_choice);
 	os_event_destroy(stream->stop_event);
 	os_sem_destroy(stream->send_sem);
 	pthread_mutex_destroy(&stream->packets_mutex);
@@ -142,6 +162,9 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+#ifndef _WIN32
+	socket_wake_free(stream);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
@@ -153,6 +176,10 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+#ifndef _WIN32
+	stream->socket_wake_fds[0] = -1;
+	stream->socket_wake_fds[1] = -1;
+#endif
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_LogSetLevel(RTMP_LOGWARNING);
@@ -235,6 +262,7 @@ static inline bool get_next_packet(struct rtmp_stream *stream, struct encoder_pa
 	pthread_mutex_lock(&stream->packets_mutex);
 	if (stream->packets.size) {
 		deque_pop_front(&stream->packets, packet, sizeof(struct encoder_packet));
+		stream->packets_bytes -= packet->size;
 		new_packet = true;
 	}
 	pthread_mutex_unlock(&stream->packets_mutex);
@@ -242,6 +270,17 @@ static inline bool get_next_packet(struct rtmp_stream *stream, struct encoder_pa
 	return new_packet;
 }
 
+static inline bool has_queued_packets(struct rtmp_stream *stream)
+{
+	bool queued;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	queued = stream->packets.size != 0;
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	return queued;
+}
+
 static bool process_recv_data(struct rtmp_stream *stream, size_t size)
 {
 	UNUSED_PARAMETER(size);
@@ -341,7 +380,14 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
-#ifdef _WIN32
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifndef _WIN32
+	socket_wake_signal(stream);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len, void *arg)
 {
 	UNUSED_PARAMETER(sb);
@@ -368,14 +414,15 @@ retry_send:
 
 	memcpy(stream->write_buf + stream->write_buf_len, data, len);
 	stream->write_buf_len += len;
+	if (stream->write_buf_len > stream->write_buf_peak)
+		stream->write_buf_peak = stream->write_buf_len;
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal(stream->buffer_has_data_event);
+	signal_socket_thread(stream);
 
 	return len;
 }
-#endif // _WIN32
 
 static int handle_socket_read(struct rtmp_stream *stream)
 {
@@ -396,23 +443,32 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+static inline int write_tag(struct rtmp_stream *stream, struct flv_tag *tag)
+{
+	if (!tag->header_size)
+		return 0;
+
+	return RTMP_WriteTag(&stream->rtmp, (const char *)tag->header, (int)tag->header_size, (const char *)tag->data,
+			     (int)tag->data_size, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
 {
-	uint8_t *data;
+	struct flv_tag tag;
 	size_t size;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data, &size, is_header);
+	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &tag, is_header);
+	size = flv_tag_size(&tag);
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, &tag);
 
 	if (is_header)
 		bfree(packet->data);
@@ -426,27 +482,27 @@ static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet
 static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, bool is_footer,
 			  size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
+	size_t size;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
 	if (is_header) {
-		flv_packet_start(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_start(packet, stream->video_codec[idx], &tag, idx);
 	} else if (is_footer) {
-		flv_packet_end(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_end(packet, stream->video_codec[idx], &tag, idx);
 	} else {
-		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &tag, idx);
 	}
+	size = flv_tag_size(&tag);
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, &tag);
 
 	if (is_header || is_footer) // manually created packets
 		bfree(packet->data);
@@ -459,21 +515,19 @@ static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *pac
 
 static int send_audio_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct flv_tag tag;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
 	if (is_header) {
-		flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
+		flv_packet_audio_start(packet, stream->audio_codec[idx], &tag, idx);
 	} else {
-		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &tag, idx);
 	}
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, &tag);
 
 	if (is_header)
 		bfree(packet->data);
@@ -605,11 +659,91 @@ static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
 
 	if (stream->dbr_est_bitrate) {
 		stream->dbr_est_bitrate -= stream->audio_bitrate;
-		if (stream->dbr_est_bitrate < 50)
-			stream->dbr_est_bitrate = 50;
+		if (stream->dbr_est_bitrate < stream->dbr_min_bitrate)
+			stream->dbr_est_bitrate = stream->dbr_min_bitrate;
 	}
 }
 
+/* Feeds the estimate with what the peer acknowledged since the last sample,
+ * in place of per-packet send timing. */
+static void dbr_sample_tcp_stats(struct rtmp_stream *stream)
+{
+	uint64_t ts = os_gettime_ns();
+	struct dbr_frame frame;
+	struct tcp_stats tcp;
+
+	if (ts - stream->dbr_last_sample_ns < DBR_TCP_SAMPLE_NS)
+		return;
+	if (!tcp_stats_get(stream->rtmp.m_sb.sb_socket, &tcp))
+		return;
+
+	frame.send_beg = stream->dbr_last_sample_ns;
+	frame.send_end = ts;
+	frame.size = (size_t)(tcp.bytes_acked - stream->dbr_last_acked);
+
+	stream->dbr_last_sample_ns = ts;
+	stream->dbr_last_acked = tcp.bytes_acked;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	dbr_add_frame(stream, &frame);
+	stream->dbr_rtt_us = tcp.rtt_us;
+	stream->dbr_min_rtt_us = tcp.min_rtt_us;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
+/* Windows in which the queue ran dry only show what was offered, not what
+ * the connection can take, so they can only raise the estimate. */
+static void update_send_rate(struct rtmp_stream *stream, size_t size, bool queue_empty)
+{
+	uint64_t ts = os_gettime_ns();
+	uint64_t elapsed;
+
+	if (!stream->send_window_start_ns)
+		stream->send_window_start_ns = ts;
+
+	stream->send_window_bytes += size;
+	stream->send_window_idle |= queue_empty;
+
+	elapsed = ts - stream->send_window_start_ns;
+	if (elapsed < SEND_RATE_WINDOW_NS)
+		return;
+
+	long rate = (long)(stream->send_window_bytes * SEC_TO_NSEC / elapsed);
+	if (!stream->send_window_idle || rate > os_atomic_load_long(&stream->send_rate))
+		os_atomic_set_long(&stream->send_rate, rate);
+
+	stream->send_window_start_ns = ts;
+	stream->send_window_bytes = 0;
+	stream->send_window_idle = false;
+}
+
+static void log_dropped_frames(struct rtmp_stream *stream)
+{
+	struct dstr str = {0};
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (stream->dropped_track_frames[i])
+			dstr_catf(&str, "%s track %zu: %d", str.len ? "," : "", i, stream->dropped_track_frames[i]);
+	}
+
+	if (str.len)
+		info("Dropped frames per video track:%s", str.array);
+	dstr_free(&str);
+}
+
+static void dbr_init_tcp_stats(struct rtmp_stream *stream)
+{
+	struct tcp_stats tcp;
+
+	stream->dbr_tcp_stats = stream->dbr_enabled && tcp_stats_get(stream->rtmp.m_sb.sb_socket, &tcp);
+	if (!stream->dbr_tcp_stats)
+		return;
+
+	stream->dbr_last_sample_ns = os_gettime_ns();
+	stream->dbr_last_acked = tcp.bytes_acked;
+	info("Dynamic bitrate estimating from TCP statistics");
+}
+
 static void dbr_set_bitrate(struct rtmp_stream *stream);
 
 #ifdef _WIN32
@@ -630,6 +764,13 @@ static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
 
+	dbr_init_tcp_stats(stream);
+
+	/* The new socket loop already buffers writes, and dynamic bitrate
+	 * without TCP statistics needs to time each packet's send, so only
+	 * batch for the plain socket. */
+	bool batch = !stream->new_socket_loop && (!stream->dbr_enabled || stream->dbr_tcp_stats);
+
 	os_set_thread_name("rtmp-stream: send_thread");
 
 #ifdef _WIN32
@@ -661,11 +802,19 @@ static void *send_thread(void *data)
 			}
 		}
 
-		if (stream->dbr_enabled) {
+		if (stream->dbr_enabled && !stream->dbr_tcp_stats) {
 			dbr_frame.send_beg = os_gettime_ns();
 			dbr_frame.size = packet.size;
 		}
 
+		size_t packet_size = packet.size;
+
+		/* sending releases the packet, keep what latency tracing needs */
+		struct encoder_packet written = packet;
+
+		if (batch)
+			RTMP_BeginBatch(&stream->rtmp);
+
 		int sent;
 		if (packet.type == OBS_ENCODER_VIDEO &&
 		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
@@ -682,7 +831,31 @@ static void *send_thread(void *data)
 			break;
 		}
 
-		if (stream->dbr_enabled) {
+		if (!stream->sent_first_packet) {
+			stream->sent_first_packet = true;
+			info("Time to first packet: %" PRIu64 " ms%s",
+			     (uint64_t)((os_gettime_ns() - stream->connect_start_ns) / MSEC_TO_NSEC),
+			     obs_output_reconnecting(stream->output) ? " (reconnect)" : "");
+		}
+
+		bool queue_empty = !has_queued_packets(stream);
+		update_send_rate(stream, packet_size, queue_empty);
+
+		/* every queued packet has its own semaphore post, so the loop
+		 * goes on without waiting until the queue has been drained */
+		if (batch && (stream->rtmp.m_sendBufLen >= MAX_SEND_BATCH_SIZE || queue_empty)) {
+			if (!RTMP_FlushBatch(&stream->rtmp)) {
+				os_atomic_set_bool(&stream->disconnected, true);
+				break;
+			}
+		}
+
+		obs_output_packet_written(stream->output, &written);
+
+		if (stream->dbr_tcp_stats) {
+			dbr_sample_tcp_stats(stream);
+
+		} else if (stream->dbr_enabled) {
 			dbr_frame.send_end = os_gettime_ns();
 
 			pthread_mutex_lock(&stream->dbr_mutex);
@@ -691,6 +864,12 @@ static void *send_thread(void *data)
 		}
 	}
 
+	/* send out whatever is left, footers are then written directly */
+	if (batch)
+		RTMP_FlushBatch(&stream->rtmp);
+
+	log_dropped_frames(stream);
+
 	bool encode_error = os_atomic_load_bool(&stream->encode_error);
 
 	if (disconnected(stream)) {
@@ -709,10 +888,17 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_socket_thread(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
+#ifndef _WIN32
+		socket_wake_free(stream);
+#endif
+
+		info("Socket loop: peak buffer %zu / %zu bytes, %" PRIu64 " send stalls (%" PRIu64 " ms)",
+		     stream->write_buf_peak, stream->write_buf_size, stream->send_stalls,
+		     (uint64_t)(stream->send_stall_ns / MSEC_TO_NSEC));
 	}
 
 	set_output_error(stream);
@@ -1053,12 +1239,22 @@ static int init_send(struct rtmp_stream *stream)
 
 		stream->write_buf_size = ideal_buffer_size;
 		stream->write_buf = bmalloc(ideal_buffer_size);
+		stream->write_buf_peak = 0;
+		stream->send_stalls = 0;
+		stream->send_stall_ns = 0;
+		stream->send_stall_start_ns = 0;
 
-#ifndef _WIN32
-		warn("New socket loop not supported on this platform");
-		return OBS_OUTPUT_ERROR;
-#else
+#ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_windows, stream);
+#else
+		if (!socket_wake_init(stream)) {
+			RTMP_Close(&stream->rtmp);
+			warn("Failed to create socket thread wakeup pipe");
+			return OBS_OUTPUT_ERROR;
+		}
+
+		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_posix, stream);
+#endif
 
 		if (ret != 0) {
 			RTMP_Close(&stream->rtmp);
@@ -1070,7 +1266,6 @@ static int init_send(struct rtmp_stream *stream)
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
 		stream->rtmp.m_customSendParam = stream;
-#endif
 	}
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1158,6 +1353,58 @@ static void win32_log_interface_type(struct rtmp_stream *stream)
 }
 #endif
 
+/* Races the service's alternative ingests against its server URL and
+ * connects to whichever answers first, remembering it for reconnects. */
+static void select_ingest(struct rtmp_stream *stream)
+{
+	struct sockaddr_storage bind_addr = {0};
+	int bind_addr_len = 0;
+	uint64_t now = os_gettime_ns();
+	uint64_t connect_time_ns = 0;
+	struct dstr list = {0};
+	size_t count = 0;
+	char **urls;
+	int fastest;
+
+	if (dstr_is_empty(&stream->ingest_alternatives))
+		return;
+
+	if (dstr_cmp(&stream->ingest_cache_url, stream->path.array) == 0 &&
+	    now - stream->ingest_cache_ts < INGEST_CACHE_TIMEOUT_NS) {
+		info("Using previously selected ingest %s", stream->ingest_cache_choice.array);
+		dstr_copy_dstr(&stream->path, &stream->ingest_cache_choice);
+		return;
+	}
+
+	dstr_printf(&list, "%s\n%s", stream->path.array, stream->ingest_alternatives.array);
+	urls = strlist_split(list.array, '\n', false);
+	dstr_free(&list);
+
+	while (urls[count])
+		count++;
+
+	if (!dstr_is_empty(&stream->bind_ip) && dstr_cmp(&stream->bind_ip, "default") != 0)
+		netif_str_to_addr(&bind_addr, &bind_addr_len, stream->bind_ip.array);
+	if (bind_addr_len == 0)
+		bind_addr_len = stream->addrlen_hint;
+
+	fastest = ingest_race(urls, count, (socklen_t)bind_addr_len, &bind_addr, &connect_time_ns);
+
+	if (fastest != -1) {
+		info("Selected ingest %s out of %zu (TCP connect %" PRIu64 " ms)", urls[fastest], count,
+		     (uint64_t)(connect_time_ns / MSEC_TO_NSEC));
+
+		dstr_copy_dstr(&stream->ingest_cache_url, &stream->path);
+		dstr_copy(&stream->path, urls[fastest]);
+		dstr_copy_dstr(&stream->ingest_cache_choice, &stream->path);
+		stream->ingest_cache_ts = now;
+	} else {
+		warn("None of the %zu ingests could be reached", count);
+	}
+
+	strlist_free(urls);
+}
+
 static int try_connect(struct rtmp_stream *stream)
 {
 	if (dstr_is_empty(&stream->path)) {
@@ -1165,6 +1412,8 @@ static int try_connect(struct rtmp_stream *stream)
 		return OBS_OUTPUT_BAD_PATH;
 	}
 
+	select_ingest(stream);
+
 	info("Connecting to RTMP URL %s...", stream->path.array);
 
 	// free any existing RTMP TLS context
@@ -1249,7 +1498,12 @@ static bool init_connect(struct rtmp_stream *stream)
 	os_atomic_set_bool(&stream->encode_error, false);
 	stream->total_bytes_sent = 0;
 	stream->dropped_frames = 0;
-	stream->min_priority = 0;
+	memset(stream->min_priority, 0, sizeof(stream->min_priority));
+	memset(stream->dropped_track_frames, 0, sizeof(stream->dropped_track_frames));
+	stream->send_rate = 0;
+	stream->send_window_start_ns = 0;
+	stream->send_window_bytes = 0;
+	stream->send_window_idle = false;
 	stream->got_first_packet = false;
 
 	settings = obs_output_get_settings(stream->output);
@@ -1257,6 +1511,8 @@ static bool init_connect(struct rtmp_stream *stream)
 	dstr_copy(&stream->key, obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_STREAM_KEY));
 	dstr_copy(&stream->username, obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_USERNAME));
 	dstr_copy(&stream->password, obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_PASSWORD));
+	dstr_copy(&stream->ingest_alternatives,
+		  obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL_ALTERNATIVES));
 	dstr_depad(&stream->path);
 	dstr_depad(&stream->key);
 	drop_b = (int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD);
@@ -1293,6 +1549,15 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
 	stream->dbr_inc_timeout = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
+	stream->dbr_tcp_stats = false;
+	stream->dbr_rtt_us = 0;
+	stream->dbr_min_rtt_us = 0;
+
+	stream->dbr_min_bitrate = (long)obs_data_get_int(settings, OPT_DYN_BITRATE_FLOOR);
+	if (stream->dbr_min_bitrate > stream->dbr_orig_bitrate)
+		stream->dbr_min_bitrate = stream->dbr_orig_bitrate;
+	if (stream->dbr_min_bitrate < MIN_DBR_BITRATE)
+		stream->dbr_min_bitrate = MIN_DBR_BITRATE;
 
 	caps = obs_encoder_get_caps(venc);
 	if ((caps & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
@@ -1333,7 +1598,6 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->addrlen_hint = len;
 	}
 
-#ifdef _WIN32
 	stream->new_socket_loop = obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode = obs_data_get_bool(settings, OPT_LOWLATENCY_ENABLED);
 
@@ -1342,10 +1606,6 @@ static bool init_connect(struct rtmp_stream *stream)
 		warn("Disabling network optimizations, not compatible with RTMPS");
 		stream->new_socket_loop = false;
 	}
-#else
-	stream->new_socket_loop = false;
-	stream->low_latency_mode = false;
-#endif
 
 	obs_data_release(settings);
 	return true;
@@ -1380,6 +1640,9 @@ static void *connect_thread(void *data)
 	ret = try_connect(stream);
 
 	if (ret != OBS_OUTPUT_SUCCESS) {
+		/* race again next time instead of retrying a dead ingest */
+		dstr_free(&stream->ingest_cache_url);
+
 		obs_output_signal_stop(stream->output, ret);
 		info("Connection to %s failed: %d", stream->path.array, ret);
 	}
@@ -1400,6 +1663,9 @@ static bool rtmp_stream_start(void *data)
 	if (!obs_output_initialize_encoders(stream->output, 0))
 		return false;
 
+	stream->connect_start_ns = os_gettime_ns();
+	stream->sent_first_packet = false;
+
 	os_atomic_set_bool(&stream->connecting, true);
 	return pthread_create(&stream->connect_thread, NULL, connect_thread, stream) == 0;
 }
@@ -1407,6 +1673,7 @@ static bool rtmp_stream_start(void *data)
 static inline bool add_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
 {
 	deque_push_back(&stream->packets, packet, sizeof(struct encoder_packet));
+	stream->packets_bytes += packet->size;
 	return true;
 }
 
@@ -1415,31 +1682,26 @@ static inline size_t num_buffered_packets(struct rtmp_stream *stream)
 	return stream->packets.size / sizeof(struct encoder_packet);
 }
 
-static void drop_frames(struct rtmp_stream *stream, const char *name, int highest_priority, bool pframes)
+/* drops the video frames of a track up to and including a priority */
+static int drop_track_frames(struct rtmp_stream *stream, size_t track, int max_priority)
 {
-	UNUSED_PARAMETER(pframes);
-
 	struct deque new_buf = {0};
 	int num_frames_dropped = 0;
 
-#ifdef _DEBUG
-	int start_packets = (int)num_buffered_packets(stream);
-#else
-	UNUSED_PARAMETER(name);
-#endif
-
-	deque_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
+	deque_reserve(&new_buf, stream->packets.size);
 
 	while (stream->packets.size) {
 		struct encoder_packet packet;
 		deque_pop_front(&stream->packets, &packet, sizeof(packet));
 
 		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO || packet.drop_priority >= highest_priority) {
+		if (packet.type == OBS_ENCODER_AUDIO || packet.track_idx != track ||
+		    packet.drop_priority > max_priority || packet.drop_priority >= OBS_NAL_PRIORITY_HIGHEST) {
 			deque_push_back(&new_buf, &packet, sizeof(packet));
 
 		} else {
 			num_frames_dropped++;
+			stream->packets_bytes -= packet.size;
 			obs_encoder_packet_release(&packet);
 		}
 	}
@@ -1447,8 +1709,81 @@ static void drop_frames(struct rtmp_stream *stream, const char *name, int highes
 	deque_free(&stream->packets);
 	stream->packets = new_buf;
 
-	if (stream->min_priority < highest_priority)
-		stream->min_priority = highest_priority;
+	/* later frames may reference the dropped ones, so keep dropping
+	 * until one that doesn't arrives */
+	if (num_frames_dropped && stream->min_priority[track] <= max_priority)
+		stream->min_priority[track] = max_priority + 1;
+
+	stream->dropped_track_frames[track] += num_frames_dropped;
+	return num_frames_dropped;
+}
+
+/* video tracks with frames queued, the most queued data (the highest bitrate
+ * rendition) first */
+static size_t get_drop_order(struct rtmp_stream *stream, size_t *order)
+{
+	size_t track_bytes[MAX_OUTPUT_VIDEO_ENCODERS] = {0};
+	size_t count = num_buffered_packets(stream);
+	size_t num = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		struct encoder_packet *cur = deque_data(&stream->packets, i * sizeof(*cur));
+		if (cur->type == OBS_ENCODER_VIDEO && cur->track_idx < MAX_OUTPUT_VIDEO_ENCODERS)
+			track_bytes[cur->track_idx] += cur->size;
+	}
+
+	for (size_t track = 0; track < MAX_OUTPUT_VIDEO_ENCODERS; track++) {
+		if (!track_bytes[track])
+			continue;
+
+		size_t pos = num++;
+		while (pos > 0 && track_bytes[order[pos - 1]] < track_bytes[track]) {
+			order[pos] = order[pos - 1];
+			pos--;
+		}
+		order[pos] = track;
+	}
+
+	return num;
+}
+
+/* Drops the least important frames first: disposable frames before
+ * referenced ones, and the highest bitrate rendition's before the others,
+ * stopping once the backlog is back under target.  Without a send rate to
+ * size the backlog by, everything below the priority goes. */
+static void drop_frames(struct rtmp_stream *stream, const char *name, int highest_priority, int64_t drop_threshold)
+{
+	long rate = os_atomic_load_long(&stream->send_rate);
+	size_t target = 0;
+	size_t order[MAX_OUTPUT_VIDEO_ENCODERS];
+	size_t num_tracks = get_drop_order(stream, order);
+	int num_frames_dropped = 0;
+
+#ifdef _DEBUG
+	int start_packets = (int)num_buffered_packets(stream);
+#else
+	UNUSED_PARAMETER(name);
+#endif
+
+	if (rate > 0)
+		target = (size_t)(drop_threshold * rate / 1000000 * DROP_TARGET_PERCENT / 100);
+
+	for (int priority = OBS_NAL_PRIORITY_DISPOSABLE; priority < highest_priority; priority++) {
+		for (size_t i = 0; i < num_tracks; i++) {
+			if (stream->packets_bytes <= target)
+				goto done;
+
+			num_frames_dropped += drop_track_frames(stream, order[i], priority);
+		}
+	}
+
+	/* still over, so keep dropping incoming frames below the priority */
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (stream->min_priority[i] < highest_priority)
+			stream->min_priority[i] = highest_priority;
+	}
+
+done:
 	if (!num_frames_dropped)
 		return;
 
@@ -1459,6 +1794,15 @@ static void drop_frames(struct rtmp_stream *stream, const char *name, int highes
 #endif
 }
 
+static inline bool dropping_frames(struct rtmp_stream *stream)
+{
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (stream->min_priority[i] > 0)
+			return true;
+	}
+	return false;
+}
+
 static bool find_first_video_packet(struct rtmp_stream *stream, struct encoder_packet *first)
 {
 	size_t count = stream->packets.size / sizeof(*first);
@@ -1483,9 +1827,13 @@ static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 	if (stream->dbr_est_bitrate && stream->dbr_est_bitrate < stream->dbr_cur_bitrate) {
 		stream->dbr_data_size = 0;
 		deque_pop_front(&stream->dbr_frames, NULL, stream->dbr_frames.size);
-		est_bitrate = stream->dbr_est_bitrate / 100 * 100;
-		if (est_bitrate < 50) {
-			est_bitrate = 50;
+		est_bitrate = stream->dbr_est_bitrate;
+		if (stream->dbr_tcp_stats)
+			est_bitrate = est_bitrate * DBR_TCP_HEADROOM_PERCENT / 100;
+
+		est_bitrate = est_bitrate / 100 * 100;
+		if (est_bitrate < stream->dbr_min_bitrate) {
+			est_bitrate = stream->dbr_min_bitrate;
 		}
 	}
 
@@ -1560,6 +1908,17 @@ static void dbr_inc_bitrate(struct rtmp_stream *stream)
 	}
 }
 
+static bool dbr_rtt_inflated(struct rtmp_stream *stream)
+{
+	bool inflated;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	inflated = stream->dbr_min_rtt_us && stream->dbr_rtt_us > stream->dbr_min_rtt_us * DBR_RTT_INFLATION;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	return inflated;
+}
+
 static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 {
 	struct encoder_packet first;
@@ -1573,7 +1932,12 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 		if (stream->dbr_inc_timeout) {
 			uint64_t t = os_gettime_ns();
 
-			if (t >= stream->dbr_inc_timeout) {
+			if (t >= stream->dbr_inc_timeout && dbr_rtt_inflated(stream)) {
+				stream->dbr_inc_timeout = t + DBR_INC_TIMER;
+				debug("RTT %" PRIu32 " us over minimum %" PRIu32 " us, holding bitrate",
+				      stream->dbr_rtt_us, stream->dbr_min_rtt_us);
+
+			} else if (t >= stream->dbr_inc_timeout) {
 				stream->dbr_inc_timeout = 0;
 				dbr_inc_bitrate(stream);
 				dbr_set_bitrate(stream);
@@ -1594,6 +1958,15 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	 * sent is higher than threshold, drop frames */
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
+	/* the span of queued timestamps doesn't shrink when frames behind the
+	 * first one are dropped, how long it takes to send what is left does */
+	long rate = os_atomic_load_long(&stream->send_rate);
+	if (rate > 0) {
+		int64_t drain_usec = (int64_t)((uint64_t)stream->packets_bytes * 1000000 / rate);
+		if (drain_usec < buffer_duration_usec)
+			buffer_duration_usec = drain_usec;
+	}
+
 	if (!pframes) {
 		stream->congestion = (float)buffer_duration_usec / (float)drop_threshold;
 	}
@@ -1624,7 +1997,7 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 
 	if (buffer_duration_usec > drop_threshold) {
 		debug("buffer_duration_usec: %" PRId64, buffer_duration_usec);
-		drop_frames(stream, name, priority, pframes);
+		drop_frames(stream, name, priority, drop_threshold);
 	}
 }
 
@@ -1635,11 +2008,14 @@ static bool add_video_packet(struct rtmp_stream *stream, struct encoder_packet *
 
 	/* if currently dropping frames, drop packets until it reaches the
 	 * desired priority */
-	if (packet->drop_priority < stream->min_priority) {
+	size_t track = packet->track_idx;
+
+	if (packet->drop_priority < stream->min_priority[track]) {
 		stream->dropped_frames++;
+		stream->dropped_track_frames[track]++;
 		return false;
 	} else {
-		stream->min_priority = 0;
+		stream->min_priority[track] = 0;
 	}
 
 	stream->last_dts_usec = packet->dts_usec;
@@ -1717,10 +2093,9 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
-#ifdef _WIN32
+	obs_data_set_default_int(defaults, OPT_DYN_BITRATE_FLOOR, 0);
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
-#endif
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -1754,10 +2129,8 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
-#ifdef _WIN32
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED, obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED, obs_module_text("RTMPStream.LowLatencyMode"));
-#endif
 
 	return props;
 }
@@ -1781,7 +2154,18 @@ static float rtmp_stream_congestion(void *data)
 	if (stream->new_socket_loop)
 		return (float)stream->write_buf_len / (float)stream->write_buf_size;
 	else
-		return stream->min_priority > 0 ? 1.0f : stream->congestion;
+		return dropping_frames(stream) ? 1.0f : stream->congestion;
+}
+
+static uint64_t rtmp_stream_buffered_bytes(void *data)
+{
+	struct rtmp_stream *stream = data;
+	uint64_t bytes;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	bytes = stream->packets_bytes;
+	pthread_mutex_unlock(&stream->packets_mutex);
+	return bytes;
 }
 
 static int rtmp_stream_connect_time(void *data)
@@ -1816,4 +2200,5 @@ struct obs_output_info rtmp_output_info = {
 	.get_congestion = rtmp_stream_congestion,
 	.get_connect_time_ms = rtmp_stream_connect_time,
 	.get_dropped_frames = rtmp_stream_dropped_frames,
+	.get_buffered_bytes = rtmp_stream_buffered_bytes,
 };
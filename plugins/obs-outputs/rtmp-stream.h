@@ -8,6 +8,8 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "tcp-stats.h"
+#include "ingest-race.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -23,6 +25,7 @@
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define OPT_DYN_BITRATE "dyn_bitrate"
+#define OPT_DYN_BITRATE_FLOOR "dyn_bitrate_floor"
 #define OPT_DROP_THRESHOLD "drop_threshold_ms"
 #define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
@@ -83,16 +86,36 @@ struct rtmp_stream {
 	struct dstr bind_ip;
 	socklen_t addrlen_hint; /* hint IPv4 vs IPv6 */
 
+	/* other ingests of the service, raced against path when connecting,
+	 * the winner is reused by reconnects for a while */
+	struct dstr ingest_alternatives;
+	struct dstr ingest_cache_url;
+	struct dstr ingest_cache_choice;
+	uint64_t ingest_cache_ts;
+
+	/* time from starting to connect until the first packet is sent */
+	uint64_t connect_start_ns;
+	bool sent_first_packet;
+
 	/* frame drop variables */
 	int64_t drop_threshold_usec;
 	int64_t pframe_drop_threshold_usec;
-	int min_priority;
+	int min_priority[MAX_OUTPUT_VIDEO_ENCODERS];
 	float congestion;
 
 	int64_t last_dts_usec;
 
 	uint64_t total_bytes_sent;
 	int dropped_frames;
+	int dropped_track_frames[MAX_OUTPUT_VIDEO_ENCODERS];
+
+	/* bytes waiting in packets, and how fast the send thread gets them out,
+	 * in bytes per second */
+	size_t packets_bytes;
+	volatile long send_rate;
+	uint64_t send_window_start_ns;
+	uint64_t send_window_bytes;
+	bool send_window_idle;
 
 #ifdef TEST_FRAMEDROPS
 	struct deque droptest_info;
@@ -111,8 +134,16 @@ struct rtmp_stream {
 	long dbr_prev_bitrate;
 	long dbr_cur_bitrate;
 	long dbr_inc_bitrate;
+	long dbr_min_bitrate;
 	bool dbr_enabled;
 
+	/* estimating from kernel TCP statistics rather than send timing */
+	bool dbr_tcp_stats;
+	uint64_t dbr_last_sample_ns;
+	uint64_t dbr_last_acked;
+	uint32_t dbr_rtt_us;
+	uint32_t dbr_min_rtt_us;
+
 	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
@@ -131,10 +162,40 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+#ifndef _WIN32
+	int socket_wake_fds[2];
+#endif
+
+	/* socket loop stats */
+	size_t write_buf_peak;
+	uint64_t send_stalls;
+	uint64_t send_stall_ns;
+	uint64_t send_stall_start_ns;
 };
 
+static inline void socket_stall_begin(struct rtmp_stream *stream)
+{
+	if (!stream->send_stall_start_ns) {
+		stream->send_stall_start_ns = os_gettime_ns();
+		stream->send_stalls++;
+	}
+}
+
+static inline void socket_stall_end(struct rtmp_stream *stream)
+{
+	if (stream->send_stall_start_ns) {
+		stream->send_stall_ns += os_gettime_ns() - stream->send_stall_start_ns;
+		stream->send_stall_start_ns = 0;
+	}
+}
+
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#else
+void *socket_thread_posix(void *data);
+bool socket_wake_init(struct rtmp_stream *stream);
+void socket_wake_free(struct rtmp_stream *stream);
+void socket_wake_signal(struct rtmp_stream *stream);
 #endif
 
 /* Adapted from FFmpeg's libavutil/pixfmt.h
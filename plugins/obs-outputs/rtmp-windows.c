@@ -24,8 +24,10 @@ static bool socket_event(struct rtmp_stream *stream, bool *can_write, uint64_t l
 		return false;
 	}
 
-	if (net_events.lNetworkEvents & FD_WRITE)
+	if (net_events.lNetworkEvents & FD_WRITE) {
 		*can_write = true;
+		socket_stall_end(stream);
+	}
 
 	if (net_events.lNetworkEvents & FD_CLOSE) {
 		if (last_send_time) {
@@ -173,6 +175,7 @@ static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write, uin
 
 			if (err_code == WSAEWOULDBLOCK) {
 				*can_write = false;
+				socket_stall_begin(stream);
 				pthread_mutex_unlock(&stream->write_buf_mutex);
 				return RET_BREAK;
 			}
@@ -0,0 +1,63 @@
+#include "tcp-stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <mstcpip.h>
+#elif defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+/* glibc's struct tcp_info lacks the newer fields */
+#include <linux/tcp.h>
+#endif
+
+#if defined(_WIN32) && defined(SIO_TCP_INFO)
+bool tcp_stats_get(tcp_stats_socket_t sock, struct tcp_stats *stats)
+{
+	TCP_INFO_v0 info;
+	DWORD version = 0;
+	DWORD size = 0;
+	uint64_t unacked;
+
+	if (WSAIoctl(sock, SIO_TCP_INFO, &version, sizeof(version), &info, sizeof(info), &size, NULL, NULL) != 0)
+		return false;
+
+	/* no direct counter, derive it from what's been sent */
+	unacked = (uint64_t)info.BytesRetrans + info.BytesInFlight;
+
+	stats->bytes_acked = info.BytesOut > unacked ? info.BytesOut - unacked : 0;
+	stats->rtt_us = info.RttUs;
+	stats->min_rtt_us = info.MinRttUs;
+	return true;
+}
+
+#elif defined(__linux__)
+bool tcp_stats_get(tcp_stats_socket_t sock, struct tcp_stats *stats)
+{
+	struct tcp_info info;
+	socklen_t size = sizeof(info);
+
+	memset(&info, 0, sizeof(info));
+
+	if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &size) != 0)
+		return false;
+
+	/* bytes_acked and min_rtt need 4.6+ */
+	if (size < offsetof(struct tcp_info, tcpi_min_rtt) + sizeof(info.tcpi_min_rtt))
+		return false;
+
+	stats->bytes_acked = info.tcpi_bytes_acked;
+	stats->rtt_us = info.tcpi_rtt;
+	stats->min_rtt_us = info.tcpi_min_rtt;
+	return true;
+}
+
+#else
+bool tcp_stats_get(tcp_stats_socket_t sock, struct tcp_stats *stats)
+{
+	(void)sock;
+	(void)stats;
+	return false;
+}
+#endif
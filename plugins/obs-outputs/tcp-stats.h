@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET tcp_stats_socket_t;
+#else
+typedef int tcp_stats_socket_t;
+#endif
+
+/* Kernel TCP statistics of a connected socket, TCP_INFO on Linux and
+ * SIO_TCP_INFO on Windows. */
+struct tcp_stats {
+	uint64_t bytes_acked;
+	uint32_t rtt_us;
+	uint32_t min_rtt_us;
+};
+
+/* Returns false if the platform or kernel doesn't provide these */
+bool tcp_stats_get(tcp_stats_socket_t sock, struct tcp_stats *stats);
@@ -96,6 +96,8 @@ typedef struct {
 	mfxU16 nWidth;       /* source picture width */
 	mfxU16 nHeight;      /* source picture height */
 	mfxU16 nAsyncDepth;
+	mfxU16 nExtraSurfaces; /* preallocated on top of what the
+				  encoder asks for */
 	mfxU16 nFpsNum;
 	mfxU16 nFpsDen;
 	mfxU16 nTargetBitRate;
@@ -128,6 +130,7 @@ typedef struct {
 	mfxU16 MaxPicAverageLightLevel;
 	bool video_fmt_10bit;
 	bool bRepeatHeaders;
+	bool bHyperEncode; /* split frames between the iGPU and dGPU */
 } qsv_param_t;
 
 enum qsv_cpu_platform {
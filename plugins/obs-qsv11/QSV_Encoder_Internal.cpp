@@ -60,6 +60,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vpl/mfxvideo++.h>
 #include <vpl/mfxdispatcher.h>
 #include <obs-module.h>
+#include <util/platform.h>
 
 #define do_log(level, format, ...) blog(level, "[qsv encoder: '%s'] " format, "msdk_impl", ##__VA_ARGS__)
 
@@ -80,6 +81,13 @@ QSV_Encoder_Internal::QSV_Encoder_Internal(mfxVersion &version, bool useTexAlloc
 	  m_nTaskIdx(0),
 	  m_nFirstSyncTask(0),
 	  m_outBitstream(),
+	  m_nFramesSubmitted(0),
+	  m_nQueueFillTotal(0),
+	  m_nQueueFillMax(0),
+	  m_nSyncWaits(0),
+	  m_nSyncWaitNs(0),
+	  m_bHyperEncode(false),
+	  m_nExtraSurfaces(0),
 	  m_bUseD3D11(false),
 	  m_bUseTexAlloc(useTexAlloc),
 	  m_sessionData(NULL),
@@ -145,6 +153,16 @@ mfxStatus QSV_Encoder_Internal::Open(qsv_param_t *pParams, enum qsv_codec codec)
 
 	InitParams(pParams, codec);
 	sts = m_pmfxENC->Query(&m_mfxEncParams, &m_mfxEncParams);
+#ifdef QSV_HYPER_ENCODE
+	if (sts < MFX_ERR_NONE && m_bHyperEncode) {
+		warn("Hyper Encode is not supported with these settings, using a single adapter");
+		extendedBuffers.pop_back();
+		m_mfxEncParams.ExtParam = extendedBuffers.data();
+		m_mfxEncParams.NumExtParam = (mfxU16)extendedBuffers.size();
+		m_bHyperEncode = false;
+		sts = m_pmfxENC->Query(&m_mfxEncParams, &m_mfxEncParams);
+	}
+#endif
 	MSDK_IGNORE_MFX_STS(sts, MFX_WRN_INCOMPATIBLE_VIDEO_PARAM);
 	MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
@@ -280,6 +298,7 @@ mfxStatus QSV_Encoder_Internal::InitParams(qsv_param_t *pParams, enum qsv_codec
 	}
 
 	m_mfxEncParams.AsyncDepth = pParams->nAsyncDepth;
+	m_nExtraSurfaces = pParams->nExtraSurfaces;
 	m_mfxEncParams.mfx.GopPicSize =
 		(pParams->nKeyIntSec) ? (mfxU16)(pParams->nKeyIntSec * pParams->nFpsNum / (float)pParams->nFpsDen)
 				      : 240;
@@ -448,6 +467,22 @@ mfxStatus QSV_Encoder_Internal::InitParams(qsv_param_t *pParams, enum qsv_codec
 		}
 	}
 
+	// Added after the LowPower check so that a session without Hyper Encode
+	// support does not turn LowPower off.  Open drops it again if needed.
+	m_bHyperEncode = false;
+#ifdef QSV_HYPER_ENCODE
+	if (pParams->bHyperEncode) {
+		memset(&m_ExtHyperModeParam, 0, sizeof(m_ExtHyperModeParam));
+		m_ExtHyperModeParam.Header.BufferId = MFX_EXTBUFF_HYPER_MODE_PARAM;
+		m_ExtHyperModeParam.Header.BufferSz = sizeof(m_ExtHyperModeParam);
+		m_ExtHyperModeParam.Mode = MFX_HYPERMODE_ADAPTIVE;
+		extendedBuffers.push_back((mfxExtBuffer *)&m_ExtHyperModeParam);
+		m_mfxEncParams.ExtParam = extendedBuffers.data();
+		m_mfxEncParams.NumExtParam = (mfxU16)extendedBuffers.size();
+		m_bHyperEncode = true;
+	}
+#endif
+
 	memset(&m_ctrl, 0, sizeof(m_ctrl));
 	memset(&m_roi, 0, sizeof(m_roi));
 
@@ -483,6 +518,8 @@ mfxStatus QSV_Encoder_Internal::AllocateSurfaces()
 
 	// SNB hack. On some SNB, it seems to require more surfaces
 	EncRequest.NumFrameSuggested += m_mfxEncParams.AsyncDepth;
+	EncRequest.NumFrameSuggested += m_nExtraSurfaces;
+	EncRequest.NumFrameMin += m_nExtraSurfaces;
 
 	// Allocate required surfaces
 	if (m_bUseTexAlloc) {
@@ -612,7 +649,14 @@ mfxStatus QSV_Encoder_Internal::InitBitstream()
 	m_outBitstream.DataOffset = 0;
 	m_outBitstream.DataLength = 0;
 
+	m_nFramesSubmitted = 0;
+	m_nQueueFillTotal = 0;
+	m_nQueueFillMax = 0;
+	m_nSyncWaits = 0;
+	m_nSyncWaitNs = 0;
+
 	blog(LOG_INFO, "\tm_nTaskPool:    %d", m_nTaskPool);
+	blog(LOG_INFO, "\thyper encode:   %s", m_bHyperEncode ? "adaptive" : "off");
 
 	return MFX_ERR_NONE;
 }
@@ -715,34 +759,18 @@ mfxStatus QSV_Encoder_Internal::Encode(uint64_t ts, uint8_t *pDataY, uint8_t *pD
 
 	while (MFX_ERR_NOT_FOUND == nTaskIdx || MFX_ERR_NOT_FOUND == nSurfIdx) {
 		// No more free tasks or surfaces, need to sync
-		sts = MFXVideoCORE_SyncOperation(m_session, m_pTaskPool[m_nFirstSyncTask].syncp, 60000);
+		sts = SyncFirstTask(60000, pBS);
 		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
-		mfxU8 *pTemp = m_outBitstream.Data;
-		memcpy(&m_outBitstream, &m_pTaskPool[m_nFirstSyncTask].mfxBS, sizeof(mfxBitstream));
-
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.Data = pTemp;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataLength = 0;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataOffset = 0;
-		m_pTaskPool[m_nFirstSyncTask].syncp = NULL;
-		nTaskIdx = m_nFirstSyncTask;
-		m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
-		*pBS = &m_outBitstream;
-
-#if 0
-		info("MSDK Encode:\n"
-			"\tnew FirstSyncTask: %d\n"
-			"\tTaskIndex:         %d",
-			m_nFirstSyncTask,
-			nTaskIdx);
-#endif
-
+		nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
 		nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
-#if 0
-		info("MSDK Encode:\n"
-			"\tnSurfIdx: %d",
-			nSurfIdx);
-#endif
+	}
+
+	// Hand out a packet that is already done without waiting on it
+	if (!*pBS && m_pTaskPool[m_nFirstSyncTask].syncp) {
+		sts = SyncFirstTask(0, pBS);
+		if (sts < MFX_ERR_NONE)
+			return sts;
 	}
 
 	mfxFrameSurface1 *pSurface = m_pmfxSurfaces[nSurfIdx];
@@ -781,6 +809,7 @@ mfxStatus QSV_Encoder_Internal::Encode(uint64_t ts, uint8_t *pDataY, uint8_t *pD
 			break;
 	}
 
+	UpdateQueueStats();
 	return sts;
 }
 
@@ -794,23 +823,20 @@ mfxStatus QSV_Encoder_Internal::Encode_tex(uint64_t ts, void *tex, uint64_t lock
 
 	while (MFX_ERR_NOT_FOUND == nTaskIdx || MFX_ERR_NOT_FOUND == nSurfIdx) {
 		// No more free tasks or surfaces, need to sync
-		sts = MFXVideoCORE_SyncOperation(m_session, m_pTaskPool[m_nFirstSyncTask].syncp, 60000);
+		sts = SyncFirstTask(60000, pBS);
 		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
-		mfxU8 *pTemp = m_outBitstream.Data;
-		memcpy(&m_outBitstream, &m_pTaskPool[m_nFirstSyncTask].mfxBS, sizeof(mfxBitstream));
-
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.Data = pTemp;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataLength = 0;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataOffset = 0;
-		m_pTaskPool[m_nFirstSyncTask].syncp = NULL;
-		nTaskIdx = m_nFirstSyncTask;
-		m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
-		*pBS = &m_outBitstream;
-
+		nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
 		nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
 	}
 
+	// Hand out a packet that is already done without waiting on it
+	if (!*pBS && m_pTaskPool[m_nFirstSyncTask].syncp) {
+		sts = SyncFirstTask(0, pBS);
+		if (sts < MFX_ERR_NONE)
+			return sts;
+	}
+
 	mfxFrameSurface1 *pSurface = m_pmfxSurfaces[nSurfIdx];
 	//copy to default surface directly
 	pSurface->Data.TimeStamp = ts;
@@ -839,9 +865,73 @@ mfxStatus QSV_Encoder_Internal::Encode_tex(uint64_t ts, void *tex, uint64_t lock
 			break;
 	}
 
+	UpdateQueueStats();
 	return sts;
 }
 
+mfxStatus QSV_Encoder_Internal::SyncFirstTask(mfxU32 nWaitMs, mfxBitstream **pBS)
+{
+	Task *pTask = &m_pTaskPool[m_nFirstSyncTask];
+	mfxStatus sts;
+
+	// A zero wait only polls, and returns MFX_WRN_IN_EXECUTION while the
+	// task is still running.  Only actual waits count as sync waits.
+	if (nWaitMs) {
+		uint64_t start = os_gettime_ns();
+		sts = MFXVideoCORE_SyncOperation(m_session, pTask->syncp, nWaitMs);
+		m_nSyncWaitNs += os_gettime_ns() - start;
+		m_nSyncWaits++;
+	} else {
+		sts = MFXVideoCORE_SyncOperation(m_session, pTask->syncp, 0);
+		if (sts == MFX_WRN_IN_EXECUTION)
+			return MFX_ERR_NONE;
+	}
+
+	MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
+
+	mfxU8 *pTemp = m_outBitstream.Data;
+	memcpy(&m_outBitstream, &pTask->mfxBS, sizeof(mfxBitstream));
+
+	pTask->mfxBS.Data = pTemp;
+	pTask->mfxBS.DataLength = 0;
+	pTask->mfxBS.DataOffset = 0;
+	pTask->syncp = NULL;
+	m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
+	*pBS = &m_outBitstream;
+
+	return sts;
+}
+
+void QSV_Encoder_Internal::UpdateQueueStats()
+{
+	mfxU16 nInFlight = 0;
+
+	for (int i = 0; i < m_nTaskPool; i++) {
+		if (m_pTaskPool[i].syncp)
+			nInFlight++;
+	}
+
+	m_nFramesSubmitted++;
+	m_nQueueFillTotal += nInFlight;
+	if (nInFlight > m_nQueueFillMax)
+		m_nQueueFillMax = nInFlight;
+}
+
+void QSV_Encoder_Internal::LogQueueStats()
+{
+	if (!m_nFramesSubmitted)
+		return;
+
+	info("queue stats:\n"
+	     "\tframes:         %llu\n"
+	     "\tqueue fill:     %.2f avg, %u max of %u\n"
+	     "\tsync waits:     %llu (%.2f%% of frames, %.3f ms avg)",
+	     (unsigned long long)m_nFramesSubmitted, (double)m_nQueueFillTotal / (double)m_nFramesSubmitted,
+	     (unsigned)m_nQueueFillMax, (unsigned)m_nTaskPool, (unsigned long long)m_nSyncWaits,
+	     100.0 * (double)m_nSyncWaits / (double)m_nFramesSubmitted,
+	     m_nSyncWaits ? (double)m_nSyncWaitNs / (double)m_nSyncWaits / 1000000.0 : 0.0);
+}
+
 mfxStatus QSV_Encoder_Internal::Drain()
 {
 	mfxStatus sts = MFX_ERR_NONE;
@@ -861,6 +951,7 @@ mfxStatus QSV_Encoder_Internal::ClearData()
 {
 	mfxStatus sts = MFX_ERR_NONE;
 	sts = Drain();
+	LogQueueStats();
 
 	if (m_pmfxENC) {
 		sts = m_pmfxENC->Close();
@@ -62,6 +62,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <vector>
 
+#if defined(_WIN32) && ((MFX_VERSION_MAJOR >= 2 && MFX_VERSION_MINOR >= 5) || MFX_VERSION_MAJOR > 2)
+#define QSV_HYPER_ENCODE
+#endif
+
 class QSV_Encoder_Internal {
 public:
 	QSV_Encoder_Internal(mfxVersion &version, bool useTexAlloc);
@@ -91,6 +95,9 @@ protected:
 	mfxStatus LoadP010(mfxFrameSurface1 *pSurface, uint8_t *pDataY, uint8_t *pDataUV, uint32_t strideY,
 			   uint32_t strideUV);
 	mfxStatus Drain();
+	mfxStatus SyncFirstTask(mfxU32 nWaitMs, mfxBitstream **pBS);
+	void UpdateQueueStats();
+	void LogQueueStats();
 	int GetFreeTaskIndex(Task *pTaskPool, mfxU16 nPoolSize);
 
 private:
@@ -123,11 +130,23 @@ private:
 	mfxExtChromaLocInfo m_ExtChromaLocInfo{};
 	mfxExtMasteringDisplayColourVolume m_ExtMasteringDisplayColourVolume{};
 	mfxExtContentLightLevelInfo m_ExtContentLightLevelInfo{};
+#ifdef QSV_HYPER_ENCODE
+	mfxExtHyperModeParam m_ExtHyperModeParam{};
+#endif
+	bool m_bHyperEncode;
+	mfxU16 m_nExtraSurfaces;
 	mfxU16 m_nTaskPool;
 	Task *m_pTaskPool;
 	int m_nTaskIdx;
 	int m_nFirstSyncTask;
 	mfxBitstream m_outBitstream;
+
+	/* queue statistics, logged when the encoder closes */
+	mfxU64 m_nFramesSubmitted;
+	mfxU64 m_nQueueFillTotal;
+	mfxU16 m_nQueueFillMax;
+	mfxU64 m_nSyncWaits;
+	mfxU64 m_nSyncWaitNs;
 	bool m_bUseD3D11;
 	bool m_bUseTexAlloc;
 	static mfxU16 g_numEncodersOpen;
@@ -178,6 +178,9 @@ static void obs_qsv_defaults(obs_data_t *settings, int ver, enum qsv_codec codec
 
 	obs_data_set_default_int(settings, "keyint_sec", 0);
 	obs_data_set_default_string(settings, "latency", "normal");
+	obs_data_set_default_int(settings, "async_depth", 0);
+	obs_data_set_default_int(settings, "extra_surfaces", 0);
+	obs_data_set_default_bool(settings, "hyper_encode", false);
 	obs_data_set_default_int(settings, "bframes", 3);
 	obs_data_set_default_bool(settings, "repeat_headers", false);
 }
@@ -228,6 +231,9 @@ static inline void add_translated_strings(obs_property_t *list, const char *cons
 #define TEXT_ICQ_QUALITY obs_module_text("ICQQuality")
 #define TEXT_KEYINT_SEC obs_module_text("KeyframeIntervalSec")
 #define TEXT_BFRAMES obs_module_text("BFrames")
+#define TEXT_ASYNC_DEPTH obs_module_text("AsyncDepth")
+#define TEXT_EXTRA_SURFACES obs_module_text("ExtraSurfaces")
+#define TEXT_HYPER_ENCODE obs_module_text("HyperEncode")
 
 static bool update_latency(obs_data_t *settings)
 {
@@ -421,6 +427,19 @@ static obs_properties_t *obs_qsv_props(enum qsv_codec codec, void *unused, int v
 
 	obs_properties_add_int(props, "bframes", TEXT_BFRAMES, 0, 3, 1);
 
+	prop = obs_properties_add_int(props, "async_depth", TEXT_ASYNC_DEPTH, 0, 16, 1);
+	obs_property_set_long_description(prop, obs_module_text("AsyncDepth.ToolTip"));
+
+	prop = obs_properties_add_int(props, "extra_surfaces", TEXT_EXTRA_SURFACES, 0, 16, 1);
+	obs_property_set_long_description(prop, obs_module_text("ExtraSurfaces.ToolTip"));
+
+#ifdef _WIN32
+	if (ver > 1) {
+		prop = obs_properties_add_bool(props, "hyper_encode", TEXT_HYPER_ENCODE);
+		obs_property_set_long_description(prop, obs_module_text("HyperEncode.ToolTip"));
+	}
+#endif
+
 	return props;
 }
 
@@ -468,6 +487,9 @@ static void update_params(struct obs_qsv *obsqsv, obs_data_t *settings)
 	int ver = (int)obs_data_get_int(settings, "__ver");
 	int icq_quality = (int)obs_data_get_int(settings, "icq_quality");
 	int keyint_sec = (int)obs_data_get_int(settings, "keyint_sec");
+	int async_depth = (int)obs_data_get_int(settings, "async_depth");
+	int extra_surfaces = (int)obs_data_get_int(settings, "extra_surfaces");
+	bool hyper_encode = obs_data_get_bool(settings, "hyper_encode");
 	bool cbr_override = obs_data_get_bool(settings, "cbr");
 	int bFrames = (int)obs_data_get_int(settings, "bframes");
 	bool repeat_headers = obs_data_get_bool(settings, "repeat_headers");
@@ -620,6 +642,12 @@ static void update_params(struct obs_qsv *obsqsv, obs_data_t *settings)
 			obsqsv->params.nLADEPTH = 60;
 	}
 
+	/* 0 keeps the depth the latency mode picked */
+	if (async_depth > 0)
+		obsqsv->params.nAsyncDepth = (mfxU16)async_depth;
+	obsqsv->params.nExtraSurfaces = (mfxU16)extra_surfaces;
+	obsqsv->params.bHyperEncode = ver > 1 && hyper_encode;
+
 	if (obsqsv->params.nLADEPTH > 0) {
 		if (obsqsv->params.nLADEPTH > 100)
 			obsqsv->params.nLADEPTH = 100;
@@ -667,6 +695,12 @@ static void update_params(struct obs_qsv *obsqsv, obs_data_t *settings)
 	if (obsqsv->params.nLADEPTH)
 		blog(LOG_INFO, "\tLookahead Depth:%d", (int)obsqsv->params.nLADEPTH);
 
+	blog(LOG_INFO,
+	     "\tasync_depth:    %d\n"
+	     "\textra_surfaces: %d\n"
+	     "\thyper_encode:   %s",
+	     (int)obsqsv->params.nAsyncDepth, extra_surfaces, obsqsv->params.bHyperEncode ? "on" : "off");
+
 	if (obsqsv->params.nRateControl == MFX_RATECONTROL_CQP)
 		blog(LOG_INFO,
 		     "\tqpi:            %d\n"
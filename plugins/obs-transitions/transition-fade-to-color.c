@@ -135,6 +135,12 @@ static void fade_to_color_video_render(void *data, gs_effect_t *effect)
 	const bool previous = gs_set_linear_srgb(true);
 
 	struct fade_to_color_info *fade_to_color = data;
+
+	/* only one side is ever blended with the color */
+	const float t = obs_transition_get_time(fade_to_color->source);
+	obs_transition_hide_source(fade_to_color->source, (t < fade_to_color->switch_point) ? OBS_TRANSITION_SOURCE_B
+											  : OBS_TRANSITION_SOURCE_A);
+
 	obs_transition_video_render(fade_to_color->source, fade_to_color_callback);
 
 	gs_set_linear_srgb(previous);
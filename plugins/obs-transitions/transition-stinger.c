@@ -70,12 +70,14 @@ static void stinger_update(void *data, obs_data_t *settings)
 	const char *path = obs_data_get_string(settings, "path");
 	bool hw_decode = obs_data_get_bool(settings, "hw_decode");
 	bool preload = obs_data_get_bool(settings, "preload");
+	int preload_limit_mb = (int)obs_data_get_int(settings, "preload_limit_mb");
 
 	obs_data_t *media_settings = obs_data_create();
 	obs_data_set_string(media_settings, "local_file", path);
 	obs_data_set_bool(media_settings, "hw_decode", hw_decode);
 	obs_data_set_bool(media_settings, "looping", false);
 	obs_data_set_bool(media_settings, "full_decode", preload);
+	obs_data_set_int(media_settings, "full_decode_limit_mb", preload_limit_mb);
 	obs_data_set_bool(media_settings, "is_stinger", true);
 	obs_data_set_bool(media_settings, "is_track_matte", s->track_matte_enabled);
 
@@ -212,6 +214,7 @@ static void stinger_destroy(void *data)
 static void stinger_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "hw_decode", true);
+	obs_data_set_default_int(settings, "preload_limit_mb", 2048);
 }
 
 static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b, float t, uint32_t cx, uint32_t cy)
@@ -609,6 +612,16 @@ static void stinger_enum_all_sources(void *data, obs_source_enum_proc_t enum_cal
 
 #define FILE_FILTER " (*.mp4 *.ts *.mov *.wmv *.flv *.mkv *.avi *.gif *.webm);;"
 
+static bool preload_modified(obs_properties_t *ppts, obs_property_t *p, obs_data_t *s)
+{
+	bool preload = obs_data_get_bool(s, "preload");
+
+	obs_property_set_visible(obs_properties_get(ppts, "preload_limit_mb"), preload);
+
+	UNUSED_PARAMETER(p);
+	return true;
+}
+
 static bool transition_point_type_modified(obs_properties_t *ppts, obs_property_t *p, obs_data_t *s)
 {
 	int64_t type = obs_data_get_int(s, "tp_type");
@@ -679,6 +692,10 @@ static obs_properties_t *stinger_properties(void *data)
 	obs_properties_add_bool(ppts, "hw_decode", obs_module_text("HardwareDecode"));
 	p = obs_properties_add_bool(ppts, "preload", obs_module_text("PreloadVideoToRam"));
 	obs_property_set_long_description(p, obs_module_text("PreloadVideoToRam.Description"));
+	obs_property_set_modified_callback(p, preload_modified);
+	p = obs_properties_add_int(ppts, "preload_limit_mb", obs_module_text("PreloadLimit"), 64, 16384, 64);
+	obs_property_int_set_suffix(p, " MB");
+	obs_property_set_long_description(p, obs_module_text("PreloadLimit.Description"));
 
 	obs_properties_add_int(ppts, "transition_point", obs_module_text("TransitionPoint"), 0, 120000, 1);
 
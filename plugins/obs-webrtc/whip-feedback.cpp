@@ -0,0 +1,122 @@
+#include "whip-feedback.h"
+
+#include <cstring>
+
+/* RTCP packet types and feedback formats (RFC 3550, RFC 4585) */
+static const uint8_t RTCP_SR = 200;
+static const uint8_t RTCP_RR = 201;
+static const uint8_t RTCP_RTPFB = 205;
+static const uint8_t RTCP_PSFB = 206;
+
+static const uint8_t RTPFB_NACK = 1;
+static const uint8_t PSFB_APP = 15;
+
+static const size_t RTCP_HEADER_SIZE = 4;
+static const size_t REPORT_BLOCK_SIZE = 24;
+
+static inline uint32_t read_u32(const uint8_t *data)
+{
+	return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | (uint32_t)data[3];
+}
+
+static inline uint16_t read_u16(const uint8_t *data)
+{
+	return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+WHIPFeedbackHandler::WHIPFeedbackHandler(uint32_t ssrc)
+	: ssrc(ssrc),
+	  report_count(0),
+	  fraction_lost(0),
+	  remb_bitrate(0),
+	  nack_count(0),
+	  nacked_packets(0)
+{
+}
+
+void WHIPFeedbackHandler::ParseReportBlocks(const uint8_t *data, size_t size, int count)
+{
+	for (int i = 0; i < count && size >= REPORT_BLOCK_SIZE; i++) {
+		if (read_u32(data) == ssrc) {
+			fraction_lost = data[4];
+			report_count++;
+		}
+
+		data += REPORT_BLOCK_SIZE;
+		size -= REPORT_BLOCK_SIZE;
+	}
+}
+
+/*
+ * draft-alvestrand-rmcat-remb: sender SSRC, media SSRC (0), "REMB",
+ * number of SSRCs, and the bitrate as a 6 bit exponent with an 18 bit
+ * mantissa
+ */
+void WHIPFeedbackHandler::ParseRemb(const uint8_t *data, size_t size)
+{
+	if (size < 16 || memcmp(data + 8, "REMB", 4) != 0)
+		return;
+
+	uint8_t exp = data[13] >> 2;
+	uint32_t mantissa = (uint32_t)(data[13] & 0x03) << 16 | (uint32_t)read_u16(data + 14);
+
+	remb_bitrate = exp > 46 ? UINT64_MAX : (uint64_t)mantissa << exp;
+}
+
+/* Generic NACK: a packet ID and a bitmask of the 16 packets after it */
+void WHIPFeedbackHandler::ParseNack(const uint8_t *data, size_t size)
+{
+	if (size < 8 || read_u32(data + 4) != ssrc)
+		return;
+
+	data += 8;
+	size -= 8;
+
+	uint64_t packets = 0;
+	for (; size >= 4; data += 4, size -= 4) {
+		uint16_t blp = read_u16(data + 2);
+
+		packets++;
+		for (; blp; blp &= blp - 1)
+			packets++;
+	}
+
+	nack_count++;
+	nacked_packets += packets;
+}
+
+void WHIPFeedbackHandler::incoming(rtc::message_vector &messages, const rtc::message_callback &)
+{
+	for (const auto &message : messages) {
+		if (message->type != rtc::Message::Control)
+			continue;
+
+		auto data = reinterpret_cast<const uint8_t *>(message->data());
+		size_t size = message->size();
+
+		// Compound packets, one RTCP packet after the other
+		while (size >= RTCP_HEADER_SIZE) {
+			int count = data[0] & 0x1f;
+			uint8_t type = data[1];
+			size_t length = ((size_t)read_u16(data + 2) + 1) * 4;
+
+			if ((data[0] >> 6) != 2 || length > size)
+				break;
+
+			const uint8_t *body = data + RTCP_HEADER_SIZE;
+			size_t body_size = length - RTCP_HEADER_SIZE;
+
+			if (type == RTCP_RR && body_size >= 4)
+				ParseReportBlocks(body + 4, body_size - 4, count);
+			else if (type == RTCP_SR && body_size >= 24)
+				ParseReportBlocks(body + 24, body_size - 24, count);
+			else if (type == RTCP_PSFB && count == PSFB_APP)
+				ParseRemb(body, body_size);
+			else if (type == RTCP_RTPFB && count == RTPFB_NACK)
+				ParseNack(body, body_size);
+
+			data += length;
+			size -= length;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <rtc/rtc.hpp>
+
+/*
+ * Picks the feedback for a track out of the RTCP coming back from the
+ * receiver: the packet loss of its receiver reports, REMB bandwidth
+ * estimates, and NACKs. Nothing is taken out of the chain, the other
+ * handlers (e.g. the NACK responder) still get everything.
+ */
+class WHIPFeedbackHandler : public rtc::MediaHandler {
+public:
+	explicit WHIPFeedbackHandler(uint32_t ssrc);
+
+	void incoming(rtc::message_vector &messages, const rtc::message_callback &send) override;
+
+	// Number of receiver reports so far, and the fraction (out of 256)
+	// of packets lost of the last
+	inline uint32_t GetReportCount() { return report_count; }
+	inline uint8_t GetFractionLost() { return fraction_lost; }
+
+	// Latest REMB estimate in bits per second, 0 if there was none
+	inline uint64_t GetRembBitrate() { return remb_bitrate; }
+
+	inline uint64_t GetNackCount() { return nack_count; }
+	inline uint64_t GetNackedPackets() { return nacked_packets; }
+
+private:
+	void ParseReportBlocks(const uint8_t *data, size_t size, int count);
+	void ParseRemb(const uint8_t *data, size_t size);
+	void ParseNack(const uint8_t *data, size_t size);
+
+	uint32_t ssrc;
+
+	std::atomic<uint32_t> report_count;
+	std::atomic<uint8_t> fraction_lost;
+	std::atomic<uint64_t> remb_bitrate;
+	std::atomic<uint64_t> nack_count;
+	std::atomic<uint64_t> nacked_packets;
+};
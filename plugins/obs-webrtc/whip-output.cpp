@@ -3,6 +3,9 @@
 
 #include <obs.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+
 /*
  * Sets the maximum size for a video fragment. Effective range is
  * 576-1470, with a lower value equating to more packets created,
@@ -23,9 +26,18 @@ const uint8_t audio_payload_type = 111;
 const char *video_mid = "1";
 const uint8_t video_payload_type = 96;
 
+// RTP header extensions identifying simulcast layers
+const int video_mid_ext_id = 1;
+const int video_rid_ext_id = 2;
+const char *mid_ext_uri = "urn:ietf:params:rtp-hdrext:sdes:mid";
+const char *rid_ext_uri = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+
 // ~3 seconds of 8.5 Megabit video
 const int video_nack_buffer_size = 4000;
 
+// Dynamic bitrate never goes below this, in kbps
+const int min_dbr_bitrate = 128;
+
 WHIPOutput::WHIPOutput(obs_data_t *, obs_output_t *output)
 	: output(output),
 	  endpoint_url(),
@@ -38,12 +50,27 @@ WHIPOutput::WHIPOutput(obs_data_t *, obs_output_t *output)
 	  peer_connection(nullptr),
 	  audio_track(nullptr),
 	  video_track(nullptr),
+	  video_feedback(nullptr),
+	  dbr_enabled(false),
+	  dbr_orig_bitrate(0),
+	  dbr_min_bitrate(0),
+	  dbr_audio_bitrate(0),
+	  dbr_cur_bitrate(0),
+	  dbr_loss_bitrate(0.0),
+	  dbr_last_report(0),
 	  total_bytes_sent(0),
 	  connect_time_ms(0),
 	  start_time_ns(0),
-	  last_audio_timestamp(0),
-	  last_video_timestamp(0)
+	  last_audio_timestamp(0)
 {
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_feedback_stats(out int bitrate, out int remb_bitrate, out float packet_loss, "
+			 "out int nack_count, out int nacked_packets, out int nack_buffer_size)",
+			 [](void *priv_data, calldata_t *cd) {
+				 static_cast<WHIPOutput *>(priv_data)->GetFeedbackStats(cd);
+			 },
+			 this);
 }
 
 WHIPOutput::~WHIPOutput()
@@ -93,9 +120,21 @@ void WHIPOutput::Data(struct encoder_packet *packet)
 		Send(packet->data, packet->size, duration, audio_track, audio_sr_reporter);
 		last_audio_timestamp = packet->dts_usec;
 	} else if (video_track && packet->type == OBS_ENCODER_VIDEO) {
-		int64_t duration = packet->dts_usec - last_video_timestamp;
-		Send(packet->data, packet->size, duration, video_track, video_sr_reporter);
-		last_video_timestamp = packet->dts_usec;
+		if (packet->track_idx >= video_layers.size())
+			return;
+
+		VideoLayer &layer = video_layers[packet->track_idx];
+		int64_t duration = packet->dts_usec - layer.last_timestamp;
+
+		auto simulcast = video_simulcast;
+		if (simulcast)
+			simulcast->SetLayer(packet->track_idx);
+
+		Send(packet->data, packet->size, duration, video_track, layer.sr_reporter);
+		layer.last_timestamp = packet->dts_usec;
+
+		if (dbr_enabled)
+			UpdateBitrate();
 	}
 }
 
@@ -134,55 +173,241 @@ void WHIPOutput::ConfigureVideoTrack(std::string media_stream_id, std::string cn
 	}
 
 	auto media_stream_track_id = std::string(media_stream_id + "-video");
-	std::shared_ptr<rtc::RtpPacketizer> packetizer;
-
-	// More predictable SSRC values between audio and video
-	uint32_t ssrc = base_ssrc + 1;
-
-	rtc::Description::Video video_description(video_mid, rtc::Description::Direction::SendOnly);
-	video_description.addSSRC(ssrc, cname, media_stream_id, media_stream_track_id);
-
-	auto rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(ssrc, cname, video_payload_type,
-									rtc::H264RtpPacketizer::defaultClockRate);
 
 	const obs_encoder_t *encoder = obs_output_get_video_encoder2(output, 0);
 	if (!encoder)
 		return;
 
-	OBSDataAutoRelease settings = obs_encoder_get_settings(encoder);
-	auto video_bitrate = (int)obs_data_get_int(settings, "bitrate");
+	rtc::Description::Video video_description(video_mid, rtc::Description::Direction::SendOnly);
 
 	const char *codec = obs_encoder_get_codec(encoder);
 	if (strcmp("h264", codec) == 0) {
 		video_description.addH264Codec(video_payload_type);
-		packetizer = std::make_shared<rtc::H264RtpPacketizer>(rtc::H264RtpPacketizer::Separator::StartSequence,
-								      rtp_config, MAX_VIDEO_FRAGMENT_SIZE);
 #ifdef ENABLE_HEVC
 	} else if (strcmp("hevc", codec) == 0) {
 		video_description.addH265Codec(video_payload_type);
-		packetizer = std::make_shared<rtc::H265RtpPacketizer>(rtc::H265RtpPacketizer::Separator::StartSequence,
-								      rtp_config, MAX_VIDEO_FRAGMENT_SIZE);
 #endif
 	} else if (strcmp("av1", codec) == 0) {
 		video_description.addAV1Codec(video_payload_type);
-		packetizer = std::make_shared<rtc::AV1RtpPacketizer>(rtc::AV1RtpPacketizer::Packetization::TemporalUnit,
-								     rtp_config, MAX_VIDEO_FRAGMENT_SIZE);
 	} else {
 		do_log(LOG_ERROR, "Video codec not supported: %s", codec);
 		return;
 	}
 
-	video_sr_reporter = std::make_shared<rtc::RtcpSrReporter>(rtp_config);
-	packetizer->addToChain(video_sr_reporter);
-	packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>(video_nack_buffer_size));
+	/*
+	 * Each rendition of the encoder group is a simulcast layer, with its
+	 * own SSRC and RID. Renditions come from the same group, so they share
+	 * the codec and their keyframes line up.
+	 */
+	size_t layer_count = 1;
+#ifdef WHIP_SIMULCAST
+	while (layer_count < MAX_OUTPUT_VIDEO_ENCODERS && obs_output_get_video_encoder2(output, layer_count))
+		layer_count++;
+
+	if (layer_count > 1) {
+		video_description.addExtMap(rtc::Description::Entry::ExtMap(video_mid_ext_id, mid_ext_uri));
+		video_description.addExtMap(rtc::Description::Entry::ExtMap(video_rid_ext_id, rid_ext_uri));
+
+		for (size_t i = 0; i < layer_count; i++)
+			video_description.addRid(std::to_string(i));
+	}
+#endif
+
+	video_layers.clear();
+
+	for (size_t i = 0; i < layer_count; i++) {
+		obs_encoder_t *layer_encoder = obs_output_get_video_encoder2(output, i);
+
+		if (strcmp(obs_encoder_get_codec(layer_encoder), codec) != 0) {
+			do_log(LOG_ERROR, "Video codec of rendition %zu doesn't match: %s", i,
+			       obs_encoder_get_codec(layer_encoder));
+			return;
+		}
+
+		// More predictable SSRC values between audio and video
+		uint32_t ssrc = base_ssrc + 1 + (uint32_t)i;
+		video_description.addSSRC(ssrc, cname, media_stream_id, media_stream_track_id);
+
+		auto rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(
+			ssrc, cname, video_payload_type, rtc::H264RtpPacketizer::defaultClockRate);
+
+#ifdef WHIP_SIMULCAST
+		if (layer_count > 1) {
+			rtp_config->mid = video_mid;
+			rtp_config->midId = video_mid_ext_id;
+			rtp_config->rid = std::to_string(i);
+			rtp_config->ridId = video_rid_ext_id;
+		}
+#endif
+
+		VideoLayer layer;
+		layer.packetizer = CreateVideoPacketizer(codec, rtp_config);
+		layer.sr_reporter = std::make_shared<rtc::RtcpSrReporter>(rtp_config);
+		layer.last_timestamp = 0;
+
+		OBSDataAutoRelease settings = obs_encoder_get_settings(layer_encoder);
+		auto video_bitrate = (int)obs_data_get_int(settings, "bitrate");
+
+		layer.packetizer->addToChain(layer.sr_reporter);
+		layer.packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>(video_nack_buffer_size));
+
+		// Receiver feedback drives the bitrate of a single rendition only
+		if (layer_count == 1) {
+			video_feedback = std::make_shared<WHIPFeedbackHandler>(ssrc);
+			layer.packetizer->addToChain(video_feedback);
+			InitDynamicBitrate(layer_encoder, video_bitrate);
+		}
+
+		if (video_bitrate != 0) {
+			layer.packetizer->addToChain(std::make_shared<rtc::PacingHandler>(
+				static_cast<double>(video_bitrate * 10000), std::chrono::milliseconds(5)));
+		}
 
-	if (video_bitrate != 0) {
-		packetizer->addToChain(std::make_shared<rtc::PacingHandler>(static_cast<double>(video_bitrate * 10000),
-									    std::chrono::milliseconds(5)));
+		video_layers.push_back(layer);
 	}
 
 	video_track = peer_connection->addTrack(video_description);
-	video_track->setMediaHandler(packetizer);
+
+	if (layer_count > 1) {
+		video_simulcast = std::make_shared<WHIPSimulcastHandler>();
+		for (auto &layer : video_layers)
+			video_simulcast->AddLayer(layer.packetizer);
+
+		video_track->setMediaHandler(video_simulcast);
+		do_log(LOG_INFO, "Sending %zu simulcast layers", layer_count);
+	} else {
+		video_simulcast = nullptr;
+		video_track->setMediaHandler(video_layers[0].packetizer);
+	}
+}
+
+std::shared_ptr<rtc::RtpPacketizer>
+WHIPOutput::CreateVideoPacketizer(const char *codec, std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config)
+{
+#ifdef ENABLE_HEVC
+	if (strcmp("hevc", codec) == 0)
+		return std::make_shared<rtc::H265RtpPacketizer>(rtc::H265RtpPacketizer::Separator::StartSequence,
+								rtp_config, MAX_VIDEO_FRAGMENT_SIZE);
+#endif
+	if (strcmp("av1", codec) == 0)
+		return std::make_shared<rtc::AV1RtpPacketizer>(rtc::AV1RtpPacketizer::Packetization::TemporalUnit,
+							       rtp_config, MAX_VIDEO_FRAGMENT_SIZE);
+
+	return std::make_shared<rtc::H264RtpPacketizer>(rtc::H264RtpPacketizer::Separator::StartSequence, rtp_config,
+							MAX_VIDEO_FRAGMENT_SIZE);
+}
+
+void WHIPOutput::InitDynamicBitrate(obs_encoder_t *encoder, int video_bitrate)
+{
+	OBSDataAutoRelease settings = obs_output_get_settings(output);
+
+	dbr_enabled = obs_data_get_bool(settings, "dyn_bitrate") && video_bitrate > 0;
+	dbr_orig_bitrate = video_bitrate;
+	dbr_cur_bitrate = video_bitrate;
+	dbr_loss_bitrate = video_bitrate;
+	dbr_last_report = 0;
+
+	if (dbr_enabled && (obs_encoder_get_caps(encoder) & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
+		do_log(LOG_INFO, "Dynamic bitrate disabled. "
+				 "The encoder does not support on-the-fly bitrate reconfiguration.");
+		dbr_enabled = false;
+	}
+
+	if (!dbr_enabled)
+		return;
+
+	dbr_min_bitrate = (int)obs_data_get_int(settings, "dyn_bitrate_floor");
+	if (dbr_min_bitrate <= 0)
+		dbr_min_bitrate = video_bitrate / 10;
+	if (dbr_min_bitrate < min_dbr_bitrate)
+		dbr_min_bitrate = min_dbr_bitrate;
+	if (dbr_min_bitrate > video_bitrate)
+		dbr_min_bitrate = video_bitrate;
+
+	dbr_audio_bitrate = 0;
+	obs_encoder_t *audio_encoder = obs_output_get_audio_encoder(output, 0);
+	if (audio_encoder) {
+		OBSDataAutoRelease audio_settings = obs_encoder_get_settings(audio_encoder);
+		dbr_audio_bitrate = (int)obs_data_get_int(audio_settings, "bitrate");
+	}
+
+	do_log(LOG_INFO, "Dynamic bitrate enabled, between %d and %d kbps", dbr_min_bitrate, dbr_orig_bitrate);
+}
+
+/*
+ * The loss based part of Google Congestion Control
+ * (draft-ietf-rmcat-gcc-02, section 6): backs off in proportion to the
+ * loss above 10%, and grows by 5% per report below 2%. The receiver's own
+ * estimate caps it where it sends REMB.
+ */
+void WHIPOutput::UpdateBitrate()
+{
+	auto feedback = video_feedback;
+	if (!feedback)
+		return;
+
+	uint32_t report_count = feedback->GetReportCount();
+	if (report_count == dbr_last_report)
+		return;
+
+	dbr_last_report = report_count;
+
+	double loss = feedback->GetFractionLost() / 256.0;
+	if (loss > 0.1)
+		dbr_loss_bitrate *= 1.0 - 0.5 * loss;
+	else if (loss < 0.02)
+		dbr_loss_bitrate *= 1.05;
+
+	dbr_loss_bitrate = std::clamp(dbr_loss_bitrate, (double)dbr_min_bitrate, (double)dbr_orig_bitrate);
+
+	int bitrate = (int)dbr_loss_bitrate;
+
+	uint64_t remb_bitrate = feedback->GetRembBitrate();
+	if (remb_bitrate) {
+		int64_t remb_video_bitrate = (int64_t)(remb_bitrate / 1000) - dbr_audio_bitrate;
+		if (remb_video_bitrate < bitrate)
+			bitrate = (int)std::max(remb_video_bitrate, (int64_t)dbr_min_bitrate);
+	}
+
+	// Small steps aren't worth reconfiguring the encoder for
+	int cur_bitrate = dbr_cur_bitrate;
+	if (bitrate != dbr_orig_bitrate && std::abs(bitrate - cur_bitrate) < cur_bitrate / 20)
+		return;
+	if (bitrate == cur_bitrate)
+		return;
+
+	do_log(LOG_INFO, "Bitrate %s to %d kbps (%.1f%% loss)", bitrate < cur_bitrate ? "lowered" : "increased",
+	       bitrate, loss * 100.0);
+	SetBitrate(bitrate);
+}
+
+void WHIPOutput::SetBitrate(int bitrate)
+{
+	obs_encoder_t *encoder = obs_output_get_video_encoder(output);
+	if (!encoder)
+		return;
+
+	OBSDataAutoRelease settings = obs_encoder_get_settings(encoder);
+	obs_data_set_int(settings, "bitrate", bitrate);
+	obs_encoder_update(encoder, settings);
+
+	dbr_cur_bitrate = bitrate;
+}
+
+void WHIPOutput::GetFeedbackStats(calldata_t *cd)
+{
+	auto feedback = video_feedback;
+
+	calldata_set_int(cd, "bitrate", dbr_cur_bitrate);
+	calldata_set_int(cd, "nack_buffer_size", video_nack_buffer_size);
+
+	if (!feedback)
+		return;
+
+	calldata_set_int(cd, "remb_bitrate", (long long)(feedback->GetRembBitrate() / 1000));
+	calldata_set_float(cd, "packet_loss", feedback->GetFractionLost() / 256.0);
+	calldata_set_int(cd, "nack_count", (long long)feedback->GetNackCount());
+	calldata_set_int(cd, "nacked_packets", (long long)feedback->GetNackedPackets());
 }
 
 /**
@@ -586,8 +811,15 @@ void WHIPOutput::StopThread(bool signal)
 		peer_connection = nullptr;
 		audio_track = nullptr;
 		video_track = nullptr;
+		video_feedback = nullptr;
+		video_simulcast = nullptr;
 	}
 
+	// Restores the bitrate the encoder was configured with
+	if (dbr_enabled && dbr_cur_bitrate != dbr_orig_bitrate)
+		SetBitrate(dbr_orig_bitrate);
+	dbr_enabled = false;
+
 	SendDelete();
 
 	/*
@@ -607,7 +839,6 @@ void WHIPOutput::StopThread(bool signal)
 	connect_time_ms = 0;
 	start_time_ns = 0;
 	last_audio_timestamp = 0;
-	last_video_timestamp = 0;
 }
 
 void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
@@ -616,8 +847,6 @@ void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration, std::shared
 	if (track == nullptr || !track->isOpen())
 		return;
 
-	std::vector<rtc::byte> sample{(rtc::byte *)data, (rtc::byte *)data + size};
-
 	auto rtp_config = rtcp_sr_reporter->rtpConfig;
 
 	// Sample time is in microseconds, we need to convert it to seconds
@@ -636,9 +865,13 @@ void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration, std::shared
 	if (rtp_config->timestampToSeconds(report_elapsed_timestamp) > 1)
 		rtcp_sr_reporter->setNeedsToReport();
 
+	/*
+	 * The packet is handed over as is rather than copied into a vector
+	 * first, the track makes the only copy the packetizer works from.
+	 */
 	try {
-		track->send(sample);
-		total_bytes_sent += sample.size();
+		track->send(static_cast<const rtc::byte *>(data), size);
+		total_bytes_sent += size;
 	} catch (const std::exception &e) {
 		do_log(LOG_ERROR, "error: %s ", e.what());
 	}
@@ -657,7 +890,7 @@ void register_whip_output()
 
 	struct obs_output_info info = {};
 	info.id = "whip_output";
-	info.flags = OBS_OUTPUT_AV | base_flags;
+	info.flags = OBS_OUTPUT_AV | OBS_OUTPUT_MULTI_TRACK_VIDEO | base_flags;
 	info.get_name = [](void *) -> const char * {
 		return obs_module_text("Output.Name");
 	};
@@ -694,7 +927,7 @@ void register_whip_output()
 	obs_register_output(&info);
 
 	info.id = "whip_output_video";
-	info.flags = OBS_OUTPUT_VIDEO | base_flags;
+	info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_MULTI_TRACK_VIDEO | base_flags;
 	info.encoded_audio_codecs = nullptr;
 	obs_register_output(&info);
 
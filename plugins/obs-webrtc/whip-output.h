@@ -10,9 +10,18 @@
 #include <atomic>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <rtc/rtc.hpp>
 
+#include "whip-feedback.h"
+#include "whip-simulcast.h"
+
+// RIDs, and the RTP header extensions carrying them, came with libdatachannel 0.21
+#if RTC_VERSION_MAJOR == 0 && RTC_VERSION_MINOR > 20 || RTC_VERSION_MAJOR > 1
+#define WHIP_SIMULCAST
+#endif
+
 class WHIPOutput {
 public:
 	WHIPOutput(obs_data_t *settings, obs_output_t *output);
@@ -40,6 +49,14 @@ private:
 	void Send(void *data, uintptr_t size, uint64_t duration, std::shared_ptr<rtc::Track> track,
 		  std::shared_ptr<rtc::RtcpSrReporter> rtcp_sr_reporter);
 
+	std::shared_ptr<rtc::RtpPacketizer>
+	CreateVideoPacketizer(const char *codec, std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config);
+
+	void InitDynamicBitrate(obs_encoder_t *encoder, int video_bitrate);
+	void UpdateBitrate();
+	void SetBitrate(int bitrate);
+	void GetFeedbackStats(calldata_t *cd);
+
 	obs_output_t *output;
 
 	std::string endpoint_url;
@@ -56,13 +73,30 @@ private:
 	std::shared_ptr<rtc::Track> audio_track;
 	std::shared_ptr<rtc::Track> video_track;
 	std::shared_ptr<rtc::RtcpSrReporter> audio_sr_reporter;
-	std::shared_ptr<rtc::RtcpSrReporter> video_sr_reporter;
+	std::shared_ptr<WHIPFeedbackHandler> video_feedback;
+
+	// One per rendition of the encoder group, simulcast with more than one
+	struct VideoLayer {
+		std::shared_ptr<rtc::RtpPacketizer> packetizer;
+		std::shared_ptr<rtc::RtcpSrReporter> sr_reporter;
+		int64_t last_timestamp;
+	};
+	std::vector<VideoLayer> video_layers;
+	std::shared_ptr<WHIPSimulcastHandler> video_simulcast;
+
+	// Dynamic bitrate, in kbps
+	bool dbr_enabled;
+	int dbr_orig_bitrate;
+	int dbr_min_bitrate;
+	int dbr_audio_bitrate;
+	std::atomic<int> dbr_cur_bitrate;
+	double dbr_loss_bitrate;
+	uint32_t dbr_last_report;
 
 	std::atomic<size_t> total_bytes_sent;
 	std::atomic<int> connect_time_ms;
 	int64_t start_time_ns;
 	int64_t last_audio_timestamp;
-	int64_t last_video_timestamp;
 };
 
 void register_whip_output();
@@ -0,0 +1,32 @@
+#include "whip-simulcast.h"
+
+void WHIPSimulcastHandler::AddLayer(std::shared_ptr<rtc::MediaHandler> chain)
+{
+	layers.push_back(chain);
+}
+
+void WHIPSimulcastHandler::media(const rtc::Description::Media &desc)
+{
+	for (auto &chain : layers)
+		chain->mediaChain(desc);
+}
+
+void WHIPSimulcastHandler::incoming(rtc::message_vector &messages, const rtc::message_callback &send)
+{
+	// Each chain may filter what it has handled, so it gets its own copy
+	for (auto &chain : layers) {
+		rtc::message_vector copy = messages;
+		chain->incomingChain(copy, send);
+	}
+}
+
+void WHIPSimulcastHandler::outgoing(rtc::message_vector &messages, const rtc::message_callback &send)
+{
+	size_t index = layer;
+	if (index >= layers.size()) {
+		messages.clear();
+		return;
+	}
+
+	layers[index]->outgoingChain(messages, send);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+
+/*
+ * A track only has one media handler chain, so with simulcast this one
+ * is set on the video track and dispatches to the chain of each layer:
+ * frames go through the one of the layer set last, which has its own
+ * packetizer, SSRC and RID, while RTCP from the receiver goes through
+ * all of them, so that each NACK responder can answer for its own SSRC.
+ */
+class WHIPSimulcastHandler : public rtc::MediaHandler {
+public:
+	void AddLayer(std::shared_ptr<rtc::MediaHandler> chain);
+
+	// Frames are only ever sent from the encoded packet thread
+	inline void SetLayer(size_t index) { layer = index; }
+
+	void media(const rtc::Description::Media &desc) override;
+	void incoming(rtc::message_vector &messages, const rtc::message_callback &send) override;
+	void outgoing(rtc::message_vector &messages, const rtc::message_callback &send) override;
+
+private:
+	std::vector<std::shared_ptr<rtc::MediaHandler>> layers;
+	std::atomic<size_t> layer = 0;
+};
@@ -15,12 +15,15 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <util/bmem.h>
 #include <util/dstr.h>
 #include <util/darray.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
 #include <obs-module.h>
 #include <opts-parser.h>
 
@@ -43,14 +46,25 @@
 
 /* ------------------------------------------------------------------------- */
 
+/* Encoders of an encoder group in ABR ladder mode share one GOP structure.
+ * Scenecut detection is disabled in all of them and IDR frames are forced
+ * on the same timestamps, using the keyframe interval of the first encoder
+ * of the group to be created. */
+struct x264_ladder {
+	obs_encoder_group_t *group;
+	uint64_t keyint_ns;
+	long refs;
+};
+
+static pthread_mutex_t ladder_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct x264_ladder *) ladders;
+
 struct obs_x264 {
 	obs_encoder_t *encoder;
 
 	x264_param_t params;
 	x264_t *context;
 
-	DARRAY(uint8_t) packet_data;
-
 	uint8_t *extra_data;
 	uint8_t *sei;
 
@@ -61,6 +75,11 @@ struct obs_x264 {
 
 	uint32_t roi_increment;
 	float *quant_offsets;
+
+	struct x264_ladder *ladder;
+	uint32_t fps_num;
+	uint32_t fps_den;
+	uint64_t next_key_ns;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -85,14 +104,57 @@ static void clear_data(struct obs_x264 *obsx264)
 	}
 }
 
+static struct x264_ladder *join_ladder(obs_encoder_group_t *group, uint64_t keyint_ns)
+{
+	struct x264_ladder *ladder = NULL;
+
+	pthread_mutex_lock(&ladder_mutex);
+
+	for (size_t i = 0; i < ladders.num; i++) {
+		if (ladders.array[i]->group == group) {
+			ladder = ladders.array[i];
+			break;
+		}
+	}
+
+	if (!ladder) {
+		ladder = bzalloc(sizeof(*ladder));
+		ladder->group = group;
+		ladder->keyint_ns = keyint_ns;
+		da_push_back(ladders, &ladder);
+	}
+
+	ladder->refs++;
+
+	pthread_mutex_unlock(&ladder_mutex);
+	return ladder;
+}
+
+static void leave_ladder(struct x264_ladder *ladder)
+{
+	if (!ladder)
+		return;
+
+	pthread_mutex_lock(&ladder_mutex);
+
+	if (--ladder->refs == 0) {
+		da_erase_item(ladders, &ladder);
+		if (!ladders.num)
+			da_free(ladders);
+		bfree(ladder);
+	}
+
+	pthread_mutex_unlock(&ladder_mutex);
+}
+
 static void obs_x264_destroy(void *data)
 {
 	struct obs_x264 *obsx264 = data;
 
 	if (obsx264) {
 		os_end_high_performance(obsx264->performance_token);
+		leave_ladder(obsx264->ladder);
 		clear_data(obsx264);
-		da_free(obsx264->packet_data);
 		bfree(obsx264);
 	}
 }
@@ -114,6 +176,8 @@ static void obs_x264_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "tune", "");
 	obs_data_set_default_string(settings, "x264opts", "");
 	obs_data_set_default_bool(settings, "repeat_headers", false);
+	obs_data_set_default_bool(settings, "abr_ladder", false);
+	obs_data_set_default_string(settings, "cpu_affinity", "");
 }
 
 static inline void add_strings(obs_property_t *list, const char *const *strings)
@@ -136,6 +200,8 @@ static inline void add_strings(obs_property_t *list, const char *const *strings)
 #define TEXT_TUNE obs_module_text("Tune")
 #define TEXT_NONE obs_module_text("None")
 #define TEXT_X264_OPTS obs_module_text("EncoderOptions")
+#define TEXT_ABR_LADDER obs_module_text("ABRLadder")
+#define TEXT_CPU_AFFINITY obs_module_text("CPUAffinity")
 
 static bool use_bufsize_modified(obs_properties_t *ppts, obs_property_t *p, obs_data_t *settings)
 {
@@ -216,6 +282,11 @@ static obs_properties_t *obs_x264_props(void *unused)
 
 	obs_properties_add_text(props, "x264opts", TEXT_X264_OPTS, OBS_TEXT_DEFAULT);
 
+	obs_properties_add_bool(props, "abr_ladder", TEXT_ABR_LADDER);
+
+	p = obs_properties_add_text(props, "cpu_affinity", TEXT_CPU_AFFINITY, OBS_TEXT_DEFAULT);
+	obs_property_set_long_description(p, obs_module_text("CPUAffinity.ToolTip"));
+
 	headers = obs_properties_add_bool(props, "repeat_headers", "repeat_headers");
 	obs_property_set_visible(headers, false);
 
@@ -345,6 +416,32 @@ static void obs_x264_video_info(void *data, struct video_scale_info *info);
 
 enum rate_control { RATE_CONTROL_CBR, RATE_CONTROL_VBR, RATE_CONTROL_ABR, RATE_CONTROL_CRF };
 
+/* x264 can look at most 250 frames ahead */
+#define MAX_LOOKAHEAD 250
+
+/* deepens the rate control lookahead as far as the encoder's latency
+ * budget allows, the custom options applied afterwards still win */
+static void apply_max_latency(struct obs_x264 *obsx264)
+{
+	uint32_t frames = obs_encoder_get_max_latency_frames(obsx264->encoder);
+	int lookahead;
+
+	/* zerolatency turns the lookahead off, keep it that way */
+	if (!frames || !obsx264->params.rc.i_lookahead)
+		return;
+
+	/* b-frames and frame threads add to the delay */
+	lookahead = (int)frames - obsx264->params.i_bframe - obsx264->params.i_threads;
+	if (lookahead > MAX_LOOKAHEAD)
+		lookahead = MAX_LOOKAHEAD;
+	if (lookahead <= obsx264->params.rc.i_lookahead)
+		return;
+
+	info("max latency: %" PRIu32 " ms, lookahead: %d frames", obs_encoder_get_max_latency(obsx264->encoder),
+	     lookahead);
+	obsx264->params.rc.i_lookahead = lookahead;
+}
+
 static void update_params(struct obs_x264 *obsx264, obs_data_t *settings, const struct obs_options *options,
 			  bool update)
 {
@@ -488,11 +585,22 @@ static void update_params(struct obs_x264 *obsx264, obs_data_t *settings, const
 	else
 		obsx264->params.i_csp = X264_CSP_NV12;
 
+	if (!update)
+		apply_max_latency(obsx264);
+
 	for (size_t i = 0; i < options->ignored_word_count; ++i)
 		warn("ignoring invalid x264 option: %s", options->ignored_words[i]);
 	for (size_t i = 0; i < options->count; ++i)
 		set_param(obsx264, options->options[i]);
 
+	/* keyframes are placed by the ladder, after the custom options so
+	 * that those cannot break the alignment */
+	if (obsx264->ladder) {
+		obsx264->params.i_keyint_max = X264_KEYINT_MAX_INFINITE;
+		obsx264->params.i_scenecut_threshold = 0;
+		obsx264->params.b_intra_refresh = 0;
+	}
+
 	if (!update) {
 		info("settings:\n"
 		     "\trate_control: %s\n"
@@ -629,6 +737,75 @@ static void load_headers(struct obs_x264 *obsx264)
 	obsx264->sei_size = sei.num;
 }
 
+static void init_ladder(struct obs_x264 *obsx264, obs_data_t *settings)
+{
+	obs_encoder_group_t *group = obs_encoder_get_group(obsx264->encoder);
+	int keyint = obsx264->params.i_keyint_max;
+
+	if (!group) {
+		warn("ABR ladder mode needs the encoder to be in an encoder group, ignoring");
+		return;
+	}
+
+	if (keyint <= 0 || keyint == X264_KEYINT_MAX_INFINITE)
+		keyint = 250;
+
+	uint64_t keyint_ns = util_mul_div64((uint64_t)keyint, 1000000000ULL * obsx264->fps_den, obsx264->fps_num);
+	obsx264->ladder = join_ladder(group, keyint_ns);
+
+	info("ABR ladder: keyframes every %" PRIu64 " ms, shared with the encoder group",
+	     obsx264->ladder->keyint_ns / 1000000);
+
+	/* applies the ladder's keyframe placement */
+	struct obs_options options = obs_parse_options(obs_data_get_string(settings, "x264opts"));
+	update_params(obsx264, settings, &options, true);
+	obs_free_options(options);
+}
+
+/* every encoder of the ladder starts on the same frame, so the same time
+ * offset from the first frame is the same picture in all of them.  pts
+ * counts in units of 1 / fps_num, whatever the frame rate divisor is */
+static bool ladder_keyframe_due(struct obs_x264 *obsx264, int64_t pts)
+{
+	const uint64_t half_frame = util_mul_div64(500000000ULL, obsx264->fps_den, obsx264->fps_num);
+	const uint64_t keyint_ns = obsx264->ladder->keyint_ns;
+	uint64_t t;
+
+	if (pts < 0)
+		return false;
+
+	t = util_mul_div64((uint64_t)pts, 1000000000ULL, obsx264->fps_num) + half_frame;
+	if (t < obsx264->next_key_ns)
+		return false;
+
+	while (obsx264->next_key_ns <= t)
+		obsx264->next_key_ns += keyint_ns;
+	return true;
+}
+
+/* x264 sizes its thread pool from the affinity of the calling thread, and its
+ * threads inherit that affinity where the platform allows, so the creating
+ * thread is pinned while the encoder opens */
+static bool pin_encoder_threads(struct obs_x264 *obsx264, const char *cpu_list, struct os_cpu_set *prev)
+{
+	struct os_cpu_set set;
+
+	if (!cpu_list || !*cpu_list)
+		return false;
+
+	if (!os_cpu_set_parse(&set, cpu_list) || os_cpu_set_empty(&set)) {
+		warn("Invalid CPU affinity '%s', threads are not pinned", cpu_list);
+		return false;
+	}
+	if (!os_get_thread_affinity(prev) || !os_set_thread_affinity(&set)) {
+		warn("Failed to pin encoder threads to CPUs %s", cpu_list);
+		return false;
+	}
+
+	info("Encoder threads pinned to CPUs %s", cpu_list);
+	return true;
+}
+
 static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 {
 	video_t *video = obs_encoder_video(encoder);
@@ -652,10 +829,22 @@ static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 
 	struct obs_x264 *obsx264 = bzalloc(sizeof(struct obs_x264));
 	obsx264->encoder = encoder;
+	obsx264->fps_num = voi->fps_num;
+	obsx264->fps_den = voi->fps_den;
 
 	if (update_settings(obsx264, settings, false)) {
+		if (obs_data_get_bool(settings, "abr_ladder"))
+			init_ladder(obsx264, settings);
+
+		struct os_cpu_set prev_affinity;
+		bool pinned =
+			pin_encoder_threads(obsx264, obs_data_get_string(settings, "cpu_affinity"), &prev_affinity);
+
 		obsx264->context = x264_encoder_open(&obsx264->params);
 
+		if (pinned)
+			os_set_thread_affinity(&prev_affinity);
+
 		if (obsx264->context == NULL)
 			warn("x264 failed to load");
 		else
@@ -665,6 +854,7 @@ static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 	}
 
 	if (!obsx264->context) {
+		leave_ladder(obsx264->ladder);
 		bfree(obsx264);
 		return NULL;
 	}
@@ -677,18 +867,26 @@ static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 static void parse_packet(struct obs_x264 *obsx264, struct encoder_packet *packet, x264_nal_t *nals, int nal_count,
 			 x264_picture_t *pic_out)
 {
+	size_t size = 0;
+	uint8_t *data;
+
 	if (!nal_count)
 		return;
 
-	da_resize(obsx264->packet_data, 0);
+	for (int i = 0; i < nal_count; i++)
+		size += nals[i].i_payload;
+
+	/* written straight into packet data libobs can hand to outputs
+	 * without copying it again */
+	data = obs_encoder_packet_alloc(obsx264->encoder, size);
+	packet->data = data;
+	packet->size = size;
 
 	for (int i = 0; i < nal_count; i++) {
-		x264_nal_t *nal = nals + i;
-		da_push_back_array(obsx264->packet_data, nal->p_payload, nal->i_payload);
+		memcpy(data, nals[i].p_payload, nals[i].i_payload);
+		data += nals[i].i_payload;
 	}
 
-	packet->data = obsx264->packet_data.array;
-	packet->size = obsx264->packet_data.num;
 	packet->type = OBS_ENCODER_VIDEO;
 	packet->pts = pic_out->i_pts;
 	packet->dts = pic_out->i_dts;
@@ -792,6 +990,9 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame, struct enco
 	if (obs_encoder_has_roi(obsx264->encoder))
 		add_roi(obsx264, &pic);
 
+	if (obsx264->ladder && ladder_keyframe_due(obsx264, frame->pts))
+		pic.i_type = X264_TYPE_IDR;
+
 	ret = x264_encoder_encode(obsx264->context, &nals, &nal_count, (frame ? &pic : NULL), &pic_out);
 	if (ret < 0) {
 		warn("encode failed");
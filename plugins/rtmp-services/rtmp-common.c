@@ -16,6 +16,7 @@ struct rtmp_common {
 	char *protocol;
 	char *server;
 	char *key;
+	struct dstr alternatives;
 
 	struct obs_service_resolution *supported_resolutions;
 	size_t supported_resolutions_count;
@@ -203,6 +204,7 @@ static void rtmp_common_destroy(void *data)
 	bfree(service->protocol);
 	bfree(service->server);
 	bfree(service->key);
+	dstr_free(&service->alternatives);
 	bfree(service);
 }
 
@@ -880,6 +882,54 @@ static const char *rtmp_common_url(void *data)
 	return service->server;
 }
 
+/* ingests the output may race against the first one */
+#define MAX_INGEST_ALTERNATIVES 3
+
+/* For automatic server selection, the next few ingests of the list the
+ * server URL was taken from, the output can connect to whichever of them
+ * is closest. */
+static const char *rtmp_common_url_alternatives(void *data)
+{
+	struct rtmp_common *service = data;
+
+	dstr_free(&service->alternatives);
+
+	if (!service->service || !service->server)
+		return NULL;
+
+	if (strcmp(service->service, "Twitch") == 0 && strcmp(service->server, "auto") == 0) {
+		twitch_ingests_lock();
+		size_t count = twitch_ingest_count();
+		for (size_t i = 1; i < count && i <= MAX_INGEST_ALTERNATIVES; i++) {
+			struct ingest ing = twitch_ingest(i);
+			if (!ing.url)
+				continue;
+			if (!dstr_is_empty(&service->alternatives))
+				dstr_cat_ch(&service->alternatives, '\n');
+			dstr_cat(&service->alternatives, ing.url);
+		}
+		twitch_ingests_unlock();
+
+	} else if (strcmp(service->service, "Amazon IVS") == 0 && strncmp(service->server, "auto", 4) == 0) {
+		bool rtmp = strcmp(service->server, "auto-rtmp") == 0;
+
+		amazon_ivs_ingests_lock();
+		size_t count = amazon_ivs_ingest_count();
+		for (size_t i = 1; i < count && i <= MAX_INGEST_ALTERNATIVES; i++) {
+			struct ingest ing = amazon_ivs_ingest(i);
+			const char *url = rtmp ? ing.url : ing.rtmps_url;
+			if (!url)
+				continue;
+			if (!dstr_is_empty(&service->alternatives))
+				dstr_cat_ch(&service->alternatives, '\n');
+			dstr_cat(&service->alternatives, url);
+		}
+		amazon_ivs_ingests_unlock();
+	}
+
+	return service->alternatives.array;
+}
+
 static const char *rtmp_common_key(void *data)
 {
 	struct rtmp_common *service = data;
@@ -1139,6 +1189,8 @@ static const char *rtmp_common_get_connect_info(void *data, uint32_t type)
 	}
 	case OBS_SERVICE_CONNECT_INFO_BEARER_TOKEN:
 		return NULL;
+	case OBS_SERVICE_CONNECT_INFO_SERVER_URL_ALTERNATIVES:
+		return rtmp_common_url_alternatives(data);
 	}
 
 	return NULL;
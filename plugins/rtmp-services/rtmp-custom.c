@@ -163,6 +163,7 @@ static const char *rtmp_custom_get_connect_info(void *data, uint32_t type)
 		break;
 	}
 	case OBS_SERVICE_CONNECT_INFO_BEARER_TOKEN:
+	case OBS_SERVICE_CONNECT_INFO_SERVER_URL_ALTERNATIVES:
 		return NULL;
 	}
 
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/crc32.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <sys/stat.h>
@@ -53,7 +54,7 @@ static obs_properties_t *ft2_source_properties(void *unused);
 static struct obs_source_info freetype2_source_info_v1 = {
 	.id = "text_ft2_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE | OBS_SOURCE_CUSTOM_DRAW,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE | OBS_SOURCE_CUSTOM_DRAW | OBS_SOURCE_STATIC_VIDEO,
 	.get_name = ft2_source_get_name,
 	.create = ft2_source_create,
 	.destroy = ft2_source_destroy,
@@ -75,7 +76,7 @@ static struct obs_source_info freetype2_source_info_v2 = {
 #ifdef _WIN32
 			OBS_SOURCE_DEPRECATED |
 #endif
-			OBS_SOURCE_CUSTOM_DRAW,
+			OBS_SOURCE_CUSTOM_DRAW | OBS_SOURCE_STATIC_VIDEO,
 	.get_name = ft2_source_get_name,
 	.create = ft2_source_create,
 	.destroy = ft2_source_destroy,
@@ -284,6 +285,41 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+static inline uint32_t get_text_crc(const wchar_t *text)
+{
+	return calc_crc32(0, text, wcslen(text) * sizeof(wchar_t));
+}
+
+/* files are often rewritten with the same content (e.g. by tools updating
+ * many files at once), so only a change of the text itself triggers a
+ * rebuild.  Returns true if the text changed */
+static bool reload_text_file(struct ft2_source *srcdata)
+{
+	wchar_t *prev_text = srcdata->text;
+
+	srcdata->text = NULL;
+	if (srcdata->log_mode)
+		read_from_end(srcdata, srcdata->text_file);
+	else
+		load_text_from_file(srcdata, srcdata->text_file);
+
+	if (!srcdata->text) {
+		srcdata->text = prev_text;
+		return false;
+	}
+
+	uint32_t crc = get_text_crc(srcdata->text);
+	if (prev_text && crc == srcdata->file_crc) {
+		bfree(srcdata->text);
+		srcdata->text = prev_text;
+		return false;
+	}
+
+	bfree(prev_text);
+	srcdata->file_crc = crc;
+	return true;
+}
+
 static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
@@ -297,12 +333,11 @@ static void ft2_video_tick(void *data, float seconds)
 		srcdata->last_checked = os_gettime_ns();
 
 		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata, srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
+			if (reload_text_file(srcdata)) {
+				cache_glyphs(srcdata, srcdata->text);
+				set_up_vertex_buffer(srcdata);
+				obs_source_mark_video_changed(srcdata->src);
+			}
 			srcdata->update_file = false;
 		}
 
@@ -498,6 +533,8 @@ skip_font_load:
 				read_from_end(srcdata, tmp);
 			else
 				load_text_from_file(srcdata, tmp);
+			if (srcdata->text)
+				srcdata->file_crc = get_text_crc(srcdata->text);
 			srcdata->last_checked = os_gettime_ns();
 		}
 	} else {
@@ -43,6 +43,7 @@ struct ft2_source {
 	time_t m_timestamp;
 	bool update_file;
 	uint64_t last_checked;
+	uint32_t file_crc;
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
@@ -59,6 +60,7 @@ struct ft2_source {
 
 	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_glyphs;
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -71,9 +71,14 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 	srcdata->cy = srcdata->max_h;
 
 	obs_enter_graphics();
-	if (srcdata->vbuf != NULL) {
+
+	/* the buffer is kept as long as the text fits, only growing when
+	 * needed, and refilled in place */
+	const uint32_t glyphs = (uint32_t)wcslen(srcdata->text);
+	if (srcdata->vbuf != NULL && (glyphs == 0 || glyphs > srcdata->vbuf_glyphs)) {
 		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
 		srcdata->vbuf = NULL;
+		srcdata->vbuf_glyphs = 0;
 		gs_vertexbuffer_destroy(tmpvbuf);
 	}
 
@@ -82,7 +87,10 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 		return;
 	}
 
-	srcdata->vbuf = create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
+	if (srcdata->vbuf == NULL) {
+		srcdata->vbuf = create_uv_vbuffer(glyphs * 6, true);
+		srcdata->vbuf_glyphs = srcdata->vbuf ? glyphs : 0;
+	}
 
 	if (srcdata->custom_width <= 100)
 		goto skip_word_wrap;
@@ -188,6 +196,13 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 	skip_glyph:;
 	}
 
+	/* clear what is left of previous text in a reused buffer, skipped
+	 * characters leave unused vertices as well */
+	if (cur_glyph < srcdata->vbuf_glyphs) {
+		size_t unused = (srcdata->vbuf_glyphs - cur_glyph) * 6;
+		memset(vdata->points + (cur_glyph * 6), 0, unused * sizeof(struct vec3));
+	}
+
 	srcdata->cy = max_y;
 }
 
@@ -332,13 +347,13 @@ void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 
 		obs_enter_graphics();
 
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
-			gs_texture_destroy(tmp_texture);
-		}
-
-		srcdata->tex = gs_texture_create(texbuf_w, texbuf_h, GS_A8, 1, (const uint8_t **)&srcdata->texbuf, 0);
+		/* the atlas is always the same size, so it is uploaded again
+		 * rather than recreated */
+		if (srcdata->tex != NULL)
+			gs_texture_set_image(srcdata->tex, srcdata->texbuf, texbuf_w, false);
+		else
+			srcdata->tex = gs_texture_create(texbuf_w, texbuf_h, GS_A8, 1,
+							 (const uint8_t **)&srcdata->texbuf, GS_DYNAMIC);
 
 		obs_leave_graphics();
 	}
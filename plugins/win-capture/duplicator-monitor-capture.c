@@ -1,4 +1,5 @@
 #include <windows.h>
+#include <inttypes.h>
 
 #include <obs-module.h>
 #include <util/dstr.h>
@@ -49,6 +50,7 @@ typedef enum gs_color_space (*PFN_winrt_capture_get_color_space)(const struct wi
 typedef void (*PFN_winrt_capture_render)(struct winrt_capture *capture);
 typedef uint32_t (*PFN_winrt_capture_width)(const struct winrt_capture *capture);
 typedef uint32_t (*PFN_winrt_capture_height)(const struct winrt_capture *capture);
+typedef void (*PFN_winrt_capture_get_stats)(const struct winrt_capture *capture, struct gs_duplicator_stats *stats);
 
 struct winrt_exports {
 	PFN_winrt_capture_supported winrt_capture_supported;
@@ -60,6 +62,7 @@ struct winrt_exports {
 	PFN_winrt_capture_render winrt_capture_render;
 	PFN_winrt_capture_width winrt_capture_width;
 	PFN_winrt_capture_height winrt_capture_height;
+	PFN_winrt_capture_get_stats winrt_capture_get_stats;
 };
 
 enum display_capture_method {
@@ -93,6 +96,11 @@ struct duplicator_capture {
 	float reset_timeout;
 	struct cursor_data cursor_data;
 
+	/* duplicators are shared, so stats are logged relative to the
+	 * snapshot taken when this source started capturing */
+	struct gs_duplicator_stats start_stats;
+	uint64_t start_time;
+
 	void *winrt_module;
 	struct winrt_exports exports;
 	struct winrt_capture *capture_winrt;
@@ -311,6 +319,7 @@ static inline void update_settings(struct duplicator_capture *capture, obs_data_
 	if (capture->duplicator) {
 		obs_enter_graphics();
 
+		log_capture_stats(capture);
 		gs_duplicator_destroy(capture->duplicator);
 		capture->duplicator = NULL;
 
@@ -339,6 +348,10 @@ static void duplicator_actual_destroy(void *data)
 {
 	struct duplicator_capture *capture = data;
 
+	obs_enter_graphics();
+	log_capture_stats(capture);
+	obs_leave_graphics();
+
 	if (capture->capture_winrt) {
 		capture->exports.winrt_capture_free(capture->capture_winrt);
 		capture->capture_winrt = NULL;
@@ -413,6 +426,7 @@ static bool load_winrt_imports(struct winrt_exports *exports, void *module, cons
 	WINRT_IMPORT(winrt_capture_render);
 	WINRT_IMPORT(winrt_capture_width);
 	WINRT_IMPORT(winrt_capture_height);
+	WINRT_IMPORT(winrt_capture_get_stats);
 
 	return success;
 }
@@ -461,8 +475,52 @@ static void reset_capture_data(struct duplicator_capture *capture)
 	capture->rot = monitor_info.rotation_degrees;
 }
 
+static void get_capture_stats(struct duplicator_capture *capture, struct gs_duplicator_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (capture->capture_winrt)
+		capture->exports.winrt_capture_get_stats(capture->capture_winrt, stats);
+	else if (capture->duplicator)
+		gs_duplicator_get_stats(capture->duplicator, stats);
+}
+
+static void start_capture_stats(struct duplicator_capture *capture)
+{
+	get_capture_stats(capture, &capture->start_stats);
+	capture->start_time = os_gettime_ns();
+}
+
+/* logs frame rate and latency since start_capture_stats, before the capture
+ * is freed */
+static void log_capture_stats(struct duplicator_capture *capture)
+{
+	struct gs_duplicator_stats stats;
+
+	if (!capture->capture_winrt && !capture->duplicator)
+		return;
+
+	get_capture_stats(capture, &stats);
+
+	const uint64_t frames = stats.frames - capture->start_stats.frames;
+	const uint64_t skipped = stats.skipped_frames - capture->start_stats.skipped_frames;
+	const uint64_t partial = stats.partial_copies - capture->start_stats.partial_copies;
+	const uint64_t latency_ns = stats.total_latency_ns - capture->start_stats.total_latency_ns;
+	const double seconds = (double)(os_gettime_ns() - capture->start_time) / 1000000000.0;
+
+	if (!frames || seconds <= 0.0)
+		return;
+
+	info("%s capture stats: %" PRIu64 " frames (%.2f fps), %" PRIu64 " copied through dirty rects, %" PRIu64
+	     " pointer only frames skipped, %.2f ms average latency",
+	     capture->capture_winrt ? "WGC" : "DXGI", frames, (double)frames / seconds, partial, skipped,
+	     (double)latency_ns / (double)frames / 1000000.0);
+}
+
 static void free_capture_data(struct duplicator_capture *capture)
 {
+	log_capture_stats(capture);
+
 	if (capture->capture_winrt) {
 		capture->exports.winrt_capture_free(capture->capture_winrt);
 		capture->capture_winrt = NULL;
@@ -543,6 +601,8 @@ static void duplicator_capture_tick(void *data, float seconds)
 					}
 				}
 
+				if (capture->capture_winrt)
+					start_capture_stats(capture);
 				capture->reset_timeout = 0.0f;
 			}
 		}
@@ -572,6 +632,8 @@ static void duplicator_capture_tick(void *data, float seconds)
 
 					if (dxgi_index != -1) {
 						capture->duplicator = gs_duplicator_create(dxgi_index);
+						if (capture->duplicator)
+							start_capture_stats(capture);
 					}
 				}
 
@@ -20,6 +20,9 @@
 #include "audio-helpers.h"
 #include "nt-stuff.h"
 
+/* one displayed, one being filled and one the GPU may still be reading */
+#define SHMEM_UPLOAD_TEXTURES 3
+
 #define do_log(level, format, ...) \
 	blog(level, "[game-capture: '%s'] " format, obs_source_get_name(gc->source), ##__VA_ARGS__)
 
@@ -190,6 +193,20 @@ struct game_capture {
 
 	void (*copy_texture)(struct game_capture *);
 
+	/* memory capture frames are copied on shmem_thread straight into the
+	 * mapped texture of the upload ring, the graphics thread only unmaps
+	 * it and swaps it in as gc->texture */
+	gs_texture_t *upload_textures[SHMEM_UPLOAD_TEXTURES];
+	size_t upload_mapped;
+	uint8_t *upload_data;
+	uint32_t upload_pitch;
+	volatile bool upload_filled;
+
+	pthread_t shmem_thread;
+	os_event_t *shmem_event;
+	volatile bool shmem_stop;
+	bool shmem_thread_active;
+
 	PFN_SetThreadDpiAwarenessContext set_thread_dpi_awareness_context;
 	PFN_GetThreadDpiAwarenessContext get_thread_dpi_awareness_context;
 	PFN_GetWindowDpiAwarenessContext get_window_dpi_awareness_context;
@@ -309,9 +326,13 @@ static inline float hook_rate_to_float(enum hook_rate rate)
 	}
 }
 
+static void stop_shmem_thread(struct game_capture *gc);
+static void free_upload_textures(struct game_capture *gc);
+
 static void stop_capture(struct game_capture *gc)
 {
 	ipc_pipe_server_free(&gc->pipe);
+	stop_shmem_thread(gc);
 
 	if (gc->hook_stop) {
 		SetEvent(gc->hook_stop);
@@ -343,6 +364,7 @@ static void stop_capture(struct game_capture *gc)
 	close_handle(&gc->texture_mutexes[1]);
 
 	obs_enter_graphics();
+	free_upload_textures(gc);
 	gs_texrender_destroy(gc->extra_texrender);
 	gc->extra_texrender = NULL;
 	gs_texture_destroy(gc->extra_texture);
@@ -1474,56 +1496,137 @@ static inline void copy_16bit_tex(struct game_capture *gc, int cur_texture, uint
 	}
 }
 
-static void copy_shmem_tex(struct game_capture *gc)
+static void copy_shmem_frame(struct game_capture *gc, int cur_texture, uint8_t *data, uint32_t pitch)
 {
-	int cur_texture;
-	HANDLE mutex = NULL;
-	uint32_t pitch;
-	int next_texture;
-	uint8_t *data;
+	if (gc->convert_16bit) {
+		copy_16bit_tex(gc, cur_texture, data, pitch);
 
-	if (!gc->shmem_data)
-		return;
+	} else if (pitch == gc->pitch) {
+		memcpy(data, gc->texture_buffers[cur_texture], (size_t)pitch * (size_t)gc->cy);
+	} else {
+		uint8_t *input = gc->texture_buffers[cur_texture];
+		uint32_t best_pitch = pitch < gc->pitch ? pitch : gc->pitch;
 
-	cur_texture = gc->shmem_data->last_tex;
+		for (size_t y = 0; y < gc->cy; y++) {
+			uint8_t *line_in = input + gc->pitch * y;
+			uint8_t *line_out = data + pitch * y;
+			memcpy(line_out, line_in, best_pitch);
+		}
+	}
+}
 
-	if (cur_texture < 0 || cur_texture > 1)
-		return;
+/* waits for the hook to release one of its buffers, preferring the one it
+ * wrote last, and returns its index or -1 when stopping */
+static int acquire_shmem_buffer(struct game_capture *gc)
+{
+	while (!os_atomic_load_bool(&gc->shmem_stop)) {
+		int cur_texture = gc->shmem_data->last_tex;
 
-	next_texture = cur_texture == 1 ? 0 : 1;
+		if (cur_texture < 0 || cur_texture > 1) {
+			os_sleep_ms(1);
+			continue;
+		}
 
-	if (object_signalled(gc->texture_mutexes[cur_texture])) {
-		mutex = gc->texture_mutexes[cur_texture];
+		if (object_signalled(gc->texture_mutexes[cur_texture]))
+			return cur_texture;
 
-	} else if (object_signalled(gc->texture_mutexes[next_texture])) {
-		mutex = gc->texture_mutexes[next_texture];
-		cur_texture = next_texture;
+		DWORD ret = WaitForMultipleObjects(2, gc->texture_mutexes, false, 100);
+		if (ret == WAIT_OBJECT_0 || ret == WAIT_OBJECT_0 + 1)
+			return (int)(ret - WAIT_OBJECT_0);
+		if (ret != WAIT_TIMEOUT)
+			return -1;
+	}
 
-	} else {
+	return -1;
+}
+
+static void *shmem_thread(void *param)
+{
+	struct game_capture *gc = param;
+
+	os_set_thread_name("game-capture: shmem copy");
+
+	while (os_event_wait(gc->shmem_event) == 0) {
+		if (os_atomic_load_bool(&gc->shmem_stop))
+			break;
+
+		int cur_texture = acquire_shmem_buffer(gc);
+		if (cur_texture < 0)
+			break;
+
+		copy_shmem_frame(gc, cur_texture, gc->upload_data, gc->upload_pitch);
+		ReleaseMutex(gc->texture_mutexes[cur_texture]);
+
+		os_atomic_set_bool(&gc->upload_filled, true);
+	}
+
+	return NULL;
+}
+
+static void stop_shmem_thread(struct game_capture *gc)
+{
+	if (gc->shmem_thread_active) {
+		os_atomic_set_bool(&gc->shmem_stop, true);
+		os_event_signal(gc->shmem_event);
+		pthread_join(gc->shmem_thread, NULL);
+		gc->shmem_thread_active = false;
+	}
+
+	os_event_destroy(gc->shmem_event);
+	gc->shmem_event = NULL;
+}
+
+/* hands the texture at idx to shmem_thread, assumes graphics */
+static void map_upload_texture(struct game_capture *gc, size_t idx)
+{
+	gc->upload_mapped = idx;
+	if (!gs_texture_map(gc->upload_textures[idx], &gc->upload_data, &gc->upload_pitch)) {
+		gc->upload_data = NULL;
 		return;
 	}
 
-	if (gs_texture_map(gc->texture, &data, &pitch)) {
-		if (gc->convert_16bit) {
-			copy_16bit_tex(gc, cur_texture, data, pitch);
+	os_atomic_set_bool(&gc->upload_filled, false);
+	os_event_signal(gc->shmem_event);
+}
 
-		} else if (pitch == gc->pitch) {
-			memcpy(data, gc->texture_buffers[cur_texture], (size_t)pitch * (size_t)gc->cy);
-		} else {
-			uint8_t *input = gc->texture_buffers[cur_texture];
-			uint32_t best_pitch = pitch < gc->pitch ? pitch : gc->pitch;
+/* assumes graphics and a stopped shmem_thread */
+static void free_upload_textures(struct game_capture *gc)
+{
+	if (gc->upload_data) {
+		gs_texture_unmap(gc->upload_textures[gc->upload_mapped]);
+		gc->upload_data = NULL;
+	}
 
-			for (size_t y = 0; y < gc->cy; y++) {
-				uint8_t *line_in = input + gc->pitch * y;
-				uint8_t *line_out = data + pitch * y;
-				memcpy(line_out, line_in, best_pitch);
-			}
-		}
+	for (size_t i = 0; i < SHMEM_UPLOAD_TEXTURES; i++) {
+		if (gc->texture == gc->upload_textures[i])
+			gc->texture = NULL;
+		gs_texture_destroy(gc->upload_textures[i]);
+		gc->upload_textures[i] = NULL;
+	}
+}
+
+static void copy_shmem_tex(struct game_capture *gc)
+{
+	if (!gc->shmem_data)
+		return;
 
-		gs_texture_unmap(gc->texture);
+	/* a failed map is retried until shmem_thread has a target again */
+	if (!gc->upload_data) {
+		map_upload_texture(gc, gc->upload_mapped);
+		return;
 	}
 
-	ReleaseMutex(mutex);
+	if (!os_atomic_load_bool(&gc->upload_filled))
+		return;
+
+	/* unmapping schedules the upload, the texture two frames back has
+	 * had time to finish drawing and becomes the next copy target */
+	const size_t idx = gc->upload_mapped;
+	gs_texture_unmap(gc->upload_textures[idx]);
+	gc->upload_data = NULL;
+	gc->texture = gc->upload_textures[idx];
+
+	map_upload_texture(gc, (idx + 1) % SHMEM_UPLOAD_TEXTURES);
 }
 
 static inline bool is_16bit_format(uint32_t format)
@@ -1537,17 +1640,26 @@ static inline bool init_shmem_capture(struct game_capture *gc)
 	const bool convert_16bit = is_16bit_format(dxgi_format);
 	const enum gs_color_format format = convert_16bit ? GS_BGRA : convert_format(dxgi_format);
 
+	stop_shmem_thread(gc);
+
 	obs_enter_graphics();
+	free_upload_textures(gc);
 	gs_texrender_destroy(gc->extra_texrender);
 	gc->extra_texrender = NULL;
 	gs_texture_destroy(gc->extra_texture);
 	gc->extra_texture = NULL;
 	gs_texture_destroy(gc->texture);
 	gc->texture = NULL;
-	gs_texture_t *const texture = gs_texture_create(gc->cx, gc->cy, format, 1, NULL, GS_DYNAMIC);
+
+	bool success = true;
+	for (size_t i = 0; i < SHMEM_UPLOAD_TEXTURES; i++) {
+		gc->upload_textures[i] = gs_texture_create(gc->cx, gc->cy, format, 1, NULL, GS_DYNAMIC);
+		success = success && gc->upload_textures[i] != NULL;
+	}
+	if (!success)
+		free_upload_textures(gc);
 	obs_leave_graphics();
 
-	bool success = texture != NULL;
 	if (success) {
 		const bool linear_sample = format != GS_R10G10B10A2;
 
@@ -1564,14 +1676,30 @@ static inline bool init_shmem_capture(struct game_capture *gc)
 			gc->texture_buffers[1] = (uint8_t *)gc->data + gc->shmem_data->tex2_offset;
 			gc->convert_16bit = convert_16bit;
 
-			gc->texture = texture;
 			gc->extra_texture = NULL;
 			gc->extra_texrender = extra_texrender;
 			gc->linear_sample = linear_sample;
+
+			gc->shmem_stop = false;
+			success = os_event_init(&gc->shmem_event, OS_EVENT_TYPE_AUTO) == 0 &&
+				  pthread_create(&gc->shmem_thread, NULL, shmem_thread, gc) == 0;
+			gc->shmem_thread_active = success;
+			if (!success)
+				warn("init_shmem_capture: failed to create copy thread");
+		}
+
+		obs_enter_graphics();
+		if (success) {
+			gc->texture = gc->upload_textures[SHMEM_UPLOAD_TEXTURES - 1];
 			gc->copy_texture = copy_shmem_tex;
+			map_upload_texture(gc, 0);
 		} else {
-			gs_texture_destroy(texture);
+			stop_shmem_thread(gc);
+			gs_texrender_destroy(gc->extra_texrender);
+			gc->extra_texrender = NULL;
+			free_upload_textures(gc);
 		}
+		obs_leave_graphics();
 	} else {
 		warn("init_shmem_capture: failed to create texture");
 	}
@@ -1581,7 +1709,10 @@ static inline bool init_shmem_capture(struct game_capture *gc)
 
 static inline bool init_shtex_capture(struct game_capture *gc)
 {
+	stop_shmem_thread(gc);
+
 	obs_enter_graphics();
+	free_upload_textures(gc);
 	gs_texrender_destroy(gc->extra_texrender);
 	gc->extra_texrender = NULL;
 	gs_texture_destroy(gc->extra_texture);
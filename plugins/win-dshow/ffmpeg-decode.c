@@ -18,6 +18,9 @@
 #include "ffmpeg-decode.h"
 #include "obs-ffmpeg-compat.h"
 #include <obs-avc.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <inttypes.h>
 #ifdef ENABLE_HEVC
 #include <obs-hevc.h>
 #endif
@@ -44,13 +47,23 @@ static bool has_hw_type(const AVCodec *c, enum AVHWDeviceType type)
 	return false;
 }
 
-static void init_hw_decoder(struct ffmpeg_decode *d)
+/* every device decodes on one shared hardware device rather than creating
+ * a device (and its surface pools and driver threads) per camera */
+static pthread_mutex_t shared_hw_mutex = PTHREAD_MUTEX_INITIALIZER;
+static AVBufferRef *shared_hw_ctx = NULL;
+static enum AVHWDeviceType shared_hw_type = AV_HWDEVICE_TYPE_NONE;
+static size_t shared_hw_users = 0;
+
+static AVBufferRef *get_shared_hw_device(const AVCodec *codec)
 {
 	enum AVHWDeviceType *priority = hw_priority;
 	AVBufferRef *hw_ctx = NULL;
 
+	if (shared_hw_ctx && has_hw_type(codec, shared_hw_type))
+		return av_buffer_ref(shared_hw_ctx);
+
 	while (*priority != AV_HWDEVICE_TYPE_NONE) {
-		if (has_hw_type(d->codec, *priority)) {
+		if (has_hw_type(codec, *priority)) {
 			int ret = av_hwdevice_ctx_create(&hw_ctx, *priority, NULL, NULL, 0);
 			if (ret == 0)
 				break;
@@ -59,6 +72,26 @@ static void init_hw_decoder(struct ffmpeg_decode *d)
 		priority++;
 	}
 
+	/* keep the first device created; a codec with only other device
+	 * types gets a private one */
+	if (hw_ctx && !shared_hw_ctx) {
+		shared_hw_ctx = av_buffer_ref(hw_ctx);
+		shared_hw_type = *priority;
+	}
+
+	return hw_ctx;
+}
+
+static void init_hw_decoder(struct ffmpeg_decode *d)
+{
+	AVBufferRef *hw_ctx;
+
+	pthread_mutex_lock(&shared_hw_mutex);
+	hw_ctx = get_shared_hw_device(d->codec);
+	if (hw_ctx)
+		shared_hw_users++;
+	pthread_mutex_unlock(&shared_hw_mutex);
+
 	if (hw_ctx) {
 		d->hw_device_ctx = hw_ctx;
 		d->decoder->hw_device_ctx = av_buffer_ref(hw_ctx);
@@ -66,6 +99,18 @@ static void init_hw_decoder(struct ffmpeg_decode *d)
 	}
 }
 
+static void release_hw_decoder(struct ffmpeg_decode *d)
+{
+	av_buffer_unref(&d->hw_device_ctx);
+
+	pthread_mutex_lock(&shared_hw_mutex);
+	if (--shared_hw_users == 0) {
+		av_buffer_unref(&shared_hw_ctx);
+		shared_hw_type = AV_HWDEVICE_TYPE_NONE;
+	}
+	pthread_mutex_unlock(&shared_hw_mutex);
+}
+
 int ffmpeg_decode_init(struct ffmpeg_decode *decode, enum AVCodecID id, bool use_hw)
 {
 	int ret;
@@ -80,6 +125,7 @@ int ffmpeg_decode_init(struct ffmpeg_decode *decode, enum AVCodecID id, bool use
 
 	decode->decoder->thread_count = 0;
 
+	decode->hw_requested = use_hw;
 	if (use_hw)
 		init_hw_decoder(decode);
 
@@ -104,7 +150,7 @@ void ffmpeg_decode_free(struct ffmpeg_decode *decode)
 		av_frame_free(&decode->frame);
 
 	if (decode->hw_device_ctx)
-		av_buffer_unref(&decode->hw_device_ctx);
+		release_hw_decoder(decode);
 
 	if (decode->packet_buffer)
 		bfree(decode->packet_buffer);
@@ -112,6 +158,21 @@ void ffmpeg_decode_free(struct ffmpeg_decode *decode)
 	memset(decode, 0, sizeof(*decode));
 }
 
+void ffmpeg_decode_log_stats(struct ffmpeg_decode *decode, const char *name)
+{
+	if (!decode->decoded_frames)
+		return;
+
+	blog(LOG_INFO, "%s: decoded %" PRIu64 " %s frames (%s), average %.2f ms, max %.2f ms", name,
+	     decode->decoded_frames, decode->codec->name, decode->hw ? "hardware" : "software",
+	     (double)decode->decode_time_ns / (double)decode->decoded_frames / 1000000.0,
+	     (double)decode->max_decode_ns / 1000000.0);
+
+	decode->decoded_frames = 0;
+	decode->decode_time_ns = 0;
+	decode->max_decode_ns = 0;
+}
+
 static inline enum video_format convert_pixel_format(int f)
 {
 	switch (f) {
@@ -291,6 +352,7 @@ bool ffmpeg_decode_video(struct ffmpeg_decode *decode, uint8_t *data, size_t siz
 {
 	int got_frame = false;
 	AVFrame *out_frame;
+	uint64_t start = os_gettime_ns();
 	int ret;
 
 	*got_output = false;
@@ -409,6 +471,12 @@ bool ffmpeg_decode_video(struct ffmpeg_decode *decode, uint8_t *data, size_t siz
 	if (frame->format == VIDEO_FORMAT_NONE)
 		return false;
 
+	const uint64_t elapsed = os_gettime_ns() - start;
+	decode->decoded_frames++;
+	decode->decode_time_ns += elapsed;
+	if (elapsed > decode->max_decode_ns)
+		decode->max_decode_ns = elapsed;
+
 	*got_output = true;
 	return true;
 }
@@ -44,6 +44,12 @@ struct ffmpeg_decode {
 	AVFrame *hw_frame;
 	AVFrame *frame;
 	bool hw;
+	bool hw_requested;
+
+	/* decode latency, from packet submission to a CPU side frame */
+	uint64_t decoded_frames;
+	uint64_t decode_time_ns;
+	uint64_t max_decode_ns;
 
 	uint8_t *packet_buffer;
 	size_t packet_size;
@@ -51,6 +57,7 @@ struct ffmpeg_decode {
 
 extern int ffmpeg_decode_init(struct ffmpeg_decode *decode, enum AVCodecID id, bool use_hw);
 extern void ffmpeg_decode_free(struct ffmpeg_decode *decode);
+extern void ffmpeg_decode_log_stats(struct ffmpeg_decode *decode, const char *name);
 
 extern bool ffmpeg_decode_audio(struct ffmpeg_decode *decode, uint8_t *data, size_t size,
 				struct obs_source_audio *audio, bool *got_output);
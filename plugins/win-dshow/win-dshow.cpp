@@ -480,7 +480,8 @@ void DShowInput::OnEncodedVideoData(enum AVCodecID id, unsigned char *data, size
 {
 	/* If format or hw decode changes, recreate the decoder */
 	if (ffmpeg_decode_valid(video_decoder) &&
-	    ((video_decoder->codec->id != id) || (video_decoder->hw != hw_decode))) {
+	    ((video_decoder->codec->id != id) || (video_decoder->hw_requested != hw_decode))) {
+		ffmpeg_decode_log_stats(video_decoder, obs_source_get_name(source));
 		ffmpeg_decode_free(video_decoder);
 	}
 
@@ -1143,6 +1144,9 @@ inline void DShowInput::Deactivate()
 {
 	device.ResetGraph();
 	obs_source_output_video2(source, nullptr);
+
+	if (ffmpeg_decode_valid(video_decoder))
+		ffmpeg_decode_log_stats(video_decoder, obs_source_get_name(source));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -14,8 +14,11 @@
 #include <util/threading.h>
 #include <util/util_uint64.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
+#include <mutex>
+#include <unordered_map>
 
 #include <audioclientactivationparams.h>
 #include <avrt.h>
@@ -164,6 +167,9 @@ class WASAPISource {
 	string executable;
 	HWND hwnd = NULL;
 	DWORD process_id = 0;
+	DWORD shared_process_id = 0;
+	bool process_owner = false;
+	bool process_listener = false;
 	const SourceType sourceType;
 	std::atomic<bool> useDeviceTiming = false;
 	std::atomic<bool> isDefaultDevice = false;
@@ -229,11 +235,18 @@ class WASAPISource {
 	uint32_t sampleRate;
 
 	vector<BYTE> silence;
+	vector<BYTE> packet;
 
 	static DWORD WINAPI ReconnectThread(LPVOID param);
 	static DWORD WINAPI CaptureThread(LPVOID param);
 
 	bool ProcessCaptureData();
+	void OutputAudio(const obs_source_audio *data);
+	void OutputToListeners(const obs_source_audio *data);
+	bool JoinProcessShare();
+	void RegisterProcessOwner();
+	void LeaveProcessShare();
+	void StopCapture();
 
 	void Start();
 	void Stop();
@@ -247,6 +260,7 @@ class WASAPISource {
 			       uint32_t &sampleRate);
 	static void ClearBuffer(IMMDevice *device);
 	static ComPtr<IAudioCaptureClient> InitCapture(IAudioClient *client, HANDLE receiveSignal);
+	void InitializeClient(IMMDevice *device);
 	void Initialize();
 
 	bool TryInitialize();
@@ -387,7 +401,9 @@ WASAPISource::WASAPISource(obs_data_t *settings, obs_source_t *source_, SourceTy
 
 			DWORD taskId = 0;
 			DWORD id = 0;
-			hr = rtwq_lock_shared_work_queue(L"Capture", 0, &taskId, &id);
+			hr = rtwq_lock_shared_work_queue(L"Pro Audio", 0, &taskId, &id);
+			if (FAILED(hr))
+				hr = rtwq_lock_shared_work_queue(L"Capture", 0, &taskId, &id);
 			if (FAILED(hr)) {
 				throw HRError("RtwqLockSharedWorkQueue failed", hr);
 			}
@@ -808,6 +824,38 @@ ComPtr<IAudioCaptureClient> WASAPISource::InitCapture(IAudioClient *client, HAND
 	return capture;
 }
 
+void WASAPISource::InitializeClient(IMMDevice *device)
+{
+	ComPtr<IAudioClient> temp_client = InitClient(device, sourceType, process_id, activate_audio_interface_async,
+						      speakers, format, sampleRate);
+	if (sourceType == SourceType::DeviceOutput)
+		ClearBuffer(device);
+	ComPtr<IAudioCaptureClient> temp_capture = InitCapture(temp_client, receiveSignal);
+
+	client = std::move(temp_client);
+	capture = std::move(temp_capture);
+
+	if (sourceType == SourceType::ProcessOutput)
+		RegisterProcessOwner();
+
+	if (rtwq_supported) {
+		HRESULT hr = rtwq_put_waiting_work_item(receiveSignal, 0, sampleReadyAsyncResult, nullptr);
+		if (FAILED(hr)) {
+			StopCapture();
+			throw HRError("RtwqPutWaitingWorkItem failed", hr);
+		}
+
+		hr = rtwq_put_waiting_work_item(restartSignal, 0, restartAsyncResult, nullptr);
+		if (FAILED(hr)) {
+			StopCapture();
+			throw HRError("RtwqPutWaitingWorkItem failed", hr);
+		}
+	}
+
+	blog(LOG_INFO, "WASAPI: Device '%s' [%" PRIu32 " Hz] initialized (source: %s)", device_name.c_str(), sampleRate,
+	     obs_source_get_name(source));
+}
+
 void WASAPISource::Initialize()
 {
 	ComPtr<IMMDevice> device;
@@ -834,34 +882,23 @@ void WASAPISource::Initialize()
 
 	ResetEvent(receiveSignal);
 
-	ComPtr<IAudioClient> temp_client = InitClient(device, sourceType, process_id, activate_audio_interface_async,
-						      speakers, format, sampleRate);
-	if (sourceType == SourceType::DeviceOutput)
-		ClearBuffer(device);
-	ComPtr<IAudioCaptureClient> temp_capture = InitCapture(temp_client, receiveSignal);
-
-	client = std::move(temp_client);
-	capture = std::move(temp_capture);
-
-	if (rtwq_supported) {
-		HRESULT hr = rtwq_put_waiting_work_item(receiveSignal, 0, sampleReadyAsyncResult, nullptr);
-		if (FAILED(hr)) {
-			capture.Clear();
-			client.Clear();
-			throw HRError("RtwqPutWaitingWorkItem failed", hr);
+	if (sourceType == SourceType::ProcessOutput && JoinProcessShare()) {
+		if (rtwq_supported) {
+			HRESULT hr = rtwq_put_waiting_work_item(receiveSignal, 0, sampleReadyAsyncResult, nullptr);
+			if (SUCCEEDED(hr))
+				hr = rtwq_put_waiting_work_item(restartSignal, 0, restartAsyncResult, nullptr);
+			if (FAILED(hr)) {
+				LeaveProcessShare();
+				throw HRError("RtwqPutWaitingWorkItem failed", hr);
+			}
 		}
 
-		hr = rtwq_put_waiting_work_item(restartSignal, 0, restartAsyncResult, nullptr);
-		if (FAILED(hr)) {
-			capture.Clear();
-			client.Clear();
-			throw HRError("RtwqPutWaitingWorkItem failed", hr);
-		}
+		blog(LOG_INFO, "WASAPI: Process %lu capture shared (source: %s)", process_id,
+		     obs_source_get_name(source));
+	} else {
+		InitializeClient(device);
 	}
 
-	blog(LOG_INFO, "WASAPI: Device '%s' [%" PRIu32 " Hz] initialized (source: %s)", device_name.c_str(), sampleRate,
-	     obs_source_get_name(source));
-
 	if (sourceType == SourceType::ProcessOutput && !hooked) {
 		hooked = true;
 
@@ -947,6 +984,117 @@ DWORD WINAPI WASAPISource::ReconnectThread(LPVOID param)
 	return 0;
 }
 
+/* Process loopback captures of the same process share one activation: the
+ * first source to start owns the audio client and hands each packet to the
+ * other sources capturing that process, which keep no client of their own. */
+struct ProcessShare {
+	WASAPISource *owner = nullptr;
+	vector<WASAPISource *> listeners;
+};
+
+static std::mutex process_shares_mutex;
+static std::unordered_map<DWORD, ProcessShare> process_shares;
+
+bool WASAPISource::JoinProcessShare()
+{
+	std::lock_guard<std::mutex> lock(process_shares_mutex);
+
+	auto it = process_shares.find(process_id);
+	if (it == process_shares.end() || !it->second.owner)
+		return false;
+
+	it->second.listeners.push_back(this);
+	shared_process_id = process_id;
+	process_listener = true;
+	return true;
+}
+
+void WASAPISource::RegisterProcessOwner()
+{
+	std::lock_guard<std::mutex> lock(process_shares_mutex);
+
+	/* another source started capturing the process concurrently, keep
+	 * this activation private rather than replacing its owner */
+	ProcessShare &share = process_shares[process_id];
+	if (share.owner)
+		return;
+
+	share.owner = this;
+	shared_process_id = process_id;
+	process_owner = true;
+}
+
+void WASAPISource::LeaveProcessShare()
+{
+	if (!process_owner && !process_listener)
+		return;
+
+	std::lock_guard<std::mutex> lock(process_shares_mutex);
+
+	auto it = process_shares.find(shared_process_id);
+	if (it != process_shares.end()) {
+		ProcessShare &share = it->second;
+
+		if (process_owner) {
+			/* the listeners restart, and the first of them to
+			 * initialize again takes over the activation */
+			for (WASAPISource *listener : share.listeners)
+				SetEvent(listener->restartSignal);
+			share.owner = nullptr;
+		} else {
+			auto listener = find(share.listeners.begin(), share.listeners.end(), this);
+			if (listener != share.listeners.end())
+				share.listeners.erase(listener);
+		}
+
+		if (!share.owner && share.listeners.empty())
+			process_shares.erase(it);
+	}
+
+	process_owner = false;
+	process_listener = false;
+}
+
+void WASAPISource::StopCapture()
+{
+	if (client) {
+		client->Stop();
+
+		capture.Clear();
+		client.Clear();
+	}
+
+	LeaveProcessShare();
+}
+
+void WASAPISource::OutputAudio(const obs_source_audio *data)
+{
+	if (reroute_target) {
+		obs_source_t *target = obs_weak_source_get_source(reroute_target);
+
+		if (target) {
+			obs_source_output_audio(target, data);
+			obs_source_release(target);
+		}
+	} else {
+		obs_source_output_audio(source, data);
+	}
+}
+
+void WASAPISource::OutputToListeners(const obs_source_audio *data)
+{
+	std::lock_guard<std::mutex> lock(process_shares_mutex);
+
+	auto it = process_shares.find(shared_process_id);
+	if (it == process_shares.end())
+		return;
+
+	for (WASAPISource *listener : it->second.listeners) {
+		listener->OutputAudio(data);
+		SetEvent(listener->receiveSignal);
+	}
+}
+
 bool WASAPISource::ProcessCaptureData()
 {
 	HRESULT res;
@@ -956,6 +1104,15 @@ bool WASAPISource::ProcessCaptureData()
 	UINT64 pos, ts;
 	UINT captureSize = 0;
 
+	/* packets are output by the source owning the process activation */
+	if (process_listener) {
+		if (!IsWindow(hwnd)) {
+			blog(LOG_WARNING, "[WASAPISource::ProcessCaptureData] window disappeared");
+			return false;
+		}
+		return true;
+	}
+
 	while (true) {
 		if ((sourceType == SourceType::ProcessOutput) && !IsWindow(hwnd)) {
 			blog(LOG_WARNING, "[WASAPISource::ProcessCaptureData] window disappeared");
@@ -1002,8 +1159,16 @@ bool WASAPISource::ProcessCaptureData()
 				silence.resize(requiredBufSize);
 
 			buffer = silence.data();
+		} else {
+			/* copy the packet out so the device buffer is released
+			 * before the audio is handed to libobs */
+			const size_t size = (size_t)get_audio_channels(speakers) * frames * 4;
+			packet.assign(buffer, buffer + size);
+			buffer = packet.data();
 		}
 
+		capture->ReleaseBuffer(frames);
+
 		obs_source_audio data = {};
 		data.data[0] = buffer;
 		data.frames = frames;
@@ -1019,18 +1184,10 @@ bool WASAPISource::ProcessCaptureData()
 				data.timestamp -= util_mul_div64(frames, UINT64_C(1000000000), sampleRate);
 		}
 
-		if (reroute_target) {
-			obs_source_t *target = obs_weak_source_get_source(reroute_target);
-
-			if (target) {
-				obs_source_output_audio(target, &data);
-				obs_source_release(target);
-			}
-		} else {
-			obs_source_output_audio(source, &data);
-		}
+		OutputAudio(&data);
 
-		capture->ReleaseBuffer(frames);
+		if (process_owner)
+			OutputToListeners(&data);
 	}
 
 	return true;
@@ -1052,7 +1209,11 @@ DWORD WINAPI WASAPISource::CaptureThread(LPVOID param)
 	}
 
 	DWORD unused = 0;
-	const HANDLE handle = AvSetMmThreadCharacteristics(L"Audio", &unused);
+	HANDLE handle = AvSetMmThreadCharacteristics(L"Pro Audio", &unused);
+	if (!handle)
+		handle = AvSetMmThreadCharacteristics(L"Audio", &unused);
+	if (handle)
+		AvSetMmThreadPriority(handle, AVRT_PRIORITY_HIGH);
 
 	WASAPISource *source = (WASAPISource *)param;
 
@@ -1149,12 +1310,7 @@ DWORD WINAPI WASAPISource::CaptureThread(LPVOID param)
 		sig_count = _countof(inactive_sigs);
 		sigs = inactive_sigs;
 
-		if (source->client) {
-			source->client->Stop();
-
-			source->capture.Clear();
-			source->client.Clear();
-		}
+		source->StopCapture();
 
 		if (idle) {
 			SetEvent(source->idleSignal);
@@ -1265,10 +1421,7 @@ void WASAPISource::OnSampleReady()
 	}
 
 	if (stop) {
-		client->Stop();
-
-		capture.Clear();
-		client.Clear();
+		StopCapture();
 
 		if (reconnect) {
 			blog(LOG_INFO, "Device '%s' invalidated.  Retrying (source: %s)", device_name.c_str(),
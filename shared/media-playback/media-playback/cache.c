@@ -15,8 +15,11 @@
  */
 
 #include <media-io/audio-io.h>
+#include <media-io/video-frame.h>
 #include <util/platform.h>
 
+#include <libavutil/imgutils.h>
+
 #include "media-playback.h"
 #include "cache.h"
 #include "media.h"
@@ -27,11 +30,62 @@ extern bool mp_media_eof(mp_media_t *m);
 extern void mp_media_next_video(mp_media_t *m, bool preload);
 extern void mp_media_next_audio(mp_media_t *m);
 extern bool mp_media_reset(mp_media_t *m);
+extern enum AVPixelFormat mp_media_cache_format(enum AVPixelFormat fmt);
 
 static bool mp_cache_reset(mp_cache_t *c);
 
 static int64_t base_sys_ts = 0;
 
+/* the decoded media of all caches shares one budget, so many small clips
+ * can stay cached at the same time while one that doesn't fit is played
+ * back from the decoder.  0 until set, which means a quarter of the system
+ * memory */
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t cache_budget = 0;
+static size_t cache_reserved = 0;
+
+static inline size_t get_cache_budget(void)
+{
+	if (!cache_budget)
+		cache_budget = (size_t)(os_get_sys_total_size() / 4);
+	return cache_budget;
+}
+
+/* resizes the part of the budget held by this cache, only fails to grow it
+ * past the budget unless forced */
+static bool mp_cache_reserve(mp_cache_t *c, size_t size, bool force)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&budget_mutex);
+	size_t others = cache_reserved - c->reserved_bytes;
+	if (!force && size > c->reserved_bytes && others + size > get_cache_budget()) {
+		success = false;
+	} else {
+		cache_reserved = others + size;
+		c->reserved_bytes = size;
+	}
+	pthread_mutex_unlock(&budget_mutex);
+
+	return success;
+}
+
+void mp_cache_set_budget(size_t budget)
+{
+	pthread_mutex_lock(&budget_mutex);
+	cache_budget = budget;
+	pthread_mutex_unlock(&budget_mutex);
+}
+
+size_t mp_cache_get_total_size(void)
+{
+	pthread_mutex_lock(&budget_mutex);
+	size_t size = cache_reserved;
+	pthread_mutex_unlock(&budget_mutex);
+
+	return size;
+}
+
 #define v_eof(c) (c->cur_v_idx == c->video_frames.num)
 #define a_eof(c) (c->cur_a_idx == c->audio_segments.num)
 
@@ -120,6 +174,24 @@ bool mp_cache_decode(mp_cache_t *c)
 	mp_media_reset(m);
 
 	while (!mp_media_eof(m)) {
+		if (c->cache_limit && c->cache_bytes > c->cache_limit) {
+			blog(LOG_WARNING,
+			     "MP: Decoded media exceeded the cache limit of %zu MB, "
+			     "truncating after %zu frames",
+			     c->cache_limit / (1024 * 1024), c->video_frames.num);
+			break;
+		}
+
+		/* the estimate was low, grow the reservation in steps */
+		size_t reserve = c->cache_bytes + c->cache_bytes / 8;
+		if (c->cache_bytes > c->reserved_bytes && !mp_cache_reserve(c, reserve, false)) {
+			blog(LOG_WARNING,
+			     "MP: Decoded media exceeded the shared cache budget of %zu MB, "
+			     "truncating after %zu frames",
+			     get_cache_budget() / (1024 * 1024), c->video_frames.num);
+			break;
+		}
+
 		if (m->has_video)
 			mp_media_next_video(m, false);
 		if (m->has_audio)
@@ -130,6 +202,10 @@ bool mp_cache_decode(mp_cache_t *c)
 	}
 
 	success = true;
+	mp_cache_reserve(c, c->cache_bytes, true);
+
+	blog(LOG_DEBUG, "MP: Cached %zu video frames and %zu audio segments (%zu MB)", c->video_frames.num,
+	     c->audio_segments.num, c->cache_bytes / (1024 * 1024));
 
 	c->start_time = c->m.fmt->start_time;
 	if (c->start_time == AV_NOPTS_VALUE)
@@ -140,6 +216,40 @@ fail:
 	return success;
 }
 
+/* frames and segments are cached in timestamp order, so seeking is a
+ * binary search for the first one at or after the position, or the last */
+static size_t find_video_frame(mp_cache_t *c, int64_t pos)
+{
+	size_t lo = 0;
+	size_t hi = c->video_frames.num - 1;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((int64_t)c->video_frames.array[mid].timestamp >= pos)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+static size_t find_audio_segment(mp_cache_t *c, int64_t pos)
+{
+	size_t lo = 0;
+	size_t hi = c->audio_segments.num - 1;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((int64_t)c->audio_segments.array[mid].timestamp >= pos)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
 static void seek_to(mp_cache_t *c, int64_t pos)
 {
 	size_t new_v_idx = 0;
@@ -150,16 +260,9 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		return;
 	}
 
-	if (c->has_video) {
-		struct obs_source_frame *v;
-
-		for (size_t i = 0; i < c->video_frames.num; i++) {
-			v = &c->video_frames.array[i];
-			new_v_idx = i;
-			if ((int64_t)v->timestamp >= pos) {
-				break;
-			}
-		}
+	if (c->has_video && c->video_frames.num) {
+		new_v_idx = find_video_frame(c, pos);
+		struct obs_source_frame *v = &c->video_frames.array[new_v_idx];
 
 		size_t next_idx = new_v_idx + 1;
 		if (next_idx == c->video_frames.num) {
@@ -169,15 +272,9 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 			c->next_v_ts = (int64_t)next->timestamp;
 		}
 	}
-	if (c->has_audio) {
-		struct obs_source_audio *a;
-		for (size_t i = 0; i < c->audio_segments.num; i++) {
-			a = &c->audio_segments.array[i];
-			new_a_idx = i;
-			if ((int64_t)a->timestamp >= pos) {
-				break;
-			}
-		}
+	if (c->has_audio && c->audio_segments.num) {
+		new_a_idx = find_audio_segment(c, pos);
+		struct obs_source_audio *a = &c->audio_segments.array[new_a_idx];
 
 		size_t next_idx = new_a_idx + 1;
 		if (next_idx == c->audio_segments.num) {
@@ -465,6 +562,49 @@ static void *mp_cache_thread_start(void *opaque)
 	return NULL;
 }
 
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	size_t size = 0;
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		size += (size_t)frame->linesize[i] * heights[i];
+	return size;
+}
+
+/* estimated size of the fully decoded media, before decoding any of it */
+static size_t estimate_cache_size(mp_cache_t *c)
+{
+	mp_media_t *m = &c->m;
+	double seconds = m->fmt->duration != AV_NOPTS_VALUE ? (double)m->fmt->duration / AV_TIME_BASE : 0.0;
+	double size = 0.0;
+
+	if (m->has_video) {
+		AVStream *stream = m->v.stream;
+		AVCodecContext *decoder = m->v.decoder;
+		double frames = (double)stream->nb_frames;
+		enum AVPixelFormat format = mp_media_cache_format(decoder->pix_fmt);
+		int frame_size = av_image_get_buffer_size(format, decoder->width, decoder->height, 1);
+
+		/* hardware formats have no size of their own, assume 4:2:0 */
+		if (frame_size <= 0)
+			frame_size = decoder->width * decoder->height * 3 / 2;
+		if (frames <= 0.0 && stream->avg_frame_rate.num && stream->avg_frame_rate.den)
+			frames = seconds * av_q2d(stream->avg_frame_rate);
+
+		size += frames * frame_size;
+	}
+
+	if (m->has_audio) {
+		AVCodecContext *decoder = m->a.decoder;
+		size += seconds * decoder->sample_rate * decoder->ch_layout.nb_channels * sizeof(float);
+	}
+
+	return (size_t)size;
+}
+
 static void fill_video(void *data, struct obs_source_frame *frame)
 {
 	mp_cache_t *c = data;
@@ -476,6 +616,7 @@ static void fill_video(void *data, struct obs_source_frame *frame)
 	dup.timestamp = frame->timestamp;
 
 	c->final_v_duration = c->m.v.last_duration;
+	c->cache_bytes += get_frame_size(&dup);
 
 	da_push_back(c->video_frames, &dup);
 }
@@ -505,6 +646,7 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 	}
 
 	c->final_a_duration = c->m.a.last_duration;
+	c->cache_bytes += get_total_audio_size(dup.format, dup.speakers, dup.frames);
 
 	da_push_back(c->audio_segments, &dup);
 }
@@ -532,7 +674,7 @@ static inline bool mp_cache_init_internal(mp_cache_t *c, const struct mp_media_i
 	return true;
 }
 
-bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
+bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info, bool *over_limit)
 {
 	struct mp_media_info info2 = *info;
 
@@ -541,6 +683,7 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	info2.a_cb = fill_audio;
 	info2.v_preload_cb = NULL;
 	info2.v_seek_cb = NULL;
+	info2.v_texture_cb = NULL;
 	info2.stop_cb = NULL;
 	info2.full_decode = true;
 
@@ -557,6 +700,28 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 		return false;
 	}
 
+	size_t estimate = estimate_cache_size(c);
+
+	if (info->cache_limit && estimate > info->cache_limit) {
+		blog(LOG_INFO,
+		     "MP: '%s' would take ~%zu MB decoded, over the limit of %zu MB, "
+		     "decoding it during playback instead",
+		     info->path, estimate / (1024 * 1024), info->cache_limit / (1024 * 1024));
+		mp_cache_free(c);
+		*over_limit = true;
+		return false;
+	}
+	if (!mp_cache_reserve(c, estimate, false)) {
+		blog(LOG_INFO,
+		     "MP: '%s' would take ~%zu MB decoded, more than is left of the shared "
+		     "cache budget of %zu MB, decoding it during playback instead",
+		     info->path, estimate / (1024 * 1024), get_cache_budget() / (1024 * 1024));
+		mp_cache_free(c);
+		*over_limit = true;
+		return false;
+	}
+
+	c->cache_limit = info->cache_limit;
 	c->opaque = info->opaque;
 	c->v_cb = info->v_cb;
 	c->a_cb = info->a_cb;
@@ -615,6 +780,7 @@ void mp_cache_free(mp_cache_t *c)
 	}
 	da_free(c->video_frames);
 	da_free(c->audio_segments);
+	mp_cache_reserve(c, 0, true);
 
 	bfree(c->path);
 	bfree(c->format_name);
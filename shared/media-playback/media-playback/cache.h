@@ -53,6 +53,9 @@ struct mp_cache {
 
 	DARRAY(struct obs_source_frame) video_frames;
 	DARRAY(struct obs_source_audio) audio_segments;
+	size_t cache_limit;
+	size_t cache_bytes;
+	size_t reserved_bytes;
 
 	size_t cur_v_idx;
 	size_t cur_a_idx;
@@ -84,7 +87,7 @@ struct mp_cache {
 
 typedef struct mp_cache mp_cache_t;
 
-extern bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info);
+extern bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info, bool *over_limit);
 extern void mp_cache_free(mp_cache_t *c);
 
 extern void mp_cache_play(mp_cache_t *c, bool loop);
@@ -95,3 +98,6 @@ extern int64_t mp_cache_get_current_time(mp_cache_t *c);
 extern void mp_cache_seek(mp_cache_t *c, int64_t pos);
 extern int64_t mp_cache_get_frames(mp_cache_t *c);
 extern int64_t mp_cache_get_duration(mp_cache_t *c);
+
+extern void mp_cache_set_budget(size_t budget);
+extern size_t mp_cache_get_total_size(void);
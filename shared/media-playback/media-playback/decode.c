@@ -18,8 +18,13 @@
 
 #include "media-playback.h"
 #include "media.h"
+#include "texture.h"
 #include <libavutil/mastering_display_metadata.h>
 
+/* surfaces that can be lent out as textures on top of the ones the decoder
+ * needs, more are downloaded instead */
+#define LENT_HW_FRAMES 8
+
 enum AVHWDeviceType hw_priority[] = {
 	AV_HWDEVICE_TYPE_CUDA,  AV_HWDEVICE_TYPE_D3D11VA, AV_HWDEVICE_TYPE_DXVA2,        AV_HWDEVICE_TYPE_VAAPI,
 	AV_HWDEVICE_TYPE_VDPAU, AV_HWDEVICE_TYPE_QSV,     AV_HWDEVICE_TYPE_VIDEOTOOLBOX, AV_HWDEVICE_TYPE_NONE,
@@ -61,10 +66,22 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 		c->hw_device_ctx = av_buffer_ref(hw_ctx);
 		c->opaque = d;
 		d->hw_ctx = hw_ctx;
+		d->hw_type = *priority;
 		d->hw = true;
 	}
 }
 
+static void init_zero_copy(struct mp_decode *d, AVCodecContext *c)
+{
+	if (d->audio || !d->m->v_texture_cb || !mp_texture_supported(d->hw_type))
+		return;
+
+	/* the pool has a fixed size, lent surfaces must not starve it */
+	c->extra_hw_frames = LENT_HW_FRAMES;
+	d->lender = mp_texture_lender_create(LENT_HW_FRAMES);
+	d->zero_copy = true;
+}
+
 static int mp_open_codec(struct mp_decode *d, bool hw)
 {
 	AVCodecContext *c;
@@ -84,6 +101,8 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 
 	if (hw)
 		init_hw_decoder(d, c);
+	if (d->hw)
+		init_zero_copy(d, c);
 
 	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG && c->codec_id != AV_CODEC_ID_TIFF &&
 	    c->codec_id != AV_CODEC_ID_JPEG2000 && c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
@@ -240,6 +259,8 @@ void mp_decode_free(struct mp_decode *d)
 		av_buffer_unref(&d->hw_ctx);
 	}
 
+	mp_texture_lender_release(d->lender);
+
 	memset(d, 0, sizeof(*d));
 }
 
@@ -299,18 +320,12 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 	}
 
 	if (*got_frame && d->hw) {
-		if (d->hw_frame->format != d->hw_format) {
+		if (d->hw_frame->format != d->hw_format || d->zero_copy) {
 			d->frame = d->hw_frame;
 			return ret;
 		}
 
-		av_frame_unref(d->sw_frame);
-
-		int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
-		if (err == 0) {
-			err = av_frame_copy_props(d->sw_frame, d->hw_frame);
-		}
-		if (err) {
+		if (!mp_decode_download(d)) {
 			ret = 0;
 			*got_frame = false;
 		}
@@ -320,6 +335,31 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 	return ret;
 }
 
+bool mp_decode_download(struct mp_decode *d)
+{
+	av_frame_unref(d->sw_frame);
+
+	int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
+	if (err == 0) {
+		err = av_frame_copy_props(d->sw_frame, d->hw_frame);
+	}
+
+	d->frame = d->sw_frame;
+	return err == 0;
+}
+
+/* the format of the data of the current frame, which for hardware frames
+ * isn't the format of the frame itself */
+enum AVPixelFormat mp_decode_get_sw_format(const struct mp_decode *d)
+{
+	const AVFrame *f = d->frame;
+
+	if (f == d->hw_frame && f->format == d->hw_format && f->hw_frames_ctx)
+		return ((const AVHWFramesContext *)f->hw_frames_ctx->data)->sw_format;
+
+	return f->format;
+}
+
 bool mp_decode_next(struct mp_decode *d)
 {
 	bool eof = d->m->eof;
@@ -37,6 +37,7 @@ extern "C" {
 #endif
 
 struct mp_media;
+struct mp_texture_lender;
 
 struct mp_decode {
 	struct mp_media *m;
@@ -55,12 +56,19 @@ struct mp_decode {
 	AVFrame *hw_frame;
 	AVFrame *frame;
 	enum AVPixelFormat hw_format;
+	enum AVHWDeviceType hw_type;
 	bool got_first_keyframe;
 	bool frame_ready;
 	bool eof;
 	bool hw;
 	uint16_t max_luminance;
 
+	/* hardware frames are kept on the GPU and lent out as textures,
+	 * mp_decode_download gets their data where that isn't possible */
+	bool zero_copy;
+	struct mp_texture_lender *lender;
+	int lend_retry;
+
 	AVPacket *orig_pkt;
 	AVPacket *pkt;
 	bool packet_pending;
@@ -74,6 +82,8 @@ extern void mp_decode_clear_packets(struct mp_decode *decode);
 
 extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
+extern bool mp_decode_download(struct mp_decode *decode);
+extern enum AVPixelFormat mp_decode_get_sw_format(const struct mp_decode *decode);
 extern void mp_decode_flush(struct mp_decode *decode);
 
 #ifdef __cplusplus
@@ -31,8 +31,21 @@ media_playback_t *media_playback_create(const struct mp_media_info *info)
 	media_playback_t *mp = bzalloc(sizeof(*mp));
 	mp->is_cached = info->is_local_file && info->full_decode;
 
-	if ((mp->is_cached && !mp_cache_init(&mp->cache, info)) ||
-	    (!mp->is_cached && !mp_media_init(&mp->media, info))) {
+	if (mp->is_cached) {
+		bool over_limit = false;
+
+		if (!mp_cache_init(&mp->cache, info, &over_limit)) {
+			if (!over_limit) {
+				bfree(mp);
+				return NULL;
+			}
+
+			/* too large to hold decoded, stream it instead */
+			mp->is_cached = false;
+		}
+	}
+
+	if (!mp->is_cached && !mp_media_init(&mp->media, info)) {
 		bfree(mp);
 		return NULL;
 	}
@@ -174,3 +187,13 @@ bool media_playback_has_audio(media_playback_t *mp)
 	else
 		return mp->media.has_audio;
 }
+
+void media_playback_set_cache_budget(size_t budget)
+{
+	mp_cache_set_budget(budget);
+}
+
+size_t media_playback_get_cache_size(void)
+{
+	return mp_cache_get_total_size();
+}
@@ -22,6 +22,12 @@ struct media_playback;
 typedef struct media_playback media_playback_t;
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+
+/* hands over a frame whose planes are in textures, see
+ * obs_source_lend_video_textures.  returns false if it wasn't taken, the
+ * frame is then downloaded and given to v_cb instead */
+typedef bool (*mp_texture_cb)(void *opaque, struct obs_source_frame *frame, gs_texture_t *const *textures,
+			      obs_source_frame_release_t release, void *param);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
@@ -31,6 +37,7 @@ struct mp_media_info {
 	mp_video_cb v_cb;
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
+	mp_texture_cb v_texture_cb;
 	mp_audio_cb a_cb;
 	mp_stop_cb stop_cb;
 
@@ -46,6 +53,11 @@ struct mp_media_info {
 	bool reconnecting;
 	bool request_preload;
 	bool full_decode;
+
+	/* upper bound in bytes of a full decode, 0 for no limit.  media
+	 * expected to exceed it, or what is left of the budget shared by all
+	 * cached media, is played back from the decoder instead */
+	size_t cache_limit;
 };
 
 extern media_playback_t *media_playback_create(const struct mp_media_info *info);
@@ -63,3 +75,8 @@ extern int64_t media_playback_get_frames(media_playback_t *mp);
 extern int64_t media_playback_get_duration(media_playback_t *mp);
 extern bool media_playback_has_video(media_playback_t *mp);
 extern bool media_playback_has_audio(media_playback_t *mp);
+
+/* the memory all fully decoded media may take together, in bytes.  0
+ * means a quarter of the system memory, which is the default */
+extern void media_playback_set_cache_budget(size_t budget);
+extern size_t media_playback_get_cache_size(void);
@@ -21,6 +21,7 @@
 #include "media-playback.h"
 #include "media.h"
 #include "closest-format.h"
+#include "texture.h"
 
 #include <libavdevice/avdevice.h>
 #include <libavutil/imgutils.h>
@@ -235,6 +236,28 @@ static inline int get_sws_range(enum AVColorRange r)
 
 #define FIXED_1_0 (1 << 16)
 
+/* fully decoded media is held in memory, so 4:2:2 and 4:4:4 frames are
+ * stored as 4:2:0, which libobs draws the same way at half or less of the
+ * size.  frames with alpha or in RGB are kept as they are */
+enum AVPixelFormat mp_media_cache_format(enum AVPixelFormat fmt)
+{
+	enum AVPixelFormat closest = closest_format(fmt);
+
+	switch (closest) {
+	case AV_PIX_FMT_YUV444P:
+	case AV_PIX_FMT_YUV422P:
+	case AV_PIX_FMT_YUYV422:
+	case AV_PIX_FMT_UYVY422:
+	case AV_PIX_FMT_YVYU422:
+		return AV_PIX_FMT_NV12;
+	case AV_PIX_FMT_YUV444P12LE:
+	case AV_PIX_FMT_YUV422P10LE:
+		return AV_PIX_FMT_P010LE;
+	default:
+		return closest;
+	}
+}
+
 static bool mp_media_init_scaling(mp_media_t *m)
 {
 	int space = get_sws_colorspace(m->v.frame->colorspace);
@@ -294,8 +317,17 @@ bool mp_media_prepare_frames(mp_media_t *m)
 	}
 
 	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
+		enum AVPixelFormat format = mp_decode_get_sw_format(&m->v);
+
+		/* textures are only lent in formats libobs converts itself */
+		if (m->v.zero_copy && format != AV_PIX_FMT_NV12 && format != AV_PIX_FMT_P010LE) {
+			m->v.zero_copy = false;
+			if (format != m->v.frame->format && !mp_decode_download(&m->v))
+				return false;
+		}
+
+		m->scale_format = m->full_decode ? mp_media_cache_format(format) : closest_format(format);
+		if (m->scale_format != format) {
 			if (!mp_media_init_scaling(m)) {
 				return false;
 			}
@@ -373,6 +405,67 @@ void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static bool mp_media_set_frame_data(mp_media_t *m, const AVFrame *f, struct obs_source_frame *frame)
+{
+	bool flip = false;
+	if (m->swscale) {
+		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data, f->linesize, 0, f->height,
+				    m->scale_pic, m->scale_linesizes);
+		if (ret < 0)
+			return false;
+
+		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
+		for (size_t i = 0; i < 4; i++) {
+			frame->data[i] = m->scale_pic[i];
+			frame->linesize[i] = abs(m->scale_linesizes[i]);
+		}
+
+	} else {
+		flip = f->linesize[0] < 0 && f->linesize[1] == 0;
+
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			frame->data[i] = f->data[i];
+			frame->linesize[i] = abs(f->linesize[i]);
+		}
+	}
+
+	if (flip)
+		frame->data[0] -= frame->linesize[0] * ((size_t)f->height - 1);
+
+	frame->flip = flip;
+	return true;
+}
+
+/* frames rejected by the source are downloaded for a while before lending
+ * is tried again */
+#define LEND_RETRY_FRAMES 120
+
+static bool mp_media_lend_textures(mp_media_t *m, struct mp_decode *d, struct obs_source_frame *frame)
+{
+	if (d->lend_retry) {
+		d->lend_retry--;
+		return false;
+	}
+
+	if (!mp_texture_lender_available(d->lender))
+		return false;
+
+	struct mp_texture_frame *tf = mp_texture_frame_create(d->lender, d->frame);
+	if (!tf) {
+		blog(LOG_INFO, "MP: Failed to import hardware frames, downloading them instead");
+		d->zero_copy = false;
+		return false;
+	}
+
+	if (!m->v_texture_cb(m->opaque, frame, tf->textures, mp_texture_frame_release, tf)) {
+		mp_texture_frame_release(tf);
+		d->lend_retry = LEND_RETRY_FRAMES;
+		return false;
+	}
+
+	return true;
+}
+
 void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -394,30 +487,24 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		return;
 	}
 
-	bool flip = false;
-	if (m->swscale) {
-		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data, f->linesize, 0, f->height,
-				    m->scale_pic, m->scale_linesizes);
-		if (ret < 0)
+	/* frames kept on the GPU are lent as textures, their data is only
+	 * downloaded where that isn't possible */
+	bool on_gpu = d->zero_copy && f == d->hw_frame && f->format == d->hw_format;
+	if (on_gpu && preload) {
+		if (!mp_decode_download(d))
 			return;
 
-		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
-		for (size_t i = 0; i < 4; i++) {
-			frame->data[i] = m->scale_pic[i];
-			frame->linesize[i] = abs(m->scale_linesizes[i]);
-		}
-
-	} else {
-		flip = f->linesize[0] < 0 && f->linesize[1] == 0;
-
-		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-			frame->data[i] = f->data[i];
-			frame->linesize[i] = abs(f->linesize[i]);
-		}
+		f = d->frame;
+		on_gpu = false;
 	}
 
-	if (flip)
-		frame->data[0] -= frame->linesize[0] * ((size_t)f->height - 1);
+	if (on_gpu) {
+		memset(frame->data, 0, sizeof(frame->data));
+		memset(frame->linesize, 0, sizeof(frame->linesize));
+		frame->flip = false;
+	} else if (!mp_media_set_frame_data(m, f, frame)) {
+		return;
+	}
 
 	new_format = convert_pixel_format(m->scale_format);
 	new_space = convert_color_space(f->colorspace, f->color_trc, f->color_primaries);
@@ -451,7 +538,6 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 	frame->width = f->width;
 	frame->height = f->height;
 	frame->max_luminance = d->max_luminance;
-	frame->flip = flip;
 	frame->flags = m->is_linear_alpha ? OBS_SOURCE_FRAME_LINEAR_ALPHA : 0;
 	switch (f->color_trc) {
 	case AVCOL_TRC_BT709:
@@ -485,6 +571,10 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		} else if (!m->request_preload) {
 			m->v_preload_cb(m->opaque, frame);
 		}
+	} else if (on_gpu) {
+		if (!mp_media_lend_textures(m, d, frame) && mp_decode_download(d) &&
+		    mp_media_set_frame_data(m, d->frame, frame))
+			m->v_cb(m->opaque, frame);
 	} else {
 		m->v_cb(m->opaque, frame);
 	}
@@ -873,6 +963,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	pthread_mutex_init_value(&media->mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_texture_cb = info->v_texture_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "texture.h"
+
+#include <util/bmem.h>
+#include <util/threading.h>
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
+#define HAVE_DMABUF_TEXTURES 1
+#include <libavutil/hwcontext_drm.h>
+#endif
+
+struct mp_texture_lender {
+	volatile long refs;
+	volatile long lent;
+	long max_lent;
+};
+
+struct mp_texture_lender *mp_texture_lender_create(long max_lent)
+{
+	struct mp_texture_lender *lender = bzalloc(sizeof(*lender));
+	lender->refs = 1;
+	lender->max_lent = max_lent;
+	return lender;
+}
+
+bool mp_texture_lender_available(struct mp_texture_lender *lender)
+{
+	return lender && os_atomic_load_long(&lender->lent) < lender->max_lent;
+}
+
+void mp_texture_lender_release(struct mp_texture_lender *lender)
+{
+	if (lender && os_atomic_dec_long(&lender->refs) == 0)
+		bfree(lender);
+}
+
+static void mp_texture_frame_destroy(struct mp_texture_frame *tf)
+{
+	obs_enter_graphics();
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		gs_texture_destroy(tf->textures[i]);
+	obs_leave_graphics();
+
+	av_frame_free(&tf->drm_frame);
+	bfree(tf);
+}
+
+void mp_texture_frame_release(void *param)
+{
+	struct mp_texture_frame *tf = param;
+	struct mp_texture_lender *lender = tf->lender;
+
+	mp_texture_frame_destroy(tf);
+
+	os_atomic_dec_long(&lender->lent);
+	mp_texture_lender_release(lender);
+}
+
+#ifdef HAVE_DMABUF_TEXTURES
+
+/* from drm_fourcc.h, which media-playback doesn't depend on */
+#define MP_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define MP_DRM_FORMAT_R8 MP_FOURCC('R', '8', ' ', ' ')
+#define MP_DRM_FORMAT_GR88 MP_FOURCC('G', 'R', '8', '8')
+#define MP_DRM_FORMAT_R16 MP_FOURCC('R', '1', '6', ' ')
+#define MP_DRM_FORMAT_GR1616 MP_FOURCC('G', 'R', '3', '2')
+#define MP_DRM_FORMAT_MOD_INVALID 0x00ffffffffffffffULL
+
+static enum gs_color_format get_layer_format(uint32_t drm_format)
+{
+	switch (drm_format) {
+	case MP_DRM_FORMAT_R8:
+		return GS_R8;
+	case MP_DRM_FORMAT_GR88:
+		return GS_R8G8;
+	case MP_DRM_FORMAT_R16:
+		return GS_R16;
+	case MP_DRM_FORMAT_GR1616:
+		return GS_RG16;
+	default:
+		return GS_UNKNOWN;
+	}
+}
+
+/* one texture per layer, assumes graphics */
+static gs_texture_t *import_layer(const AVDRMFrameDescriptor *desc, const AVDRMLayerDescriptor *layer,
+				  uint32_t width, uint32_t height)
+{
+	const enum gs_color_format format = get_layer_format(layer->format);
+	int fds[AV_DRM_MAX_PLANES];
+	uint32_t strides[AV_DRM_MAX_PLANES];
+	uint32_t offsets[AV_DRM_MAX_PLANES];
+	uint64_t modifiers[AV_DRM_MAX_PLANES];
+	bool use_modifiers = true;
+
+	if (format == GS_UNKNOWN || layer->nb_planes < 1)
+		return NULL;
+
+	for (int p = 0; p < layer->nb_planes; p++) {
+		const AVDRMPlaneDescriptor *plane = &layer->planes[p];
+		const AVDRMObjectDescriptor *object = &desc->objects[plane->object_index];
+
+		fds[p] = object->fd;
+		strides[p] = (uint32_t)plane->pitch;
+		offsets[p] = (uint32_t)plane->offset;
+		modifiers[p] = object->format_modifier;
+		if (object->format_modifier == MP_DRM_FORMAT_MOD_INVALID)
+			use_modifiers = false;
+	}
+
+	return gs_texture_create_from_dmabuf(width, height, layer->format, format, (uint32_t)layer->nb_planes, fds,
+					     strides, offsets, use_modifiers ? modifiers : NULL);
+}
+
+bool mp_texture_supported(enum AVHWDeviceType type)
+{
+	enum gs_dmabuf_flags flags;
+	uint32_t *formats = NULL;
+	size_t num_formats = 0;
+	bool supported;
+
+	if (type != AV_HWDEVICE_TYPE_VAAPI)
+		return false;
+
+	obs_enter_graphics();
+	supported = gs_query_dmabuf_capabilities(&flags, &formats, &num_formats);
+	obs_leave_graphics();
+
+	bfree(formats);
+	return supported;
+}
+
+struct mp_texture_frame *mp_texture_frame_create(struct mp_texture_lender *lender, const AVFrame *hw_frame)
+{
+	struct mp_texture_frame *tf = bzalloc(sizeof(*tf));
+	tf->drm_frame = av_frame_alloc();
+	tf->drm_frame->format = AV_PIX_FMT_DRM_PRIME;
+
+	/* the mapping holds a reference to the surface, so the decoder can't
+	 * reuse it while it's lent */
+	if (av_hwframe_map(tf->drm_frame, hw_frame, AV_HWFRAME_MAP_READ) != 0) {
+		av_frame_free(&tf->drm_frame);
+		bfree(tf);
+		return NULL;
+	}
+
+	const AVDRMFrameDescriptor *desc = (const AVDRMFrameDescriptor *)tf->drm_frame->data[0];
+	const uint32_t width = (uint32_t)hw_frame->width;
+	const uint32_t height = (uint32_t)hw_frame->height;
+	bool success = desc->nb_layers == 2;
+
+	/* NV12 and P010 surfaces are exported as a luma and a chroma layer */
+	obs_enter_graphics();
+	for (int l = 0; success && l < 2; l++) {
+		const uint32_t cx = l ? (width + 1) / 2 : width;
+		const uint32_t cy = l ? (height + 1) / 2 : height;
+
+		tf->textures[l] = import_layer(desc, &desc->layers[l], cx, cy);
+		success = tf->textures[l] != NULL;
+	}
+	obs_leave_graphics();
+
+	if (!success) {
+		mp_texture_frame_destroy(tf);
+		return NULL;
+	}
+
+	os_atomic_inc_long(&lender->refs);
+	os_atomic_inc_long(&lender->lent);
+	tf->lender = lender;
+	return tf;
+}
+
+#else
+
+bool mp_texture_supported(enum AVHWDeviceType type)
+{
+	UNUSED_PARAMETER(type);
+	return false;
+}
+
+struct mp_texture_frame *mp_texture_frame_create(struct mp_texture_lender *lender, const AVFrame *hw_frame)
+{
+	UNUSED_PARAMETER(lender);
+	UNUSED_PARAMETER(hw_frame);
+	return NULL;
+}
+
+#endif
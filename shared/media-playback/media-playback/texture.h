@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <obs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4204)
+#endif
+
+#include <libavutil/frame.h>
+#include <libavutil/hwcontext.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+/* Imports hardware decoded frames as textures of the obs graphics context,
+ * so they can be drawn without being downloaded and uploaded again.  Only
+ * VAAPI surfaces exported as DMA-BUFs are supported, other hardware frames
+ * take the download path. */
+
+/* counts the frames of a decoder that are lent out, shared with the frames
+ * so it outlives the decoder */
+struct mp_texture_lender;
+
+struct mp_texture_frame {
+	AVFrame *drm_frame;
+	gs_texture_t *textures[MAX_AV_PLANES];
+	struct mp_texture_lender *lender;
+};
+
+extern bool mp_texture_supported(enum AVHWDeviceType type);
+
+extern struct mp_texture_lender *mp_texture_lender_create(long max_lent);
+extern void mp_texture_lender_release(struct mp_texture_lender *lender);
+
+/* false while as many frames as the decoder can spare are lent out */
+extern bool mp_texture_lender_available(struct mp_texture_lender *lender);
+
+/* NULL if the frame can't be imported */
+extern struct mp_texture_frame *mp_texture_frame_create(struct mp_texture_lender *lender, const AVFrame *hw_frame);
+
+/* an obs_source_frame_release_t, callable from any thread */
+extern void mp_texture_frame_release(void *param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <util/dstr.h>
+#include <util/threading.h>
 #include <callback/calldata.h>
 #include "obs-scripting.h"
 
@@ -37,6 +38,43 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+/* Runs the per-frame work of a scripting language, script_tick and timers,
+ * on a thread of its own.  The graphics thread only adds up the elapsed
+ * time and wakes the thread, so a slow script delays its own ticks, which
+ * are merged into one, instead of stalling rendering. */
+typedef void (*script_tick_cb)(float seconds);
+
+struct script_tick_thread {
+	pthread_t thread;
+	os_event_t *event;
+	pthread_mutex_t mutex;
+	script_tick_cb tick;
+	const char *name;
+	float seconds;
+	volatile bool stop;
+	bool valid;
+};
+
+extern bool script_tick_thread_start(struct script_tick_thread *tt, const char *name, script_tick_cb tick);
+extern void script_tick_thread_stop(struct script_tick_thread *tt);
+
+/* Callbacks scripts add with obs_add_tick_callback still run on the
+ * graphics thread, for scripts that need to be in step with frames.  One
+ * that takes longer than the budget several frames in a row is moved to
+ * the tick thread. */
+#define SCRIPT_FRAME_TICK_BUDGET_NS 2000000ULL
+#define SCRIPT_FRAME_TICK_MAX_SLOW 3
+
+static inline bool script_frame_tick_over_budget(int *slow_ticks, uint64_t start_ns, uint64_t end_ns)
+{
+	if (end_ns - start_ns <= SCRIPT_FRAME_TICK_BUDGET_NS) {
+		*slow_ticks = 0;
+		return false;
+	}
+
+	return ++*slow_ticks >= SCRIPT_FRAME_TICK_MAX_SLOW;
+}
+
 extern void script_log(obs_script_t *script, int level, const char *format, ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format, va_list args);
 
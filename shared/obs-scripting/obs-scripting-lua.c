@@ -57,6 +57,11 @@ static char *startup_script = NULL;
 
 static pthread_mutex_t tick_mutex;
 static struct obs_lua_script *first_tick_script = NULL;
+static struct script_tick_thread tick_thread;
+
+/* tick callbacks that were too slow for the graphics thread, called from
+ * the tick thread instead.  protected by tick_mutex */
+static DARRAY(struct lua_obs_callback *) moved_tick_callbacks;
 
 pthread_mutex_t lua_source_def_mutex;
 
@@ -372,9 +377,23 @@ static int obs_lua_add_main_render_callback(lua_State *script)
 
 /* -------------------------------------------- */
 
+struct lua_frame_tick {
+	float seconds;
+	int slow_ticks;
+};
+
+static void defer_move_tick(void *cb)
+{
+	pthread_mutex_lock(&tick_mutex);
+	da_push_back(moved_tick_callbacks, &cb);
+	pthread_mutex_unlock(&tick_mutex);
+}
+
 static void obs_lua_tick_callback(void *priv, float seconds)
 {
 	struct lua_obs_callback *cb = priv;
+	struct lua_frame_tick *ft = lua_obs_callback_extra_data(cb);
+	struct obs_lua_script *data = (struct obs_lua_script *)cb->base.script;
 	lua_State *script = cb->script;
 
 	if (script_callback_removed(&cb->base)) {
@@ -382,12 +401,32 @@ static void obs_lua_tick_callback(void *priv, float seconds)
 		return;
 	}
 
+	/* the graphics thread doesn't wait for a script that is busy on
+	 * another thread, the time is passed on with the next tick instead */
+	ft->seconds += seconds;
+	if (pthread_mutex_trylock(&data->mutex) != 0)
+		return;
+
+	uint64_t start = os_gettime_ns();
+
 	lock_callback();
 
-	lua_pushnumber(script, (lua_Number)seconds);
+	lua_pushnumber(script, (lua_Number)ft->seconds);
 	call_func(obs_lua_tick_callback, 1, 0);
 
 	unlock_callback();
+
+	pthread_mutex_unlock(&data->mutex);
+	ft->seconds = 0.0f;
+
+	if (script_frame_tick_over_budget(&ft->slow_ticks, start, os_gettime_ns())) {
+		script_warn(&data->base,
+			    "A tick callback took longer than %d ms for %d frames in a row, "
+			    "calling it outside of the graphics thread from now on",
+			    (int)(SCRIPT_FRAME_TICK_BUDGET_NS / 1000000), SCRIPT_FRAME_TICK_MAX_SLOW);
+		obs_remove_tick_callback(obs_lua_tick_callback, cb);
+		defer_call_post(defer_move_tick, cb);
+	}
 }
 
 static int obs_lua_remove_tick_callback(lua_State *script)
@@ -411,7 +450,7 @@ static int obs_lua_add_tick_callback(lua_State *script)
 	if (!verify_args1(script, is_function))
 		return 0;
 
-	struct lua_obs_callback *cb = add_lua_obs_callback(script, 1);
+	struct lua_obs_callback *cb = add_lua_obs_callback_extra(script, 1, sizeof(struct lua_frame_tick));
 	defer_call_post(defer_add_tick, cb);
 	return 0;
 }
@@ -1036,7 +1075,7 @@ static void add_hook_functions(lua_State *script)
 
 /* -------------------------------------------- */
 
-static void lua_tick(void *param, float seconds)
+static void lua_tick(float seconds)
 {
 	struct obs_lua_script *data;
 	struct lua_obs_timer *timer;
@@ -1061,6 +1100,23 @@ static void lua_tick(void *param, float seconds)
 		data = data->next_tick;
 	}
 	current_lua_script = NULL;
+
+	for (size_t i = moved_tick_callbacks.num; i > 0; i--) {
+		struct lua_obs_callback *cb = moved_tick_callbacks.array[i - 1];
+		lua_State *script = cb->script;
+
+		if (script_callback_removed(&cb->base)) {
+			da_erase(moved_tick_callbacks, i - 1);
+			continue;
+		}
+
+		lock_callback();
+
+		lua_pushnumber(script, (lua_Number)seconds);
+		call_func(obs_lua_tick_callback, 1, 0);
+
+		unlock_callback();
+	}
 	pthread_mutex_unlock(&tick_mutex);
 
 	/* --------------------------------- */
@@ -1086,8 +1142,6 @@ static void lua_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
-
-	UNUSED_PARAMETER(param);
 }
 
 /* -------------------------------------------- */
@@ -1364,12 +1418,14 @@ void obs_lua_load(void)
 	dstr_free(&package_cpath);
 	startup_script = tmp.array;
 
-	obs_add_tick_callback(lua_tick, NULL);
+	if (!script_tick_thread_start(&tick_thread, "scripting: lua tick", lua_tick))
+		blog(LOG_WARNING, "[obs-scripting]: Failed to start the lua tick thread");
 }
 
 void obs_lua_unload(void)
 {
-	obs_remove_tick_callback(lua_tick, NULL);
+	script_tick_thread_stop(&tick_thread);
+	da_free(moved_tick_callbacks);
 
 	bfree(startup_script);
 	pthread_mutex_destroy(&tick_mutex);
@@ -57,6 +57,11 @@ static bool mutexes_loaded = false;
 
 static pthread_mutex_t tick_mutex;
 static struct obs_python_script *first_tick_script = NULL;
+static struct script_tick_thread tick_thread;
+
+/* tick callbacks that were too slow for the graphics thread, called from
+ * the tick thread instead.  protected by tick_mutex */
+static DARRAY(struct python_obs_callback *) moved_tick_callbacks;
 
 static PyObject *py_obspython = NULL;
 struct obs_python_script *cur_python_script = NULL;
@@ -460,24 +465,50 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
+struct python_frame_tick {
+	int slow_ticks;
+};
+
+static void defer_move_tick(void *cb)
+{
+	pthread_mutex_lock(&tick_mutex);
+	da_push_back(moved_tick_callbacks, &cb);
+	pthread_mutex_unlock(&tick_mutex);
+}
+
+static void call_tick_callback(struct python_obs_callback *cb, float seconds)
+{
+	PyObject *args = Py_BuildValue("(f)", seconds);
+	PyObject *py_ret = PyObject_CallObject(cb->func, args);
+	py_error();
+	Py_XDECREF(py_ret);
+	Py_XDECREF(args);
+}
+
 static void obs_python_tick_callback(void *priv, float seconds)
 {
 	struct python_obs_callback *cb = priv;
+	struct python_frame_tick *ft = python_obs_callback_extra_data(cb);
 
 	if (script_callback_removed(&cb->base)) {
 		obs_remove_tick_callback(obs_python_tick_callback, cb);
 		return;
 	}
 
-	lock_callback(cb);
-
-	PyObject *args = Py_BuildValue("(f)", seconds);
-	PyObject *py_ret = PyObject_CallObject(cb->func, args);
-	py_error();
-	Py_XDECREF(py_ret);
-	Py_XDECREF(args);
+	uint64_t start = os_gettime_ns();
 
+	lock_callback(cb);
+	call_tick_callback(cb, seconds);
 	unlock_callback();
+
+	if (script_frame_tick_over_budget(&ft->slow_ticks, start, os_gettime_ns())) {
+		script_warn(cb->base.script,
+			    "A tick callback took longer than %d ms for %d frames in a row, "
+			    "calling it outside of the graphics thread from now on",
+			    (int)(SCRIPT_FRAME_TICK_BUDGET_NS / 1000000), SCRIPT_FRAME_TICK_MAX_SLOW);
+		obs_remove_tick_callback(obs_python_tick_callback, cb);
+		defer_call_post(defer_move_tick, cb);
+	}
 }
 
 static PyObject *obs_python_remove_tick_callback(PyObject *self, PyObject *args)
@@ -520,7 +551,7 @@ static PyObject *obs_python_add_tick_callback(PyObject *self, PyObject *args)
 	if (!py_cb || !PyFunction_Check(py_cb))
 		return python_none();
 
-	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
+	struct python_obs_callback *cb = add_python_obs_callback_extra(script, py_cb, sizeof(struct python_frame_tick));
 	obs_add_tick_callback(obs_python_tick_callback, cb);
 	return python_none();
 }
@@ -1474,7 +1505,7 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
-static void python_tick(void *param, float seconds)
+static void python_tick(float seconds)
 {
 	struct obs_python_script *data;
 	/* When loading a new Python script, the GIL might be released while
@@ -1487,7 +1518,7 @@ static void python_tick(void *param, float seconds)
 	uint64_t ts = obs_get_video_frame_time();
 
 	pthread_mutex_lock(&tick_mutex);
-	valid = !!first_tick_script;
+	valid = first_tick_script || moved_tick_callbacks.num;
 	pthread_mutex_unlock(&tick_mutex);
 
 	/* --------------------------------- */
@@ -1514,6 +1545,20 @@ static void python_tick(void *param, float seconds)
 			data = data->next_tick;
 		}
 
+		for (size_t i = moved_tick_callbacks.num; i > 0; i--) {
+			struct python_obs_callback *cb = moved_tick_callbacks.array[i - 1];
+
+			if (script_callback_removed(&cb->base)) {
+				da_erase(moved_tick_callbacks, i - 1);
+				continue;
+			}
+
+			cur_python_script = (struct obs_python_script *)cb->base.script;
+			cur_python_cb = cb;
+			call_tick_callback(cb, seconds);
+			cur_python_cb = NULL;
+		}
+
 		cur_python_script = NULL;
 		if (busy_script) {
 			cur_python_script = busy_script;
@@ -1553,8 +1598,6 @@ static void python_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
-
-	UNUSED_PARAMETER(param);
 }
 
 /* -------------------------------------------- */
@@ -1732,14 +1775,17 @@ out:
 
 	python_loaded_at_all = success;
 
-	if (python_loaded)
-		obs_add_tick_callback(python_tick, NULL);
+	if (python_loaded && !script_tick_thread_start(&tick_thread, "scripting: python tick", python_tick))
+		warn("Failed to start the python tick thread");
 
 	return python_loaded;
 }
 
 void obs_python_unload(void)
 {
+	script_tick_thread_stop(&tick_thread);
+	da_free(moved_tick_callbacks);
+
 	if (mutexes_loaded) {
 		pthread_mutex_destroy(&tick_mutex);
 		pthread_mutex_destroy(&timer_mutex);
@@ -1757,8 +1803,6 @@ void obs_python_unload(void)
 
 	/* ---------------------- */
 
-	obs_remove_tick_callback(python_tick, NULL);
-
 	for (size_t i = 0; i < python_paths.num; i++)
 		bfree(python_paths.array[i]);
 	da_free(python_paths);
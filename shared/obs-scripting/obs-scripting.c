@@ -117,6 +117,78 @@ void defer_call_post(defer_call_cb call, void *cb)
 
 /* -------------------------------------------- */
 
+static void *tick_thread(void *param)
+{
+	struct script_tick_thread *tt = param;
+	os_set_thread_name(tt->name);
+
+	while (os_event_wait(tt->event) == 0) {
+		if (os_atomic_load_bool(&tt->stop))
+			break;
+
+		pthread_mutex_lock(&tt->mutex);
+		float seconds = tt->seconds;
+		tt->seconds = 0.0f;
+		pthread_mutex_unlock(&tt->mutex);
+
+		tt->tick(seconds);
+	}
+
+	return NULL;
+}
+
+static void tick_thread_post(void *param, float seconds)
+{
+	struct script_tick_thread *tt = param;
+
+	pthread_mutex_lock(&tt->mutex);
+	tt->seconds += seconds;
+	pthread_mutex_unlock(&tt->mutex);
+
+	os_event_signal(tt->event);
+}
+
+bool script_tick_thread_start(struct script_tick_thread *tt, const char *name, script_tick_cb tick)
+{
+	memset(tt, 0, sizeof(*tt));
+	tt->name = name;
+	tt->tick = tick;
+
+	if (pthread_mutex_init(&tt->mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&tt->event, OS_EVENT_TYPE_AUTO) != 0) {
+		pthread_mutex_destroy(&tt->mutex);
+		return false;
+	}
+	if (pthread_create(&tt->thread, NULL, tick_thread, tt) != 0) {
+		os_event_destroy(tt->event);
+		pthread_mutex_destroy(&tt->mutex);
+		return false;
+	}
+
+	tt->valid = true;
+	obs_add_tick_callback(tick_thread_post, tt);
+	return true;
+}
+
+void script_tick_thread_stop(struct script_tick_thread *tt)
+{
+	if (!tt->valid)
+		return;
+
+	obs_remove_tick_callback(tick_thread_post, tt);
+
+	os_atomic_set_bool(&tt->stop, true);
+	os_event_signal(tt->event);
+	pthread_join(tt->thread, NULL);
+
+	os_event_destroy(tt->event);
+	pthread_mutex_destroy(&tt->mutex);
+	tt->valid = false;
+}
+
+/* -------------------------------------------- */
+
 bool obs_scripting_load(void)
 {
 	deque_init(&defer_call_queue);
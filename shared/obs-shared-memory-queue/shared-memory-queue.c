@@ -24,20 +24,38 @@ struct queue_header {
 	uint32_t reserved[8];
 };
 
+/* precedes each of the frames.  seq is odd while the writer is copying
+ * into the frame, readers compare it before and after reading to tell
+ * whether the frame was overwritten in the meantime.  older readers only
+ * know about the timestamp */
+struct frame_header {
+	uint64_t timestamp;
+	volatile LONG seq;
+};
+
 struct video_queue {
 	HANDLE handle;
 	bool ready_to_read;
 	struct queue_header *header;
-	uint64_t *ts[3];
+	struct frame_header *frame_header[3];
 	uint8_t *frame[3];
 	long last_inc;
 	int dup_counter;
 	bool is_writer;
+
+	unsigned long read_idx;
+	LONG read_seq;
+	bool reread;
+	struct video_queue_stats stats;
 };
 
 #define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
 #define FRAME_HEADER_SIZE 32
 
+/* a frame overwritten while being read is read again from the newest
+ * frame, which the writer reaches again only after filling the others */
+#define MAX_READ_ATTEMPTS 3
+
 video_queue_t *video_queue_create(uint32_t cx, uint32_t cy, uint64_t interval)
 {
 	struct video_queue vq = {0};
@@ -96,7 +114,7 @@ video_queue_t *video_queue_create(uint32_t cx, uint32_t cy, uint64_t interval)
 
 	for (size_t i = 0; i < 3; i++) {
 		uint32_t off = offset_frame[i];
-		vq.ts[i] = (uint64_t *)(((uint8_t *)vq.header) + off);
+		vq.frame_header[i] = (struct frame_header *)(((uint8_t *)vq.header) + off);
 		vq.frame[i] = ((uint8_t *)vq.header) + off + FRAME_HEADER_SIZE;
 	}
 	pvq = malloc(sizeof(vq));
@@ -162,13 +180,18 @@ void video_queue_write(video_queue_t *vq, uint8_t **data, uint32_t *linesize, ui
 	long inc = ++qh->write_idx;
 
 	unsigned long idx = get_idx(inc);
+	struct frame_header *fh = vq->frame_header[idx];
 	size_t size = linesize[0] * qh->cy;
 
-	*vq->ts[idx] = timestamp;
+	InterlockedIncrement(&fh->seq);
+
+	fh->timestamp = timestamp;
 	memcpy(vq->frame[idx], data[0], size);
 	memcpy(vq->frame[idx] + size, data[1], size / 2);
 
-	qh->read_idx = inc;
+	InterlockedIncrement(&fh->seq);
+
+	InterlockedExchange((volatile LONG *)&qh->read_idx, inc);
 	qh->state = SHARED_QUEUE_STATE_READY;
 }
 
@@ -182,7 +205,7 @@ enum queue_state video_queue_state(video_queue_t *vq)
 	if (!vq->ready_to_read && state == SHARED_QUEUE_STATE_READY) {
 		for (size_t i = 0; i < 3; i++) {
 			size_t off = vq->header->offsets[i];
-			vq->ts[i] = (uint64_t *)(((uint8_t *)vq->header) + off);
+			vq->frame_header[i] = (struct frame_header *)(((uint8_t *)vq->header) + off);
 			vq->frame[i] = ((uint8_t *)vq->header) + off + FRAME_HEADER_SIZE;
 		}
 		vq->ready_to_read = true;
@@ -191,28 +214,76 @@ enum queue_state video_queue_state(video_queue_t *vq)
 	return state;
 }
 
-bool video_queue_read(video_queue_t *vq, nv12_scale_t *scale, void *dst, uint64_t *ts)
+bool video_queue_read_begin(video_queue_t *vq, const uint8_t **frame, uint64_t *ts)
 {
 	struct queue_header *qh = vq->header;
-	long inc = qh->read_idx;
+	long inc = (long)InterlockedCompareExchange((volatile LONG *)&qh->read_idx, 0, 0);
 
 	if (qh->state == SHARED_QUEUE_STATE_STOPPING) {
 		return false;
 	}
 
 	if (inc == vq->last_inc) {
-		if (++vq->dup_counter == 10) {
-			return false;
+		if (!vq->reread) {
+			if (++vq->dup_counter == 10) {
+				return false;
+			}
+			vq->stats.duplicated++;
 		}
 	} else {
+		if (vq->last_inc && (unsigned long)(inc - vq->last_inc) > 1)
+			vq->stats.skipped += (unsigned long)(inc - vq->last_inc) - 1;
+
 		vq->dup_counter = 0;
 		vq->last_inc = inc;
 	}
 
-	unsigned long idx = get_idx(inc);
+	vq->reread = false;
+
+	vq->read_idx = get_idx(inc);
+	vq->read_seq = InterlockedCompareExchange(&vq->frame_header[vq->read_idx]->seq, 0, 0);
+
+	*ts = vq->frame_header[vq->read_idx]->timestamp;
+	*frame = vq->frame[vq->read_idx];
+	return true;
+}
 
-	*ts = *vq->ts[idx];
+bool video_queue_read_end(video_queue_t *vq)
+{
+	MemoryBarrier();
+
+	LONG seq = vq->frame_header[vq->read_idx]->seq;
+	if ((vq->read_seq & 1) != 0 || seq != vq->read_seq) {
+		vq->stats.torn++;
+		return false;
+	}
 
-	nv12_do_scale(scale, dst, vq->frame[idx]);
+	vq->stats.frames++;
 	return true;
 }
+
+bool video_queue_read(video_queue_t *vq, nv12_scale_t *scale, void *dst, uint64_t *ts)
+{
+	for (int i = 0; i < MAX_READ_ATTEMPTS; i++) {
+		const uint8_t *frame;
+
+		if (!video_queue_read_begin(vq, &frame, ts)) {
+			return false;
+		}
+
+		nv12_do_scale(scale, dst, frame);
+
+		if (video_queue_read_end(vq)) {
+			break;
+		}
+
+		vq->reread = true;
+	}
+
+	return true;
+}
+
+void video_queue_get_stats(video_queue_t *vq, struct video_queue_stats *stats)
+{
+	*stats = vq->stats;
+}
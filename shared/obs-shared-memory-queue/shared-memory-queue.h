@@ -19,6 +19,18 @@ enum queue_state {
 	SHARED_QUEUE_STATE_STOPPING,
 };
 
+/* what a reader of the queue has seen, counted by each reader itself */
+struct video_queue_stats {
+	/* frames read completely */
+	uint64_t frames;
+	/* reads that found no new frame and repeated the last one */
+	uint64_t duplicated;
+	/* frames that were written and replaced before this reader got to them */
+	uint64_t skipped;
+	/* reads that had to be redone because the frame was overwritten */
+	uint64_t torn;
+};
+
 extern video_queue_t *video_queue_create(uint32_t cx, uint32_t cy, uint64_t interval);
 extern video_queue_t *video_queue_open();
 extern void video_queue_close(video_queue_t *vq);
@@ -28,6 +40,15 @@ extern void video_queue_write(video_queue_t *vq, uint8_t **data, uint32_t *lines
 extern enum queue_state video_queue_state(video_queue_t *vq);
 extern bool video_queue_read(video_queue_t *vq, nv12_scale_t *scale, void *dst, uint64_t *ts);
 
+/* reads the newest frame in place instead of copying it.  the NV12 data
+ * stays in shared memory and may be overwritten while it is used, so
+ * video_queue_read_end must be called after it to tell whether it was.
+ * begin returns false like video_queue_read */
+extern bool video_queue_read_begin(video_queue_t *vq, const uint8_t **frame, uint64_t *ts);
+extern bool video_queue_read_end(video_queue_t *vq);
+
+extern void video_queue_get_stats(video_queue_t *vq, struct video_queue_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,10 +1,94 @@
 #include <string.h>
 #include "tiny-nv12-scale.h"
 
-/* TODO: optimize this stuff later, or replace with something better.  it's
- * kind of garbage.  although normally it shouldn't be called that often.  plus
- * it's nearest neighbor so not really a huge deal.  at the very least it
- * should be sse2 at some point. */
+#if defined(__SSE2__) || (defined(_M_X64) && !defined(_M_ARM64EC)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NV12_SCALE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64) || defined(_M_ARM64EC)
+#include <arm_neon.h>
+#define NV12_SCALE_NEON
+#endif
+
+/* nearest neighbor, so each destination pixel is looked up with a 32.32 fixed
+ * point step instead of a division.  rounding the step up makes it pick the
+ * same pixels as pos * src / dst for any destination below 65536 wide. */
+static inline uint64_t scale_step(int src, int dst)
+{
+	return dst > 0 ? (((uint64_t)src << 32) + (uint64_t)dst - 1) / (uint64_t)dst : 0;
+}
+
+static inline int scale_pos(int pos, uint64_t step)
+{
+	return (int)(((uint64_t)pos * step) >> 32);
+}
+
+static void scale_line_nearest(uint8_t *dst, const uint8_t *src, int dst_cx, uint64_t step)
+{
+	for (int x = 0; x < dst_cx; x++)
+		dst[x] = src[scale_pos(x, step)];
+}
+
+/* splits count interleaved uv pairs into separate u and v planes */
+static void split_uv(uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src, int count)
+{
+	int i = 0;
+
+#if defined(NV12_SCALE_SSE2)
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+
+	for (; i + 16 <= count; i += 16) {
+		const __m128i uv0 = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		const __m128i uv1 = _mm_loadu_si128((const __m128i *)(src + i * 2 + 16));
+
+		const __m128i u = _mm_packus_epi16(_mm_and_si128(uv0, mask), _mm_and_si128(uv1, mask));
+		const __m128i v = _mm_packus_epi16(_mm_srli_epi16(uv0, 8), _mm_srli_epi16(uv1, 8));
+
+		_mm_storeu_si128((__m128i *)(dst_u + i), u);
+		_mm_storeu_si128((__m128i *)(dst_v + i), v);
+	}
+#elif defined(NV12_SCALE_NEON)
+	for (; i + 16 <= count; i += 16) {
+		const uint8x16x2_t uv = vld2q_u8(src + i * 2);
+
+		vst1q_u8(dst_u + i, uv.val[0]);
+		vst1q_u8(dst_v + i, uv.val[1]);
+	}
+#endif
+
+	for (; i < count; i++) {
+		dst_u[i] = src[i * 2];
+		dst_v[i] = src[i * 2 + 1];
+	}
+}
+
+/* interleaves a line of cx luma samples with cx bytes of uv pairs */
+static void pack_yuy2_line(uint8_t *dst, const uint8_t *src_y, const uint8_t *src_uv, int cx)
+{
+	int i = 0;
+
+#if defined(NV12_SCALE_SSE2)
+	for (; i + 16 <= cx; i += 16) {
+		const __m128i y = _mm_loadu_si128((const __m128i *)(src_y + i));
+		const __m128i uv = _mm_loadu_si128((const __m128i *)(src_uv + i));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi8(y, uv));
+		_mm_storeu_si128((__m128i *)(dst + i * 2 + 16), _mm_unpackhi_epi8(y, uv));
+	}
+#elif defined(NV12_SCALE_NEON)
+	for (; i + 16 <= cx; i += 16) {
+		uint8x16x2_t yuyv;
+
+		yuyv.val[0] = vld1q_u8(src_y + i);
+		yuyv.val[1] = vld1q_u8(src_uv + i);
+		vst2q_u8(dst + i * 2, yuyv);
+	}
+#endif
+
+	for (; i < cx; i++) {
+		dst[i * 2] = src_y[i];
+		dst[i * 2 + 1] = src_uv[i];
+	}
+}
 
 void nv12_scale_init(nv12_scale_t *s, enum target_format format, int dst_cx, int dst_cy, int src_cx, int src_cy)
 {
@@ -24,16 +108,14 @@ static void nv12_scale_nearest(nv12_scale_t *s, uint8_t *dst_start, const uint8_
 	const int src_cy = s->src_cy;
 	const int dst_cx = s->dst_cx;
 	const int dst_cy = s->dst_cy;
+	const uint64_t step_x = scale_step(src_cx, dst_cx);
 
 	/* lum */
 	for (int y = 0; y < dst_cy; y++) {
 		const int src_line = y * src_cy / dst_cy * s->src_cx;
 
-		for (int x = 0; x < dst_cx; x++) {
-			const int src_x = x * src_cx / dst_cx;
-
-			*(dst++) = src[src_line + src_x];
-		}
+		scale_line_nearest(dst, src + src_line, dst_cx, step_x);
+		dst += dst_cx;
 	}
 
 	src += src_cx * src_cy;
@@ -43,14 +125,13 @@ static void nv12_scale_nearest(nv12_scale_t *s, uint8_t *dst_start, const uint8_
 	const int dst_cy_d2 = dst_cy / 2;
 
 	for (int y = 0; y < dst_cy_d2; y++) {
-		const int src_line = y * src_cy / dst_cy * src_cx;
+		const uint8_t *src_line = src + y * src_cy / dst_cy * src_cx;
 
 		for (int x = 0; x < dst_cx_d2; x++) {
-			const int src_x = x * src_cx / dst_cx * 2;
-			const int pos = src_line + src_x;
+			const int pos = scale_pos(x, step_x) * 2;
 
-			*(dst++) = src[pos];
-			*(dst++) = src[pos + 1];
+			*(dst++) = src_line[pos];
+			*(dst++) = src_line[pos + 1];
 		}
 	}
 }
@@ -64,15 +145,14 @@ static void nv12_scale_nearest_to_i420(nv12_scale_t *s, uint8_t *dst_start, cons
 	const int dst_cy = s->dst_cy;
 	const int size = src_cx * src_cy;
 
+	const uint64_t step_x = scale_step(src_cx, dst_cx);
+
 	/* lum */
 	for (int y = 0; y < dst_cy; y++) {
 		const int src_line = y * src_cy / dst_cy * s->src_cx;
 
-		for (int x = 0; x < dst_cx; x++) {
-			const int src_x = x * src_cx / dst_cx;
-
-			*(dst++) = src[src_line + src_x];
-		}
+		scale_line_nearest(dst, src + src_line, dst_cx, step_x);
+		dst += dst_cx;
 	}
 
 	src += size;
@@ -84,14 +164,13 @@ static void nv12_scale_nearest_to_i420(nv12_scale_t *s, uint8_t *dst_start, cons
 	register uint8_t *dst2 = dst + dst_cx * dst_cy / 4;
 
 	for (int y = 0; y < dst_cy_d2; y++) {
-		const int src_line = y * src_cy / dst_cy * src_cx;
+		const uint8_t *src_line = src + y * src_cy / dst_cy * src_cx;
 
 		for (int x = 0; x < dst_cx_d2; x++) {
-			const int src_x = x * src_cx / dst_cx * 2;
-			const int pos = src_line + src_x;
+			const int pos = scale_pos(x, step_x) * 2;
 
-			*(dst++) = src[pos];
-			*(dst2++) = src[pos + 1];
+			*(dst++) = src_line[pos];
+			*(dst2++) = src_line[pos + 1];
 		}
 	}
 }
@@ -103,15 +182,10 @@ static void nv12_convert_to_i420(nv12_scale_t *s, uint8_t *dst_start, const uint
 
 	memcpy(dst_start, src_start, size);
 
-	register uint8_t *dst1 = dst_start + size;
-	register uint8_t *dst2 = dst1 + size_d4;
-	register uint8_t *dst_end = dst2 + size_d4;
-	register const uint8_t *src = src_start + size;
+	uint8_t *dst_u = dst_start + size;
+	uint8_t *dst_v = dst_u + size_d4;
 
-	while (dst2 < dst_end) {
-		*(dst1++) = *(src++);
-		*(dst2++) = *(src++);
-	}
+	split_uv(dst_u, dst_v, src_start + size, size_d4);
 }
 
 static void nv12_scale_nearest_to_yuy2(nv12_scale_t *s, uint8_t *dst_start, const uint8_t *src)
@@ -128,21 +202,20 @@ static void nv12_scale_nearest_to_yuy2(nv12_scale_t *s, uint8_t *dst_start, cons
 	const int size = src_cx * src_cy;
 
 	const uint8_t *src_uv = src + size;
+	const uint64_t step_x = scale_step(src_cx, dst_cx);
+	const uint64_t step_x_d2 = scale_step(src_cx_d2, dst_cx_d2);
 
 	register int uv_flip = 0;
 
 	for (int y = 0; y < dst_cy; y++) {
-		const int src_line = y * src_cy / dst_cy * s->src_cx;
-		const int src_line_d2 = y / 2 * src_cy_d2 / dst_cy_d2 * s->src_cx;
+		const uint8_t *src_line = src + y * src_cy / dst_cy * s->src_cx;
+		const uint8_t *src_line_uv = src_uv + y / 2 * src_cy_d2 / dst_cy_d2 * s->src_cx;
 
 		for (int x = 0; x < dst_cx; x++) {
-			const int src_x = x * src_cx / dst_cx;
-			const int src_x_d2 = x / 2 * src_cx_d2 / dst_cx_d2;
-			const int pos = src_line + src_x;
-			const int pos_uv = src_line_d2 + src_x_d2 * 2 + uv_flip;
+			const int pos_uv = scale_pos(x / 2, step_x_d2) * 2 + uv_flip;
 
-			*(dst++) = src[pos];
-			*(dst++) = src_uv[pos_uv];
+			*(dst++) = src_line[scale_pos(x, step_x)];
+			*(dst++) = src_line_uv[pos_uv];
 
 			uv_flip ^= 1;
 		}
@@ -151,33 +224,15 @@ static void nv12_scale_nearest_to_yuy2(nv12_scale_t *s, uint8_t *dst_start, cons
 
 static void nv12_convert_to_yuy2(nv12_scale_t *s, uint8_t *dst_start, const uint8_t *src_start)
 {
-	const int size = s->src_cx * s->src_cy;
-	const int size_dst_line = s->src_cx * 2;
+	const int cx = s->src_cx;
+	const int cy = s->src_cy;
 
-	register const uint8_t *src_y = src_start;
-	register const uint8_t *src_uv = src_y + size;
-	register uint8_t *dst = dst_start;
-	register uint8_t *dst_end = dst + size * 2;
-
-	while (dst < dst_end) {
-		register uint8_t *dst_line_end = dst + size_dst_line;
-		const uint8_t *src_uv_start = src_uv;
-		while (dst < dst_line_end) {
-			*(dst++) = *(src_y++);
-			*(dst++) = *(src_uv++);
-			*(dst++) = *(src_y++);
-			*(dst++) = *(src_uv++);
-		}
+	const uint8_t *src_y = src_start;
+	const uint8_t *src_uv = src_y + cx * cy;
 
-		dst_line_end = dst + size_dst_line;
-		src_uv = src_uv_start;
-		while (dst < dst_line_end) {
-			*(dst++) = *(src_y++);
-			*(dst++) = *(src_uv++);
-			*(dst++) = *(src_y++);
-			*(dst++) = *(src_uv++);
-		}
-	}
+	/* each uv line is shared by two lines of luma */
+	for (int y = 0; y < cy; y++)
+		pack_yuy2_line(dst_start + y * cx * 2, src_y + y * cx, src_uv + y / 2 * cx, cx);
 }
 
 void nv12_do_scale(nv12_scale_t *s, uint8_t *dst, const uint8_t *src)
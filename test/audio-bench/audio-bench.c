@@ -0,0 +1,420 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Headless audio pipeline benchmark.  Creates a number of async audio
+ * sources in a scene, optionally with audio filters, and drives the real
+ * audio thread with audio_output_step so ticks run back to back instead of
+ * on the clock.  Reports ticks per second, the time of each tick, the
+ * profiler tree of the audio thread and allocations per tick. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/util_uint64.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#ifdef _WIN32
+#define DEFAULT_RENDERER "libobs-d3d11"
+#else
+#define DEFAULT_RENDERER "libobs-opengl"
+#endif
+
+struct bench_config {
+	int sources;
+	int mixes;
+	int ticks;
+	int warmup;
+	int render_threads;
+	bool gain;
+	bool compressor;
+	bool noise_gate;
+	bool verbose;
+	const char *renderer;
+};
+
+struct bench_source {
+	obs_source_t *source;
+	double phase;
+	double step;
+	uint64_t ts;
+};
+
+/* ------------------------------------------------------------------------- */
+/* bench_audio: async audio source the benchmark pushes audio into itself */
+
+static const char *bench_audio_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Audio Benchmark Source";
+}
+
+static void *bench_audio_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void bench_audio_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static struct obs_source_info bench_audio = {
+	.id = "bench_audio",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = bench_audio_name,
+	.create = bench_audio_create,
+	.destroy = bench_audio_destroy,
+};
+
+static void push_audio(struct bench_source *bs, uint32_t frames, uint32_t sample_rate)
+{
+	float left[AUDIO_OUTPUT_FRAMES];
+	float right[AUDIO_OUTPUT_FRAMES];
+
+	for (uint32_t i = 0; i < frames; i++) {
+		left[i] = (float)(sin(bs->phase) * 0.5);
+		right[i] = left[i];
+
+		bs->phase += bs->step;
+		if (bs->phase > M_PI * 2.0)
+			bs->phase -= M_PI * 2.0;
+	}
+
+	struct obs_source_audio data = {
+		.data = {(uint8_t *)left, (uint8_t *)right},
+		.frames = frames,
+		.speakers = SPEAKERS_STEREO,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.samples_per_sec = sample_rate,
+		.timestamp = bs->ts,
+	};
+	obs_source_output_audio(bs->source, &data);
+
+	bs->ts += util_mul_div64(frames, 1000000000ULL, sample_rate);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool verbose_log = false;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	if (log_level <= LOG_WARNING || verbose_log) {
+		vfprintf(stderr, msg, args);
+		fputc('\n', stderr);
+	}
+
+	UNUSED_PARAMETER(param);
+}
+
+static void mix_output(void *param, size_t mix_idx, struct audio_data *data)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mix_idx);
+	UNUSED_PARAMETER(data);
+}
+
+static void add_filter(obs_source_t *source, const char *id, int idx)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "%s %d", id, idx);
+
+	obs_source_t *filter = obs_source_create_private(id, name, NULL);
+	if (!filter) {
+		blog(LOG_WARNING, "Filter '%s' is not available, was obs-filters loaded?", id);
+		return;
+	}
+
+	obs_source_filter_add(source, filter);
+	obs_source_release(filter);
+}
+
+static bool init_obs(const struct bench_config *cfg, profiler_name_store_t *store)
+{
+	if (!obs_startup("en-US", NULL, store))
+		return false;
+
+	struct obs_video_info ovi = {
+		.graphics_module = cfg->renderer,
+		.fps_num = 1,
+		.fps_den = 1,
+		.base_width = 64,
+		.base_height = 64,
+		.output_width = 64,
+		.output_height = 64,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BILINEAR,
+	};
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Couldn't initialize video with '%s'", cfg->renderer);
+		return false;
+	}
+
+	struct obs_audio_info2 oai = {
+		.samples_per_sec = 48000,
+		.speakers = SPEAKERS_STEREO,
+		.render_threads = (uint32_t)cfg->render_threads,
+	};
+	if (!obs_reset_audio2(&oai)) {
+		blog(LOG_ERROR, "Couldn't initialize audio");
+		return false;
+	}
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	obs_register_source(&bench_audio);
+	return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static void run_bench(const struct bench_config *cfg)
+{
+	audio_t *audio = obs_get_audio();
+	uint32_t sample_rate = (uint32_t)audio_output_get_sample_rate(audio);
+	uint32_t frames = (uint32_t)audio_output_get_info(audio)->frames_per_tick;
+	uint32_t mixers = (1 << cfg->mixes) - 1;
+	DARRAY(struct bench_source) sources;
+	uint64_t *tick_times;
+
+	da_init(sources);
+
+	obs_scene_t *scene = obs_scene_create_private("audio bench");
+
+	for (int i = 0; i < cfg->sources; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "bench source %d", i);
+
+		struct bench_source *bs = da_push_back_new(sources);
+		bs->source = obs_source_create_private("bench_audio", name, NULL);
+		bs->step = 2.0 * M_PI * (220.0 + 10.0 * i) / sample_rate;
+		obs_source_set_audio_mixers(bs->source, mixers);
+
+		if (cfg->gain)
+			add_filter(bs->source, "gain_filter", i);
+		if (cfg->compressor)
+			add_filter(bs->source, "compressor_filter", i);
+		if (cfg->noise_gate)
+			add_filter(bs->source, "noise_gate_filter", i);
+
+		obs_scene_add(scene, bs->source);
+	}
+
+	for (int mix = 0; mix < cfg->mixes; mix++)
+		audio_output_connect(audio, mix, NULL, mix_output, NULL);
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	/* settle timing and buffering before measuring */
+	for (int tick = 0; tick < cfg->warmup; tick++) {
+		for (size_t i = 0; i < sources.num; i++)
+			push_audio(&sources.array[i], frames, sample_rate);
+		audio_output_step(audio);
+	}
+
+	profiler_start();
+
+	tick_times = bmalloc(sizeof(uint64_t) * cfg->ticks);
+	long allocs = 0;
+	uint64_t start = os_gettime_ns();
+
+	for (int tick = 0; tick < cfg->ticks; tick++) {
+		for (size_t i = 0; i < sources.num; i++)
+			push_audio(&sources.array[i], frames, sample_rate);
+
+		/* only count the tick itself, not the pushes */
+		long allocs_start = bnum_total_allocs();
+		uint64_t tick_start = os_gettime_ns();
+		audio_output_step(audio);
+		tick_times[tick] = os_gettime_ns() - tick_start;
+		allocs += bnum_total_allocs() - allocs_start;
+	}
+
+	uint64_t total = os_gettime_ns() - start;
+
+	profiler_stop();
+
+	qsort(tick_times, cfg->ticks, sizeof(uint64_t), compare_u64);
+
+	uint64_t tick_sum = 0;
+	for (int tick = 0; tick < cfg->ticks; tick++)
+		tick_sum += tick_times[tick];
+
+	double realtime = (double)frames / (double)sample_rate * 1000000.0;
+
+	printf("sources: %d, mixes: %d, filters:%s%s%s%s, render threads: %d\n", cfg->sources, cfg->mixes,
+	       cfg->gain ? " gain" : "", cfg->compressor ? " compressor" : "", cfg->noise_gate ? " noise_gate" : "",
+	       (cfg->gain || cfg->compressor || cfg->noise_gate) ? "" : " none", cfg->render_threads);
+	printf("ticks: %d of %u frames in %.3f s, %.1f ticks/s (%.1fx real time)\n", cfg->ticks, frames,
+	       (double)total / 1000000000.0, (double)cfg->ticks * 1000000000.0 / (double)total,
+	       realtime * cfg->ticks / ((double)total / 1000.0));
+	printf("tick: mean %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n",
+	       (double)tick_sum / cfg->ticks / 1000.0, (double)tick_times[cfg->ticks / 2] / 1000.0,
+	       (double)tick_times[cfg->ticks * 99 / 100] / 1000.0, (double)tick_times[cfg->ticks - 1] / 1000.0);
+	printf("allocations: %ld, %.2f per tick\n", allocs, (double)allocs / cfg->ticks);
+
+	/* per-stage times, printed through the log */
+	verbose_log = true;
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	profiler_print(snap);
+	profile_snapshot_free(snap);
+	verbose_log = cfg->verbose;
+
+	bfree(tick_times);
+
+	obs_set_output_source(0, NULL);
+
+	for (int mix = 0; mix < cfg->mixes; mix++)
+		audio_output_disconnect(audio, mix, mix_output, NULL);
+
+	for (size_t i = 0; i < sources.num; i++)
+		obs_source_release(sources.array[i].source);
+	da_free(sources);
+
+	obs_scene_release(scene);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [options]\n"
+	       "  --sources N         async audio sources (default 8)\n"
+	       "  --mixes M           audio mixes, 1 to %d (default 1)\n"
+	       "  --ticks N           measured ticks (default 10000)\n"
+	       "  --warmup N          ticks run before measuring (default 200)\n"
+	       "  --render-threads N  audio render threads (default 0)\n"
+	       "  --filters LIST      comma separated: gain,compressor,noise_gate\n"
+	       "  --renderer MODULE   graphics module (default " DEFAULT_RENDERER ")\n"
+	       "  --verbose           print the libobs log\n",
+	       name, MAX_AUDIO_MIXES);
+}
+
+static bool parse_filters(struct bench_config *cfg, const char *list)
+{
+	char *copy = bstrdup(list);
+	char *token = strtok(copy, ",");
+	bool success = true;
+
+	while (token) {
+		if (strcmp(token, "gain") == 0) {
+			cfg->gain = true;
+		} else if (strcmp(token, "compressor") == 0) {
+			cfg->compressor = true;
+		} else if (strcmp(token, "noise_gate") == 0) {
+			cfg->noise_gate = true;
+		} else {
+			fprintf(stderr, "Unknown filter '%s'\n", token);
+			success = false;
+		}
+		token = strtok(NULL, ",");
+	}
+
+	bfree(copy);
+	return success;
+}
+
+static bool parse_args(struct bench_config *cfg, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			cfg->verbose = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--sources") == 0)
+			cfg->sources = atoi(val);
+		else if (strcmp(arg, "--mixes") == 0)
+			cfg->mixes = atoi(val);
+		else if (strcmp(arg, "--ticks") == 0)
+			cfg->ticks = atoi(val);
+		else if (strcmp(arg, "--warmup") == 0)
+			cfg->warmup = atoi(val);
+		else if (strcmp(arg, "--render-threads") == 0)
+			cfg->render_threads = atoi(val);
+		else if (strcmp(arg, "--renderer") == 0)
+			cfg->renderer = val;
+		else if (strcmp(arg, "--filters") == 0) {
+			if (!parse_filters(cfg, val))
+				return false;
+		} else
+			return false;
+		i++;
+	}
+
+	return cfg->sources >= 0 && cfg->mixes >= 1 && cfg->mixes <= MAX_AUDIO_MIXES && cfg->ticks > 0 &&
+	       cfg->warmup >= 0 && cfg->render_threads >= 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config cfg = {
+		.sources = 8,
+		.mixes = 1,
+		.ticks = 10000,
+		.warmup = 200,
+		.renderer = DEFAULT_RENDERER,
+	};
+	int ret = 0;
+
+	if (!parse_args(&cfg, argc, argv)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	verbose_log = cfg.verbose;
+	base_set_log_handler(do_log, NULL);
+
+	profiler_name_store_t *store = profiler_name_store_create();
+
+	if (init_obs(&cfg, store)) {
+		run_bench(&cfg);
+	} else {
+		fprintf(stderr, "Couldn't initialize libobs\n");
+		ret = 1;
+	}
+
+	obs_shutdown();
+	profiler_free();
+	profiler_name_store_free(store);
+
+	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	return ret;
+}
@@ -0,0 +1,61 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <media-io/audio-math.h>
+
+static void mul_to_db_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (float mul = 1e-7f; mul < 100.0f; mul *= 1.001f) {
+		float exact = mul_to_db(mul);
+		float fast = fast_mul_to_db(mul);
+		assert_true(fabsf(exact - fast) < 1e-4f);
+	}
+
+	assert_true(fast_mul_to_db(1.0f) == 0.0f);
+	assert_true(isinf(fast_mul_to_db(0.0f)) && fast_mul_to_db(0.0f) < 0.0f);
+}
+
+static void db_to_mul_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (float db = -140.0f; db < 40.0f; db += 0.01f) {
+		float exact = db_to_mul(db);
+		float fast = fast_db_to_mul(db);
+		assert_true(fabsf(exact - fast) / exact < 1e-5f);
+	}
+
+	assert_true(fast_db_to_mul(0.0f) == 1.0f);
+	assert_true(fast_db_to_mul(-INFINITY) == 0.0f);
+}
+
+/* the gain stage of the compressor and limiter */
+static void compression_gain_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const float threshold = -18.0f;
+	const float slope = 1.0f - 1.0f / 4.0f;
+
+	for (float env = 0.0f; env < 2.0f; env += 0.0005f) {
+		float exact = db_to_mul(fminf(0, slope * (threshold - mul_to_db(env))));
+		float gain = slope * (threshold - fast_mul_to_db(env));
+		float fast = fast_db_to_mul(gain < 0.0f ? gain : 0.0f);
+		assert_true(fabsf(exact - fast) / exact < 1e-5f);
+	}
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(mul_to_db_test),
+		cmocka_unit_test(db_to_mul_test),
+		cmocka_unit_test(compression_gain_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,60 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/threading.h>
+
+static void parse_ranges_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct os_cpu_set set;
+
+	assert_true(os_cpu_set_parse(&set, " 0-3, 8 ,10-11"));
+	assert_int_equal(set.bits[0], 0xd0f);
+
+	assert_true(os_cpu_set_parse(&set, "64,1023"));
+	assert_false(os_cpu_set_has(&set, 0));
+	assert_true(os_cpu_set_has(&set, 64));
+	assert_true(os_cpu_set_has(&set, 1023));
+	assert_int_equal(set.bits[1], 1);
+}
+
+static void parse_empty_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct os_cpu_set set;
+
+	assert_true(os_cpu_set_parse(&set, NULL));
+	assert_true(os_cpu_set_empty(&set));
+	assert_true(os_cpu_set_parse(&set, ""));
+	assert_true(os_cpu_set_empty(&set));
+}
+
+static void parse_invalid_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct os_cpu_set set;
+
+	assert_false(os_cpu_set_parse(&set, "3-1"));
+	assert_true(os_cpu_set_empty(&set));
+	assert_false(os_cpu_set_parse(&set, "1,x"));
+	assert_true(os_cpu_set_empty(&set));
+	assert_false(os_cpu_set_parse(&set, "1024"));
+	assert_false(os_cpu_set_parse(&set, "1 2"));
+	assert_false(os_cpu_set_parse(&set, "-1"));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(parse_ranges_test),
+		cmocka_unit_test(parse_empty_test),
+		cmocka_unit_test(parse_invalid_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
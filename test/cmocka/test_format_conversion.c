@@ -0,0 +1,126 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <media-io/format-conversion.h>
+
+/* widths that exercise both the vector loops and the scalar tails */
+static const uint32_t widths[] = {2, 14, 16, 18, 34, 1366, 1920};
+#define HEIGHT 4
+
+static void fill_random(uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+}
+
+static void nv12_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		const uint32_t width = widths[i];
+		uint8_t *lum = bmalloc(width * HEIGHT);
+		uint8_t *chroma = bmalloc(width * HEIGHT / 2);
+		uint32_t *output = bzalloc(width * HEIGHT * 4);
+
+		fill_random(lum, width * HEIGHT);
+		fill_random(chroma, width * HEIGHT / 2);
+
+		const uint8_t *input[] = {lum, chroma};
+		const uint32_t linesize[] = {width, width};
+		decompress_nv12(input, linesize, 0, HEIGHT, (uint8_t *)output, width * 4);
+
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				const uint8_t *uv = chroma + (y / 2) * width + (x / 2) * 2;
+				uint32_t expected = lum[y * width + x] | (uv[0] << 8) | (uv[1] << 16);
+				assert_int_equal(output[y * width + x], expected);
+			}
+		}
+
+		bfree(lum);
+		bfree(chroma);
+		bfree(output);
+	}
+}
+
+static void i420_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		const uint32_t width = widths[i];
+		uint8_t *lum = bmalloc(width * HEIGHT);
+		uint8_t *u = bmalloc(width * HEIGHT / 4);
+		uint8_t *v = bmalloc(width * HEIGHT / 4);
+		uint32_t *output = bzalloc(width * HEIGHT * 4);
+
+		fill_random(lum, width * HEIGHT);
+		fill_random(u, width * HEIGHT / 4);
+		fill_random(v, width * HEIGHT / 4);
+
+		const uint8_t *input[] = {lum, u, v};
+		const uint32_t linesize[] = {width, width / 2, width / 2};
+		decompress_420(input, linesize, 0, HEIGHT, (uint8_t *)output, width * 4);
+
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				const size_t chroma_pos = (y / 2) * (width / 2) + x / 2;
+				uint32_t expected = (lum[y * width + x] << 16) | (u[chroma_pos] << 8) | v[chroma_pos];
+				assert_int_equal(output[y * width + x], expected);
+			}
+		}
+
+		bfree(lum);
+		bfree(u);
+		bfree(v);
+		bfree(output);
+	}
+}
+
+static void packed_422_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+		/* one line; decompress_422 reads linesize / 2 pixel pairs */
+		const uint32_t pairs = widths[i];
+		uint32_t *input = bmalloc(pairs * 4);
+		uint32_t *output = bzalloc(pairs * 8);
+
+		fill_random((uint8_t *)input, pairs * 4);
+
+		for (int leading_lum = 0; leading_lum < 2; leading_lum++) {
+			decompress_422((const uint8_t *)input, pairs * 2, 0, 1, (uint8_t *)output, pairs * 4,
+				       leading_lum);
+
+			for (uint32_t x = 0; x < pairs; x++) {
+				uint32_t dw = input[x];
+				uint32_t second = leading_lum ? (dw & 0xFFFFFF00) | ((dw >> 16) & 0xFF)
+							      : (dw & 0xFFFF00FF) | ((dw >> 16) & 0xFF00);
+
+				assert_int_equal(output[x * 2], dw);
+				assert_int_equal(output[x * 2 + 1], second);
+			}
+		}
+
+		bfree(input);
+		bfree(output);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(nv12_test),
+		cmocka_unit_test(i420_test),
+		cmocka_unit_test(packed_422_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,144 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/mpmc-ring.h>
+
+#define THREADS 4
+#define THREAD_ITEMS 50000
+
+static void ring_wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct mpmc_ring ring;
+	uint32_t val;
+
+	mpmc_ring_init(&ring, sizeof(uint32_t), 6);
+	assert_int_equal(ring.capacity, 8);
+	assert_false(mpmc_ring_pop_front(&ring, &val));
+
+	for (uint32_t pass = 0; pass < 10; pass++) {
+		for (uint32_t i = 0; i < 8; i++) {
+			uint32_t in = pass * 8 + i;
+			assert_true(mpmc_ring_push_back(&ring, &in));
+		}
+
+		val = 0;
+		assert_false(mpmc_ring_push_back(&ring, &val));
+		assert_int_equal(mpmc_ring_size(&ring), 8);
+
+		for (uint32_t i = 0; i < 8; i++) {
+			assert_true(mpmc_ring_pop_front(&ring, &val));
+			assert_int_equal(val, pass * 8 + i);
+		}
+
+		assert_true(mpmc_ring_empty(&ring));
+		assert_false(mpmc_ring_pop_front(&ring, &val));
+	}
+
+	mpmc_ring_free(&ring);
+}
+
+struct thread_data {
+	struct mpmc_ring *ring;
+	uint32_t id;
+	volatile long *popped;
+	uint32_t counts[THREADS];
+	uint32_t last[THREADS];
+	bool ordered;
+};
+
+static void *producer_thread(void *param)
+{
+	struct thread_data *data = param;
+
+	for (uint32_t i = 0; i < THREAD_ITEMS;) {
+		uint32_t item = (data->id << 24) | i;
+
+		if (mpmc_ring_push_back(data->ring, &item))
+			i++;
+	}
+
+	return NULL;
+}
+
+static void *consumer_thread(void *param)
+{
+	struct thread_data *data = param;
+
+	data->ordered = true;
+
+	while (os_atomic_load_long(data->popped) < THREADS * THREAD_ITEMS) {
+		uint32_t item, producer, seq;
+
+		if (!mpmc_ring_pop_front(data->ring, &item))
+			continue;
+
+		os_atomic_inc_long(data->popped);
+
+		producer = item >> 24;
+		seq = item & 0xFFFFFF;
+
+		/* items of one producer must come out in the order they went in */
+		if (data->counts[producer] && seq <= data->last[producer])
+			data->ordered = false;
+
+		data->last[producer] = seq;
+		data->counts[producer]++;
+	}
+
+	return NULL;
+}
+
+static void ring_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct thread_data producers[THREADS] = {0};
+	struct thread_data consumers[THREADS] = {0};
+	pthread_t threads[THREADS * 2];
+	volatile long popped = 0;
+	struct mpmc_ring ring;
+
+	mpmc_ring_init(&ring, sizeof(uint32_t), 64);
+
+	for (uint32_t i = 0; i < THREADS; i++) {
+		producers[i].ring = &ring;
+		producers[i].id = i;
+		consumers[i].ring = &ring;
+		consumers[i].popped = &popped;
+
+		assert_int_equal(pthread_create(&threads[i], NULL, producer_thread, &producers[i]), 0);
+		assert_int_equal(pthread_create(&threads[THREADS + i], NULL, consumer_thread, &consumers[i]), 0);
+	}
+
+	for (size_t i = 0; i < THREADS * 2; i++)
+		pthread_join(threads[i], NULL);
+
+	for (uint32_t producer = 0; producer < THREADS; producer++) {
+		uint32_t total = 0;
+
+		for (size_t i = 0; i < THREADS; i++)
+			total += consumers[i].counts[producer];
+
+		assert_int_equal(total, THREAD_ITEMS);
+	}
+
+	for (size_t i = 0; i < THREADS; i++)
+		assert_true(consumers[i].ordered);
+
+	assert_true(mpmc_ring_empty(&ring));
+	mpmc_ring_free(&ring);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(ring_wrap_test),
+		cmocka_unit_test(ring_thread_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,96 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/spsc-ring.h>
+
+#define THREAD_ITEMS 100000
+
+static void ring_wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_ring ring;
+	uint8_t in[24], out[24];
+
+	spsc_ring_init(&ring, 60);
+	assert_int_equal(ring.capacity, 64);
+
+	for (size_t i = 0; i < sizeof(in); i++)
+		in[i] = (uint8_t)i;
+
+	/* 24 does not divide 64, so writes straddle the end of the buffer */
+	for (int pass = 0; pass < 10; pass++) {
+		assert_true(spsc_ring_space(&ring) >= sizeof(in));
+		spsc_ring_write(&ring, 0, in, sizeof(in));
+		assert_int_equal(spsc_ring_size(&ring), 0);
+		spsc_ring_commit(&ring, sizeof(in));
+		assert_int_equal(spsc_ring_size(&ring), sizeof(in));
+
+		spsc_ring_peek(&ring, 0, out, sizeof(out));
+		assert_memory_equal(in, out, sizeof(in));
+		spsc_ring_pop(&ring, sizeof(out));
+		assert_int_equal(spsc_ring_size(&ring), 0);
+	}
+
+	spsc_ring_write(&ring, 0, in, sizeof(in));
+	spsc_ring_commit(&ring, sizeof(in));
+	spsc_ring_clear(&ring);
+	assert_int_equal(spsc_ring_size(&ring), 0);
+	assert_int_equal(spsc_ring_space(&ring), 64);
+
+	spsc_ring_free(&ring);
+}
+
+static void *producer_thread(void *param)
+{
+	struct spsc_ring *ring = param;
+
+	for (uint32_t i = 0; i < THREAD_ITEMS;) {
+		if (spsc_ring_space(ring) < sizeof(i))
+			continue;
+
+		spsc_ring_write(ring, 0, &i, sizeof(i));
+		spsc_ring_commit(ring, sizeof(i));
+		i++;
+	}
+
+	return NULL;
+}
+
+static void ring_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_ring ring;
+	pthread_t thread;
+
+	spsc_ring_init(&ring, 256);
+	assert_int_equal(pthread_create(&thread, NULL, producer_thread, &ring), 0);
+
+	for (uint32_t expected = 0; expected < THREAD_ITEMS;) {
+		uint32_t val;
+
+		if (spsc_ring_size(&ring) < sizeof(val))
+			continue;
+
+		spsc_ring_peek(&ring, 0, &val, sizeof(val));
+		spsc_ring_pop(&ring, sizeof(val));
+		assert_int_equal(val, expected);
+		expected++;
+	}
+
+	pthread_join(thread, NULL);
+	spsc_ring_free(&ring);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(ring_wrap_test),
+		cmocka_unit_test(ring_thread_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,233 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/task.h>
+#include <util/threading.h>
+#include <util/bmem.h>
+
+/* more queues than the pool has threads, so the pool is shared */
+#define QUEUES 40
+#define QUEUE_TASKS 2000
+#define POOL_TASKS 10000
+
+struct order_data {
+	os_task_queue_t *queue;
+	long next;
+	bool ordered;
+	bool inside;
+};
+
+struct order_task {
+	struct order_data *data;
+	long index;
+};
+
+static void order_task(void *param)
+{
+	struct order_task *task = param;
+	struct order_data *data = task->data;
+
+	if (task->index != data->next)
+		data->ordered = false;
+	if (!os_task_queue_inside(data->queue))
+		data->inside = false;
+
+	data->next++;
+}
+
+static void queue_order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct order_data data[QUEUES];
+	struct order_task *tasks = bmalloc(sizeof(*tasks) * QUEUES * QUEUE_TASKS);
+
+	for (size_t i = 0; i < QUEUES; i++) {
+		enum os_task_priority priority = (enum os_task_priority)(i % 3);
+
+		data[i].queue = os_task_queue_create_named("test", priority);
+		data[i].next = 0;
+		data[i].ordered = true;
+		data[i].inside = true;
+		assert_non_null(data[i].queue);
+	}
+
+	/* interleaved, so the queues are all in the ready list at once */
+	for (long t = 0; t < QUEUE_TASKS; t++) {
+		for (size_t i = 0; i < QUEUES; i++) {
+			struct order_task *task = &tasks[i * QUEUE_TASKS + t];
+			task->data = &data[i];
+			task->index = t;
+			assert_true(os_task_queue_queue_task(data[i].queue, order_task, task));
+		}
+	}
+
+	for (size_t i = 0; i < QUEUES; i++) {
+		os_task_queue_wait(data[i].queue);
+		assert_int_equal(data[i].next, QUEUE_TASKS);
+		assert_true(data[i].ordered);
+		assert_true(data[i].inside);
+		assert_false(os_task_queue_inside(data[i].queue));
+		os_task_queue_destroy(data[i].queue);
+	}
+
+	bfree(tasks);
+}
+
+struct chain_data {
+	os_task_queue_t *queues[QUEUES];
+	volatile long completed;
+};
+
+struct chain_task {
+	struct chain_data *data;
+	size_t index;
+};
+
+static void chain_task(void *param)
+{
+	struct chain_task *task = param;
+	struct chain_data *data = task->data;
+
+	/* each task waits on the next queue from inside its own, which nests
+	 * deeper than the pool has threads */
+	if (task->index + 1 < QUEUES) {
+		struct chain_task *next = &task[1];
+		os_task_queue_queue_task(data->queues[task->index + 1], chain_task, next);
+		os_task_queue_wait(data->queues[task->index + 1]);
+	}
+
+	os_atomic_inc_long(&data->completed);
+}
+
+static void nested_wait_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct chain_data data = {0};
+	struct chain_task tasks[QUEUES];
+
+	for (size_t i = 0; i < QUEUES; i++) {
+		data.queues[i] = os_task_queue_create();
+		assert_non_null(data.queues[i]);
+		tasks[i].data = &data;
+		tasks[i].index = i;
+	}
+
+	for (int pass = 0; pass < 20; pass++) {
+		os_atomic_set_long(&data.completed, 0);
+		os_task_queue_queue_task(data.queues[0], chain_task, &tasks[0]);
+		os_task_queue_wait(data.queues[0]);
+		assert_int_equal(os_atomic_load_long(&data.completed), QUEUES);
+	}
+
+	/* destroying a queue whose task is waiting on the next one */
+	os_atomic_set_long(&data.completed, 0);
+	os_task_queue_queue_task(data.queues[0], chain_task, &tasks[0]);
+	for (size_t i = 0; i < QUEUES; i++)
+		os_task_queue_destroy(data.queues[i]);
+	assert_int_equal(os_atomic_load_long(&data.completed), QUEUES);
+}
+
+struct blocking_data {
+	os_event_t *events[QUEUES];
+	volatile long released;
+};
+
+struct blocking_task {
+	struct blocking_data *data;
+	os_event_t *event;
+};
+
+static void blocking_task(void *param)
+{
+	struct blocking_task *task = param;
+
+	os_event_wait(task->event);
+	os_atomic_inc_long(&task->data->released);
+}
+
+static void release_task(void *param)
+{
+	struct blocking_data *data = param;
+
+	for (size_t i = 0; i < QUEUES; i++)
+		os_event_signal(data->events[i]);
+}
+
+static void dedicated_queue_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct blocking_data data = {0};
+	struct blocking_task tasks[QUEUES];
+	os_task_queue_t *dedicated[QUEUES];
+	os_task_queue_t *shared;
+
+	/* more blocked queues than the pool has threads: the task that
+	 * unblocks them only runs if they don't hold shared workers */
+	for (size_t i = 0; i < QUEUES; i++) {
+		assert_int_equal(os_event_init(&data.events[i], OS_EVENT_TYPE_MANUAL), 0);
+		tasks[i].data = &data;
+		tasks[i].event = data.events[i];
+
+		dedicated[i] = os_task_queue_create_dedicated("test: blocking", OS_TASK_PRIORITY_NORMAL);
+		assert_non_null(dedicated[i]);
+		assert_true(os_task_queue_queue_task(dedicated[i], blocking_task, &tasks[i]));
+	}
+
+	shared = os_task_queue_create();
+	assert_non_null(shared);
+	assert_true(os_task_queue_queue_task(shared, release_task, &data));
+	os_task_queue_wait(shared);
+
+	for (size_t i = 0; i < QUEUES; i++)
+		os_task_queue_destroy(dedicated[i]);
+	assert_int_equal(os_atomic_load_long(&data.released), QUEUES);
+
+	os_task_queue_destroy(shared);
+	for (size_t i = 0; i < QUEUES; i++)
+		os_event_destroy(data.events[i]);
+}
+
+static void count_task(void *param)
+{
+	os_atomic_inc_long(param);
+}
+
+static void pool_task_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	volatile long count = 0;
+
+	for (int i = 0; i < POOL_TASKS; i++)
+		assert_true(os_task_pool_queue_task((enum os_task_priority)(i % 3), count_task, (void *)&count));
+	assert_false(os_task_pool_queue_task(OS_TASK_PRIORITY_NORMAL, NULL, NULL));
+
+	/* freeing the pool runs whatever the workers didn't get to */
+	os_task_pool_free();
+	assert_int_equal(os_atomic_load_long(&count), POOL_TASKS);
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_free();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(queue_order_test),
+		cmocka_unit_test(nested_wait_test),
+		cmocka_unit_test(dedicated_queue_test),
+		cmocka_unit_test(pool_task_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, teardown);
+}
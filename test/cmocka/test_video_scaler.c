@@ -0,0 +1,111 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+
+#define SRC_WIDTH 1920
+#define SRC_HEIGHT 1080
+#define DST_WIDTH 1280
+#define DST_HEIGHT 720
+
+/* not a multiple of 4, so an 8-bit intermediate would be off by 2 */
+#define FLAT_VALUE 514
+
+static void fill_plane16(struct video_frame *frame, size_t plane, uint32_t height, uint16_t val)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		uint16_t *line = (uint16_t *)(frame->data[plane] + y * frame->linesize[plane]);
+		for (uint32_t x = 0; x < frame->linesize[plane] / 2; x++)
+			line[x] = val;
+	}
+}
+
+static void check_plane16(const struct video_frame *frame, size_t plane, uint32_t width, uint32_t height, int shift)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		const uint16_t *line = (const uint16_t *)(frame->data[plane] + y * frame->linesize[plane]);
+		for (uint32_t x = 0; x < width; x++) {
+			int val = line[x] >> shift;
+			assert_in_range(val, FLAT_VALUE - 1, FLAT_VALUE + 1);
+		}
+	}
+}
+
+static video_scaler_t *create_scaler(enum video_format format, uint32_t threads)
+{
+	struct video_scale_info src = {
+		.format = format,
+		.width = SRC_WIDTH,
+		.height = SRC_HEIGHT,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = format == VIDEO_FORMAT_NV12 ? VIDEO_CS_709 : VIDEO_CS_2100_PQ,
+	};
+	struct video_scale_info dst = src;
+	video_scaler_t *scaler = NULL;
+
+	dst.width = DST_WIDTH;
+	dst.height = DST_HEIGHT;
+	dst.threads = threads;
+
+	assert_int_equal(video_scaler_create(&scaler, &dst, &src, VIDEO_SCALE_BILINEAR), VIDEO_SCALER_SUCCESS);
+	return scaler;
+}
+
+static void p010_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct video_frame in, out;
+	video_frame_init(&in, VIDEO_FORMAT_P010, SRC_WIDTH, SRC_HEIGHT);
+	video_frame_init(&out, VIDEO_FORMAT_P010, DST_WIDTH, DST_HEIGHT);
+
+	fill_plane16(&in, 0, SRC_HEIGHT, FLAT_VALUE << 6);
+	fill_plane16(&in, 1, SRC_HEIGHT / 2, FLAT_VALUE << 6);
+
+	video_scaler_t *scaler = create_scaler(VIDEO_FORMAT_P010, 0);
+	assert_true(video_scaler_scale(scaler, out.data, out.linesize, (const uint8_t *const *)in.data, in.linesize));
+	video_scaler_destroy(scaler);
+
+	check_plane16(&out, 0, DST_WIDTH, DST_HEIGHT, 6);
+	check_plane16(&out, 1, DST_WIDTH, DST_HEIGHT / 2, 6);
+
+	video_frame_free(&in);
+	video_frame_free(&out);
+}
+
+static void i010_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct video_frame in, out;
+	video_frame_init(&in, VIDEO_FORMAT_I010, SRC_WIDTH, SRC_HEIGHT);
+	video_frame_init(&out, VIDEO_FORMAT_I010, DST_WIDTH, DST_HEIGHT);
+
+	fill_plane16(&in, 0, SRC_HEIGHT, FLAT_VALUE);
+	fill_plane16(&in, 1, SRC_HEIGHT / 2, FLAT_VALUE);
+	fill_plane16(&in, 2, SRC_HEIGHT / 2, FLAT_VALUE);
+
+	video_scaler_t *scaler = create_scaler(VIDEO_FORMAT_I010, 0);
+	assert_true(video_scaler_scale(scaler, out.data, out.linesize, (const uint8_t *const *)in.data, in.linesize));
+	video_scaler_destroy(scaler);
+
+	check_plane16(&out, 0, DST_WIDTH, DST_HEIGHT, 0);
+	check_plane16(&out, 1, DST_WIDTH / 2, DST_HEIGHT / 2, 0);
+	check_plane16(&out, 2, DST_WIDTH / 2, DST_HEIGHT / 2, 0);
+
+	video_frame_free(&in);
+	video_frame_free(&out);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(p010_test),
+		cmocka_unit_test(i010_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,755 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Headless video encoder benchmark.  Runs every requested video encoder
+ * over a matrix of resolutions, presets and rate controls.  Synthetic NV12
+ * frames are pushed into a video output of the benchmark's own, which is
+ * not tied to the render clock, as fast as the encoder takes them.  Prints
+ * fps, CPU and GPU usage and the frame push to packet latency of each run
+ * as JSON. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+#ifdef _WIN32
+#define DEFAULT_RENDERER "libobs-d3d11"
+#else
+#define DEFAULT_RENDERER "libobs-opengl"
+#endif
+
+/* distinct frames cycled through, enough that encoders can't just skip */
+#define BANK_FRAMES 8
+#define BLOCK_SIZE 16
+
+/* frames pushed but not yet handed to the encoder, well below the cache
+ * size so the video output never has to merge frames */
+#define VIDEO_CACHE_SIZE 16
+#define MAX_QUEUED_FRAMES 8
+
+#define STALL_TIMEOUT_NS 5000000000ULL
+#define DRAIN_TIMEOUT_NS 1000000000ULL
+#define STOP_TIMEOUT_NS 5000000000ULL
+#define GPU_SAMPLE_INTERVAL_NS 100000000ULL
+
+struct bench_config {
+	char **encoders;
+	char **resolutions;
+	char **presets;
+	char **rate_controls;
+	const char *preset_key;
+	const char *output_path;
+	const char *renderer;
+	int bitrate;
+	int fps;
+	int frames;
+	bool verbose;
+};
+
+struct frame_bank {
+	uint32_t width;
+	uint32_t height;
+	uint8_t *luma[BANK_FRAMES];
+	uint8_t *chroma[BANK_FRAMES];
+};
+
+struct bench_run {
+	uint32_t frames;
+	uint64_t *push_times;
+	uint64_t *latencies;
+
+	volatile long packets;
+	uint64_t bytes;
+	uint64_t first_packet_ns;
+	uint64_t last_packet_ns;
+};
+
+struct gpu_usage {
+	char *path;
+	uint64_t last_sample;
+	double total;
+	int samples;
+};
+
+/* only one run is active at a time */
+static struct bench_run *cur_run = NULL;
+
+/* ------------------------------------------------------------------------- */
+/* bench_output: encoded output that only records packet timing and size */
+
+static const char *bench_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Encoder Benchmark Output";
+}
+
+static void *bench_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void bench_output_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool bench_output_start(void *data)
+{
+	obs_output_t *output = data;
+
+	if (!obs_output_can_begin_data_capture(output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void bench_output_stop(void *data, uint64_t ts)
+{
+	obs_output_end_data_capture(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static void bench_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct bench_run *run = cur_run;
+	const uint64_t now = os_gettime_ns();
+
+	if (!packet || !run || packet->type != OBS_ENCODER_VIDEO)
+		return;
+
+	/* pts counts frames in units of the frame rate denominator */
+	int64_t idx = packet->timebase_num ? packet->pts / packet->timebase_num : -1;
+	if (idx >= 0 && idx < (int64_t)run->frames && run->push_times[idx])
+		run->latencies[idx] = now - run->push_times[idx];
+
+	if (!run->first_packet_ns)
+		run->first_packet_ns = now;
+	run->last_packet_ns = now;
+	run->bytes += packet->size;
+	os_atomic_inc_long(&run->packets);
+
+	UNUSED_PARAMETER(data);
+}
+
+static struct obs_output_info bench_output = {
+	.id = "bench_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = bench_output_name,
+	.create = bench_output_create,
+	.destroy = bench_output_destroy,
+	.start = bench_output_start,
+	.stop = bench_output_stop,
+	.encoded_packet = bench_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* synthetic frames: a scrolling gradient under a field of random blocks,
+ * an eighth of which change every frame */
+
+static void frame_bank_init(struct frame_bank *bank, uint32_t width, uint32_t height)
+{
+	const uint32_t blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const uint32_t blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	uint8_t *field = bmalloc(blocks_x * blocks_y);
+
+	bank->width = width;
+	bank->height = height;
+
+	/* the same content for every run */
+	srand(1);
+	for (uint32_t i = 0; i < blocks_x * blocks_y; i++)
+		field[i] = (uint8_t)(rand() % 256);
+
+	for (int f = 0; f < BANK_FRAMES; f++) {
+		uint8_t *luma = bmalloc(width * height);
+		uint8_t *chroma = bmalloc(width * (height / 2));
+
+		for (uint32_t i = 0; i < blocks_x * blocks_y; i++) {
+			if (rand() % 8 == 0)
+				field[i] = (uint8_t)(rand() % 256);
+		}
+
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				uint8_t block = field[(y / BLOCK_SIZE) * blocks_x + x / BLOCK_SIZE];
+				luma[y * width + x] = (uint8_t)(block / 2 + ((x + y + f * 8) & 127));
+			}
+		}
+
+		for (uint32_t y = 0; y < height / 2; y++) {
+			for (uint32_t x = 0; x < width / 2; x++) {
+				uint8_t block = field[(y * 2 / BLOCK_SIZE) * blocks_x + x * 2 / BLOCK_SIZE];
+				chroma[y * width + x * 2] = (uint8_t)(96 + block / 4);
+				chroma[y * width + x * 2 + 1] = (uint8_t)(160 - block / 4);
+			}
+		}
+
+		bank->luma[f] = luma;
+		bank->chroma[f] = chroma;
+	}
+
+	bfree(field);
+}
+
+static void frame_bank_free(struct frame_bank *bank)
+{
+	for (int f = 0; f < BANK_FRAMES; f++) {
+		bfree(bank->luma[f]);
+		bfree(bank->chroma[f]);
+	}
+}
+
+static void release_frame(void *param)
+{
+	UNUSED_PARAMETER(param);
+}
+
+/* ------------------------------------------------------------------------- */
+/* GPU usage, where the driver exposes it (amdgpu on Linux) */
+
+static void gpu_usage_init(struct gpu_usage *gpu)
+{
+	memset(gpu, 0, sizeof(*gpu));
+
+#ifdef __linux__
+	for (int card = 0; card < 8; card++) {
+		char path[128];
+		snprintf(path, sizeof(path), "/sys/class/drm/card%d/device/gpu_busy_percent", card);
+
+		if (os_file_exists(path)) {
+			gpu->path = bstrdup(path);
+			break;
+		}
+	}
+#endif
+}
+
+static void gpu_usage_sample(struct gpu_usage *gpu)
+{
+	const uint64_t now = os_gettime_ns();
+	int percent;
+
+	if (!gpu->path || now - gpu->last_sample < GPU_SAMPLE_INTERVAL_NS)
+		return;
+
+	FILE *file = os_fopen(gpu->path, "r");
+	if (!file)
+		return;
+
+	if (fscanf(file, "%d", &percent) == 1) {
+		gpu->total += percent;
+		gpu->samples++;
+	}
+
+	fclose(file);
+	gpu->last_sample = now;
+}
+
+static void gpu_usage_free(struct gpu_usage *gpu)
+{
+	bfree(gpu->path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool verbose_log = false;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	if (log_level <= LOG_WARNING || verbose_log) {
+		vfprintf(stderr, msg, args);
+		fputc('\n', stderr);
+	}
+
+	UNUSED_PARAMETER(param);
+}
+
+static bool init_obs(const struct bench_config *cfg)
+{
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	/* encoders get their frames from the bench's own video output, the
+	 * main one only has to exist */
+	struct obs_video_info ovi = {
+		.graphics_module = cfg->renderer,
+		.fps_num = 1,
+		.fps_den = 1,
+		.base_width = 64,
+		.base_height = 64,
+		.output_width = 64,
+		.output_height = 64,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BILINEAR,
+	};
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Couldn't initialize video with '%s'", cfg->renderer);
+		return false;
+	}
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	obs_register_output(&bench_output);
+	return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static void add_latency_stats(obs_data_t *result, const struct bench_run *run)
+{
+	uint64_t *sorted = bmalloc(sizeof(uint64_t) * run->frames);
+	uint64_t total = 0;
+	size_t num = 0;
+
+	for (uint32_t i = 0; i < run->frames; i++) {
+		if (run->latencies[i]) {
+			sorted[num++] = run->latencies[i];
+			total += run->latencies[i];
+		}
+	}
+
+	if (num) {
+		qsort(sorted, num, sizeof(uint64_t), compare_u64);
+
+		obs_data_set_double(result, "latency_mean_ms", (double)total / (double)num / 1000000.0);
+		obs_data_set_double(result, "latency_p99_ms", (double)sorted[num * 99 / 100] / 1000000.0);
+		obs_data_set_double(result, "latency_max_ms", (double)sorted[num - 1] / 1000000.0);
+	}
+
+	bfree(sorted);
+}
+
+/* waits until the encoder has taken all but MAX_QUEUED_FRAMES - 1 of the
+ * pushed frames, false if it stops making progress */
+static bool wait_for_encoder(obs_encoder_t *encoder, uint32_t pushed, struct gpu_usage *gpu)
+{
+	struct obs_encoder_stats stats;
+	uint64_t last_submitted = 0;
+	uint64_t last_progress = os_gettime_ns();
+
+	for (;;) {
+		obs_encoder_get_stats(encoder, &stats);
+		if (pushed - stats.frames_submitted < MAX_QUEUED_FRAMES)
+			return true;
+
+		const uint64_t now = os_gettime_ns();
+		if (stats.frames_submitted != last_submitted) {
+			last_submitted = stats.frames_submitted;
+			last_progress = now;
+		} else if (now - last_progress > STALL_TIMEOUT_NS) {
+			return false;
+		}
+
+		gpu_usage_sample(gpu);
+		os_sleep_ms(1);
+	}
+}
+
+/* delayed packets (lookahead, B-frames) may never come without a flush,
+ * so this only waits until they stop coming */
+static void wait_for_packets(struct bench_run *run, struct gpu_usage *gpu)
+{
+	long last_packets = os_atomic_load_long(&run->packets);
+	uint64_t last_progress = os_gettime_ns();
+
+	while (last_packets < (long)run->frames) {
+		const uint64_t now = os_gettime_ns();
+		long packets = os_atomic_load_long(&run->packets);
+
+		if (packets != last_packets) {
+			last_packets = packets;
+			last_progress = now;
+		} else if (now - last_progress > DRAIN_TIMEOUT_NS) {
+			break;
+		}
+
+		gpu_usage_sample(gpu);
+		os_sleep_ms(1);
+	}
+}
+
+static void stop_output(obs_output_t *output)
+{
+	const uint64_t start = os_gettime_ns();
+
+	obs_output_stop(output);
+	while (obs_output_active(output)) {
+		if (os_gettime_ns() - start > STOP_TIMEOUT_NS) {
+			obs_output_force_stop(output);
+			break;
+		}
+		os_sleep_ms(1);
+	}
+}
+
+static void run_encoder(const struct bench_config *cfg, const char *id, const struct frame_bank *bank,
+			const char *preset, const char *rate_control, obs_data_array_t *results)
+{
+	obs_data_t *result = obs_data_create();
+	obs_data_t *settings = obs_data_create();
+	obs_encoder_t *encoder = NULL;
+	obs_output_t *output = NULL;
+	video_t *video = NULL;
+	os_cpu_usage_info_t *cpu = NULL;
+	struct gpu_usage gpu;
+	struct bench_run run = {0};
+
+	obs_data_set_string(result, "encoder", id);
+	obs_data_set_string(result, "codec", obs_get_encoder_codec(id));
+	obs_data_set_int(result, "width", bank->width);
+	obs_data_set_int(result, "height", bank->height);
+	obs_data_set_int(result, "fps", cfg->fps);
+	obs_data_set_string(result, "preset", *preset ? preset : "default");
+	obs_data_set_string(result, "rate_control", *rate_control ? rate_control : "default");
+	obs_data_set_int(result, "bitrate", cfg->bitrate);
+
+	if (*preset)
+		obs_data_set_string(settings, cfg->preset_key, preset);
+	if (*rate_control)
+		obs_data_set_string(settings, "rate_control", rate_control);
+	obs_data_set_int(settings, "bitrate", cfg->bitrate);
+	obs_data_set_int(settings, "keyint_sec", 2);
+
+	struct video_output_info voi = {
+		.name = "encoder bench",
+		.format = VIDEO_FORMAT_NV12,
+		.fps_num = (uint32_t)cfg->fps,
+		.fps_den = 1,
+		.width = bank->width,
+		.height = bank->height,
+		.cache_size = VIDEO_CACHE_SIZE,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		obs_data_set_string(result, "error", "Couldn't open the video output");
+		goto finish;
+	}
+
+	encoder = obs_video_encoder_create(id, "bench encoder", settings, NULL);
+	if (!encoder) {
+		obs_data_set_string(result, "error", "Couldn't create the encoder");
+		goto finish;
+	}
+
+	obs_encoder_set_video(encoder, video);
+
+	output = obs_output_create("bench_output", "bench output", NULL, NULL);
+	obs_output_set_video_encoder(output, encoder);
+
+	run.frames = (uint32_t)cfg->frames;
+	run.push_times = bzalloc(sizeof(uint64_t) * run.frames);
+	run.latencies = bzalloc(sizeof(uint64_t) * run.frames);
+	cur_run = &run;
+
+	if (!obs_output_start(output)) {
+		const char *error = obs_output_get_last_error(output);
+		obs_data_set_string(result, "error", error ? error : "Couldn't start the encoder");
+		goto finish;
+	}
+
+	cpu = os_cpu_usage_info_start();
+	gpu_usage_init(&gpu);
+
+	const uint64_t interval = 1000000000ULL / (uint64_t)cfg->fps;
+	const uint64_t start = os_gettime_ns();
+	bool stalled = false;
+
+	for (uint32_t i = 0; i < run.frames; i++) {
+		if (!wait_for_encoder(encoder, i, &gpu)) {
+			stalled = true;
+			break;
+		}
+
+		struct video_data frame = {
+			.data = {bank->luma[i % BANK_FRAMES], bank->chroma[i % BANK_FRAMES]},
+			.linesize = {bank->width, bank->width},
+			.timestamp = start + interval * i,
+		};
+
+		run.push_times[i] = os_gettime_ns();
+		video_output_push_frame_ref(video, &frame, 1, release_frame, NULL);
+	}
+
+	if (!stalled)
+		wait_for_packets(&run, &gpu);
+
+	const double cpu_percent = os_cpu_usage_info_query(cpu);
+
+	stop_output(output);
+
+	const long packets = os_atomic_load_long(&run.packets);
+	obs_data_set_int(result, "packets", packets);
+
+	if (stalled || packets < 2) {
+		obs_data_set_string(result, "error", "The encoder stopped taking frames");
+	} else {
+		const double duration = (double)(run.last_packet_ns - run.first_packet_ns) / 1000000000.0;
+		const double fps = (double)(packets - 1) / duration;
+
+		obs_data_set_double(result, "encode_fps", fps);
+		obs_data_set_double(result, "realtime_ratio", fps / (double)cfg->fps);
+		obs_data_set_double(result, "output_kbps",
+				    (double)run.bytes * 8.0 * (double)cfg->fps / (double)packets / 1000.0);
+		obs_data_set_double(result, "cpu_percent", cpu_percent);
+		if (gpu.samples)
+			obs_data_set_double(result, "gpu_percent", gpu.total / (double)gpu.samples);
+
+		add_latency_stats(result, &run);
+	}
+
+	os_cpu_usage_info_destroy(cpu);
+	gpu_usage_free(&gpu);
+
+finish:
+	cur_run = NULL;
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	if (video)
+		video_output_close(video);
+
+	bfree(run.push_times);
+	bfree(run.latencies);
+
+	if (cfg->verbose || obs_data_has_user_value(result, "error"))
+		blog(LOG_INFO, "%s %ux%u preset %s, rate control %s: %s", id, bank->width, bank->height,
+		     *preset ? preset : "default", *rate_control ? rate_control : "default",
+		     obs_data_has_user_value(result, "error") ? obs_data_get_string(result, "error") : "done");
+
+	obs_data_array_push_back(results, result);
+	obs_data_release(settings);
+	obs_data_release(result);
+}
+
+static bool parse_resolution(const char *str, uint32_t *width, uint32_t *height)
+{
+	unsigned int w, h;
+
+	if (sscanf(str, "%ux%u", &w, &h) != 2 || !w || !h || w % 2 || h % 2)
+		return false;
+
+	*width = w;
+	*height = h;
+	return true;
+}
+
+static void run_bench(const struct bench_config *cfg, obs_data_array_t *results)
+{
+	for (char **res = cfg->resolutions; *res; res++) {
+		struct frame_bank bank;
+		uint32_t width, height;
+
+		if (!parse_resolution(*res, &width, &height)) {
+			blog(LOG_WARNING, "Invalid resolution '%s'", *res);
+			continue;
+		}
+
+		frame_bank_init(&bank, width, height);
+
+		for (char **id = cfg->encoders; *id; id++) {
+			for (char **preset = cfg->presets; *preset; preset++) {
+				for (char **rc = cfg->rate_controls; *rc; rc++)
+					run_encoder(cfg, *id, &bank, *preset, *rc, results);
+			}
+		}
+
+		frame_bank_free(&bank);
+	}
+}
+
+/* every registered video encoder that isn't deprecated */
+static char **all_video_encoders(void)
+{
+	struct dstr list = {0};
+	const char *id;
+
+	for (size_t i = 0; obs_enum_encoder_types(i, &id); i++) {
+		if (obs_get_encoder_type(id) != OBS_ENCODER_VIDEO)
+			continue;
+		if (obs_get_encoder_caps(id) & OBS_ENCODER_CAP_DEPRECATED)
+			continue;
+
+		if (list.len)
+			dstr_cat_ch(&list, ',');
+		dstr_cat(&list, id);
+	}
+
+	char **encoders = strlist_split(list.array ? list.array : "", ',', false);
+	dstr_free(&list);
+	return encoders;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [options]\n"
+	       "  --encoders LIST       comma separated encoder ids (default: all video encoders)\n"
+	       "  --resolutions LIST    comma separated WxH (default 1280x720,1920x1080)\n"
+	       "  --presets LIST        comma separated presets (default: the encoder's)\n"
+	       "  --preset-key KEY      setting the presets are written to (default preset)\n"
+	       "  --rate-control LIST   comma separated rate controls (default: the encoder's)\n"
+	       "  --bitrate KBPS        bitrate setting (default 6000)\n"
+	       "  --fps N               frame rate of the synthetic video (default 60)\n"
+	       "  --frames N            frames per run (default 600)\n"
+	       "  --output FILE         write the JSON there instead of stdout\n"
+	       "  --renderer MODULE     graphics module (default " DEFAULT_RENDERER ")\n"
+	       "  --verbose             print the libobs log\n"
+	       "\n"
+	       "cpu_percent is of all logical cores; gpu_percent is only present where\n"
+	       "the driver reports GPU usage.\n",
+	       name);
+}
+
+static bool parse_args(struct bench_config *cfg, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			cfg->verbose = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--encoders") == 0) {
+			strlist_free(cfg->encoders);
+			cfg->encoders = strlist_split(val, ',', false);
+		} else if (strcmp(arg, "--resolutions") == 0) {
+			strlist_free(cfg->resolutions);
+			cfg->resolutions = strlist_split(val, ',', false);
+		} else if (strcmp(arg, "--presets") == 0) {
+			strlist_free(cfg->presets);
+			cfg->presets = strlist_split(val, ',', false);
+		} else if (strcmp(arg, "--rate-control") == 0) {
+			strlist_free(cfg->rate_controls);
+			cfg->rate_controls = strlist_split(val, ',', false);
+		} else if (strcmp(arg, "--preset-key") == 0) {
+			cfg->preset_key = val;
+		} else if (strcmp(arg, "--bitrate") == 0) {
+			cfg->bitrate = atoi(val);
+		} else if (strcmp(arg, "--fps") == 0) {
+			cfg->fps = atoi(val);
+		} else if (strcmp(arg, "--frames") == 0) {
+			cfg->frames = atoi(val);
+		} else if (strcmp(arg, "--output") == 0) {
+			cfg->output_path = val;
+		} else if (strcmp(arg, "--renderer") == 0) {
+			cfg->renderer = val;
+		} else {
+			return false;
+		}
+		i++;
+	}
+
+	return cfg->bitrate > 0 && cfg->fps > 0 && cfg->frames > 1 && *cfg->resolutions && *cfg->presets &&
+	       *cfg->rate_controls;
+}
+
+static void free_config(struct bench_config *cfg)
+{
+	strlist_free(cfg->encoders);
+	strlist_free(cfg->resolutions);
+	strlist_free(cfg->presets);
+	strlist_free(cfg->rate_controls);
+}
+
+static bool write_results(const struct bench_config *cfg, obs_data_array_t *results)
+{
+	obs_data_t *root = obs_data_create();
+	bool success = true;
+
+	obs_data_set_array(root, "results", results);
+	const char *json = obs_data_get_json_pretty(root);
+
+	if (cfg->output_path) {
+		success = os_quick_write_utf8_file(cfg->output_path, json, strlen(json), false);
+		if (!success)
+			fprintf(stderr, "Couldn't write '%s'\n", cfg->output_path);
+	} else {
+		printf("%s\n", json);
+	}
+
+	obs_data_release(root);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	/* an empty entry stands for the encoder's default */
+	struct bench_config cfg = {
+		.resolutions = strlist_split("1280x720,1920x1080", ',', false),
+		.presets = strlist_split("", ',', true),
+		.rate_controls = strlist_split("", ',', true),
+		.preset_key = "preset",
+		.renderer = DEFAULT_RENDERER,
+		.bitrate = 6000,
+		.fps = 60,
+		.frames = 600,
+	};
+	int ret = 0;
+
+	if (!parse_args(&cfg, argc, argv)) {
+		usage(argv[0]);
+		free_config(&cfg);
+		return 1;
+	}
+
+	verbose_log = cfg.verbose;
+	base_set_log_handler(do_log, NULL);
+
+	if (init_obs(&cfg)) {
+		obs_data_array_t *results = obs_data_array_create();
+
+		if (!cfg.encoders)
+			cfg.encoders = all_video_encoders();
+
+		run_bench(&cfg, results);
+		if (!write_results(&cfg, results))
+			ret = 1;
+
+		obs_data_array_release(results);
+	} else {
+		fprintf(stderr, "Couldn't initialize libobs\n");
+		ret = 1;
+	}
+
+	obs_shutdown();
+	free_config(&cfg);
+
+	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	return ret;
+}
@@ -0,0 +1,805 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* libobs micro-benchmarks.  Times small pieces of libobs that run without
+ * obs_startup: containers, allocation, format conversion, the video scaler,
+ * audio math, obs_data JSON and signal dispatch.  Each benchmark runs enough
+ * iterations to last --min-time, repeated --repetitions times, and reports
+ * the median time per operation along with allocations per operation.
+ *
+ * --format json prints the same results as JSON, and --baseline compares
+ * them to an earlier JSON run, exiting with 2 when any benchmark got slower
+ * than --threshold percent.  The audio pipeline, encoders, and network
+ * outputs have their own benchmarks in audio-bench, encoder-bench and
+ * output-bench. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/deque.h>
+#include <util/platform.h>
+#include <callback/signal.h>
+#include <media-io/audio-math.h>
+#include <media-io/format-conversion.h>
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+
+struct bench_config {
+	int min_time_ms;
+	int repetitions;
+	double threshold;
+	const char *filter;
+	const char *baseline_path;
+	const char *output_path;
+	bool json;
+	bool list;
+	bool verbose;
+};
+
+struct bench_state {
+	uint64_t iterations;
+	/* bytes processed by one operation, for throughput */
+	uint64_t bytes_per_op;
+	void *data;
+};
+
+struct bench_info {
+	const char *name;
+	bool (*setup)(struct bench_state *state);
+	void (*run)(struct bench_state *state);
+	void (*teardown)(struct bench_state *state);
+};
+
+struct bench_result {
+	const char *name;
+	uint64_t iterations;
+	double ns_per_op;
+	double ns_per_op_min;
+	double ns_per_op_max;
+	double bytes_per_second;
+	double allocs_per_op;
+};
+
+/* keeps the compiler from dropping the work being measured */
+static volatile uint64_t bench_sink;
+static volatile float bench_sink_float;
+
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+#define SCALED_WIDTH 1280
+#define SCALED_HEIGHT 720
+
+/* ------------------------------------------------------------------------- */
+/* containers and allocation */
+
+#define DARRAY_BATCH 1024
+
+static void bench_darray_push_pop(struct bench_state *state)
+{
+	DARRAY(uint64_t) array;
+	da_init(array);
+
+	/* fill and drain in batches so long runs don't hold all of it */
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		da_push_back(array, &i);
+
+		if (array.num == DARRAY_BATCH || i + 1 == state->iterations) {
+			while (array.num) {
+				bench_sink += array.array[array.num - 1];
+				da_pop_back(array);
+			}
+		}
+	}
+
+	da_free(array);
+}
+
+#define DEQUE_ITEM_SIZE 64
+#define DEQUE_DEPTH 256
+
+static void bench_deque_push_pop(struct bench_state *state)
+{
+	uint8_t item[DEQUE_ITEM_SIZE] = {0};
+	struct deque dq;
+	deque_init(&dq);
+
+	/* a queue that stays about as deep, like the audio and video queues */
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		item[0] = (uint8_t)i;
+		deque_push_back(&dq, item, sizeof(item));
+		if (dq.size >= DEQUE_ITEM_SIZE * DEQUE_DEPTH)
+			deque_pop_front(&dq, item, sizeof(item));
+	}
+
+	bench_sink += dq.size;
+	deque_free(&dq);
+}
+
+static void bench_bmem_alloc_free(struct bench_state *state)
+{
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		/* 16 bytes to 2 KiB */
+		uint8_t *ptr = bmalloc((size_t)16 << (i & 7));
+		ptr[0] = (uint8_t)i;
+		bench_sink += ptr[0];
+		bfree(ptr);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* format conversion and scaling */
+
+struct frames_data {
+	struct video_frame src;
+	struct video_frame dst;
+	video_scaler_t *scaler;
+};
+
+static void fill_frame(struct video_frame *frame, uint32_t height)
+{
+	for (size_t plane = 0; plane < MAX_AV_PLANES && frame->data[plane]; plane++) {
+		uint32_t plane_height = plane ? (height + 1) / 2 : height;
+
+		for (uint32_t y = 0; y < plane_height; y++) {
+			uint8_t *line = frame->data[plane] + (size_t)y * frame->linesize[plane];
+
+			for (uint32_t x = 0; x < frame->linesize[plane]; x++)
+				line[x] = (uint8_t)(x * 7 + y * 3 + plane * 61);
+		}
+	}
+}
+
+static bool setup_frames(struct bench_state *state, enum video_format src_format, enum video_format dst_format,
+			 uint32_t dst_width, uint32_t dst_height)
+{
+	struct frames_data *data = bzalloc(sizeof(*data));
+
+	video_frame_init(&data->src, src_format, FRAME_WIDTH, FRAME_HEIGHT);
+	video_frame_init(&data->dst, dst_format, dst_width, dst_height);
+	fill_frame(&data->src, FRAME_HEIGHT);
+
+	state->data = data;
+	return true;
+}
+
+static void teardown_frames(struct bench_state *state)
+{
+	struct frames_data *data = state->data;
+
+	video_scaler_destroy(data->scaler);
+	video_frame_free(&data->src);
+	video_frame_free(&data->dst);
+	bfree(data);
+}
+
+static bool setup_compress_uyvx(struct bench_state *state)
+{
+	state->bytes_per_op = (uint64_t)FRAME_WIDTH * FRAME_HEIGHT * 4;
+	return setup_frames(state, VIDEO_FORMAT_BGRA, VIDEO_FORMAT_NV12, FRAME_WIDTH, FRAME_HEIGHT);
+}
+
+static void bench_compress_uyvx_to_nv12(struct bench_state *state)
+{
+	struct frames_data *data = state->data;
+
+	for (uint64_t i = 0; i < state->iterations; i++)
+		compress_uyvx_to_nv12(data->src.data[0], data->src.linesize[0], 0, FRAME_HEIGHT, data->dst.data,
+				      data->dst.linesize);
+}
+
+static bool setup_decompress_nv12(struct bench_state *state)
+{
+	state->bytes_per_op = (uint64_t)FRAME_WIDTH * FRAME_HEIGHT * 3 / 2;
+	return setup_frames(state, VIDEO_FORMAT_NV12, VIDEO_FORMAT_BGRA, FRAME_WIDTH, FRAME_HEIGHT);
+}
+
+static void bench_decompress_nv12(struct bench_state *state)
+{
+	struct frames_data *data = state->data;
+
+	for (uint64_t i = 0; i < state->iterations; i++)
+		decompress_nv12((const uint8_t *const *)data->src.data, data->src.linesize, 0, FRAME_HEIGHT,
+				data->dst.data[0], data->dst.linesize[0]);
+}
+
+static bool setup_decompress_422(struct bench_state *state)
+{
+	state->bytes_per_op = (uint64_t)FRAME_WIDTH * FRAME_HEIGHT * 2;
+	return setup_frames(state, VIDEO_FORMAT_YUY2, VIDEO_FORMAT_BGRA, FRAME_WIDTH, FRAME_HEIGHT);
+}
+
+static void bench_decompress_422(struct bench_state *state)
+{
+	struct frames_data *data = state->data;
+
+	/* decompress_422 takes half the byte widths, and the same for the line
+	 * strides, so it's given one line at a time */
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
+			const uint8_t *src = data->src.data[0] + (size_t)y * data->src.linesize[0];
+			uint8_t *dst = data->dst.data[0] + (size_t)y * data->dst.linesize[0];
+
+			decompress_422(src, FRAME_WIDTH, 0, 1, dst, FRAME_WIDTH * 2, false);
+		}
+	}
+}
+
+/* P010 and I010 go through the HDR paths of the scaler */
+static bool setup_scaler(struct bench_state *state, enum video_format format, uint32_t threads)
+{
+	const bool hdr = format != VIDEO_FORMAT_NV12;
+	struct video_scale_info src = {
+		.format = format,
+		.width = FRAME_WIDTH,
+		.height = FRAME_HEIGHT,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = hdr ? VIDEO_CS_2100_PQ : VIDEO_CS_709,
+	};
+	struct video_scale_info dst = src;
+	struct frames_data *data;
+
+	dst.width = SCALED_WIDTH;
+	dst.height = SCALED_HEIGHT;
+	dst.threads = threads;
+
+	setup_frames(state, format, format, SCALED_WIDTH, SCALED_HEIGHT);
+	data = state->data;
+
+	if (video_scaler_create(&data->scaler, &dst, &src, VIDEO_SCALE_BILINEAR) != VIDEO_SCALER_SUCCESS) {
+		teardown_frames(state);
+		return false;
+	}
+
+	state->bytes_per_op = (uint64_t)FRAME_WIDTH * FRAME_HEIGHT * 3 / 2 * (hdr ? 2 : 1);
+	return true;
+}
+
+static bool setup_scaler_single(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_NV12, 0);
+}
+
+static bool setup_scaler_threaded(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_NV12, 4);
+}
+
+static bool setup_scaler_p010(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_P010, 0);
+}
+
+static bool setup_scaler_p010_threaded(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_P010, 4);
+}
+
+static bool setup_scaler_i010(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_I010, 0);
+}
+
+static bool setup_scaler_i010_threaded(struct bench_state *state)
+{
+	return setup_scaler(state, VIDEO_FORMAT_I010, 4);
+}
+
+static void bench_video_scaler(struct bench_state *state)
+{
+	struct frames_data *data = state->data;
+
+	for (uint64_t i = 0; i < state->iterations; i++)
+		video_scaler_scale(data->scaler, data->dst.data, data->dst.linesize,
+				   (const uint8_t *const *)data->src.data, data->src.linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+/* audio */
+
+#define AUDIO_SAMPLES 1024
+
+static bool setup_audio_math(struct bench_state *state)
+{
+	float *samples = bmalloc(sizeof(float) * AUDIO_SAMPLES);
+
+	for (size_t i = 0; i < AUDIO_SAMPLES; i++)
+		samples[i] = (float)(i + 1) / (float)AUDIO_SAMPLES;
+
+	state->data = samples;
+	state->bytes_per_op = sizeof(float) * AUDIO_SAMPLES;
+	return true;
+}
+
+static void teardown_audio_math(struct bench_state *state)
+{
+	bfree(state->data);
+}
+
+/* the envelope to gain conversion of the compressor, limiter and expander */
+static void bench_audio_gain(struct bench_state *state)
+{
+	const float *samples = state->data;
+	float sum = 0.0f;
+
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		for (size_t j = 0; j < AUDIO_SAMPLES; j++) {
+			const float gain = 0.75f * (-18.0f - fast_mul_to_db(samples[j]));
+			sum += fast_db_to_mul(gain < 0.0f ? gain : 0.0f);
+		}
+	}
+
+	bench_sink_float = sum;
+}
+
+/* ------------------------------------------------------------------------- */
+/* obs_data */
+
+struct json_data {
+	obs_data_t *data;
+	char *json;
+};
+
+/* roughly the shape of a scene collection */
+static obs_data_t *create_collection(void)
+{
+	obs_data_t *collection = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+
+	obs_data_set_string(collection, "name", "Micro Benchmark");
+	obs_data_set_string(collection, "current_scene", "Scene");
+
+	for (int i = 0; i < 64; i++) {
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+		char name[64];
+
+		snprintf(name, sizeof(name), "Source %d", i);
+		obs_data_set_string(source, "name", name);
+		obs_data_set_string(source, "id", "image_source");
+		obs_data_set_double(source, "volume", 1.0);
+		obs_data_set_bool(source, "enabled", true);
+		obs_data_set_int(source, "mixers", 255);
+
+		obs_data_set_string(settings, "file", "/home/user/Pictures/overlay.png");
+		obs_data_set_int(settings, "width", 1920);
+		obs_data_set_int(settings, "height", 1080);
+		obs_data_set_double(settings, "opacity", 0.85);
+		obs_data_set_bool(settings, "unload", false);
+		obs_data_set_obj(source, "settings", settings);
+
+		obs_data_array_push_back(sources, source);
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_set_array(collection, "sources", sources);
+	obs_data_array_release(sources);
+	return collection;
+}
+
+static bool setup_json(struct bench_state *state)
+{
+	struct json_data *data = bzalloc(sizeof(*data));
+
+	data->data = create_collection();
+	data->json = bstrdup(obs_data_get_json(data->data));
+
+	state->data = data;
+	state->bytes_per_op = strlen(data->json);
+	return true;
+}
+
+static void teardown_json(struct bench_state *state)
+{
+	struct json_data *data = state->data;
+
+	obs_data_release(data->data);
+	bfree(data->json);
+	bfree(data);
+}
+
+static void bench_json_load(struct bench_state *state)
+{
+	struct json_data *data = state->data;
+
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		obs_data_t *loaded = obs_data_create_from_json(data->json);
+		bench_sink += (uintptr_t)loaded;
+		obs_data_release(loaded);
+	}
+}
+
+static void bench_json_save(struct bench_state *state)
+{
+	struct json_data *data = state->data;
+
+	for (uint64_t i = 0; i < state->iterations; i++)
+		bench_sink += strlen(obs_data_get_json(data->data));
+}
+
+/* ------------------------------------------------------------------------- */
+/* signals */
+
+#define SIGNAL_CALLBACKS 4
+
+static void signal_callback(void *param, calldata_t *cd)
+{
+	UNUSED_PARAMETER(param);
+	bench_sink += (uint64_t)calldata_int(cd, "value");
+}
+
+static bool setup_signal(struct bench_state *state)
+{
+	signal_handler_t *handler = signal_handler_create();
+
+	signal_handler_add(handler, "void bench_signal(ptr source, int value)");
+	for (intptr_t i = 0; i < SIGNAL_CALLBACKS; i++)
+		signal_handler_connect(handler, "bench_signal", signal_callback, (void *)i);
+
+	state->data = handler;
+	return true;
+}
+
+static void teardown_signal(struct bench_state *state)
+{
+	signal_handler_destroy(state->data);
+}
+
+static void bench_signal(struct bench_state *state)
+{
+	uint8_t stack[128];
+	calldata_t cd;
+
+	for (uint64_t i = 0; i < state->iterations; i++) {
+		calldata_init_fixed(&cd, stack, sizeof(stack));
+		calldata_set_ptr(&cd, "source", state);
+		calldata_set_int(&cd, "value", (long long)i);
+		signal_handler_signal(state->data, "bench_signal", &cd);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const struct bench_info benchmarks[] = {
+	{"darray_push_pop", NULL, bench_darray_push_pop, NULL},
+	{"deque_push_pop", NULL, bench_deque_push_pop, NULL},
+	{"bmem_alloc_free", NULL, bench_bmem_alloc_free, NULL},
+	{"compress_uyvx_to_nv12_1080p", setup_compress_uyvx, bench_compress_uyvx_to_nv12, teardown_frames},
+	{"decompress_nv12_1080p", setup_decompress_nv12, bench_decompress_nv12, teardown_frames},
+	{"decompress_422_1080p", setup_decompress_422, bench_decompress_422, teardown_frames},
+	{"video_scaler_nv12_1080p_to_720p", setup_scaler_single, bench_video_scaler, teardown_frames},
+	{"video_scaler_nv12_1080p_to_720p_threaded", setup_scaler_threaded, bench_video_scaler, teardown_frames},
+	{"video_scaler_p010_1080p_to_720p", setup_scaler_p010, bench_video_scaler, teardown_frames},
+	{"video_scaler_p010_1080p_to_720p_threaded", setup_scaler_p010_threaded, bench_video_scaler, teardown_frames},
+	{"video_scaler_i010_1080p_to_720p", setup_scaler_i010, bench_video_scaler, teardown_frames},
+	{"video_scaler_i010_1080p_to_720p_threaded", setup_scaler_i010_threaded, bench_video_scaler, teardown_frames},
+	{"audio_compressor_gain_1024", setup_audio_math, bench_audio_gain, teardown_audio_math},
+	{"obs_data_json_load", setup_json, bench_json_load, teardown_json},
+	{"obs_data_json_save", setup_json, bench_json_save, teardown_json},
+	{"signal_dispatch", setup_signal, bench_signal, teardown_signal},
+};
+
+static bool verbose_log = false;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	if (log_level <= LOG_WARNING || verbose_log) {
+		vfprintf(stderr, msg, args);
+		fputc('\n', stderr);
+	}
+
+	UNUSED_PARAMETER(param);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double val_a = *(const double *)a;
+	double val_b = *(const double *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static uint64_t time_run(const struct bench_info *bench, struct bench_state *state, uint64_t iterations)
+{
+	state->iterations = iterations;
+
+	uint64_t start = os_gettime_ns();
+	bench->run(state);
+	return os_gettime_ns() - start;
+}
+
+static bool run_bench(const struct bench_config *cfg, const struct bench_info *bench, struct bench_result *result)
+{
+	const uint64_t min_ns = (uint64_t)cfg->min_time_ms * 1000000ULL;
+	struct bench_state state = {0};
+	uint64_t iterations = 1;
+	double *samples;
+
+	if (bench->setup && !bench->setup(&state)) {
+		fprintf(stderr, "%s: setup failed, skipping\n", bench->name);
+		return false;
+	}
+
+	/* grow the iteration count until a run lasts the minimum time */
+	for (;;) {
+		uint64_t elapsed = time_run(bench, &state, iterations);
+		if (elapsed >= min_ns)
+			break;
+
+		uint64_t next = elapsed ? iterations * min_ns / elapsed + 1 : iterations * 100;
+		if (next > iterations * 100)
+			next = iterations * 100;
+		iterations = next > iterations ? next : iterations + 1;
+	}
+
+	samples = bmalloc(sizeof(double) * cfg->repetitions);
+	long allocs = 0;
+
+	for (int i = 0; i < cfg->repetitions; i++) {
+		long allocs_start = bnum_total_allocs();
+		uint64_t elapsed = time_run(bench, &state, iterations);
+
+		allocs += bnum_total_allocs() - allocs_start;
+		samples[i] = (double)elapsed / (double)iterations;
+	}
+
+	qsort(samples, cfg->repetitions, sizeof(double), compare_double);
+
+	result->name = bench->name;
+	result->iterations = iterations;
+	result->ns_per_op = samples[cfg->repetitions / 2];
+	result->ns_per_op_min = samples[0];
+	result->ns_per_op_max = samples[cfg->repetitions - 1];
+	result->bytes_per_second = state.bytes_per_op ? (double)state.bytes_per_op * 1e9 / result->ns_per_op : 0.0;
+	result->allocs_per_op = (double)allocs / ((double)iterations * cfg->repetitions);
+
+	bfree(samples);
+
+	if (bench->teardown)
+		bench->teardown(&state);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* baseline comparison and output */
+
+static double baseline_ns_per_op(obs_data_array_t *baseline, const char *name)
+{
+	size_t count = baseline ? obs_data_array_count(baseline) : 0;
+	double ns = 0.0;
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(baseline, i);
+
+		if (strcmp(obs_data_get_string(item, "name"), name) == 0)
+			ns = obs_data_get_double(item, "ns_per_op");
+
+		obs_data_release(item);
+		if (ns > 0.0)
+			break;
+	}
+
+	return ns;
+}
+
+static obs_data_t *result_to_data(const struct bench_result *result)
+{
+	obs_data_t *item = obs_data_create();
+
+	obs_data_set_string(item, "name", result->name);
+	obs_data_set_int(item, "iterations", (long long)result->iterations);
+	obs_data_set_double(item, "ns_per_op", result->ns_per_op);
+	obs_data_set_double(item, "ns_per_op_min", result->ns_per_op_min);
+	obs_data_set_double(item, "ns_per_op_max", result->ns_per_op_max);
+	obs_data_set_double(item, "allocs_per_op", result->allocs_per_op);
+	if (result->bytes_per_second > 0.0)
+		obs_data_set_double(item, "bytes_per_second", result->bytes_per_second);
+
+	return item;
+}
+
+static bool write_json(const struct bench_config *cfg, obs_data_array_t *results, int regressions)
+{
+	obs_data_t *root = obs_data_create();
+	bool success = true;
+
+	obs_data_set_string(root, "version", obs_get_version_string());
+	obs_data_set_int(root, "repetitions", cfg->repetitions);
+	obs_data_set_int(root, "min_time_ms", cfg->min_time_ms);
+	if (cfg->baseline_path) {
+		obs_data_set_double(root, "threshold_percent", cfg->threshold);
+		obs_data_set_int(root, "regressions", regressions);
+	}
+	obs_data_set_array(root, "benchmarks", results);
+
+	const char *json = obs_data_get_json_pretty(root);
+
+	/* text results are already on stdout */
+	if (cfg->output_path) {
+		success = os_quick_write_utf8_file(cfg->output_path, json, strlen(json), false);
+		if (!success)
+			fprintf(stderr, "Couldn't write '%s'\n", cfg->output_path);
+	} else {
+		printf("%s\n", json);
+	}
+
+	obs_data_release(root);
+	return success;
+}
+
+static void print_result(const struct bench_result *result, double baseline, bool regressed)
+{
+	printf("%-42s %12.1f ns/op", result->name, result->ns_per_op);
+
+	if (result->bytes_per_second > 0.0)
+		printf(" %10.1f MB/s", result->bytes_per_second / 1000000.0);
+	else
+		printf(" %15s", "");
+
+	printf(" %8.2f allocs/op", result->allocs_per_op);
+
+	if (baseline > 0.0)
+		printf(" %+7.1f%%%s", (result->ns_per_op / baseline - 1.0) * 100.0, regressed ? " REGRESSED" : "");
+
+	printf("\n");
+	fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [options]\n"
+	       "  --filter TEXT       only run benchmarks with TEXT in their name\n"
+	       "  --min-time MS       minimum time of each measured run (default 200)\n"
+	       "  --repetitions N     measured runs, the median is reported (default 5)\n"
+	       "  --format FORMAT     text or json (default text)\n"
+	       "  --output FILE       also write the results there as JSON\n"
+	       "  --baseline FILE     compare against the JSON of an earlier run\n"
+	       "  --threshold PCT     slowdown over the baseline that counts as a\n"
+	       "                      regression (default 10)\n"
+	       "  --list              list the benchmarks and exit\n"
+	       "  --verbose           print the libobs log\n"
+	       "\n"
+	       "Exits with 2 when a benchmark regressed against the baseline.\n",
+	       name);
+}
+
+static bool parse_args(struct bench_config *cfg, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			cfg->verbose = true;
+			continue;
+		}
+		if (strcmp(arg, "--list") == 0) {
+			cfg->list = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--filter") == 0) {
+			cfg->filter = val;
+		} else if (strcmp(arg, "--min-time") == 0) {
+			cfg->min_time_ms = atoi(val);
+		} else if (strcmp(arg, "--repetitions") == 0) {
+			cfg->repetitions = atoi(val);
+		} else if (strcmp(arg, "--format") == 0) {
+			if (strcmp(val, "json") == 0)
+				cfg->json = true;
+			else if (strcmp(val, "text") != 0)
+				return false;
+		} else if (strcmp(arg, "--output") == 0) {
+			cfg->output_path = val;
+		} else if (strcmp(arg, "--baseline") == 0) {
+			cfg->baseline_path = val;
+		} else if (strcmp(arg, "--threshold") == 0) {
+			cfg->threshold = atof(val);
+		} else {
+			return false;
+		}
+		i++;
+	}
+
+	return cfg->min_time_ms > 0 && cfg->repetitions > 0 && cfg->threshold >= 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config cfg = {
+		.min_time_ms = 200,
+		.repetitions = 5,
+		.threshold = 10.0,
+	};
+	obs_data_t *baseline_data = NULL;
+	obs_data_array_t *baseline = NULL;
+	int regressions = 0;
+	int ret = 0;
+
+	if (!parse_args(&cfg, argc, argv)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (cfg.list) {
+		for (size_t i = 0; i < OBS_COUNTOF(benchmarks); i++)
+			printf("%s\n", benchmarks[i].name);
+		return 0;
+	}
+
+	verbose_log = cfg.verbose;
+	base_set_log_handler(do_log, NULL);
+
+	if (cfg.baseline_path) {
+		baseline_data = obs_data_create_from_json_file(cfg.baseline_path);
+		if (!baseline_data) {
+			fprintf(stderr, "Couldn't load baseline '%s'\n", cfg.baseline_path);
+			return 1;
+		}
+		baseline = obs_data_get_array(baseline_data, "benchmarks");
+	}
+
+	obs_data_array_t *results = obs_data_array_create();
+
+	for (size_t i = 0; i < OBS_COUNTOF(benchmarks); i++) {
+		const struct bench_info *bench = &benchmarks[i];
+		struct bench_result result;
+
+		if (cfg.filter && !strstr(bench->name, cfg.filter))
+			continue;
+		if (!run_bench(&cfg, bench, &result))
+			continue;
+
+		double base = baseline_ns_per_op(baseline, bench->name);
+		bool regressed = base > 0.0 && result.ns_per_op > base * (1.0 + cfg.threshold / 100.0);
+		if (regressed)
+			regressions++;
+
+		obs_data_t *item = result_to_data(&result);
+		if (base > 0.0) {
+			obs_data_set_double(item, "baseline_ns_per_op", base);
+			obs_data_set_double(item, "change_percent", (result.ns_per_op / base - 1.0) * 100.0);
+			obs_data_set_bool(item, "regressed", regressed);
+		}
+		obs_data_array_push_back(results, item);
+		obs_data_release(item);
+
+		if (!cfg.json)
+			print_result(&result, base, regressed);
+	}
+
+	if ((cfg.json || cfg.output_path) && !write_json(&cfg, results, regressions))
+		ret = 1;
+	else if (regressions)
+		ret = 2;
+
+	if (!cfg.json && cfg.baseline_path)
+		printf("%d of %zu benchmarks regressed by more than %.1f%%\n", regressions,
+		       obs_data_array_count(results), cfg.threshold);
+
+	obs_data_array_release(results);
+	obs_data_array_release(baseline);
+	obs_data_release(baseline_data);
+
+	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	return ret;
+}
@@ -0,0 +1,1532 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* Headless network output benchmark.  A pass-through video encoder hands
+ * out the access units of an H.264 Annex B file at the frame rate, with
+ * real AAC audio of the silent mix next to it, to rtmp_output and (when
+ * built with libsrt) ffmpeg_mpegts_muxer.  Each sends to a loopback sink
+ * running in the same process.  A run with an output that drops every
+ * packet is the baseline.  Prints, as JSON, the CPU each output costs per
+ * Mbps over that baseline, syscalls per second, and the latency from the
+ * encoder handing a packet off to the sink receiving it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <obs-nal.h>
+#include <obs-avc.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET bench_socket_t;
+#define INVALID_BENCH_SOCKET INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <time.h>
+typedef int bench_socket_t;
+#define INVALID_BENCH_SOCKET -1
+#define close_socket close
+#endif
+
+#ifdef HAVE_SRT
+#include <srt/srt.h>
+#endif
+
+#ifdef _WIN32
+#define DEFAULT_RENDERER "libobs-d3d11"
+#else
+#define DEFAULT_RENDERER "libobs-opengl"
+#endif
+
+#define CONNECT_TIMEOUT_NS 10000000000ULL
+#define STOP_TIMEOUT_NS 10000000000ULL
+#define SINK_POLL_MSEC 100
+
+/* user data unregistered SEI put in front of the slices of every access
+ * unit, carrying the time the encoder handed the packet off.  the time is
+ * written one nibble per byte, 0x40 to 0x4F, so that the payload never
+ * needs emulation prevention and the sink can find it in the raw stream */
+#define MARKER_UUID_SIZE 16
+#define MARKER_TIME_SIZE 16
+#define MARKER_SIZE (MARKER_UUID_SIZE + MARKER_TIME_SIZE)
+
+static const uint8_t marker_uuid[MARKER_UUID_SIZE] = {0x6f, 0x62, 0x73, 0x2d, 0x6f, 0x75, 0x74, 0x70,
+						      0x75, 0x74, 0x2d, 0x62, 0x65, 0x6e, 0x63, 0x68};
+
+#define RTMP_SIG_SIZE 1536
+#define RTMP_DEFAULT_CHUNK_SIZE 128
+#define RTMP_MAX_CHUNK_STREAMS 64
+
+#define TS_PACKET_SIZE 188
+#define TS_MAX_PIDS 8
+
+struct bench_config {
+	char **outputs;
+	const char *input_path;
+	const char *output_path;
+	const char *renderer;
+	int audio_bitrate;
+	int fps;
+	int seconds;
+	bool verbose;
+};
+
+struct access_unit {
+	size_t offset;
+	size_t size;
+	/* where the marker goes, before the first slice */
+	size_t vcl_offset;
+	bool keyframe;
+	bool has_headers;
+};
+
+struct input_file {
+	uint8_t *data;
+	size_t size;
+	DARRAY(struct access_unit) aus;
+	DARRAY(uint8_t) headers;
+};
+
+struct marker_scanner {
+	uint8_t carry[MARKER_SIZE - 1];
+	size_t carry_size;
+};
+
+struct sink {
+	bench_socket_t listen_socket;
+#ifdef HAVE_SRT
+	SRTSOCKET srt_listen_socket;
+#endif
+	int port;
+
+	pthread_t thread;
+	bool thread_active;
+	volatile bool stop;
+
+	/* only counted while measuring */
+	pthread_mutex_t mutex;
+	bool measuring;
+	uint64_t bytes;
+	DARRAY(uint64_t) latencies;
+
+	/* CPU time spent in the sink thread, written when it exits */
+	uint64_t cpu_ns;
+};
+
+struct rtmp_chunk_stream {
+	uint32_t length;
+	uint8_t type;
+	uint32_t stream_id;
+	bool extended_ts;
+	DARRAY(uint8_t) payload;
+};
+
+struct rtmp_conn {
+	struct sink *sink;
+	bench_socket_t socket;
+	bool handshake_done;
+	uint32_t chunk_size;
+	struct rtmp_chunk_stream streams[RTMP_MAX_CHUNK_STREAMS];
+};
+
+struct proc_io {
+	uint64_t reads;
+	uint64_t writes;
+};
+
+/* the file the bench encoders read, only one run is active at a time */
+static struct input_file *cur_input = NULL;
+
+/* ------------------------------------------------------------------------- */
+/* input file */
+
+static inline bool is_vcl(uint8_t type)
+{
+	return type >= OBS_NAL_SLICE && type <= OBS_NAL_SLICE_IDR;
+}
+
+/* splits the stream into access units: a new one starts at an AUD, SPS,
+ * PPS or SEI, or at a slice with first_mb_in_slice 0, after a slice */
+static bool input_file_load(struct input_file *input, const char *path)
+{
+	struct access_unit au = {0};
+	bool au_has_vcl = false;
+	FILE *file = os_fopen(path, "rb");
+	const uint8_t *nal_start, *nal_end, *nal_codestart;
+	const uint8_t *end;
+	int64_t size;
+
+	memset(input, 0, sizeof(*input));
+
+	if (!file)
+		return false;
+
+	size = os_fgetsize(file);
+	if (size <= 0) {
+		fclose(file);
+		return false;
+	}
+
+	input->data = bmalloc((size_t)size);
+	input->size = fread(input->data, 1, (size_t)size, file);
+	fclose(file);
+
+	end = input->data + input->size;
+	nal_start = obs_nal_find_startcode(input->data, end);
+	nal_end = NULL;
+
+	while (nal_end != end) {
+		nal_codestart = nal_start;
+
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		const uint8_t type = nal_start[0] & 0x1F;
+		const bool first_slice = is_vcl(type) && nal_start + 1 < end && (nal_start[1] & 0x80);
+
+		nal_end = obs_nal_find_startcode(nal_start, end);
+		if (!nal_end)
+			nal_end = end;
+
+		const size_t offset = nal_codestart - input->data;
+
+		if (au_has_vcl && (first_slice || type == OBS_NAL_AUD || type == OBS_NAL_SPS || type == OBS_NAL_PPS ||
+				   type == OBS_NAL_SEI)) {
+			au.size = offset - au.offset;
+			da_push_back(input->aus, &au);
+
+			memset(&au, 0, sizeof(au));
+			au.offset = offset;
+			au_has_vcl = false;
+		}
+
+		if (type == OBS_NAL_SPS || type == OBS_NAL_PPS) {
+			au.has_headers = true;
+
+			/* the first SPS and PPS are the extra data */
+			if (!input->aus.num && !au_has_vcl)
+				da_push_back_array(input->headers, nal_codestart, nal_end - nal_codestart);
+		}
+
+		if (is_vcl(type)) {
+			if (!au_has_vcl)
+				au.vcl_offset = offset - au.offset;
+			au_has_vcl = true;
+		}
+		if (type == OBS_NAL_SLICE_IDR)
+			au.keyframe = true;
+
+		nal_start = nal_end;
+	}
+
+	if (au_has_vcl) {
+		au.size = input->size - au.offset;
+		da_push_back(input->aus, &au);
+	}
+
+	return input->aus.num && input->headers.num && input->aus.array[0].keyframe;
+}
+
+static void input_file_free(struct input_file *input)
+{
+	bfree(input->data);
+	da_free(input->aus);
+	da_free(input->headers);
+}
+
+/* ------------------------------------------------------------------------- */
+/* bench_file_video: hands out the file's access units, one per frame, and
+ * starts over at the first keyframe when it runs out */
+
+struct file_encoder {
+	const struct input_file *input;
+	size_t next_au;
+	bool repeat_headers;
+	DARRAY(uint8_t) packet;
+};
+
+static const char *file_encoder_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Output Benchmark File Encoder";
+}
+
+static void *file_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct file_encoder *enc;
+
+	if (!cur_input)
+		return NULL;
+
+	enc = bzalloc(sizeof(*enc));
+	enc->input = cur_input;
+	enc->repeat_headers = obs_data_get_bool(settings, "repeat_headers");
+
+	UNUSED_PARAMETER(encoder);
+	return enc;
+}
+
+static void file_encoder_destroy(void *data)
+{
+	struct file_encoder *enc = data;
+
+	da_free(enc->packet);
+	bfree(enc);
+}
+
+static void push_marker(struct file_encoder *enc)
+{
+	static const uint8_t sei_header[] = {0, 0, 0, 1, OBS_NAL_SEI, 5, MARKER_SIZE};
+	uint8_t time[MARKER_TIME_SIZE];
+	uint64_t now = os_gettime_ns();
+
+	for (int i = 0; i < MARKER_TIME_SIZE; i++)
+		time[i] = (uint8_t)(0x40 | ((now >> (60 - i * 4)) & 0xF));
+
+	da_push_back_array(enc->packet, sei_header, sizeof(sei_header));
+	da_push_back_array(enc->packet, marker_uuid, MARKER_UUID_SIZE);
+	da_push_back_array(enc->packet, time, MARKER_TIME_SIZE);
+	da_push_back(enc->packet, &(uint8_t){0x80});
+}
+
+static bool file_encoder_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet,
+				bool *received_packet)
+{
+	struct file_encoder *enc = data;
+	const struct input_file *input = enc->input;
+	const struct access_unit *au = input->aus.array + enc->next_au;
+	const uint8_t *au_data = input->data + au->offset;
+
+	if (++enc->next_au == input->aus.num)
+		enc->next_au = 0;
+
+	da_resize(enc->packet, 0);
+	da_push_back_array(enc->packet, au_data, au->vcl_offset);
+	if (au->keyframe && !au->has_headers && enc->repeat_headers)
+		da_push_back_array(enc->packet, input->headers.array, input->headers.num);
+	push_marker(enc);
+	da_push_back_array(enc->packet, au_data + au->vcl_offset, au->size - au->vcl_offset);
+
+	packet->data = enc->packet.array;
+	packet->size = enc->packet.num;
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->keyframe = au->keyframe;
+	packet->priority = au->keyframe ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
+	packet->drop_priority = packet->priority;
+
+	*received_packet = true;
+	return true;
+}
+
+static bool file_encoder_extra_data(void *data, uint8_t **extra_data, size_t *size)
+{
+	struct file_encoder *enc = data;
+
+	*extra_data = enc->input->headers.array;
+	*size = enc->input->headers.num;
+	return true;
+}
+
+static struct obs_encoder_info file_encoder = {
+	.id = "bench_file_video",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = file_encoder_name,
+	.create = file_encoder_create,
+	.destroy = file_encoder_destroy,
+	.encode = file_encoder_encode,
+	.get_extra_data = file_encoder_extra_data,
+};
+
+/* ------------------------------------------------------------------------- */
+/* bench_null_output: takes the packets and drops them, for the baseline */
+
+static const char *null_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Output Benchmark Null Output";
+}
+
+static void *null_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void null_output_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool null_output_start(void *data)
+{
+	obs_output_t *output = data;
+
+	if (!obs_output_can_begin_data_capture(output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void null_output_stop(void *data, uint64_t ts)
+{
+	obs_output_end_data_capture(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static void null_output_packet(void *data, struct encoder_packet *packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(packet);
+}
+
+static struct obs_output_info null_output = {
+	.id = "bench_null_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.get_name = null_output_name,
+	.create = null_output_create,
+	.destroy = null_output_destroy,
+	.start = null_output_start,
+	.stop = null_output_stop,
+	.encoded_packet = null_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* measurements */
+
+static uint64_t thread_cpu_ns(void)
+{
+#ifdef _WIN32
+	FILETIME create, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user))
+		return 0;
+
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) * 100;
+#else
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* read and write family syscalls of the process so far, Linux only */
+static bool proc_io_get(struct proc_io *io)
+{
+#ifdef __linux__
+	FILE *file = fopen("/proc/self/io", "r");
+	unsigned long long val;
+	char line[128];
+	int found = 0;
+
+	if (!file)
+		return false;
+
+	while (fgets(line, sizeof(line), file)) {
+		if (sscanf(line, "syscr: %llu", &val) == 1) {
+			io->reads = val;
+			found++;
+		} else if (sscanf(line, "syscw: %llu", &val) == 1) {
+			io->writes = val;
+			found++;
+		}
+	}
+
+	fclose(file);
+	return found == 2;
+#else
+	UNUSED_PARAMETER(io);
+	return false;
+#endif
+}
+
+static uint64_t decode_marker_time(const uint8_t *time)
+{
+	uint64_t val = 0;
+
+	for (int i = 0; i < MARKER_TIME_SIZE; i++)
+		val = (val << 4) | (time[i] & 0xF);
+	return val;
+}
+
+static void add_latency(struct sink *sink, const uint8_t *time)
+{
+	const uint64_t now = os_gettime_ns();
+	const uint64_t sent = decode_marker_time(time);
+
+	if (sent > now)
+		return;
+
+	pthread_mutex_lock(&sink->mutex);
+	if (sink->measuring)
+		da_push_back(sink->latencies, &(uint64_t){now - sent});
+	pthread_mutex_unlock(&sink->mutex);
+}
+
+static void add_bytes(struct sink *sink, size_t size)
+{
+	pthread_mutex_lock(&sink->mutex);
+	if (sink->measuring)
+		sink->bytes += size;
+	pthread_mutex_unlock(&sink->mutex);
+}
+
+static void find_markers(struct sink *sink, const uint8_t *data, size_t size)
+{
+	const uint8_t *end = data + size;
+
+	while ((size_t)(end - data) >= MARKER_SIZE) {
+		const uint8_t *p = memchr(data, marker_uuid[0], end - data - MARKER_SIZE + 1);
+		if (!p)
+			break;
+
+		if (memcmp(p, marker_uuid, MARKER_UUID_SIZE) == 0) {
+			add_latency(sink, p + MARKER_UUID_SIZE);
+			data = p + MARKER_SIZE;
+		} else {
+			data = p + 1;
+		}
+	}
+}
+
+/* finds markers in a stream that comes in pieces, a marker can be split
+ * over two of them */
+static void scan_markers(struct sink *sink, struct marker_scanner *scanner, const uint8_t *data, size_t size)
+{
+	uint8_t joined[(MARKER_SIZE - 1) * 2];
+	size_t head = size < MARKER_SIZE - 1 ? size : MARKER_SIZE - 1;
+
+	if (scanner->carry_size) {
+		memcpy(joined, scanner->carry, scanner->carry_size);
+		memcpy(joined + scanner->carry_size, data, head);
+		find_markers(sink, joined, scanner->carry_size + head);
+	}
+
+	find_markers(sink, data, size);
+
+	if (size >= MARKER_SIZE - 1) {
+		memcpy(scanner->carry, data + size - (MARKER_SIZE - 1), MARKER_SIZE - 1);
+		scanner->carry_size = MARKER_SIZE - 1;
+	} else {
+		size_t keep = scanner->carry_size + size;
+		if (keep > MARKER_SIZE - 1)
+			keep = MARKER_SIZE - 1;
+
+		memcpy(joined, scanner->carry, scanner->carry_size);
+		memcpy(joined + scanner->carry_size, data, size);
+		memcpy(scanner->carry, joined + scanner->carry_size + size - keep, keep);
+		scanner->carry_size = keep;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* sockets */
+
+static bool send_all(bench_socket_t sock, const uint8_t *data, size_t size)
+{
+	while (size) {
+		int ret = (int)send(sock, (const char *)data, (int)size, 0);
+		if (ret <= 0)
+			return false;
+
+		data += ret;
+		size -= ret;
+	}
+
+	return true;
+}
+
+/* waits up to SINK_POLL_MSEC for the socket to become readable */
+static bool wait_readable(bench_socket_t sock)
+{
+	struct timeval tv = {0, SINK_POLL_MSEC * 1000};
+	fd_set set;
+
+	FD_ZERO(&set);
+	FD_SET(sock, &set);
+	return select((int)sock + 1, &set, NULL, NULL, &tv) > 0;
+}
+
+static bench_socket_t listen_tcp(int *port)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t len = sizeof(addr);
+	bench_socket_t sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	if (sock == INVALID_BENCH_SOCKET)
+		return INVALID_BENCH_SOCKET;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, 1) != 0 ||
+	    getsockname(sock, (struct sockaddr *)&addr, &len) != 0) {
+		close_socket(sock);
+		return INVALID_BENCH_SOCKET;
+	}
+
+	*port = ntohs(addr.sin_port);
+	return sock;
+}
+
+/* ------------------------------------------------------------------------- */
+/* RTMP sink: answers the handshake, connect, createStream and publish just
+ * enough for librtmp to start sending, then takes everything it gets */
+
+static inline uint32_t get_be24(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void amf_string(struct darray *da, const char *str)
+{
+	DARRAY(uint8_t) d;
+	size_t len = strlen(str);
+
+	d.da = *da;
+	da_push_back(d, &(uint8_t){0x02});
+	da_push_back(d, &(uint8_t){(uint8_t)(len >> 8)});
+	da_push_back(d, &(uint8_t){(uint8_t)len});
+	da_push_back_array(d, (const uint8_t *)str, len);
+	*da = d.da;
+}
+
+static void amf_number(struct darray *da, double val)
+{
+	DARRAY(uint8_t) d;
+	uint64_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+
+	d.da = *da;
+	da_push_back(d, &(uint8_t){0x00});
+	for (int i = 7; i >= 0; i--)
+		da_push_back(d, &(uint8_t){(uint8_t)(bits >> (i * 8))});
+	*da = d.da;
+}
+
+static void amf_null(struct darray *da)
+{
+	DARRAY(uint8_t) d;
+
+	d.da = *da;
+	da_push_back(d, &(uint8_t){0x05});
+	*da = d.da;
+}
+
+/* an object of string properties, NULL terminated name/value pairs */
+static void amf_status_object(struct darray *da, const char *const *props)
+{
+	DARRAY(uint8_t) d;
+
+	d.da = *da;
+	da_push_back(d, &(uint8_t){0x03});
+	for (; *props; props += 2) {
+		size_t len = strlen(props[0]);
+
+		da_push_back(d, &(uint8_t){(uint8_t)(len >> 8)});
+		da_push_back(d, &(uint8_t){(uint8_t)len});
+		da_push_back_array(d, (const uint8_t *)props[0], len);
+		*da = d.da;
+		amf_string(da, props[1]);
+		d.da = *da;
+	}
+	da_push_back_array(d, ((const uint8_t[]){0, 0, 9}), 3);
+	*da = d.da;
+}
+
+/* sends an AMF0 command on chunk stream 3 in the default chunk size */
+static bool rtmp_send_command(struct rtmp_conn *conn, uint32_t stream_id, const uint8_t *payload, size_t size)
+{
+	uint8_t header[12] = {0x03, 0, 0, 0, (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size, 0x14,
+			      (uint8_t)stream_id, (uint8_t)(stream_id >> 8), (uint8_t)(stream_id >> 16),
+			      (uint8_t)(stream_id >> 24)};
+
+	if (!send_all(conn->socket, header, sizeof(header)))
+		return false;
+
+	while (size) {
+		size_t chunk = size < RTMP_DEFAULT_CHUNK_SIZE ? size : RTMP_DEFAULT_CHUNK_SIZE;
+
+		if (!send_all(conn->socket, payload, chunk))
+			return false;
+
+		payload += chunk;
+		size -= chunk;
+
+		if (size && !send_all(conn->socket, &(uint8_t){0xC3}, 1))
+			return false;
+	}
+
+	return true;
+}
+
+static bool rtmp_handle_command(struct rtmp_conn *conn, const uint8_t *data, size_t size, uint32_t stream_id)
+{
+	DARRAY(uint8_t) reply;
+	char name[32];
+	uint64_t bits = 0;
+	double txn;
+	size_t len;
+	bool success = true;
+
+	/* name string, then the transaction number */
+	if (size < 3 || data[0] != 0x02)
+		return true;
+	len = ((size_t)data[1] << 8) | data[2];
+	if (len >= sizeof(name) || size < 3 + len + 9 || data[3 + len] != 0x00)
+		return true;
+
+	memcpy(name, data + 3, len);
+	name[len] = 0;
+	for (int i = 0; i < 8; i++)
+		bits = (bits << 8) | data[4 + len + i];
+	memcpy(&txn, &bits, sizeof(txn));
+
+	da_init(reply);
+
+	if (strcmp(name, "connect") == 0) {
+		static const char *const props[] = {"level", "status", "code", "NetConnection.Connect.Success", NULL};
+
+		amf_string(&reply.da, "_result");
+		amf_number(&reply.da, txn);
+		amf_null(&reply.da);
+		amf_status_object(&reply.da, props);
+		success = rtmp_send_command(conn, 0, reply.array, reply.num);
+
+	} else if (strcmp(name, "createStream") == 0) {
+		amf_string(&reply.da, "_result");
+		amf_number(&reply.da, txn);
+		amf_null(&reply.da);
+		amf_number(&reply.da, 1.0);
+		success = rtmp_send_command(conn, 0, reply.array, reply.num);
+
+	} else if (strcmp(name, "publish") == 0) {
+		static const char *const props[] = {"level", "status", "code", "NetStream.Publish.Start", NULL};
+
+		amf_string(&reply.da, "onStatus");
+		amf_number(&reply.da, 0.0);
+		amf_null(&reply.da);
+		amf_status_object(&reply.da, props);
+		success = rtmp_send_command(conn, stream_id, reply.array, reply.num);
+	}
+
+	da_free(reply);
+	return success;
+}
+
+static bool rtmp_handle_message(struct rtmp_conn *conn, struct rtmp_chunk_stream *cs, uint32_t stream_id)
+{
+	const uint8_t *data = cs->payload.array;
+	const size_t size = cs->payload.num;
+
+	switch (cs->type) {
+	case 1: /* set chunk size */
+		if (size >= 4)
+			conn->chunk_size = get_be32(data) & 0x7FFFFFFF;
+		return conn->chunk_size != 0;
+	case 9: /* video */
+		find_markers(conn->sink, data, size);
+		return true;
+	case 20: /* AMF0 command */
+		return rtmp_handle_command(conn, data, size, stream_id);
+	default:
+		return true;
+	}
+}
+
+/* parses one chunk, returns how much of data it took, 0 if the chunk isn't
+ * complete yet and -1 on errors */
+static int64_t rtmp_parse_chunk(struct rtmp_conn *conn, const uint8_t *data, size_t size)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = data + size;
+	struct rtmp_chunk_stream *cs;
+	uint32_t csid;
+	int fmt;
+
+	if (p == end)
+		return 0;
+
+	fmt = *p >> 6;
+	csid = *p++ & 0x3F;
+	if (csid < 2 || csid >= RTMP_MAX_CHUNK_STREAMS)
+		return -1;
+
+	cs = &conn->streams[csid];
+
+	if (fmt <= 2) {
+		static const size_t header_sizes[] = {11, 7, 3};
+		uint32_t ts;
+
+		if ((size_t)(end - p) < header_sizes[fmt])
+			return 0;
+
+		ts = get_be24(p);
+		if (fmt <= 1) {
+			cs->length = get_be24(p + 3);
+			cs->type = p[6];
+		}
+		if (fmt == 0)
+			cs->stream_id = p[7] | (p[8] << 8) | (p[9] << 16) | ((uint32_t)p[10] << 24);
+
+		p += header_sizes[fmt];
+		cs->extended_ts = ts == 0xFFFFFF;
+	}
+
+	if (cs->extended_ts) {
+		if (end - p < 4)
+			return 0;
+		p += 4;
+	}
+
+	size_t remaining = cs->length - cs->payload.num;
+	size_t chunk = remaining < conn->chunk_size ? remaining : conn->chunk_size;
+
+	if ((size_t)(end - p) < chunk)
+		return 0;
+
+	da_push_back_array(cs->payload, p, chunk);
+	p += chunk;
+
+	if (cs->payload.num == cs->length) {
+		bool success = rtmp_handle_message(conn, cs, cs->stream_id);
+
+		da_resize(cs->payload, 0);
+		if (!success)
+			return -1;
+	}
+
+	return p - data;
+}
+
+/* returns how much of data was used */
+static int64_t rtmp_parse(struct rtmp_conn *conn, const uint8_t *data, size_t size)
+{
+	size_t pos = 0;
+
+	if (!conn->handshake_done) {
+		uint8_t s0s1s2[1 + RTMP_SIG_SIZE * 2] = {0x03};
+
+		/* C0 C1 in, S0 S1 S2 out (S2 echoing C1), then C2 in */
+		if (size < 1 + RTMP_SIG_SIZE * 2)
+			return 0;
+
+		memcpy(s0s1s2 + 1 + RTMP_SIG_SIZE, data + 1, RTMP_SIG_SIZE);
+		if (!send_all(conn->socket, s0s1s2, sizeof(s0s1s2)))
+			return -1;
+
+		conn->handshake_done = true;
+		pos = 1 + RTMP_SIG_SIZE * 2;
+	}
+
+	while (pos < size) {
+		int64_t used = rtmp_parse_chunk(conn, data + pos, size - pos);
+		if (used < 0)
+			return -1;
+		if (used == 0)
+			break;
+		pos += (size_t)used;
+	}
+
+	return (int64_t)pos;
+}
+
+static bench_socket_t accept_connection(struct sink *sink)
+{
+	while (!os_atomic_load_bool(&sink->stop)) {
+		if (wait_readable(sink->listen_socket))
+			return accept(sink->listen_socket, NULL, NULL);
+	}
+
+	return INVALID_BENCH_SOCKET;
+}
+
+static void *rtmp_sink_thread(void *data)
+{
+	struct sink *sink = data;
+	struct rtmp_conn conn = {.sink = sink, .chunk_size = RTMP_DEFAULT_CHUNK_SIZE};
+	DARRAY(uint8_t) in;
+	uint8_t buf[65536];
+
+	os_set_thread_name("output-bench: rtmp sink");
+	da_init(in);
+
+	conn.socket = accept_connection(sink);
+	if (conn.socket == INVALID_BENCH_SOCKET)
+		goto finish;
+
+	while (!os_atomic_load_bool(&sink->stop)) {
+		if (!wait_readable(conn.socket))
+			continue;
+
+		int ret = (int)recv(conn.socket, (char *)buf, sizeof(buf), 0);
+		if (ret <= 0)
+			break;
+
+		add_bytes(sink, ret);
+		da_push_back_array(in, buf, ret);
+
+		int64_t used = rtmp_parse(&conn, in.array, in.num);
+		if (used < 0) {
+			blog(LOG_WARNING, "RTMP sink: invalid data, closing the connection");
+			break;
+		}
+		da_erase_range(in, 0, (size_t)used);
+	}
+
+	close_socket(conn.socket);
+
+finish:
+	for (size_t i = 0; i < RTMP_MAX_CHUNK_STREAMS; i++)
+		da_free(conn.streams[i].payload);
+	da_free(in);
+
+	sink->cpu_ns = thread_cpu_ns();
+	return NULL;
+}
+
+static bool rtmp_sink_start(struct sink *sink)
+{
+	sink->listen_socket = listen_tcp(&sink->port);
+	if (sink->listen_socket == INVALID_BENCH_SOCKET)
+		return false;
+
+	sink->thread_active = pthread_create(&sink->thread, NULL, rtmp_sink_thread, sink) == 0;
+	return sink->thread_active;
+}
+
+/* ------------------------------------------------------------------------- */
+/* SRT sink: takes the MPEG-TS and looks for markers per PID */
+
+#ifdef HAVE_SRT
+struct ts_pid_scanner {
+	int pid;
+	struct marker_scanner scanner;
+};
+
+static void scan_ts_packet(struct sink *sink, struct ts_pid_scanner *pids, const uint8_t *p)
+{
+	const int pid = ((p[1] & 0x1F) << 8) | p[2];
+	const int afc = (p[3] >> 4) & 3;
+	size_t offset = 4;
+
+	if (p[0] != 0x47 || !(afc & 1))
+		return;
+	if (afc & 2)
+		offset += 1 + (size_t)p[4];
+	if (offset >= TS_PACKET_SIZE)
+		return;
+
+	for (size_t i = 0; i < TS_MAX_PIDS; i++) {
+		if (pids[i].pid == pid || pids[i].pid == -1) {
+			pids[i].pid = pid;
+			scan_markers(sink, &pids[i].scanner, p + offset, TS_PACKET_SIZE - offset);
+			return;
+		}
+	}
+}
+
+static void *srt_sink_thread(void *data)
+{
+	struct sink *sink = data;
+	struct ts_pid_scanner pids[TS_MAX_PIDS];
+	SRTSOCKET sock = SRT_INVALID_SOCK;
+	char buf[1500];
+
+	os_set_thread_name("output-bench: srt sink");
+
+	for (size_t i = 0; i < TS_MAX_PIDS; i++) {
+		pids[i].pid = -1;
+		pids[i].scanner.carry_size = 0;
+	}
+
+	while (!os_atomic_load_bool(&sink->stop) && sock == SRT_INVALID_SOCK) {
+		SRTSOCKET listen_sock = sink->srt_listen_socket;
+		int events = SRT_EPOLL_IN;
+		int eid = srt_epoll_create();
+		SRTSOCKET ready[1];
+		int num = 1;
+
+		srt_epoll_add_usock(eid, listen_sock, &events);
+		if (srt_epoll_wait(eid, ready, &num, NULL, NULL, SINK_POLL_MSEC, NULL, NULL, NULL, NULL) > 0)
+			sock = srt_accept(listen_sock, NULL, NULL);
+		srt_epoll_release(eid);
+	}
+
+	while (sock != SRT_INVALID_SOCK && !os_atomic_load_bool(&sink->stop)) {
+		int ret = srt_recvmsg(sock, buf, sizeof(buf));
+		if (ret == SRT_ERROR) {
+			/* the receive timeout, to check for stopping */
+			if (srt_getlasterror(NULL) == SRT_EASYNCRCV)
+				continue;
+			break;
+		}
+
+		add_bytes(sink, ret);
+		for (int pos = 0; pos + TS_PACKET_SIZE <= ret; pos += TS_PACKET_SIZE)
+			scan_ts_packet(sink, pids, (const uint8_t *)buf + pos);
+	}
+
+	if (sock != SRT_INVALID_SOCK)
+		srt_close(sock);
+
+	sink->cpu_ns = thread_cpu_ns();
+	return NULL;
+}
+
+static bool srt_sink_start(struct sink *sink)
+{
+	struct sockaddr_in addr = {0};
+	int len = sizeof(addr);
+	int timeout = SINK_POLL_MSEC;
+	bool no = false;
+
+	sink->srt_listen_socket = srt_create_socket();
+	if (sink->srt_listen_socket == SRT_INVALID_SOCK)
+		return false;
+
+	/* packets should reach the sink when they arrive, not after the
+	 * receiver latency */
+	srt_setsockflag(sink->srt_listen_socket, SRTO_TSBPDMODE, &no, sizeof(no));
+	srt_setsockflag(sink->srt_listen_socket, SRTO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (srt_bind(sink->srt_listen_socket, (struct sockaddr *)&addr, sizeof(addr)) == SRT_ERROR ||
+	    srt_listen(sink->srt_listen_socket, 1) == SRT_ERROR ||
+	    srt_getsockname(sink->srt_listen_socket, (struct sockaddr *)&addr, &len) == SRT_ERROR)
+		return false;
+
+	sink->port = ntohs(addr.sin_port);
+	sink->thread_active = pthread_create(&sink->thread, NULL, srt_sink_thread, sink) == 0;
+	return sink->thread_active;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static void sink_init(struct sink *sink)
+{
+	memset(sink, 0, sizeof(*sink));
+	sink->listen_socket = INVALID_BENCH_SOCKET;
+#ifdef HAVE_SRT
+	sink->srt_listen_socket = SRT_INVALID_SOCK;
+#endif
+	pthread_mutex_init(&sink->mutex, NULL);
+}
+
+static void sink_set_measuring(struct sink *sink, bool measuring)
+{
+	pthread_mutex_lock(&sink->mutex);
+	sink->measuring = measuring;
+	pthread_mutex_unlock(&sink->mutex);
+}
+
+static void sink_stop(struct sink *sink)
+{
+	os_atomic_set_bool(&sink->stop, true);
+	if (sink->thread_active)
+		pthread_join(sink->thread, NULL);
+	sink->thread_active = false;
+
+	if (sink->listen_socket != INVALID_BENCH_SOCKET)
+		close_socket(sink->listen_socket);
+	sink->listen_socket = INVALID_BENCH_SOCKET;
+#ifdef HAVE_SRT
+	if (sink->srt_listen_socket != SRT_INVALID_SOCK)
+		srt_close(sink->srt_listen_socket);
+	sink->srt_listen_socket = SRT_INVALID_SOCK;
+#endif
+}
+
+static void sink_free(struct sink *sink)
+{
+	sink_stop(sink);
+	da_free(sink->latencies);
+	pthread_mutex_destroy(&sink->mutex);
+}
+
+static bool verbose_log = false;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	if (log_level <= LOG_WARNING || verbose_log) {
+		vfprintf(stderr, msg, args);
+		fputc('\n', stderr);
+	}
+
+	UNUSED_PARAMETER(param);
+}
+
+static bool init_obs(const struct bench_config *cfg)
+{
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	/* the file encoder doesn't look at the frames, they only pace it */
+	struct obs_video_info ovi = {
+		.graphics_module = cfg->renderer,
+		.fps_num = (uint32_t)cfg->fps,
+		.fps_den = 1,
+		.base_width = 64,
+		.base_height = 64,
+		.output_width = 64,
+		.output_height = 64,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BILINEAR,
+	};
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Couldn't initialize video with '%s'", cfg->renderer);
+		return false;
+	}
+
+	struct obs_audio_info oai = {
+		.samples_per_sec = 48000,
+		.speakers = SPEAKERS_STEREO,
+	};
+	if (!obs_reset_audio(&oai)) {
+		blog(LOG_ERROR, "Couldn't initialize audio");
+		return false;
+	}
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	obs_register_encoder(&file_encoder);
+	obs_register_output(&null_output);
+	return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static void add_latency_stats(obs_data_t *result, struct sink *sink)
+{
+	uint64_t *samples = sink->latencies.array;
+	size_t num = sink->latencies.num;
+	uint64_t total = 0;
+
+	if (!num)
+		return;
+
+	qsort(samples, num, sizeof(uint64_t), compare_u64);
+	for (size_t i = 0; i < num; i++)
+		total += samples[i];
+
+	obs_data_set_double(result, "latency_mean_ms", (double)total / (double)num / 1000000.0);
+	obs_data_set_double(result, "latency_p50_ms", (double)samples[num / 2] / 1000000.0);
+	obs_data_set_double(result, "latency_p99_ms", (double)samples[num * 99 / 100] / 1000000.0);
+	obs_data_set_double(result, "latency_max_ms", (double)samples[num - 1] / 1000000.0);
+}
+
+static bool wait_for_active(obs_output_t *output)
+{
+	const uint64_t start = os_gettime_ns();
+
+	while (!obs_output_active(output)) {
+		if (os_gettime_ns() - start > CONNECT_TIMEOUT_NS)
+			return false;
+		os_sleep_ms(10);
+	}
+
+	return true;
+}
+
+static void stop_output(obs_output_t *output)
+{
+	const uint64_t start = os_gettime_ns();
+
+	obs_output_stop(output);
+	while (obs_output_active(output)) {
+		if (os_gettime_ns() - start > STOP_TIMEOUT_NS) {
+			obs_output_force_stop(output);
+			break;
+		}
+		os_sleep_ms(1);
+	}
+}
+
+static const char *output_id(const char *name)
+{
+	if (strcmp(name, "null") == 0)
+		return "bench_null_output";
+	if (strcmp(name, "rtmp") == 0)
+		return "rtmp_output";
+#ifdef HAVE_SRT
+	if (strcmp(name, "srt") == 0)
+		return "ffmpeg_mpegts_muxer";
+#endif
+	return NULL;
+}
+
+static bool start_sink(const char *name, struct sink *sink, struct dstr *url)
+{
+	if (strcmp(name, "rtmp") == 0) {
+		if (!rtmp_sink_start(sink))
+			return false;
+		dstr_printf(url, "rtmp://127.0.0.1:%d/live", sink->port);
+		return true;
+	}
+#ifdef HAVE_SRT
+	if (strcmp(name, "srt") == 0) {
+		if (!srt_sink_start(sink))
+			return false;
+		dstr_printf(url, "srt://127.0.0.1:%d", sink->port);
+		return true;
+	}
+#endif
+	return true;
+}
+
+/* the baseline's CPU usage, subtracted from the network outputs' */
+static double baseline_cpu_percent = 0.0;
+
+static void run_output(const struct bench_config *cfg, const char *name, obs_data_array_t *results)
+{
+	obs_data_t *result = obs_data_create();
+	obs_data_t *service_settings = obs_data_create();
+	obs_data_t *video_settings = obs_data_create();
+	obs_data_t *audio_settings = obs_data_create();
+	obs_service_t *service = NULL;
+	obs_encoder_t *video = NULL;
+	obs_encoder_t *audio = NULL;
+	obs_output_t *output = NULL;
+	os_cpu_usage_info_t *cpu = NULL;
+	const char *id = output_id(name);
+	struct dstr url = {0};
+	struct proc_io io_start = {0}, io_end = {0};
+	struct sink sink;
+
+	sink_init(&sink);
+	obs_data_set_string(result, "output", name);
+
+	if (!id) {
+		obs_data_set_string(result, "error", "Unknown output");
+		goto finish;
+	}
+	obs_data_set_string(result, "output_id", id);
+
+	if (!start_sink(name, &sink, &url)) {
+		obs_data_set_string(result, "error", "Couldn't start the sink");
+		goto finish;
+	}
+
+	if (url.len) {
+		obs_data_set_string(service_settings, "server", url.array);
+		obs_data_set_string(service_settings, "key", "bench");
+		service = obs_service_create("rtmp_custom", "bench service", service_settings, NULL);
+		if (!service) {
+			obs_data_set_string(result, "error", "Couldn't create the service");
+			goto finish;
+		}
+	}
+
+	obs_data_set_int(audio_settings, "bitrate", cfg->audio_bitrate);
+	if (service)
+		obs_service_apply_encoder_settings(service, video_settings, audio_settings);
+
+	video = obs_video_encoder_create("bench_file_video", "bench video", video_settings, NULL);
+	audio = obs_audio_encoder_create("ffmpeg_aac", "bench audio", audio_settings, 0, NULL);
+	if (!video || !audio) {
+		obs_data_set_string(result, "error", "Couldn't create the encoders");
+		goto finish;
+	}
+
+	obs_encoder_set_video(video, obs_get_video());
+	obs_encoder_set_audio(audio, obs_get_audio());
+
+	output = obs_output_create(id, "bench output", NULL, NULL);
+	if (!output) {
+		obs_data_set_string(result, "error", "Couldn't create the output");
+		goto finish;
+	}
+
+	obs_output_set_video_encoder(output, video);
+	obs_output_set_audio_encoder(output, audio, 0);
+	if (service)
+		obs_output_set_service(output, service);
+
+	if (!obs_output_start(output) || !wait_for_active(output)) {
+		const char *error = obs_output_get_last_error(output);
+		obs_data_set_string(result, "error", error ? error : "Couldn't start the output");
+		goto finish;
+	}
+
+	/* let the connection settle before measuring */
+	os_sleep_ms(1000);
+
+	const bool have_io = proc_io_get(&io_start);
+	cpu = os_cpu_usage_info_start();
+	sink_set_measuring(&sink, true);
+	const uint64_t start = os_gettime_ns();
+
+	os_sleep_ms((uint32_t)cfg->seconds * 1000);
+
+	const double cpu_percent = os_cpu_usage_info_query(cpu);
+	const uint64_t duration_ns = os_gettime_ns() - start;
+	sink_set_measuring(&sink, false);
+	proc_io_get(&io_end);
+
+	stop_output(output);
+	sink_stop(&sink);
+
+	const double seconds = (double)duration_ns / 1000000000.0;
+	const double sink_percent =
+		(double)sink.cpu_ns / ((double)duration_ns * (double)os_get_logical_cores()) * 100.0;
+
+	obs_data_set_double(result, "seconds", seconds);
+	obs_data_set_double(result, "cpu_percent", cpu_percent);
+
+	if (strcmp(name, "null") == 0) {
+		baseline_cpu_percent = cpu_percent;
+	} else {
+		const double mbps = (double)sink.bytes * 8.0 / seconds / 1000000.0;
+		const double output_percent = cpu_percent - sink_percent - baseline_cpu_percent;
+
+		obs_data_set_double(result, "sink_cpu_percent", sink_percent);
+		obs_data_set_double(result, "output_cpu_percent", output_percent);
+		obs_data_set_double(result, "received_mbps", mbps);
+		if (mbps > 0.0)
+			obs_data_set_double(result, "cpu_percent_per_mbps", output_percent / mbps);
+		add_latency_stats(result, &sink);
+	}
+
+	if (have_io) {
+		const double writes = (double)(io_end.writes - io_start.writes);
+		const double reads = (double)(io_end.reads - io_start.reads);
+
+		obs_data_set_double(result, "write_syscalls_per_sec", writes / seconds);
+		obs_data_set_double(result, "read_syscalls_per_sec", reads / seconds);
+	}
+
+finish:
+	if (output && obs_output_active(output))
+		stop_output(output);
+	sink_free(&sink);
+
+	os_cpu_usage_info_destroy(cpu);
+	obs_output_release(output);
+	obs_encoder_release(video);
+	obs_encoder_release(audio);
+	obs_service_release(service);
+
+	if (cfg->verbose || obs_data_has_user_value(result, "error"))
+		blog(LOG_INFO, "%s: %s", name,
+		     obs_data_has_user_value(result, "error") ? obs_data_get_string(result, "error") : "done");
+
+	obs_data_array_push_back(results, result);
+	obs_data_release(audio_settings);
+	obs_data_release(video_settings);
+	obs_data_release(service_settings);
+	obs_data_release(result);
+	dstr_free(&url);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s --input FILE [options]\n"
+	       "  --input FILE          H.264 Annex B elementary stream to send\n"
+	       "  --outputs LIST        comma separated, of rtmp"
+#ifdef HAVE_SRT
+	       ", srt"
+#endif
+	       " (default: all)\n"
+	       "  --fps N               frame rate the file is sent at (default 60)\n"
+	       "  --seconds N           measured time per output (default 30)\n"
+	       "  --audio-bitrate KBPS  AAC bitrate (default 160)\n"
+	       "  --output FILE         write the JSON there instead of stdout\n"
+	       "  --renderer MODULE     graphics module (default " DEFAULT_RENDERER ")\n"
+	       "  --verbose             print the libobs log\n"
+	       "\n"
+	       "cpu_percent is of all logical cores and includes the sink, sink_cpu_percent\n"
+	       "is the sink's share.  output_cpu_percent takes both that and the baseline of\n"
+	       "an output that drops everything off.  syscalls are only counted on Linux.\n",
+	       name);
+}
+
+static bool parse_args(struct bench_config *cfg, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			cfg->verbose = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--input") == 0) {
+			cfg->input_path = val;
+		} else if (strcmp(arg, "--outputs") == 0) {
+			strlist_free(cfg->outputs);
+			cfg->outputs = strlist_split(val, ',', false);
+		} else if (strcmp(arg, "--fps") == 0) {
+			cfg->fps = atoi(val);
+		} else if (strcmp(arg, "--seconds") == 0) {
+			cfg->seconds = atoi(val);
+		} else if (strcmp(arg, "--audio-bitrate") == 0) {
+			cfg->audio_bitrate = atoi(val);
+		} else if (strcmp(arg, "--output") == 0) {
+			cfg->output_path = val;
+		} else if (strcmp(arg, "--renderer") == 0) {
+			cfg->renderer = val;
+		} else {
+			return false;
+		}
+		i++;
+	}
+
+	return cfg->input_path && cfg->fps > 0 && cfg->seconds > 0 && cfg->audio_bitrate > 0 && *cfg->outputs;
+}
+
+static bool write_results(const struct bench_config *cfg, obs_data_array_t *results)
+{
+	obs_data_t *root = obs_data_create();
+	bool success = true;
+
+	obs_data_set_array(root, "results", results);
+	const char *json = obs_data_get_json_pretty(root);
+
+	if (cfg->output_path) {
+		success = os_quick_write_utf8_file(cfg->output_path, json, strlen(json), false);
+		if (!success)
+			fprintf(stderr, "Couldn't write '%s'\n", cfg->output_path);
+	} else {
+		printf("%s\n", json);
+	}
+
+	obs_data_release(root);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config cfg = {
+#ifdef HAVE_SRT
+		.outputs = strlist_split("rtmp,srt", ',', false),
+#else
+		.outputs = strlist_split("rtmp", ',', false),
+#endif
+		.renderer = DEFAULT_RENDERER,
+		.audio_bitrate = 160,
+		.fps = 60,
+		.seconds = 30,
+	};
+	struct input_file input;
+	int ret = 0;
+
+	if (!parse_args(&cfg, argc, argv)) {
+		usage(argv[0]);
+		strlist_free(cfg.outputs);
+		return 1;
+	}
+
+	verbose_log = cfg.verbose;
+	base_set_log_handler(do_log, NULL);
+
+	if (!input_file_load(&input, cfg.input_path)) {
+		fprintf(stderr, "Couldn't read H.264 access units starting with a keyframe from '%s'\n",
+			cfg.input_path);
+		input_file_free(&input);
+		strlist_free(cfg.outputs);
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsa_data;
+	WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+#ifdef HAVE_SRT
+	srt_startup();
+#endif
+
+	cur_input = &input;
+
+	if (init_obs(&cfg)) {
+		obs_data_array_t *results = obs_data_array_create();
+
+		run_output(&cfg, "null", results);
+		for (char **name = cfg.outputs; *name; name++)
+			run_output(&cfg, *name, results);
+
+		if (!write_results(&cfg, results))
+			ret = 1;
+
+		obs_data_array_release(results);
+	} else {
+		fprintf(stderr, "Couldn't initialize libobs\n");
+		ret = 1;
+	}
+
+	obs_shutdown();
+	cur_input = NULL;
+
+#ifdef HAVE_SRT
+	srt_cleanup();
+#endif
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	input_file_free(&input);
+	strlist_free(cfg.outputs);
+
+	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	return ret;
+}